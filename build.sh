@@ -31,6 +31,13 @@ webgpu_native_examples() {
     cd "$WORKING_DIR"
 }
 
+pack_assets() {
+    ASSETS_DIR="$BUILD_DIR/Releasex64/assets"
+
+    echo "---------- Packing assets ----------"
+    "$BUILD_DIR/Releasex64/wgpu_asset_packer" "$ASSETS_DIR" "$ASSETS_DIR/assets.pak"
+}
+
 docker_build() {
     WORKING_DIR=`pwd`
 
@@ -70,6 +77,10 @@ while [[ $# -gt 0 ]]; do case "$1" in
     shift
     webgpu_native_examples
     ;;
+  -pack_assets)
+    shift
+    pack_assets
+    ;;
   -docker_build)
     shift
     docker_build
@@ -84,6 +95,7 @@ usage: $0 [options]
 options:
   -update_dawn            Update to the latest version of "depot_tools" and "Dawn"
   -webgpu_native_examples Build WebGPU native examples
+  -pack_assets            Pack the built assets into assets/assets.pak
   -docker_build           Build Docker image for running the examples
   -docker_run             Run the Docker container with the examples
   -help                   Show help on stdout and exit
@@ -24,6 +24,7 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <algorithm>
 #include <unordered_map>
 
 struct WTTFormatMapItem {
@@ -131,14 +132,26 @@ static basist::transcoder_texture_format SelectBasisTextureformat(const std::uno
 }
 // clang-format on
 
-basisu_transcode_result_t
-basisu_transcode(basisu_data_t basisu_data,
-                 WGPUTextureFormat (*supported_formats)[12],
-                 uint32_t supported_format_count, bool mipmaps)
-{
+struct basisu_transcoder {
+  explicit basisu_transcoder(basist::etc1_global_selector_codebook* codebook)
+      : transcoder(codebook)
+  {
+  }
 
-  basisu_transcode_result_t transcodeResult = {};
-  transcodeResult.result_code = BASIS_TRANSCODE_RESULT_TRANSCODE_FAILURE;
+  basist::basisu_transcoder transcoder;
+  basisu_data_t data                       = {};
+  basist::transcoder_texture_format format = {};
+};
+
+basisu_transcoder_t*
+basisu_transcoder_create(basisu_data_t basisu_data,
+                         const WGPUTextureFormat* supported_formats,
+                         uint32_t supported_format_count, bool mipmaps,
+                         basisu_image_desc_t* image_desc,
+                         uint32_t* result_code)
+{
+  *image_desc  = {};
+  *result_code = BASIS_TRANSCODE_RESULT_TRANSCODE_FAILURE;
 
   // The formats this device supports
   std::unordered_map<basist::transcoder_texture_format, bool>
@@ -148,7 +161,7 @@ basisu_transcode(basisu_data_t basisu_data,
     const auto wttFormat                = item.second.format;
     supportedBasisFormats[targetFormat] = false;
     for (uint32_t i = 0; i < supported_format_count; ++i) {
-      if ((*supported_formats)[i] == wttFormat) {
+      if (supported_formats[i] == wttFormat) {
         supportedBasisFormats[targetFormat] = true;
         break;
       }
@@ -158,32 +171,37 @@ basisu_transcode(basisu_data_t basisu_data,
   const auto basisuDataSize = static_cast<uint32_t>(basisu_data.size);
 
   assert(g_pGlobal_codebook);
-  basist::basisu_transcoder transcoder(g_pGlobal_codebook);
-  if (!transcoder.validate_header(basisu_data.ptr, basisuDataSize)) {
-    transcodeResult.result_code = BASIS_TRANSCODE_RESULT_INVALID_BASIS_HEADER;
-    return transcodeResult;
+  auto* transcoder = new basisu_transcoder(g_pGlobal_codebook);
+  transcoder->data = basisu_data;
+  basist::basisu_transcoder& basisTranscoder = transcoder->transcoder;
+  if (!basisTranscoder.validate_header(basisu_data.ptr, basisuDataSize)) {
+    *result_code = BASIS_TRANSCODE_RESULT_INVALID_BASIS_HEADER;
+    delete transcoder;
+    return nullptr;
   }
-  if (!transcoder.start_transcoding(basisu_data.ptr, basisuDataSize)) {
-    transcodeResult.result_code = BASIS_TRANSCODE_RESULT_TRANSCODE_FAILURE;
-    return transcodeResult;
+  if (!basisTranscoder.start_transcoding(basisu_data.ptr, basisuDataSize)) {
+    *result_code = BASIS_TRANSCODE_RESULT_TRANSCODE_FAILURE;
+    delete transcoder;
+    return nullptr;
   }
 
   basist::basisu_image_info imageInfo;
-  transcoder.get_image_info(basisu_data.ptr, basisuDataSize, imageInfo, 0);
+  basisTranscoder.get_image_info(basisu_data.ptr, basisuDataSize, imageInfo, 0);
 
   auto hasAlpha    = imageInfo.m_alpha_flag;
   auto levels      = imageInfo.m_total_levels;
   auto basisFormat = SelectBasisTextureformat(supportedBasisFormats, hasAlpha);
 
   if (levels == 0) {
-    transcodeResult.result_code = BASIS_TRANSCODE_RESULT_INVALID_BASIS_DATA;
-    return transcodeResult;
+    *result_code = BASIS_TRANSCODE_RESULT_INVALID_BASIS_DATA;
+    delete transcoder;
+    return nullptr;
   }
 
   if (WTT_FORMAT_MAP.find(basisFormat) == WTT_FORMAT_MAP.end()) {
-    transcodeResult.result_code
-      = BASIS_TRANSCODE_RESULT_UNSUPPORTED_TRANSCODE_FORMAT;
-    return transcodeResult;
+    *result_code = BASIS_TRANSCODE_RESULT_UNSUPPORTED_TRANSCODE_FORMAT;
+    delete transcoder;
+    return nullptr;
   }
 
   const auto& wttFormat = WTT_FORMAT_MAP.at(basisFormat);
@@ -194,46 +212,102 @@ basisu_transcode(basisu_data_t basisu_data,
     levels = 1;
   }
 
+  // The faces of a cubemap are stored as separate images
+  const bool isCubemap
+    = basisTranscoder.get_texture_type(basisu_data.ptr, basisuDataSize)
+        == basist::cBASISTexTypeCubemapArray
+      && basisTranscoder.get_total_images(basisu_data.ptr, basisuDataSize) >= 6;
+
   // Set image info
-  transcodeResult.image_desc.format      = wttFormat.format;
-  transcodeResult.image_desc.width       = imageInfo.m_width;
-  transcodeResult.image_desc.height      = imageInfo.m_height;
-  transcodeResult.image_desc.level_count = levels;
+  transcoder->format      = basisFormat;
+  image_desc->format      = wttFormat.format;
+  image_desc->width       = imageInfo.m_width;
+  image_desc->height      = imageInfo.m_height;
+  image_desc->level_count = std::min<uint32_t>(levels, BASISU_MAX_MIPMAPS);
+  image_desc->face_count  = isCubemap ? 6u : 1u;
+
+  *result_code = BASIS_TRANSCODE_RESULT_SUCCESS;
+  return transcoder;
+}
+
+bool basisu_transcoder_transcode_level(basisu_transcoder_t* transcoder,
+                                       uint32_t face, uint32_t level,
+                                       basisu_data_t* level_data)
+{
+  assert(transcoder && level_data);
+  *level_data = {};
+
+  const void* data          = transcoder->data.ptr;
+  const auto basisuDataSize = static_cast<uint32_t>(transcoder->data.size);
+  const auto basisFormat    = transcoder->format;
 
-  // Transcode each mip level
   uint32_t descW, descH, blocks;
-  for (uint32_t level = 0; level < levels; level++) {
-    // reset per level
-    bool success = false;
-    if (transcoder.get_image_level_desc(basisu_data.ptr, basisuDataSize, 0,
-                                        level, descW, descH, blocks)) {
-      uint32_t decSize = basis_get_bytes_per_block_or_pixel(basisFormat);
-      if (basis_transcoder_format_is_uncompressed(basisFormat)) {
-        decSize *= descW * descH;
-      }
-      else {
-        decSize *= blocks;
-      }
-      if (void* decBuf = malloc(decSize)) {
-        if (basis_transcoder_format_is_uncompressed(basisFormat)) {
-          // note that blocks becomes total number of pixels for RGB/RGBA
-          blocks = descW * descH;
-        }
-        if (transcoder.transcode_image_level(basisu_data.ptr, basisuDataSize, 0,
-                                             level, decBuf, blocks,
-                                             basisFormat)) {
-          transcodeResult.image_desc.levels[level].ptr  = decBuf;
-          transcodeResult.image_desc.levels[level].size = decSize;
-          success                                       = true;
-        }
-      }
-    }
-    if (!success) {
+  if (!transcoder->transcoder.get_image_level_desc(data, basisuDataSize, face,
+                                                   level, descW, descH,
+                                                   blocks)) {
+    return false;
+  }
+
+  uint32_t decSize = basis_get_bytes_per_block_or_pixel(basisFormat);
+  if (basis_transcoder_format_is_uncompressed(basisFormat)) {
+    decSize *= descW * descH;
+    // note that blocks becomes total number of pixels for RGB/RGBA
+    blocks = descW * descH;
+  }
+  else {
+    decSize *= blocks;
+  }
+  void* decBuf = malloc(decSize);
+  if (!decBuf) {
+    return false;
+  }
+
+  // A transcoder state per call keeps concurrent calls thread safe
+  basist::basisu_transcoder_state state;
+  if (!transcoder->transcoder.transcode_image_level(data, basisuDataSize, face,
+                                                    level, decBuf, blocks,
+                                                    basisFormat, 0, 0,
+                                                    &state)) {
+    free(decBuf);
+    return false;
+  }
+
+  level_data->ptr  = decBuf;
+  level_data->size = decSize;
+  return true;
+}
+
+void basisu_transcoder_release(basisu_transcoder_t* transcoder)
+{
+  delete transcoder;
+}
+
+basisu_transcode_result_t
+basisu_transcode(basisu_data_t basisu_data,
+                 const WGPUTextureFormat* supported_formats,
+                 uint32_t supported_format_count, bool mipmaps)
+{
+  basisu_transcode_result_t transcodeResult = {};
+  basisu_transcoder_t* transcoder           = basisu_transcoder_create(
+    basisu_data, supported_formats, supported_format_count, mipmaps,
+    &transcodeResult.image_desc, &transcodeResult.result_code);
+  if (!transcoder) {
+    return transcodeResult;
+  }
+
+  // Transcode each mip level of the first image
+  transcodeResult.image_desc.face_count = 1;
+  for (uint32_t level = 0; level < transcodeResult.image_desc.level_count;
+       level++) {
+    if (!basisu_transcoder_transcode_level(
+          transcoder, 0, level, &transcodeResult.image_desc.levels[level])) {
       basisu_free(&transcodeResult.image_desc);
+      basisu_transcoder_release(transcoder);
       transcodeResult.result_code = BASIS_TRANSCODE_RESULT_TRANSCODE_FAILURE;
       return transcodeResult;
     }
   }
+  basisu_transcoder_release(transcoder);
   transcodeResult.result_code = BASIS_TRANSCODE_RESULT_SUCCESS;
 
   return transcodeResult;
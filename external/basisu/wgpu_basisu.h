@@ -36,6 +36,7 @@ typedef struct basisu_image_desc_t {
   uint32_t width;
   uint32_t height;
   uint32_t level_count; // Number of mipmaps
+  uint32_t face_count;  // 6 for cubemaps, 1 otherwise
   basisu_data_t levels[BASISU_MAX_MIPMAPS];
 } basisu_image_desc_t;
 
@@ -52,10 +53,29 @@ bool basisu_is_initialized(void);
 /* Basis Universal transcoding */
 basisu_transcode_result_t
 basisu_transcode(basisu_data_t basisu_data,
-                 WGPUTextureFormat (*supported_formats)[12],
+                 const WGPUTextureFormat* supported_formats,
                  uint32_t supported_format_count, bool mipmaps);
 void basisu_free(const basisu_image_desc_t* desc);
 
+/*
+ * basisu_transcoder_t transcodes single mip levels of a file. After creation
+ * the levels can be transcoded from several threads at the same time, the
+ * basisu data has to stay alive until the transcoder is released.
+ */
+typedef struct basisu_transcoder basisu_transcoder_t;
+
+basisu_transcoder_t*
+basisu_transcoder_create(basisu_data_t basisu_data,
+                         const WGPUTextureFormat* supported_formats,
+                         uint32_t supported_format_count, bool mipmaps,
+                         basisu_image_desc_t* image_desc,
+                         uint32_t* result_code);
+/* The level data is allocated with malloc() and owned by the caller */
+bool basisu_transcoder_transcode_level(basisu_transcoder_t* transcoder,
+                                       uint32_t face, uint32_t level,
+                                       basisu_data_t* level_data);
+void basisu_transcoder_release(basisu_transcoder_t* transcoder);
+
 #if defined(__cplusplus)
 } // extern "C"
 #endif
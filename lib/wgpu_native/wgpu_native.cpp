@@ -2,11 +2,22 @@
 
 #include <dawn/dawn_proc.h>
 #include <dawn/native/DawnNative.h>
+#include <dawn/platform/DawnPlatform.h>
 #include <dawn/webgpu_cpp.h>
 
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#if defined(WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 #include <memory>
+#include <string>
+#include <vector>
 
 //****************************** Implementation *******************************/
 
@@ -28,6 +39,116 @@ namespace WGPUImpl {
 static const char* BackendTypeName(wgpu::BackendType);
 static const char* AdapterTypeName(wgpu::AdapterType);
 
+// Persistent cache of the backend pipelines and shaders, Dawn stores the
+// blobs through the caching interface of the platform on the backends that
+// support it. One file per blob, the file starts with the key to detect hash
+// collisions.
+class FileCachingInterface : public dawn_platform::CachingInterface {
+public:
+  explicit FileCachingInterface(const std::string& directory)
+      : directory(directory)
+  {
+  }
+
+  void SetFingerprint(const void* fingerprint, size_t fingerprintSize)
+  {
+    fingerprintHash = Hash(0xcbf29ce484222325ull, fingerprint, fingerprintSize);
+  }
+
+  size_t LoadData(const WGPUDevice device, const void* key, size_t keySize,
+                  void* value, size_t valueSize) override
+  {
+    (void)device;
+    FILE* file = fopen(BlobPath(key, keySize).c_str(), "rb");
+    if (file == nullptr) {
+      return 0;
+    }
+    // The file starts with the key size and the key
+    uint64_t storedKeySize = 0;
+    std::vector<uint8_t> storedKey;
+    bool valid = fread(&storedKeySize, sizeof(storedKeySize), 1, file) == 1
+                 && storedKeySize == keySize;
+    if (valid) {
+      storedKey.resize(keySize);
+      valid = fread(storedKey.data(), 1, keySize, file) == keySize
+              && memcmp(storedKey.data(), key, keySize) == 0;
+    }
+    size_t blobSize = 0;
+    if (valid) {
+      const long blobOffset = ftell(file);
+      fseek(file, 0, SEEK_END);
+      blobSize = (size_t)(ftell(file) - blobOffset);
+      fseek(file, blobOffset, SEEK_SET);
+    }
+    // Dawn queries the size first, with an empty value
+    if (valid && value != nullptr && valueSize >= blobSize) {
+      valid = fread(value, 1, blobSize, file) == blobSize;
+    }
+    fclose(file);
+    return valid ? blobSize : 0;
+  }
+
+  void StoreData(const WGPUDevice device, const void* key, size_t keySize,
+                 const void* value, size_t valueSize) override
+  {
+    (void)device;
+    const std::string path = BlobPath(key, keySize);
+    FILE* file             = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+      return;
+    }
+    const uint64_t storedKeySize = keySize;
+    bool written
+      = fwrite(&storedKeySize, sizeof(storedKeySize), 1, file) == 1
+        && fwrite(key, 1, keySize, file) == keySize
+        && fwrite(value, 1, valueSize, file) == valueSize;
+    fclose(file);
+    if (!written) {
+      remove(path.c_str());
+    }
+  }
+
+private:
+  static uint64_t Hash(uint64_t hash, const void* data, size_t size)
+  {
+    // 64-bit FNV-1a
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  std::string BlobPath(const void* key, size_t keySize) const
+  {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/%016llx.bin",
+             (unsigned long long)Hash(fingerprintHash, key, keySize));
+    return directory + filename;
+  }
+
+  std::string directory;
+  uint64_t fingerprintHash = 0;
+};
+
+class CachingPlatform : public dawn_platform::Platform {
+public:
+  explicit CachingPlatform(const std::string& directory) : caching(directory)
+  {
+  }
+
+  // The fingerprint identifies the adapter and driver
+  dawn_platform::CachingInterface*
+  GetCachingInterface(const void* fingerprint, size_t fingerprintSize) override
+  {
+    caching.SetFingerprint(fingerprint, fingerprintSize);
+    return &caching;
+  }
+
+private:
+  FileCachingInterface caching;
+};
+
 static struct {
   struct {
     DawnProcTable procTable;
@@ -36,15 +157,75 @@ static struct {
   struct {
     dawn_native::Adapter handle;
     wgpu::BackendType backendType;
+    backend_validation_level_enum validationLevel;
     struct {
       const char* name;
       const char* typeName;
       const char* backendName;
     } info;
   } adapter;
-  bool initialized = false;
+  struct {
+    std::string directory;
+    std::unique_ptr<CachingPlatform> platform = nullptr;
+  } pipelineCache;
+  struct {
+    int32_t index     = -1;
+    uint32_t vendorID = 0;
+    std::string name;
+  } adapterSelection;
+  wgpu_proc_table_hook_t procTableHook = nullptr;
+  bool initialized                     = false;
 } gpuContext = {};
 
+static void ApplyBackendValidationLevel()
+{
+  backend_validation_level_enum level = gpuContext.adapter.validationLevel;
+  if (level == BackendValidationLevel_Default) {
+#ifdef NDEBUG
+    level = BackendValidationLevel_Disabled;
+#else
+    level = BackendValidationLevel_Full;
+#endif
+  }
+
+  dawn_native::Instance* instance = gpuContext.dawn_native.instance.get();
+  switch (level) {
+    case BackendValidationLevel_Partial:
+      instance->EnableBackendValidation(true);
+      instance->SetBackendValidationLevel(
+        dawn_native::BackendValidationLevel::Partial);
+      break;
+    case BackendValidationLevel_Full:
+      instance->EnableBackendValidation(true);
+      instance->SetBackendValidationLevel(
+        dawn_native::BackendValidationLevel::Full);
+      break;
+    default:
+      instance->EnableBackendValidation(false);
+      instance->SetBackendValidationLevel(
+        dawn_native::BackendValidationLevel::Disabled);
+      break;
+  }
+}
+
+static void SetupPipelineCache()
+{
+  const std::string& directory = gpuContext.pipelineCache.directory;
+  if (directory.empty()) {
+    return;
+  }
+#if defined(WIN32)
+  _mkdir(directory.c_str());
+#else
+  mkdir(directory.c_str(), 0755);
+#endif
+  gpuContext.pipelineCache.platform
+    = std::make_unique<CachingPlatform>(directory);
+  gpuContext.dawn_native.instance->SetPlatform(
+    gpuContext.pipelineCache.platform.get());
+  dlog("Pipeline cache directory: %s", directory.c_str());
+}
+
 static void Initialize()
 {
   if (gpuContext.initialized) {
@@ -53,12 +234,14 @@ static void Initialize()
 
   // Set up the native procs for the global proctable
   gpuContext.dawn_native.procTable = dawn_native::GetProcs();
+  if (gpuContext.procTableHook != nullptr) {
+    gpuContext.procTableHook(&gpuContext.dawn_native.procTable);
+  }
   dawnProcSetProcs(&gpuContext.dawn_native.procTable);
   gpuContext.dawn_native.instance = std::make_unique<dawn_native::Instance>();
+  SetupPipelineCache();
   gpuContext.dawn_native.instance->DiscoverDefaultAdapters();
-  gpuContext.dawn_native.instance->EnableBackendValidation(true);
-  gpuContext.dawn_native.instance->SetBackendValidationLevel(
-    dawn_native::BackendValidationLevel::Full);
+  ApplyBackendValidationLevel();
 
   // Dawn backend type.
   // Default to D3D12, Metal, Vulkan, OpenGL in that order as D3D12 and Metal
@@ -80,6 +263,43 @@ static void Initialize()
   gpuContext.initialized    = true;
 }
 
+static void SetBackendValidationLevel(backend_validation_level_enum level)
+{
+  gpuContext.adapter.validationLevel = level;
+  if (gpuContext.initialized) {
+    ApplyBackendValidationLevel();
+  }
+}
+
+static void SetPipelineCacheDirectory(const char* directory)
+{
+  const std::string value = directory ? directory : "";
+  if (gpuContext.initialized) {
+    if (value != gpuContext.pipelineCache.directory) {
+      dlog("The pipeline cache has to be configured before the first adapter");
+    }
+    return;
+  }
+  gpuContext.pipelineCache.directory = value;
+}
+
+static void SetProcTableHook(wgpu_proc_table_hook_t hook)
+{
+  if (gpuContext.initialized) {
+    if (hook != gpuContext.procTableHook) {
+      dlog("The proc table hook has to be set before the first adapter");
+    }
+    return;
+  }
+  gpuContext.procTableHook = hook;
+}
+
+static const char* GetPipelineCacheDirectory()
+{
+  const std::string& directory = gpuContext.pipelineCache.directory;
+  return directory.empty() ? nullptr : directory.c_str();
+}
+
 static void SetAdapterInfo(const wgpu::AdapterProperties& ap)
 {
   gpuContext.adapter.info.name        = ap.name;
@@ -87,6 +307,41 @@ static void SetAdapterInfo(const wgpu::AdapterProperties& ap)
   gpuContext.adapter.info.backendName = BackendTypeName(ap.backendType);
 }
 
+static std::string ToLower(const char* str)
+{
+  std::string lower = str != nullptr ? str : "";
+  for (char& c : lower) {
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+  return lower;
+}
+
+// The needle is lower case
+static bool ContainsIgnoreCase(const char* haystack, const std::string& needle)
+{
+  return ToLower(haystack).find(needle) != std::string::npos;
+}
+
+static bool MatchesAdapterSelection(const wgpu::AdapterProperties& ap)
+{
+  const auto& selection = gpuContext.adapterSelection;
+  return (selection.vendorID == 0 || ap.vendorID == selection.vendorID)
+         && (selection.name.empty()
+             || ContainsIgnoreCase(ap.name, selection.name));
+}
+
+static WGPUAdapter SelectAdapter(const dawn_native::Adapter& adapter)
+{
+  wgpu::AdapterProperties ap;
+  adapter.GetProperties(&ap);
+  gpuContext.adapter.handle = adapter;
+  SetAdapterInfo(ap);
+  dlog("Selected adapter %s (device=0x%x vendor=0x%x type=%s/%s)", ap.name,
+       ap.deviceID, ap.vendorID, gpuContext.adapter.info.typeName,
+       gpuContext.adapter.info.backendName);
+  return gpuContext.adapter.handle.Get();
+}
+
 static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
 {
   Initialize();
@@ -120,24 +375,35 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
 
   std::vector<dawn_native::Adapter> adapters
     = gpuContext.dawn_native.instance->GetAdapters();
+
+  // An explicitly selected adapter is used regardless of its type and backend
+  const auto& selection = gpuContext.adapterSelection;
+  if (selection.index >= 0) {
+    if (static_cast<size_t>(selection.index) < adapters.size()) {
+      return SelectAdapter(adapters[selection.index]);
+    }
+    fprintf(stderr, "Adapter index %d out of range, %zu adapters available\n",
+            selection.index, adapters.size());
+    return nullptr;
+  }
+
   for (auto reqType : typePriority) {
     for (const dawn_native::Adapter& adapter : adapters) {
       wgpu::AdapterProperties ap;
       adapter.GetProperties(&ap);
       if (ap.adapterType == reqType
           && (reqType == wgpu::AdapterType::CPU
-              || ap.backendType == gpuContext.adapter.backendType)) {
-        gpuContext.adapter.handle = adapter;
-        SetAdapterInfo(ap);
-        dlog("Selected adapter %s (device=0x%x vendor=0x%x type=%s/%s)",
-             ap.name, ap.deviceID, ap.vendorID,
-             gpuContext.adapter.info.typeName,
-             gpuContext.adapter.info.backendName);
-        return gpuContext.adapter.handle.Get();
+              || ap.backendType == gpuContext.adapter.backendType)
+          && MatchesAdapterSelection(ap)) {
+        return SelectAdapter(adapter);
       }
     }
   }
 
+  if (selection.vendorID != 0 || !selection.name.empty()) {
+    fprintf(stderr, "No adapter matches the selection (vendor=0x%x name=%s)\n",
+            selection.vendorID, selection.name.c_str());
+  }
   return nullptr;
 }
 
@@ -146,16 +412,115 @@ static void LogAvailableAdapters()
   Initialize();
 
   fprintf(stderr, "Available adapters:\n");
+  uint32_t index = 0;
   for (auto&& a : gpuContext.dawn_native.instance->GetAdapters()) {
     wgpu::AdapterProperties p;
     a.GetProperties(&p);
+    WGPUSupportedLimits supported = {};
+    a.GetLimits(&supported);
+    const WGPULimits& l = supported.limits;
     fprintf(
       stderr,
-      "  %s (%s)\n"
-      "    deviceID=%u, vendorID=0x%x, BackendType::%s, AdapterType::%s\n",
-      p.name, p.driverDescription, p.deviceID, p.vendorID,
-      BackendTypeName(p.backendType), AdapterTypeName(p.adapterType));
+      "  [%u] %s (%s)\n"
+      "    deviceID=%u, vendorID=0x%x, BackendType::%s, AdapterType::%s\n"
+      "    maxTextureDimension2D=%u, maxStorageBufferBindingSize=%llu, "
+      "maxComputeInvocationsPerWorkgroup=%u\n",
+      index++, p.name, p.driverDescription, p.deviceID, p.vendorID,
+      BackendTypeName(p.backendType), AdapterTypeName(p.adapterType),
+      l.maxTextureDimension2D,
+      static_cast<unsigned long long>(l.maxStorageBufferBindingSize),
+      l.maxComputeInvocationsPerWorkgroup);
+  }
+}
+
+static uint32_t GetAdapterCount()
+{
+  Initialize();
+
+  return static_cast<uint32_t>(
+    gpuContext.dawn_native.instance->GetAdapters().size());
+}
+
+static bool GetAdapterDesc(uint32_t index, wgpu_adapter_desc_t* desc)
+{
+  Initialize();
+
+  std::vector<dawn_native::Adapter> adapters
+    = gpuContext.dawn_native.instance->GetAdapters();
+  if (index >= adapters.size()) {
+    return false;
+  }
+
+  const dawn_native::Adapter& adapter = adapters[index];
+  wgpu::AdapterProperties ap;
+  adapter.GetProperties(&ap);
+
+  memset(desc, 0, sizeof(*desc));
+  desc->index = index;
+  snprintf(desc->name, sizeof(desc->name), "%s", ap.name ? ap.name : "");
+  snprintf(desc->driver_description, sizeof(desc->driver_description), "%s",
+           ap.driverDescription ? ap.driverDescription : "");
+  desc->vendor_id         = ap.vendorID;
+  desc->device_id         = ap.deviceID;
+  desc->adapter_type      = static_cast<WGPUAdapterType>(ap.adapterType);
+  desc->backend_type      = static_cast<WGPUBackendType>(ap.backendType);
+  desc->adapter_type_name = AdapterTypeName(ap.adapterType);
+  desc->backend_name      = BackendTypeName(ap.backendType);
+  adapter.GetLimits(&desc->limits);
+
+  return true;
+}
+
+static void SetAdapterSelection(const wgpu_adapter_selection_t* selection)
+{
+  if (gpuContext.adapter.handle) {
+    dlog("Adapter selection changed after an adapter was requested");
+  }
+  auto& current    = gpuContext.adapterSelection;
+  current.index    = selection ? selection->index : -1;
+  current.vendorID = selection ? selection->vendor_id : 0;
+  current.name     = ToLower(selection ? selection->name : nullptr);
+}
+
+static void ParseAdapterSelection(const char* value,
+                                  wgpu_adapter_selection_t* selection)
+{
+  static const struct {
+    const char* name;
+    uint32_t vendorID;
+  } vendors[] = {
+    {"nvidia", 0x10de}, {"amd", 0x1002}, {"intel", 0x8086},
+    {"apple", 0x106b},  {"arm", 0x13b5}, {"qualcomm", 0x5143},
+  };
+
+  selection->index     = -1;
+  selection->vendor_id = 0;
+  selection->name      = nullptr;
+  if (value == nullptr || *value == '\0') {
+    return;
+  }
+
+  char* end = nullptr;
+  if (value[0] == '0' && (value[1] == 'x' || value[1] == 'X')) {
+    unsigned long vendorID = strtoul(value, &end, 16);
+    if (*end == '\0') {
+      selection->vendor_id = static_cast<uint32_t>(vendorID);
+      return;
+    }
+  }
+  long index = strtol(value, &end, 10);
+  if (*end == '\0' && index >= 0) {
+    selection->index = static_cast<int32_t>(index);
+    return;
+  }
+  const std::string lower = ToLower(value);
+  for (const auto& vendor : vendors) {
+    if (lower == vendor.name) {
+      selection->vendor_id = vendor.vendorID;
+      return;
+    }
   }
+  selection->name = value;
 }
 
 static void GetAdapterInfo(char (*adapter_info)[256])
@@ -241,16 +606,57 @@ static const char* AdapterTypeName(wgpu::AdapterType t)
 
 //******************************** Public API *********************************/
 
+void wgpu_set_backend_validation_level(backend_validation_level_enum level)
+{
+  WGPUImpl::SetBackendValidationLevel(level);
+}
+
 void wgpu_log_available_adapters()
 {
   WGPUImpl::LogAvailableAdapters();
 }
 
+uint32_t wgpu_get_adapter_count(void)
+{
+  return WGPUImpl::GetAdapterCount();
+}
+
+bool wgpu_get_adapter_desc(uint32_t index, wgpu_adapter_desc_t* desc)
+{
+  return WGPUImpl::GetAdapterDesc(index, desc);
+}
+
+void wgpu_set_adapter_selection(const wgpu_adapter_selection_t* selection)
+{
+  WGPUImpl::SetAdapterSelection(selection);
+}
+
+void wgpu_parse_adapter_selection(const char* value,
+                                  wgpu_adapter_selection_t* selection)
+{
+  WGPUImpl::ParseAdapterSelection(value, selection);
+}
+
 void wgpu_get_adapter_info(char (*adapter_info)[256])
 {
   WGPUImpl::GetAdapterInfo(adapter_info);
 }
 
+void wgpu_set_pipeline_cache_dir(const char* directory)
+{
+  WGPUImpl::SetPipelineCacheDirectory(directory);
+}
+
+const char* wgpu_get_pipeline_cache_dir(void)
+{
+  return WGPUImpl::GetPipelineCacheDirectory();
+}
+
+void wgpu_set_proc_table_hook(wgpu_proc_table_hook_t hook)
+{
+  WGPUImpl::SetProcTableHook(hook);
+}
+
 WGPUAdapter wgpu_request_adapter(WGPURequestAdapterOptions* options)
 {
   return WGPUImpl::RequestAdapter(options);
@@ -1,13 +1,77 @@
 #ifndef WGPU_NATIVE_H
 #define WGPU_NATIVE_H
 
+#include <dawn/dawn_proc_table.h>
 #include <dawn/webgpu.h>
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef enum backend_validation_level_enum {
+  /* Full validation in debug builds, no validation in release builds */
+  BackendValidationLevel_Default  = 0,
+  BackendValidationLevel_Disabled = 1,
+  BackendValidationLevel_Partial  = 2,
+  BackendValidationLevel_Full     = 3,
+} backend_validation_level_enum;
+
+/* Needs to be called before the first adapter is requested */
+void wgpu_set_backend_validation_level(backend_validation_level_enum level);
+/* Directory of the persistent backend pipeline cache, NULL or an empty string
+ * disables it. Needs to be called before the first adapter is requested. */
+void wgpu_set_pipeline_cache_dir(const char* directory);
+/* Directory of the persistent backend pipeline cache, NULL if disabled */
+const char* wgpu_get_pipeline_cache_dir(void);
+/* Called with the native procs before they become the global proc table, the
+ * hook can replace entries to intercept WebGPU calls. Needs to be called
+ * before the first adapter is requested. */
+typedef void (*wgpu_proc_table_hook_t)(DawnProcTable* procs);
+void wgpu_set_proc_table_hook(wgpu_proc_table_hook_t hook);
 void wgpu_log_available_adapters();
+
+/* Adapter enumeration, the index is the position in the adapter list */
+typedef struct wgpu_adapter_desc_t {
+  uint32_t index;
+  char name[256];
+  char driver_description[256];
+  uint32_t vendor_id;
+  uint32_t device_id;
+  WGPUAdapterType adapter_type;
+  WGPUBackendType backend_type;
+  const char* adapter_type_name;
+  const char* backend_name;
+  WGPUSupportedLimits limits;
+} wgpu_adapter_desc_t;
+
+uint32_t wgpu_get_adapter_count(void);
+/* Returns false if there is no adapter with the index */
+bool wgpu_get_adapter_desc(uint32_t index, wgpu_adapter_desc_t* desc);
+
+/* Adapter selection of wgpu_request_adapter(), the adapters of the default
+ * backend type are searched in the power preference order. An index selects
+ * that adapter of any backend type, vendor id and name filter the search. */
+typedef struct wgpu_adapter_selection_t {
+  /* Adapter list index, -1 = select by power preference */
+  int32_t index;
+  /* PCI vendor id, 0 = any vendor */
+  uint32_t vendor_id;
+  /* Case-insensitive part of the adapter name, NULL = any name */
+  const char* name;
+} wgpu_adapter_selection_t;
+
+/* NULL restores the default selection. Needs to be called before the first
+ * adapter is requested. */
+void wgpu_set_adapter_selection(const wgpu_adapter_selection_t* selection);
+/**
+ * @brief Parses an adapter selection from a string: an adapter list index, a
+ * vendor name (nvidia, amd, intel, apple, arm, qualcomm), a hexadecimal vendor
+ * id (0x10de) or otherwise a part of the adapter name.
+ */
+void wgpu_parse_adapter_selection(const char* value,
+                                  wgpu_adapter_selection_t* selection);
 void wgpu_get_adapter_info(char (*adapter_info)[256]);
 WGPUAdapter wgpu_request_adapter(WGPURequestAdapterOptions* options);
 WGPUSurface wgpu_create_surface(void* display, void* window_handle);
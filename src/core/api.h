@@ -1,7 +1,9 @@
 #ifndef CORE_API_H
 #define CORE_API_H
 
+#include "arena.h"
 #include "camera.h"
+#include "cascaded_shadows.h"
 #include "file.h"
 #include "frustum.h"
 #include "input.h"
@@ -9,6 +11,7 @@
 #include "macro.h"
 #include "math.h"
 #include "platform.h"
+#include "trace.h"
 #include "utils.h"
 #include "window.h"
 
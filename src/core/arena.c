@@ -0,0 +1,148 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "macro.h"
+
+/* Granularity of the block size when the arena grows */
+#define ARENA_BLOCK_GRANULARITY 4096u
+
+/* Allocation which did not fit the block, freed by the next reset */
+typedef struct arena_overflow_t {
+  struct arena_overflow_t* next;
+} arena_overflow_t;
+
+/**
+ * @brief Arena class
+ */
+struct arena {
+  uint8_t* block;
+  size_t capacity;
+  size_t offset;
+  arena_overflow_t* overflow;
+  /* Block and overflow bytes since the last reset */
+  size_t used;
+  size_t peak;
+};
+
+static size_t round_up(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/* arena creating/releasing */
+
+arena_t* arena_create(size_t capacity)
+{
+  arena_t* arena = (arena_t*)malloc(sizeof(*arena));
+  memset(arena, 0, sizeof(*arena));
+  arena->capacity = round_up(MAX(capacity, 1), ARENA_BLOCK_GRANULARITY);
+  arena->block    = (uint8_t*)malloc(arena->capacity);
+  ASSERT(arena->block != NULL);
+
+  return arena;
+}
+
+static void free_overflow(arena_t* arena)
+{
+  arena_overflow_t* overflow = arena->overflow;
+  while (overflow != NULL) {
+    arena_overflow_t* next = overflow->next;
+    free(overflow);
+    overflow = next;
+  }
+  arena->overflow = NULL;
+}
+
+void arena_release(arena_t* arena)
+{
+  if (arena == NULL) {
+    return;
+  }
+
+  free_overflow(arena);
+  free(arena->block);
+  free(arena);
+}
+
+/* Allocation */
+
+static void* alloc_overflow(arena_t* arena, size_t size, size_t alignment)
+{
+  const size_t header_size = round_up(sizeof(arena_overflow_t), alignment);
+  arena_overflow_t* overflow
+    = (arena_overflow_t*)malloc(header_size + size + alignment);
+  ASSERT(overflow != NULL);
+  overflow->next  = arena->overflow;
+  arena->overflow = overflow;
+
+  const uintptr_t address = (uintptr_t)overflow + header_size;
+  return (void*)round_up(address, alignment);
+}
+
+void* arena_alloc(arena_t* arena, size_t size, size_t alignment)
+{
+  alignment = (alignment == 0) ? ARENA_DEFAULT_ALIGNMENT : alignment;
+  ASSERT((alignment & (alignment - 1)) == 0);
+
+  /* Align the address, malloc only guarantees the alignment of max_align_t */
+  const uintptr_t base    = (uintptr_t)arena->block;
+  const size_t offset     = round_up(base + arena->offset, alignment) - base;
+  const size_t block_size = offset - arena->offset + size;
+
+  void* ptr = NULL;
+  if (offset + size <= arena->capacity) {
+    ptr           = arena->block + offset;
+    arena->offset = offset + size;
+    arena->used += block_size;
+  }
+  else {
+    ptr = alloc_overflow(arena, size, alignment);
+    arena->used += size + alignment;
+  }
+  arena->peak = MAX(arena->peak, arena->used);
+
+  return ptr;
+}
+
+void* arena_calloc(arena_t* arena, size_t count, size_t size)
+{
+  void* ptr = arena_alloc(arena, count * size, 0);
+  memset(ptr, 0, count * size);
+
+  return ptr;
+}
+
+void arena_reset(arena_t* arena)
+{
+  /* Grow the block if the allocations since the last reset overflowed */
+  if (arena->overflow != NULL) {
+    free_overflow(arena);
+    free(arena->block);
+    const size_t capacity = round_up(arena->used, ARENA_BLOCK_GRANULARITY);
+    log_debug("Arena grows from %zu to %zu bytes", arena->capacity, capacity);
+    arena->capacity = capacity;
+    arena->block    = (uint8_t*)malloc(arena->capacity);
+    ASSERT(arena->block != NULL);
+  }
+  arena->offset = 0;
+  arena->used   = 0;
+}
+
+size_t arena_get_used(arena_t* arena)
+{
+  return arena->used;
+}
+
+size_t arena_get_peak(arena_t* arena)
+{
+  return arena->peak;
+}
+
+size_t arena_get_capacity(arena_t* arena)
+{
+  return arena->capacity;
+}
@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Linear allocator for short-lived CPU scratch memory. Allocations are
+ * not freed one by one, arena_reset() frees all of them at once. An
+ * allocation which does not fit the remaining capacity gets an overflow block
+ * of its own, the next reset grows the arena to the peak usage, so a steady
+ * workload allocates from a single block without calling malloc. Not
+ * synchronized, an arena is used by one thread.
+ */
+typedef struct arena arena_t;
+
+/* Default alignment, covers the scalar and the SIMD vector types */
+#define ARENA_DEFAULT_ALIGNMENT 16u
+
+/* Allocates count elements of type */
+#define ARENA_ALLOC_ARRAY(arena, type, count)                                  \
+  ((type*)arena_alloc((arena), (count) * sizeof(type), 0))
+
+/* arena creating/releasing */
+arena_t* arena_create(size_t capacity);
+void arena_release(arena_t* arena);
+
+/**
+ * @brief Allocates size bytes, valid until the next reset.
+ * @param alignment power of two, 0 = ARENA_DEFAULT_ALIGNMENT
+ */
+void* arena_alloc(arena_t* arena, size_t size, size_t alignment);
+/* Zero-initialized allocation of count elements of size bytes */
+void* arena_calloc(arena_t* arena, size_t count, size_t size);
+
+/* Frees all allocations */
+void arena_reset(arena_t* arena);
+
+/* Bytes allocated since the last reset, including alignment padding */
+size_t arena_get_used(arena_t* arena);
+/* Highest usage since the arena was created */
+size_t arena_get_peak(arena_t* arena);
+size_t arena_get_capacity(arena_t* arena);
+
+#endif /* ARENA_H */
@@ -271,11 +271,14 @@ argparse_parse(struct argparse *self, int argc, const char **argv)
         continue;
 
 unknown:
+        // ignored unknown options are copied verbatim like non-options
+        if (self->flags & ARGPARSE_IGNORE_UNKNOWN_ARGS) {
+            self->out[self->cpidx++] = self->argv[0];
+            continue;
+        }
         fprintf(stderr, "error: unknown option `%s`\n", self->argv[0]);
         argparse_usage(self);
-        if (!(self->flags & ARGPARSE_IGNORE_UNKNOWN_ARGS)) {
-            exit(EXIT_FAILURE);
-        }
+        exit(EXIT_FAILURE);
     }
 
 end:
@@ -0,0 +1,22 @@
+#include "asset_archive.h"
+
+const char* asset_archive_normalize_path(const char* path)
+{
+  while (path[0] == '.' && path[1] == '/') {
+    path += 2;
+    while (path[0] == '/') {
+      ++path;
+    }
+  }
+  return path;
+}
+
+uint64_t asset_archive_hash_path(const char* path)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char* c = asset_archive_normalize_path(path); *c != '\0'; ++c) {
+    hash ^= (uint8_t)*c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
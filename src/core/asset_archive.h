@@ -0,0 +1,62 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * Packed asset archive format
+ *
+ * Layout of an archive built with wgpu_asset_packer:
+ *  - asset_archive_header_t
+ *  - asset_archive_entry_t[entry_count], sorted by path hash
+ *  - path string table, the paths are relative to the assets directory
+ *  - payloads, each payload starts at a multiple of the header alignment
+ *
+ * All values are little-endian. The payloads are aligned to the WebGPU copy
+ * alignment, so mapped payloads can be uploaded without repacking.
+ * -------------------------------------------------------------------------- */
+
+#define ASSET_ARCHIVE_MAGIC 0x4b415057u /* "WPAK" */
+#define ASSET_ARCHIVE_VERSION 1u
+#define ASSET_ARCHIVE_ALIGNMENT 256u
+
+typedef enum asset_archive_compression_t {
+  AssetArchiveCompression_None = 0,
+} asset_archive_compression_t;
+
+typedef struct asset_archive_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t alignment;
+  uint64_t path_table_offset;
+  uint64_t path_table_size;
+} asset_archive_header_t;
+
+typedef struct asset_archive_entry_t {
+  uint64_t path_hash;
+  uint64_t offset;      /* payload offset from the start of the archive */
+  uint64_t size;        /* uncompressed size */
+  uint64_t stored_size; /* size of the payload in the archive */
+  uint32_t path_offset; /* offset in the path table */
+  uint32_t path_length; /* path length without NUL terminator */
+  uint32_t compression; /* asset_archive_compression_t */
+  uint32_t reserved;
+} asset_archive_entry_t;
+
+/**
+ * @brief Returns the 64-bit FNV-1a hash of the normalized path, leading "./"
+ * components are skipped.
+ * @param path the path relative to the assets directory
+ * @return the path hash
+ */
+uint64_t asset_archive_hash_path(const char* path);
+
+/**
+ * @brief Returns the path without leading "./" components.
+ * @param path the path relative to the assets directory
+ * @return the normalized path, points into 'path'
+ */
+const char* asset_archive_normalize_path(const char* path);
+
+#endif
@@ -0,0 +1,486 @@
+#if defined(__linux__)
+/* syscall() is not part of POSIX */
+#define _DEFAULT_SOURCE
+#endif
+
+#include "async_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ASYNC_IO_URING_SUPPORTED 1
+#else
+#define ASYNC_IO_URING_SUPPORTED 0
+#endif
+
+#include "log.h"
+#include "macro.h"
+#include "thread_pool.h"
+
+#define ASYNC_IO_QUEUE_DEPTH 64u
+#define ASYNC_IO_THREAD_COUNT 4u
+/* Reads are split into chunks, a single read returns at most ~2 GiB */
+#define ASYNC_IO_MAX_READ_SIZE (1u << 30)
+
+typedef struct async_io_request_t {
+  async_io_t* async_io;
+  async_io_callback_t callback;
+  void* user_data;
+  char filename[STRMAX];
+  int fd;
+  int error;
+  file_read_result_t result;
+  uint64_t offset; /* number of bytes read */
+  struct iovec iovec;
+  struct async_io_request_t* next;
+} async_io_request_t;
+
+/* Singly linked FIFO of requests */
+typedef struct async_io_queue_t {
+  async_io_request_t* first;
+  async_io_request_t* last;
+} async_io_queue_t;
+
+#if ASYNC_IO_URING_SUPPORTED
+typedef struct async_io_ring_t {
+  int fd;
+  uint32_t entries;
+  uint32_t in_flight;
+  uint32_t unsubmitted;
+  /* Submission queue */
+  void* sq_ptr;
+  size_t sq_size;
+  uint32_t* sq_head;
+  uint32_t* sq_tail;
+  uint32_t* sq_mask;
+  uint32_t* sq_array;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  /* Completion queue, shares the mapping with the submission queue if
+   * IORING_FEAT_SINGLE_MMAP is supported */
+  void* cq_ptr;
+  size_t cq_size;
+  uint32_t* cq_head;
+  uint32_t* cq_tail;
+  uint32_t* cq_mask;
+  struct io_uring_cqe* cqes;
+} async_io_ring_t;
+#endif
+
+struct async_io {
+  /* Requests not completed by the caller yet, only used by the owner thread */
+  uint32_t outstanding;
+  /* Requests waiting for a submission queue entry */
+  async_io_queue_t pending;
+  /* Finished requests, filled by the I/O threads in fallback mode */
+  async_io_queue_t completed;
+  pthread_mutex_t mutex;
+  pthread_cond_t request_completed;
+  /* I/O threads, NULL if io_uring is used */
+  thread_pool_t* thread_pool;
+#if ASYNC_IO_URING_SUPPORTED
+  bool use_ring;
+  async_io_ring_t ring;
+#endif
+};
+
+static void async_io_queue_push(async_io_queue_t* queue,
+                                async_io_request_t* request)
+{
+  request->next = NULL;
+  if (queue->last != NULL) {
+    queue->last->next = request;
+  }
+  else {
+    queue->first = request;
+  }
+  queue->last = request;
+}
+
+static async_io_request_t* async_io_queue_pop(async_io_queue_t* queue)
+{
+  async_io_request_t* request = queue->first;
+  if (request != NULL) {
+    queue->first = request->next;
+    if (queue->first == NULL) {
+      queue->last = NULL;
+    }
+  }
+  return request;
+}
+
+/* Moves the request to the completed queue, can be called from any thread */
+static void async_io_request_complete(async_io_request_t* request, int error)
+{
+  async_io_t* async_io = request->async_io;
+  if (request->fd >= 0) {
+    close(request->fd);
+    request->fd = -1;
+  }
+  request->error = error;
+  if (error != 0) {
+    free(request->result.data);
+    request->result = (file_read_result_t){0};
+  }
+
+  pthread_mutex_lock(&async_io->mutex);
+  async_io_queue_push(&async_io->completed, request);
+  pthread_cond_signal(&async_io->request_completed);
+  pthread_mutex_unlock(&async_io->mutex);
+}
+
+/* Opens the file and allocates the destination of the read */
+static int async_io_request_open(async_io_request_t* request)
+{
+  request->fd = open(request->filename, O_RDONLY | O_CLOEXEC);
+  if (request->fd < 0) {
+    return errno;
+  }
+  struct stat st;
+  if (fstat(request->fd, &st) != 0) {
+    return errno;
+  }
+  if ((uint64_t)st.st_size > UINT32_MAX) {
+    return EFBIG;
+  }
+  request->result.size = (uint32_t)st.st_size;
+  request->result.data = (uint8_t*)malloc(st.st_size > 0 ? st.st_size : 1);
+  return request->result.data != NULL ? 0 : ENOMEM;
+}
+
+/* Blocking read of the remaining bytes, runs on the I/O threads */
+static void async_io_read_job(void* arg)
+{
+  async_io_request_t* request = (async_io_request_t*)arg;
+  int error                   = async_io_request_open(request);
+  while (error == 0 && request->offset < request->result.size) {
+    const ssize_t count
+      = pread(request->fd, request->result.data + request->offset,
+              MIN(request->result.size - request->offset,
+                  ASYNC_IO_MAX_READ_SIZE),
+              (off_t)request->offset);
+    if (count < 0 && errno != EINTR) {
+      error = errno;
+    }
+    else if (count == 0) {
+      error = EIO; /* the file was truncated */
+    }
+    else if (count > 0) {
+      request->offset += (uint64_t)count;
+    }
+  }
+  async_io_request_complete(request, error);
+}
+
+/* -------------------------------------------------------------------------- *
+ * io_uring backend
+ * -------------------------------------------------------------------------- */
+
+#if ASYNC_IO_URING_SUPPORTED
+
+static int async_io_ring_create(async_io_ring_t* ring)
+{
+  struct io_uring_params params = {0};
+  ring->fd = (int)syscall(__NR_io_uring_setup, ASYNC_IO_QUEUE_DEPTH, &params);
+  if (ring->fd < 0) {
+    return errno;
+  }
+  ring->entries = params.sq_entries;
+
+  ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring->cq_size
+    = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    ring->sq_size = MAX(ring->sq_size, ring->cq_size);
+    ring->cq_size = ring->sq_size;
+  }
+
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ptr = single_mmap || ring->sq_ptr == MAP_FAILED ?
+                   ring->sq_ptr :
+                   mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes      = ring->cq_ptr == MAP_FAILED ?
+                      MAP_FAILED :
+                      mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    const int error = errno;
+    if (ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+      munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr != MAP_FAILED) {
+      munmap(ring->sq_ptr, ring->sq_size);
+    }
+    close(ring->fd);
+    return error;
+  }
+
+  uint8_t* sq = (uint8_t*)ring->sq_ptr;
+  uint8_t* cq = (uint8_t*)ring->cq_ptr;
+
+  ring->sq_head  = (uint32_t*)(sq + params.sq_off.head);
+  ring->sq_tail  = (uint32_t*)(sq + params.sq_off.tail);
+  ring->sq_mask  = (uint32_t*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+  ring->cq_head  = (uint32_t*)(cq + params.cq_off.head);
+  ring->cq_tail  = (uint32_t*)(cq + params.cq_off.tail);
+  ring->cq_mask  = (uint32_t*)(cq + params.cq_off.ring_mask);
+  ring->cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  return 0;
+}
+
+static void async_io_ring_release(async_io_ring_t* ring)
+{
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ptr != ring->sq_ptr) {
+    munmap(ring->cq_ptr, ring->cq_size);
+  }
+  munmap(ring->sq_ptr, ring->sq_size);
+  close(ring->fd);
+}
+
+static int async_io_ring_enter(async_io_ring_t* ring, uint32_t min_complete)
+{
+  const uint32_t flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  const int result     = (int)syscall(__NR_io_uring_enter, ring->fd,
+                                      ring->unsubmitted, min_complete, flags,
+                                      NULL, 0);
+  if (result < 0) {
+    return errno;
+  }
+  ring->unsubmitted -= MIN((uint32_t)result, ring->unsubmitted);
+  return 0;
+}
+
+/* Queues a read of the next chunk of the request */
+static void async_io_ring_push(async_io_ring_t* ring,
+                               async_io_request_t* request)
+{
+  const uint32_t tail  = *ring->sq_tail;
+  const uint32_t index = tail & *ring->sq_mask;
+
+  request->iovec = (struct iovec){
+    .iov_base = request->result.data + request->offset,
+    .iov_len  = MIN(request->result.size - request->offset,
+                    ASYNC_IO_MAX_READ_SIZE),
+  };
+  struct io_uring_sqe* sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = IORING_OP_READV;
+  sqe->fd        = request->fd;
+  sqe->off       = request->offset;
+  sqe->addr      = (uint64_t)(uintptr_t)&request->iovec;
+  sqe->len       = 1;
+  sqe->user_data = (uint64_t)(uintptr_t)request;
+
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++ring->in_flight;
+  ++ring->unsubmitted;
+}
+
+/* Fills the free submission queue entries with pending requests */
+static void async_io_ring_submit(async_io_t* async_io)
+{
+  async_io_ring_t* ring = &async_io->ring;
+  while (async_io->pending.first != NULL && ring->in_flight < ring->entries) {
+    async_io_ring_push(ring, async_io_queue_pop(&async_io->pending));
+  }
+  if (ring->unsubmitted > 0) {
+    const int error = async_io_ring_enter(ring, 0);
+    if (error != 0 && error != EAGAIN && error != EBUSY && error != EINTR) {
+      log_error("io_uring_enter failed: %s", strerror(error));
+    }
+  }
+}
+
+/* Processes the completion queue entries */
+static void async_io_ring_reap(async_io_t* async_io)
+{
+  async_io_ring_t* ring = &async_io->ring;
+  uint32_t head         = *ring->cq_head;
+  const uint32_t tail   = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+    async_io_request_t* request
+      = (async_io_request_t*)(uintptr_t)cqe->user_data;
+    --ring->in_flight;
+    if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+      async_io_queue_push(&async_io->pending, request);
+    }
+    else if (cqe->res < 0) {
+      async_io_request_complete(request, -cqe->res);
+    }
+    else if (cqe->res == 0) {
+      async_io_request_complete(request, EIO); /* the file was truncated */
+    }
+    else {
+      request->offset += (uint64_t)cqe->res;
+      if (request->offset < request->result.size) {
+        async_io_queue_push(&async_io->pending, request);
+      }
+      else {
+        async_io_request_complete(request, 0);
+      }
+    }
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+#endif /* ASYNC_IO_URING_SUPPORTED */
+
+/* -------------------------------------------------------------------------- *
+ * Requests
+ * -------------------------------------------------------------------------- */
+
+static bool async_io_ring_enabled(async_io_t* async_io)
+{
+#if ASYNC_IO_URING_SUPPORTED
+  return async_io->use_ring;
+#else
+  UNUSED_VAR(async_io);
+  return false;
+#endif
+}
+
+async_io_t* async_io_create(void)
+{
+  async_io_t* async_io = (async_io_t*)calloc(1, sizeof(async_io_t));
+  pthread_mutex_init(&async_io->mutex, NULL);
+  pthread_cond_init(&async_io->request_completed, NULL);
+
+#if ASYNC_IO_URING_SUPPORTED
+  const int error = async_io_ring_create(&async_io->ring);
+  if (error == 0) {
+    async_io->use_ring = true;
+    return async_io;
+  }
+  log_debug("io_uring not available (%s), using I/O threads",
+            strerror(error));
+#endif
+
+  async_io->thread_pool = thread_pool_create(ASYNC_IO_THREAD_COUNT);
+  return async_io;
+}
+
+void async_io_release(async_io_t* async_io)
+{
+  if (async_io == NULL) {
+    return;
+  }
+  async_io_wait(async_io);
+#if ASYNC_IO_URING_SUPPORTED
+  if (async_io->use_ring) {
+    async_io_ring_release(&async_io->ring);
+  }
+#endif
+  if (async_io->thread_pool != NULL) {
+    thread_pool_release(async_io->thread_pool);
+  }
+  pthread_cond_destroy(&async_io->request_completed);
+  pthread_mutex_destroy(&async_io->mutex);
+  free(async_io);
+}
+
+bool async_io_uses_io_uring(async_io_t* async_io)
+{
+  return async_io_ring_enabled(async_io);
+}
+
+void async_io_read_file(async_io_t* async_io, const char* filename,
+                        async_io_callback_t callback, void* user_data)
+{
+  async_io_request_t* request
+    = (async_io_request_t*)calloc(1, sizeof(async_io_request_t));
+  request->async_io  = async_io;
+  request->callback  = callback;
+  request->user_data = user_data;
+  request->fd        = -1;
+  snprintf(request->filename, sizeof(request->filename), "%s", filename);
+  ++async_io->outstanding;
+
+  // Archived files are copied from the archive mapping
+  if (file_is_archived(filename)) {
+    read_file(filename, &request->result, 0);
+    async_io_request_complete(request, 0);
+    return;
+  }
+
+  if (!async_io_ring_enabled(async_io)) {
+    thread_pool_submit(async_io->thread_pool, async_io_read_job, request);
+    return;
+  }
+
+#if ASYNC_IO_URING_SUPPORTED
+  const int error = async_io_request_open(request);
+  if (error != 0 || request->result.size == 0) {
+    async_io_request_complete(request, error);
+    return;
+  }
+  async_io_queue_push(&async_io->pending, request);
+  async_io_ring_submit(async_io);
+#endif
+}
+
+uint32_t async_io_poll(async_io_t* async_io)
+{
+#if ASYNC_IO_URING_SUPPORTED
+  if (async_io->use_ring) {
+    async_io_ring_reap(async_io);
+    async_io_ring_submit(async_io);
+  }
+#endif
+
+  pthread_mutex_lock(&async_io->mutex);
+  async_io_queue_t completed = async_io->completed;
+  async_io->completed        = (async_io_queue_t){0};
+  pthread_mutex_unlock(&async_io->mutex);
+
+  uint32_t count              = 0;
+  async_io_request_t* request = NULL;
+  while ((request = async_io_queue_pop(&completed)) != NULL) {
+    --async_io->outstanding;
+    ++count;
+    request->callback(request->error, &request->result, request->user_data);
+    free(request);
+  }
+  return count;
+}
+
+void async_io_wait(async_io_t* async_io)
+{
+  while (async_io->outstanding > 0) {
+    if (async_io_poll(async_io) > 0) {
+      continue;
+    }
+#if ASYNC_IO_URING_SUPPORTED
+    if (async_io->use_ring) {
+      const int error = async_io_ring_enter(&async_io->ring, 1);
+      if (error != 0 && error != EINTR) {
+        log_error("io_uring_enter failed: %s", strerror(error));
+      }
+      continue;
+    }
+#endif
+    pthread_mutex_lock(&async_io->mutex);
+    while (async_io->completed.first == NULL) {
+      pthread_cond_wait(&async_io->request_completed, &async_io->mutex);
+    }
+    pthread_mutex_unlock(&async_io->mutex);
+  }
+}
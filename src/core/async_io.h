@@ -0,0 +1,51 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stdint.h>
+
+#include "file.h"
+
+/**
+ * @brief Asynchronous file reads. Reads are queued with io_uring on Linux and
+ * run on a small pool of I/O threads if io_uring is not available, e.g. when
+ * it is blocked by a container seccomp profile. Files in the mounted asset
+ * archive complete without I/O.
+ *
+ * The requests are submitted and completed on the thread owning the
+ * async_io_t: the callbacks run in async_io_poll() and async_io_wait().
+ */
+typedef struct async_io async_io_t;
+
+/**
+ * @brief Called once the read finished. On success the callback owns
+ * result->data and releases it with free(), on failure result is zeroed.
+ * @param error 0 on success, otherwise the errno value of the failed call
+ */
+typedef void (*async_io_callback_t)(int error, file_read_result_t* result,
+                                    void* user_data);
+
+/* async I/O creating/releasing */
+async_io_t* async_io_create(void);
+/* Waits for the outstanding requests before releasing */
+void async_io_release(async_io_t* async_io);
+
+/**
+ * @brief Queues a read of the whole file, the file name is not referenced
+ * after the call.
+ */
+void async_io_read_file(async_io_t* async_io, const char* filename,
+                        async_io_callback_t callback, void* user_data);
+
+/**
+ * @brief Submits queued reads and calls the callbacks of the finished reads
+ * without blocking.
+ * @return the number of callbacks called
+ */
+uint32_t async_io_poll(async_io_t* async_io);
+
+/* Blocks until the callbacks of all requests have been called */
+void async_io_wait(async_io_t* async_io);
+
+bool async_io_uses_io_uring(async_io_t* async_io);
+
+#endif
@@ -0,0 +1,247 @@
+#include "benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file.h"
+#include "log.h"
+#include "macro.h"
+
+/* benchmark creating/releasing */
+
+benchmark_t* benchmark_create(uint32_t warmup_frames, uint32_t frame_count)
+{
+  benchmark_t* benchmark = (benchmark_t*)malloc(sizeof(benchmark_t));
+  memset(benchmark, 0, sizeof(benchmark_t));
+
+  benchmark->warmup_frames = warmup_frames;
+  benchmark->frame_count   = frame_count;
+  benchmark->capacity      = frame_count > 0 ? frame_count : 1024u;
+  benchmark->frame_times = (float*)calloc(benchmark->capacity, sizeof(float));
+
+  return benchmark;
+}
+
+void benchmark_release(benchmark_t* benchmark)
+{
+  free(benchmark->frame_times);
+  free(benchmark);
+}
+
+void benchmark_set_max_duration(benchmark_t* benchmark, float duration_ms)
+{
+  benchmark->max_duration_ms = MAX(0.0f, duration_ms);
+}
+
+/* benchmark recording */
+
+void benchmark_add_frame_time(benchmark_t* benchmark, float frame_time_ms)
+{
+  if (benchmark->frames_seen++ < benchmark->warmup_frames
+      || benchmark_is_finished(benchmark)) {
+    return;
+  }
+  if (benchmark->frames_recorded == benchmark->capacity) {
+    benchmark->capacity *= 2;
+    benchmark->frame_times = (float*)realloc(
+      benchmark->frame_times, benchmark->capacity * sizeof(float));
+  }
+  benchmark->frame_times[benchmark->frames_recorded++] = frame_time_ms;
+  benchmark->recorded_duration_ms += frame_time_ms;
+}
+
+bool benchmark_is_finished(benchmark_t* benchmark)
+{
+  if (benchmark->frame_count > 0
+      && benchmark->frames_recorded >= benchmark->frame_count) {
+    return true;
+  }
+  if (benchmark->max_duration_ms > 0.0f
+      && benchmark->recorded_duration_ms >= benchmark->max_duration_ms) {
+    return true;
+  }
+  return false;
+}
+
+/* benchmark statistics */
+
+static int compare_floats(const void* a, const void* b)
+{
+  const float fa = *(const float*)a, fb = *(const float*)b;
+  return (fa > fb) - (fa < fb);
+}
+
+/* Nearest-rank percentile of a sorted array */
+static float percentile(const float* sorted, uint32_t count, float p)
+{
+  uint32_t rank = (uint32_t)ceilf(p / 100.0f * (float)count);
+  rank          = CLAMP(rank, 1u, count);
+  return sorted[rank - 1];
+}
+
+void benchmark_compute_statistics(const float* frame_times,
+                                  uint32_t frame_count,
+                                  benchmark_statistics_t* stats)
+{
+  memset(stats, 0, sizeof(benchmark_statistics_t));
+  if (frame_count == 0) {
+    return;
+  }
+
+  float* sorted = (float*)malloc(frame_count * sizeof(float));
+  memcpy(sorted, frame_times, frame_count * sizeof(float));
+  qsort(sorted, frame_count, sizeof(float), compare_floats);
+
+  double sum = 0.0;
+  for (uint32_t i = 0; i < frame_count; ++i) {
+    sum += sorted[i];
+  }
+  const double mean = sum / frame_count;
+  double variance   = 0.0;
+  for (uint32_t i = 0; i < frame_count; ++i) {
+    variance += (sorted[i] - mean) * (sorted[i] - mean);
+  }
+  variance /= frame_count;
+
+  stats->frame_count = frame_count;
+  stats->min         = sorted[0];
+  stats->max         = sorted[frame_count - 1];
+  stats->mean        = (float)mean;
+  stats->std_dev     = (float)sqrt(variance);
+  stats->p50         = percentile(sorted, frame_count, 50.0f);
+  stats->p95         = percentile(sorted, frame_count, 95.0f);
+  stats->p99         = percentile(sorted, frame_count, 99.0f);
+
+  free(sorted);
+}
+
+void benchmark_get_statistics(benchmark_t* benchmark,
+                              benchmark_statistics_t* stats)
+{
+  benchmark_compute_statistics(benchmark->frame_times,
+                               benchmark->frames_recorded, stats);
+}
+
+/* benchmark reporting */
+
+static void write_json_string(FILE* file, const char* str)
+{
+  fputc('"', file);
+  for (const char* c = str ? str : ""; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+static void write_json_report(FILE* file, benchmark_t* benchmark,
+                              const benchmark_report_info_t* info,
+                              const benchmark_statistics_t* stats)
+{
+  fprintf(file, "{\n  \"example\": ");
+  write_json_string(file, info->example_title);
+  fprintf(file, ",\n  \"adapter\": {\n    \"name\": ");
+  write_json_string(file, info->adapter_info[0]);
+  fprintf(file, ",\n    \"type\": ");
+  write_json_string(file, info->adapter_info[1]);
+  fprintf(file, ",\n    \"backend\": ");
+  write_json_string(file, info->adapter_info[2]);
+  fprintf(file, "\n  },\n");
+  fprintf(file, "  \"resolution\": [%u, %u],\n", info->width, info->height);
+  fprintf(file, "  \"warmup_frames\": %u,\n", benchmark->warmup_frames);
+  fprintf(file,
+          "  \"statistics\": {\n"
+          "    \"frame_count\": %u,\n"
+          "    \"min_ms\": %.4f,\n"
+          "    \"max_ms\": %.4f,\n"
+          "    \"mean_ms\": %.4f,\n"
+          "    \"std_dev_ms\": %.4f,\n"
+          "    \"p50_ms\": %.4f,\n"
+          "    \"p95_ms\": %.4f,\n"
+          "    \"p99_ms\": %.4f\n"
+          "  },\n",
+          stats->frame_count, stats->min, stats->max, stats->mean,
+          stats->std_dev, stats->p50, stats->p95, stats->p99);
+  if (info->counter_count > 0) {
+    fprintf(file, "  \"counters_per_frame\": {\n");
+    for (uint32_t i = 0; i < info->counter_count; ++i) {
+      fprintf(file, "    ");
+      write_json_string(file, info->counters[i].name);
+      fprintf(file, ": %.4f%s\n", info->counters[i].mean,
+              (i + 1 < info->counter_count) ? "," : "");
+    }
+    fprintf(file, "  },\n");
+  }
+  fprintf(file, "  \"frame_times_ms\": [");
+  for (uint32_t i = 0; i < benchmark->frames_recorded; ++i) {
+    fprintf(file, "%s%.4f", (i == 0) ? "" : ", ", benchmark->frame_times[i]);
+  }
+  fprintf(file, "]\n}\n");
+}
+
+static void write_csv_report(FILE* file, benchmark_t* benchmark,
+                             const benchmark_report_info_t* info,
+                             const benchmark_statistics_t* stats)
+{
+  fprintf(file, "# example,%s\n", info->example_title);
+  fprintf(file, "# adapter,%s,%s,%s\n", info->adapter_info[0],
+          info->adapter_info[1], info->adapter_info[2]);
+  fprintf(file, "# resolution,%u,%u\n", info->width, info->height);
+  fprintf(file, "# warmup_frames,%u\n", benchmark->warmup_frames);
+  fprintf(file,
+          "# frame_count,min_ms,max_ms,mean_ms,std_dev_ms,p50_ms,p95_ms,"
+          "p99_ms\n");
+  fprintf(file, "# %u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+          stats->frame_count, stats->min, stats->max, stats->mean,
+          stats->std_dev, stats->p50, stats->p95, stats->p99);
+  if (info->counter_count > 0) {
+    fprintf(file, "# counters_per_frame");
+    for (uint32_t i = 0; i < info->counter_count; ++i) {
+      fprintf(file, ",%s", info->counters[i].name);
+    }
+    fprintf(file, "\n# ");
+    for (uint32_t i = 0; i < info->counter_count; ++i) {
+      fprintf(file, "%s%.4f", (i == 0) ? "" : ",", info->counters[i].mean);
+    }
+    fprintf(file, "\n");
+  }
+  fprintf(file, "frame,frame_time_ms\n");
+  for (uint32_t i = 0; i < benchmark->frames_recorded; ++i) {
+    fprintf(file, "%u,%.4f\n", i, benchmark->frame_times[i]);
+  }
+}
+
+int benchmark_write_report(benchmark_t* benchmark, const char* filename,
+                           const benchmark_report_info_t* info)
+{
+  ASSERT(benchmark && info);
+
+  benchmark_statistics_t stats;
+  benchmark_get_statistics(benchmark, &stats);
+
+  FILE* file = stdout;
+  if (filename != NULL) {
+    file = fopen(filename, "w");
+    if (file == NULL) {
+      log_error("Unable to open benchmark report file '%s'\n", filename);
+      return 1;
+    }
+  }
+
+  if (filename != NULL && filename_has_extension(filename, "csv")) {
+    write_csv_report(file, benchmark, info, &stats);
+  }
+  else {
+    write_json_report(file, benchmark, info, &stats);
+  }
+
+  if (file != stdout) {
+    fclose(file);
+  }
+
+  return 0;
+}
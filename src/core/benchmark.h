@@ -0,0 +1,90 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Frame time statistics (all values in milliseconds).
+ */
+typedef struct benchmark_statistics_t {
+  uint32_t frame_count;
+  float min;
+  float max;
+  float mean;
+  float std_dev;
+  float p50;
+  float p95;
+  float p99;
+} benchmark_statistics_t;
+
+/**
+ * @brief Average per frame of a counter of the measured frames, e.g. the
+ * number of draw calls.
+ */
+typedef struct benchmark_counter_t {
+  const char* name;
+  double mean;
+} benchmark_counter_t;
+
+/**
+ * @brief Information written in the header of a benchmark report.
+ */
+typedef struct benchmark_report_info_t {
+  const char* example_title;
+  /* 0: adapter name, 1: adapter type name, 2: backend name */
+  char (*adapter_info)[256];
+  uint32_t width;
+  uint32_t height;
+  /* Optional frame counters */
+  const benchmark_counter_t* counters;
+  uint32_t counter_count;
+} benchmark_report_info_t;
+
+/**
+ * @brief Frame time recorder: skips a number of warm-up frames and afterwards
+ * records the frame times of the measured frames. Recording finishes after a
+ * fixed number of frames and/or after a maximum measured duration.
+ */
+typedef struct benchmark_t {
+  uint32_t warmup_frames;
+  uint32_t frame_count;  /* 0 = no frame limit */
+  float max_duration_ms; /* 0 = no duration limit */
+  float recorded_duration_ms;
+  uint32_t frames_seen;
+  uint32_t frames_recorded;
+  uint32_t capacity;
+  float* frame_times; /* milliseconds */
+} benchmark_t;
+
+/* benchmark creating/releasing */
+benchmark_t* benchmark_create(uint32_t warmup_frames, uint32_t frame_count);
+void benchmark_release(benchmark_t* benchmark);
+void benchmark_set_max_duration(benchmark_t* benchmark, float duration_ms);
+
+/* benchmark recording */
+void benchmark_add_frame_time(benchmark_t* benchmark, float frame_time_ms);
+bool benchmark_is_finished(benchmark_t* benchmark);
+
+/**
+ * @brief Computes min, max, mean, standard deviation and p50/p95/p99 of the
+ * given frame times (in milliseconds).
+ */
+void benchmark_compute_statistics(const float* frame_times,
+                                  uint32_t frame_count,
+                                  benchmark_statistics_t* stats);
+void benchmark_get_statistics(benchmark_t* benchmark,
+                              benchmark_statistics_t* stats);
+
+/**
+ * @brief Writes the benchmark report to the specified file. The report format
+ * is selected by the file extension: ".csv" writes CSV, anything else JSON.
+ * @param benchmark the benchmark containing the recorded frame times
+ * @param filename the report file, NULL writes the JSON report to stdout
+ * @param info the report header information
+ * @return 0 on success otherwise 1
+ */
+int benchmark_write_report(benchmark_t* benchmark, const char* filename,
+                           const benchmark_report_info_t* info);
+
+#endif
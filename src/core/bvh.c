@@ -0,0 +1,257 @@
+#include "bvh.h"
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macro.h"
+
+/* Number of bins the split candidates are evaluated on per axis */
+#define BVH_BIN_COUNT 16u
+
+/* -------------------------------------------------------------------------- *
+ * Bounds
+ * -------------------------------------------------------------------------- */
+
+typedef struct bvh_bounds_t {
+  float min[3];
+  float max[3];
+} bvh_bounds_t;
+
+static void bvh_bounds_reset(bvh_bounds_t* bounds)
+{
+  for (uint32_t i = 0; i < 3; ++i) {
+    bounds->min[i] = FLT_MAX;
+    bounds->max[i] = -FLT_MAX;
+  }
+}
+
+static void bvh_bounds_grow(bvh_bounds_t* bounds, const float point[3])
+{
+  for (uint32_t i = 0; i < 3; ++i) {
+    bounds->min[i] = MIN(bounds->min[i], point[i]);
+    bounds->max[i] = MAX(bounds->max[i], point[i]);
+  }
+}
+
+static void bvh_bounds_merge(bvh_bounds_t* bounds, const bvh_bounds_t* other)
+{
+  for (uint32_t i = 0; i < 3; ++i) {
+    bounds->min[i] = MIN(bounds->min[i], other->min[i]);
+    bounds->max[i] = MAX(bounds->max[i], other->max[i]);
+  }
+}
+
+/* Half the surface area, the constant factor cancels out in the SAH */
+static float bvh_bounds_half_area(const bvh_bounds_t* bounds)
+{
+  const float dx = bounds->max[0] - bounds->min[0];
+  const float dy = bounds->max[1] - bounds->min[1];
+  const float dz = bounds->max[2] - bounds->min[2];
+  if (dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+    return 0.0f;
+  }
+  return dx * dy + dy * dz + dz * dx;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Construction
+ * -------------------------------------------------------------------------- */
+
+typedef struct bvh_builder_t {
+  bvh_t* bvh;
+  const bvh_bounds_t* triangle_bounds;
+  const float* centroids; /* 3 floats per triangle */
+} bvh_builder_t;
+
+typedef struct bvh_bin_t {
+  bvh_bounds_t bounds;
+  uint32_t count;
+} bvh_bin_t;
+
+static uint32_t bvh_bin_index(float centroid, float min, float scale)
+{
+  const uint32_t bin = (uint32_t)((centroid - min) * scale);
+  return MIN(bin, BVH_BIN_COUNT - 1);
+}
+
+/**
+ * @brief Finds the split with the lowest surface area heuristic cost, returns
+ * false if the centroids of the range are all at the same position.
+ * @param axis receives the split axis
+ * @param split_bin receives the last bin of the first child
+ */
+static bool bvh_find_split(const bvh_builder_t* builder, uint32_t begin,
+                           uint32_t end, const bvh_bounds_t* centroid_bounds,
+                           uint32_t* axis, uint32_t* split_bin)
+{
+  const uint32_t* triangle_indices = builder->bvh->triangle_indices;
+  float best_cost                  = FLT_MAX;
+
+  for (uint32_t a = 0; a < 3; ++a) {
+    const float min    = centroid_bounds->min[a];
+    const float extent = centroid_bounds->max[a] - min;
+    if (extent <= 0.0f) {
+      continue;
+    }
+    const float scale = (float)BVH_BIN_COUNT / extent;
+
+    bvh_bin_t bins[BVH_BIN_COUNT];
+    for (uint32_t b = 0; b < BVH_BIN_COUNT; ++b) {
+      bvh_bounds_reset(&bins[b].bounds);
+      bins[b].count = 0;
+    }
+    for (uint32_t i = begin; i < end; ++i) {
+      const uint32_t triangle = triangle_indices[i];
+      const uint32_t b
+        = bvh_bin_index(builder->centroids[triangle * 3 + a], min, scale);
+      bvh_bounds_merge(&bins[b].bounds, &builder->triangle_bounds[triangle]);
+      ++bins[b].count;
+    }
+
+    /* Costs of the first children, swept from the left */
+    float left_areas[BVH_BIN_COUNT - 1];
+    uint32_t left_counts[BVH_BIN_COUNT - 1];
+    bvh_bounds_t bounds;
+    bvh_bounds_reset(&bounds);
+    uint32_t count = 0;
+    for (uint32_t b = 0; b < BVH_BIN_COUNT - 1; ++b) {
+      bvh_bounds_merge(&bounds, &bins[b].bounds);
+      count += bins[b].count;
+      left_areas[b]  = bvh_bounds_half_area(&bounds);
+      left_counts[b] = count;
+    }
+
+    /* Sweep from the right, splits with an empty child are skipped */
+    bvh_bounds_reset(&bounds);
+    count = 0;
+    for (uint32_t b = BVH_BIN_COUNT - 1; b > 0; --b) {
+      bvh_bounds_merge(&bounds, &bins[b].bounds);
+      count += bins[b].count;
+      if (count == 0 || left_counts[b - 1] == 0) {
+        continue;
+      }
+      const float cost = left_areas[b - 1] * (float)left_counts[b - 1]
+                         + bvh_bounds_half_area(&bounds) * (float)count;
+      if (cost < best_cost) {
+        best_cost  = cost;
+        *axis      = a;
+        *split_bin = b - 1;
+      }
+    }
+  }
+
+  return best_cost < FLT_MAX;
+}
+
+static void bvh_build_node(bvh_builder_t* builder, uint32_t begin,
+                           uint32_t end, uint32_t depth)
+{
+  bvh_t* bvh           = builder->bvh;
+  uint32_t* indices    = bvh->triangle_indices;
+  const uint32_t count = end - begin;
+  bvh_node_t* node     = &bvh->nodes[bvh->node_count++];
+
+  bvh_bounds_t bounds, centroid_bounds;
+  bvh_bounds_reset(&bounds);
+  bvh_bounds_reset(&centroid_bounds);
+  for (uint32_t i = begin; i < end; ++i) {
+    bvh_bounds_merge(&bounds, &builder->triangle_bounds[indices[i]]);
+    bvh_bounds_grow(&centroid_bounds, &builder->centroids[indices[i] * 3]);
+  }
+  memcpy(node->aabb_min, bounds.min, sizeof(node->aabb_min));
+  memcpy(node->aabb_max, bounds.max, sizeof(node->aabb_max));
+  bvh->depth = MAX(bvh->depth, depth);
+
+  if (count <= BVH_MAX_LEAF_TRIANGLES) {
+    node->primitives = (begin << BVH_LEAF_COUNT_BITS) | count;
+    node->miss_index = bvh->node_count;
+    return;
+  }
+
+  /* Partition the range at the SAH split, triangles with coinciding
+   * centroids can't be separated by a plane and are split at the median */
+  uint32_t axis = 0, split_bin = 0;
+  uint32_t mid  = begin + count / 2;
+  if (bvh_find_split(builder, begin, end, &centroid_bounds, &axis,
+                     &split_bin)) {
+    const float min = centroid_bounds.min[axis];
+    const float scale
+      = (float)BVH_BIN_COUNT / (centroid_bounds.max[axis] - min);
+    uint32_t left  = begin;
+    uint32_t right = end;
+    while (left < right) {
+      const float centroid = builder->centroids[indices[left] * 3 + axis];
+      if (bvh_bin_index(centroid, min, scale) <= split_bin) {
+        ++left;
+      }
+      else {
+        const uint32_t triangle = indices[left];
+        indices[left]           = indices[--right];
+        indices[right]          = triangle;
+      }
+    }
+    mid = left;
+  }
+
+  node->primitives = 0;
+  bvh_build_node(builder, begin, mid, depth + 1);
+  bvh_build_node(builder, mid, end, depth + 1);
+  /* The node pointer is stable, all nodes are allocated up front */
+  node->miss_index = bvh->node_count;
+}
+
+bvh_t* bvh_create(const float* positions, uint32_t triangle_count)
+{
+  ASSERT(triangle_count < (1u << (32u - BVH_LEAF_COUNT_BITS)));
+
+  bvh_t* bvh          = calloc(1, sizeof(bvh_t));
+  bvh->triangle_count = triangle_count;
+  if (triangle_count == 0) {
+    return bvh;
+  }
+
+  /* A binary tree with leaves of at least one triangle */
+  bvh->nodes            = malloc((2 * triangle_count - 1) * sizeof(bvh_node_t));
+  bvh->triangle_indices = malloc(triangle_count * sizeof(uint32_t));
+
+  bvh_bounds_t* triangle_bounds
+    = malloc(triangle_count * sizeof(bvh_bounds_t));
+  float* centroids = malloc(triangle_count * 3 * sizeof(float));
+  for (uint32_t i = 0; i < triangle_count; ++i) {
+    const float* vertices = &positions[i * 9];
+    bvh_bounds_reset(&triangle_bounds[i]);
+    for (uint32_t v = 0; v < 3; ++v) {
+      bvh_bounds_grow(&triangle_bounds[i], &vertices[v * 3]);
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+      centroids[i * 3 + c]
+        = (vertices[c] + vertices[3 + c] + vertices[6 + c]) / 3.0f;
+    }
+    bvh->triangle_indices[i] = i;
+  }
+
+  bvh_builder_t builder = {
+    .bvh             = bvh,
+    .triangle_bounds = triangle_bounds,
+    .centroids       = centroids,
+  };
+  bvh_build_node(&builder, 0, triangle_count, 1);
+
+  free(triangle_bounds);
+  free(centroids);
+
+  return bvh;
+}
+
+void bvh_destroy(bvh_t* bvh)
+{
+  if (bvh == NULL) {
+    return;
+  }
+
+  free(bvh->nodes);
+  free(bvh->triangle_indices);
+  free(bvh);
+}
@@ -0,0 +1,65 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdint.h>
+
+/* Maximum number of triangles of a leaf node */
+#define BVH_MAX_LEAF_TRIANGLES 4u
+
+/* Bits of bvh_node_t.primitives holding the triangle count of a leaf */
+#define BVH_LEAF_COUNT_BITS 3u
+#define BVH_LEAF_COUNT_MASK ((1u << BVH_LEAF_COUNT_BITS) - 1u)
+
+/**
+ * @brief Node of a flattened bounding volume hierarchy, 32 bytes, matches the
+ * std430 layout of
+ *
+ *   struct BVHNode {
+ *     aabb_min   : vec3<f32>,
+ *     miss_index : u32,
+ *     aabb_max   : vec3<f32>,
+ *     primitives : u32,
+ *   }
+ *
+ * The nodes are stored in depth first order, the first child of an inner node
+ * directly follows it. miss_index is the node to continue with when the ray
+ * misses the node or the leaf has been tested, which is the node following the
+ * subtree (node_count past the last subtree). This allows a stackless
+ * traversal:
+ *
+ *   i = 0
+ *   while (i < node_count)
+ *     if (hit(node[i]) && !leaf(node[i])) i = i + 1
+ *     else test triangles if leaf and hit, i = node[i].miss_index
+ *
+ * primitives is first_triangle << BVH_LEAF_COUNT_BITS | triangle_count for
+ * leaves and 0 for inner nodes.
+ */
+typedef struct bvh_node_t {
+  float aabb_min[3];
+  uint32_t miss_index;
+  float aabb_max[3];
+  uint32_t primitives;
+} bvh_node_t;
+
+/**
+ * @brief Bounding volume hierarchy over a triangle soup, built with the
+ * surface area heuristic evaluated on 16 bins of the triangle centroids per
+ * axis (Wald, "On fast Construction of SAH-based Bounding Volume
+ * Hierarchies"). The triangles of a leaf are a contiguous range of
+ * triangle_indices, which maps the BVH order to the input triangles.
+ */
+typedef struct bvh_t {
+  bvh_node_t* nodes;
+  uint32_t node_count;
+  uint32_t* triangle_indices;
+  uint32_t triangle_count;
+  uint32_t depth; /* depth of the deepest leaf, the root has depth 1 */
+} bvh_t;
+
+/* bvh creating/destroying, positions holds 9 floats (3 vertices) per
+ * triangle */
+bvh_t* bvh_create(const float* positions, uint32_t triangle_count);
+void bvh_destroy(bvh_t* bvh);
+
+#endif
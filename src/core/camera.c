@@ -226,20 +226,39 @@ void camera_set_perspective(camera_t* camera, float fov, float aspect,
   camera->fov   = fov;
   camera->znear = znear;
   camera->zfar  = zfar;
-  glm_perspective(glm_rad(fov), aspect, znear, zfar,
-                  camera->matrices.perspective);
-  if (camera->flip_y) {
-    camera->matrices.perspective[1][1] *= -1.0f;
-  }
+  camera_update_aspect_ratio(camera, aspect);
 }
 
 void camera_update_aspect_ratio(camera_t* camera, float aspect)
 {
-  glm_perspective(glm_rad(camera->fov), aspect, camera->znear, camera->zfar,
-                  camera->matrices.perspective);
+  mat4* perspective = &camera->matrices.unjittered_perspective;
+  camera->aspect    = aspect;
+  if (camera->reversed_z) {
+    perspective_matrix_reversed_z_infinite_far(glm_rad(camera->fov), aspect,
+                                               camera->znear, *perspective);
+  }
+  else {
+    glm_perspective(glm_rad(camera->fov), aspect, camera->znear, camera->zfar,
+                    *perspective);
+  }
   if (camera->flip_y) {
-    camera->matrices.perspective[1][1] *= -1.0f;
+    (*perspective)[1][1] *= -1.0f;
   }
+
+  // The jitter is added to the clip space x / y scaled by w, so it is a
+  // constant offset in NDC
+  mat4* jittered = &camera->matrices.perspective;
+  glm_mat4_copy(*perspective, *jittered);
+  for (uint32_t c = 0; c < 4; ++c) {
+    (*jittered)[c][0] += camera->jitter[0] * (*perspective)[c][3];
+    (*jittered)[c][1] += camera->jitter[1] * (*perspective)[c][3];
+  }
+}
+
+void camera_set_jitter(camera_t* camera, vec2 jitter)
+{
+  glm_vec2_copy(jitter, camera->jitter);
+  camera_update_aspect_ratio(camera, camera->aspect);
 }
 
 /* property retrieving */
@@ -23,9 +23,15 @@ typedef struct {
   float movement_speed;
   bool updated;
   bool flip_y;
+  /* Reversed-Z projection with an infinite far plane, zfar is ignored */
+  bool reversed_z;
+  float aspect;
+  /* Sub-pixel offset of the projection in NDC, see camera_set_jitter() */
+  vec2 jitter;
   struct {
-    mat4 perspective;
+    mat4 perspective; /* jittered */
     mat4 view;
+    mat4 unjittered_perspective;
   } matrices;
   struct {
     bool left;
@@ -54,6 +60,9 @@ void camera_set_movement_speed(camera_t* camera, float movement_speed);
 void camera_set_perspective(camera_t* camera, float fov, float aspect,
                             float znear, float zfar);
 void camera_update_aspect_ratio(camera_t* camera, float aspect);
+/* Offsets the projection by a sub-pixel amount in NDC, e.g. the jitter of
+ * temporal anti-aliasing, (0, 0) disables it */
+void camera_set_jitter(camera_t* camera, vec2 jitter);
 
 /* property retrieving */
 bool camera_moving(camera_t* camera);
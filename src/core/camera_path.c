@@ -0,0 +1,136 @@
+#include "camera_path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+#define CAMERA_PATH_HEADER "camera_path 1"
+#define CAMERA_PATH_INITIAL_CAPACITY 1024u
+
+typedef struct camera_path_key_t {
+  vec3 position;
+  vec3 rotation;
+} camera_path_key_t;
+
+struct camera_path_t {
+  camera_path_key_t* keys;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+/* camera path creating/releasing */
+
+camera_path_t* camera_path_create(void)
+{
+  camera_path_t* path = (camera_path_t*)malloc(sizeof(camera_path_t));
+  memset(path, 0, sizeof(camera_path_t));
+
+  path->capacity = CAMERA_PATH_INITIAL_CAPACITY;
+  path->keys
+    = (camera_path_key_t*)calloc(path->capacity, sizeof(camera_path_key_t));
+
+  return path;
+}
+
+void camera_path_release(camera_path_t* path)
+{
+  if (path == NULL) {
+    return;
+  }
+
+  free(path->keys);
+  free(path);
+}
+
+/* camera path recording */
+
+static void camera_path_add_key(camera_path_t* path, vec3 position,
+                                vec3 rotation)
+{
+  if (path->count == path->capacity) {
+    path->capacity *= 2;
+    path->keys = (camera_path_key_t*)realloc(
+      path->keys, path->capacity * sizeof(camera_path_key_t));
+  }
+  camera_path_key_t* key = &path->keys[path->count++];
+  glm_vec3_copy(position, key->position);
+  glm_vec3_copy(rotation, key->rotation);
+}
+
+void camera_path_record(camera_path_t* path, camera_t* camera)
+{
+  camera_path_add_key(path, camera->position, camera->rotation);
+}
+
+uint32_t camera_path_get_frame_count(camera_path_t* path)
+{
+  return path->count;
+}
+
+bool camera_path_apply(camera_path_t* path, uint32_t frame, camera_t* camera)
+{
+  if (frame >= path->count) {
+    return false;
+  }
+
+  /* The recorded state as is, camera_set_position() flips the y axis */
+  camera_path_key_t* key = &path->keys[frame];
+  glm_vec3_copy(key->position, camera->position);
+  glm_vec3_copy(key->rotation, camera->rotation);
+  camera_update_view_matrix(camera);
+  return true;
+}
+
+/* camera path file i/o */
+
+int camera_path_save(camera_path_t* path, const char* filename)
+{
+  FILE* file = fopen(filename, "w");
+  if (file == NULL) {
+    log_error("Unable to open camera path file '%s'\n", filename);
+    return 1;
+  }
+
+  fprintf(file, "%s\n", CAMERA_PATH_HEADER);
+  for (uint32_t i = 0; i < path->count; ++i) {
+    const camera_path_key_t* key = &path->keys[i];
+    fprintf(file, "%.9g %.9g %.9g %.9g %.9g %.9g\n", key->position[0],
+            key->position[1], key->position[2], key->rotation[0],
+            key->rotation[1], key->rotation[2]);
+  }
+
+  fclose(file);
+  return 0;
+}
+
+camera_path_t* camera_path_load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if (file == NULL) {
+    log_error("Unable to open camera path file '%s'\n", filename);
+    return NULL;
+  }
+
+  char line[256];
+  if (fgets(line, sizeof(line), file) == NULL
+      || strncmp(line, CAMERA_PATH_HEADER, strlen(CAMERA_PATH_HEADER)) != 0) {
+    log_error("Invalid camera path file '%s'\n", filename);
+    fclose(file);
+    return NULL;
+  }
+
+  camera_path_t* path = camera_path_create();
+  vec3 position, rotation;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (sscanf(line, "%f %f %f %f %f %f", &position[0], &position[1],
+               &position[2], &rotation[0], &rotation[1], &rotation[2])
+        == 6) {
+      camera_path_add_key(path, position, rotation);
+    }
+  }
+
+  fclose(file);
+  return path;
+}
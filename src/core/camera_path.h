@@ -0,0 +1,46 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "camera.h"
+
+/* -------------------------------------------------------------------------- *
+ * Camera path
+ *
+ * Per-frame camera positions and rotations, recorded from the camera of an
+ * example and replayed on a later run, so that every run renders the same
+ * views. Saved as text, one "x y z pitch yaw roll" line per frame.
+ * -------------------------------------------------------------------------- */
+
+typedef struct camera_path_t camera_path_t;
+
+/* camera path creating/releasing */
+camera_path_t* camera_path_create(void);
+void camera_path_release(camera_path_t* path);
+
+/* camera path recording, one key per rendered frame */
+void camera_path_record(camera_path_t* path, camera_t* camera);
+uint32_t camera_path_get_frame_count(camera_path_t* path);
+
+/**
+ * @brief Sets the camera position and rotation of a recorded frame.
+ * @return false if the path has no key for the frame, the camera keeps its
+ * state
+ */
+bool camera_path_apply(camera_path_t* path, uint32_t frame, camera_t* camera);
+
+/**
+ * @brief Writes the camera path to the specified file.
+ * @return 0 on success, 1 on failure
+ */
+int camera_path_save(camera_path_t* path, const char* filename);
+
+/**
+ * @brief Reads a camera path written by camera_path_save().
+ * @return the camera path, NULL on failure
+ */
+camera_path_t* camera_path_load(const char* filename);
+
+#endif /* CAMERA_PATH_H */
@@ -0,0 +1,145 @@
+#include "cascaded_shadows.h"
+
+#include <float.h>
+#include <string.h>
+
+#include "macro.h"
+
+/* cascaded shadows initialization */
+
+void cascaded_shadows_init(cascaded_shadows_t* shadows, uint32_t cascade_count,
+                           float split_lambda, uint32_t shadow_map_size)
+{
+  ASSERT(cascade_count > 0 && cascade_count <= CASCADED_SHADOWS_MAX_CASCADES);
+  ASSERT(shadow_map_size > 0);
+
+  memset(shadows, 0, sizeof(cascaded_shadows_t));
+  shadows->cascade_count   = cascade_count;
+  shadows->split_lambda    = split_lambda;
+  shadows->shadow_map_size = shadow_map_size;
+  shadows->dirty_mask      = (1u << cascade_count) - 1u;
+}
+
+/* cascade fitting */
+
+/* Practical split scheme (Zhang et al.), blends the logarithmic and uniform
+ * split distances */
+static void compute_split_depths(cascaded_shadows_t* shadows, float near,
+                                 float far)
+{
+  const uint32_t count = shadows->cascade_count;
+  for (uint32_t i = 0; i < count; ++i) {
+    const float p         = (float)(i + 1) / (float)count;
+    const float log_split = near * powf(far / near, p);
+    const float uniform   = near + (far - near) * p;
+    shadows->split_depths[i]
+      = shadows->split_lambda * (log_split - uniform) + uniform;
+  }
+}
+
+/* Orthographic projection mapping the view space depth range [-near, -far]
+ * to [0, 1] */
+static void ortho_zero_to_one(float left, float right, float bottom, float top,
+                              float near, float far, mat4 dest)
+{
+  glm_mat4_zero(dest);
+  dest[0][0] = 2.0f / (right - left);
+  dest[1][1] = 2.0f / (top - bottom);
+  dest[2][2] = -1.0f / (far - near);
+  dest[3][0] = -(right + left) / (right - left);
+  dest[3][1] = -(top + bottom) / (top - bottom);
+  dest[3][2] = -near / (far - near);
+  dest[3][3] = 1.0f;
+}
+
+/* Light space bounds of the camera frustum slice between the view space
+ * distances near and far */
+static void compute_slice_bounds(cascaded_shadows_camera_t* camera,
+                                 mat4 light_from_view, float near, float far,
+                                 vec2 min, vec2 max)
+{
+  const float tan_half_fov = tanf(camera->fov_y * 0.5f);
+  const float depths[2]    = {near, far};
+
+  min[0] = min[1] = FLT_MAX;
+  max[0] = max[1] = -FLT_MAX;
+  for (uint32_t i = 0; i < 8; ++i) {
+    const float depth  = depths[i >> 2];
+    const float height = depth * tan_half_fov;
+    const float width  = height * camera->aspect;
+    vec3 corner        = {
+      (i & 1) ? width : -width,
+      (i & 2) ? height : -height,
+      -depth,
+    };
+    glm_mat4_mulv3(light_from_view, corner, 1.0f, corner);
+    min[0] = MIN(min[0], corner[0]);
+    min[1] = MIN(min[1], corner[1]);
+    max[0] = MAX(max[0], corner[0]);
+    max[1] = MAX(max[1], corner[1]);
+  }
+}
+
+void cascaded_shadows_update(cascaded_shadows_t* shadows,
+                             cascaded_shadows_camera_t* camera,
+                             vec3 light_direction, vec3 scene_center,
+                             float scene_radius)
+{
+  compute_split_depths(shadows, camera->near, camera->far);
+
+  // The light looks along its direction from the boundary of the scene, so
+  // the depth range [0, 2 * radius] covers all casters of every cascade
+  vec3 light_position, up = {0.0f, 1.0f, 0.0f};
+  glm_vec3_scale(light_direction, -scene_radius, light_position);
+  glm_vec3_add(scene_center, light_position, light_position);
+  if (fabsf(glm_vec3_dot(light_direction, up)) > 0.99f) {
+    glm_vec3_copy((vec3){0.0f, 0.0f, 1.0f}, up);
+  }
+  mat4 light_view_matrix, inverse_view_matrix, light_from_view;
+  glm_lookat(light_position, scene_center, up, light_view_matrix);
+  glm_mat4_inv(camera->view_matrix, inverse_view_matrix);
+  glm_mat4_mul(light_view_matrix, inverse_view_matrix, light_from_view);
+
+  shadows->dirty_mask = 0;
+  float near          = camera->near;
+  for (uint32_t i = 0; i < shadows->cascade_count; ++i) {
+    const float far = shadows->split_depths[i];
+    vec2 min, max;
+    compute_slice_bounds(camera, light_from_view, near, far, min, max);
+
+    // Snap the bounds to texel increments, otherwise the rasterization of the
+    // casters changes with every sub-texel camera movement
+    const float texel_size = MAX(max[0] - min[0], max[1] - min[1])
+                             / (float)shadows->shadow_map_size;
+    for (uint32_t j = 0; j < 2; ++j) {
+      min[j] = floorf(min[j] / texel_size) * texel_size;
+      max[j] = ceilf(max[j] / texel_size) * texel_size;
+    }
+
+    mat4 projection_matrix, view_proj_matrix;
+    ortho_zero_to_one(min[0], max[0], min[1], max[1], 0.0f,
+                      2.0f * scene_radius, projection_matrix);
+    glm_mat4_mul(projection_matrix, light_view_matrix, view_proj_matrix);
+
+    if (memcmp(view_proj_matrix, shadows->view_proj_matrices[i], sizeof(mat4))
+        != 0) {
+      glm_mat4_copy(view_proj_matrix, shadows->view_proj_matrices[i]);
+      frustum_update(&shadows->frustums[i], view_proj_matrix);
+      shadows->dirty_mask |= 1u << i;
+    }
+    near = far;
+  }
+}
+
+/* cascade checking */
+
+bool cascaded_shadows_is_dirty(cascaded_shadows_t* shadows, uint32_t cascade)
+{
+  return (shadows->dirty_mask & (1u << cascade)) != 0;
+}
+
+void cascaded_shadows_invalidate(cascaded_shadows_t* shadows)
+{
+  // A zero matrix never equals a fitted one
+  memset(shadows->view_proj_matrices, 0, sizeof(shadows->view_proj_matrices));
+}
@@ -0,0 +1,72 @@
+#ifndef CASCADED_SHADOWS_H
+#define CASCADED_SHADOWS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cglm/cglm.h>
+
+#include "frustum.h"
+
+#define CASCADED_SHADOWS_MAX_CASCADES 4u
+
+/* -------------------------------------------------------------------------- *
+ * Cascaded shadow maps
+ *
+ * Splits the camera view range into cascades and fits an orthographic light
+ * projection tightly around each cascade slice. The light projections map the
+ * depth to [0, 1] (WebGPU convention) and their extents are snapped to shadow
+ * map texels, which keeps the shadow edges from shimmering while the camera
+ * moves.
+ *
+ * Each cascade has a frustum for culling the shadow casters rendered into it
+ * and a dirty bit which is set when its light matrix changed in the last
+ * update. Static casters only have to be rendered again into the dirty
+ * cascades, the shadow map layers of the other cascades are still valid.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @brief Perspective camera the cascades are fitted to
+ */
+typedef struct cascaded_shadows_camera_t {
+  mat4 view_matrix;
+  float fov_y;  /* Vertical field of view in radians */
+  float aspect; /* Width / height */
+  float near;   /* Start of the shadowed view range */
+  float far;    /* End of the shadowed view range */
+} cascaded_shadows_camera_t;
+
+typedef struct cascaded_shadows_t {
+  uint32_t cascade_count;
+  /* Split scheme, 0 for uniform and 1 for logarithmic splits */
+  float split_lambda;
+  uint32_t shadow_map_size;
+  /* View space distance of the far end of each cascade */
+  float split_depths[CASCADED_SHADOWS_MAX_CASCADES];
+  mat4 view_proj_matrices[CASCADED_SHADOWS_MAX_CASCADES];
+  frustum_t frustums[CASCADED_SHADOWS_MAX_CASCADES];
+  /* Bit i is set if the matrix of cascade i changed in the last update */
+  uint32_t dirty_mask;
+} cascaded_shadows_t;
+
+/* cascaded shadows initialization, marks all cascades dirty */
+void cascaded_shadows_init(cascaded_shadows_t* shadows, uint32_t cascade_count,
+                           float split_lambda, uint32_t shadow_map_size);
+
+/**
+ * @brief Computes the cascade splits and light matrices.
+ * @param light_direction the direction the light travels in, normalized
+ * @param scene_center the center of a sphere enclosing all shadow casters
+ * @param scene_radius the radius of the sphere enclosing all shadow casters
+ */
+void cascaded_shadows_update(cascaded_shadows_t* shadows,
+                             cascaded_shadows_camera_t* camera,
+                             vec3 light_direction, vec3 scene_center,
+                             float scene_radius);
+
+/* cascade checking */
+bool cascaded_shadows_is_dirty(cascaded_shadows_t* shadows, uint32_t cascade);
+/* Marks all cascades dirty in the next update, e.g. when a caster moved */
+void cascaded_shadows_invalidate(cascaded_shadows_t* shadows);
+
+#endif
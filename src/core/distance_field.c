@@ -0,0 +1,253 @@
+#include "distance_field.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "macro.h"
+
+/* Squared distance of the texels without a seed */
+#define DISTANCE_FIELD_INF 1e20f
+#define DISTANCE_FIELD_DEFAULT_SPREAD 4.0f
+
+#define DISTANCE_FIELD_CACHE_MAGIC 0x444c4644u /* "DFLD" */
+#define DISTANCE_FIELD_CACHE_VERSION 1u
+
+typedef struct distance_field_cache_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint64_t key;
+} distance_field_cache_header_t;
+
+static uint32_t distance_field_get_downsample(const distance_field_desc_t* desc)
+{
+  return MAX(desc->downsample, 1u);
+}
+
+static float distance_field_get_spread(const distance_field_desc_t* desc)
+{
+  return desc->spread > 0.0f ? desc->spread : DISTANCE_FIELD_DEFAULT_SPREAD;
+}
+
+void distance_field_get_size(const distance_field_desc_t* desc,
+                             uint32_t* width, uint32_t* height)
+{
+  const uint32_t downsample = distance_field_get_downsample(desc);
+  *width  = (desc->width + downsample - 1) / downsample;
+  *height = (desc->height + downsample - 1) / downsample;
+}
+
+/**
+ * @brief 1D squared distance transform of a sampled function, the lower
+ * envelope of the parabolas rooted at each sample (Felzenszwalb and
+ * Huttenlocher, "Distance Transforms of Sampled Functions").
+ * @param f the function samples, replaced with the transform
+ * @param n the sample count
+ * @param v scratch, n locations of the parabolas of the envelope
+ * @param z scratch, n + 1 boundaries between the parabolas
+ * @param d scratch, n samples
+ */
+static void distance_field_transform_1d(float* f, uint32_t n, uint32_t* v,
+                                        float* z, float* d)
+{
+  uint32_t k = 0;
+  v[0]       = 0;
+  z[0]       = -DISTANCE_FIELD_INF;
+  z[1]       = DISTANCE_FIELD_INF;
+  for (uint32_t q = 1; q < n; ++q) {
+    const float fq = f[q] + (float)q * (float)q;
+    float s;
+    /* z[0] is below any intersection, k stays >= 0 */
+    for (;;) {
+      const uint32_t r = v[k];
+      s = (fq - (f[r] + (float)r * (float)r)) / (float)(2 * (q - r));
+      if (s > z[k]) {
+        break;
+      }
+      --k;
+    }
+    ++k;
+    v[k]     = q;
+    z[k]     = s;
+    z[k + 1] = DISTANCE_FIELD_INF;
+  }
+
+  k = 0;
+  for (uint32_t q = 0; q < n; ++q) {
+    while (z[k + 1] < (float)q) {
+      ++k;
+    }
+    const float dq = (float)q - (float)v[k];
+    d[q]           = dq * dq + f[v[k]];
+  }
+  memcpy(f, d, n * sizeof(float));
+}
+
+/* 2D squared distance transform, the columns then the rows */
+static void distance_field_transform_2d(float* grid, uint32_t width,
+                                        uint32_t height, float* f, uint32_t* v,
+                                        float* z, float* d)
+{
+  for (uint32_t x = 0; x < width; ++x) {
+    for (uint32_t y = 0; y < height; ++y) {
+      f[y] = grid[y * width + x];
+    }
+    distance_field_transform_1d(f, height, v, z, d);
+    for (uint32_t y = 0; y < height; ++y) {
+      grid[y * width + x] = f[y];
+    }
+  }
+  for (uint32_t y = 0; y < height; ++y) {
+    distance_field_transform_1d(&grid[y * width], width, v, z, d);
+  }
+}
+
+void distance_field_generate(const distance_field_desc_t* desc,
+                             uint8_t* field)
+{
+  const uint32_t width       = desc->width;
+  const uint32_t height      = desc->height;
+  const uint32_t pixel_count = width * height;
+  const uint32_t max_size    = MAX(width, height);
+  if (pixel_count == 0) {
+    return;
+  }
+
+  /* Squared distances to the nearest covered (outer) and to the nearest
+   * uncovered (inner) area. A partially covered pixel seeds both with the
+   * distance of its center to the edge, assuming the edge crosses the pixel
+   * at its coverage. */
+  float* outer = (float*)malloc(2 * pixel_count * sizeof(float));
+  float* inner = outer + pixel_count;
+  for (uint32_t i = 0; i < pixel_count; ++i) {
+    const uint8_t c = desc->coverage[i];
+    if (c == 255) {
+      outer[i] = 0.0f;
+      inner[i] = DISTANCE_FIELD_INF;
+    }
+    else if (c == 0) {
+      outer[i] = DISTANCE_FIELD_INF;
+      inner[i] = 0.0f;
+    }
+    else {
+      const float e = 0.5f - (float)c / 255.0f;
+      outer[i]      = e > 0.0f ? e * e : 0.0f;
+      inner[i]      = e < 0.0f ? e * e : 0.0f;
+    }
+  }
+
+  float* f    = (float*)malloc((3 * max_size + 1) * sizeof(float));
+  float* d    = f + max_size;
+  float* z    = d + max_size;
+  uint32_t* v = (uint32_t*)malloc(max_size * sizeof(uint32_t));
+  distance_field_transform_2d(outer, width, height, f, v, z, d);
+  distance_field_transform_2d(inner, width, height, f, v, z, d);
+  free(v);
+  free(f);
+
+  /* Signed distances in coverage pixels, positive inside */
+  for (uint32_t i = 0; i < pixel_count; ++i) {
+    outer[i] = sqrtf(inner[i]) - sqrtf(outer[i]);
+  }
+
+  /* The field texel is the mean of its block, the distance at its center */
+  const uint32_t downsample = distance_field_get_downsample(desc);
+  const float scale
+    = 0.5f / (distance_field_get_spread(desc) * (float)downsample);
+  uint32_t field_width, field_height;
+  distance_field_get_size(desc, &field_width, &field_height);
+  for (uint32_t fy = 0; fy < field_height; ++fy) {
+    const uint32_t y0 = fy * downsample;
+    const uint32_t y1 = MIN(y0 + downsample, height);
+    for (uint32_t fx = 0; fx < field_width; ++fx) {
+      const uint32_t x0 = fx * downsample;
+      const uint32_t x1 = MIN(x0 + downsample, width);
+      float sum         = 0.0f;
+      for (uint32_t y = y0; y < y1; ++y) {
+        for (uint32_t x = x0; x < x1; ++x) {
+          sum += outer[y * width + x];
+        }
+      }
+      const float distance = sum / (float)((y1 - y0) * (x1 - x0));
+      const float value    = 0.5f + distance * scale;
+      field[fy * field_width + fx]
+        = (uint8_t)(CLAMP(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+  }
+
+  free(outer);
+}
+
+uint64_t distance_field_hash(const distance_field_desc_t* desc)
+{
+  const float params[4] = {
+    (float)desc->width,
+    (float)desc->height,
+    (float)distance_field_get_downsample(desc),
+    distance_field_get_spread(desc),
+  };
+  /* 64-bit FNV-1a */
+  uint64_t hash        = 0xcbf29ce484222325ull;
+  const uint8_t* bytes = (const uint8_t*)params;
+  for (size_t i = 0; i < sizeof(params); ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  const size_t size = (size_t)desc->width * desc->height;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ desc->coverage[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool distance_field_cache_read(const char* filename, uint64_t key,
+                               uint32_t width, uint32_t height, uint8_t* field)
+{
+  FILE* file = fopen(filename, "rb");
+  if (file == NULL) {
+    return false;
+  }
+
+  distance_field_cache_header_t header = {0};
+  const size_t size                    = (size_t)width * height;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1
+               && header.magic == DISTANCE_FIELD_CACHE_MAGIC
+               && header.version == DISTANCE_FIELD_CACHE_VERSION
+               && header.key == key && header.width == width
+               && header.height == height
+               && fread(field, 1, size, file) == size;
+  fclose(file);
+
+  if (!valid) {
+    log_debug("Ignoring outdated distance field cache %s", filename);
+  }
+  return valid;
+}
+
+void distance_field_cache_write(const char* filename, uint64_t key,
+                                uint32_t width, uint32_t height,
+                                const uint8_t* field)
+{
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
+    log_warn("Unable to write distance field cache %s", filename);
+    return;
+  }
+
+  const distance_field_cache_header_t header = {
+    .magic   = DISTANCE_FIELD_CACHE_MAGIC,
+    .version = DISTANCE_FIELD_CACHE_VERSION,
+    .width   = width,
+    .height  = height,
+    .key     = key,
+  };
+  const size_t size = (size_t)width * height;
+  if (fwrite(&header, sizeof(header), 1, file) != 1
+      || fwrite(field, 1, size, file) != size) {
+    log_warn("Unable to write distance field cache %s", filename);
+  }
+  fclose(file);
+}
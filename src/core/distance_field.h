@@ -0,0 +1,63 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Signed distance field of an 8-bit coverage bitmap, e.g. a font atlas.
+ * The field stores the distance of each texel to the nearest edge of the
+ * covered area: 0.5 (128) on the edge, larger values inside, smaller values
+ * outside, and 'spread' field texels away from the edge the values saturate.
+ * Sampled with a bilinear filter and thresholded at 0.5 the edges stay sharp at
+ * any magnification, so one small field replaces the atlases of all scales.
+ *
+ * The distances are exact Euclidean distances (separable squared distance
+ * transform), the partial coverage of anti-aliased edge pixels refines the edge
+ * position below a pixel. With a downsample factor > 1 the coverage is
+ * rasterized at a higher resolution than the field, which preserves corners
+ * and thin features.
+ */
+typedef struct distance_field_desc_t {
+  const uint8_t* coverage; /* width * height bytes, tightly packed */
+  uint32_t width;
+  uint32_t height;
+  uint32_t downsample; /* coverage pixels per field texel, 0 = 1 */
+  float spread;        /* distance range in field texels, 0 = 4 */
+} distance_field_desc_t;
+
+/* Size of the field of a coverage bitmap, the coverage size divided by the
+ * downsample factor (rounded up) */
+void distance_field_get_size(const distance_field_desc_t* desc,
+                             uint32_t* width, uint32_t* height);
+
+/**
+ * @brief Generates the distance field of a coverage bitmap.
+ * @param desc the coverage bitmap and the field parameters
+ * @param field the field, distance_field_get_size() bytes, tightly packed
+ */
+void distance_field_generate(const distance_field_desc_t* desc,
+                             uint8_t* field);
+
+/* Hash of the coverage and the field parameters, the key of cached fields */
+uint64_t distance_field_hash(const distance_field_desc_t* desc);
+
+/**
+ * @brief Reads a field written by distance_field_cache_write().
+ * @param filename the name of the cache file
+ * @param key the hash of the coverage the field was generated from
+ * @param width the expected width of the field
+ * @param height the expected height of the field
+ * @param field the field, width * height bytes
+ * @return true if the file exists and matches the key and size
+ */
+bool distance_field_cache_read(const char* filename, uint64_t key,
+                               uint32_t width, uint32_t height,
+                               uint8_t* field);
+
+/* Writes a field to a cache file, failures are logged and ignored */
+void distance_field_cache_write(const char* filename, uint64_t key,
+                                uint32_t width, uint32_t height,
+                                const uint8_t* field);
+
+#endif /* DISTANCE_FIELD_H */
@@ -1,13 +1,66 @@
 #include "file.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "asset_archive.h"
 #include "log.h"
 #include "macro.h"
 
+/* Mounted asset archive */
+static struct {
+  file_mapping_t mapping;
+  const asset_archive_entry_t* entries;
+  uint32_t entry_count;
+  const char* paths;
+} file_archive = {0};
+
+/* Returns the archive entry of the file, NULL if not archived */
+static const asset_archive_entry_t* file_archive_find(const char* filename)
+{
+  if (file_archive.entries == NULL) {
+    return NULL;
+  }
+
+  const char* path    = asset_archive_normalize_path(filename);
+  const uint64_t hash = asset_archive_hash_path(path);
+  const size_t length = strlen(path);
+
+  // Binary search of the first entry with the hash
+  const asset_archive_entry_t* entries = file_archive.entries;
+  const uint32_t entry_count           = file_archive.entry_count;
+  uint32_t first = 0, last = entry_count;
+  while (first < last) {
+    const uint32_t middle = first + (last - first) / 2;
+    if (entries[middle].path_hash < hash) {
+      first = middle + 1;
+    }
+    else {
+      last = middle;
+    }
+  }
+  for (uint32_t i = first; i < entry_count && entries[i].path_hash == hash;
+       ++i) {
+    const asset_archive_entry_t* entry = &entries[i];
+    if (entry->path_length == length
+        && memcmp(file_archive.paths + entry->path_offset, path, length) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
 int file_exists(const char* filename)
 {
+  if (file_archive_find(filename) != NULL) {
+    return 1;
+  }
+
   /* try to open file to read */
   FILE* file;
   if ((file = fopen(filename, "r"))) {
@@ -36,6 +89,18 @@ void read_file(const char* filename, file_read_result_t* result,
                int is_text_file)
 {
   ASSERT(filename && result);
+  const asset_archive_entry_t* entry = file_archive_find(filename);
+  if (entry != NULL) {
+    result->size = (uint32_t)entry->size;
+    result->data = malloc(result->size + (is_text_file == 0 ? 0 : 1));
+    memcpy(result->data, file_archive.mapping.data + entry->offset,
+           result->size);
+    if (is_text_file != 0) {
+      result->data[result->size] = 0;
+    }
+    return;
+  }
+
   FILE* file = fopen(filename, "rb");
   if (file == NULL) {
     log_error("Unable to open file '%s'\n", filename);
@@ -52,3 +117,132 @@ void read_file(const char* filename, file_read_result_t* result,
     result->data[result->size] = 0;
   }
 }
+
+int file_map(const char* filename, file_mapping_t* mapping)
+{
+  ASSERT(filename && mapping);
+  *mapping = (file_mapping_t){0};
+
+  const asset_archive_entry_t* entry = file_archive_find(filename);
+  if (entry != NULL) {
+    *mapping = (file_mapping_t){
+      .size     = entry->size,
+      .data     = entry->size > 0 ? file_archive.mapping.data + entry->offset :
+                                    NULL,
+      .archived = true,
+    };
+    return 0;
+  }
+
+  const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error = errno;
+    close(fd);
+    return error;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  const int error = data == MAP_FAILED ? errno : 0;
+  // The mapping stays valid after closing the file descriptor
+  close(fd);
+  if (error != 0) {
+    return error;
+  }
+
+  mapping->size = (size_t)st.st_size;
+  mapping->data = (const uint8_t*)data;
+  return 0;
+}
+
+void file_unmap(file_mapping_t* mapping)
+{
+  if (mapping->data != NULL && !mapping->archived) {
+    munmap((void*)mapping->data, mapping->size);
+  }
+  *mapping = (file_mapping_t){0};
+}
+
+/* Checks that the index and the payloads lie within the archive */
+static bool file_archive_validate(const file_mapping_t* mapping)
+{
+  const asset_archive_header_t* header
+    = (const asset_archive_header_t*)mapping->data;
+  if (mapping->size < sizeof(*header) || header->magic != ASSET_ARCHIVE_MAGIC
+      || header->version != ASSET_ARCHIVE_VERSION) {
+    return false;
+  }
+
+  const uint64_t index_size
+    = (uint64_t)header->entry_count * sizeof(asset_archive_entry_t);
+  if (sizeof(*header) + index_size > mapping->size
+      || header->path_table_offset > mapping->size
+      || header->path_table_size > mapping->size - header->path_table_offset) {
+    return false;
+  }
+
+  const asset_archive_entry_t* entries
+    = (const asset_archive_entry_t*)(header + 1);
+  for (uint32_t i = 0; i < header->entry_count; ++i) {
+    const asset_archive_entry_t* entry = &entries[i];
+    // Compressed payloads are not supported by this version of the reader
+    if (entry->compression != AssetArchiveCompression_None
+        || entry->stored_size != entry->size || entry->size > UINT32_MAX
+        || entry->offset > mapping->size
+        || entry->size > mapping->size - entry->offset
+        || (uint64_t)entry->path_offset + entry->path_length
+             > header->path_table_size
+        || (i > 0 && entries[i - 1].path_hash > entry->path_hash)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool file_is_archived(const char* filename)
+{
+  return file_archive_find(filename) != NULL;
+}
+
+int file_archive_mount(const char* filename)
+{
+  file_archive_unmount();
+
+  file_mapping_t mapping = {0};
+  const int error        = file_map(filename, &mapping);
+  if (error != 0) {
+    return error;
+  }
+  if (mapping.data == NULL || !file_archive_validate(&mapping)) {
+    log_error("Invalid asset archive '%s'", filename);
+    file_unmap(&mapping);
+    return EINVAL;
+  }
+
+  const asset_archive_header_t* header
+    = (const asset_archive_header_t*)mapping.data;
+  file_archive.mapping     = mapping;
+  file_archive.entries     = (const asset_archive_entry_t*)(header + 1);
+  file_archive.entry_count = header->entry_count;
+  file_archive.paths
+    = (const char*)mapping.data + header->path_table_offset;
+  log_info("Mounted asset archive '%s' with %u files", filename,
+           header->entry_count);
+  return 0;
+}
+
+void file_archive_unmount(void)
+{
+  file_unmap(&file_archive.mapping);
+  file_archive.entries     = NULL;
+  file_archive.entry_count = 0;
+  file_archive.paths       = NULL;
+}
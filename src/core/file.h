@@ -1,6 +1,8 @@
 #ifndef FILE_H
 #define FILE_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct file_read_result_t {
@@ -9,7 +11,8 @@ typedef struct file_read_result_t {
 } file_read_result_t;
 
 /**
- * @brief Check if a file exist using fopen() function.
+ * @brief Check if a file exist in the mounted asset archive or using fopen()
+ * function.
  * @param filename the name of the file
  * @return 1 if the file exist otherwise return 0
  */
@@ -32,11 +35,52 @@ int filename_has_extension(const char* filename, const char* extension);
 
 /**
  * @brief Reads the file with the specified filename and writes data and size to
- * 'result'.
+ * 'result'. Files in the mounted asset archive are copied from the archive.
  * @param filename the name of the file
  * @param result the file read result
  */
 void read_file(const char* filename, file_read_result_t* result,
                int is_text_file);
 
+/* Read-only memory mapping of a file */
+typedef struct file_mapping_t {
+  size_t size;
+  const uint8_t* data; /* NULL for empty files */
+  bool archived;       /* points into the mounted asset archive */
+} file_mapping_t;
+
+/**
+ * @brief Maps the file with the specified filename into memory. The pages are
+ * read on first access instead of copying the whole file upfront. Files in the
+ * mounted asset archive resolve to their payload in the archive mapping.
+ * @param filename the name of the file
+ * @param mapping the file mapping, zeroed on failure
+ * @return 0 on success, otherwise the errno value of the failed call
+ */
+int file_map(const char* filename, file_mapping_t* mapping);
+
+/**
+ * @brief Unmaps a file mapped with file_map() and resets 'mapping'.
+ * @param mapping the file mapping
+ */
+void file_unmap(file_mapping_t* mapping);
+
+/* Returns true if the file is in the mounted asset archive */
+bool file_is_archived(const char* filename);
+
+/**
+ * @brief Mounts a packed asset archive built with wgpu_asset_packer. Paths are
+ * looked up in the archive first and fall back to the file system, only one
+ * archive can be mounted at a time.
+ * @param filename the name of the archive
+ * @return 0 on success, otherwise the errno value of the failed call or EINVAL
+ * if the archive is invalid
+ */
+int file_archive_mount(const char* filename);
+
+/**
+ * @brief Unmounts the asset archive, mappings into the archive become invalid.
+ */
+void file_archive_unmount(void);
+
 #endif
@@ -0,0 +1,71 @@
+#include "frame_limiter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "platform.h"
+
+/* Duration of a sleep chunk */
+#define FRAME_LIMITER_SLEEP_NS 1000000ull
+/* Initial sleep duration estimate, pessimistic until chunks are measured */
+#define FRAME_LIMITER_INITIAL_SLEEP_NS 2000000.0
+/* The estimate follows the last samples, e.g. after a change of the timer
+ * resolution or the system load */
+#define FRAME_LIMITER_MAX_SAMPLES 64u
+
+void frame_limiter_init(frame_limiter_t* limiter, float max_fps)
+{
+  memset(limiter, 0, sizeof(*limiter));
+  limiter->frame_time_ns
+    = max_fps > 0.0f ? (uint64_t)(1000000000.0 / (double)max_fps) : 0;
+  limiter->sleep_mean_ns = FRAME_LIMITER_INITIAL_SLEEP_NS;
+}
+
+/* Exponentially weighted mean and variance of the sleep durations */
+static void frame_limiter_add_sleep(frame_limiter_t* limiter,
+                                    double sleep_ns)
+{
+  if (limiter->sleep_samples < FRAME_LIMITER_MAX_SAMPLES) {
+    ++limiter->sleep_samples;
+  }
+  const double alpha = 1.0 / (double)limiter->sleep_samples;
+  const double delta = sleep_ns - limiter->sleep_mean_ns;
+  limiter->sleep_mean_ns += alpha * delta;
+  limiter->sleep_variance_ns
+    = (1.0 - alpha) * (limiter->sleep_variance_ns + alpha * delta * delta);
+}
+
+void frame_limiter_wait(frame_limiter_t* limiter)
+{
+  if (limiter->frame_time_ns == 0) {
+    return;
+  }
+
+  uint64_t now = platform_get_time_ns();
+  const uint64_t deadline = limiter->next_frame_ns;
+  if (deadline == 0 || now >= deadline + limiter->frame_time_ns) {
+    limiter->next_frame_ns = now + limiter->frame_time_ns;
+    limiter->last_error_ms = 0.0f;
+    return;
+  }
+
+  /* Sleep while a chunk surely ends before the deadline */
+  while (now < deadline) {
+    const double estimate_ns
+      = limiter->sleep_mean_ns + sqrt(limiter->sleep_variance_ns);
+    if ((double)(deadline - now) <= estimate_ns) {
+      break;
+    }
+    platform_sleep_until_ns(now + FRAME_LIMITER_SLEEP_NS);
+    const uint64_t woken = platform_get_time_ns();
+    frame_limiter_add_sleep(limiter, (double)(woken - now));
+    now = woken;
+  }
+  /* Spin the rest */
+  while (now < deadline) {
+    now = platform_get_time_ns();
+  }
+
+  limiter->last_error_ms = (float)((double)(now - deadline) / 1000000.0);
+  limiter->next_frame_ns = deadline + limiter->frame_time_ns;
+}
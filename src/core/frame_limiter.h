@@ -0,0 +1,33 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Target frame rate limiter: waits until the start time of the next
+ * frame with coarse sleeps followed by a short spin. The sleeps are 1 ms
+ * chunks as long as the remaining time exceeds the learned sleep duration
+ * (mean + standard deviation of the measured chunks), the rest is spun, which
+ * keeps the frame start within a fraction of a millisecond while the CPU is
+ * idle most of the wait.
+ */
+typedef struct frame_limiter_t {
+  uint64_t frame_time_ns; /* 0 = unlimited */
+  uint64_t next_frame_ns; /* start time of the next frame */
+  /* Measured duration of the sleep chunks (in nanoseconds) */
+  double sleep_mean_ns;
+  double sleep_variance_ns;
+  uint32_t sleep_samples;
+  /* Start of the last frame minus its target start (in milliseconds) */
+  float last_error_ms;
+} frame_limiter_t;
+
+/* Target frame rate, frames per second <= 0 disables the limiter */
+void frame_limiter_init(frame_limiter_t* limiter, float max_fps);
+
+/* Waits until the next frame is due, call once before every frame. A frame
+ * later than a whole frame time restarts the pacing instead of rendering the
+ * missed frames back to back. */
+void frame_limiter_wait(frame_limiter_t* limiter);
+
+#endif /* FRAME_LIMITER_H */
@@ -2,6 +2,17 @@
 
 #include <string.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64)                                      \
+  || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SIMD_WIDTH 4
+#else
+#define FRUSTUM_SIMD_WIDTH 1
+#endif
+
 #include "macro.h"
 
 /* frustum creating/releasing */
@@ -75,3 +86,148 @@ bool frustum_check_sphere(frustum_t* frustum, vec3 pos, float radius)
   }
   return true;
 }
+
+bool frustum_check_box(frustum_t* frustum, vec3 min, vec3 max)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(frustum->planes); ++i) {
+    /* The box corner furthest along the plane normal */
+    const float x = frustum->planes[i][0] >= 0.0f ? max[0] : min[0];
+    const float y = frustum->planes[i][1] >= 0.0f ? max[1] : min[1];
+    const float z = frustum->planes[i][2] >= 0.0f ? max[2] : min[2];
+    if ((frustum->planes[i][0] * x) + (frustum->planes[i][1] * y)
+          + (frustum->planes[i][2] * z) + frustum->planes[i][3]
+        < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* frustum batch checking */
+
+#if FRUSTUM_SIMD_WIDTH == 8
+typedef __m256 frustum_simd_t;
+#define frustum_simd_set1 _mm256_set1_ps
+#define frustum_simd_load _mm256_loadu_ps
+#define frustum_simd_add _mm256_add_ps
+#define frustum_simd_sub _mm256_sub_ps
+#define frustum_simd_mul _mm256_mul_ps
+#define frustum_simd_and _mm256_and_ps
+#define frustum_simd_cmpgt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define frustum_simd_movemask _mm256_movemask_ps
+#elif FRUSTUM_SIMD_WIDTH == 4
+typedef __m128 frustum_simd_t;
+#define frustum_simd_set1 _mm_set1_ps
+#define frustum_simd_load _mm_loadu_ps
+#define frustum_simd_add _mm_add_ps
+#define frustum_simd_sub _mm_sub_ps
+#define frustum_simd_mul _mm_mul_ps
+#define frustum_simd_and _mm_and_ps
+#define frustum_simd_cmpgt _mm_cmpgt_ps
+#define frustum_simd_movemask _mm_movemask_ps
+#endif
+
+#if FRUSTUM_SIMD_WIDTH > 1
+/* Frustum planes broadcast into SIMD registers */
+typedef struct frustum_simd_planes_t {
+  frustum_simd_t x[6];
+  frustum_simd_t y[6];
+  frustum_simd_t z[6];
+  frustum_simd_t w[6];
+} frustum_simd_planes_t;
+
+static void frustum_simd_planes_load(frustum_t* frustum,
+                                     frustum_simd_planes_t* planes)
+{
+  for (uint32_t i = 0; i < 6; ++i) {
+    planes->x[i] = frustum_simd_set1(frustum->planes[i][0]);
+    planes->y[i] = frustum_simd_set1(frustum->planes[i][1]);
+    planes->z[i] = frustum_simd_set1(frustum->planes[i][2]);
+    planes->w[i] = frustum_simd_set1(frustum->planes[i][3]);
+  }
+}
+
+/* Visibility bits of the FRUSTUM_SIMD_WIDTH spheres starting at first */
+static inline uint32_t
+frustum_simd_check_spheres(const frustum_simd_planes_t* planes,
+                           const frustum_spheres_t* spheres, uint32_t first)
+{
+  const frustum_simd_t x = frustum_simd_load(spheres->x + first);
+  const frustum_simd_t y = frustum_simd_load(spheres->y + first);
+  const frustum_simd_t z = frustum_simd_load(spheres->z + first);
+  const frustum_simd_t neg_radius = frustum_simd_sub(
+    frustum_simd_set1(0.0f), frustum_simd_load(spheres->radius + first));
+  frustum_simd_t visible = frustum_simd_set1(0.0f);
+  for (uint32_t i = 0; i < 6; ++i) {
+    const frustum_simd_t distance = frustum_simd_add(
+      frustum_simd_add(frustum_simd_mul(planes->x[i], x),
+                       frustum_simd_mul(planes->y[i], y)),
+      frustum_simd_add(frustum_simd_mul(planes->z[i], z), planes->w[i]));
+    const frustum_simd_t inside = frustum_simd_cmpgt(distance, neg_radius);
+    visible = (i == 0) ? inside : frustum_simd_and(visible, inside);
+  }
+  return (uint32_t)frustum_simd_movemask(visible);
+}
+#endif
+
+static bool frustum_check_spheres_at(frustum_t* frustum,
+                                     const frustum_spheres_t* spheres,
+                                     uint32_t index)
+{
+  vec3 pos = {spheres->x[index], spheres->y[index], spheres->z[index]};
+  return frustum_check_sphere(frustum, pos, spheres->radius[index]);
+}
+
+void frustum_check_spheres(frustum_t* frustum, const frustum_spheres_t* spheres,
+                           uint32_t* visibility)
+{
+  memset(visibility, 0, ((spheres->count + 31) / 32) * sizeof(uint32_t));
+
+  uint32_t i = 0;
+#if FRUSTUM_SIMD_WIDTH > 1
+  /* 32 is a multiple of the SIMD width, a block never spans two words */
+  frustum_simd_planes_t planes;
+  frustum_simd_planes_load(frustum, &planes);
+  for (; i + FRUSTUM_SIMD_WIDTH <= spheres->count; i += FRUSTUM_SIMD_WIDTH) {
+    visibility[i / 32] |= frustum_simd_check_spheres(&planes, spheres, i)
+                          << (i % 32);
+  }
+#endif
+  for (; i < spheres->count; ++i) {
+    if (frustum_check_spheres_at(frustum, spheres, i)) {
+      visibility[i / 32] |= 1u << (i % 32);
+    }
+  }
+}
+
+uint32_t frustum_cull_spheres(frustum_t* frustum,
+                              const frustum_spheres_t* spheres,
+                              uint32_t* visible_indices)
+{
+  uint32_t visible_count = 0;
+
+  uint32_t i = 0;
+#if FRUSTUM_SIMD_WIDTH > 1
+  frustum_simd_planes_t planes;
+  frustum_simd_planes_load(frustum, &planes);
+  for (; i + FRUSTUM_SIMD_WIDTH <= spheres->count; i += FRUSTUM_SIMD_WIDTH) {
+    uint32_t mask = frustum_simd_check_spheres(&planes, spheres, i);
+    while (mask != 0) {
+      /* Lowest set bit first, keeps the indices sorted */
+      uint32_t bit = 0;
+      while (!(mask & (1u << bit))) {
+        ++bit;
+      }
+      visible_indices[visible_count++] = i + bit;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; i < spheres->count; ++i) {
+    if (frustum_check_spheres_at(frustum, spheres, i)) {
+      visible_indices[visible_count++] = i;
+    }
+  }
+
+  return visible_count;
+}
@@ -28,5 +28,29 @@ void frustum_update(frustum_t* frustum, mat4 matrix);
 
 /* frustum checking */
 bool frustum_check_sphere(frustum_t* frustum, vec3 pos, float radius);
+bool frustum_check_box(frustum_t* frustum, vec3 min, vec3 max);
+
+/**
+ * @brief Spheres in structure of arrays layout for batch frustum checking
+ */
+typedef struct frustum_spheres_t {
+  const float* x;
+  const float* y;
+  const float* z;
+  const float* radius;
+  uint32_t count;
+} frustum_spheres_t;
+
+/* frustum batch checking, 4 (SSE) or 8 (AVX) spheres per iteration */
+
+/* Sets bit i % 32 of visibility[i / 32] if sphere i is visible, the bitmask
+ * has (count + 31) / 32 words */
+void frustum_check_spheres(frustum_t* frustum, const frustum_spheres_t* spheres,
+                           uint32_t* visibility);
+/* Writes the indices of the visible spheres, returns the number of visible
+ * spheres */
+uint32_t frustum_cull_spheres(frustum_t* frustum,
+                              const frustum_spheres_t* spheres,
+                              uint32_t* visible_indices);
 
 #endif
@@ -22,21 +22,76 @@
 
 #include "log.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
 #define MAX_CALLBACKS 32
 
+/* Records per thread ring, power of two */
+#define LOG_RING_CAPACITY 256
+#define LOG_RECORD_TEXT_SIZE 1024
+/* Sleep of the writer thread when all rings are empty */
+#define LOG_WRITER_INTERVAL_MS 2
+/* Rate limited call sites per thread */
+#define LOG_RATE_LIMIT_SITES 64
+#define LOG_RATE_LIMIT_PROBES 4
+
 typedef struct {
   log_LogFn fn;
   void *udata;
   int level;
 } Callback;
 
+typedef struct {
+  uint64_t sequence;
+  time_t time;
+  const char *file;
+  int line;
+  int level;
+  char text[LOG_RECORD_TEXT_SIZE];
+} Record;
+
+/* Single producer (the owning thread), single consumer (the writer thread) */
+typedef struct Ring {
+  Record records[LOG_RING_CAPACITY];
+  uint32_t head; /* atomic, advanced by the writer thread */
+  uint32_t tail; /* atomic, advanced by the owning thread */
+  uint32_t dropped; /* atomic */
+  struct Ring *next;
+} Ring;
+
+typedef struct {
+  const char *file;
+  int line;
+  uint64_t window_start_ms;
+  uint32_t count;
+  uint32_t suppressed;
+} RateLimitSite;
+
 static struct {
   void *udata;
   log_LockFn lock;
   int level;
   bool quiet;
   Callback callbacks[MAX_CALLBACKS];
-} L;
+  uint32_t rate_limit;
+  /* Asynchronous logging */
+  bool async; /* atomic */
+  bool writer_stop; /* atomic */
+  bool writer_running;
+  bool atexit_registered;
+  pthread_t writer;
+  uint64_t sequence; /* atomic */
+  /* Rings of all threads which logged, rings are never freed */
+  Ring *rings; /* atomic */
+} L = {
+  .rate_limit = LOG_RATE_LIMIT_DEFAULT,
+};
+
+static __thread Ring *thread_ring;
+static __thread RateLimitSite thread_sites[LOG_RATE_LIMIT_SITES];
+
 
 
 static const char *level_strings[] = {
@@ -137,19 +192,20 @@ static void init_event(log_Event *ev, void *udata) {
 }
 
 
-void log_log(int level, const char *file, int line, const char *fmt, ...) {
+/* Writes a message to stderr and the callbacks, the caller holds the lock */
+static void dispatch(int level, const char *file, int line, struct tm *time,
+                     const char *fmt, va_list ap) {
   log_Event ev = {
     .fmt   = fmt,
     .file  = file,
+    .time  = time,
     .line  = line,
     .level = level,
   };
 
-  lock();
-
   if (!L.quiet && level >= L.level) {
     init_event(&ev, stderr);
-    va_start(ev.ap, fmt);
+    va_copy(ev.ap, ap);
     stdout_callback(&ev);
     va_end(ev.ap);
   }
@@ -158,11 +214,284 @@ void log_log(int level, const char *file, int line, const char *fmt, ...) {
     Callback *cb = &L.callbacks[i];
     if (level >= cb->level) {
       init_event(&ev, cb->udata);
-      va_start(ev.ap, fmt);
+      va_copy(ev.ap, ap);
       cb->fn(&ev);
       va_end(ev.ap);
     }
   }
+}
+
+
+static void dispatch_format(int level, const char *file, int line,
+                            struct tm *time, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  dispatch(level, file, line, time, fmt, ap);
+  va_end(ap);
+}
+
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+
+/*
+ * Returns false if the message exceeds the rate limit of its call site.
+ * Sets suppressed to the number of messages suppressed in the last window of
+ * the site when a new window starts.
+ */
+static bool rate_limit_pass(int level, const char *file, int line,
+                            uint32_t *suppressed) {
+  *suppressed = 0;
+  const uint32_t limit = L.rate_limit;
+  if (limit == 0 || level >= LOG_FATAL) {
+    return true;
+  }
+
+  const uintptr_t hash = ((uintptr_t)file >> 3) * 31u + (uintptr_t)line;
+  RateLimitSite *site = NULL;
+  for (uint32_t i = 0; i < LOG_RATE_LIMIT_PROBES; i++) {
+    RateLimitSite *s = &thread_sites[(hash + i) % LOG_RATE_LIMIT_SITES];
+    if (s->file == NULL || (s->file == file && s->line == line)) {
+      site = s;
+      break;
+    }
+  }
+  if (site == NULL) {
+    /* Table full around this slot, the site is not rate limited */
+    return true;
+  }
+
+  const uint64_t now = now_ms();
+  if (site->file == NULL || now - site->window_start_ms >= 1000u) {
+    *suppressed           = site->suppressed;
+    site->file            = file;
+    site->line            = line;
+    site->window_start_ms = now;
+    site->count           = 0;
+    site->suppressed      = 0;
+  }
+  if (site->count >= limit) {
+    site->suppressed++;
+    return false;
+  }
+  site->count++;
+  return true;
+}
+
+
+/* Asynchronous logging */
+
+static Ring *get_thread_ring(void) {
+  if (thread_ring == NULL) {
+    Ring *ring = calloc(1, sizeof(Ring));
+    if (ring == NULL) {
+      return NULL;
+    }
+    ring->next = __atomic_load_n(&L.rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&L.rings, &ring->next, ring, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    thread_ring = ring;
+  }
+  return thread_ring;
+}
+
+
+static void enqueue(int level, const char *file, int line, const char *fmt,
+                    va_list ap) {
+  Ring *ring = get_thread_ring();
+  if (ring == NULL) {
+    return;
+  }
+
+  const uint32_t tail = ring->tail;
+  const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  if (tail - head == LOG_RING_CAPACITY) {
+    __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  Record *record = &ring->records[tail & (LOG_RING_CAPACITY - 1)];
+  record->time  = time(NULL);
+  record->file  = file;
+  record->line  = line;
+  record->level = level;
+  vsnprintf(record->text, sizeof(record->text), fmt, ap);
+  record->sequence = __atomic_fetch_add(&L.sequence, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+static void enqueue_format(int level, const char *file, int line,
+                           const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  enqueue(level, file, line, fmt, ap);
+  va_end(ap);
+}
+
+
+/* Writes the queued records of all rings in logging order */
+static uint32_t drain(void) {
+  uint32_t written = 0;
+
+  Ring *rings = __atomic_load_n(&L.rings, __ATOMIC_ACQUIRE);
+  for (Ring *ring = rings; ring; ring = ring->next) {
+    const uint32_t dropped
+      = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+      lock();
+      dispatch_format(LOG_WARN, __FILE__, __LINE__, NULL,
+                      "%u log records dropped, the log ring was full\n",
+                      dropped);
+      unlock();
+    }
+  }
+
+  while (true) {
+    /* Oldest record at the heads of the rings */
+    Ring *next = NULL;
+    for (Ring *ring = rings; ring; ring = ring->next) {
+      const uint32_t head = ring->head;
+      if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        continue;
+      }
+      const Record *record = &ring->records[head & (LOG_RING_CAPACITY - 1)];
+      if (next == NULL
+          || record->sequence
+               < next->records[next->head & (LOG_RING_CAPACITY - 1)].sequence) {
+        next = ring;
+      }
+    }
+    if (next == NULL) {
+      break;
+    }
+
+    const Record *record = &next->records[next->head & (LOG_RING_CAPACITY - 1)];
+    struct tm time;
+    localtime_r(&record->time, &time);
+    lock();
+    dispatch_format(record->level, record->file, record->line, &time, "%s",
+                    record->text);
+    unlock();
+    __atomic_store_n(&next->head, next->head + 1, __ATOMIC_RELEASE);
+    written++;
+  }
+
+  return written;
+}
+
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  const struct timespec interval = {
+    .tv_nsec = LOG_WRITER_INTERVAL_MS * 1000000L,
+  };
+  while (!__atomic_load_n(&L.writer_stop, __ATOMIC_ACQUIRE)) {
+    if (drain() == 0) {
+      nanosleep(&interval, NULL);
+    }
+  }
+  drain();
+  return NULL;
+}
+
+
+static bool rings_empty(void) {
+  Ring *rings = __atomic_load_n(&L.rings, __ATOMIC_ACQUIRE);
+  for (Ring *ring = rings; ring; ring = ring->next) {
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+        != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static void log_shutdown(void) {
+  log_set_async(false);
+}
+
+
+void log_set_async(bool enable) {
+  if (enable == L.writer_running) {
+    return;
+  }
+
+  if (enable) {
+    L.writer_stop = false;
+    if (pthread_create(&L.writer, NULL, writer_main, NULL) != 0) {
+      return;
+    }
+    L.writer_running = true;
+    __atomic_store_n(&L.async, true, __ATOMIC_RELEASE);
+    /* Write the queued records of a process exiting with async logging */
+    if (!L.atexit_registered) {
+      L.atexit_registered = (atexit(log_shutdown) == 0);
+    }
+  }
+  else {
+    __atomic_store_n(&L.async, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&L.writer_stop, true, __ATOMIC_RELEASE);
+    pthread_join(L.writer, NULL);
+    L.writer_running = false;
+  }
+}
+
+
+void log_flush(void) {
+  if (!__atomic_load_n(&L.async, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  const struct timespec interval = {
+    .tv_nsec = LOG_WRITER_INTERVAL_MS * 1000000L,
+  };
+  while (!rings_empty()) {
+    nanosleep(&interval, NULL);
+  }
+}
+
+
+void log_set_rate_limit(uint32_t max_per_second) {
+  L.rate_limit = max_per_second;
+}
+
+
+void log_log(int level, const char *file, int line, const char *fmt, ...) {
+  uint32_t suppressed = 0;
+  if (!rate_limit_pass(level, file, line, &suppressed)) {
+    return;
+  }
+
+  va_list ap;
+  if (__atomic_load_n(&L.async, __ATOMIC_ACQUIRE)) {
+    if (suppressed > 0) {
+      enqueue_format(level, file, line,
+                     "%u similar messages suppressed\n", suppressed);
+    }
+    va_start(ap, fmt);
+    enqueue(level, file, line, fmt, ap);
+    va_end(ap);
+    if (level >= LOG_FATAL) {
+      log_flush();
+    }
+    return;
+  }
+
+  lock();
+
+  if (suppressed > 0) {
+    dispatch_format(level, file, line, NULL,
+                    "%u similar messages suppressed\n", suppressed);
+  }
+  va_start(ap, fmt);
+  dispatch(level, file, line, NULL, fmt, ap);
+  va_end(ap);
 
   unlock();
 }
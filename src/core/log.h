@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
 #define LOG_VERSION "0.1.0"
@@ -45,6 +46,25 @@ void log_set_quiet(bool enable);
 int log_add_callback(log_LogFn fn, void *udata, int level);
 int log_add_fp(FILE *fp, int level);
 
+/*
+ * Asynchronous logging: log_log() formats the message into a ring buffer of
+ * the calling thread and returns, a background thread writes the records in
+ * order. Full rings drop records instead of blocking, the writer reports the
+ * number of dropped records. LOG_FATAL records are written before log_log()
+ * returns. Meant to be switched at startup and shutdown, records logged by
+ * other threads while switching off may be lost.
+ */
+void log_set_async(bool enable);
+/* Blocks until every record logged so far is written */
+void log_flush(void);
+/*
+ * Max messages per second and call site (file and line) of a thread, the
+ * suppressed messages are counted and reported once the next second starts.
+ * 0 disables the rate limiting, default: LOG_RATE_LIMIT_DEFAULT.
+ */
+#define LOG_RATE_LIMIT_DEFAULT 20
+void log_set_rate_limit(uint32_t max_per_second);
+
 void log_log(int level, const char *file, int line, const char *fmt, ...);
 
 #endif
@@ -5,10 +5,30 @@
 
 #include "macro.h"
 
+/* xorshift32 state, never 0 */
+static uint32_t random_state = 0x9e3779b9u;
+
+void random_seed(uint32_t seed)
+{
+  random_state = seed != 0 ? seed : 0x9e3779b9u;
+}
+
+uint32_t random_uint32(void)
+{
+  uint32_t x = random_state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  random_state = x;
+  return x;
+}
+
 float random_float_min_max(float min, float max)
 {
   /* [min, max] */
-  return ((max - min) * ((float)rand() / (float)RAND_MAX)) + min;
+  return ((max - min) * ((float)random_uint32() / (float)UINT32_MAX)) + min;
 }
 
 float random_float()
@@ -31,3 +51,32 @@ float clamp_float(float d, float min, float max)
   const float t = d < min ? min : d;
   return t > max ? max : t;
 }
+
+/* Batch transforms */
+
+void mat4_mul_batch(mat4 m, mat4* src, mat4* dst, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    glm_mat4_mul(m, src[i], dst[i]);
+  }
+}
+
+void mat4_compose_trs_batch(vec3* translations, versor* rotations,
+                            vec3* scales, mat4* dst, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    /* Scaled rotation columns, the translation in the last column */
+    if (rotations != NULL) {
+      glm_quat_mat4(rotations[i], dst[i]);
+    }
+    else {
+      glm_mat4_identity(dst[i]);
+    }
+    if (scales != NULL) {
+      glm_vec4_scale(dst[i][0], scales[i][0], dst[i][0]);
+      glm_vec4_scale(dst[i][1], scales[i][1], dst[i][1]);
+      glm_vec4_scale(dst[i][2], scales[i][2], dst[i][2]);
+    }
+    glm_vec4(translations[i], 1.0f, dst[i][3]);
+  }
+}
@@ -1,6 +1,23 @@
 #ifndef MATH_H
 #define MATH_H
 
+#include <stdint.h>
+
+#include <cglm/cglm.h>
+
+/**
+ * @brief Seeds the random number generator of random_float() and
+ * random_uint32(), the same seed generates the same sequence on every run.
+ * @param seed seed, 0 selects the default seed
+ */
+void random_seed(uint32_t seed);
+
+/**
+ * @brief Generates a random 32-bit unsigned integer (xorshift32).
+ * @return random number in range [1, UINT32_MAX]
+ */
+uint32_t random_uint32(void);
+
 /**
  * @brief Generates a random float number in range [min, max].
  * @param min minimum number
@@ -32,4 +49,26 @@ int approx_eq_fabs(float v0, float v1);
  */
 float clamp_float(float d, float min, float max);
 
+/* -------------------------------------------------------------------------- *
+ * Batch transforms
+ *
+ * Transform the matrices of many instances in one call. The matrices are
+ * processed with the cglm functions, which use the SSE / AVX code paths on x86
+ * and NEON on ARM when the compiler targets them. dst may be the same array
+ * as src.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @brief Multiplies count matrices with a matrix, dst[i] = m * src[i].
+ */
+void mat4_mul_batch(mat4 m, mat4* src, mat4* dst, uint32_t count);
+
+/**
+ * @brief Composes count model matrices translation * rotation * scale.
+ * @param rotations unit quaternions, NULL = no rotation
+ * @param scales NULL = unit scale
+ */
+void mat4_compose_trs_batch(vec3* translations, versor* rotations,
+                            vec3* scales, mat4* dst, uint32_t count);
+
 #endif /* MATH_H */
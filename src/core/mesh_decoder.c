@@ -0,0 +1,489 @@
+#include "mesh_decoder.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Bitstream headers, the low nibble holds the version */
+#define MESH_DECODER_VERTEX_HEADER 0xa0u
+#define MESH_DECODER_INDEX_HEADER 0xe0u
+#define MESH_DECODER_SEQUENCE_HEADER 0xd0u
+
+/* Vertex codec limits */
+#define MESH_DECODER_VERTEX_BLOCK_SIZE_BYTES 8192u
+#define MESH_DECODER_VERTEX_BLOCK_MAX_SIZE 256u
+#define MESH_DECODER_BYTE_GROUP_SIZE 16u
+#define MESH_DECODER_BYTE_GROUP_DECODE_LIMIT 24u
+#define MESH_DECODER_TAIL_MAX_SIZE 32u
+
+/* -------------------------------------------------------------------------- *
+ * Vertex codec
+ * -------------------------------------------------------------------------- */
+
+static size_t vertex_block_size(size_t vertex_size)
+{
+  /* The block fits the scratch buffer and is aligned to the byte groups */
+  size_t result = MESH_DECODER_VERTEX_BLOCK_SIZE_BYTES / vertex_size;
+  result &= ~(size_t)(MESH_DECODER_BYTE_GROUP_SIZE - 1);
+  return result < MESH_DECODER_VERTEX_BLOCK_MAX_SIZE ?
+           result :
+           MESH_DECODER_VERTEX_BLOCK_MAX_SIZE;
+}
+
+static uint8_t unzigzag8(uint8_t v)
+{
+  return (uint8_t)(-(v & 1) ^ (v >> 1));
+}
+
+/* Decodes 16 values of 0, 2, 4 or 8 bits, the 2 and 4 bit values with all
+ * bits set are followed by a full byte */
+static const uint8_t* decode_bytes_group(const uint8_t* data, uint8_t* buffer,
+                                         int bitslog2)
+{
+  if (bitslog2 == 0) {
+    memset(buffer, 0, MESH_DECODER_BYTE_GROUP_SIZE);
+    return data;
+  }
+  if (bitslog2 == 3) {
+    memcpy(buffer, data, MESH_DECODER_BYTE_GROUP_SIZE);
+    return data + MESH_DECODER_BYTE_GROUP_SIZE;
+  }
+
+  const uint32_t bits       = bitslog2 == 1 ? 2u : 4u;
+  const uint32_t escape     = (1u << bits) - 1u;
+  const uint32_t byte_count = MESH_DECODER_BYTE_GROUP_SIZE * bits / 8;
+  const uint8_t* data_var   = data + byte_count;
+  for (uint32_t i = 0; i < byte_count; ++i) {
+    uint8_t byte = data[i];
+    for (uint32_t k = 0; k < 8 / bits; ++k) {
+      const uint8_t enc = (uint8_t)(byte >> (8 - bits));
+      byte              = (uint8_t)(byte << bits);
+      if (enc == escape) {
+        *buffer++ = *data_var++;
+      }
+      else {
+        *buffer++ = enc;
+      }
+    }
+  }
+  return data_var;
+}
+
+static const uint8_t* decode_bytes(const uint8_t* data, const uint8_t* data_end,
+                                   uint8_t* buffer, size_t buffer_size)
+{
+  /* 2 bits per group select its bit count */
+  const uint8_t* header    = data;
+  const size_t header_size
+    = (buffer_size / MESH_DECODER_BYTE_GROUP_SIZE + 3) / 4;
+  if ((size_t)(data_end - data) < header_size) {
+    return NULL;
+  }
+  data += header_size;
+
+  for (size_t i = 0; i < buffer_size; i += MESH_DECODER_BYTE_GROUP_SIZE) {
+    if ((size_t)(data_end - data) < MESH_DECODER_BYTE_GROUP_DECODE_LIMIT) {
+      return NULL;
+    }
+    const size_t group = i / MESH_DECODER_BYTE_GROUP_SIZE;
+    const int bitslog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+    data               = decode_bytes_group(data, buffer + i, bitslog2);
+  }
+  return data;
+}
+
+static const uint8_t* decode_vertex_block(const uint8_t* data,
+                                          const uint8_t* data_end,
+                                          uint8_t* vertex_data,
+                                          size_t vertex_count,
+                                          size_t vertex_size,
+                                          uint8_t last_vertex[256])
+{
+  uint8_t buffer[MESH_DECODER_VERTEX_BLOCK_MAX_SIZE];
+  const size_t vertex_count_aligned
+    = (vertex_count + MESH_DECODER_BYTE_GROUP_SIZE - 1)
+      & ~(size_t)(MESH_DECODER_BYTE_GROUP_SIZE - 1);
+
+  /* The bytes of each vertex component are delta encoded to the previous
+   * vertex */
+  for (size_t k = 0; k < vertex_size; ++k) {
+    data = decode_bytes(data, data_end, buffer, vertex_count_aligned);
+    if (data == NULL) {
+      return NULL;
+    }
+    uint8_t p = last_vertex[k];
+    for (size_t i = 0; i < vertex_count; ++i) {
+      const uint8_t v                  = (uint8_t)(unzigzag8(buffer[i]) + p);
+      vertex_data[i * vertex_size + k] = v;
+      p                                = v;
+    }
+  }
+  memcpy(last_vertex, &vertex_data[vertex_size * (vertex_count - 1)],
+         vertex_size);
+  return data;
+}
+
+int mesh_decoder_decode_vertex_buffer(void* destination, size_t vertex_count,
+                                      size_t vertex_size, const uint8_t* buffer,
+                                      size_t buffer_size)
+{
+  if (vertex_size == 0 || vertex_size > 256 || vertex_size % 4 != 0) {
+    return -1;
+  }
+  const uint8_t* data     = buffer;
+  const uint8_t* data_end = buffer + buffer_size;
+  if (buffer_size < 1 + vertex_size) {
+    return -2;
+  }
+  const uint8_t header = *data++;
+  if ((header & 0xf0) != MESH_DECODER_VERTEX_HEADER || (header & 0x0f) > 0) {
+    return -1;
+  }
+
+  /* The tail holds the first baseline vertex */
+  uint8_t last_vertex[256];
+  memcpy(last_vertex, data_end - vertex_size, vertex_size);
+
+  uint8_t* vertex_data     = (uint8_t*)destination;
+  const size_t block_size  = vertex_block_size(vertex_size);
+  size_t vertex_offset     = 0;
+  while (vertex_offset < vertex_count) {
+    const size_t count = (vertex_offset + block_size < vertex_count) ?
+                           block_size :
+                           vertex_count - vertex_offset;
+    data = decode_vertex_block(data, data_end,
+                               vertex_data + vertex_offset * vertex_size,
+                               count, vertex_size, last_vertex);
+    if (data == NULL) {
+      return -2;
+    }
+    vertex_offset += count;
+  }
+
+  const size_t tail_size = vertex_size < MESH_DECODER_TAIL_MAX_SIZE ?
+                             MESH_DECODER_TAIL_MAX_SIZE :
+                             vertex_size;
+  return (size_t)(data_end - data) == tail_size ? 0 : -3;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Index codecs
+ * -------------------------------------------------------------------------- */
+
+static uint32_t decode_vbyte(const uint8_t** data)
+{
+  const uint8_t lead = *(*data)++;
+  if (lead < 128) {
+    return lead;
+  }
+  /* Up to 4 more groups of 7 bits, the high bit marks a continuation */
+  uint32_t result = lead & 127u;
+  uint32_t shift  = 7;
+  for (uint32_t i = 0; i < 4; ++i) {
+    const uint8_t group = *(*data)++;
+    result |= (uint32_t)(group & 127u) << shift;
+    shift += 7;
+    if (group < 128) {
+      break;
+    }
+  }
+  return result;
+}
+
+static uint32_t decode_index(const uint8_t** data, uint32_t last)
+{
+  const uint32_t v = decode_vbyte(data);
+  const uint32_t d = (v >> 1) ^ (uint32_t)(-(int32_t)(v & 1));
+  return last + d;
+}
+
+static void write_index(void* destination, size_t i, size_t index_size,
+                        uint32_t index)
+{
+  if (index_size == 2) {
+    ((uint16_t*)destination)[i] = (uint16_t)index;
+  }
+  else {
+    ((uint32_t*)destination)[i] = index;
+  }
+}
+
+static void write_triangle(void* destination, size_t i, size_t index_size,
+                           uint32_t a, uint32_t b, uint32_t c)
+{
+  write_index(destination, i + 0, index_size, a);
+  write_index(destination, i + 1, index_size, b);
+  write_index(destination, i + 2, index_size, c);
+}
+
+typedef struct index_decoder_fifos_t {
+  uint32_t edges[16][2];
+  size_t edge_offset;
+  uint32_t vertices[16];
+  size_t vertex_offset;
+} index_decoder_fifos_t;
+
+static void push_edge(index_decoder_fifos_t* fifos, uint32_t a, uint32_t b)
+{
+  fifos->edges[fifos->edge_offset][0] = a;
+  fifos->edges[fifos->edge_offset][1] = b;
+  fifos->edge_offset                  = (fifos->edge_offset + 1) & 15;
+}
+
+static void push_vertex(index_decoder_fifos_t* fifos, uint32_t v, bool cond)
+{
+  fifos->vertices[fifos->vertex_offset] = v;
+  fifos->vertex_offset = (fifos->vertex_offset + (cond ? 1 : 0)) & 15;
+}
+
+int mesh_decoder_decode_index_buffer(void* destination, size_t index_count,
+                                     size_t index_size, const uint8_t* buffer,
+                                     size_t buffer_size)
+{
+  if (index_count % 3 != 0 || (index_size != 2 && index_size != 4)) {
+    return -1;
+  }
+  /* Header, 1 byte per triangle and the 16 byte auxiliary code table */
+  if (buffer_size < 1 + index_count / 3 + 16) {
+    return -2;
+  }
+  if ((buffer[0] & 0xf0) != MESH_DECODER_INDEX_HEADER) {
+    return -1;
+  }
+  const int version = buffer[0] & 0x0f;
+  if (version > 1) {
+    return -1;
+  }
+
+  index_decoder_fifos_t fifos;
+  memset(&fifos, 0xff, sizeof(fifos));
+  fifos.edge_offset   = 0;
+  fifos.vertex_offset = 0;
+
+  uint32_t next      = 0;
+  uint32_t last      = 0;
+  const int fec_max  = version >= 1 ? 13 : 15;
+  const uint8_t* code           = buffer + 1;
+  const uint8_t* data           = code + index_count / 3;
+  const uint8_t* data_safe_end  = buffer + buffer_size - 16;
+  const uint8_t* codeaux_table  = data_safe_end;
+
+  for (size_t i = 0; i < index_count; i += 3) {
+    /* A triangle reads at most 16 bytes, the code table follows the data */
+    if (data > data_safe_end) {
+      return -2;
+    }
+
+    const uint8_t codetri = *code++;
+    if (codetri < 0xf0) {
+      /* Triangle sharing an edge of the edge FIFO */
+      const int fe     = codetri >> 4;
+      const uint32_t a = fifos.edges[(fifos.edge_offset - 1 - fe) & 15][0];
+      const uint32_t b = fifos.edges[(fifos.edge_offset - 1 - fe) & 15][1];
+      const int fec    = codetri & 15;
+      uint32_t c       = 0;
+      if (fec < fec_max) {
+        /* Third vertex is new or from the vertex FIFO */
+        c = (fec == 0) ?
+              next :
+              fifos.vertices[(fifos.vertex_offset - 1 - fec) & 15];
+        write_triangle(destination, i, index_size, a, b, c);
+        push_vertex(&fifos, c, fec == 0);
+        next += (fec == 0);
+      }
+      else {
+        /* Third vertex is delta encoded to the last free index, 13 and 14
+         * encode -1 and +1 */
+        last = c = (fec != 15) ? last + (uint32_t)(fec - (fec ^ 3)) :
+                                 decode_index(&data, last);
+        write_triangle(destination, i, index_size, a, b, c);
+        push_vertex(&fifos, c, true);
+      }
+      push_edge(&fifos, c, b);
+      push_edge(&fifos, a, c);
+    }
+    else {
+      uint32_t a = 0, b = 0, c = 0;
+      if (codetri < 0xfe) {
+        /* Triangle without shared edge, vertices from the code table */
+        const uint8_t codeaux = codeaux_table[codetri & 15];
+        const int feb         = codeaux >> 4;
+        const int fec         = codeaux & 15;
+        a                     = next++;
+        b = (feb == 0) ? next :
+                         fifos.vertices[(fifos.vertex_offset - feb) & 15];
+        next += (feb == 0);
+        c = (fec == 0) ? next :
+                         fifos.vertices[(fifos.vertex_offset - fec) & 15];
+        next += (fec == 0);
+        write_triangle(destination, i, index_size, a, b, c);
+        push_vertex(&fifos, a, true);
+        push_vertex(&fifos, b, feb == 0);
+        push_vertex(&fifos, c, fec == 0);
+      }
+      else {
+        /* Vertices from a full code byte, 15 = free index */
+        const uint8_t codeaux = *data++;
+        const int fea         = codetri == 0xfe ? 0 : 15;
+        const int feb         = codeaux >> 4;
+        const int fec         = codeaux & 15;
+        if (codeaux == 0) {
+          next = 0;
+        }
+        a = (fea == 0) ? next++ : 0;
+        b = (feb == 0) ? next++ :
+                         fifos.vertices[(fifos.vertex_offset - feb) & 15];
+        c = (fec == 0) ? next++ :
+                         fifos.vertices[(fifos.vertex_offset - fec) & 15];
+        if (fea == 15) {
+          last = a = decode_index(&data, last);
+        }
+        if (feb == 15) {
+          last = b = decode_index(&data, last);
+        }
+        if (fec == 15) {
+          last = c = decode_index(&data, last);
+        }
+        write_triangle(destination, i, index_size, a, b, c);
+        push_vertex(&fifos, a, true);
+        push_vertex(&fifos, b, feb == 0 || feb == 15);
+        push_vertex(&fifos, c, fec == 0 || fec == 15);
+      }
+      push_edge(&fifos, b, a);
+      push_edge(&fifos, c, b);
+      push_edge(&fifos, a, c);
+    }
+  }
+
+  /* All data is read up to the code table */
+  return data == data_safe_end ? 0 : -3;
+}
+
+int mesh_decoder_decode_index_sequence(void* destination, size_t index_count,
+                                       size_t index_size, const uint8_t* buffer,
+                                       size_t buffer_size)
+{
+  if (index_size != 2 && index_size != 4) {
+    return -1;
+  }
+  /* Header, 1 byte per index and a 4 byte tail */
+  if (buffer_size < 1 + index_count + 4) {
+    return -2;
+  }
+  if ((buffer[0] & 0xf0) != MESH_DECODER_SEQUENCE_HEADER
+      || (buffer[0] & 0x0f) > 1) {
+    return -1;
+  }
+
+  const uint8_t* data          = buffer + 1;
+  const uint8_t* data_safe_end = buffer + buffer_size - 4;
+  uint32_t last[2]             = {0, 0};
+  for (size_t i = 0; i < index_count; ++i) {
+    /* An index reads at most 5 bytes, the tail follows the data */
+    if (data >= data_safe_end) {
+      return -2;
+    }
+    uint32_t v = decode_vbyte(&data);
+    /* The low bit selects the baseline */
+    const uint32_t baseline = v & 1;
+    v >>= 1;
+    const uint32_t d     = (v >> 1) ^ (uint32_t)(-(int32_t)(v & 1));
+    const uint32_t index = last[baseline] + d;
+    last[baseline]       = index;
+    write_index(destination, i, index_size, index);
+  }
+
+  return data == data_safe_end ? 0 : -3;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Filters
+ * -------------------------------------------------------------------------- */
+
+static int round_to_int(float v)
+{
+  return (int)(v + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+/* Reconstructs the z component of an octahedral encoded vector, the z input
+ * holds the encoded length of 1 */
+static void decode_octahedral(float* x, float* y, float* z, float max)
+{
+  *z            = *z - fabsf(*x) - fabsf(*y);
+  const float t = (*z >= 0.0f) ? 0.0f : *z;
+  *x += (*x >= 0.0f) ? t : -t;
+  *y += (*y >= 0.0f) ? t : -t;
+  const float s = max / sqrtf(*x * *x + *y * *y + *z * *z);
+  *x *= s;
+  *y *= s;
+  *z *= s;
+}
+
+void mesh_decoder_filter_octahedral(void* data, size_t count, size_t stride)
+{
+  if (stride == 4) {
+    int8_t* v = (int8_t*)data;
+    for (size_t i = 0; i < count; ++i, v += 4) {
+      float x = v[0], y = v[1], z = v[2];
+      decode_octahedral(&x, &y, &z, 127.0f);
+      v[0] = (int8_t)round_to_int(x);
+      v[1] = (int8_t)round_to_int(y);
+      v[2] = (int8_t)round_to_int(z);
+    }
+  }
+  else {
+    int16_t* v = (int16_t*)data;
+    for (size_t i = 0; i < count; ++i, v += 4) {
+      float x = v[0], y = v[1], z = v[2];
+      decode_octahedral(&x, &y, &z, 32767.0f);
+      v[0] = (int16_t)round_to_int(x);
+      v[1] = (int16_t)round_to_int(y);
+      v[2] = (int16_t)round_to_int(z);
+    }
+  }
+}
+
+void mesh_decoder_filter_quaternion(void* data, size_t count, size_t stride)
+{
+  (void)stride;
+  const float scale = 1.0f / sqrtf(2.0f);
+  int16_t* v        = (int16_t*)data;
+  for (size_t i = 0; i < count; ++i, v += 4) {
+    /* The 4th component holds the scale and the index of the largest
+     * component, which is reconstructed */
+    const int sf   = v[3] | 3;
+    const float ss = scale / (float)sf;
+    const float x  = (float)v[0] * ss;
+    const float y  = (float)v[1] * ss;
+    const float z  = (float)v[2] * ss;
+    const float ww = 1.0f - x * x - y * y - z * z;
+    const float w  = sqrtf(ww >= 0.0f ? ww : 0.0f);
+    const int qc   = v[3] & 3;
+    const int16_t xf = (int16_t)round_to_int(x * 32767.0f);
+    const int16_t yf = (int16_t)round_to_int(y * 32767.0f);
+    const int16_t zf = (int16_t)round_to_int(z * 32767.0f);
+    const int16_t wf = (int16_t)(int)(w * 32767.0f + 0.5f);
+    v[(qc + 1) & 3]  = xf;
+    v[(qc + 2) & 3]  = yf;
+    v[(qc + 3) & 3]  = zf;
+    v[(qc + 0) & 3]  = wf;
+  }
+}
+
+void mesh_decoder_filter_exponential(void* data, size_t count, size_t stride)
+{
+  /* 24-bit signed mantissa and 8-bit signed exponent per component */
+  uint32_t* v                  = (uint32_t*)data;
+  const size_t component_count = count * (stride / 4);
+  for (size_t i = 0; i < component_count; ++i) {
+    const int32_t m = (int32_t)(v[i] << 8) >> 8;
+    const int32_t e = (int32_t)v[i] >> 24;
+    union {
+      float f;
+      uint32_t u;
+    } bits;
+    bits.u = (uint32_t)(e + 127) << 23;
+    bits.f = bits.f * (float)m;
+    v[i]   = bits.u;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef MESH_DECODER_H
+#define MESH_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * Decoders of the meshoptimizer buffer compression (bitstream version 0 of the
+ * vertex codec, versions 0 and 1 of the index codecs) as used by the glTF
+ * EXT_meshopt_compression extension. All functions return 0 on success and a
+ * negative value if the data is malformed.
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @brief Decodes vertex data (mode ATTRIBUTES), vertices are delta encoded
+ * byte by byte in blocks.
+ * @param vertex_size the size of a vertex in bytes, a multiple of 4 up to 256
+ */
+int mesh_decoder_decode_vertex_buffer(void* destination, size_t vertex_count,
+                                      size_t vertex_size, const uint8_t* buffer,
+                                      size_t buffer_size);
+
+/**
+ * @brief Decodes a triangle list (mode TRIANGLES) encoded with edge and vertex
+ * FIFOs.
+ * @param index_size 2 or 4
+ */
+int mesh_decoder_decode_index_buffer(void* destination, size_t index_count,
+                                     size_t index_size, const uint8_t* buffer,
+                                     size_t buffer_size);
+
+/**
+ * @brief Decodes an arbitrary index sequence (mode INDICES), the indices are
+ * delta encoded against two baselines.
+ * @param index_size 2 or 4
+ */
+int mesh_decoder_decode_index_sequence(void* destination, size_t index_count,
+                                       size_t index_size, const uint8_t* buffer,
+                                       size_t buffer_size);
+
+/* In place filters of decoded vertex data, stride is the size of an element:
+ *  - octahedral: 4 (snorm8x4) or 8 (snorm16x4) bytes, unit vectors
+ *  - quaternion: 8 bytes (snorm16x4), unit quaternions
+ *  - exponential: multiple of 4 bytes, float32 components */
+void mesh_decoder_filter_octahedral(void* data, size_t count, size_t stride);
+void mesh_decoder_filter_quaternion(void* data, size_t count, size_t stride);
+void mesh_decoder_filter_exponential(void* data, size_t count, size_t stride);
+
+#endif
@@ -0,0 +1,1017 @@
+#include "mesh_optimizer.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macro.h"
+
+/* Size of the simulated post-transform vertex cache */
+#define MESH_OPTIMIZER_CACHE_SIZE 16u
+
+/* Vertex scores are tabulated up to this number of remaining triangles */
+#define MESH_OPTIMIZER_MAX_VALENCE 8u
+
+#define MESH_OPTIMIZER_INVALID_INDEX 0xFFFFFFFFu
+
+/* -------------------------------------------------------------------------- *
+ * Vertex cache optimization
+ * -------------------------------------------------------------------------- */
+
+typedef struct vertex_score_table_t {
+  float cache[MESH_OPTIMIZER_CACHE_SIZE];
+  float valence[MESH_OPTIMIZER_MAX_VALENCE + 1];
+} vertex_score_table_t;
+
+static void vertex_score_table_init(vertex_score_table_t* table)
+{
+  /* The vertices of the last triangle get a fixed score, so that the next
+   * triangle does not simply continue the strip in the same direction */
+  for (uint32_t i = 0; i < MESH_OPTIMIZER_CACHE_SIZE; ++i) {
+    table->cache[i]
+      = (i < 3) ? 0.75f :
+                  powf(1.0f - (float)(i - 3) / (MESH_OPTIMIZER_CACHE_SIZE - 3),
+                       1.5f);
+  }
+  /* Boost vertices with few remaining triangles to get rid of them early */
+  table->valence[0] = 0.0f;
+  for (uint32_t i = 1; i <= MESH_OPTIMIZER_MAX_VALENCE; ++i) {
+    table->valence[i] = 2.0f / sqrtf((float)i);
+  }
+}
+
+static float vertex_score(const vertex_score_table_t* table,
+                          int32_t cache_position, uint32_t live_triangles)
+{
+  if (live_triangles == 0) {
+    /* No triangle needs this vertex anymore */
+    return 0.0f;
+  }
+  const float cache_score
+    = (cache_position >= 0) ? table->cache[cache_position] : 0.0f;
+  const float valence_score
+    = (live_triangles <= MESH_OPTIMIZER_MAX_VALENCE) ?
+        table->valence[live_triangles] :
+        2.0f / sqrtf((float)live_triangles);
+  return cache_score + valence_score;
+}
+
+void mesh_optimizer_optimize_vertex_cache(uint32_t* indices,
+                                          size_t index_count,
+                                          size_t vertex_count)
+{
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0 || vertex_count == 0) {
+    return;
+  }
+
+  vertex_score_table_t score_table;
+  vertex_score_table_init(&score_table);
+
+  /* Vertex-triangle adjacency */
+  uint32_t* live_triangles = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+  uint32_t* offsets        = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+  for (size_t i = 0; i < triangle_count * 3; ++i) {
+    ++live_triangles[indices[i]];
+  }
+  uint32_t offset = 0;
+  for (size_t v = 0; v < vertex_count; ++v) {
+    offsets[v] = offset;
+    offset += live_triangles[v];
+    live_triangles[v] = 0;
+  }
+  uint32_t* adjacency
+    = (uint32_t*)malloc(triangle_count * 3 * sizeof(uint32_t));
+  for (size_t t = 0; t < triangle_count; ++t) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      const uint32_t v = indices[t * 3 + k];
+      adjacency[offsets[v] + live_triangles[v]++] = (uint32_t)t;
+    }
+  }
+
+  /* Initial scores */
+  float* vertex_scores   = (float*)malloc(vertex_count * sizeof(float));
+  float* triangle_scores = (float*)malloc(triangle_count * sizeof(float));
+  bool* emitted          = (bool*)calloc(triangle_count, sizeof(bool));
+  for (size_t v = 0; v < vertex_count; ++v) {
+    vertex_scores[v] = vertex_score(&score_table, -1, live_triangles[v]);
+  }
+  for (size_t t = 0; t < triangle_count; ++t) {
+    triangle_scores[t] = vertex_scores[indices[t * 3 + 0]]
+                         + vertex_scores[indices[t * 3 + 1]]
+                         + vertex_scores[indices[t * 3 + 2]];
+  }
+
+  uint32_t* result = (uint32_t*)malloc(triangle_count * 3 * sizeof(uint32_t));
+  uint32_t cache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+  uint32_t new_cache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+  uint32_t cache_count = 0;
+
+  uint32_t current_triangle = 0;
+  size_t input_cursor       = 1;
+  size_t output_triangle    = 0;
+  while (current_triangle != MESH_OPTIMIZER_INVALID_INDEX) {
+    const uint32_t* triangle = &indices[current_triangle * 3];
+
+    /* Emit the triangle */
+    memcpy(&result[output_triangle * 3], triangle, 3 * sizeof(uint32_t));
+    ++output_triangle;
+    emitted[current_triangle]         = true;
+    triangle_scores[current_triangle] = 0.0f;
+
+    /* Move the triangle vertices to the front of the cache (LRU) */
+    uint32_t cache_write     = 0;
+    new_cache[cache_write++] = triangle[0];
+    new_cache[cache_write++] = triangle[1];
+    new_cache[cache_write++] = triangle[2];
+    for (uint32_t i = 0; i < cache_count; ++i) {
+      const uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        new_cache[cache_write++] = v;
+      }
+    }
+    memcpy(cache, new_cache, cache_write * sizeof(uint32_t));
+
+    /* Remove the emitted triangle from the adjacency of its vertices */
+    for (uint32_t k = 0; k < 3; ++k) {
+      const uint32_t v    = triangle[k];
+      uint32_t* triangles = &adjacency[offsets[v]];
+      for (uint32_t i = 0; i < live_triangles[v]; ++i) {
+        if (triangles[i] == current_triangle) {
+          triangles[i] = triangles[live_triangles[v] - 1];
+          --live_triangles[v];
+          break;
+        }
+      }
+    }
+
+    /* Update the scores of the cached vertices, the vertices pushed out of the
+     * cache lose their cache score */
+    for (uint32_t i = 0; i < cache_write; ++i) {
+      const uint32_t v = cache[i];
+      const int32_t cache_position
+        = (i < MESH_OPTIMIZER_CACHE_SIZE) ? (int32_t)i : -1;
+      const float score
+        = vertex_score(&score_table, cache_position, live_triangles[v]);
+      const float score_diff = score - vertex_scores[v];
+      vertex_scores[v]       = score;
+      for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+        triangle_scores[adjacency[offsets[v] + j]] += score_diff;
+      }
+    }
+    cache_count = MIN(cache_write, MESH_OPTIMIZER_CACHE_SIZE);
+
+    /* Next triangle: the best scored triangle using a cached vertex */
+    current_triangle = MESH_OPTIMIZER_INVALID_INDEX;
+    float best_score = 0.0f;
+    for (uint32_t i = 0; i < cache_count; ++i) {
+      const uint32_t v = cache[i];
+      for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+        const uint32_t t = adjacency[offsets[v] + j];
+        if (triangle_scores[t] > best_score) {
+          best_score       = triangle_scores[t];
+          current_triangle = t;
+        }
+      }
+    }
+
+    /* Dead end, continue with the next triangle in input order */
+    if (current_triangle == MESH_OPTIMIZER_INVALID_INDEX) {
+      while (input_cursor < triangle_count && emitted[input_cursor]) {
+        ++input_cursor;
+      }
+      if (input_cursor < triangle_count) {
+        current_triangle = (uint32_t)input_cursor;
+      }
+    }
+  }
+
+  memcpy(indices, result, triangle_count * 3 * sizeof(uint32_t));
+
+  free(result);
+  free(emitted);
+  free(triangle_scores);
+  free(vertex_scores);
+  free(adjacency);
+  free(offsets);
+  free(live_triangles);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Overdraw optimization
+ * -------------------------------------------------------------------------- */
+
+/* FIFO cache simulation based on timestamps */
+typedef struct vertex_cache_sim_t {
+  uint32_t* timestamps;
+  uint32_t timestamp;
+} vertex_cache_sim_t;
+
+static void vertex_cache_sim_reset(vertex_cache_sim_t* sim)
+{
+  /* All cached timestamps become older than the cache size */
+  sim->timestamp += MESH_OPTIMIZER_CACHE_SIZE + 1;
+}
+
+static uint32_t vertex_cache_sim_update(vertex_cache_sim_t* sim,
+                                        const uint32_t* triangle)
+{
+  uint32_t cache_misses = 0;
+  for (uint32_t k = 0; k < 3; ++k) {
+    const uint32_t v = triangle[k];
+    if (sim->timestamp - sim->timestamps[v] > MESH_OPTIMIZER_CACHE_SIZE) {
+      sim->timestamps[v] = sim->timestamp++;
+      ++cache_misses;
+    }
+  }
+  return cache_misses;
+}
+
+typedef struct overdraw_cluster_t {
+  uint32_t first_triangle;
+  uint32_t triangle_count;
+  float sort_key;
+} overdraw_cluster_t;
+
+static int overdraw_cluster_compare(const void* a, const void* b)
+{
+  const overdraw_cluster_t* ca = (const overdraw_cluster_t*)a;
+  const overdraw_cluster_t* cb = (const overdraw_cluster_t*)b;
+  /* Descending sort key, ties keep the vertex cache order */
+  if (ca->sort_key != cb->sort_key) {
+    return (ca->sort_key > cb->sort_key) ? -1 : 1;
+  }
+  return (ca->first_triangle < cb->first_triangle) ? -1 : 1;
+}
+
+static void get_vertex_position(const float* vertex_positions, size_t stride,
+                                uint32_t index, float* dest)
+{
+  const float* p
+    = (const float*)((const uint8_t*)vertex_positions + (size_t)index * stride);
+  dest[0] = p[0];
+  dest[1] = p[1];
+  dest[2] = p[2];
+}
+
+void mesh_optimizer_optimize_overdraw(uint32_t* indices, size_t index_count,
+                                      const float* vertex_positions,
+                                      size_t vertex_count,
+                                      size_t vertex_positions_stride,
+                                      float threshold)
+{
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0 || vertex_count == 0) {
+    return;
+  }
+
+  vertex_cache_sim_t sim = {
+    .timestamps = (uint32_t*)calloc(vertex_count, sizeof(uint32_t)),
+    .timestamp  = MESH_OPTIMIZER_CACHE_SIZE + 1,
+  };
+
+  /* Hard boundaries: a triangle missing all three vertices starts a new
+   * cluster, breaking there does not degrade the vertex cache efficiency */
+  uint32_t* hard_clusters
+    = (uint32_t*)malloc((triangle_count + 1) * sizeof(uint32_t));
+  uint32_t hard_cluster_count = 0;
+  for (size_t t = 0; t < triangle_count; ++t) {
+    const uint32_t cache_misses
+      = vertex_cache_sim_update(&sim, &indices[t * 3]);
+    if (t == 0 || cache_misses == 3) {
+      hard_clusters[hard_cluster_count++] = (uint32_t)t;
+    }
+  }
+  hard_clusters[hard_cluster_count] = (uint32_t)triangle_count;
+
+  /* Soft boundaries: split the hard clusters further as long as the cache
+   * miss ratio stays within the threshold of the cluster's ratio */
+  overdraw_cluster_t* clusters
+    = (overdraw_cluster_t*)malloc(triangle_count * sizeof(overdraw_cluster_t));
+  uint32_t cluster_count = 0;
+  for (uint32_t c = 0; c < hard_cluster_count; ++c) {
+    const uint32_t start = hard_clusters[c];
+    const uint32_t end   = hard_clusters[c + 1];
+
+    vertex_cache_sim_reset(&sim);
+    uint32_t cluster_misses = 0;
+    for (uint32_t t = start; t < end; ++t) {
+      cluster_misses += vertex_cache_sim_update(&sim, &indices[t * 3]);
+    }
+    const float cluster_threshold
+      = threshold * (float)cluster_misses / (float)(end - start);
+
+    vertex_cache_sim_reset(&sim);
+    uint32_t cluster_start = start, running_misses = 0;
+    for (uint32_t t = start; t < end; ++t) {
+      running_misses += vertex_cache_sim_update(&sim, &indices[t * 3]);
+      const uint32_t running_triangles = t + 1 - cluster_start;
+      if ((float)running_misses / (float)running_triangles
+            <= cluster_threshold
+          || t + 1 == end) {
+        clusters[cluster_count++] = (overdraw_cluster_t){
+          .first_triangle = cluster_start,
+          .triangle_count = running_triangles,
+        };
+        vertex_cache_sim_reset(&sim);
+        cluster_start  = t + 1;
+        running_misses = 0;
+      }
+    }
+  }
+
+  /* Mesh centroid */
+  float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+  for (size_t v = 0; v < vertex_count; ++v) {
+    float p[3];
+    get_vertex_position(vertex_positions, vertex_positions_stride, (uint32_t)v,
+                        p);
+    mesh_centroid[0] += p[0];
+    mesh_centroid[1] += p[1];
+    mesh_centroid[2] += p[2];
+  }
+  for (uint32_t k = 0; k < 3; ++k) {
+    mesh_centroid[k] /= (float)vertex_count;
+  }
+
+  /* Sort key: how far the cluster faces outwards, the area weighted centroid
+   * projected on the area weighted normal of the cluster */
+  for (uint32_t c = 0; c < cluster_count; ++c) {
+    overdraw_cluster_t* cluster = &clusters[c];
+    float centroid[3]           = {0.0f, 0.0f, 0.0f};
+    float normal[3]             = {0.0f, 0.0f, 0.0f};
+    float cluster_area          = 0.0f;
+    for (uint32_t t = 0; t < cluster->triangle_count; ++t) {
+      const uint32_t* triangle = &indices[(cluster->first_triangle + t) * 3];
+      float p0[3], p1[3], p2[3];
+      get_vertex_position(vertex_positions, vertex_positions_stride,
+                          triangle[0], p0);
+      get_vertex_position(vertex_positions, vertex_positions_stride,
+                          triangle[1], p1);
+      get_vertex_position(vertex_positions, vertex_positions_stride,
+                          triangle[2], p2);
+      const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      const float n[3]  = {
+        e1[1] * e2[2] - e1[2] * e2[1],
+        e1[2] * e2[0] - e1[0] * e2[2],
+        e1[0] * e2[1] - e1[1] * e2[0],
+      };
+      const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (uint32_t k = 0; k < 3; ++k) {
+        centroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0f;
+        normal[k] += n[k];
+      }
+      cluster_area += area;
+    }
+    const float normal_length = sqrtf(
+      normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    const float inv_area
+      = (cluster_area > 0.0f) ? 1.0f / cluster_area : 0.0f;
+    const float inv_normal_length
+      = (normal_length > 0.0f) ? 1.0f / normal_length : 0.0f;
+    cluster->sort_key = 0.0f;
+    for (uint32_t k = 0; k < 3; ++k) {
+      cluster->sort_key += (centroid[k] * inv_area - mesh_centroid[k])
+                           * normal[k] * inv_normal_length;
+    }
+  }
+  qsort(clusters, cluster_count, sizeof(overdraw_cluster_t),
+        overdraw_cluster_compare);
+
+  /* Emit the triangles cluster by cluster */
+  uint32_t* result = (uint32_t*)malloc(triangle_count * 3 * sizeof(uint32_t));
+  size_t output_triangle = 0;
+  for (uint32_t c = 0; c < cluster_count; ++c) {
+    memcpy(&result[output_triangle * 3],
+           &indices[clusters[c].first_triangle * 3],
+           clusters[c].triangle_count * 3 * sizeof(uint32_t));
+    output_triangle += clusters[c].triangle_count;
+  }
+  memcpy(indices, result, triangle_count * 3 * sizeof(uint32_t));
+
+  free(result);
+  free(clusters);
+  free(hard_clusters);
+  free(sim.timestamps);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Vertex fetch optimization
+ * -------------------------------------------------------------------------- */
+
+void mesh_optimizer_optimize_vertex_fetch(void* vertices, uint32_t* indices,
+                                          size_t index_count,
+                                          size_t vertex_count,
+                                          size_t vertex_size)
+{
+  if (vertex_count == 0) {
+    return;
+  }
+
+  /* New vertex indices in the order of the first use */
+  uint32_t* remap = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+  memset(remap, 0xFF, vertex_count * sizeof(uint32_t));
+  uint32_t next_vertex = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t v = indices[i];
+    if (remap[v] == MESH_OPTIMIZER_INVALID_INDEX) {
+      remap[v] = next_vertex++;
+    }
+    indices[i] = remap[v];
+  }
+  for (size_t v = 0; v < vertex_count; ++v) {
+    if (remap[v] == MESH_OPTIMIZER_INVALID_INDEX) {
+      remap[v] = next_vertex++;
+    }
+  }
+
+  uint8_t* src = (uint8_t*)vertices;
+  uint8_t* dst = (uint8_t*)malloc(vertex_count * vertex_size);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    memcpy(dst + (size_t)remap[v] * vertex_size, src + v * vertex_size,
+           vertex_size);
+  }
+  memcpy(vertices, dst, vertex_count * vertex_size);
+
+  free(dst);
+  free(remap);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Meshlet generation
+ * -------------------------------------------------------------------------- */
+
+static void meshlet_compute_bounds(mesh_optimizer_meshlet_t* meshlet,
+                                   const uint32_t* indices,
+                                   const float* vertex_positions,
+                                   size_t vertex_positions_stride)
+{
+  const uint32_t* meshlet_indices = &indices[meshlet->first_index];
+
+  /* Bounding sphere around the center of the bounding box */
+  float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < meshlet->index_count; ++i) {
+    float p[3];
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        meshlet_indices[i], p);
+    for (uint32_t k = 0; k < 3; ++k) {
+      min[k] = MIN(min[k], p[k]);
+      max[k] = MAX(max[k], p[k]);
+    }
+  }
+  float radius_sq = 0.0f;
+  for (uint32_t k = 0; k < 3; ++k) {
+    meshlet->center[k] = (min[k] + max[k]) * 0.5f;
+  }
+  for (uint32_t i = 0; i < meshlet->index_count; ++i) {
+    float p[3];
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        meshlet_indices[i], p);
+    const float dx = p[0] - meshlet->center[0];
+    const float dy = p[1] - meshlet->center[1];
+    const float dz = p[2] - meshlet->center[2];
+    radius_sq      = MAX(radius_sq, dx * dx + dy * dy + dz * dz);
+  }
+  meshlet->radius = sqrtf(radius_sq);
+
+  /* Normal cone around the average triangle normal */
+  const uint32_t triangle_count = meshlet->index_count / 3;
+  float axis[3]                 = {0.0f, 0.0f, 0.0f};
+  uint32_t normal_count         = 0;
+  float* normals = (float*)malloc(triangle_count * 3 * sizeof(float));
+  for (uint32_t t = 0; t < triangle_count; ++t) {
+    float p0[3], p1[3], p2[3];
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        meshlet_indices[t * 3 + 0], p0);
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        meshlet_indices[t * 3 + 1], p1);
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        meshlet_indices[t * 3 + 2], p2);
+    const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n[3]        = {
+      e1[1] * e2[2] - e1[2] * e2[1],
+      e1[2] * e2[0] - e1[0] * e2[2],
+      e1[0] * e2[1] - e1[1] * e2[0],
+    };
+    const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length <= 0.0f) {
+      /* Degenerate triangles don't restrict the cone */
+      continue;
+    }
+    for (uint32_t k = 0; k < 3; ++k) {
+      n[k] /= length;
+      axis[k] += n[k];
+      normals[normal_count * 3 + k] = n[k];
+    }
+    ++normal_count;
+  }
+  const float axis_length
+    = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  float min_dot = 1.0f;
+  if (axis_length > 0.0f) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      axis[k] /= axis_length;
+    }
+    for (uint32_t i = 0; i < normal_count; ++i) {
+      const float* n = &normals[i * 3];
+      min_dot = MIN(min_dot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+    }
+  }
+  free(normals);
+
+  memcpy(meshlet->cone_axis, axis, sizeof(axis));
+  /* A cone wider than ~84 degrees (or without normals) is never backfacing */
+  meshlet->cone_cutoff = (axis_length <= 0.0f || min_dot <= 0.1f) ?
+                           1.0f :
+                           sqrtf(1.0f - min_dot * min_dot);
+}
+
+/* Collects the vertices of the triangle which are not in the meshlet yet */
+static size_t meshlet_find_new_vertices(const uint32_t* meshlet_vertices,
+                                        size_t meshlet_vertex_count,
+                                        const uint32_t* triangle,
+                                        uint32_t* new_vertices)
+{
+  size_t new_vertex_count = 0;
+  for (uint32_t k = 0; k < 3; ++k) {
+    bool found = false;
+    for (size_t i = 0; i < meshlet_vertex_count && !found; ++i) {
+      found = (meshlet_vertices[i] == triangle[k]);
+    }
+    for (size_t i = 0; i < new_vertex_count && !found; ++i) {
+      found = (new_vertices[i] == triangle[k]);
+    }
+    if (!found) {
+      new_vertices[new_vertex_count++] = triangle[k];
+    }
+  }
+  return new_vertex_count;
+}
+
+size_t mesh_optimizer_build_meshlets(mesh_optimizer_meshlet_t** meshlets,
+                                     const uint32_t* indices,
+                                     size_t index_count,
+                                     const float* vertex_positions,
+                                     size_t vertex_positions_stride,
+                                     size_t max_vertices,
+                                     size_t max_triangles)
+{
+  const size_t triangle_count = index_count / 3;
+  *meshlets                   = NULL;
+  if (triangle_count == 0 || max_vertices < 3 || max_triangles == 0) {
+    return 0;
+  }
+
+  /* Upper bound: every meshlet holds at least one triangle */
+  mesh_optimizer_meshlet_t* result = (mesh_optimizer_meshlet_t*)malloc(
+    triangle_count * sizeof(mesh_optimizer_meshlet_t));
+  uint32_t* meshlet_vertices
+    = (uint32_t*)malloc(max_vertices * sizeof(uint32_t));
+  size_t meshlet_count          = 0;
+  size_t meshlet_vertex_count   = 0;
+  size_t meshlet_triangle_count = 0;
+
+  for (size_t t = 0; t < triangle_count; ++t) {
+    const uint32_t* triangle = &indices[t * 3];
+    uint32_t new_vertices[3];
+    size_t new_vertex_count = meshlet_find_new_vertices(
+      meshlet_vertices, meshlet_vertex_count, triangle, new_vertices);
+
+    /* Start a new meshlet when the triangle doesn't fit */
+    if (meshlet_vertex_count + new_vertex_count > max_vertices
+        || meshlet_triangle_count == max_triangles) {
+      ++meshlet_count;
+      meshlet_vertex_count   = 0;
+      meshlet_triangle_count = 0;
+      new_vertex_count       = meshlet_find_new_vertices(
+        meshlet_vertices, meshlet_vertex_count, triangle, new_vertices);
+    }
+
+    mesh_optimizer_meshlet_t* meshlet = &result[meshlet_count];
+    if (meshlet_triangle_count == 0) {
+      meshlet->first_index = (uint32_t)(t * 3);
+    }
+    meshlet->index_count = (uint32_t)((meshlet_triangle_count + 1) * 3);
+    memcpy(&meshlet_vertices[meshlet_vertex_count], new_vertices,
+           new_vertex_count * sizeof(uint32_t));
+    meshlet_vertex_count += new_vertex_count;
+    ++meshlet_triangle_count;
+  }
+  /* The last meshlet is never empty */
+  ++meshlet_count;
+
+  for (size_t i = 0; i < meshlet_count; ++i) {
+    meshlet_compute_bounds(&result[i], indices, vertex_positions,
+                           vertex_positions_stride);
+  }
+
+  free(meshlet_vertices);
+  *meshlets = result;
+  return meshlet_count;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Simplification
+ * -------------------------------------------------------------------------- */
+
+/* Symmetric 4x4 error quadric: a00 a01 a02 a03 a11 a12 a13 a22 a23 a33 */
+typedef struct simplify_quadric_t {
+  double q[10];
+} simplify_quadric_t;
+
+typedef struct simplify_collapse_t {
+  uint32_t v0; /* moved onto v1 */
+  uint32_t v1;
+  float cost;
+} simplify_collapse_t;
+
+static void simplify_quadric_add_plane(simplify_quadric_t* quadric,
+                                       const double n[4], double weight)
+{
+  double* q = quadric->q;
+  q[0] += weight * n[0] * n[0];
+  q[1] += weight * n[0] * n[1];
+  q[2] += weight * n[0] * n[2];
+  q[3] += weight * n[0] * n[3];
+  q[4] += weight * n[1] * n[1];
+  q[5] += weight * n[1] * n[2];
+  q[6] += weight * n[1] * n[3];
+  q[7] += weight * n[2] * n[2];
+  q[8] += weight * n[2] * n[3];
+  q[9] += weight * n[3] * n[3];
+}
+
+static void simplify_quadric_merge(simplify_quadric_t* dst,
+                                   const simplify_quadric_t* src)
+{
+  for (uint32_t i = 0; i < 10; ++i) {
+    dst->q[i] += src->q[i];
+  }
+}
+
+/* Squared distance of the position to the planes of the quadric */
+static double simplify_quadric_error(const simplify_quadric_t* a,
+                                     const simplify_quadric_t* b,
+                                     const float p[3])
+{
+  double q[10];
+  for (uint32_t i = 0; i < 10; ++i) {
+    q[i] = a->q[i] + b->q[i];
+  }
+  const double x = p[0], y = p[1], z = p[2];
+  const double error = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z
+                       + 2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z
+                       + 2.0 * q[6] * y + q[7] * z * z + 2.0 * q[8] * z + q[9];
+  return error > 0.0 ? error : 0.0;
+}
+
+static void simplify_triangle_normal(const float* p0, const float* p1,
+                                     const float* p2, float n[3])
+{
+  const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+  n[0]              = e1[1] * e2[2] - e1[2] * e2[1];
+  n[1]              = e1[2] * e2[0] - e1[0] * e2[2];
+  n[2]              = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static uint32_t simplify_hash(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  return (uint32_t)key;
+}
+
+/* Open addressing hash set of 64-bit keys, 0 is the empty key */
+typedef struct simplify_hash_set_t {
+  uint64_t* keys;
+  uint32_t mask;
+} simplify_hash_set_t;
+
+static void simplify_hash_set_init(simplify_hash_set_t* set, size_t capacity)
+{
+  uint32_t size = 16;
+  while (size < capacity * 2) {
+    size <<= 1;
+  }
+  set->keys = (uint64_t*)calloc(size, sizeof(uint64_t));
+  set->mask = size - 1;
+}
+
+/* @return the slot of the key, inserted if not present */
+static uint64_t* simplify_hash_set_find(simplify_hash_set_t* set, uint64_t key,
+                                        bool insert)
+{
+  uint32_t slot = simplify_hash(key) & set->mask;
+  while (set->keys[slot] != 0 && set->keys[slot] != key) {
+    slot = (slot + 1) & set->mask;
+  }
+  if (set->keys[slot] == 0) {
+    if (!insert) {
+      return NULL;
+    }
+    set->keys[slot] = key;
+  }
+  return &set->keys[slot];
+}
+
+/* Vertices at the same position share the first vertex as position vertex */
+static void simplify_build_position_remap(uint32_t* remap,
+                                          const float* positions,
+                                          size_t vertex_count)
+{
+  simplify_hash_set_t set;
+  simplify_hash_set_init(&set, vertex_count);
+  uint32_t* slot_vertices
+    = (uint32_t*)malloc((set.mask + 1) * sizeof(uint32_t));
+  for (size_t v = 0; v < vertex_count; ++v) {
+    const float* p = &positions[v * 3];
+    uint32_t bits[3];
+    memcpy(bits, p, sizeof(bits));
+    /* Never 0, which marks empty slots */
+    const uint64_t key
+      = (((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u)
+         ^ ((uint64_t)bits[2] * 83492791u))
+        | 1ull << 63;
+    uint32_t slot = simplify_hash(key) & set.mask;
+    remap[v]      = (uint32_t)v;
+    while (set.keys[slot] != 0) {
+      const uint32_t other = slot_vertices[slot];
+      if (set.keys[slot] == key
+          && memcmp(&positions[other * 3], p, 3 * sizeof(float)) == 0) {
+        remap[v] = other;
+        break;
+      }
+      slot = (slot + 1) & set.mask;
+    }
+    if (remap[v] == v) {
+      set.keys[slot]      = key;
+      slot_vertices[slot] = (uint32_t)v;
+    }
+  }
+  free(slot_vertices);
+  free(set.keys);
+}
+
+static int simplify_collapse_compare(const void* a, const void* b)
+{
+  const float ca = ((const simplify_collapse_t*)a)->cost;
+  const float cb = ((const simplify_collapse_t*)b)->cost;
+  return (ca < cb) ? -1 : (ca > cb) ? 1 : 0;
+}
+
+/* Checks if moving v0 onto v1 flips a triangle around v0 */
+static bool simplify_collapse_flips(const float* positions,
+                                    const uint32_t* indices,
+                                    const uint32_t* adjacency_offsets,
+                                    const uint32_t* adjacency, uint32_t v0,
+                                    uint32_t v1)
+{
+  for (uint32_t a = adjacency_offsets[v0]; a < adjacency_offsets[v0 + 1];
+       ++a) {
+    const uint32_t* triangle = &indices[adjacency[a] * 3];
+    if (triangle[0] == v1 || triangle[1] == v1 || triangle[2] == v1) {
+      /* Removed by the collapse */
+      continue;
+    }
+    float before[3], after[3];
+    const float* p[3];
+    for (uint32_t k = 0; k < 3; ++k) {
+      p[k] = &positions[triangle[k] * 3];
+    }
+    simplify_triangle_normal(p[0], p[1], p[2], before);
+    for (uint32_t k = 0; k < 3; ++k) {
+      if (triangle[k] == v0) {
+        p[k] = &positions[v1 * 3];
+      }
+    }
+    simplify_triangle_normal(p[0], p[1], p[2], after);
+    if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2]
+        <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Removes the triangles with two equal indices, returns the new index count */
+static size_t simplify_remove_degenerate(uint32_t* indices, size_t index_count)
+{
+  size_t result = 0;
+  for (size_t i = 0; i < index_count; i += 3) {
+    const uint32_t a = indices[i + 0], b = indices[i + 1], c = indices[i + 2];
+    if (a != b && b != c && a != c) {
+      indices[result + 0] = a;
+      indices[result + 1] = b;
+      indices[result + 2] = c;
+      result += 3;
+    }
+  }
+  return result;
+}
+
+size_t mesh_optimizer_simplify(uint32_t* destination, const uint32_t* indices,
+                               size_t index_count,
+                               const float* vertex_positions,
+                               size_t vertex_count,
+                               size_t vertex_positions_stride,
+                               size_t target_index_count, float target_error,
+                               float* result_error)
+{
+  if (result_error != NULL) {
+    *result_error = 0.0f;
+  }
+  memcpy(destination, indices, index_count * sizeof(uint32_t));
+  index_count = simplify_remove_degenerate(destination, index_count);
+  if (index_count <= target_index_count || vertex_count == 0) {
+    return index_count;
+  }
+
+  /* Positions normalized to the unit cube, the errors are relative to the
+   * mesh extent */
+  float* positions = (float*)malloc(vertex_count * 3 * sizeof(float));
+  float min[3]     = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float max[3]     = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (size_t v = 0; v < vertex_count; ++v) {
+    get_vertex_position(vertex_positions, vertex_positions_stride,
+                        (uint32_t)v, &positions[v * 3]);
+    for (uint32_t k = 0; k < 3; ++k) {
+      min[k] = MIN(min[k], positions[v * 3 + k]);
+      max[k] = MAX(max[k], positions[v * 3 + k]);
+    }
+  }
+  const float extent
+    = MAX(max[0] - min[0], MAX(max[1] - min[1], max[2] - min[2]));
+  const float scale  = extent > 0.0f ? 1.0f / extent : 0.0f;
+  for (size_t v = 0; v < vertex_count; ++v) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      positions[v * 3 + k] = (positions[v * 3 + k] - min[k]) * scale;
+    }
+  }
+
+  /* Vertices on attribute seams (several vertices at one position) and on
+   * open borders (edges of one triangle) are locked */
+  uint32_t* position_remap = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+  simplify_build_position_remap(position_remap, positions, vertex_count);
+  bool* locked = (bool*)calloc(vertex_count, sizeof(bool));
+  for (size_t v = 0; v < vertex_count; ++v) {
+    if (position_remap[v] != v) {
+      locked[v]                 = true;
+      locked[position_remap[v]] = true;
+    }
+  }
+  simplify_hash_set_t edges;
+  simplify_hash_set_init(&edges, index_count);
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint64_t a = position_remap[destination[i]];
+    const uint64_t b = position_remap[destination[i - i % 3 + (i + 1) % 3]];
+    simplify_hash_set_find(&edges, (a << 32 | b) + 1, true);
+  }
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t v0 = destination[i];
+    const uint32_t v1 = destination[i - i % 3 + (i + 1) % 3];
+    const uint64_t a  = position_remap[v0];
+    const uint64_t b  = position_remap[v1];
+    if (simplify_hash_set_find(&edges, (b << 32 | a) + 1, false) == NULL) {
+      locked[v0] = true;
+      locked[v1] = true;
+    }
+  }
+  free(edges.keys);
+  free(position_remap);
+
+  /* Quadrics of the area weighted triangle planes */
+  simplify_quadric_t* quadrics
+    = (simplify_quadric_t*)calloc(vertex_count, sizeof(simplify_quadric_t));
+  for (size_t i = 0; i < index_count; i += 3) {
+    const float* p0 = &positions[destination[i + 0] * 3];
+    float n[3];
+    simplify_triangle_normal(p0, &positions[destination[i + 1] * 3],
+                             &positions[destination[i + 2] * 3], n);
+    const double length
+      = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+    if (length <= 0.0) {
+      continue;
+    }
+    const double plane[4] = {
+      n[0] / length,
+      n[1] / length,
+      n[2] / length,
+      -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]) / length,
+    };
+    for (uint32_t k = 0; k < 3; ++k) {
+      simplify_quadric_add_plane(&quadrics[destination[i + k]], plane,
+                                 length * 0.5);
+    }
+  }
+
+  const double error_limit = (double)target_error * target_error;
+  double max_error         = 0.0;
+  uint32_t* adjacency_offsets
+    = (uint32_t*)malloc((vertex_count + 1) * sizeof(uint32_t));
+  uint32_t* adjacency = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+  uint32_t* collapse_remap
+    = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+  bool* touched = (bool*)malloc(vertex_count * sizeof(bool));
+  simplify_collapse_t* collapses
+    = (simplify_collapse_t*)malloc(index_count * sizeof(simplify_collapse_t));
+
+  /* Each pass collapses the cheapest independent edges */
+  while (index_count > target_index_count) {
+    /* Vertex-triangle adjacency of the current triangles */
+    memset(adjacency_offsets, 0, (vertex_count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < index_count; ++i) {
+      ++adjacency_offsets[destination[i] + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v) {
+      adjacency_offsets[v + 1] += adjacency_offsets[v];
+    }
+    for (size_t i = 0; i < index_count; ++i) {
+      adjacency[adjacency_offsets[destination[i]]++] = (uint32_t)(i / 3);
+    }
+    for (size_t v = vertex_count; v > 0; --v) {
+      adjacency_offsets[v] = adjacency_offsets[v - 1];
+    }
+    adjacency_offsets[0] = 0;
+
+    /* Candidate collapses of the edges, the moved vertex must be unlocked */
+    size_t collapse_count = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+      const uint32_t v0 = destination[i];
+      const uint32_t v1 = destination[i - i % 3 + (i + 1) % 3];
+      if (!locked[v0]) {
+        collapses[collapse_count++] = (simplify_collapse_t){
+          .v0   = v0,
+          .v1   = v1,
+          .cost = (float)simplify_quadric_error(&quadrics[v0], &quadrics[v1],
+                                                &positions[v1 * 3]),
+        };
+      }
+    }
+    qsort(collapses, collapse_count, sizeof(simplify_collapse_t),
+          simplify_collapse_compare);
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+      collapse_remap[v] = (uint32_t)v;
+    }
+    memset(touched, 0, vertex_count * sizeof(bool));
+    const size_t goal     = (index_count - target_index_count) / 3 + 1;
+    size_t removed        = 0;
+    size_t collapses_done = 0;
+    for (size_t c = 0; c < collapse_count && removed < goal; ++c) {
+      const simplify_collapse_t* collapse = &collapses[c];
+      if (collapse->cost > error_limit) {
+        break;
+      }
+      const uint32_t v0 = collapse->v0, v1 = collapse->v1;
+      if (touched[v0] || touched[v1]
+          || simplify_collapse_flips(positions, destination, adjacency_offsets,
+                                     adjacency, v0, v1)) {
+        continue;
+      }
+      /* The triangles around v0 change, their vertices wait for the next
+       * pass */
+      for (uint32_t a = adjacency_offsets[v0]; a < adjacency_offsets[v0 + 1];
+           ++a) {
+        const uint32_t* triangle = &destination[adjacency[a] * 3];
+        removed
+          += (triangle[0] == v1 || triangle[1] == v1 || triangle[2] == v1);
+        for (uint32_t k = 0; k < 3; ++k) {
+          touched[triangle[k]] = true;
+        }
+      }
+      collapse_remap[v0] = v1;
+      simplify_quadric_merge(&quadrics[v1], &quadrics[v0]);
+      max_error = MAX(max_error, (double)collapse->cost);
+      ++collapses_done;
+    }
+    if (collapses_done == 0) {
+      break;
+    }
+
+    for (size_t i = 0; i < index_count; ++i) {
+      destination[i] = collapse_remap[destination[i]];
+    }
+    index_count = simplify_remove_degenerate(destination, index_count);
+  }
+
+  free(collapses);
+  free(touched);
+  free(collapse_remap);
+  free(adjacency);
+  free(adjacency_offsets);
+  free(quadrics);
+  free(locked);
+  free(positions);
+
+  if (result_error != NULL) {
+    *result_error = (float)sqrt(max_error);
+  }
+  return index_count;
+}
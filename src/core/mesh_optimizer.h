@@ -0,0 +1,102 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Overdraw threshold, maximum allowed vertex cache degradation (5%) */
+#define MESH_OPTIMIZER_DEFAULT_OVERDRAW_THRESHOLD 1.05f
+
+/**
+ * @brief Reorders the triangles of an indexed triangle list in place for the
+ * locality of the post-transform vertex cache (Tom Forsyth, "Linear-Speed
+ * Vertex Cache Optimisation").
+ * @param indices the triangle list, index_count / 3 triangles
+ * @param vertex_count the number of vertices referenced by the indices
+ */
+void mesh_optimizer_optimize_vertex_cache(uint32_t* indices,
+                                          size_t index_count,
+                                          size_t vertex_count);
+
+/**
+ * @brief Reorders the triangles of a vertex cache optimized triangle list in
+ * place to reduce overdraw (Sander et al., "Fast Triangle Reordering for
+ * Vertex Locality and Reduced Overdraw"). The triangles are split into
+ * clusters which are sorted so that outward-facing clusters are drawn first.
+ * @param vertex_positions the vertex positions (3 floats per vertex)
+ * @param vertex_positions_stride the distance between positions in bytes
+ * @param threshold how much the vertex cache efficiency may degrade, e.g.
+ * MESH_OPTIMIZER_DEFAULT_OVERDRAW_THRESHOLD
+ */
+void mesh_optimizer_optimize_overdraw(uint32_t* indices, size_t index_count,
+                                      const float* vertex_positions,
+                                      size_t vertex_count,
+                                      size_t vertex_positions_stride,
+                                      float threshold);
+
+/**
+ * @brief Reorders the vertices in place in the order of their first use by the
+ * indices and remaps the indices, which improves the vertex fetch locality.
+ * Vertices not referenced by the indices are moved to the end.
+ * @param vertices the vertex data, vertex_count * vertex_size bytes
+ */
+void mesh_optimizer_optimize_vertex_fetch(void* vertices, uint32_t* indices,
+                                          size_t index_count,
+                                          size_t vertex_count,
+                                          size_t vertex_size);
+
+/**
+ * @brief Meshlet: a cluster of neighbouring triangles with bounds for culling.
+ * The triangles of a meshlet are a contiguous range of the triangle list.
+ */
+typedef struct mesh_optimizer_meshlet_t {
+  uint32_t first_index; /* first index of the meshlet in the triangle list */
+  uint32_t index_count;
+  float center[3]; /* bounding sphere */
+  float radius;
+  float cone_axis[3]; /* normal cone, average triangle normal */
+  float cone_cutoff;  /* sine of the cone angle, 1 = the cone can't be culled */
+} mesh_optimizer_meshlet_t;
+
+/**
+ * @brief Splits an indexed triangle list into meshlets, the triangle order
+ * should be optimized for the vertex cache before (neighbouring triangles end
+ * up in the same meshlet). A meshlet is backfacing for a camera at position p
+ * if dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius.
+ * @param meshlets receives the meshlet array, has to be freed by the caller
+ * @param max_vertices the maximum number of unique vertices per meshlet
+ * @param max_triangles the maximum number of triangles per meshlet
+ * @return the number of meshlets
+ */
+size_t mesh_optimizer_build_meshlets(mesh_optimizer_meshlet_t** meshlets,
+                                     const uint32_t* indices,
+                                     size_t index_count,
+                                     const float* vertex_positions,
+                                     size_t vertex_positions_stride,
+                                     size_t max_vertices,
+                                     size_t max_triangles);
+
+/**
+ * @brief Simplifies an indexed triangle list by collapsing edges in the order
+ * of their quadric error (Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics"). Only the indices are reduced, a vertex is moved
+ * onto a neighbouring vertex, so the simplified lists share the vertices of
+ * the original one. Vertices on open borders and attribute seams (several
+ * vertices at the same position) are locked.
+ * @param destination receives the simplified triangle list, index_count
+ * entries
+ * @param target_index_count the index count to reach if the error allows it
+ * @param target_error the maximum error relative to the mesh extent, e.g. 0.01
+ * @param result_error receives the error of the result relative to the mesh
+ * extent, can be NULL
+ * @return the number of indices written to destination
+ */
+size_t mesh_optimizer_simplify(uint32_t* destination, const uint32_t* indices,
+                               size_t index_count,
+                               const float* vertex_positions,
+                               size_t vertex_count,
+                               size_t vertex_positions_stride,
+                               size_t target_index_count, float target_error,
+                               float* result_error);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef PLATFORM_H
 #define PLATFORM_H
 
+#include <stdint.h>
+
 /* date class */
 typedef struct date_t {
   int msec;
@@ -19,5 +21,10 @@ void initialize_default_path(void);
 /* misc platform functions */
 void get_local_time(date_t* current_date);
 float platform_get_time(void);
+/* Monotonic time in nanoseconds, full precision for timestamps */
+uint64_t platform_get_time_ns(void);
+/* Sleeps until the platform_get_time_ns() deadline, the wake-up can be late
+ * by the scheduler granularity */
+void platform_sleep_until_ns(uint64_t deadline_ns);
 
 #endif
@@ -0,0 +1,289 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "macro.h"
+
+#define THREAD_POOL_MAX_THREAD_COUNT 32u
+#define THREAD_POOL_CACHE_LINE_SIZE 64u
+/* More chunks than threads balance the load of uneven chunks */
+#define THREAD_POOL_CHUNKS_PER_THREAD 4u
+
+typedef struct thread_pool_job_t {
+  thread_pool_job_func_t func;
+  void* arg;
+} thread_pool_job_t;
+
+/**
+ * @brief Thread pool class
+ */
+struct thread_pool {
+  pthread_t threads[THREAD_POOL_MAX_THREAD_COUNT];
+  uint32_t thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t job_available;
+  pthread_cond_t jobs_finished;
+  /* Ring buffer of queued jobs */
+  thread_pool_job_t* jobs;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t queued_count;
+  /* Queued and running jobs */
+  uint32_t pending_count;
+  bool shutdown;
+};
+
+static void* thread_pool_worker_main(void* arg)
+{
+  thread_pool_t* thread_pool = (thread_pool_t*)arg;
+
+  pthread_mutex_lock(&thread_pool->mutex);
+  while (true) {
+    while (thread_pool->queued_count == 0 && !thread_pool->shutdown) {
+      pthread_cond_wait(&thread_pool->job_available, &thread_pool->mutex);
+    }
+    if (thread_pool->queued_count == 0) {
+      /* Shutdown and no jobs left */
+      break;
+    }
+    thread_pool_job_t job = thread_pool->jobs[thread_pool->head];
+    thread_pool->head     = (thread_pool->head + 1) % thread_pool->capacity;
+    --thread_pool->queued_count;
+    pthread_mutex_unlock(&thread_pool->mutex);
+
+    job.func(job.arg);
+
+    pthread_mutex_lock(&thread_pool->mutex);
+    if (--thread_pool->pending_count == 0) {
+      pthread_cond_broadcast(&thread_pool->jobs_finished);
+    }
+  }
+  pthread_mutex_unlock(&thread_pool->mutex);
+
+  return NULL;
+}
+
+/* thread pool creating/releasing */
+
+thread_pool_t* thread_pool_create(uint32_t thread_count)
+{
+  if (thread_count == 0) {
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count         = cpu_count > 0 ? (uint32_t)cpu_count : 1u;
+  }
+  thread_count = MIN(thread_count, THREAD_POOL_MAX_THREAD_COUNT);
+
+  thread_pool_t* thread_pool = (thread_pool_t*)malloc(sizeof(thread_pool_t));
+  memset(thread_pool, 0, sizeof(thread_pool_t));
+
+  thread_pool->capacity = 64u;
+  thread_pool->jobs     = (thread_pool_job_t*)calloc(thread_pool->capacity,
+                                                   sizeof(thread_pool_job_t));
+  pthread_mutex_init(&thread_pool->mutex, NULL);
+  pthread_cond_init(&thread_pool->job_available, NULL);
+  pthread_cond_init(&thread_pool->jobs_finished, NULL);
+
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    if (pthread_create(&thread_pool->threads[i], NULL, thread_pool_worker_main,
+                       thread_pool)
+        != 0) {
+      log_error("Could not create worker thread %u\n", i);
+      break;
+    }
+    ++thread_pool->thread_count;
+  }
+
+  return thread_pool;
+}
+
+void thread_pool_release(thread_pool_t* thread_pool)
+{
+  if (thread_pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&thread_pool->mutex);
+  thread_pool->shutdown = true;
+  pthread_cond_broadcast(&thread_pool->job_available);
+  pthread_mutex_unlock(&thread_pool->mutex);
+  for (uint32_t i = 0; i < thread_pool->thread_count; ++i) {
+    pthread_join(thread_pool->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&thread_pool->jobs_finished);
+  pthread_cond_destroy(&thread_pool->job_available);
+  pthread_mutex_destroy(&thread_pool->mutex);
+  free(thread_pool->jobs);
+  free(thread_pool);
+}
+
+/* job submission */
+
+static void thread_pool_grow_queue(thread_pool_t* thread_pool)
+{
+  const uint32_t capacity = thread_pool->capacity * 2;
+  thread_pool_job_t* jobs
+    = (thread_pool_job_t*)calloc(capacity, sizeof(thread_pool_job_t));
+  for (uint32_t i = 0; i < thread_pool->queued_count; ++i) {
+    jobs[i]
+      = thread_pool->jobs[(thread_pool->head + i) % thread_pool->capacity];
+  }
+  free(thread_pool->jobs);
+  thread_pool->jobs     = jobs;
+  thread_pool->capacity = capacity;
+  thread_pool->head     = 0;
+}
+
+void thread_pool_submit(thread_pool_t* thread_pool, thread_pool_job_func_t func,
+                        void* arg)
+{
+  ASSERT(thread_pool && func);
+
+  if (thread_pool->thread_count == 0) {
+    /* No worker threads, execute the job on the calling thread */
+    func(arg);
+    return;
+  }
+
+  pthread_mutex_lock(&thread_pool->mutex);
+  if (thread_pool->queued_count == thread_pool->capacity) {
+    thread_pool_grow_queue(thread_pool);
+  }
+  const uint32_t tail
+    = (thread_pool->head + thread_pool->queued_count) % thread_pool->capacity;
+  thread_pool->jobs[tail] = (thread_pool_job_t){
+    .func = func,
+    .arg  = arg,
+  };
+  ++thread_pool->queued_count;
+  ++thread_pool->pending_count;
+  pthread_cond_signal(&thread_pool->job_available);
+  pthread_mutex_unlock(&thread_pool->mutex);
+}
+
+void thread_pool_wait(thread_pool_t* thread_pool)
+{
+  pthread_mutex_lock(&thread_pool->mutex);
+  while (thread_pool->pending_count > 0) {
+    pthread_cond_wait(&thread_pool->jobs_finished, &thread_pool->mutex);
+  }
+  pthread_mutex_unlock(&thread_pool->mutex);
+}
+
+uint32_t thread_pool_get_thread_count(thread_pool_t* thread_pool)
+{
+  return thread_pool->thread_count;
+}
+
+/* parallel for */
+
+typedef struct thread_pool_parallel_for_t {
+  thread_pool_range_func_t func;
+  void* arg;
+  uint32_t count;
+  uint32_t chunk_size;
+  uint32_t chunk_count;
+  uint32_t next_chunk; /* atomic */
+  /* Helper jobs which did not finish yet */
+  uint32_t running_helpers;
+  pthread_mutex_t mutex;
+  pthread_cond_t helpers_finished;
+} thread_pool_parallel_for_t;
+
+static void thread_pool_run_chunks(thread_pool_parallel_for_t* parallel_for)
+{
+  uint32_t chunk = 0;
+  while ((chunk = __atomic_fetch_add(&parallel_for->next_chunk, 1,
+                                     __ATOMIC_RELAXED))
+         < parallel_for->chunk_count) {
+    const uint32_t begin = chunk * parallel_for->chunk_size;
+    const uint32_t end
+      = MIN(begin + parallel_for->chunk_size, parallel_for->count);
+    parallel_for->func(parallel_for->arg, begin, end);
+  }
+}
+
+static void thread_pool_parallel_for_helper(void* arg)
+{
+  thread_pool_parallel_for_t* parallel_for = (thread_pool_parallel_for_t*)arg;
+
+  thread_pool_run_chunks(parallel_for);
+
+  pthread_mutex_lock(&parallel_for->mutex);
+  if (--parallel_for->running_helpers == 0) {
+    pthread_cond_signal(&parallel_for->helpers_finished);
+  }
+  pthread_mutex_unlock(&parallel_for->mutex);
+}
+
+static uint32_t thread_pool_gcd(uint32_t a, uint32_t b)
+{
+  while (b != 0) {
+    const uint32_t t = a % b;
+    a                = b;
+    b                = t;
+  }
+  return a;
+}
+
+void thread_pool_parallel_for(thread_pool_t* thread_pool, uint32_t count,
+                              uint32_t element_size,
+                              thread_pool_range_func_t func, void* arg)
+{
+  ASSERT(func);
+
+  if (count == 0) {
+    return;
+  }
+
+  /* Number of elements which fill whole cache lines */
+  const uint32_t granularity
+    = THREAD_POOL_CACHE_LINE_SIZE
+      / thread_pool_gcd(MAX(element_size, 1u), THREAD_POOL_CACHE_LINE_SIZE);
+  const uint32_t thread_count
+    = (thread_pool != NULL) ? thread_pool->thread_count : 0;
+  const uint32_t target_chunk_count
+    = (thread_count + 1) * THREAD_POOL_CHUNKS_PER_THREAD;
+  uint32_t chunk_size = (count + target_chunk_count - 1) / target_chunk_count;
+  chunk_size = ((chunk_size + granularity - 1) / granularity) * granularity;
+  const uint32_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+  /* The calling thread processes chunks as well */
+  const uint32_t helper_count = MIN(thread_count, chunk_count - 1);
+  if (helper_count == 0) {
+    func(arg, 0, count);
+    return;
+  }
+
+  thread_pool_parallel_for_t parallel_for = {
+    .func            = func,
+    .arg             = arg,
+    .count           = count,
+    .chunk_size      = chunk_size,
+    .chunk_count     = chunk_count,
+    .next_chunk      = 0,
+    .running_helpers = helper_count,
+  };
+  pthread_mutex_init(&parallel_for.mutex, NULL);
+  pthread_cond_init(&parallel_for.helpers_finished, NULL);
+
+  for (uint32_t i = 0; i < helper_count; ++i) {
+    thread_pool_submit(thread_pool, thread_pool_parallel_for_helper,
+                       &parallel_for);
+  }
+  thread_pool_run_chunks(&parallel_for);
+
+  /* The helpers reference the state on this stack */
+  pthread_mutex_lock(&parallel_for.mutex);
+  while (parallel_for.running_helpers > 0) {
+    pthread_cond_wait(&parallel_for.helpers_finished, &parallel_for.mutex);
+  }
+  pthread_mutex_unlock(&parallel_for.mutex);
+
+  pthread_cond_destroy(&parallel_for.helpers_finished);
+  pthread_mutex_destroy(&parallel_for.mutex);
+}
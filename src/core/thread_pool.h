@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Fixed-size pool of worker threads executing jobs from a FIFO queue.
+ * Jobs must not touch the WebGPU device, the device is used from the main
+ * thread only.
+ */
+typedef struct thread_pool thread_pool_t;
+
+typedef void (*thread_pool_job_func_t)(void* arg);
+
+/* thread pool creating/releasing */
+/**
+ * @brief Creates a thread pool.
+ * @param thread_count the number of worker threads, 0 = number of CPU cores
+ */
+thread_pool_t* thread_pool_create(uint32_t thread_count);
+/* Finishes all submitted jobs before the worker threads are joined */
+void thread_pool_release(thread_pool_t* thread_pool);
+
+/* job submission */
+void thread_pool_submit(thread_pool_t* thread_pool, thread_pool_job_func_t func,
+                        void* arg);
+/* Blocks until all submitted jobs are finished */
+void thread_pool_wait(thread_pool_t* thread_pool);
+
+uint32_t thread_pool_get_thread_count(thread_pool_t* thread_pool);
+
+/* parallel for */
+typedef void (*thread_pool_range_func_t)(void* arg, uint32_t begin,
+                                         uint32_t end);
+
+/**
+ * @brief Calls func for chunks of the range [0, count) on the worker threads
+ * and the calling thread, returns once the whole range is processed. The
+ * chunks of an array of element_size byte elements cover whole cache lines, so
+ * no two threads write the same cache line if the array starts on a cache
+ * line. Waits only for its own chunks, other jobs of the pool delay but do not
+ * block the caller.
+ * @param thread_pool the worker threads, NULL runs the range on the calling
+ * thread
+ */
+void thread_pool_parallel_for(thread_pool_t* thread_pool, uint32_t count,
+                              uint32_t element_size,
+                              thread_pool_range_func_t func, void* arg);
+
+#endif
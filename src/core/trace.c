@@ -0,0 +1,230 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "macro.h"
+#include "platform.h"
+
+#define TRACE_MAX_THREADS 32u
+#define TRACE_INITIAL_CAPACITY 4096u
+
+typedef struct trace_event_t {
+  char name[TRACE_EVENT_NAME_SIZE];
+  uint32_t track;
+  uint64_t begin_ns;
+  uint64_t duration_ns;
+} trace_event_t;
+
+/* Trace session, the mutex guards all members */
+static struct {
+  pthread_mutex_t mutex;
+  bool enabled;
+  bool overflowed;
+  char filename[STRMAX];
+  uint64_t start_ns;
+  trace_event_t* events;
+  uint32_t event_count;
+  uint32_t capacity;
+  /* Threads by track, the thread starting the session gets track 1 */
+  pthread_t threads[TRACE_MAX_THREADS];
+  uint32_t thread_count;
+} trace = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* trace session */
+
+bool trace_begin_session(const char* filename)
+{
+  if (filename == NULL || filename[0] == '\0') {
+    return false;
+  }
+
+  pthread_mutex_lock(&trace.mutex);
+  const bool was_enabled = trace.enabled;
+  if (!was_enabled) {
+    snprintf(trace.filename, sizeof(trace.filename), "%s", filename);
+    trace.start_ns     = platform_get_time_ns();
+    trace.capacity     = TRACE_INITIAL_CAPACITY;
+    trace.events       = (trace_event_t*)malloc(trace.capacity
+                                                * sizeof(trace_event_t));
+    trace.event_count  = 0;
+    trace.overflowed   = false;
+    trace.threads[0]   = pthread_self();
+    trace.thread_count = 1;
+    trace.enabled      = true;
+  }
+  pthread_mutex_unlock(&trace.mutex);
+
+  if (was_enabled) {
+    log_warn("Trace session already active, ignoring '%s'\n", filename);
+    return false;
+  }
+  return true;
+}
+
+static void write_json_string(FILE* file, const char* str)
+{
+  fputc('"', file);
+  for (; *str != '\0'; ++str) {
+    if (*str == '"' || *str == '\\') {
+      fputc('\\', file);
+      fputc(*str, file);
+    }
+    else if ((unsigned char)*str >= 0x20) {
+      fputc(*str, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void write_thread_name(FILE* file, uint32_t track, const char* name)
+{
+  fprintf(file,
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+          "\"args\":{\"name\":",
+          track);
+  write_json_string(file, name);
+  fprintf(file, "}},\n");
+}
+
+static bool write_trace_file(void)
+{
+  FILE* file = fopen(trace.filename, "w");
+  if (file == NULL) {
+    log_error("Unable to open trace file '%s'\n", trace.filename);
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  char thread_name[STRMAX];
+  for (uint32_t i = 0; i < trace.thread_count; ++i) {
+    if (i == 0) {
+      snprintf(thread_name, sizeof(thread_name), "Main thread");
+    }
+    else {
+      snprintf(thread_name, sizeof(thread_name), "Thread %u", i);
+    }
+    write_thread_name(file, i + 1, thread_name);
+  }
+  write_thread_name(file, TRACE_TRACK_GPU, "GPU");
+  for (uint32_t i = 0; i < trace.event_count; ++i) {
+    const trace_event_t* event = &trace.events[i];
+    /* Times are in microseconds since the start of the session */
+    const uint64_t begin_ns
+      = event->begin_ns > trace.start_ns ? event->begin_ns - trace.start_ns :
+                                           0;
+    fprintf(file, "{\"name\":");
+    write_json_string(file, event->name);
+    fprintf(file,
+            ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            event->track == TRACE_TRACK_GPU ? "gpu" : "cpu", event->track,
+            (double)begin_ns / 1000.0, (double)event->duration_ns / 1000.0,
+            (i + 1 < trace.event_count) ? "," : "");
+  }
+  fprintf(file, "]}\n");
+
+  fclose(file);
+  return true;
+}
+
+void trace_end_session(void)
+{
+  pthread_mutex_lock(&trace.mutex);
+  if (trace.enabled) {
+    trace.enabled = false;
+    if (write_trace_file()) {
+      log_info("Trace with %u events written to '%s'\n", trace.event_count,
+               trace.filename);
+    }
+    free(trace.events);
+    trace.events      = NULL;
+    trace.event_count = 0;
+    trace.capacity    = 0;
+  }
+  pthread_mutex_unlock(&trace.mutex);
+}
+
+bool trace_is_enabled(void)
+{
+  pthread_mutex_lock(&trace.mutex);
+  const bool enabled = trace.enabled;
+  pthread_mutex_unlock(&trace.mutex);
+  return enabled;
+}
+
+uint64_t trace_get_time_ns(void)
+{
+  return platform_get_time_ns();
+}
+
+/* scope recording */
+
+/* Track of the calling thread, the mutex has to be locked */
+static uint32_t get_thread_track(void)
+{
+  const pthread_t self = pthread_self();
+  for (uint32_t i = 0; i < trace.thread_count; ++i) {
+    if (pthread_equal(trace.threads[i], self)) {
+      return i + 1;
+    }
+  }
+  if (trace.thread_count < TRACE_MAX_THREADS) {
+    trace.threads[trace.thread_count++] = self;
+    return trace.thread_count;
+  }
+  /* Share the last track when there are too many threads */
+  return TRACE_MAX_THREADS;
+}
+
+uint64_t trace_begin(void)
+{
+  return trace_is_enabled() ? platform_get_time_ns() : 0;
+}
+
+void trace_end(const char* name, uint64_t begin_ns)
+{
+  if (begin_ns == 0) {
+    return;
+  }
+  const uint64_t end_ns = platform_get_time_ns();
+  trace_add_event(name, 0, begin_ns, end_ns > begin_ns ? end_ns - begin_ns : 0);
+}
+
+void trace_add_event(const char* name, uint32_t track, uint64_t begin_ns,
+                     uint64_t duration_ns)
+{
+  pthread_mutex_lock(&trace.mutex);
+  if (!trace.enabled) {
+    pthread_mutex_unlock(&trace.mutex);
+    return;
+  }
+
+  if (trace.event_count == trace.capacity) {
+    if (trace.capacity >= TRACE_MAX_EVENTS) {
+      if (!trace.overflowed) {
+        log_warn("Trace is full, dropping the events after %u events\n",
+                 trace.event_count);
+        trace.overflowed = true;
+      }
+      pthread_mutex_unlock(&trace.mutex);
+      return;
+    }
+    trace.capacity = MIN(trace.capacity * 2, TRACE_MAX_EVENTS);
+    trace.events   = (trace_event_t*)realloc(
+      trace.events, trace.capacity * sizeof(trace_event_t));
+  }
+
+  trace_event_t* event = &trace.events[trace.event_count++];
+  snprintf(event->name, TRACE_EVENT_NAME_SIZE, "%s", name ? name : "");
+  event->track       = track != 0 ? track : get_thread_track();
+  event->begin_ns    = begin_ns;
+  event->duration_ns = duration_ns;
+
+  pthread_mutex_unlock(&trace.mutex);
+}
@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_EVENT_NAME_SIZE 32u
+/* Recording stops when the session holds this many events */
+#define TRACE_MAX_EVENTS (1u << 20)
+/* Track of the GPU scopes, the CPU threads use the tracks 1, 2, ... */
+#define TRACE_TRACK_GPU 1000u
+
+/**
+ * @brief Recorder of CPU and GPU timeline events, written as Chrome trace
+ * event JSON which is opened by chrome://tracing and ui.perfetto.dev.
+ *
+ * Each thread recording scopes gets its own track. The scopes are recorded as
+ * complete events, so nested scopes and scopes of loader threads need no
+ * begin / end bookkeeping:
+ *
+ *   TRACE_SCOPE("gltf_load") {
+ *     model = wgpu_gltf_model_load_from_file(&load_options);
+ *   }
+ *
+ * Leaving a TRACE_SCOPE block with break, return or goto drops its event, use
+ * trace_begin() / trace_end() around code with early exits. All functions are
+ * thread safe and return immediately when no session is active.
+ */
+
+/* trace session */
+/* Starts recording, the events are written to filename at the end */
+bool trace_begin_session(const char* filename);
+/* Writes the recorded events and stops recording */
+void trace_end_session(void);
+bool trace_is_enabled(void);
+
+/* Monotonic time of the trace timeline in nanoseconds */
+uint64_t trace_get_time_ns(void);
+
+/* scope recording */
+/* Returns the begin time passed to trace_end(), 0 without active session */
+uint64_t trace_begin(void);
+void trace_end(const char* name, uint64_t begin_ns);
+
+/**
+ * @brief Adds an event with a given begin time and duration, e.g. a GPU scope
+ * measured with timestamp queries.
+ * @param track TRACE_TRACK_GPU or 0 for the track of the calling thread
+ */
+void trace_add_event(const char* name, uint32_t track, uint64_t begin_ns,
+                     uint64_t duration_ns);
+
+#define TRACE_SCOPE(name)                                                      \
+  for (uint64_t trace_begin_ns_ = trace_begin(), trace_once_ = 1; trace_once_; \
+       trace_once_ = 0, trace_end(name, trace_begin_ns_))
+
+#endif
@@ -1,43 +1,157 @@
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/hwcontext.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/time.h>
 #include <libswscale/swscale.h>
-#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "macro.h"
+#include "video_decode.h"
+
+/* write every decoded RGBA frame to a PPM file */
+#define VIDEO_DECODE_DEBUG_FRAMES 0
 
 /*
- * control play speed.
- *   0.1: 10 times slower
- *   1.0: play on normal speed.
- *   2.0: two times faster
+ * Decoded frames are handed to the renderer through a lock-free triple buffer.
+ * The decode job owns the back slot, the render thread owns the front slot
+ * and the third slot holds the latest complete frame. Each side swaps its
+ * slot with the latest slot atomically, neither side blocks or copies.
  */
-#define PLAY_SPEED (1.0);
+#define VIDEO_FRAME_SLOT_COUNT 3
+#define VIDEO_FRAME_SLOT_MASK 0x3u
+#define VIDEO_FRAME_SLOT_NEW 0x4u /* latest slot not yet picked up */
 
-static struct video_decode_state_t {
-  pthread_t decode_thread;
+typedef struct video_frame_slot_t {
+  void* data;
+  int64_t pts_us;
+  uint64_t index;
+} video_frame_slot_t;
+
+struct video_decoder {
   AVFormatContext* fmt_ctx;
   AVCodecContext* dec_ctx;
   AVStream* video_st;
   int video_stream_index;
   int video_w, video_h;
   int crop_w, crop_h;
-  unsigned int video_fmt;
-  int64_t duration_base;
-  void* decode_buf;
-} s_state = {
-  .fmt_ctx            = NULL,
-  .dec_ctx            = NULL,
-  .video_st           = NULL,
-  .video_stream_index = -1,
-  .decode_buf         = NULL,
+  AVBufferRef* hw_device_ctx;
+  enum AVPixelFormat hw_pix_fmt;
+  struct SwsContext* sws_ctx;
+  uint8_t* rgb_buffer;
+  AVFrame* frame;
+  AVFrame* framergb;
+  AVFrame* sw_frame;
+  AVPacket* packet;
+  video_frame_info_t frame_info;
+  size_t frame_size;
+  /* decode job state */
+  int draining;
+  int64_t loop_offset_us;
+  int64_t last_pts_us;
+  int64_t frame_duration_us;
+  uint64_t frame_index;
+  /* playback, the clock runs play_speed times faster than real time */
+  thread_pool_t* thread_pool;
+  bool owns_thread_pool;
+  float play_speed;
+  int64_t clock_base_us;
+  bool started;
+  /* frame slots */
+  video_frame_slot_t frames[VIDEO_FRAME_SLOT_COUNT];
+  uint32_t back_slot;   /* decode job */
+  uint32_t latest_slot; /* shared, slot index | VIDEO_FRAME_SLOT_NEW */
+  uint32_t front_slot;  /* render thread */
+  bool front_valid;
+  bool frame_acquired;
+  /* shared between the decode job and the render thread */
+  uint32_t job_running;
+  uint32_t failed;
+  uint64_t decoded_frames;
+  uint64_t decode_time_us;
+  /* render thread */
+  uint64_t acquired_frames;
 };
 
-int init_video_decode()
+static char s_default_hwaccel[32] = "none";
+
+int set_video_hwaccel(const char* name)
+{
+  if (name == NULL || strlen(name) >= sizeof(s_default_hwaccel)) {
+    return -1;
+  }
+  strcpy(s_default_hwaccel, name);
+  return 0;
+}
+
+static enum AVPixelFormat get_hw_format(AVCodecContext* ctx,
+                                        const enum AVPixelFormat* pix_fmts)
+{
+  const video_decoder_t* decoder = (const video_decoder_t*)ctx->opaque;
+  for (const enum AVPixelFormat* p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+    if (*p == decoder->hw_pix_fmt) {
+      return *p;
+    }
+  }
+
+  /* frames of the software fallback are repacked into NV12 */
+  fprintf(stderr, "hwaccel surface format not offered, decoding on the CPU\n");
+  return avcodec_default_get_format(ctx, pix_fmts);
+}
+
+/*
+ * Decodes on the GPU if a hwaccel is selected and supports the codec. Only
+ * 8-bit 4:2:0 streams are decoded in hardware, their surfaces are downloaded
+ * as NV12.
+ */
+static int init_hw_decoder(video_decoder_t* decoder, AVCodecContext* dec_ctx,
+                           const AVCodec* dec, const char* hwaccel)
 {
+  if (strcmp(hwaccel, "none") == 0
+      || (dec_ctx->pix_fmt != AV_PIX_FMT_YUV420P
+          && dec_ctx->pix_fmt != AV_PIX_FMT_YUVJ420P)) {
+    return -1;
+  }
+
+  enum AVHWDeviceType type = strcmp(hwaccel, "auto") == 0 ?
+                               AV_HWDEVICE_TYPE_VAAPI :
+                               av_hwdevice_find_type_by_name(hwaccel);
+  if (type == AV_HWDEVICE_TYPE_NONE) {
+    fprintf(stderr, "Unknown hwaccel: %s\n", hwaccel);
+    return -1;
+  }
+
+  for (int i = 0;; i++) {
+    const AVCodecHWConfig* config = avcodec_get_hw_config(dec, i);
+    if (config == NULL) {
+      fprintf(stderr, "Decoder %s does not support %s\n", dec->name,
+              av_hwdevice_get_type_name(type));
+      return -1;
+    }
+    if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)
+        && config->device_type == type) {
+      decoder->hw_pix_fmt = config->pix_fmt;
+      break;
+    }
+  }
+
+  if (av_hwdevice_ctx_create(&decoder->hw_device_ctx, type, NULL, NULL, 0)
+      < 0) {
+    fprintf(stderr, "Could not create %s device\n",
+            av_hwdevice_get_type_name(type));
+    decoder->hw_pix_fmt = AV_PIX_FMT_NONE;
+    return -1;
+  }
+  dec_ctx->hw_device_ctx = av_buffer_ref(decoder->hw_device_ctx);
+  dec_ctx->get_format    = get_hw_format;
+  dec_ctx->opaque        = decoder;
+
   return 0;
 }
 
-int open_video_file(const char* fname)
+static int open_video_file(video_decoder_t* decoder, const char* fname,
+                           const char* hwaccel)
 {
   AVFormatContext* fmt_ctx = NULL;
   AVCodec* dec;
@@ -50,6 +164,7 @@ int open_video_file(const char* fname)
     fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
     return -1;
   }
+  decoder->fmt_ctx = fmt_ctx;
 
   ret = avformat_find_stream_info(fmt_ctx, NULL);
   if (ret < 0) {
@@ -73,8 +188,10 @@ int open_video_file(const char* fname)
     fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
     return AVERROR(ENOMEM);
   }
+  decoder->dec_ctx = dec_ctx;
   avcodec_parameters_to_context(dec_ctx,
                                 fmt_ctx->streams[video_stream_index]->codecpar);
+  const int hw_decode = init_hw_decoder(decoder, dec_ctx, dec, hwaccel) == 0;
 
   /* init the video decoder */
   ret = avcodec_open2(dec_ctx, dec, NULL);
@@ -83,55 +200,192 @@ int open_video_file(const char* fname)
     return ret;
   }
 
-  s_state.fmt_ctx            = fmt_ctx;
-  s_state.dec_ctx            = dec_ctx;
-  s_state.video_st           = fmt_ctx->streams[video_stream_index];
-  s_state.video_stream_index = video_stream_index;
+  decoder->video_st           = fmt_ctx->streams[video_stream_index];
+  decoder->video_stream_index = video_stream_index;
+
+  decoder->video_w = dec_ctx->width;
+  decoder->video_h = dec_ctx->height;
 
-  s_state.video_w   = dec_ctx->width;
-  s_state.video_h   = dec_ctx->height;
-  s_state.video_fmt = s_state.dec_ctx->pix_fmt;
+  /* 4:2:0 output keeps the decoder planes, they are converted on the GPU */
+  video_frame_format_t frame_format = VIDEO_FRAME_FORMAT_RGBA8;
+  if (dec_ctx->pix_fmt == AV_PIX_FMT_YUV420P
+      || dec_ctx->pix_fmt == AV_PIX_FMT_YUVJ420P) {
+    frame_format = VIDEO_FRAME_FORMAT_I420;
+  }
+  if (dec_ctx->pix_fmt == AV_PIX_FMT_NV12 || hw_decode) {
+    frame_format = VIDEO_FRAME_FORMAT_NV12;
+  }
 
 #if 0
-  if (s_video_w > s_video_h) {
-    s_crop_w = s_crop_h = s_video_h;
+  if (decoder->video_w > decoder->video_h) {
+    decoder->crop_w = decoder->crop_h = decoder->video_h;
   }
   else {
-    s_crop_w = s_crop_h = s_video_w;
+    decoder->crop_w = decoder->crop_h = decoder->video_w;
   }
 #else
-  s_state.crop_w = s_state.video_w;
-  s_state.crop_h = s_state.video_h;
+  decoder->crop_w = decoder->video_w;
+  decoder->crop_h = decoder->video_h;
 #endif
 
+  /* cropping is only implemented for RGBA output */
+  if (decoder->crop_w != decoder->video_w
+      || decoder->crop_h != decoder->video_h) {
+    frame_format = VIDEO_FRAME_FORMAT_RGBA8;
+  }
+  const size_t chroma_size
+    = (size_t)((decoder->crop_w + 1) / 2) * ((decoder->crop_h + 1) / 2);
+  decoder->frame_size = (size_t)decoder->crop_w * decoder->crop_h;
+  decoder->frame_size = frame_format == VIDEO_FRAME_FORMAT_RGBA8 ?
+                          decoder->frame_size * 4 :
+                          decoder->frame_size + chroma_size * 2;
+  /* untagged HD streams are BT.709 */
+  const int bt709 = dec_ctx->colorspace == AVCOL_SPC_BT709
+                    || (dec_ctx->colorspace == AVCOL_SPC_UNSPECIFIED
+                        && decoder->video_h >= 720);
+  const int full_range = dec_ctx->pix_fmt == AV_PIX_FMT_YUVJ420P
+                         || dec_ctx->color_range == AVCOL_RANGE_JPEG;
+  decoder->frame_info  = (video_frame_info_t){
+    .format     = frame_format,
+    .width      = decoder->crop_w,
+    .height     = decoder->crop_h,
+    .bt709      = bt709,
+    .full_range = full_range,
+  };
+
+  /* the duration of the last frame separates the loops */
+  const AVRational frame_rate = decoder->video_st->avg_frame_rate;
+  decoder->frame_duration_us
+    = frame_rate.num > 0 ? (int64_t)(1000000 * av_q2d(av_inv_q(frame_rate))) :
+                           40000;
+
   fprintf(stdout, "-------------------------------------------\n");
   fprintf(stdout, " file  : %s\n", fname);
-  fprintf(stdout, " format: %s\n", av_get_pix_fmt_name(s_state.video_fmt));
-  fprintf(stdout, " size  : (%d, %d)\n", s_state.video_w, s_state.video_h);
-  fprintf(stdout, " crop  : (%d, %d)\n", s_state.crop_w, s_state.crop_h);
+  fprintf(stdout, " format: %s\n", av_get_pix_fmt_name(dec_ctx->pix_fmt));
+  fprintf(stdout, " size  : (%d, %d)\n", decoder->video_w, decoder->video_h);
+  fprintf(stdout, " crop  : (%d, %d)\n", decoder->crop_w, decoder->crop_h);
+  const char* decode_name = "software";
+  if (hw_decode) {
+    AVHWDeviceContext* device_ctx
+      = (AVHWDeviceContext*)decoder->hw_device_ctx->data;
+    decode_name = av_hwdevice_get_type_name(device_ctx->type);
+  }
+  fprintf(stdout, " decode: %s\n", decode_name);
+  fprintf(stdout, " output: %s\n",
+          frame_format == VIDEO_FRAME_FORMAT_I420 ? "I420" :
+          frame_format == VIDEO_FRAME_FORMAT_NV12 ? "NV12" :
+                                                    "RGBA");
   fprintf(stdout, "-------------------------------------------\n");
 
   return 0;
 }
 
-int get_video_dimension(int* width, int* height)
+/* Allocates the frames, the packet, the RGBA conversion and the slots */
+static int init_decode_buffers(video_decoder_t* decoder)
 {
-  *width  = s_state.crop_w;
-  *height = s_state.crop_h;
+  decoder->frame    = av_frame_alloc();
+  decoder->framergb = av_frame_alloc();
+  decoder->sw_frame = av_frame_alloc();
+  decoder->packet   = av_packet_alloc();
+  if (decoder->frame == NULL || decoder->framergb == NULL
+      || decoder->sw_frame == NULL || decoder->packet == NULL) {
+    fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+    return -1;
+  }
+
+  /* only RGBA output is converted on the CPU */
+  if (decoder->frame_info.format == VIDEO_FRAME_FORMAT_RGBA8) {
+    int dec_w    = decoder->dec_ctx->width;
+    int dec_h    = decoder->dec_ctx->height;
+    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGBA, dec_w, dec_h, 1);
+
+    decoder->rgb_buffer = (uint8_t*)av_malloc(numBytes * sizeof(uint8_t));
+
+    av_image_fill_arrays(decoder->framergb->data, decoder->framergb->linesize,
+                         decoder->rgb_buffer, AV_PIX_FMT_RGBA, dec_w, dec_h,
+                         1);
+
+    decoder->sws_ctx
+      = sws_getContext(dec_w, dec_h, decoder->dec_ctx->pix_fmt, dec_w, dec_h,
+                       AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    if (decoder->sws_ctx == NULL) {
+      fprintf(stderr, "Cannot initialize the sws context\n");
+      return -1;
+    }
+  }
+
+  /* the render thread may read the latest frame at any time once it has been
+   * published */
+  for (int i = 0; i < VIDEO_FRAME_SLOT_COUNT; i++) {
+    decoder->frames[i].data = malloc(decoder->frame_size);
+    if (decoder->frames[i].data == NULL) {
+      fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+      return -1;
+    }
+  }
 
   return 0;
 }
 
-int get_video_pixformat(int* pixformat)
+video_decoder_t* video_decoder_open(const video_decoder_desc_t* desc)
 {
-  *pixformat = s_state.video_fmt;
-  return 0;
+  video_decoder_t* decoder = (video_decoder_t*)calloc(1, sizeof(*decoder));
+  decoder->video_stream_index = -1;
+  decoder->hw_pix_fmt         = AV_PIX_FMT_NONE;
+  decoder->play_speed  = desc->play_speed > 0.0f ? desc->play_speed : 1.0f;
+  decoder->back_slot   = 0;
+  decoder->latest_slot = 1;
+  decoder->front_slot  = 2;
+
+  const char* hwaccel = desc->hwaccel ? desc->hwaccel : s_default_hwaccel;
+  if (open_video_file(decoder, desc->filename, hwaccel) != 0
+      || init_decode_buffers(decoder) != 0) {
+    video_decoder_release(decoder);
+    return NULL;
+  }
+
+  decoder->thread_pool      = desc->thread_pool;
+  decoder->owns_thread_pool = desc->thread_pool == NULL;
+  if (decoder->owns_thread_pool) {
+    decoder->thread_pool = thread_pool_create(1);
+  }
+
+  return decoder;
 }
 
-int get_video_buffer(void** buf)
+void video_decoder_release(video_decoder_t* decoder)
 {
-  *buf = s_state.decode_buf;
-  return 0;
+  if (decoder == NULL) {
+    return;
+  }
+
+  /* the job does not touch the decoder after clearing the flag */
+  while (__atomic_load_n(&decoder->job_running, __ATOMIC_ACQUIRE)) {
+    av_usleep(1000);
+  }
+  if (decoder->owns_thread_pool && decoder->thread_pool != NULL) {
+    thread_pool_release(decoder->thread_pool);
+  }
+
+  for (int i = 0; i < VIDEO_FRAME_SLOT_COUNT; i++) {
+    free(decoder->frames[i].data);
+  }
+  sws_freeContext(decoder->sws_ctx);
+  av_free(decoder->rgb_buffer);
+  av_packet_free(&decoder->packet);
+  av_frame_free(&decoder->sw_frame);
+  av_frame_free(&decoder->framergb);
+  av_frame_free(&decoder->frame);
+  avcodec_free_context(&decoder->dec_ctx);
+  avformat_close_input(&decoder->fmt_ctx);
+  av_buffer_unref(&decoder->hw_device_ctx);
+  free(decoder);
+}
+
+void video_decoder_get_frame_info(video_decoder_t* decoder,
+                                  video_frame_info_t* info)
+{
+  *info = decoder->frame_info;
 }
 
 static int save_to_ppm(AVFrame* frame, int width, int height, int icnt)
@@ -165,19 +419,15 @@ static int save_to_ppm(AVFrame* frame, int width, int height, int icnt)
   return 0;
 }
 
-static int convert_to_rgba8888(AVFrame* frame, int ofstx, int ofsty, int width,
-                               int height)
+static int convert_to_rgba8888(AVFrame* frame, void* dst, int ofstx, int ofsty,
+                               int width, int height)
 {
-  if (s_state.decode_buf == NULL) {
-    s_state.decode_buf = (unsigned char*)malloc(width * height * 4);
-  }
-
   if (ofstx == 0 && ofsty == 0) {
-    memcpy(s_state.decode_buf, frame->data[0], width * height * 4);
+    memcpy(dst, frame->data[0], width * height * 4);
   }
   else {
     for (int y = 0; y < height; y++) {
-      unsigned char* dst8 = (unsigned char*)s_state.decode_buf + y * width * 4;
+      unsigned char* dst8 = (unsigned char*)dst + y * width * 4;
       unsigned char* src8 = frame->data[0] + (y + ofsty) * frame->linesize[0];
       src8 += ofstx * 4;
 
@@ -192,145 +442,258 @@ static int convert_to_rgba8888(AVFrame* frame, int ofstx, int ofsty, int width,
   return 0;
 }
 
-static int on_frame_decoded(AVFrame* frame, int write_debug_frames)
+static void copy_plane(uint8_t* dst, const uint8_t* src, int src_stride,
+                       int width, int height)
 {
-  int dec_w = s_state.video_w;
-  int dec_h = s_state.video_h;
-  int ofstx = (s_state.video_w - s_state.crop_w) * 0.5f;
-  int ofsty = (s_state.video_h - s_state.crop_h) * 0.5f;
-
-  if (write_debug_frames) {
-    static int i = 0;
-    save_to_ppm(frame, dec_w, dec_h, i++);
+  for (int y = 0; y < height; y++) {
+    memcpy(dst + y * width, src + y * src_stride, width);
   }
-
-  convert_to_rgba8888(frame, ofstx, ofsty, s_state.crop_w, s_state.crop_h);
-
-  return 0;
 }
 
-static void init_duration()
+/* packs the planes of a 4:2:0 frame, Y followed by U and V or UV */
+static int copy_yuv_planes(AVFrame* frame, video_frame_format_t format,
+                           void* dst, int width, int height)
 {
-  s_state.duration_base = av_gettime();
+  const int chroma_w = (width + 1) / 2;
+  const int chroma_h = (height + 1) / 2;
+  uint8_t* dst8      = (uint8_t*)dst;
+
+  copy_plane(dst8, frame->data[0], frame->linesize[0], width, height);
+  dst8 += width * height;
+  if (format == VIDEO_FRAME_FORMAT_NV12 && frame->format != AV_PIX_FMT_NV12) {
+    /* software fallback of the hwaccel, interleave U and V */
+    for (int y = 0; y < chroma_h; y++) {
+      const uint8_t* src_u = frame->data[1] + y * frame->linesize[1];
+      const uint8_t* src_v = frame->data[2] + y * frame->linesize[2];
+      for (int x = 0; x < chroma_w; x++) {
+        *dst8++ = src_u[x];
+        *dst8++ = src_v[x];
+      }
+    }
+  }
+  else if (format == VIDEO_FRAME_FORMAT_NV12) {
+    copy_plane(dst8, frame->data[1], frame->linesize[1], chroma_w * 2,
+               chroma_h);
+  }
+  else {
+    copy_plane(dst8, frame->data[1], frame->linesize[1], chroma_w, chroma_h);
+    dst8 += chroma_w * chroma_h;
+    copy_plane(dst8, frame->data[2], frame->linesize[2], chroma_w, chroma_h);
+  }
+  return 0;
 }
 
-static int64_t get_duration_us()
+/* Makes the back slot the latest frame and continues with the oldest slot */
+static void publish_video_frame(video_decoder_t* decoder, int64_t pts_us)
 {
-  int64_t duration = av_gettime() - s_state.duration_base;
-  return duration;
+  video_frame_slot_t* slot = &decoder->frames[decoder->back_slot];
+  slot->pts_us             = pts_us;
+  slot->index              = decoder->frame_index++;
+  const uint32_t previous
+    = __atomic_exchange_n(&decoder->latest_slot,
+                          decoder->back_slot | VIDEO_FRAME_SLOT_NEW,
+                          __ATOMIC_ACQ_REL);
+  decoder->back_slot = previous & VIDEO_FRAME_SLOT_MASK;
 }
 
-static void sleep_to_pts(AVPacket* packet)
+static int64_t get_frame_pts_us(video_decoder_t* decoder, AVFrame* frame)
 {
-  int64_t pts_us = 0;
-  if (packet->dts != AV_NOPTS_VALUE) {
-    pts_us = packet->dts;
+  if (frame->best_effort_timestamp == AV_NOPTS_VALUE) {
+    return decoder->last_pts_us + decoder->frame_duration_us
+           - decoder->loop_offset_us;
   }
+  return (int64_t)(frame->best_effort_timestamp
+                   * av_q2d(decoder->video_st->time_base) * 1000 * 1000);
+}
 
-  pts_us *= (av_q2d(s_state.video_st->time_base) * 1000 * 1000);
-  pts_us /= PLAY_SPEED;
+static void on_frame_decoded(video_decoder_t* decoder, AVFrame* frame,
+                             int64_t pts_us)
+{
+  int ofstx = (decoder->video_w - decoder->crop_w) * 0.5f;
+  int ofsty = (decoder->video_h - decoder->crop_h) * 0.5f;
 
-  int64_t delay_us = pts_us - get_duration_us();
-  if (delay_us > 0) {
-    av_usleep(delay_us);
+  void* dst = decoder->frames[decoder->back_slot].data;
+  if (decoder->frame_info.format != VIDEO_FRAME_FORMAT_RGBA8) {
+    copy_yuv_planes(frame, decoder->frame_info.format, dst, decoder->crop_w,
+                    decoder->crop_h);
   }
+  else {
+    if (VIDEO_DECODE_DEBUG_FRAMES) {
+      save_to_ppm(frame, decoder->video_w, decoder->video_h,
+                  (int)decoder->frame_index);
+    }
+    convert_to_rgba8888(frame, dst, ofstx, ofsty, decoder->crop_w,
+                        decoder->crop_h);
+  }
+  publish_video_frame(decoder, pts_us);
 }
-static void* decode_thread_main()
+
+/* Downloads hardware frames and converts the RGBA output */
+static AVFrame* get_output_frame(video_decoder_t* decoder)
 {
-  AVFrame* frame    = av_frame_alloc();
-  AVFrame* framergb = av_frame_alloc();
+  AVFrame* frame = decoder->frame;
+  if (decoder->hw_device_ctx != NULL && frame->format == decoder->hw_pix_fmt) {
+    decoder->sw_frame->format = AV_PIX_FMT_NV12;
+    if (av_hwframe_transfer_data(decoder->sw_frame, frame, 0) < 0) {
+      fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+      return NULL;
+    }
+    return decoder->sw_frame;
+  }
+  if (decoder->sws_ctx != NULL) {
+    sws_scale(decoder->sws_ctx, (const uint8_t* const*)frame->data,
+              frame->linesize, 0, frame->height, decoder->framergb->data,
+              decoder->framergb->linesize);
+    return decoder->framergb;
+  }
+  return frame;
+}
 
-  if (frame == NULL || framergb == NULL) {
-    fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
-    return 0;
-  }
-
-  int dec_w    = s_state.dec_ctx->width;
-  int dec_h    = s_state.dec_ctx->height;
-  int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGBA, dec_w, dec_h, 1);
-
-  uint8_t* buffer = (uint8_t*)av_malloc(numBytes * sizeof(uint8_t));
-
-  av_image_fill_arrays(framergb->data, framergb->linesize, buffer,
-                       AV_PIX_FMT_RGBA, dec_w, dec_h, 1);
-
-  struct SwsContext* sws_ctx
-    = sws_getContext(dec_w, dec_h, s_state.dec_ctx->pix_fmt, dec_w, dec_h,
-                     AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
-  if (sws_ctx == NULL) {
-    fprintf(stderr, "Cannot initialize the sws context\n");
-    return 0;
-  }
-
-  while (1) {
-    AVPacket packet;
-    int ret;
-
-    init_duration();
-
-    while (av_read_frame(s_state.fmt_ctx, &packet) >= 0) {
-      if (packet.stream_index == s_state.video_stream_index) {
-        ret = avcodec_send_packet(s_state.dec_ctx, &packet);
-        if (ret < 0) {
-          fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
-          break;
-        }
-
-        while (ret >= 0) {
-          ret = avcodec_receive_frame(s_state.dec_ctx, frame);
-          if (ret == AVERROR(EAGAIN)) {
-            // fprintf (stderr, "retry.\n");
-            break;
-          }
-          else if (ret == AVERROR_EOF) {
-            fprintf(stderr, "EOF.\n");
-            break;
-          }
-          else if (ret < 0) {
-            fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
-            return 0;
-          }
-
-          sws_scale(sws_ctx, (const uint8_t* const*)frame->data,
-                    frame->linesize, 0, dec_h, framergb->data,
-                    framergb->linesize);
-
-          sleep_to_pts(&packet);
-          on_frame_decoded(framergb, 0);
-        }
+/* Decodes the next frame into the back slot and publishes it */
+static void video_decoder_decode_job(void* arg)
+{
+  video_decoder_t* decoder = (video_decoder_t*)arg;
+  const int64_t start_us   = av_gettime_relative();
+  AVFrame* output          = NULL;
+  int failed               = 0;
+  int rewinds              = 0;
+
+  while (output == NULL && !failed) {
+    int ret = avcodec_receive_frame(decoder->dec_ctx, decoder->frame);
+    if (ret == 0) {
+      output = get_output_frame(decoder);
+      failed = output == NULL;
+    }
+    else if (ret == AVERROR_EOF) {
+      /* rewind to restart, a stream without frames stops */
+      if (rewinds++ > 0) {
+        fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        failed = 1;
+        break;
       }
-
-      av_packet_unref(&packet);
+      decoder->loop_offset_us
+        = decoder->last_pts_us + decoder->frame_duration_us;
+      av_seek_frame(decoder->fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+      avcodec_flush_buffers(decoder->dec_ctx);
+      decoder->draining = 0;
     }
-
-    /* flush decoder */
-    ret = avcodec_send_packet(s_state.dec_ctx, &packet);
-    if (ret < 0) {
+    else if (ret != AVERROR(EAGAIN)) {
       fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+      failed = 1;
     }
-
-    while (avcodec_receive_frame(s_state.dec_ctx, frame) == 0) {
-      sws_scale(sws_ctx, (const uint8_t* const*)frame->data, frame->linesize, 0,
-                dec_h, framergb->data, framergb->linesize);
-
-      sleep_to_pts(&packet);
-      on_frame_decoded(framergb, 0);
+    else if (av_read_frame(decoder->fmt_ctx, decoder->packet) < 0) {
+      /* flush decoder */
+      if (decoder->draining
+          || avcodec_send_packet(decoder->dec_ctx, NULL) < 0) {
+        fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        failed = 1;
+      }
+      decoder->draining = 1;
     }
+    else {
+      if (decoder->packet->stream_index == decoder->video_stream_index
+          && avcodec_send_packet(decoder->dec_ctx, decoder->packet) < 0) {
+        fprintf(stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        failed = 1;
+      }
+      av_packet_unref(decoder->packet);
+    }
+  }
+
+  if (output != NULL) {
+    const int64_t pts_us
+      = decoder->loop_offset_us + get_frame_pts_us(decoder, decoder->frame);
+    decoder->last_pts_us = pts_us;
+    on_frame_decoded(decoder, output, pts_us);
+    __atomic_add_fetch(&decoder->decoded_frames, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&decoder->decode_time_us,
+                       (uint64_t)(av_gettime_relative() - start_us),
+                       __ATOMIC_RELAXED);
+  }
+  if (failed) {
+    __atomic_store_n(&decoder->failed, 1, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&decoder->job_running, 0, __ATOMIC_RELEASE);
+}
 
-    /* rewind to restart */
-    av_seek_frame(s_state.fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
-    avcodec_flush_buffers(s_state.dec_ctx);
+/* Decodes the next frame once the latest frame was picked up */
+static void video_decoder_schedule(video_decoder_t* decoder)
+{
+  const uint32_t latest
+    = __atomic_load_n(&decoder->latest_slot, __ATOMIC_ACQUIRE);
+  if (!decoder->started || (latest & VIDEO_FRAME_SLOT_NEW)
+      || __atomic_load_n(&decoder->failed, __ATOMIC_RELAXED)
+      || __atomic_load_n(&decoder->job_running, __ATOMIC_ACQUIRE)) {
+    return;
   }
+  __atomic_store_n(&decoder->job_running, 1, __ATOMIC_RELAXED);
+  thread_pool_submit(decoder->thread_pool, video_decoder_decode_job, decoder);
+}
 
-  av_free(buffer);
-  av_frame_free(&framergb);
-  av_frame_free(&frame);
+static int64_t get_clock_us(video_decoder_t* decoder)
+{
+  return (int64_t)((av_gettime_relative() - decoder->clock_base_us)
+                   * (double)decoder->play_speed);
+}
 
-  return 0;
+void video_decoder_start(video_decoder_t* decoder)
+{
+  decoder->clock_base_us = av_gettime_relative();
+  decoder->started       = true;
+  video_decoder_schedule(decoder);
 }
 
-int start_video_decode()
+int video_decoder_acquire_frame(video_decoder_t* decoder,
+                                video_frame_t* frame)
 {
-  pthread_create(&s_state.decode_thread, NULL, decode_thread_main, NULL);
-  return 0;
+  ASSERT(!decoder->frame_acquired);
+  decoder->frame_acquired = true;
+
+  int is_new            = 0;
+  const uint32_t latest = __atomic_load_n(&decoder->latest_slot,
+                                          __ATOMIC_ACQUIRE);
+  if (latest & VIDEO_FRAME_SLOT_NEW) {
+    const uint32_t latest_slot = latest & VIDEO_FRAME_SLOT_MASK;
+    if (get_clock_us(decoder) >= decoder->frames[latest_slot].pts_us) {
+      /* no decode job runs while the latest frame is new, the front slot
+       * becomes the back slot of the next publish */
+      __atomic_store_n(&decoder->latest_slot, decoder->front_slot,
+                       __ATOMIC_RELEASE);
+      decoder->front_slot  = latest_slot;
+      decoder->front_valid = true;
+      decoder->acquired_frames++;
+      is_new = 1;
+    }
+  }
+  video_decoder_schedule(decoder);
+
+  const video_frame_slot_t* slot = &decoder->frames[decoder->front_slot];
+  *frame                         = (video_frame_t){
+    .data   = decoder->front_valid ? slot->data : NULL,
+    .pts_us = decoder->front_valid ? slot->pts_us : 0,
+    .index  = decoder->front_valid ? slot->index : 0,
+  };
+  return is_new;
+}
+
+void video_decoder_release_frame(video_decoder_t* decoder)
+{
+  ASSERT(decoder->frame_acquired);
+  decoder->frame_acquired = false;
+}
+
+void video_decoder_get_stats(video_decoder_t* decoder,
+                             video_decoder_stats_t* stats)
+{
+  const uint64_t decoded_frames
+    = __atomic_load_n(&decoder->decoded_frames, __ATOMIC_RELAXED);
+  const uint64_t decode_time_us
+    = __atomic_load_n(&decoder->decode_time_us, __ATOMIC_RELAXED);
+  *stats = (video_decoder_stats_t){
+    .decoded_frames  = decoded_frames,
+    .acquired_frames = decoder->acquired_frames,
+    .decode_time_ms  = decoded_frames > 0 ?
+                         (double)decode_time_us / 1000.0 / decoded_frames :
+                         0.0,
+  };
 }
@@ -3,12 +3,92 @@
 
 #include <stdint.h>
 
-int init_video_decode();
-int open_video_file(const char* fname);
-int get_video_dimension(int* width, int* height);
-int get_video_pixformat(uint32_t* pixformat);
-int get_video_buffer(void** buf);
+#include "thread_pool.h"
 
-int start_video_decode();
+typedef enum video_frame_format_t {
+  VIDEO_FRAME_FORMAT_RGBA8, /* packed RGBA */
+  VIDEO_FRAME_FORMAT_I420,  /* Y plane, U plane and V plane */
+  VIDEO_FRAME_FORMAT_NV12,  /* Y plane and interleaved UV plane */
+} video_frame_format_t;
+
+/*
+ * Layout of the decoded frames. The planes of the 4:2:0 formats are tightly
+ * packed, the chroma planes have half the width and height (rounded up).
+ */
+typedef struct video_frame_info_t {
+  video_frame_format_t format;
+  int width, height;
+  int bt709;      /* BT.709 instead of BT.601 color matrix */
+  int full_range; /* full instead of video range */
+} video_frame_info_t;
+
+/*
+ * Selects the hardware decoder of the decoders opened afterwards: "none"
+ * (default), "auto" (VAAPI) or an FFmpeg device type like "vaapi" or "vulkan".
+ * Falls back to software decoding if the device or codec is not supported.
+ */
+int set_video_hwaccel(const char* name);
+
+/* -------------------------------------------------------------------------- *
+ * Video decoder
+ *
+ * Decodes one video stream, the video loops. Frames are decoded one at a time
+ * by jobs on a thread pool, so many decoders can share a few threads. The next
+ * frame is decoded while the current frame is displayed and handed over once
+ * its presentation time is reached.
+ *
+ * The decoder is driven by the render thread: video_decoder_acquire_frame()
+ * picks up due frames and submits the next decode job.
+ * -------------------------------------------------------------------------- */
+
+typedef struct video_decoder video_decoder_t;
+
+typedef struct video_decoder_desc_t {
+  const char* filename;
+  /* Pool running the decode jobs, shared between decoders. NULL creates a
+   * private pool with one thread. */
+  thread_pool_t* thread_pool;
+  /* Hardware decoder, NULL = set_video_hwaccel() selection */
+  const char* hwaccel;
+  /* Play speed, 0.5 = two times slower, 2.0 = two times faster (default: 1) */
+  float play_speed;
+} video_decoder_desc_t;
+
+typedef struct video_frame_t {
+  const void* data; /* NULL before the first frame was decoded */
+  int64_t pts_us;   /* presentation time, increases across loops */
+  uint64_t index;   /* number of the frame since the start */
+} video_frame_t;
+
+typedef struct video_decoder_stats_t {
+  uint64_t decoded_frames;
+  uint64_t acquired_frames; /* decoded frames picked up by the renderer */
+  double decode_time_ms;    /* average decode time per frame */
+} video_decoder_stats_t;
+
+/* Video decoder creating/releasing, returns NULL if the file cannot be
+ * decoded */
+video_decoder_t* video_decoder_open(const video_decoder_desc_t* desc);
+/* Waits for the running decode job before releasing */
+void video_decoder_release(video_decoder_t* decoder);
+
+void video_decoder_get_frame_info(video_decoder_t* decoder,
+                                  video_frame_info_t* info);
+
+/* Starts the playback clock and decodes the first frame */
+void video_decoder_start(video_decoder_t* decoder);
+
+/**
+ * @brief Returns the newest frame whose presentation time is reached. The
+ * frame data stays valid until video_decoder_release_frame().
+ * @return 1 if the frame was not returned before, 0 otherwise
+ */
+int video_decoder_acquire_frame(video_decoder_t* decoder,
+                                video_frame_t* frame);
+void video_decoder_release_frame(video_decoder_t* decoder);
+
+/* Decode throughput of the stream */
+void video_decoder_get_stats(video_decoder_t* decoder,
+                             video_decoder_stats_t* stats);
 
 #endif
@@ -0,0 +1,111 @@
+#include "view_layout.h"
+
+#include <string.h>
+
+#include "macro.h"
+
+/* Size of the views of a grid, 0 if the cells do not fit the display */
+static void view_layout_grid_view_size(uint32_t width, uint32_t height,
+                                       uint32_t spacing, uint32_t columns,
+                                       uint32_t rows, float aspect,
+                                       float* view_width, float* view_height)
+{
+  *view_width  = 0.0f;
+  *view_height = 0.0f;
+  if (spacing * (columns + 1) >= width || spacing * (rows + 1) >= height) {
+    return;
+  }
+  const float cell_width  = (float)(width - spacing * (columns + 1)) / columns;
+  const float cell_height = (float)(height - spacing * (rows + 1)) / rows;
+  if (aspect <= 0.0f) {
+    *view_width  = cell_width;
+    *view_height = cell_height;
+    return;
+  }
+  *view_width  = MIN(cell_width, cell_height * aspect);
+  *view_height = *view_width / aspect;
+}
+
+int view_layout_compute(const view_layout_desc_t* desc, view_layout_t* layout)
+{
+  memset(layout, 0, sizeof(*layout));
+  if (desc->view_count == 0 || desc->view_count > VIEW_LAYOUT_MAX_VIEWS
+      || desc->display_count == 0
+      || desc->display_count > VIEW_LAYOUT_MAX_DISPLAYS) {
+    return 1;
+  }
+
+  layout->view_count = desc->view_count;
+  for (uint32_t d = 0; d < desc->display_count; ++d) {
+    const uint32_t width      = desc->displays[d].width;
+    const uint32_t height     = desc->displays[d].height;
+    const uint32_t first_view = d * desc->view_count / desc->display_count;
+    const uint32_t view_count
+      = (d + 1) * desc->view_count / desc->display_count - first_view;
+    layout->displays[d].first_view = first_view;
+    layout->displays[d].view_count = view_count;
+    if (view_count == 0) {
+      continue;
+    }
+
+    /* Grid with the largest views, square views choose the grid of filled
+     * cells */
+    const float grid_aspect
+      = desc->view_aspect > 0.0f ? desc->view_aspect : 1.0f;
+    uint32_t columns = 1, rows = view_count;
+    float best_area  = -1.0f;
+    for (uint32_t c = 1; c <= view_count; ++c) {
+      const uint32_t r = (view_count + c - 1) / c;
+      float view_width, view_height;
+      view_layout_grid_view_size(width, height, desc->spacing, c, r,
+                                 grid_aspect, &view_width, &view_height);
+      if (view_width * view_height > best_area) {
+        best_area = view_width * view_height;
+        columns   = c;
+        rows      = r;
+      }
+    }
+    layout->displays[d].columns = columns;
+    layout->displays[d].rows    = rows;
+
+    float view_width, view_height;
+    view_layout_grid_view_size(width, height, desc->spacing, columns, rows,
+                               desc->view_aspect, &view_width, &view_height);
+    const float cell_width
+      = (float)(width - MIN(width, desc->spacing * (columns + 1))) / columns;
+    const float cell_height
+      = (float)(height - MIN(height, desc->spacing * (rows + 1))) / rows;
+    for (uint32_t i = 0; i < view_count; ++i) {
+      const uint32_t column = i % columns, row = i / columns;
+      const float cell_x
+        = desc->spacing + column * (cell_width + desc->spacing);
+      const float cell_y = desc->spacing + row * (cell_height + desc->spacing);
+      layout->views[first_view + i].display = d;
+      layout->views[first_view + i].rect    = (view_rect_t){
+        .x      = (uint32_t)(cell_x + (cell_width - view_width) * 0.5f),
+        .y      = (uint32_t)(cell_y + (cell_height - view_height) * 0.5f),
+        .width  = (uint32_t)view_width,
+        .height = (uint32_t)view_height,
+      };
+    }
+  }
+
+  return 0;
+}
+
+int32_t view_layout_pick(const view_layout_t* layout, uint32_t display,
+                         uint32_t x, uint32_t y)
+{
+  if (display >= VIEW_LAYOUT_MAX_DISPLAYS) {
+    return -1;
+  }
+  const uint32_t first_view = layout->displays[display].first_view;
+  for (uint32_t i = 0; i < layout->displays[display].view_count; ++i) {
+    const view_rect_t* rect = &layout->views[first_view + i].rect;
+    if (x >= rect->x && x < rect->x + rect->width && y >= rect->y
+        && y < rect->y + rect->height) {
+      return (int32_t)(first_view + i);
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,66 @@
+#ifndef VIEW_LAYOUT_H
+#define VIEW_LAYOUT_H
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * View layout
+ *
+ * Places N views of the same content aspect ratio on a set of displays (the
+ * windows of a monitoring wall or one large surface). The views are spread
+ * evenly over the displays and tiled in a grid per display, the grid with the
+ * largest view size wins. Used by the multi-window rendering (see
+ * swap_chain_set.h) and by the renderers of multiple video streams, so both
+ * agree on which stream is shown where.
+ * -------------------------------------------------------------------------- */
+
+#define VIEW_LAYOUT_MAX_VIEWS 256u
+#define VIEW_LAYOUT_MAX_DISPLAYS 16u
+
+typedef struct view_rect_t {
+  uint32_t x, y;
+  uint32_t width, height;
+} view_rect_t;
+
+typedef struct view_layout_desc_t {
+  uint32_t view_count;
+  /* Aspect ratio (width / height) of the views, 0 fills the grid cells of a
+   * grid chosen for square views */
+  float view_aspect;
+  /* Sizes of the displays in pixels, at least one */
+  uint32_t display_count;
+  struct {
+    uint32_t width, height;
+  } displays[VIEW_LAYOUT_MAX_DISPLAYS];
+  /* Gap between the cells and at the display borders in pixels */
+  uint32_t spacing;
+} view_layout_desc_t;
+
+typedef struct view_layout_t {
+  uint32_t view_count;
+  struct {
+    uint32_t display; /* index of the display showing the view */
+    view_rect_t rect; /* viewport of the view, centered in its grid cell */
+  } views[VIEW_LAYOUT_MAX_VIEWS];
+  /* Grid per display */
+  struct {
+    uint32_t first_view, view_count;
+    uint32_t columns, rows;
+  } displays[VIEW_LAYOUT_MAX_DISPLAYS];
+} view_layout_t;
+
+/**
+ * @brief Computes the layout. The views are split into contiguous ranges of
+ * nearly the same size, one range per display in display order.
+ * @return 0 on success, 1 if the description is invalid
+ */
+int view_layout_compute(const view_layout_desc_t* desc, view_layout_t* layout);
+
+/**
+ * @brief Finds the view under a position of a display, e.g. the cursor.
+ * @return the view index or -1 if the position is between the views
+ */
+int32_t view_layout_pick(const view_layout_t* layout, uint32_t display,
+                         uint32_t x, uint32_t y);
+
+#endif
@@ -35,6 +35,9 @@ struct window {
   void* userdata;
 };
 
+/* Windows sharing the GLFW library, it is terminated with the last window */
+static uint32_t window_count = 0;
+
 /* Function prototypes */
 static void surface_update_framebuffer_size(window_t* window);
 static void glfw_window_error_callback(int error, const char* description);
@@ -73,13 +76,33 @@ window_t* window_create(window_config_t* config)
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, config->resizable ? GLFW_TRUE : GLFW_FALSE);
 
+  /* Full screen windows take over the video mode of their monitor */
+  GLFWmonitor* monitor = NULL;
+  uint32_t width = config->width, height = config->height;
+  if (config->monitor > 0) {
+    int monitor_count      = 0;
+    GLFWmonitor** monitors = glfwGetMonitors(&monitor_count);
+    if (config->monitor <= monitor_count) {
+      monitor                 = monitors[config->monitor - 1];
+      const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+      width                   = (uint32_t)mode->width;
+      height                  = (uint32_t)mode->height;
+    }
+    else {
+      fprintf(stderr, "Monitor %d not found, %d monitors connected\n",
+              config->monitor, monitor_count);
+    }
+  }
+
   /* Create GLFW window */
-  window->handle = glfwCreateWindow(config->width, config->height,
-                                    config->title, NULL, NULL);
+  window->handle = glfwCreateWindow((int)width, (int)height, config->title,
+                                    monitor, NULL);
 
   /* Confirm that GLFW window was created successfully */
   if (!window->handle) {
-    glfwTerminate();
+    if (window_count == 0) {
+      glfwTerminate();
+    }
     fprintf(stderr, "Failed to create window\n");
     fflush(stderr);
     return window;
@@ -106,6 +129,7 @@ window_t* window_create(window_config_t* config)
 
   /* Change the state of the window to intialized */
   window->intialized = 1;
+  ++window_count;
 
   return window;
 }
@@ -118,8 +142,10 @@ void window_destroy(window_t* window)
       glfwDestroyWindow(window->handle);
       window->handle = NULL;
 
-      /* Terminate GLFW */
-      glfwTerminate();
+      /* Terminate GLFW with the last window */
+      if (--window_count == 0) {
+        glfwTerminate();
+      }
     }
 
     /* Free allocated memory */
@@ -133,6 +159,11 @@ int window_should_close(window_t* window)
   return glfwWindowShouldClose(window->handle);
 }
 
+void window_set_should_close(window_t* window, int value)
+{
+  glfwSetWindowShouldClose(window->handle, value);
+}
+
 void window_set_title(window_t* window, const char* title)
 {
   glfwSetWindowTitle(window->handle, title);
@@ -173,6 +204,16 @@ void window_get_aspect_ratio(window_t* window, float* aspect_ratio)
   *aspect_ratio = (float)window->surface.width / (float)window->surface.height;
 }
 
+int window_get_monitor_count(void)
+{
+  if (!glfwInit()) {
+    return 0;
+  }
+  int monitor_count = 0;
+  glfwGetMonitors(&monitor_count);
+  return monitor_count;
+}
+
 /* input related functions */
 
 void input_poll_events(void)
@@ -180,6 +221,11 @@ void input_poll_events(void)
   glfwPollEvents();
 }
 
+void input_wait_events(void)
+{
+  glfwWaitEvents();
+}
+
 void input_query_cursor(window_t* window, float* xpos, float* ypos)
 {
   double cursor_xpos, cursor_ypos;
@@ -337,11 +383,12 @@ static void surface_update_framebuffer_size(window_t* window)
 static void glfw_window_size_callback(GLFWwindow* src_window, int width,
                                       int height)
 {
-  UNUSED_VAR(width);
-  UNUSED_VAR(height);
+  window_t* window = (window_t*)glfwGetWindowUserPointer(src_window);
+  surface_update_framebuffer_size(window);
 
-  surface_update_framebuffer_size(
-    (window_t*)glfwGetWindowUserPointer(src_window));
+  if (window && window->callbacks.resize_callback) {
+    window->callbacks.resize_callback(window, width, height);
+  }
 }
 
 static keycode_t remap_glfw_key_code(int key)
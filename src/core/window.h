@@ -10,6 +10,9 @@ typedef struct window_config_t {
   uint32_t width;
   uint32_t height;
   int resizable;
+  /* Full screen on the monitor with this 1-based index (in the video mode of
+   * the monitor), 0 = windowed */
+  int monitor;
 } window_config_t;
 
 typedef struct window window_t;
@@ -31,15 +34,20 @@ typedef struct {
 window_t* window_create(window_config_t* config);
 void window_destroy(window_t* window);
 int window_should_close(window_t* window);
+void window_set_should_close(window_t* window, int value);
 void window_set_title(window_t* window, const char* title);
 void window_set_userdata(window_t* window, void* userdata);
 void* window_get_userdata(window_t* window);
 void* window_get_surface(window_t* window);
 void window_get_size(window_t* window, uint32_t* width, uint32_t* height);
 void window_get_aspect_ratio(window_t* window, float* aspect_ratio);
+/* Number of connected monitors, initializes the library if needed */
+int window_get_monitor_count(void);
 
 /* input related functions */
 void input_poll_events(void);
+/* Sleeps until at least one event is available and processes the events */
+void input_wait_events(void);
 void input_query_cursor(window_t* window, float* xpos, float* ypos);
 void input_set_callbacks(window_t* window, callbacks_t callbacks);
 
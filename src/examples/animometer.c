@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "../core/argparse.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
@@ -76,6 +77,9 @@ static const char* fragment_shader_wgsl = CODE(
 );
 // clang-format on
 
+// Upper bound of the triangle count searched by the scaling benchmark
+#define MAX_NUM_TRIANGLES 100000u
+
 // Settings
 static struct settings_t {
   uint64_t num_triangles;
@@ -86,6 +90,7 @@ static struct settings_t {
   .render_bundles  = true,
   .dynamic_offsets = false,
 };
+static uint64_t triangle_capacity      = 0;
 static uint64_t uniform_bytes          = 0;
 static uint64_t aligned_uniform_bytes  = 0;
 static uint64_t aligned_uniform_floats = 0;
@@ -117,7 +122,7 @@ static struct {
 
 // Render bundles execute the commands previously recorded into the given
 // GPURenderBundles as part of this render pass.
-static WGPURenderBundle render_bundle;
+static wgpu_render_bundle_cache_t* render_bundle_cache;
 
 // Bind groups stores the resources bound to the binding points in a shader
 static WGPUBindGroupLayout time_bind_group_layout;
@@ -128,6 +133,44 @@ static WGPUBindGroup* bind_groups;
 static WGPUBindGroup dynamic_bind_group;
 static WGPUBindGroup time_bind_group;
 
+// Scaling benchmark: searches the highest triangle count that renders within
+// the target frame time, for each of the recording modes
+typedef enum scaling_mode_t {
+  ScalingMode_Plain          = 0,
+  ScalingMode_DynamicOffsets = 1,
+  ScalingMode_RenderBundles  = 2,
+  ScalingMode_Count          = 3,
+} scaling_mode_t;
+
+static const char* scaling_mode_names[ScalingMode_Count] = {
+  "plain",
+  "dynamic offsets",
+  "render bundles",
+};
+
+// Frames skipped after changing the triangle count, e.g. for re-recording
+// the render bundle, and frames averaged per triangle count
+#define SCALING_SETTLE_FRAMES 10u
+#define SCALING_MEASURE_FRAMES 60u
+#define SCALING_START_TRIANGLES 1024u
+
+static struct {
+  int enabled;
+  float target_frame_time_ms;
+  bool running;
+  bool finished;
+  scaling_mode_t mode;
+  // Highest count within and lowest count above the target, 0 = unknown
+  uint64_t sustained;
+  uint64_t exceeded;
+  uint32_t frame;
+  float frame_time_sum_ms;
+  float last_mean_ms;
+  uint64_t results[ScalingMode_Count];
+} scaling_benchmark = {
+  .target_frame_time_ms = 16.6f,
+};
+
 // Other variables
 static const char* example_title = "Animometer";
 static bool prepared             = false;
@@ -283,18 +326,23 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
 
 static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
 {
+  // The scaling benchmark varies the triangle count up to the maximum
+  triangle_capacity
+    = scaling_benchmark.enabled ? MAX_NUM_TRIANGLES : settings.num_triangles;
   uniform_bytes          = 5 * sizeof(float);
   aligned_uniform_bytes  = ceil(uniform_bytes / 256.0f) * 256;
   aligned_uniform_floats = aligned_uniform_bytes / sizeof(float);
   uniform_buffer         = wgpuDeviceCreateBuffer(
-            wgpu_context->device,
-            &(WGPUBufferDescriptor){
-              .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-              .size  = settings.num_triangles * aligned_uniform_bytes + sizeof(float),
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = triangle_capacity * aligned_uniform_bytes + sizeof(float),
     });
-  float uniform_buffer_data[settings.num_triangles * aligned_uniform_floats];
-  bind_groups = malloc(settings.num_triangles * sizeof(WGPUBindGroup));
-  for (uint64_t i = 0; i < settings.num_triangles; ++i) {
+  const uint64_t uniform_float_count
+    = triangle_capacity * aligned_uniform_floats;
+  float* uniform_buffer_data = calloc(uniform_float_count, sizeof(float));
+  bind_groups = malloc(triangle_capacity * sizeof(WGPUBindGroup));
+  for (uint64_t i = 0; i < triangle_capacity; ++i) {
     uniform_buffer_data[aligned_uniform_floats * i + 0]
       = float_random(0.0f, 1.0f) * 0.2f + 0.2f; // scale
     uniform_buffer_data[aligned_uniform_floats * i + 1]
@@ -339,7 +387,7 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
       .entries    = dynamic_bg_entries,
     }));
 
-  time_offset = settings.num_triangles * aligned_uniform_bytes;
+  time_offset = triangle_capacity * aligned_uniform_bytes;
   WGPUBindGroupEntry time_bg_entries[1] = {
         [0] = (WGPUBindGroupEntry) {
           .binding = 0,
@@ -356,15 +404,16 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
                           }));
 
   const uint64_t max_mapping_length = (14 * 1024 * 1024) / sizeof(float);
-  for (uint64_t offset = 0; offset < ARRAY_SIZE(uniform_buffer_data);
+  for (uint64_t offset = 0; offset < uniform_float_count;
        offset += max_mapping_length) {
     const uint64_t upload_count
-      = MIN(ARRAY_SIZE(uniform_buffer_data) - offset, max_mapping_length);
+      = MIN(uniform_float_count - offset, max_mapping_length);
 
     wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffer,
                          offset * sizeof(float), &uniform_buffer_data[offset],
                          upload_count * sizeof(float));
   }
+  free(uniform_buffer_data);
 }
 
 #define RECORD_RENDER_PASS(Type, rpass_enc)                                    \
@@ -472,20 +521,124 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
 }
 
-static void prepare_render_bundle_encoder(wgpu_context_t* wgpu_context)
+static void record_render_bundle(WGPURenderBundleEncoder bundle_encoder,
+                                 void* user_data)
+{
+  UNUSED_VAR(user_data);
+  RECORD_RENDER_PASS(RenderBundleEncoder, bundle_encoder)
+}
+
+static void prepare_render_bundle_cache(wgpu_context_t* wgpu_context)
 {
   WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
-  WGPURenderBundleEncoder render_bundle_encoder
-    = wgpuDeviceCreateRenderBundleEncoder(wgpu_context->device,
-                                          &(WGPURenderBundleEncoderDescriptor){
-                                            .colorFormatsCount = 1,
-                                            .colorFormats      = color_formats,
-                                            .sampleCount       = 1,
-                                          });
-  RECORD_RENDER_PASS(RenderBundleEncoder, render_bundle_encoder)
-  render_bundle = wgpuRenderBundleEncoderFinish(render_bundle_encoder, NULL);
-
-  WGPU_RELEASE_RESOURCE(RenderBundleEncoder, render_bundle_encoder)
+  render_bundle_cache                = wgpu_render_bundle_cache_create(
+    wgpu_context, &(wgpu_render_bundle_cache_desc_t){
+                    .label              = "Animometer render bundle",
+                    .color_format_count = 1,
+                    .color_formats      = color_formats,
+                    .sample_count       = 1,
+                    .record_func        = record_render_bundle,
+                  });
+}
+
+static void set_triangle_count(uint64_t num_triangles)
+{
+  settings.num_triangles = MIN(num_triangles, triangle_capacity);
+  wgpu_render_bundle_cache_invalidate(render_bundle_cache);
+  scaling_benchmark.frame             = 0;
+  scaling_benchmark.frame_time_sum_ms = 0.0f;
+}
+
+static void start_scaling_mode(scaling_mode_t mode)
+{
+  scaling_benchmark.mode      = mode;
+  scaling_benchmark.sustained = 0;
+  scaling_benchmark.exceeded  = 0;
+  settings.dynamic_offsets    = (mode == ScalingMode_DynamicOffsets);
+  settings.render_bundles     = (mode == ScalingMode_RenderBundles);
+  set_triangle_count(SCALING_START_TRIANGLES);
+}
+
+static void start_scaling_benchmark(void)
+{
+  log_info("Animometer scaling benchmark, target frame time %.2f ms",
+           scaling_benchmark.target_frame_time_ms);
+  memset(scaling_benchmark.results, 0, sizeof(scaling_benchmark.results));
+  scaling_benchmark.running  = true;
+  scaling_benchmark.finished = false;
+  start_scaling_mode(ScalingMode_Plain);
+}
+
+static void finish_scaling_mode(void)
+{
+  const scaling_mode_t mode        = scaling_benchmark.mode;
+  scaling_benchmark.results[mode] = scaling_benchmark.sustained;
+  log_info("Animometer %s: %llu triangles sustained",
+           scaling_mode_names[mode],
+           (unsigned long long)scaling_benchmark.sustained);
+
+  if (mode + 1 < ScalingMode_Count) {
+    start_scaling_mode((scaling_mode_t)(mode + 1));
+    return;
+  }
+
+  scaling_benchmark.running  = false;
+  scaling_benchmark.finished = true;
+  log_info("Animometer score (plain / dynamic offsets / render bundles): "
+           "%llu / %llu / %llu",
+           (unsigned long long)scaling_benchmark.results[0],
+           (unsigned long long)scaling_benchmark.results[1],
+           (unsigned long long)scaling_benchmark.results[2]);
+}
+
+// Doubles the triangle count while the frame time stays within the target and
+// afterwards bisects between the highest sustained and lowest exceeding count
+static void update_scaling_benchmark(wgpu_example_context_t* context)
+{
+  if (!scaling_benchmark.running) {
+    return;
+  }
+
+  const uint32_t frame = scaling_benchmark.frame++;
+  if (frame < SCALING_SETTLE_FRAMES) {
+    return;
+  }
+  scaling_benchmark.frame_time_sum_ms += context->frame_timer * 1000.0f;
+  if (frame + 1 < SCALING_SETTLE_FRAMES + SCALING_MEASURE_FRAMES) {
+    return;
+  }
+
+  const uint64_t count = settings.num_triangles;
+  scaling_benchmark.last_mean_ms
+    = scaling_benchmark.frame_time_sum_ms / (float)SCALING_MEASURE_FRAMES;
+  const float target_ms = scaling_benchmark.target_frame_time_ms;
+  if (scaling_benchmark.last_mean_ms <= target_ms) {
+    scaling_benchmark.sustained = count;
+  }
+  else {
+    scaling_benchmark.exceeded = count;
+  }
+
+  const uint64_t sustained = scaling_benchmark.sustained;
+  const uint64_t exceeded  = scaling_benchmark.exceeded;
+  if (exceeded == 0) {
+    if (sustained >= triangle_capacity) {
+      finish_scaling_mode();
+    }
+    else {
+      set_triangle_count(sustained * 2);
+    }
+    return;
+  }
+
+  // Stop at a resolution of 2 percent of the sustained count
+  const uint64_t resolution = MAX(sustained / 50, 1);
+  if (exceeded - sustained <= resolution) {
+    finish_scaling_mode();
+  }
+  else {
+    set_triangle_count(sustained + (exceeded - sustained) / 2);
+  }
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -496,7 +649,10 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_uniform_buffers(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
-    prepare_render_bundle_encoder(context->wgpu_context);
+    prepare_render_bundle_cache(context->wgpu_context);
+    if (scaling_benchmark.enabled) {
+      start_scaling_benchmark();
+    }
     prepared = true;
     return 0;
   }
@@ -512,6 +668,25 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                            &settings.render_bundles);
     imgui_overlay_checkBox(context->imgui_overlay, "Dynamic offsets",
                            &settings.dynamic_offsets);
+    imgui_overlay_text("Triangles: %llu",
+                       (unsigned long long)settings.num_triangles);
+  }
+  if (scaling_benchmark.enabled && imgui_overlay_header("Scaling benchmark")) {
+    if (scaling_benchmark.running) {
+      imgui_overlay_text("Mode: %s",
+                         scaling_mode_names[scaling_benchmark.mode]);
+      imgui_overlay_text("Last frame time: %.2f ms",
+                         scaling_benchmark.last_mean_ms);
+    }
+    else if (imgui_overlay_button(context->imgui_overlay, "Restart")) {
+      start_scaling_benchmark();
+    }
+    if (scaling_benchmark.finished) {
+      for (uint32_t i = 0; i < (uint32_t)ScalingMode_Count; ++i) {
+        imgui_overlay_text("%s: %llu", scaling_mode_names[i],
+                           (unsigned long long)scaling_benchmark.results[i]);
+      }
+    }
   }
 }
 
@@ -529,9 +704,12 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       wgpu_context->cmd_enc, &render_pass.descriptor);
 
     if (settings.render_bundles) {
-      const WGPURenderBundle render_bundles[1] = {render_bundle};
-      wgpuRenderPassEncoderExecuteBundles(wgpu_context->rpass_enc, 1,
-                                          render_bundles);
+      // Toggling the dynamic offsets switches the recorded pipeline
+      wgpu_render_bundle_cache_set_dependency(
+        render_bundle_cache, 0,
+        settings.dynamic_offsets ? dynamic_pipeline : pipeline);
+      wgpu_render_bundle_cache_execute(render_bundle_cache,
+                                       wgpu_context->rpass_enc);
     }
     else {
       RECORD_RENDER_PASS(RenderPassEncoder, wgpu_context->rpass_enc)
@@ -582,6 +760,7 @@ static int example_render(wgpu_example_context_t* context)
   if (!context->paused) {
     update_uniform_buffers(context);
   }
+  update_scaling_benchmark(context);
   return draw_result;
 }
 
@@ -595,11 +774,11 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, dynamic_pipeline_layout)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
   WGPU_RELEASE_RESOURCE(RenderPipeline, dynamic_pipeline)
-  WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
+  wgpu_render_bundle_cache_destroy(render_bundle_cache);
   WGPU_RELEASE_RESOURCE(BindGroupLayout, time_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, dynamic_bind_group_layout);
-  for (uint64_t i = 0; i < settings.num_triangles; ++i) {
+  for (uint64_t i = 0; i < triangle_capacity; ++i) {
     WGPU_RELEASE_RESOURCE(BindGroup, bind_groups[i])
   }
   free(bind_groups);
@@ -607,8 +786,51 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroup, time_bind_group)
 }
 
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]   = {"--target-frame-time="};
+  char* filters_flag[2] = {"--scaling-benchmark", "--help-animometer"};
+  char* filtered_argv[1 + 1 + 2 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option options[] = {
+    OPT_BOOLEAN(0, "scaling-benchmark", &scaling_benchmark.enabled,
+                "search the highest triangle count within the target frame "
+                "time for each mode",
+                NULL, 0, 0),
+    OPT_FLOAT(0, "target-frame-time", &scaling_benchmark.target_frame_time_ms,
+              "target frame time in milliseconds (default 16.6)", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-animometer", NULL, "show the animometer options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  if (scaling_benchmark.target_frame_time_ms <= 0.0f) {
+    scaling_benchmark.target_frame_time_ms = 16.6f;
+  }
+}
+
 void example_animometer(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
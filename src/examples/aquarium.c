@@ -55,190 +55,34 @@
 
 static long long MATRIX_RANDOM_RANGE_ = 4294967296;
 
+/* The matrices are row-major arrays of row vectors, the same memory layout as
+ * the column-major cglm matrices of column vectors. The cglm functions load
+ * aligned matrices, the arrays are copied into mat4 locals. */
 static void matrix_mul_matrix_matrix4(float* dst, const float* a,
                                       const float* b)
 {
-  float a00 = a[0];
-  float a01 = a[1];
-  float a02 = a[2];
-  float a03 = a[3];
-  float a10 = a[4 + 0];
-  float a11 = a[4 + 1];
-  float a12 = a[4 + 2];
-  float a13 = a[4 + 3];
-  float a20 = a[8 + 0];
-  float a21 = a[8 + 1];
-  float a22 = a[8 + 2];
-  float a23 = a[8 + 3];
-  float a30 = a[12 + 0];
-  float a31 = a[12 + 1];
-  float a32 = a[12 + 2];
-  float a33 = a[12 + 3];
-  float b00 = b[0];
-  float b01 = b[1];
-  float b02 = b[2];
-  float b03 = b[3];
-  float b10 = b[4 + 0];
-  float b11 = b[4 + 1];
-  float b12 = b[4 + 2];
-  float b13 = b[4 + 3];
-  float b20 = b[8 + 0];
-  float b21 = b[8 + 1];
-  float b22 = b[8 + 2];
-  float b23 = b[8 + 3];
-  float b30 = b[12 + 0];
-  float b31 = b[12 + 1];
-  float b32 = b[12 + 2];
-  float b33 = b[12 + 3];
-  dst[0]    = a00 * b00 + a01 * b10 + a02 * b20 + a03 * b30;
-  dst[1]    = a00 * b01 + a01 * b11 + a02 * b21 + a03 * b31;
-  dst[2]    = a00 * b02 + a01 * b12 + a02 * b22 + a03 * b32;
-  dst[3]    = a00 * b03 + a01 * b13 + a02 * b23 + a03 * b33;
-  dst[4]    = a10 * b00 + a11 * b10 + a12 * b20 + a13 * b30;
-  dst[5]    = a10 * b01 + a11 * b11 + a12 * b21 + a13 * b31;
-  dst[6]    = a10 * b02 + a11 * b12 + a12 * b22 + a13 * b32;
-  dst[7]    = a10 * b03 + a11 * b13 + a12 * b23 + a13 * b33;
-  dst[8]    = a20 * b00 + a21 * b10 + a22 * b20 + a23 * b30;
-  dst[9]    = a20 * b01 + a21 * b11 + a22 * b21 + a23 * b31;
-  dst[10]   = a20 * b02 + a21 * b12 + a22 * b22 + a23 * b32;
-  dst[11]   = a20 * b03 + a21 * b13 + a22 * b23 + a23 * b33;
-  dst[12]   = a30 * b00 + a31 * b10 + a32 * b20 + a33 * b30;
-  dst[13]   = a30 * b01 + a31 * b11 + a32 * b21 + a33 * b31;
-  dst[14]   = a30 * b02 + a31 * b12 + a32 * b22 + a33 * b32;
-  dst[15]   = a30 * b03 + a31 * b13 + a32 * b23 + a33 * b33;
+  mat4 ma, mb, mdst;
+  memcpy(ma, a, sizeof(ma));
+  memcpy(mb, b, sizeof(mb));
+  /* Row vectors: a * b is b * a with column vectors */
+  glm_mat4_mul(mb, ma, mdst);
+  memcpy(dst, mdst, sizeof(mdst));
 }
 
 static void matrix_inverse4(float* dst, const float* m)
 {
-  float m00    = m[0 * 4 + 0];
-  float m01    = m[0 * 4 + 1];
-  float m02    = m[0 * 4 + 2];
-  float m03    = m[0 * 4 + 3];
-  float m10    = m[1 * 4 + 0];
-  float m11    = m[1 * 4 + 1];
-  float m12    = m[1 * 4 + 2];
-  float m13    = m[1 * 4 + 3];
-  float m20    = m[2 * 4 + 0];
-  float m21    = m[2 * 4 + 1];
-  float m22    = m[2 * 4 + 2];
-  float m23    = m[2 * 4 + 3];
-  float m30    = m[3 * 4 + 0];
-  float m31    = m[3 * 4 + 1];
-  float m32    = m[3 * 4 + 2];
-  float m33    = m[3 * 4 + 3];
-  float tmp_0  = m22 * m33;
-  float tmp_1  = m32 * m23;
-  float tmp_2  = m12 * m33;
-  float tmp_3  = m32 * m13;
-  float tmp_4  = m12 * m23;
-  float tmp_5  = m22 * m13;
-  float tmp_6  = m02 * m33;
-  float tmp_7  = m32 * m03;
-  float tmp_8  = m02 * m23;
-  float tmp_9  = m22 * m03;
-  float tmp_10 = m02 * m13;
-  float tmp_11 = m12 * m03;
-  float tmp_12 = m20 * m31;
-  float tmp_13 = m30 * m21;
-  float tmp_14 = m10 * m31;
-  float tmp_15 = m30 * m11;
-  float tmp_16 = m10 * m21;
-  float tmp_17 = m20 * m11;
-  float tmp_18 = m00 * m31;
-  float tmp_19 = m30 * m01;
-  float tmp_20 = m00 * m21;
-  float tmp_21 = m20 * m01;
-  float tmp_22 = m00 * m11;
-  float tmp_23 = m10 * m01;
-
-  float t0 = (tmp_0 * m11 + tmp_3 * m21 + tmp_4 * m31)
-             - (tmp_1 * m11 + tmp_2 * m21 + tmp_5 * m31);
-  float t1 = (tmp_1 * m01 + tmp_6 * m21 + tmp_9 * m31)
-             - (tmp_0 * m01 + tmp_7 * m21 + tmp_8 * m31);
-  float t2 = (tmp_2 * m01 + tmp_7 * m11 + tmp_10 * m31)
-             - (tmp_3 * m01 + tmp_6 * m11 + tmp_11 * m31);
-  float t3 = (tmp_5 * m01 + tmp_8 * m11 + tmp_11 * m21)
-             - (tmp_4 * m01 + tmp_9 * m11 + tmp_10 * m21);
-
-  float d = 1.0f / (m00 * t0 + m10 * t1 + m20 * t2 + m30 * t3);
-
-  dst[0] = d * t0;
-  dst[1] = d * t1;
-  dst[2] = d * t2;
-  dst[3] = d * t3;
-  dst[4] = d
-           * ((tmp_1 * m10 + tmp_2 * m20 + tmp_5 * m30)
-              - (tmp_0 * m10 + tmp_3 * m20 + tmp_4 * m30));
-  dst[5] = d
-           * ((tmp_0 * m00 + tmp_7 * m20 + tmp_8 * m30)
-              - (tmp_1 * m00 + tmp_6 * m20 + tmp_9 * m30));
-  dst[6] = d
-           * ((tmp_3 * m00 + tmp_6 * m10 + tmp_11 * m30)
-              - (tmp_2 * m00 + tmp_7 * m10 + tmp_10 * m30));
-  dst[7] = d
-           * ((tmp_4 * m00 + tmp_9 * m10 + tmp_10 * m20)
-              - (tmp_5 * m00 + tmp_8 * m10 + tmp_11 * m20));
-  dst[8] = d
-           * ((tmp_12 * m13 + tmp_15 * m23 + tmp_16 * m33)
-              - (tmp_13 * m13 + tmp_14 * m23 + tmp_17 * m33));
-  dst[9] = d
-           * ((tmp_13 * m03 + tmp_18 * m23 + tmp_21 * m33)
-              - (tmp_12 * m03 + tmp_19 * m23 + tmp_20 * m33));
-  dst[10] = d
-            * ((tmp_14 * m03 + tmp_19 * m13 + tmp_22 * m33)
-               - (tmp_15 * m03 + tmp_18 * m13 + tmp_23 * m33));
-  dst[11] = d
-            * ((tmp_17 * m03 + tmp_20 * m13 + tmp_23 * m23)
-               - (tmp_16 * m03 + tmp_21 * m13 + tmp_22 * m23));
-  dst[12] = d
-            * ((tmp_14 * m22 + tmp_17 * m32 + tmp_13 * m12)
-               - (tmp_16 * m32 + tmp_12 * m12 + tmp_15 * m22));
-  dst[13] = d
-            * ((tmp_20 * m32 + tmp_12 * m02 + tmp_19 * m22)
-               - (tmp_18 * m22 + tmp_21 * m32 + tmp_13 * m02));
-  dst[14] = d
-            * ((tmp_18 * m12 + tmp_23 * m32 + tmp_15 * m02)
-               - (tmp_22 * m32 + tmp_14 * m02 + tmp_19 * m12));
-  dst[15] = d
-            * ((tmp_22 * m22 + tmp_16 * m02 + tmp_21 * m12)
-               - (tmp_20 * m12 + tmp_23 * m22 + tmp_17 * m02));
+  mat4 mm;
+  memcpy(mm, m, sizeof(mm));
+  glm_mat4_inv(mm, mm);
+  memcpy(dst, mm, sizeof(mm));
 }
 
 static void matrix_transpose4(float* dst, const float* m)
 {
-  float m00 = m[0 * 4 + 0];
-  float m01 = m[0 * 4 + 1];
-  float m02 = m[0 * 4 + 2];
-  float m03 = m[0 * 4 + 3];
-  float m10 = m[1 * 4 + 0];
-  float m11 = m[1 * 4 + 1];
-  float m12 = m[1 * 4 + 2];
-  float m13 = m[1 * 4 + 3];
-  float m20 = m[2 * 4 + 0];
-  float m21 = m[2 * 4 + 1];
-  float m22 = m[2 * 4 + 2];
-  float m23 = m[2 * 4 + 3];
-  float m30 = m[3 * 4 + 0];
-  float m31 = m[3 * 4 + 1];
-  float m32 = m[3 * 4 + 2];
-  float m33 = m[3 * 4 + 3];
-
-  dst[0]  = m00;
-  dst[1]  = m10;
-  dst[2]  = m20;
-  dst[3]  = m30;
-  dst[4]  = m01;
-  dst[5]  = m11;
-  dst[6]  = m21;
-  dst[7]  = m31;
-  dst[8]  = m02;
-  dst[9]  = m12;
-  dst[10] = m22;
-  dst[11] = m32;
-  dst[12] = m03;
-  dst[13] = m13;
-  dst[14] = m23;
-  dst[15] = m33;
+  mat4 mm;
+  memcpy(mm, m, sizeof(mm));
+  glm_mat4_transpose(mm);
+  memcpy(dst, mm, sizeof(mm));
 }
 
 static void matrix_frustum(float* dst, float left, float right, float bottom,
@@ -1162,108 +1006,6 @@ static g_settings_t g_settings = {
   .field_of_view     = 82.699f,
 };
 
-/* -------------------------------------------------------------------------- *
- * FPSTimer - Defines fps timer, uses millseconds time unit.
- * -------------------------------------------------------------------------- */
-
-#define NUM_HISTORY_DATA 100u
-#define NUM_FRAMES_TO_AVERAGE 128u
-#define FPS_VALID_THRESHOLD 5u
-
-sc_array_def(float, float);
-
-typedef struct {
-  float total_time;
-  struct sc_array_float time_table;
-  int32_t time_table_cursor;
-  struct sc_array_float history_fps;
-  struct sc_array_float history_frame_time;
-  struct sc_array_float log_fps;
-  float average_fps;
-} fps_timer_t;
-
-static void fps_timer_init_defaults(fps_timer_t* this)
-{
-  memset(this, 0, sizeof(*this));
-
-  this->total_time = NUM_FRAMES_TO_AVERAGE * 1000.0f;
-
-  for (uint32_t i = 0; i < NUM_FRAMES_TO_AVERAGE; ++i) {
-    sc_array_add(&this->time_table, 1000.0f);
-  }
-
-  this->time_table_cursor = 0;
-
-  for (uint32_t i = 0; i < NUM_HISTORY_DATA; ++i) {
-    sc_array_add(&this->history_fps, 1.0f);
-    sc_array_add(&this->history_frame_time, 100.0f);
-  }
-
-  this->average_fps = 0.0f;
-}
-
-static void fps_timer_create(fps_timer_t* this)
-{
-  fps_timer_init_defaults(this);
-}
-
-static void fps_timer_update(fps_timer_t* this, float elapsed_time,
-                             float rendering_time, float test_time)
-{
-  this->total_time
-    += elapsed_time - this->time_table.elems[this->time_table_cursor];
-  this->time_table.elems[this->time_table_cursor] = elapsed_time;
-
-  ++this->time_table_cursor;
-  if (this->time_table_cursor == NUM_FRAMES_TO_AVERAGE) {
-    this->time_table_cursor = 0;
-  }
-
-  float frame_time  = this->total_time / NUM_FRAMES_TO_AVERAGE;
-  this->average_fps = floor(1000.0f / frame_time + 0.5f);
-
-  for (uint32_t i = 0; i < NUM_HISTORY_DATA - 1; ++i) {
-    this->history_fps.elems[i]        = this->history_fps.elems[i + 1];
-    this->history_frame_time.elems[i] = this->history_frame_time.elems[i + 1];
-  }
-
-  this->history_fps.elems[NUM_HISTORY_DATA - 1] = this->average_fps;
-  this->history_frame_time.elems[NUM_HISTORY_DATA - 1]
-    = 1000.0 / this->average_fps;
-
-  if (test_time - rendering_time > 5000.0f
-      && test_time - rendering_time < 25000.0f) {
-    sc_array_add(&this->log_fps, this->average_fps);
-  }
-}
-
-static float fps_timer_get_average_fps(fps_timer_t* this)
-{
-  return this->average_fps;
-}
-
-static int32_t fps_timer_variance(fps_timer_t* this)
-{
-  float avg = 0.0f;
-
-  for (size_t i = 0; i < sc_array_size(&this->log_fps); ++i) {
-    avg += this->log_fps.elems[i];
-  }
-  avg /= sc_array_size(&this->log_fps);
-
-  float var = 0.0f;
-  for (size_t i = 0; i < sc_array_size(&this->log_fps); ++i) {
-    var += pow(this->log_fps.elems[i] - avg, 2);
-  }
-  var /= sc_array_size(&this->log_fps);
-
-  if (var < FPS_VALID_THRESHOLD) {
-    return (int32_t)ceil(avg);
-  }
-
-  return 0;
-}
-
 /* -------------------------------------------------------------------------- *
  * Behavior - Base class for behavior.
  * -------------------------------------------------------------------------- */
@@ -1877,9 +1619,9 @@ typedef struct {
   WGPURenderPassDescriptor render_pass_descriptor;
   struct {
     WGPUTextureView backbuffer;
-    texture_t scene_render_target;
-    texture_t scene_depth_stencil;
   } texture_views;
+  /* Transient multisampled scene color and depth-stencil attachments */
+  wgpu_msaa_target_t* msaa_target;
   WGPURenderPipeline pipeline;
   WGPUBindGroup bind_group;
   WGPUTextureFormat preferred_swap_chain_format;
@@ -1941,6 +1683,7 @@ static void context_create(context_t* this)
 
 static void context_detroy(context_t* this)
 {
+  wgpu_msaa_target_destroy(this->msaa_target);
 }
 
 static void context_initialize(context_t* this)
@@ -1971,6 +1714,10 @@ static uint32_t context_get_client_height(context_t* this)
 static void set_msaa_sample_count(context_t* this, uint32_t msaa_sample_count)
 {
   this->msaa_sample_count = msaa_sample_count;
+  if (this->msaa_target != NULL) {
+    this->msaa_sample_count
+      = wgpu_msaa_target_set_sample_count(this->msaa_target, msaa_sample_count);
+  }
 }
 
 static WGPUSampler
@@ -2187,72 +1934,6 @@ static WGPURenderPipeline context_create_render_pipeline(
   return pipeline;
 }
 
-static texture_t context_create_multisampled_render_target_view(context_t* this)
-{
-  texture_t texture = {0};
-
-  WGPUTextureDescriptor texture_desc = {
-    .dimension               = WGPUTextureDimension_2D,
-    .size.width              = this->client_width,
-    .size.height             = this->client_height,
-    .size.depthOrArrayLayers = 1,
-    .sampleCount             = this->msaa_sample_count,
-    .format                  = this->preferred_swap_chain_format,
-    .mipLevelCount           = 1,
-    .usage
-    = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
-  };
-  texture.texture = wgpuDeviceCreateTexture(this->device, &texture_desc);
-  ASSERT(texture.texture != NULL);
-
-  /* Create the texture view */
-  WGPUTextureViewDescriptor texture_view_dec = {
-    .dimension       = WGPUTextureViewDimension_2D,
-    .format          = texture_desc.format,
-    .baseMipLevel    = 0,
-    .mipLevelCount   = 1,
-    .baseArrayLayer  = 0,
-    .arrayLayerCount = 1,
-  };
-  texture.view = wgpuTextureCreateView(texture.texture, &texture_view_dec);
-  ASSERT(texture.view != NULL);
-
-  return texture;
-}
-
-static texture_t context_create_depth_stencil_view(context_t* this)
-{
-  texture_t texture = {0};
-
-  WGPUTextureDescriptor texture_desc = {
-    .dimension               = WGPUTextureDimension_2D,
-    .size.width              = this->client_width,
-    .size.height             = this->client_height,
-    .size.depthOrArrayLayers = 1,
-    .sampleCount             = this->msaa_sample_count,
-    .format                  = WGPUTextureFormat_Depth24PlusStencil8,
-    .mipLevelCount           = 1,
-    .usage
-    = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
-  };
-  texture.texture = wgpuDeviceCreateTexture(this->device, &texture_desc);
-  ASSERT(texture.texture != NULL);
-
-  /* Create the texture view */
-  WGPUTextureViewDescriptor texture_view_dec = {
-    .dimension       = WGPUTextureViewDimension_2D,
-    .format          = texture_desc.format,
-    .baseMipLevel    = 0,
-    .mipLevelCount   = 1,
-    .baseArrayLayer  = 0,
-    .arrayLayerCount = 1,
-  };
-  texture.view = wgpuTextureCreateView(texture.texture, &texture_view_dec);
-  ASSERT(texture.view != NULL);
-
-  return texture;
-}
-
 static WGPUBuffer context_create_buffer(void* this,
                                         WGPUBufferDescriptor const* descriptor)
 {
@@ -2490,12 +2171,17 @@ static void context_pre_frame(context_t* this)
   if (this->is_swapchain_out_of_date) {
     this->client_width  = wgpu_context->surface.width;
     this->client_height = wgpu_context->surface.height;
-    if (this->msaa_sample_count > 1) {
-      this->texture_views.scene_render_target
-        = context_create_multisampled_render_target_view(this);
+    /* The MSAA target follows the surface size */
+    if (this->msaa_target == NULL) {
+      wgpu_msaa_target_desc_t msaa_target_desc = {
+        .label                = "Aquarium scene target",
+        .color_format         = this->preferred_swap_chain_format,
+        .depth_stencil_format = WGPUTextureFormat_Depth24PlusStencil8,
+        .sample_count         = this->msaa_sample_count,
+      };
+      this->msaa_target
+        = wgpu_msaa_target_create(wgpu_context, &msaa_target_desc);
     }
-    this->texture_views.scene_depth_stencil
-      = context_create_depth_stencil_view(this);
     // mSwapchain.Configure(mPreferredSwapChainFormat,
     // kSwapchainBackBufferUsage,
     //                     mClientWidth, mClientHeight);
@@ -2506,32 +2192,14 @@ static void context_pre_frame(context_t* this)
   this->texture_views.backbuffer
     = wgpuSwapChainGetCurrentTextureView(wgpu_context->swap_chain.instance);
 
-  WGPURenderPassColorAttachment color_attachment = {0};
-  if (this->msaa_sample_count) {
-    // If MSAA is enabled, we render to a multisampled texture and then resolve
-    // to the backbuffer
-    color_attachment.view = this->texture_views.scene_render_target.view;
-    color_attachment.resolveTarget = this->texture_views.backbuffer;
-    color_attachment.loadOp        = WGPULoadOp_Clear;
-    color_attachment.storeOp       = WGPUStoreOp_Store;
-    color_attachment.clearColor    = (WGPUColor){0.f, 0.8f, 1.f, 0.f};
-  }
-  else {
-    /* When MSAA is off, we render directly to the backbuffer */
-    color_attachment.view       = this->texture_views.backbuffer;
-    color_attachment.loadOp     = WGPULoadOp_Clear;
-    color_attachment.storeOp    = WGPUStoreOp_Store;
-    color_attachment.clearColor = (WGPUColor){0.f, 0.8f, 1.f, 0.f};
-  }
-
+  /* With MSAA the scene is rendered into the multisampled texture, resolved
+   * into the backbuffer, otherwise directly into the backbuffer */
+  WGPURenderPassColorAttachment color_attachment                = {0};
   WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {0};
-  depth_stencil_attachment.view = this->texture_views.scene_depth_stencil.view;
-  depth_stencil_attachment.depthLoadOp    = WGPULoadOp_Clear;
-  depth_stencil_attachment.depthStoreOp   = WGPUStoreOp_Store;
-  depth_stencil_attachment.clearDepth     = 1.f;
-  depth_stencil_attachment.stencilLoadOp  = WGPULoadOp_Clear;
-  depth_stencil_attachment.stencilStoreOp = WGPUStoreOp_Store;
-  depth_stencil_attachment.clearStencil   = 0;
+  wgpu_msaa_target_get_attachments(
+    this->msaa_target, this->texture_views.backbuffer,
+    &(WGPUColor){0.f, 0.8f, 1.f, 0.f}, &color_attachment,
+    &depth_stencil_attachment);
 
   this->render_pass_descriptor.colorAttachmentCount = 1;
   this->render_pass_descriptor.colorAttachments     = &color_attachment;
@@ -95,13 +95,17 @@ static void setup_camera(wgpu_example_context_t* context)
                          context->window_size.aspect_ratio, 0.0f, 256.0f);
 }
 
-// Upload texture image data to the GPU
+// Upload texture image data to the GPU, the larger mip levels are streamed
 static void load_texture(wgpu_context_t* wgpu_context)
 {
+  struct wgpu_texture_load_options_t load_options = {
+    .address_mode = WGPUAddressMode_ClampToEdge,
+    .stream_mips  = true,
+  };
   textures.opaque = wgpu_create_texture_from_file(
-    wgpu_context, "textures/basisu/testcard.basis", NULL);
+    wgpu_context, "textures/basisu/testcard.basis", &load_options);
   textures.alpha = wgpu_create_texture_from_file(
-    wgpu_context, "textures/basisu/testcard_rgba.basis", NULL);
+    wgpu_context, "textures/basisu/testcard_rgba.basis", &load_options);
 }
 
 // Setup vertices for a single uv-mapped quad
@@ -248,6 +252,22 @@ static void setup_bind_group(wgpu_context_t* wgpu_context)
   }
 }
 
+// Upload the streamed mip levels and rebind the textures when more levels are
+// resident
+static void update_texture_residency(wgpu_context_t* wgpu_context)
+{
+  wgpu_texture_client_stream_mips(wgpu_context->texture_client);
+  const bool opaque_updated
+    = wgpu_texture_update_mip_residency(wgpu_context, &textures.opaque);
+  const bool alpha_updated
+    = wgpu_texture_update_mip_residency(wgpu_context, &textures.alpha);
+  if (opaque_updated || alpha_updated) {
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.opaque)
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.alpha)
+    setup_bind_group(wgpu_context);
+  }
+}
+
 static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   // Color attachment
@@ -467,6 +487,7 @@ static int example_render(wgpu_example_context_t* context)
   if (!prepared) {
     return 1;
   }
+  update_texture_residency(context->wgpu_context);
   return example_draw(context);
 }
 
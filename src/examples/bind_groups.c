@@ -432,13 +432,14 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpu_gltf_model_draw(model, (wgpu_gltf_model_render_options_t){0});
   }
 
+  // Draw ui overlay into the same pass
+  draw_ui_in_pass(wgpu_context->context, example_on_update_ui_overlay,
+                  wgpu_context->rpass_enc, NULL);
+
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
-  // Draw ui overlay
-  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
-
   // Get command buffer
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
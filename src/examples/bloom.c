@@ -10,8 +10,8 @@
  * WebGPU Example - Bloom (Offscreen Rendering)
  *
  * Advanced fullscreen effect example adding a bloom effect to a scene. Glowing
- * scene parts are rendered to a low res offscreen framebuffer that is applied
- * atop the scene using a two pass separated gaussian blur.
+ * scene parts are rendered to a low res offscreen framebuffer that is blurred
+ * with a progressive downsample / upsample mip chain and added atop the scene.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/bloom
@@ -24,6 +24,15 @@
 
 static bool bloom = true;
 
+// Downsample / upsample bloom of the glow framebuffer
+static wgpu_bloom_t* bloom_filter       = NULL;
+static wgpu_bloom_params_t bloom_params = {
+  .threshold = 0.0f,
+  .knee      = 0.5f,
+  .radius    = 1.0f,
+  .intensity = 1.5f,
+};
+
 static texture_t cubemap;
 
 static struct {
@@ -35,7 +44,6 @@ static struct {
 static struct {
   wgpu_buffer_t scene;
   wgpu_buffer_t skybox;
-  wgpu_buffer_t blur_params;
 } uniform_buffers;
 
 typedef struct {
@@ -44,44 +52,27 @@ typedef struct {
   mat4 model;
 } ubo_scene_t;
 
-typedef struct {
-  float blur_scale;
-  float blur_strength;
-} ubo_blur_params_t;
-
 static struct {
   ubo_scene_t scene, skybox;
-  ubo_blur_params_t blur_params;
-} ubos = {
-  .blur_params = (ubo_blur_params_t){
-    .blur_scale    = 1.0f,
-    .blur_strength = 1.5f,
-  },
-};
+} ubos;
 
 static struct {
-  WGPURenderPipeline blur_vert;
-  WGPURenderPipeline blur_horz;
   WGPURenderPipeline glow_pass;
   WGPURenderPipeline phong_pass;
   WGPURenderPipeline skybox;
 } pipelines;
 
 static struct {
-  WGPUPipelineLayout blur;
   WGPUPipelineLayout scene;
   WGPUPipelineLayout skybox;
 } pipeline_layouts;
 
 static struct {
-  WGPUBindGroup blur_vert;
-  WGPUBindGroup blur_horz;
   WGPUBindGroup scene;
   WGPUBindGroup skybox;
 } bind_groups;
 
 static struct {
-  WGPUBindGroupLayout blur;
   WGPUBindGroupLayout scene;
   WGPUBindGroupLayout skybox;
 } bind_group_layouts;
@@ -104,8 +95,7 @@ typedef struct {
 
 static struct {
   uint32_t width, height;
-  WGPUSampler sampler;
-  frame_buffer_t frame_buffers[2];
+  frame_buffer_t frame_buffer;
 } offscreen_pass;
 
 static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
@@ -259,88 +249,29 @@ static void prepare_offscreen_frame_buffer(wgpu_context_t* wgpu_context,
     };
 }
 
-// Prepare the offscreen framebuffers used for the vertical- and horizontal blur
+// Prepare the offscreen framebuffer of the glowing scene parts and the bloom
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
 {
   offscreen_pass.width  = (uint32_t)FB_DIM;
   offscreen_pass.height = (uint32_t)FB_DIM;
 
-  // Create sampler to sample from the color attachments
-  offscreen_pass.sampler = wgpuDeviceCreateSampler(
-    wgpu_context->device, &(WGPUSamplerDescriptor){
-                            .addressModeU  = WGPUAddressMode_ClampToEdge,
-                            .addressModeV  = WGPUAddressMode_ClampToEdge,
-                            .addressModeW  = WGPUAddressMode_ClampToEdge,
-                            .minFilter     = WGPUFilterMode_Linear,
-                            .magFilter     = WGPUFilterMode_Linear,
-                            .mipmapFilter  = WGPUFilterMode_Linear,
-                            .lodMinClamp   = 0.0f,
-                            .lodMaxClamp   = 1.0f,
-                            .maxAnisotropy = 1,
-                          });
-
-  // Create two frame buffers
-  prepare_offscreen_frame_buffer(wgpu_context, &offscreen_pass.frame_buffers[0],
-                                 FB_COLOR_FORMAT, FB_DEPTH_FORMAT);
-  prepare_offscreen_frame_buffer(wgpu_context, &offscreen_pass.frame_buffers[1],
+  prepare_offscreen_frame_buffer(wgpu_context, &offscreen_pass.frame_buffer,
                                  FB_COLOR_FORMAT, FB_DEPTH_FORMAT);
+
+  // The bloom is added to the scene in the main render pass
+  bloom_filter = wgpu_bloom_create(
+    wgpu_context, &(wgpu_bloom_desc_t){
+                    .label            = "Glow bloom",
+                    .width            = offscreen_pass.width,
+                    .height           = offscreen_pass.height,
+                    .composite_format = wgpu_context->swap_chain.format,
+                    .composite_depth_stencil_format = FB_DEPTH_FORMAT,
+                  });
+  wgpu_bloom_set_params(bloom_filter, &bloom_params);
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 {
-  // Bind group layout for fullscreen blur
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[3] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Fragment shader uniform buffer
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Fragment,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = false,
-          .minBindingSize   = sizeof(ubo_blur_params_t),
-        },
-        .sampler = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: Fragment shader image view
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-          .multisampled  = false,
-        },
-        .storageTexture = {0},
-      },
-      [2] = (WGPUBindGroupLayoutEntry) {
-        // Binding 2: Fragment shader image sampler
-        .binding    = 2,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      }
-    };
-
-    // Create the bind group layout
-    bind_group_layouts.blur = wgpuDeviceCreateBindGroupLayout(
-      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
-                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-                              .entries    = bgl_entries,
-                            });
-    ASSERT(bind_group_layouts.blur != NULL)
-
-    // Create the pipeline layout
-    pipeline_layouts.blur = wgpuDeviceCreatePipelineLayout(
-      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
-                              .bindGroupLayoutCount = 1,
-                              .bindGroupLayouts     = &bind_group_layouts.blur,
-                            });
-    ASSERT(pipeline_layouts.blur != NULL)
-  }
-
   // Bind group layout for scene rendering
   {
     WGPUBindGroupLayoutEntry bgl_entries[1] = {
@@ -430,68 +361,6 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 
 static void setup_bind_groups(wgpu_context_t* wgpu_context)
 {
-  // Bind group for full screen blur
-  // Vertical blur
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-        [0] = (WGPUBindGroupEntry) {
-          // Binding 0: Fragment shader uniform buffer
-          .binding = 0,
-          .buffer  = uniform_buffers.blur_params.buffer,
-          .offset  = 0,
-          .size    = uniform_buffers.blur_params.size,
-        },
-        [1] = (WGPUBindGroupEntry) {
-         // Binding 1: Fragment shader image sampler
-          .binding     = 1,
-          .textureView = offscreen_pass.frame_buffers[0].color.texture_view,
-        },
-        [2] = (WGPUBindGroupEntry) {
-          // Binding 2: Fragment shader image sampler
-          .binding = 2,
-          .sampler = offscreen_pass.sampler,
-        },
-      };
-
-    bind_groups.blur_vert = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .layout     = bind_group_layouts.blur,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_groups.blur_vert != NULL)
-  }
-  // Horizontal blur
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-        [0] = (WGPUBindGroupEntry) {
-          // Binding 0: Fragment shader uniform buffer
-          .binding = 0,
-          .buffer  = uniform_buffers.blur_params.buffer,
-          .offset  = 0,
-          .size    = uniform_buffers.blur_params.size,
-        },
-        [1] = (WGPUBindGroupEntry) {
-         // Binding 1: Fragment shader image sampler
-          .binding     = 1,
-          .textureView = offscreen_pass.frame_buffers[1].color.texture_view,
-        },
-        [2] = (WGPUBindGroupEntry) {
-          // Binding 2: Fragment shader image sampler
-          .binding = 2,
-          .sampler = offscreen_pass.sampler,
-        },
-      };
-
-    bind_groups.blur_horz = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .layout     = bind_group_layouts.blur,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_groups.blur_horz != NULL)
-  }
-
   // Bind group for scene rendering
   {
     WGPUBindGroupEntry bg_entries[1] = {
@@ -594,117 +463,6 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
         .sample_count = 1,
       });
 
-  // Blur pipelines
-  {
-    // Additive blending
-    WGPUBlendState blend_state_radial_blur = {
-      .color.operation = WGPUBlendOperation_Add,
-      .color.srcFactor = WGPUBlendFactor_One,
-      .color.dstFactor = WGPUBlendFactor_One,
-      .alpha.operation = WGPUBlendOperation_Add,
-      .alpha.srcFactor = WGPUBlendFactor_SrcAlpha,
-      .alpha.dstFactor = WGPUBlendFactor_DstAlpha,
-    };
-    WGPUColorTargetState color_target_state = (WGPUColorTargetState){
-      .format    = FB_COLOR_FORMAT,
-      .blend     = &blend_state_radial_blur,
-      .writeMask = WGPUColorWriteMask_All,
-    };
-
-    // Vertical blur pipeline
-    {
-      // Vertex state
-      WGPUVertexState vertex_state = wgpu_create_vertex_state(
-                wgpu_context, &(wgpu_vertex_state_t){
-                .shader_desc = (wgpu_shader_desc_t){
-                  // Vertex shader SPIR-V
-                  .label = "gaussblur_vert.vertex_shader",
-                  .file  = "shaders/bloom/gaussblur.vert.spv",
-                },
-                // Empty vertex input state
-                .buffer_count = 0,
-                .buffers      = NULL,
-              });
-
-      // Fragment state
-      WGPUFragmentState fragment_state = wgpu_create_fragment_state(
-                wgpu_context, &(wgpu_fragment_state_t){
-                .shader_desc = (wgpu_shader_desc_t){
-                  // Fragment shader SPIR-V
-                  .label = "gaussblur_vert.fragment_shader",
-                  .file  = "shaders/bloom/gaussblur_vert.frag.spv",
-                },
-                .target_count = 1,
-                .targets      = &color_target_state,
-              });
-
-      // Create rendering pipeline using the specified states
-      pipelines.blur_vert = wgpuDeviceCreateRenderPipeline(
-        wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                                .label        = "vertical_blur_render_pipeline",
-                                .layout       = pipeline_layouts.blur,
-                                .primitive    = primitive_state,
-                                .vertex       = vertex_state,
-                                .fragment     = &fragment_state,
-                                .depthStencil = &depth_stencil_state,
-                                .multisample  = multisample_state,
-                              });
-      ASSERT(pipelines.blur_vert);
-
-      // Partial cleanup
-      WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-      WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
-    }
-
-    // Horizontal blur pipeline
-    {
-      // Using swapchain format in this pipeline
-      color_target_state.format = wgpu_context->swap_chain.format;
-
-      // Vertex state
-      WGPUVertexState vertex_state = wgpu_create_vertex_state(
-                wgpu_context, &(wgpu_vertex_state_t){
-                .shader_desc = (wgpu_shader_desc_t){
-                  // Vertex shader SPIR-V
-                  .label = "gaussblur_horz_vertex_shader",
-                  .file  = "shaders/bloom/gaussblur.vert.spv",
-                },
-                // Empty vertex input state
-                .buffer_count = 0,
-                .buffers      = NULL,
-              });
-
-      // Fragment state
-      WGPUFragmentState fragment_state = wgpu_create_fragment_state(
-                wgpu_context, &(wgpu_fragment_state_t){
-                .shader_desc = (wgpu_shader_desc_t){
-                  // Fragment shader SPIR-V
-                  .label = "gaussblur_horz_fragment_shader",
-                  .file  = "shaders/bloom/gaussblur_horz.frag.spv",
-                },
-                .target_count = 1,
-                .targets      = &color_target_state,
-              });
-
-      // Create rendering pipeline using the specified states
-      pipelines.blur_horz = wgpuDeviceCreateRenderPipeline(
-        wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                                .label     = "horizontal_blur_render_pipeline",
-                                .layout    = pipeline_layouts.blur,
-                                .primitive = primitive_state,
-                                .vertex    = vertex_state,
-                                .fragment  = &fragment_state,
-                                .depthStencil = &depth_stencil_state,
-                                .multisample  = multisample_state,
-                              });
-      ASSERT(pipelines.blur_horz);
-
-      // Partial cleanup
-      WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-      WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
-    }
-  }
-
   // Vertex buffer layout
   WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
     gltf_model,
@@ -915,14 +673,6 @@ static void update_uniform_buffers_scene(wgpu_example_context_t* context)
                           0, &ubos.skybox, uniform_buffers.skybox.size);
 }
 
-// Update blur pass parameter uniform buffer
-void update_uniform_buffers_blur(wgpu_example_context_t* context)
-{
-  wgpu_queue_write_buffer(context->wgpu_context,
-                          uniform_buffers.blur_params.buffer, 0,
-                          &ubos.blur_params, uniform_buffers.blur_params.size);
-}
-
 // Prepare and initialize uniform buffer containing shader uniforms
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
@@ -934,14 +684,6 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
       .size  = sizeof(ubo_scene_t),
     });
 
-  // Blur parameters uniform buffers
-  uniform_buffers.blur_params = wgpu_create_buffer(
-    context->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(ubo_blur_params_t),
-    });
-
   // Skybox
   uniform_buffers.skybox = wgpu_create_buffer(
     context->wgpu_context,
@@ -952,7 +694,6 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
 
   // Initialize uniform buffers
   update_uniform_buffers_scene(context);
-  update_uniform_buffers_blur(context);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -978,9 +719,13 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
     imgui_overlay_checkBox(context->imgui_overlay, "Bloom", &bloom);
-    if (imgui_overlay_input_float(context->imgui_overlay, "Scale",
-                                  &ubos.blur_params.blur_scale, 0.1f, "%.1f")) {
-      update_uniform_buffers_blur(context);
+    if (imgui_overlay_input_float(context->imgui_overlay, "Intensity",
+                                  &bloom_params.intensity, 0.1f, "%.1f")) {
+      wgpu_bloom_set_params(bloom_filter, &bloom_params);
+    }
+    if (imgui_overlay_input_float(context->imgui_overlay, "Radius",
+                                  &bloom_params.radius, 0.1f, "%.1f")) {
+      wgpu_bloom_set_params(bloom_filter, &bloom_params);
     }
   }
 }
@@ -992,10 +737,10 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
   /*
-   * The blur method used in this example is multi pass and renders the vertical
-   * blur first and then the horizontal one.
-   * While it's possible to blur in one pass, this method is widely used as it
-   * requires far less samples to generate the blur.
+   * The blur method used in this example filters the glow framebuffer into a
+   * mip chain: every level is downsampled from the previous one and the levels
+   * are upsampled and added back up again, which results in a wide blur radius
+   * at a fraction of the texel fetches of a full resolution gaussian blur.
    */
 
   if (bloom) {
@@ -1007,7 +752,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     // Create render pass encoder for encoding drawing commands
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc,
-      &offscreen_pass.frame_buffers[0].render_pass_desc.render_pass_descriptor);
+      &offscreen_pass.frame_buffer.render_pass_desc.render_pass_descriptor);
 
     // Set viewport
     wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
@@ -1032,46 +777,16 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
     /*
-     * Second render pass: Vertical blur.
-     *
-     * Render contents of the first pass into a second framebuffer and apply a
-     * vertical blur.
-     * This is the first blur pass, the horizontal blur is applied
-     * when rendering on top of the scene.
+     * Second render pass: Downsample and upsample passes of the bloom.
      */
-
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc,
-      &offscreen_pass.frame_buffers[1].render_pass_desc.render_pass_descriptor);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                     (float)offscreen_pass.width,
-                                     (float)offscreen_pass.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        offscreen_pass.width,
-                                        offscreen_pass.height);
-
-    // Render
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.blur_vert);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.blur_vert, 0, 0);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
-
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+    wgpu_bloom_encode(bloom_filter, wgpu_context->cmd_enc,
+                      offscreen_pass.frame_buffer.color.texture_view);
   }
 
   /*
-   * Third render pass: Scene rendering with applied vertical blur
+   * Third render pass: Scene rendering with applied bloom
    *
-   * Renders the scene and the (vertically blurred) contents of the second
-   * framebuffer and apply a horizontal blur.
+   * Renders the scene and adds the bloom of the glowing parts.
    */
   {
     // Set target frame buffer
@@ -1104,13 +819,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       bind_groups.scene, 0, 0);
     wgpu_gltf_model_draw(models.ufo, (wgpu_gltf_model_render_options_t){0});
 
-    // Fullscreen triangle (clipped to a quad) with horizontal blur
+    // Fullscreen triangle (clipped to a quad) with the bloom
     if (bloom) {
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       pipelines.blur_horz);
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.blur_horz, 0, 0);
-      wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+      wgpu_bloom_composite(bloom_filter, wgpu_context->rpass_enc);
     }
 
     // End render pass
@@ -1171,40 +882,29 @@ static void example_destroy(wgpu_example_context_t* context)
   wgpu_gltf_model_destroy(models.ufo_glow);
   wgpu_gltf_model_destroy(models.skybox);
 
-  for (uint32_t i = 0; i < 2; ++i) {
-    WGPU_RELEASE_RESOURCE(Texture,
-                          offscreen_pass.frame_buffers[i].color.texture)
-    WGPU_RELEASE_RESOURCE(Texture,
-                          offscreen_pass.frame_buffers[i].depth.texture)
+  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.frame_buffer.color.texture)
+  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.frame_buffer.depth.texture)
 
-    WGPU_RELEASE_RESOURCE(TextureView,
-                          offscreen_pass.frame_buffers[i].color.texture_view)
-    WGPU_RELEASE_RESOURCE(TextureView,
-                          offscreen_pass.frame_buffers[i].depth.texture_view)
-  }
+  WGPU_RELEASE_RESOURCE(TextureView,
+                        offscreen_pass.frame_buffer.color.texture_view)
+  WGPU_RELEASE_RESOURCE(TextureView,
+                        offscreen_pass.frame_buffer.depth.texture_view)
 
-  WGPU_RELEASE_RESOURCE(Sampler, offscreen_pass.sampler)
+  wgpu_bloom_destroy(bloom_filter);
 
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.scene.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.skybox.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.blur_params.buffer)
 
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.blur_vert)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.blur_horz)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.glow_pass)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.phong_pass)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.skybox)
 
-  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.blur)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.scene)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.skybox)
 
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.blur_vert)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.blur_horz)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.scene)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.skybox)
 
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.blur)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.scene)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.skybox)
 }
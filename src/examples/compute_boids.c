@@ -3,7 +3,10 @@
 
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../webgpu/bin_sort.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/random_fill.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Boids
@@ -16,13 +19,23 @@
  * A compute shader updates two ping-pong buffers which store particle data. The
  * data is used to draw instanced particles.
  *
+ * The neighbour search either visits all boids or uses a uniform grid: the
+ * boids are sorted by grid cell each frame and a boid only visits the cells
+ * within the largest rule distance. The boid count is set with
+ * --num-particles=<count> (up to 1M boids).
+ *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/tree/main/src/sample/computeBoids
  * https://github.com/gfx-rs/wgpu-rs/tree/master/examples/boids
  * -------------------------------------------------------------------------- */
 
 // Number of boid particles to simulate
-static const uint32_t NUM_PARTICLES = 1500;
+#define NUM_PARTICLES 1500u
+#define MAX_NUM_PARTICLES (1024u * 1024u)
+static uint32_t num_particles = NUM_PARTICLES;
+
+// Uniform grid over the [-1, 1] simulation area for the neighbour search
+#define GRID_DIM 32u
 
 // Number of single-particle calculations (invocations) in each gpu work group
 static const uint32_t PARTICLES_PER_GROUP = 64;
@@ -83,8 +96,23 @@ static WGPUPipelineLayout render_pipeline_layout;
 static WGPUComputePipeline compute_pipeline;
 static WGPURenderPipeline render_pipeline;
 
-// Bind groups and layouts
+// Grid neighbour search
+static struct {
+  bool enabled;
+  wgpu_bin_sort_t* bin_sort;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline cells_pipeline;
+  WGPUComputePipeline update_pipeline;
+} grid = {
+  .enabled = true,
+};
+
+// Bind groups and layouts, bind group i updates particle buffer i into the
+// other one
 static WGPUBindGroup particle_bind_groups[2];
+static uint32_t step_index = 0;
 static WGPUBindGroupLayout compute_bind_group_layout;
 
 // Render pass descriptor for frame buffer writes
@@ -131,7 +159,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type           = WGPUBufferBindingType_ReadOnlyStorage,
-        .minBindingSize = NUM_PARTICLES * 16,
+        .minBindingSize = num_particles * 16,
       },
       .sampler = {0},
     },
@@ -140,7 +168,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type           = WGPUBufferBindingType_Storage,
-        .minBindingSize = NUM_PARTICLES * 16,
+        .minBindingSize = num_particles * 16,
       },
       .sampler = {0},
     },
@@ -200,24 +228,52 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
     WGPUBufferUsage_Uniform);
 
   // Buffer for all particles data of type [(posx,posy,velx,vely),...]
-  float particle_data[NUM_PARTICLES * 4];
-  memset(particle_data, 0.f, sizeof(particle_data));
-  srand((unsigned int)time(NULL)); // randomize seed
-  for (uint32_t i = 0; i < NUM_PARTICLES; i += 4) {
-    const size_t chunk       = i * 4;
-    particle_data[chunk + 0] = 2 * (random_float() - 0.5f);        // posx
-    particle_data[chunk + 1] = 2 * (random_float() - 0.5f);        // posy
-    particle_data[chunk + 2] = 2 * (random_float() - 0.5f) * 0.1f; // velx
-    particle_data[chunk + 3] = 2 * (random_float() - 0.5f) * 0.1f; // vely
-  }
+  const uint32_t particle_data_size = num_particles * 4 * sizeof(float);
 
   // Creates two buffers of particle data each of size NUM_PARTICLES the two
-  // buffers alternate as dst and src for each frame
+  // buffers alternate as dst and src for each frame. The data is generated on
+  // the GPU, the same seed fills both buffers with the same particles.
+  wgpu_context_t* wgpu_context    = context->wgpu_context;
+  wgpu_random_fill_t* random_fill = wgpu_random_fill_create(wgpu_context);
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  const uint32_t seed = random_uint32();
   for (uint32_t i = 0; i < 2; ++i) {
-    particle_buffers[i] = wgpu_create_buffer_from_data(
-      context->wgpu_context, &particle_data, sizeof(particle_data),
-      WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage);
+    particle_buffers[i] = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Particle buffer",
+        .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage,
+        .size  = particle_data_size,
+      });
+    ASSERT(particle_buffers[i] != NULL);
+    // posx, posy
+    wgpu_random_fill_buffer(random_fill, cmd_enc, particle_buffers[i],
+                            num_particles,
+                            &(wgpu_random_fill_desc_t){
+                              .seed       = seed,
+                              .min        = -1.0f,
+                              .max        = 1.0f,
+                              .components = 2,
+                              .stride     = 4,
+                            });
+    // velx, vely
+    wgpu_random_fill_buffer(random_fill, cmd_enc, particle_buffers[i],
+                            num_particles,
+                            &(wgpu_random_fill_desc_t){
+                              .seed       = seed + 1,
+                              .min        = -0.1f,
+                              .max        = 0.1f,
+                              .components = 2,
+                              .stride     = 4,
+                              .offset     = 2,
+                            });
   }
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  wgpu_random_fill_destroy(random_fill);
 
   // Create two bind groups, one for each buffer as the src where the alternate
   // buffer is used as the dst
@@ -233,13 +289,13 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
         .binding = 1,
         .buffer  = particle_buffers[i],
         .offset  = 0,
-        .size    = sizeof(particle_data),
+        .size    = particle_data_size,
       },
       [2] = (WGPUBindGroupEntry) {
         .binding = 2,
         .buffer  = particle_buffers[(i + 1) % 2],
         .offset  = 0,
-        .size    = sizeof(particle_data), // bind to opposite buffer
+        .size    = particle_data_size, // bind to opposite buffer
       },
     };
     WGPUBindGroupDescriptor bg_desc = {
@@ -253,7 +309,7 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
 
   // Calculates number of work groups from PARTICLES_PER_GROUP constant
   work_group_count
-    = (uint32_t)ceilf((float)NUM_PARTICLES / (float)PARTICLES_PER_GROUP);
+    = (uint32_t)ceilf((float)num_particles / (float)PARTICLES_PER_GROUP);
 }
 
 static void update_sim_params(wgpu_context_t* wgpu_context)
@@ -382,6 +438,217 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   wgpu_shader_release(&boids_comp_shader);
 }
 
+/* Grid neighbour search, the update follows updateSprites.wgsl but only
+ * visits the boids of the cells within the largest rule distance */
+// clang-format off
+static const char* grid_shader_wgsl = CODE(
+  struct Particle {
+    pos : vec2<f32>,
+    vel : vec2<f32>,
+  }
+  struct SimParams {
+    deltaT : f32,
+    rule1Distance : f32,
+    rule2Distance : f32,
+    rule3Distance : f32,
+    rule1Scale : f32,
+    rule2Scale : f32,
+    rule3Scale : f32,
+  }
+  struct Particles {
+    particles : array<Particle>,
+  }
+
+  @binding(0) @group(0) var<uniform> params : SimParams;
+  @binding(1) @group(0) var<storage, read> particlesA : Particles;
+  @binding(2) @group(0) var<storage, read_write> particlesB : Particles;
+  @binding(0) @group(1) var<storage, read_write> cellKeys : array<u32>;
+  @binding(1) @group(1) var<storage, read> sortedIndices : array<u32>;
+  @binding(2) @group(1) var<storage, read> cellOffsets : array<u32>;
+
+  const kGridDim = 32;
+  const kCellSize = 0.0625;
+
+  fn cellOf(pos : vec2<f32>) -> vec2<i32> {
+    return clamp(vec2<i32>(floor((pos + vec2<f32>(1.0)) / kCellSize)),
+                 vec2<i32>(0), vec2<i32>(kGridDim - 1));
+  }
+
+  @compute @workgroup_size(64)
+  fn compute_cells(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let index = gid.x;
+    if (index >= arrayLength(&particlesA.particles)) {
+      return;
+    }
+    let cell = cellOf(particlesA.particles[index].pos);
+    cellKeys[index] = u32(cell.x + cell.y * kGridDim);
+  }
+
+  @compute @workgroup_size(64)
+  fn update(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let index = gid.x;
+    if (index >= arrayLength(&particlesA.particles)) {
+      return;
+    }
+    var vPos = particlesA.particles[index].pos;
+    var vVel = particlesA.particles[index].vel;
+    var cMass = vec2<f32>(0.0, 0.0);
+    var cVel = vec2<f32>(0.0, 0.0);
+    var colVel = vec2<f32>(0.0, 0.0);
+    var cMassCount = 0u;
+    var cVelCount = 0u;
+
+    let maxDistance = max(params.rule1Distance,
+                          max(params.rule2Distance, params.rule3Distance));
+    let rings = i32(ceil(maxDistance / kCellSize));
+    let cell = cellOf(vPos);
+    let lo = max(cell - vec2<i32>(rings), vec2<i32>(0));
+    let hi = min(cell + vec2<i32>(rings), vec2<i32>(kGridDim - 1));
+    for (var y = lo.y; y <= hi.y; y = y + 1) {
+      for (var x = lo.x; x <= hi.x; x = x + 1) {
+        let c = u32(x + y * kGridDim);
+        for (var j = cellOffsets[c]; j < cellOffsets[c + 1u]; j = j + 1u) {
+          let i = sortedIndices[j];
+          if (i == index) {
+            continue;
+          }
+          let pos = particlesA.particles[i].pos;
+          let vel = particlesA.particles[i].vel;
+          let dist = distance(pos, vPos);
+          if (dist < params.rule1Distance) {
+            cMass = cMass + pos;
+            cMassCount = cMassCount + 1u;
+          }
+          if (dist < params.rule2Distance) {
+            colVel = colVel - (pos - vPos);
+          }
+          if (dist < params.rule3Distance) {
+            cVel = cVel + vel;
+            cVelCount = cVelCount + 1u;
+          }
+        }
+      }
+    }
+    if (cMassCount > 0u) {
+      cMass = (cMass / vec2<f32>(f32(cMassCount))) - vPos;
+    }
+    if (cVelCount > 0u) {
+      cVel = cVel / vec2<f32>(f32(cVelCount));
+    }
+    vVel = vVel + (cMass * params.rule1Scale) + (colVel * params.rule2Scale)
+           + (cVel * params.rule3Scale);
+
+    // clamp velocity for a more pleasing simulation
+    vVel = normalize(vVel) * clamp(length(vVel), 0.0, 0.1);
+    // kinematic update
+    vPos = vPos + (vVel * params.deltaT);
+    // Wrap around boundary
+    if (vPos.x < -1.0) {
+      vPos.x = 1.0;
+    }
+    if (vPos.x > 1.0) {
+      vPos.x = -1.0;
+    }
+    if (vPos.y < -1.0) {
+      vPos.y = 1.0;
+    }
+    if (vPos.y > 1.0) {
+      vPos.y = -1.0;
+    }
+    // Write back
+    particlesB.particles[index].pos = vPos;
+    particlesB.particles[index].vel = vVel;
+  }
+);
+// clang-format on
+
+static WGPUComputePipeline create_grid_pipeline(wgpu_context_t* wgpu_context,
+                                                const char* entry)
+{
+  wgpu_shader_t grid_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = grid_shader_wgsl,
+                    .entry            = entry,
+                  });
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(
+    wgpu_context->device,
+    &(WGPUComputePipelineDescriptor){
+      .layout  = grid.pipeline_layout,
+      .compute = grid_shader.programmable_stage_descriptor,
+    });
+  ASSERT(pipeline != NULL)
+  wgpu_shader_release(&grid_shader);
+  return pipeline;
+}
+
+static void prepare_grid(wgpu_context_t* wgpu_context)
+{
+  grid.bin_sort = wgpu_bin_sort_create(wgpu_context,
+                                       &(wgpu_bin_sort_desc_t){
+                                         .count     = num_particles,
+                                         .bin_count = GRID_DIM * GRID_DIM,
+                                       });
+
+  // Group 1: cell keys, sorted indices and cell offsets of the bin sort
+  WGPUBuffer buffers[3] = {
+    wgpu_bin_sort_get_keys(grid.bin_sort),
+    wgpu_bin_sort_get_indices(grid.bin_sort),
+    wgpu_bin_sort_get_offsets(grid.bin_sort),
+  };
+  const uint64_t sizes[3] = {
+    num_particles * sizeof(uint32_t),
+    num_particles * sizeof(uint32_t),
+    (GRID_DIM * GRID_DIM + 1) * sizeof(uint32_t),
+  };
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {0};
+  WGPUBindGroupEntry bg_entries[3]        = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(buffers); ++i) {
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type = (i == 0) ? WGPUBufferBindingType_Storage :
+                           WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = sizes[i],
+      },
+    };
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding = i,
+      .buffer  = buffers[i],
+      .offset  = 0,
+      .size    = sizes[i],
+    };
+  }
+  grid.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(grid.bind_group_layout != NULL)
+  grid.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout     = grid.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(grid.bind_group != NULL)
+
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    compute_bind_group_layout, /* Group 0 : Sim params and particles */
+    grid.bind_group_layout,    /* Group 1 : Grid */
+  };
+  grid.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 2,
+                            .bindGroupLayouts     = bind_group_layouts,
+                          });
+  ASSERT(grid.pipeline_layout != NULL)
+
+  grid.cells_pipeline  = create_grid_pipeline(wgpu_context, "compute_cells");
+  grid.update_pipeline = create_grid_pipeline(wgpu_context, "update");
+}
+
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
@@ -389,6 +656,7 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_pipeline_layout(context->wgpu_context);
     prepare_uniform_buffers(context);
     prepare_pipelines(context->wgpu_context);
+    prepare_grid(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -397,6 +665,33 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+/* Records one simulation step of all boids */
+static void simulation_step(wgpu_example_context_t* context,
+                            WGPUComputePassEncoder cpass_enc)
+{
+  UNUSED_VAR(context);
+
+  WGPUBindGroup particle_bind_group = particle_bind_groups[step_index % 2];
+  if (grid.enabled) {
+    // Sort the boids by cell, the bin sort replaces the bind group 0
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.cells_pipeline);
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, particle_bind_group, 0,
+                                       NULL);
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, grid.bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, work_group_count, 1, 1);
+    wgpu_bin_sort_dispatch(grid.bin_sort, cpass_enc);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.update_pipeline);
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, grid.bind_group, 0, NULL);
+  }
+  else {
+    wgpuComputePassEncoderSetPipeline(cpass_enc, compute_pipeline);
+  }
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, particle_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, work_group_count, 1, 1);
+  ++step_index;
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
@@ -407,6 +702,9 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
         update_sim_params(context->wgpu_context);
       }
     }
+    imgui_overlay_checkBox(context->imgui_overlay, "Grid neighbour search",
+                           &grid.enabled);
+    imgui_overlay_text("Boids: %u", num_particles);
   }
 }
 
@@ -419,20 +717,8 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Compute pass
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute_pipeline);
-    wgpuComputePassEncoderSetBindGroup(
-      wgpu_context->cpass_enc, 0,
-      particle_bind_groups[context->frame.index % 2], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
-                                             work_group_count, 1, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
+  // Compute pass, the simulation steps scheduled for this frame
+  record_simulation_steps(context, wgpu_context->cmd_enc);
 
   // Render pass
   {
@@ -442,11 +728,11 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
     // render dst particles
     wgpuRenderPassEncoderSetVertexBuffer(
       wgpu_context->rpass_enc, 0,
-      particle_buffers[(context->frame.index + 1) % 2], 0, WGPU_WHOLE_SIZE);
+      particle_buffers[step_index % 2], 0, WGPU_WHOLE_SIZE);
     // the three instance-local vertices
     wgpuRenderPassEncoderSetVertexBuffer(
       wgpu_context->rpass_enc, 1, sprite_vertex_buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, NUM_PARTICLES, 0, 0);
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, num_particles, 0, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
@@ -505,10 +791,55 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, sprite_vertex_buffer)
   WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipeline)
   WGPU_RELEASE_RESOURCE(ComputePipeline, compute_pipeline)
+  wgpu_bin_sort_destroy(grid.bin_sort);
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, grid.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, grid.bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, grid.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.cells_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.update_pipeline)
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]                = {"--num-particles="};
+  char* filters_flag[1]              = {"--help-compute-boids"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  int32_t particle_count           = (int32_t)NUM_PARTICLES;
+  struct argparse_option options[] = {
+    OPT_INTEGER(0, "num-particles", &particle_count,
+                "number of boids (up to 1M)", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-compute-boids", NULL, "show the compute boids options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  num_particles
+    = (uint32_t)CLAMP(particle_count, 1, (int32_t)MAX_NUM_PARTICLES);
 }
 
 void example_compute_boids(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
@@ -516,9 +847,10 @@ void example_compute_boids(int argc, char* argv[])
      .overlay = true,
      .vsync   = true,
     },
-    .example_initialize_func = &example_initialize,
-    .example_render_func     = &example_render,
-    .example_destroy_func    = &example_destroy,
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_simulation_step_func = &simulation_step,
   });
   // clang-format on
 }
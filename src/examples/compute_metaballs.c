@@ -1,17 +1,25 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <float.h>
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../webgpu/bloom.h"
+#include "../webgpu/compute_scheduler.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/profiler.h"
 #include "../webgpu/texture.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Metaballs
  *
- * WebGPU demo featuring marching cubes and bloom post-processing via compute
- * shaders, physically based shading, deferred rendering, gamma correction and
- * shadow mapping.
+ * WebGPU demo featuring marching cubes via compute shaders, bloom
+ * post-processing, physically based shading, deferred rendering, gamma
+ * correction and shadow mapping. The compute work of a frame is submitted in a command
+ * buffer of its own before the swap chain image is acquired. With the
+ * DawnShaderFloat16 feature the field volume is stored in f16,
+ * --metaballs-f32-volume keeps it in f32 to benchmark both precisions.
  *
  * Ref:
  * https://github.com/gnikoloff/webgpu-compute-metaballs
@@ -24,7 +32,19 @@
  * https://github.com/gnikoloff/webgpu-compute-metaballs/blob/master/src/constants.ts
  * -------------------------------------------------------------------------- */
 
-#define MAX_METABALLS 256u
+/* Capacity of the metaballs buffer, the ball count is set at runtime */
+#define MAX_METABALLS 4096u
+#define DEFAULT_METABALLS 256u
+
+/* Bins per axis of the coarse grid the metaballs are sorted into before the
+ * field evaluation */
+#define METABALLS_BIN_GRID_SIZE 16u
+#define METABALLS_BIN_COUNT                                                    \
+  (METABALLS_BIN_GRID_SIZE * METABALLS_BIN_GRID_SIZE * METABALLS_BIN_GRID_SIZE)
+
+/* Capacity of the binned ball indices, a ball is referenced by every bin its
+ * radius overlaps */
+#define METABALLS_MAX_BIN_REFERENCES (4u * 1024u * 1024u)
 
 static const WGPUTextureFormat DEPTH_FORMAT = WGPUTextureFormat_Depth24Plus;
 
@@ -32,6 +52,13 @@ static const uint32_t SHADOW_MAP_SIZE = 128;
 
 static const uint32_t METABALLS_COMPUTE_WORKGROUP_SIZE[3] = {4, 4, 4};
 
+/* Workgroup size of the isosurface extraction passes */
+#define METABALLS_SURFACE_WORKGROUP_SIZE 64u
+
+/* Upper bound of the generated isosurface vertices, 5 triangles per active
+ * cell */
+#define METABALLS_MAX_SURFACE_VERTICES (3u * 1024u * 1024u)
+
 static const vec4 BACKGROUND_COLOR = {0.1f, 0.1f, 0.1f, 1.0f};
 
 /* -------------------------------------------------------------------------- *
@@ -99,6 +126,7 @@ typedef struct {
   uint32_t point_lights_count;
   float output_scale;
   bool update_metaballs;
+  float volume_resolution; /* scale of the marching cubes grid */
 } quality_option_t;
 
 /* -------------------------------------------------------------------------- *
@@ -146,6 +174,7 @@ static const quality_option_t QUALITIES[3] = {
     .point_lights_count = 32,
     .output_scale       = 1.0f,
     .update_metaballs   = false,
+    .volume_resolution  = 1.0f,
   },
   [QualitySettings_Medium] = (quality_option_t) {
     .bloom_toggle       = true,
@@ -153,6 +182,7 @@ static const quality_option_t QUALITIES[3] = {
     .point_lights_count = 32,
     .output_scale       = 1.0f,
     .update_metaballs   = true,
+    .volume_resolution  = 1.0f,
    },
   [QualitySettings_High] = (quality_option_t) {
     .bloom_toggle       = true,
@@ -160,9 +190,12 @@ static const quality_option_t QUALITIES[3] = {
     .point_lights_count = 128,
     .output_scale       = 1.0f,
     .update_metaballs   = true,
+    .volume_resolution  = 1.6f,
   },
 };
 
+static const char* QUALITY_NAMES[3] = {"Low", "Medium", "High"};
+
 static quality_settings_enum _quality = QualitySettings_Low;
 
 static quality_option_t settings_get_quality_level()
@@ -180,6 +213,42 @@ static void settings_set_quality(quality_settings_enum v)
   _quality = v;
 }
 
+/* Finest marching cubes grid of the quality levels */
+static float settings_get_max_volume_resolution()
+{
+  float resolution = 0.0f;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(QUALITIES); ++i) {
+    resolution = MAX(resolution, QUALITIES[i].volume_resolution);
+  }
+  return resolution;
+}
+
+static uint32_t _metaballs_count = DEFAULT_METABALLS;
+
+static uint32_t settings_get_metaballs_count()
+{
+  return _metaballs_count;
+}
+
+static void settings_set_metaballs_count(uint32_t v)
+{
+  _metaballs_count = CLAMP(v, 1u, MAX_METABALLS);
+}
+
+/* The field volume is stored in half precision if the device supports it */
+static wgpu_shader_storage_precision_t _volume_precision
+  = Shader_StoragePrecision_F16;
+
+static wgpu_shader_storage_precision_t settings_get_volume_precision()
+{
+  return _volume_precision;
+}
+
+static void settings_set_volume_precision(wgpu_shader_storage_precision_t v)
+{
+  _volume_precision = v;
+}
+
 /* -------------------------------------------------------------------------- *
  * Orthographic Camera
  *
@@ -1328,24 +1397,58 @@ typedef struct {
   wgpu_buffer_t tables_buffer;
   wgpu_buffer_t metaball_buffer;
   wgpu_buffer_t volume_buffer;
+  wgpu_shader_storage_precision_t volume_precision;
   wgpu_buffer_t indirect_render_buffer;
 
+  /* Isosurface extraction buffers, one element per marching cubes cell */
+  struct {
+    wgpu_buffer_t cell_ids;
+    wgpu_buffer_t vertex_counts;
+    wgpu_buffer_t active_flags;
+    wgpu_buffer_t vertex_offsets;
+    wgpu_buffer_t active_cells;
+    wgpu_buffer_t active_count;
+    wgpu_buffer_t dispatch_args;
+  } surface_buffers;
+  /* Coarse grid of ball indices, one count / offset / cursor per bin */
+  struct {
+    wgpu_buffer_t counts;
+    wgpu_buffer_t offsets;
+    wgpu_buffer_t cursors;
+    wgpu_buffer_t balls;
+  } bin_buffers;
+  wgpu_compute_primitives_t* compute_primitives;
+  wgpu_indirect_dispatch_t* indirect_dispatch;
+
+  WGPUComputePipeline count_ball_bins_pipeline;
+  WGPUComputePipeline fill_ball_bins_pipeline;
   WGPUComputePipeline compute_metaballs_pipeline;
-  WGPUComputePipeline compute_marching_cubes_pipeline;
+  WGPUComputePipeline classify_cells_pipeline;
+  WGPUComputePipeline finalize_surface_pipeline;
+  WGPUComputePipeline generate_triangles_pipeline;
 
+  WGPUBindGroup count_ball_bins_bind_group;
+  WGPUBindGroup fill_ball_bins_bind_group;
   WGPUBindGroup compute_metaballs_bind_group;
-  WGPUBindGroup compute_marching_cubes_bind_group;
+  WGPUBindGroup classify_cells_bind_group;
+  WGPUBindGroup finalize_surface_bind_group;
+  WGPUBindGroup generate_triangles_bind_group;
 
-  uint32_t indirect_render_array[9];
   metaball_list metaball_array;
   uint32_t* metaball_array_header;
   metaball_t* metaball_array_balls;
 
   wgpu_buffer_t vertex_buffer;
   wgpu_buffer_t normal_buffer;
-  wgpu_buffer_t index_buffer;
 
-  uint32_t index_count;
+  uint32_t ball_count;
+  uint32_t cell_count;
+  uint32_t cell_capacity; /* cells of the grid the buffers are sized for */
+  uint32_t vertex_capacity;
+  bool surface_dirty;
+  uint32_t surface_version; /* incremented whenever the surface is rebuilt */
+  vec3 bounds_min;          /* bounds of the balls of the last update */
+  vec3 bounds_max;
 
   float strength;
   float strength_target;
@@ -1357,136 +1460,550 @@ typedef struct {
 
 static bool metaballs_compute_is_ready(metaballs_compute_t* this)
 {
-  return (this->compute_metaballs_pipeline != NULL)
-         && (this->compute_marching_cubes_pipeline != NULL);
+  return (this->count_ball_bins_bind_group != NULL)
+         && (this->fill_ball_bins_bind_group != NULL)
+         && (this->compute_metaballs_bind_group != NULL)
+         && (this->classify_cells_bind_group != NULL)
+         && (this->finalize_surface_bind_group != NULL)
+         && (this->generate_triangles_bind_group != NULL);
 }
 
-static void metaballs_compute_init(metaballs_compute_t* this)
+/* Isosurface extraction of the metaballs field:
+ *
+ *   - classify_cells: vertex count and active flag of every cell
+ *   - finalize_surface: draw arguments from the scanned counts
+ *   - generate_triangles: vertices of the active cells only, written at the
+ *     scanned vertex offsets
+ *
+ * The vertex offsets come from an exclusive scan of the vertex counts and the
+ * active cells from a compaction of the cell ids, both recorded with the
+ * compute primitives between the passes. The workgroup count of
+ * generate_triangles is written from the compacted cell count with the
+ * indirect dispatch helper. */
+// clang-format off
+static const char* isosurface_compute_shader_wgsl = CODE(
+  struct Tables {
+    edges : array<u32, 256>,
+    tris  : array<i32, 4096>,
+  }
+
+  struct IsosurfaceVolume {
+    min_corner : vec3f,
+    max_corner : vec3f,
+    step_size  : vec3f,
+    size       : vec3u,
+    threshold  : f32,
+    values     : array<StorageScalar>,
+  }
+
+  override vertex_capacity : u32 = 0u;
+
+  @group(0) @binding(0) var<storage, read> tables : Tables;
+  @group(0) @binding(1) var<storage, read> volume : IsosurfaceVolume;
+  @group(0) @binding(2) var<storage, read_write> vertex_counts : array<u32>;
+  @group(0) @binding(3) var<storage, read_write> active_flags : array<u32>;
+  @group(0) @binding(4) var<storage, read> vertex_offsets : array<u32>;
+  @group(0) @binding(5) var<storage, read> active_cells : array<u32>;
+  @group(0) @binding(6) var<storage, read> active_count : array<u32>;
+  @group(0) @binding(7) var<storage, read_write> positions : array<f32>;
+  @group(0) @binding(8) var<storage, read_write> normals : array<f32>;
+  @group(0) @binding(9) var<storage, read_write> draw_args : array<u32>;
+
+  const WORKGROUP_SIZE = 64u;
+
+  var<private> CORNERS : array<vec3u, 8> = array<vec3u, 8>(
+    vec3u(0, 0, 0), vec3u(1, 0, 0),
+    vec3u(1, 1, 0), vec3u(0, 1, 0),
+    vec3u(0, 0, 1), vec3u(1, 0, 1),
+    vec3u(1, 1, 1), vec3u(0, 1, 1)
+  );
+
+  var<private> EDGE_CORNERS : array<vec2u, 12> = array<vec2u, 12>(
+    vec2u(0, 1), vec2u(1, 2), vec2u(2, 3),
+    vec2u(3, 0), vec2u(4, 5), vec2u(5, 6),
+    vec2u(6, 7), vec2u(7, 4), vec2u(0, 4),
+    vec2u(1, 5), vec2u(2, 6), vec2u(3, 7)
+  );
+
+  fn cell_grid_size() -> vec3u {
+    return volume.size - vec3u(1);
+  }
+
+  fn cell_coord(cell : u32) -> vec3u {
+    let grid = cell_grid_size();
+    return vec3u(cell % grid.x, (cell / grid.x) % grid.y,
+                 cell / (grid.x * grid.y));
+  }
+
+  fn value_at(p : vec3u) -> f32 {
+    return f32(volume.values[p.x + p.y * volume.size.x
+                             + p.z * volume.size.x * volume.size.y]);
+  }
+
+  fn cube_index(cell : vec3u) -> u32 {
+    var index = 0u;
+    for (var i = 0u; i < 8u; i++) {
+      if (value_at(cell + CORNERS[i]) < volume.threshold) {
+        index |= 1u << i;
+      }
+    }
+    return index;
+  }
+
+  fn normal_at(p : vec3u) -> vec3f {
+    let lo = max(p, vec3u(1)) - vec3u(1);
+    let hi = min(p + vec3u(1), volume.size - vec3u(1));
+    return vec3f(
+      value_at(vec3u(lo.x, p.y, p.z)) - value_at(vec3u(hi.x, p.y, p.z)),
+      value_at(vec3u(p.x, lo.y, p.z)) - value_at(vec3u(p.x, hi.y, p.z)),
+      value_at(vec3u(p.x, p.y, lo.z)) - value_at(vec3u(p.x, p.y, hi.z))
+    );
+  }
+
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn classify_cells(@builtin(global_invocation_id) id : vec3u) {
+    let grid = cell_grid_size();
+    if (id.x >= grid.x * grid.y * grid.z) {
+      return;
+    }
+    let index = cube_index(cell_coord(id.x));
+    var count = 0u;
+    while (count < 15u && tables.tris[index * 16u + count] >= 0) {
+      count += 3u;
+    }
+    vertex_counts[id.x] = count;
+    active_flags[id.x]  = select(0u, 1u, count > 0u);
+  }
+
+  @compute @workgroup_size(1)
+  fn finalize_surface() {
+    let grid = cell_grid_size();
+    let last = grid.x * grid.y * grid.z - 1u;
+    draw_args[0] = min(vertex_offsets[last] + vertex_counts[last],
+                       vertex_capacity);
+    draw_args[1] = 1u;
+    draw_args[2] = 0u;
+    draw_args[3] = 0u;
+  }
+
+  // Dispatched with the arguments written from the active count, in rows of
+  // workgroups for large counts
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn generate_triangles(@builtin(global_invocation_id) id : vec3u,
+                        @builtin(num_workgroups) groups : vec3u) {
+    let active = id.x + id.y * groups.x * WORKGROUP_SIZE;
+    if (active >= active_count[0]) {
+      return;
+    }
+    let cell_id = active_cells[active];
+    let cell    = cell_coord(cell_id);
+    let index   = cube_index(cell);
+    let first   = vertex_offsets[cell_id];
+    for (var i = 0u; i < 15u; i++) {
+      let edge = tables.tris[index * 16u + i];
+      let vertex = first + i;
+      if (edge < 0 || vertex >= vertex_capacity) {
+        break;
+      }
+      let corners = EDGE_CORNERS[u32(edge)];
+      let p0 = cell + CORNERS[corners.x];
+      let p1 = cell + CORNERS[corners.y];
+      let v0 = value_at(p0);
+      let v1 = value_at(p1);
+      let t = clamp((volume.threshold - v0) / (v1 - v0), 0.0, 1.0);
+      let position = volume.min_corner
+                     + mix(vec3f(p0), vec3f(p1), t) * volume.step_size;
+      let gradient = mix(normal_at(p0), normal_at(p1), t);
+      let normal = gradient * inverseSqrt(max(dot(gradient, gradient), 1e-12));
+      for (var c = 0u; c < 3u; c++) {
+        positions[vertex * 3u + c] = position[c];
+        normals[vertex * 3u + c]   = normal[c];
+      }
+    }
+  }
+);
+// clang-format on
+
+/* Bind group of a compute pipeline with an auto layout: buffers[i] is bound
+ * at binding i, NULL for the bindings not used by the entry point */
+static WGPUBindGroup
+metaballs_compute_create_bind_group(metaballs_compute_t* this,
+                                    WGPUComputePipeline pipeline,
+                                    const char* label,
+                                    const wgpu_buffer_t* const* buffers,
+                                    uint32_t buffer_count)
+{
+  WGPUBindGroupEntry bg_entries[16] = {0};
+  uint32_t entry_count              = 0;
+  ASSERT(buffer_count <= (uint32_t)ARRAY_SIZE(bg_entries));
+  for (uint32_t i = 0; i < buffer_count; ++i) {
+    if (buffers[i] != NULL) {
+      bg_entries[entry_count++] = (WGPUBindGroupEntry){
+        .binding = i,
+        .buffer  = buffers[i]->buffer,
+        .size    = buffers[i]->size,
+      };
+    }
+  }
+
+  WGPUBindGroupDescriptor bg_desc = {
+    .label      = label,
+    .layout     = wgpuComputePipelineGetBindGroupLayout(pipeline, 0),
+    .entryCount = entry_count,
+    .entries    = bg_entries,
+  };
+
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+    this->renderer->wgpu_context->device, &bg_desc);
+  ASSERT(bind_group != NULL);
+  return bind_group;
+}
+
+/* Isosurface extraction bind groups, recreated each time the pipelines are
+ * stored */
+static void metaballs_compute_init_classify_cells_bind_group(void* user_data)
 {
-  /* Compute metaballs pipeline */
-  {
-    /* Compute shader */
-    wgpu_shader_t comp_shader = wgpu_shader_create(
-      this->renderer->wgpu_context,
-      &(wgpu_shader_desc_t){
-        // Compute shader WGSL
-        .label = "metaballs isosurface compute shader",
-        .file  = "shaders/compute_metaballs/metaball_field_compute_shader.wgsl",
-        .entry = "main",
-      });
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
 
-    /* Create pipeline */
-    this->compute_metaballs_pipeline = wgpuDeviceCreateComputePipeline(
-      this->renderer->wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .compute = comp_shader.programmable_stage_descriptor,
-      });
-    ASSERT(this->compute_metaballs_pipeline != NULL);
+  WGPU_RELEASE_RESOURCE(BindGroup, this->classify_cells_bind_group)
 
-    /* Partial clean-up */
-    wgpu_shader_release(&comp_shader);
+  const wgpu_buffer_t* buffers[4] = {
+    [0] = &this->tables_buffer,
+    [1] = &this->volume_buffer,
+    [2] = &this->surface_buffers.vertex_counts,
+    [3] = &this->surface_buffers.active_flags,
+  };
+  this->classify_cells_bind_group = metaballs_compute_create_bind_group(
+    this, this->classify_cells_pipeline, "classify cells bind group", buffers,
+    (uint32_t)ARRAY_SIZE(buffers));
+}
+
+static void metaballs_compute_init_finalize_surface_bind_group(void* user_data)
+{
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, this->finalize_surface_bind_group)
+
+  const wgpu_buffer_t* buffers[10] = {
+    [1] = &this->volume_buffer,
+    [2] = &this->surface_buffers.vertex_counts,
+    [4] = &this->surface_buffers.vertex_offsets,
+    [6] = &this->surface_buffers.active_count,
+    [9] = &this->indirect_render_buffer,
+  };
+  this->finalize_surface_bind_group = metaballs_compute_create_bind_group(
+    this, this->finalize_surface_pipeline, "finalize surface bind group",
+    buffers, (uint32_t)ARRAY_SIZE(buffers));
+}
+
+static void
+metaballs_compute_init_generate_triangles_bind_group(void* user_data)
+{
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, this->generate_triangles_bind_group)
+
+  const wgpu_buffer_t* buffers[9] = {
+    [0] = &this->tables_buffer,
+    [1] = &this->volume_buffer,
+    [4] = &this->surface_buffers.vertex_offsets,
+    [5] = &this->surface_buffers.active_cells,
+    [6] = &this->surface_buffers.active_count,
+    [7] = &this->vertex_buffer,
+    [8] = &this->normal_buffer,
+  };
+  this->generate_triangles_bind_group = metaballs_compute_create_bind_group(
+    this, this->generate_triangles_pipeline, "generate triangles bind group",
+    buffers, (uint32_t)ARRAY_SIZE(buffers));
+}
+
+/* Metaballs field evaluation with a coarse grid of ball indices built every
+ * update:
+ *
+ *   - count_ball_bins: number of balls overlapping each bin
+ *   - fill_ball_bins: ball indices of each bin, at the scanned bin offsets
+ *   - compute_field: every voxel only sums the balls of its bin
+ *
+ * A ball contributes nothing beyond its radius, sqrt(strength / subtract), so
+ * the sums are exact while their cost follows the local ball density. The bin
+ * counts and cursors are cleared and the counts scanned with the compute
+ * primitives between the passes. */
+// clang-format off
+static const char* metaball_field_compute_shader_wgsl = CODE(
+  struct Metaball {
+    position : vec4f,
+    radius   : f32,
+    strength : f32,
+    subtract : f32,
+    padding  : f32,
+  }
+
+  struct MetaballList {
+    ball_count : u32,
+    balls      : array<Metaball>,
+  }
+
+  struct IsosurfaceVolume {
+    min_corner : vec3f,
+    max_corner : vec3f,
+    step_size  : vec3f,
+    size       : vec3u,
+    threshold  : f32,
+    values     : array<StorageScalar>,
+  }
+
+  override bin_grid_size : u32 = 16u;
+  override bin_capacity : u32 = 0u;
+
+  @group(0) @binding(0) var<storage, read> metaballs : MetaballList;
+  @group(0) @binding(1) var<storage, read_write> volume : IsosurfaceVolume;
+  @group(0) @binding(2)
+  var<storage, read_write> bin_counts : array<atomic<u32>>;
+  @group(0) @binding(3) var<storage, read> bin_offsets : array<u32>;
+  @group(0) @binding(4)
+  var<storage, read_write> bin_cursors : array<atomic<u32>>;
+  @group(0) @binding(5) var<storage, read_write> bin_balls : array<u32>;
+
+  fn bin_coord(p : vec3f) -> vec3u {
+    let extent = vec3f(volume.size - vec3u(1)) * volume.step_size;
+    let coord  = (p - volume.min_corner) * f32(bin_grid_size) / extent;
+    return vec3u(clamp(coord, vec3f(0.0), vec3f(f32(bin_grid_size - 1u))));
+  }
+
+  fn bin_index(c : vec3u) -> u32 {
+    return c.x + (c.y + c.z * bin_grid_size) * bin_grid_size;
+  }
+
+  @compute @workgroup_size(64)
+  fn count_ball_bins(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= metaballs.ball_count) {
+      return;
+    }
+    let ball = metaballs.balls[id.x];
+    let lo   = bin_coord(ball.position.xyz - vec3f(ball.radius));
+    let hi   = bin_coord(ball.position.xyz + vec3f(ball.radius));
+    for (var z = lo.z; z <= hi.z; z++) {
+      for (var y = lo.y; y <= hi.y; y++) {
+        for (var x = lo.x; x <= hi.x; x++) {
+          atomicAdd(&bin_counts[bin_index(vec3u(x, y, z))], 1u);
+        }
+      }
+    }
+  }
+
+  @compute @workgroup_size(64)
+  fn fill_ball_bins(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= metaballs.ball_count) {
+      return;
+    }
+    let ball = metaballs.balls[id.x];
+    let lo   = bin_coord(ball.position.xyz - vec3f(ball.radius));
+    let hi   = bin_coord(ball.position.xyz + vec3f(ball.radius));
+    for (var z = lo.z; z <= hi.z; z++) {
+      for (var y = lo.y; y <= hi.y; y++) {
+        for (var x = lo.x; x <= hi.x; x++) {
+          let bin  = bin_index(vec3u(x, y, z));
+          let slot = bin_offsets[bin] + atomicAdd(&bin_cursors[bin], 1u);
+          if (slot < bin_capacity) {
+            bin_balls[slot] = id.x;
+          }
+        }
+      }
+    }
+  }
+
+  @compute @workgroup_size(4, 4, 4)
+  fn compute_field(@builtin(global_invocation_id) id : vec3u) {
+    if (any(id >= volume.size)) {
+      return;
+    }
+    let position = volume.min_corner + volume.step_size * vec3f(id);
+    let bin      = bin_index(bin_coord(position));
+    let first    = bin_offsets[bin];
+    let last     = min(first + atomicLoad(&bin_counts[bin]), bin_capacity);
+    var value    = 0.0;
+    for (var i = first; i < last; i++) {
+      let ball = metaballs.balls[bin_balls[i]];
+      let d    = position - ball.position.xyz;
+      value += max(ball.strength / (0.000001 + dot(d, d)) - ball.subtract, 0.0);
+    }
+    volume.values[id.x + id.y * volume.size.x
+                  + id.z * volume.size.x * volume.size.y] = to_storage(value);
   }
+);
+// clang-format on
+
+/* Metaballs field bind groups, recreated each time the pipelines are stored */
+static void metaballs_compute_init_count_ball_bins_bind_group(void* user_data)
+{
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, this->count_ball_bins_bind_group)
+
+  const wgpu_buffer_t* buffers[3] = {
+    [0] = &this->metaball_buffer,
+    [1] = &this->volume_buffer,
+    [2] = &this->bin_buffers.counts,
+  };
+  this->count_ball_bins_bind_group = metaballs_compute_create_bind_group(
+    this, this->count_ball_bins_pipeline, "count ball bins bind group",
+    buffers, (uint32_t)ARRAY_SIZE(buffers));
+}
+
+static void metaballs_compute_init_fill_ball_bins_bind_group(void* user_data)
+{
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, this->fill_ball_bins_bind_group)
+
+  const wgpu_buffer_t* buffers[6] = {
+    [0] = &this->metaball_buffer,
+    [1] = &this->volume_buffer,
+    [3] = &this->bin_buffers.offsets,
+    [4] = &this->bin_buffers.cursors,
+    [5] = &this->bin_buffers.balls,
+  };
+  this->fill_ball_bins_bind_group = metaballs_compute_create_bind_group(
+    this, this->fill_ball_bins_pipeline, "fill ball bins bind group", buffers,
+    (uint32_t)ARRAY_SIZE(buffers));
+}
+
+static void metaballs_compute_init_metaballs_bind_group(void* user_data)
+{
+  metaballs_compute_t* this = (metaballs_compute_t*)user_data;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, this->compute_metaballs_bind_group)
+
+  const wgpu_buffer_t* buffers[6] = {
+    [0] = &this->metaball_buffer,
+    [1] = &this->volume_buffer,
+    [2] = &this->bin_buffers.counts,
+    [3] = &this->bin_buffers.offsets,
+    [5] = &this->bin_buffers.balls,
+  };
+  this->compute_metaballs_bind_group = metaballs_compute_create_bind_group(
+    this, this->compute_metaballs_pipeline, "compute metaballs bind group",
+    buffers, (uint32_t)ARRAY_SIZE(buffers));
+}
 
-  /* Compute metaballs bind group */
+static void metaballs_compute_init(metaballs_compute_t* this)
+{
+  /* Both shaders access the volume in its storage precision */
+  char* field_shader_wgsl = wgpu_add_storage_precision(
+    metaball_field_compute_shader_wgsl, this->volume_precision);
+  char* isosurface_shader_wgsl = wgpu_add_storage_precision(
+    isosurface_compute_shader_wgsl, this->volume_precision);
+
+  /* Metaballs field pipelines */
   {
-    WGPUBindGroupEntry bg_entries[2] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .buffer  = this->metaball_buffer.buffer,
-        .size    = this->metaball_buffer.size,
+    WGPUConstantEntry constants[2] = {
+      [0] = (WGPUConstantEntry){
+        .key   = "bin_grid_size",
+        .value = (double)METABALLS_BIN_GRID_SIZE,
       },
-      [1] = (WGPUBindGroupEntry) {
-        .binding = 1,
-        .buffer  = this->volume_buffer.buffer,
-        .size    = this->volume_buffer.size,
+      [1] = (WGPUConstantEntry){
+        .key   = "bin_capacity",
+        .value = (double)METABALLS_MAX_BIN_REFERENCES,
       },
     };
 
-    WGPUBindGroupDescriptor bg_desc = {
-      .label  = "compute metaballs bind group",
-      .layout = wgpuComputePipelineGetBindGroupLayout(
-        this->compute_metaballs_pipeline, 0),
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
+    struct {
+      const char* entry;
+      WGPUComputePipeline* pipeline;
+      wgpu_pipeline_ready_callback_t bind_group_init;
+    } field_pipelines[3] = {
+      {"count_ball_bins", &this->count_ball_bins_pipeline,
+       metaballs_compute_init_count_ball_bins_bind_group},
+      {"fill_ball_bins", &this->fill_ball_bins_pipeline,
+       metaballs_compute_init_fill_ball_bins_bind_group},
+      {"compute_field", &this->compute_metaballs_pipeline,
+       metaballs_compute_init_metaballs_bind_group},
     };
 
-    this->compute_metaballs_bind_group = wgpuDeviceCreateBindGroup(
-      this->renderer->wgpu_context->device, &bg_desc);
-    ASSERT(this->compute_metaballs_bind_group != NULL);
-  }
-
-  /* Compute marching cubes pipeline */
-  {
-    /* Compute shader */
-    wgpu_shader_t comp_shader = wgpu_shader_create(
-      this->renderer->wgpu_context,
-      &(wgpu_shader_desc_t){
-        // Compute shader WGSL
-        .label = "marching cubes computer shader",
-        .file  = "shaders/compute_metaballs/marching_cubes_compute_shader.wgsl",
-        .entry = "main",
-      });
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(field_pipelines); ++i) {
+      /* Compute shader, the module is shared by the entry points */
+      wgpu_shader_t comp_shader = wgpu_shader_create(
+        this->renderer->wgpu_context,
+        &(wgpu_shader_desc_t){
+          // Compute shader WGSL
+          .label     = "metaballs isosurface compute shader",
+          .wgsl_code = {field_shader_wgsl},
+          .entry     = field_pipelines[i].entry,
+          .constants = {
+            .count   = (uint32_t)ARRAY_SIZE(constants),
+            .entries = constants,
+          },
+        });
 
-    /* Create pipeline */
-    this->compute_marching_cubes_pipeline = wgpuDeviceCreateComputePipeline(
-      this->renderer->wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .label   = "compute marching cubes pipeline",
-        .compute = comp_shader.programmable_stage_descriptor,
-      });
-    ASSERT(this->compute_marching_cubes_pipeline != NULL);
+      /* Create pipeline */
+      wgpu_create_compute_pipeline_async(
+        this->renderer->wgpu_context,
+        &(WGPUComputePipelineDescriptor){
+          .label   = field_pipelines[i].entry,
+          .compute = comp_shader.programmable_stage_descriptor,
+        },
+        field_pipelines[i].pipeline, field_pipelines[i].bind_group_init,
+        this);
 
-    /* Partial clean-up */
-    wgpu_shader_release(&comp_shader);
+      /* Partial clean-up */
+      wgpu_shader_release(&comp_shader);
+    }
   }
 
-  /* Compute marching cubes bind group */
+  /* Isosurface extraction pipelines */
   {
-    WGPUBindGroupEntry bg_entries[6] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .buffer  = this->tables_buffer.buffer,
-        .size    = this->tables_buffer.size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding = 1,
-        .buffer  = this->volume_buffer.buffer,
-        .size    = this->volume_buffer.size,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = this->vertex_buffer.buffer,
-        .size    = this->vertex_buffer.size,
-      },
-      [3] = (WGPUBindGroupEntry) {
-        .binding = 3,
-        .buffer  = this->normal_buffer.buffer,
-        .size    = this->normal_buffer.size,
-      },
-      [4] = (WGPUBindGroupEntry) {
-        .binding = 4,
-        .buffer  = this->index_buffer.buffer,
-        .size    = this->index_buffer.size,
-      },
-      [5] = (WGPUBindGroupEntry) {
-        .binding = 5,
-        .buffer  = this->indirect_render_buffer.buffer,
-        .size    = this->indirect_render_buffer.size,
+    WGPUConstantEntry constants[1] = {
+      [0] = (WGPUConstantEntry){
+        .key   = "vertex_capacity",
+        .value = (double)this->vertex_capacity,
       },
     };
 
-    WGPUBindGroupDescriptor bg_desc = {
-      .layout = wgpuComputePipelineGetBindGroupLayout(
-        this->compute_marching_cubes_pipeline, 0),
-      .label      = "compute marching cubes bind group",
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
+    struct {
+      const char* entry;
+      WGPUComputePipeline* pipeline;
+      wgpu_pipeline_ready_callback_t bind_group_init;
+    } surface_pipelines[3] = {
+      {"classify_cells", &this->classify_cells_pipeline,
+       metaballs_compute_init_classify_cells_bind_group},
+      {"finalize_surface", &this->finalize_surface_pipeline,
+       metaballs_compute_init_finalize_surface_bind_group},
+      {"generate_triangles", &this->generate_triangles_pipeline,
+       metaballs_compute_init_generate_triangles_bind_group},
     };
 
-    this->compute_marching_cubes_bind_group = wgpuDeviceCreateBindGroup(
-      this->renderer->wgpu_context->device, &bg_desc);
-    ASSERT(this->compute_marching_cubes_bind_group != NULL);
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(surface_pipelines); ++i) {
+      /* Compute shader, the module is shared by the entry points */
+      wgpu_shader_t comp_shader = wgpu_shader_create(
+        this->renderer->wgpu_context,
+        &(wgpu_shader_desc_t){
+          // Compute shader WGSL
+          .label     = "isosurface compute shader",
+          .wgsl_code = {isosurface_shader_wgsl},
+          .entry     = surface_pipelines[i].entry,
+          .constants = {
+            .count   = (uint32_t)ARRAY_SIZE(constants),
+            .entries = constants,
+          },
+        });
+
+      /* Create pipeline */
+      wgpu_create_compute_pipeline_async(
+        this->renderer->wgpu_context,
+        &(WGPUComputePipelineDescriptor){
+          .label   = surface_pipelines[i].entry,
+          .compute = comp_shader.programmable_stage_descriptor,
+        },
+        surface_pipelines[i].pipeline, surface_pipelines[i].bind_group_init,
+        this);
+
+      /* Partial clean-up */
+      wgpu_shader_release(&comp_shader);
+    }
   }
+
+  free(field_shader_wgsl);
+  free(isosurface_shader_wgsl);
 }
 
 static void metaballs_compute_init_defaults(metaballs_compute_t* this)
@@ -1558,13 +2075,20 @@ static void metaballs_compute_create(metaballs_compute_t* this,
                                          });
   }
 
-  /* Metaballs volume buffer */
+  /* Metaballs volume buffer, the header is followed by the values in their
+   * storage precision. Half precision halves the traffic of the field and the
+   * marching cubes passes. */
   {
+    this->volume_precision = wgpu_get_storage_precision(
+      wgpu_context, settings_get_volume_precision());
     const uint32_t volume_elements
       = volume->width * volume->height * volume->depth;
+    const uint64_t values_size
+      = (uint64_t)wgpu_get_storage_scalar_size(this->volume_precision)
+        * volume_elements;
     const uint64_t volume_buffer_size = sizeof(float) * 12
                                         + sizeof(uint32_t) * 4
-                                        + sizeof(float) * volume_elements;
+                                        + ((values_size + 3) & ~3ull);
     WGPUBufferDescriptor buffer_desc = {
       .label            = "metaballs volume buffer",
       .usage            = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
@@ -1599,11 +2123,14 @@ static void metaballs_compute_create(metaballs_compute_t* this,
     wgpuBufferUnmap(this->volume_buffer.buffer);
   }
 
-  const uint32_t marching_cube_cells
+  /* Isosurface buffers, the vertices are generated for the active cells
+   * only, at most 5 triangles per cell */
+  this->cell_count
     = (volume->width - 1) * (volume->height - 1) * (volume->depth - 1);
-  const size_t vertex_buffer_size
-    = sizeof(float) * 3 * 12 * marching_cube_cells;
-  const size_t index_buffer_size = sizeof(uint32_t) * 15 * marching_cube_cells;
+  this->cell_capacity = this->cell_count;
+  this->vertex_capacity
+    = MIN(this->cell_count * 15, METABALLS_MAX_SURFACE_VERTICES);
+  const size_t vertex_buffer_size = sizeof(float) * 3 * this->vertex_capacity;
 
   this->vertex_buffer = wgpu_create_buffer(
     wgpu_context, &(wgpu_buffer_desc_t){
@@ -1619,22 +2146,100 @@ static void metaballs_compute_create(metaballs_compute_t* this,
                     .size  = vertex_buffer_size,
                   });
 
-  this->index_buffer = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .label = "metaballs index buffer",
-                    .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Index,
-                    .size  = index_buffer_size,
-                  });
-  this->index_count = index_buffer_size / sizeof(uint32_t);
+  /* Draw arguments: vertex count, instance count, first vertex, first
+   * instance */
+  this->indirect_render_buffer = wgpu_create_buffer(
+    wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "metaballs indirect draw buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect,
+      .size  = sizeof(uint32_t) * 4,
+    });
+
+  /* Isosurface extraction buffers */
+  {
+    const uint32_t cells_size = sizeof(uint32_t) * this->cell_count;
 
-  this->indirect_render_array[0] = 500;
-  this->indirect_render_buffer   = wgpu_create_buffer(
+    uint32_t* cell_ids = (uint32_t*)malloc(cells_size);
+    for (uint32_t i = 0; i < this->cell_count; ++i) {
+      cell_ids[i] = i;
+    }
+    this->surface_buffers.cell_ids = wgpu_create_buffer(
       wgpu_context, &(wgpu_buffer_desc_t){
-                      .label = "metaballs indirect draw buffer",
-                      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect
-                             | WGPUBufferUsage_CopyDst,
-                      .size = sizeof(this->indirect_render_array),
-                  });
+                      .label   = "metaballs cell ids buffer",
+                      .usage   = WGPUBufferUsage_Storage,
+                      .size    = cells_size,
+                      .initial = {cell_ids, cells_size},
+                    });
+    free(cell_ids);
+
+    struct {
+      wgpu_buffer_t* buffer;
+      const char* label;
+      uint32_t size;
+      WGPUBufferUsage usage;
+    } buffers[6] = {
+      {&this->surface_buffers.vertex_counts, "metaballs vertex counts buffer",
+       cells_size, WGPUBufferUsage_Storage},
+      {&this->surface_buffers.active_flags, "metaballs active flags buffer",
+       cells_size, WGPUBufferUsage_Storage},
+      {&this->surface_buffers.vertex_offsets, "metaballs vertex offsets buffer",
+       cells_size, WGPUBufferUsage_Storage},
+      {&this->surface_buffers.active_cells, "metaballs active cells buffer",
+       cells_size, WGPUBufferUsage_Storage},
+      {&this->surface_buffers.active_count, "metaballs active count buffer",
+       sizeof(uint32_t), WGPUBufferUsage_Storage},
+      {&this->surface_buffers.dispatch_args, "metaballs dispatch args buffer",
+       WGPU_INDIRECT_DISPATCH_ARGS_SIZE,
+       WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect},
+    };
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(buffers); ++i) {
+      *buffers[i].buffer = wgpu_create_buffer(
+        wgpu_context, &(wgpu_buffer_desc_t){
+                        .label = buffers[i].label,
+                        .usage = buffers[i].usage,
+                        .size  = buffers[i].size,
+                      });
+    }
+
+  }
+
+  /* Metaballs bin buffers */
+  {
+    const uint32_t bins_size = sizeof(uint32_t) * METABALLS_BIN_COUNT;
+    this->bin_buffers.counts = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "metaballs bin counts buffer",
+        .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+        .size  = bins_size,
+      });
+    this->bin_buffers.offsets = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .label = "metaballs bin offsets buffer",
+                      .usage = WGPUBufferUsage_Storage,
+                      .size  = bins_size,
+                    });
+    this->bin_buffers.cursors = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "metaballs bin cursors buffer",
+        .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+        .size  = bins_size,
+      });
+    this->bin_buffers.balls = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .label = "metaballs bin balls buffer",
+                      .usage = WGPUBufferUsage_Storage,
+                      .size = sizeof(uint32_t) * METABALLS_MAX_BIN_REFERENCES,
+                    });
+  }
+
+  /* Scans the bin counts and the vertex counts of the cells */
+  this->compute_primitives = wgpu_compute_primitives_create(
+    wgpu_context, MAX(this->cell_count, METABALLS_BIN_COUNT));
+  /* Triangle generation sized by the active cell count on the GPU */
+  this->indirect_dispatch = wgpu_indirect_dispatch_create(wgpu_context);
 
   for (uint32_t i = 0; i < MAX_METABALLS; ++i) {
     this->ball_positions[i].x     = (random_float() * 2 - 1) * volume->x_min;
@@ -1655,13 +2260,63 @@ static void metaballs_compute_destroy(metaballs_compute_t* this)
   WGPU_RELEASE_RESOURCE(Buffer, this->metaball_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, this->volume_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, this->indirect_render_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.cell_ids.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.vertex_counts.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.active_flags.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.vertex_offsets.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.active_cells.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.active_count.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->surface_buffers.dispatch_args.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->bin_buffers.counts.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->bin_buffers.offsets.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->bin_buffers.cursors.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->bin_buffers.balls.buffer)
+  wgpu_compute_primitives_destroy(this->compute_primitives);
+  wgpu_indirect_dispatch_destroy(this->indirect_dispatch);
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->count_ball_bins_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->fill_ball_bins_pipeline)
   WGPU_RELEASE_RESOURCE(ComputePipeline, this->compute_metaballs_pipeline)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, this->compute_marching_cubes_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->classify_cells_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->finalize_surface_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->generate_triangles_pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->count_ball_bins_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->fill_ball_bins_bind_group)
   WGPU_RELEASE_RESOURCE(BindGroup, this->compute_metaballs_bind_group)
-  WGPU_RELEASE_RESOURCE(BindGroup, this->compute_marching_cubes_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->classify_cells_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->finalize_surface_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->generate_triangles_bind_group)
   WGPU_RELEASE_RESOURCE(Buffer, this->vertex_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, this->normal_buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, this->index_buffer.buffer)
+}
+
+/* Switches to a grid within the one the buffers were created for, only the
+ * header of the volume buffer is rewritten, the field is recomputed */
+static void metaballs_compute_set_volume(metaballs_compute_t* this,
+                                         const ivolume_settings_t* volume)
+{
+  const uint32_t cell_count
+    = (volume->width - 1) * (volume->height - 1) * (volume->depth - 1);
+  ASSERT(cell_count <= this->cell_capacity);
+
+  memcpy(&this->volume, volume, sizeof(ivolume_settings_t));
+  this->cell_count = cell_count;
+
+  float header[16]      = {0};
+  uint32_t* volume_size = (uint32_t*)(&header[12]);
+  header[0]             = volume->x_min;
+  header[1]             = volume->y_min;
+  header[2]             = volume->z_min;
+  header[8]             = volume->x_step;
+  header[9]             = volume->y_step;
+  header[10]            = volume->z_step;
+  volume_size[0]        = volume->width;
+  volume_size[1]        = volume->height;
+  volume_size[2]        = volume->depth;
+  header[15]            = volume->iso_level;
+  wgpu_queue_write_buffer(this->renderer->wgpu_context,
+                          this->volume_buffer.buffer, 0, header,
+                          sizeof(header));
+  this->surface_dirty = true;
 }
 
 static void metaballs_compute_rearrange(metaballs_compute_t* this)
@@ -1670,10 +2325,8 @@ static void metaballs_compute_rearrange(metaballs_compute_t* this)
   this->strength_target = 3.0f + random_float() * 3.0f;
 }
 
-static metaballs_compute_t*
-metaballs_compute_update_sim(metaballs_compute_t* this,
-                             WGPUComputePassEncoder compute_pass, float time,
-                             float time_delta)
+static metaballs_compute_t* metaballs_compute_update_sim(
+  metaballs_compute_t* this, float time, float time_delta)
 {
   UNUSED_VAR(time);
 
@@ -1684,11 +2337,12 @@ metaballs_compute_update_sim(metaballs_compute_t* this,
   this->subtract += (this->subtract_target - this->subtract) * time_delta * 4;
   this->strength += (this->strength_target - this->strength) * time_delta * 4;
 
-  const uint32_t numblobs = MAX_METABALLS;
+  const uint32_t numblobs = settings_get_metaballs_count();
 
-  this->metaball_array_header[0] = MAX_METABALLS;
+  this->ball_count               = numblobs;
+  this->metaball_array_header[0] = numblobs;
 
-  for (uint32_t i = 0; i < MAX_METABALLS; i++) {
+  for (uint32_t i = 0; i < numblobs; i++) {
     imetaball_pos_t* pos = &this->ball_positions[i];
 
     pos->vx += -pos->x * pos->speed * 20.0f;
@@ -1732,53 +2386,177 @@ metaballs_compute_update_sim(metaballs_compute_t* this,
     }
   }
 
+  // Shrink the balls beyond the default count to keep the filled volume
+  // similar, the radius follows from strength / subtract
+  const float scale
+    = MIN(cbrtf((float)DEFAULT_METABALLS / (float)numblobs), 1.0f);
+  const float strength = this->strength * scale * scale;
+  const float radius   = sqrt(strength / this->subtract);
+  glm_vec3_fill(this->bounds_min, FLT_MAX);
+  glm_vec3_fill(this->bounds_max, -FLT_MAX);
   for (uint32_t i = 0; i < numblobs; i++) {
     imetaball_pos_t* position = &this->ball_positions[i];
     metaball_t* metaball      = &this->metaball_array_balls[i];
     metaball->position[0]     = position->x;
     metaball->position[1]     = position->y;
     metaball->position[2]     = position->z;
-    metaball->radius          = sqrt(this->strength / this->subtract);
-    metaball->strength        = this->strength;
+    metaball->radius          = radius;
+    metaball->strength        = strength;
     metaball->subtract        = this->subtract;
+    glm_vec3_minv(this->bounds_min,
+                  (vec3){position->x - radius, position->y - radius,
+                         position->z - radius},
+                  this->bounds_min);
+    glm_vec3_maxv(this->bounds_max,
+                  (vec3){position->x + radius, position->y + radius,
+                         position->z + radius},
+                  this->bounds_max);
   }
 
-  wgpu_queue_write_buffer(this->renderer->wgpu_context,
-                          this->metaball_buffer.buffer, 0,
-                          &this->metaball_array, sizeof(this->metaball_array));
   wgpu_queue_write_buffer(
-    this->renderer->wgpu_context, this->indirect_render_buffer.buffer, 0,
-    &this->indirect_render_array, sizeof(this->indirect_render_array));
+    this->renderer->wgpu_context, this->metaball_buffer.buffer, 0,
+    &this->metaball_array,
+    sizeof(this->metaball_array.ball_count) + numblobs * sizeof(metaball_t));
 
-  const uint32_t dispatch_size[3] = {
-    this->volume.width / METABALLS_COMPUTE_WORKGROUP_SIZE[0],  //
-    this->volume.height / METABALLS_COMPUTE_WORKGROUP_SIZE[1], //
-    this->volume.depth / METABALLS_COMPUTE_WORKGROUP_SIZE[2],  //
-  };
+  this->surface_dirty   = true;
+  this->has_calced_once = true;
+
+  return this;
+}
+
+/* Evaluates the field of the updated balls and extracts its isosurface: the
+ * balls are binned first, then the cells are classified, the active ones
+ * compacted and only those generate triangles, with an indirect dispatch sized
+ * by the GPU. Recorded outside of a compute pass since the compute primitives
+ * begin their own passes. */
+static void metaballs_compute_build_surface(metaballs_compute_t* this,
+                                            WGPUCommandEncoder cmd_enc)
+{
+  if (!this->surface_dirty || !metaballs_compute_is_ready(this)) {
+    return;
+  }
+  this->surface_dirty = false;
+  ++this->surface_version;
+
+  wgpu_pipeline_statistics_t* statistics
+    = this->renderer->wgpu_context->pipeline_statistics;
+  const uint32_t ball_groups = (this->ball_count + 63) / 64;
+
+  /* Bin counts */
+  wgpuCommandEncoderClearBuffer(cmd_enc, this->bin_buffers.counts.buffer, 0,
+                                this->bin_buffers.counts.size);
+  wgpuCommandEncoderClearBuffer(cmd_enc, this->bin_buffers.cursors.buffer, 0,
+                                this->bin_buffers.cursors.size);
+  {
+    WGPUComputePassEncoder compute_pass
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(compute_pass,
+                                      this->count_ball_bins_pipeline);
+    wgpuComputePassEncoderSetBindGroup(
+      compute_pass, 0, this->count_ball_bins_bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(compute_pass, ball_groups, 1, 1);
+    wgpuComputePassEncoderEnd(compute_pass);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
+  }
+
+  /* Bin offsets */
+  wgpu_compute_exclusive_scan(this->compute_primitives, cmd_enc,
+                              this->bin_buffers.counts.buffer,
+                              this->bin_buffers.offsets.buffer,
+                              METABALLS_BIN_COUNT);
+
+  /* Ball indices of the bins and the field of the volume */
+  {
+    const uint32_t dispatch_size[3] = {
+      (this->volume.width + METABALLS_COMPUTE_WORKGROUP_SIZE[0] - 1)
+        / METABALLS_COMPUTE_WORKGROUP_SIZE[0],
+      (this->volume.height + METABALLS_COMPUTE_WORKGROUP_SIZE[1] - 1)
+        / METABALLS_COMPUTE_WORKGROUP_SIZE[1],
+      (this->volume.depth + METABALLS_COMPUTE_WORKGROUP_SIZE[2] - 1)
+        / METABALLS_COMPUTE_WORKGROUP_SIZE[2],
+    };
 
-  /* Update metaballs */
-  if (this->compute_metaballs_pipeline) {
+    WGPUComputePassEncoder compute_pass
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpu_pipeline_statistics_begin_compute_pass(statistics, compute_pass,
+                                                "Metaballs field");
+    wgpuComputePassEncoderSetPipeline(compute_pass,
+                                      this->fill_ball_bins_pipeline);
+    wgpuComputePassEncoderSetBindGroup(
+      compute_pass, 0, this->fill_ball_bins_bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(compute_pass, ball_groups, 1, 1);
     wgpuComputePassEncoderSetPipeline(compute_pass,
                                       this->compute_metaballs_pipeline);
     wgpuComputePassEncoderSetBindGroup(
       compute_pass, 0, this->compute_metaballs_bind_group, 0, NULL);
     wgpuComputePassEncoderDispatchWorkgroups(
       compute_pass, dispatch_size[0], dispatch_size[1], dispatch_size[2]);
+    wgpu_pipeline_statistics_end_compute_pass(statistics, compute_pass);
+    wgpuComputePassEncoderEnd(compute_pass);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
   }
 
-  /* Update marching cubes */
-  if (this->compute_marching_cubes_pipeline) {
+  /* Vertex counts and active flags of all cells */
+  {
+    WGPUComputePassEncoder compute_pass
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpu_pipeline_statistics_begin_compute_pass(statistics, compute_pass,
+                                                "Metaballs classify");
     wgpuComputePassEncoderSetPipeline(compute_pass,
-                                      this->compute_marching_cubes_pipeline);
+                                      this->classify_cells_pipeline);
     wgpuComputePassEncoderSetBindGroup(
-      compute_pass, 0, this->compute_marching_cubes_bind_group, 0, NULL);
+      compute_pass, 0, this->classify_cells_bind_group, 0, NULL);
     wgpuComputePassEncoderDispatchWorkgroups(
-      compute_pass, dispatch_size[0], dispatch_size[1], dispatch_size[2]);
+      compute_pass,
+      (this->cell_count + METABALLS_SURFACE_WORKGROUP_SIZE - 1)
+        / METABALLS_SURFACE_WORKGROUP_SIZE,
+      1, 1);
+    wgpu_pipeline_statistics_end_compute_pass(statistics, compute_pass);
+    wgpuComputePassEncoderEnd(compute_pass);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
   }
 
-  this->has_calced_once = true;
-
-  return this;
+  /* Active cell list and vertex offsets */
+  wgpu_compute_compact(this->compute_primitives, cmd_enc,
+                       this->surface_buffers.cell_ids.buffer,
+                       this->surface_buffers.active_flags.buffer,
+                       this->surface_buffers.active_cells.buffer,
+                       this->surface_buffers.active_count.buffer,
+                       this->cell_count);
+  wgpu_compute_exclusive_scan(this->compute_primitives, cmd_enc,
+                              this->surface_buffers.vertex_counts.buffer,
+                              this->surface_buffers.vertex_offsets.buffer,
+                              this->cell_count);
+
+  /* Indirect arguments and the triangles of the active cells */
+  {
+    WGPUComputePassEncoder compute_pass
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpu_pipeline_statistics_begin_compute_pass(statistics, compute_pass,
+                                                "Metaballs triangles");
+    wgpuComputePassEncoderSetPipeline(compute_pass,
+                                      this->finalize_surface_pipeline);
+    wgpuComputePassEncoderSetBindGroup(
+      compute_pass, 0, this->finalize_surface_bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(compute_pass, 1, 1, 1);
+    wgpu_indirect_dispatch_write_args(
+      this->indirect_dispatch, compute_pass,
+      &(wgpu_indirect_dispatch_args_desc_t){
+        .count_buffer   = this->surface_buffers.active_count.buffer,
+        .args_buffer    = this->surface_buffers.dispatch_args.buffer,
+        .workgroup_size = METABALLS_SURFACE_WORKGROUP_SIZE,
+        .max_count      = this->cell_count,
+      });
+    wgpuComputePassEncoderSetPipeline(compute_pass,
+                                      this->generate_triangles_pipeline);
+    wgpuComputePassEncoderSetBindGroup(
+      compute_pass, 0, this->generate_triangles_bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+      compute_pass, this->surface_buffers.dispatch_args.buffer, 0);
+    wgpu_pipeline_statistics_end_compute_pass(statistics, compute_pass);
+    wgpuComputePassEncoderEnd(compute_pass);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
+  }
 }
 
 /* -------------------------------------------------------------------------- *
@@ -2088,13 +2866,14 @@ static void point_lights_init(point_lights_t* this)
         = "shaders/compute_metaballs/update_point_lights_compute_shader.wgsl",
         .entry = "main",
       });
-    this->update_compute_pipeline = wgpuDeviceCreateComputePipeline(
-      wgpu_context->device,
+    wgpu_create_compute_pipeline_async(
+      wgpu_context,
       &(WGPUComputePipelineDescriptor){
         .label   = "point light update compute pipeline",
         .layout  = this->update_compute_pipeline_layout,
         .compute = comp_shader.programmable_stage_descriptor,
-      });
+      },
+      &this->update_compute_pipeline, NULL, NULL);
     wgpu_shader_release(&comp_shader);
   }
 }
@@ -2258,9 +3037,7 @@ point_lights_update_sim(point_lights_t* this,
   wgpuComputePassEncoderSetBindGroup(
     compute_pass, 1, this->renderer->bind_groups.frame, 0, NULL);
   wgpuComputePassEncoderDispatchWorkgroups(
-    compute_pass,
-    (uint32_t)ceil(settings_get_quality_level().point_lights_count / 64.0f), 1,
-    1);
+    compute_pass, ((uint32_t)this->lights_count + 63) / 64, 1, 1);
   return this;
 }
 
@@ -2607,75 +3384,964 @@ static void spot_light_create(spot_light_t* this, webgpu_renderer_t* renderer,
         .storageTexture = {0},
       },
     };
-    this->bind_group_layouts.depth_texture = wgpuDeviceCreateBindGroupLayout(
+    this->bind_group_layouts.depth_texture = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device,
+      &(WGPUBindGroupLayoutDescriptor){
+        .label      = "spot light depth texture bind group layout",
+        .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+        .entries    = bgl_entries,
+      });
+    ASSERT(this->bind_group_layouts.depth_texture != NULL);
+  }
+
+  /* Spot light ubos bind group */
+  {
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = this->ubos.light_info.buffer,
+        .size    = this->ubos.light_info.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = this->ubos.projection.buffer,
+        .size    = this->ubos.projection.size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = this->ubos.view.buffer,
+        .size    = this->ubos.view.size,
+      },
+    };
+    this->bind_groups.ubos = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "spot light ubos bind group",
+                              .layout     = this->bind_group_layouts.ubos,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(this->bind_groups.ubos != NULL);
+  }
+
+  /* Spot light depth texture bind group */
+  {
+    WGPUBindGroupEntry bg_entries[1] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding     = 0,
+        .textureView = this->depth_texture.view,
+        },
+      };
+    this->bind_groups.depth_texture = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label  = "spot light depth texture bind group",
+                              .layout = this->bind_group_layouts.depth_texture,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(this->bind_groups.depth_texture != NULL);
+  }
+}
+
+static void spot_light_destroy(spot_light_t* this)
+{
+  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.light_info.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.projection.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.view.buffer)
+  WGPU_RELEASE_RESOURCE(Texture, this->depth_texture.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, this->depth_texture.view)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.ubos)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.depth_texture)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.ubos)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.depth_texture)
+}
+
+/* -------------------------------------------------------------------------- *
+ * Point Light Shadows
+ *
+ * Omnidirectional shadows of the first POINT_LIGHT_SHADOW_LIGHTS_COUNT point
+ * lights, cast by the metaballs. The six cube faces of every shadowed light
+ * are packed into one 2D depth atlas, a column per light and a row per face,
+ * and store the distance to the light divided by its range.
+ *
+ * A single invocation group classifies the lights each frame: a light is
+ * updated when it moved farther than POINT_LIGHT_SHADOW_MOVE_TOLERANCE from
+ * the position its faces were rendered from, when its range changed or when
+ * its range overlaps the bounds of the metaballs and the surface was rebuilt.
+ * The updated lights are appended to a selection and the draw arguments of
+ * the atlas pass are written from their count, the faces of all selected
+ * lights are then cleared and rendered in one render pass with an instance per
+ * face. Unchanged lights keep their faces, so the cost follows what moves.
+ *
+ * The lookup bind group exposes the atlas, a comparison sampler, the positions
+ * and ranges the faces were rendered from and the shadowed light count to the
+ * deferred pass (group 4). The shadow of the shadowed light i at the world
+ * position p is
+ *
+ *   v    = p - cache[i].xyz, face = major axis of v (+x, -x, +y, -y, +z, -z)
+ *   f    = face coordinates of v, see faceCoords() below
+ *   uv   = ((vec2(f.x, -f.y) / f.z * 0.5 + 0.5) + vec2(i, face))
+ *          / vec2(POINT_LIGHT_SHADOW_LIGHTS_COUNT, 6)
+ *   lit  = textureSampleCompare(atlas, sampler, uv,
+ *                               length(v) / cache[i].w - bias)
+ * -------------------------------------------------------------------------- */
+
+#define POINT_LIGHT_SHADOW_LIGHTS_COUNT 16u
+#define POINT_LIGHT_SHADOW_FACE_SIZE 128u
+#define POINT_LIGHT_SHADOW_MOVE_TOLERANCE 0.25f
+
+/* Frame parameters, matches Params in WGSL */
+typedef struct {
+  vec4 bounds_min; /* w: 1 when the surface was rebuilt */
+  vec4 bounds_max; /* w: move tolerance */
+  uint32_t lights_count;
+  uint32_t force_update;
+  uint32_t padding[2];
+} point_light_shadow_params_t;
+
+// clang-format off
+static const char* point_light_shadow_classify_shader_wgsl = CODE(
+  struct Light {
+    position  : vec4f,
+    velocity  : vec4f,
+    color     : vec3f,
+    range     : f32,
+    intensity : f32,
+  }
+
+  struct Params {
+    boundsMin    : vec4f,
+    boundsMax    : vec4f,
+    lightsCount  : u32,
+    forceUpdate  : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var<storage, read> lights : array<Light>;
+  @group(0) @binding(2) var<storage, read_write> cache : array<vec4f>;
+  @group(0) @binding(3) var<storage, read_write> selection : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> drawArgs : array<u32>;
+  @group(0) @binding(5) var<storage, read> surfaceArgs : array<u32>;
+
+  var<workgroup> selectedCount : atomic<u32>;
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(local_invocation_index) index : u32) {
+    if (index < params.lightsCount) {
+      let light = lights[index];
+      let cached = cache[index];
+      var update = params.forceUpdate != 0u || cached.w != light.range
+        || distance(cached.xyz, light.position.xyz) > params.boundsMax.w;
+      if (params.boundsMin.w != 0.0) {
+        let closest = clamp(light.position.xyz, params.boundsMin.xyz,
+                            params.boundsMax.xyz);
+        let d = closest - light.position.xyz;
+        update = update || dot(d, d) <= light.range * light.range;
+      }
+      if (update) {
+        selection[atomicAdd(&selectedCount, 1u)] = index;
+        cache[index] = vec4f(light.position.xyz, light.range);
+      }
+    }
+    workgroupBarrier();
+
+    if (index == 0u) {
+      let faceCount = atomicLoad(&selectedCount) * 6u;
+      // Clear of the faces
+      drawArgs[0] = 6u;
+      drawArgs[1] = faceCount;
+      drawArgs[2] = 0u;
+      drawArgs[3] = 0u;
+      // Metaballs surface into the faces
+      drawArgs[4] = surfaceArgs[0];
+      drawArgs[5] = faceCount;
+      drawArgs[6] = 0u;
+      drawArgs[7] = 0u;
+    }
+  }
+);
+
+static const char* point_light_shadow_render_shader_wgsl = CODE(
+  struct Light {
+    position  : vec4f,
+    velocity  : vec4f,
+    color     : vec3f,
+    range     : f32,
+    intensity : f32,
+  }
+
+  @group(0) @binding(0) var<storage, read> lights : array<Light>;
+  @group(0) @binding(1) var<storage, read> selection : array<u32>;
+
+  override columns : f32 = 16.0;
+  override faceSize : f32 = 128.0;
+  const kNear = 0.05;
+
+  // Coordinates of v in the frame of the cube face, z along the face axis
+  fn faceCoords(face : u32, v : vec3f) -> vec3f {
+    switch face {
+      case 0u: { return vec3f(-v.z, v.y, v.x); }
+      case 1u: { return vec3f(v.z, v.y, -v.x); }
+      case 2u: { return vec3f(v.x, -v.z, v.y); }
+      case 3u: { return vec3f(v.x, v.z, -v.y); }
+      case 4u: { return vec3f(v.x, v.y, v.z); }
+      default: { return vec3f(-v.x, v.y, -v.z); }
+    }
+  }
+
+  struct Tile {
+    light  : u32,
+    face   : u32,
+    center : vec2f, // normalized device coordinates
+    extent : vec2f,
+    rect   : vec4f, // framebuffer pixels
+  }
+
+  fn tileOf(instance : u32) -> Tile {
+    var tile : Tile;
+    let column = selection[instance / 6u];
+    tile.light = column;
+    tile.face = instance % 6u;
+    tile.extent = vec2f(1.0 / columns, 1.0 / 6.0);
+    tile.center = vec2f((f32(column) + 0.5) / columns * 2.0 - 1.0,
+                        1.0 - (f32(tile.face) + 0.5) / 6.0 * 2.0);
+    let origin = vec2f(f32(column), f32(tile.face)) * faceSize;
+    tile.rect = vec4f(origin, origin + faceSize);
+    return tile;
+  }
+
+  @vertex
+  fn vs_clear(@builtin(vertex_index) vertex : u32,
+              @builtin(instance_index) instance : u32)
+    -> @builtin(position) vec4f {
+    var corners = array<vec2f, 6>(
+      vec2f(-1.0, -1.0), vec2f(1.0, -1.0), vec2f(-1.0, 1.0),
+      vec2f(-1.0, 1.0), vec2f(1.0, -1.0), vec2f(1.0, 1.0));
+    let tile = tileOf(instance);
+    return vec4f(tile.center + corners[vertex] * tile.extent, 1.0, 1.0);
+  }
+
+  struct CasterOutput {
+    @builtin(position) position : vec4f,
+    @location(0) lightVec : vec3f,
+    @location(1) @interpolate(flat) range : f32,
+    @location(2) @interpolate(flat) rect : vec4f,
+  }
+
+  @vertex
+  fn vs_caster(@location(0) position : vec3f,
+               @builtin(instance_index) instance : u32) -> CasterOutput {
+    let tile = tileOf(instance);
+    let light = lights[tile.light];
+    let v = position - light.position.xyz;
+    let f = faceCoords(tile.face, v);
+
+    var output : CasterOutput;
+    // 90 degree projection of the face into its tile, the depth is written
+    // by the fragment shader, clip z only removes what is behind the light
+    output.position = vec4f(tile.center * f.z + tile.extent * f.xy,
+                            f.z - kNear, f.z);
+    output.lightVec = v;
+    output.range = light.range;
+    output.rect = tile.rect;
+    return output;
+  }
+
+  @fragment
+  fn fs_caster(input : CasterOutput) -> @builtin(frag_depth) f32 {
+    // The projection of a face reaches into the neighboring tiles
+    if (any(input.position.xy < input.rect.xy)
+        || any(input.position.xy >= input.rect.zw)) {
+      discard;
+    }
+    return clamp(length(input.lightVec) / input.range, 0.0, 1.0);
+  }
+);
+// clang-format on
+
+typedef struct {
+  webgpu_renderer_t* renderer;
+  point_lights_t* point_lights;
+  bool enabled;
+
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+  } atlas;
+  WGPUSampler sampler;
+
+  struct {
+    wgpu_buffer_t params;
+    wgpu_buffer_t cache;
+    wgpu_buffer_t selection;
+    wgpu_buffer_t draw_args;
+  } buffers;
+  point_light_shadow_params_t params;
+
+  struct {
+    WGPUBindGroupLayout classify;
+    WGPUBindGroupLayout render;
+    WGPUBindGroupLayout lookup;
+  } bind_group_layouts;
+  struct {
+    WGPUBindGroup classify;
+    WGPUBindGroup render;
+    WGPUBindGroup lookup;
+  } bind_groups;
+  struct {
+    WGPUPipelineLayout classify;
+    WGPUPipelineLayout render;
+  } pipeline_layouts;
+  WGPUComputePipeline classify_pipeline;
+  WGPURenderPipeline clear_pipeline;
+  WGPURenderPipeline caster_pipeline;
+
+  struct {
+    WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
+    WGPURenderPassDescriptor descriptor;
+  } framebuffer;
+
+  uint32_t surface_version; /* of the surface the faces were last tested */
+  uint32_t lights_count;    /* shadowed lights of the last frame */
+} point_light_shadows_t;
+
+static bool point_light_shadows_is_ready(point_light_shadows_t* this)
+{
+  return (this->classify_pipeline != NULL) && (this->clear_pipeline != NULL)
+         && (this->caster_pipeline != NULL);
+}
+
+static void point_light_shadows_init_pipelines(point_light_shadows_t* this)
+{
+  wgpu_context_t* wgpu_context = this->renderer->wgpu_context;
+
+  /* Classify compute pipeline */
+  {
+    wgpu_shader_t comp_shader = wgpu_shader_create(
+      wgpu_context,
+      &(wgpu_shader_desc_t){
+        // Compute shader WGSL
+        .label     = "point light shadow classify compute shader",
+        .wgsl_code = {point_light_shadow_classify_shader_wgsl},
+        .entry     = "main",
+      });
+    wgpu_create_compute_pipeline_async(
+      wgpu_context,
+      &(WGPUComputePipelineDescriptor){
+        .label   = "point light shadow classify compute pipeline",
+        .layout  = this->pipeline_layouts.classify,
+        .compute = comp_shader.programmable_stage_descriptor,
+      },
+      &this->classify_pipeline, NULL, NULL);
+    wgpu_shader_release(&comp_shader);
+  }
+
+  /* Atlas render pipelines */
+  WGPUConstantEntry constants[2] = {
+    [0] = (WGPUConstantEntry){
+      .key   = "columns",
+      .value = (double)POINT_LIGHT_SHADOW_LIGHTS_COUNT,
+    },
+    [1] = (WGPUConstantEntry){
+      .key   = "faceSize",
+      .value = (double)POINT_LIGHT_SHADOW_FACE_SIZE,
+    },
+  };
+
+  // Primitive state
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  // Multisample state
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  /* Clear of the updated faces, the depth of the whole tile is set to 1 */
+  {
+    WGPUDepthStencilState depth_stencil_state
+      = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+        .format              = WGPUTextureFormat_Depth32Float,
+        .depth_write_enabled = true,
+      });
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Always;
+
+    WGPUVertexState vertex_state = wgpu_create_vertex_state(
+        wgpu_context, &(wgpu_vertex_state_t){
+        .shader_desc = (wgpu_shader_desc_t){
+            // Vertex shader WGSL
+            .label            = "point light shadow clear vertex shader",
+            .wgsl_code        = {point_light_shadow_render_shader_wgsl},
+            .entry            = "vs_clear",
+            .constants        = {
+              .count   = (uint32_t)ARRAY_SIZE(constants),
+              .entries = constants,
+            },
+          },
+          .buffer_count = 0,
+          .buffers      = NULL,
+        });
+
+    wgpu_create_render_pipeline_async(
+      wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "point light shadow clear pipeline",
+        .layout       = this->pipeline_layouts.render,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = NULL,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->clear_pipeline, NULL, NULL);
+
+    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  }
+
+  /* Metaballs surface into the updated faces */
+  {
+    WGPUDepthStencilState depth_stencil_state
+      = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+        .format              = WGPUTextureFormat_Depth32Float,
+        .depth_write_enabled = true,
+      });
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+
+    WGPUVertexAttribute attribute = {
+      .shaderLocation = 0,
+      .offset         = 0,
+      .format         = WGPUVertexFormat_Float32x3,
+    };
+    WGPUVertexBufferLayout vertex_buffers[1] = {
+      [0] = (WGPUVertexBufferLayout){
+        .arrayStride    = 3 * sizeof(float),
+        .stepMode       = WGPUVertexStepMode_Vertex,
+        .attributeCount = 1,
+        .attributes     = &attribute,
+      },
+    };
+
+    WGPUVertexState vertex_state = wgpu_create_vertex_state(
+        wgpu_context, &(wgpu_vertex_state_t){
+        .shader_desc = (wgpu_shader_desc_t){
+            // Vertex shader WGSL
+            .label            = "point light shadow caster vertex shader",
+            .wgsl_code        = {point_light_shadow_render_shader_wgsl},
+            .entry            = "vs_caster",
+            .constants        = {
+              .count   = (uint32_t)ARRAY_SIZE(constants),
+              .entries = constants,
+            },
+          },
+          .buffer_count = (uint32_t)ARRAY_SIZE(vertex_buffers),
+          .buffers      = vertex_buffers,
+        });
+
+    WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+        wgpu_context, &(wgpu_fragment_state_t){
+        .shader_desc = (wgpu_shader_desc_t){
+          // Fragment shader WGSL
+          .label            = "point light shadow caster fragment shader",
+          .wgsl_code        = {point_light_shadow_render_shader_wgsl},
+          .entry            = "fs_caster",
+          .constants        = {
+            .count   = (uint32_t)ARRAY_SIZE(constants),
+            .entries = constants,
+          },
+        },
+        .target_count = 0,
+        .targets      = NULL,
+        });
+
+    wgpu_create_render_pipeline_async(
+      wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "point light shadow caster pipeline",
+        .layout       = this->pipeline_layouts.render,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = &fragment_state,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->caster_pipeline, NULL, NULL);
+
+    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  }
+}
+
+static void point_light_shadows_init_defaults(point_light_shadows_t* this)
+{
+  memset(this, 0, sizeof(*this));
+
+  this->enabled = true;
+}
+
+static void point_light_shadows_create(point_light_shadows_t* this,
+                                       webgpu_renderer_t* renderer,
+                                       point_lights_t* point_lights)
+{
+  point_light_shadows_init_defaults(this);
+
+  this->renderer     = renderer;
+  this->point_lights = point_lights;
+
+  wgpu_context_t* wgpu_context = renderer->wgpu_context;
+
+  /* Depth atlas, a column per light and a row per cube face */
+  {
+    WGPUTextureDescriptor texture_desc = {
+      .label         = "point light shadow atlas texture",
+      .size          = (WGPUExtent3D){
+        .width              = POINT_LIGHT_SHADOW_LIGHTS_COUNT
+                              * POINT_LIGHT_SHADOW_FACE_SIZE,
+        .height             = 6 * POINT_LIGHT_SHADOW_FACE_SIZE,
+        .depthOrArrayLayers = 1,
+      },
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+      .dimension     = WGPUTextureDimension_2D,
+      .format        = WGPUTextureFormat_Depth32Float,
+      .usage
+      = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
+    };
+    this->atlas.texture
+      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+    ASSERT(this->atlas.texture != NULL);
+
+    this->atlas.view = wgpuTextureCreateView(
+      this->atlas.texture, &(WGPUTextureViewDescriptor){
+                             .label = "point light shadow atlas texture view",
+                             .dimension       = WGPUTextureViewDimension_2D,
+                             .format          = texture_desc.format,
+                             .baseMipLevel    = 0,
+                             .mipLevelCount   = 1,
+                             .baseArrayLayer  = 0,
+                             .arrayLayerCount = 1,
+                           });
+    ASSERT(this->atlas.view != NULL);
+  }
+
+  /* Comparison sampler of the lookup */
+  this->sampler = wgpuDeviceCreateSampler(
+    wgpu_context->device, &(WGPUSamplerDescriptor){
+                            .label         = "point light shadow sampler",
+                            .addressModeU  = WGPUAddressMode_ClampToEdge,
+                            .addressModeV  = WGPUAddressMode_ClampToEdge,
+                            .addressModeW  = WGPUAddressMode_ClampToEdge,
+                            .minFilter     = WGPUFilterMode_Linear,
+                            .magFilter     = WGPUFilterMode_Linear,
+                            .mipmapFilter  = WGPUFilterMode_Nearest,
+                            .compare       = WGPUCompareFunction_LessEqual,
+                            .maxAnisotropy = 1,
+                          });
+  ASSERT(this->sampler != NULL);
+
+  /* Buffers, the zeroed cache updates every light on the first frame */
+  this->buffers.params = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "point light shadow params",
+                    .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+                    .size  = sizeof(point_light_shadow_params_t),
+                  });
+  this->buffers.cache = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "point light shadow cache",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = POINT_LIGHT_SHADOW_LIGHTS_COUNT * sizeof(vec4),
+                  });
+  this->buffers.selection = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "point light shadow selection",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = POINT_LIGHT_SHADOW_LIGHTS_COUNT * sizeof(uint32_t),
+                  });
+  this->buffers.draw_args = wgpu_create_buffer(
+    wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "point light shadow draw arguments",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect,
+      .size  = 8 * sizeof(uint32_t),
+    });
+
+  /* Classify bind group layout, the surface arguments are bound when the
+   * atlas is first rendered */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[6] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = this->buffers.params.size,
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = point_lights->lights_buffer.size,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Storage,
+          .minBindingSize = this->buffers.cache.size,
+        },
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Storage,
+          .minBindingSize = this->buffers.selection.size,
+        },
+      },
+      [4] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 4,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Storage,
+          .minBindingSize = this->buffers.draw_args.size,
+        },
+      },
+      [5] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 5,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = 4 * sizeof(uint32_t),
+        },
+      },
+    };
+    this->bind_group_layouts.classify = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device,
+      &(WGPUBindGroupLayoutDescriptor){
+        .label      = "point light shadow classify bind group layout",
+        .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+        .entries    = bgl_entries,
+      });
+    ASSERT(this->bind_group_layouts.classify != NULL);
+  }
+
+  /* Atlas render bind group layout & bind group */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[2] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = point_lights->lights_buffer.size,
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = this->buffers.selection.size,
+        },
+      },
+    };
+    this->bind_group_layouts.render = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device,
+      &(WGPUBindGroupLayoutDescriptor){
+        .label      = "point light shadow render bind group layout",
+        .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+        .entries    = bgl_entries,
+      });
+    ASSERT(this->bind_group_layouts.render != NULL);
+
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = point_lights->lights_buffer.buffer,
+        .size    = point_lights->lights_buffer.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = this->buffers.selection.buffer,
+        .size    = this->buffers.selection.size,
+      },
+    };
+    this->bind_groups.render = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label  = "point light shadow render bind group",
+                              .layout = this->bind_group_layouts.render,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(this->bind_groups.render != NULL);
+  }
+
+  /* Lookup bind group layout & bind group of the deferred pass */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[4] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: Depth atlas
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Depth,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Binding 1: Comparison sampler
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Fragment,
+        .sampler = (WGPUSamplerBindingLayout) {
+          .type = WGPUSamplerBindingType_Comparison,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Positions and ranges the faces were rendered from
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = this->buffers.cache.size,
+        },
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Parameters, the shadowed light count
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = this->buffers.params.size,
+        },
+      },
+    };
+    this->bind_group_layouts.lookup = wgpuDeviceCreateBindGroupLayout(
       wgpu_context->device,
       &(WGPUBindGroupLayoutDescriptor){
-        .label      = "spot light depth texture bind group layout",
+        .label      = "point light shadow lookup bind group layout",
         .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
         .entries    = bgl_entries,
       });
-    ASSERT(this->bind_group_layouts.depth_texture != NULL);
-  }
+    ASSERT(this->bind_group_layouts.lookup != NULL);
 
-  /* Spot light ubos bind group */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
+    WGPUBindGroupEntry bg_entries[4] = {
       [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .buffer  = this->ubos.light_info.buffer,
-        .size    = this->ubos.light_info.size,
+        .binding     = 0,
+        .textureView = this->atlas.view,
       },
       [1] = (WGPUBindGroupEntry) {
         .binding = 1,
-        .buffer  = this->ubos.projection.buffer,
-        .size    = this->ubos.projection.size,
+        .sampler = this->sampler,
       },
       [2] = (WGPUBindGroupEntry) {
         .binding = 2,
-        .buffer  = this->ubos.view.buffer,
-        .size    = this->ubos.view.size,
+        .buffer  = this->buffers.cache.buffer,
+        .size    = this->buffers.cache.size,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = this->buffers.params.buffer,
+        .size    = this->buffers.params.size,
       },
     };
-    this->bind_groups.ubos = wgpuDeviceCreateBindGroup(
+    this->bind_groups.lookup = wgpuDeviceCreateBindGroup(
       wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label      = "spot light ubos bind group",
-                              .layout     = this->bind_group_layouts.ubos,
+                              .label  = "point light shadow lookup bind group",
+                              .layout = this->bind_group_layouts.lookup,
                               .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
                               .entries    = bg_entries,
                             });
-    ASSERT(this->bind_groups.ubos != NULL);
+    ASSERT(this->bind_groups.lookup != NULL);
   }
 
-  /* Spot light depth texture bind group */
-  {
-    WGPUBindGroupEntry bg_entries[1] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding     = 0,
-        .textureView = this->depth_texture.view,
-        },
-      };
-    this->bind_groups.depth_texture = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label  = "spot light depth texture bind group",
-                              .layout = this->bind_group_layouts.depth_texture,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(this->bind_groups.depth_texture != NULL);
-  }
+  /* Pipeline layouts */
+  this->pipeline_layouts.classify = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "point light shadow classify pipeline layout",
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &this->bind_group_layouts.classify,
+    });
+  ASSERT(this->pipeline_layouts.classify != NULL);
+  this->pipeline_layouts.render = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "point light shadow render pipeline layout",
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &this->bind_group_layouts.render,
+    });
+  ASSERT(this->pipeline_layouts.render != NULL);
+
+  /* Render pass descriptor, the faces not updated are kept */
+  this->framebuffer.depth_stencil_attachment
+    = (WGPURenderPassDepthStencilAttachment){
+      .view         = this->atlas.view,
+      .depthLoadOp  = WGPULoadOp_Load,
+      .depthStoreOp = WGPUStoreOp_Store,
+      .clearDepth   = 1.0f,
+      .clearStencil = 0,
+    };
+  this->framebuffer.descriptor = (WGPURenderPassDescriptor){
+    .label                  = "point light shadow atlas render pass",
+    .colorAttachmentCount   = 0,
+    .colorAttachments       = NULL,
+    .depthStencilAttachment = &this->framebuffer.depth_stencil_attachment,
+    .occlusionQuerySet      = NULL,
+  };
+
+  point_light_shadows_init_pipelines(this);
 }
 
-static void spot_light_destroy(spot_light_t* this)
+static void point_light_shadows_destroy(point_light_shadows_t* this)
 {
-  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.light_info.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.projection.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, this->ubos.view.buffer)
-  WGPU_RELEASE_RESOURCE(Texture, this->depth_texture.texture)
-  WGPU_RELEASE_RESOURCE(TextureView, this->depth_texture.view)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.ubos)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.depth_texture)
-  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.ubos)
-  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.depth_texture)
+  WGPU_RELEASE_RESOURCE(Texture, this->atlas.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, this->atlas.view)
+  WGPU_RELEASE_RESOURCE(Sampler, this->sampler)
+  WGPU_RELEASE_RESOURCE(Buffer, this->buffers.params.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->buffers.cache.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->buffers.selection.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->buffers.draw_args.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.classify)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.render)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layouts.lookup)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.classify)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.render)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->bind_groups.lookup)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, this->pipeline_layouts.classify)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, this->pipeline_layouts.render)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->classify_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, this->clear_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, this->caster_pipeline)
+}
+
+static void point_light_shadows_set_enabled(point_light_shadows_t* this,
+                                            bool enabled)
+{
+  this->enabled = enabled;
+  /* The faces were not kept up to date while disabled */
+  this->lights_count = 0;
+}
+
+/* Classifies the lights and renders the faces of the updated ones, the
+ * surface buffers of the metaballs are complete when the command buffer
+ * executes */
+static void point_light_shadows_render(point_light_shadows_t* this,
+                                       WGPUCommandEncoder cmd_enc,
+                                       metaballs_compute_t* surface)
+{
+  if (!this->enabled || !point_light_shadows_is_ready(this)
+      || !surface->has_calced_once) {
+    return;
+  }
+  wgpu_context_t* wgpu_context = this->renderer->wgpu_context;
+
+  /* The surface draw arguments are bound once, the buffer is never
+   * recreated */
+  if (this->bind_groups.classify == NULL) {
+    WGPUBindGroupEntry bg_entries[6] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = this->buffers.params.buffer,
+        .size    = this->buffers.params.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = this->point_lights->lights_buffer.buffer,
+        .size    = this->point_lights->lights_buffer.size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = this->buffers.cache.buffer,
+        .size    = this->buffers.cache.size,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = this->buffers.selection.buffer,
+        .size    = this->buffers.selection.size,
+      },
+      [4] = (WGPUBindGroupEntry) {
+        .binding = 4,
+        .buffer  = this->buffers.draw_args.buffer,
+        .size    = this->buffers.draw_args.size,
+      },
+      [5] = (WGPUBindGroupEntry) {
+        .binding = 5,
+        .buffer  = surface->indirect_render_buffer.buffer,
+        .size    = surface->indirect_render_buffer.size,
+      },
+    };
+    this->bind_groups.classify = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .label      = "point light shadow classify bind group",
+        .layout     = this->bind_group_layouts.classify,
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(this->bind_groups.classify != NULL);
+  }
+
+  /* Frame parameters */
+  const uint32_t lights_count = MIN((uint32_t)this->point_lights->lights_count,
+                                    POINT_LIGHT_SHADOW_LIGHTS_COUNT);
+  const bool surface_changed
+    = surface->surface_version != this->surface_version;
+  point_light_shadow_params_t* params = &this->params;
+  glm_vec4_copy((vec4){surface->bounds_min[0], surface->bounds_min[1],
+                       surface->bounds_min[2], surface_changed ? 1.0f : 0.0f},
+                params->bounds_min);
+  glm_vec4_copy((vec4){surface->bounds_max[0], surface->bounds_max[1],
+                       surface->bounds_max[2],
+                       POINT_LIGHT_SHADOW_MOVE_TOLERANCE},
+                params->bounds_max);
+  /* Lights enabled since the last frame have outdated faces */
+  params->force_update  = lights_count > this->lights_count ? 1u : 0u;
+  params->lights_count  = lights_count;
+  this->lights_count    = lights_count;
+  this->surface_version = surface->surface_version;
+  wgpu_queue_write_buffer(wgpu_context, this->buffers.params.buffer, 0, params,
+                          sizeof(*params));
+  if (lights_count == 0) {
+    return;
+  }
+
+  /* Classify */
+  {
+    WGPUComputePassEncoder compute_pass
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(compute_pass, this->classify_pipeline);
+    wgpuComputePassEncoderSetBindGroup(compute_pass, 0,
+                                       this->bind_groups.classify, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(compute_pass, 1, 1, 1);
+    wgpuComputePassEncoderEnd(compute_pass);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
+  }
+
+  /* Clear and render the updated faces */
+  {
+    WGPURenderPassEncoder render_pass = wgpuCommandEncoderBeginRenderPass(
+      cmd_enc, &this->framebuffer.descriptor);
+    wgpuRenderPassEncoderSetBindGroup(render_pass, 0, this->bind_groups.render,
+                                      0, NULL);
+    wgpuRenderPassEncoderSetPipeline(render_pass, this->clear_pipeline);
+    wgpuRenderPassEncoderDrawIndirect(render_pass,
+                                      this->buffers.draw_args.buffer, 0);
+    wgpuRenderPassEncoderSetPipeline(render_pass, this->caster_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(
+      render_pass, 0, surface->vertex_buffer.buffer, 0, WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderDrawIndirect(
+      render_pass, this->buffers.draw_args.buffer, 4 * sizeof(uint32_t));
+    wgpuRenderPassEncoderEnd(render_pass);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, render_pass)
+  }
 }
 
 /* -------------------------------------------------------------------------- *
@@ -2828,18 +4494,18 @@ static void box_outline_init(box_outline_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipeline
-      = wgpuDeviceCreateRenderPipeline(this->renderer->wgpu_context->device,
-                                       &(WGPURenderPipelineDescriptor){
-                                         .label = "box outline render pipeline",
-                                         .layout       = this->pipeline_layout,
-                                         .primitive    = primitive_state,
-                                         .vertex       = vertex_state,
-                                         .fragment     = &fragment_state,
-                                         .depthStencil = &depth_stencil_state,
-                                         .multisample  = multisample_state,
-                                       });
-    ASSERT(this->render_pipeline != NULL);
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "box outline render pipeline",
+        .layout       = this->pipeline_layout,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = &fragment_state,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->render_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -3206,8 +4872,8 @@ static void ground_init(ground_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipelines.render_pipeline = wgpuDeviceCreateRenderPipeline(
-      this->renderer->wgpu_context->device,
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
       &(WGPURenderPipelineDescriptor){
         .label        = "ground render pipeline",
         .layout       = this->pipeline_layouts.render_pipeline,
@@ -3216,8 +4882,8 @@ static void ground_init(ground_t* this)
         .fragment     = &fragment_state,
         .depthStencil = &depth_stencil_state,
         .multisample  = multisample_state,
-      });
-    ASSERT(this->pipeline_layouts.render_pipeline != NULL);
+      },
+      &this->render_pipelines.render_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -3307,19 +4973,18 @@ static void ground_init(ground_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipelines.render_shadow_pipeline
-      = wgpuDeviceCreateRenderPipeline(
-        this->renderer->wgpu_context->device,
-        &(WGPURenderPipelineDescriptor){
-          .label        = "ground render pipeline",
-          .layout       = this->pipeline_layouts.render_shadow_pipeline,
-          .primitive    = primitive_state,
-          .vertex       = vertex_state,
-          .fragment     = NULL,
-          .depthStencil = &depth_stencil_state,
-          .multisample  = multisample_state,
-        });
-    ASSERT(this->pipeline_layouts.render_shadow_pipeline != NULL);
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "ground render pipeline",
+        .layout       = this->pipeline_layouts.render_shadow_pipeline,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = NULL,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->render_pipelines.render_shadow_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -3699,8 +5364,8 @@ static void metaballs_init(metaballs_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipelines.render_pipeline = wgpuDeviceCreateRenderPipeline(
-      this->renderer->wgpu_context->device,
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
       &(WGPURenderPipelineDescriptor){
         .label        = "metaball rendering pipeline",
         .layout       = this->pipeline_layouts.render_pipeline,
@@ -3709,8 +5374,8 @@ static void metaballs_init(metaballs_t* this)
         .fragment     = &fragment_state,
         .depthStencil = &depth_stencil_state,
         .multisample  = multisample_state,
-      });
-    ASSERT(this->pipeline_layouts.render_pipeline != NULL);
+      },
+      &this->render_pipelines.render_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -3786,19 +5451,18 @@ static void metaballs_init(metaballs_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipelines.render_shadow_pipeline
-      = wgpuDeviceCreateRenderPipeline(
-        this->renderer->wgpu_context->device,
-        &(WGPURenderPipelineDescriptor){
-          .label        = "metaballs shadow rendering pipeline",
-          .layout       = this->pipeline_layouts.render_shadow_pipeline,
-          .primitive    = primitive_state,
-          .vertex       = vertex_state,
-          .fragment     = NULL,
-          .depthStencil = &depth_stencil_state,
-          .multisample  = multisample_state,
-        });
-    ASSERT(this->pipeline_layouts.render_shadow_pipeline != NULL);
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "metaballs shadow rendering pipeline",
+        .layout       = this->pipeline_layouts.render_shadow_pipeline,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = NULL,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->render_pipelines.render_shadow_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -3917,9 +5581,15 @@ static void metaballs_rearrange(metaballs_t* this)
   metaballs_compute_rearrange(&this->metaballs_compute);
 }
 
-static metaballs_t* metaballs_update_sim(metaballs_t* this,
-                                         WGPUComputePassEncoder compute_pass,
-                                         float time, float time_delta)
+static void metaballs_set_volume(metaballs_t* this,
+                                 const ivolume_settings_t* volume)
+{
+  memcpy(&this->volume, volume, sizeof(ivolume_settings_t));
+  metaballs_compute_set_volume(&this->metaballs_compute, volume);
+}
+
+static metaballs_t* metaballs_update_sim(metaballs_t* this, float time,
+                                         float time_delta)
 {
   const float color_speed = time_delta * 2.0f;
   this->material.color_rgb[0]
@@ -3943,8 +5613,14 @@ static metaballs_t* metaballs_update_sim(metaballs_t* this,
   wgpu_queue_write_buffer(this->renderer->wgpu_context, this->ubo.buffer, 0,
                           &this->material, sizeof(metaballs_material_t));
 
-  metaballs_compute_update_sim(&this->metaballs_compute, compute_pass, time,
-                               time_delta);
+  metaballs_compute_update_sim(&this->metaballs_compute, time, time_delta);
+  return this;
+}
+
+static metaballs_t* metaballs_build_surface(metaballs_t* this,
+                                            WGPUCommandEncoder cmd_enc)
+{
+  metaballs_compute_build_surface(&this->metaballs_compute, cmd_enc);
   return this;
 }
 
@@ -3962,11 +5638,8 @@ static metaballs_t* metaballs_render_shadow(metaballs_t* this,
   wgpuRenderPassEncoderSetVertexBuffer(
     render_pass, 0, this->metaballs_compute.vertex_buffer.buffer, 0,
     WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetIndexBuffer(
-    render_pass, this->metaballs_compute.index_buffer.buffer,
-    WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderDrawIndexed(
-    render_pass, this->metaballs_compute.index_count, 1, 0, 0, 0);
+  wgpuRenderPassEncoderDrawIndirect(
+    render_pass, this->metaballs_compute.indirect_render_buffer.buffer, 0);
   return this;
 }
 
@@ -3988,11 +5661,8 @@ static metaballs_t* metaballs_render(metaballs_t* this,
   wgpuRenderPassEncoderSetVertexBuffer(
     render_pass, 1, this->metaballs_compute.normal_buffer.buffer, 0,
     WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetIndexBuffer(
-    render_pass, this->metaballs_compute.index_buffer.buffer,
-    WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderDrawIndexed(
-    render_pass, this->metaballs_compute.index_count, 1, 0, 0, 0);
+  wgpuRenderPassEncoderDrawIndirect(
+    render_pass, this->metaballs_compute.indirect_render_buffer.buffer, 0);
   return this;
 }
 
@@ -4098,18 +5768,18 @@ static void particles_init(particles_t* this)
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipeline
-      = wgpuDeviceCreateRenderPipeline(this->renderer->wgpu_context->device,
-                                       &(WGPURenderPipelineDescriptor){
-                                         .label  = "particles render pipeline",
-                                         .layout = this->pipeline_layout,
-                                         .primitive    = primitive_state,
-                                         .vertex       = vertex_state,
-                                         .fragment     = &fragment_state,
-                                         .depthStencil = &depth_stencil_state,
-                                         .multisample  = multisample_state,
-                                       });
-    ASSERT(this->render_pipeline != NULL);
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label        = "particles render pipeline",
+        .layout       = this->pipeline_layout,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = &fragment_state,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      &this->render_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -4186,7 +5856,8 @@ static void particles_destroy(particles_t* this)
 }
 
 static void particles_render(particles_t* this,
-                             WGPURenderPassEncoder render_pass)
+                             WGPURenderPassEncoder render_pass,
+                             uint32_t lights_count)
 {
   if (!this->render_pipeline) {
     return;
@@ -4196,8 +5867,7 @@ static void particles_render(particles_t* this,
   wgpuRenderPassEncoderSetBindGroup(render_pass, 0,
                                     this->renderer->bind_groups.frame, 0, 0);
   wgpuRenderPassEncoderSetBindGroup(render_pass, 1, this->bind_group, 0, 0);
-  wgpuRenderPassEncoderDrawIndexed(
-    render_pass, 6, settings_get_quality_level().point_lights_count, 0, 0, 0);
+  wgpuRenderPassEncoderDrawIndexed(render_pass, 6, lights_count, 0, 0, 0);
 }
 
 /* -------------------------------------------------------------------------- *
@@ -4309,16 +5979,17 @@ static void effect_init(effect_t* this, const char* fragment_shader_file,
         });
 
     // Create rendering pipeline using the specified states
-    this->render_pipeline = wgpuDeviceCreateRenderPipeline(
-      this->renderer->wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                                              .label  = label,
-                                              .layout = this->pipeline_layout,
-                                              .primitive   = primitive_state,
-                                              .vertex      = vertex_state,
-                                              .fragment    = &fragment_state,
-                                              .multisample = multisample_state,
-                                            });
-    ASSERT(this->render_pipeline != NULL);
+    wgpu_create_render_pipeline_async(
+      this->renderer->wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label       = label,
+        .layout      = this->pipeline_layout,
+        .primitive   = primitive_state,
+        .vertex      = vertex_state,
+        .fragment    = &fragment_state,
+        .multisample = multisample_state,
+      },
+      &this->render_pipeline, NULL, NULL);
 
     // Partial cleanup
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -4596,18 +6267,14 @@ static void copy_pass_render(copy_pass_t* this,
 /* -------------------------------------------------------------------------- *
  * Bloom Pass
  *
+ * The bright parts are filtered by the shared downsample / upsample bloom in
+ * place of the separable compute blur of the reference, which also removes
+ * the frame of latency of blurring them in the compute command buffer.
+ *
  * Ref:
  * https://github.com/gnikoloff/webgpu-compute-metaballs/blob/master/src/postfx/bloom-pass.ts
  * -------------------------------------------------------------------------- */
 
-#define BLOOM_PASS_TILE_DIM 128u
-#define BLOOM_PASS_BATCH                                                       \
-  {                                                                            \
-    4, 4                                                                       \
-  }
-#define BLOOM_PASS_FILTER_SIZE 10u
-#define BLOOM_PASS_ITERATIONS 2u
-
 typedef struct {
   webgpu_renderer_t* renderer;
   effect_t effect;
@@ -4624,191 +6291,28 @@ typedef struct {
     WGPUTexture texture;
     WGPUTextureView view;
   } input_texture;
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView view;
-  } blur_textures[2];
 
   WGPUBindGroupLayout bind_group_layout;
   WGPUBindGroup bind_group;
 
-  WGPUPipelineLayout blur_pipeline_layout;
-  WGPUComputePipeline blur_pipeline;
-
-  WGPUBindGroupLayout blur_constants_bind_group_layout;
-  WGPUBindGroup blur_compute_constants_bindGroup;
-
-  WGPUBindGroupLayout blur_compute_bind_group_layout;
-  WGPUBindGroup blur_compute_bind_groups[3];
-
-  wgpu_buffer_t blur_params_buffer;
-  wgpu_buffer_t buffer_0;
-  wgpu_buffer_t buffer_1;
+  /* Downsample / upsample mip chain of the bright parts, added to the frame
+   * buffer after the result pass */
+  wgpu_bloom_t* bloom;
 
   struct {
     WGPURenderPassColorAttachment color_attachments[1];
     WGPURenderPassDescriptor descriptor;
-  } framebuffer;
-
-  WGPUSampler sampler;
-  uint32_t block_dim;
-} bloom_pass_t;
-
-static bool bloom_pass_is_ready(bloom_pass_t* this)
-{
-  return (this->effect.render_pipeline != NULL)
-         && (this->blur_pipeline != NULL);
-}
-
-static void bloom_pass_init_compute_pipeline(bloom_pass_t* this)
-{
-  wgpu_context_t* wgpu_context = this->renderer->wgpu_context;
-
-  /* Bloom pass blur pipeline layout */
-  {
-    WGPUBindGroupLayout bind_group_layouts[2] = {
-      this->blur_constants_bind_group_layout, // Group 0
-      this->blur_compute_bind_group_layout,   // Group 1
-    };
-    WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
-      .label                = "bloom pass blur pipeline layout",
-      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
-      .bindGroupLayouts     = bind_group_layouts,
-    };
-    this->blur_pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      this->renderer->wgpu_context->device, &pipeline_layout_desc);
-    ASSERT(this->blur_pipeline_layout != NULL);
-  }
-
-  /* Bloom pass blur pipeline */
-  {
-    wgpu_shader_t comp_shader = wgpu_shader_create(
-      wgpu_context,
-      &(wgpu_shader_desc_t){
-        // Compute shader WGSL
-        .file  = "shaders/compute_metaballs/bloom_blur_compute_shader.wgsl",
-        .entry = "main",
-      });
-    this->blur_pipeline = wgpuDeviceCreateComputePipeline(
-      wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .label   = "bloom pass blur pipeline",
-        .layout  = this->blur_pipeline_layout,
-        .compute = comp_shader.programmable_stage_descriptor,
-      });
-    wgpu_shader_release(&comp_shader);
-  }
-
-  /* Horizontal flip */
-  const uint32_t horizontal_flip_data[1] = {
-    0 //
-  };
-  this->buffer_0 = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .label        = "Horizontal flip buffer",
-                    .usage        = WGPUBufferUsage_Uniform,
-                    .size         = sizeof(horizontal_flip_data),
-                    .initial.data = &horizontal_flip_data[0],
-                  });
-
-  /* Vertical flip */
-  const uint32_t vertical_flip_data[1] = {
-    1 //
-  };
-  this->buffer_1
-    = wgpu_create_buffer(wgpu_context, &(wgpu_buffer_desc_t){
-                                         .label = "Vertical flip buffer",
-                                         .usage = WGPUBufferUsage_Uniform,
-                                         .size  = sizeof(vertical_flip_data),
-                                         .initial.data = &vertical_flip_data[0],
-                                       });
-
-  /* Blur compute bind group 0 */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding     = 0,
-        .textureView = this->bloom_texture.view,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding     = 1,
-        .textureView = this->blur_textures[0].view,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = this->buffer_0.buffer,
-        .size    = this->buffer_0.size,
-      },
-    };
-    this->blur_compute_bind_groups[0] = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label  = "blur compute bind group 0",
-                              .layout = this->blur_compute_bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(this->blur_compute_bind_groups[0] != NULL);
-  }
-
-  /* Blur compute bind group 1 */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding     = 0,
-        .textureView = this->blur_textures[0].view,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding     = 1,
-        .textureView = this->blur_textures[1].view,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = this->buffer_1.buffer,
-        .size    = this->buffer_1.size,
-      },
-    };
-    this->blur_compute_bind_groups[1] = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label  = "blur compute bind group 1",
-                              .layout = this->blur_compute_bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(this->blur_compute_bind_groups[1] != NULL);
-  }
+  } framebuffer;
+} bloom_pass_t;
 
-  /* Blur compute bind group 2 */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding     = 0,
-        .textureView = this->blur_textures[1].view,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding     = 1,
-        .textureView = this->blur_textures[0].view,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = this->buffer_0.buffer,
-        .size    = this->buffer_0.size,
-      },
-    };
-    this->blur_compute_bind_groups[2] = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label  = "blur compute bind group 2",
-                              .layout = this->blur_compute_bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(this->blur_compute_bind_groups[2] != NULL);
-  }
+static bool bloom_pass_is_ready(bloom_pass_t* this)
+{
+  return (this->effect.render_pipeline != NULL) && (this->bloom != NULL);
 }
 
 static void bloom_pass_init_defaults(bloom_pass_t* this)
 {
   memset(this, 0, sizeof(*this));
-  this->block_dim = 0;
 }
 
 static void bloom_pass_create(bloom_pass_t* this, webgpu_renderer_t* renderer,
@@ -4877,43 +6381,6 @@ static void bloom_pass_create(bloom_pass_t* this, webgpu_renderer_t* renderer,
     ASSERT(this->bind_group_layout != NULL);
   }
 
-  /* Blur texture and blur texture views */
-  for (uint8_t i = 0; i < 2; ++i) {
-    /* Blur texture */
-    WGPUExtent3D texture_extent = {
-      .width              = renderer->output_size[0],
-      .height             = renderer->output_size[1],
-      .depthOrArrayLayers = 1,
-    };
-    WGPUTextureDescriptor texture_desc = {
-      .label         = "blur texture",
-      .size          = texture_extent,
-      .mipLevelCount = 1,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = WGPUTextureFormat_RGBA8Unorm,
-      .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_StorageBinding
-               | WGPUTextureUsage_TextureBinding,
-    };
-    this->blur_textures[i].texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(this->blur_textures[i].texture != NULL);
-
-    /* Blur texture view */
-    WGPUTextureViewDescriptor texture_view_dec = {
-      .label           = "blur texture view",
-      .dimension       = WGPUTextureViewDimension_2D,
-      .format          = texture_desc.format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = 1,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
-    };
-    this->blur_textures[i].view = wgpuTextureCreateView(
-      this->blur_textures[i].texture, &texture_view_dec);
-    ASSERT(this->blur_textures[i].view != NULL);
-  }
-
   /* G-buffer bind group */
   {
     WGPUBindGroupEntry bg_entries[1] = {
@@ -4980,131 +6447,20 @@ static void bloom_pass_create(bloom_pass_t* this, webgpu_renderer_t* renderer,
     .depthStencilAttachment = NULL,
   };
 
-  /* Blur params buffer */
-  this->block_dim = BLOOM_PASS_TILE_DIM - (BLOOM_PASS_FILTER_SIZE - 1);
-  const uint32_t blur_params[2] = {BLOOM_PASS_FILTER_SIZE, this->block_dim};
-  this->blur_params_buffer      = wgpu_create_buffer(
-         wgpu_context, &(wgpu_buffer_desc_t){
-                         .label = "blur params buffer",
-                         .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-                         .size  = sizeof(blur_params),
-                         .initial.data = &blur_params[0],
+  /* Bloom mip chain, the bloom pass writes only the bright parts */
+  this->bloom = wgpu_bloom_create(
+    wgpu_context, &(wgpu_bloom_desc_t){
+                    .label            = "bloom mip chain",
+                    .width            = renderer->output_size[0],
+                    .height           = renderer->output_size[1],
+                    .composite_format = renderer->presentation_format,
                   });
-
-  /* Bloom sampler */
-  this->sampler = wgpuDeviceCreateSampler(
-    wgpu_context->device, &(WGPUSamplerDescriptor){
-                            .label         = "bloom sampler",
-                            .addressModeU  = WGPUAddressMode_ClampToEdge,
-                            .addressModeV  = WGPUAddressMode_ClampToEdge,
-                            .addressModeW  = WGPUAddressMode_ClampToEdge,
-                            .minFilter     = WGPUFilterMode_Linear,
-                            .magFilter     = WGPUFilterMode_Linear,
-                            .mipmapFilter  = WGPUFilterMode_Linear,
-                            .lodMinClamp   = 0.0f,
-                            .lodMaxClamp   = 1.0f,
-                            .maxAnisotropy = 1,
-                          });
-  ASSERT(this->sampler != NULL);
-
-  /* Blur constants bind group layout */
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[2] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Compute,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Compute,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = this->blur_params_buffer.size,
-        },
-        .sampler = {0},
-      },
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .label      = "blur constants bind group layout",
-      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-      .entries    = bgl_entries,
-    };
-    this->blur_constants_bind_group_layout
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(this->blur_constants_bind_group_layout != NULL);
-  }
-
-  /* Blur constants bind group */
-  {
-    WGPUBindGroupEntry bg_entries[2] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .sampler = this->sampler,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding = 1,
-        .buffer  = this->blur_params_buffer.buffer,
-        .size    = this->blur_params_buffer.size,
-      },
-    };
-    WGPUBindGroupDescriptor bg_desc = {
-      .label      = "blur constants bind group",
-      .layout     = this->blur_constants_bind_group_layout,
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
-    };
-    this->blur_compute_constants_bindGroup
-      = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-    ASSERT(this->blur_compute_constants_bindGroup != NULL);
-  }
-
-  /* Blur compute bind group layout */
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[3] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Compute,
-        .texture = (WGPUTextureBindingLayout){
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-          .multisampled  = false,
-        },
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Compute,
-        .storageTexture = (WGPUStorageTextureBindingLayout) {
-           .access        = WGPUStorageTextureAccess_WriteOnly,
-           .format        = WGPUTextureFormat_RGBA8Unorm,
-           .viewDimension = WGPUTextureViewDimension_2D,
-         },
-        .sampler = {0},
-      },
-      [2] = (WGPUBindGroupLayoutEntry) {
-        .binding    = 2,
-        .visibility = WGPUShaderStage_Compute,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = sizeof(float),
-        },
-        .sampler = {0},
-      },
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .label      = "blur compute bind group layout",
-      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-      .entries    = bgl_entries,
-    };
-    this->blur_compute_bind_group_layout
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(this->blur_compute_bind_group_layout != NULL);
-  }
-
-  /* Init compute pipeline */
-  bloom_pass_init_compute_pipeline(this);
+  wgpu_bloom_set_params(this->bloom, &(wgpu_bloom_params_t){
+                                       .threshold = 0.0f,
+                                       .knee      = 0.0f,
+                                       .radius    = 1.0f,
+                                       .intensity = 1.0f,
+                                     });
 }
 
 static void bloom_pass_destroy(bloom_pass_t* this)
@@ -5112,76 +6468,21 @@ static void bloom_pass_destroy(bloom_pass_t* this)
   effect_destroy(&this->effect);
   WGPU_RELEASE_RESOURCE(Texture, this->bloom_texture.texture)
   WGPU_RELEASE_RESOURCE(TextureView, this->bloom_texture.view)
-  for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(this->blur_textures); ++i) {
-    WGPU_RELEASE_RESOURCE(Texture, this->blur_textures[i].texture)
-    WGPU_RELEASE_RESOURCE(TextureView, this->blur_textures[i].view)
-  }
   WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, this->bind_group)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, this->blur_pipeline_layout)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, this->blur_pipeline)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->blur_constants_bind_group_layout)
-  WGPU_RELEASE_RESOURCE(BindGroup, this->blur_compute_constants_bindGroup)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, this->blur_compute_bind_group_layout)
-  WGPU_RELEASE_RESOURCE(BindGroup, this->blur_compute_bind_groups[0])
-  WGPU_RELEASE_RESOURCE(BindGroup, this->blur_compute_bind_groups[1])
-  WGPU_RELEASE_RESOURCE(BindGroup, this->blur_compute_bind_groups[2])
-  WGPU_RELEASE_RESOURCE(Buffer, this->blur_params_buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, this->buffer_0.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, this->buffer_1.buffer)
-  WGPU_RELEASE_RESOURCE(Sampler, this->sampler)
+  wgpu_bloom_destroy(this->bloom);
+  this->bloom = NULL;
 }
 
+/* Filters the bright parts written by bloom_pass_render() */
 static void bloom_pass_update_bloom(bloom_pass_t* this,
-                                    WGPUComputePassEncoder compute_pass)
+                                    WGPUCommandEncoder cmd_enc)
 {
   if (!bloom_pass_is_ready(this)) {
     return;
   }
 
-  const webgpu_renderer_t* renderer = this->renderer;
-  const uint32_t block_dim          = this->block_dim;
-  const uint32_t batch[2]           = BLOOM_PASS_BATCH;
-  const uint32_t src_width          = renderer->output_size[0];
-  const uint32_t src_height         = renderer->output_size[1];
-
-  wgpuComputePassEncoderSetPipeline(compute_pass, this->blur_pipeline);
-  wgpuComputePassEncoderSetBindGroup(
-    compute_pass, 0, this->blur_compute_constants_bindGroup, 0, NULL);
-  wgpuComputePassEncoderSetBindGroup(
-    compute_pass, 1, this->blur_compute_bind_groups[0], 0, NULL);
-  wgpuComputePassEncoderDispatchWorkgroups(
-    compute_pass,
-    (uint32_t)ceil(src_width / (float)block_dim), // workgroupCountX
-    (uint32_t)ceil(src_height / (float)batch[1]), // workgroupCountY
-    1                                             // workgroupCountZ
-  );
-  wgpuComputePassEncoderSetBindGroup(
-    compute_pass, 1, this->blur_compute_bind_groups[1], 0, NULL);
-  wgpuComputePassEncoderDispatchWorkgroups(
-    compute_pass,
-    (uint32_t)ceil(src_height / (float)block_dim), // workgroupCountX
-    (uint32_t)ceil(src_width / (float)batch[1]),   // workgroupCountY
-    1                                              // workgroupCountZ
-  );
-  for (uint32_t i = 0; i < BLOOM_PASS_ITERATIONS - 1; ++i) {
-    wgpuComputePassEncoderSetBindGroup(
-      compute_pass, 1, this->blur_compute_bind_groups[2], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      compute_pass,
-      (uint32_t)ceil(src_width / (float)block_dim), // workgroupCountX
-      (uint32_t)ceil(src_height / (float)batch[1]), // workgroupCountY
-      1                                             // workgroupCountZ
-    );
-    wgpuComputePassEncoderSetBindGroup(
-      compute_pass, 1, this->blur_compute_bind_groups[1], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      compute_pass,
-      (uint32_t)ceil(src_height / (float)block_dim), // workgroupCountX
-      (uint32_t)ceil(src_width / (float)batch[1]),   // workgroupCountY
-      1                                              // workgroupCountZ
-    );
-  }
+  wgpu_bloom_encode(this->bloom, cmd_enc, this->bloom_texture.view);
 }
 
 static void bloom_pass_render(bloom_pass_t* this,
@@ -5197,6 +6498,17 @@ static void bloom_pass_render(bloom_pass_t* this,
   wgpuRenderPassEncoderDrawIndexed(render_pass, 6, 1, 0, 0, 0);
 }
 
+/* Adds the filtered bloom to the frame buffer */
+static void bloom_pass_composite(bloom_pass_t* this,
+                                 WGPURenderPassEncoder render_pass)
+{
+  if (!bloom_pass_is_ready(this)) {
+    return;
+  }
+
+  wgpu_bloom_composite(this->bloom, render_pass);
+}
+
 /* -------------------------------------------------------------------------- *
  * Deffered Pass
  *
@@ -5206,9 +6518,13 @@ static void bloom_pass_render(bloom_pass_t* this,
 
 typedef struct {
   webgpu_renderer_t* renderer;
+  /* Into the frame buffer and into the copy pass of the bloom, both are
+   * created for switching the bloom with the quality level */
   effect_t effect;
+  effect_t bloom_effect;
 
   point_lights_t point_lights;
+  point_light_shadows_t point_light_shadows;
   spot_light_t spot_light;
 
   struct {
@@ -5237,7 +6553,8 @@ typedef struct {
 static bool deferred_pass_is_ready(deferred_pass_t* this)
 {
   return point_lights_is_ready(&this->point_lights)
-         && (this->effect.render_pipeline != NULL);
+         && (this->effect.render_pipeline != NULL)
+         && (this->bloom_effect.render_pipeline != NULL);
 }
 
 static void deferred_pass_init_defaults(deferred_pass_t* this)
@@ -5259,6 +6576,8 @@ static void deferred_pass_create(deferred_pass_t* this,
 
   /* Point light */
   point_lights_create(&this->point_lights, renderer);
+  point_light_shadows_create(&this->point_light_shadows, renderer,
+                             &this->point_lights);
 
   /* Spot light */
   ispot_light_t ispot_light = {
@@ -5440,17 +6759,19 @@ static void deferred_pass_create(deferred_pass_t* this,
 
   /* Initialize effect */
   {
-    WGPUBindGroupLayout bind_group_layouts[4] = {
+    WGPUBindGroupLayout bind_group_layouts[5] = {
       this->bind_group_layout,
       this->renderer->bind_group_layouts.frame,
       this->spot_light.bind_group_layouts.ubos,
       this->spot_light.bind_group_layouts.depth_texture,
+      this->point_light_shadows.bind_group_layouts.lookup,
     };
-    WGPUBindGroup bind_groups[4] = {
+    WGPUBindGroup bind_groups[5] = {
       this->bind_group,
       this->renderer->bind_groups.frame,
       this->spot_light.bind_groups.ubos,
       this->spot_light.bind_groups.depth_texture,
+      this->point_light_shadows.bind_groups.lookup,
     };
     iscreen_effect_t screen_effect = {
       .fragment_shader_file
@@ -5459,12 +6780,13 @@ static void deferred_pass_create(deferred_pass_t* this,
       .bind_group_layouts.item_count = (uint32_t)ARRAY_SIZE(bind_group_layouts),
       .bind_groups.items             = bind_groups,
       .bind_groups.item_count        = (uint32_t)ARRAY_SIZE(bind_groups),
-      .presentation_format = settings_get_quality_level().bloom_toggle ?
-                               WGPUTextureFormat_RGBA16Float :
-                               WGPUTextureFormat_BGRA8Unorm,
-      .label               = "deferred pass effect",
+      .presentation_format           = WGPUTextureFormat_BGRA8Unorm,
+      .label                         = "deferred pass effect",
     };
     effect_create(&this->effect, renderer, &screen_effect);
+    screen_effect.presentation_format = WGPUTextureFormat_RGBA16Float;
+    screen_effect.label               = "deferred pass bloom effect";
+    effect_create(&this->bloom_effect, renderer, &screen_effect);
   }
 
   /* Frame buffer Color attachments */
@@ -5519,7 +6841,9 @@ static void deferred_pass_create(deferred_pass_t* this,
 static void deferred_pass_destroy(deferred_pass_t* this)
 {
   effect_destroy(&this->effect);
+  effect_destroy(&this->bloom_effect);
   point_lights_destroy(&this->point_lights);
+  point_light_shadows_destroy(&this->point_light_shadows);
   spot_light_destroy(&this->spot_light);
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, this->bind_group_layout)
@@ -5574,13 +6898,13 @@ static void deferred_pass_update_lights_sim(deferred_pass_t* this,
 }
 
 static void deferred_pass_render(deferred_pass_t* this,
-                                 WGPURenderPassEncoder render_pass)
+                                 WGPURenderPassEncoder render_pass, bool bloom)
 {
   if (!deferred_pass_is_ready(this)) {
     return;
   }
 
-  effect_pre_render(&this->effect, render_pass);
+  effect_pre_render(bloom ? &this->bloom_effect : &this->effect, render_pass);
   wgpuRenderPassEncoderSetBindGroup(render_pass, 1,
                                     this->renderer->bind_groups.frame, 0, NULL);
   wgpuRenderPassEncoderDrawIndexed(render_pass, 6, 1, 0, 0, 0);
@@ -5617,7 +6941,7 @@ static void result_pass_init_defaults(result_pass_t* this)
 }
 
 static void result_pass_create(result_pass_t* this, webgpu_renderer_t* renderer,
-                               copy_pass_t* copy_pass, bloom_pass_t* bloom_pass)
+                               copy_pass_t* copy_pass)
 {
   result_pass_init_defaults(this);
 
@@ -5696,9 +7020,9 @@ static void result_pass_create(result_pass_t* this, webgpu_renderer_t* renderer,
       .textureView = copy_pass->copy_texture.view,
     },
     [1] = (WGPUBindGroupEntry) {
+      // The bloom is added by the composite of the bloom pass
       .binding     = 1,
-      .textureView = bloom_pass ? bloom_pass->blur_textures[1].view
-                                  : this->empty_texture.view,
+      .textureView = this->empty_texture.view,
     },
   };
   this->bind_group = wgpuDeviceCreateBindGroup(
@@ -5780,6 +7104,8 @@ static struct {
   float last_frame_time;     // has seconds unit
   float dt;                  // has seconds unit
   float rearrange_countdown; // has seconds unit
+  // Compute tasks submitted ahead of the render passes
+  wgpu_compute_scheduler_t* compute_scheduler;
 } example_state = {
   .last_frame_time     = 0.0f,
   .dt                  = 0.0f,
@@ -5790,12 +7116,122 @@ static struct {
 static const char* example_title = "Compute Metaballs";
 static bool prepared             = false;
 
+/* Automatic quality (--metaballs-auto-quality): the level follows the GPU
+ * frame time measured by the profiler, the sum of its outermost scopes,
+ * averaged over AUTO_QUALITY_SAMPLE_FRAMES frames. The level is lowered when
+ * the average exceeds the target and raised when it stays below
+ * AUTO_QUALITY_RAISE_RATIO of the target, after a lowering only once
+ * AUTO_QUALITY_RETRY_FRAMES frames have passed. The gap and the delay keep the
+ * level from oscillating. */
+#define AUTO_QUALITY_SAMPLE_FRAMES 30u
+#define AUTO_QUALITY_RAISE_RATIO 0.6f
+#define AUTO_QUALITY_RETRY_FRAMES 600u
+
+static struct {
+  bool enabled;
+  float target_frame_time_ms;
+  uint32_t frame_counter; /* frames since the last level change */
+  uint32_t retry_countdown;
+  float frame_time_sum;
+  uint32_t sample_count;
+  float frame_time_ms; /* average the level was last checked with */
+} auto_quality = {
+  .enabled              = false,
+  .target_frame_time_ms = 1000.0f / 60.0f,
+};
+
 static void example_rearrange()
 {
   deferred_pass_rearrange(&example_state.deferred_pass);
   metaballs_rearrange(&example_state.metaballs);
 }
 
+/* Volume of the grid resolution, the volume keeps its extent */
+static ivolume_settings_t example_volume_settings(float resolution)
+{
+  return (ivolume_settings_t){
+    .x_min = -3.0f,
+    .y_min = -3.0f,
+    .z_min = -3.0f,
+
+    .width  = (uint32_t)(100 * resolution),
+    .height = (uint32_t)(100 * resolution),
+    .depth  = (uint32_t)(80 * resolution),
+
+    .x_step = 0.075f / resolution,
+    .y_step = 0.075f / resolution,
+    .z_step = 0.075f / resolution,
+
+    .iso_level = 20.0f,
+  };
+}
+
+/* Switches the quality level without recreating resources: the bloom pass,
+ * both deferred pass targets and the buffers of the finest grid exist for
+ * all levels. The shadow map resolution and the output scale are the same
+ * for all levels and set at startup. */
+static void example_set_quality(quality_settings_enum quality)
+{
+  settings_set_quality(quality);
+  const quality_option_t level = settings_get_quality_level();
+  point_lights_set_lights_count(&example_state.deferred_pass.point_lights,
+                                level.point_lights_count);
+  example_state.volume = example_volume_settings(level.volume_resolution);
+  metaballs_set_volume(&example_state.metaballs, &example_state.volume);
+
+  auto_quality.frame_counter  = 0;
+  auto_quality.frame_time_sum = 0.0f;
+  auto_quality.sample_count   = 0;
+}
+
+static void auto_quality_update(wgpu_profiler_t* profiler)
+{
+  if (!auto_quality.enabled || profiler == NULL) {
+    return;
+  }
+  if (auto_quality.retry_countdown > 0) {
+    --auto_quality.retry_countdown;
+  }
+
+  // The results of the frames in flight were rendered at the previous level
+  if (++auto_quality.frame_counter <= WGPU_PROFILER_FRAME_COUNT) {
+    return;
+  }
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  const uint32_t scope_count = wgpu_profiler_get_scope_count(profiler);
+  float gpu_time_ms          = 0.0f;
+  for (uint32_t i = 0; i < scope_count; ++i) {
+    if (scopes[i].depth == 0) {
+      gpu_time_ms += scopes[i].gpu_time_ms;
+    }
+  }
+  if (gpu_time_ms <= 0.0f) {
+    return;
+  }
+  auto_quality.frame_time_sum += gpu_time_ms;
+  if (++auto_quality.sample_count < AUTO_QUALITY_SAMPLE_FRAMES) {
+    return;
+  }
+  auto_quality.frame_time_ms
+    = auto_quality.frame_time_sum / (float)auto_quality.sample_count;
+  auto_quality.frame_time_sum = 0.0f;
+  auto_quality.sample_count   = 0;
+
+  const quality_settings_enum quality = settings_get_quality();
+  const float target_ms               = auto_quality.target_frame_time_ms;
+  if (auto_quality.frame_time_ms > target_ms
+      && quality > QualitySettings_Low) {
+    example_set_quality((quality_settings_enum)(quality - 1));
+    auto_quality.retry_countdown = AUTO_QUALITY_RETRY_FRAMES;
+  }
+  else if (auto_quality.frame_time_ms < target_ms * AUTO_QUALITY_RAISE_RATIO
+           && quality < QualitySettings_High
+           && auto_quality.retry_countdown == 0) {
+    example_set_quality((quality_settings_enum)(quality + 1));
+  }
+}
+
 static void init_example_state(wgpu_context_t* wgpu_context)
 {
   const uint32_t inner_width  = wgpu_context->surface.width;
@@ -5848,22 +7284,12 @@ static void init_example_state(wgpu_context_t* wgpu_context)
   wgpu_queue_write_buffer(wgpu_context, renderer->ubos.view_ubo.buffer, 0,
                           view_ubo, sizeof(*view_ubo));
 
-  /* Volume settings */
-  example_state.volume = (ivolume_settings_t){
-    .x_min = -3.0f,
-    .y_min = -3.0f,
-    .z_min = -3.0f,
-
-    .width  = 100,
-    .height = 100,
-    .depth  = 80,
-
-    .x_step = 0.075f,
-    .y_step = 0.075f,
-    .z_step = 0.075f,
-
-    .iso_level = 20.0f,
-  };
+  /* Volume settings, the grid resolution scales with the quality level. The
+   * metaballs buffers are created for the finest grid of the levels. */
+  example_state.volume = example_volume_settings(
+    settings_get_quality_level().volume_resolution);
+  ivolume_settings_t max_volume
+    = example_volume_settings(settings_get_max_volume_resolution());
 
   /* Deferred pass, copy pass, bloom pass & result pass */
   deferred_pass_t* deferred_pass = &example_state.deferred_pass;
@@ -5871,18 +7297,16 @@ static void init_example_state(wgpu_context_t* wgpu_context)
   copy_pass_t* copy_pass = &example_state.copy_pass;
   copy_pass_create(copy_pass, renderer);
 
-  bloom_pass_t* bloom_pass = NULL;
-  if (settings_get_quality_level().bloom_toggle) {
-    bloom_pass = &example_state.bloom_pass;
-    bloom_pass_create(bloom_pass, renderer, copy_pass);
-  }
+  bloom_pass_t* bloom_pass = &example_state.bloom_pass;
+  bloom_pass_create(bloom_pass, renderer, copy_pass);
 
   result_pass_t* result_pass = &example_state.result_pass;
-  result_pass_create(result_pass, renderer, copy_pass, bloom_pass);
+  result_pass_create(result_pass, renderer, copy_pass);
 
   /* Metaballs, ground, box outline & particles */
-  metaballs_create(&example_state.metaballs, renderer, &example_state.volume,
+  metaballs_create(&example_state.metaballs, renderer, &max_volume,
                    &deferred_pass->spot_light);
+  metaballs_set_volume(&example_state.metaballs, &example_state.volume);
   ground_create(&example_state.ground, renderer, &deferred_pass->spot_light);
   box_outline_create(&example_state.box_outline, renderer);
   particles_create(&example_state.particles, renderer,
@@ -5933,8 +7357,6 @@ static void suppress_unused_functions()
 {
   UNUSED_VAR(SHADOW_MAP_SIZE);
 
-  UNUSED_FUNCTION(settings_get_quality);
-  UNUSED_FUNCTION(settings_set_quality);
   UNUSED_FUNCTION(orthographic_camera_set_position);
   UNUSED_FUNCTION(orthographic_camera_look_at);
   UNUSED_FUNCTION(orthographic_camera_init);
@@ -5954,6 +7376,8 @@ static int example_initialize(wgpu_example_context_t* context)
   if (context) {
     suppress_unused_functions();
     init_example_state(context->wgpu_context);
+    example_state.compute_scheduler
+      = wgpu_compute_scheduler_create(context->wgpu_context);
     prepared = true;
     return 0;
   }
@@ -5964,6 +7388,20 @@ static int example_initialize(wgpu_example_context_t* context)
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
+    int32_t quality = (int32_t)settings_get_quality();
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Quality", &quality,
+                                QUALITY_NAMES,
+                                (uint32_t)ARRAY_SIZE(QUALITY_NAMES))) {
+      example_set_quality((quality_settings_enum)quality);
+    }
+    imgui_overlay_checkBox(context->imgui_overlay, "Auto Quality",
+                           &auto_quality.enabled);
+    if (auto_quality.enabled) {
+      imgui_overlay_slider_float(context->imgui_overlay,
+                                 "Target GPU Time (ms)",
+                                 &auto_quality.target_frame_time_ms, 4.0f,
+                                 33.3f);
+    }
     if (imgui_overlay_slider_int(
           context->imgui_overlay, "Point Lights Count",
           &example_state.deferred_pass.point_lights.lights_count, 0,
@@ -5972,7 +7410,85 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
         &example_state.deferred_pass.point_lights,
         example_state.deferred_pass.point_lights.lights_count);
     }
+    point_light_shadows_t* point_light_shadows
+      = &example_state.deferred_pass.point_light_shadows;
+    bool shadows_enabled = point_light_shadows->enabled;
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Point Light Shadows",
+                               &shadows_enabled)) {
+      point_light_shadows_set_enabled(point_light_shadows, shadows_enabled);
+    }
+    int32_t metaballs_count = (int32_t)settings_get_metaballs_count();
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Metaballs Count",
+                                 &metaballs_count, 1, MAX_METABALLS)) {
+      settings_set_metaballs_count((uint32_t)metaballs_count);
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    const metaballs_compute_t* compute
+      = &example_state.metaballs.metaballs_compute;
+    imgui_overlay_text(
+      "Volume: %s, %.1f MB",
+      compute->volume_precision == Shader_StoragePrecision_F16 ? "f16" : "f32",
+      (double)compute->volume_buffer.size / (1024.0 * 1024.0));
+    if (example_state.deferred_pass.point_light_shadows.enabled) {
+      imgui_overlay_text(
+        "Shadowed point lights: %u",
+        example_state.deferred_pass.point_light_shadows.lights_count);
+    }
+    if (auto_quality.enabled && auto_quality.frame_time_ms > 0.0f) {
+      imgui_overlay_text("GPU time: %.2f ms (target %.2f ms)",
+                         (double)auto_quality.frame_time_ms,
+                         (double)auto_quality.target_frame_time_ms);
+    }
+  }
+}
+
+/* Extract the isosurface of the metaballs */
+static void record_build_surface(WGPUCommandEncoder cmd_enc, void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  metaballs_build_surface(&example_state.metaballs, cmd_enc);
+}
+
+static void record_lights_sim(WGPUComputePassEncoder compute_pass,
+                              void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  deferred_pass_update_lights_sim(&example_state.deferred_pass, compute_pass,
+                                  example_state.last_frame_time,
+                                  example_state.dt);
+}
+
+/* The compute tasks touch disjoint resources and share the first level,
+ * the render passes of the frame read their results */
+static void submit_compute_tasks(void)
+{
+  /* Update the metaballs */
+  if (settings_get_quality_level().update_metaballs) {
+    metaballs_update_sim(&example_state.metaballs,
+                         example_state.last_frame_time, example_state.dt);
+  }
+  else {
+    if (!metaballs_has_updated_at_least_once(&example_state.metaballs)) {
+      metaballs_update_sim(&example_state.metaballs,
+                           example_state.last_frame_time, example_state.dt);
+    }
   }
+
+  wgpu_compute_scheduler_t* scheduler = example_state.compute_scheduler;
+  wgpu_compute_scheduler_add_task(scheduler,
+                                  &(wgpu_compute_task_desc_t){
+                                    .label        = "Metaballs surface",
+                                    .encoder_func = record_build_surface,
+                                  });
+  wgpu_compute_scheduler_add_task(scheduler,
+                                  &(wgpu_compute_task_desc_t){
+                                    .label     = "Lights simulation",
+                                    .pass_func = record_lights_sim,
+                                  });
+  wgpu_compute_scheduler_submit(scheduler);
 }
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
@@ -5982,31 +7498,8 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-
-  /* Run compute shaders */
-  {
-    WGPUComputePassEncoder compute_pass
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    if (settings_get_quality_level().update_metaballs) {
-      metaballs_update_sim(&example_state.metaballs, compute_pass,
-                           example_state.last_frame_time, example_state.dt);
-    }
-    else {
-      if (!metaballs_has_updated_at_least_once(&example_state.metaballs)) {
-        metaballs_update_sim(&example_state.metaballs, compute_pass,
-                             example_state.last_frame_time, example_state.dt);
-      }
-    }
-
-    deferred_pass_update_lights_sim(&example_state.deferred_pass, compute_pass,
-                                    example_state.last_frame_time,
-                                    example_state.dt);
-    if (settings_get_quality_level().bloom_toggle) {
-      bloom_pass_update_bloom(&example_state.bloom_pass, compute_pass);
-    }
-    wgpuComputePassEncoderEnd(compute_pass);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, compute_pass)
-  }
+  wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                            "Render");
 
   /* Render scene from spot light POV */
   {
@@ -6022,16 +7515,27 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, spot_light_shadow_pass)
   }
 
+  /* Render the metaballs into the faces of the updated point lights */
+  point_light_shadows_render(&example_state.deferred_pass.point_light_shadows,
+                             wgpu_context->cmd_enc,
+                             &example_state.metaballs.metaballs_compute);
+
   /* Deferred pass */
   {
     example_state.deferred_pass.framebuffer.descriptor.label = "gbuffer";
     WGPURenderPassEncoder g_buffer_pass = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc,
       &example_state.deferred_pass.framebuffer.descriptor);
+    wgpu_pipeline_statistics_begin_render_pass(
+      wgpu_context->pipeline_statistics, g_buffer_pass, "G-Buffer");
     metaballs_render(&example_state.metaballs, g_buffer_pass);
     box_outline_render(&example_state.box_outline, g_buffer_pass);
     ground_render(&example_state.ground, g_buffer_pass);
-    particles_render(&example_state.particles, g_buffer_pass);
+    particles_render(
+      &example_state.particles, g_buffer_pass,
+      (uint32_t)example_state.deferred_pass.point_lights.lights_count);
+    wgpu_pipeline_statistics_end_render_pass(wgpu_context->pipeline_statistics,
+                                             g_buffer_pass);
     wgpuRenderPassEncoderEnd(g_buffer_pass);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, g_buffer_pass)
   }
@@ -6045,7 +7549,8 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
         = wgpuCommandEncoderBeginRenderPass(
           wgpu_context->cmd_enc,
           &example_state.copy_pass.framebuffer.descriptor);
-      deferred_pass_render(&example_state.deferred_pass, copy_render_pass);
+      deferred_pass_render(&example_state.deferred_pass, copy_render_pass,
+                           true);
       wgpuRenderPassEncoderEnd(copy_render_pass);
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, copy_render_pass)
     }
@@ -6062,6 +7567,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, bloom_render_pass)
     }
 
+    /* Bloom mip chain */
+    bloom_pass_update_bloom(&example_state.bloom_pass, wgpu_context->cmd_enc);
+
     /* Final composite pass */
     {
       example_state.renderer.framebuffer.descriptor.label
@@ -6069,6 +7577,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       WGPURenderPassEncoder render_pass = wgpuCommandEncoderBeginRenderPass(
         wgpu_context->cmd_enc, &example_state.renderer.framebuffer.descriptor);
       result_pass_render(&example_state.result_pass, render_pass);
+      bloom_pass_composite(&example_state.bloom_pass, render_pass);
       wgpuRenderPassEncoderEnd(render_pass);
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, render_pass)
     }
@@ -6080,11 +7589,12 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
         = "draw default framebuffer";
       WGPURenderPassEncoder render_pass = wgpuCommandEncoderBeginRenderPass(
         wgpu_context->cmd_enc, &example_state.renderer.framebuffer.descriptor);
-      deferred_pass_render(&example_state.deferred_pass, render_pass);
+      deferred_pass_render(&example_state.deferred_pass, render_pass, false);
       wgpuRenderPassEncoderEnd(render_pass);
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, render_pass)
     }
   }
+  wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
 
   // Draw ui overlay
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -6100,6 +7610,12 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
 static int example_draw(wgpu_example_context_t* context)
 {
+  // Quality level of the frame
+  auto_quality_update(context->wgpu_context->profiler);
+
+  // Metaballs and lights compute work
+  submit_compute_tasks();
+
   // Prepare frame
   prepare_frame(context);
 
@@ -6139,18 +7655,84 @@ static void example_destroy(wgpu_example_context_t* context)
   webgpu_renderer_destroy(&example_state.renderer);
   deferred_pass_destroy(&example_state.deferred_pass);
   copy_pass_destroy(&example_state.copy_pass);
-  if (settings_get_quality_level().bloom_toggle) {
-    bloom_pass_destroy(&example_state.bloom_pass);
-  }
+  bloom_pass_destroy(&example_state.bloom_pass);
   result_pass_destroy(&example_state.result_pass);
   metaballs_destroy(&example_state.metaballs);
   ground_destroy(&example_state.ground);
   box_outline_destroy(&example_state.box_outline);
   particles_destroy(&example_state.particles);
+  wgpu_compute_scheduler_destroy(example_state.compute_scheduler);
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[3]   = {"--metaballs-quality=", "--metaballs-count=",
+                           "--metaballs-target-frame-time="};
+  char* filters_flag[3] = {"--metaballs-f32-volume",
+                           "--metaballs-auto-quality",
+                           "--help-compute-metaballs"};
+  char* filtered_argv[1 + 3 + 3 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  int32_t quality    = (int32_t)settings_get_quality();
+  int32_t ball_count = (int32_t)settings_get_metaballs_count();
+  int f32_volume     = 0;
+  int auto_level     = 0;
+  float target_ms    = auto_quality.target_frame_time_ms;
+
+  struct argparse_option options[] = {
+    OPT_INTEGER(0, "metaballs-quality", &quality,
+                "quality level, 0 = low, 1 = medium, 2 = high (finer "
+                "marching cubes grid)",
+                NULL, 0, 0),
+    OPT_INTEGER(0, "metaballs-count", &ball_count,
+                "number of metaballs, 1 to 4096 (default 256)", NULL, 0, 0),
+    OPT_BOOLEAN(0, "metaballs-f32-volume", &f32_volume,
+                "store the field volume in f32 instead of f16, for comparing "
+                "both precisions with --benchmark",
+                NULL, 0, 0),
+    OPT_BOOLEAN(0, "metaballs-auto-quality", &auto_level,
+                "adjust the quality level to the GPU frame time", NULL, 0, 0),
+    OPT_FLOAT(0, "metaballs-target-frame-time", &target_ms,
+              "GPU frame time in milliseconds the automatic quality aims for "
+              "(default 16.7)",
+              NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-compute-metaballs", NULL,
+                "show the compute metaballs options", argparse_help_cb_no_exit,
+                0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  settings_set_quality((quality_settings_enum)CLAMP(
+    quality, (int32_t)QualitySettings_Low, (int32_t)QualitySettings_High));
+  settings_set_metaballs_count((uint32_t)MAX(ball_count, 1));
+  settings_set_volume_precision(f32_volume ? Shader_StoragePrecision_F32 :
+                                             Shader_StoragePrecision_F16);
+  auto_quality.enabled              = auto_level != 0;
+  auto_quality.target_frame_time_ms = CLAMP(target_ms, 4.0f, 33.3f);
 }
 
 void example_compute_metaballs(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
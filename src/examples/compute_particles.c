@@ -4,12 +4,14 @@
 #include <string.h>
 
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/particle_system.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Shader Particle System
  *
- * Attraction based 2D GPU particle system using compute shaders. Particle data
- * is stored in a shader storage buffer.
+ * Attraction based 2D GPU particle system using compute shaders. The particles
+ * are emitted and simulated by the shared GPU particle system, the behavior
+ * below ports the attraction and repulsion of the original compute shader.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/computeparticles/computeparticles.cpp
@@ -38,20 +40,17 @@ static struct {
 
 // Resources for the compute part of the example
 static struct {
-  wgpu_buffer_t storage_buffer; // (Shader) storage buffer object containing the
-                                // particles
   wgpu_buffer_t uniform_buffer; // Uniform buffer object containing particle
                                 // system parameters
-  WGPUBindGroupLayout bind_group_layout; // Compute shader binding layout
-  WGPUBindGroup bind_group;              // Compute shader bindings
-  WGPUPipelineLayout pipeline_layout;    // Layout of the compute pipeline
-  WGPUComputePipeline pipeline; // Compute pipeline for updating particle
-                                // positions
-  struct compute_ubo_t {        // Compute shader uniform block object
-    float delta_t;              // Frame delta time
-    float dest_x;               // x position of the attractor
-    float dest_y;               // y position of the attractor
-    int32_t particle_count;
+  WGPUBindGroupLayout bind_group_layout; // Particle behavior binding layout
+  WGPUBindGroup bind_group;              // Particle behavior bindings
+  // Particle pool emitting and updating the particles
+  wgpu_particle_system_t* particle_system;
+  struct compute_ubo_t { // Compute shader uniform block object
+    float delta_t;       // Frame delta time
+    float dest_x;        // x position of the attractor
+    float dest_y;        // y position of the attractor
+    float padding;
   } ubo;
 } compute;
 
@@ -61,13 +60,77 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } render_pass;
 
-// SSBO particle declaration
+// SSBO particle declaration, matches the WGSL Particle struct
 typedef struct particle_t {
   vec2 pos;          // Particle position
   vec2 vel;          // Particle velocity
   vec4 gradient_pos; // Texture coordinates for the gradient ramp map
 } particle_t;
 
+// Particle behavior of the particle system
+// clang-format off
+static const char* particle_behavior_wgsl = CODE(
+  struct Particle {
+    pos          : vec2<f32>,
+    vel          : vec2<f32>,
+    gradient_pos : vec4<f32>,
+  }
+
+  struct Params {
+    delta_t : f32,
+    dest_x  : f32,
+    dest_y  : f32,
+  }
+
+  @group(1) @binding(0) var<uniform> ubo : Params;
+
+  fn attraction(pos : vec2<f32>, attract_pos : vec2<f32>) -> vec2<f32> {
+    let delta    = attract_pos - pos;
+    let damp     = 0.5;
+    let inv_dist = 1.0 / sqrt(dot(delta, delta) + damp);
+    return delta * inv_dist * inv_dist * inv_dist * 0.0035;
+  }
+
+  fn repulsion(pos : vec2<f32>, attract_pos : vec2<f32>) -> vec2<f32> {
+    let delta           = attract_pos - pos;
+    let target_distance = sqrt(dot(delta, delta));
+    let inv_dist        = 1.0 / target_distance;
+    return delta * inv_dist * inv_dist * inv_dist * -0.000035;
+  }
+
+  fn particle_emit(index : u32) -> Particle {
+    var particle : Particle;
+    particle.pos = vec2<f32>(particle_random(index, 0u),
+                             particle_random(index, 1u)) * 2.0 - 1.0;
+    particle.vel = vec2<f32>(0.0);
+    particle.gradient_pos = vec4<f32>(particle.pos.x * 0.5, 0.0, 0.0, 0.0);
+    return particle;
+  }
+
+  // The particles never die
+  fn particle_update(particle : ptr<function, Particle>) -> bool {
+    let dest_pos = vec2<f32>(ubo.dest_x, ubo.dest_y);
+    var vel = (*particle).vel + repulsion((*particle).pos, dest_pos) * 0.05;
+
+    // Move by velocity, collide with the boundary
+    let pos = (*particle).pos + vel * ubo.delta_t;
+    if (any(abs(pos) > vec2<f32>(1.0))) {
+      vel = (-vel * 0.1) + attraction(pos, dest_pos) * 12.0;
+    }
+    else {
+      (*particle).pos = pos;
+    }
+    (*particle).vel = vel;
+
+    (*particle).gradient_pos.x += 0.02 * ubo.delta_t;
+    if ((*particle).gradient_pos.x > 1.0) {
+      (*particle).gradient_pos.x -= 1.0;
+    }
+    return true;
+  }
+);
+// clang-format on
+
 // Other variables
 static const char* example_title = "Compute Shader Particle System";
 static bool prepared             = false;
@@ -80,34 +143,6 @@ static void load_assets(wgpu_context_t* wgpu_context)
     wgpu_context, "textures/particle_gradient_rgba.ktx", NULL);
 }
 
-// Setup and fill the compute shader storage buffers containing the particles
-static void prepare_storage_buffers(wgpu_context_t* wgpu_context)
-{
-  // Initial particle positions
-  static particle_t particle_buffer[PARTICLE_COUNT] = {0};
-  for (uint32_t i = 0; i < (uint32_t)PARTICLE_COUNT; ++i) {
-    particle_buffer[i] = (particle_t){
-      .pos = {
-        random_float_min_max(-1.0f, 1.0f), // x
-        random_float_min_max(-1.0f, 1.0f)  // y
-       },
-      .vel = GLM_VEC2_ZERO_INIT,
-      .gradient_pos = GLM_VEC4_ZERO_INIT,
-    };
-    particle_buffer[i].gradient_pos[0] = particle_buffer[i].pos[0] / 2.0f;
-  }
-
-  // Staging
-  // SSBO won't be changed on the host after upload
-  compute.storage_buffer = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex
-                             | WGPUBufferUsage_Storage,
-                    .size         = PARTICLE_COUNT * sizeof(particle_t),
-                    .initial.data = particle_buffer,
-                  });
-}
-
 static void update_uniform_buffers(wgpu_example_context_t* context)
 {
   wgpu_context_t* wgpu_context = context->wgpu_context;
@@ -138,9 +173,6 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
 // Prepare and initialize uniform buffer containing shader uniforms
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
-  // Initialize the uniform buffer block
-  compute.ubo.particle_count = PARTICLE_COUNT;
-
   // Compute shader uniform buffer block
   compute.uniform_buffer = wgpu_create_buffer(
     context->wgpu_context,
@@ -366,7 +398,6 @@ static void prepare_graphics(wgpu_example_context_t* context)
 {
   wgpu_context_t* wgpu_context = context->wgpu_context;
 
-  prepare_storage_buffers(wgpu_context);
   prepare_uniform_buffers(context);
   setup_pipeline_layout(wgpu_context);
   prepare_pipelines(wgpu_context);
@@ -376,28 +407,18 @@ static void prepare_graphics(wgpu_example_context_t* context)
 
 static void prepare_compute(wgpu_context_t* wgpu_context)
 {
-  /* Compute pipeline layout */
-  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+  /* Particle behavior bind group layout */
+  WGPUBindGroupLayoutEntry bgl_entries[1] = {
     [0] = (WGPUBindGroupLayoutEntry) {
-      // Binding 0 : Particle position storage buffer
+      // Binding 0 : Uniform buffer
       .binding    = 0,
       .visibility = WGPUShaderStage_Compute,
-      .buffer = (WGPUBufferBindingLayout) {
-        .type           = WGPUBufferBindingType_Storage,
-        .minBindingSize = PARTICLE_COUNT * sizeof(particle_t),
-      },
-      .sampler = {0},
-    },
-    [1] = (WGPUBindGroupLayoutEntry) {
-      // Binding 1 : Uniform buffer
-      .binding    = 1,
-      .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type           = WGPUBufferBindingType_Uniform,
         .minBindingSize = sizeof(compute.ubo),
       },
       .sampler = {0},
-    }
+    },
   };
   WGPUBindGroupLayoutDescriptor bgl_desc = {
     .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
@@ -407,25 +428,11 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
     = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
   ASSERT(compute.bind_group_layout != NULL)
 
-  WGPUPipelineLayoutDescriptor compute_pipeline_layout_desc = {
-    .bindGroupLayoutCount = 1,
-    .bindGroupLayouts     = &compute.bind_group_layout,
-  };
-  compute.pipeline_layout = wgpuDeviceCreatePipelineLayout(
-    wgpu_context->device, &compute_pipeline_layout_desc);
-  ASSERT(compute.pipeline_layout != NULL)
-
-  /* Compute pipeline bind group */
-  WGPUBindGroupEntry bg_entries[2] = {
+  /* Particle behavior bind group */
+  WGPUBindGroupEntry bg_entries[1] = {
     [0] = (WGPUBindGroupEntry) {
-      // Binding 0 : Particle position storage buffer
+     // Binding 0 : Uniform buffer
       .binding = 0,
-      .buffer  = compute.storage_buffer.buffer,
-      .size    = compute.storage_buffer.size,
-    },
-    [1] = (WGPUBindGroupEntry) {
-     // Binding 1 : Uniform buffer
-      .binding = 1,
       .buffer  = compute.uniform_buffer.buffer,
       .offset  = 0,
       .size    = compute.uniform_buffer.size,
@@ -438,24 +445,18 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
   };
   compute.bind_group
     = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-
-  /* Compute shader */
-  wgpu_shader_t particle_comp_shader = wgpu_shader_create(
-    wgpu_context, &(wgpu_shader_desc_t){
-                    // Compute shader SPIR-V
-                    .file = "shaders/compute_particles/particle.comp.spv",
+  ASSERT(compute.bind_group != NULL)
+
+  /* Particle system, all particles are emitted in the first frame */
+  compute.particle_system = wgpu_particle_system_create(
+    wgpu_context, &(wgpu_particle_system_desc_t){
+                    .label             = "compute_particles",
+                    .capacity          = PARTICLE_COUNT,
+                    .particle_size     = sizeof(particle_t),
+                    .wgsl_code         = particle_behavior_wgsl,
+                    .bind_group_layout = compute.bind_group_layout,
+                    .bind_group        = compute.bind_group,
                   });
-
-  /* Create pipeline */
-  compute.pipeline = wgpuDeviceCreateComputePipeline(
-    wgpu_context->device,
-    &(WGPUComputePipelineDescriptor){
-      .layout  = compute.pipeline_layout,
-      .compute = particle_comp_shader.programmable_stage_descriptor,
-    });
-
-  /* Partial clean-up */
-  wgpu_shader_release(&particle_comp_shader);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -487,33 +488,24 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Compute pass: Compute particle movement
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    // Dispatch the compute job
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute.pipeline);
-    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
-                                       compute.bind_group, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
-                                             PARTICLE_COUNT / 256, 1, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
+  // Compute pass: Emit the particles and compute the particle movement
+  wgpu_particle_system_update(compute.particle_system, wgpu_context->cmd_enc,
+                              PARTICLE_COUNT);
 
-  // Render pass: Draw the particle system using the update vertex buffer
+  // Render pass: Draw the live particles of the particle system
   {
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc, &render_pass.descriptor);
+    wgpu_pipeline_statistics_begin_render_pass(
+      wgpu_context->pipeline_statistics, wgpu_context->rpass_enc, "Particles");
     wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
                                      graphics.pipeline);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
                                       graphics.bind_group, 0, 0);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                         compute.storage_buffer.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, PARTICLE_COUNT, 1, 0, 0);
+    wgpu_particle_system_draw(compute.particle_system,
+                              wgpu_context->rpass_enc, 0);
+    wgpu_pipeline_statistics_end_render_pass(wgpu_context->pipeline_statistics,
+                                             wgpu_context->rpass_enc);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
@@ -589,12 +581,10 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(RenderPipeline, graphics.pipeline)
 
   // Compute pipeline
-  WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffer.buffer)
+  wgpu_particle_system_destroy(compute.particle_system);
   WGPU_RELEASE_RESOURCE(Buffer, compute.uniform_buffer.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, compute.bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_group)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, compute.pipeline_layout)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
 }
 
 void example_compute_particles(int argc, char* argv[])
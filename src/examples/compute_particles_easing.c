@@ -3,11 +3,15 @@
 
 #include <string.h>
 
+#include "../webgpu/particle_system.h"
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Shader Particle Easing
  *
  * Particle system using compute shaders. Particle data is stored in a shader
  * storage buffer, particle movement is implemented using easing functions.
+ * Particles die at the end of their life and are emitted again from the dead
+ * list of the shared GPU particle system.
  *
  * Ref:
  * https://redcamel.github.io/webgpu/14_compute
@@ -30,9 +34,6 @@ static struct {
 // Vertex buffer and attributes
 static struct wgpu_buffer_t vertices = {0};
 
-// Particles data
-static float initial_particle_data[PARTICLE_NUM * PROPERTY_NUM] = {0};
-
 // Resources for the graphics part of the example
 static struct {
   WGPUBindGroupLayout uniforms_bind_group_layout;
@@ -44,13 +45,139 @@ static struct {
 // Resources for the compute part of the example
 static struct {
   wgpu_buffer_t sim_param_buffer;
-  wgpu_buffer_t particle_buffer;
   WGPUBindGroupLayout bind_group_layout;
-  WGPUBindGroup particle_bind_group;
-  WGPUPipelineLayout pipeline_layout;
-  WGPUComputePipeline pipeline;
+  WGPUBindGroup sim_param_bind_group;
+  wgpu_particle_system_t* particle_system;
 } compute;
 
+/* Particle behavior of the particle system. A particle holds PROPERTY_NUM
+ * floats: start time and life, position, scale and the start value, end value
+ * and ease of x, y, z, the scales and the alpha, followed by the alpha value.
+ * The ease 0 is linear, 1.. are the in, out and in-out easings of the quad,
+ * cubic, quart, quint, sine, expo, circ, back and bounce functions. */
+// clang-format off
+static const char* particle_behavior_wgsl = CODE(
+  struct SimParams {
+    time     : f32,
+    min_life : f32,
+    max_life : f32,
+  }
+
+  struct Particle {
+    time     : vec4f,
+    position : vec4f,
+    scale    : vec4f,
+    x        : vec4f,
+    y        : vec4f,
+    z        : vec4f,
+    scale_x  : vec4f,
+    scale_y  : vec4f,
+    scale_z  : vec4f,
+    alpha    : vec4f,
+  }
+
+  @group(1) @binding(0) var<uniform> params : SimParams;
+
+  fn bounce_out(t : f32) -> f32 {
+    let n = 7.5625;
+    let d = 2.75;
+    if (t < 1.0 / d) {
+      return n * t * t;
+    }
+    if (t < 2.0 / d) {
+      let u = t - 1.5 / d;
+      return n * u * u + 0.75;
+    }
+    if (t < 2.5 / d) {
+      let u = t - 2.25 / d;
+      return n * u * u + 0.9375;
+    }
+    let u = t - 2.625 / d;
+    return n * u * u + 0.984375;
+  }
+
+  fn ease_in(family : u32, t : f32) -> f32 {
+    switch (family) {
+      case 0u: { return t * t; }
+      case 1u: { return t * t * t; }
+      case 2u: { return t * t * t * t; }
+      case 3u: { return t * t * t * t * t; }
+      case 4u: { return 1.0 - cos(t * 1.5707963); }
+      case 5u: { return select(exp2(10.0 * t - 10.0), 0.0, t <= 0.0); }
+      case 6u: { return 1.0 - sqrt(max(1.0 - t * t, 0.0)); }
+      case 7u: { return t * t * (2.70158 * t - 1.70158); }
+      default: { return 1.0 - bounce_out(1.0 - t); }
+    }
+  }
+
+  fn ease(kind : f32, t : f32) -> f32 {
+    let e = u32(kind);
+    if (e == 0u) {
+      return t;
+    }
+    let family = (e - 1u) / 3u;
+    switch ((e - 1u) % 3u) {
+      case 0u: { return ease_in(family, t); }
+      case 1u: { return 1.0 - ease_in(family, 1.0 - t); }
+      default: {
+        if (t < 0.5) {
+          return 0.5 * ease_in(family, 2.0 * t);
+        }
+        return 1.0 - 0.5 * ease_in(family, 2.0 - 2.0 * t);
+      }
+    }
+  }
+
+  fn eased(value : vec4f, t : f32) -> f32 {
+    return mix(value.x, value.y, ease(value.z, t));
+  }
+
+  fn random_end(index : u32, stream : u32) -> f32 {
+    return particle_random(index, stream) * 2.0 - 1.0;
+  }
+
+  fn random_ease(index : u32, stream : u32) -> f32 {
+    return floor(particle_random(index, stream) * 27.0);
+  }
+
+  fn particle_emit(index : u32) -> Particle {
+    var p : Particle;
+    let life = mix(params.min_life, params.max_life,
+                   particle_random(index, 0u));
+    // The first particles are spread over their life
+    var age = 0.0;
+    if (particle_system.frame == 0u) {
+      age = particle_random(index, 1u) * life;
+    }
+    p.time  = vec4f(params.time - age, life, 0.0, 0.0);
+    p.x     = vec4f(0.0, random_end(index, 2u), random_ease(index, 3u), 0.0);
+    p.y     = vec4f(0.0, random_end(index, 4u), random_ease(index, 5u), 0.0);
+    p.z     = vec4f(0.0, random_end(index, 6u), random_ease(index, 7u), 0.0);
+    let scale = vec4f(0.0, particle_random(index, 8u) * 12.0, 0.0, 0.0);
+    p.scale_x = scale;
+    p.scale_y = scale;
+    p.scale_z = scale;
+    p.alpha = vec4f(particle_random(index, 9u), 0.0, random_ease(index, 10u),
+                    0.0);
+    return p;
+  }
+
+  fn particle_update(particle : ptr<function, Particle>) -> bool {
+    let p = *particle;
+    let t = (params.time - p.time.x) / p.time.y;
+    if (t >= 1.0) {
+      return false;
+    }
+    (*particle).position = vec4f(eased(p.x, t), eased(p.y, t), eased(p.z, t),
+                                 0.0);
+    (*particle).scale = vec4f(eased(p.scale_x, t), eased(p.scale_y, t),
+                              eased(p.scale_z, t), 0.0);
+    (*particle).alpha.w = eased(p.alpha, t);
+    return true;
+  }
+);
+// clang-format on
+
 // Texture and sampler
 static texture_t particle_texture;
 
@@ -87,79 +214,10 @@ static void prepare_vertex_buffer(wgpu_context_t* wgpu_context)
                   });
 }
 
-static void prepare_particle_buffer(wgpu_context_t* wgpu_context)
-{
-  // Particle data
-  const float current_time = platform_get_time();
-  for (uint32_t i = 0; i < (uint32_t)PARTICLE_NUM; ++i) {
-    const float life = random_float() * 8000.0f + 2000.0f;
-    const float age  = random_float() * life;
-    initial_particle_data[PROPERTY_NUM * i + 0]
-      = current_time - age;                             // start time
-    initial_particle_data[PROPERTY_NUM * i + 1] = life; // life
-    // position
-    initial_particle_data[PROPERTY_NUM * i + 4] = random_float() * 2 - 1; // x
-    initial_particle_data[PROPERTY_NUM * i + 5] = random_float() * 2 - 1; // y
-    initial_particle_data[PROPERTY_NUM * i + 6] = random_float() * 2 - 1; // z
-    initial_particle_data[PROPERTY_NUM * i + 7] = 0.0f;
-    // scale
-    initial_particle_data[PROPERTY_NUM * i + 8]  = 0.0f; // scaleX
-    initial_particle_data[PROPERTY_NUM * i + 9]  = 0.0f; // scaleY
-    initial_particle_data[PROPERTY_NUM * i + 10] = 0.0f; // scaleZ
-    initial_particle_data[PROPERTY_NUM * i + 11] = 0.0f;
-    // x
-    initial_particle_data[PROPERTY_NUM * i + 12] = 0.0f; // startValue
-    initial_particle_data[PROPERTY_NUM * i + 13]
-      = random_float() * 2.0f - 1.0f; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 14]
-      = (int)(random_float() * 27.0f); // ease
-    // y
-    initial_particle_data[PROPERTY_NUM * i + 16] = 0.0f; // startValue
-    initial_particle_data[PROPERTY_NUM * i + 17]
-      = random_float() * 2.0f - 1.0f; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 18]
-      = (int)(random_float() * 27.0f); // ease
-    // z
-    initial_particle_data[PROPERTY_NUM * i + 20] = 0.0f; // startValue
-    initial_particle_data[PROPERTY_NUM * i + 21]
-      = random_float() * 2.0f - 1.0f; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 22]
-      = (int)(random_float() * 27.0f); // ease
-    // scaleX
-    const float t_scale                          = random_float() * 12.0f;
-    initial_particle_data[PROPERTY_NUM * i + 24] = 0.0f;    // startValue
-    initial_particle_data[PROPERTY_NUM * i + 25] = t_scale; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 26] = 0.0f;    // ease
-    // scaleY
-    initial_particle_data[PROPERTY_NUM * i + 28] = 0.0f;    // startValue
-    initial_particle_data[PROPERTY_NUM * i + 29] = t_scale; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 30] = 0.0f;    // ease
-    // scaleZ
-    initial_particle_data[PROPERTY_NUM * i + 32] = 0.0f;    // startValue
-    initial_particle_data[PROPERTY_NUM * i + 33] = t_scale; // endValue
-    initial_particle_data[PROPERTY_NUM * i + 34] = 0.0f;    // ease
-    // alpha
-    initial_particle_data[PROPERTY_NUM * i + 36] = random_float(); // startValue
-    initial_particle_data[PROPERTY_NUM * i + 37] = 0.0f;           // endValue
-    initial_particle_data[PROPERTY_NUM * i + 38]
-      = (int)(random_float() * 27.0f);                   // ease
-    initial_particle_data[PROPERTY_NUM * i + 39] = 0.0f; // value
-  }
-
-  // Create vertex buffer
-  compute.particle_buffer = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex
-                             | WGPUBufferUsage_Storage,
-                    .size         = sizeof(initial_particle_data),
-                    .initial.data = initial_particle_data,
-                  });
-}
-
 static void prepare_compute(wgpu_context_t* wgpu_context)
 {
-  /* Compute pipeline layout */
-  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+  /* Particle behavior bind group layout */
+  WGPUBindGroupLayoutEntry bgl_entries[1] = {
     [0] = (WGPUBindGroupLayoutEntry) {
       // Binding 0 : SimParams
       .binding    = 0,
@@ -170,16 +228,6 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
       },
       .sampler = {0},
     },
-    [1] = (WGPUBindGroupLayoutEntry) {
-      // Binding 1 : ParticlesA
-      .binding    = 1,
-      .visibility = WGPUShaderStage_Compute,
-      .buffer = (WGPUBufferBindingLayout) {
-        .type           = WGPUBufferBindingType_Storage,
-        .minBindingSize = sizeof(initial_particle_data),
-      },
-      .sampler = {0},
-    }
   };
   WGPUBindGroupLayoutDescriptor bgl_desc = {
     .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
@@ -189,28 +237,13 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
     = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
   ASSERT(compute.bind_group_layout != NULL)
 
-  WGPUPipelineLayoutDescriptor compute_pipeline_layout_desc = {
-    .bindGroupLayoutCount = 1,
-    .bindGroupLayouts     = &compute.bind_group_layout,
-  };
-  compute.pipeline_layout = wgpuDeviceCreatePipelineLayout(
-    wgpu_context->device, &compute_pipeline_layout_desc);
-  ASSERT(compute.pipeline_layout != NULL)
-
-  /* Compute pipeline bind group */
-  WGPUBindGroupEntry bg_entries[2] = {
+  /* Particle behavior bind group */
+  WGPUBindGroupEntry bg_entries[1] = {
     [0] = (WGPUBindGroupEntry) {
       /* Binding 0 : SimParams */
       .binding = 0,
       .buffer  = compute.sim_param_buffer.buffer,
-      .size    =  compute.sim_param_buffer.size,
-    },
-    [1] = (WGPUBindGroupEntry) {
-     /* Binding 1 : Particles A */
-      .binding = 1,
-      .buffer  = compute.particle_buffer.buffer,
-      .offset  = 0,
-      .size    = compute.particle_buffer.size,
+      .size    = compute.sim_param_buffer.size,
     },
   };
   WGPUBindGroupDescriptor bg_desc = {
@@ -218,28 +251,21 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
     .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
     .entries    = bg_entries,
   };
-  compute.particle_bind_group
+  compute.sim_param_bind_group
     = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-
-  /* Compute shader */
-  wgpu_shader_t particle_comp_shader = wgpu_shader_create(
-    wgpu_context,
-    &(wgpu_shader_desc_t){
-      /* Compute shader SPIR-V */
-      .label = "particle_compute_shader",
-      .file  = "shaders/compute_particles_easing/particle.comp.spv",
-    });
-
-  /* Create pipeline */
-  compute.pipeline = wgpuDeviceCreateComputePipeline(
-    wgpu_context->device,
-    &(WGPUComputePipelineDescriptor){
-      .layout  = compute.pipeline_layout,
-      .compute = particle_comp_shader.programmable_stage_descriptor,
-    });
-
-  /* Partial clean-up */
-  wgpu_shader_release(&particle_comp_shader);
+  ASSERT(compute.sim_param_bind_group != NULL)
+
+  /* Particle system, drawn as instances of the quad */
+  compute.particle_system = wgpu_particle_system_create(
+    wgpu_context, &(wgpu_particle_system_desc_t){
+                    .label             = "compute_particles_easing",
+                    .capacity          = PARTICLE_NUM,
+                    .particle_size     = PROPERTY_NUM * sizeof(float),
+                    .vertex_count      = 6,
+                    .wgsl_code         = particle_behavior_wgsl,
+                    .bind_group_layout = compute.bind_group_layout,
+                    .bind_group        = compute.sim_param_bind_group,
+                  });
 }
 
 static void prepare_particle_texture(wgpu_context_t* wgpu_context)
@@ -504,7 +530,6 @@ static int example_initialize(wgpu_example_context_t* context)
   if (context) {
     prepare_vertex_buffer(context->wgpu_context);
     prepare_uniform_buffers(context);
-    prepare_particle_buffer(context->wgpu_context);
     prepare_compute(context->wgpu_context);
     prepare_particle_texture(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
@@ -527,22 +552,11 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  /* Compute pass: Compute particle movement */
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    /* Dispatch the compute job */
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute.pipeline);
-    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
-                                       compute.particle_bind_group, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
-                                             PARTICLE_NUM, 1, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
+  /* Compute pass: Replace the dead particles and compute particle movement */
+  wgpu_particle_system_update(compute.particle_system, wgpu_context->cmd_enc,
+                              PARTICLE_NUM);
 
-  /* Render pass: Draw the particle system using the update vertex buffer */
+  /* Render pass: Draw the live particles of the particle system */
   {
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc, &render_pass_desc);
@@ -550,12 +564,10 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                      graphics.pipeline);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
                                       graphics.uniforms_bind_group, 0, 0);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                         compute.particle_buffer.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 1,
                                          vertices.buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 6, PARTICLE_NUM, 0, 0);
+    wgpu_particle_system_draw(compute.particle_system,
+                              wgpu_context->rpass_enc, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
@@ -616,12 +628,10 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(RenderPipeline, graphics.pipeline)
 
   /* Compute pipeline */
+  wgpu_particle_system_destroy(compute.particle_system);
   WGPU_RELEASE_RESOURCE(Buffer, compute.sim_param_buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, compute.particle_buffer.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, compute.bind_group_layout)
-  WGPU_RELEASE_RESOURCE(BindGroup, compute.particle_bind_group)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, compute.pipeline_layout)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroup, compute.sim_param_bind_group)
 }
 
 void example_compute_particles_easing(int argc, char* argv[])
@@ -4,12 +4,19 @@
 #include <string.h>
 
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/particle_system.h"
+#include "../webgpu/weighted_oit.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Shader Particles WebGPU Logo
  *
  * This example demonstrates rendering of particles simulated with compute
- * shaders.
+ * shaders. The particles are spawned from a probability map of the logo,
+ * dead particles are recycled by the shared GPU particle system. With depth
+ * sorted blending the live particles are sorted back to front on the GPU and
+ * alpha blended, with weighted blended order-independent transparency they are
+ * alpha blended approximately without sorting, otherwise they are blended
+ * additively in any order.
  *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/tree/main/src/sample/particles
@@ -25,9 +32,6 @@ const uint32_t particle_instance_byte_size = 3 * 4 + // position
                                              1 * 4 + // padding
                                              0;
 
-/* Particles buffer */
-static struct wgpu_buffer_t particles_buffer = {0};
-
 /* Quad vertex buffer */
 static struct wgpu_buffer_t quad_vertices = {0};
 
@@ -43,15 +47,39 @@ static struct uniform_buffer_vs_t {
   wgpu_buffer_t buffer;
 } uniform_buffer_vs = {0};
 
-static WGPUBindGroup uniform_bind_group;
+/* Blend modes: additive, alpha blending of the depth sorted particles and
+ * weighted blended OIT of the unsorted particles */
+typedef enum blend_mode_t {
+  BlendMode_Additive    = 0,
+  BlendMode_Sorted      = 1,
+  BlendMode_WeightedOit = 2,
+  BlendMode_Count       = 3,
+} blend_mode_t;
+
+static int32_t current_blend_mode = (int32_t)BlendMode_Sorted;
+static const char* blend_mode_names[BlendMode_Count] = {
+  "Additive",
+  "Depth sorted",
+  "Weighted OIT",
+};
+
+/* Pipelines and bind groups per blend mode, layouts of the pipelines differ */
+static WGPUBindGroup uniform_bind_groups[BlendMode_Count];
 static texture_t depth_texture;
 static texture_t texture;
-static WGPURenderPipeline render_pipeline;
+static WGPURenderPipeline render_pipelines[BlendMode_Count];
 
 static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
 static WGPURenderPassDescriptor render_pass_desc;
 static WGPURenderPassDepthStencilAttachment render_pass_depth_stencil_att_desc;
 
+/* Weighted OIT targets, transparent pass and composite pass */
+static wgpu_weighted_oit_t* weighted_oit;
+static WGPURenderPassColorAttachment oit_color_att_descriptors[2];
+static WGPURenderPassDescriptor oit_render_pass_desc;
+static WGPURenderPassColorAttachment composite_color_att_descriptors[1];
+static WGPURenderPassDescriptor composite_render_pass_desc;
+
 // Probability map generation
 static WGPUComputePipeline probability_map_import_level_pipeline;
 static WGPUComputePipeline probability_map_export_level_pipeline;
@@ -92,24 +120,138 @@ struct {
   mat4 model_view_projection;
 } view_matrices;
 
-static WGPUComputePipeline compute_pipeline;
+static WGPUBindGroupLayout compute_bind_group_layout;
 static WGPUBindGroup compute_bind_group;
+static wgpu_particle_system_t* particle_system;
+
+/* Particle behavior, ports the simulation of the original particle.wgsl */
+// clang-format off
+static const char* particle_behavior_wgsl = CODE(
+  struct SimulationParams {
+    delta_time : f32,
+    seed       : vec4f,
+  }
+
+  struct Particle {
+    position : vec3f,
+    lifetime : f32,
+    color    : vec4f,
+    velocity : vec3f,
+  }
+
+  @group(1) @binding(0) var<uniform> sim_params : SimulationParams;
+  @group(1) @binding(1) var probability_map : texture_2d<f32>;
+
+  var<private> rand_seed : vec2f;
+
+  fn init_rand(invocation_id : u32, seed : vec4f) {
+    rand_seed = seed.xz;
+    rand_seed = fract(rand_seed * cos(35.456 + f32(invocation_id) * seed.yw));
+    rand_seed = fract(rand_seed * cos(41.235 + f32(invocation_id) * seed.xw));
+  }
+
+  fn rand() -> f32 {
+    rand_seed.x = fract(cos(dot(rand_seed, vec2f(23.14077926, 232.61038156)))
+                        * 12000.0);
+    rand_seed.y = fract(cos(dot(rand_seed, vec2f(54.47856553, 345.84153136)))
+                        * 55000.0);
+    return rand_seed.y;
+  }
+
+  // Spawns the particle at a texel picked with the probability map, starting
+  // with the 1x1 mip level
+  fn particle_emit(index : u32) -> Particle {
+    init_rand(index, sim_params.seed);
+    var coord = vec2i(0);
+    for (var level = textureNumLevels(probability_map) - 1u; level > 0u;
+         level--) {
+      let probabilities = textureLoad(probability_map, coord, level);
+      let value = vec4f(rand());
+      let mask  = (value >= vec4f(0.0, probabilities.xyz))
+                  & (value < probabilities);
+      coord = coord * 2;
+      coord.x = coord.x + select(0, 1, any(mask.yw));
+      coord.y = coord.y + select(0, 1, any(mask.zw));
+    }
+    let uv = vec2f(coord) / vec2f(textureDimensions(probability_map));
+
+    var particle : Particle;
+    particle.position = vec3f((uv - 0.5) * 3.0 * vec2f(1.0, -1.0), 0.0);
+    particle.color    = textureLoad(probability_map, coord, 0);
+    particle.velocity = vec3f((rand() - 0.5) * 0.1, (rand() - 0.5) * 0.1,
+                              rand() * 0.3);
+    particle.lifetime = 0.5 + rand() * 3.0;
+    return particle;
+  }
+
+  // View depth of the depth sort
+  fn particle_position(particle : Particle) -> vec3f {
+    return particle.position;
+  }
+
+  // Gravity, velocity integration and fading out before vanishing
+  fn particle_update(particle : ptr<function, Particle>) -> bool {
+    (*particle).velocity.z -= sim_params.delta_time * 0.5;
+    (*particle).position += sim_params.delta_time * (*particle).velocity;
+    (*particle).lifetime -= sim_params.delta_time;
+    (*particle).color.a = smoothstep(0.0, 0.5, (*particle).lifetime);
+    return (*particle).lifetime >= 0.0;
+  }
+);
+// clang-format on
+
+/* Particle rendering of the weighted OIT, ports the render shaders of the
+ * original particle.wgsl, wrapped with wgpu_weighted_oit_create_wgsl() */
+// clang-format off
+static const char* particle_oit_shader_wgsl = CODE(
+  struct RenderParams {
+    modelViewProjectionMatrix : mat4x4f,
+    right                     : vec3f,
+    up                        : vec3f,
+  }
+  @group(0) @binding(0) var<uniform> render_params : RenderParams;
+
+  struct VertexInput {
+    @location(0) position : vec3f,
+    @location(1) color    : vec4f,
+    @location(2) quad_pos : vec2f,
+  }
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) color          : vec4f,
+    @location(1) quad_pos       : vec2f,
+    @location(2) view_depth     : f32,
+  }
+
+  @vertex
+  fn vs_main(in : VertexInput) -> VertexOutput {
+    let quad_pos = mat2x3f(render_params.right, render_params.up) * in.quad_pos;
+    let position = in.position + quad_pos * 0.01;
+    var out : VertexOutput;
+    out.position   = render_params.modelViewProjectionMatrix
+                     * vec4f(position, 1.0);
+    out.color      = in.color;
+    out.quad_pos   = in.quad_pos;
+    out.view_depth = out.position.w;
+    return out;
+  }
+
+  @fragment
+  fn fs_main(in : VertexOutput) -> WeightedOitOutput {
+    var color = in.color;
+    color.a = color.a * max(1.0 - length(in.quad_pos), 0.0);
+    return weightedOitOutput(color, in.view_depth);
+  }
+);
+// clang-format on
 
 // Other variables
 static const char* example_title = "Compute Shader Particles WebGPU Logo";
 static bool prepared             = false;
 
-static void prepare_particles_buffer(wgpu_context_t* wgpu_context)
-{
-  particles_buffer = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex
-                             | WGPUBufferUsage_Storage,
-                    .size = num_particles * particle_instance_byte_size,
-                  });
-}
-
-static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
+static void prepare_render_pipeline(wgpu_context_t* wgpu_context,
+                                    blend_mode_t blend_mode)
 {
   // Primitive state
   WGPUPrimitiveState primitive_state = {
@@ -121,7 +263,9 @@ static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
   // Color target state
   WGPUBlendState blend_state              = wgpu_create_blend_state(true);
   blend_state.color.srcFactor             = WGPUBlendFactor_SrcAlpha;
-  blend_state.color.dstFactor             = WGPUBlendFactor_One;
+  blend_state.color.dstFactor             = blend_mode == BlendMode_Sorted ?
+                                              WGPUBlendFactor_OneMinusSrcAlpha :
+                                              WGPUBlendFactor_One;
   blend_state.color.operation             = WGPUBlendOperation_Add;
   blend_state.alpha.srcFactor             = WGPUBlendFactor_Zero;
   blend_state.alpha.dstFactor             = WGPUBlendFactor_One;
@@ -132,6 +276,12 @@ static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
     .writeMask = WGPUColorWriteMask_All,
   };
 
+  // Accumulation and revealage targets of the weighted OIT
+  WGPUBlendState oit_blend_states[2];
+  WGPUColorTargetState oit_color_target_states[2];
+  wgpu_weighted_oit_get_color_targets(oit_blend_states,
+                                      oit_color_target_states);
+
   // Depth stencil state
   WGPUDepthStencilState depth_stencil_state
     = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
@@ -183,29 +333,40 @@ static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
     };
   }
 
+  // Shader, the weighted OIT uses the embedded render shaders
+  const bool weighted_oit_blending = blend_mode == BlendMode_WeightedOit;
+  char* oit_wgsl_code              = NULL;
+  wgpu_shader_desc_t shader_desc   = {
+    .file = "shaders/compute_particles_webgpu_logo/particle.wgsl",
+  };
+  if (weighted_oit_blending) {
+    oit_wgsl_code = wgpu_weighted_oit_create_wgsl(particle_oit_shader_wgsl);
+    shader_desc   = (wgpu_shader_desc_t){
+      .label            = "particle_oit_shader",
+      .wgsl_code.source = oit_wgsl_code,
+    };
+  }
+
   // Vertex state
+  shader_desc.entry            = "vs_main";
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
-            wgpu_context, &(wgpu_vertex_state_t){
-            .shader_desc = (wgpu_shader_desc_t){
-              // Vertex shader WGSL
-              .file  = "shaders/compute_particles_webgpu_logo/particle.wgsl",
-              .entry = "vs_main",
-            },
-            .buffer_count = (uint32_t)ARRAY_SIZE(vertex_buffer_layouts),
-            .buffers      = vertex_buffer_layouts,
-          });
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc  = shader_desc,
+                    .buffer_count = (uint32_t)ARRAY_SIZE(vertex_buffer_layouts),
+                    .buffers      = vertex_buffer_layouts,
+                  });
 
   // Fragment state
+  shader_desc.entry                = "fs_main";
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
-            wgpu_context, &(wgpu_fragment_state_t){
-            .shader_desc = (wgpu_shader_desc_t){
-              // Fragment shader WGSL
-              .file  = "shaders/compute_particles_webgpu_logo/particle.wgsl",
-              .entry = "fs_main",
-            },
-            .target_count = 1,
-            .targets      = &color_target_state,
-          });
+    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc  = shader_desc,
+                    .target_count = weighted_oit_blending ? 2 : 1,
+                    .targets      = weighted_oit_blending ?
+                                      oit_color_target_states :
+                                      &color_target_state,
+                  });
+  free(oit_wgsl_code);
 
   // Multisample state
   WGPUMultisampleState multisample_state
@@ -215,7 +376,7 @@ static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
       });
 
   // Create rendering pipeline using the specified states
-  render_pipeline = wgpuDeviceCreateRenderPipeline(
+  WGPURenderPipeline render_pipeline = wgpuDeviceCreateRenderPipeline(
     wgpu_context->device, &(WGPURenderPipelineDescriptor){
                             .label        = "particle_render_pipeline",
                             .primitive    = primitive_state,
@@ -225,6 +386,7 @@ static void prepare_render_pipelines(wgpu_context_t* wgpu_context)
                             .multisample  = multisample_state,
                           });
   ASSERT(render_pipeline)
+  render_pipelines[blend_mode] = render_pipeline;
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -281,14 +443,16 @@ static void prepare_uniform_bind_group(wgpu_context_t* wgpu_context)
       .size    =  uniform_buffer_vs.buffer.size,
     },
   };
-  uniform_bind_group = wgpuDeviceCreateBindGroup(
-    wgpu_context->device,
-    &(WGPUBindGroupDescriptor){
-      .layout     = wgpuRenderPipelineGetBindGroupLayout(render_pipeline, 0),
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
-    });
-  ASSERT(uniform_bind_group != NULL)
+  for (uint32_t i = 0; i < (uint32_t)BlendMode_Count; ++i) {
+    uniform_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout = wgpuRenderPipelineGetBindGroupLayout(render_pipelines[i], 0),
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(uniform_bind_groups[i] != NULL)
+  }
 }
 
 static void setup_render_pass()
@@ -322,6 +486,20 @@ static void setup_render_pass()
     .colorAttachments       = rp_color_att_descriptors,
     .depthStencilAttachment = &render_pass_depth_stencil_att_desc,
   };
+
+  // Weighted OIT transparent pass, the attachments are assigned later
+  oit_render_pass_desc = (WGPURenderPassDescriptor){
+    .colorAttachmentCount   = 2,
+    .colorAttachments       = oit_color_att_descriptors,
+    .depthStencilAttachment = &render_pass_depth_stencil_att_desc,
+  };
+
+  // Weighted OIT composite pass over the cleared frame buffer
+  composite_color_att_descriptors[0] = rp_color_att_descriptors[0];
+  composite_render_pass_desc         = (WGPURenderPassDescriptor){
+    .colorAttachmentCount = 1,
+    .colorAttachments     = composite_color_att_descriptors,
+  };
 }
 
 static void prepare_quad_vertex_buffer(wgpu_context_t* wgpu_context)
@@ -576,33 +754,39 @@ static void prepare_simulation_uniform_buffer(wgpu_context_t* wgpu_context)
   ASSERT(simulation_ubo_buffer.buffer)
 }
 
-static void prepare_compute_pipeline(wgpu_context_t* wgpu_context)
+static void prepare_particle_system(wgpu_context_t* wgpu_context)
 {
-  /* Compute shader */
-  wgpu_shader_t particle_comp_shader = wgpu_shader_create(
-    wgpu_context,
-    &(wgpu_shader_desc_t){
-      // Compute shader WGSL
-      .file  = "shaders/compute_particles_webgpu_logo/particle.wgsl",
-      .entry = "simulate",
-    });
-
-  /* Create pipeline */
-  compute_pipeline = wgpuDeviceCreateComputePipeline(
-    wgpu_context->device,
-    &(WGPUComputePipelineDescriptor){
-      .compute = particle_comp_shader.programmable_stage_descriptor,
-    });
-  ASSERT(compute_pipeline)
-
-  /* Partial clean-up */
-  wgpu_shader_release(&particle_comp_shader);
-}
+  /* Particle behavior bind group layout */
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0 : Simulation UBO buffer
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = simulation_ubo_buffer.size,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1 : Probability map texture
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+        .multisampled  = false,
+      },
+    },
+  };
+  compute_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(compute_bind_group_layout)
 
-static void prepare_compute_bind_group(wgpu_context_t* wgpu_context)
-{
-  /* Compute pipeline bind group */
-  WGPUBindGroupEntry bg_entries[3] = {
+  /* Particle behavior bind group */
+  WGPUBindGroupEntry bg_entries[2] = {
     [0] = (WGPUBindGroupEntry) {
       // Binding 0 : Simulation UBO buffer
       .binding = 0,
@@ -610,26 +794,33 @@ static void prepare_compute_bind_group(wgpu_context_t* wgpu_context)
       .size    = simulation_ubo_buffer.size,
     },
     [1] = (WGPUBindGroupEntry) {
-     // Binding 1 : Particles buffer
-      .binding = 1,
-      .buffer  = particles_buffer.buffer,
-      .offset  = 0,
-      .size    = particles_buffer.size,
-    },
-    [2] = (WGPUBindGroupEntry) {
-     // Binding 2 : Texture view
-      .binding     = 2,
+     // Binding 1 : Probability map texture
+      .binding     = 1,
       .textureView = texture.view,
     },
   };
   WGPUBindGroupDescriptor bg_desc = {
-    .layout     = wgpuComputePipelineGetBindGroupLayout(compute_pipeline, 0),
+    .layout     = compute_bind_group_layout,
     .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
     .entries    = bg_entries,
   };
   compute_bind_group
     = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
   ASSERT(compute_bind_group)
+
+  /* Particle system, drawn as instances of the quad */
+  particle_system = wgpu_particle_system_create(
+    wgpu_context, &(wgpu_particle_system_desc_t){
+                    .label             = "compute_particles_webgpu_logo",
+                    .capacity          = num_particles,
+                    .particle_size     = particle_instance_byte_size,
+                    .vertex_count      = 6,
+                    .wgsl_code         = particle_behavior_wgsl,
+                    .bind_group_layout = compute_bind_group_layout,
+                    .bind_group        = compute_bind_group,
+                    .depth_sort        = current_blend_mode
+                                         == (int32_t)BlendMode_Sorted,
+                  });
 }
 
 static void prepare_view_matrices(wgpu_context_t* wgpu_context)
@@ -700,8 +891,13 @@ static void update_uniform_buffers(wgpu_context_t* wgpu_context)
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
-    prepare_particles_buffer(context->wgpu_context);
-    prepare_render_pipelines(context->wgpu_context);
+    prepare_render_pipeline(context->wgpu_context, BlendMode_Additive);
+    prepare_render_pipeline(context->wgpu_context, BlendMode_Sorted);
+    prepare_render_pipeline(context->wgpu_context, BlendMode_WeightedOit);
+    weighted_oit = wgpu_weighted_oit_create(context->wgpu_context,
+                                            &(wgpu_weighted_oit_desc_t){
+                                              .label = "particle_oit_target",
+                                            });
     prepare_depth_texture(context->wgpu_context);
     prepare_uniform_buffer(context->wgpu_context);
     prepare_uniform_bind_group(context->wgpu_context);
@@ -710,8 +906,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_texture(context->wgpu_context);
     generate_probability_map(context->wgpu_context);
     prepare_simulation_uniform_buffer(context->wgpu_context);
-    prepare_compute_pipeline(context->wgpu_context);
-    prepare_compute_bind_group(context->wgpu_context);
+    prepare_particle_system(context->wgpu_context);
     prepare_view_matrices(context->wgpu_context);
     prepared = true;
     return 0;
@@ -727,41 +922,55 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                            &simulation_params.simulate);
     imgui_overlay_input_float(context->imgui_overlay, "Delta Time",
                               &simulation_params.delta_time, 0.01, "%.2f");
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Blending",
+                                &current_blend_mode, blend_mode_names,
+                                (uint32_t)BlendMode_Count)) {
+      // Only the alpha blending of the depth sorted particles needs the sort
+      wgpu_particle_system_set_depth_sort(
+        particle_system, current_blend_mode == (int32_t)BlendMode_Sorted);
+    }
   }
 }
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
+  const blend_mode_t blend_mode = (blend_mode_t)current_blend_mode;
   rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
+  composite_color_att_descriptors[0].view
+    = wgpu_context->swap_chain.frame_buffer;
+  if (blend_mode == BlendMode_WeightedOit) {
+    wgpu_weighted_oit_get_attachments(weighted_oit, oit_color_att_descriptors);
+  }
 
   /* Create command encoder */
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute_pipeline);
-    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
-                                       compute_bind_group, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
-                                             ceil(num_particles / 64.f), 1, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
+  /* Respawn the dead particles and simulate the living ones */
+  wgpu_particle_system_update(particle_system, wgpu_context->cmd_enc,
+                              num_particles);
 
   {
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc, &render_pass_desc);
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, render_pipeline);
+      wgpu_context->cmd_enc, blend_mode == BlendMode_WeightedOit ?
+                               &oit_render_pass_desc :
+                               &render_pass_desc);
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                     render_pipelines[blend_mode]);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      uniform_bind_group, 0, 0);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 0, particles_buffer.buffer, 0, WGPU_WHOLE_SIZE);
+                                      uniform_bind_groups[blend_mode], 0, 0);
     wgpuRenderPassEncoderSetVertexBuffer(
       wgpu_context->rpass_enc, 1, quad_vertices.buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 6, num_particles, 0, 0);
+    wgpu_particle_system_draw(particle_system, wgpu_context->rpass_enc, 0);
+    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  }
+
+  /* Blend the unsorted particles over the cleared frame buffer */
+  if (blend_mode == BlendMode_WeightedOit) {
+    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &composite_render_pass_desc);
+    wgpu_weighted_oit_composite(weighted_oit, wgpu_context->rpass_enc);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
@@ -806,6 +1015,7 @@ static int example_render(wgpu_example_context_t* context)
 
   update_simulation_ubo_data(context->wgpu_context);
   update_uniform_buffers(context->wgpu_context);
+  wgpu_particle_system_set_view_matrix(particle_system, view_matrices.view);
 
   return example_draw(context);
 }
@@ -814,14 +1024,16 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
 
-  WGPU_RELEASE_RESOURCE(Buffer, particles_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, quad_vertices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer_vs.buffer.buffer)
 
-  WGPU_RELEASE_RESOURCE(BindGroup, uniform_bind_group)
+  for (uint32_t i = 0; i < (uint32_t)BlendMode_Count; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, uniform_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipelines[i])
+  }
+  wgpu_weighted_oit_destroy(weighted_oit);
   wgpu_destroy_texture(&depth_texture);
   wgpu_destroy_texture(&texture);
-  WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipeline)
 
   WGPU_RELEASE_RESOURCE(ComputePipeline, probability_map_import_level_pipeline)
   WGPU_RELEASE_RESOURCE(ComputePipeline, probability_map_export_level_pipeline)
@@ -831,7 +1043,8 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, buffer_b.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, simulation_ubo_buffer.buffer)
 
-  WGPU_RELEASE_RESOURCE(ComputePipeline, compute_pipeline)
+  wgpu_particle_system_destroy(particle_system);
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, compute_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, compute_bind_group)
 }
 
@@ -0,0 +1,539 @@
+#include "example_base.h"
+#include "examples.h"
+
+#include <string.h>
+
+#include "../core/argparse.h"
+#include "../core/platform.h"
+#include "../webgpu/compute_primitives.h"
+#include "../webgpu/imgui_overlay.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Compute Primitives
+ *
+ * Benchmark of the compute primitives of src/webgpu/compute_primitives.h: the
+ * exclusive scan, the stream compaction and the key/value radix sort are run
+ * on random u32 keys for element counts from 1K up to 16M (or --max-keys=).
+ * One element count is measured per frame, the rates are logged and shown in
+ * the UI. The GPU time is taken from timestamp queries, without timestamp
+ * query support the time from submit to completion is used. Every sort result
+ * is read back and verified.
+ * -------------------------------------------------------------------------- */
+
+#define MIN_NUM_KEYS (1u << 10)
+#define MAX_NUM_KEYS (1u << 24)
+#define NUM_KEY_COUNTS 8u
+
+typedef enum primitive_t {
+  PRIMITIVE_SCAN    = 0,
+  PRIMITIVE_COMPACT = 1,
+  PRIMITIVE_SORT    = 2,
+  PRIMITIVE_COUNT   = 3,
+} primitive_t;
+
+static const char* primitive_str[PRIMITIVE_COUNT] = {"Scan", "Compact", "Sort"};
+
+// Buffers of the benchmark, sized for max_keys elements
+static struct {
+  WGPUBuffer source_keys;
+  WGPUBuffer source_values;
+  WGPUBuffer keys;
+  WGPUBuffer values;
+  WGPUBuffer flags;
+  WGPUBuffer output;
+  WGPUBuffer output_count;
+  WGPUBuffer readback;
+} buffers = {0};
+
+// Timestamp queries of one measured primitive
+static struct {
+  bool supported;
+  WGPUQuerySet query_set;
+  WGPUBuffer resolve_buffer;
+  WGPUBuffer readback_buffer;
+} timestamps = {0};
+
+// Results of the element counts measured so far
+static struct {
+  uint32_t key_count[NUM_KEY_COUNTS];
+  double time_ms[NUM_KEY_COUNTS][PRIMITIVE_COUNT];
+  bool sort_valid[NUM_KEY_COUNTS];
+  uint32_t count;
+  uint32_t total;
+} results = {0};
+
+static wgpu_compute_primitives_t* compute_primitives = NULL;
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass;
+
+// Other variables
+static const char* example_title = "Compute Primitives";
+static bool prepared             = false;
+static uint32_t max_keys         = MAX_NUM_KEYS;
+
+static WGPUBuffer create_buffer(wgpu_context_t* wgpu_context, const char* label,
+                                WGPUBufferUsageFlags usage, uint64_t size)
+{
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(wgpu_context->device,
+                                             &(WGPUBufferDescriptor){
+                                               .label = label,
+                                               .usage = usage,
+                                               .size  = size,
+                                             });
+  ASSERT(buffer != NULL);
+  return buffer;
+}
+
+static void prepare_buffers(wgpu_context_t* wgpu_context)
+{
+  const uint64_t size              = (uint64_t)max_keys * sizeof(uint32_t);
+  const WGPUBufferUsageFlags usage = WGPUBufferUsage_Storage
+                                     | WGPUBufferUsage_CopySrc
+                                     | WGPUBufferUsage_CopyDst;
+  buffers.source_keys
+    = create_buffer(wgpu_context, "Source keys buffer", usage, size);
+  buffers.source_values
+    = create_buffer(wgpu_context, "Source values buffer", usage, size);
+  buffers.keys   = create_buffer(wgpu_context, "Keys buffer", usage, size);
+  buffers.values = create_buffer(wgpu_context, "Values buffer", usage, size);
+  buffers.flags  = create_buffer(wgpu_context, "Flags buffer", usage, size);
+  buffers.output = create_buffer(wgpu_context, "Output buffer", usage, size);
+  buffers.output_count = create_buffer(wgpu_context, "Output count buffer",
+                                       usage, sizeof(uint32_t));
+  // Sorted keys, sorted values and unsorted keys of the sort verification
+  buffers.readback = create_buffer(
+    wgpu_context, "Readback buffer",
+    WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, 3 * size);
+
+  // Random keys, the values are the element indices and every second element
+  // is flagged for the compaction
+  uint32_t* data = (uint32_t*)malloc(size);
+  uint32_t seed  = 0x12345678u;
+  for (uint32_t i = 0; i < max_keys; ++i) {
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    data[i] = seed;
+  }
+  wgpuQueueWriteBuffer(wgpu_context->queue, buffers.source_keys, 0, data,
+                       size);
+  for (uint32_t i = 0; i < max_keys; ++i) {
+    data[i] = i;
+  }
+  wgpuQueueWriteBuffer(wgpu_context->queue, buffers.source_values, 0, data,
+                       size);
+  for (uint32_t i = 0; i < max_keys; ++i) {
+    data[i] = i & 1u;
+  }
+  wgpuQueueWriteBuffer(wgpu_context->queue, buffers.flags, 0, data, size);
+  free(data);
+}
+
+static void prepare_timestamps(wgpu_context_t* wgpu_context)
+{
+  timestamps.supported
+    = wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery);
+  if (!timestamps.supported) {
+    log_warn("Timestamp queries not supported, measuring submit to completion");
+    return;
+  }
+  timestamps.query_set = wgpuDeviceCreateQuerySet(
+    wgpu_context->device, &(WGPUQuerySetDescriptor){
+                            .label = "Compute primitives timestamp query set",
+                            .type  = WGPUQueryType_Timestamp,
+                            .count = 2,
+                          });
+  ASSERT(timestamps.query_set != NULL);
+  timestamps.resolve_buffer = create_buffer(
+    wgpu_context, "Timestamp resolve buffer",
+    WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+    2 * sizeof(uint64_t));
+  timestamps.readback_buffer = create_buffer(
+    wgpu_context, "Timestamp readback buffer",
+    WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, 2 * sizeof(uint64_t));
+}
+
+static void setup_render_pass(void)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearColor = (WGPUColor) {
+        .r = 0.1f,
+        .g = 0.1f,
+        .b = 0.1f,
+        .a = 1.0f,
+      },
+  };
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = NULL,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    wgpu_context_t* wgpu_context = context->wgpu_context;
+    compute_primitives = wgpu_compute_primitives_create(wgpu_context, max_keys);
+    prepare_buffers(wgpu_context);
+    prepare_timestamps(wgpu_context);
+    setup_render_pass();
+    // Element counts 1K * 4^k up to max_keys
+    for (uint32_t n = MIN_NUM_KEYS;
+         n <= max_keys && results.total < NUM_KEY_COUNTS; n *= 4) {
+      results.key_count[results.total++] = n;
+    }
+    prepared = true;
+    return 0;
+  }
+
+  return 1;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Measurement
+ * -------------------------------------------------------------------------- */
+
+typedef struct readback_t {
+  bool done;
+  bool success;
+} readback_t;
+
+static void map_callback(WGPUBufferMapAsyncStatus status, void* user_data)
+{
+  readback_t* readback = (readback_t*)user_data;
+  readback->success    = status == WGPUBufferMapAsyncStatus_Success;
+  readback->done       = true;
+}
+
+static void work_done_callback(WGPUQueueWorkDoneStatus status, void* user_data)
+{
+  readback_t* readback = (readback_t*)user_data;
+  readback->success    = status == WGPUQueueWorkDoneStatus_Success;
+  readback->done       = true;
+}
+
+static bool map_and_wait(wgpu_context_t* wgpu_context, WGPUBuffer buffer,
+                         size_t size)
+{
+  readback_t readback = {0};
+  wgpuBufferMapAsync(buffer, WGPUMapMode_Read, 0, size, map_callback,
+                     &readback);
+  while (!readback.done) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+  return readback.success;
+}
+
+static void submit(wgpu_context_t* wgpu_context, WGPUCommandEncoder cmd_enc)
+{
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+}
+
+static void record_primitive(WGPUCommandEncoder cmd_enc, primitive_t primitive,
+                             uint32_t count)
+{
+  switch (primitive) {
+    case PRIMITIVE_SCAN:
+      wgpu_compute_exclusive_scan(compute_primitives, cmd_enc,
+                                  buffers.source_keys, buffers.output, count);
+      break;
+    case PRIMITIVE_COMPACT:
+      wgpu_compute_compact(compute_primitives, cmd_enc, buffers.source_values,
+                           buffers.flags, buffers.output, buffers.output_count,
+                           count);
+      break;
+    case PRIMITIVE_SORT:
+      wgpu_compute_radix_sort(compute_primitives, cmd_enc, buffers.keys,
+                              buffers.values, count);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Runs the primitive on count elements and waits for the result.
+ * @return the GPU time in milliseconds, a negative value on failure
+ */
+static double measure_primitive(wgpu_context_t* wgpu_context,
+                                primitive_t primitive, uint32_t count)
+{
+  // The sort works in place, start from the unsorted keys
+  const uint64_t size = (uint64_t)count * sizeof(uint32_t);
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, buffers.source_keys, 0,
+                                       buffers.keys, 0, size);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, buffers.source_values, 0,
+                                       buffers.values, 0, size);
+  submit(wgpu_context, cmd_enc);
+
+  cmd_enc = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  if (timestamps.supported) {
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, timestamps.query_set, 0);
+  }
+  record_primitive(cmd_enc, primitive, count);
+  if (timestamps.supported) {
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, timestamps.query_set, 1);
+    wgpuCommandEncoderResolveQuerySet(cmd_enc, timestamps.query_set, 0, 2,
+                                      timestamps.resolve_buffer, 0);
+    wgpuCommandEncoderCopyBufferToBuffer(
+      cmd_enc, timestamps.resolve_buffer, 0, timestamps.readback_buffer, 0,
+      2 * sizeof(uint64_t));
+  }
+  const float time_start = platform_get_time();
+  submit(wgpu_context, cmd_enc);
+
+  if (!timestamps.supported) {
+    readback_t work_done = {0};
+    wgpuQueueOnSubmittedWorkDone(wgpu_context->queue, 0, work_done_callback,
+                                 &work_done);
+    while (!work_done.done) {
+      wgpuDeviceTick(wgpu_context->device);
+    }
+    return work_done.success ?
+             (double)(platform_get_time() - time_start) * 1000.0 :
+             -1.0;
+  }
+
+  if (!map_and_wait(wgpu_context, timestamps.readback_buffer,
+                    2 * sizeof(uint64_t))) {
+    return -1.0;
+  }
+  const uint64_t* ticks = (const uint64_t*)wgpuBufferGetConstMappedRange(
+    timestamps.readback_buffer, 0, 2 * sizeof(uint64_t));
+  // Timestamps are in nanoseconds
+  const double time_ms = ticks[1] > ticks[0] ? (ticks[1] - ticks[0]) / 1.0e6 :
+                                               -1.0;
+  wgpuBufferUnmap(timestamps.readback_buffer);
+  return time_ms;
+}
+
+/* Checks that the keys are ascending and the values still belong to them */
+static bool verify_sort(wgpu_context_t* wgpu_context, uint32_t count)
+{
+  const uint64_t size   = (uint64_t)count * sizeof(uint32_t);
+  const uint64_t region = (uint64_t)max_keys * sizeof(uint32_t);
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, buffers.keys, 0,
+                                       buffers.readback, 0, size);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, buffers.values, 0,
+                                       buffers.readback, region, size);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, buffers.source_keys, 0,
+                                       buffers.readback, 2 * region, size);
+  submit(wgpu_context, cmd_enc);
+  if (!map_and_wait(wgpu_context, buffers.readback, 3 * region)) {
+    return false;
+  }
+
+  const uint32_t* data = (const uint32_t*)wgpuBufferGetConstMappedRange(
+    buffers.readback, 0, 3 * region);
+  const uint32_t* keys        = data;
+  const uint32_t* values      = data + max_keys;
+  const uint32_t* source_keys = data + 2 * (size_t)max_keys;
+  bool valid                  = true;
+  for (uint32_t i = 0; i < count && valid; ++i) {
+    valid = values[i] < count && source_keys[values[i]] == keys[i]
+            && (i == 0 || keys[i - 1] <= keys[i]);
+  }
+  wgpuBufferUnmap(buffers.readback);
+  return valid;
+}
+
+static void run_next_benchmark(wgpu_context_t* wgpu_context)
+{
+  const uint32_t r     = results.count;
+  const uint32_t count = results.key_count[r];
+  for (uint32_t p = 0; p < (uint32_t)PRIMITIVE_COUNT; ++p) {
+    results.time_ms[r][p]
+      = measure_primitive(wgpu_context, (primitive_t)p, count);
+  }
+  results.sort_valid[r] = verify_sort(wgpu_context, count);
+  ++results.count;
+
+  log_info("%8u keys: scan %.3f ms, compact %.3f ms, sort %.3f ms (%.1f M "
+           "keys/s)%s",
+           count, results.time_ms[r][PRIMITIVE_SCAN],
+           results.time_ms[r][PRIMITIVE_COMPACT],
+           results.time_ms[r][PRIMITIVE_SORT],
+           count / (results.time_ms[r][PRIMITIVE_SORT] * 1.0e3),
+           results.sort_valid[r] ? "" : ", sort result invalid");
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  if (imgui_overlay_header("Results")) {
+    imgui_overlay_text("Timing: %s", timestamps.supported ?
+                                       "timestamp queries" :
+                                       "submit to completion");
+    for (uint32_t r = 0; r < results.count; ++r) {
+      imgui_overlay_text("%u keys", results.key_count[r]);
+      for (uint32_t p = 0; p < (uint32_t)PRIMITIVE_COUNT; ++p) {
+        // Million keys per second
+        const double time_ms = results.time_ms[r][p];
+        imgui_overlay_text("  %s: %.1f M keys/s", primitive_str[p],
+                           time_ms > 0.0 ?
+                             results.key_count[r] / (time_ms * 1.0e3) :
+                             0.0);
+      }
+      if (!results.sort_valid[r]) {
+        imgui_overlay_text("  Sort result invalid");
+      }
+    }
+    if (results.count < results.total) {
+      imgui_overlay_text("Measuring %u keys...",
+                         results.key_count[results.count]);
+    }
+  }
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context          = context->wgpu_context;
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Render pass
+  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    wgpu_context->cmd_enc, &render_pass.descriptor);
+  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  ASSERT(command_buffer != NULL)
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // One element count per frame, the UI shows the progress
+  if (results.count < results.total) {
+    run_next_benchmark(context->wgpu_context);
+  }
+
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return 0;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return 1;
+  }
+  return example_draw(context);
+}
+
+// Clean up used resources
+static void example_destroy(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+  wgpu_compute_primitives_destroy(compute_primitives);
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.source_keys)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.source_values)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.keys)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.values)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.flags)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.output)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.output_count)
+  WGPU_RELEASE_RESOURCE(Buffer, buffers.readback)
+  WGPU_RELEASE_RESOURCE(Buffer, timestamps.readback_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, timestamps.resolve_buffer)
+  WGPU_RELEASE_RESOURCE(QuerySet, timestamps.query_set)
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]                = {"--max-keys="};
+  char* filters_flag[1]              = {"--help-compute-primitives"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  int32_t key_count                = (int32_t)MAX_NUM_KEYS;
+  struct argparse_option options[] = {
+    OPT_INTEGER(0, "max-keys", &key_count,
+                "largest measured element count (1K to 16M)", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-compute-primitives", NULL,
+                "show the compute primitives options", argparse_help_cb_no_exit,
+                0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  max_keys = (uint32_t)CLAMP(key_count, (int32_t)MIN_NUM_KEYS,
+                             (int32_t)MAX_NUM_KEYS);
+}
+
+void example_compute_primitives(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title   = example_title,
+      .overlay = true,
+      .vsync   = true,
+    },
+    .example_initialize_func = &example_initialize,
+    .example_render_func     = &example_render,
+    .example_destroy_func    = &example_destroy,
+  });
+  // clang-format on
+}
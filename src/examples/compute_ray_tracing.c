@@ -1,8 +1,12 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <float.h>
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../core/bvh.h"
+#include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
@@ -11,6 +15,18 @@
  * Simple GPU ray tracer with shadows and reflections using a compute shader. No
  * scene geometry is rendered in the graphics pass.
  *
+ * Besides the analytic spheres and planes, the scene contains a triangle mesh
+ * loaded from a glTF file (--model=<file>, models/venus.gltf by default). The
+ * mesh is accelerated by a BVH built on the CPU and flattened into a storage
+ * buffer, which the shader traverses without a stack, so the cost of a ray
+ * grows logarithmically with the triangle count.
+ *
+ * The image is traced in tiles, a configurable number of tiles per frame, and
+ * the samples of a pixel are accumulated with sub-pixel jitter while the light
+ * and the camera stay in place (pause the example to let the image converge).
+ * The rays traced per frame are counted on the GPU and read back
+ * asynchronously to show the ray throughput.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/computeraytracing
  * -------------------------------------------------------------------------- */
@@ -23,6 +39,13 @@
 #define TEX_DIM 2048
 #endif
 
+// Size of the square image tiles in pixels
+#define TILE_SIZE 128u
+#define TILE_COUNT ((TEX_DIM / TILE_SIZE) * (TEX_DIM / TILE_SIZE))
+
+// Ray counter readbacks in flight
+#define RAY_COUNTER_READBACK_COUNT 3u
+
 static texture_t texture_compute_target = {0};
 static uint32_t current_id
   = 0; // Id used to identify objects by the ray tracing shader
@@ -47,6 +70,11 @@ static struct {
       spheres; // (Shader) storage buffer object with scene spheres
     struct wgpu_buffer_t
       planes; // (Shader) storage buffer object with scene planes
+    struct wgpu_buffer_t nodes;     // Flattened BVH of the mesh
+    struct wgpu_buffer_t triangles; // Mesh triangles in BVH order
+    struct wgpu_buffer_t
+      accumulation; // Accumulated samples of the ray traced image
+    struct wgpu_buffer_t ray_counter; // Number of rays traced per frame
   } storage_buffers;
   struct wgpu_buffer_t
     uniform_buffer; // Uniform buffer object containing scene data
@@ -60,12 +88,45 @@ static struct {
     vec4 fogColor;
     struct {
       vec3 pos;
-      vec3 lookat;
       float fov;
+      vec3 lookat;
+      float _pad;
     } camera;
+    vec3 meshDiffuse;
+    float meshSpecular;
+    uint32_t sphereCount;
+    uint32_t planeCount;
+    uint32_t nodeCount; // BVH nodes, 0 = no mesh
+    uint32_t tileCount; // Tiles of the image
+    uint32_t tileStart; // First tile traced in the frame
+    uint32_t _pad[3];
   } ubo;
 } compute;
 
+// Progressive accumulation of the ray traced image
+static struct {
+  bool restart; // Clears the accumulated samples in the next frame
+  vec3 light_pos;
+  vec3 camera_pos;
+  int32_t tiles_per_frame;
+  uint32_t sample_count; // Samples per pixel of the last fully traced frame
+  uint32_t traced_tiles;
+} accumulation = {
+  .restart         = true,
+  .tiles_per_frame = (int32_t)TILE_COUNT,
+};
+
+// Asynchronous readback of the ray counter, see wgpu_buffer_read_async()
+static struct {
+  struct {
+    bool pending;     // Readback in flight, not available for the next frame
+    float frame_time; // Frame time of the frame that wrote the counter
+  } readbacks[RAY_COUNTER_READBACK_COUNT];
+  uint32_t readback_index;
+  uint32_t ray_count;
+  float frame_time;
+} ray_stats = {0};
+
 // Render pass descriptor for frame buffer writes
 static struct {
   WGPURenderPassColorAttachment color_attachments[1];
@@ -92,6 +153,20 @@ typedef struct plane_t {
   int32_t _pad[3];
 } plane_t;
 
+// BVH triangle, first vertex and the edges from it
+typedef struct triangle_t {
+  vec4 v0;
+  vec4 e1;
+  vec4 e2;
+} triangle_t;
+
+// Command line options
+static struct {
+  const char* model;
+} options = {
+  .model = "models/venus.gltf",
+};
+
 // Other variables
 static const char* example_title = "Compute Shader Ray Tracing";
 static bool prepared             = false;
@@ -183,18 +258,100 @@ void init_plane(plane_t* plane, vec3 normal, float distance, vec3 diffuse,
   plane->specular = specular;
 }
 
+// Loads the mesh, fits it into the bounding sphere of the replaced sphere and
+// builds its BVH, returns the number of BVH nodes or 0 if no mesh was loaded
+static uint32_t prepare_mesh(wgpu_context_t* wgpu_context, vec3 center,
+                             float radius)
+{
+  const uint32_t gltf_loading_flags
+    = WGPU_GLTF_FileLoadingFlags_PreTransformVertices
+      | WGPU_GLTF_FileLoadingFlags_DontLoadImages
+      | WGPU_GLTF_FileLoadingFlags_RetainTriangles;
+  struct gltf_model_t* model
+    = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
+      .wgpu_context       = wgpu_context,
+      .filename           = options.model,
+      .file_loading_flags = gltf_loading_flags,
+    });
+  uint32_t triangle_count = 0;
+  const float* positions
+    = model ? wgpu_gltf_model_get_triangles(model, &triangle_count) : NULL;
+  if (triangle_count == 0) {
+    log_warn("No triangles loaded from %s, tracing spheres only\n",
+             options.model);
+    wgpu_gltf_model_destroy(model);
+    return 0;
+  }
+
+  // Scale the largest extent of the mesh to the sphere diameter and flip y
+  vec3 min = {FLT_MAX, FLT_MAX, FLT_MAX}, max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+    glm_vec3_minv(min, (float*)&positions[i * 3], min);
+    glm_vec3_maxv(max, (float*)&positions[i * 3], max);
+  }
+  vec3 extent, mid;
+  glm_vec3_sub(max, min, extent);
+  glm_vec3_center(min, max, mid);
+  const float scale = 2.0f * radius / MAX(glm_vec3_max(extent), 1e-6f);
+  float* vertices   = malloc(triangle_count * 9 * sizeof(float));
+  for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+    vec3 pos;
+    glm_vec3_sub((float*)&positions[i * 3], mid, pos);
+    glm_vec3_scale(pos, scale, pos);
+    pos[1] = -pos[1];
+    glm_vec3_add(pos, center, &vertices[i * 3]);
+  }
+  wgpu_gltf_model_destroy(model);
+
+  // Flatten the hierarchy, the triangles are stored in the order of the leaves
+  bvh_t* bvh            = bvh_create(vertices, triangle_count);
+  triangle_t* triangles = malloc(triangle_count * sizeof(triangle_t));
+  for (uint32_t i = 0; i < triangle_count; ++i) {
+    const float* v = &vertices[bvh->triangle_indices[i] * 9];
+    glm_vec4_copy((vec4){v[0], v[1], v[2], 0.0f}, triangles[i].v0);
+    glm_vec4_copy((vec4){v[3] - v[0], v[4] - v[1], v[5] - v[2], 0.0f},
+                  triangles[i].e1);
+    glm_vec4_copy((vec4){v[6] - v[0], v[7] - v[1], v[8] - v[2], 0.0f},
+                  triangles[i].e2);
+  }
+  log_info("BVH of %u triangles: %u nodes, depth %u\n", triangle_count,
+           bvh->node_count, bvh->depth);
+
+  compute.storage_buffers.nodes = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst
+                             | WGPUBufferUsage_Storage,
+                    .size         = bvh->node_count * sizeof(bvh_node_t),
+                    .initial.data = bvh->nodes,
+                  });
+  compute.storage_buffers.triangles = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst
+                             | WGPUBufferUsage_Storage,
+                    .size         = triangle_count * sizeof(triangle_t),
+                    .initial.data = triangles,
+                  });
+
+  const uint32_t node_count = bvh->node_count;
+  bvh_destroy(bvh);
+  free(triangles);
+  free(vertices);
+
+  return node_count;
+}
+
 // Setup and fill the compute shader storage buffers containing primitives for
 // the raytraced scene
 static void prepare_storage_buffers(wgpu_context_t* wgpu_context)
 {
-  // Spheres
+  // Spheres, the mesh replaces the last one
   static sphere_t spheres[3] = {0};
   init_sphere(&spheres[0], (vec3){1.75f, -0.5f, 0.0f}, 1.0f,
               (vec3){0.0f, 1.0f, 0.0f}, 32.0f);
-  init_sphere(&spheres[1], (vec3){0.0f, 1.0f, -0.5f}, 1.0f,
-              (vec3){0.65f, 0.77f, 0.97f}, 32.0f);
-  init_sphere(&spheres[2], (vec3){-1.75f, -0.75f, -0.5f}, 1.25f,
+  init_sphere(&spheres[1], (vec3){-1.75f, -0.75f, -0.5f}, 1.25f,
               (vec3){0.9f, 0.76f, 0.46f}, 32.0f);
+  init_sphere(&spheres[2], (vec3){0.0f, 1.0f, -0.5f}, 1.0f,
+              (vec3){0.65f, 0.77f, 0.97f}, 32.0f);
   uint64_t storage_buffer_size = ARRAY_SIZE(spheres) * sizeof(sphere_t);
 
   // Stage
@@ -235,6 +392,41 @@ static void prepare_storage_buffers(wgpu_context_t* wgpu_context)
                     .size         = storage_buffer_size,
                     .initial.data = &planes,
                   });
+
+  // Mesh, the bindings need non-empty buffers without one
+  compute.ubo.nodeCount
+    = prepare_mesh(wgpu_context, spheres[2].pos, spheres[2].radius);
+  compute.ubo.sphereCount = compute.ubo.nodeCount > 0 ? 2 : 3;
+  compute.ubo.planeCount  = (uint32_t)ARRAY_SIZE(planes);
+  glm_vec3_copy(spheres[2].diffuse, compute.ubo.meshDiffuse);
+  compute.ubo.meshSpecular = spheres[2].specular;
+  if (compute.ubo.nodeCount == 0) {
+    compute.storage_buffers.nodes = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .usage = WGPUBufferUsage_Storage,
+                      .size  = sizeof(bvh_node_t),
+                    });
+    compute.storage_buffers.triangles = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .usage = WGPUBufferUsage_Storage,
+                      .size  = sizeof(triangle_t),
+                    });
+  }
+
+  // Accumulated samples per pixel and the ray counter
+  compute.storage_buffers.accumulation = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = (uint64_t)TEX_DIM * TEX_DIM * sizeof(vec4),
+                  });
+  compute.storage_buffers.ray_counter = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_CopySrc
+                             | WGPUBufferUsage_Storage,
+                    .size  = sizeof(uint32_t),
+                  });
+  // Readbacks of a previous run are dropped by the context reset
+  memset(&ray_stats, 0, sizeof(ray_stats));
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -402,11 +594,328 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+// clang-format off
+static const char* ray_tracing_scene_wgsl = CODE(
+  const EPSILON = 0.0001;
+  const MAXLEN = 1000.0;
+  const SHADOW = 0.5;
+  const LEAF_COUNT_BITS = 3u;
+  const LEAF_COUNT_MASK = 7u;
+
+  struct Camera {
+    pos : vec3<f32>,
+    fov : f32,
+    lookat : vec3<f32>,
+  }
+
+  struct UBO {
+    light_pos : vec3<f32>,
+    aspect_ratio : f32,
+    fog_color : vec4<f32>,
+    camera : Camera,
+    mesh_diffuse : vec3<f32>,
+    mesh_specular : f32,
+    sphere_count : u32,
+    plane_count : u32,
+    node_count : u32,
+    tile_count : u32,
+    tile_start : u32,
+  }
+
+  struct Sphere {
+    pos : vec3<f32>,
+    radius : f32,
+    diffuse : vec3<f32>,
+    specular : f32,
+    id : u32,
+  }
+
+  struct Plane {
+    normal : vec3<f32>,
+    distance : f32,
+    diffuse : vec3<f32>,
+    specular : f32,
+    id : u32,
+  }
+
+  // Flattened BVH node, see core/bvh.h
+  struct BVHNode {
+    aabb_min : vec3<f32>,
+    miss_index : u32,
+    aabb_max : vec3<f32>,
+    primitives : u32,
+  }
+
+  // First vertex and the two edges from it
+  struct Triangle {
+    v0 : vec4<f32>,
+    e1 : vec4<f32>,
+    e2 : vec4<f32>,
+  }
+
+  struct Hit {
+    t : f32,
+    normal : vec3<f32>,
+    diffuse : vec3<f32>,
+    specular : f32,
+  }
+
+  @group(0) @binding(1) var<uniform> ubo : UBO;
+  @group(0) @binding(2) var<storage, read> spheres : array<Sphere>;
+  @group(0) @binding(3) var<storage, read> planes : array<Plane>;
+  @group(0) @binding(4) var<storage, read> nodes : array<BVHNode>;
+  @group(0) @binding(5) var<storage, read> triangles : array<Triangle>;
+
+  fn sphere_intersect(ro : vec3<f32>, rd : vec3<f32>, s : Sphere) -> f32 {
+    let oc = ro - s.pos;
+    let b = dot(oc, rd);
+    let c = dot(oc, oc) - s.radius * s.radius;
+    let h = b * b - c;
+    if (h < 0.0) {
+      return -1.0;
+    }
+    return -b - sqrt(h);
+  }
+
+  fn plane_intersect(ro : vec3<f32>, rd : vec3<f32>, p : Plane) -> f32 {
+    let d = dot(rd, p.normal);
+    if (d == 0.0) {
+      return -1.0;
+    }
+    return -(p.distance + dot(ro, p.normal)) / d;
+  }
+
+  fn box_intersect(ro : vec3<f32>, inv_rd : vec3<f32>, node : BVHNode,
+                   t_max : f32) -> bool {
+    let t0 = (node.aabb_min - ro) * inv_rd;
+    let t1 = (node.aabb_max - ro) * inv_rd;
+    let t_min = min(t0, t1);
+    let t_far = max(t0, t1);
+    let t_enter = max(max(t_min.x, t_min.y), max(t_min.z, 0.0));
+    let t_exit = min(min(t_far.x, t_far.y), min(t_far.z, t_max));
+    return t_enter <= t_exit;
+  }
+
+  // Moeller-Trumbore, returns the ray distance or -1
+  fn triangle_intersect(ro : vec3<f32>, rd : vec3<f32>,
+                        tri : Triangle) -> f32 {
+    let p = cross(rd, tri.e2.xyz);
+    let det = dot(tri.e1.xyz, p);
+    if (abs(det) < 1e-10) {
+      return -1.0;
+    }
+    let inv_det = 1.0 / det;
+    let s = ro - tri.v0.xyz;
+    let u = dot(s, p) * inv_det;
+    let q = cross(s, tri.e1.xyz);
+    let v = dot(rd, q) * inv_det;
+    if (u < 0.0 || v < 0.0 || u + v > 1.0) {
+      return -1.0;
+    }
+    return dot(tri.e2.xyz, q) * inv_det;
+  }
+);
+
+static const char* ray_tracing_bvh_wgsl = CODE(
+  // Stackless BVH traversal, returns the closest triangle in (EPSILON, t_max)
+  // or -1, t_max receives its distance
+  fn mesh_intersect(ro : vec3<f32>, rd : vec3<f32>,
+                    t_max : ptr<function, f32>) -> i32 {
+    let inv_rd = 1.0 / rd;
+    var hit = -1;
+    var i = 0u;
+    loop {
+      if (i >= ubo.node_count) {
+        break;
+      }
+      let node = nodes[i];
+      if (!box_intersect(ro, inv_rd, node, *t_max)) {
+        i = node.miss_index;
+        continue;
+      }
+      let count = node.primitives & LEAF_COUNT_MASK;
+      if (count == 0u) {
+        i = i + 1u;
+        continue;
+      }
+      let first = node.primitives >> LEAF_COUNT_BITS;
+      for (var k = first; k < first + count; k = k + 1u) {
+        let t = triangle_intersect(ro, rd, triangles[k]);
+        if (t > EPSILON && t < *t_max) {
+          *t_max = t;
+          hit = i32(k);
+        }
+      }
+      i = node.miss_index;
+    }
+    return hit;
+  }
+
+  fn intersect(ro : vec3<f32>, rd : vec3<f32>) -> Hit {
+    var hit : Hit;
+    hit.t = MAXLEN;
+    for (var i = 0u; i < ubo.sphere_count; i = i + 1u) {
+      let t = sphere_intersect(ro, rd, spheres[i]);
+      if (t > EPSILON && t < hit.t) {
+        hit.t = t;
+        hit.normal = normalize(ro + t * rd - spheres[i].pos);
+        hit.diffuse = spheres[i].diffuse;
+        hit.specular = spheres[i].specular;
+      }
+    }
+    for (var i = 0u; i < ubo.plane_count; i = i + 1u) {
+      let t = plane_intersect(ro, rd, planes[i]);
+      if (t > EPSILON && t < hit.t) {
+        hit.t = t;
+        hit.normal = planes[i].normal;
+        hit.diffuse = planes[i].diffuse;
+        hit.specular = planes[i].specular;
+      }
+    }
+    var t_mesh = hit.t;
+    let k = mesh_intersect(ro, rd, &t_mesh);
+    if (k >= 0) {
+      let tri = triangles[k];
+      let n = normalize(cross(tri.e1.xyz, tri.e2.xyz));
+      hit.t = t_mesh;
+      hit.normal = faceForward(n, rd, n);
+      hit.diffuse = ubo.mesh_diffuse;
+      hit.specular = ubo.mesh_specular;
+    }
+    return hit;
+  }
+
+  fn in_shadow(ro : vec3<f32>, rd : vec3<f32>, light_dist : f32) -> bool {
+    for (var i = 0u; i < ubo.sphere_count; i = i + 1u) {
+      let t = sphere_intersect(ro, rd, spheres[i]);
+      if (t > EPSILON && t < light_dist) {
+        return true;
+      }
+    }
+    var t_mesh = light_dist;
+    return mesh_intersect(ro, rd, &t_mesh) >= 0;
+  }
+);
+
+static const char* ray_tracing_main_wgsl = CODE(
+  const RAYBOUNCES = 2;
+  const REFLECTIONSTRENGTH = 0.4;
+  const REFLECTIONFALLOFF = 0.5;
+  const TILE_SIZE = 128u;
+
+  @group(0) @binding(0)
+  var result_image : texture_storage_2d<rgba8unorm, write>;
+  // Sum of the samples of a pixel, w = sample count
+  @group(0) @binding(6)
+  var<storage, read_write> accumulation : array<vec4<f32>>;
+  @group(0) @binding(7) var<storage, read_write> ray_counter : atomic<u32>;
+
+  var<workgroup> workgroup_rays : atomic<u32>;
+
+  fn light_diffuse(normal : vec3<f32>, light_dir : vec3<f32>) -> f32 {
+    return clamp(dot(normal, light_dir), 0.1, 1.0);
+  }
+
+  fn light_specular(normal : vec3<f32>, light_dir : vec3<f32>,
+                    specular_factor : f32) -> f32 {
+    let view_vec = normalize(ubo.camera.pos);
+    let half_vec = normalize(light_dir + view_vec);
+    return pow(clamp(dot(normal, half_vec), 0.0, 1.0), specular_factor);
+  }
+
+  fn fog(t : f32, color : vec3<f32>) -> vec3<f32> {
+    return mix(color, ubo.fog_color.rgb, clamp(t / 20.0, 0.0, 1.0));
+  }
+
+  // Shades the closest hit and reflects the ray, w = number of rays traced
+  fn render_scene(ro : ptr<function, vec3<f32>>,
+                  rd : ptr<function, vec3<f32>>) -> vec4<f32> {
+    let hit = intersect(*ro, *rd);
+    if (hit.t >= MAXLEN) {
+      return vec4(0.0, 0.0, 0.0, 1.0);
+    }
+    let pos = *ro + hit.t * *rd;
+    let light_vec = normalize(ubo.light_pos - pos);
+    var color = light_diffuse(hit.normal, light_vec) * hit.diffuse
+                + light_specular(hit.normal, light_vec, hit.specular);
+    let light_dist = length(ubo.light_pos - pos);
+    if (in_shadow(pos, light_vec, light_dist)) {
+      color = color * SHADOW;
+    }
+    color = fog(hit.t, color);
+    *rd = reflect(*rd, hit.normal);
+    *ro = pos;
+    return vec4(color, 2.0);
+  }
+
+  fn hash(x : u32) -> u32 {
+    var h = x;
+    h = (h ^ (h >> 16u)) * 0x7feb352du;
+    h = (h ^ (h >> 15u)) * 0x846ca68bu;
+    return h ^ (h >> 16u);
+  }
+
+  // Sub-pixel offset of a sample, the first sample is the pixel center
+  fn sample_offset(pixel_index : u32, sample_index : u32) -> vec2<f32> {
+    if (sample_index == 0u) {
+      return vec2(0.5);
+    }
+    let h = hash(pixel_index ^ hash(sample_index));
+    return vec2(f32(h & 0xffffu), f32(h >> 16u)) / 65536.0;
+  }
+
+  // One workgroup z layer per tile, the tiles of a frame start at tile_start
+  @compute @workgroup_size(8, 8, 1)
+  fn main(@builtin(workgroup_id) workgroup_id : vec3<u32>,
+          @builtin(local_invocation_id) local_id : vec3<u32>,
+          @builtin(local_invocation_index) local_index : u32) {
+    let dim = textureDimensions(result_image);
+    let tiles_x = (dim.x + TILE_SIZE - 1u) / TILE_SIZE;
+    let tile = (ubo.tile_start + workgroup_id.z) % ubo.tile_count;
+    let pixel = vec2(tile % tiles_x, tile / tiles_x) * TILE_SIZE
+                + workgroup_id.xy * 8u + local_id.xy;
+    var rays = 0u;
+    if (all(pixel < dim)) {
+      let index = pixel.y * dim.x + pixel.x;
+      var acc = accumulation[index];
+      let uv = (vec2<f32>(pixel) + sample_offset(index, u32(acc.w)))
+               / vec2<f32>(dim);
+      var ro = ubo.camera.pos;
+      var rd = normalize(
+        vec3((-1.0 + 2.0 * uv) * vec2(ubo.aspect_ratio, 1.0), -1.0));
+
+      let primary = render_scene(&ro, &rd);
+      var final_color = primary.rgb;
+      rays = u32(primary.w);
+      var reflection_strength = REFLECTIONSTRENGTH;
+      for (var i = 0; i < RAYBOUNCES; i = i + 1) {
+        let reflection = render_scene(&ro, &rd);
+        final_color = (1.0 - reflection_strength) * final_color
+                      + reflection_strength
+                          * mix(reflection.rgb, final_color,
+                                1.0 - reflection_strength);
+        reflection_strength = reflection_strength * REFLECTIONFALLOFF;
+        rays = rays + u32(reflection.w);
+      }
+
+      acc = acc + vec4(final_color, 1.0);
+      accumulation[index] = acc;
+      textureStore(result_image, pixel, vec4(acc.rgb / acc.w, 0.0));
+    }
+    atomicAdd(&workgroup_rays, rays);
+    workgroupBarrier();
+    if (local_index == 0u) {
+      atomicAdd(&ray_counter, atomicLoad(&workgroup_rays));
+    }
+  }
+);
+// clang-format on
+
 // Prepare the compute pipeline that generates the ray traced image
 static void prepare_compute(wgpu_context_t* wgpu_context)
 {
   /* Compute pipeline layout */
-  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+  WGPUBindGroupLayoutEntry bgl_entries[8] = {
     [0] = (WGPUBindGroupLayoutEntry) {
       // Binding 0 : Storage image (raytraced output)
       .binding    = 0,
@@ -429,25 +938,65 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
       .sampler = {0},
     },
     [2] = (WGPUBindGroupLayoutEntry) {
-      // Binding 2: Shader storage buffer for the spheres
+      // Binding 2 : Shader storage buffer for the spheres
       .binding    = 2,
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
-        .type           = WGPUBufferBindingType_Storage,
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
         .minBindingSize = compute.storage_buffers.spheres.size,
       },
       .sampler = {0},
     },
     [3] = (WGPUBindGroupLayoutEntry) {
-      // Binding 3: Shader storage buffer for the planes
+      // Binding 3 : Shader storage buffer for the planes
       .binding    = 3,
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
-        .type           = WGPUBufferBindingType_Storage,
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
         .minBindingSize = compute.storage_buffers.planes.size,
       },
       .sampler = {0},
     },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      // Binding 4 : Shader storage buffer for the BVH nodes
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = compute.storage_buffers.nodes.size,
+      },
+      .sampler = {0},
+    },
+    [5] = (WGPUBindGroupLayoutEntry) {
+      // Binding 5 : Shader storage buffer for the mesh triangles
+      .binding    = 5,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = compute.storage_buffers.triangles.size,
+      },
+      .sampler = {0},
+    },
+    [6] = (WGPUBindGroupLayoutEntry) {
+      // Binding 6 : Shader storage buffer for the accumulated samples
+      .binding    = 6,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = compute.storage_buffers.accumulation.size,
+      },
+      .sampler = {0},
+    },
+    [7] = (WGPUBindGroupLayoutEntry) {
+      // Binding 7 : Shader storage buffer for the ray counter
+      .binding    = 7,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = compute.storage_buffers.ray_counter.size,
+      },
+      .sampler = {0},
+    },
   };
   WGPUBindGroupLayoutDescriptor bgl_desc = {
     .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
@@ -466,33 +1015,61 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
   ASSERT(compute.pipeline_layout != NULL)
 
   /* Compute pipeline bind group */
-  WGPUBindGroupEntry bg_entries[4] = {
+  WGPUBindGroupEntry bg_entries[8] = {
     [0] = (WGPUBindGroupEntry) {
-      // Binding 0: Output storage image
+      // Binding 0 : Output storage image
       .binding     = 0,
       .textureView = texture_compute_target.view,
     },
     [1] = (WGPUBindGroupEntry) {
-     // Binding 1 : Uniform buffer
+      // Binding 1 : Uniform buffer
       .binding = 1,
       .buffer  = compute.uniform_buffer.buffer,
       .offset  = 0,
       .size    = compute.uniform_buffer.size,
     },
     [2] = (WGPUBindGroupEntry) {
-     // Binding 2: Shader storage buffer for the spheres
+      // Binding 2 : Shader storage buffer for the spheres
       .binding = 2,
       .buffer  = compute.storage_buffers.spheres.buffer,
       .offset  = 0,
       .size    = compute.storage_buffers.spheres.size,
     },
     [3] = (WGPUBindGroupEntry) {
-     // Binding 3: Shader storage buffer for the planes
+      // Binding 3 : Shader storage buffer for the planes
       .binding = 3,
       .buffer  = compute.storage_buffers.planes.buffer,
       .offset  = 0,
       .size    = compute.storage_buffers.planes.size,
     },
+    [4] = (WGPUBindGroupEntry) {
+      // Binding 4 : Shader storage buffer for the BVH nodes
+      .binding = 4,
+      .buffer  = compute.storage_buffers.nodes.buffer,
+      .offset  = 0,
+      .size    = compute.storage_buffers.nodes.size,
+    },
+    [5] = (WGPUBindGroupEntry) {
+      // Binding 5 : Shader storage buffer for the mesh triangles
+      .binding = 5,
+      .buffer  = compute.storage_buffers.triangles.buffer,
+      .offset  = 0,
+      .size    = compute.storage_buffers.triangles.size,
+    },
+    [6] = (WGPUBindGroupEntry) {
+      // Binding 6 : Shader storage buffer for the accumulated samples
+      .binding = 6,
+      .buffer  = compute.storage_buffers.accumulation.buffer,
+      .offset  = 0,
+      .size    = compute.storage_buffers.accumulation.size,
+    },
+    [7] = (WGPUBindGroupEntry) {
+      // Binding 7 : Shader storage buffer for the ray counter
+      .binding = 7,
+      .buffer  = compute.storage_buffers.ray_counter.buffer,
+      .offset  = 0,
+      .size    = compute.storage_buffers.ray_counter.size,
+    },
   };
   WGPUBindGroupDescriptor bg_desc = {
     .layout     = compute.bind_group_layout,
@@ -502,23 +1079,39 @@ static void prepare_compute(wgpu_context_t* wgpu_context)
   compute.bind_group
     = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
 
-  /* Compute shader */
-  wgpu_shader_t particle_comp_shader = wgpu_shader_create(
+  /* Compute shader, the scene declarations are shared by both parts */
+  const char* sources[3] = {ray_tracing_scene_wgsl, ray_tracing_bvh_wgsl,
+                            ray_tracing_main_wgsl};
+  size_t length          = 1;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(sources); ++i) {
+    length += strlen(sources[i]) + 1;
+  }
+  char* wgsl_code = (char*)malloc(length);
+  wgsl_code[0]    = '\0';
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(sources); ++i) {
+    strcat(wgsl_code, sources[i]);
+    strcat(wgsl_code, "\n");
+  }
+  wgpu_shader_t ray_tracing_comp_shader = wgpu_shader_create(
     wgpu_context, &(wgpu_shader_desc_t){
-                    // Compute shader SPIR-V
-                    .file = "shaders/compute_ray_tracing/raytracing.comp.spv",
+                    // Compute shader WGSL
+                    .label            = "ray_tracing_compute_shader",
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "main",
                   });
+  free(wgsl_code);
 
   /* Create pipeline */
   compute.pipeline = wgpuDeviceCreateComputePipeline(
     wgpu_context->device,
     &(WGPUComputePipelineDescriptor){
+      .label   = "ray_tracing_compute_pipeline",
       .layout  = compute.pipeline_layout,
-      .compute = particle_comp_shader.programmable_stage_descriptor,
+      .compute = ray_tracing_comp_shader.programmable_stage_descriptor,
     });
 
   /* Partial clean-up */
-  wgpu_shader_release(&particle_comp_shader);
+  wgpu_shader_release(&ray_tracing_comp_shader);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -531,6 +1124,26 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   compute.ubo.lightPos[2] = 0.0f + cos(glm_rad(timer * 360.0f)) * 2.0f;
   glm_vec3_scale(context->camera->position, -1.0f, compute.ubo.camera.pos);
 
+  // Restart the accumulation when the light or the camera moved
+  if (!glm_vec3_eqv(compute.ubo.lightPos, accumulation.light_pos)
+      || !glm_vec3_eqv(compute.ubo.camera.pos, accumulation.camera_pos)) {
+    glm_vec3_copy(compute.ubo.lightPos, accumulation.light_pos);
+    glm_vec3_copy(compute.ubo.camera.pos, accumulation.camera_pos);
+    accumulation.restart = true;
+  }
+
+  // Continue with the tiles following the ones of the last frame
+  if (accumulation.restart) {
+    compute.ubo.tileStart     = 0;
+    accumulation.sample_count = 0;
+    accumulation.traced_tiles = 0;
+  }
+  else {
+    compute.ubo.tileStart
+      = (compute.ubo.tileStart + (uint32_t)accumulation.tiles_per_frame)
+        % TILE_COUNT;
+  }
+
   // Map uniform buffer and update it
   wgpu_queue_write_buffer(context->wgpu_context, compute.uniform_buffer.buffer,
                           0, &compute.ubo, compute.uniform_buffer.size);
@@ -545,6 +1158,7 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   glm_vec3_copy((vec3){0.0f, 0.5f, 0.0f}, compute.ubo.camera.lookat);
   compute.ubo.camera.fov  = 10.0f;
   compute.ubo.aspectRatio = context->window_size.aspect_ratio;
+  compute.ubo.tileCount   = TILE_COUNT;
   context->timer_speed *= 0.25f;
 
   // Compute shader parameter uniform buffer block
@@ -579,23 +1193,78 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+// Rays per second of the last counter read back, spread over the GPU time of
+// the tracing if timestamps are available and the frame time otherwise
+static float get_mrays_per_second(wgpu_context_t* wgpu_context)
+{
+  float time_ms = ray_stats.frame_time * 1000.0f;
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(wgpu_context->profiler);
+  const uint32_t scope_count
+    = wgpu_profiler_get_scope_count(wgpu_context->profiler);
+  for (uint32_t i = 0; i < scope_count; ++i) {
+    if (strcmp(scopes[i].name, "Ray tracing") == 0) {
+      time_ms = scopes[i].avg_gpu_time_ms;
+    }
+  }
+  return (time_ms > 0.0f) ? (float)ray_stats.ray_count / (time_ms * 1000.0f) :
+                            0.0f;
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    imgui_overlay_slider_int(context->imgui_overlay, "Tiles per frame",
+                             &accumulation.tiles_per_frame, 1,
+                             (int32_t)TILE_COUNT);
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("BVH nodes: %u", compute.ubo.nodeCount);
+    imgui_overlay_text("Samples per pixel: %u", accumulation.sample_count);
+    imgui_overlay_text("Rays per frame: %u", ray_stats.ray_count);
+    imgui_overlay_text("Mrays/s: %.1f",
+                       get_mrays_per_second(context->wgpu_context));
+  }
+}
+
+static void ray_counter_readback_callback(const void* data, uint64_t size,
+                                          void* user_data)
+{
+  const uint32_t index = (uint32_t)(uintptr_t)user_data;
+
+  if (data != NULL && size >= sizeof(uint32_t)) {
+    ray_stats.ray_count  = *(const uint32_t*)data;
+    ray_stats.frame_time = ray_stats.readbacks[index].frame_time;
   }
+  ray_stats.readbacks[index].pending = false;
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
 
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Compute pass: generated ray traced image
+  // Restart the accumulation and reset the ray counter
+  if (accumulation.restart) {
+    wgpuCommandEncoderClearBuffer(wgpu_context->cmd_enc,
+                                  compute.storage_buffers.accumulation.buffer,
+                                  0, compute.storage_buffers.accumulation.size);
+    accumulation.restart = false;
+  }
+  wgpuCommandEncoderClearBuffer(wgpu_context->cmd_enc,
+                                compute.storage_buffers.ray_counter.buffer, 0,
+                                compute.storage_buffers.ray_counter.size);
+
+  // Compute pass: generated ray traced image, one workgroup layer per tile
   {
+    wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                              "Ray tracing");
     wgpu_context->cpass_enc
       = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
     // Dispatch the compute job
@@ -604,10 +1273,14 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
                                        compute.bind_group, 0, NULL);
     wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc, texture_compute_target.size.width / 16,
-      texture_compute_target.size.height / 16, 1);
+      wgpu_context->cpass_enc, TILE_SIZE / 8, TILE_SIZE / 8,
+      (uint32_t)accumulation.tiles_per_frame);
     wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
     WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+    wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
+
+    accumulation.traced_tiles += (uint32_t)accumulation.tiles_per_frame;
+    accumulation.sample_count = accumulation.traced_tiles / TILE_COUNT;
   }
 
   // Display ray traced image generated by compute shader as a full screen quad
@@ -645,11 +1318,24 @@ static int example_draw(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   // Submit to queue
   submit_command_buffers(context);
 
+  // Read the ray counter of this frame back if a readback slot is available,
+  // it is copied after the frame
+  const uint32_t index = ray_stats.readback_index;
+  if (!ray_stats.readbacks[index].pending
+      && wgpu_buffer_read_async(
+        wgpu_context, compute.storage_buffers.ray_counter.buffer, 0,
+        sizeof(uint32_t), ray_counter_readback_callback,
+        (void*)(uintptr_t)index)) {
+    ray_stats.readbacks[index].pending    = true;
+    ray_stats.readbacks[index].frame_time = context->frame_timer;
+    ray_stats.readback_index = (index + 1) % RAY_COUNTER_READBACK_COUNT;
+  }
+
   // Submit frame
   submit_frame(context);
 
@@ -662,9 +1348,8 @@ static int example_render(wgpu_example_context_t* context)
     return 1;
   }
   const int draw_result = example_draw(context);
-  if (!context->paused) {
-    update_uniform_buffers(context);
-  }
+  // The timer stands still while paused, so the accumulation continues
+  update_uniform_buffers(context);
   return draw_result;
 }
 
@@ -684,6 +1369,10 @@ static void example_destroy(wgpu_example_context_t* context)
   // Compute
   WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.spheres.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.planes.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.nodes.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.triangles.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.accumulation.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, compute.storage_buffers.ray_counter.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, compute.uniform_buffer.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, compute.bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_group)
@@ -691,8 +1380,45 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
 }
 
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]                = {"--model="};
+  char* filters_flag[1]              = {"--help-compute-ray-tracing"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option argparse_options[] = {
+    OPT_STRING(0, "model", &options.model,
+               "glTF model traced with the BVH (default models/venus.gltf)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-compute-ray-tracing", NULL,
+                "show the compute ray tracing options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, argparse_options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+}
+
 void example_compute_ray_tracing(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
@@ -1,15 +1,18 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#include "../webgpu/image_filter.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Compute Shader Image Load/Store
  *
- * Uses a compute shader to apply different convolution kernels (and effects) on
- * an input image in realtime.
+ * Uses a compute shader to apply a chain of convolution kernels (and effects)
+ * on an input image in realtime. Adjacent stages of the chain are fused into
+ * one tiled dispatch, see image_filter.h.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/computeshader
@@ -37,14 +40,19 @@ static struct {
   WGPUPipelineLayout pipeline_layout;    // Layout of the graphics pipeline
 } graphics;
 
+// Stages of the filter chain selectable in the UI
+#define FILTER_CHAIN_LENGTH 4u
+
 // Resources for the compute part of the example
 static struct Compute {
-  WGPUBindGroupLayout bind_group_layout; // Compute shader binding layout
-  WGPUBindGroup bind_group;              // Compute shader bindings
-  WGPUPipelineLayout pipeline_layout;    // Layout of the compute pipeline
-  WGPUComputePipeline pipelines[3];      // Compute pipelines for image filters
-  int32_t pipeline_index; // Current image filtering compute pipeline index
-} compute = {0};
+  wgpu_image_filter_t* filter; // Filter chain applied to the input image
+  int32_t chain[FILTER_CHAIN_LENGTH]; // Kernel of each stage, 0 = none
+  bool fused;                         // Fuse the stages into tiled dispatches
+  float gpu_time_ms;                  // GPU time of the filter chain
+} compute = {
+  .chain = {1 + WGPU_ImageFilter_Emboss, 0, 0, 0},
+  .fused = true,
+};
 
 // Render pass descriptor for frame buffer writes
 static struct {
@@ -56,25 +64,8 @@ static wgpu_buffer_t vertex_buffer;
 static wgpu_buffer_t index_buffer;
 static wgpu_buffer_t uniform_buffer_vs;
 
-// Compute shaders containing convolution kernels (and effects)
-static struct {
-  const char* name;
-  const char* location;
-} compute_shaders[3] = {
-  [0] = {
-    .name     = "emboss",
-    .location = "shaders/compute_shader/emboss.comp.spv",
-  },
-  [1] = {
-    .name     = "edgedetect",
-    .location = "shaders/compute_shader/edgedetect.comp.spv",
-  },
-  [2] = {
-    .name     = "sharpen",
-    .location = "shaders/compute_shader/sharpen.comp.spv",
-  },
-};
-static const char* shader_names[3] = {"emboss", "edgedetect", "sharpen"};
+// Kernel names of the UI, "none" followed by the predefined kernels
+static const char* kernel_names[1 + WGPU_ImageFilter_Count] = {"none"};
 
 static struct {
   mat4 projection;
@@ -423,95 +414,29 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
-static void prepare_compute(wgpu_context_t* wgpu_context)
+// Applies the chain selected in the UI to the filter
+static void update_filter_chain(void)
 {
-  // Compute pipeline bind group layout
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[2] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Input image (read-only)
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Compute,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-        },
-        .sampler = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: Output image (write)
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Compute,
-        .storageTexture = (WGPUStorageTextureBindingLayout) {
-          .access        = WGPUStorageTextureAccess_WriteOnly,
-          .format        = WGPUTextureFormat_RGBA8Unorm,
-          .viewDimension = WGPUTextureViewDimension_2D,
-        },
-        .sampler = {0},
-      },
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-      .entries    = bgl_entries,
-    };
-    compute.bind_group_layout
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(compute.bind_group_layout != NULL)
-  }
-
-  // Compute pipeline layout
-  {
-    WGPUPipelineLayoutDescriptor compute_pipeline_layout_desc = {
-      .bindGroupLayoutCount = 1,
-      .bindGroupLayouts     = &compute.bind_group_layout,
-    };
-    compute.pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      wgpu_context->device, &compute_pipeline_layout_desc);
-    ASSERT(compute.pipeline_layout != NULL)
-  }
-
-  // Compute pipeline bind group
-  {
-    WGPUBindGroupEntry bg_entries[2] = {
-      [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Input image (read-only)
-        .binding     = 0,
-        .textureView = textures.color_map.view,
-      },
-      [1] = (WGPUBindGroupEntry) {
-       // Binding 1: Output image (write)
-        .binding     = 1,
-        .textureView = textures.compute_target.view,
-      },
-    };
-    WGPUBindGroupDescriptor bg_desc = {
-      .layout     = compute.bind_group_layout,
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
-    };
-    compute.bind_group
-      = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-    ASSERT(compute.bind_group != NULL)
+  wgpu_image_filter_stage_t stages[FILTER_CHAIN_LENGTH];
+  uint32_t stage_count = 0;
+  for (uint32_t i = 0; i < FILTER_CHAIN_LENGTH; ++i) {
+    if (compute.chain[i] > 0) {
+      stages[stage_count++] = wgpu_image_filter_get_kernel(
+        (wgpu_image_filter_kernel_enum_t)(compute.chain[i] - 1));
+    }
   }
+  wgpu_image_filter_set_stages(compute.filter, stages, stage_count);
+  wgpu_image_filter_set_fused(compute.filter, compute.fused);
+}
 
-  // One pipeline for each effect
-  for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(compute_shaders); ++i) {
-    // Compute shader
-    wgpu_shader_t comp_shader
-      = wgpu_shader_create(wgpu_context, &(wgpu_shader_desc_t){
-                                           // Compute shader SPIR-V
-                                           .file = compute_shaders[i].location,
-                                         });
-    // Compute pipeline
-    compute.pipelines[i] = wgpuDeviceCreateComputePipeline(
-      wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .layout  = compute.pipeline_layout,
-        .compute = comp_shader.programmable_stage_descriptor,
-      });
-    // Clean-up
-    wgpu_shader_release(&comp_shader);
+static void prepare_compute(wgpu_context_t* wgpu_context)
+{
+  for (uint32_t i = 0; i < WGPU_ImageFilter_Count; ++i) {
+    kernel_names[1 + i]
+      = wgpu_image_filter_get_kernel_name((wgpu_image_filter_kernel_enum_t)i);
   }
+  compute.filter = wgpu_image_filter_create(wgpu_context);
+  update_filter_chain();
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -564,9 +489,35 @@ static int example_initialize(wgpu_example_context_t* context)
 
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
+  // GPU time of the filter chain in the last profiled frame
+  wgpu_profiler_t* profiler = context->wgpu_context->profiler;
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  for (uint32_t i = 0; i < wgpu_profiler_get_scope_count(profiler); ++i) {
+    if (strcmp(scopes[i].name, "Image filter") == 0) {
+      compute.gpu_time_ms = scopes[i].gpu_time_ms;
+    }
+  }
+
   if (imgui_overlay_header("Settings")) {
-    imgui_overlay_combo_box(context->imgui_overlay, "Shader",
-                            &compute.pipeline_index, shader_names, 3);
+    bool chain_changed = false;
+    for (uint32_t i = 0; i < FILTER_CHAIN_LENGTH; ++i) {
+      char caption[16];
+      snprintf(caption, sizeof(caption), "Stage %u", i + 1);
+      chain_changed |= imgui_overlay_combo_box(
+        context->imgui_overlay, caption, &compute.chain[i], kernel_names,
+        (uint32_t)ARRAY_SIZE(kernel_names));
+    }
+    chain_changed |= imgui_overlay_checkBox(context->imgui_overlay,
+                                            "Fuse stages", &compute.fused);
+    if (chain_changed) {
+      update_filter_chain();
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Dispatches: %u",
+                       wgpu_image_filter_get_pass_count(compute.filter));
+    imgui_overlay_text("Filter GPU time: %.3f ms", compute.gpu_time_ms);
   }
 }
 
@@ -578,19 +529,11 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(
-      wgpu_context->cpass_enc, compute.pipelines[compute.pipeline_index]);
-    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
-                                       compute.bind_group, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc, textures.compute_target.size.width / 16,
-      textures.compute_target.size.height / 16, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
+  // Filter chain, recorded in its own compute passes
+  wgpu_image_filter_apply(compute.filter, wgpu_context->cmd_enc,
+                          textures.color_map.view, textures.compute_target.view,
+                          textures.compute_target.size.width,
+                          textures.compute_target.size.height);
 
   // Render pass
   {
@@ -700,12 +643,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, graphics.pipeline_layout)
 
   // Compute
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, compute.bind_group_layout)
-  WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_group)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, compute.pipeline_layout)
-  for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(compute.pipelines); ++i) {
-    WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipelines[i])
-  }
+  wgpu_image_filter_destroy(compute.filter);
 
   WGPU_RELEASE_RESOURCE(Buffer, vertex_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, index_buffer.buffer)
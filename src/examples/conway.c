@@ -3,11 +3,19 @@
 
 #include <string.h>
 
+#include "../webgpu/imgui_overlay.h"
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - A Conway Game Of Life
  *
  * A binary Conway game of life.
  *
+ * The cells are either stored one per rgba8 texel of a texture the size of the
+ * surface, or bit-packed with 32 cells per u32 word. The packed board is
+ * advanced by counting the neighbors of all 32 cells of a word at once with
+ * bitwise adders, decoded by the fragment shader for display and seeded on the
+ * GPU, which allows boards of 16K x 16K cells and more.
+ *
  * Ref:
  * https://github.com/Palats/webgpu/blob/main/src/demos/conway.ts
  * https://en.wikipedia.org/wiki/Conway%27s_Game_of_Life
@@ -33,7 +41,9 @@ static const char* compute_shader_wgsl = CODE(
     return 1;
   }
 
-  @compute @workgroup_size(8, 8)
+  override workgroup_size : u32 = 8u;
+
+  @compute @workgroup_size(workgroup_size, workgroup_size)
   fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
     // Guard against out-of-bounds work group sizes
     if (global_id.x >= uniforms.computeWidth || global_id.y >= uniforms.computeHeight) {
@@ -107,6 +117,128 @@ static const char* graphics_fragment_shader_wgsl = CODE(
     return textureSample(computeTexture, dstSampler, inp.coord);
   }
 );
+
+// Bit-packed board, bit i of word x of a row holds the cell at x * 32 + i
+static const char* packed_compute_shader_wgsl = CODE(
+  struct Board {
+    width : u32,
+    height : u32,
+    wordsPerRow : u32,
+    seed : u32
+  }
+
+  @group(0) @binding(0) var<uniform> board : Board;
+  @group(0) @binding(1) var<storage, read> cellsSrc : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> cellsDst : array<u32>;
+
+  // Cells of the word past the right edge of the board stay dead
+  fn rowMask(x : u32) -> u32 {
+    let valid = board.width - x * 32u;
+    if (valid >= 32u) {
+      return 0xffffffffu;
+    }
+    return (1u << valid) - 1u;
+  }
+
+  fn wordAt(x : i32, y : i32) -> u32 {
+    if (x < 0 || y < 0 || x >= i32(board.wordsPerRow)
+        || y >= i32(board.height)) {
+      return 0u;
+    }
+    return cellsSrc[u32(y) * board.wordsPerRow + u32(x)];
+  }
+
+  // Adds one neighbor to the bit-sliced counters of 32 cells, the counters
+  // hold bit 0 and bit 1 of the count and whether it reached 4
+  fn addNeighbors(sum : ptr<function, vec3<u32>>, neighbors : u32) {
+    let carry0 = (*sum).x & neighbors;
+    (*sum).x = (*sum).x ^ neighbors;
+    let carry1 = (*sum).y & carry0;
+    (*sum).y = (*sum).y ^ carry0;
+    (*sum).z = (*sum).z | carry1;
+  }
+
+  // Adds the west, east and (optionally) the center neighbors of a row
+  fn addRow(sum : ptr<function, vec3<u32>>, x : i32, y : i32,
+            withCenter : bool) -> u32 {
+    let center = wordAt(x, y);
+    addNeighbors(sum, (center << 1u) | (wordAt(x - 1, y) >> 31u));
+    addNeighbors(sum, (center >> 1u) | (wordAt(x + 1, y) << 31u));
+    if (withCenter) {
+      addNeighbors(sum, center);
+    }
+    return center;
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x >= board.wordsPerRow || global_id.y >= board.height) {
+      return;
+    }
+
+    let x = i32(global_id.x);
+    let y = i32(global_id.y);
+    var sum = vec3<u32>(0u);
+    addRow(&sum, x, y - 1, true);
+    let alive = addRow(&sum, x, y, false);
+    addRow(&sum, x, y + 1, true);
+
+    // Alive with 3 neighbors, or with 2 neighbors if alive already
+    let nextCells = sum.y & ~sum.z & (sum.x | alive);
+    cellsDst[global_id.y * board.wordsPerRow + global_id.x]
+      = nextCells & rowMask(global_id.x);
+  }
+
+  fn hash(value : u32) -> u32 {
+    let state = value * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  // Brings 20% of the cells to life
+  @compute @workgroup_size(8, 8)
+  fn seed(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x >= board.wordsPerRow || global_id.y >= board.height) {
+      return;
+    }
+
+    let index = global_id.y * board.wordsPerRow + global_id.x;
+    let base = hash(board.seed) + index * 32u;
+    var word = 0u;
+    for (var i = 0u; i < 32u; i++) {
+      if (hash(base + i) < 858993459u) {
+        word = word | (1u << i);
+      }
+    }
+    cellsDst[index] = word & rowMask(global_id.x);
+  }
+);
+
+static const char* packed_fragment_shader_wgsl = CODE(
+  struct VSOut {
+    @builtin(position) pos: vec4<f32>,
+    @location(0) coord: vec2<f32>
+  }
+
+  struct Board {
+    width : u32,
+    height : u32,
+    wordsPerRow : u32,
+    seed : u32
+  }
+
+  @group(0) @binding(0) var<uniform> board : Board;
+  @group(0) @binding(1) var<storage, read> cells : array<u32>;
+
+  @fragment
+  fn main(inp: VSOut) -> @location(0) vec4<f32> {
+    let size = vec2<u32>(board.width, board.height);
+    let cell = min(vec2<u32>(inp.coord * vec2<f32>(size)), size - 1u);
+    let word = cells[cell.y * board.wordsPerRow + cell.x / 32u];
+    let s = f32((word >> (cell.x % 32u)) & 1u);
+    return vec4<f32>(s, s, s, 1.0);
+  }
+);
 // clang-format on
 
 static struct {
@@ -138,6 +270,7 @@ static struct {
   WGPUBindGroup bind_groups[2];
   WGPUPipelineLayout pipeline_layout;
   WGPUComputePipeline pipeline;
+  uint32_t workgroup_size; /* Workgroup edge length, specialized per device */
 } compute;
 
 // Render pass descriptor for frame buffer writes
@@ -148,6 +281,42 @@ static struct {
 
 static bool is_forward = true;
 
+// Board edge lengths of the bit-packed storage, 0 = the surface size
+static const uint32_t packed_board_sizes[4] = {0, 4096, 16384, 32768};
+static const char* packed_board_size_names[4]
+  = {"Surface", "4096 x 4096", "16384 x 16384", "32768 x 32768"};
+
+// Resources of the bit-packed storage, 32 cells per u32 word
+static struct {
+  struct wgpu_buffer_t uniform_buffer;
+  struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t words_per_row;
+    uint32_t seed;
+  } board;
+  WGPUBuffer cells[2];
+  uint64_t cells_size;
+  WGPUBindGroupLayout compute_bind_group_layout;
+  WGPUPipelineLayout compute_pipeline_layout;
+  WGPUComputePipeline pipeline;
+  WGPUComputePipeline seed_pipeline;
+  WGPUBindGroup compute_bind_groups[2];
+  WGPUBindGroupLayout graphics_bind_group_layout;
+  WGPUPipelineLayout graphics_pipeline_layout;
+  WGPURenderPipeline graphics_pipeline;
+  WGPUBindGroup graphics_bind_groups[2];
+  bool seed_pending; /* Seeding is recorded with the next frame */
+} packed;
+
+static struct {
+  int32_t storage; /* 0 = rgba8 texture, 1 = bit-packed */
+  int32_t board_size_index;
+} settings = {
+  .storage          = 1,
+  .board_size_index = 0,
+};
+
 // Other variables
 static const char* example_title = "A Conway Game Of Life";
 static bool prepared             = false;
@@ -440,29 +609,87 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
   }
 }
 
+static WGPUComputePipeline create_compute_pipeline(wgpu_context_t* wgpu_context,
+                                                   uint32_t workgroup_size,
+                                                   void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  // Workgroup size override
+  WGPUConstantEntry constants[1] = {
+    [0] = (WGPUConstantEntry){
+      .key   = "workgroup_size",
+      .value = (double)workgroup_size,
+    },
+  };
+
+  // Compute shader
+  wgpu_shader_t conway_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = compute_shader_wgsl,
+                    .entry            = "main",
+                    .constants        = {
+                      .count   = (uint32_t)ARRAY_SIZE(constants),
+                      .entries = constants,
+                    },
+                  });
+
+  // Create compute pipeline
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Effect pipeline",
+                    .layout  = compute.pipeline_layout,
+                    .compute = conway_comp_shader.programmable_stage_descriptor,
+                  });
+
+  // Partial cleanup
+  wgpu_shader_release(&conway_comp_shader);
+
+  return pipeline;
+}
+
+static void dispatch_compute(WGPUComputePassEncoder pass_encoder,
+                             uint32_t workgroup_size, void* user_data)
+{
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, (WGPUBindGroup)user_data,
+                                     0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    pass_encoder,
+    (uint32_t)ceil(uniforms.desc.compute_width / (float)workgroup_size),
+    (uint32_t)ceil(uniforms.desc.compute_height / (float)workgroup_size), 1);
+}
+
+/* Measures the candidate workgroup sizes on the first run on an adapter */
+static void tune_compute_pipeline(wgpu_context_t* wgpu_context)
+{
+  static const uint32_t candidates[3] = {4, 8, 16};
+  const uint32_t workgroup_size       = wgpu_tune_workgroup_size(
+    wgpu_context, &(wgpu_workgroup_tuner_desc_t){
+                    .name            = "conway",
+                    .candidate_count = (uint32_t)ARRAY_SIZE(candidates),
+                    .candidates      = candidates,
+                    .dimension_count = 2,
+                    .default_size    = compute.workgroup_size,
+                    .create_pipeline = create_compute_pipeline,
+                    .dispatch        = dispatch_compute,
+                    .user_data       = compute.bind_groups[0],
+                  });
+  if (workgroup_size != compute.workgroup_size) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
+    compute.workgroup_size = workgroup_size;
+    compute.pipeline
+      = create_compute_pipeline(wgpu_context, workgroup_size, NULL);
+  }
+}
+
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
 {
   /* Compute pipeline */
   {
-    // Compute shader
-    wgpu_shader_t conway_comp_shader = wgpu_shader_create(
-      wgpu_context, &(wgpu_shader_desc_t){
-                      // Compute shader WGSL
-                      .wgsl_code.source = compute_shader_wgsl,
-                      .entry            = "main",
-                    });
-
-    // Create compute pipeline
-    compute.pipeline = wgpuDeviceCreateComputePipeline(
-      wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .label   = "Effect pipeline",
-        .layout  = compute.pipeline_layout,
-        .compute = conway_comp_shader.programmable_stage_descriptor,
-      });
-
-    // Partial cleanup
-    wgpu_shader_release(&conway_comp_shader);
+    compute.workgroup_size = wgpu_get_workgroup_size(wgpu_context, 8, 2);
+    compute.pipeline
+      = create_compute_pipeline(wgpu_context, compute.workgroup_size, NULL);
   }
 
   /* Graphics pipeline */
@@ -530,6 +757,340 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   }
 }
 
+static void prepare_packed_pipelines(wgpu_context_t* wgpu_context)
+{
+  // Board uniform buffer
+  packed.uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(packed.board),
+                  });
+
+  /* Compute pipelines */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[3] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Board
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(packed.board),
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Input cells
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Output cells
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_Storage,
+        },
+      },
+    };
+    packed.compute_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label = "Packed compute bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(packed.compute_bind_group_layout != NULL)
+
+    packed.compute_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                              .label = "Packed compute pipeline layout",
+                              .bindGroupLayoutCount = 1,
+                              .bindGroupLayouts
+                              = &packed.compute_bind_group_layout,
+                            });
+    ASSERT(packed.compute_pipeline_layout != NULL)
+
+    // Generation and seeding entry points
+    const char* entries[2]          = {"main", "seed"};
+    WGPUComputePipeline* targets[2] = {&packed.pipeline, &packed.seed_pipeline};
+    for (uint32_t i = 0; i < 2; ++i) {
+      wgpu_shader_t shader = wgpu_shader_create(
+        wgpu_context, &(wgpu_shader_desc_t){
+                        .wgsl_code.source = packed_compute_shader_wgsl,
+                        .entry            = entries[i],
+                      });
+      *targets[i] = wgpu_create_compute_pipeline(
+        wgpu_context, &(WGPUComputePipelineDescriptor){
+                        .label   = "Packed conway pipeline",
+                        .layout  = packed.compute_pipeline_layout,
+                        .compute = shader.programmable_stage_descriptor,
+                      });
+      wgpu_shader_release(&shader);
+    }
+  }
+
+  /* Graphics pipeline */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[2] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Board
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(packed.board),
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Cells decoded for display
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+        },
+      },
+    };
+    packed.graphics_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label = "Packed rendering bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(packed.graphics_bind_group_layout != NULL)
+
+    packed.graphics_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                              .label = "Packed rendering pipeline layout",
+                              .bindGroupLayoutCount = 1,
+                              .bindGroupLayouts
+                              = &packed.graphics_bind_group_layout,
+                            });
+    ASSERT(packed.graphics_pipeline_layout != NULL)
+
+    WGPUPrimitiveState primitive_state = {
+      .topology  = WGPUPrimitiveTopology_TriangleList,
+      .frontFace = WGPUFrontFace_CCW,
+      .cullMode  = WGPUCullMode_None,
+    };
+
+    WGPUBlendState blend_state              = wgpu_create_blend_state(true);
+    WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+      .format    = wgpu_context->swap_chain.format,
+      .blend     = &blend_state,
+      .writeMask = WGPUColorWriteMask_All,
+    };
+
+    WGPUVertexState vertex_state = wgpu_create_vertex_state(
+          wgpu_context, &(wgpu_vertex_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              .wgsl_code.source = graphics_vertex_shader_wgsl,
+              .entry            = "main",
+            },
+          });
+
+    WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+          wgpu_context, &(wgpu_fragment_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              .wgsl_code.source = packed_fragment_shader_wgsl,
+              .entry            = "main",
+            },
+            .target_count = 1,
+            .targets      = &color_target_state,
+          });
+
+    WGPUMultisampleState multisample_state
+      = wgpu_create_multisample_state_descriptor(
+        &(create_multisample_state_desc_t){
+          .sample_count = 1,
+        });
+
+    packed.graphics_pipeline = wgpuDeviceCreateRenderPipeline(
+      wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                              .label  = "Packed conway graphics pipeline",
+                              .layout = packed.graphics_pipeline_layout,
+                              .primitive   = primitive_state,
+                              .vertex      = vertex_state,
+                              .fragment    = &fragment_state,
+                              .multisample = multisample_state,
+                            });
+
+    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  }
+}
+
+static void release_packed_board(void)
+{
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, packed.compute_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, packed.graphics_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(Buffer, packed.cells[i])
+  }
+}
+
+/* Writes a new seed, the board is seeded on the GPU with the next frame */
+static void reseed_packed_board(wgpu_context_t* wgpu_context)
+{
+  packed.board.seed = (uint32_t)rand();
+  wgpu_queue_write_buffer(wgpu_context, packed.uniform_buffer.buffer, 0,
+                          &packed.board, sizeof(packed.board));
+  packed.seed_pending = true;
+}
+
+/* (Re)creates the cell buffers for the selected board size */
+static void prepare_packed_board(wgpu_context_t* wgpu_context)
+{
+  WGPUSupportedLimits supported_limits = {0};
+  wgpuDeviceGetLimits(wgpu_context->device, &supported_limits);
+  const uint64_t max_size = supported_limits.limits.maxStorageBufferBindingSize;
+
+  // Falls back to smaller boards for buffers above the binding size limit
+  for (;;) {
+    const uint32_t size = packed_board_sizes[settings.board_size_index];
+    packed.board.width  = size > 0 ? size : wgpu_context->surface.width;
+    packed.board.height = size > 0 ? size : wgpu_context->surface.height;
+    packed.board.words_per_row = (packed.board.width + 31) / 32;
+    packed.cells_size = (uint64_t)packed.board.words_per_row
+                        * packed.board.height * sizeof(uint32_t);
+    if (packed.cells_size <= max_size || settings.board_size_index == 0) {
+      break;
+    }
+    log_warn("%s board exceeds the storage buffer binding size limit\n",
+             packed_board_size_names[settings.board_size_index]);
+    --settings.board_size_index;
+  }
+
+  release_packed_board();
+  for (uint32_t i = 0; i < 2; ++i) {
+    packed.cells[i] = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .label = "Packed cells buffer",
+                              .usage = WGPUBufferUsage_Storage,
+                              .size  = packed.cells_size,
+                            });
+    ASSERT(packed.cells[i] != NULL)
+  }
+
+  // Bind group i advances cells i into the other buffer and displays the
+  // result
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPUBindGroupEntry compute_bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = packed.uniform_buffer.buffer,
+        .size    = packed.uniform_buffer.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = packed.cells[i],
+        .size    = packed.cells_size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = packed.cells[1 - i],
+        .size    = packed.cells_size,
+      },
+    };
+    packed.compute_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = packed.compute_bind_group_layout,
+        .entryCount = (uint32_t)ARRAY_SIZE(compute_bg_entries),
+        .entries    = compute_bg_entries,
+      });
+    ASSERT(packed.compute_bind_groups[i] != NULL)
+
+    WGPUBindGroupEntry graphics_bg_entries[2] = {
+      [0] = compute_bg_entries[0],
+      [1] = compute_bg_entries[2],
+    };
+    graphics_bg_entries[1].binding = 1;
+    packed.graphics_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = packed.graphics_bind_group_layout,
+        .entryCount = (uint32_t)ARRAY_SIZE(graphics_bg_entries),
+        .entries    = graphics_bg_entries,
+      });
+    ASSERT(packed.graphics_bind_groups[i] != NULL)
+  }
+
+  reseed_packed_board(wgpu_context);
+}
+
+static void dispatch_packed_compute(WGPUComputePassEncoder pass_encoder,
+                                    WGPUComputePipeline pipeline,
+                                    WGPUBindGroup bind_group)
+{
+  wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    pass_encoder, (packed.board.words_per_row + 7) / 8,
+    (packed.board.height + 7) / 8, 1);
+}
+
+/* Advances the board by one generation */
+static void simulation_step(wgpu_example_context_t* context,
+                            WGPUComputePassEncoder cpass_enc)
+{
+  UNUSED_VAR(context);
+
+  if (settings.storage == 0) {
+    wgpuComputePassEncoderSetPipeline(cpass_enc, compute.pipeline);
+    dispatch_compute(
+      cpass_enc, compute.workgroup_size,
+      is_forward ? compute.bind_groups[0] : compute.bind_groups[1]);
+  }
+  else {
+    // Seeding writes the first cells buffer, which is advanced next
+    if (packed.seed_pending) {
+      dispatch_packed_compute(cpass_enc, packed.seed_pipeline,
+                              packed.compute_bind_groups[1]);
+      packed.seed_pending = false;
+      is_forward          = true;
+    }
+    dispatch_packed_compute(cpass_enc, packed.pipeline,
+                            is_forward ? packed.compute_bind_groups[0] :
+                                         packed.compute_bind_groups[1]);
+  }
+
+  // Switch for the next generation
+  is_forward = !is_forward;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    static const char* storages[2] = {"rgba8 texture", "Bit-packed"};
+    imgui_overlay_combo_box(context->imgui_overlay, "Cells", &settings.storage,
+                            storages, 2);
+    if (settings.storage == 1) {
+      if (imgui_overlay_combo_box(
+            context->imgui_overlay, "Board", &settings.board_size_index,
+            packed_board_size_names,
+            (uint32_t)ARRAY_SIZE(packed_board_sizes))) {
+        prepare_packed_board(context->wgpu_context);
+      }
+      if (imgui_overlay_button(context->imgui_overlay, "Reseed")) {
+        reseed_packed_board(context->wgpu_context);
+      }
+      imgui_overlay_text("%u x %u cells, %.1f MiB", packed.board.width,
+                         packed.board.height,
+                         2.0 * packed.cells_size / (1024.0 * 1024.0));
+    }
+    else {
+      imgui_overlay_text("%u x %u cells, %.1f MiB",
+                         uniforms.desc.compute_width,
+                         uniforms.desc.compute_height,
+                         2.0 * 4.0 * uniforms.desc.compute_width
+                           * uniforms.desc.compute_height
+                           / (1024.0 * 1024.0));
+    }
+  }
+}
+
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
@@ -538,6 +1099,9 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_pipeline_layouts(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
+    tune_compute_pipeline(context->wgpu_context);
+    prepare_packed_pipelines(context->wgpu_context);
+    prepare_packed_board(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -556,37 +1120,38 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
   // -- Do compute pass, where the actual effect is -- //
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute.pipeline);
-    wgpuComputePassEncoderSetBindGroup(
-      wgpu_context->cpass_enc, 0,
-      is_forward ? compute.bind_groups[0] : compute.bind_groups[1], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc,
-      (uint32_t)ceil(uniforms.desc.compute_width / 8.0f),
-      (uint32_t)ceil(uniforms.desc.compute_height / 8.0f), 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-  }
-
-  // -- And do the frame rendering -- //
+  record_simulation_steps(context, wgpu_context->cmd_enc);
+
+  // -- And do the frame rendering, of the last generation -- //
   {
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc, &render_pass.descriptor);
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     graphics.pipeline);
-    wgpuRenderPassEncoderSetBindGroup(
-      wgpu_context->rpass_enc, 0,
-      is_forward ? graphics.bind_groups[0] : graphics.bind_groups[1], 0, NULL);
+    if (settings.storage == 0) {
+      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                       graphics.pipeline);
+      wgpuRenderPassEncoderSetBindGroup(
+        wgpu_context->rpass_enc, 0,
+        is_forward ? graphics.bind_groups[1] : graphics.bind_groups[0], 0,
+        NULL);
+    }
+    else {
+      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                       packed.graphics_pipeline);
+      wgpuRenderPassEncoderSetBindGroup(
+        wgpu_context->rpass_enc, 0,
+        is_forward ? packed.graphics_bind_groups[1] :
+                     packed.graphics_bind_groups[0],
+        0, NULL);
+    }
     // Double-triangle for fullscreen has 6 vertices
     wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 6, 1, 0, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
 
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
   // Get command buffer
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
@@ -612,9 +1177,6 @@ static int example_draw(wgpu_example_context_t* context)
   // Submit frame
   submit_frame(context);
 
-  // Switch for next frame
-  is_forward = !is_forward;
-
   return 0;
 }
 
@@ -649,6 +1211,17 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_groups[1])
   WGPU_RELEASE_RESOURCE(PipelineLayout, compute.pipeline_layout)
   WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
+
+  // Bit-packed storage
+  release_packed_board();
+  WGPU_RELEASE_RESOURCE(Buffer, packed.uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, packed.compute_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, packed.compute_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, packed.pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, packed.seed_pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, packed.graphics_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, packed.graphics_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, packed.graphics_pipeline)
 }
 
 void example_conway(int argc, char* argv[])
@@ -656,12 +1229,14 @@ void example_conway(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-     .title = example_title,
-     .vsync = true,
+     .title   = example_title,
+     .overlay = true,
+     .vsync   = true,
     },
-    .example_initialize_func = &example_initialize,
-    .example_render_func     = &example_render,
-    .example_destroy_func    = &example_destroy,
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_simulation_step_func = &simulation_step,
   });
   // clang-format on
 }
@@ -33,7 +33,9 @@ static const char* compute_shader_wgsl = CODE(
     return textureLoad(trailSrc, vec2<i32>(x, y), 0);
   }
 
-  @compute @workgroup_size(8, 8)
+  override workgroup_size : u32 = 8u;
+
+  @compute @workgroup_size(workgroup_size, workgroup_size)
   fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
     let x = i32(global_id.x);
     let y = i32(global_id.y);
@@ -170,6 +172,7 @@ static struct {
   WGPUBindGroup bind_groups[2];
   WGPUPipelineLayout pipeline_layout;
   WGPUComputePipeline pipeline;
+  uint32_t workgroup_size; /* Workgroup edge length, specialized per device */
 } compute;
 
 // Render pass descriptor for frame buffer writes
@@ -502,29 +505,87 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
   }
 }
 
+static WGPUComputePipeline create_compute_pipeline(wgpu_context_t* wgpu_context,
+                                                   uint32_t workgroup_size,
+                                                   void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  // Workgroup size override
+  WGPUConstantEntry constants[1] = {
+    [0] = (WGPUConstantEntry){
+      .key   = "workgroup_size",
+      .value = (double)workgroup_size,
+    },
+  };
+
+  // Compute shader
+  wgpu_shader_t conway_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = compute_shader_wgsl,
+                    .entry            = "main",
+                    .constants        = {
+                      .count   = (uint32_t)ARRAY_SIZE(constants),
+                      .entries = constants,
+                    },
+                  });
+
+  // Create compute pipeline
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Effect pipeline",
+                    .layout  = compute.pipeline_layout,
+                    .compute = conway_comp_shader.programmable_stage_descriptor,
+                  });
+
+  // Partial cleanup
+  wgpu_shader_release(&conway_comp_shader);
+
+  return pipeline;
+}
+
+static void dispatch_compute(WGPUComputePassEncoder pass_encoder,
+                             uint32_t workgroup_size, void* user_data)
+{
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, (WGPUBindGroup)user_data,
+                                     0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    pass_encoder,
+    (uint32_t)ceil(uniforms.desc.compute_width / (float)workgroup_size),
+    (uint32_t)ceil(uniforms.desc.compute_height / (float)workgroup_size), 1);
+}
+
+/* Measures the candidate workgroup sizes on the first run on an adapter */
+static void tune_compute_pipeline(wgpu_context_t* wgpu_context)
+{
+  static const uint32_t candidates[3] = {4, 8, 16};
+  const uint32_t workgroup_size       = wgpu_tune_workgroup_size(
+    wgpu_context, &(wgpu_workgroup_tuner_desc_t){
+                    .name            = "conway_paletted_blurring",
+                    .candidate_count = (uint32_t)ARRAY_SIZE(candidates),
+                    .candidates      = candidates,
+                    .dimension_count = 2,
+                    .default_size    = compute.workgroup_size,
+                    .create_pipeline = create_compute_pipeline,
+                    .dispatch        = dispatch_compute,
+                    .user_data       = compute.bind_groups[0],
+                  });
+  if (workgroup_size != compute.workgroup_size) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
+    compute.workgroup_size = workgroup_size;
+    compute.pipeline
+      = create_compute_pipeline(wgpu_context, workgroup_size, NULL);
+  }
+}
+
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
 {
   /* Compute pipeline */
   {
-    // Compute shader
-    wgpu_shader_t conway_comp_shader = wgpu_shader_create(
-      wgpu_context, &(wgpu_shader_desc_t){
-                      // Compute shader WGSL
-                      .wgsl_code.source = compute_shader_wgsl,
-                      .entry            = "main",
-                    });
-
-    // Create compute pipeline
-    compute.pipeline = wgpuDeviceCreateComputePipeline(
-      wgpu_context->device,
-      &(WGPUComputePipelineDescriptor){
-        .label   = "Effect pipeline",
-        .layout  = compute.pipeline_layout,
-        .compute = conway_comp_shader.programmable_stage_descriptor,
-      });
-
-    // Partial cleanup
-    wgpu_shader_release(&conway_comp_shader);
+    compute.workgroup_size = wgpu_get_workgroup_size(wgpu_context, 8, 2);
+    compute.pipeline
+      = create_compute_pipeline(wgpu_context, compute.workgroup_size, NULL);
   }
 
   /* Graphics pipeline */
@@ -600,6 +661,7 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_pipeline_layouts(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
+    tune_compute_pipeline(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -623,13 +685,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
       = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
     wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
                                       compute.pipeline);
-    wgpuComputePassEncoderSetBindGroup(
-      wgpu_context->cpass_enc, 0,
-      is_forward ? compute.bind_groups[0] : compute.bind_groups[1], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc,
-      (uint32_t)ceil(uniforms.desc.compute_width / 8.0f),
-      (uint32_t)ceil(uniforms.desc.compute_height / 8.0f), 1);
+    dispatch_compute(
+      wgpu_context->cpass_enc, compute.workgroup_size,
+      is_forward ? compute.bind_groups[0] : compute.bind_groups[1]);
     wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
     WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
   }
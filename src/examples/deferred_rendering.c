@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#include "../webgpu/compute_primitives.h"
+#include "../webgpu/compute_scheduler.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
@@ -14,24 +16,76 @@
  * In this sample we have 3 gBuffers for positions, normals, and albedo.
  * And then do the lighting in a second pass with per fragment data read from
  * gBuffers so it's independent of scene complexity. We also update light
- * position in a compute shader, where further operations like tile/cluster
- * culling could happen.
+ * position in a compute shader.
+ *
+ * The lights are culled against a 3D cluster grid: the view frustum is split
+ * into screen tiles and exponential depth slices, a compute pass counts the
+ * lights overlapping every cluster, the counts are scanned into offsets and a
+ * second pass writes the light indices of every cluster. The shading pass
+ * then only iterates the lights of the cluster of the fragment, which keeps
+ * tens of thousands of lights real-time. The light radius shrinks with the
+ * light count to keep the lit density of the scene similar.
+ *
+ * The light volumes mode rasterizes an instanced sphere around every light
+ * instead. A first draw marks the stencil with the depth-fail (z-fail) test:
+ * back faces behind the surface increment and front faces behind the surface
+ * decrement it, so the stencil counts the volumes that contain the surface,
+ * also with the camera inside of a volume. A second draw of the back faces
+ * shades the pixels with a non-zero stencil additively, on top of a full-screen
+ * ambient pass. The overlay keeps the last GPU time of every technique and the
+ * light count it was measured at, for the comparison with the clustered
+ * shading.
+ *
+ * The compact GBuffer mode stores octahedral encoded normals in rg16float and
+ * the albedo in rgba8unorm and reconstructs the position from the depth
+ * buffer, which takes 12 instead of 40 bytes per pixel.
+ *
+ * The screen space ambient occlusion reads the depth and the normals of the
+ * compact GBuffer in a compute pass at half or full resolution. Every pixel of
+ * a 4x4 block rotates the sample kernel differently (interleaved sampling), so
+ * few samples per pixel suffice. A second compute pass blurs the 4x4 blocks
+ * with depth-aware (bilateral) weights and upsamples them to the surface size.
+ * The GPU times of both resolutions are shown in the overlay.
+ *
+ * The light update and the light culling do not depend on the G-buffer, they
+ * are submitted in a command buffer of their own before the swap chain image
+ * is acquired.
  *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/tree/main/src/sample/deferredRendering
  * -------------------------------------------------------------------------- */
 
 // Constants
-#define MAX_NUM_LIGHTS 1024
+#define MAX_NUM_LIGHTS 131072
 static const uint32_t max_num_lights   = (uint32_t)MAX_NUM_LIGHTS;
 static const uint8_t light_data_stride = 8;
 static vec3 light_extent_min           = {-50.f, -30.f, -50.f};
 static vec3 light_extent_max           = {50.f, 30.f, 50.f};
 
+// Light radius at up to RADIUS_LIGHT_COUNT lights
+#define MAX_LIGHT_RADIUS 20.0f
+#define MIN_LIGHT_RADIUS 2.0f
+#define RADIUS_LIGHT_COUNT 1024.0f
+
+// Cluster grid: screen tiles x exponential depth slices
+#define CLUSTER_DIM_X 32u
+#define CLUSTER_DIM_Y 18u
+#define CLUSTER_DIM_Z 64u
+#define CLUSTER_COUNT (CLUSTER_DIM_X * CLUSTER_DIM_Y * CLUSTER_DIM_Z)
+// Light indices of all clusters, references beyond are dropped
+#define CLUSTER_LIGHT_INDEX_CAPACITY (1u << 22)
+// View depth range of the depth slices
+static const float cluster_depth_range[2] = {5.0f, 400.0f};
+
+// Light volume sphere tessellation
+#define LIGHT_VOLUME_SLICES 16u
+#define LIGHT_VOLUME_STACKS 8u
+
 static struct {
   vec3 up_vector;
   vec3 origin;
   mat4 projection_matrix;
+  mat4 view_matrix;
   mat4 view_proj_matrix;
 } view_matrices = {0};
 
@@ -49,9 +103,69 @@ static struct {
   WGPUTextureView texture_views[3];
 } gbuffer = {0};
 
-// Depth texture
+// Compact GBuffer: octahedral normals and albedo, the position is
+// reconstructed from the depth
+static struct {
+  WGPUTexture texture_normal;
+  WGPUTexture texture_albedo;
+  WGPUTextureView texture_views[2];
+  WGPUBuffer inverse_camera_uniform_buffer;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPURenderPipeline write_pipeline;
+} gbuffer_compact = {0};
+
+// Screen space ambient occlusion of the compact GBuffer
+typedef enum ssao_mode_enum {
+  SsaoMode_Off   = 0,
+  SsaoMode_Half  = 1,
+  SsaoMode_Full  = 2,
+  SsaoMode_Count = 3,
+} ssao_mode_enum;
+
+// SSAO uniform data
+typedef struct {
+  mat4 view_proj_matrix;
+  mat4 inv_view_proj_matrix;
+  float depth_params[2]; // view depth = y / (depth + x)
+  float radius;
+  float intensity;
+  uint32_t scale; // surface pixels per AO pixel
+  uint32_t padding[3];
+} ssao_uniforms_t;
+
+static struct {
+  WGPUBuffer uniform_buffer;
+  // AO and view depth at half and full resolution, indexed by mode - 1
+  WGPUTexture raw_textures[2];
+  WGPUTextureView raw_texture_views[2];
+  // Blurred AO of the surface size, read by the shading
+  WGPUTexture texture;
+  WGPUTextureView texture_view;
+  WGPURenderPassColorAttachment clear_attachment;
+  bool cleared;
+  WGPUBindGroupLayout sample_bind_group_layout;
+  WGPUBindGroupLayout upsample_bind_group_layout;
+  WGPUPipelineLayout sample_pipeline_layout;
+  WGPUPipelineLayout upsample_pipeline_layout;
+  WGPUComputePipeline sample_pipeline;
+  WGPUComputePipeline upsample_pipeline;
+  WGPUBindGroup sample_bind_groups[2];
+  WGPUBindGroup upsample_bind_groups[2];
+  // Last GPU time of the modes
+  float gpu_time_ms[SsaoMode_Count];
+} ssao = {0};
+
+#define SSAO_RADIUS 4.0f
+#define SSAO_INTENSITY 1.5f
+// Far view depth of the background in the raw AO
+#define SSAO_FAR_DEPTH 1.0e6f
+
+// Depth texture, the stencil marks the pixels inside of the light volumes
 static WGPUTexture depth_texture;
 static WGPUTextureView depth_texture_view;
+// Depth aspect of the depth texture, read by the shading and the SSAO
+static WGPUTextureView depth_sample_texture_view;
 
 // Uniform buffers
 static WGPUBuffer model_uniform_buffer;
@@ -72,6 +186,45 @@ static struct {
   WGPUBindGroupLayout buffer_compute_bind_group_layout;
 } lights = {0};
 
+// Light config uniform data
+typedef struct {
+  uint32_t num_lights;
+  float light_radius;
+  uint32_t padding[2];
+} light_config_t;
+
+// Cluster uniform data, the view projection places the light volumes
+typedef struct {
+  mat4 view_matrix;
+  mat4 view_proj_matrix;
+  float proj_scale[2];
+  float depth_range[2];
+  float surface_size[2];
+  uint32_t index_capacity;
+  uint32_t padding;
+} cluster_uniforms_t;
+
+// Clustered light culling
+static struct {
+  WGPUBuffer uniform_buffer;
+  WGPUBuffer counts;
+  WGPUBuffer cursors;
+  WGPUBuffer offsets;
+  WGPUBuffer light_indices;
+  WGPUBindGroupLayout cull_bind_group_layout;
+  WGPUBindGroupLayout shading_bind_group_layout;
+  WGPUBindGroup cull_bind_group;
+  WGPUBindGroup shading_bind_group;
+  WGPUPipelineLayout cull_pipeline_layout;
+  WGPUComputePipeline clear_pipeline;
+  WGPUComputePipeline count_pipeline;
+  WGPUComputePipeline assign_pipeline;
+  wgpu_compute_primitives_t* primitives;
+} clusters = {0};
+
+// Compute tasks of the frame, submitted ahead of the render passes
+static wgpu_compute_scheduler_t* compute_scheduler = NULL;
+
 // Bind groups
 static WGPUBindGroup scene_uniform_bind_group;
 static WGPUBindGroup surface_size_uniform_bind_group;
@@ -82,16 +235,47 @@ static WGPUBindGroupLayout scene_uniform_bind_group_layout;
 static WGPUBindGroupLayout surface_size_uniform_bind_group_layout;
 static WGPUBindGroupLayout gbuffer_textures_bind_group_layout;
 
+typedef enum gbuffer_format_enum {
+  GBufferFormat_Full    = 0,
+  GBufferFormat_Compact = 1,
+  GBufferFormat_Count   = 2,
+} gbuffer_format_enum;
+
+typedef enum light_culling_enum {
+  LightCulling_None      = 0,
+  LightCulling_Clustered = 1,
+  LightCulling_Volumes   = 2,
+  LightCulling_Count     = 3,
+} light_culling_enum;
+
+// Light volumes: instanced spheres around the lights, the deferred render
+// pipeline of the mode draws the ambient term
+static struct {
+  WGPUBuffer vertex_buffer;
+  WGPUBuffer index_buffer;
+  uint32_t index_count;
+  WGPURenderPipeline stencil_pipelines[GBufferFormat_Count];
+  WGPURenderPipeline lighting_pipelines[GBufferFormat_Count];
+} light_volumes = {0};
+
+// Last GPU time of the shading techniques, with the light count at the time
+static struct {
+  float gpu_time_ms;
+  int32_t num_lights;
+} shading_timings[LightCulling_Count] = {0};
+
 // Pipelines
 static WGPURenderPipeline write_gbuffers_pipeline;
 static WGPURenderPipeline gbuffers_debug_view_pipeline;
-static WGPURenderPipeline deferred_render_pipeline;
+static WGPURenderPipeline deferred_render_pipelines[GBufferFormat_Count]
+                                                   [LightCulling_Count];
 static WGPUComputePipeline light_update_compute_pipeline;
 
 // Pipeline layouts
 static WGPUPipelineLayout write_gbuffers_pipeline_layout;
 static WGPUPipelineLayout gbuffers_debug_view_pipeline_layout;
-static WGPUPipelineLayout deferred_render_pipeline_layout;
+static WGPUPipelineLayout deferred_render_pipeline_layouts[GBufferFormat_Count]
+                                                          [LightCulling_Count];
 static WGPUPipelineLayout light_update_compute_pipeline_layout;
 
 // Render pass descriptor
@@ -101,11 +285,23 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } write_gbuffer_pass = {0};
 
+static struct {
+  WGPURenderPassColorAttachment color_attachments[2];
+  WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
+  WGPURenderPassDescriptor descriptor;
+} write_gbuffer_compact_pass = {0};
+
 static struct {
   WGPURenderPassColorAttachment color_attachments[1];
   WGPURenderPassDescriptor descriptor;
 } texture_quad_pass = {0};
 
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
+  WGPURenderPassDescriptor descriptor;
+} light_volume_pass = {0};
+
 typedef enum render_mode_enum {
   RenderMode_Rendering    = 0,
   RenderMode_GBuffer_View = 1,
@@ -113,16 +309,549 @@ typedef enum render_mode_enum {
 
 static struct {
   render_mode_enum current_render_mode;
+  gbuffer_format_enum gbuffer_format;
+  light_culling_enum light_culling;
+  ssao_mode_enum ssao_mode;
   int32_t num_lights;
 } settings = {
   .current_render_mode = RenderMode_Rendering,
+  .gbuffer_format      = GBufferFormat_Compact,
+  .light_culling       = LightCulling_Clustered,
+  .ssao_mode           = SsaoMode_Half,
   .num_lights          = 128,
 };
 
+// GBuffer bytes per pixel of the formats, including the depth
+static const uint32_t gbuffer_bytes_per_pixel[GBufferFormat_Count] = {
+  16 + 16 + 4 + 4, // position & normal rgba32float, albedo bgra8unorm
+  4 + 4 + 4,       // normal rg16float, albedo rgba8unorm
+};
+
+// The GBuffers debug view shows the full GBuffer
+static gbuffer_format_enum get_gbuffer_format(void)
+{
+  return settings.current_render_mode == RenderMode_GBuffer_View ?
+           GBufferFormat_Full :
+           settings.gbuffer_format;
+}
+
+// The SSAO reads the compact GBuffer
+static bool is_ssao_enabled(void)
+{
+  return settings.ssao_mode != SsaoMode_Off
+         && settings.current_render_mode == RenderMode_Rendering
+         && get_gbuffer_format() == GBufferFormat_Compact;
+}
+
 // Other variables
 static const char* example_title = "Deferred Rendering";
 static bool prepared             = false;
 
+/* -------------------------------------------------------------------------- *
+ * Light culling and shading shaders
+ *
+ * The shaders are split into parts joined by concat_shader_sources() to keep
+ * the string literals short.
+ * -------------------------------------------------------------------------- */
+
+// Light and cluster declarations, the grid constants match CLUSTER_DIM_X/Y/Z
+// clang-format off
+static const char* lights_common_wgsl = CODE(
+  struct LightData {
+    position : vec4<f32>,
+    color : vec3<f32>,
+    radius : f32,
+  }
+  struct LightsBuffer {
+    lights : array<LightData>,
+  }
+  struct Config {
+    numLights : u32,
+    lightRadius : f32,
+  }
+  struct Clusters {
+    view : mat4x4<f32>,
+    viewProjection : mat4x4<f32>,
+    projScale : vec2<f32>,
+    depthRange : vec2<f32>,
+    surfaceSize : vec2<f32>,
+    indexCapacity : u32,
+    padding : u32,
+  }
+
+  const kClusterDim = vec3<u32>(32u, 18u, 64u);
+  const kClusterCount = 36864u;
+
+  // Exponential depth slice of a view depth
+  fn depthSlice(depth : f32) -> u32 {
+    let nearDepth = clusters.depthRange.x;
+    let t = log(max(depth, nearDepth) / nearDepth)
+            / log(clusters.depthRange.y / nearDepth);
+    return min(u32(t * f32(kClusterDim.z)), kClusterDim.z - 1u);
+  }
+
+  fn clusterIndex(cluster : vec3<u32>) -> u32 {
+    return (cluster.z * kClusterDim.y + cluster.y) * kClusterDim.x + cluster.x;
+  }
+);
+
+static const char* light_culling_range_wgsl = CODE(
+  @group(0) @binding(0) var<storage, read> lightsBuffer : LightsBuffer;
+  @group(0) @binding(1) var<uniform> config : Config;
+  @group(1) @binding(0) var<uniform> clusters : Clusters;
+  @group(1) @binding(1)
+  var<storage, read_write> clusterCounts : array<atomic<u32>>;
+  @group(1) @binding(2)
+  var<storage, read_write> clusterCursors : array<atomic<u32>>;
+  @group(1) @binding(3) var<storage, read> clusterOffsets : array<u32>;
+  @group(1) @binding(4)
+  var<storage, read_write> clusterLights : array<u32>;
+
+  struct ClusterRange {
+    lo : vec3<u32>,
+    hi : vec3<u32>,
+    visible : bool,
+  }
+
+  // Clusters overlapped by the view space bounding box of the light sphere
+  fn lightClusterRange(light : u32) -> ClusterRange {
+    var range : ClusterRange;
+    range.visible = false;
+    let radius = config.lightRadius;
+    let position = lightsBuffer.lights[light].position;
+    let center = (clusters.view * vec4<f32>(position.xyz, 1.0)).xyz;
+    // The camera looks down -z, depths in front of it are positive
+    let maxDepth = -center.z + radius;
+    if (maxDepth < 0.1) {
+      return range;
+    }
+    let minDepth = max(-center.z - radius, 0.1);
+
+    // x / depth is extremal at the corners of the box
+    let lo = center.xy - vec2<f32>(radius);
+    let hi = center.xy + vec2<f32>(radius);
+    let a = lo / minDepth;
+    let b = lo / maxDepth;
+    let c = hi / minDepth;
+    let d = hi / maxDepth;
+    let ndcMin = min(min(a, b), min(c, d)) * clusters.projScale;
+    let ndcMax = max(max(a, b), max(c, d)) * clusters.projScale;
+    if (any(ndcMin > vec2<f32>(1.0)) || any(ndcMax < vec2<f32>(-1.0))) {
+      return range;
+    }
+
+    // Tile rows go down the screen
+    let dim = vec2<f32>(kClusterDim.xy);
+    let tileMin = clamp((vec2<f32>(ndcMin.x, -ndcMax.y) * 0.5 + 0.5) * dim,
+                        vec2<f32>(0.0), dim - 1.0);
+    let tileMax = clamp((vec2<f32>(ndcMax.x, -ndcMin.y) * 0.5 + 0.5) * dim,
+                        vec2<f32>(0.0), dim - 1.0);
+    range.lo = vec3<u32>(vec2<u32>(tileMin), depthSlice(minDepth));
+    range.hi = vec3<u32>(vec2<u32>(tileMax), depthSlice(maxDepth));
+    range.visible = true;
+    return range;
+  }
+);
+
+static const char* light_culling_kernels_wgsl = CODE(
+  @compute @workgroup_size(64)
+  fn clearClusters(@builtin(global_invocation_id) gid : vec3<u32>) {
+    if (gid.x < kClusterCount) {
+      atomicStore(&clusterCounts[gid.x], 0u);
+      atomicStore(&clusterCursors[gid.x], 0u);
+    }
+  }
+
+  @compute @workgroup_size(64)
+  fn countLights(@builtin(global_invocation_id) gid : vec3<u32>) {
+    if (gid.x >= config.numLights) {
+      return;
+    }
+    let range = lightClusterRange(gid.x);
+    if (!range.visible) {
+      return;
+    }
+    for (var z = range.lo.z; z <= range.hi.z; z++) {
+      for (var y = range.lo.y; y <= range.hi.y; y++) {
+        for (var x = range.lo.x; x <= range.hi.x; x++) {
+          let cluster = clusterIndex(vec3<u32>(x, y, z));
+          atomicAdd(&clusterCounts[cluster], 1u);
+        }
+      }
+    }
+  }
+
+  @compute @workgroup_size(64)
+  fn assignLights(@builtin(global_invocation_id) gid : vec3<u32>) {
+    if (gid.x >= config.numLights) {
+      return;
+    }
+    let range = lightClusterRange(gid.x);
+    if (!range.visible) {
+      return;
+    }
+    for (var z = range.lo.z; z <= range.hi.z; z++) {
+      for (var y = range.lo.y; y <= range.hi.y; y++) {
+        for (var x = range.lo.x; x <= range.hi.x; x++) {
+          let cluster = clusterIndex(vec3<u32>(x, y, z));
+          let slot = clusterOffsets[cluster]
+                     + atomicAdd(&clusterCursors[cluster], 1u);
+          if (slot < clusters.indexCapacity) {
+            clusterLights[slot] = gid.x;
+          }
+        }
+      }
+    }
+  }
+);
+
+// Surface of the full GBuffer
+static const char* gbuffer_full_wgsl = CODE(
+  @group(0) @binding(0) var gBufferPosition : texture_2d<f32>;
+  @group(0) @binding(1) var gBufferNormal : texture_2d<f32>;
+  @group(0) @binding(2) var gBufferAlbedo : texture_2d<f32>;
+
+  fn loadSurface(coord : vec4<f32>) -> Surface {
+    let texel = vec2<i32>(floor(coord.xy));
+    var surface : Surface;
+    surface.position = textureLoad(gBufferPosition, texel, 0).xyz;
+    surface.normal = textureLoad(gBufferNormal, texel, 0).xyz;
+    surface.albedo = textureLoad(gBufferAlbedo, texel, 0).rgb;
+    return surface;
+  }
+
+  fn loadAmbientOcclusion(coord : vec4<f32>) -> f32 {
+    return 1.0;
+  }
+);
+
+// Surface of the compact GBuffer, the position is reconstructed from the depth
+static const char* gbuffer_compact_wgsl = CODE(
+  @group(0) @binding(0) var gBufferNormal : texture_2d<f32>;
+  @group(0) @binding(1) var gBufferAlbedo : texture_2d<f32>;
+  @group(0) @binding(2) var gBufferDepth : texture_depth_2d;
+
+  struct InverseCamera {
+    invViewProjectionMatrix : mat4x4<f32>,
+  }
+  @group(0) @binding(3) var<uniform> inverseCamera : InverseCamera;
+  @group(0) @binding(4) var ambientOcclusion : texture_2d<f32>;
+
+  fn octDecode(e : vec2<f32>) -> vec3<f32> {
+    var n = vec3<f32>(e, 1.0 - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.0);
+    n.x += select(t, -t, n.x >= 0.0);
+    n.y += select(t, -t, n.y >= 0.0);
+    return normalize(n);
+  }
+
+  fn loadSurface(coord : vec4<f32>) -> Surface {
+    let texel = vec2<i32>(floor(coord.xy));
+    let depth = textureLoad(gBufferDepth, texel, 0);
+    // Framebuffer rows go down, NDC y goes up
+    let uv = coord.xy / canvas.size;
+    let ndc = vec4<f32>(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, depth, 1.0);
+    let world = inverseCamera.invViewProjectionMatrix * ndc;
+    var surface : Surface;
+    surface.position = world.xyz / world.w;
+    surface.normal = octDecode(textureLoad(gBufferNormal, texel, 0).xy);
+    surface.albedo = textureLoad(gBufferAlbedo, texel, 0).rgb;
+    return surface;
+  }
+
+  fn loadAmbientOcclusion(coord : vec4<f32>) -> f32 {
+    return textureLoad(ambientOcclusion, vec2<i32>(floor(coord.xy)), 0).r;
+  }
+);
+
+// Writes the compact GBuffer, with the checkerboard albedo of the full one
+static const char* write_gbuffer_compact_wgsl = CODE(
+  struct GBufferOutput {
+    @location(0) normal : vec4<f32>,
+    @location(1) albedo : vec4<f32>,
+  }
+
+  // Octahedral encoding of a unit vector
+  fn octEncode(n : vec3<f32>) -> vec2<f32> {
+    let p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if (n.z >= 0.0) {
+      return p;
+    }
+    let signs = select(vec2<f32>(-1.0), vec2<f32>(1.0), p >= vec2<f32>(0.0));
+    return (1.0 - abs(p.yx)) * signs;
+  }
+
+  @fragment
+  fn main(@location(1) fragNormal : vec3<f32>,
+          @location(2) fragUV : vec2<f32>) -> GBufferOutput {
+    // faking some kind of checkerboard texture
+    let uv = floor(30.0 * fragUV);
+    let c = 0.2 + 0.5 * ((uv.x + uv.y) - 2.0 * floor((uv.x + uv.y) / 2.0));
+    var output : GBufferOutput;
+    output.normal = vec4<f32>(octEncode(normalize(fragNormal)), 0.0, 0.0);
+    output.albedo = vec4<f32>(c, c, c, 1.0);
+    return output;
+  }
+);
+
+static const char* deferred_shading_wgsl = CODE(
+  @group(1) @binding(0) var<storage, read> lightsBuffer : LightsBuffer;
+  @group(1) @binding(1) var<uniform> config : Config;
+
+  struct CanvasConstants {
+    size : vec2<f32>,
+  }
+  @group(2) @binding(0) var<uniform> canvas : CanvasConstants;
+
+  @group(3) @binding(0) var<uniform> clusters : Clusters;
+  @group(3) @binding(1) var<storage, read> clusterCounts : array<u32>;
+  @group(3) @binding(2) var<storage, read> clusterOffsets : array<u32>;
+  @group(3) @binding(3) var<storage, read> clusterLights : array<u32>;
+
+  struct Surface {
+    position : vec3<f32>,
+    normal : vec3<f32>,
+    albedo : vec3<f32>,
+  }
+
+  fn shadeLight(surface : Surface, light : u32) -> vec3<f32> {
+    let L = lightsBuffer.lights[light].position.xyz - surface.position;
+    let distance = length(L);
+    if (distance > config.lightRadius) {
+      return vec3<f32>(0.0);
+    }
+    let lambert = max(dot(surface.normal, normalize(L)), 0.0);
+    return lambert * pow(1.0 - distance / config.lightRadius, 2.0)
+           * lightsBuffer.lights[light].color * surface.albedo;
+  }
+
+  @fragment
+  fn mainAllLights(@builtin(position) coord : vec4<f32>)
+    -> @location(0) vec4<f32> {
+    let surface = loadSurface(coord);
+    var result = vec3<f32>(0.0);
+    for (var i = 0u; i < config.numLights; i++) {
+      result += shadeLight(surface, i);
+    }
+    // some manual ambient
+    result += vec3<f32>(0.2) * loadAmbientOcclusion(coord);
+    return vec4<f32>(result, 1.0);
+  }
+
+  @fragment
+  fn mainClustered(@builtin(position) coord : vec4<f32>)
+    -> @location(0) vec4<f32> {
+    let surface = loadSurface(coord);
+    let depth = -(clusters.view * vec4<f32>(surface.position, 1.0)).z;
+    let tileScale = vec2<f32>(kClusterDim.xy) / canvas.size;
+    let tile = min(vec2<u32>(coord.xy * tileScale), kClusterDim.xy - 1u);
+    let cluster = clusterIndex(vec3<u32>(tile, depthSlice(depth)));
+    let first = clusterOffsets[cluster];
+    let last = min(first + clusterCounts[cluster], clusters.indexCapacity);
+    var result = vec3<f32>(0.0);
+    for (var i = first; i < last; i++) {
+      result += shadeLight(surface, clusterLights[i]);
+    }
+    // some manual ambient
+    result += vec3<f32>(0.2) * loadAmbientOcclusion(coord);
+    return vec4<f32>(result, 1.0);
+  }
+);
+
+// Light volumes: the spheres scaled to the light radius, the stencil marking
+// and the additive shading of one light per instance
+static const char* light_volume_wgsl = CODE(
+  struct VolumeOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) @interpolate(flat) light : u32,
+  }
+
+  @vertex
+  fn mainVolume(@builtin(instance_index) light : u32,
+                @location(0) position : vec3<f32>) -> VolumeOutput {
+    let center = lightsBuffer.lights[light].position.xyz;
+    let world = center + position * config.lightRadius;
+    var output : VolumeOutput;
+    output.position = clusters.viewProjection * vec4<f32>(world, 1.0);
+    output.light = light;
+    return output;
+  }
+
+  // Only the stencil is written
+  @fragment
+  fn mainStencil() -> @location(0) vec4<f32> {
+    return vec4<f32>(0.0);
+  }
+
+  @fragment
+  fn mainLightVolume(@builtin(position) coord : vec4<f32>,
+                     @location(0) @interpolate(flat) light : u32)
+    -> @location(0) vec4<f32> {
+    return vec4<f32>(shadeLight(loadSurface(coord), light), 1.0);
+  }
+
+  @fragment
+  fn mainAmbient(@builtin(position) coord : vec4<f32>)
+    -> @location(0) vec4<f32> {
+    // some manual ambient
+    return vec4<f32>(vec3<f32>(0.2) * loadAmbientOcclusion(coord), 1.0);
+  }
+);
+
+/* -------------------------------------------------------------------------- *
+ * Screen space ambient occlusion shaders
+ * -------------------------------------------------------------------------- */
+
+// SSAO uniforms and depth helpers, the scale matches ssao_uniforms_t
+static const char* ssao_common_wgsl = CODE(
+  struct Ssao {
+    viewProjection : mat4x4<f32>,
+    invViewProjection : mat4x4<f32>,
+    depthParams : vec2<f32>,
+    radius : f32,
+    intensity : f32,
+    scale : u32,
+  }
+  @group(0) @binding(0) var<uniform> ssao : Ssao;
+  @group(0) @binding(1) var gBufferDepth : texture_depth_2d;
+
+  const kFarDepth = 1.0e6;
+
+  fn linearDepth(depth : f32) -> f32 {
+    return ssao.depthParams.y / (depth + ssao.depthParams.x);
+  }
+);
+
+// Hemisphere sampling around the normal at half or full resolution, the
+// rotation of the kernel interleaves over 4x4 pixel blocks
+static const char* ssao_sample_wgsl = CODE(
+  @group(0) @binding(2) var gBufferNormal : texture_2d<f32>;
+  @group(0) @binding(3) var aoOutput : texture_storage_2d<rg32float, write>;
+
+  const kSampleCount = 12u;
+  const kGoldenAngle = 2.39996323;
+  const kTwoPi = 6.28318531;
+
+  fn octDecode(e : vec2<f32>) -> vec3<f32> {
+    var n = vec3<f32>(e, 1.0 - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.0);
+    n.x += select(t, -t, n.x >= 0.0);
+    n.y += select(t, -t, n.y >= 0.0);
+    return normalize(n);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= textureDimensions(aoOutput))) {
+      return;
+    }
+    let size = vec2<i32>(textureDimensions(gBufferDepth));
+    let texel = min(vec2<i32>(id.xy) * i32(ssao.scale), size - 1);
+    let depth = textureLoad(gBufferDepth, texel, 0);
+    if (depth >= 1.0) {
+      textureStore(aoOutput, id.xy, vec4<f32>(1.0, kFarDepth, 0.0, 0.0));
+      return;
+    }
+
+    // World position reconstructed from the depth, framebuffer rows go down
+    let uv = (vec2<f32>(texel) + 0.5) / vec2<f32>(size);
+    let ndc = vec4<f32>(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, depth, 1.0);
+    let world = ssao.invViewProjection * ndc;
+    let position = world.xyz / world.w;
+    let normal = octDecode(textureLoad(gBufferNormal, texel, 0).xy);
+    let viewDepth = linearDepth(depth);
+
+    let up = select(vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(1.0, 0.0, 0.0),
+                    abs(normal.y) > 0.99);
+    let tangent = normalize(cross(up, normal));
+    let bitangent = cross(normal, tangent);
+    let rotation = f32((id.x & 3u) + 4u * (id.y & 3u)) * (kTwoPi / 16.0);
+
+    // Cosine weighted spiral, the samples get denser towards the center
+    var occlusion = 0.0;
+    for (var i = 0u; i < kSampleCount; i++) {
+      let t = (f32(i) + 0.5) / f32(kSampleCount);
+      let angle = rotation + f32(i) * kGoldenAngle;
+      let r = sqrt(t);
+      let h = vec3<f32>(cos(angle) * r, sin(angle) * r, sqrt(1.0 - t));
+      let offset = (tangent * h.x + bitangent * h.y + normal * h.z)
+                   * ssao.radius * mix(0.2, 1.0, t * t);
+      let clip = ssao.viewProjection * vec4<f32>(position + offset, 1.0);
+      let sampleUV = vec2<f32>(clip.x, -clip.y) / clip.w * 0.5 + 0.5;
+      if (clip.w <= 0.0 || any(sampleUV < vec2<f32>(0.0))
+          || any(sampleUV >= vec2<f32>(1.0))) {
+        continue;
+      }
+      let sampleTexel = vec2<i32>(sampleUV * vec2<f32>(size));
+      let sceneDepth = linearDepth(textureLoad(gBufferDepth, sampleTexel, 0));
+      // Surfaces far in front of the pixel do not occlude it
+      let rangeWeight = smoothstep(
+        0.0, 1.0, ssao.radius / max(abs(viewDepth - sceneDepth), 1e-4));
+      occlusion += select(0.0, rangeWeight, sceneDepth < clip.w - 0.05);
+    }
+    let ao = pow(1.0 - occlusion / f32(kSampleCount), ssao.intensity);
+    textureStore(aoOutput, id.xy, vec4<f32>(ao, viewDepth, 0.0, 0.0));
+  }
+);
+
+// Bilateral 4x4 blur of the interleaved AO and upsampling to the surface size,
+// the AO texels at other depths than the pixel get no weight
+static const char* ssao_upsample_wgsl = CODE(
+  @group(0) @binding(2) var aoInput : texture_2d<f32>;
+  @group(0) @binding(3) var aoOutput : texture_storage_2d<r32float, write>;
+
+  const kDepthSharpness = 50.0;
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= textureDimensions(aoOutput))) {
+      return;
+    }
+    let texel = vec2<i32>(id.xy);
+    let depth = textureLoad(gBufferDepth, texel, 0);
+    if (depth >= 1.0) {
+      textureStore(aoOutput, id.xy, vec4<f32>(1.0));
+      return;
+    }
+    let viewDepth = linearDepth(depth);
+
+    let last = vec2<i32>(textureDimensions(aoInput)) - 1;
+    let center = (vec2<f32>(texel) + 0.5) / f32(ssao.scale) - 0.5;
+    let base = vec2<i32>(floor(center)) - 1;
+    var sum = 0.0;
+    var weightSum = 0.0;
+    for (var y = 0; y < 4; y++) {
+      for (var x = 0; x < 4; x++) {
+        let coord = clamp(base + vec2<i32>(x, y), vec2<i32>(0), last);
+        let aoSample = textureLoad(aoInput, coord, 0).xy;
+        let weight = exp(-abs(aoSample.y - viewDepth) / viewDepth
+                         * kDepthSharpness);
+        sum += aoSample.x * weight;
+        weightSum += weight;
+      }
+    }
+    let ao = select(1.0, sum / weightSum, weightSum > 1e-4);
+    textureStore(aoOutput, id.xy, vec4<f32>(ao));
+  }
+);
+// clang-format on
+
+// Joins shader source parts, the returned string has to be freed
+static char* concat_shader_sources(const char* const* sources, uint32_t count)
+{
+  size_t length = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += strlen(sources[i]);
+  }
+  char* source = malloc(length);
+  ASSERT(source)
+  source[0] = '\0';
+  for (uint32_t i = 0; i < count; ++i) {
+    strcat(source, sources[i]);
+  }
+  return source;
+}
+
 // Prepare vertex and index buffers for the Stanford dragon mesh
 static void
 prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context,
@@ -220,6 +949,74 @@ prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context,
   }
 }
 
+// Unit sphere of the light volumes. The faces of the tessellation lie inside of
+// the sphere, the vertices are pushed out until the faces enclose it.
+static void prepare_light_volume_mesh(wgpu_context_t* wgpu_context)
+{
+  const uint32_t slices = LIGHT_VOLUME_SLICES, stacks = LIGHT_VOLUME_STACKS;
+  const float d_phi = 2.0f * PI / (float)slices, d_theta = PI / (float)stacks;
+  const float scale = 1.0f / (cosf(d_phi * 0.5f) * cosf(d_theta * 0.5f));
+
+  // Create the sphere vertex buffer
+  {
+    const uint64_t vertex_buffer_size
+      = (stacks + 1) * (slices + 1) * sizeof(vec3);
+    light_volumes.vertex_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .label            = "Light volume vertices",
+                              .usage            = WGPUBufferUsage_Vertex,
+                              .size             = vertex_buffer_size,
+                              .mappedAtCreation = true,
+                            });
+    ASSERT(light_volumes.vertex_buffer);
+    float* mapping = (float*)wgpuBufferGetMappedRange(
+      light_volumes.vertex_buffer, 0, vertex_buffer_size);
+    ASSERT(mapping);
+    for (uint32_t i = 0; i <= stacks; ++i) {
+      const float theta = (float)i * d_theta;
+      for (uint32_t j = 0; j <= slices; ++j) {
+        const float phi = (float)j * d_phi;
+        float* position = &mapping[3 * (i * (slices + 1) + j)];
+        position[0]     = sinf(theta) * cosf(phi) * scale;
+        position[1]     = cosf(theta) * scale;
+        position[2]     = sinf(theta) * sinf(phi) * scale;
+      }
+    }
+    wgpuBufferUnmap(light_volumes.vertex_buffer);
+  }
+
+  // Create the sphere index buffer, counter-clockwise seen from outside
+  {
+    light_volumes.index_count = stacks * slices * 6;
+    const uint64_t index_buffer_size
+      = light_volumes.index_count * sizeof(uint16_t);
+    light_volumes.index_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .label            = "Light volume indices",
+                              .usage            = WGPUBufferUsage_Index,
+                              .size             = index_buffer_size,
+                              .mappedAtCreation = true,
+                            });
+    ASSERT(light_volumes.index_buffer);
+    uint16_t* mapping = (uint16_t*)wgpuBufferGetMappedRange(
+      light_volumes.index_buffer, 0, index_buffer_size);
+    ASSERT(mapping);
+    for (uint32_t i = 0, k = 0; i < stacks; ++i) {
+      for (uint32_t j = 0; j < slices; ++j) {
+        const uint16_t a = (uint16_t)(i * (slices + 1) + j);
+        const uint16_t b = (uint16_t)(a + slices + 1);
+        mapping[k++]     = a;
+        mapping[k++]     = a + 1;
+        mapping[k++]     = b;
+        mapping[k++]     = a + 1;
+        mapping[k++]     = b + 1;
+        mapping[k++]     = b;
+      }
+    }
+    wgpuBufferUnmap(light_volumes.index_buffer);
+  }
+}
+
 // GBuffer texture render targets
 static void prepare_gbuffer_texture_render_targets(wgpu_context_t* wgpu_context)
 {
@@ -280,6 +1077,45 @@ static void prepare_gbuffer_texture_render_targets(wgpu_context_t* wgpu_context)
     gbuffer.texture_views[2]
       = wgpuTextureCreateView(gbuffer.texture_albedo, &texture_view_dec);
   }
+
+  // Compact GBuffer: octahedral normal and albedo, 8 bytes per pixel
+  {
+    const WGPUTextureFormat formats[2] = {
+      WGPUTextureFormat_RG16Float,  // normal
+      WGPUTextureFormat_RGBA8Unorm, // albedo
+    };
+    WGPUTexture* textures[2] = {
+      &gbuffer_compact.texture_normal,
+      &gbuffer_compact.texture_albedo,
+    };
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(formats); ++i) {
+      WGPUTextureDescriptor texture_desc = {
+        .size          = (WGPUExtent3D) {
+          .width               = wgpu_context->surface.width,
+          .height              = wgpu_context->surface.height,
+          .depthOrArrayLayers  = 1,
+        },
+        .mipLevelCount = 1,
+        .sampleCount   = 1,
+        .dimension     = WGPUTextureDimension_2D,
+        .format        = formats[i],
+        .usage         = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
+      };
+      *textures[i]
+        = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+      ASSERT(*textures[i] != NULL);
+      gbuffer_compact.texture_views[i] = wgpuTextureCreateView(
+        *textures[i], &(WGPUTextureViewDescriptor){
+                        .dimension       = WGPUTextureViewDimension_2D,
+                        .format          = formats[i],
+                        .baseMipLevel    = 0,
+                        .mipLevelCount   = 1,
+                        .baseArrayLayer  = 0,
+                        .arrayLayerCount = 1,
+                        .aspect          = WGPUTextureAspect_All,
+                      });
+    }
+  }
 }
 
 static void prepare_bind_group_layouts(wgpu_context_t* wgpu_context)
@@ -331,9 +1167,10 @@ static void prepare_bind_group_layouts(wgpu_context_t* wgpu_context)
   {
     WGPUBindGroupLayoutEntry bgl_entries[2] = {
       [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Storage buffer (Fragment shader) - LightsBuffer
+        // Binding 0: Storage buffer (Vertex/Fragment shader) - LightsBuffer
         .binding    = 0,
-        .visibility = WGPUShaderStage_Fragment | WGPUShaderStage_Compute,
+        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment
+                      | WGPUShaderStage_Compute,
         .buffer = (WGPUBufferBindingLayout) {
           .type           = WGPUBufferBindingType_ReadOnlyStorage,
           .minBindingSize = sizeof(float) * light_data_stride * max_num_lights,
@@ -341,12 +1178,13 @@ static void prepare_bind_group_layouts(wgpu_context_t* wgpu_context)
         .sampler = {0},
       },
       [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: Uniform buffer (Fragment shader) - Config
+        // Binding 1: Uniform buffer (Vertex/Fragment shader) - Config
         .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment | WGPUShaderStage_Compute,
+        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment
+                      | WGPUShaderStage_Compute,
         .buffer = (WGPUBufferBindingLayout) {
           .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = sizeof(uint32_t),
+          .minBindingSize = sizeof(light_config_t),
         },
         .storageTexture = {0},
       },
@@ -433,7 +1271,7 @@ static void prepare_bind_group_layouts(wgpu_context_t* wgpu_context)
         .visibility = WGPUShaderStage_Compute,
         .buffer = (WGPUBufferBindingLayout) {
           .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = sizeof(uint32_t),
+          .minBindingSize = sizeof(light_config_t),
         },
         .storageTexture = {0},
       },
@@ -455,6 +1293,122 @@ static void prepare_bind_group_layouts(wgpu_context_t* wgpu_context)
                             });
     ASSERT(lights.buffer_compute_bind_group_layout != NULL);
   }
+
+  // Compact GBuffer bind group layout
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[5] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: Octahedral normal texture view
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Binding 1: Albedo texture view
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Depth texture view
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Depth,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Uniform buffer (Fragment shader) - InverseCamera
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(mat4),
+        },
+      },
+      [4] = (WGPUBindGroupLayoutEntry) {
+        // Binding 4: Ambient occlusion texture view
+        .binding    = 4,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+    };
+    gbuffer_compact.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label = "Compact GBuffer bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(gbuffer_compact.bind_group_layout != NULL);
+  }
+
+  // Cluster culling bind group layout
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[5] = {0};
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(bgl_entries); ++i) {
+      // Binding 1-2: counts and cursors, 3: offsets, 4: light indices
+      bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+        .binding    = i,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout){
+          .type = (i == 3) ? WGPUBufferBindingType_ReadOnlyStorage :
+                             WGPUBufferBindingType_Storage,
+        },
+      };
+    }
+    // Binding 0: Uniform buffer (Compute shader) - Clusters
+    bgl_entries[0].buffer = (WGPUBufferBindingLayout){
+      .type           = WGPUBufferBindingType_Uniform,
+      .minBindingSize = sizeof(cluster_uniforms_t),
+    };
+    clusters.cull_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label      = "Cluster culling bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(clusters.cull_bind_group_layout != NULL);
+  }
+
+  // Cluster shading bind group layout
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[4] = {0};
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(bgl_entries); ++i) {
+      // Binding 1: counts, 2: offsets, 3: light indices
+      bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+        .binding    = i,
+        .visibility = WGPUShaderStage_Fragment,
+        .buffer = (WGPUBufferBindingLayout){
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+        },
+      };
+    }
+    // Binding 0: Uniform buffer (Vertex/Fragment shader) - Clusters, the
+    // light volumes are placed with its view projection
+    bgl_entries[0].visibility
+      = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+    bgl_entries[0].buffer = (WGPUBufferBindingLayout){
+      .type           = WGPUBufferBindingType_Uniform,
+      .minBindingSize = sizeof(cluster_uniforms_t),
+    };
+    clusters.shading_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label      = "Cluster shading bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(clusters.shading_bind_group_layout != NULL);
+  }
 }
 
 static void prepare_render_pipeline_layouts(wgpu_context_t* wgpu_context)
@@ -485,20 +1439,27 @@ static void prepare_render_pipeline_layouts(wgpu_context_t* wgpu_context)
     ASSERT(gbuffers_debug_view_pipeline_layout != NULL);
   }
 
-  // Deferred render pipeline layout
-  {
-    WGPUBindGroupLayout bind_group_layouts[3] = {
-      gbuffer_textures_bind_group_layout,     // set 0
-      lights.buffer_bind_group_layout,        // set 1
-      surface_size_uniform_bind_group_layout, // set 2
-    };
-    deferred_render_pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      wgpu_context->device,
-      &(WGPUPipelineLayoutDescriptor){
-        .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
-        .bindGroupLayouts     = bind_group_layouts,
-      });
-    ASSERT(deferred_render_pipeline_layout != NULL);
+  // Deferred render pipeline layouts of the GBuffer formats, the clustered
+  // shading also binds the light lists of the clusters and the light volumes
+  // the view projection of the cluster uniforms
+  for (uint32_t f = 0; f < (uint32_t)GBufferFormat_Count; ++f) {
+    for (uint32_t c = 0; c < (uint32_t)LightCulling_Count; ++c) {
+      WGPUBindGroupLayout bind_group_layouts[4] = {
+        f == GBufferFormat_Compact ?
+          gbuffer_compact.bind_group_layout :
+          gbuffer_textures_bind_group_layout,   // set 0
+        lights.buffer_bind_group_layout,        // set 1
+        surface_size_uniform_bind_group_layout, // set 2
+        clusters.shading_bind_group_layout,     // set 3
+      };
+      deferred_render_pipeline_layouts[f][c] = wgpuDeviceCreatePipelineLayout(
+        wgpu_context->device,
+        &(WGPUPipelineLayoutDescriptor){
+          .bindGroupLayoutCount = c == LightCulling_None ? 3 : 4,
+          .bindGroupLayouts     = bind_group_layouts,
+        });
+      ASSERT(deferred_render_pipeline_layouts[f][c] != NULL);
+    }
   }
 }
 
@@ -533,7 +1494,7 @@ static void prepare_write_gbuffers_pipeline(wgpu_context_t* wgpu_context)
   // Depth stencil state
   WGPUDepthStencilState depth_stencil_state
     = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
-      .format              = WGPUTextureFormat_Depth24Plus,
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
       .depth_write_enabled = true,
     });
   depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
@@ -598,6 +1559,99 @@ static void prepare_write_gbuffers_pipeline(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+static void
+prepare_write_gbuffers_compact_pipeline(wgpu_context_t* wgpu_context)
+{
+  // Primitive state
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_Back,
+  };
+
+  // Color target state, the position is reconstructed from the depth
+  WGPUColorTargetState color_target_states[2] = {
+    // octahedral normal
+    [0] = (WGPUColorTargetState){
+      .format    = WGPUTextureFormat_RG16Float,
+      .writeMask = WGPUColorWriteMask_All,
+    },
+    // albedo
+    [1] = (WGPUColorTargetState){
+      .format    = WGPUTextureFormat_RGBA8Unorm,
+      .writeMask = WGPUColorWriteMask_All,
+    },
+  };
+
+  // Depth stencil state
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = true,
+    });
+  depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+
+  // Vertex buffer layout
+  WGPU_VERTEX_BUFFER_LAYOUT(
+    write_gbuffers_compact, sizeof(float) * 8,
+    // Attribute location 0: Position
+    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x3, 0),
+    // Attribute location 1: Normal
+    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x3, sizeof(float) * 3),
+    // Attribute location 2: uv
+    WGPU_VERTATTR_DESC(2, WGPUVertexFormat_Float32x2, sizeof(float) * 6))
+
+  // Vertex state
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+            wgpu_context, &(wgpu_vertex_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Vertex shader WGSL
+              .label = "vertexWriteGBuffers WGSL",
+              .file  = "shaders/deferred_rendering/vertexWriteGBuffers.wgsl",
+              .entry = "main",
+            },
+            .buffer_count = 1,
+            .buffers      = &write_gbuffers_compact_vertex_buffer_layout,
+          });
+
+  // Fragment state
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+            wgpu_context, &(wgpu_fragment_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Fragment shader WGSL
+              .label            = "Write compact GBuffer WGSL",
+              .wgsl_code.source = write_gbuffer_compact_wgsl,
+              .entry            = "main",
+             },
+            .target_count = (uint32_t)ARRAY_SIZE(color_target_states),
+            .targets = color_target_states,
+          });
+
+  // Multisample state
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  // Create rendering pipeline using the specified states
+  gbuffer_compact.write_pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label = "write_gbuffers_compact_render_pipeline",
+                            .layout       = write_gbuffers_pipeline_layout,
+                            .primitive    = primitive_state,
+                            .vertex       = vertex_state,
+                            .fragment     = &fragment_state,
+                            .depthStencil = &depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+  ASSERT(gbuffer_compact.write_pipeline != NULL);
+
+  // Partial cleanup
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
 static void prepare_gbuffers_debug_view_pipeline(wgpu_context_t* wgpu_context)
 {
   // Primitive state
@@ -662,8 +1716,14 @@ static void prepare_gbuffers_debug_view_pipeline(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
-static void prepare_deferred_render_pipeline(wgpu_context_t* wgpu_context)
+static WGPURenderPipeline
+create_deferred_render_pipeline(wgpu_context_t* wgpu_context,
+                                gbuffer_format_enum gbuffer_format,
+                                light_culling_enum light_culling)
 {
+  WGPUPipelineLayout pipeline_layout
+    = deferred_render_pipeline_layouts[gbuffer_format][light_culling];
+
   // Primitive state
   WGPUPrimitiveState primitive_state = {
     .topology  = WGPUPrimitiveTopology_TriangleList,
@@ -691,18 +1751,41 @@ static void prepare_deferred_render_pipeline(wgpu_context_t* wgpu_context)
         .buffers = NULL,
       });
 
-  // Fragment state
+  // Fragment state, the light volumes add the lights to the ambient term
+  const char* sources[4] = {
+    lights_common_wgsl,
+    gbuffer_format == GBufferFormat_Compact ? gbuffer_compact_wgsl :
+                                              gbuffer_full_wgsl,
+    deferred_shading_wgsl,
+    light_volume_wgsl,
+  };
+  static const char* entries[LightCulling_Count] = {
+    [LightCulling_None]      = "mainAllLights",
+    [LightCulling_Clustered] = "mainClustered",
+    [LightCulling_Volumes]   = "mainAmbient",
+  };
+  char* fragment_source
+    = concat_shader_sources(sources, (uint32_t)ARRAY_SIZE(sources));
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
         wgpu_context, &(wgpu_fragment_state_t){
         .shader_desc = (wgpu_shader_desc_t){
           // Fragment shader WGSL
-          .file  = "shaders/deferred_rendering/fragmentDeferredRendering.wgsl",
-          .entry = "main",
+          .wgsl_code.source = fragment_source,
+          .entry            = entries[light_culling],
         },
         .target_count = 1,
         .targets      = &color_target_state,
       });
 
+  // The light volume pass has the depth stencil attachment, the ambient term
+  // ignores it
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = false,
+    });
+  depth_stencil_state.depthCompare = WGPUCompareFunction_Always;
+
   // Multisample state
   WGPUMultisampleState multisample_state
     = wgpu_create_multisample_state_descriptor(
@@ -711,19 +1794,169 @@ static void prepare_deferred_render_pipeline(wgpu_context_t* wgpu_context)
       });
 
   // Create rendering pipeline using the specified states
-  deferred_render_pipeline = wgpuDeviceCreateRenderPipeline(
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(
     wgpu_context->device, &(WGPURenderPipelineDescriptor){
                             .label       = "deferred_render_pipeline",
-                            .layout      = deferred_render_pipeline_layout,
+                            .layout      = pipeline_layout,
                             .primitive   = primitive_state,
                             .vertex      = vertex_state,
                             .fragment    = &fragment_state,
+                            .depthStencil
+                            = light_culling == LightCulling_Volumes ?
+                                &depth_stencil_state :
+                                NULL,
                             .multisample = multisample_state,
                           });
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  free(fragment_source);
+
+  return pipeline;
+}
+
+static void prepare_deferred_render_pipelines(wgpu_context_t* wgpu_context)
+{
+  // Shading with all lights or with the lights of the cluster of the
+  // fragment, for both GBuffer formats
+  for (uint32_t f = 0; f < (uint32_t)GBufferFormat_Count; ++f) {
+    for (uint32_t c = 0; c < (uint32_t)LightCulling_Count; ++c) {
+      deferred_render_pipelines[f][c] = create_deferred_render_pipeline(
+        wgpu_context, (gbuffer_format_enum)f, (light_culling_enum)c);
+      ASSERT(deferred_render_pipelines[f][c] != NULL);
+    }
+  }
+}
+
+// Stencil marking or additive shading of the light volumes
+static WGPURenderPipeline
+create_light_volume_pipeline(wgpu_context_t* wgpu_context,
+                             gbuffer_format_enum gbuffer_format, bool stencil)
+{
+  // The shading draws the back faces, which also covers the camera inside of a
+  // volume
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = stencil ? WGPUCullMode_None : WGPUCullMode_Front,
+  };
+
+  // Color target state
+  WGPUBlendState blend_state = {
+    .color.operation = WGPUBlendOperation_Add,
+    .color.srcFactor = WGPUBlendFactor_One,
+    .color.dstFactor = WGPUBlendFactor_One,
+    .alpha.operation = WGPUBlendOperation_Add,
+    .alpha.srcFactor = WGPUBlendFactor_One,
+    .alpha.dstFactor = WGPUBlendFactor_One,
+  };
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = WGPUTextureFormat_BGRA8Unorm,
+    .blend     = &blend_state,
+    .writeMask = stencil ? WGPUColorWriteMask_None : WGPUColorWriteMask_All,
+  };
+
+  // Depth stencil state: the depth-fail marking counts the volumes that
+  // contain the surface (wrapping at 256), the shading passes the back faces
+  // behind the surface where the count is non-zero
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = false,
+    });
+  if (stencil) {
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+    depth_stencil_state.stencilFront.depthFailOp
+      = WGPUStencilOperation_DecrementWrap;
+    depth_stencil_state.stencilBack.depthFailOp
+      = WGPUStencilOperation_IncrementWrap;
+  }
+  else {
+    depth_stencil_state.depthCompare         = WGPUCompareFunction_GreaterEqual;
+    depth_stencil_state.stencilBack.compare  = WGPUCompareFunction_NotEqual;
+    depth_stencil_state.stencilFront.compare = WGPUCompareFunction_NotEqual;
+  }
+  depth_stencil_state.stencilReadMask  = 0xff;
+  depth_stencil_state.stencilWriteMask = stencil ? 0xff : 0x00;
+
+  // Vertex buffer layout
+  WGPU_VERTEX_BUFFER_LAYOUT(
+    light_volume, sizeof(vec3),
+    // Attribute location 0: Position
+    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x3, 0))
+
+  // Vertex and fragment state
+  const char* sources[4] = {
+    lights_common_wgsl,
+    gbuffer_format == GBufferFormat_Compact ? gbuffer_compact_wgsl :
+                                              gbuffer_full_wgsl,
+    deferred_shading_wgsl,
+    light_volume_wgsl,
+  };
+  char* source = concat_shader_sources(sources, (uint32_t)ARRAY_SIZE(sources));
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+        wgpu_context, &(wgpu_vertex_state_t){
+        .shader_desc = (wgpu_shader_desc_t){
+          // Vertex shader WGSL
+          .label            = "Light volume WGSL",
+          .wgsl_code.source = source,
+          .entry            = "mainVolume",
+        },
+        .buffer_count = 1,
+        .buffers      = &light_volume_vertex_buffer_layout,
+      });
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+        wgpu_context, &(wgpu_fragment_state_t){
+        .shader_desc = (wgpu_shader_desc_t){
+          // Fragment shader WGSL
+          .label            = "Light volume WGSL",
+          .wgsl_code.source = source,
+          .entry            = stencil ? "mainStencil" : "mainLightVolume",
+        },
+        .target_count = 1,
+        .targets      = &color_target_state,
+      });
+
+  // Multisample state
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  // Create rendering pipeline using the specified states
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device,
+    &(WGPURenderPipelineDescriptor){
+      .label  = stencil ? "light_volume_stencil_render_pipeline" :
+                          "light_volume_render_pipeline",
+      .layout = deferred_render_pipeline_layouts[gbuffer_format]
+                                                [LightCulling_Volumes],
+      .primitive    = primitive_state,
+      .vertex       = vertex_state,
+      .fragment     = &fragment_state,
+      .depthStencil = &depth_stencil_state,
+      .multisample  = multisample_state,
+    });
+  ASSERT(pipeline != NULL);
+
+  // Partial cleanup
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  free(source);
+
+  return pipeline;
+}
+
+static void prepare_light_volume_pipelines(wgpu_context_t* wgpu_context)
+{
+  for (uint32_t f = 0; f < (uint32_t)GBufferFormat_Count; ++f) {
+    light_volumes.stencil_pipelines[f] = create_light_volume_pipeline(
+      wgpu_context, (gbuffer_format_enum)f, true);
+    light_volumes.lighting_pipelines[f] = create_light_volume_pipeline(
+      wgpu_context, (gbuffer_format_enum)f, false);
+  }
 }
 
 static void prepare_depth_texture(wgpu_context_t* wgpu_context)
@@ -738,8 +1971,8 @@ static void prepare_depth_texture(wgpu_context_t* wgpu_context)
     .mipLevelCount = 1,
     .sampleCount   = 1,
     .dimension     = WGPUTextureDimension_2D,
-    .format        = WGPUTextureFormat_Depth24Plus,
-    .usage         = WGPUTextureUsage_RenderAttachment,
+    .format        = WGPUTextureFormat_Depth24PlusStencil8,
+    .usage         = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
   };
   depth_texture = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
 
@@ -754,6 +1987,69 @@ static void prepare_depth_texture(wgpu_context_t* wgpu_context)
     .aspect          = WGPUTextureAspect_All,
   };
   depth_texture_view = wgpuTextureCreateView(depth_texture, &texture_view_dec);
+
+  // Texture bindings read the depth aspect only
+  texture_view_dec.aspect = WGPUTextureAspect_DepthOnly;
+  depth_sample_texture_view
+    = wgpuTextureCreateView(depth_texture, &texture_view_dec);
+}
+
+// SSAO textures: the raw AO at half and full resolution and the upsampled AO
+static void prepare_ssao_textures(wgpu_context_t* wgpu_context)
+{
+  const uint32_t width  = wgpu_context->surface.width;
+  const uint32_t height = wgpu_context->surface.height;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(ssao.raw_textures); ++i) {
+    // Mode half (i = 0) and full (i = 1)
+    const uint32_t scale = 2u - i;
+    ssao.raw_textures[i] = wgpuDeviceCreateTexture(
+      wgpu_context->device,
+      &(WGPUTextureDescriptor){
+        .label         = "SSAO raw texture",
+        .size          = (WGPUExtent3D){
+          .width              = (width + scale - 1) / scale,
+          .height             = (height + scale - 1) / scale,
+          .depthOrArrayLayers = 1,
+        },
+        .mipLevelCount = 1,
+        .sampleCount   = 1,
+        .dimension     = WGPUTextureDimension_2D,
+        .format        = WGPUTextureFormat_RG32Float,
+        .usage = WGPUTextureUsage_StorageBinding
+                 | WGPUTextureUsage_TextureBinding,
+      });
+    ASSERT(ssao.raw_textures[i] != NULL);
+    ssao.raw_texture_views[i]
+      = wgpuTextureCreateView(ssao.raw_textures[i], NULL);
+    ASSERT(ssao.raw_texture_views[i] != NULL);
+  }
+
+  // Cleared to no occlusion while the SSAO is off
+  ssao.texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "SSAO texture",
+      .size          = (WGPUExtent3D){
+        .width              = width,
+        .height             = height,
+        .depthOrArrayLayers = 1,
+      },
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+      .dimension     = WGPUTextureDimension_2D,
+      .format        = WGPUTextureFormat_R32Float,
+      .usage = WGPUTextureUsage_StorageBinding | WGPUTextureUsage_TextureBinding
+               | WGPUTextureUsage_RenderAttachment,
+    });
+  ASSERT(ssao.texture != NULL);
+  ssao.texture_view = wgpuTextureCreateView(ssao.texture, NULL);
+  ASSERT(ssao.texture_view != NULL);
+  ssao.clear_attachment = (WGPURenderPassColorAttachment){
+    .view       = ssao.texture_view,
+    .loadOp     = WGPULoadOp_Clear,
+    .storeOp    = WGPUStoreOp_Store,
+    .clearValue = (WGPUColor){1.0, 1.0, 1.0, 1.0},
+  };
 }
 
 static void setup_render_passes()
@@ -809,6 +2105,9 @@ static void setup_render_passes()
         .depthClearValue = 1.0f,
         .clearDepth      = 1.0f,
         .clearStencil    = 0,
+        // The light volume pass clears the stencil itself
+        .stencilLoadOp  = WGPULoadOp_Clear,
+        .stencilStoreOp = WGPUStoreOp_Discard,
       };
 
     // Render pass descriptor
@@ -820,6 +2119,38 @@ static void setup_render_passes()
     };
   }
 
+  /* Write compact GBuffer pass */
+  {
+    // Color attachments
+    for (uint32_t i = 0; i < 2; ++i) {
+      write_gbuffer_compact_pass.color_attachments[i] =
+        (WGPURenderPassColorAttachment) {
+          .view       = gbuffer_compact.texture_views[i],
+          .loadOp     = WGPULoadOp_Clear,
+          .storeOp    = WGPUStoreOp_Store,
+          .clearValue = (WGPUColor) {
+            .r = 0.0f,
+            .g = 0.0f,
+            .b = 0.0f,
+            .a = 1.0f,
+          },
+        };
+    }
+
+    // The depth is kept for the position reconstruction
+    write_gbuffer_compact_pass.depth_stencil_attachment
+      = write_gbuffer_pass.depth_stencil_attachment;
+
+    // Render pass descriptor
+    write_gbuffer_compact_pass.descriptor = (WGPURenderPassDescriptor){
+      .colorAttachmentCount
+      = (uint32_t)ARRAY_SIZE(write_gbuffer_compact_pass.color_attachments),
+      .colorAttachments = write_gbuffer_compact_pass.color_attachments,
+      .depthStencilAttachment
+      = &write_gbuffer_compact_pass.depth_stencil_attachment,
+    };
+  }
+
   /* Texture Quad Pass */
   {
     // Color attachment
@@ -842,13 +2173,53 @@ static void setup_render_passes()
       .colorAttachments     = texture_quad_pass.color_attachments,
     };
   }
+
+  /* Light volume pass */
+  {
+    // Color attachment, view is acquired and set in render loop
+    light_volume_pass.color_attachments[0]
+      = texture_quad_pass.color_attachments[0];
+
+    // The depth is tested and sampled, but not written: the depth load and
+    // store operations stay undefined
+    light_volume_pass.depth_stencil_attachment
+      = (WGPURenderPassDepthStencilAttachment){
+        .view              = depth_texture_view,
+        .depthReadOnly     = true,
+        .stencilLoadOp     = WGPULoadOp_Clear,
+        .stencilStoreOp    = WGPUStoreOp_Discard,
+        .stencilClearValue = 0,
+        .clearStencil      = 0,
+      };
+
+    // Render pass descriptor
+    light_volume_pass.descriptor = (WGPURenderPassDescriptor){
+      .colorAttachmentCount = 1,
+      .colorAttachments     = light_volume_pass.color_attachments,
+      .depthStencilAttachment
+      = &light_volume_pass.depth_stencil_attachment,
+    };
+  }
+}
+
+// The light radius shrinks with the cube root of the light count, which keeps
+// the number of lights reaching a point about constant
+static light_config_t get_light_config(void)
+{
+  const float num_lights = (float)settings.num_lights;
+  const float radius     = MAX_LIGHT_RADIUS
+                       * cbrtf(MIN(RADIUS_LIGHT_COUNT / num_lights, 1.0f));
+  return (light_config_t){
+    .num_lights   = (uint32_t)settings.num_lights,
+    .light_radius = MAX(radius, MIN_LIGHT_RADIUS),
+  };
 }
 
 static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
 {
   // Config uniform buffer
   {
-    lights.config_uniform_buffer_size = sizeof(uint32_t);
+    lights.config_uniform_buffer_size = sizeof(light_config_t);
     lights.config_uniform_buffer      = wgpuDeviceCreateBuffer(
            wgpu_context->device,
            &(WGPUBufferDescriptor){
@@ -857,10 +2228,10 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
              .mappedAtCreation = true,
       });
     ASSERT(lights.config_uniform_buffer);
-    uint32_t* config_data = (uint32_t*)wgpuBufferGetMappedRange(
+    light_config_t* config_data = (light_config_t*)wgpuBufferGetMappedRange(
       lights.config_uniform_buffer, 0, lights.config_uniform_buffer_size);
     ASSERT(config_data);
-    config_data[0] = settings.num_lights;
+    *config_data = get_light_config();
     wgpuBufferUnmap(lights.config_uniform_buffer);
   }
 
@@ -967,6 +2338,52 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
                             });
     ASSERT(gbuffer_textures_bind_group != NULL);
   }
+
+  // Inverse camera uniform buffer of the position reconstruction
+  {
+    const WGPUBufferDescriptor buffer_desc = {
+      .size  = sizeof(mat4), // 4x4 matrix
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+    };
+    gbuffer_compact.inverse_camera_uniform_buffer
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &buffer_desc);
+    ASSERT(gbuffer_compact.inverse_camera_uniform_buffer);
+  }
+
+  // Compact GBuffer bind group
+  {
+    WGPUBindGroupEntry bg_entries[5] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding     = 0,
+        .textureView = gbuffer_compact.texture_views[0],
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = gbuffer_compact.texture_views[1],
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding     = 2,
+        .textureView = depth_sample_texture_view,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = gbuffer_compact.inverse_camera_uniform_buffer,
+        .size    = sizeof(mat4),
+      },
+      [4] = (WGPUBindGroupEntry) {
+        .binding     = 4,
+        .textureView = ssao.texture_view,
+      },
+    };
+    gbuffer_compact.bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Compact GBuffer bind group",
+                              .layout     = gbuffer_compact.bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(gbuffer_compact.bind_group != NULL);
+  }
 }
 
 static void prepare_compute_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -982,6 +2399,22 @@ static void prepare_compute_pipeline_layout(wgpu_context_t* wgpu_context)
       wgpu_context->device, &compute_pipeline_layout_desc);
     ASSERT(light_update_compute_pipeline_layout != NULL);
   }
+
+  // Light culling compute pipeline layout
+  {
+    WGPUBindGroupLayout bind_group_layouts[2] = {
+      lights.buffer_bind_group_layout, // set 0
+      clusters.cull_bind_group_layout, // set 1
+    };
+    clusters.cull_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .label                = "Light culling compute pipeline layout",
+        .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+        .bindGroupLayouts     = bind_group_layouts,
+      });
+    ASSERT(clusters.cull_pipeline_layout != NULL);
+  }
 }
 
 static void prepare_light_update_compute_pipeline(wgpu_context_t* wgpu_context)
@@ -1120,6 +2553,352 @@ static void prepare_lights(wgpu_context_t* wgpu_context)
   }
 }
 
+static WGPUComputePipeline
+create_light_culling_pipeline(wgpu_context_t* wgpu_context, const char* entry)
+{
+  const char* sources[3] = {lights_common_wgsl, light_culling_range_wgsl,
+                            light_culling_kernels_wgsl};
+  char* source = concat_shader_sources(sources, (uint32_t)ARRAY_SIZE(sources));
+  wgpu_shader_t light_culling_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "Light culling WGSL",
+                    .wgsl_code.source = source,
+                    .entry            = entry,
+                  });
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(
+    wgpu_context->device,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "light_culling_compute_pipeline",
+      .layout  = clusters.cull_pipeline_layout,
+      .compute = light_culling_comp_shader.programmable_stage_descriptor,
+    });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&light_culling_comp_shader);
+  free(source);
+  return pipeline;
+}
+
+static void prepare_clusters(wgpu_context_t* wgpu_context)
+{
+  /* Cluster buffers */
+  {
+    clusters.uniform_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Cluster uniform buffer",
+        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+        .size  = sizeof(cluster_uniforms_t),
+      });
+    const WGPUBufferDescriptor buffer_desc = {
+      .usage = WGPUBufferUsage_Storage,
+      .size  = CLUSTER_COUNT * sizeof(uint32_t),
+    };
+    clusters.counts
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &buffer_desc);
+    clusters.cursors
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &buffer_desc);
+    clusters.offsets
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &buffer_desc);
+    clusters.light_indices = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Cluster light indices buffer",
+        .usage = WGPUBufferUsage_Storage,
+        .size  = CLUSTER_LIGHT_INDEX_CAPACITY * sizeof(uint32_t),
+      });
+    ASSERT(clusters.uniform_buffer && clusters.counts && clusters.cursors
+           && clusters.offsets && clusters.light_indices);
+  }
+
+  /* Light culling pipelines, the offsets are the scanned counts */
+  {
+    clusters.clear_pipeline
+      = create_light_culling_pipeline(wgpu_context, "clearClusters");
+    clusters.count_pipeline
+      = create_light_culling_pipeline(wgpu_context, "countLights");
+    clusters.assign_pipeline
+      = create_light_culling_pipeline(wgpu_context, "assignLights");
+    clusters.primitives
+      = wgpu_compute_primitives_create(wgpu_context, CLUSTER_COUNT);
+  }
+
+  /* Cluster culling bind group */
+  {
+    WGPUBindGroupEntry bg_entries[5] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = clusters.uniform_buffer,
+        .size    = sizeof(cluster_uniforms_t),
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = clusters.counts,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = clusters.cursors,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = clusters.offsets,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+      [4] = (WGPUBindGroupEntry) {
+        .binding = 4,
+        .buffer  = clusters.light_indices,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+    };
+    clusters.cull_bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Cluster culling bind group",
+                              .layout     = clusters.cull_bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(clusters.cull_bind_group != NULL);
+  }
+
+  /* Cluster shading bind group */
+  {
+    WGPUBindGroupEntry bg_entries[4] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = clusters.uniform_buffer,
+        .size    = sizeof(cluster_uniforms_t),
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = clusters.counts,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = clusters.offsets,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = clusters.light_indices,
+        .size    = WGPU_WHOLE_SIZE,
+      },
+    };
+    clusters.shading_bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Cluster shading bind group",
+                              .layout     = clusters.shading_bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(clusters.shading_bind_group != NULL);
+  }
+}
+
+static WGPUComputePipeline create_ssao_pipeline(wgpu_context_t* wgpu_context,
+                                                const char* kernel_source,
+                                                WGPUPipelineLayout layout)
+{
+  const char* sources[2] = {ssao_common_wgsl, kernel_source};
+  char* source = concat_shader_sources(sources, (uint32_t)ARRAY_SIZE(sources));
+  wgpu_shader_t ssao_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "SSAO WGSL",
+                    .wgsl_code.source = source,
+                    .entry            = "main",
+                  });
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(
+    wgpu_context->device,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "SSAO compute pipeline",
+      .layout  = layout,
+      .compute = ssao_comp_shader.programmable_stage_descriptor,
+    });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&ssao_comp_shader);
+  free(source);
+  return pipeline;
+}
+
+static void prepare_ssao(wgpu_context_t* wgpu_context)
+{
+  /* SSAO uniform buffer */
+  {
+    ssao.uniform_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "SSAO uniform buffer",
+        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+        .size  = sizeof(ssao_uniforms_t),
+      });
+    ASSERT(ssao.uniform_buffer != NULL);
+  }
+
+  /* Bind group layouts, binding 2 is the input, binding 3 the output */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[4] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: Uniform buffer (Compute shader) - Ssao
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(ssao_uniforms_t),
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Binding 1: Depth texture view
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Depth,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Octahedral normal / raw AO texture view
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Raw AO / AO storage texture view
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Compute,
+        .storageTexture = (WGPUStorageTextureBindingLayout) {
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = WGPUTextureFormat_RG32Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+    };
+    ssao.sample_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label      = "SSAO sample bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(ssao.sample_bind_group_layout != NULL);
+
+    bgl_entries[3].storageTexture.format = WGPUTextureFormat_R32Float;
+    ssao.upsample_bind_group_layout      = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label      = "SSAO upsample bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(ssao.upsample_bind_group_layout != NULL);
+  }
+
+  /* Pipelines */
+  {
+    ssao.sample_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .label                = "SSAO sample pipeline layout",
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts     = &ssao.sample_bind_group_layout,
+      });
+    ASSERT(ssao.sample_pipeline_layout != NULL);
+    ssao.upsample_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .label                = "SSAO upsample pipeline layout",
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts     = &ssao.upsample_bind_group_layout,
+      });
+    ASSERT(ssao.upsample_pipeline_layout != NULL);
+    ssao.sample_pipeline = create_ssao_pipeline(
+      wgpu_context, ssao_sample_wgsl, ssao.sample_pipeline_layout);
+    ssao.upsample_pipeline = create_ssao_pipeline(
+      wgpu_context, ssao_upsample_wgsl, ssao.upsample_pipeline_layout);
+  }
+
+  /* Bind groups of the half and full resolution */
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(ssao.raw_texture_views); ++i) {
+    WGPUBindGroupEntry bg_entries[4] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = ssao.uniform_buffer,
+        .size    = sizeof(ssao_uniforms_t),
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = depth_sample_texture_view,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding     = 2,
+        .textureView = gbuffer_compact.texture_views[0],
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding     = 3,
+        .textureView = ssao.raw_texture_views[i],
+      },
+    };
+    ssao.sample_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "SSAO sample bind group",
+                              .layout     = ssao.sample_bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(ssao.sample_bind_groups[i] != NULL);
+
+    bg_entries[2].textureView    = ssao.raw_texture_views[i];
+    bg_entries[3].textureView    = ssao.texture_view;
+    ssao.upsample_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "SSAO upsample bind group",
+                              .layout     = ssao.upsample_bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(ssao.upsample_bind_groups[i] != NULL);
+  }
+}
+
+// Cluster uniforms and inverse view projection of the current camera
+static void update_shading_uniforms(wgpu_context_t* wgpu_context)
+{
+  cluster_uniforms_t uniforms = {
+    .proj_scale = {view_matrices.projection_matrix[0][0],
+                   view_matrices.projection_matrix[1][1]},
+    .depth_range  = {cluster_depth_range[0], cluster_depth_range[1]},
+    .surface_size = {(float)wgpu_context->surface.width,
+                     (float)wgpu_context->surface.height},
+    .index_capacity = CLUSTER_LIGHT_INDEX_CAPACITY,
+  };
+  glm_mat4_copy(view_matrices.view_matrix, uniforms.view_matrix);
+  glm_mat4_copy(view_matrices.view_proj_matrix, uniforms.view_proj_matrix);
+  wgpuQueueWriteBuffer(wgpu_context->queue, clusters.uniform_buffer, 0,
+                       &uniforms, sizeof(uniforms));
+
+  mat4 inverse_view_proj_matrix = GLM_MAT4_IDENTITY_INIT;
+  glm_mat4_inv(view_matrices.view_proj_matrix, inverse_view_proj_matrix);
+  wgpuQueueWriteBuffer(wgpu_context->queue,
+                       gbuffer_compact.inverse_camera_uniform_buffer, 0,
+                       inverse_view_proj_matrix, sizeof(mat4));
+
+  // The view depth is B / (depth + A) with depth = (A * z + B) / -z
+  ssao_uniforms_t ssao_uniforms = {
+    .depth_params = {view_matrices.projection_matrix[2][2],
+                     view_matrices.projection_matrix[3][2]},
+    .radius       = SSAO_RADIUS,
+    .intensity    = SSAO_INTENSITY,
+    .scale        = settings.ssao_mode == SsaoMode_Full ? 1u : 2u,
+  };
+  glm_mat4_copy(view_matrices.view_proj_matrix, ssao_uniforms.view_proj_matrix);
+  glm_mat4_copy(inverse_view_proj_matrix, ssao_uniforms.inv_view_proj_matrix);
+  wgpuQueueWriteBuffer(wgpu_context->queue, ssao.uniform_buffer, 0,
+                       &ssao_uniforms, sizeof(ssao_uniforms));
+}
+
 static void prepare_view_matrices(wgpu_context_t* wgpu_context)
 {
   float aspect_ratio
@@ -1143,6 +2922,8 @@ static void prepare_view_matrices(wgpu_context_t* wgpu_context)
   mat4 view_proj_matrix = GLM_MAT4_IDENTITY_INIT;
   glm_mat4_mulN((mat4*[]){&view_matrices.projection_matrix, &view_matrix}, 2,
                 view_proj_matrix);
+  glm_mat4_copy(view_matrix, view_matrices.view_matrix);
+  glm_mat4_copy(view_proj_matrix, view_matrices.view_proj_matrix);
 
   // Move the model so it's centered.
   mat4 model_matrix = GLM_MAT4_IDENTITY_INIT;
@@ -1168,6 +2949,7 @@ static void prepare_view_matrices(wgpu_context_t* wgpu_context)
     = {(float)wgpu_context->surface.width, (float)wgpu_context->surface.height};
   wgpuQueueWriteBuffer(wgpu_context->queue, surface_size_uniform_buffer, 0,
                        surface_size_data, sizeof(vec2));
+  update_shading_uniforms(wgpu_context);
 }
 
 /**
@@ -1207,14 +2989,14 @@ static mat4* get_camera_view_proj_matrix(wgpu_example_context_t* context)
   const float rad = PI * (context->frame.timestamp_millis / 5000.0f);
   glm_vec3_rotate_y(eye_position, view_matrices.origin, rad, &eye_position);
 
-  mat4 view_matrix = GLM_MAT4_IDENTITY_INIT;
   glm_lookat(eye_position,            //
              view_matrices.origin,    //
              view_matrices.up_vector, //
-             view_matrix);
+             view_matrices.view_matrix);
 
-  glm_mat4_mulN((mat4*[]){&view_matrices.projection_matrix, &view_matrix}, 2,
-                view_matrices.view_proj_matrix);
+  glm_mat4_mulN(
+    (mat4*[]){&view_matrices.projection_matrix, &view_matrices.view_matrix}, 2,
+    view_matrices.view_proj_matrix);
   return &view_matrices.view_proj_matrix;
 }
 
@@ -1223,6 +3005,7 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   mat4* camera_view_proj = get_camera_view_proj_matrix(context);
   wgpuQueueWriteBuffer(context->wgpu_context->queue, camera_uniform_buffer, 0,
                        *camera_view_proj, sizeof(mat4));
+  update_shading_uniforms(context->wgpu_context);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -1231,19 +3014,28 @@ static int example_initialize(wgpu_example_context_t* context)
     stanford_dragon_mesh_init(&stanford_dragon_mesh);
     prepare_vertex_and_index_buffers(context->wgpu_context,
                                      &stanford_dragon_mesh);
+    prepare_light_volume_mesh(context->wgpu_context);
+    // The mesh data is in the vertex and index buffers now
+    stanford_dragon_mesh_destroy(&stanford_dragon_mesh);
     prepare_gbuffer_texture_render_targets(context->wgpu_context);
     prepare_depth_texture(context->wgpu_context);
+    prepare_ssao_textures(context->wgpu_context);
     prepare_bind_group_layouts(context->wgpu_context);
     prepare_render_pipeline_layouts(context->wgpu_context);
     prepare_write_gbuffers_pipeline(context->wgpu_context);
+    prepare_write_gbuffers_compact_pipeline(context->wgpu_context);
     prepare_gbuffers_debug_view_pipeline(context->wgpu_context);
-    prepare_deferred_render_pipeline(context->wgpu_context);
+    prepare_deferred_render_pipelines(context->wgpu_context);
+    prepare_light_volume_pipelines(context->wgpu_context);
     setup_render_passes();
     prepare_uniform_buffers(context->wgpu_context);
     prepare_compute_pipeline_layout(context->wgpu_context);
     prepare_light_update_compute_pipeline(context->wgpu_context);
     prepare_lights(context->wgpu_context);
+    prepare_clusters(context->wgpu_context);
+    prepare_ssao(context->wgpu_context);
     prepare_view_matrices(context->wgpu_context);
+    compute_scheduler = wgpu_compute_scheduler_create(context->wgpu_context);
     prepared = true;
     return 0;
   }
@@ -1251,8 +3043,47 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+// Keeps the last GPU time of the SSAO of the current mode for the comparison
+static void update_ssao_gpu_time(wgpu_profiler_t* profiler)
+{
+  if (!is_ssao_enabled()) {
+    return;
+  }
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  for (uint32_t i = 0; i < wgpu_profiler_get_scope_count(profiler); ++i) {
+    if (strcmp(scopes[i].name, "SSAO") == 0) {
+      ssao.gpu_time_ms[settings.ssao_mode] = scopes[i].avg_gpu_time_ms;
+    }
+  }
+}
+
+// Keeps the last GPU time of the current shading technique, the clustered
+// shading includes the light culling
+static void update_shading_gpu_time(wgpu_profiler_t* profiler)
+{
+  if (settings.current_render_mode != RenderMode_Rendering) {
+    return;
+  }
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  float gpu_time_ms = 0.0f;
+  for (uint32_t i = 0; i < wgpu_profiler_get_scope_count(profiler); ++i) {
+    if (strcmp(scopes[i].name, "Deferred shading") == 0
+        || (settings.light_culling == LightCulling_Clustered
+            && strcmp(scopes[i].name, "Light culling") == 0)) {
+      gpu_time_ms += scopes[i].avg_gpu_time_ms;
+    }
+  }
+  shading_timings[settings.light_culling].gpu_time_ms = gpu_time_ms;
+  shading_timings[settings.light_culling].num_lights  = settings.num_lights;
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
+  update_ssao_gpu_time(context->wgpu_context->profiler);
+  update_shading_gpu_time(context->wgpu_context->profiler);
+
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
     static const char* mode[3] = {"rendering", "gBuffers view"};
@@ -1261,16 +3092,203 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                 mode, 2)) {
       settings.current_render_mode = (render_mode_enum)item_index;
     }
+    static const char* gbuffer_format[2] = {"full", "compact"};
+    item_index                           = (int32_t)settings.gbuffer_format;
+    if (imgui_overlay_combo_box(context->imgui_overlay, "GBuffer",
+                                &item_index, gbuffer_format, 2)) {
+      settings.gbuffer_format = (gbuffer_format_enum)item_index;
+    }
+    static const char* culling[3] = {"none", "clustered", "light volumes"};
+    item_index                    = (int32_t)settings.light_culling;
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Light culling",
+                                &item_index, culling, 3)) {
+      settings.light_culling = (light_culling_enum)item_index;
+    }
+    static const char* ssao_mode[3] = {"off", "half resolution",
+                                       "full resolution"};
+    item_index                      = (int32_t)settings.ssao_mode;
+    if (imgui_overlay_combo_box(context->imgui_overlay, "SSAO", &item_index,
+                                ssao_mode, 3)) {
+      settings.ssao_mode = (ssao_mode_enum)item_index;
+      update_shading_uniforms(context->wgpu_context);
+    }
     if (imgui_overlay_slider_int(context->imgui_overlay, "Number of Lights",
                                  &settings.num_lights, 1, max_num_lights)) {
-      uint32_t num_lights[1] = {(uint32_t)settings.num_lights};
+      const light_config_t config = get_light_config();
       wgpuQueueWriteBuffer(context->wgpu_context->queue,
-                           lights.config_uniform_buffer, 0, num_lights,
-                           sizeof(uint32_t));
+                           lights.config_uniform_buffer, 0, &config,
+                           sizeof(config));
+    }
+    imgui_overlay_text("Light radius: %.1f", get_light_config().light_radius);
+    imgui_overlay_text("Clusters: %ux%ux%u", CLUSTER_DIM_X, CLUSTER_DIM_Y,
+                       CLUSTER_DIM_Z);
+    const uint32_t bytes_per_pixel
+      = gbuffer_bytes_per_pixel[get_gbuffer_format()];
+    imgui_overlay_text("GBuffer: %u bytes/pixel (%u saved)", bytes_per_pixel,
+                       gbuffer_bytes_per_pixel[GBufferFormat_Full]
+                         - bytes_per_pixel);
+    if (get_gbuffer_format() != GBufferFormat_Compact) {
+      imgui_overlay_text("SSAO needs the compact GBuffer");
+    }
+    // Measured when the modes were last enabled
+    imgui_overlay_text("SSAO: %.2f ms half, %.2f ms full resolution",
+                       ssao.gpu_time_ms[SsaoMode_Half],
+                       ssao.gpu_time_ms[SsaoMode_Full]);
+    // Measured when the techniques were last selected
+    for (uint32_t i = 0; i < (uint32_t)LightCulling_Count; ++i) {
+      if (shading_timings[i].num_lights > 0) {
+        imgui_overlay_text("Shading (%s): %.2f ms at %d lights", culling[i],
+                           shading_timings[i].gpu_time_ms,
+                           shading_timings[i].num_lights);
+      }
     }
   }
 }
 
+// Update lights position
+static void record_light_update(WGPUComputePassEncoder light_pass,
+                                void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  wgpuComputePassEncoderSetPipeline(light_pass, light_update_compute_pipeline);
+  wgpuComputePassEncoderSetBindGroup(light_pass, 0,
+                                     lights.buffer_compute_bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    light_pass, (uint32_t)ceil(settings.num_lights / 64.f), 1, 1);
+}
+
+// Bin the lights into the clusters: count the lights of every cluster, scan
+// the counts into offsets and write the light indices
+static void record_light_culling(WGPUCommandEncoder cmd_enc, void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  const uint32_t light_groups = (uint32_t)ceil(settings.num_lights / 64.f);
+  WGPUComputePassEncoder cull_pass
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetBindGroup(cull_pass, 0, lights.buffer_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetBindGroup(cull_pass, 1, clusters.cull_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetPipeline(cull_pass, clusters.clear_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cull_pass, (uint32_t)ceil(CLUSTER_COUNT / 64.f), 1, 1);
+  wgpuComputePassEncoderSetPipeline(cull_pass, clusters.count_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(cull_pass, light_groups, 1, 1);
+  wgpuComputePassEncoderEnd(cull_pass);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cull_pass)
+
+  wgpu_compute_exclusive_scan(clusters.primitives, cmd_enc, clusters.counts,
+                              clusters.offsets, CLUSTER_COUNT);
+
+  cull_pass = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetBindGroup(cull_pass, 0, lights.buffer_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetBindGroup(cull_pass, 1, clusters.cull_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetPipeline(cull_pass, clusters.assign_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(cull_pass, light_groups, 1, 1);
+  wgpuComputePassEncoderEnd(cull_pass);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cull_pass)
+}
+
+static void submit_compute_tasks(void)
+{
+  wgpu_compute_scheduler_add_task(compute_scheduler,
+                                  &(wgpu_compute_task_desc_t){
+                                    .label       = "Light update",
+                                    .write_count = 1,
+                                    .writes[0]   = lights.buffer,
+                                    .pass_func   = record_light_update,
+                                  });
+  if (settings.current_render_mode == RenderMode_Rendering
+      && settings.light_culling == LightCulling_Clustered) {
+    wgpu_compute_scheduler_add_task(
+      compute_scheduler, &(wgpu_compute_task_desc_t){
+                           .label        = "Light culling",
+                           .read_count   = 2,
+                           .reads[0]     = lights.buffer,
+                           .reads[1]     = clusters.uniform_buffer,
+                           .write_count  = 4,
+                           .writes[0]    = clusters.counts,
+                           .writes[1]    = clusters.cursors,
+                           .writes[2]    = clusters.offsets,
+                           .writes[3]    = clusters.light_indices,
+                           .encoder_func = record_light_culling,
+                         });
+  }
+  wgpu_compute_scheduler_submit(compute_scheduler);
+}
+
+// Sample the AO at the resolution of the mode, then blur and upsample it
+static void record_ssao(WGPUCommandEncoder cmd_enc, uint32_t width,
+                        uint32_t height)
+{
+  const uint32_t index = (uint32_t)settings.ssao_mode - 1u;
+  const uint32_t scale = settings.ssao_mode == SsaoMode_Full ? 1u : 2u;
+  WGPUComputePassEncoder ssao_pass
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(ssao_pass, ssao.sample_pipeline);
+  wgpuComputePassEncoderSetBindGroup(ssao_pass, 0,
+                                     ssao.sample_bind_groups[index], 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    ssao_pass, (width + 8 * scale - 1) / (8 * scale),
+    (height + 8 * scale - 1) / (8 * scale), 1);
+  wgpuComputePassEncoderSetPipeline(ssao_pass, ssao.upsample_pipeline);
+  wgpuComputePassEncoderSetBindGroup(ssao_pass, 0,
+                                     ssao.upsample_bind_groups[index], 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(ssao_pass, (width + 7) / 8,
+                                           (height + 7) / 8, 1);
+  wgpuComputePassEncoderEnd(ssao_pass);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, ssao_pass)
+}
+
+// Ambient term, then the stencil marking and the shading of the light volumes
+static void record_light_volumes(WGPUCommandEncoder cmd_enc,
+                                 WGPUTextureView frame_buffer)
+{
+  const gbuffer_format_enum gbuffer_format = get_gbuffer_format();
+  const uint32_t num_lights                = (uint32_t)settings.num_lights;
+  light_volume_pass.color_attachments[0].view = frame_buffer;
+  WGPURenderPassEncoder volume_pass
+    = wgpuCommandEncoderBeginRenderPass(cmd_enc, &light_volume_pass.descriptor);
+  wgpuRenderPassEncoderSetBindGroup(
+    volume_pass, 0,
+    gbuffer_format == GBufferFormat_Compact ? gbuffer_compact.bind_group :
+                                              gbuffer_textures_bind_group,
+    0, 0);
+  wgpuRenderPassEncoderSetBindGroup(volume_pass, 1, lights.buffer_bind_group,
+                                    0, 0);
+  wgpuRenderPassEncoderSetBindGroup(volume_pass, 2,
+                                    surface_size_uniform_bind_group, 0, 0);
+  wgpuRenderPassEncoderSetBindGroup(volume_pass, 3,
+                                    clusters.shading_bind_group, 0, 0);
+  wgpuRenderPassEncoderSetPipeline(
+    volume_pass,
+    deferred_render_pipelines[gbuffer_format][LightCulling_Volumes]);
+  wgpuRenderPassEncoderDraw(volume_pass, 6, 1, 0, 0);
+
+  // One sphere instance per light
+  wgpuRenderPassEncoderSetVertexBuffer(volume_pass, 0,
+                                       light_volumes.vertex_buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(volume_pass, light_volumes.index_buffer,
+                                      WGPUIndexFormat_Uint16, 0,
+                                      WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetStencilReference(volume_pass, 0);
+  wgpuRenderPassEncoderSetPipeline(
+    volume_pass, light_volumes.stencil_pipelines[gbuffer_format]);
+  wgpuRenderPassEncoderDrawIndexed(volume_pass, light_volumes.index_count,
+                                   num_lights, 0, 0, 0);
+  wgpuRenderPassEncoderSetPipeline(
+    volume_pass, light_volumes.lighting_pipelines[gbuffer_format]);
+  wgpuRenderPassEncoderDrawIndexed(volume_pass, light_volumes.index_count,
+                                   num_lights, 0, 0, 0);
+  wgpuRenderPassEncoderEnd(volume_pass);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, volume_pass)
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   wgpu_context->cmd_enc
@@ -1278,9 +3296,15 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
   {
     // Write position, normal, albedo etc. data to gBuffers
+    wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                              "G-Buffer");
+    const bool compact = get_gbuffer_format() == GBufferFormat_Compact;
     WGPURenderPassEncoder gbuffer_pass = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc, &write_gbuffer_pass.descriptor);
-    wgpuRenderPassEncoderSetPipeline(gbuffer_pass, write_gbuffers_pipeline);
+      wgpu_context->cmd_enc, compact ? &write_gbuffer_compact_pass.descriptor :
+                                       &write_gbuffer_pass.descriptor);
+    wgpuRenderPassEncoderSetPipeline(gbuffer_pass,
+                                     compact ? gbuffer_compact.write_pipeline :
+                                               write_gbuffers_pipeline);
     wgpuRenderPassEncoderSetBindGroup(gbuffer_pass, 0, scene_uniform_bind_group,
                                       0, 0);
     wgpuRenderPassEncoderSetVertexBuffer(gbuffer_pass, 0, vertex_buffer, 0,
@@ -1290,23 +3314,32 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpuRenderPassEncoderDrawIndexed(gbuffer_pass, index_count, 1, 0, 0, 0);
     wgpuRenderPassEncoderEnd(gbuffer_pass);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, gbuffer_pass)
+    wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
   }
 
-  {
-    // Update lights position
-    WGPUComputePassEncoder light_pass
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(light_pass,
-                                      light_update_compute_pipeline);
-    wgpuComputePassEncoderSetBindGroup(
-      light_pass, 0, lights.buffer_compute_bind_group, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      light_pass, (uint32_t)ceil(max_num_lights / 64.f), 1, 1);
-    wgpuComputePassEncoderEnd(light_pass);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, light_pass)
+  if (is_ssao_enabled()) {
+    wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                              "SSAO");
+    record_ssao(wgpu_context->cmd_enc, wgpu_context->surface.width,
+                wgpu_context->surface.height);
+    wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
+    ssao.cleared = false;
+  }
+  else if (!ssao.cleared) {
+    // No occlusion until the SSAO is enabled again
+    WGPURenderPassEncoder clear_pass = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &(WGPURenderPassDescriptor){
+                               .colorAttachmentCount = 1,
+                               .colorAttachments = &ssao.clear_attachment,
+                             });
+    wgpuRenderPassEncoderEnd(clear_pass);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, clear_pass)
+    ssao.cleared = true;
   }
 
   {
+    wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                              "Deferred shading");
     if (settings.current_render_mode == RenderMode_GBuffer_View) {
       // GBuffers debug view
       // Left: position
@@ -1326,6 +3359,10 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       wgpuRenderPassEncoderEnd(debug_view_pass);
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, debug_view_pass)
     }
+    else if (settings.light_culling == LightCulling_Volumes) {
+      record_light_volumes(wgpu_context->cmd_enc,
+                           wgpu_context->swap_chain.frame_buffer);
+    }
     else {
       // Deferred rendering
       texture_quad_pass.color_attachments[0].view
@@ -1333,18 +3370,30 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       WGPURenderPassEncoder deferred_rendering_pass
         = wgpuCommandEncoderBeginRenderPass(wgpu_context->cmd_enc,
                                             &texture_quad_pass.descriptor);
-      wgpuRenderPassEncoderSetPipeline(deferred_rendering_pass,
-                                       deferred_render_pipeline);
-      wgpuRenderPassEncoderSetBindGroup(deferred_rendering_pass, 0,
-                                        gbuffer_textures_bind_group, 0, 0);
+      const gbuffer_format_enum gbuffer_format = get_gbuffer_format();
+      const bool clustered
+        = settings.light_culling == LightCulling_Clustered;
+      wgpuRenderPassEncoderSetPipeline(
+        deferred_rendering_pass,
+        deferred_render_pipelines[gbuffer_format][settings.light_culling]);
+      wgpuRenderPassEncoderSetBindGroup(
+        deferred_rendering_pass, 0,
+        gbuffer_format == GBufferFormat_Compact ? gbuffer_compact.bind_group :
+                                                  gbuffer_textures_bind_group,
+        0, 0);
       wgpuRenderPassEncoderSetBindGroup(deferred_rendering_pass, 1,
                                         lights.buffer_bind_group, 0, 0);
       wgpuRenderPassEncoderSetBindGroup(deferred_rendering_pass, 2,
                                         surface_size_uniform_bind_group, 0, 0);
+      if (clustered) {
+        wgpuRenderPassEncoderSetBindGroup(deferred_rendering_pass, 3,
+                                          clusters.shading_bind_group, 0, 0);
+      }
       wgpuRenderPassEncoderDraw(deferred_rendering_pass, 6, 1, 0, 0);
       wgpuRenderPassEncoderEnd(deferred_rendering_pass);
       WGPU_RELEASE_RESOURCE(RenderPassEncoder, deferred_rendering_pass)
     }
+    wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
   }
 
   // Draw ui overlay
@@ -1361,6 +3410,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
 static int example_draw(wgpu_example_context_t* context)
 {
+  // Light update and culling, independent of the swap chain image
+  submit_compute_tasks();
+
   // Prepare frame
   prepare_frame(context);
 
@@ -1402,8 +3454,34 @@ static void example_destroy(wgpu_example_context_t* context)
   for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(gbuffer.texture_views); ++i) {
     WGPU_RELEASE_RESOURCE(TextureView, gbuffer.texture_views[i])
   }
+  WGPU_RELEASE_RESOURCE(Texture, gbuffer_compact.texture_normal)
+  WGPU_RELEASE_RESOURCE(Texture, gbuffer_compact.texture_albedo)
+  for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(gbuffer_compact.texture_views);
+       ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, gbuffer_compact.texture_views[i])
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, gbuffer_compact.inverse_camera_uniform_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, gbuffer_compact.bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, gbuffer_compact.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, gbuffer_compact.write_pipeline)
+  for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(ssao.raw_textures); ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, ssao.raw_texture_views[i])
+    WGPU_RELEASE_RESOURCE(Texture, ssao.raw_textures[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, ssao.sample_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, ssao.upsample_bind_groups[i])
+  }
+  WGPU_RELEASE_RESOURCE(TextureView, ssao.texture_view)
+  WGPU_RELEASE_RESOURCE(Texture, ssao.texture)
+  WGPU_RELEASE_RESOURCE(Buffer, ssao.uniform_buffer)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ssao.sample_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ssao.upsample_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ssao.sample_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ssao.upsample_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ssao.sample_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ssao.upsample_bind_group_layout)
   WGPU_RELEASE_RESOURCE(Texture, depth_texture)
   WGPU_RELEASE_RESOURCE(TextureView, depth_texture_view)
+  WGPU_RELEASE_RESOURCE(TextureView, depth_sample_texture_view)
   WGPU_RELEASE_RESOURCE(Buffer, model_uniform_buffer)
   WGPU_RELEASE_RESOURCE(Buffer, camera_uniform_buffer)
   WGPU_RELEASE_RESOURCE(Buffer, surface_size_uniform_buffer)
@@ -1412,6 +3490,21 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, lights.config_uniform_buffer)
   WGPU_RELEASE_RESOURCE(BindGroup, lights.buffer_bind_group)
   WGPU_RELEASE_RESOURCE(BindGroup, lights.buffer_compute_bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, clusters.uniform_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, clusters.counts)
+  WGPU_RELEASE_RESOURCE(Buffer, clusters.cursors)
+  WGPU_RELEASE_RESOURCE(Buffer, clusters.offsets)
+  WGPU_RELEASE_RESOURCE(Buffer, clusters.light_indices)
+  WGPU_RELEASE_RESOURCE(BindGroup, clusters.cull_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, clusters.shading_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, clusters.cull_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, clusters.shading_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, clusters.clear_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, clusters.count_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, clusters.assign_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, clusters.cull_pipeline_layout)
+  wgpu_compute_primitives_destroy(clusters.primitives);
+  wgpu_compute_scheduler_destroy(compute_scheduler);
   WGPU_RELEASE_RESOURCE(BindGroup, scene_uniform_bind_group)
   WGPU_RELEASE_RESOURCE(BindGroup, surface_size_uniform_bind_group)
   WGPU_RELEASE_RESOURCE(BindGroup, gbuffer_textures_bind_group)
@@ -1421,13 +3514,24 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, scene_uniform_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, surface_size_uniform_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, gbuffer_textures_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Buffer, light_volumes.vertex_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, light_volumes.index_buffer)
+  for (uint32_t f = 0; f < (uint32_t)GBufferFormat_Count; ++f) {
+    WGPU_RELEASE_RESOURCE(RenderPipeline, light_volumes.stencil_pipelines[f])
+    WGPU_RELEASE_RESOURCE(RenderPipeline, light_volumes.lighting_pipelines[f])
+  }
   WGPU_RELEASE_RESOURCE(RenderPipeline, write_gbuffers_pipeline)
   WGPU_RELEASE_RESOURCE(RenderPipeline, gbuffers_debug_view_pipeline)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, deferred_render_pipeline)
+  for (uint32_t f = 0; f < (uint32_t)GBufferFormat_Count; ++f) {
+    for (uint32_t c = 0; c < (uint32_t)LightCulling_Count; ++c) {
+      WGPU_RELEASE_RESOURCE(RenderPipeline, deferred_render_pipelines[f][c])
+      WGPU_RELEASE_RESOURCE(PipelineLayout,
+                            deferred_render_pipeline_layouts[f][c])
+    }
+  }
   WGPU_RELEASE_RESOURCE(ComputePipeline, light_update_compute_pipeline)
   WGPU_RELEASE_RESOURCE(PipelineLayout, write_gbuffers_pipeline_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, gbuffers_debug_view_pipeline_layout)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, deferred_render_pipeline_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, light_update_compute_pipeline_layout)
 }
 
@@ -18,7 +18,6 @@
  * -------------------------------------------------------------------------- */
 
 #define OBJECT_INSTANCES 125
-#define ALIGNMENT 256 // 256-byte alignment
 
 // Vertex layout for this example
 typedef struct {
@@ -34,11 +33,8 @@ static wgpu_buffer_t indices = {0};
 
 static struct {
   struct wgpu_buffer_t view;
-  struct {
-    WGPUBuffer buffer;
-    uint64_t buffer_size;
-    uint64_t model_size;
-  } dynamic;
+  // Per-object model matrices packed by the uniform allocator
+  wgpu_uniform_allocator_t* dynamic;
 } uniform_buffers = {0};
 
 static struct {
@@ -50,11 +46,9 @@ static struct {
 static vec3 rotations[OBJECT_INSTANCES]       = {0};
 static vec3 rotation_speeds[OBJECT_INSTANCES] = {0};
 
-// One big uniform buffer that contains all matrices
-static struct {
-  mat4 model;
-  uint8_t padding[192];
-} ubo_data_dynamic[OBJECT_INSTANCES] = {0};
+// Per-object model matrices and their offsets in the dynamic uniform buffer
+static mat4 model_matrices[OBJECT_INSTANCES]      = {0};
+static uint32_t dynamic_offsets[OBJECT_INSTANCES] = {0};
 
 // Pipeline
 static WGPUPipelineLayout pipeline_layout;
@@ -71,7 +65,7 @@ static struct {
 } render_pass;
 
 // Render bundle
-static WGPURenderBundle render_bundle;
+static wgpu_render_bundle_cache_t* render_bundle_cache;
 
 // Render bundle setting & animation timer
 static bool render_bundles   = true;
@@ -155,7 +149,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_Uniform,
         .hasDynamicOffset = true,
-        .minBindingSize   = (uint64_t)uniform_buffers.dynamic.model_size,
+        .minBindingSize   = sizeof(mat4),
       },
       .sampler = {0},
     }
@@ -178,11 +172,6 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
   ASSERT(pipeline_layout != NULL);
 }
 
-static uint64_t calc_constant_buffer_byte_size(uint64_t byte_size)
-{
-  return (byte_size + 255) & ~255;
-}
-
 static void setup_bind_groups(wgpu_context_t* wgpu_context)
 {
   // Bind Group
@@ -197,9 +186,9 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
     [1] = (WGPUBindGroupEntry) {
       // Binding 1 : Instance matrix as dynamic uniform buffer
       .binding = 1,
-      .buffer  = uniform_buffers.dynamic.buffer,
+      .buffer  = wgpu_uniform_allocator_get_buffer(uniform_buffers.dynamic),
       .offset  = 0,
-      .size    = uniform_buffers.dynamic.model_size,
+      .size    = sizeof(mat4),
     }
   };
   WGPUBindGroupDescriptor bg_desc = {
@@ -331,30 +320,35 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
     for (uint32_t i = 0; i < OBJECT_INSTANCES; ++i) {                          \
       /* One dynamic offset per dynamic bind group to offset into the ubo      \
        * containing all model matrices*/                                       \
-      uint32_t dynamic_offset = i * (uint32_t)ALIGNMENT;                       \
       /* Bind the bind group for rendering a mesh using the dynamic offset */  \
-      wgpu##Type##SetBindGroup(rpass_enc, 0, bind_group, 1, &dynamic_offset);  \
+      wgpu##Type##SetBindGroup(rpass_enc, 0, bind_group, 1,                    \
+                               &dynamic_offsets[i]);                           \
       wgpu##Type##DrawIndexed(rpass_enc, indices.count, 1, 0, 0, 0);           \
     }                                                                          \
   }
 
-static void prepare_render_bundle_encoder(wgpu_context_t* wgpu_context)
+static void record_render_bundle(WGPURenderBundleEncoder bundle_encoder,
+                                 void* user_data)
 {
-  WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
-  WGPURenderBundleEncoder render_bundle_encoder
-    = wgpuDeviceCreateRenderBundleEncoder(
-      wgpu_context->device,
-      &(WGPURenderBundleEncoderDescriptor){
-        .label              = "dynamic_uniform_buffer_render_bundle_encoder",
-        .colorFormatsCount  = (uint32_t)ARRAY_SIZE(color_formats),
-        .colorFormats       = color_formats,
-        .depthStencilFormat = WGPUTextureFormat_Depth24PlusStencil8,
-        .sampleCount        = 1,
-      });
-  RECORD_RENDER_PASS(RenderBundleEncoder, render_bundle_encoder)
-  render_bundle = wgpuRenderBundleEncoderFinish(render_bundle_encoder, NULL);
+  UNUSED_VAR(user_data);
+  RECORD_RENDER_PASS(RenderBundleEncoder, bundle_encoder)
+}
 
-  WGPU_RELEASE_RESOURCE(RenderBundleEncoder, render_bundle_encoder)
+static void prepare_render_bundle_cache(wgpu_context_t* wgpu_context)
+{
+  WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
+  render_bundle_cache                = wgpu_render_bundle_cache_create(
+    wgpu_context,
+    &(wgpu_render_bundle_cache_desc_t){
+      .label                = "dynamic_uniform_buffer_render_bundle",
+      .color_format_count   = (uint32_t)ARRAY_SIZE(color_formats),
+      .color_formats        = color_formats,
+      .depth_stencil_format = WGPUTextureFormat_Depth24PlusStencil8,
+      .sample_count         = 1,
+      .record_func          = record_render_bundle,
+    });
+  wgpu_render_bundle_cache_set_dependency(render_bundle_cache, 0, pipeline);
+  wgpu_render_bundle_cache_set_dependency(render_bundle_cache, 1, bind_group);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -364,9 +358,10 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   glm_mat4_copy(camera->matrices.perspective, ubo_vs.projection_matrix);
   glm_mat4_copy(camera->matrices.view, ubo_vs.view_matrix);
 
-  // Map uniform buffer and update it
-  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.view.buffer, 0,
-                          &ubo_vs, uniform_buffers.view.size);
+  // Update uniform buffer through the upload ring
+  wgpu_upload_ring_write_buffer(context->wgpu_context->upload_ring,
+                                uniform_buffers.view.buffer, 0, &ubo_vs,
+                                uniform_buffers.view.size);
 }
 
 // Prepare and initialize uniform buffer containing shader uniforms
@@ -391,7 +386,7 @@ static void update_dynamic_uniform_buffer(wgpu_example_context_t* context,
         uint32_t index = x * dim * dim + y * dim + z;
 
         // Model
-        mat4* modelMat = &ubo_data_dynamic[index].model;
+        mat4* modelMat = &model_matrices[index];
 
         // Update rotations
         glm_vec3_scale(rotation_speeds[index], animation_timer,
@@ -414,10 +409,18 @@ static void update_dynamic_uniform_buffer(wgpu_example_context_t* context,
 
   animation_timer = 0.0f;
 
-  // Update buffer
-  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.dynamic.buffer,
-                          0, &ubo_data_dynamic,
-                          uniform_buffers.dynamic.buffer_size);
+  // Pack the matrices into the dynamic uniform buffer, the objects are
+  // allocated in the same order every update so the offsets recorded in the
+  // render bundle stay valid
+  wgpu_uniform_allocator_reset(uniform_buffers.dynamic);
+  for (uint32_t i = 0; i < OBJECT_INSTANCES; ++i) {
+    wgpu_uniform_allocation_t allocation;
+    if (wgpu_uniform_allocator_push(uniform_buffers.dynamic, model_matrices[i],
+                                    sizeof(mat4), &allocation)) {
+      dynamic_offsets[i] = allocation.offset;
+    }
+  }
+  wgpu_uniform_allocator_flush(uniform_buffers.dynamic);
 }
 
 // Prepare and initialize uniform buffer containing shader uniforms
@@ -434,14 +437,11 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
     });
 
   // Uniform buffer object with per-object matrices
-  uniform_buffers.dynamic.model_size = sizeof(mat4);
-  uniform_buffers.dynamic.buffer_size
-    = calc_constant_buffer_byte_size(sizeof(ubo_data_dynamic));
-  uniform_buffers.dynamic.buffer = wgpuDeviceCreateBuffer(
-    context->wgpu_context->device,
-    &(WGPUBufferDescriptor){
-      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
-      .size  = uniform_buffers.dynamic.buffer_size,
+  uniform_buffers.dynamic = wgpu_uniform_allocator_create(
+    context->wgpu_context,
+    &(wgpu_uniform_allocator_desc_t){
+      .label = "Dynamic uniform buffer",
+      .size  = OBJECT_INSTANCES * 256,
     });
 
   // Prepare per-object matrices with offsets and random rotations
@@ -471,7 +471,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_pipeline(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
-    prepare_render_bundle_encoder(context->wgpu_context);
+    prepare_render_bundle_cache(context->wgpu_context);
     prepared = true;
     return 0;
   }
@@ -500,8 +500,8 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpu_context->cmd_enc, &render_pass.descriptor);
 
   if (render_bundles) {
-    wgpuRenderPassEncoderExecuteBundles(wgpu_context->rpass_enc, 1,
-                                        &render_bundle);
+    wgpu_render_bundle_cache_execute(render_bundle_cache,
+                                     wgpu_context->rpass_enc);
   }
   else {
     RECORD_RENDER_PASS(RenderPassEncoder, wgpu_context->rpass_enc)
@@ -565,12 +565,12 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, indices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.view.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.dynamic.buffer)
+  wgpu_uniform_allocator_destroy(uniform_buffers.dynamic);
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
-  WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
+  wgpu_render_bundle_cache_destroy(render_bundle_cache);
 }
 
 void example_dynamic_uniform_buffer(int argc, char* argv[])
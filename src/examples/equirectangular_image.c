@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "../webgpu/cubemap_filter.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
@@ -13,6 +14,9 @@
  * degrees viewing experience to achieve more realistic surroundings and
  * convincing real-time effects.
  *
+ * The panorama is converted into a cubemap once and baked next to the image,
+ * every pixel is a single cube lookup along its view ray.
+ *
  * Ref:
  * https://www.saschawillems.de/blog/2016/08/13/vulkan-tutorial-on-rendering-a-fullscreen-quad-without-buffers
  * https://onix-systems.com/blog/how-to-use-360-equirectangular-panoramas-for-greater-realism-in-games
@@ -21,6 +25,67 @@
  * http://www.hdrlabs.com/sibl/archive.html
  * -------------------------------------------------------------------------- */
 
+// Shaders
+// clang-format off
+static const char* shader_wgsl = CODE(
+  struct Inputs {
+    iResolution : vec2<f32>,
+    iMouse : vec4<f32>,
+    iHFovDegrees : f32,
+    iVFovDegrees : f32,
+    iVisualizeInput : u32, // C bool in the lowest byte
+  }
+
+  @group(0) @binding(0) var<uniform> inputs : Inputs;
+  @group(0) @binding(1) var environmentCube : texture_cube<f32>;
+  @group(0) @binding(2) var environmentSampler : sampler;
+
+  const PI : f32 = 3.14159265358979;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) ray : vec3<f32>,
+    @location(1) uv : vec2<f32>,
+  }
+
+  // Fullscreen triangle, the view ray is linear in screen space
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    let p = vec2<f32>(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u))
+            * 2.0 - 1.0;
+    // Viewing direction from the mouse position
+    let yaw = inputs.iMouse.x / max(inputs.iResolution.x, 1.0) * 2.0 * PI;
+    let pitch = clamp(0.5 - inputs.iMouse.y / max(inputs.iResolution.y, 1.0),
+                      -0.5, 0.5) * PI;
+    let halfFov = radians(vec2<f32>(inputs.iHFovDegrees, inputs.iVFovDegrees))
+                  * 0.5;
+    let r = vec3<f32>(p * tan(halfFov), -1.0);
+    let pitched = vec3<f32>(r.x, r.y * cos(pitch) - r.z * sin(pitch),
+                            r.y * sin(pitch) + r.z * cos(pitch));
+    var output : VertexOutput;
+    output.position = vec4<f32>(p, 0.0, 1.0);
+    output.ray = vec3<f32>(pitched.x * cos(yaw) - pitched.z * sin(yaw),
+                           pitched.y,
+                           pitched.x * sin(yaw) + pitched.z * cos(yaw));
+    output.uv = vec2<f32>(p.x * 0.5 + 0.5, 0.5 - p.y * 0.5);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    var direction = input.ray;
+    if ((inputs.iVisualizeInput & 0xFFu) != 0u) {
+      // Direction of the panorama texel under the pixel
+      let longitude = (input.uv.x - 0.5) * 2.0 * PI;
+      let theta = input.uv.y * PI;
+      direction = vec3<f32>(sin(longitude) * sin(theta), cos(theta),
+                            -cos(longitude) * sin(theta));
+    }
+    return textureSample(environmentCube, environmentSampler, direction);
+  }
+);
+// clang-format on
+
 // Uniform buffer block object
 static wgpu_buffer_t uniform_buffer_vs = {0};
 
@@ -79,9 +144,9 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 {
   WGPUBindGroupLayoutEntry bgl_entries[3] = {
     [0] = (WGPUBindGroupLayoutEntry) {
-      //  Binding 1: Fragment shader uniform buffer
+      //  Binding 0: Vertex & fragment shader uniform buffer
       .binding    = 0,
-      .visibility = WGPUShaderStage_Fragment,
+      .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_Uniform,
         .hasDynamicOffset = false,
@@ -90,12 +155,12 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .sampler = {0},
     },
     [1] = (WGPUBindGroupLayoutEntry) {
-      // Binding 1: Fragment shader texture view
+      // Binding 1: Fragment shader cubemap view
       .binding    = 1,
       .visibility = WGPUShaderStage_Fragment,
       .texture = (WGPUTextureBindingLayout) {
         .sampleType    = WGPUTextureSampleType_Float,
-        .viewDimension = WGPUTextureViewDimension_2D,
+        .viewDimension = WGPUTextureViewDimension_Cube,
         .multisampled  = false,
       },
       .storageTexture = {0},
@@ -158,8 +223,14 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
 
 static void prepare_texture(wgpu_context_t* wgpu_context)
 {
-  const char* file = "textures/Circus_Backstage_8k.jpg";
-  texture          = wgpu_create_texture_from_file(wgpu_context, file, NULL);
+  // The 8k image is decoded and converted on the first run only
+  texture = wgpu_cubemap_load_equirectangular(
+    wgpu_context, "textures/Circus_Backstage_8k.jpg",
+    "textures/Circus_Backstage_8k_cube.bin",
+    &(wgpu_equirect_to_cubemap_desc_t){
+      .label = "circus_backstage_cube_texture",
+    });
+  ASSERT(texture.texture != NULL);
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -280,9 +351,10 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
                     wgpu_context, &(wgpu_vertex_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Vertex shader SPIR-V
-                      .label = "vertex_shader",
-                      .file  = "shaders/equirectangular_image/main.vert.spv",
+                      // Vertex shader WGSL
+                      .label            = "vertex_shader",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "vs_main",
                     },
                     .buffer_count = 0,
                     .buffers      = NULL,
@@ -292,9 +364,10 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
                     wgpu_context, &(wgpu_fragment_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Fragment shader SPIR-V
-                      .label = "fragment_shader",
-                      .file  = "shaders/equirectangular_image/main.frag.spv",
+                      // Fragment shader WGSL
+                      .label            = "fragment_shader",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "fs_main",
                     },
                     .target_count = 1,
                     .targets      = &color_target_state,
@@ -348,14 +421,14 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
           context->imgui_overlay, "Horizontal FOV (degrees)",
           &shader_inputs_ubo.iHFovDegrees, 1.0f, "%.0f")) {
       shader_inputs_ubo.iHFovDegrees
-        = clamp_float(shader_inputs_ubo.iHFovDegrees, 10, 1000);
+        = clamp_float(shader_inputs_ubo.iHFovDegrees, 10, 170);
       shader_inputs_ubo_update_needed = true;
     }
     if (imgui_overlay_input_float(
           context->imgui_overlay, "Vertical FOV (degrees)",
           &shader_inputs_ubo.iVFovDegrees, 1.0f, "%.0f")) {
       shader_inputs_ubo.iVFovDegrees
-        = clamp_float(shader_inputs_ubo.iVFovDegrees, 10, 1000);
+        = clamp_float(shader_inputs_ubo.iVFovDegrees, 10, 170);
       shader_inputs_ubo_update_needed = true;
     }
     if (imgui_overlay_checkBox(context->imgui_overlay, "Show input",
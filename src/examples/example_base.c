@@ -1,8 +1,15 @@
 #include "example_base.h"
 
+#include <float.h>
+#include <math.h>
 #include <string.h>
 
 #include "../core/argparse.h"
+#include "../core/benchmark.h"
+#include "../core/camera_path.h"
+#include "../core/frame_limiter.h"
+#include "../core/trace.h"
+#include "../webgpu/gpu_stats.h"
 #include "../webgpu/imgui_overlay.h"
 
 #ifdef __GNUC__
@@ -21,6 +28,13 @@ static const char* const WINDOW_TITLE = "WebGPU Example";
 static const uint32_t WINDOW_WIDTH    = 1280;
 static const uint32_t WINDOW_HEIGHT   = 720;
 
+/* Frames rendered in headless mode without benchmark or --frames */
+#define HEADLESS_DEFAULT_FRAMES 100u
+
+/* Initial capacity of the CPU scratch arenas, they grow to the peak usage */
+#define FRAME_ARENA_CAPACITY (1u << 20)
+#define LOAD_ARENA_CAPACITY (16u << 20)
+
 typedef struct {
   bool window_resized;
   bool view_updated;
@@ -41,6 +55,337 @@ typedef struct {
   float last_fps;
 } record_t;
 
+/* Performance HUD, frame times of the last frames and the CPU / GPU split */
+#define HUD_HISTORY_SIZE 100u
+
+static struct {
+  float frame_times[HUD_HISTORY_SIZE]; /* ring of frame times in ms */
+  uint32_t frame_time_offset;          /* oldest frame time */
+  float wait_time;                     /* swap chain acquire and present */
+  float frame_time_ms;
+  float cpu_time_ms;
+} performance_hud = {0};
+
+static void performance_hud_add_frame(float frame_time_ms)
+{
+  performance_hud.frame_times[performance_hud.frame_time_offset]
+    = frame_time_ms;
+  performance_hud.frame_time_offset
+    = (performance_hud.frame_time_offset + 1) % HUD_HISTORY_SIZE;
+
+  /* The CPU time excludes waiting for the swap chain */
+  performance_hud.frame_time_ms = frame_time_ms;
+  performance_hud.cpu_time_ms
+    = MAX(frame_time_ms - performance_hud.wait_time * 1000.0f, 0.0f);
+  performance_hud.wait_time = 0.0f;
+}
+
+/* Shader invocations of the passes tagged with pipeline statistics queries */
+static void
+update_pipeline_statistics_overlay(wgpu_example_context_t* context)
+{
+  wgpu_pipeline_statistics_t* statistics
+    = context->wgpu_context->pipeline_statistics;
+  const wgpu_pipeline_statistics_result_t* passes
+    = wgpu_pipeline_statistics_get_results(statistics);
+  const uint32_t pass_count
+    = wgpu_pipeline_statistics_get_result_count(statistics);
+
+  /* The fragment invocations per window pixel are the overdraw of a pass */
+  const double pixel_count = MAX(
+    1.0, (double)context->window_size.width * context->window_size.height);
+  for (uint32_t i = 0; i < pass_count; ++i) {
+    if (passes[i].compute) {
+      igText("%s: %.1fk CS invocations", passes[i].name,
+             (double)passes[i].compute_invocations / 1000.0);
+      continue;
+    }
+    igText("%s: %.1fk VS, %.1fk / %.1fk prims, %.2f FS/px", passes[i].name,
+           (double)passes[i].vertex_invocations / 1000.0,
+           (double)passes[i].clipper_primitives_out / 1000.0,
+           (double)passes[i].clipper_invocations / 1000.0,
+           (double)passes[i].fragment_invocations / pixel_count);
+  }
+}
+
+static void update_performance_hud_overlay(wgpu_example_context_t* context)
+{
+  wgpu_profiler_t* profiler = context->wgpu_context->profiler;
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  const uint32_t scope_count = wgpu_profiler_get_scope_count(profiler);
+
+  /* The GPU time of the frame is the sum of the outermost profiler scopes */
+  float gpu_time_ms = 0.0f;
+  for (uint32_t i = 0; i < scope_count; ++i) {
+    if (scopes[i].depth == 0) {
+      gpu_time_ms += scopes[i].avg_gpu_time_ms;
+    }
+  }
+
+  const float scale = imgui_overlay_get_scale(context->imgui_overlay);
+  char frame_time_text[32];
+  snprintf(frame_time_text, sizeof(frame_time_text), "%.2f ms",
+           performance_hud.frame_time_ms);
+  igPlotLines_FloatPtr("##frame_times", performance_hud.frame_times,
+                       (int)HUD_HISTORY_SIZE,
+                       (int)performance_hud.frame_time_offset, frame_time_text,
+                       0.0f, FLT_MAX, (ImVec2){200.0f * scale, 40.0f * scale},
+                       sizeof(float));
+  if (scope_count > 0) {
+    igText("CPU %.2f ms, GPU %.2f ms", performance_hud.cpu_time_ms,
+           gpu_time_ms);
+  }
+  else {
+    igText("CPU %.2f ms", performance_hud.cpu_time_ms);
+  }
+  for (uint32_t i = 0; i < scope_count; ++i) {
+    igText("%*sGPU %s: %.3f ms", (int)(scopes[i].depth * 2), "",
+           scopes[i].name, scopes[i].avg_gpu_time_ms);
+  }
+  update_pipeline_statistics_overlay(context);
+  igText("Frame arena: %.1f / %.1f KiB",
+         (double)arena_get_peak(context->frame_arena) / 1024.0,
+         (double)arena_get_capacity(context->frame_arena) / 1024.0);
+  if (context->dynamic_resolution != NULL) {
+    igText("Resolution scale %.0f%%",
+           wgpu_dynamic_resolution_get_scale(context->dynamic_resolution)
+             * 100.0f);
+  }
+
+  if (!wgpu_stats_enabled()) {
+    return;
+  }
+
+  wgpu_frame_counters_t counters;
+  wgpu_stats_get_frame_counters(&counters);
+  igText("%u render / %u compute passes", counters.render_passes,
+         counters.compute_passes);
+  igText("%u draws (%.1fk instances), %u dispatches", counters.draw_calls,
+         (double)counters.instances / 1000.0, counters.dispatches);
+  igText("Pipelines: %u (%u redundant)", counters.pipeline_sets,
+         counters.redundant_pipeline_sets);
+  igText("Bind groups: %u (%u redundant)", counters.bind_group_sets,
+         counters.redundant_bind_group_sets);
+  igText("Uploaded: %.1f KiB/frame", (double)counters.upload_bytes / 1024.0);
+  igText("Created: %u buffers, %u textures", counters.buffer_creations,
+         counters.texture_creations);
+
+  wgpu_memory_stats_t memory;
+  wgpu_stats_get_memory(&memory);
+  igText("Buffers: %u (%.1f MiB)", memory.buffer_count,
+         (double)memory.buffer_bytes / (1024.0 * 1024.0));
+  igText("Textures: %u (%.1f MiB)", memory.texture_count,
+         (double)memory.texture_bytes / (1024.0 * 1024.0));
+  igText("Peak: %.1f MiB", (double)memory.peak_bytes / (1024.0 * 1024.0));
+  for (uint32_t i = 0; i < MemoryCategory_Count; ++i) {
+    const wgpu_memory_category_stats_t* category = &memory.categories[i];
+    if (category->count > 0) {
+      igText("  %s: %u (%.1f MiB)",
+             wgpu_stats_get_memory_category_name((wgpu_memory_category_t)i),
+             category->count, (double)category->bytes / (1024.0 * 1024.0));
+    }
+  }
+}
+
+/* Fixed timestep simulation of the running example */
+#define SIMULATION_MAX_STEPS_PER_FRAME 256u
+
+static struct {
+  simulationstepfunc_t* step_func;
+  float time_accumulator;   /* frame time not simulated yet (in seconds) */
+  uint32_t scheduled_steps; /* steps to record in the current frame */
+  uint32_t recorded_steps;  /* steps recorded in the current frame */
+  uint32_t step_counter;    /* steps since the last steps per second update */
+} simulation = {0};
+
+/* Deterministic runs (--deterministic): seeded random numbers and a fixed
+ * frame time instead of the measured one, the camera optionally recorded to or
+ * replayed from a camera path */
+#define DETERMINISTIC_FRAME_TIME (1.0f / 60.0f)
+
+static struct {
+  bool enabled;
+  camera_path_t* recording;
+  const char* recording_file;
+  camera_path_t* replay;
+} determinism = {0};
+
+static void schedule_simulation_steps(wgpu_example_context_t* context,
+                                      float elapsed_time)
+{
+  simulation.recorded_steps = 0;
+  if (simulation.step_func == NULL || context->paused) {
+    simulation.scheduled_steps = 0;
+    return;
+  }
+
+  const float step_rate = context->simulation.step_rate;
+  if (step_rate <= 0.0f) {
+    simulation.scheduled_steps = context->simulation.steps_per_frame;
+    return;
+  }
+
+  /* As many fixed timesteps as fit into the elapsed time, the time exceeding
+   * the maximum steps per frame is dropped instead of catching up later */
+  simulation.time_accumulator += elapsed_time;
+  const float step_count = floorf(simulation.time_accumulator * step_rate);
+  if (step_count > (float)SIMULATION_MAX_STEPS_PER_FRAME) {
+    simulation.scheduled_steps  = SIMULATION_MAX_STEPS_PER_FRAME;
+    simulation.time_accumulator = 0.0f;
+  }
+  else {
+    simulation.scheduled_steps = (uint32_t)step_count;
+    simulation.time_accumulator -= step_count / step_rate;
+  }
+}
+
+static void update_simulation_overlay(wgpu_example_context_t* context)
+{
+  igText("%u simulation steps/s", context->simulation.steps_per_second);
+  if (context->simulation.step_rate > 0.0f) {
+    igText("Fixed timestep: %.1f steps/s", context->simulation.step_rate);
+    return;
+  }
+
+  int32_t steps_per_frame = (int32_t)context->simulation.steps_per_frame;
+  igPushItemWidth(110.0f * imgui_overlay_get_scale(context->imgui_overlay));
+  if (imgui_overlay_slider_int(context->imgui_overlay, "Steps per frame",
+                               &steps_per_frame, 1, 64)) {
+    context->simulation.steps_per_frame = (uint32_t)steps_per_frame;
+  }
+  igPopItemWidth();
+}
+
+/* Frame counters summed over the measured benchmark frames */
+#define BENCHMARK_COUNTER_COUNT 12u
+
+static const char* const benchmark_counter_names[BENCHMARK_COUNTER_COUNT] = {
+  "render_passes",
+  "compute_passes",
+  "draw_calls",
+  "vertices",
+  "indices",
+  "instances",
+  "dispatches",
+  "pipeline_sets",
+  "redundant_pipeline_sets",
+  "bind_group_sets",
+  "redundant_bind_group_sets",
+  "upload_bytes",
+};
+
+/* Pipeline statistics of a pass, reported as "<pass>.<statistic>". Render
+ * passes report the first four, compute passes the last statistic. */
+#define BENCHMARK_PASS_STATISTIC_COUNT 5u
+#define BENCHMARK_MAX_PASS_COUNTERS (WGPU_PIPELINE_STATISTICS_MAX_PASSES * 4u)
+
+static const char* const
+  benchmark_pass_statistic_names[BENCHMARK_PASS_STATISTIC_COUNT]
+  = {
+    "vertex_invocations",   /* */
+    "clipper_invocations",  /* */
+    "clipper_primitives",   /* */
+    "fragment_invocations", /* */
+    "compute_invocations",  /* */
+};
+
+static struct {
+  uint32_t frame_count;
+  double sums[BENCHMARK_COUNTER_COUNT];
+  double simulation_steps;
+  /* Pipeline statistics of the tagged passes, summed by pass name */
+  uint32_t pass_count;
+  struct {
+    char name[WGPU_PIPELINE_STATISTICS_NAME_SIZE];
+    bool compute;
+    double sums[BENCHMARK_PASS_STATISTIC_COUNT];
+  } passes[WGPU_PIPELINE_STATISTICS_MAX_PASSES];
+} benchmark_counters = {0};
+
+/* Adds the latest read back pipeline statistics to the sums of the passes */
+static void
+benchmark_counters_add_pass_statistics(wgpu_context_t* wgpu_context)
+{
+  wgpu_pipeline_statistics_t* statistics = wgpu_context->pipeline_statistics;
+  const wgpu_pipeline_statistics_result_t* results
+    = wgpu_pipeline_statistics_get_results(statistics);
+  const uint32_t result_count
+    = wgpu_pipeline_statistics_get_result_count(statistics);
+  for (uint32_t i = 0; i < result_count; ++i) {
+    uint32_t pass_index = 0;
+    while (pass_index < benchmark_counters.pass_count
+           && strcmp(benchmark_counters.passes[pass_index].name,
+                     results[i].name)
+                != 0) {
+      ++pass_index;
+    }
+    if (pass_index == WGPU_PIPELINE_STATISTICS_MAX_PASSES) {
+      continue;
+    }
+    if (pass_index == benchmark_counters.pass_count) {
+      ++benchmark_counters.pass_count;
+      snprintf(benchmark_counters.passes[pass_index].name,
+               WGPU_PIPELINE_STATISTICS_NAME_SIZE, "%s", results[i].name);
+      benchmark_counters.passes[pass_index].compute = results[i].compute;
+    }
+    const double values[BENCHMARK_PASS_STATISTIC_COUNT] = {
+      (double)results[i].vertex_invocations,
+      (double)results[i].clipper_invocations,
+      (double)results[i].clipper_primitives_out,
+      (double)results[i].fragment_invocations,
+      (double)results[i].compute_invocations,
+    };
+    for (uint32_t j = 0; j < BENCHMARK_PASS_STATISTIC_COUNT; ++j) {
+      benchmark_counters.passes[pass_index].sums[j] += values[j];
+    }
+  }
+}
+
+static void benchmark_counters_add_frame(wgpu_context_t* wgpu_context)
+{
+  wgpu_frame_counters_t counters;
+  wgpu_stats_get_frame_counters(&counters);
+  const double values[BENCHMARK_COUNTER_COUNT] = {
+    counters.render_passes,
+    counters.compute_passes,
+    counters.draw_calls,
+    (double)counters.vertices,
+    (double)counters.indices,
+    (double)counters.instances,
+    counters.dispatches,
+    counters.pipeline_sets,
+    counters.redundant_pipeline_sets,
+    counters.bind_group_sets,
+    counters.redundant_bind_group_sets,
+    (double)counters.upload_bytes,
+  };
+  for (uint32_t i = 0; i < BENCHMARK_COUNTER_COUNT; ++i) {
+    benchmark_counters.sums[i] += values[i];
+  }
+  benchmark_counters.simulation_steps += simulation.recorded_steps;
+  benchmark_counters_add_pass_statistics(wgpu_context);
+  ++benchmark_counters.frame_count;
+}
+
+/* Demo mode session, the window and WebGPU context are shared by examples */
+#define DEMO_MAX_RESULTS 128
+#define DEMO_WARMUP_FRAMES 10
+
+static struct {
+  bool active;
+  bool aborted;
+  example_demo_settings_t settings;
+  window_t* window;
+  wgpu_context_t* wgpu_context;
+  char adapter_info[3][256];
+  uint32_t result_count;
+  struct {
+    char example_title[STRMAX];
+    benchmark_statistics_t stats;
+  } results[DEMO_MAX_RESULTS];
+} demo_session = {0};
+
 static void get_pos_delta(vec2 old_pos, vec2 new_pos, vec2* result)
 {
   glm_vec2_sub(new_pos, old_pos, *result);
@@ -48,6 +393,11 @@ static void get_pos_delta(vec2 old_pos, vec2 new_pos, vec2* result)
 
 static void get_cursor_pos(window_t* window, vec2* result)
 {
+  // Headless mode has no cursor
+  if (window == NULL) {
+    glm_vec2_zero(*result);
+    return;
+  }
   input_query_cursor(window, &(*result)[0], &(*result)[1]);
 }
 
@@ -108,26 +458,33 @@ static void resize_callback(window_t* window, int width, int height)
   record->window_resized = true;
 }
 
-#if 0
 static void update_window_size(wgpu_example_context_t* context,
                                record_t* record)
 {
-  if (record->window_resized) {
-    wgpu_context_t* wgpu_context = context->wgpu_context;
-    // Update window size and aspect ratio
-    window_get_size(context->window, &context->window_size.width,
-                    &context->window_size.height);
-    window_get_aspect_ratio(context->window,
-                            &context->window_size.aspect_ratio);
-    // Update surface size
-    window_get_size(context->window, &wgpu_context->surface.width,
-                    &wgpu_context->surface.height);
-    // Recreate swap chain
-    wgpu_setup_swap_chain(context->wgpu_context);
-    record->window_resized = false;
+  if (!record->window_resized) {
+    return;
   }
+  record->window_resized = false;
+
+  uint32_t width = 0, height = 0;
+  window_get_size(context->window, &width, &height);
+  // Skip minimized windows, the swap chain cannot have a zero size
+  if (width == 0 || height == 0) {
+    return;
+  }
+  // Update window size and aspect ratio
+  context->window_size.width  = width;
+  context->window_size.height = height;
+  window_get_aspect_ratio(context->window, &context->window_size.aspect_ratio);
+  // Recreate swap chain and depth-stencil texture
+  wgpu_resize_swap_chain(context->wgpu_context, width, height);
+  if (context->camera != NULL) {
+    camera_update_aspect_ratio(context->camera,
+                               context->window_size.aspect_ratio);
+  }
+  // Let the example update its size dependent resources
+  record->view_updated = true;
 }
-#endif
 
 static void update_camera(wgpu_example_context_t* context, record_t* record)
 {
@@ -227,17 +584,68 @@ notify_key_input_state(record_t* record,
   }
 }
 
+/* Command line arguments shared by all examples */
+typedef struct {
+  int benchmark;
+  int benchmark_warmup_frames;
+  int benchmark_frames;
+  const char* benchmark_output;
+  backend_validation_level_enum validation_level;
+  int frames_in_flight;
+  const char* pipeline_cache_dir;
+  int watch_shaders;
+  int gpu_markers;
+  int simulation_steps;
+  float simulation_rate;
+  int headless;
+  int frame_count;
+  const char* adapter;
+  int low_power;
+  int list_adapters;
+  int low_latency_input;
+  int on_demand;
+  float max_fps;
+  const char* trace_output;
+  int deterministic;
+  int seed;
+  const char* camera_record;
+  const char* camera_replay;
+} example_arguments_t;
+
 static void parse_example_arguments(int argc, char* argv[],
-                                    refexport_t* ref_export)
-{
-  char* filters_short[2]           = {"-w", "-h"};
-  char* filters_eq[2]              = {"--width=", "--height="};
-  char* filtered_argv[1 + (2 * 2)] = {0};
-  char** argvc                     = (char**)argv;
-  int fargc                        = 1;
-  for (int32_t i = 0; i < argc; ++i) {
+                                    refexport_t* ref_export,
+                                    example_arguments_t* example_arguments)
+{
+  char* filters_short[2] = {"-w", "-h"};
+  char* filters_eq[17]   = {"--width=",
+                            "--height=",
+                            "--benchmark-warmup=",
+                            "--benchmark-frames=",
+                            "--benchmark-output=",
+                            "--validation=",
+                            "--frames-in-flight=",
+                            "--pipeline-cache=",
+                            "--simulation-steps=",
+                            "--simulation-rate=",
+                            "--max-fps=",
+                            "--frames=",
+                            "--adapter=",
+                            "--trace=",
+                            "--seed=",
+                            "--camera-record=",
+                            "--camera-replay="};
+  char* filters_flag[9]  = {"--benchmark",     "--watch-shaders",
+                            "--headless",      "--low-power",
+                            "--list-adapters", "--low-latency-input",
+                            "--on-demand",     "--gpu-markers",
+                            "--deterministic"};
+  char* filtered_argv[1 + (2 * 2) + 17 + 9 + 1] = {0};
+  const int max_fargc = (int)ARRAY_SIZE(filtered_argv) - 1;
+  char** argvc        = (char**)argv;
+  int fargc           = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
     for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_short); ++j) {
-      if (strcmp(argvc[i], filters_short[j]) == 0) {
+      if (strcmp(argvc[i], filters_short[j]) == 0 && (i + 1) < argc) {
         filtered_argv[fargc++] = filters_short[j];
         filtered_argv[fargc++] = argvc[++i];
       }
@@ -247,12 +655,105 @@ static void parse_example_arguments(int argc, char* argv[],
         filtered_argv[fargc++] = argvc[i];
       }
     }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argvc[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argvc[i];
+      }
+    }
   }
 
+  // Default benchmark settings
+  example_arguments->benchmark               = 0;
+  example_arguments->benchmark_warmup_frames = 60;
+  example_arguments->benchmark_frames        = 600;
+  example_arguments->benchmark_output        = NULL;
+  example_arguments->frames_in_flight        = 0;
+  example_arguments->pipeline_cache_dir      = "pipeline_cache";
+  example_arguments->watch_shaders           = 0;
+  example_arguments->gpu_markers             = 0;
+  example_arguments->simulation_steps        = 1;
+  example_arguments->simulation_rate         = 0.0f;
+  example_arguments->headless                = 0;
+  example_arguments->frame_count             = 0;
+  example_arguments->adapter                 = NULL;
+  example_arguments->low_power               = 0;
+  example_arguments->list_adapters           = 0;
+  example_arguments->low_latency_input       = 0;
+  example_arguments->on_demand               = 0;
+  example_arguments->max_fps                 = 0.0f;
+  example_arguments->trace_output            = NULL;
+  example_arguments->deterministic           = 0;
+  example_arguments->seed                    = 1;
+  example_arguments->camera_record           = NULL;
+  example_arguments->camera_replay           = NULL;
+
+  const char* validation = NULL;
   int window_width = 0, window_height = 0;
   struct argparse_option options[] = {
     OPT_INTEGER('w', "width", &window_width, "window width", NULL, 0, 0),
     OPT_INTEGER('h', "height", &window_height, "window height", NULL, 0, 0),
+    OPT_BOOLEAN(0, "benchmark", &example_arguments->benchmark,
+                "benchmark mode", NULL, 0, 0),
+    OPT_INTEGER(0, "benchmark-warmup",
+                &example_arguments->benchmark_warmup_frames,
+                "number of warm-up frames", NULL, 0, 0),
+    OPT_INTEGER(0, "benchmark-frames", &example_arguments->benchmark_frames,
+                "number of measured frames", NULL, 0, 0),
+    OPT_STRING(0, "benchmark-output", &example_arguments->benchmark_output,
+               "benchmark report file", NULL, 0, 0),
+    OPT_STRING(0, "validation", &validation,
+               "backend validation level (off, partial or full)", NULL, 0, 0),
+    OPT_INTEGER(0, "frames-in-flight", &example_arguments->frames_in_flight,
+                "max number of frames queued ahead of the GPU (1-3)", NULL, 0,
+                0),
+    OPT_STRING(0, "pipeline-cache", &example_arguments->pipeline_cache_dir,
+               "backend pipeline cache directory, empty to disable", NULL, 0,
+               0),
+    OPT_BOOLEAN(0, "watch-shaders", &example_arguments->watch_shaders,
+                "reload shader files when they change", NULL, 0, 0),
+    OPT_BOOLEAN(0, "gpu-markers", &example_arguments->gpu_markers,
+                "debug groups around the passes for GPU profilers", NULL, 0,
+                0),
+    OPT_INTEGER(0, "simulation-steps", &example_arguments->simulation_steps,
+                "simulation steps per frame of compute examples", NULL, 0, 0),
+    OPT_FLOAT(0, "simulation-rate", &example_arguments->simulation_rate,
+              "fixed timestep simulation steps per second, overrides "
+              "--simulation-steps",
+              NULL, 0, 0),
+    OPT_BOOLEAN(0, "headless", &example_arguments->headless,
+                "render offscreen without window and swap chain", NULL, 0, 0),
+    OPT_INTEGER(0, "frames", &example_arguments->frame_count,
+                "number of rendered frames, 0 = until the window is closed",
+                NULL, 0, 0),
+    OPT_STRING(0, "adapter", &example_arguments->adapter,
+               "adapter index, vendor (nvidia, amd, intel, 0x10de) or part of "
+               "the adapter name",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "low-power", &example_arguments->low_power,
+                "prefer integrated over discrete GPUs", NULL, 0, 0),
+    OPT_BOOLEAN(0, "list-adapters", &example_arguments->list_adapters,
+                "list the adapters with their limits and exit", NULL, 0, 0),
+    OPT_BOOLEAN(0, "low-latency-input", &example_arguments->low_latency_input,
+                "apply the camera input before rendering the frame", NULL, 0,
+                0),
+    OPT_BOOLEAN(0, "on-demand", &example_arguments->on_demand,
+                "render only when input arrives or the example animates",
+                NULL, 0, 0),
+    OPT_FLOAT(0, "max-fps", &example_arguments->max_fps,
+              "target frame rate of the frame limiter, 0 = unlimited", NULL,
+              0, 0),
+    OPT_STRING(0, "trace", &example_arguments->trace_output,
+               "write a CPU and GPU timeline in Chrome trace JSON", NULL, 0,
+               0),
+    OPT_BOOLEAN(0, "deterministic", &example_arguments->deterministic,
+                "fixed frame time and seeded random numbers", NULL, 0, 0),
+    OPT_INTEGER(0, "seed", &example_arguments->seed,
+                "random seed of deterministic runs", NULL, 0, 0),
+    OPT_STRING(0, "camera-record", &example_arguments->camera_record,
+               "record the camera of every frame to a camera path file", NULL,
+               0, 0),
+    OPT_STRING(0, "camera-replay", &example_arguments->camera_replay,
+               "replay the camera of a recorded camera path file", NULL, 0, 0),
     OPT_END(),
   };
   struct argparse argparse;
@@ -267,6 +768,41 @@ static void parse_example_arguments(int argc, char* argv[],
   if (window_height > 100) {
     ref_export->example_window_config.height = window_height;
   }
+
+  // Sanitize benchmark settings
+  example_arguments->benchmark_warmup_frames
+    = MAX(0, example_arguments->benchmark_warmup_frames);
+  example_arguments->benchmark_frames
+    = MAX(1, example_arguments->benchmark_frames);
+  example_arguments->frames_in_flight
+    = CLAMP(example_arguments->frames_in_flight, 0,
+            (int)WGPU_MAX_FRAMES_IN_FLIGHT);
+  example_arguments->simulation_steps
+    = CLAMP(example_arguments->simulation_steps, 1,
+            (int)SIMULATION_MAX_STEPS_PER_FRAME);
+  example_arguments->simulation_rate
+    = MAX(0.0f, example_arguments->simulation_rate);
+  example_arguments->frame_count = MAX(0, example_arguments->frame_count);
+  example_arguments->max_fps     = MAX(0.0f, example_arguments->max_fps);
+
+  // Backend validation level
+  example_arguments->validation_level = BackendValidationLevel_Default;
+  if (validation == NULL) {
+    return;
+  }
+  if (strcmp(validation, "off") == 0) {
+    example_arguments->validation_level = BackendValidationLevel_Disabled;
+  }
+  else if (strcmp(validation, "partial") == 0) {
+    example_arguments->validation_level = BackendValidationLevel_Partial;
+  }
+  else if (strcmp(validation, "full") == 0) {
+    example_arguments->validation_level = BackendValidationLevel_Full;
+  }
+  else {
+    log_warn("Unknown validation level '%s', using the default\n",
+             validation);
+  }
 }
 
 static void
@@ -282,6 +818,12 @@ intialize_wgpu_example_context(wgpu_example_context_t* context,
   // V-Sync setting for the swapchain
   context->vsync = example_settings->vsync;
 
+  // Depth convention
+  context->reversed_z = example_settings->reversed_z;
+
+  // Device limits
+  context->required_limits = example_settings->required_limits;
+
   // FPS
   context->frame_counter = 0;
   context->last_fps      = 0;
@@ -315,8 +857,25 @@ static void setup_window(wgpu_example_context_t* context,
     .width     = GET_DEFAULT_IF_ZERO(windows_config->width, WINDOW_WIDTH),
     .height    = GET_DEFAULT_IF_ZERO(windows_config->height, WINDOW_HEIGHT),
     .resizable = windows_config->resizable,
+    .monitor   = windows_config->monitor,
   };
-  context->window = window_create(&config);
+  if (context->headless) {
+    // The offscreen frame buffer has the size of the window
+    context->window_size.width  = config.width;
+    context->window_size.height = config.height;
+    context->window_size.aspect_ratio
+      = (float)config.width / (float)config.height;
+    return;
+  }
+  if (demo_session.active && demo_session.window != NULL) {
+    // Demo mode reuses the window of the previous example
+    context->window = demo_session.window;
+    window_set_title(context->window, config.title);
+  }
+  else {
+    context->window     = window_create(&config);
+    demo_session.window = demo_session.active ? context->window : NULL;
+  }
   window_get_size(context->window, &context->window_size.width,
                   &context->window_size.height);
   window_get_aspect_ratio(context->window, &context->window_size.aspect_ratio);
@@ -332,15 +891,66 @@ static void setup_window(wgpu_example_context_t* context,
 
 static void intialize_webgpu(wgpu_example_context_t* context)
 {
+  // Demo mode reuses the adapter, device and swap chain of the previous example
+  if (demo_session.active && demo_session.wgpu_context != NULL) {
+    context->wgpu_context          = demo_session.wgpu_context;
+    context->wgpu_context->context = context;
+    memcpy(context->adapter_info, demo_session.adapter_info,
+           sizeof(context->adapter_info));
+    wgpu_set_reversed_z(context->wgpu_context, context->reversed_z);
+    return;
+  }
+
   context->wgpu_context = wgpu_context_create(&(wgpu_context_create_options_t){
-    .vsync = context->vsync,
+    .vsync              = context->vsync,
+    .validation_level   = context->validation_level,
+    .frames_in_flight   = context->frames_in_flight,
+    .pipeline_cache_dir = context->pipeline_cache_dir,
+    .watch_shaders      = context->watch_shaders,
+    .gpu_markers        = context->gpu_markers,
+    .reversed_z         = context->reversed_z,
+    .adapter            = context->adapter,
+    .low_power          = context->low_power,
+    .required_limits    = &context->required_limits,
   });
   context->wgpu_context->context = context;
 
   wgpu_create_device_and_queue(context->wgpu_context);
-  wgpu_setup_window_surface(context->wgpu_context, context->window);
+  if (context->headless) {
+    wgpu_setup_offscreen_surface(context->wgpu_context,
+                                 context->window_size.width,
+                                 context->window_size.height);
+  }
+  else {
+    wgpu_setup_window_surface(context->wgpu_context, context->window);
+  }
   wgpu_setup_swap_chain(context->wgpu_context);
   wgpu_get_context_info(context->adapter_info);
+
+  if (demo_session.active) {
+    demo_session.wgpu_context = context->wgpu_context;
+    memcpy(demo_session.adapter_info, context->adapter_info,
+           sizeof(demo_session.adapter_info));
+  }
+}
+
+static void
+intialize_dynamic_resolution(wgpu_example_context_t* context,
+                             wgpu_example_settings_t* example_settings)
+{
+  if (example_settings->dynamic_resolution) {
+    context->dynamic_resolution = wgpu_dynamic_resolution_create(
+      context->wgpu_context,
+      &(wgpu_dynamic_resolution_desc_t){
+        .target_frame_time_ms = example_settings->target_frame_time_ms,
+      });
+  }
+}
+
+static void release_dynamic_resolution(wgpu_example_context_t* context)
+{
+  wgpu_dynamic_resolution_destroy(context->dynamic_resolution);
+  context->dynamic_resolution = NULL;
 }
 
 static void intialize_imgui(wgpu_example_context_t* context,
@@ -362,9 +972,40 @@ static void release_imgui(wgpu_example_context_t* context)
 
 static void release_webgpu(wgpu_example_context_t* context)
 {
+  if (demo_session.active) {
+    // Keep the device alive for the next example
+    wgpu_context_reset(context->wgpu_context);
+    return;
+  }
   wgpu_context_release(context->wgpu_context);
 }
 
+static void update_present_mode_overlay(wgpu_example_context_t* context)
+{
+  static const char* present_mode_names[3] = {"Fifo", "Mailbox", "Immediate"};
+  static const WGPUPresentMode present_modes[3] = {
+    WGPUPresentMode_Fifo,
+    WGPUPresentMode_Mailbox,
+    WGPUPresentMode_Immediate,
+  };
+
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  int32_t present_mode_index   = 0;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(present_modes); ++i) {
+    if (present_modes[i] == wgpu_context->swap_chain.present_mode) {
+      present_mode_index = (int32_t)i;
+      break;
+    }
+  }
+  igPushItemWidth(110.0f * imgui_overlay_get_scale(context->imgui_overlay));
+  if (imgui_overlay_combo_box(context->imgui_overlay, "Present mode",
+                              &present_mode_index, present_mode_names,
+                              (uint32_t)ARRAY_SIZE(present_mode_names))) {
+    wgpu_set_present_mode(wgpu_context, present_modes[present_mode_index]);
+  }
+  igPopItemWidth();
+}
+
 static void
 update_overlay(wgpu_example_context_t* context,
                onupdateuioverlayfunc_t* example_on_update_ui_overlay_func)
@@ -386,6 +1027,11 @@ update_overlay(wgpu_example_context_t* context,
   igText("%s backend - %s", context->adapter_info[2], context->adapter_info[1]);
   igText("%.2f ms/frame (%.1d fps)", (1000.0f / context->last_fps),
          context->last_fps);
+  update_performance_hud_overlay(context);
+  update_present_mode_overlay(context);
+  if (simulation.step_func != NULL) {
+    update_simulation_overlay(context);
+  }
   if (example_on_update_ui_overlay_func) {
     igPushItemWidth(110.0f * imgui_overlay_get_scale(context->imgui_overlay));
     example_on_update_ui_overlay_func(context);
@@ -396,39 +1042,354 @@ update_overlay(wgpu_example_context_t* context,
   imgui_overlay_render(context->imgui_overlay);
 }
 
+/* Close request of example_request_close(), headless mode has no window */
+static bool close_requested = false;
+
+void example_request_close(wgpu_example_context_t* context)
+{
+  close_requested = true;
+  if (context->window != NULL) {
+    window_set_should_close(context->window, 1);
+  }
+}
+
+static bool example_should_close(wgpu_example_context_t* context)
+{
+  return close_requested
+         || (context->window != NULL && window_should_close(context->window));
+}
+
+/* Frames rendered in on-demand mode before the loop waits for input again,
+ * ImGui settles its layout in the frame after an input event */
+#define ON_DEMAND_EVENT_FRAMES 2u
+
+static uint32_t redraw_frames = 0;
+
+void example_request_redraw(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  redraw_frames = MAX(redraw_frames, 1u);
+}
+
+/* Waits for input in on-demand mode unless a redraw is pending, returns if it
+ * waited */
+static bool wait_for_redraw(wgpu_example_context_t* context)
+{
+  if (!context->on_demand || context->window == NULL) {
+    return false;
+  }
+  if (simulation.step_func != NULL && !context->paused) {
+    return false;
+  }
+  if (redraw_frames > 0) {
+    --redraw_frames;
+    return false;
+  }
+
+  input_wait_events();
+  redraw_frames = ON_DEMAND_EVENT_FRAMES - 1;
+
+  return true;
+}
+
+/* Applies the camera and mouse input and notifies the example */
+static void process_input(wgpu_example_context_t* context, record_t* record,
+                          onviewchangedfunc_t* view_changed_func,
+                          onkeypressedfunc_t* example_on_key_pressed_func)
+{
+  update_camera(context, record);
+  update_input_state(context, record);
+  if (example_on_key_pressed_func) {
+    notify_key_input_state(record, example_on_key_pressed_func);
+  }
+  if (record->view_updated && view_changed_func) {
+    view_changed_func(context);
+  }
+}
+
+/* Staged initialization */
+
+#define LOAD_TASK_QUEUE_CAPACITY 64u
+/* Time per frame spent on load tasks, at least one task runs per frame */
+#define LOAD_TASK_FRAME_BUDGET_MS 12.0f
+/* Pause between the runs of a retried task in finish_load_tasks() */
+#define LOAD_TASK_RETRY_SLEEP_NS 1000000ull
+
+static struct {
+  struct {
+    const char* name;
+    loadtaskfunc_t* func;
+  } tasks[LOAD_TASK_QUEUE_CAPACITY];
+  uint32_t count;
+  /* Index of the next task to run */
+  uint32_t next;
+  /* The running task asked to run again, see example_retry_load_task() */
+  bool retry;
+  float start_time;
+} load_queue;
+
+void example_queue_load_task(wgpu_example_context_t* context, const char* name,
+                             loadtaskfunc_t* func)
+{
+  UNUSED_VAR(context);
+  ASSERT(load_queue.count < LOAD_TASK_QUEUE_CAPACITY);
+
+  if (load_queue.next == load_queue.count) {
+    load_queue.start_time = platform_get_time();
+  }
+  load_queue.tasks[load_queue.count].name = name;
+  load_queue.tasks[load_queue.count].func = func;
+  ++load_queue.count;
+}
+
+void example_retry_load_task(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  load_queue.retry = true;
+}
+
+bool example_is_loading(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  return load_queue.next < load_queue.count;
+}
+
+static void run_load_task(wgpu_example_context_t* context)
+{
+  const uint32_t index    = load_queue.next++;
+  const uint64_t trace_ns = trace_begin();
+  load_queue.retry        = false;
+  wgpu_upload_batch_begin(context->wgpu_context);
+  load_queue.tasks[index].func(context);
+  wgpu_upload_batch_end(context->wgpu_context);
+  if (load_queue.retry) {
+    load_queue.next = index;
+  }
+  trace_end(load_queue.tasks[index].name, trace_ns);
+  arena_reset(context->load_arena);
+  if (!example_is_loading(context)) {
+    log_info("Loaded in %.2f s", platform_get_time() - load_queue.start_time);
+  }
+}
+
+/* Runs the queued tasks until the frame budget is used up */
+static void run_load_tasks(wgpu_example_context_t* context)
+{
+  const float time_start = platform_get_time();
+  do {
+    run_load_task(context);
+  } while (example_is_loading(context) && !load_queue.retry
+           && (platform_get_time() - time_start) * 1000.0f
+                < LOAD_TASK_FRAME_BUDGET_MS);
+}
+
+static void finish_load_tasks(wgpu_example_context_t* context)
+{
+  while (example_is_loading(context)) {
+    run_load_task(context);
+    if (load_queue.retry) {
+      // Wait for the background job without spinning
+      platform_sleep_until_ns(platform_get_time_ns()
+                              + LOAD_TASK_RETRY_SLEEP_NS);
+    }
+  }
+}
+
+static void update_loading_overlay(wgpu_example_context_t* context)
+{
+  const uint32_t done = load_queue.next;
+  const float width
+    = 200.0f * imgui_overlay_get_scale(context->imgui_overlay);
+  igText("Loading %s", load_queue.tasks[done].name);
+  igProgressBar((float)done / (float)load_queue.count, (ImVec2){width, 0.0f},
+                NULL);
+}
+
+/* Clears the frame buffer and draws the loading progress */
+static void render_loading_frame(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  prepare_frame(context);
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPURenderPassColorAttachment color_attachment = {
+    .view       = wgpu_context->swap_chain.frame_buffer,
+    .loadOp     = WGPULoadOp_Clear,
+    .storeOp    = WGPUStoreOp_Store,
+    .clearColor = (WGPUColor){
+      .r = 0.025f,
+      .g = 0.025f,
+      .b = 0.025f,
+      .a = 1.0f,
+    },
+  };
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .label                = "Loading render pass",
+               .colorAttachmentCount = 1,
+               .colorAttachments     = &color_attachment,
+             });
+  // Example passes may not exist yet
+  draw_ui_in_pass(context, update_loading_overlay, rpass_enc,
+                  &(imgui_overlay_pass_desc_t){0});
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0]
+    = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  submit_command_buffers(context);
+  submit_frame(context);
+}
+
+/* Device loss recovery */
+
+/* Destroys the example, replaces the lost device and initializes the example
+ * again, it reloads its resources from disk and its CPU-side data */
+static void recover_lost_device(wgpu_example_context_t* context,
+                                refexport_t* ref_export)
+{
+  log_warn("Recovering from the device loss");
+  const uint64_t trace_ns = trace_begin();
+
+  // The destroy functions see a complete example
+  finish_load_tasks(context);
+  wgpu_wait_for_pending_pipelines(context->wgpu_context);
+  ref_export->example_destroy_func(context);
+  release_dynamic_resolution(context);
+  release_imgui(context);
+
+  wgpu_recreate_device(context->wgpu_context);
+
+  intialize_dynamic_resolution(context, &ref_export->example_settings);
+  intialize_imgui(context, &ref_export->example_settings);
+  memset(&load_queue, 0, sizeof(load_queue));
+  wgpu_upload_batch_begin(context->wgpu_context);
+  ref_export->example_initialize_func(context);
+  wgpu_upload_batch_end(context->wgpu_context);
+  arena_reset(context->load_arena);
+  // Reproducible runs continue with the example loaded
+  if (context->headless || determinism.enabled) {
+    finish_load_tasks(context);
+  }
+  trace_end("recover_lost_device", trace_ns);
+}
+
 static void render_loop(wgpu_example_context_t* context,
-                        renderfunc_t* render_func,
+                        refexport_t* ref_export, renderfunc_t* render_func,
                         onviewchangedfunc_t* view_changed_func,
-                        onkeypressedfunc_t* example_on_key_pressed_func)
+                        onkeypressedfunc_t* example_on_key_pressed_func,
+                        benchmark_t* benchmark, uint32_t frame_count)
 {
   record_t record;
   memset(&record, 0, sizeof(record_t));
-  window_set_userdata(context->window, &record);
+  if (context->window != NULL) {
+    window_set_userdata(context->window, &record);
+  }
+
+  memset(&benchmark_counters, 0, sizeof(benchmark_counters));
+
+  frame_limiter_t frame_limiter;
+  frame_limiter_init(&frame_limiter, context->max_fps);
 
   float time_start, time_end, time_diff, fps_timer;
   record.last_timestamp = platform_get_time();
-  while (!window_should_close(context->window)) {
-    time_start                      = platform_get_time();
-    context->frame.timestamp_millis = time_start * 1000.0f;
+  float simulation_time = record.last_timestamp;
+  close_requested = false;
+  redraw_frames   = 0;
+  for (uint32_t frame = 0; !example_should_close(context); ++frame) {
+    // Stop after the requested number of frames (--frames)
+    if (frame_count > 0 && frame >= frame_count) {
+      break;
+    }
+    // The time spent waiting for input is not simulated
+    if (wait_for_redraw(context)) {
+      simulation_time = platform_get_time();
+    }
+    // The frame time excludes the wait of the frame limiter (--max-fps)
+    frame_limiter_wait(&frame_limiter);
+    time_start = platform_get_time();
+    if (determinism.enabled) {
+      context->frame.timestamp_millis
+        = (float)frame * DETERMINISTIC_FRAME_TIME * 1000.0f;
+      schedule_simulation_steps(context, DETERMINISTIC_FRAME_TIME);
+    }
+    else {
+      context->frame.timestamp_millis = time_start * 1000.0f;
+      schedule_simulation_steps(context, time_start - simulation_time);
+    }
+    simulation_time = time_start;
     if (record.view_updated) {
       record.mouse_scrolled = 0;
       record.wheel_delta    = 0;
       record.view_updated   = false;
     }
-    input_poll_events();
-    // update_window_size(context, &record);
-    render_func(context);
+    if (context->window != NULL) {
+      input_poll_events();
+      update_window_size(context, &record);
+    }
+    if (context->wgpu_context->device_lost) {
+      recover_lost_device(context, ref_export);
+      simulation_time = platform_get_time();
+    }
+    arena_reset(context->frame_arena);
+    wgpu_reload_changed_shaders(context->wgpu_context);
+    if (context->dynamic_resolution != NULL) {
+      wgpu_dynamic_resolution_update(context->dynamic_resolution);
+    }
+    // The example only receives input once it is loaded
+    const bool loading = example_is_loading(context);
+    onviewchangedfunc_t* frame_view_changed_func
+      = loading ? NULL : view_changed_func;
+    onkeypressedfunc_t* frame_key_pressed_func
+      = loading ? NULL : example_on_key_pressed_func;
+    if (context->low_latency_input) {
+      process_input(context, &record, frame_view_changed_func,
+                    frame_key_pressed_func);
+    }
+    // The replayed camera overrides the camera input
+    if (determinism.replay != NULL && context->camera != NULL
+        && camera_path_apply(determinism.replay, frame, context->camera)
+        && view_changed_func) {
+      view_changed_func(context);
+    }
+    if (loading) {
+      render_loading_frame(context);
+      run_load_tasks(context);
+      example_request_redraw(context);
+      // View changes during the loading are applied at once
+      if (!example_is_loading(context) && view_changed_func) {
+        view_changed_func(context);
+      }
+    }
+    else {
+      const uint64_t trace_ns = trace_begin();
+      render_func(context);
+      trace_end("render_func", trace_ns);
+    }
+    // Deliver the finished GPU readbacks, submit the readbacks of this frame
+    wgpu_readback_pool_tick(context->wgpu_context->readback_pool);
+    if (determinism.recording != NULL && context->camera != NULL) {
+      camera_path_record(determinism.recording, context->camera);
+    }
+    simulation.step_counter += simulation.recorded_steps;
     ++record.frame_counter;
     ++context->frame.index;
     time_end             = platform_get_time();
     time_diff            = (time_end - time_start) * 1000.0f;
-    record.frame_timer   = time_diff / 1000.0f;
+    record.frame_timer
+      = determinism.enabled ? DETERMINISTIC_FRAME_TIME : time_diff / 1000.0f;
     context->frame_timer = record.frame_timer;
     context->run_time += context->frame_timer;
-    update_camera(context, &record);
-    update_input_state(context, &record);
-    if (example_on_key_pressed_func) {
-      notify_key_input_state(&record, example_on_key_pressed_func);
+    performance_hud_add_frame(time_diff);
+    if (!context->low_latency_input) {
+      process_input(context, &record, frame_view_changed_func,
+                    frame_key_pressed_func);
     }
     // Convert to clamped timer value
     if (!context->paused) {
@@ -437,17 +1398,136 @@ static void render_loop(wgpu_example_context_t* context,
         context->timer -= 1.0f;
       }
     }
-    if (record.view_updated && view_changed_func) {
-      view_changed_func(context);
+    // A changed view is rendered in the next frame
+    if (record.view_updated) {
+      example_request_redraw(context);
     }
     fps_timer = (time_end - record.last_timestamp) * 1000.0f;
     if (fps_timer > 1000.0f) {
       record.last_fps   = (float)record.frame_counter * (1000.0f / fps_timer);
       context->last_fps = (int)(record.last_fps + 0.5f);
-      record.frame_counter  = 0;
+      context->simulation.steps_per_second
+        = (uint32_t)(simulation.step_counter * (1000.0f / fps_timer) + 0.5f);
+      simulation.step_counter = 0;
+      record.frame_counter    = 0;
       record.last_timestamp = time_end;
     }
     context->frame_counter = record.frame_counter;
+    // Record frame time and stop when all benchmark frames are measured
+    if (benchmark != NULL) {
+      const uint32_t frames_recorded = benchmark->frames_recorded;
+      benchmark_add_frame_time(benchmark, time_diff);
+      if (benchmark->frames_recorded > frames_recorded) {
+        benchmark_counters_add_frame(context->wgpu_context);
+      }
+      if (benchmark_is_finished(benchmark)) {
+        break;
+      }
+    }
+  }
+}
+
+static void begin_determinism(example_arguments_t* example_arguments)
+{
+  memset(&determinism, 0, sizeof(determinism));
+  determinism.enabled = example_arguments->deterministic != 0;
+  // The examples use both rand() and random_float()
+  if (determinism.enabled) {
+    srand((unsigned int)example_arguments->seed);
+    random_seed((uint32_t)example_arguments->seed);
+  }
+  if (example_arguments->camera_replay != NULL) {
+    determinism.replay = camera_path_load(example_arguments->camera_replay);
+  }
+  if (example_arguments->camera_record != NULL) {
+    determinism.recording      = camera_path_create();
+    determinism.recording_file = example_arguments->camera_record;
+  }
+}
+
+static void end_determinism(void)
+{
+  if (determinism.recording != NULL) {
+    if (camera_path_get_frame_count(determinism.recording) > 0) {
+      camera_path_save(determinism.recording, determinism.recording_file);
+    }
+    else {
+      log_warn("The example has no camera, no camera path recorded\n");
+    }
+  }
+  camera_path_release(determinism.recording);
+  camera_path_release(determinism.replay);
+  memset(&determinism, 0, sizeof(determinism));
+}
+
+static void write_benchmark_report(wgpu_example_context_t* context,
+                                   benchmark_t* benchmark,
+                                   const char* filename)
+{
+  // Average the WebGPU call counters of the measured frames
+  benchmark_counter_t
+    counters[BENCHMARK_COUNTER_COUNT + 1 + BENCHMARK_MAX_PASS_COUNTERS];
+  char pass_counter_names[BENCHMARK_MAX_PASS_COUNTERS][64];
+  uint32_t counter_count = 0;
+  if (wgpu_stats_enabled() && benchmark_counters.frame_count > 0) {
+    for (uint32_t i = 0; i < BENCHMARK_COUNTER_COUNT; ++i) {
+      counters[i] = (benchmark_counter_t){
+        .name = benchmark_counter_names[i],
+        .mean = benchmark_counters.sums[i] / benchmark_counters.frame_count,
+      };
+    }
+    counter_count = BENCHMARK_COUNTER_COUNT;
+  }
+  // Simulation steps, reported as steps per frame
+  double steps_per_frame = 0.0;
+  if (simulation.step_func != NULL && benchmark_counters.frame_count > 0) {
+    steps_per_frame
+      = benchmark_counters.simulation_steps / benchmark_counters.frame_count;
+    counters[counter_count++] = (benchmark_counter_t){
+      .name = "simulation_steps",
+      .mean = steps_per_frame,
+    };
+  }
+  // Pipeline statistics of the tagged passes
+  uint32_t pass_counter_count = 0;
+  for (uint32_t i = 0; i < benchmark_counters.pass_count
+                       && benchmark_counters.frame_count > 0;
+       ++i) {
+    const uint32_t first = benchmark_counters.passes[i].compute ? 4 : 0;
+    const uint32_t last  = benchmark_counters.passes[i].compute ? 5 : 4;
+    for (uint32_t j = first; j < last; ++j) {
+      char* name = pass_counter_names[pass_counter_count++];
+      snprintf(name, sizeof(pass_counter_names[0]), "%s.%s",
+               benchmark_counters.passes[i].name,
+               benchmark_pass_statistic_names[j]);
+      counters[counter_count++] = (benchmark_counter_t){
+        .name = name,
+        .mean = benchmark_counters.passes[i].sums[j]
+                / benchmark_counters.frame_count,
+      };
+    }
+  }
+
+  benchmark_write_report(benchmark, filename,
+                         &(benchmark_report_info_t){
+                           .example_title = context->example_title,
+                           .adapter_info  = context->adapter_info,
+                           .width         = context->window_size.width,
+                           .height        = context->window_size.height,
+                           .counters      = counters,
+                           .counter_count = counter_count,
+                         });
+
+  benchmark_statistics_t stats;
+  benchmark_get_statistics(benchmark, &stats);
+  log_info("Benchmark %s: %u frames, mean %.3f ms, p50 %.3f ms, p95 %.3f ms, "
+           "p99 %.3f ms, max %.3f ms\n",
+           context->example_title, stats.frame_count, stats.mean, stats.p50,
+           stats.p95, stats.p99, stats.max);
+  if (steps_per_frame > 0.0 && stats.mean > 0.0f) {
+    log_info("Benchmark %s: %.2f simulation steps/frame, %.1f steps/s\n",
+             context->example_title, steps_per_frame,
+             steps_per_frame * 1000.0 / stats.mean);
   }
 }
 
@@ -461,10 +1541,25 @@ void draw_ui(wgpu_example_context_t* context,
   }
 }
 
+void draw_ui_in_pass(wgpu_example_context_t* context,
+                     onupdateuioverlayfunc_t* example_on_update_ui_overlay_func,
+                     WGPURenderPassEncoder rpass_enc,
+                     const struct imgui_overlay_pass_desc_t* pass_desc)
+{
+  if (context->show_imgui_overlay) {
+    update_overlay(context, example_on_update_ui_overlay_func);
+    imgui_overlay_draw_in_pass(context->imgui_overlay, rpass_enc, pass_desc);
+  }
+}
+
 void prepare_frame(wgpu_example_context_t* context)
 {
   // Acquire the current image from the swap chain
+  const float time_start = platform_get_time();
+  const uint64_t trace_ns = trace_begin();
   wgpu_swap_chain_get_current_image(context->wgpu_context);
+  trace_end("acquire", trace_ns);
+  performance_hud.wait_time += platform_get_time() - time_start;
 
   ASSERT(context->wgpu_context->swap_chain.frame_buffer != NULL);
 }
@@ -474,39 +1569,277 @@ void submit_command_buffers(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context = context->wgpu_context;
 
   // Submit command buffer(s) to the queue
+  const uint64_t trace_ns = trace_begin();
   wgpu_flush_command_buffers(wgpu_context,
                              wgpu_context->submit_info.command_buffers,
                              wgpu_context->submit_info.command_buffer_count);
+  trace_end("submit", trace_ns);
+}
+
+uint32_t record_simulation_steps(wgpu_example_context_t* context,
+                                 WGPUCommandEncoder cmd_enc)
+{
+  const uint32_t step_count = simulation.scheduled_steps;
+  if (simulation.step_func == NULL || step_count == 0) {
+    return 0;
+  }
+
+  wgpu_profiler_t* profiler = context->wgpu_context->profiler;
+  wgpu_profiler_begin_scope(profiler, cmd_enc, "Simulation");
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Simulation compute pass",
+             });
+  for (uint32_t i = 0; i < step_count; ++i) {
+    simulation.step_func(context, cpass_enc);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  wgpu_profiler_end_scope(profiler, cmd_enc);
+
+  simulation.scheduled_steps = 0;
+  simulation.recorded_steps += step_count;
+
+  return step_count;
 }
 
 void submit_frame(wgpu_example_context_t* context)
 {
   // Present the current buffer to the swap chain
+  const float time_start = platform_get_time();
+  const uint64_t trace_ns = trace_begin();
   wgpu_swap_chain_present(context->wgpu_context);
+  trace_end("present", trace_ns);
+  performance_hud.wait_time += platform_get_time() - time_start;
+}
+
+static void record_demo_result(wgpu_example_context_t* context,
+                               benchmark_t* benchmark)
+{
+  if (demo_session.result_count >= DEMO_MAX_RESULTS) {
+    return;
+  }
+  snprintf(demo_session.results[demo_session.result_count].example_title,
+           STRMAX, "%s", context->example_title);
+  benchmark_get_statistics(
+    benchmark, &demo_session.results[demo_session.result_count].stats);
+  ++demo_session.result_count;
+}
+
+void example_list_adapters(void)
+{
+  const uint32_t adapter_count = wgpu_get_adapter_count();
+  printf("%u adapters available:\n", adapter_count);
+  wgpu_adapter_desc_t desc;
+  for (uint32_t i = 0; i < adapter_count; ++i) {
+    if (!wgpu_get_adapter_desc(i, &desc)) {
+      continue;
+    }
+    const WGPULimits* limits = &desc.limits.limits;
+    printf("[%u] %s (%s)\n", desc.index, desc.name, desc.driver_description);
+    printf("    vendor 0x%04x, device 0x%04x, %s, %s backend\n",
+           desc.vendor_id, desc.device_id, desc.adapter_type_name,
+           desc.backend_name);
+    printf("    maxTextureDimension2D             %u\n",
+           limits->maxTextureDimension2D);
+    printf("    maxTextureArrayLayers             %u\n",
+           limits->maxTextureArrayLayers);
+    printf("    maxBindGroups                     %u\n",
+           limits->maxBindGroups);
+    printf("    maxUniformBufferBindingSize       %llu\n",
+           (unsigned long long)limits->maxUniformBufferBindingSize);
+    printf("    maxStorageBufferBindingSize       %llu\n",
+           (unsigned long long)limits->maxStorageBufferBindingSize);
+    printf("    maxStorageBuffersPerShaderStage   %u\n",
+           limits->maxStorageBuffersPerShaderStage);
+    printf("    maxComputeWorkgroupStorageSize    %u\n",
+           limits->maxComputeWorkgroupStorageSize);
+    printf("    maxComputeInvocationsPerWorkgroup %u\n",
+           limits->maxComputeInvocationsPerWorkgroup);
+    printf("    maxComputeWorkgroupsPerDimension  %u\n",
+           limits->maxComputeWorkgroupsPerDimension);
+  }
 }
 
 void example_run(int argc, char* argv[], refexport_t* ref_export)
 {
+  if (demo_session.aborted) {
+    return;
+  }
   // Parse the example arguments
-  parse_example_arguments(argc, argv, ref_export);
+  example_arguments_t example_arguments;
+  parse_example_arguments(argc, argv, ref_export, &example_arguments);
+  if (example_arguments.list_adapters) {
+    example_list_adapters();
+    return;
+  }
   // Initialize WebGPU example context
   wgpu_example_context_t context;
   intialize_wgpu_example_context(&context, &ref_export->example_settings);
-  // Setup Window
+  context.validation_level   = example_arguments.validation_level;
+  context.frames_in_flight   = (uint32_t)example_arguments.frames_in_flight;
+  context.pipeline_cache_dir = example_arguments.pipeline_cache_dir;
+  context.watch_shaders      = example_arguments.watch_shaders != 0;
+  context.gpu_markers        = example_arguments.gpu_markers != 0;
+  context.simulation.steps_per_frame
+    = (uint32_t)example_arguments.simulation_steps;
+  context.simulation.step_rate = example_arguments.simulation_rate;
+  context.headless             = example_arguments.headless != 0;
+  context.adapter              = example_arguments.adapter;
+  context.low_power            = example_arguments.low_power != 0;
+  context.low_latency_input    = example_arguments.low_latency_input != 0;
+  context.on_demand            = example_arguments.on_demand != 0;
+  context.max_fps              = example_arguments.max_fps;
+  memset(&simulation, 0, sizeof(simulation));
+  simulation.step_func = ref_export->example_simulation_step_func;
+  // Benchmark and demo mode measure the uncapped frame rate
+  benchmark_t* benchmark = NULL;
+  if (demo_session.active) {
+    benchmark = benchmark_create(DEMO_WARMUP_FRAMES,
+                                 demo_session.settings.frame_count);
+    benchmark_set_max_duration(
+      benchmark, demo_session.settings.duration_seconds * 1000.0f);
+    context.vsync = false;
+  }
+  else if (example_arguments.benchmark) {
+    benchmark = benchmark_create(example_arguments.benchmark_warmup_frames,
+                                 example_arguments.benchmark_frames);
+    context.vsync = false;
+  }
+  // Measured frames are rendered back to back
+  if (benchmark != NULL) {
+    context.on_demand = false;
+    context.max_fps   = 0.0f;
+  }
+  // Without window only a benchmark or the frame count ends the render loop
+  uint32_t frame_count = (uint32_t)example_arguments.frame_count;
+  if (context.headless && benchmark == NULL && frame_count == 0) {
+    frame_count = HEADLESS_DEFAULT_FRAMES;
+  }
+  // Record the timeline of the whole run (--trace)
+  trace_begin_session(example_arguments.trace_output);
+  // Setup Window, headless mode only takes its size
   setup_window(&context, &ref_export->example_window_config);
   // Intialize WebGPU
   intialize_webgpu(&context);
+  // Intialize dynamic resolution
+  intialize_dynamic_resolution(&context, &ref_export->example_settings);
   // Intialize ImGui
   intialize_imgui(&context, &ref_export->example_settings);
-  // Intialize example
+  // Intialize example, the load arena holds its temporaries
+  context.frame_arena = arena_create(FRAME_ARENA_CAPACITY);
+  context.load_arena  = arena_create(LOAD_ARENA_CAPACITY);
+  begin_determinism(&example_arguments);
+  memset(&load_queue, 0, sizeof(load_queue));
+  const uint64_t trace_ns = trace_begin();
+  // The texture uploads of the initialization are submitted together
+  wgpu_upload_batch_begin(context.wgpu_context);
   ref_export->example_initialize_func(&context);
+  wgpu_upload_batch_end(context.wgpu_context);
+  trace_end("example_initialize", trace_ns);
+  arena_reset(context.load_arena);
+  // Measured and reproducible runs start with the example loaded
+  if (benchmark != NULL || context.headless || determinism.enabled) {
+    finish_load_tasks(&context);
+  }
   // Render loop
-  render_loop(&context, ref_export->example_render_func,
+  render_loop(&context, ref_export, ref_export->example_render_func,
               ref_export->example_on_view_changed_func,
-              ref_export->example_on_key_pressed_func);
-  // Cleanup
+              ref_export->example_on_key_pressed_func, benchmark, frame_count);
+  end_determinism();
+  // Benchmark report
+  if (demo_session.active) {
+    record_demo_result(&context, benchmark);
+    demo_session.aborted = example_should_close(&context);
+    benchmark_release(benchmark);
+  }
+  else if (benchmark != NULL) {
+    write_benchmark_report(&context, benchmark,
+                           example_arguments.benchmark_output);
+    benchmark_release(benchmark);
+  }
+  // Cleanup, pipelines created asynchronously are stored into the example.
+  // The example is destroyed fully loaded, also when closed while loading.
+  finish_load_tasks(&context);
+  wgpu_wait_for_pending_pipelines(context.wgpu_context);
   ref_export->example_destroy_func(&context);
+  release_dynamic_resolution(&context);
   release_imgui(&context);
   release_webgpu(&context);
-  window_destroy(context.window);
+  arena_release(context.frame_arena);
+  arena_release(context.load_arena);
+  if (!demo_session.active && context.window != NULL) {
+    window_destroy(context.window);
+  }
+  trace_end_session();
+}
+
+/* Demo mode */
+
+void example_demo_begin(const example_demo_settings_t* settings)
+{
+  memset(&demo_session, 0, sizeof(demo_session));
+  demo_session.active   = true;
+  demo_session.settings = *settings;
+  if (demo_session.settings.frame_count == 0
+      && demo_session.settings.duration_seconds <= 0.0f) {
+    demo_session.settings.duration_seconds = 10.0f;
+  }
+}
+
+bool example_demo_aborted(void)
+{
+  return demo_session.aborted;
+}
+
+static void write_demo_summary(FILE* file, bool csv)
+{
+  if (csv) {
+    fprintf(file, "example,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+  }
+  else {
+    fprintf(file, "Adapter: %s (%s backend - %s)\n",
+            demo_session.adapter_info[0], demo_session.adapter_info[2],
+            demo_session.adapter_info[1]);
+    fprintf(file, "%-36s %8s %9s %9s %9s %9s %9s\n", "Example", "Frames",
+            "Mean(ms)", "P50(ms)", "P95(ms)", "P99(ms)", "Max(ms)");
+  }
+  for (uint32_t i = 0; i < demo_session.result_count; ++i) {
+    const benchmark_statistics_t* stats = &demo_session.results[i].stats;
+    fprintf(file,
+            csv ? "\"%s\",%u,%.4f,%.4f,%.4f,%.4f,%.4f\n" :
+                  "%-36.36s %8u %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+            demo_session.results[i].example_title, stats->frame_count,
+            stats->mean, stats->p50, stats->p95, stats->p99, stats->max);
+  }
+}
+
+void example_demo_end(void)
+{
+  if (!demo_session.active) {
+    return;
+  }
+
+  // Summary table
+  write_demo_summary(stdout, false);
+  if (demo_session.settings.output_file != NULL) {
+    FILE* file = fopen(demo_session.settings.output_file, "w");
+    if (file != NULL) {
+      write_demo_summary(file, true);
+      fclose(file);
+    }
+    else {
+      log_error("Unable to open demo report file '%s'\n",
+                demo_session.settings.output_file);
+    }
+  }
+
+  // Release the shared window and WebGPU context
+  if (demo_session.wgpu_context != NULL) {
+    wgpu_context_release(demo_session.wgpu_context);
+  }
+  if (demo_session.window != NULL) {
+    window_destroy(demo_session.window);
+  }
+  memset(&demo_session, 0, sizeof(demo_session));
 }
@@ -5,6 +5,7 @@
 #include "../webgpu/api.h"
 
 typedef struct {
+  // NULL in headless mode
   window_t* window;
   struct {
     uint32_t width;
@@ -14,6 +15,36 @@ typedef struct {
   callbacks_t callbacks;
   wgpu_context_t* wgpu_context;
   bool vsync;
+  backend_validation_level_enum validation_level;
+  uint32_t frames_in_flight;
+  const char* pipeline_cache_dir;
+  bool watch_shaders;
+  // Debug groups around the passes for external GPU profilers (--gpu-markers)
+  bool gpu_markers;
+  bool reversed_z;
+  // Adapter selection (--adapter), NULL = select by power preference
+  const char* adapter;
+  bool low_power;
+  // Device limits of the example settings
+  WGPULimits required_limits;
+  // Headless mode (--headless): no window and swap chain, the frames are
+  // rendered into the offscreen frame buffer of the WebGPU context
+  bool headless;
+  // Camera input is applied before the frame is rendered instead of after it
+  // (--low-latency-input), the frame uses the input of the same frame
+  bool low_latency_input;
+  // On-demand rendering (--on-demand): the render loop sleeps until an input
+  // event arrives, see example_request_redraw()
+  bool on_demand;
+  // Target frame rate (--max-fps), 0 = unlimited, the render loop waits with
+  // a frame limiter until the next frame is due
+  float max_fps;
+  // CPU scratch memory: the frame arena is reset before every frame, the
+  // load arena after the example is initialized
+  arena_t* frame_arena;
+  arena_t* load_arena;
+  // Dynamic resolution controller, NULL unless the example opts in
+  wgpu_dynamic_resolution_t* dynamic_resolution;
   struct {
     size_t index;
     float timestamp_millis;
@@ -42,6 +73,15 @@ typedef struct {
   // Multiplier for speeding up (or slowing down) the global timer
   float timer_speed;
   bool paused;
+  // Fixed timestep simulation, see record_simulation_steps()
+  struct {
+    // Steps recorded per frame, used when step_rate is 0
+    uint32_t steps_per_frame;
+    // Simulated steps per second of frame time, 0 = steps_per_frame
+    float step_rate;
+    // Recorded simulation steps per second, updated with last_fps
+    uint32_t steps_per_second;
+  } simulation;
   camera_t* camera;
   // Input
   vec2 mouse_position;
@@ -61,6 +101,24 @@ typedef struct {
   bool overlay;
   /** @brief Create texture client */
   bool create_texture_client;
+  /**
+   * @brief Reversed-Z depth: Depth32Float cleared to 0.0 and a GreaterEqual
+   * depth test, the camera should set reversed_z as well
+   */
+  bool reversed_z;
+  /**
+   * @brief Creates context->dynamic_resolution, updated before every frame.
+   * The example renders its scene into a texture scaled by
+   * wgpu_dynamic_resolution_get_scale() and upscales it in the final pass.
+   */
+  bool dynamic_resolution;
+  /** @brief GPU frame time of the dynamic resolution, 0 = 16.6 ms */
+  float target_frame_time_ms;
+  /**
+   * @brief Device limits the example needs, the non-zero limits are
+   * requested. All zero = the adapter limits are requested.
+   */
+  WGPULimits required_limits;
 } wgpu_example_settings_t;
 
 typedef void* surface_t;
@@ -72,6 +130,9 @@ typedef void onupdateuioverlayfunc_t(wgpu_example_context_t* context);
 typedef void onkeypressedfunc_t(keycode_t key);
 typedef void onpointerdownfunc_t(button_t button);
 typedef void onpointerupfunc_t(button_t button);
+typedef void simulationstepfunc_t(wgpu_example_context_t* context,
+                                  WGPUComputePassEncoder cpass_enc);
+typedef void loadtaskfunc_t(wgpu_example_context_t* context);
 
 typedef struct {
   onkeypressedfunc_t* example_on_key_pressed_func;
@@ -87,15 +148,78 @@ typedef struct {
   destroyfunc_t* example_destroy_func;
   onviewchangedfunc_t* example_on_view_changed_func;
   onkeypressedfunc_t* example_on_key_pressed_func;
+  /** @brief Records one simulation step, see record_simulation_steps() */
+  simulationstepfunc_t* example_simulation_step_func;
 } refexport_t;
 
+struct imgui_overlay_pass_desc_t;
+
 /* Helper functions */
 void draw_ui(wgpu_example_context_t* context,
              onupdateuioverlayfunc_t* example_on_update_ui_overlay_func);
+/* Draws the UI into the final render pass of the example instead of an extra
+ * pass, pass_desc describes its attachments (see imgui_overlay.h) */
+void draw_ui_in_pass(wgpu_example_context_t* context,
+                     onupdateuioverlayfunc_t* example_on_update_ui_overlay_func,
+                     WGPURenderPassEncoder rpass_enc,
+                     const struct imgui_overlay_pass_desc_t* pass_desc);
 void prepare_frame(wgpu_example_context_t* context);
 void submit_command_buffers(wgpu_example_context_t* context);
 void submit_frame(wgpu_example_context_t* context);
 
+/* Records the simulation steps scheduled for the current frame into a single
+ * compute pass, the step function of the example is called once per step and
+ * advances its own ping-pong state. Runs steps_per_frame steps per frame, or
+ * with a step_rate as many fixed timesteps as fit into the elapsed frame time.
+ * Returns the number of recorded steps, no steps are scheduled while paused.
+ * The steps per frame and rate can be set with --simulation-steps and
+ * --simulation-rate. */
+uint32_t record_simulation_steps(wgpu_example_context_t* context,
+                                 WGPUCommandEncoder cmd_enc);
+
+/* Ends the render loop after the current frame, also in headless mode */
+void example_request_close(wgpu_example_context_t* context);
+
+/* Renders the next frame in on-demand mode without waiting for input, called
+ * every frame by examples animating on their own. Examples with a simulation
+ * step function animate unless they are paused. */
+void example_request_redraw(wgpu_example_context_t* context);
+
+/* Staged initialization: the initialize function of the example only sets up
+ * what the first frame needs and queues the loading of its assets and
+ * pipelines. The framework runs the queued tasks in order, as many per frame
+ * as fit into a frame budget, and renders a loading frame with the progress
+ * in the overlay meanwhile. The render, view changed and key pressed
+ * functions of the example are called once all tasks are done, the view
+ * changed function once right after. Tasks can queue further tasks, the load
+ * arena is reset after every task. Benchmark, headless and deterministic runs
+ * finish all tasks before the first frame. */
+void example_queue_load_task(wgpu_example_context_t* context, const char* name,
+                             loadtaskfunc_t* func);
+/* Called by a task waiting for a background job (e.g. an asynchronously
+ * loaded glTF model), the task runs again in the next frame instead of being
+ * done */
+void example_retry_load_task(wgpu_example_context_t* context);
+bool example_is_loading(wgpu_example_context_t* context);
+
 void example_run(int argc, char* argv[], refexport_t* ref_export);
 
+/* Adapter list of --list-adapters with the limits of each adapter, the index
+ * selects the adapter with --adapter=<index> */
+void example_list_adapters(void);
+
+/* Demo mode: runs examples back-to-back sharing the window and device */
+typedef struct example_demo_settings_t {
+  /** @brief Number of measured frames per example, 0 = use duration */
+  uint32_t frame_count;
+  /** @brief Measured duration per example (in seconds) */
+  float duration_seconds;
+  /** @brief Optional CSV file for the summary table */
+  const char* output_file;
+} example_demo_settings_t;
+
+void example_demo_begin(const example_demo_settings_t* settings);
+bool example_demo_aborted(void);
+void example_demo_end(void);
+
 #endif
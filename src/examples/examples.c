@@ -18,6 +18,7 @@ void example_compute_n_body(int argc, char* argv[]);
 void example_compute_particles(int argc, char* argv[]);
 void example_compute_particles_easing(int argc, char* argv[]);
 void example_compute_particles_webgpu_logo(int argc, char* argv[]);
+void example_compute_primitives(int argc, char* argv[]);
 void example_compute_ray_tracing(int argc, char* argv[]);
 void example_compute_shader(int argc, char* argv[]);
 void example_conservative_raster(int argc, char* argv[]);
@@ -32,7 +33,10 @@ void example_equirectangular_image(int argc, char* argv[]);
 void example_gears(int argc, char* argv[]);
 void example_gerstner_waves(int argc, char* argv[]);
 void example_gltf_loading(int argc, char* argv[]);
+void example_gltf_mesh_instancing(int argc, char* argv[]);
+void example_gltf_morph_targets(int argc, char* argv[]);
 void example_gltf_scene_rendering(int argc, char* argv[]);
+void example_gltf_skinning(int argc, char* argv[]);
 void example_hdr(int argc, char* argv[]);
 void example_image_blur(int argc, char* argv[]);
 void example_imgui_overlay(int argc, char* argv[]);
@@ -68,6 +72,8 @@ void example_textured_quad(int argc, char* argv[]);
 void example_triangle(int argc, char* argv[]);
 void example_two_cubes(int argc, char* argv[]);
 void example_video_uploading(int argc, char* argv[]);
+void example_video_wall(int argc, char* argv[]);
+void example_voxelization(int argc, char* argv[]);
 void example_wireframe_vertex_pulling(int argc, char* argv[]);
 
 static examplecase_t g_example_cases[] = {
@@ -82,6 +88,7 @@ static examplecase_t g_example_cases[] = {
   {"compute_particles", example_compute_particles},
   {"compute_particles_easing", example_compute_particles_easing},
   {"compute_particles_webgpu_logo", example_compute_particles_webgpu_logo},
+  {"compute_primitives", example_compute_primitives},
   {"compute_ray_tracing", example_compute_ray_tracing},
   {"compute_shader", example_compute_shader},
   {"conservative_raster", example_conservative_raster},
@@ -96,7 +103,10 @@ static examplecase_t g_example_cases[] = {
   {"gears", example_gears},
   {"gerstner_waves", example_gerstner_waves},
   {"gltf_loading", example_gltf_loading},
+  {"gltf_mesh_instancing", example_gltf_mesh_instancing},
+  {"gltf_morph_targets", example_gltf_morph_targets},
   {"gltf_scene_rendering", example_gltf_scene_rendering},
+  {"gltf_skinning", example_gltf_skinning},
   {"hdr", example_hdr},
   {"image_blur", example_image_blur},
   {"imgui_overlay", example_imgui_overlay},
@@ -132,6 +142,8 @@ static examplecase_t g_example_cases[] = {
   {"triangle", example_triangle},
   {"two_cubes", example_two_cubes},
   {"video_uploading", example_video_uploading},
+  {"video_wall", example_video_wall},
+  {"voxelization", example_voxelization},
   {"wireframe_vertex_pulling", example_wireframe_vertex_pulling},
 };
 
@@ -24,6 +24,13 @@
 
 #define MAX_DIMENSIONS 3
 
+/* Solvers of the pressure Poisson equation */
+typedef enum {
+  PRESSURE_SOLVER_JACOBI,        /* ping-pong Jacobi iterations */
+  PRESSURE_SOLVER_RED_BLACK_SOR, /* in-place red-black SOR iterations */
+  PRESSURE_SOLVER_COUNT,
+} pressure_solver_t;
+
 static struct {
   uint32_t grid_size;
   uint32_t grid_w;
@@ -36,6 +43,7 @@ static struct {
   float dx;
   uint32_t sim_speed;
   bool contain_fluid;
+  bool fuse_kernels; /* fused advect/boundary and vorticity/confinement */
   float velocity_add_intensity;
   float velocity_add_radius;
   float velocity_diffusion;
@@ -45,6 +53,8 @@ static struct {
   float viscosity;
   uint32_t vorticity;
   uint32_t pressure_iterations;
+  int32_t pressure_solver;
+  float pressure_omega; /* SOR over-relaxation factor in [1, 2) */
   int32_t buffer_view;
   float dt;
   float time;
@@ -53,6 +63,7 @@ static struct {
   .dye_size               = 2048,
   .sim_speed              = 5,
   .contain_fluid          = true,
+  .fuse_kernels           = false,
   .velocity_add_intensity = 0.1f,
   .velocity_add_radius    = 0.0001f,
   .velocity_diffusion     = 0.9999f,
@@ -62,6 +73,8 @@ static struct {
   .viscosity              = 0.8f,
   .vorticity              = 2,
   .pressure_iterations    = 100,
+  .pressure_solver        = PRESSURE_SOLVER_JACOBI,
+  .pressure_omega         = 1.9f,
   .buffer_view            = 0,
   .dt                     = 0.0f,
   .time                   = 0.0f,
@@ -190,6 +203,9 @@ static struct {
 
   /* The r,g,b buffer containing the data to render */
   dynamic_buffer_t rgb_buffer;
+
+  /* Max residual and max right-hand side of the pressure equation */
+  dynamic_buffer_t pressure_residual;
 } dynamic_buffers;
 
 /* Initialize dynamic buffers */
@@ -217,6 +233,9 @@ static void dynamic_buffers_init(wgpu_context_t* wgpu_context)
 
   dynamic_buffer_init(&dynamic_buffers.vorticity, wgpu_context, 1,
                       settings.grid_w, settings.grid_h);
+
+  dynamic_buffer_init(&dynamic_buffers.pressure_residual, wgpu_context, 1, 2,
+                      1);
 }
 
 static void dynamic_buffers_destroy()
@@ -236,6 +255,8 @@ static void dynamic_buffers_destroy()
   dynamic_buffer_destroy(&dynamic_buffers.vorticity);
 
   dynamic_buffer_destroy(&dynamic_buffers.rgb_buffer);
+
+  dynamic_buffer_destroy(&dynamic_buffers.pressure_residual);
 }
 
 /* -------------------------------------------------------------------------- *
@@ -260,6 +281,7 @@ typedef enum {
   UNIFORM_MOUSE_TYPE,             /* mouse_type */
   UNIFORM_RENDER_INTENSITY,       /* render_intensity_multiplier */
   UNIFORM_RENDER_DYE,             /* render_dye_buffer */
+  UNIFORM_PRESSURE_OMEGA,         /* pressure_omega */
   UNIFORM_COUNT,
 } uniform_type_t;
 
@@ -293,6 +315,7 @@ static struct {
   uniform_t u_symmetry;
   uniform_t u_render_intensity;
   uniform_t u_render_dye;
+  uniform_t pressure_omega;
 } uniforms;
 
 static uniform_t* global_uniforms[UNIFORM_COUNT] = {0};
@@ -379,6 +402,8 @@ static void uniforms_buffers_init(wgpu_context_t* wgpu_context)
   uniform_init(&uniforms.contain_fluid, wgpu_context, UNIFORM_CONTAIN_FLUID, 1,
                NULL);
   uniform_init(&uniforms.u_symmetry, wgpu_context, UNIFORM_MOUSE_TYPE, 1, NULL);
+  uniform_init(&uniforms.pressure_omega, wgpu_context, UNIFORM_PRESSURE_OMEGA,
+               1, NULL);
 }
 
 /* -------------------------------------------------------------------------- *
@@ -407,10 +432,20 @@ static struct {
   program_t divergence_program;
   program_t gradient_subtract_program;
   program_t pressure_program;
+  program_t pressure_red_program;
+  program_t pressure_black_program;
+  program_t pressure_residual_program;
   program_t update_dye_program;
   program_t update_program;
   program_t vorticity_confinment_program;
   program_t vorticity_program;
+  /* Fused kernels and the programs reading or writing their outputs */
+  struct {
+    program_t advect_boundary_program;
+    program_t divergence_program;
+    program_t gradient_subtract_program;
+    program_t vorticity_confinment_program;
+  } fused;
 } programs;
 
 static void program_init_defaults(program_t* this)
@@ -418,23 +453,21 @@ static void program_init_defaults(program_t* this)
   memset(this, 0, sizeof(*this));
 }
 
-static void program_init(program_t* this, wgpu_context_t* wgpu_context,
-                         dynamic_buffer_t** buffers, uint32_t buffer_count,
-                         uniform_t** uniforms, uint32_t uniform_count,
-                         const char* shader_wgsl_path, uint32_t dispatch_x,
-                         uint32_t dispatch_y)
+/* With bind_all_dims each dimension of a buffer is a separate binding,
+ * otherwise only the first dimension is bound */
+static void program_init_shader(program_t* this, wgpu_context_t* wgpu_context,
+                                dynamic_buffer_t** buffers,
+                                uint32_t buffer_count, bool bind_all_dims,
+                                uniform_t** uniforms, uint32_t uniform_count,
+                                wgpu_shader_desc_t const* shader_desc,
+                                uint32_t dispatch_x, uint32_t dispatch_y)
 {
   program_init_defaults(this);
 
   /* Create the shader module using the WGSL string and use it to create a
    * compute pipeline with 'auto' binding layout */
   {
-    wgpu_shader_t comp_shader
-      = wgpu_shader_create(wgpu_context, &(wgpu_shader_desc_t){
-                                           /* Compute shader WGSL */
-                                           .file  = shader_wgsl_path,
-                                           .entry = "main",
-                                         });
+    wgpu_shader_t comp_shader = wgpu_shader_create(wgpu_context, shader_desc);
     this->compute_pipeline = wgpuDeviceCreateComputePipeline(
       wgpu_context->device,
       &(WGPUComputePipelineDescriptor){
@@ -445,17 +478,20 @@ static void program_init(program_t* this, wgpu_context_t* wgpu_context,
 
   /* Concat the buffer & uniforms and format the entries to the right WebGPU
    * format */
-  WGPUBindGroupEntry
-    bg_entries[PROGRAM_MAX_BUFFER_COUNT + PROGRAM_MAX_UNIFORM_COUNT];
+  WGPUBindGroupEntry bg_entries[PROGRAM_MAX_BUFFER_COUNT * MAX_DIMENSIONS
+                                + PROGRAM_MAX_UNIFORM_COUNT];
   uint32_t bge_i = 0;
   {
-    for (uint32_t i = 0; i < buffer_count; ++i, ++bge_i) {
-      bg_entries[bge_i] = (WGPUBindGroupEntry){
-        .binding = bge_i,
-        .buffer  = buffers[i]->buffers[0].buffer,
-        .offset  = 0,
-        .size    = buffers[i]->buffers[0].size,
-      };
+    for (uint32_t i = 0; i < buffer_count; ++i) {
+      const uint32_t dims = bind_all_dims ? buffers[i]->dims : 1;
+      for (uint32_t dim = 0; dim < dims; ++dim, ++bge_i) {
+        bg_entries[bge_i] = (WGPUBindGroupEntry){
+          .binding = bge_i,
+          .buffer  = buffers[i]->buffers[dim].buffer,
+          .offset  = 0,
+          .size    = buffers[i]->buffers[dim].size,
+        };
+      }
     }
     for (uint32_t i = 0; i < uniform_count; ++i, ++bge_i) {
       bg_entries[bge_i] = (WGPUBindGroupEntry){
@@ -483,6 +519,22 @@ static void program_init(program_t* this, wgpu_context_t* wgpu_context,
   this->dispatch_y = dispatch_y;
 }
 
+static void program_init(program_t* this, wgpu_context_t* wgpu_context,
+                         dynamic_buffer_t** buffers, uint32_t buffer_count,
+                         uniform_t** uniforms, uint32_t uniform_count,
+                         const char* shader_wgsl_path, uint32_t dispatch_x,
+                         uint32_t dispatch_y)
+{
+  program_init_shader(this, wgpu_context, buffers, buffer_count, false,
+                      uniforms, uniform_count,
+                      &(wgpu_shader_desc_t){
+                        /* Compute shader WGSL */
+                        .file  = shader_wgsl_path,
+                        .entry = "main",
+                      },
+                      dispatch_x, dispatch_y);
+}
+
 static void program_destroy(program_t* this)
 {
   WGPU_RELEASE_RESOURCE(ComputePipeline, this->compute_pipeline)
@@ -674,6 +726,152 @@ static void init_pressure_program(program_t* this, wgpu_context_t* wgpu_context)
                settings.grid_w, settings.grid_h);
 }
 
+/* Red-black successive over-relaxation of the pressure equation, updated in
+ * place. The red and black cells are relaxed by separate dispatches over half
+ * the grid width, each cell only reads neighbors of the other color. The
+ * missing neighbors at the border are the cell itself (zero normal pressure
+ * gradient). */
+// clang-format off
+static const char* pressure_sor_shader_wgsl = CODE(
+  struct GridSize {
+    w : f32,
+    h : f32,
+    dyeW: f32,
+    dyeH: f32,
+    dx : f32,
+    rdx : f32,
+    dyeRdx : f32
+  }
+
+  @group(0) @binding(0) var<storage, read_write> pressure : array<f32>;
+  @group(0) @binding(1) var<storage, read_write> divergence : array<f32>;
+  @group(0) @binding(2) var<uniform> uGrid : GridSize;
+  @group(0) @binding(3) var<uniform> omega : f32;
+
+  fn relax(x : u32, y : u32) {
+    let w = u32(uGrid.w);
+    let h = u32(uGrid.h);
+    if (x >= w || y >= h) {
+      return;
+    }
+
+    let index = x + y * w;
+    let L = pressure[select(index - 1u, index, x == 0u)];
+    let R = pressure[select(index + 1u, index, x + 1u == w)];
+    let B = pressure[select(index - w, index, y == 0u)];
+    let T = pressure[select(index + w, index, y + 1u == h)];
+    let alpha = -(uGrid.dx * uGrid.dx);
+    let jacobi = (L + R + B + T + alpha * divergence[index]) * 0.25;
+    pressure[index] = mix(pressure[index], jacobi, omega);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn red(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    relax(global_id.x * 2u + (global_id.y & 1u), global_id.y);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn black(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    relax(global_id.x * 2u + ((global_id.y + 1u) & 1u), global_id.y);
+  }
+);
+// clang-format on
+
+/* Max residual |L + R + B + T - 4p - dx^2 div| and max |dx^2 div| over the
+ * interior cells. The values are positive, so their bit patterns order like
+ * the floats and an atomic max on u32 is enough. */
+// clang-format off
+static const char* pressure_residual_shader_wgsl = CODE(
+  struct GridSize {
+    w : f32,
+    h : f32,
+    dyeW: f32,
+    dyeH: f32,
+    dx : f32,
+    rdx : f32,
+    dyeRdx : f32
+  }
+
+  @group(0) @binding(0) var<storage, read_write> pressure : array<f32>;
+  @group(0) @binding(1) var<storage, read_write> divergence : array<f32>;
+  @group(0) @binding(2) var<storage, read_write> residual : array<atomic<u32>>;
+  @group(0) @binding(3) var<uniform> uGrid : GridSize;
+
+  var<workgroup> groupResidual : atomic<u32>;
+  var<workgroup> groupRhs : atomic<u32>;
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>,
+          @builtin(local_invocation_index) local_index : u32) {
+    let w = u32(uGrid.w);
+    let h = u32(uGrid.h);
+    let x = global_id.x;
+    let y = global_id.y;
+
+    if (x > 0u && y > 0u && x + 1u < w && y + 1u < h) {
+      let index = x + y * w;
+      let rhs = uGrid.dx * uGrid.dx * divergence[index];
+      let r = pressure[index - 1u] + pressure[index + 1u]
+              + pressure[index - w] + pressure[index + w]
+              - 4.0 * pressure[index] - rhs;
+      atomicMax(&groupResidual, bitcast<u32>(abs(r)));
+      atomicMax(&groupRhs, bitcast<u32>(abs(rhs)));
+    }
+
+    workgroupBarrier();
+    if (local_index == 0u) {
+      atomicMax(&residual[0], atomicLoad(&groupResidual));
+      atomicMax(&residual[1], atomicLoad(&groupRhs));
+    }
+  }
+);
+// clang-format on
+
+static void init_pressure_sor_program(program_t* this,
+                                      wgpu_context_t* wgpu_context,
+                                      const char* entry)
+{
+  dynamic_buffer_t* program_buffers[2] = {
+    &dynamic_buffers.pressure,   /* pressure */
+    &dynamic_buffers.divergence, /* in_divergence */
+  };
+  uniform_t* program_uniforms[2] = {
+    &uniforms.grid,           /* */
+    &uniforms.pressure_omega, /* */
+  };
+  program_init_shader(this, wgpu_context, program_buffers,
+                      (uint32_t)ARRAY_SIZE(program_buffers), false,
+                      program_uniforms, (uint32_t)ARRAY_SIZE(program_uniforms),
+                      &(wgpu_shader_desc_t){
+                        /* Compute shader WGSL */
+                        .wgsl_code.source = pressure_sor_shader_wgsl,
+                        .entry            = entry,
+                      },
+                      (settings.grid_w + 1) / 2, settings.grid_h);
+}
+
+static void init_pressure_residual_program(program_t* this,
+                                           wgpu_context_t* wgpu_context)
+{
+  dynamic_buffer_t* program_buffers[3] = {
+    &dynamic_buffers.pressure,          /* in_pressure */
+    &dynamic_buffers.divergence,        /* in_divergence */
+    &dynamic_buffers.pressure_residual, /* out_residual */
+  };
+  uniform_t* program_uniforms[1] = {
+    &uniforms.grid, /* */
+  };
+  program_init_shader(this, wgpu_context, program_buffers,
+                      (uint32_t)ARRAY_SIZE(program_buffers), false,
+                      program_uniforms, (uint32_t)ARRAY_SIZE(program_uniforms),
+                      &(wgpu_shader_desc_t){
+                        /* Compute shader WGSL */
+                        .wgsl_code.source = pressure_residual_shader_wgsl,
+                        .entry            = "main",
+                      },
+                      settings.grid_w, settings.grid_h);
+}
+
 static void init_update_dye_program(program_t* this,
                                     wgpu_context_t* wgpu_context)
 {
@@ -758,6 +956,223 @@ static void init_vorticity_program(program_t* this,
                settings.grid_w, settings.grid_h);
 }
 
+/* Fused advection and velocity boundary. Border cells take the advected
+ * velocity of their inner neighbor, negated if the fluid is contained, so the
+ * boundary needs no separate pass over the advected field. */
+// clang-format off
+static const char* advect_boundary_shader_wgsl = CODE(
+  struct GridSize {
+    w : f32,
+    h : f32,
+    dyeW: f32,
+    dyeH: f32,
+    dx : f32,
+    rdx : f32,
+    dyeRdx : f32
+  }
+
+  @group(0) @binding(0) var<storage, read_write> x_in : array<f32>;
+  @group(0) @binding(1) var<storage, read_write> y_in : array<f32>;
+  @group(0) @binding(2) var<storage, read_write> x_out : array<f32>;
+  @group(0) @binding(3) var<storage, read_write> y_out : array<f32>;
+  @group(0) @binding(4) var<uniform> uGrid : GridSize;
+  @group(0) @binding(5) var<uniform> uDt : f32;
+  @group(0) @binding(6) var<uniform> uContainFluid : f32;
+
+  fn ID(p : vec2<f32>) -> u32 {
+    return u32(p.x + p.y * uGrid.w);
+  }
+
+  fn velocity(p : vec2<f32>) -> vec2<f32> {
+    let index = ID(p);
+    return vec2<f32>(x_in[index], y_in[index]);
+  }
+
+  fn advect(pos : vec2<f32>) -> vec2<f32> {
+    let maxPos = vec2<f32>(uGrid.w - 1.0, uGrid.h - 1.0);
+    let x = clamp(pos - uDt * uGrid.rdx * velocity(pos), vec2<f32>(0.0),
+                  maxPos);
+    let p0 = floor(x);
+    let p1 = min(p0 + 1.0, maxPos);
+    let f = x - p0;
+    let q0 = mix(velocity(p0), velocity(vec2<f32>(p1.x, p0.y)), f.x);
+    let q1 = mix(velocity(vec2<f32>(p0.x, p1.y)), velocity(p1), f.x);
+    return mix(q0, q1, f.y);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let pos = vec2<f32>(global_id.xy);
+    if (pos.x >= uGrid.w || pos.y >= uGrid.h) {
+      return;
+    }
+
+    let source = clamp(pos, vec2<f32>(1.0),
+                       vec2<f32>(uGrid.w - 2.0, uGrid.h - 2.0));
+    var scale = 1.0;
+    if (any(source != pos) && uContainFluid == 1.0) {
+      scale = -1.0;
+    }
+
+    let V = advect(source) * scale;
+    let index = ID(pos);
+    x_out[index] = V.x;
+    y_out[index] = V.y;
+  }
+);
+// clang-format on
+
+/* Fused vorticity and vorticity confinement. The curl of the neighbors is
+ * recomputed from the velocity instead of being read back from the vorticity
+ * field, which is still written for the buffer view. */
+// clang-format off
+static const char* vorticity_confinment_fused_shader_wgsl = CODE(
+  struct GridSize {
+    w : f32,
+    h : f32,
+    dyeW: f32,
+    dyeH: f32,
+    dx : f32,
+    rdx : f32,
+    dyeRdx : f32
+  }
+
+  @group(0) @binding(0) var<storage, read_write> x_vel : array<f32>;
+  @group(0) @binding(1) var<storage, read_write> y_vel : array<f32>;
+  @group(0) @binding(2) var<storage, read_write> x_out : array<f32>;
+  @group(0) @binding(3) var<storage, read_write> y_out : array<f32>;
+  @group(0) @binding(4) var<storage, read_write> vorticity : array<f32>;
+  @group(0) @binding(5) var<uniform> uGrid : GridSize;
+  @group(0) @binding(6) var<uniform> uDt : f32;
+  @group(0) @binding(7) var<uniform> uVorticity : f32;
+
+  fn ID(x : f32, y : f32) -> u32 {
+    return u32(x + y * uGrid.w);
+  }
+
+  fn curl(x : f32, y : f32) -> f32 {
+    let Ly = y_vel[ID(x - 1.0, y)];
+    let Ry = y_vel[ID(x + 1.0, y)];
+    let Bx = x_vel[ID(x, y - 1.0)];
+    let Tx = x_vel[ID(x, y + 1.0)];
+    return 0.5 * ((Ry - Ly) - (Tx - Bx));
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let pos = vec2<f32>(global_id.xy);
+    if (pos.x >= uGrid.w || pos.y >= uGrid.h) {
+      return;
+    }
+
+    let index = ID(pos.x, pos.y);
+    if (pos.x < 2.0 || pos.y < 2.0
+        || pos.x >= uGrid.w - 2.0 || pos.y >= uGrid.h - 2.0) {
+      x_out[index] = x_vel[index];
+      y_out[index] = y_vel[index];
+      vorticity[index] = 0.0;
+      return;
+    }
+
+    let C = curl(pos.x, pos.y);
+    let L = curl(pos.x - 1.0, pos.y);
+    let R = curl(pos.x + 1.0, pos.y);
+    let B = curl(pos.x, pos.y - 1.0);
+    let T = curl(pos.x, pos.y + 1.0);
+
+    var force = 0.5 * vec2<f32>(abs(T) - abs(B), abs(R) - abs(L));
+    force = force * inverseSqrt(max(2.4414e-4, dot(force, force)));
+    force = force * uGrid.dx * uVorticity * uDt * C * vec2<f32>(1.0, -1.0);
+
+    x_out[index] = x_vel[index] + force.x;
+    y_out[index] = y_vel[index] + force.y;
+    vorticity[index] = C;
+  }
+);
+// clang-format on
+
+static void init_advect_boundary_program(program_t* this,
+                                         wgpu_context_t* wgpu_context)
+{
+  dynamic_buffer_t* program_buffers[2] = {
+    &dynamic_buffers.velocity0, /* in_velocity */
+    &dynamic_buffers.velocity,  /* out_velocity */
+  };
+  uniform_t* program_uniforms[3] = {
+    &uniforms.grid,          /* */
+    &uniforms.dt,            /* */
+    &uniforms.contain_fluid, /* */
+  };
+  program_init_shader(this, wgpu_context, program_buffers,
+                      (uint32_t)ARRAY_SIZE(program_buffers), true,
+                      program_uniforms, (uint32_t)ARRAY_SIZE(program_uniforms),
+                      &(wgpu_shader_desc_t){
+                        /* Compute shader WGSL */
+                        .wgsl_code.source = advect_boundary_shader_wgsl,
+                        .entry            = "main",
+                      },
+                      settings.grid_w, settings.grid_h);
+}
+
+static void init_fused_divergence_program(program_t* this,
+                                          wgpu_context_t* wgpu_context)
+{
+  dynamic_buffer_t* program_buffers[2] = {
+    &dynamic_buffers.velocity,    /* in_velocity */
+    &dynamic_buffers.divergence0, /* out_divergence */
+  };
+  uniform_t* program_uniforms[1] = {
+    &uniforms.grid, /* */
+  };
+  const char* shader_wgsl_path = "divergence_shader.wgsl";
+  program_init(this, wgpu_context, program_buffers,
+               (uint32_t)ARRAY_SIZE(program_buffers), program_uniforms,
+               (uint32_t)ARRAY_SIZE(program_uniforms), shader_wgsl_path,
+               settings.grid_w, settings.grid_h);
+}
+
+static void init_fused_gradient_subtract_program(program_t* this,
+                                                 wgpu_context_t* wgpu_context)
+{
+  dynamic_buffer_t* program_buffers[3] = {
+    &dynamic_buffers.pressure,  /* in_pressure */
+    &dynamic_buffers.velocity,  /* in_velocity */
+    &dynamic_buffers.velocity0, /* out_velocity */
+  };
+  uniform_t* program_uniforms[1] = {
+    &uniforms.grid, /* */
+  };
+  const char* shader_wgsl_path = "gradient_subtract_shader.wgsl";
+  program_init(this, wgpu_context, program_buffers,
+               (uint32_t)ARRAY_SIZE(program_buffers), program_uniforms,
+               (uint32_t)ARRAY_SIZE(program_uniforms), shader_wgsl_path,
+               settings.grid_w, settings.grid_h);
+}
+
+static void init_fused_vorticity_program(program_t* this,
+                                         wgpu_context_t* wgpu_context)
+{
+  dynamic_buffer_t* program_buffers[3] = {
+    &dynamic_buffers.velocity0, /* in_velocity */
+    &dynamic_buffers.velocity,  /* out_velocity */
+    &dynamic_buffers.vorticity, /* out_vorticity */
+  };
+  uniform_t* program_uniforms[3] = {
+    &uniforms.grid,        /* */
+    &uniforms.dt,          /* */
+    &uniforms.u_vorticity, /* */
+  };
+  program_init_shader(
+    this, wgpu_context, program_buffers, (uint32_t)ARRAY_SIZE(program_buffers),
+    true, program_uniforms, (uint32_t)ARRAY_SIZE(program_uniforms),
+    &(wgpu_shader_desc_t){
+      /* Compute shader WGSL */
+      .wgsl_code.source = vorticity_confinment_fused_shader_wgsl,
+      .entry            = "main",
+    },
+    settings.grid_w, settings.grid_h);
+}
+
 /* Init programs */
 static void programs_init(wgpu_context_t* wgpu_context)
 {
@@ -773,11 +1188,25 @@ static void programs_init(wgpu_context_t* wgpu_context)
   init_gradient_subtract_program(&programs.gradient_subtract_program,
                                  wgpu_context);
   init_pressure_program(&programs.pressure_program, wgpu_context);
+  init_pressure_sor_program(&programs.pressure_red_program, wgpu_context,
+                            "red");
+  init_pressure_sor_program(&programs.pressure_black_program, wgpu_context,
+                            "black");
+  init_pressure_residual_program(&programs.pressure_residual_program,
+                                 wgpu_context);
   init_update_dye_program(&programs.update_dye_program, wgpu_context);
   init_update_program(&programs.update_program, wgpu_context);
   init_vorticity_confinment_program(&programs.vorticity_confinment_program,
                                     wgpu_context);
   init_vorticity_program(&programs.vorticity_program, wgpu_context);
+  init_advect_boundary_program(&programs.fused.advect_boundary_program,
+                               wgpu_context);
+  init_fused_divergence_program(&programs.fused.divergence_program,
+                                wgpu_context);
+  init_fused_gradient_subtract_program(
+    &programs.fused.gradient_subtract_program, wgpu_context);
+  init_fused_vorticity_program(&programs.fused.vorticity_confinment_program,
+                               wgpu_context);
 }
 
 static void programs_destroy()
@@ -792,10 +1221,17 @@ static void programs_destroy()
   program_destroy(&programs.divergence_program);
   program_destroy(&programs.gradient_subtract_program);
   program_destroy(&programs.pressure_program);
+  program_destroy(&programs.pressure_red_program);
+  program_destroy(&programs.pressure_black_program);
+  program_destroy(&programs.pressure_residual_program);
   program_destroy(&programs.update_dye_program);
   program_destroy(&programs.update_program);
   program_destroy(&programs.vorticity_confinment_program);
   program_destroy(&programs.vorticity_program);
+  program_destroy(&programs.fused.advect_boundary_program);
+  program_destroy(&programs.fused.divergence_program);
+  program_destroy(&programs.fused.gradient_subtract_program);
+  program_destroy(&programs.fused.vorticity_confinment_program);
 }
 
 /* -------------------------------------------------------------------------- *
@@ -856,13 +1292,9 @@ static WGPUExtent3D get_preferred_dimensions(uint32_t size,
  */
 static void init_sizes(wgpu_context_t* wgpu_context)
 {
-  uint64_t max_buffer_size          = 0;
-  uint64_t max_canvas_size          = 0;
-  WGPUSupportedLimits device_limits = {0};
-  if (wgpuAdapterGetLimits(wgpu_context->adapter, &device_limits)) {
-    max_buffer_size = device_limits.limits.maxStorageBufferBindingSize;
-    max_canvas_size = device_limits.limits.maxTextureDimension2D;
-  }
+  const WGPULimits* device_limits = &wgpu_context->limits.limits;
+  uint64_t max_buffer_size         = device_limits->maxStorageBufferBindingSize;
+  uint64_t max_canvas_size         = device_limits->maxTextureDimension2D;
 
   /* Calculate simulation buffer dimensions */
   WGPUExtent3D grid_size = get_preferred_dimensions(
@@ -1199,6 +1631,56 @@ static void simulation_reset()
   simulation.loop = 0;
 }
 
+/* Readback of the pressure residual, the values lag a few frames behind */
+static struct {
+  bool measured;           /* residual measured in the current frame */
+  bool pending;            /* readback requested and not delivered yet */
+  float relative_residual; /* max residual / max right-hand side */
+} pressure_residual = {0};
+
+static void pressure_residual_init(void)
+{
+  /* Readbacks of a previous run are dropped by the context reset */
+  memset(&pressure_residual, 0, sizeof(pressure_residual));
+}
+
+static void pressure_residual_readback_cb(const void* data, uint64_t size,
+                                          void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  if (data != NULL && size >= 2 * sizeof(float)) {
+    float const* values = (float const*)data;
+    pressure_residual.relative_residual
+      = (values[1] > 0.0f) ? values[0] / values[1] : 0.0f;
+  }
+  pressure_residual.pending = false;
+}
+
+/* Clears the maxima if the residual is measured in this frame */
+static void pressure_residual_prepare(wgpu_context_t* wgpu_context)
+{
+  pressure_residual.measured = !pressure_residual.pending;
+  if (pressure_residual.measured) {
+    static const uint32_t zeros[2] = {0, 0};
+    wgpu_queue_write_buffer(wgpu_context,
+                            dynamic_buffers.pressure_residual.buffers[0].buffer,
+                            0, zeros, sizeof(zeros));
+  }
+}
+
+/* Reads back the values of the submitted frame */
+static void pressure_residual_request_readback(wgpu_context_t* wgpu_context)
+{
+  if (pressure_residual.measured) {
+    pressure_residual.measured = false;
+    pressure_residual.pending  = wgpu_buffer_read_async(
+      wgpu_context, dynamic_buffers.pressure_residual.buffers[0].buffer, 0,
+      dynamic_buffers.pressure_residual.buffer_size,
+      pressure_residual_readback_cb, NULL);
+  }
+}
+
 /* Fluid simulation step */
 static void
 simulation_dispatch_compute_pipeline(WGPUComputePassEncoder pass_encoder)
@@ -1208,27 +1690,57 @@ simulation_dispatch_compute_pipeline(WGPUComputePassEncoder pass_encoder)
   program_dispatch(&programs.update_program, pass_encoder);
 
   /* Advect the velocity field through itself */
-  program_dispatch(&programs.advect_program, pass_encoder);
-  program_dispatch(&programs.boundary_program, pass_encoder);
+  if (settings.fuse_kernels) {
+    program_dispatch(&programs.fused.advect_boundary_program, pass_encoder);
+  }
+  else {
+    program_dispatch(&programs.advect_program, pass_encoder);
+    program_dispatch(&programs.boundary_program, pass_encoder);
+  }
 
   /* Compute the divergence */
-  program_dispatch(&programs.divergence_program, pass_encoder);
+  program_dispatch(settings.fuse_kernels ? &programs.fused.divergence_program :
+                                           &programs.divergence_program,
+                   pass_encoder);
   program_dispatch(&programs.boundary_div_program, pass_encoder);
 
-  /* Solve the jacobi-pressure equation */
-  for (uint32_t i = 0; i < settings.pressure_iterations; ++i) {
-    program_dispatch(&programs.pressure_program, pass_encoder);
-    /* boundary conditions */
-    program_dispatch(&programs.boundary_pressure_program, pass_encoder);
+  /* Solve the pressure equation */
+  if (settings.pressure_solver == PRESSURE_SOLVER_RED_BLACK_SOR) {
+    for (uint32_t i = 0; i < settings.pressure_iterations; ++i) {
+      program_dispatch(&programs.pressure_red_program, pass_encoder);
+      program_dispatch(&programs.pressure_black_program, pass_encoder);
+    }
+  }
+  else {
+    for (uint32_t i = 0; i < settings.pressure_iterations; ++i) {
+      program_dispatch(&programs.pressure_program, pass_encoder);
+      /* boundary conditions */
+      program_dispatch(&programs.boundary_pressure_program, pass_encoder);
+    }
+  }
+
+  /* Measure the convergence while no readback is in flight */
+  if (pressure_residual.measured) {
+    program_dispatch(&programs.pressure_residual_program, pass_encoder);
   }
 
   /* Subtract the pressure from the velocity field */
-  program_dispatch(&programs.gradient_subtract_program, pass_encoder);
+  program_dispatch(settings.fuse_kernels ?
+                     &programs.fused.gradient_subtract_program :
+                     &programs.gradient_subtract_program,
+                   pass_encoder);
   program_dispatch(&programs.clear_pressure_program, pass_encoder);
 
-  /* Compute & apply vorticity confinment */
-  program_dispatch(&programs.vorticity_program, pass_encoder);
-  program_dispatch(&programs.vorticity_confinment_program, pass_encoder);
+  /* Compute & apply vorticity confinment, the fused kernel leaves the final
+   * velocity in the velocity buffer */
+  if (settings.fuse_kernels) {
+    program_dispatch(&programs.fused.vorticity_confinment_program,
+                     pass_encoder);
+  }
+  else {
+    program_dispatch(&programs.vorticity_program, pass_encoder);
+    program_dispatch(&programs.vorticity_confinment_program, pass_encoder);
+  }
 
   /* Advect the dye through the velocity field */
   program_dispatch(&programs.advect_dye_program, pass_encoder);
@@ -1240,6 +1752,7 @@ static int example_initialize(wgpu_example_context_t* context)
     dynamic_buffers_init(context->wgpu_context);
     uniforms_buffers_init(context->wgpu_context);
     programs_init(context->wgpu_context);
+    pressure_residual_init();
     prepared = true;
     return 0;
   }
@@ -1250,6 +1763,26 @@ static int example_initialize(wgpu_example_context_t* context)
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
+    static const char* pressure_solvers[PRESSURE_SOLVER_COUNT] = {
+      "Jacobi",        /* PRESSURE_SOLVER_JACOBI */
+      "Red-black SOR", /* PRESSURE_SOLVER_RED_BLACK_SOR */
+    };
+    imgui_overlay_combo_box(context->imgui_overlay, "Pressure solver",
+                            &settings.pressure_solver, pressure_solvers,
+                            (uint32_t)ARRAY_SIZE(pressure_solvers));
+    int32_t pressure_iterations = (int32_t)settings.pressure_iterations;
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Pressure iterations",
+                                 &pressure_iterations, 1, 200)) {
+      settings.pressure_iterations = (uint32_t)pressure_iterations;
+    }
+    if (settings.pressure_solver == PRESSURE_SOLVER_RED_BLACK_SOR) {
+      imgui_overlay_slider_float(context->imgui_overlay, "SOR omega",
+                                 &settings.pressure_omega, 1.0f, 1.99f);
+    }
+    imgui_overlay_text("Relative residual: %.2e",
+                       pressure_residual.relative_residual);
+    imgui_overlay_checkBox(context->imgui_overlay, "Fused kernels",
+                           &settings.fuse_kernels);
   }
 }
 
@@ -1268,6 +1801,8 @@ build_simulation_step_command_buffer(wgpu_example_context_t* context)
   simulation.last_frame = now;
 
   /* Update uniforms */
+  uniforms.pressure_omega.values[0] = settings.pressure_omega;
+  pressure_residual_prepare(wgpu_context);
   for (uint32_t i = 0; i < (uint32_t)UNIFORM_COUNT; ++i) {
     uniform_update(global_uniforms[i], wgpu_context, NULL, 0);
   }
@@ -1295,8 +1830,10 @@ build_simulation_step_command_buffer(wgpu_example_context_t* context)
     WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
   }
 
-  dynamic_buffer_copy_to(&dynamic_buffers.velocity0, &dynamic_buffers.velocity,
-                         wgpu_context->cmd_enc);
+  if (!settings.fuse_kernels) {
+    dynamic_buffer_copy_to(&dynamic_buffers.velocity0,
+                           &dynamic_buffers.velocity, wgpu_context->cmd_enc);
+  }
   dynamic_buffer_copy_to(&dynamic_buffers.pressure0, &dynamic_buffers.pressure,
                          wgpu_context->cmd_enc);
 
@@ -1350,6 +1887,7 @@ static int example_draw(wgpu_example_context_t* context)
 
   // Submit to queue
   submit_command_buffers(context);
+  pressure_residual_request_readback(wgpu_context);
 
   // Send commands to the GPU
   submit_frame(context);
@@ -1367,6 +1905,7 @@ static int example_render(wgpu_example_context_t* context)
 
 static void example_destroy(wgpu_example_context_t* context)
 {
+  UNUSED_VAR(context);
 }
 
 void example_fluid_simulation(int argc, char* argv[])
@@ -15,6 +15,13 @@
  * WebGPU interpretation of glxgears. Procedurally generates and animates
  * multiple gears.
  *
+ * The geometry of a gear profile is generated once into a shared mesh pool,
+ * gears with the same profile share the mesh. The gears are drawn instanced,
+ * one draw per gear definition, from a per-instance buffer with the position,
+ * rotation and color of every gear, the vertex shader animates the rotation.
+ * The gear train can be replicated on a grid to thousands of gears as a vertex
+ * throughput stress test.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/gears
  *
@@ -26,83 +33,59 @@
  * -------------------------------------------------------------------------- */
 
 /* -------------------------------------------------------------------------- *
- * WebGPU Gear class definition
+ * WebGPU Gear mesh pool
  * -------------------------------------------------------------------------- */
 
 typedef struct vertex_t {
   vec3 pos;
   vec3 normal;
-  vec3 color;
 } vertex_t;
 
-static void initialize_vertex(vertex_t* v, vec3 p, vec3 n, vec3 c)
+static void initialize_vertex(vertex_t* v, vec3 p, vec3 n)
 {
   v->pos[0]    = p[0];
   v->pos[1]    = p[1];
   v->pos[2]    = p[2];
-  v->color[0]  = c[0];
-  v->color[1]  = c[1];
-  v->color[2]  = c[2];
   v->normal[0] = n[0];
   v->normal[1] = n[1];
   v->normal[2] = n[2];
 }
 
+// Gear profile, the parameters of the generated geometry
 typedef struct gear_info_t {
   float inner_radius;
   float outer_radius;
   float width;
   int num_teeth;
   float tooth_depth;
-  vec3 color;
-  vec3 pos;
-  float rot_speed;
-  float rot_offset;
 } gear_info_t;
 
-typedef struct gear_ubo_t {
-  mat4 projection;
-  mat4 model;
-  mat4 normal;
-  mat4 view;
-  vec3 light_pos;
-} gear_ubo_t;
-
-typedef struct webgpu_gear_t {
-  // Reference to the WebGPU context
-  wgpu_context_t* wgpu_context;
-  // WGPU bind group
-  WGPUBindGroup bind_group;
-  // Vertex buffer
-  struct {
-    wgpu_buffer_t buffer;
-    vertex_t* data;
-  } vbo;
-  // Index buffer
-  struct {
-    wgpu_buffer_t buffer;
-    uint32_t* data;
-  } ibo;
-  // Uniform buffer
-  struct {
-    wgpu_buffer_t buffer;
-    gear_ubo_t data;
-  } ubo;
-  vec3 color;
-  vec3 pos;
-  float rot_speed;
-  float rot_offset;
-} webgpu_gear_t;
-
-static void webgpu_gear_prepare_uniform_buffer(webgpu_gear_t* gear);
+// Mesh of a gear profile in the shared vertex and index buffers
+typedef struct gear_mesh_t {
+  gear_info_t info;
+  uint32_t first_index;
+  uint32_t index_count;
+  int32_t base_vertex;
+} gear_mesh_t;
+
+#define GEAR_MESH_POOL_SIZE 8u
+
+static struct {
+  gear_mesh_t meshes[GEAR_MESH_POOL_SIZE];
+  uint32_t mesh_count;
+  vertex_t* vertices;
+  uint32_t vertex_count;
+  uint32_t* indices;
+  uint32_t index_count;
+  wgpu_buffer_t vertex_buffer;
+  wgpu_buffer_t index_buffer;
+} mesh_pool = {0};
 
 int32_t webgpu_gear_new_vertex(vertex_t* vertex_buffer, int32_t* vertex_counter,
-                               float x, float y, float z, vec3 normal,
-                               vec3 color)
+                               float x, float y, float z, vec3 normal)
 {
   vertex_buffer[*vertex_counter] = (vertex_t){0};
-  initialize_vertex(&vertex_buffer[*vertex_counter], (vec3){x, y, z}, normal,
-                    color);
+  initialize_vertex(&vertex_buffer[*vertex_counter], (vec3){x, y, z}, normal);
   ++(*vertex_counter);
   return (*vertex_counter) - 1;
 }
@@ -115,64 +98,36 @@ void webgpu_gear_new_face(uint32_t* index_buffer, int32_t* index_counter, int a,
   index_buffer[(*index_counter)++] = c;
 }
 
-static webgpu_gear_t* webgpu_gear_create(wgpu_context_t* wgpu_context)
+// Vertices of a gear profile
+static uint32_t webgpu_gear_vertex_count(const gear_info_t* gearinfo)
 {
-  webgpu_gear_t* gear = (webgpu_gear_t*)malloc(sizeof(webgpu_gear_t));
-  gear->wgpu_context  = wgpu_context;
-  gear->vbo.data      = NULL;
-  gear->ibo.data      = NULL;
-
-  return gear;
+  return (6         // /* front face */
+          + 4       // /* front sides of teeth */
+          + 6       // /* back face */
+          + 4       // /* back sides of teeth */
+          + (4 * 5) // /* draw outward faces of teeth */
+          )
+         * gearinfo->num_teeth;
 }
 
-static void webgpu_gear_destroy(webgpu_gear_t* gear)
+// Indices of a gear profile
+static uint32_t webgpu_gear_index_count(const gear_info_t* gearinfo)
 {
-  // Clean up WebGPU resources
-  WGPU_RELEASE_RESOURCE(Buffer, gear->ubo.buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, gear->vbo.buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, gear->ibo.buffer.buffer)
-  WGPU_RELEASE_RESOURCE(BindGroup, gear->bind_group)
-  if (gear->vbo.data) {
-    free(gear->vbo.data);
-  }
-  if (gear->ibo.data) {
-    free(gear->ibo.data);
-  }
-  free(gear);
+  return (4         // /* front face */
+          + 2       // /* front sides of teeth */
+          + 4       // /* back face */
+          + 2       // /* back sides of teeth */
+          + (2 * 5) // /* draw outward faces of teeth */
+          )
+         * 3 * gearinfo->num_teeth;
 }
 
-static void webgpu_gear_generate(webgpu_gear_t* gear, gear_info_t* gearinfo)
+// Generates the geometry of a gear profile, the indices start at vertex 0
+static void webgpu_gear_generate(vertex_t* vbd, uint32_t* ibd,
+                                 const gear_info_t* gearinfo)
 {
-  glm_vec3_copy(gearinfo->color, gear->color);
-  glm_vec3_copy(gearinfo->pos, gear->pos);
-  gear->rot_offset = gearinfo->rot_offset;
-  gear->rot_speed  = gearinfo->rot_speed;
-
-  /* Vertex buffer */
-  gear->vbo.buffer.count = (6         // /* front face */
-                            + 4       // /* front sides of teeth */
-                            + 6       // /* back face */
-                            + 4       // /* back sides of teeth */
-                            + (4 * 5) // /* draw outward faces of teeth */
-                            )
-                           * gearinfo->num_teeth;
-  gear->vbo.buffer.size  = gear->vbo.buffer.count * sizeof(vertex_t);
-  gear->vbo.data         = (vertex_t*)malloc(gear->vbo.buffer.size);
-  vertex_t* vbd          = gear->vbo.data; // alias
   int32_t vertex_counter = 0;
-
-  /* Index buffer */
-  gear->ibo.buffer.count = (4         // /* front face */
-                            + 2       // /* front sides of teeth */
-                            + 4       // /* back face */
-                            + 2       // /* back sides of teeth */
-                            + (2 * 5) // /* draw outward faces of teeth */
-                            )
-                           * 3 * gearinfo->num_teeth;
-  gear->ibo.buffer.size = gear->ibo.buffer.count * sizeof(uint32_t);
-  gear->ibo.data        = (uint32_t*)malloc(gear->ibo.buffer.size);
-  uint32_t* ibd         = gear->ibo.data; // alias
-  int32_t index_counter = 0;
+  int32_t index_counter  = 0;
 
   int i;
   float r0, r1, r2;
@@ -214,20 +169,20 @@ static void webgpu_gear_generate(webgpu_gear_t* gear, gear_info_t* gearinfo)
     // front face
     glm_vec3_copy((vec3){0.0f, 0.0f, 1.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta, r0 * sin_ta,
-                                 gearinfo->width * 0.5f, normal, gear->color);
+                                 gearinfo->width * 0.5f, normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 gearinfo->width * 0.5f, normal, gear->color);
+                                 gearinfo->width * 0.5f, normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta, r0 * sin_ta,
-                                 gearinfo->width * 0.5f, normal, gear->color);
+                                 gearinfo->width * 0.5f, normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix4 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta_4da,
                                  r0 * sin_ta_4da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix5 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_4da,
                                  r1 * sin_ta_4da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix2, ix3, ix4);
@@ -236,36 +191,36 @@ static void webgpu_gear_generate(webgpu_gear_t* gear, gear_info_t* gearinfo)
     // front sides of teeth
     glm_vec3_copy((vec3){0.0f, 0.0f, 1.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 gearinfo->width * 0.5f, normal, gear->color);
+                                 gearinfo->width * 0.5f, normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     // back face
     glm_vec3_copy((vec3){0.0f, 0.0f, -1.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 -gearinfo->width * 0.5f, normal, gear->color);
+                                 -gearinfo->width * 0.5f, normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta, r0 * sin_ta,
-                                 -gearinfo->width * 0.5f, normal, gear->color);
+                                 -gearinfo->width * 0.5f, normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta, r0 * sin_ta,
-                                 -gearinfo->width * 0.5f, normal, gear->color);
+                                 -gearinfo->width * 0.5f, normal);
     ix4 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_4da,
                                  r1 * sin_ta_4da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix5 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta_4da,
                                  r0 * sin_ta_4da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix2, ix3, ix4);
@@ -275,188 +230,167 @@ static void webgpu_gear_generate(webgpu_gear_t* gear, gear_info_t* gearinfo)
     glm_vec3_copy((vec3){0.0f, 0.0f, -1.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 -gearinfo->width * 0.5f, normal, gear->color);
+                                 -gearinfo->width * 0.5f, normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     // draw outward faces of teeth
     glm_vec3_copy((vec3){v1, -u1, 0.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 gearinfo->width * 0.5f, normal, gear->color);
+                                 gearinfo->width * 0.5f, normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta, r1 * sin_ta,
-                                 -gearinfo->width * 0.5f, normal, gear->color);
+                                 -gearinfo->width * 0.5f, normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     glm_vec3_copy((vec3){cos_ta, sin_ta, 0.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_1da,
                                  r2 * sin_ta_1da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     glm_vec3_copy((vec3){v2, -u2, 0.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r2 * cos_ta_2da,
                                  r2 * sin_ta_2da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     glm_vec3_copy((vec3){cos_ta, sin_ta, 0.0f}, normal);
     ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_3da,
                                  r1 * sin_ta_3da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix2 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_4da,
                                  r1 * sin_ta_4da, gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     ix3 = webgpu_gear_new_vertex(vbd, &vertex_counter, r1 * cos_ta_4da,
                                  r1 * sin_ta_4da, -gearinfo->width * 0.5f,
-                                 normal, gear->color);
+                                 normal);
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
 
     // draw inside radius cylinder
-    ix0 = webgpu_gear_new_vertex(gear->vbo.data, &vertex_counter, r0 * cos_ta,
+    ix0 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta,
                                  r0 * sin_ta, -gearinfo->width * 0.5f,
-                                 (vec3){-cos_ta, -sin_ta, 0.0f}, gear->color);
-    ix1 = webgpu_gear_new_vertex(gear->vbo.data, &vertex_counter, r0 * cos_ta,
+                                 (vec3){-cos_ta, -sin_ta, 0.0f});
+    ix1 = webgpu_gear_new_vertex(vbd, &vertex_counter, r0 * cos_ta,
                                  r0 * sin_ta, gearinfo->width * 0.5f,
-                                 (vec3){-cos_ta, -sin_ta, 0.0f}, gear->color);
+                                 (vec3){-cos_ta, -sin_ta, 0.0f});
     ix2 = webgpu_gear_new_vertex(
-      gear->vbo.data, &vertex_counter, r0 * cos_ta_4da, r0 * sin_ta_4da,
-      -gearinfo->width * 0.5f, (vec3){-cos_ta_4da, -sin_ta_4da, 0.0f},
-      gear->color);
+      vbd, &vertex_counter, r0 * cos_ta_4da, r0 * sin_ta_4da,
+      -gearinfo->width * 0.5f, (vec3){-cos_ta_4da, -sin_ta_4da, 0.0f});
     ix3 = webgpu_gear_new_vertex(
-      gear->vbo.data, &vertex_counter, r0 * cos_ta_4da, r0 * sin_ta_4da,
-      gearinfo->width * 0.5f, (vec3){-cos_ta_4da, -sin_ta_4da, 0.0f},
-      gear->color);
+      vbd, &vertex_counter, r0 * cos_ta_4da, r0 * sin_ta_4da,
+      gearinfo->width * 0.5f, (vec3){-cos_ta_4da, -sin_ta_4da, 0.0f});
     webgpu_gear_new_face(ibd, &index_counter, ix0, ix1, ix2);
     webgpu_gear_new_face(ibd, &index_counter, ix1, ix3, ix2);
   }
 
-  // Vertex buffer
-  gear->vbo.buffer = wgpu_create_buffer(
-    gear->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage        = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-      .size         = gear->vbo.buffer.size,
-      .count        = gear->vbo.buffer.count,
-      .initial.data = gear->vbo.data,
-    });
-
-  // Index buffer
-  gear->ibo.buffer
-    = wgpu_create_buffer(gear->wgpu_context, &(wgpu_buffer_desc_t){
-                                               .usage = WGPUBufferUsage_CopyDst
-                                                        | WGPUBufferUsage_Index,
-                                               .size  = gear->ibo.buffer.size,
-                                               .count = gear->ibo.buffer.count,
-                                               .initial.data = gear->ibo.data,
-                                             });
-
-  // Uniform buffer
-  webgpu_gear_prepare_uniform_buffer(gear);
+  ASSERT(vertex_counter == (int32_t)webgpu_gear_vertex_count(gearinfo));
+  ASSERT(index_counter == (int32_t)webgpu_gear_index_count(gearinfo));
 }
 
-static void webgpu_gear_draw(webgpu_gear_t* gear)
+static bool gear_info_equal(const gear_info_t* a, const gear_info_t* b)
 {
-  WGPURenderPassEncoder rpass = gear->wgpu_context->rpass_enc;
-
-  wgpuRenderPassEncoderSetBindGroup(rpass, 0, gear->bind_group, 0, 0);
-  wgpuRenderPassEncoderSetVertexBuffer(rpass, 0, gear->vbo.buffer.buffer, 0,
-                                       WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetIndexBuffer(
-    rpass, gear->ibo.buffer.buffer, WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderDrawIndexed(rpass, gear->ibo.buffer.count, 1, 0, 0, 1);
+  return a->inner_radius == b->inner_radius
+         && a->outer_radius == b->outer_radius && a->width == b->width
+         && a->num_teeth == b->num_teeth && a->tooth_depth == b->tooth_depth;
 }
 
-static void webgpu_gear_update_uniform_buffer(webgpu_gear_t* gear,
-                                              mat4 perspective, mat4 view,
-                                              float timer)
+// Returns the mesh of the gear profile, generated on the first request
+static const gear_mesh_t* gear_mesh_pool_get(const gear_info_t* gearinfo)
 {
-  gear_ubo_t* ubo = &gear->ubo.data;
-  glm_mat4_copy(perspective, ubo->projection);
-  glm_mat4_copy(view, ubo->view);
-  glm_mat4_copy(GLM_MAT4_IDENTITY, ubo->model);
-  glm_translate(ubo->model, gear->pos);
-  glm_rotate(ubo->model, glm_rad((gear->rot_speed * timer) + gear->rot_offset),
-             (vec3){0.0f, 0.0f, 1.0f});
-  mat4 mul_mat = GLM_MAT4_ZERO_INIT;
-  glm_mat4_mul(ubo->view, ubo->model, mul_mat);
-  glm_mat4_inv(mul_mat, mul_mat);
-  glm_mat4_transpose_to(mul_mat, ubo->normal);
-  glm_vec3_copy((vec3){0.0f, 0.0f, 2.5f}, ubo->light_pos);
-  ubo->light_pos[0] = sin(glm_rad(timer)) * 8.0f;
-  ubo->light_pos[2] = cos(glm_rad(timer)) * 8.0f;
-
-  wgpu_queue_write_buffer(gear->wgpu_context, gear->ubo.buffer.buffer, 0, ubo,
-                          gear->ubo.buffer.size);
+  for (uint32_t i = 0; i < mesh_pool.mesh_count; ++i) {
+    if (gear_info_equal(&mesh_pool.meshes[i].info, gearinfo)) {
+      return &mesh_pool.meshes[i];
+    }
+  }
+
+  ASSERT(mesh_pool.mesh_count < GEAR_MESH_POOL_SIZE);
+  ASSERT(mesh_pool.vertex_buffer.buffer == NULL);
+  gear_mesh_t* mesh = &mesh_pool.meshes[mesh_pool.mesh_count++];
+  mesh->info        = *gearinfo;
+  mesh->first_index = mesh_pool.index_count;
+  mesh->index_count = webgpu_gear_index_count(gearinfo);
+  mesh->base_vertex = (int32_t)mesh_pool.vertex_count;
+
+  const uint32_t vertex_count = webgpu_gear_vertex_count(gearinfo);
+  mesh_pool.vertices          = (vertex_t*)realloc(
+    mesh_pool.vertices,
+    (mesh_pool.vertex_count + vertex_count) * sizeof(vertex_t));
+  mesh_pool.indices = (uint32_t*)realloc(
+    mesh_pool.indices,
+    (mesh_pool.index_count + mesh->index_count) * sizeof(uint32_t));
+  webgpu_gear_generate(mesh_pool.vertices + mesh_pool.vertex_count,
+                       mesh_pool.indices + mesh_pool.index_count, gearinfo);
+  mesh_pool.vertex_count += vertex_count;
+  mesh_pool.index_count += mesh->index_count;
+
+  return mesh;
 }
 
-static void webgpu_gear_setup_bind_group(webgpu_gear_t* gear,
-                                         WGPUBindGroupLayout bind_group_layout)
+// Uploads the generated meshes into the shared buffers
+static void gear_mesh_pool_upload(wgpu_context_t* wgpu_context)
 {
-  WGPUBindGroupDescriptor bg_desc = {
-    .layout     = bind_group_layout,
-    .entryCount = 1,
-    .entries    = &(WGPUBindGroupEntry) {
-      // Binding 0 : Vertex shader uniform buffer
-      .binding = 0,
-      .buffer  = gear->ubo.buffer.buffer,
-      .offset  = 0,
-      .size    = gear->ubo.buffer.size,
-    },
-  };
-
-  gear->bind_group
-    = wgpuDeviceCreateBindGroup(gear->wgpu_context->device, &bg_desc);
-  ASSERT(gear->bind_group != NULL);
+  mesh_pool.vertex_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+                    .size  = mesh_pool.vertex_count * sizeof(vertex_t),
+                    .count = mesh_pool.vertex_count,
+                    .initial.data = mesh_pool.vertices,
+                  });
+  mesh_pool.index_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
+                    .size  = mesh_pool.index_count * sizeof(uint32_t),
+                    .count = mesh_pool.index_count,
+                    .initial.data = mesh_pool.indices,
+                  });
 }
 
-static void webgpu_gear_prepare_uniform_buffer(webgpu_gear_t* gear)
+static void gear_mesh_pool_destroy(void)
 {
-  memset(&gear->ubo.data, 0, sizeof(gear_ubo_t));
-  gear->ubo.buffer = wgpu_create_buffer(
-    gear->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(gear_ubo_t),
-    });
+  WGPU_RELEASE_RESOURCE(Buffer, mesh_pool.vertex_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, mesh_pool.index_buffer.buffer)
+  free(mesh_pool.vertices);
+  free(mesh_pool.indices);
+  memset(&mesh_pool, 0, sizeof(mesh_pool));
 }
 
 /* -------------------------------------------------------------------------- *
@@ -511,34 +445,100 @@ static webgpu_gear_definition_t gear_defs[3] = {
     .rotation_offset = -30.0f,
   },
 };
-static webgpu_gear_t* wgpu_gears[3];
-static const uint32_t wgpu_gears_count = (uint32_t)ARRAY_SIZE(wgpu_gears);
+static const gear_mesh_t* gear_meshes[3];
+static const uint32_t gear_defs_count = (uint32_t)ARRAY_SIZE(gear_defs);
 
-static void prepare_vertices(wgpu_context_t* wgpu_context)
+// Per-instance data, matches Instance in WGSL
+typedef struct gear_instance_t {
+  vec3 pos;
+  float rot_speed;
+  vec3 color;
+  float rot_offset;
+} gear_instance_t;
+
+// Gear trains of the scene, replicated on a square grid
+static const uint32_t gear_train_counts[5] = {1, 16, 256, 1024, 4096};
+static const char* gear_count_names[5] = {"3", "48", "768", "3072", "12288"};
+// Distance of the gear trains on the grid
+static const float gear_train_spacing = 14.0f;
+
+static struct {
+  wgpu_buffer_t buffer;
+  uint32_t train_count;
+} instances = {0};
+
+static struct {
+  int32_t gear_count_index;
+} settings = {0};
+
+static void prepare_meshes(wgpu_context_t* wgpu_context)
 {
-  for (uint32_t i = 0; i < wgpu_gears_count; ++i) {
-    const float* gear_color    = gear_defs[i].color;
-    const float* gear_position = gear_defs[i].position;
-    gear_info_t gear_info      = {
-           .inner_radius = gear_defs[i].inner_radius,
-           .outer_radius = gear_defs[i].outer_radius,
-           .width        = gear_defs[i].width,
-           .num_teeth    = gear_defs[i].tooth_count,
-           .tooth_depth  = gear_defs[i].tooth_depth,
-           .color        = {gear_color[0], gear_color[1], gear_color[2]},
-           .pos          = {gear_position[0], gear_position[1], gear_position[2]},
-           .rot_speed    = gear_defs[i].rotation_speed,
-           .rot_offset   = gear_defs[i].rotation_offset,
+  for (uint32_t i = 0; i < gear_defs_count; ++i) {
+    gear_info_t gear_info = {
+      .inner_radius = gear_defs[i].inner_radius,
+      .outer_radius = gear_defs[i].outer_radius,
+      .width        = gear_defs[i].width,
+      .num_teeth    = gear_defs[i].tooth_count,
+      .tooth_depth  = gear_defs[i].tooth_depth,
     };
-    wgpu_gears[i] = webgpu_gear_create(wgpu_context);
-    webgpu_gear_generate(wgpu_gears[i], &gear_info);
+    gear_meshes[i] = gear_mesh_pool_get(&gear_info);
   }
+  gear_mesh_pool_upload(wgpu_context);
+}
+
+// (Re)creates the instance buffer, the instances of a gear definition are
+// consecutive so that every definition is a single instanced draw
+static void prepare_instances(wgpu_context_t* wgpu_context)
+{
+  WGPU_RELEASE_RESOURCE(Buffer, instances.buffer.buffer)
+
+  const uint32_t train_count    = gear_train_counts[settings.gear_count_index];
+  const uint32_t grid_size      = (uint32_t)ceilf(sqrtf((float)train_count));
+  const uint32_t instance_count = gear_defs_count * train_count;
+  const float center            = (float)(grid_size - 1) * 0.5f;
+  gear_instance_t* data
+    = (gear_instance_t*)malloc(instance_count * sizeof(gear_instance_t));
+  for (uint32_t i = 0; i < gear_defs_count; ++i) {
+    const webgpu_gear_definition_t* def = &gear_defs[i];
+    for (uint32_t t = 0; t < train_count; ++t) {
+      const float x = ((float)(t % grid_size) - center) * gear_train_spacing;
+      const float y = ((float)(t / grid_size) - center) * gear_train_spacing;
+      data[i * train_count + t] = (gear_instance_t){
+        .pos        = {def->position[0] + x, def->position[1] + y,
+                       def->position[2]},
+        .rot_speed  = def->rotation_speed,
+        .color      = {def->color[0], def->color[1], def->color[2]},
+        .rot_offset = def->rotation_offset,
+      };
+    }
+  }
+
+  instances.buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+                    .size  = instance_count * sizeof(gear_instance_t),
+                    .count = instance_count,
+                    .initial.data = data,
+                  });
+  instances.train_count = train_count;
+  free(data);
 }
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Gears example
  * -------------------------------------------------------------------------- */
 
+// Uniform buffer block object, matches Uniforms in WGSL
+static struct {
+  mat4 projection;
+  mat4 view;
+  vec4 light_pos;
+  float time;
+  float padding[3];
+} ubo_vs = {0};
+
+static wgpu_buffer_t uniform_buffer_vs;
+
 // The pipeline layout
 static WGPUPipelineLayout pipeline_layout;
 
@@ -552,10 +552,78 @@ static WGPURenderPassDescriptor render_pass_desc;
 // The bind group layout
 static WGPUBindGroupLayout bind_group_layout;
 
+// The bind group
+static WGPUBindGroup bind_group;
+
 // Other variables
 static const char* example_title = "Gears";
 static bool prepared             = false;
 
+// Shaders
+// clang-format off
+static const char* gears_shader_wgsl = CODE(
+  struct Uniforms {
+    projection : mat4x4f,
+    view       : mat4x4f,
+    lightPos   : vec4f,
+    time       : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : Uniforms;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) normal         : vec3f,
+    @location(1) color          : vec3f,
+    @location(2) eyePos         : vec3f,
+    @location(3) lightVec       : vec3f,
+  }
+
+  @vertex
+  fn vs_main(
+    @location(0) inPos : vec3f,
+    @location(1) inNormal : vec3f,
+    // Instance: position and rotation speed, color and rotation offset
+    @location(2) instancePosSpeed : vec4f,
+    @location(3) instanceColorOffset : vec4f
+  ) -> VertexOutput {
+    // Rotation around z in degrees
+    let angle = radians(instancePosSpeed.w * ubo.time
+                        + instanceColorOffset.w);
+    let c = cos(angle);
+    let s = sin(angle);
+    let rotation = mat3x3f(vec3f(c, s, 0.0), vec3f(-s, c, 0.0),
+                           vec3f(0.0, 0.0, 1.0));
+    let worldPos = rotation * inPos + instancePosSpeed.xyz;
+    let eyePos = ubo.view * vec4f(worldPos, 1.0);
+    let lightPos = ubo.view * vec4f(ubo.lightPos.xyz, 1.0);
+
+    var output : VertexOutput;
+    // Rigid transform, the normal matrix is the rotation part
+    let view3 = mat3x3f(ubo.view[0].xyz, ubo.view[1].xyz, ubo.view[2].xyz);
+    output.normal = normalize(view3 * rotation * inNormal);
+    output.color = instanceColorOffset.rgb;
+    output.eyePos = eyePos.xyz;
+    output.lightVec = normalize(lightPos.xyz - eyePos.xyz);
+    output.position = ubo.projection * eyePos;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4f {
+    let normal = normalize(input.normal);
+    let eye = normalize(-input.eyePos);
+    let reflected = normalize(reflect(-input.lightVec, normal));
+    let ambient = vec4f(0.2, 0.2, 0.2, 1.0);
+    let diffuse = vec4f(0.5, 0.5, 0.5, 0.5)
+                  * max(dot(normal, input.lightVec), 0.0);
+    let specular = vec4f(0.5, 0.5, 0.5, 1.0)
+                   * pow(max(dot(reflected, eye), 0.0), 0.8) * 0.25;
+    return (ambient + diffuse) * vec4f(input.color, 1.0) + specular;
+  }
+);
+// clang-format on
+
 static void setup_camera(wgpu_example_context_t* context)
 {
   context->camera         = camera_create();
@@ -580,7 +648,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .buffer = (WGPUBufferBindingLayout) {
         .type = WGPUBufferBindingType_Uniform,
         .hasDynamicOffset = false,
-        .minBindingSize   = sizeof(gear_ubo_t),
+        .minBindingSize   = sizeof(ubo_vs),
       },
       .sampler = {0},
     },
@@ -600,11 +668,22 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
   ASSERT(pipeline_layout != NULL)
 }
 
-static void setup_bind_groups()
+static void setup_bind_groups(wgpu_context_t* wgpu_context)
 {
-  for (uint32_t i = 0; i < wgpu_gears_count; ++i) {
-    webgpu_gear_setup_bind_group(wgpu_gears[i], bind_group_layout);
-  }
+  WGPUBindGroupDescriptor bg_desc = {
+    .layout     = bind_group_layout,
+    .entryCount = 1,
+    .entries    = &(WGPUBindGroupEntry) {
+      // Binding 0 : Vertex shader uniform buffer
+      .binding = 0,
+      .buffer  = uniform_buffer_vs.buffer,
+      .offset  = 0,
+      .size    = uniform_buffer_vs.size,
+    },
+  };
+
+  bind_group = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
+  ASSERT(bind_group != NULL)
 }
 
 // Create the graphics pipeline
@@ -632,37 +711,73 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
       .depth_write_enabled = true,
     });
 
-  // Vertex buffer layout
-  WGPU_VERTEX_BUFFER_LAYOUT(
-    gear, sizeof(vertex_t),
-    // Attribute location 0: Position
-    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x3, offsetof(vertex_t, pos)),
-    // Attribute location 1: Normal
-    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x3,
-                       offsetof(vertex_t, normal)),
-    // Attribute location 2: Color
-    WGPU_VERTATTR_DESC(2, WGPUVertexFormat_Float32x3,
-                       offsetof(vertex_t, color)))
+  // Vertex buffer layouts
+  WGPUVertexAttribute vertex_attributes[2] = {
+    [0] = (WGPUVertexAttribute) {
+      // Attribute location 0: Position
+      .shaderLocation = 0,
+      .offset         = offsetof(vertex_t, pos),
+      .format         = WGPUVertexFormat_Float32x3,
+    },
+    [1] = (WGPUVertexAttribute) {
+      // Attribute location 1: Normal
+      .shaderLocation = 1,
+      .offset         = offsetof(vertex_t, normal),
+      .format         = WGPUVertexFormat_Float32x3,
+    },
+  };
+  WGPUVertexAttribute instance_attributes[2] = {
+    [0] = (WGPUVertexAttribute) {
+      // Attribute location 2: Position and rotation speed
+      .shaderLocation = 2,
+      .offset         = offsetof(gear_instance_t, pos),
+      .format         = WGPUVertexFormat_Float32x4,
+    },
+    [1] = (WGPUVertexAttribute) {
+      // Attribute location 3: Color and rotation offset
+      .shaderLocation = 3,
+      .offset         = offsetof(gear_instance_t, color),
+      .format         = WGPUVertexFormat_Float32x4,
+    },
+  };
+  WGPUVertexBufferLayout vertex_buffer_layouts[2] = {
+    [0] = (WGPUVertexBufferLayout) {
+      // Gear mesh
+      .arrayStride    = sizeof(vertex_t),
+      .stepMode       = WGPUVertexStepMode_Vertex,
+      .attributeCount = (uint32_t)ARRAY_SIZE(vertex_attributes),
+      .attributes     = vertex_attributes,
+    },
+    [1] = (WGPUVertexBufferLayout) {
+      // Gear instances
+      .arrayStride    = sizeof(gear_instance_t),
+      .stepMode       = WGPUVertexStepMode_Instance,
+      .attributeCount = (uint32_t)ARRAY_SIZE(instance_attributes),
+      .attributes     = instance_attributes,
+    },
+  };
 
   // Vertex state
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
                 wgpu_context, &(wgpu_vertex_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
-                  // Vertex shader SPIR-V
-                  .label = "gears_vertex_shader",
-                  .file  = "shaders/gears/gears.vert.spv",
+                  // Vertex shader WGSL
+                  .label            = "gears_vertex_shader",
+                  .wgsl_code.source = gears_shader_wgsl,
+                  .entry            = "vs_main",
                 },
-                .buffer_count = 1,
-                .buffers      = &gear_vertex_buffer_layout,
+                .buffer_count = (uint32_t)ARRAY_SIZE(vertex_buffer_layouts),
+                .buffers      = vertex_buffer_layouts,
               });
 
   // Fragment state
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
                 wgpu_context, &(wgpu_fragment_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
-                  // Fragment shader SPIR-V
-                  .label = "gears_fragment_shader",
-                  .file  = "shaders/gears/gears.frag.spv",
+                  // Fragment shader WGSL
+                  .label            = "gears_fragment_shader",
+                  .wgsl_code.source = gears_shader_wgsl,
+                  .entry            = "fs_main",
                 },
                 .target_count = 1,
                 .targets      = &color_target_state,
@@ -720,22 +835,40 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
 {
-  for (uint32_t i = 0; i < wgpu_gears_count; ++i) {
-    webgpu_gear_update_uniform_buffer(
-      wgpu_gears[i], context->camera->matrices.perspective,
-      context->camera->matrices.view, context->timer * 360.0f);
-  }
+  const float timer = context->timer * 360.0f;
+  glm_mat4_copy(context->camera->matrices.perspective, ubo_vs.projection);
+  glm_mat4_copy(context->camera->matrices.view, ubo_vs.view);
+  glm_vec4_copy((vec4){sin(glm_rad(timer)) * 8.0f, 0.0f,
+                       cos(glm_rad(timer)) * 8.0f, 1.0f},
+                ubo_vs.light_pos);
+  ubo_vs.time = timer;
+
+  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffer_vs.buffer, 0,
+                          &ubo_vs, uniform_buffer_vs.size);
+}
+
+static void prepare_uniform_buffers(wgpu_example_context_t* context)
+{
+  uniform_buffer_vs = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ubo_vs),
+    });
+
+  update_uniform_buffers(context);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     setup_camera(context);
-    prepare_vertices(context->wgpu_context);
+    prepare_meshes(context->wgpu_context);
+    prepare_instances(context->wgpu_context);
+    prepare_uniform_buffers(context);
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
-    setup_bind_groups();
-    update_uniform_buffers(context);
+    setup_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -748,6 +881,21 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Gears",
+                                &settings.gear_count_index, gear_count_names,
+                                (uint32_t)ARRAY_SIZE(gear_count_names))) {
+      prepare_instances(context->wgpu_context);
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    uint64_t triangle_count = 0;
+    for (uint32_t i = 0; i < gear_defs_count; ++i) {
+      triangle_count += gear_meshes[i]->index_count / 3;
+    }
+    triangle_count *= instances.train_count;
+    imgui_overlay_text("Meshes: %u", mesh_pool.mesh_count);
+    imgui_overlay_text("Draws: %u", gear_defs_count);
+    imgui_overlay_text("Triangles: %llu", (unsigned long long)triangle_count);
   }
 }
 
@@ -762,13 +910,25 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   // Create render pass encoder for encoding drawing commands
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass_desc);
-
-  // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
-
-  // Draw gears
-  for (uint32_t i = 0; i < wgpu_gears_count; ++i) {
-    webgpu_gear_draw(wgpu_gears[i]);
+  WGPURenderPassEncoder rpass = wgpu_context->rpass_enc;
+
+  // Bind the rendering pipeline and the shared buffers
+  wgpuRenderPassEncoderSetPipeline(rpass, pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass, 0, bind_group, 0, 0);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass, 0, mesh_pool.vertex_buffer.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass, 1, instances.buffer.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(rpass, mesh_pool.index_buffer.buffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      WGPU_WHOLE_SIZE);
+
+  // Draw the instances of every gear definition
+  for (uint32_t i = 0; i < gear_defs_count; ++i) {
+    const gear_mesh_t* mesh = gear_meshes[i];
+    wgpuRenderPassEncoderDrawIndexed(
+      rpass, mesh->index_count, instances.train_count, mesh->first_index,
+      mesh->base_vertex, i * instances.train_count);
   }
 
   // End render pass
@@ -785,7 +945,6 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
   return command_buffer;
 }
-
 static int example_draw(wgpu_example_context_t* context)
 {
   // Prepare frame
@@ -824,16 +983,17 @@ static void example_on_view_changed(wgpu_example_context_t* context)
   update_uniform_buffers(context);
 }
 
+
 static void example_destroy(wgpu_example_context_t* context)
 {
   camera_release(context->camera);
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline);
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout);
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout);
-
-  for (uint32_t i = 0; i < wgpu_gears_count; ++i) {
-    webgpu_gear_destroy(wgpu_gears[i]);
-  }
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer_vs.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, instances.buffer.buffer)
+  gear_mesh_pool_destroy();
 }
 
 void example_gears(int argc, char* argv[])
@@ -4,17 +4,282 @@
 
 #include <string.h>
 
+#include "../webgpu/imgui_overlay.h"
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Gerstner Waves
  *
  * This example is a WebGPU implementation of the Gerstner Waves algorithm.
  *
+ * The waves are baked into a displacement map and a normal map by a compute
+ * pass once per frame, the plane mesh samples the maps in the vertex and
+ * fragment shaders. Two wave models are available:
+ *
+ *  * Gerstner: the sum of the Gerstner waves evaluated per texel, the maps
+ *    cover the plane
+ *  * FFT ocean: a Phillips spectrum evolved over time and transformed with an
+ *    inverse FFT (Tessendorf, "Simulating Ocean Water"), the maps tile an
+ *    ocean patch
+ *
+ * The shading cost doesn't depend on the number of waves and the mesh
+ * resolution is independent of the wave detail.
+ *
  * Ref:
  * https://github.com/artemhlezin/webgpu-gerstner-waves
  * https://en.wikipedia.org/wiki/Trochoidal_wave
  * https://www.reddit.com/r/webgpu/comments/s2elkb/webgpu_gerstner_waves_implementation
+ * https://people.computing.clemson.edu/~jtessen/reports/papers_files/coursenotes2004.pdf
  * -------------------------------------------------------------------------- */
 
+// Resolution of the baked displacement and normal maps
+#define WAVE_MAP_SIZE 256u
+
+// FFT ocean parameters
+#define OCEAN_PATCH_SIZE 32.0f          // meters covered by the spectrum
+#define OCEAN_WIND_SPEED 5.0f           // meters per second
+#define OCEAN_PHILLIPS_AMPLITUDE 0.006f // Phillips spectrum constant
+#define OCEAN_GRAVITY 9.81f
+
+// Shaders
+// clang-format off
+static const char* gerstner_bake_shader_wgsl = CODE(
+  struct OceanParams {
+    time : f32,
+    choppiness : f32,
+    texel_size : f32,
+    uv_scale : f32,
+    uv_offset : f32,
+    height_min : f32,
+    height_max : f32,
+    padding : f32,
+  }
+
+  struct GerstnerWave {
+    wave_length : f32,
+    amplitude : f32,
+    steepness : f32,
+    padding1 : f32,
+    direction : vec2<f32>,
+    padding2 : vec2<f32>,
+  }
+
+  struct GerstnerWaves {
+    waves : array<GerstnerWave, 5>,
+    amplitude_sum : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> ocean : OceanParams;
+  @group(0) @binding(1) var<uniform> gerstner : GerstnerWaves;
+  @group(0) @binding(4) var displacement_map
+    : texture_storage_2d<rgba16float, write>;
+  @group(0) @binding(5) var normal_map
+    : texture_storage_2d<rgba16float, write>;
+
+  const pi = 3.14159265;
+  const gravity = 9.81;
+  const wave_count = 5u;
+
+  @compute @workgroup_size(8, 8)
+  fn bake_gerstner(@builtin(global_invocation_id) id : vec3<u32>) {
+    let position = vec2<f32>(id.xy) * ocean.texel_size;
+    var displacement = vec3<f32>(0.0);
+    var normal = vec3<f32>(0.0, 0.0, 1.0);
+    for (var i = 0u; i < wave_count; i++) {
+      let wave = gerstner.waves[i];
+      let k = 2.0 * pi / wave.wave_length;
+      let omega = sqrt(gravity * k);
+      let q = wave.steepness / (k * wave.amplitude * f32(wave_count));
+      let theta = k * dot(wave.direction, position) - omega * ocean.time;
+      let c = cos(theta);
+      let s = sin(theta);
+      displacement += vec3<f32>(q * wave.amplitude * wave.direction * c,
+                                wave.amplitude * s);
+      normal -= vec3<f32>(wave.direction * k * wave.amplitude * c,
+                          q * k * wave.amplitude * s);
+    }
+    textureStore(displacement_map, id.xy, vec4<f32>(displacement, 1.0));
+    textureStore(normal_map, id.xy, vec4<f32>(normalize(normal), 0.0));
+  }
+);
+
+static const char* fft_ocean_shader_wgsl = CODE(
+  struct OceanParams {
+    time : f32,
+    choppiness : f32,
+    texel_size : f32,
+    uv_scale : f32,
+    uv_offset : f32,
+    height_min : f32,
+    height_max : f32,
+    padding : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> ocean : OceanParams;
+  @group(0) @binding(2) var<storage, read> initial_spectrum : array<vec4<f32>>;
+  @group(0) @binding(3) var<storage, read_write> spectrum : array<vec4<f32>>;
+  @group(0) @binding(4) var displacement_map
+    : texture_storage_2d<rgba16float, write>;
+  @group(0) @binding(5) var normal_map
+    : texture_storage_2d<rgba16float, write>;
+
+  const map_size = 256u;
+  const map_size_log2 = 8u;
+  const pi = 3.14159265;
+  const gravity = 9.81;
+
+  var<workgroup> fft_buffer : array<vec4<f32>, 512>;
+
+  fn complex_mul(a : vec2<f32>, b : vec2<f32>) -> vec2<f32> {
+    return vec2<f32>(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn evolve_spectrum(@builtin(global_invocation_id) id : vec3<u32>) {
+    let index = id.y * map_size + id.x;
+    let patch_size = ocean.texel_size * f32(map_size);
+    let k = 2.0 * pi * (vec2<f32>(id.xy) - f32(map_size / 2u)) / patch_size;
+    let k_length = max(length(k), 0.000001);
+    let omega = sqrt(gravity * k_length) * ocean.time;
+    let rotation = vec2<f32>(cos(omega), sin(omega));
+    let h0 = initial_spectrum[index];
+    let h = complex_mul(h0.xy, rotation)
+            + complex_mul(h0.zw, vec2<f32>(rotation.x, -rotation.y));
+    let minus_i_h = vec2<f32>(h.y, -h.x);
+    let dx = minus_i_h * (k.x / k_length);
+    let dy = minus_i_h * (k.y / k_length);
+    spectrum[index] = vec4<f32>(h + vec2<f32>(-dx.y, dx.x), dy);
+  }
+
+  fn inverse_fft(lane : u32, base : u32, stride : u32) {
+    let reversed = reverseBits(lane) >> (32u - map_size_log2);
+    fft_buffer[reversed] = spectrum[base + lane * stride];
+    workgroupBarrier();
+    var source = 0u;
+    for (var m = 2u; m <= map_size; m = m << 1u) {
+      let half_m = m >> 1u;
+      let j = lane % m;
+      let even = source * map_size + lane - j + j % half_m;
+      let angle = 2.0 * pi * f32(j) / f32(m);
+      let w = vec2<f32>(cos(angle), sin(angle));
+      let a = fft_buffer[even];
+      let b = fft_buffer[even + half_m];
+      fft_buffer[(1u - source) * map_size + lane]
+        = a + vec4<f32>(complex_mul(b.xy, w), complex_mul(b.zw, w));
+      source = 1u - source;
+      workgroupBarrier();
+    }
+    spectrum[base + lane * stride] = fft_buffer[source * map_size + lane];
+  }
+
+  @compute @workgroup_size(map_size)
+  fn fft_rows(@builtin(local_invocation_id) local_id : vec3<u32>,
+              @builtin(workgroup_id) group_id : vec3<u32>) {
+    inverse_fft(local_id.x, group_id.x * map_size, 1u);
+  }
+
+  @compute @workgroup_size(map_size)
+  fn fft_columns(@builtin(local_invocation_id) local_id : vec3<u32>,
+                 @builtin(workgroup_id) group_id : vec3<u32>) {
+    inverse_fft(local_id.x, group_id.x, map_size);
+  }
+
+  fn ocean_sample(coord : vec2<i32>) -> vec3<f32> {
+    let size = i32(map_size);
+    let wrapped = vec2<u32>((coord + size) % size);
+    let value = spectrum[wrapped.y * map_size + wrapped.x];
+    let parity = select(1.0, -1.0, ((wrapped.x + wrapped.y) & 1u) == 1u);
+    return parity * vec3<f32>(value.yz * ocean.choppiness, value.x);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn resolve_maps(@builtin(global_invocation_id) id : vec3<u32>) {
+    let coord = vec2<i32>(id.xy);
+    let dx = ocean_sample(coord + vec2<i32>(1, 0))
+             - ocean_sample(coord - vec2<i32>(1, 0));
+    let dy = ocean_sample(coord + vec2<i32>(0, 1))
+             - ocean_sample(coord - vec2<i32>(0, 1));
+    let texel = 2.0 * ocean.texel_size;
+    let normal = normalize(cross(vec3<f32>(texel, 0.0, 0.0) + dx,
+                                 vec3<f32>(0.0, texel, 0.0) + dy));
+    let displacement = ocean_sample(coord);
+    textureStore(displacement_map, id.xy, vec4<f32>(displacement, 1.0));
+    textureStore(normal_map, id.xy, vec4<f32>(normal, 0.0));
+  }
+);
+
+static const char* ocean_shader_wgsl = CODE(
+  struct Scene {
+    elapsed_time : f32,
+    model_matrix : mat4x4<f32>,
+    view_projection_matrix : mat4x4<f32>,
+    view_position : vec3<f32>,
+  }
+
+  struct OceanParams {
+    time : f32,
+    choppiness : f32,
+    texel_size : f32,
+    uv_scale : f32,
+    uv_offset : f32,
+    height_min : f32,
+    height_max : f32,
+    padding : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> scene : Scene;
+  @group(0) @binding(1) var<uniform> ocean : OceanParams;
+  @group(1) @binding(0) var sea_sampler : sampler;
+  @group(1) @binding(1) var sea_color : texture_2d<f32>;
+  @group(1) @binding(2) var wave_sampler : sampler;
+  @group(1) @binding(3) var displacement_map : texture_2d<f32>;
+  @group(1) @binding(4) var normal_map : texture_2d<f32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) world_position : vec3<f32>,
+    @location(1) map_uv : vec2<f32>,
+    @location(2) height : f32,
+  }
+
+  @vertex
+  fn vertex_main(@location(0) position : vec3<f32>) -> VertexOutput {
+    let map_uv = position.xy * ocean.uv_scale + ocean.uv_offset;
+    let displacement = textureSampleLevel(displacement_map, wave_sampler,
+                                          map_uv, 0.0).xyz;
+    let world_position = scene.model_matrix
+                         * vec4<f32>(position + displacement, 1.0);
+    var output : VertexOutput;
+    output.position = scene.view_projection_matrix * world_position;
+    output.world_position = world_position.xyz;
+    output.map_uv = map_uv;
+    output.height = displacement.z;
+    return output;
+  }
+
+  @fragment
+  fn fragment_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let local_normal = textureSample(normal_map, wave_sampler,
+                                     input.map_uv).xyz;
+    let normal = normalize(
+      (scene.model_matrix * vec4<f32>(local_normal, 0.0)).xyz);
+    let view_direction = normalize(scene.view_position - input.world_position);
+    let light_direction = normalize(vec3<f32>(-0.4, 1.0, 0.3));
+    let height = clamp((input.height - ocean.height_min)
+                         / (ocean.height_max - ocean.height_min), 0.0, 1.0);
+    let base_color = textureSample(sea_color, sea_sampler,
+                                   vec2<f32>(height, 0.5)).rgb;
+    let diffuse = max(dot(normal, light_direction), 0.0);
+    let half_vector = normalize(light_direction + view_direction);
+    let specular = pow(max(dot(normal, half_vector), 0.0), 128.0);
+    let facing = max(dot(normal, view_direction), 0.0);
+    let fresnel = 0.02 + 0.98 * pow(1.0 - facing, 5.0);
+    let sky_color = vec3<f32>(0.6, 0.7, 0.8);
+    let color = mix(base_color * (0.3 + 0.7 * diffuse), sky_color, fresnel);
+    return vec4<f32>(color + specular, 1.0);
+  }
+);
+// clang-format on
+
 /* -------------------------------------------------------------------------- *
  * Camera control
  * -------------------------------------------------------------------------- */
@@ -127,6 +392,7 @@ static wgpu_buffer_t indices = {0};
 static struct {
   wgpu_buffer_t scene;
   wgpu_buffer_t gerstner_wave_params;
+  wgpu_buffer_t ocean_params;
 } uniform_buffers;
 
 // Uniform buffer data
@@ -199,6 +465,60 @@ static struct {
 };
 static bool gerstner_waves_normalized = false;
 
+// Wave models baked into the maps
+typedef enum wave_model_t {
+  WaveModel_Gerstner,
+  WaveModel_FFTOcean,
+  WaveModel_Count,
+} wave_model_t;
+static int32_t wave_model = WaveModel_Gerstner;
+static const char* wave_model_names[WaveModel_Count] = {
+  "Gerstner",  // WaveModel_Gerstner
+  "FFT ocean", // WaveModel_FFTOcean
+};
+
+// Parameters shared by the bake and the render passes
+static struct {
+  float time;
+  float choppiness; // Scale of the FFT ocean horizontal displacement
+  float texel_size; // Distance between map texels in meters
+  float uv_scale;   // Plane position to map uv
+  float uv_offset;  // Half a texel
+  float height_min;
+  float height_max;
+  float padding;
+} ocean_params = {
+  .choppiness = 1.0f,
+};
+
+// Height range of the FFT ocean, 3 standard deviations
+static float ocean_height_range = 0.0f;
+
+// FFT ocean spectrum, the initial spectrum holds h0(k) and conj(h0(-k))
+static struct {
+  wgpu_buffer_t initial;
+  wgpu_buffer_t evolved;
+} spectrum_buffers;
+
+// Baked displacement and normal maps
+static struct {
+  WGPUTexture texture;
+  WGPUTextureView view;
+} displacement_map, normal_map;
+static WGPUSampler wave_sampler;
+
+// Wave bake compute pass
+static struct {
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline bake_gerstner;
+  WGPUComputePipeline evolve_spectrum;
+  WGPUComputePipeline fft_rows;
+  WGPUComputePipeline fft_columns;
+  WGPUComputePipeline resolve_maps;
+} wave_bake;
+
 // Texture and sampler for sea color image
 static texture_t sea_color_texture;
 static WGPUSampler non_filtering_sampler;
@@ -239,14 +559,15 @@ static void prepare_example(wgpu_example_context_t* context)
   start_time = context->run_time;
 }
 
-// Prepare the plane mesh
+// Prepare the plane mesh, the grid is generated into the buffers
 static void prepare_plane_mesh()
 {
   plane_mesh_init(&plane_mesh, &(plane_mesh_init_options_t){
-                                 .width   = 12.0f,
-                                 .height  = 12.0f,
-                                 .rows    = 100,
-                                 .columns = 100,
+                                 .width       = 12.0f,
+                                 .height      = 12.0f,
+                                 .rows        = 100,
+                                 .columns     = 100,
+                                 .counts_only = true,
                                });
 }
 
@@ -254,22 +575,48 @@ static void prepare_plane_mesh()
 static void prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context)
 {
   // Create vertex buffer
-  vertices = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-                    .size  = plane_mesh.vertex_count * sizeof(plane_vertex_t),
-                    .count = plane_mesh.vertex_count,
-                    .initial.data = plane_mesh.vertices,
-                  });
+  {
+    const uint64_t size = plane_mesh.vertex_count * sizeof(plane_vertex_t);
+    WGPUBuffer buffer   = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .usage = WGPUBufferUsage_Vertex,
+                              .size  = size,
+                              .mappedAtCreation = true,
+                            });
+    ASSERT(buffer != NULL);
+    plane_vertex_t* mapping = wgpuBufferGetMappedRange(buffer, 0, size);
+    ASSERT(mapping != NULL);
+    plane_mesh_write_vertices(&plane_mesh, mapping);
+    wgpuBufferUnmap(buffer);
+    vertices = (wgpu_buffer_t){
+      .buffer = buffer,
+      .usage  = WGPUBufferUsage_Vertex,
+      .size   = (uint32_t)size,
+      .count  = (uint32_t)plane_mesh.vertex_count,
+    };
+  }
 
   // Create index buffer
-  indices = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
-                    .size  = plane_mesh.index_count * sizeof(uint32_t),
-                    .count = plane_mesh.index_count,
-                    .initial.data = plane_mesh.indices,
-                  });
+  {
+    const uint64_t size = plane_mesh.index_count * sizeof(uint32_t);
+    WGPUBuffer buffer   = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .usage = WGPUBufferUsage_Index,
+                              .size  = size,
+                              .mappedAtCreation = true,
+                            });
+    ASSERT(buffer != NULL);
+    uint32_t* mapping = wgpuBufferGetMappedRange(buffer, 0, size);
+    ASSERT(mapping != NULL);
+    plane_mesh_write_indices(&plane_mesh, mapping);
+    wgpuBufferUnmap(buffer);
+    indices = (wgpu_buffer_t){
+      .buffer = buffer,
+      .usage  = WGPUBufferUsage_Index,
+      .size   = (uint32_t)size,
+      .count  = (uint32_t)plane_mesh.index_count,
+    };
+  }
 }
 
 static void prepare_texture(wgpu_context_t* wgpu_context)
@@ -289,6 +636,129 @@ static void prepare_texture(wgpu_context_t* wgpu_context)
   ASSERT(non_filtering_sampler != NULL);
 }
 
+static void prepare_wave_maps(wgpu_context_t* wgpu_context)
+{
+  // Displacement map, x and y horizontal, z height in plane space
+  // Normal map, plane space normals
+  struct {
+    WGPUTexture* texture;
+    WGPUTextureView* view;
+    const char* label;
+  } maps[2] = {
+    {&displacement_map.texture, &displacement_map.view, "Displacement map"},
+    {&normal_map.texture, &normal_map.view, "Normal map"},
+  };
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(maps); ++i) {
+    *maps[i].texture = wgpuDeviceCreateTexture(
+      wgpu_context->device,
+      &(WGPUTextureDescriptor){
+        .label         = maps[i].label,
+        .size          = (WGPUExtent3D){
+          .width              = WAVE_MAP_SIZE,
+          .height             = WAVE_MAP_SIZE,
+          .depthOrArrayLayers = 1,
+        },
+        .mipLevelCount = 1,
+        .sampleCount   = 1,
+        .dimension     = WGPUTextureDimension_2D,
+        .format        = WGPUTextureFormat_RGBA16Float,
+        .usage
+        = WGPUTextureUsage_StorageBinding | WGPUTextureUsage_TextureBinding,
+      });
+    ASSERT(*maps[i].texture != NULL);
+    *maps[i].view = wgpuTextureCreateView(*maps[i].texture, NULL);
+    ASSERT(*maps[i].view != NULL);
+  }
+
+  // Bilinear sampler, the FFT ocean maps tile
+  WGPUSamplerDescriptor sampler_desc = {
+    .addressModeU  = WGPUAddressMode_Repeat,
+    .addressModeV  = WGPUAddressMode_Repeat,
+    .addressModeW  = WGPUAddressMode_Repeat,
+    .minFilter     = WGPUFilterMode_Linear,
+    .magFilter     = WGPUFilterMode_Linear,
+    .maxAnisotropy = 1,
+  };
+  wave_sampler = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+  ASSERT(wave_sampler != NULL);
+}
+
+static float gaussian_random(void)
+{
+  // Box-Muller transform
+  const float u1 = (rand() + 1.0f) / ((float)RAND_MAX + 2.0f);
+  const float u2 = rand() / (float)RAND_MAX;
+  return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * PI * u2);
+}
+
+// Initial Phillips spectrum h0(k) of the FFT ocean
+static void prepare_ocean_spectrum(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  const uint32_t n = WAVE_MAP_SIZE;
+  const float dk   = 2.0f * PI / OCEAN_PATCH_SIZE;
+  const float wind_length
+    = OCEAN_WIND_SPEED * OCEAN_WIND_SPEED / OCEAN_GRAVITY;
+  const float small_waves = wind_length * 0.001f;
+  vec2 wind_direction     = {1.0f, 0.6f};
+  glm_vec2_normalize(wind_direction);
+
+  float* h0 = ARENA_ALLOC_ARRAY(context->load_arena, float, n * n * 2);
+  float variance = 0.0f;
+  for (uint32_t y = 0; y < n; ++y) {
+    for (uint32_t x = 0; x < n; ++x) {
+      const vec2 k = {dk * ((float)x - n / 2), dk * ((float)y - n / 2)};
+      const float k_length_sq = k[0] * k[0] + k[1] * k[1];
+      float phillips          = 0.0f;
+      if (k_length_sq > 0.0f) {
+        const float k_dot_w
+          = (k[0] * wind_direction[0] + k[1] * wind_direction[1])
+            / sqrtf(k_length_sq);
+        phillips = OCEAN_PHILLIPS_AMPLITUDE
+                   * expf(-1.0f / (k_length_sq * wind_length * wind_length))
+                   / (k_length_sq * k_length_sq) * k_dot_w * k_dot_w
+                   * expf(-k_length_sq * small_waves * small_waves);
+      }
+      const float amplitude = sqrtf(phillips * dk * dk * 0.5f);
+      float* h              = &h0[(y * n + x) * 2];
+      h[0]                  = gaussian_random() * amplitude;
+      h[1]                  = gaussian_random() * amplitude;
+      variance += 2.0f * (h[0] * h[0] + h[1] * h[1]);
+    }
+  }
+  ocean_height_range = 3.0f * sqrtf(variance);
+
+  // Pack h0(k) and conj(h0(-k))
+  float* initial_spectrum
+    = ARENA_ALLOC_ARRAY(context->load_arena, float, n * n * 4);
+  for (uint32_t y = 0; y < n; ++y) {
+    for (uint32_t x = 0; x < n; ++x) {
+      const float* h       = &h0[(y * n + x) * 2];
+      const float* h_minus = &h0[(((n - y) % n) * n + (n - x) % n) * 2];
+      float* dst           = &initial_spectrum[(y * n + x) * 4];
+      dst[0]               = h[0];
+      dst[1]               = h[1];
+      dst[2]               = h_minus[0];
+      dst[3]               = -h_minus[1];
+    }
+  }
+
+  spectrum_buffers.initial = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label        = "Initial ocean spectrum",
+                    .usage        = WGPUBufferUsage_Storage,
+                    .size         = n * n * 4 * sizeof(float),
+                    .initial.data = initial_spectrum,
+                  });
+  spectrum_buffers.evolved = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Ocean spectrum",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = n * n * 4 * sizeof(float),
+                  });
+}
+
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 {
   // Bind group layout for Gerstner Waves mesh rendering & parameters
@@ -306,13 +776,13 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
         .sampler = {0},
       },
       [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: GerstnerWavesUniforms
+        // Binding 1: OceanParams
         .binding    = 1,
         .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
         .buffer = (WGPUBufferBindingLayout) {
           .type             = WGPUBufferBindingType_Uniform,
           .hasDynamicOffset = false,
-          .minBindingSize   = sizeof(gerstner_wave_params),
+          .minBindingSize   = sizeof(ocean_params),
         },
         .sampler = {0},
       },
@@ -327,9 +797,9 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(bind_group_layouts.uniforms != NULL);
   }
 
-  // Bind group layout for sea color texture
+  // Bind group layout for sea color texture and wave maps
   {
-    WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    WGPUBindGroupLayoutEntry bgl_entries[5] = {
       [0] = (WGPUBindGroupLayoutEntry) {
         // Binding 0: Sampler
         .binding    = 0,
@@ -349,7 +819,38 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
           .multisampled  = false,
         },
         .storageTexture = {0},
-      }
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Wave map sampler
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+        .sampler = (WGPUSamplerBindingLayout){
+          .type = WGPUSamplerBindingType_Filtering,
+        },
+        .texture = {0},
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Displacement map
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Vertex,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+        .storageTexture = {0},
+      },
+      [4] = (WGPUBindGroupLayoutEntry) {
+        // Binding 4: Normal map
+        .binding    = 4,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+        .storageTexture = {0},
+      },
     };
     bind_group_layouts.textures = wgpuDeviceCreateBindGroupLayout(
       wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
@@ -386,11 +887,11 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
         .size    = uniform_buffers.scene.size,
       },
       [1] = (WGPUBindGroupEntry) {
-        // Binding 1: GerstnerWavesUniforms
+        // Binding 1: OceanParams
         .binding = 1,
-        .buffer  = uniform_buffers.gerstner_wave_params.buffer,
+        .buffer  = uniform_buffers.ocean_params.buffer,
         .offset  = 0,
-        .size    = uniform_buffers.gerstner_wave_params.size,
+        .size    = uniform_buffers.ocean_params.size,
       },
     };
 
@@ -404,9 +905,9 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
     ASSERT(bind_groups.uniforms != NULL);
   }
 
-  // Bind group for sea color texture
+  // Bind group for sea color texture and wave maps
   {
-    WGPUBindGroupEntry bg_entries[2] = {
+    WGPUBindGroupEntry bg_entries[5] = {
       [0] = (WGPUBindGroupEntry) {
          // Binding 0: Sampler
         .binding = 0,
@@ -416,7 +917,22 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
         // Binding 1: Texture view
         .binding     = 1,
         .textureView = sea_color_texture.view,
-      }
+      },
+      [2] = (WGPUBindGroupEntry) {
+        // Binding 2: Wave map sampler
+        .binding = 2,
+        .sampler = wave_sampler,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        // Binding 3: Displacement map
+        .binding     = 3,
+        .textureView = displacement_map.view,
+      },
+      [4] = (WGPUBindGroupEntry) {
+        // Binding 4: Normal map
+        .binding     = 4,
+        .textureView = normal_map.view,
+      },
     };
     WGPUBindGroupDescriptor bg_desc = {
       .label      = "Sea color texture bind group",
@@ -475,8 +991,9 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
              wgpu_context, &(wgpu_vertex_state_t){
              .shader_desc = (wgpu_shader_desc_t){
                 // Vertex shader WGSL
-                .file  = "shaders/gerstner_waves/gerstner-waves.wgsl",
-                .entry = "vertex_main",
+                .label            = "Ocean vertex shader",
+                .wgsl_code.source = ocean_shader_wgsl,
+                .entry            = "vertex_main",
              },
              .buffer_count = 1,
              .buffers      = &plane_vertex_buffer_layout,
@@ -487,8 +1004,9 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
              wgpu_context, &(wgpu_fragment_state_t){
              .shader_desc = (wgpu_shader_desc_t){
                 // Fragment shader WGSL
-                .file  = "shaders/gerstner_waves/gerstner-waves.wgsl",
-                .entry = "fragment_main",
+                .label            = "Ocean fragment shader",
+                .wgsl_code.source = ocean_shader_wgsl,
+                .entry            = "fragment_main",
              },
              .target_count = 1,
              .targets      = &color_target_state,
@@ -519,6 +1037,158 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+static void prepare_wave_bake(wgpu_context_t* wgpu_context)
+{
+  // Bind group layout shared by the bake kernels
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[6] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: OceanParams
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(ocean_params),
+        },
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Binding 1: GerstnerWavesUniforms
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(gerstner_wave_params),
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Initial spectrum
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = spectrum_buffers.initial.size,
+        },
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Evolved spectrum, transformed in place
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Storage,
+          .minBindingSize = spectrum_buffers.evolved.size,
+        },
+      },
+      [4] = (WGPUBindGroupLayoutEntry) {
+        // Binding 4: Displacement map
+        .binding    = 4,
+        .visibility = WGPUShaderStage_Compute,
+        .storageTexture = (WGPUStorageTextureBindingLayout) {
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = WGPUTextureFormat_RGBA16Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [5] = (WGPUBindGroupLayoutEntry) {
+        // Binding 5: Normal map
+        .binding    = 5,
+        .visibility = WGPUShaderStage_Compute,
+        .storageTexture = (WGPUStorageTextureBindingLayout) {
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = WGPUTextureFormat_RGBA16Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+    };
+    wave_bake.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label      = "Wave bake bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(wave_bake.bind_group_layout != NULL);
+
+    wave_bake.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                              .label                = "Wave bake layout",
+                              .bindGroupLayoutCount = 1,
+                              .bindGroupLayouts = &wave_bake.bind_group_layout,
+                            });
+    ASSERT(wave_bake.pipeline_layout != NULL);
+  }
+
+  // Bind group
+  {
+    WGPUBindGroupEntry bg_entries[6] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = uniform_buffers.ocean_params.buffer,
+        .size    = uniform_buffers.ocean_params.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = uniform_buffers.gerstner_wave_params.buffer,
+        .size    = uniform_buffers.gerstner_wave_params.size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = spectrum_buffers.initial.buffer,
+        .size    = spectrum_buffers.initial.size,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding = 3,
+        .buffer  = spectrum_buffers.evolved.buffer,
+        .size    = spectrum_buffers.evolved.size,
+      },
+      [4] = (WGPUBindGroupEntry) {
+        .binding     = 4,
+        .textureView = displacement_map.view,
+      },
+      [5] = (WGPUBindGroupEntry) {
+        .binding     = 5,
+        .textureView = normal_map.view,
+      },
+    };
+    wave_bake.bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Wave bake bind group",
+                              .layout     = wave_bake.bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(wave_bake.bind_group != NULL);
+  }
+
+  // Compute pipelines
+  struct {
+    WGPUComputePipeline* pipeline;
+    const char* wgsl_code;
+    const char* entry;
+  } kernels[5] = {
+    {&wave_bake.bake_gerstner, gerstner_bake_shader_wgsl, "bake_gerstner"},
+    {&wave_bake.evolve_spectrum, fft_ocean_shader_wgsl, "evolve_spectrum"},
+    {&wave_bake.fft_rows, fft_ocean_shader_wgsl, "fft_rows"},
+    {&wave_bake.fft_columns, fft_ocean_shader_wgsl, "fft_columns"},
+    {&wave_bake.resolve_maps, fft_ocean_shader_wgsl, "resolve_maps"},
+  };
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(kernels); ++i) {
+    wgpu_shader_t comp_shader = wgpu_shader_create(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      // Compute shader WGSL
+                      .label            = kernels[i].entry,
+                      .wgsl_code.source = kernels[i].wgsl_code,
+                      .entry            = kernels[i].entry,
+                    });
+    *kernels[i].pipeline = wgpu_create_compute_pipeline(
+      wgpu_context, &(WGPUComputePipelineDescriptor){
+                      .label   = kernels[i].entry,
+                      .layout  = wave_bake.pipeline_layout,
+                      .compute = comp_shader.programmable_stage_descriptor,
+                    });
+    ASSERT(*kernels[i].pipeline != NULL);
+    wgpu_shader_release(&comp_shader);
+  }
+}
+
 static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   UNUSED_VAR(wgpu_context);
@@ -658,6 +1328,31 @@ update_uniform_buffers_gerstner_waves(wgpu_example_context_t* context)
     &gerstner_wave_params, uniform_buffers.gerstner_wave_params.size);
 }
 
+static void update_uniform_buffers_ocean(wgpu_example_context_t* context)
+{
+  const float map_size   = (float)WAVE_MAP_SIZE;
+  ocean_params.time      = scene_data.elapsed_time;
+  ocean_params.uv_offset = 0.5f / map_size;
+  if (wave_model == WaveModel_Gerstner) {
+    // The map covers the plane, edge texels on the plane border
+    ocean_params.texel_size = plane_mesh.width / (map_size - 1.0f);
+    ocean_params.uv_scale   = (map_size - 1.0f) / (map_size * plane_mesh.width);
+    ocean_params.height_min = -gerstner_wave_params.amplitude_sum;
+    ocean_params.height_max = gerstner_wave_params.amplitude_sum;
+  }
+  else {
+    // The map tiles the ocean patch
+    ocean_params.texel_size = OCEAN_PATCH_SIZE / map_size;
+    ocean_params.uv_scale   = 1.0f / OCEAN_PATCH_SIZE;
+    ocean_params.height_min = -ocean_height_range;
+    ocean_params.height_max = ocean_height_range;
+  }
+
+  wgpu_queue_write_buffer(context->wgpu_context,
+                          uniform_buffers.ocean_params.buffer, 0,
+                          &ocean_params, uniform_buffers.ocean_params.size);
+}
+
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
   // Scene uniform buffer
@@ -676,9 +1371,18 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
       .size  = sizeof(gerstner_wave_params),
     });
 
+  // Ocean parameters buffer
+  uniform_buffers.ocean_params = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ocean_params),
+    });
+
   // Initialize uniform buffers
   update_uniform_buffers_scene(context);
   update_uniform_buffers_gerstner_waves(context);
+  update_uniform_buffers_ocean(context);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -690,6 +1394,9 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_vertex_and_index_buffers(context->wgpu_context);
     prepare_uniform_buffers(context);
     prepare_texture(context->wgpu_context);
+    prepare_wave_maps(context->wgpu_context);
+    prepare_ocean_spectrum(context);
+    prepare_wave_bake(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
@@ -702,6 +1409,49 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_combo_box(context->imgui_overlay, "Waves", &wave_model,
+                            wave_model_names, (uint32_t)WaveModel_Count);
+    if (wave_model == WaveModel_FFTOcean) {
+      imgui_overlay_slider_float(context->imgui_overlay, "Choppiness",
+                                 &ocean_params.choppiness, 0.0f, 2.0f);
+    }
+  }
+}
+
+// Bakes the waves of the current model into the displacement and normal maps
+static void record_wave_bake(WGPUCommandEncoder cmd_enc)
+{
+  const uint32_t tile_count = WAVE_MAP_SIZE / 8u;
+
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, wave_bake.bind_group, 0,
+                                     NULL);
+  if (wave_model == WaveModel_Gerstner) {
+    wgpuComputePassEncoderSetPipeline(cpass_enc, wave_bake.bake_gerstner);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, tile_count, tile_count,
+                                             1);
+  }
+  else {
+    wgpuComputePassEncoderSetPipeline(cpass_enc, wave_bake.evolve_spectrum);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, tile_count, tile_count,
+                                             1);
+    // One workgroup per row / column
+    wgpuComputePassEncoderSetPipeline(cpass_enc, wave_bake.fft_rows);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, WAVE_MAP_SIZE, 1, 1);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, wave_bake.fft_columns);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, WAVE_MAP_SIZE, 1, 1);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, wave_bake.resolve_maps);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, tile_count, tile_count,
+                                             1);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   // Set target frame buffer
@@ -721,6 +1471,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Bake the wave maps
+  record_wave_bake(wgpu_context->cmd_enc);
+
   // Create render pass
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass.descriptor);
@@ -743,6 +1496,9 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
   // Get command buffer
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
@@ -751,20 +1507,22 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   return command_buffer;
 }
 
-static int example_draw(wgpu_context_t* wgpu_context)
+static int example_draw(wgpu_example_context_t* context)
 {
-  // Get next image in the swap chain (back/front buffer)
-  wgpu_swap_chain_get_current_image(wgpu_context);
+  // Prepare frame
+  prepare_frame(context);
 
-  // Create command buffer
-  WGPUCommandBuffer command_buffer = build_command_buffer(wgpu_context);
-  ASSERT(command_buffer != NULL);
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0]
+    = build_command_buffer(context->wgpu_context);
 
-  // Submit command buffer to the queue
-  wgpu_flush_command_buffers(wgpu_context, &command_buffer, 1);
+  // Submit to queue
+  submit_command_buffers(context);
 
-  // Present the current buffer to the swap chain
-  wgpu_swap_chain_present(wgpu_context);
+  // Submit frame
+  submit_frame(context);
 
   return 0;
 }
@@ -776,18 +1534,36 @@ static int example_render(wgpu_example_context_t* context)
   }
   update_controls(context);
   update_uniform_buffers_scene(context);
-  return example_draw(context->wgpu_context);
+  update_uniform_buffers_ocean(context);
+  return example_draw(context);
 }
 
 static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
 
+  plane_mesh_destroy(&plane_mesh);
   wgpu_destroy_texture(&sea_color_texture);
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, indices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.scene.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.gerstner_wave_params.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.ocean_params.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, spectrum_buffers.initial.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, spectrum_buffers.evolved.buffer)
+  WGPU_RELEASE_RESOURCE(TextureView, displacement_map.view)
+  WGPU_RELEASE_RESOURCE(Texture, displacement_map.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, normal_map.view)
+  WGPU_RELEASE_RESOURCE(Texture, normal_map.texture)
+  WGPU_RELEASE_RESOURCE(Sampler, wave_sampler)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, wave_bake.bake_gerstner)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, wave_bake.evolve_spectrum)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, wave_bake.fft_rows)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, wave_bake.fft_columns)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, wave_bake.resolve_maps)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, wave_bake.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, wave_bake.bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, wave_bake.bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.uniforms)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.textures)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.uniforms)
@@ -804,8 +1580,9 @@ void example_gerstner_waves(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title = example_title,
-      .vsync = true,
+      .title   = example_title,
+      .overlay = true,
+      .vsync   = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -0,0 +1,605 @@
+#include "example_base.h"
+#include "examples.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/argparse.h"
+#include "../webgpu/gltf_model.h"
+#include "../webgpu/imgui_overlay.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - glTF Mesh Instancing
+ *
+ * Draws the nodes of a glTF model (--model=<file>, models/Sponza/glTF/
+ * Sponza.gltf by default) that reference the same mesh with one instanced draw
+ * per primitive. The model is loaded with
+ * WGPU_GLTF_FileLoadingFlags_MeshInstancing, the vertex shader reads the world
+ * matrix of each instance with gltf_get_instance_matrix() instead of the mesh
+ * uniform block. Models with the EXT_mesh_gpu_instancing extension draw the
+ * instances of their nodes the same way.
+ * -------------------------------------------------------------------------- */
+
+static struct gltf_model_t* gltf_model;
+
+static struct {
+  struct {
+    WGPUBuffer buffer;
+    uint64_t size;
+  } ubo_scene_matrices;
+  struct {
+    mat4 projection;
+    mat4 view;
+    vec4 light_pos;
+  } scene_matrices;
+} shader_data = {
+  .scene_matrices.projection = GLM_MAT4_IDENTITY_INIT,
+  .scene_matrices.view       = GLM_MAT4_IDENTITY_INIT,
+  .scene_matrices.light_pos  = {0.0f, 10.0f, 0.0f, 1.0f},
+};
+
+static struct {
+  WGPUBindGroupLayout ubo_scene;
+  WGPUBindGroupLayout instancing;
+  WGPUBindGroupLayout textures;
+} bind_group_layouts;
+
+static struct bind_group_t {
+  WGPUBindGroup ubo_scene;
+} bind_groups;
+
+static WGPUPipelineLayout pipeline_layout;
+static WGPURenderPipeline solid_pipeline;
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass;
+
+// View projection matrix used for frustum culling
+static mat4 view_projection = GLM_MAT4_IDENTITY_INIT;
+static bool frustum_culling = true;
+
+// Command line options
+static struct {
+  const char* model;
+} options = {
+  .model = "models/Sponza/glTF/Sponza.gltf",
+};
+
+// Other variables
+static const char* example_title = "glTF Mesh Instancing";
+static bool prepared             = false;
+
+// Shaders, prefixed with the instancing prelude of group 1 and the packed
+// textures prelude of group 2
+// clang-format off
+static const char* instanced_model_shader_wgsl = CODE(
+  struct UBOScene {
+    projection : mat4x4<f32>,
+    view : mat4x4<f32>,
+    lightPos : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> uboScene : UBOScene;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+    @location(1) color : vec3<f32>,
+    @location(2) uv : vec2<f32>,
+    @location(3) viewVec : vec3<f32>,
+    @location(4) lightVec : vec3<f32>,
+  }
+
+  @vertex
+  fn vs_main(
+    @location(0) inPos : vec3<f32>,
+    @location(1) inNormal : vec3<f32>,
+    @location(2) inUV : vec2<f32>,
+    @location(3) inColor : vec4<f32>,
+    @builtin(instance_index) instanceIndex : u32
+  ) -> VertexOutput {
+    // World matrix of the node drawn by this instance
+    let viewModel = uboScene.view * gltf_get_instance_matrix(instanceIndex);
+    let pos = viewModel * vec4<f32>(inPos, 1.0);
+    let viewModel3 = mat3x3<f32>(viewModel[0].xyz, viewModel[1].xyz,
+                                 viewModel[2].xyz);
+    var output : VertexOutput;
+    output.position = uboScene.projection * pos;
+    output.normal = viewModel3 * inNormal;
+    output.color = inColor.rgb;
+    output.uv = inUV;
+    output.lightVec = (uboScene.view * uboScene.lightPos).xyz - pos.xyz;
+    output.viewVec = -pos.xyz;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let color = gltf_sample_packed(gltf_packed_material.base_color, input.uv,
+                                   vec4<f32>(1.0))
+                * vec4<f32>(input.color, 1.0);
+    let N = normalize(input.normal);
+    let L = normalize(input.lightVec);
+    let V = normalize(input.viewVec);
+    let R = reflect(-L, N);
+    let diffuse = max(dot(N, L), 0.25) * color.rgb;
+    let specular = pow(max(dot(R, V), 0.0), 16.0) * vec3<f32>(0.25);
+    return vec4<f32>(diffuse + specular, 1.0);
+  }
+);
+// clang-format on
+
+static void setup_camera(wgpu_example_context_t* context)
+{
+  context->camera         = camera_create();
+  context->camera->type   = CameraType_FirstPerson;
+  context->camera->flip_y = false;
+  camera_set_position(context->camera, (vec3){0.0f, 1.0f, 0.0f});
+  camera_set_rotation(context->camera, (vec3){0.0f, -90.0f, 0.0f});
+  camera_set_perspective(context->camera, 60.0f,
+                         context->window_size.aspect_ratio, 0.1f, 256.0f);
+}
+
+static void load_assets(wgpu_context_t* wgpu_context)
+{
+  const uint32_t gltf_loading_flags
+    = WGPU_GLTF_FileLoadingFlags_MeshInstancing
+      | WGPU_GLTF_FileLoadingFlags_PackTextures;
+  gltf_model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
+    .wgpu_context       = wgpu_context,
+    .filename           = options.model,
+    .file_loading_flags = gltf_loading_flags,
+  });
+}
+
+static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
+{
+  /*
+   * This sample uses separate descriptor sets (and layouts) for the scene
+   * matrices, the instance matrices and the material textures
+   */
+
+  // Bind group layout to pass scene data to the shader
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[1] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: Uniform buffer (Vertex shader) => UBOScene
+        .binding = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout){
+          .type = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(shader_data.scene_matrices),
+        },
+        .sampler = {0},
+        },
+    };
+    WGPUBindGroupLayoutDescriptor bgl_desc = {
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    };
+    bind_group_layouts.ubo_scene
+      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
+    ASSERT(bind_group_layouts.ubo_scene != NULL);
+  }
+
+  // Bind group layout for the instance matrices
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[WGPU_GLTF_INSTANCING_BINDING_COUNT];
+    wgpu_gltf_get_instancing_bind_group_layout_entries(bgl_entries);
+    WGPUBindGroupLayoutDescriptor bgl_desc = {
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    };
+    bind_group_layouts.instancing
+      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
+    ASSERT(bind_group_layouts.instancing != NULL);
+  }
+
+  // Bind group layout for the packed material textures
+  {
+    WGPUBindGroupLayoutEntry
+      bgl_entries[WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT];
+    wgpu_gltf_get_packed_textures_bind_group_layout_entries(bgl_entries);
+    WGPUBindGroupLayoutDescriptor bgl_desc = {
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    };
+    bind_group_layouts.textures
+      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
+    ASSERT(bind_group_layouts.textures != NULL);
+  }
+
+  // Pipeline layout using the bind group layouts
+  {
+    // The pipeline layout uses three sets:
+    // Set 0 = Scene matrices (VS)
+    // Set 1 = Instance matrices (VS)
+    // Set 2 = Packed material textures (FS)
+    WGPUBindGroupLayout bind_group_layout_sets[3] = {
+      bind_group_layouts.ubo_scene,  // set 0
+      bind_group_layouts.instancing, // set 1
+      bind_group_layouts.textures,   // set 2
+    };
+    // Pipeline layout
+    WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layout_sets),
+      .bindGroupLayouts     = bind_group_layout_sets,
+    };
+    pipeline_layout = wgpuDeviceCreatePipelineLayout(wgpu_context->device,
+                                                     &pipeline_layout_desc);
+    ASSERT(pipeline_layout != NULL)
+  }
+}
+
+static void update_uniform_buffers(wgpu_example_context_t* context)
+{
+  // Pass matrices to the shaders
+  camera_t* camera = context->camera;
+  glm_mat4_copy(camera->matrices.perspective,
+                shader_data.scene_matrices.projection);
+  glm_mat4_copy(camera->matrices.view, shader_data.scene_matrices.view);
+  glm_mat4_mul(camera->matrices.perspective, camera->matrices.view,
+               view_projection);
+
+  // Map uniform buffer and update it
+  wgpu_queue_write_buffer(
+    context->wgpu_context, shader_data.ubo_scene_matrices.buffer, 0,
+    &shader_data.scene_matrices, shader_data.ubo_scene_matrices.size);
+}
+
+static void prepare_uniform_buffers(wgpu_example_context_t* context)
+{
+  // Matrices vertex shader uniform buffer
+  shader_data.ubo_scene_matrices.size   = sizeof(shader_data.scene_matrices);
+  shader_data.ubo_scene_matrices.buffer = wgpuDeviceCreateBuffer(
+    context->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size             = shader_data.ubo_scene_matrices.size,
+      .mappedAtCreation = false,
+    });
+
+  // Initialize uniform buffers
+  update_uniform_buffers(context);
+}
+
+static void setup_bind_groups(wgpu_context_t* wgpu_context)
+{
+  // Bind group for scene matrices
+  {
+    WGPUBindGroupEntry bg_entries[1] = {
+      [0] = (WGPUBindGroupEntry) {
+        // Binding 0: Uniform buffer (Vertex shader) => UBOScene
+        .binding = 0,
+        .buffer  = shader_data.ubo_scene_matrices.buffer,
+        .offset  = 0,
+        .size    = shader_data.ubo_scene_matrices.size,
+      },
+    };
+    bind_groups.ubo_scene = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .layout     = bind_group_layouts.ubo_scene,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(bind_groups.ubo_scene != NULL)
+  }
+
+  // Bind group for the instance matrices, no mesh uniform bind groups are
+  // prepared as the instance matrices replace them
+  {
+    wgpu_gltf_model_prepare_instancing_bind_group(
+      gltf_model, bind_group_layouts.instancing);
+  }
+
+  // Bind group shared by all materials, bound with the offset of the material
+  {
+    wgpu_gltf_model_prepare_packed_textures_bind_group(
+      gltf_model, bind_group_layouts.textures);
+  }
+}
+
+static void setup_render_pass(wgpu_context_t* wgpu_context)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearColor = (WGPUColor) {
+        .r = 0.025f,
+        .g = 0.025f,
+        .b = 0.025f,
+        .a = 1.0f,
+      },
+  };
+
+  // Depth attachment
+  wgpu_setup_deph_stencil(wgpu_context, NULL);
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+  };
+}
+
+static void prepare_pipelines(wgpu_context_t* wgpu_context)
+{
+  // Model shader, the vertex shader reads the instance matrices and the
+  // fragment shader samples the packed textures
+  char* instanced_wgsl
+    = wgpu_gltf_create_instancing_wgsl(1, instanced_model_shader_wgsl);
+  char* model_wgsl = wgpu_gltf_create_packed_textures_wgsl(2, instanced_wgsl);
+  free(instanced_wgsl);
+
+  // Primitive state
+  WGPUPrimitiveState primitive_state_desc = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  // Color target state
+  WGPUBlendState blend_state                   = wgpu_create_blend_state(false);
+  WGPUColorTargetState color_target_state_desc = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // Depth stencil state
+  WGPUDepthStencilState depth_stencil_state_desc
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = true,
+    });
+
+  // Vertex buffer layout
+  WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
+    gltf_scene,
+    // Location 0: Position
+    WGPU_GLTF_VERTATTR_DESC(0, WGPU_GLTF_VertexComponent_Position),
+    // Location 1: Vertex normal
+    WGPU_GLTF_VERTATTR_DESC(1, WGPU_GLTF_VertexComponent_Normal),
+    // Location 2: Texture coordinates
+    WGPU_GLTF_VERTATTR_DESC(2, WGPU_GLTF_VertexComponent_UV),
+    // Location 3: Vertex color
+    WGPU_GLTF_VERTATTR_DESC(3, WGPU_GLTF_VertexComponent_Color));
+
+  // Vertex state
+  WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
+            wgpu_context, &(wgpu_vertex_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Vertex shader WGSL
+              .wgsl_code.source = model_wgsl,
+              .entry            = "vs_main",
+            },
+            .buffer_count = 1,
+            .buffers = &gltf_scene_vertex_buffer_layout,
+          });
+
+  // Fragment state
+  WGPUFragmentState fragment_state_desc = wgpu_create_fragment_state(
+            wgpu_context, &(wgpu_fragment_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Fragment shader WGSL
+              .wgsl_code.source = model_wgsl,
+              .entry            = "fs_main",
+            },
+            .target_count = 1,
+            .targets = &color_target_state_desc,
+          });
+
+  // Multisample state
+  WGPUMultisampleState multisample_state_desc
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  // Render pipeline descriptor
+  solid_pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label        = "gltf_mesh_instancing_render_pipeline",
+                            .layout       = pipeline_layout,
+                            .primitive    = primitive_state_desc,
+                            .vertex       = vertex_state_desc,
+                            .fragment     = &fragment_state_desc,
+                            .depthStencil = &depth_stencil_state_desc,
+                            .multisample  = multisample_state_desc,
+                          });
+  ASSERT(solid_pipeline != NULL);
+  free(model_wgsl);
+
+  // Partial cleanup
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    setup_camera(context);
+    load_assets(context->wgpu_context);
+    prepare_uniform_buffers(context);
+    setup_pipeline_layout(context->wgpu_context);
+    prepare_pipelines(context->wgpu_context);
+    setup_bind_groups(context->wgpu_context);
+    setup_render_pass(context->wgpu_context);
+    prepared = true;
+    return 0;
+  }
+
+  return 1;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_checkBox(context->imgui_overlay, "Frustum culling",
+                           &frustum_culling);
+  }
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+{
+  // Set target frame buffer
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Create render pass encoder for encoding drawing commands
+  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    wgpu_context->cmd_enc, &render_pass.descriptor);
+
+  // Bind the rendering pipeline
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, solid_pipeline);
+
+  // Set the bind groups
+  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                    bind_groups.ubo_scene, 0, 0);
+  wgpuRenderPassEncoderSetBindGroup(
+    wgpu_context->rpass_enc, 1,
+    wgpu_gltf_model_get_instancing_bind_group(gltf_model), 0, 0);
+
+  // Set viewport
+  wgpuRenderPassEncoderSetViewport(
+    wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
+    (float)wgpu_context->surface.height, 0.0f, 1.0f);
+
+  // Set scissor rectangle
+  wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
+                                      wgpu_context->surface.width,
+                                      wgpu_context->surface.height);
+
+  // Draw model, the first node of each mesh draws all of its instances
+  wgpu_gltf_model_render_options_t render_options = {
+    .render_flags   = WGPU_GLTF_RenderFlags_BindImages,
+    .bind_image_set = 2,
+  };
+  glm_mat4_copy(view_projection, render_options.view_projection);
+  if (frustum_culling) {
+    render_options.render_flags |= WGPU_GLTF_RenderFlags_FrustumCulling;
+  }
+  wgpu_gltf_model_draw(gltf_model, render_options);
+
+  // End render pass
+  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0]
+    = build_command_buffer(context->wgpu_context);
+
+  // Submit to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return 0;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return 1;
+  }
+  int draw_result = example_draw(context);
+  if (context->camera->updated) {
+    update_uniform_buffers(context);
+  }
+  return draw_result;
+}
+
+static void example_destroy(wgpu_example_context_t* context)
+{
+  camera_release(context->camera);
+  wgpu_gltf_model_destroy(gltf_model);
+
+  WGPU_RELEASE_RESOURCE(Buffer, shader_data.ubo_scene_matrices.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_scene)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.instancing)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.textures)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.ubo_scene)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, solid_pipeline)
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]                = {"--model="};
+  char* filters_flag[1]              = {"--help-gltf-mesh-instancing"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option argparse_options[] = {
+    OPT_STRING(0, "model", &options.model,
+               "glTF model with meshes referenced by several nodes (default "
+               "models/Sponza/glTF/Sponza.gltf)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-gltf-mesh-instancing", NULL,
+                "show the glTF mesh instancing options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, argparse_options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+}
+
+void example_gltf_mesh_instancing(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title   = example_title,
+      .overlay = true
+    },
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+  });
+  // clang-format on
+}
@@ -5,6 +5,8 @@
 
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/parallel_recorder.h"
+#include "../webgpu/temporal_aa.h"
 #include "../webgpu/texture.h"
 
 /* -------------------------------------------------------------------------- *
@@ -13,19 +15,88 @@
  * Renders a complete scene loaded from an glTF 2.0 file. The sample uses the
  * glTF model loading functions, and adds data structures, functions and shaders
  * required to render a more complex scene using Crytek's Sponza model with
- * per-material pipelines and normal mapping.
+ * per-material pipelines and normal mapping. The scene is rendered with a
+ * reversed-Z depth buffer and an infinite far plane, the distant arches of the
+ * atrium don't z-fight. The opaque primitives are drawn front-to-back in a
+ * depth pre-pass, so the normal mapped main pass shades each pixel once. The
+ * scene is rendered with dynamic resolution scaling, the resolution drops when
+ * the GPU frame time exceeds 16.6 ms and is upscaled into the frame buffer.
+ * With temporal anti-aliasing the projection is jittered every frame, the
+ * depth pre-pass writes the motion vectors and the temporal resolve
+ * accumulates the frames at the full resolution, so the render scale is
+ * reduced to 50 - 75 %. The sorted per-frame draws are recorded into render
+ * bundles on worker threads. The meshlets of the model are culled against the
+ * view frustum and by their normal cones on the GPU before the passes, the
+ * draw list then draws the visible meshlets with indirect draws. The model is
+ * loaded asynchronously, the loading frames keep being rendered meanwhile.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfscenerendering/gltfscenerendering.cpp
  * -------------------------------------------------------------------------- */
 
+// Shaders
+// clang-format off
+static const char* depth_prepass_vertex_shader_wgsl = CODE(
+  struct UBOScene {
+    projection : mat4x4<f32>,
+    view       : mat4x4<f32>,
+    light_pos  : vec4<f32>,
+    view_pos   : vec4<f32>,
+    // Unjittered, for the motion vectors
+    view_projection          : mat4x4<f32>,
+    previous_view_projection : mat4x4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo_scene : UBOScene;
+  @group(2) @binding(0) var<uniform> model : mat4x4<f32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) clip_position : vec4<f32>,
+    @location(1) previous_clip_position : vec4<f32>,
+  }
+
+  // Same operations as scene.vert, the main pass tests the depth with Equal
+  @vertex
+  fn main(@location(0) position : vec3<f32>) -> VertexOutput {
+    let world = model * vec4<f32>(position, 1.0);
+    var output : VertexOutput;
+    output.position = ubo_scene.projection * ubo_scene.view * model
+                      * vec4<f32>(position, 1.0);
+    // The scene is static, only the camera moves
+    output.clip_position = ubo_scene.view_projection * world;
+    output.previous_clip_position = ubo_scene.previous_view_projection * world;
+    return output;
+  }
+);
+
+// Motion vectors, the UV offsets to the previous frame with UVs going down
+static const char* depth_prepass_fragment_shader_wgsl = CODE(
+  @fragment
+  fn main(@location(0) clip_position : vec4<f32>,
+          @location(1) previous_clip_position : vec4<f32>)
+    -> @location(0) vec4<f32> {
+    let uv = clip_position.xy / clip_position.w * vec2<f32>(0.5, -0.5);
+    let previous_uv = previous_clip_position.xy / previous_clip_position.w
+                      * vec2<f32>(0.5, -0.5);
+    return vec4<f32>(previous_uv - uv, 0.0, 0.0);
+  }
+);
+// clang-format on
+
 static struct gltf_model_t* gltf_model;
 
+// Sponza is parsed and decoded on a background thread while the loading frames
+// are rendered, the WebGPU resources are created once it is ready
+static wgpu_gltf_model_loader_t* gltf_model_loader;
+
 static struct {
   mat4 projection;
   mat4 view;
   vec4 light_pos;
   vec4 view_pos;
+  mat4 view_projection;
+  mat4 previous_view_projection;
 } ubo_scene = {
   .light_pos = {0.0f, 5.0f, 0.0f, 1.0f},
 };
@@ -53,8 +124,37 @@ static struct {
   WGPUBindGroup ubo_scene;
 } bind_groups = {0};
 
-static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
-static WGPURenderPassDescriptor render_pass_desc;
+// The scene is static, the opaque and alpha masked draws are recorded once
+// into a render bundle. The depth pre-pass of the opaque draws is sorted
+// front-to-back and alpha blended draws back-to-front every frame.
+static wgpu_gltf_draw_list_t* draw_list;
+static WGPURenderBundle render_bundle;
+
+// The sorted draws are recorded in parallel into per-frame render bundles
+static struct {
+  wgpu_parallel_recorder_t* recorder;
+  uint32_t depth_prepass_job;
+  uint32_t blended_job;
+} parallel_recording = {0};
+
+// The scene is rendered at the dynamic resolution scale into pooled textures
+// of the frame graph and upscaled into the frame buffer
+static struct {
+  wgpu_frame_graph_t* graph;
+  wgpu_frame_graph_resource_t scene_color;
+  wgpu_frame_graph_resource_t scene_depth;
+  wgpu_frame_graph_resource_t motion_vectors;
+  wgpu_frame_graph_resource_t taa_output;
+} frame_graph = {0};
+
+// Temporal anti-aliasing, upscales from the render scale
+static wgpu_temporal_aa_t* temporal_aa;
+
+static struct {
+  bool temporal_aa;
+} settings = {
+  .temporal_aa = true,
+};
 static WGPUPipelineLayout pipeline_layout;
 
 // Other variables
@@ -66,6 +166,7 @@ static void setup_camera(wgpu_example_context_t* context)
   context->camera         = camera_create();
   context->camera->type   = CameraType_FirstPerson;
   context->camera->flip_y = false;
+  context->camera->reversed_z = context->wgpu_context->depth_stencil.reversed_z;
   camera_set_position(context->camera, (vec3){0.0f, 1.0f, 0.0f});
   camera_set_rotation(context->camera, (vec3){0.0f, -90.0f, 0.0f});
   camera_set_perspective(context->camera, 60.0f,
@@ -74,12 +175,13 @@ static void setup_camera(wgpu_example_context_t* context)
 
 static void load_assets(wgpu_context_t* wgpu_context)
 {
-  const uint32_t gltf_loading_flags = WGPU_GLTF_FileLoadingFlags_None;
-  gltf_model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
-    .wgpu_context       = wgpu_context,
-    .filename           = "models/Sponza/glTF/Sponza.gltf",
-    .file_loading_flags = gltf_loading_flags,
-  });
+  const uint32_t gltf_loading_flags = WGPU_GLTF_FileLoadingFlags_MeshletCulling;
+  gltf_model_loader
+    = wgpu_gltf_model_load_from_file_async(&(wgpu_gltf_model_load_options_t){
+      .wgpu_context       = wgpu_context,
+      .filename           = "models/Sponza/glTF/Sponza.gltf",
+      .file_loading_flags = gltf_loading_flags,
+    });
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -286,32 +388,6 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
   }
 }
 
-static void setup_render_pass(wgpu_context_t* wgpu_context)
-{
-  // Color attachment
-  rp_color_att_descriptors[0] = (WGPURenderPassColorAttachment) {
-      .view       = NULL, // Assigned later
-      .loadOp     = WGPULoadOp_Clear,
-      .storeOp    = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.25f,
-        .g = 0.25f,
-        .b = 0.25f,
-        .a = 1.0f,
-      },
-  };
-
-  // Depth attachment
-  wgpu_setup_deph_stencil(wgpu_context, NULL);
-
-  // Render pass descriptor
-  render_pass_desc = (WGPURenderPassDescriptor){
-    .colorAttachmentCount   = 1,
-    .colorAttachments       = rp_color_att_descriptors,
-    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
-  };
-}
-
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
 {
   // Primitive state
@@ -329,11 +405,20 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     .writeMask = WGPUColorWriteMask_All,
   };
 
-  // Depth stencil state
+  // Depth stencil states, the opaque materials test against the depth of the
+  // pre-pass
+  const WGPUTextureFormat depth_format
+    = wgpu_get_default_depth_stencil_format(wgpu_context);
   WGPUDepthStencilState depth_stencil_state
     = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
-      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .format              = depth_format,
+      .depth_write_enabled = true,
+    });
+  WGPUDepthStencilState depth_prepassed_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = depth_format,
       .depth_write_enabled = true,
+      .depth_prepass       = true,
     });
 
   // Vertex buffer layout
@@ -399,8 +484,13 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     WGPUPrimitiveState* primitive_desc = &render_pipeline_descriptor.primitive;
     primitive_desc->cullMode
       = material->double_sided ? WGPUCullMode_None : WGPUCullMode_Back;
-    material->pipeline = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &render_pipeline_descriptor);
+    render_pipeline_descriptor.depthStencil
+      = material->alpha_mode == AlphaMode_OPAQUE ?
+          &depth_prepassed_stencil_state :
+          &depth_stencil_state;
+    // Materials with the same states share one pipeline
+    material->pipeline = wgpu_create_render_pipeline(
+      wgpu_context, &render_pipeline_descriptor);
     ASSERT(material->pipeline != NULL)
   }
 
@@ -408,6 +498,45 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   // created
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+
+  // Position only pipelines of the depth pre-pass
+  wgpu_gltf_model_prepare_depth_pipelines(
+    gltf_model,
+    &(wgpu_gltf_depth_pipeline_desc_t){
+      .layout             = pipeline_layout,
+      .vertex_wgsl_code   = depth_prepass_vertex_shader_wgsl,
+      .fragment_wgsl_code = depth_prepass_fragment_shader_wgsl,
+      .color_format       = WGPU_TEMPORAL_AA_MOTION_VECTOR_FORMAT,
+      .depth_format       = depth_format,
+      .sample_count       = 1,
+    });
+}
+
+// Render size of the scene textures, as computed by the frame graph
+static void get_render_size(wgpu_example_context_t* context, uint32_t* width,
+                            uint32_t* height)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  const float scale
+    = wgpu_dynamic_resolution_get_scale(context->dynamic_resolution);
+  *width  = MAX((uint32_t)((float)wgpu_context->surface.width * scale), 1u);
+  *height = MAX((uint32_t)((float)wgpu_context->surface.height * scale), 1u);
+}
+
+// Jitters the projection of the frame, once per frame before the uniform
+// buffer update
+static void update_jitter(wgpu_example_context_t* context)
+{
+  vec2 jitter = GLM_VEC2_ZERO_INIT;
+  if (settings.temporal_aa) {
+    uint32_t width = 0, height = 0;
+    get_render_size(context, &width, &height);
+    wgpu_temporal_aa_begin_frame(temporal_aa, width, height,
+                                 context->wgpu_context->surface.width,
+                                 context->wgpu_context->surface.height);
+    wgpu_temporal_aa_get_jitter(temporal_aa, jitter);
+  }
+  camera_set_jitter(context->camera, jitter);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -416,6 +545,9 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   glm_mat4_copy(camera->matrices.perspective, ubo_scene.projection);
   glm_mat4_copy(camera->matrices.view, ubo_scene.view);
   glm_vec4_copy(camera->view_pos, ubo_scene.view_pos);
+  glm_mat4_copy(ubo_scene.view_projection, ubo_scene.previous_view_projection);
+  glm_mat4_mul(camera->matrices.unjittered_perspective, camera->matrices.view,
+               ubo_scene.view_projection);
   wgpu_queue_write_buffer(context->wgpu_context, ubo_buffers.ubo_scene.buffer,
                           0, &ubo_scene, ubo_buffers.ubo_scene.size);
 }
@@ -430,7 +562,10 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
         .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
         .size  = sizeof(ubo_scene),
       });
+    // No motion in the first frame
     update_uniform_buffers(context);
+    glm_mat4_copy(ubo_scene.view_projection,
+                  ubo_scene.previous_view_projection);
   }
 
   // Material constants uniform buffer
@@ -452,62 +587,342 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   }
 }
 
+static void prepare_render_bundle(wgpu_context_t* wgpu_context)
+{
+  // Draw list sorted by pipeline and material
+  draw_list = wgpu_gltf_draw_list_create(
+    gltf_model, (wgpu_gltf_model_render_options_t){
+                  .render_flags        = WGPU_GLTF_RenderFlags_BindImages,
+                  .bind_image_set      = 1,
+                  .bind_mesh_model_set = 2,
+                });
+
+  WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
+  WGPURenderBundleEncoder render_bundle_encoder
+    = wgpuDeviceCreateRenderBundleEncoder(
+      wgpu_context->device,
+      &(WGPURenderBundleEncoderDescriptor){
+        .label              = "gltf_scene_rendering_render_bundle_encoder",
+        .colorFormatsCount  = (uint32_t)ARRAY_SIZE(color_formats),
+        .colorFormats       = color_formats,
+        .depthStencilFormat
+        = wgpu_get_default_depth_stencil_format(wgpu_context),
+        .sampleCount        = 1,
+      });
+  // Set the bind group
+  wgpuRenderBundleEncoderSetBindGroup(render_bundle_encoder, 0,
+                                      bind_groups.ubo_scene, 0, 0);
+  // Draw the scene
+  wgpu_gltf_draw_list_record_render_bundle(
+    draw_list, render_bundle_encoder,
+    WGPU_GLTF_RenderFlags_RenderOpaqueNodes
+      | WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes);
+  render_bundle = wgpuRenderBundleEncoderFinish(render_bundle_encoder, NULL);
+  ASSERT(render_bundle != NULL);
+
+  WGPU_RELEASE_RESOURCE(RenderBundleEncoder, render_bundle_encoder)
+}
+
+/* Load tasks, see example_queue_load_task() */
+
+static void load_model_task(wgpu_example_context_t* context)
+{
+  // Poll the loader once per frame
+  if (!wgpu_gltf_model_loader_is_ready(gltf_model_loader)) {
+    example_retry_load_task(context);
+    return;
+  }
+  gltf_model        = wgpu_gltf_model_loader_finish(gltf_model_loader);
+  gltf_model_loader = NULL;
+  ASSERT(gltf_model != NULL);
+}
+
+static void prepare_scene_task(wgpu_example_context_t* context)
+{
+  prepare_uniform_buffers(context);
+  setup_pipeline_layout(context->wgpu_context);
+  prepare_pipelines(context->wgpu_context);
+  setup_bind_groups(context->wgpu_context);
+  prepare_render_bundle(context->wgpu_context);
+  prepared = true;
+}
+
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     setup_camera(context);
     load_assets(context->wgpu_context);
-    prepare_uniform_buffers(context);
-    setup_pipeline_layout(context->wgpu_context);
-    prepare_pipelines(context->wgpu_context);
-    setup_bind_groups(context->wgpu_context);
-    setup_render_pass(context->wgpu_context);
-    prepared = true;
+    frame_graph.graph = wgpu_frame_graph_create(context->wgpu_context);
+    temporal_aa       = wgpu_temporal_aa_create(
+      context->wgpu_context, &(wgpu_temporal_aa_desc_t){
+                               .reversed_z = context->camera->reversed_z,
+                             });
+    wgpu_dynamic_resolution_set_scale_range(context->dynamic_resolution, 0.5f,
+                                            0.75f);
+    parallel_recording.recorder
+      = wgpu_parallel_recorder_create(context->wgpu_context, 2);
+    // The scene is prepared once the model is loaded
+    example_queue_load_task(context, "Sponza", load_model_task);
+    example_queue_load_task(context, "pipelines", prepare_scene_task);
     return 0;
   }
 
   return 1;
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+// Per-frame bundles, recorded on the worker threads of the parallel recorder
+static void record_depth_prepass_bundle(WGPURenderBundleEncoder bundle_enc,
+                                        void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  wgpuRenderBundleEncoderSetBindGroup(bundle_enc, 0, bind_groups.ubo_scene, 0,
+                                      0);
+  wgpu_gltf_draw_list_record_render_bundle(
+    draw_list, bundle_enc,
+    WGPU_GLTF_RenderFlags_DepthOnly | WGPU_GLTF_RenderFlags_RenderOpaqueNodes);
+}
+
+static void record_blended_bundle(WGPURenderBundleEncoder bundle_enc,
+                                  void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  wgpuRenderBundleEncoderSetBindGroup(bundle_enc, 0, bind_groups.ubo_scene, 0,
+                                      0);
+  wgpu_gltf_draw_list_record_render_bundle(
+    draw_list, bundle_enc, WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes);
+}
+
+static void record_scene_bundles(wgpu_context_t* wgpu_context)
+{
+  // The draw list is sorted before the jobs read it
+  wgpu_gltf_draw_list_sort_opaque(draw_list, ubo_scene.view_pos);
+  wgpu_gltf_draw_list_sort_blended(draw_list, ubo_scene.view_pos);
+
+  // Same attachment formats as the depth pre-pass and the scene pass
+  const WGPUTextureFormat motion_vector_formats[1]
+    = {WGPU_TEMPORAL_AA_MOTION_VECTOR_FORMAT};
+  const WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
+  const WGPUTextureFormat depth_format
+    = wgpu_get_default_depth_stencil_format(wgpu_context);
+  wgpu_parallel_bundle_desc_t bundle_desc = {
+    .color_format_count   = (uint32_t)ARRAY_SIZE(motion_vector_formats),
+    .color_formats        = motion_vector_formats,
+    .depth_stencil_format = depth_format,
+  };
+
+  wgpu_parallel_recorder_t* recorder = parallel_recording.recorder;
+  wgpu_parallel_recorder_reset(recorder);
+  bundle_desc.label       = "Depth pre-pass render bundle";
+  bundle_desc.record_func = record_depth_prepass_bundle;
+  parallel_recording.depth_prepass_job
+    = wgpu_parallel_recorder_add_render_bundle(recorder, &bundle_desc);
+  bundle_desc.color_format_count = (uint32_t)ARRAY_SIZE(color_formats);
+  bundle_desc.color_formats      = color_formats;
+  bundle_desc.label              = "Alpha blended render bundle";
+  bundle_desc.record_func        = record_blended_bundle;
+  parallel_recording.blended_job
+    = wgpu_parallel_recorder_add_render_bundle(recorder, &bundle_desc);
+  wgpu_parallel_recorder_record(recorder);
+}
+
+// Depth pre-pass at the dynamic resolution scale, lays down the depth and the
+// motion vectors of the opaque parts of the scene front-to-back
+static void record_depth_prepass(wgpu_frame_graph_t* graph,
+                                 wgpu_frame_graph_pass_encoder_t encoder,
+                                 void* user_data)
+{
+  UNUSED_VAR(graph);
+  UNUSED_VAR(user_data);
+
+  const WGPURenderBundle bundle = wgpu_parallel_recorder_get_render_bundle(
+    parallel_recording.recorder, parallel_recording.depth_prepass_job);
+  wgpuRenderPassEncoderExecuteBundles(encoder.render, 1, &bundle);
+}
+
+// Scene pass at the dynamic resolution scale, the default viewport covers the
+// scaled target
+static void record_scene_pass(wgpu_frame_graph_t* graph,
+                              wgpu_frame_graph_pass_encoder_t encoder,
+                              void* user_data)
+{
+  UNUSED_VAR(graph);
+  wgpu_example_context_t* context = (wgpu_example_context_t*)user_data;
+  wgpu_pipeline_statistics_t* statistics
+    = context->wgpu_context->pipeline_statistics;
+
+  // Draw the opaque and alpha masked parts and the alpha blended parts
+  const WGPURenderBundle bundles[2] = {
+    render_bundle,
+    wgpu_parallel_recorder_get_render_bundle(parallel_recording.recorder,
+                                             parallel_recording.blended_job),
+  };
+  wgpu_pipeline_statistics_begin_render_pass(statistics, encoder.render,
+                                             "Scene");
+  wgpuRenderPassEncoderExecuteBundles(encoder.render,
+                                      (uint32_t)ARRAY_SIZE(bundles), bundles);
+  wgpu_pipeline_statistics_end_render_pass(statistics, encoder.render);
+}
+
+// Temporal resolve of the scene at the full resolution
+static void record_temporal_aa_pass(wgpu_frame_graph_t* graph,
+                                    wgpu_frame_graph_pass_encoder_t encoder,
+                                    void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  wgpu_temporal_aa_inputs_t inputs = {
+    .color = wgpu_frame_graph_get_texture_view(graph, frame_graph.scene_color),
+    .depth = wgpu_frame_graph_get_texture_view(graph, frame_graph.scene_depth),
+    .motion_vectors
+    = wgpu_frame_graph_get_texture_view(graph, frame_graph.motion_vectors),
+  };
+  wgpu_temporal_aa_resolve(temporal_aa, encoder.compute, &inputs);
+}
+
+// Upscale pass of the scene or the temporal resolve into the frame buffer
+static void record_upscale_pass(wgpu_frame_graph_t* graph,
+                                wgpu_frame_graph_pass_encoder_t encoder,
+                                void* user_data)
 {
-  // Set target frame buffer
-  rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
+  wgpu_example_context_t* context = (wgpu_example_context_t*)user_data;
+  wgpu_dynamic_resolution_upscale(
+    context->dynamic_resolution, encoder.render,
+    wgpu_frame_graph_get_texture_view(graph, settings.temporal_aa ?
+                                               frame_graph.taa_output :
+                                               frame_graph.scene_color));
+}
+
+static void declare_frame_graph(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  wgpu_frame_graph_t* graph    = frame_graph.graph;
+  const float scale
+    = wgpu_dynamic_resolution_get_scale(context->dynamic_resolution);
+  wgpu_frame_graph_begin(graph);
+
+  frame_graph.scene_color = wgpu_frame_graph_create_texture(
+    graph, &(wgpu_frame_graph_texture_desc_t){
+             .label  = "Scene color texture",
+             .format = wgpu_context->swap_chain.format,
+             .scale  = scale,
+           });
+  frame_graph.scene_depth = wgpu_frame_graph_create_texture(
+    graph, &(wgpu_frame_graph_texture_desc_t){
+             .label  = "Scene depth texture",
+             .format = wgpu_get_default_depth_stencil_format(wgpu_context),
+             .scale  = scale,
+           });
+  frame_graph.motion_vectors = wgpu_frame_graph_create_texture(
+    graph, &(wgpu_frame_graph_texture_desc_t){
+             .label  = "Motion vector texture",
+             .format = WGPU_TEMPORAL_AA_MOTION_VECTOR_FORMAT,
+             .scale  = scale,
+           });
+  const wgpu_frame_graph_resource_t frame_buffer
+    = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Frame buffer",
+               .view   = wgpu_context->swap_chain.frame_buffer,
+               .format = wgpu_context->swap_chain.format,
+             });
+
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Depth pre-pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_graph.motion_vectors,
+               .clear_value = (WGPUColor){0.0f, 0.0f, 0.0f, 0.0f},
+             },
+             .depth_stencil_attachment = frame_graph.scene_depth,
+             .execute_func             = record_depth_prepass,
+           });
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Scene pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_graph.scene_color,
+               .clear_value = (WGPUColor){0.25f, 0.25f, 0.25f, 1.0f},
+             },
+             .depth_stencil_attachment = frame_graph.scene_depth,
+             .execute_func             = record_scene_pass,
+             .user_data                = context,
+           });
+
+  wgpu_frame_graph_resource_t upscale_source = frame_graph.scene_color;
+  if (settings.temporal_aa) {
+    frame_graph.taa_output = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Temporal AA output",
+               .view   = wgpu_temporal_aa_get_output_view(temporal_aa),
+               .format = WGPU_TEMPORAL_AA_OUTPUT_FORMAT,
+             });
+    wgpu_frame_graph_add_pass(
+      graph, &(wgpu_frame_graph_pass_desc_t){
+               .label        = "Temporal AA",
+               .type         = FrameGraph_PassType_Compute,
+               .read_count   = 3,
+               .reads        = {frame_graph.scene_color,
+                                frame_graph.scene_depth,
+                                frame_graph.motion_vectors},
+               .write_count  = 1,
+               .writes[0]    = frame_graph.taa_output,
+               .execute_func = record_temporal_aa_pass,
+             });
+    upscale_source = frame_graph.taa_output;
+  }
+
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Upscale pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_buffer,
+               .clear_value = (WGPUColor){0.0f, 0.0f, 0.0f, 1.0f},
+             },
+             .read_count   = 1,
+             .reads[0]     = upscale_source,
+             .execute_func = record_upscale_pass,
+             .user_data    = context,
+           });
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Temporal AA",
+                               &settings.temporal_aa)) {
+      // The temporal resolve upscales from a lower render scale
+      wgpu_dynamic_resolution_set_scale_range(
+        context->dynamic_resolution, 0.5f, settings.temporal_aa ? 0.75f : 1.0f);
+      wgpu_temporal_aa_reset(temporal_aa);
+    }
+  }
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
 
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Create render pass encoder for encoding drawing commands
-  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-    wgpu_context->cmd_enc, &render_pass_desc);
+  // Visible meshlets of all passes drawing the scene
+  wgpu_gltf_model_cull_meshlets(gltf_model, wgpu_context->cmd_enc,
+                                ubo_scene.view_projection, ubo_scene.view_pos,
+                                NULL);
 
-  // Set the bind group
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                    bind_groups.ubo_scene, 0, 0);
-
-  // Set viewport
-  wgpuRenderPassEncoderSetViewport(
-    wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
-    (float)wgpu_context->surface.height, 0.0f, 1.0f);
-
-  // Set scissor rectangle
-  wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                      wgpu_context->surface.width,
-                                      wgpu_context->surface.height);
-
-  // Draw plane
-  static wgpu_gltf_render_flags_enum_t render_flags
-    = WGPU_GLTF_RenderFlags_BindImages;
-  wgpu_gltf_model_draw(gltf_model, (wgpu_gltf_model_render_options_t){
-                                     .render_flags        = render_flags,
-                                     .bind_image_set      = 1,
-                                     .bind_mesh_model_set = 2,
-                                   });
-
-  // End render pass
-  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  // Scene, temporal resolve and upscale pass
+  record_scene_bundles(wgpu_context);
+  declare_frame_graph(context);
+  wgpu_frame_graph_execute(frame_graph.graph, wgpu_context->cmd_enc);
+
+  // Draw ui overlay
+  draw_ui(context, example_on_update_ui_overlay);
 
   // Get command buffer
   WGPUCommandBuffer command_buffer
@@ -522,11 +937,17 @@ static int example_draw(wgpu_example_context_t* context)
   // Prepare frame
   prepare_frame(context);
 
+  // The projection is jittered every frame and the motion vectors need the
+  // view projection of the previous frame, so the uniforms are updated once
+  // per frame instead of on view changes
+  update_jitter(context);
+  update_uniform_buffers(context);
+
   // Command buffer to be submitted to the queue
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   // Submit to queue
   submit_command_buffers(context);
@@ -545,14 +966,13 @@ static int example_render(wgpu_example_context_t* context)
   return example_draw(context);
 }
 
-static void example_on_view_changed(wgpu_example_context_t* context)
-{
-  update_uniform_buffers(context);
-}
-
 static void example_destroy(wgpu_example_context_t* context)
 {
   camera_release(context->camera);
+  if (gltf_model_loader != NULL) {
+    // Closed while loading
+    gltf_model = wgpu_gltf_model_loader_finish(gltf_model_loader);
+  }
   wgpu_gltf_model_destroy(gltf_model);
 
   WGPU_RELEASE_RESOURCE(Buffer, ubo_buffers.ubo_scene.buffer)
@@ -568,6 +988,12 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.ubo_scene)
 
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
+  wgpu_gltf_draw_list_release(draw_list);
+  wgpu_parallel_recorder_destroy(parallel_recording.recorder);
+
+  wgpu_frame_graph_destroy(frame_graph.graph);
+  wgpu_temporal_aa_destroy(temporal_aa);
 }
 
 void example_gltf_scene_rendering(int argc, char* argv[])
@@ -575,12 +1001,14 @@ void example_gltf_scene_rendering(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title = example_title,
+      .title              = example_title,
+      .overlay            = true,
+      .reversed_z         = true,
+      .dynamic_resolution = true,
     },
-    .example_initialize_func      = &example_initialize,
-    .example_render_func          = &example_render,
-    .example_destroy_func         = &example_destroy,
-    .example_on_view_changed_func = &example_on_view_changed,
+    .example_initialize_func = &example_initialize,
+    .example_render_func     = &example_render,
+    .example_destroy_func    = &example_destroy,
   });
   // clang-format on
 }
@@ -1,6 +1,8 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../webgpu/gltf_model.h"
@@ -11,7 +13,10 @@
  * WebGPU Example - glTF Vertex Skinning
  *
  * Shows how to load and display an animated scene from a glTF file using vertex
- * skinning.
+ * skinning. The vertices are skinned by the compute pre-pass of the glTF model
+ * (WGPU_GLTF_FileLoadingFlags_ComputeSkinning) once per frame, the vertex
+ * shader only applies the mesh and camera matrices. The images of the model are
+ * packed into texture arrays, its materials share one bind group.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfskinning/gltfskinning.cpp
@@ -38,7 +43,6 @@ static struct {
 static struct {
   WGPUBindGroupLayout ubo_scene;
   WGPUBindGroupLayout ubo_primitive;
-  WGPUBindGroupLayout joint_matrices;
   WGPUBindGroupLayout textures;
 } bind_group_layouts;
 
@@ -55,10 +59,72 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } render_pass;
 
+// Animation time of the first animation, wrapped at its last keyframe
+static float animation_timer = 0.0f;
+
 // Other variables
 static const char* example_title = "glTF Vertex Skinning";
 static bool prepared             = false;
 
+// Shaders, prefixed with the packed textures prelude of group 2
+// clang-format off
+static const char* skinned_model_shader_wgsl = CODE(
+  struct UBOScene {
+    projection : mat4x4<f32>,
+    view : mat4x4<f32>,
+    lightPos : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> uboScene : UBOScene;
+  @group(1) @binding(0) var<uniform> primitiveModel : mat4x4<f32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+    @location(1) color : vec3<f32>,
+    @location(2) uv : vec2<f32>,
+    @location(3) viewVec : vec3<f32>,
+    @location(4) lightVec : vec3<f32>,
+  }
+
+  @vertex
+  fn vs_main(
+    @location(0) inPos : vec3<f32>,
+    @location(1) inNormal : vec3<f32>,
+    @location(2) inUV : vec2<f32>,
+    @location(3) inColor : vec4<f32>
+  ) -> VertexOutput {
+    // Position and normal are already skinned in mesh space
+    let viewModel = uboScene.view * primitiveModel;
+    let pos = viewModel * vec4<f32>(inPos, 1.0);
+    let viewModel3 = mat3x3<f32>(viewModel[0].xyz, viewModel[1].xyz,
+                                 viewModel[2].xyz);
+    var output : VertexOutput;
+    output.position = uboScene.projection * pos;
+    output.normal = viewModel3 * inNormal;
+    output.color = inColor.rgb;
+    output.uv = inUV;
+    output.lightVec = (uboScene.view * uboScene.lightPos).xyz - pos.xyz;
+    output.viewVec = -pos.xyz;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let color = gltf_sample_packed(gltf_packed_material.base_color, input.uv,
+                                   vec4<f32>(1.0))
+                * vec4<f32>(input.color, 1.0);
+    let N = normalize(input.normal);
+    let L = normalize(input.lightVec);
+    let V = normalize(input.viewVec);
+    let R = reflect(-L, N);
+    let diffuse = max(dot(N, L), 0.5) * input.color;
+    let specular = pow(max(dot(R, V), 0.0), 16.0) * vec3<f32>(0.75);
+    return vec4<f32>(diffuse * color.rgb + specular, 1.0);
+  }
+);
+// clang-format on
+
 static void setup_camera(wgpu_example_context_t* context)
 {
   context->camera         = camera_create();
@@ -72,7 +138,9 @@ static void setup_camera(wgpu_example_context_t* context)
 
 static void load_assets(wgpu_context_t* wgpu_context)
 {
-  const uint32_t gltf_loading_flags = WGPU_GLTF_FileLoadingFlags_None;
+  const uint32_t gltf_loading_flags
+    = WGPU_GLTF_FileLoadingFlags_ComputeSkinning
+      | WGPU_GLTF_FileLoadingFlags_PackTextures;
   gltf_model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
     .wgpu_context       = wgpu_context,
     .filename           = "models/CesiumMan/glTF/CesiumMan.gltf",
@@ -133,53 +201,11 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(bind_group_layouts.ubo_primitive != NULL);
   }
 
-  // Bind group layout to pass skin joint matrices to the shader
+  // Bind group layout for the packed material textures
   {
-    WGPUBindGroupLayoutEntry bgl_entries[1] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Uniform buffer (Vertex shader) => JointMatrices
-        .binding = 0,
-        .visibility = WGPUShaderStage_Vertex,
-        .buffer = (WGPUBufferBindingLayout){
-          .type = WGPUBufferBindingType_Storage,
-          .minBindingSize = sizeof(mat4),
-        },
-        .sampler = {0},
-      },
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-      .entries    = bgl_entries,
-    };
-    bind_group_layouts.ubo_scene
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(bind_group_layouts.ubo_scene != NULL);
-  }
-
-  // Bind group layout for passing material textures
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[2] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: texture2D (Fragment shader) => Color map
-        .binding = 0,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-          .multisampled = false,
-        },
-        .storageTexture = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: sampler (Fragment shader) => Color map
-        .binding = 1,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type=WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      },
-    };
+    WGPUBindGroupLayoutEntry
+      bgl_entries[WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT];
+    wgpu_gltf_get_packed_textures_bind_group_layout_entries(bgl_entries);
     WGPUBindGroupLayoutDescriptor bgl_desc = {
       .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
       .entries    = bgl_entries,
@@ -194,13 +220,11 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     // The pipeline layout uses three sets:
     // Set 0 = Scene matrices (VS)
     // Set 1 = Primitive matrices (VS)
-    // Set 2 = Joint matrices (VS)
-    // Set 3 = Material texture (FS)
-    WGPUBindGroupLayout bind_group_layout_sets[4] = {
-      bind_group_layouts.ubo_scene,      // set 0
-      bind_group_layouts.ubo_primitive,  // set 1
-      bind_group_layouts.joint_matrices, // set 2
-      bind_group_layouts.textures,       // set 3
+    // Set 2 = Packed material textures (FS)
+    WGPUBindGroupLayout bind_group_layout_sets[3] = {
+      bind_group_layouts.ubo_scene,     // set 0
+      bind_group_layouts.ubo_primitive, // set 1
+      bind_group_layouts.textures,      // set 2
     };
     // Pipeline layout
     WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
@@ -271,40 +295,10 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
                                              bind_group_layouts.ubo_primitive);
   }
 
-  // Bind group for glTF model skin joint matrices
-  {
-    wgpu_gltf_model_prepare_skins_bind_group(gltf_model,
-                                             bind_group_layouts.joint_matrices);
-  }
-
-  // Bind group for materials
+  // Bind group shared by all materials, bound with the offset of the material
   {
-    wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
-    for (uint32_t i = 0; i < materials.material_count; ++i) {
-      wgpu_gltf_material_t* material = &materials.materials[i];
-      if (material->base_color_texture) {
-        WGPUBindGroupEntry bg_entries[2] = {
-            [0] = (WGPUBindGroupEntry) {
-              // Binding 0: texture2D (Fragment shader) => Color map
-              .binding = 0,
-              .textureView = material->base_color_texture->wgpu_texture.view,
-            },
-            [1] = (WGPUBindGroupEntry) {
-              // Binding 1: sampler (Fragment shader) => Color map
-              .binding = 1,
-              .sampler =  material->base_color_texture->wgpu_texture.sampler,
-            },
-          };
-        material->bind_group = wgpuDeviceCreateBindGroup(
-          wgpu_context->device,
-          &(WGPUBindGroupDescriptor){
-            .layout     = bind_group_layouts.textures,
-            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-            .entries    = bg_entries,
-          });
-        ASSERT(material->bind_group != NULL)
-      }
-    }
+    wgpu_gltf_model_prepare_packed_textures_bind_group(
+      gltf_model, bind_group_layouts.textures);
   }
 }
 
@@ -339,6 +333,10 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
 
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
 {
+  // Model shader, the fragment shader samples the packed textures
+  char* model_wgsl
+    = wgpu_gltf_create_packed_textures_wgsl(2, skinned_model_shader_wgsl);
+
   // Primitive state
   WGPUPrimitiveState primitive_state_desc = {
     .topology  = WGPUPrimitiveTopology_TriangleList,
@@ -361,7 +359,8 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
       .depth_write_enabled = true,
     });
 
-  // Vertex buffer layout
+  // Vertex buffer layout, the joints and weights are consumed by the compute
+  // skinning pass
   WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
     gltf_scene,
     // Location 0: Position
@@ -371,18 +370,15 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     // Location 2: Texture coordinates
     WGPU_GLTF_VERTATTR_DESC(2, WGPU_GLTF_VertexComponent_UV),
     // Location 3: Vertex color
-    WGPU_GLTF_VERTATTR_DESC(3, WGPU_GLTF_VertexComponent_Color),
-    // Location 4: Per-Vertex Joint indices
-    WGPU_GLTF_VERTATTR_DESC(4, WGPU_GLTF_VertexComponent_Joint0),
-    // Location 5: Per-Vertex Joint weights
-    WGPU_GLTF_VERTATTR_DESC(5, WGPU_GLTF_VertexComponent_Weight0));
+    WGPU_GLTF_VERTATTR_DESC(3, WGPU_GLTF_VertexComponent_Color));
 
   // Vertex state
   WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
             wgpu_context, &(wgpu_vertex_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Vertex shader SPIR-V
-              .file = "shaders/gltf_skinning/skinnedmodel.vert.spv",
+              // Vertex shader WGSL
+              .wgsl_code.source = model_wgsl,
+              .entry            = "vs_main",
             },
             .buffer_count = 1,
             .buffers = &gltf_scene_vertex_buffer_layout,
@@ -392,8 +388,9 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUFragmentState fragment_state_desc = wgpu_create_fragment_state(
             wgpu_context, &(wgpu_fragment_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Fragment shader SPIR-V
-              .file = "shaders/gltf_skinning/skinnedmodel.frag.spv",
+              // Fragment shader WGSL
+              .wgsl_code.source = model_wgsl,
+              .entry            = "fs_main",
             },
             .target_count = 1,
             .targets = &color_target_state_desc,
@@ -417,6 +414,8 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
                             .depthStencil = &depth_stencil_state_desc,
                             .multisample  = multisample_state_desc,
                           });
+  ASSERT(solid_pipeline != NULL);
+  free(model_wgsl);
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
@@ -456,10 +455,16 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Skin the vertices of the current animation frame
+  wgpu_gltf_model_compute_skinning(gltf_model, wgpu_context->cmd_enc);
+
   // Create render pass encoder for encoding drawing commands
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass.descriptor);
 
+  // Bind the rendering pipeline
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, solid_pipeline);
+
   // Set the bind group
   wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
                                     bind_groups.ubo_scene, 0, 0);
@@ -474,17 +479,17 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
-  // Draw plane
+  // Draw model
   static wgpu_gltf_render_flags_enum_t render_flags
     = WGPU_GLTF_RenderFlags_BindImages;
   wgpu_gltf_model_draw(gltf_model, (wgpu_gltf_model_render_options_t){
                                      .render_flags        = render_flags,
                                      .bind_mesh_model_set = 1,
-                                     .bind_image_set      = 3,
+                                     .bind_image_set      = 2,
                                    });
 
   // End render pass
-  wgpuRenderPassEncoderEndPass(wgpu_context->rpass_enc);
+  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
   // Draw ui overlay
@@ -528,7 +533,14 @@ static int example_render(wgpu_example_context_t* context)
     update_uniform_buffers(context);
   }
   if (!context->paused) {
-    // gltf_model_update_animation(gltf_model, 0, context->frame_timer);
+    animation_timer += context->frame_timer;
+    const float animation_end = gltf_model_get_animation_end(gltf_model, 0);
+    if (animation_timer > animation_end) {
+      animation_timer = animation_end > 0.0f ?
+                          fmodf(animation_timer, animation_end) :
+                          0.0f;
+    }
+    gltf_model_update_animation(gltf_model, 0, animation_timer);
   }
   return draw_result;
 }
@@ -541,7 +553,6 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, shader_data.ubo_scene_matrices.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_scene)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_primitive)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.joint_matrices)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.textures)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.ubo_scene)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
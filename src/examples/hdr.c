@@ -3,6 +3,8 @@
 
 #include <string.h>
 
+#include "../webgpu/auto_exposure.h"
+#include "../webgpu/bloom.h"
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
 
@@ -11,7 +13,20 @@
  *
  * Implements a high dynamic range rendering pipeline using 16/32 bit floating
  * point precision for all internal formats, textures and calculations,
- * including a bloom pass, manual exposure and tone mapping.
+ * including a bloom pass, manual exposure and tone mapping. The bright parts
+ * of the G-Buffer pass are filtered by the shared downsample / upsample bloom
+ * and added to the frame buffer by its composite pass.
+ *
+ * The format of the HDR offscreen targets can be selected, rgba32float moves
+ * twice the bytes of rgba16float per texel, which is a significant part of
+ * the frame at 4K. The compute composite path fuses a bloom filter and the
+ * composition into one dispatch, the bright texels are blurred in workgroup
+ * memory instead of a mip chain. The estimated bytes moved per frame are shown
+ * in the statistics.
+ *
+ * With auto exposure the exposure adapts to the average scene luminance of a
+ * GPU luminance histogram of the G-Buffer pass, the adapted exposure is copied
+ * into the parameters of the next frame without a readback.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/hdr
@@ -20,8 +35,33 @@
 #define NUMBER_OF_CONSTANTS 3
 #define ALIGNMENT 256 // 256-byte alignment
 
-static bool bloom          = false;
-static bool display_skybox = true;
+static bool bloom             = false;
+static bool display_skybox    = true;
+static bool compute_composite = false;
+static bool auto_exposure_on  = false;
+
+static wgpu_auto_exposure_t* auto_exposure = NULL;
+static wgpu_bloom_t* bloom_filter          = NULL;
+
+// HDR offscreen formats
+static struct {
+  WGPUTextureFormat format;
+  uint32_t bytes_per_texel;
+  // Render attachment format in core WebGPU
+  bool renderable;
+  bool blendable;
+} hdr_formats[3] = {
+  // clang-format off
+  { .format = WGPUTextureFormat_RGBA16Float,   .bytes_per_texel = 8,  .renderable = true,  .blendable = true  },
+  { .format = WGPUTextureFormat_RG11B10Ufloat, .bytes_per_texel = 4,  .renderable = false, .blendable = false },
+  { .format = WGPUTextureFormat_RGBA32Float,   .bytes_per_texel = 16, .renderable = true,  .blendable = false },
+  // clang-format on
+};
+static const char* hdr_format_names[3]
+  = {"rgba16float", "rg11b10ufloat", "rgba32float"};
+static int32_t hdr_format_index = 0;
+// Format of the created targets, after the fallback of unrenderable formats
+static int32_t active_hdr_format_index = 0;
 
 static struct {
   texture_t envmap;
@@ -79,26 +119,22 @@ static struct {
   WGPURenderPipeline skybox;
   WGPURenderPipeline reflect;
   WGPURenderPipeline composition;
-  WGPURenderPipeline bloom[2];
 } pipelines = {0};
 
 static struct {
   WGPUPipelineLayout models;
   WGPUPipelineLayout composition;
-  WGPUPipelineLayout bloom_filter;
 } pipeline_layouts = {0};
 
 static struct {
   WGPUBindGroup object;
   WGPUBindGroup skybox;
   WGPUBindGroup composition;
-  WGPUBindGroup bloom_filter;
 } bind_groups = {0};
 
 static struct {
   WGPUBindGroupLayout models;
   WGPUBindGroupLayout composition;
-  WGPUBindGroupLayout bloom_filter;
 } bind_group_layouts = {0};
 
 typedef enum wgpu_render_pass_attachment_type_t {
@@ -125,24 +161,119 @@ static struct {
   WGPUSampler sampler;
 } offscreen_pass = {0};
 
+// Fused bloom filter & composition compute pass
 static struct {
-  uint32_t width, height;
-  frame_buffer_attachment_t color[1];
-  struct {
-    WGPURenderPassColorAttachment color_attachment[1];
-    WGPURenderPassDescriptor render_pass_descriptor;
-  } render_pass_desc;
-  WGPUSampler sampler;
-} filter_pass = {0};
+  frame_buffer_attachment_t output;
+  wgpu_buffer_t params;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+  WGPUBindGroup bind_group;
+  // Copies the output into the frame buffer
+  WGPUBindGroup composition_bind_group;
+} composite_pass = {0};
+
+static struct {
+  uint32_t bloom;
+  float blur_strength;
+  uint32_t padding[2];
+} composite_params = {
+  .blur_strength = 1.5f,
+};
+
+// Estimated bytes read and written by the passes of a frame
+static uint64_t frame_traffic_bytes = 0;
 
 static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
 static WGPURenderPassDescriptor render_pass_desc;
 
-static WGPUTextureFormat depth_format = WGPUTextureFormat_Depth24PlusStencil8;
+// The offscreen depth is not sampled and has no stencil
+static WGPUTextureFormat depth_format = WGPUTextureFormat_Depth24Plus;
 
 static const char* example_title = "High Dynamic Range Rendering";
 static bool prepared             = false;
 
+// Shaders
+// clang-format off
+static const char* composite_shader_wgsl = CODE(
+  const TILE_SIZE = 16;
+  const RADIUS = 4;
+  // TILE_SIZE + 2 * RADIUS
+  const APRON_SIZE = 24;
+
+  struct Params {
+    bloom : u32,
+    blurStrength : f32,
+  }
+
+  @group(0) @binding(0) var sceneTexture : texture_2d<f32>;
+  @group(0) @binding(1) var brightTexture : texture_2d<f32>;
+  @group(0) @binding(2) var outputTexture :
+    texture_storage_2d<rgba8unorm, write>;
+  @group(0) @binding(3) var<uniform> params : Params;
+
+  // Bright texels of the tile and its apron
+  var<workgroup> bright : array<array<vec3<f32>, APRON_SIZE>, APRON_SIZE>;
+  // Vertically blurred rows of the tile
+  var<workgroup> blurred : array<array<vec3<f32>, APRON_SIZE>, TILE_SIZE>;
+
+  fn weight(i : i32) -> f32 {
+    var weights = array<f32, 5>(0.227027, 0.1945946, 0.1216216, 0.054054,
+                                0.016216);
+    return weights[i];
+  }
+
+  @compute @workgroup_size(16, 16)
+  fn main(@builtin(workgroup_id) workgroupId : vec3<u32>,
+          @builtin(local_invocation_id) localId : vec3<u32>,
+          @builtin(local_invocation_index) localIndex : u32) {
+    let size = vec2<i32>(textureDimensions(sceneTexture));
+    let tileOrigin = vec2<i32>(workgroupId.xy) * TILE_SIZE;
+    let local = vec2<i32>(localId.xy);
+
+    var bloomColor = vec3<f32>(0.0);
+    if (params.bloom != 0u) {
+      // Load the bright texels once, clamped to the edge
+      for (var i = i32(localIndex); i < APRON_SIZE * APRON_SIZE; i += 256) {
+        let t = vec2<i32>(i % APRON_SIZE, i / APRON_SIZE);
+        let p = clamp(tileOrigin - RADIUS + t, vec2<i32>(0), size - 1);
+        bright[t.y][t.x] = textureLoad(brightTexture, p, 0).rgb;
+      }
+      workgroupBarrier();
+
+      // Vertical bloom filter pass
+      for (var i = i32(localIndex); i < TILE_SIZE * APRON_SIZE; i += 256) {
+        let x = i % APRON_SIZE;
+        let y = i / APRON_SIZE + RADIUS;
+        var sum = bright[y][x] * weight(0);
+        for (var k = 1; k <= RADIUS; k++) {
+          sum += (bright[y - k][x] + bright[y + k][x]) * weight(k)
+                 * params.blurStrength;
+        }
+        blurred[y - RADIUS][x] = sum;
+      }
+      workgroupBarrier();
+
+      // Horizontal bloom filter pass
+      let x = local.x + RADIUS;
+      bloomColor = blurred[local.y][x] * weight(0);
+      for (var k = 1; k <= RADIUS; k++) {
+        bloomColor += (blurred[local.y][x - k] + blurred[local.y][x + k])
+                      * weight(k) * params.blurStrength;
+      }
+    }
+
+    let pixel = tileOrigin + local;
+    if (pixel.x >= size.x || pixel.y >= size.y) {
+      return;
+    }
+    // The scene is tone mapped by the G-Buffer pass, the bloom is added
+    let color = textureLoad(sceneTexture, pixel, 0).rgb + bloomColor;
+    textureStore(outputTexture, pixel, vec4<f32>(color, 1.0));
+  }
+);
+// clang-format on
+
 static void setup_camera(wgpu_example_context_t* context)
 {
   context->camera       = camera_create();
@@ -242,9 +373,24 @@ void create_attachment(wgpu_context_t* wgpu_context, const char* texture_label,
   ASSERT(attachment->texture_view);
 }
 
+// Selected HDR format, unrenderable formats fall back to rgba16float
+static int32_t get_hdr_format_index(void)
+{
+  if (!hdr_formats[hdr_format_index].renderable) {
+    log_warn("%s is not a render attachment format, using %s",
+             hdr_format_names[hdr_format_index], hdr_format_names[0]);
+    return 0;
+  }
+  return hdr_format_index;
+}
+
 // Prepare a new framebuffer and attachments for offscreen rendering (G-Buffer)
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
 {
+  active_hdr_format_index = get_hdr_format_index();
+  const WGPUTextureFormat hdr_format
+    = hdr_formats[active_hdr_format_index].format;
+
   {
     offscreen_pass.width  = wgpu_context->surface.width;
     offscreen_pass.height = wgpu_context->surface.height;
@@ -252,12 +398,12 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
     /* Color attachments */
 
     // Two floating point color buffers
-    create_attachment(
-      wgpu_context, "offscreen_color_tex_1", WGPUTextureFormat_RGBA8Unorm,
-      WGPU_RENDER_PASS_COLOR_ATTACHMENT_TYPE, &offscreen_pass.color[0]);
-    create_attachment(
-      wgpu_context, "offscreen_color_tex_2", WGPUTextureFormat_RGBA8Unorm,
-      WGPU_RENDER_PASS_COLOR_ATTACHMENT_TYPE, &offscreen_pass.color[1]);
+    create_attachment(wgpu_context, "offscreen_color_tex_1", hdr_format,
+                      WGPU_RENDER_PASS_COLOR_ATTACHMENT_TYPE,
+                      &offscreen_pass.color[0]);
+    create_attachment(wgpu_context, "offscreen_color_tex_2", hdr_format,
+                      WGPU_RENDER_PASS_COLOR_ATTACHMENT_TYPE,
+                      &offscreen_pass.color[1]);
     // Depth attachment
     create_attachment(wgpu_context, "offscreen_tex_depth", depth_format,
                       WGPU_RENDER_PASS_DEPTH_STENCIL_ATTACHMENT_TYPE,
@@ -281,16 +427,13 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
         };
     }
 
-    /* Depth stencil attachment */
+    /* Depth attachment, only used by the pass */
     offscreen_pass.render_pass_desc.depth_stencil_attachment
       = (WGPURenderPassDepthStencilAttachment){
-        .view           = offscreen_pass.depth.texture_view,
-        .depthLoadOp    = WGPULoadOp_Clear,
-        .depthStoreOp   = WGPUStoreOp_Store,
-        .clearDepth     = 1.0f,
-        .stencilLoadOp  = WGPULoadOp_Clear,
-        .stencilStoreOp = WGPUStoreOp_Store,
-        .clearStencil   = 0,
+        .view         = offscreen_pass.depth.texture_view,
+        .depthLoadOp  = WGPULoadOp_Clear,
+        .depthStoreOp = WGPUStoreOp_Discard,
+        .clearDepth   = 1.0f,
       };
 
     // Render pass descriptor
@@ -310,63 +453,77 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
                               .addressModeW  = WGPUAddressMode_ClampToEdge,
                               .minFilter     = WGPUFilterMode_Nearest,
                               .magFilter     = WGPUFilterMode_Nearest,
-                              .mipmapFilter  = WGPUFilterMode_Linear,
+                              .mipmapFilter  = WGPUFilterMode_Nearest,
                               .lodMinClamp   = 0.0f,
                               .lodMaxClamp   = 1.0f,
                               .maxAnisotropy = 1,
                             });
   }
 
-  // Bloom separable filter pass
+  // Bloom of the bright parts, added to the frame buffer by the composite
+  // pass. The bright parts are thresholded by the G-Buffer pass.
   {
-    filter_pass.width  = wgpu_context->surface.width;
-    filter_pass.height = wgpu_context->surface.height;
-
-    // Color attachments
-
-    // Floating point color buffer
-    create_attachment(
-      wgpu_context, "bloom_color_tex", WGPUTextureFormat_RGBA8Unorm,
-      WGPU_RENDER_PASS_COLOR_ATTACHMENT_TYPE, &filter_pass.color[0]);
+    // rgba32float is not filterable without the float32-filterable feature
+    const bool unfilterable = hdr_format == WGPUTextureFormat_RGBA32Float;
+    bloom_filter            = wgpu_bloom_create(
+      wgpu_context,
+      &(wgpu_bloom_desc_t){
+        .label                          = "Bloom mip chain",
+        .width                          = offscreen_pass.width,
+        .height                         = offscreen_pass.height,
+        .composite_format               = wgpu_context->swap_chain.format,
+        .composite_depth_stencil_format = WGPUTextureFormat_Depth24PlusStencil8,
+        .unfilterable_source            = unfilterable,
+      });
+    wgpu_bloom_set_params(bloom_filter, &(wgpu_bloom_params_t){
+                                          .threshold = 0.0f,
+                                          .knee      = 0.0f,
+                                          .radius    = 1.0f,
+                                          .intensity = 1.0f,
+                                        });
+  }
 
-    // Init attachment properties
+  // Fused bloom filter & composition output
+  {
+    WGPUTextureDescriptor texture_desc = {
+      .label         = "composite_output_tex",
+      .usage         = WGPUTextureUsage_StorageBinding
+               | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = wgpu_context->surface.width,
+        .height             = wgpu_context->surface.height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = WGPUTextureFormat_RGBA8Unorm,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    };
+    composite_pass.output.format = texture_desc.format;
+    composite_pass.output.texture
+      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+    ASSERT(composite_pass.output.texture);
+    composite_pass.output.texture_view
+      = wgpuTextureCreateView(composite_pass.output.texture, NULL);
+    ASSERT(composite_pass.output.texture_view);
+  }
+}
 
-    // Color attachment
-    filter_pass.render_pass_desc.color_attachment[0]
-          = (WGPURenderPassColorAttachment) {
-            .view       = filter_pass.color[0].texture_view,
-            .loadOp     = WGPULoadOp_Clear,
-            .storeOp    = WGPUStoreOp_Store,
-            .clearColor = (WGPUColor) {
-              .r = 0.0f,
-              .g = 0.0f,
-              .b = 0.0f,
-              .a = 0.0f,
-            },
-        };
+static void release_offscreen(void)
+{
+  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color[0].texture)
+  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color[1].texture)
+  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.depth.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color[0].texture_view)
+  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color[1].texture_view)
+  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.depth.texture_view)
+  WGPU_RELEASE_RESOURCE(Sampler, offscreen_pass.sampler)
 
-    // Render pass descriptor
-    filter_pass.render_pass_desc.render_pass_descriptor
-      = (WGPURenderPassDescriptor){
-        .colorAttachmentCount   = 1,
-        .colorAttachments       = filter_pass.render_pass_desc.color_attachment,
-        .depthStencilAttachment = NULL,
-      };
+  wgpu_bloom_destroy(bloom_filter);
+  bloom_filter = NULL;
 
-    // Create sampler to sample from the color attachment
-    filter_pass.sampler = wgpuDeviceCreateSampler(
-      wgpu_context->device, &(WGPUSamplerDescriptor){
-                              .addressModeU  = WGPUAddressMode_ClampToEdge,
-                              .addressModeV  = WGPUAddressMode_ClampToEdge,
-                              .addressModeW  = WGPUAddressMode_ClampToEdge,
-                              .minFilter     = WGPUFilterMode_Nearest,
-                              .magFilter     = WGPUFilterMode_Nearest,
-                              .mipmapFilter  = WGPUFilterMode_Linear,
-                              .lodMinClamp   = 0.0f,
-                              .lodMaxClamp   = 1.0f,
-                              .maxAnisotropy = 1,
-                            });
-  }
+  WGPU_RELEASE_RESOURCE(Texture, composite_pass.output.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, composite_pass.output.texture_view)
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -446,15 +603,16 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(pipeline_layouts.models != NULL)
   }
 
-  // Bind group layout for bloom filter & G-Buffer composition
+  // Bind group layout for the G-Buffer composition, the 32-bit float formats
+  // are not filterable
   {
-    WGPUBindGroupLayoutEntry bgl_entries[5] = {
+    WGPUBindGroupLayoutEntry bgl_entries[4] = {
       [0] = (WGPUBindGroupLayoutEntry) {
         // Binding 0: Fragment shader image view
         .binding    = 0,
         .visibility = WGPUShaderStage_Fragment,
         .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
           .viewDimension = WGPUTextureViewDimension_2D,
           .multisampled  = false,
         },
@@ -465,7 +623,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
         .binding    = 1,
         .visibility = WGPUShaderStage_Fragment,
         .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
+          .type = WGPUSamplerBindingType_NonFiltering,
         },
         .texture = {0},
       },
@@ -474,7 +632,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
         .binding    = 2,
         .visibility = WGPUShaderStage_Fragment,
         .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
           .viewDimension = WGPUTextureViewDimension_2D,
           .multisampled  = false,
         },
@@ -485,50 +643,18 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
         .binding    = 3,
         .visibility = WGPUShaderStage_Fragment,
         .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
+          .type = WGPUSamplerBindingType_NonFiltering,
         },
         .texture = {0},
       },
-      [4] = (WGPUBindGroupLayoutEntry) {
-        // Binding 4: fragment shader dynamic uniform buffer
-        .binding    = 4,
-        .visibility = WGPUShaderStage_Fragment,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = true,
-          .minBindingSize   = sizeof(ubo_constants[0].value),
-        },
-        .sampler = {0},
-      },
     };
 
-    // Bloom filter pipeline layout
-    {
-      // Create the bind group layout
-      bind_group_layouts.bloom_filter = wgpuDeviceCreateBindGroupLayout(
-        wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
-                                .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-                                .entries    = bgl_entries,
-                              });
-      ASSERT(bind_group_layouts.bloom_filter != NULL)
-
-      // Create the pipeline layout
-      pipeline_layouts.bloom_filter = wgpuDeviceCreatePipelineLayout(
-        wgpu_context->device,
-        &(WGPUPipelineLayoutDescriptor){
-          .label                = "Bloom filter pipeline layout",
-          .bindGroupLayoutCount = 1,
-          .bindGroupLayouts     = &bind_group_layouts.bloom_filter,
-        });
-      ASSERT(pipeline_layouts.bloom_filter != NULL)
-    }
-
     // G-Buffer composition
     {
       // Create the bind group layout
       bind_group_layouts.composition = wgpuDeviceCreateBindGroupLayout(
         wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
-                                .entryCount = 4u,
+                                .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
                                 .entries    = bgl_entries,
                               });
       ASSERT(bind_group_layouts.composition != NULL)
@@ -544,6 +670,70 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       ASSERT(pipeline_layouts.composition != NULL)
     }
   }
+
+  // Bind group layout for the fused bloom filter & composition
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[4] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        // Binding 0: Scene texture
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+        .storageTexture = {0},
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        // Binding 1: Bright texture
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+        .storageTexture = {0},
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        // Binding 2: Output texture (write)
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .storageTexture = (WGPUStorageTextureBindingLayout) {
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = WGPUTextureFormat_RGBA8Unorm,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+        .sampler = {0},
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Binding 3: Uniform buffer
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = sizeof(composite_params),
+        },
+        .sampler = {0},
+      },
+    };
+    composite_pass.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(composite_pass.bind_group_layout != NULL)
+
+    composite_pass.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .label                = "Composite pipeline layout",
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts     = &composite_pass.bind_group_layout,
+      });
+    ASSERT(composite_pass.pipeline_layout != NULL)
+  }
 }
 
 static void setup_bind_groups(wgpu_context_t* wgpu_context)
@@ -609,12 +799,12 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
     }
   }
 
-  // Bloom filter bind group
+  // Composition bind group
   {
-    WGPUBindGroupEntry bg_entries[5] = {
+    WGPUBindGroupEntry bg_entries[4] = {
       [0] = (WGPUBindGroupEntry) {
         // Binding 0: Fragment shader image view
-        .binding     = 0,
+        .binding    = 0,
         .textureView = offscreen_pass.color[0].texture_view
       },
       [1] = (WGPUBindGroupEntry) {
@@ -632,61 +822,70 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
         .binding = 3,
         .sampler = offscreen_pass.sampler,
       },
-      [4] = (WGPUBindGroupEntry) {
-        // Binding 4: fragment shader dynamic uniform buffer
-        .binding = 4,
-        .buffer  = uniform_buffers.dynamic.buffer,
-        .offset  = 0,
-        .size    = sizeof(ubo_constants[0].value),
-      },
     };
 
     WGPUBindGroupDescriptor bg_desc = {
-      .layout     = bind_group_layouts.bloom_filter,
+      .layout     = bind_group_layouts.composition,
       .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
       .entries    = bg_entries,
     };
-    bind_groups.bloom_filter
+    bind_groups.composition
+      = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
+    ASSERT(bind_groups.composition != NULL)
+
+    // The composition of the compute path copies its output
+    bg_entries[0].textureView = composite_pass.output.texture_view;
+    composite_pass.composition_bind_group
       = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-    ASSERT(bind_groups.bloom_filter != NULL);
+    ASSERT(composite_pass.composition_bind_group != NULL)
   }
 
-  // Composition bind group
+  // Fused bloom filter & composition bind group
   {
     WGPUBindGroupEntry bg_entries[4] = {
       [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Fragment shader image view
-        .binding    = 0,
-        .textureView = offscreen_pass.color[0].texture_view
+        // Binding 0: Scene texture
+        .binding     = 0,
+        .textureView = offscreen_pass.color[0].texture_view,
       },
       [1] = (WGPUBindGroupEntry) {
-        // Binding 1: Fragment shader image sampler
-        .binding = 1,
-        .sampler = offscreen_pass.sampler,
+        // Binding 1: Bright texture
+        .binding     = 1,
+        .textureView = offscreen_pass.color[1].texture_view,
       },
       [2] = (WGPUBindGroupEntry) {
-        // Binding 2: Fragment shader image view
+        // Binding 2: Output texture (write)
         .binding     = 2,
-        .textureView = filter_pass.color[0].texture_view
+        .textureView = composite_pass.output.texture_view,
       },
       [3] = (WGPUBindGroupEntry) {
-        // Binding 3: Fragment shader image sampler
+        // Binding 3: Uniform buffer
         .binding = 3,
-        .sampler = filter_pass.sampler,
+        .buffer  = composite_pass.params.buffer,
+        .offset  = 0,
+        .size    = composite_pass.params.size,
       },
     };
-
     WGPUBindGroupDescriptor bg_desc = {
-      .layout     = bind_group_layouts.composition,
+      .layout     = composite_pass.bind_group_layout,
       .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
       .entries    = bg_entries,
     };
-    bind_groups.composition
+    composite_pass.bind_group
       = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-    ASSERT(bind_groups.composition != NULL)
+    ASSERT(composite_pass.bind_group != NULL)
   }
 }
 
+static void release_bind_groups(void)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.object)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.skybox)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.composition)
+  WGPU_RELEASE_RESOURCE(BindGroup, composite_pass.bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, composite_pass.composition_bind_group)
+}
+
 static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   // Color attachment
@@ -794,77 +993,6 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
   }
 
-  // Bloom pass
-  {
-    // Additive blending
-    WGPUBlendState blend_state_radial_blur = {
-      .color.operation = WGPUBlendOperation_Add,
-      .color.srcFactor = WGPUBlendFactor_One,
-      .color.dstFactor = WGPUBlendFactor_One,
-      .alpha.operation = WGPUBlendOperation_Add,
-      .alpha.srcFactor = WGPUBlendFactor_SrcAlpha,
-      .alpha.dstFactor = WGPUBlendFactor_DstAlpha,
-    };
-    WGPUColorTargetState color_target_state_desc = (WGPUColorTargetState){
-      .blend     = &blend_state_radial_blur,
-      .writeMask = WGPUColorWriteMask_All,
-    };
-
-    // Vertex state
-    WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
-          wgpu_context, &(wgpu_vertex_state_t){
-            .shader_desc = (wgpu_shader_desc_t){
-              // Vertex shader SPIR-V
-              .label = "Bloom vertex shader",
-              .file  = "shaders/hdr/bloom.vert.spv",
-            },
-            // Empty vertex input state, full screen triangles are generated by
-            // the vertex shader
-            .buffer_count = 0,
-            .buffers = NULL,
-          });
-
-    // Fragment state
-    WGPUFragmentState fragment_state_desc = wgpu_create_fragment_state(
-          wgpu_context, &(wgpu_fragment_state_t){
-            .shader_desc = (wgpu_shader_desc_t){
-              // Fragment shader SPIR-V
-              .label = "Bloom fragment shader",
-              .file  = "shaders/hdr/bloom.frag.spv",
-            },
-            .target_count = 1,
-            .targets = &color_target_state_desc,
-          });
-
-    // First bloom filter pass (into separate framebuffer)
-    color_target_state_desc.format = wgpu_context->swap_chain.format;
-    pipelines.bloom[0]             = wgpuDeviceCreateRenderPipeline(
-                  wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                                          .label        = "bloom_1_render_pipeline",
-                                          .layout       = pipeline_layouts.bloom_filter,
-                                          .primitive    = primitive_state_desc,
-                                          .vertex       = vertex_state_desc,
-                                          .fragment     = &fragment_state_desc,
-                                          .depthStencil = &depth_stencil_state_desc,
-                                          .multisample  = multisample_state_desc,
-                            });
-    ASSERT(pipelines.bloom[0]);
-
-    // Second bloom filter pass (into separate framebuffer)
-    color_target_state_desc.format = filter_pass.color[0].format;
-    pipelines.bloom[1]             = wgpuDeviceCreateRenderPipeline(
-                  wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                                          .label        = "bloom_2_render_pipeline",
-                                          .layout       = pipeline_layouts.bloom_filter,
-                                          .primitive    = primitive_state_desc,
-                                          .vertex       = vertex_state_desc,
-                                          .fragment     = &fragment_state_desc,
-                                          .depthStencil = NULL,
-                                          .multisample  = multisample_state_desc,
-                            });
-    ASSERT(pipelines.bloom[1]);
-  }
-
   // Object rendering pipelines
   {
     // Use vertex input state from glTF model setup
@@ -917,6 +1045,7 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     // Skybox pipeline (background cube)
     {
       primitive_state_desc.cullMode              = WGPUCullMode_Back;
+      depth_stencil_state_desc.format            = depth_format;
       depth_stencil_state_desc.depthWriteEnabled = false;
 
       // Create rendering pipeline using the specified states
@@ -958,6 +1087,87 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
     WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
   }
+
+  // Fused bloom filter & composition pipeline
+  {
+    wgpu_shader_t composite_comp_shader = wgpu_shader_create(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      // Compute shader WGSL
+                      .label            = "composite_compute_shader",
+                      .wgsl_code.source = composite_shader_wgsl,
+                      .entry            = "main",
+                    });
+    composite_pass.pipeline = wgpuDeviceCreateComputePipeline(
+      wgpu_context->device,
+      &(WGPUComputePipelineDescriptor){
+        .label   = "composite_compute_pipeline",
+        .layout  = composite_pass.pipeline_layout,
+        .compute = composite_comp_shader.programmable_stage_descriptor,
+      });
+    ASSERT(composite_pass.pipeline);
+    wgpu_shader_release(&composite_comp_shader);
+  }
+}
+
+static void release_pipelines(void)
+{
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.skybox)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.reflect)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.composition)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, composite_pass.pipeline)
+}
+
+// Recreates the offscreen targets and everything depending on their format
+static void rebuild_offscreen(wgpu_context_t* wgpu_context)
+{
+  release_bind_groups();
+  release_pipelines();
+  release_offscreen();
+  prepare_offscreen(wgpu_context);
+  prepare_pipelines(wgpu_context);
+  setup_bind_groups(wgpu_context);
+  wgpu_auto_exposure_resize(auto_exposure, offscreen_pass.width,
+                            offscreen_pass.height);
+}
+
+/*
+ * Estimated bytes moved per frame: every render target texel is written once,
+ * every sampled texel is read once (the filter taps hit the cache), blending
+ * reads the target and the discarded depth is written by immediate mode GPUs.
+ */
+static void update_frame_traffic(wgpu_context_t* wgpu_context)
+{
+  const uint64_t hdr   = hdr_formats[active_hdr_format_index].bytes_per_texel;
+  const uint64_t ldr   = 4; // rgba8 / bgra8
+  const uint64_t depth = 4;
+
+  // G-Buffer pass: two HDR targets
+  uint64_t texel_bytes = 2 * hdr + depth;
+  // Bloom mip chain texel bytes per quarter of the frame texels
+  uint64_t chain_bytes = 0;
+  if (compute_composite) {
+    // Fused pass reads the scene (and the bright texels) once, the copy into
+    // the frame buffer reads its LDR output
+    texel_bytes += hdr + (bloom ? hdr : 0) + ldr;
+    texel_bytes += ldr + ldr;
+  }
+  else {
+    // Composition pass
+    texel_bytes += hdr + ldr;
+    if (bloom) {
+      // The first downsample pass reads the bright texels, the levels (a
+      // third of the frame texels) are written and read by the downsample
+      // passes and read, blended and written by the upsample passes. The
+      // composite reads the first level, blended into the frame buffer.
+      const uint64_t level = 8; // rgba16float
+      texel_bytes += hdr + ldr + ldr;
+      chain_bytes = 5 * level * 4 / 3 + level;
+    }
+  }
+  const uint64_t texel_count
+    = (uint64_t)wgpu_context->surface.width * wgpu_context->surface.height;
+  frame_traffic_bytes
+    = texel_bytes * texel_count + chain_bytes * texel_count / 4;
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -979,6 +1189,13 @@ static void update_params(wgpu_example_context_t* context)
                           0, &ubo_params, uniform_buffers.params.size);
 }
 
+static void update_composite_params(wgpu_example_context_t* context)
+{
+  composite_params.bloom = bloom ? 1u : 0u;
+  wgpu_queue_write_buffer(context->wgpu_context, composite_pass.params.buffer,
+                          0, &composite_params, composite_pass.params.size);
+}
+
 static void update_dynamic_uniform_buffers(wgpu_example_context_t* context)
 {
   // Set constant values
@@ -1022,10 +1239,19 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
            .mappedAtCreation = false,
     });
 
+  // Fused bloom filter & composition parameters
+  composite_pass.params = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(composite_params),
+    });
+
   // Initialize uniform buffers
   update_uniform_buffers(context);
   update_params(context);
   update_dynamic_uniform_buffers(context);
+  update_composite_params(context);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -1035,10 +1261,19 @@ static int example_initialize(wgpu_example_context_t* context)
     load_assets(context->wgpu_context);
     prepare_uniform_buffers(context);
     prepare_offscreen(context->wgpu_context);
+    // The G-Buffer pass tone maps with 1 - exp(-color * exposure)
+    auto_exposure = wgpu_auto_exposure_create(
+      context->wgpu_context,
+      &(wgpu_auto_exposure_desc_t){
+        .width  = offscreen_pass.width,
+        .height = offscreen_pass.height,
+        .input  = WGPU_AutoExposureInput_ExponentialToneMapped,
+      });
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
+    update_frame_traffic(context->wgpu_context);
     prepared = true;
     return 0;
   }
@@ -1053,21 +1288,58 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                 &models.object_index, object_names, 4)) {
       update_uniform_buffers(context);
     }
-    if (imgui_overlay_input_float(context->imgui_overlay, "Exposure",
-                                  &ubo_params.exposure, 0.025f, "%.3f")) {
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Auto exposure",
+                               &auto_exposure_on)) {
+      if (auto_exposure_on) {
+        wgpu_auto_exposure_reset(auto_exposure);
+      }
+      else {
+        // Restore the manual exposure
+        update_params(context);
+      }
+    }
+    if (!auto_exposure_on
+        && imgui_overlay_input_float(context->imgui_overlay, "Exposure",
+                                     &ubo_params.exposure, 0.025f, "%.3f")) {
       update_params(context);
     }
-    imgui_overlay_checkBox(context->imgui_overlay, "Bloom", &bloom);
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Bloom", &bloom)) {
+      update_composite_params(context);
+      update_frame_traffic(context->wgpu_context);
+    }
     imgui_overlay_checkBox(context->imgui_overlay, "Skybox", &display_skybox);
+    if (imgui_overlay_combo_box(context->imgui_overlay, "HDR format",
+                                &hdr_format_index, hdr_format_names, 3)) {
+      rebuild_offscreen(context->wgpu_context);
+      update_frame_traffic(context->wgpu_context);
+    }
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Compute composite",
+                               &compute_composite)) {
+      update_frame_traffic(context->wgpu_context);
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("HDR targets: %s",
+                       hdr_format_names[active_hdr_format_index]);
+    imgui_overlay_text("Bytes moved: %.1f MiB/frame",
+                       (double)frame_traffic_bytes / (1024.0 * 1024.0));
   }
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context,
+                                              float delta_time)
 {
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Render with the exposure adapted in the last frame, the histogram
+  // reconstructs the scene luminance with the same exposure
+  if (auto_exposure_on) {
+    wgpu_auto_exposure_copy_exposure(auto_exposure, wgpu_context->cmd_enc,
+                                     uniform_buffers.params.buffer, 0);
+  }
+
   /*
    * First pass: Render scene to offscreen framebuffer
    */
@@ -1113,41 +1385,41 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   }
 
   /*
-   * Second render pass: First bloom pass
+   * Compute pass: Luminance histogram and exposure adaptation
    */
-  if (bloom) {
-    // Bloom filter
-
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc,
-      &filter_pass.render_pass_desc.render_pass_descriptor);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                     (float)filter_pass.width,
-                                     (float)filter_pass.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        filter_pass.width, filter_pass.height);
+  if (auto_exposure_on) {
+    wgpu_auto_exposure_encode(auto_exposure, wgpu_context->cmd_enc,
+                              offscreen_pass.color[0].texture_view,
+                              delta_time);
+  }
 
-    // Render
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.bloom[1]);
-    uint32_t dynamic_offset = 0 * (uint32_t)ALIGNMENT;
-    wgpuRenderPassEncoderSetBindGroup(
-      wgpu_context->rpass_enc, 0, bind_groups.bloom_filter, 1, &dynamic_offset);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  /*
+   * Compute pass: Bloom filter passes and composition fused into one dispatch
+   */
+  if (compute_composite) {
+    wgpu_context->cpass_enc
+      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
+                                      composite_pass.pipeline);
+    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
+                                       composite_pass.bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      wgpu_context->cpass_enc, (wgpu_context->surface.width + 15) / 16,
+      (wgpu_context->surface.height + 15) / 16, 1);
+    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+  }
 
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  /*
+   * Bloom passes: Downsample / upsample mip chain of the bright parts
+   */
+  if (bloom && !compute_composite) {
+    wgpu_bloom_encode(bloom_filter, wgpu_context->cmd_enc,
+                      offscreen_pass.color[1].texture_view);
   }
 
   /*
-   * Third render pass: Scene rendering with applied second bloom pass (when
-   * enabled)
+   * Second render pass: Scene rendering with the bloom added (when enabled)
    */
   {
     // Final composition
@@ -1169,23 +1441,20 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                         wgpu_context->surface.width,
                                         wgpu_context->surface.height);
 
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.composition, 0, 0);
+    wgpuRenderPassEncoderSetBindGroup(
+      wgpu_context->rpass_enc, 0,
+      compute_composite ? composite_pass.composition_bind_group :
+                          bind_groups.composition,
+      0, 0);
 
-    // Scene
+    // Scene (the output of the compute pass)
     wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
                                      pipelines.composition);
     wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
 
     // Bloom
-    if (bloom) {
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       pipelines.bloom[0]);
-      uint32_t dynamic_offset = 1 * (uint32_t)ALIGNMENT;
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.bloom_filter, 1,
-                                        &dynamic_offset);
-      wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+    if (bloom && !compute_composite) {
+      wgpu_bloom_composite(bloom_filter, wgpu_context->rpass_enc);
     }
   }
   // End render pass
@@ -1212,7 +1481,7 @@ static int example_draw(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context->wgpu_context, context->frame_timer);
 
   // Submit to queue
   submit_command_buffers(context);
@@ -1249,37 +1518,21 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.matrices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.params.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.dynamic.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, composite_pass.params.buffer)
 
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color[0].texture)
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color[1].texture)
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.depth.texture)
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color[0].texture_view)
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color[1].texture_view)
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.depth.texture_view)
-  WGPU_RELEASE_RESOURCE(Sampler, offscreen_pass.sampler)
-
-  WGPU_RELEASE_RESOURCE(Texture, filter_pass.color[0].texture)
-  WGPU_RELEASE_RESOURCE(TextureView, filter_pass.color[0].texture_view)
-  WGPU_RELEASE_RESOURCE(Sampler, filter_pass.sampler)
-
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.skybox)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.reflect)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.composition)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.bloom[0])
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.bloom[1])
+  wgpu_auto_exposure_destroy(auto_exposure);
+  release_offscreen();
+  release_pipelines();
 
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.models)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.composition)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.bloom_filter)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, composite_pass.pipeline_layout)
 
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.object)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.skybox)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.composition)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.bloom_filter)
+  release_bind_groups();
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.models)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.composition)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.bloom_filter)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, composite_pass.bind_group_layout)
 }
 
 void example_hdr(int argc, char* argv[])
@@ -11,6 +11,11 @@
  *
  * This example shows how to blur an image using a WebGPU compute shader.
  *
+ * The sliding-window mode blurs with a running sum box filter instead: every
+ * invocation walks one row or column and updates the window sum with one added
+ * and one removed texel, so the cost does not depend on the radius. Three box
+ * passes approximate a gaussian.
+ *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/tree/main/src/sample/imageBlur
  * -------------------------------------------------------------------------- */
@@ -19,31 +24,53 @@
 static const uint32_t tile_dim = 128;
 static const uint32_t batch[2] = {4, 4};
 
+// Lines walked by one workgroup of the sliding-window box filter
+static const uint32_t box_workgroup_size = 64;
+
 // Uniform buffers
 static wgpu_buffer_t uniform_buffers[2];
 static uint32_t uniform_buffer_data[2] = {0, 1};
 static wgpu_buffer_t blur_params_buffer;
+static wgpu_buffer_t box_params_buffer;
 
 // Pipelines
 static WGPUComputePipeline blur_pipeline;
+static WGPUComputePipeline box_blur_pipeline;
 static WGPURenderPipeline fullscreen_quad_pipeline;
 
 // Bind groups
 static WGPUBindGroup compute_constants_bind_group;
 static WGPUBindGroup compute_bind_groups[3];
+static WGPUBindGroup box_constants_bind_group;
+static WGPUBindGroup box_bind_groups[3];
 static WGPUBindGroup show_result_bind_group;
 
 // Texture and sampler
 static texture_t texture;
 static texture_t blur_textures[2];
 
+// Blur modes
+typedef enum blur_mode_t {
+  BlurMode_TiledConvolution = 0,
+  BlurMode_SlidingWindow    = 1,
+} blur_mode_t;
+
+static const char* blur_mode_names[2] = {"Tiled convolution",
+                                         "Sliding window"};
+
 // Settings
 static struct {
+  int32_t mode;
   int32_t filter_size;
   int32_t iterations;
+  int32_t box_radius;
+  int32_t box_iterations;
 } settings = {
-  .filter_size = 15,
-  .iterations  = 2,
+  .mode           = BlurMode_TiledConvolution,
+  .filter_size    = 15,
+  .iterations     = 2,
+  .box_radius     = 32,
+  .box_iterations = 3,
 };
 static uint32_t block_dim    = 1;
 static uint32_t image_width  = 0;
@@ -59,6 +86,58 @@ static struct {
 static const char* example_title = "Image Blur";
 static bool prepared             = false;
 
+// clang-format off
+static const char* box_blur_shader_wgsl = CODE(
+  struct Params {
+    radius : u32,
+  }
+
+  struct Flip {
+    value : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(1) @binding(1) var inputTex : texture_2d<f32>;
+  @group(1) @binding(2) var outputTex : texture_storage_2d<rgba8unorm, write>;
+  @group(1) @binding(3) var<uniform> flip : Flip;
+
+  fn texel_coord(x : i32, line : i32) -> vec2<i32> {
+    if (flip.value != 0u) {
+      return vec2<i32>(line, x);
+    }
+    return vec2<i32>(x, line);
+  }
+
+  fn load(x : i32, line : i32, length : i32) -> vec4<f32> {
+    return textureLoad(inputTex, texel_coord(clamp(x, 0, length - 1), line), 0);
+  }
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    var dims = vec2<i32>(textureDimensions(inputTex, 0));
+    if (flip.value != 0u) {
+      dims = dims.yx;
+    }
+    let line = i32(id.x);
+    if (line >= dims.y) {
+      return;
+    }
+
+    let r     = i32(params.radius);
+    let scale = 1.0 / f32(2 * r + 1);
+
+    var sum = vec4<f32>(0.0);
+    for (var i = -r; i <= r; i++) {
+      sum += load(i, line, dims.x);
+    }
+    for (var x = 0; x < dims.x; x++) {
+      textureStore(outputTex, texel_coord(x, line), sum * scale);
+      sum += load(x + r + 1, line, dims.x) - load(x - r, line, dims.x);
+    }
+  }
+);
+// clang-format on
+
 static void prepare_texture(wgpu_context_t* wgpu_context)
 {
   const char* file = "textures/Di-3d.png";
@@ -277,6 +356,70 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
       = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
     ASSERT(show_result_bind_group != NULL);
   }
+
+  // Sliding-window box filter radius
+  box_params_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = 4,
+                  });
+
+  // Sliding-window box filter constants bind group
+  {
+    WGPUBindGroupEntry bg_entries[1] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = box_params_buffer.buffer,
+        .offset  = 0,
+        .size    = box_params_buffer.size,
+      },
+    };
+    WGPUBindGroupDescriptor bg_desc = {
+      .label      = "Box blur constants bind group",
+      .layout     = wgpuComputePipelineGetBindGroupLayout(box_blur_pipeline, 0),
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    };
+    box_constants_bind_group
+      = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
+    ASSERT(box_constants_bind_group != NULL);
+  }
+
+  // Sliding-window box filter bind groups, same ping-pong as the tiled passes
+  {
+    WGPUTextureView inputs[3]  = {texture.view, blur_textures[0].view,
+                                  blur_textures[1].view};
+    WGPUTextureView outputs[3] = {blur_textures[0].view, blur_textures[1].view,
+                                  blur_textures[0].view};
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(box_bind_groups); ++i) {
+      wgpu_buffer_t* flip = &uniform_buffers[i == 1 ? 1 : 0];
+      WGPUBindGroupEntry bg_entries[3] = {
+        [0] = (WGPUBindGroupEntry) {
+          .binding     = 1,
+          .textureView = inputs[i],
+        },
+        [1] = (WGPUBindGroupEntry) {
+          .binding     = 2,
+          .textureView = outputs[i],
+        },
+        [2] = (WGPUBindGroupEntry) {
+          .binding = 3,
+          .buffer  = flip->buffer,
+          .offset  = 0,
+          .size    = flip->size,
+        },
+      };
+      WGPUBindGroupDescriptor bg_desc = {
+        .label  = "Box blur bind group",
+        .layout = wgpuComputePipelineGetBindGroupLayout(box_blur_pipeline, 1),
+        .entryCount = 3,
+        .entries    = bg_entries,
+      };
+      box_bind_groups[i]
+        = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
+      ASSERT(box_bind_groups[i] != NULL);
+    }
+  }
 }
 
 // Create the compute & graphics pipelines
@@ -304,6 +447,29 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     wgpu_shader_release(&blur_comp_shader);
   }
 
+  // Sliding-window box filter compute pipeline
+  {
+    // Compute shader
+    wgpu_shader_t box_comp_shader = wgpu_shader_create(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      // Compute shader WGSL
+                      .label            = "box_blur_wgsl",
+                      .wgsl_code.source = box_blur_shader_wgsl,
+                    });
+
+    // Compute pipeline
+    box_blur_pipeline = wgpuDeviceCreateComputePipeline(
+      wgpu_context->device,
+      &(WGPUComputePipelineDescriptor){
+        .label   = "image_box_blur_compute_pipeline",
+        .compute = box_comp_shader.programmable_stage_descriptor,
+      });
+    ASSERT(box_blur_pipeline != NULL);
+
+    // Partial clean-up
+    wgpu_shader_release(&box_comp_shader);
+  }
+
   // Fullscreen quad render pipeline
   {
     // Primitive state
@@ -379,6 +545,10 @@ static void update_settings(wgpu_context_t* wgpu_context)
   // Map uniform buffer and update it
   wgpu_queue_write_buffer(wgpu_context, blur_params_buffer.buffer, 0,
                           &uniform_buffer_data, sizeof(uniform_buffer_data));
+
+  const uint32_t box_radius = (uint32_t)settings.box_radius;
+  wgpu_queue_write_buffer(wgpu_context, box_params_buffer.buffer, 0,
+                          &box_radius, sizeof(box_radius));
 }
 
 static int round_up_to_odd(int value, int min, int max)
@@ -389,13 +559,26 @@ static int round_up_to_odd(int value, int min, int max)
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
-    if (imgui_overlay_slider_int(context->imgui_overlay, "Filter Size",
-                                 &settings.filter_size, 1, 33)) {
-      settings.filter_size = round_up_to_odd(settings.filter_size, 1, 33);
-      update_settings(context->wgpu_context);
+    imgui_overlay_combo_box(context->imgui_overlay, "Mode", &settings.mode,
+                            blur_mode_names,
+                            (uint32_t)ARRAY_SIZE(blur_mode_names));
+    if (settings.mode == BlurMode_TiledConvolution) {
+      if (imgui_overlay_slider_int(context->imgui_overlay, "Filter Size",
+                                   &settings.filter_size, 1, 33)) {
+        settings.filter_size = round_up_to_odd(settings.filter_size, 1, 33);
+        update_settings(context->wgpu_context);
+      }
+      imgui_overlay_slider_int(context->imgui_overlay, "Iterations",
+                               &settings.iterations, 1, 10);
+    }
+    else {
+      if (imgui_overlay_slider_int(context->imgui_overlay, "Radius",
+                                   &settings.box_radius, 1, 256)) {
+        update_settings(context->wgpu_context);
+      }
+      imgui_overlay_slider_int(context->imgui_overlay, "Box passes",
+                               &settings.box_iterations, 1, 5);
     }
-    imgui_overlay_slider_int(context->imgui_overlay, "Iterations",
-                             &settings.iterations, 1, 10);
   }
 }
 
@@ -408,7 +591,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
   // Compute pass
-  {
+  if (settings.mode == BlurMode_TiledConvolution) {
     wgpu_context->cpass_enc
       = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
     wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc, blur_pipeline);
@@ -444,6 +627,37 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
     WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
   }
+  else {
+    // One invocation per row in the horizontal and per column in the vertical
+    // passes
+    const uint32_t row_groups
+      = (image_height + box_workgroup_size - 1) / box_workgroup_size;
+    const uint32_t column_groups
+      = (image_width + box_workgroup_size - 1) / box_workgroup_size;
+
+    wgpu_context->cpass_enc
+      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
+                                      box_blur_pipeline);
+    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
+                                       box_constants_bind_group, 0, NULL);
+
+    for (uint32_t i = 0; i < (uint32_t)settings.box_iterations; ++i) {
+      wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 1,
+                                         box_bind_groups[i == 0 ? 0 : 2], 0,
+                                         NULL);
+      wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
+                                               row_groups, 1, 1);
+
+      wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 1,
+                                         box_bind_groups[1], 0, NULL);
+      wgpuComputePassEncoderDispatchWorkgroups(wgpu_context->cpass_enc,
+                                               column_groups, 1, 1);
+    }
+
+    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+  }
 
   // Fullscreen quad pipeline
   {
@@ -526,11 +740,17 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroup, compute_bind_groups[0])
   WGPU_RELEASE_RESOURCE(BindGroup, compute_bind_groups[1])
   WGPU_RELEASE_RESOURCE(BindGroup, compute_bind_groups[2])
+  WGPU_RELEASE_RESOURCE(BindGroup, box_constants_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, box_bind_groups[0])
+  WGPU_RELEASE_RESOURCE(BindGroup, box_bind_groups[1])
+  WGPU_RELEASE_RESOURCE(BindGroup, box_bind_groups[2])
   WGPU_RELEASE_RESOURCE(BindGroup, show_result_bind_group)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers[0].buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers[1].buffer)
   WGPU_RELEASE_RESOURCE(Buffer, blur_params_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, box_params_buffer.buffer)
   WGPU_RELEASE_RESOURCE(ComputePipeline, blur_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, box_blur_pipeline)
   WGPU_RELEASE_RESOURCE(RenderPipeline, fullscreen_quad_pipeline)
 }
 
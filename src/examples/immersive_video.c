@@ -13,6 +13,11 @@
  * This example shows how to display a 360-degree video where the viewer has
  * control of the viewing direction.
  *
+ * The stereo mode renders both eyes side by side in a single pass: one draw of
+ * two instances, the instance index selects the eye from a uniform array of
+ * eye views. The video is uploaded once and sampled by both eyes, stereoscopic
+ * videos store the eyes top-bottom or side by side in one frame.
+ *
  * Ref:
  * https://gist.github.com/fieldOfView/5106319
  * https://yanwsh.github.io/videojs-panorama/index_v4.html
@@ -36,6 +41,99 @@ static struct {
   .iVFovDegrees = 80.0f,
 };
 
+// Shaders
+// clang-format off
+static const char* stereo_shader_wgsl = CODE(
+  struct Eye {
+    view : mat4x4<f32>,
+    uvRect : vec4<f32>, // region of the eye in the video frame
+  }
+
+  struct StereoUniforms {
+    eyes : array<Eye, 2>,
+    halfFov : vec2<f32>, // radians
+    visualizeInput : u32,
+    padding : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> stereo : StereoUniforms;
+  @group(0) @binding(1) var videoTexture : texture_2d<f32>;
+  @group(0) @binding(2) var videoSampler : sampler;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) eyePosition : vec2<f32>, // [-1, 1] within the eye viewport
+    @location(1) @interpolate(flat) eye : u32,
+  }
+
+  // Quad of the eye, drawn as a triangle strip of 4 vertices per instance
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32,
+             @builtin(instance_index) instanceIndex : u32) -> VertexOutput {
+    let p = vec2<f32>(f32(vertexIndex & 1u), f32(vertexIndex >> 1u)) * 2.0
+            - 1.0;
+    var output : VertexOutput;
+    // Left eye in the left half, right eye in the right half
+    output.position = vec4<f32>(p.x * 0.5 + f32(instanceIndex) - 0.5, p.y,
+                                0.0, 1.0);
+    output.eyePosition = p;
+    output.eye = instanceIndex;
+    return output;
+  }
+
+  const PI : f32 = 3.14159265358979;
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let eye = stereo.eyes[input.eye];
+    var uv : vec2<f32>;
+    if (stereo.visualizeInput != 0u) {
+      uv = input.eyePosition * vec2<f32>(0.5, -0.5) + 0.5;
+    }
+    else {
+      // Angles of the pixel relative to the viewing direction
+      let angles = input.eyePosition * stereo.halfFov;
+      let local = vec3<f32>(cos(angles.y) * sin(angles.x), sin(angles.y),
+                            -cos(angles.y) * cos(angles.x));
+      let dir = (eye.view * vec4<f32>(local, 0.0)).xyz;
+      // Equirectangular projection
+      uv = vec2<f32>(atan2(dir.x, -dir.z) / (2.0 * PI) + 0.5,
+                     acos(clamp(dir.y, -1.0, 1.0)) / PI);
+    }
+    return textureSampleLevel(videoTexture, videoSampler,
+                              eye.uvRect.xy + uv * eye.uvRect.zw, 0.0);
+  }
+);
+// clang-format on
+
+// Stereo mode
+typedef enum stereo_video_layout_enum_t {
+  Stereo_Video_Layout_Mono         = 0, // the same image for both eyes
+  Stereo_Video_Layout_Top_Bottom   = 1, // left eye on top
+  Stereo_Video_Layout_Side_By_Side = 2, // left eye on the left
+} stereo_video_layout_enum_t;
+
+static struct {
+  bool enabled;
+  int32_t video_layout;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline pipeline;
+  wgpu_buffer_t uniform_buffer;
+} stereo = {0};
+
+// Uniform block data of the stereo mode, matches the WGSL struct
+static struct {
+  struct {
+    mat4 view;
+    vec4 uv_rect;
+  } eyes[2];
+  vec2 half_fov;
+  uint32_t visualize_input;
+  uint32_t padding;
+} stereo_ubo = {0};
+
 // Used for mouse pixel coordinates calculation
 static struct {
   vec2 initial_mouse_position;
@@ -71,6 +169,8 @@ static struct video_texture_t {
   WGPUSampler sampler;
   WGPUTexture texture;
   WGPUTextureView view;
+  // Converts the 4:2:0 frames of the decoder into the texture
+  wgpu_yuv_converter_t* yuv_converter;
 } video_texture = {0};
 
 static struct video_info_t {
@@ -80,6 +180,9 @@ static struct video_info_t {
   } frame_size;
 } video_info = {0};
 
+// Decoder of the video file
+static video_decoder_t* video_decoder = NULL;
+
 static const char* video_file_location
   = "videos/immersive_video/underwater_diving_360degrees.mp4";
 
@@ -102,7 +205,9 @@ static void prepare_video_texture(wgpu_context_t* wgpu_context)
       .sampleCount   = 1,
       .dimension     = WGPUTextureDimension_2D,
       .format        = WGPUTextureFormat_RGBA8Unorm,
-      .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+      .usage         = WGPUTextureUsage_CopyDst
+                       | WGPUTextureUsage_TextureBinding
+                       | WGPUTextureUsage_StorageBinding,
   });
 
   // Create the texture view
@@ -117,6 +222,24 @@ static void prepare_video_texture(wgpu_context_t* wgpu_context)
                            });
   ASSERT(video_texture.view != NULL);
 
+  // Planar frames are converted on the GPU
+  video_frame_info_t frame_info = {0};
+  video_decoder_get_frame_info(video_decoder, &frame_info);
+  if (frame_info.format != VIDEO_FRAME_FORMAT_RGBA8) {
+    const wgpu_yuv_format_enum_t yuv_format
+      = frame_info.format == VIDEO_FRAME_FORMAT_NV12 ? WGPU_YUV_Format_NV12 :
+                                                       WGPU_YUV_Format_I420;
+    video_texture.yuv_converter = wgpu_yuv_converter_create(
+      wgpu_context, &(wgpu_yuv_converter_desc_t){
+                      .format     = yuv_format,
+                      .width      = (uint32_t)frame_info.width,
+                      .height     = (uint32_t)frame_info.height,
+                      .bt709      = frame_info.bt709 != 0,
+                      .full_range = frame_info.full_range != 0,
+                      .texture    = video_texture.texture,
+                    });
+  }
+
   // Create the sampler
   video_texture.sampler = wgpuDeviceCreateSampler(
     wgpu_context->device, &(WGPUSamplerDescriptor){
@@ -243,6 +366,44 @@ static bool window_resized(wgpu_context_t* wgpu_context)
              != (uint32_t)wgpu_context->surface.height);
 }
 
+static void update_stereo_uniform_buffer(wgpu_context_t* wgpu_context)
+{
+  // Viewing direction from the mouse position, a drag across the window turns
+  // the view once around
+  const float yaw = shader_inputs_ubo.iMouse[0]
+                    / MAX(shader_inputs_ubo.iResolution[0], 1.0f) * 2.0f * PI;
+  const float pitch
+    = clamp_float(0.5f
+                    - shader_inputs_ubo.iMouse[1]
+                        / MAX(shader_inputs_ubo.iResolution[1], 1.0f),
+                  -0.5f, 0.5f)
+      * PI;
+
+  // Both eyes look in the same direction, the parallax is in the video. A
+  // tracked headset would set the pose of each eye here.
+  static const vec4 uv_rects[3][2] = {
+    [Stereo_Video_Layout_Mono]         = {{0.0f, 0.0f, 1.0f, 1.0f},
+                                          {0.0f, 0.0f, 1.0f, 1.0f}},
+    [Stereo_Video_Layout_Top_Bottom]   = {{0.0f, 0.0f, 1.0f, 0.5f},
+                                          {0.0f, 0.5f, 1.0f, 0.5f}},
+    [Stereo_Video_Layout_Side_By_Side] = {{0.0f, 0.0f, 0.5f, 1.0f},
+                                          {0.5f, 0.0f, 0.5f, 1.0f}},
+  };
+  for (uint32_t i = 0; i < 2; ++i) {
+    glm_mat4_identity(stereo_ubo.eyes[i].view);
+    glm_rotate_y(stereo_ubo.eyes[i].view, -yaw, stereo_ubo.eyes[i].view);
+    glm_rotate_x(stereo_ubo.eyes[i].view, pitch, stereo_ubo.eyes[i].view);
+    glm_vec4_copy((float*)uv_rects[stereo.video_layout][i],
+                  stereo_ubo.eyes[i].uv_rect);
+  }
+  stereo_ubo.half_fov[0]     = glm_rad(shader_inputs_ubo.iHFovDegrees) * 0.5f;
+  stereo_ubo.half_fov[1]     = glm_rad(shader_inputs_ubo.iVFovDegrees) * 0.5f;
+  stereo_ubo.visualize_input = shader_inputs_ubo.iVisualizeInput ? 1u : 0u;
+
+  wgpu_queue_write_buffer(wgpu_context, stereo.uniform_buffer.buffer, 0,
+                          &stereo_ubo, stereo.uniform_buffer.size);
+}
+
 static void update_uniform_buffers(wgpu_example_context_t* context)
 {
   // iResolution: viewport resolution (in pixels)
@@ -278,6 +439,9 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   if (shader_inputs_ubo_update_needed) {
     wgpu_queue_write_buffer(context->wgpu_context, uniform_buffer_vs.buffer, 0,
                             &shader_inputs_ubo, uniform_buffer_vs.size);
+    if (stereo.enabled) {
+      update_stereo_uniform_buffer(context->wgpu_context);
+    }
     shader_inputs_ubo_update_needed = false;
   }
 }
@@ -373,37 +537,181 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+static void prepare_stereo(wgpu_context_t* wgpu_context)
+{
+  stereo.uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(stereo_ubo),
+                  });
+
+  // Bind group layout, the eye views are read by the fragment shader
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Uniform buffer of the eyes
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(stereo_ubo),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Video texture view, shared with the mono pipeline
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Video texture sampler
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout){
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+  };
+  stereo.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "Immersive video stereo bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(stereo.bind_group_layout != NULL);
+
+  stereo.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts     = &stereo.bind_group_layout,
+                          });
+  ASSERT(stereo.pipeline_layout != NULL);
+
+  // Bind group
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = stereo.uniform_buffer.buffer,
+      .size    = stereo.uniform_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = video_texture.view,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .sampler = video_texture.sampler,
+    },
+  };
+  stereo.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Immersive video stereo bind group",
+                            .layout     = stereo.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(stereo.bind_group != NULL);
+
+  // Pipeline, one quad per eye
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleStrip,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  WGPUBlendState blend_state              = wgpu_create_blend_state(false);
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      // Vertex shader WGSL
+                      .label            = "stereo_vertex_shader",
+                      .wgsl_code.source = stereo_shader_wgsl,
+                      .entry            = "vs_main",
+                    },
+                    .buffer_count = 0,
+                    .buffers      = NULL,
+                  });
+
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      // Fragment shader WGSL
+                      .label            = "stereo_fragment_shader",
+                      .wgsl_code.source = stereo_shader_wgsl,
+                      .entry            = "fs_main",
+                    },
+                    .target_count = 1,
+                    .targets      = &color_target_state,
+                  });
+
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  stereo.pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label       = "immersive_video_stereo_pipeline",
+                            .layout      = stereo.pipeline_layout,
+                            .primitive   = primitive_state,
+                            .vertex      = vertex_state,
+                            .fragment    = &fragment_state,
+                            .multisample = multisample_state,
+                          });
+  ASSERT(stereo.pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
 static int prepare_video(const char* fname)
 {
-  init_video_decode();
-  open_video_file(fname);
+  video_decoder = video_decoder_open(&(video_decoder_desc_t){
+    .filename = fname,
+  });
+  if (video_decoder == NULL) {
+    return 1;
+  }
 
-  get_video_dimension(&video_info.frame_size.width,
-                      &video_info.frame_size.height);
+  video_frame_info_t frame_info = {0};
+  video_decoder_get_frame_info(video_decoder, &frame_info);
+  video_info.frame_size.width  = frame_info.width;
+  video_info.frame_size.height = frame_info.height;
 
-  start_video_decode();
+  video_decoder_start(video_decoder);
 
   return 0;
 }
 
 static int update_capture_texture(wgpu_context_t* wgpu_context)
 {
-  int video_w, video_h;
-  void* video_buf;
-
-  get_video_dimension(&video_w, &video_h);
-  get_video_buffer(&video_buf);
-
-  if (video_buf) {
-    wgpu_image_to_texure(wgpu_context, video_texture.texture,
-                         (uint8_t*)video_buf,
-                         (WGPUExtent3D){
-                           .width              = video_info.frame_size.width,
-                           .height             = video_info.frame_size.height,
-                           .depthOrArrayLayers = 1,
-                         },
-                         4u);
+  // Only upload frames decoded since the last update
+  video_frame_t frame = {0};
+  if (video_decoder_acquire_frame(video_decoder, &frame) && frame.data) {
+    if (video_texture.yuv_converter != NULL) {
+      wgpu_yuv_converter_convert(video_texture.yuv_converter, frame.data);
+    }
+    else {
+      wgpu_image_to_texure(wgpu_context, video_texture.texture,
+                           (uint8_t*)frame.data,
+                           (WGPUExtent3D){
+                             .width              = video_info.frame_size.width,
+                             .height             = video_info.frame_size.height,
+                             .depthOrArrayLayers = 1,
+                           },
+                           4u);
+    }
   }
+  video_decoder_release_frame(video_decoder);
 
   return 0;
 }
@@ -411,13 +719,16 @@ static int update_capture_texture(wgpu_context_t* wgpu_context)
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
-    prepare_video(video_file_location);
+    if (prepare_video(video_file_location) != 0) {
+      return 1;
+    }
     prepare_video_texture(context->wgpu_context);
     prepare_mouse_state(context->wgpu_context);
     prepare_uniform_buffers(context);
     setup_pipeline_layout(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
+    prepare_stereo(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -447,6 +758,18 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                &shader_inputs_ubo.iVisualizeInput)) {
       shader_inputs_ubo_update_needed = true;
     }
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Stereo",
+                               &stereo.enabled)) {
+      shader_inputs_ubo_update_needed = true;
+    }
+    if (stereo.enabled) {
+      static const char* video_layouts[3]
+        = {"Mono", "Top-bottom", "Side-by-side"};
+      if (imgui_overlay_combo_box(context->imgui_overlay, "Video layout",
+                                  &stereo.video_layout, video_layouts, 3)) {
+        shader_inputs_ubo_update_needed = true;
+      }
+    }
   }
 }
 
@@ -464,11 +787,13 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpu_context->cmd_enc, &render_pass.descriptor);
 
   // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                   stereo.enabled ? stereo.pipeline : pipeline);
 
   // Set the bind group
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
-                                    0);
+  wgpuRenderPassEncoderSetBindGroup(
+    wgpu_context->rpass_enc, 0,
+    stereo.enabled ? stereo.bind_group : bind_group, 0, 0);
 
   // Set viewport
   wgpuRenderPassEncoderSetViewport(
@@ -480,8 +805,14 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
-  // Draw quad
-  wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  if (stereo.enabled) {
+    // Both eyes in one draw, one instance per eye
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 4, 2, 0, 0);
+  }
+  else {
+    // Draw quad
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  }
 
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
@@ -539,11 +870,18 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Texture, video_texture.texture)
   WGPU_RELEASE_RESOURCE(TextureView, video_texture.view)
   WGPU_RELEASE_RESOURCE(Sampler, video_texture.sampler)
+  wgpu_yuv_converter_destroy(video_texture.yuv_converter);
+  video_decoder_release(video_decoder);
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer_vs.buffer)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
+  WGPU_RELEASE_RESOURCE(Buffer, stereo.uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, stereo.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, stereo.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, stereo.bind_group)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, stereo.pipeline)
 }
 
 void example_immersive_video(int argc, char* argv[])
@@ -10,7 +10,8 @@
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Instanced Cube
  *
- * This example shows the use of instancing.
+ * This example shows the use of instancing. The per-instance matrices are
+ * composed and multiplied with the batch matrix transforms.
  *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/blob/main/src/sample/instancedCube
@@ -71,9 +72,11 @@ static struct {
 static struct {
   mat4 projection;
   mat4 view;
+  mat4 view_projection;
+  vec3 translations[MAX_NUM_INSTANCES];
+  versor rotations[MAX_NUM_INSTANCES];
   mat4 model[MAX_NUM_INSTANCES];
-  float model_view_projection[16 * MAX_NUM_INSTANCES];
-  mat4 tmp;
+  mat4 model_view_projection[MAX_NUM_INSTANCES];
 } view_matrices = {0};
 
 // Pipeline
@@ -136,28 +139,24 @@ static void update_transformation_matrix(wgpu_example_context_t* context)
 {
   const float now = context->frame.timestamp_millis / 1000.0f;
 
-  uint32_t m = 0, i = 0;
+  uint32_t i = 0;
   for (uint32_t x = 0; x < x_count; x++) {
     for (uint32_t y = 0; y < y_count; y++) {
-      memcpy(view_matrices.tmp, view_matrices.model[i], sizeof(mat4));
-      glm_rotate(view_matrices.tmp, 1.0f,
-                 (vec3){
-                   sin(((float)x + 0.5f) * now), // x
-                   cos(((float)y + 0.5f) * now), // y
-                   0.0f                          // z
-                 });
-
-      glm_mat4_mul(view_matrices.view, view_matrices.tmp, view_matrices.tmp);
-      glm_mat4_mul(view_matrices.projection, view_matrices.tmp,
-                   view_matrices.tmp);
-
-      memcpy(&view_matrices.model_view_projection[m], view_matrices.tmp,
-             sizeof(view_matrices.tmp));
-
+      glm_quatv(view_matrices.rotations[i], 1.0f,
+                (vec3){
+                  sin(((float)x + 0.5f) * now), // x
+                  cos(((float)y + 0.5f) * now), // y
+                  0.0f                          // z
+                });
       ++i;
-      m += matrix_float_count;
     }
   }
+
+  // Model matrices and model view projection matrices of all instances
+  mat4_compose_trs_batch(view_matrices.translations, view_matrices.rotations,
+                         NULL, view_matrices.model, num_instances);
+  mat4_mul_batch(view_matrices.view_projection, view_matrices.model,
+                 view_matrices.model_view_projection, num_instances);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -183,25 +182,26 @@ static void prepare_view_matrices(wgpu_context_t* wgpu_context)
   glm_mat4_identity(view_matrices.view);
   glm_translate(view_matrices.view, (vec3){0.0f, 0.0f, -12.0f});
 
-  // Temporary matrix
-  glm_mat4_identity(view_matrices.tmp);
+  // View projection matrix
+  glm_mat4_mul(view_matrices.projection, view_matrices.view,
+               view_matrices.view_projection);
 }
 
 static void prepare_model_matrices()
 {
   const float step = 4.0f;
 
-  // Initialize the matrix data for every instance.
+  // Initialize the translation of every instance.
   uint32_t m = 0;
   for (uint32_t x = 0; x < x_count; x++) {
     for (uint32_t y = 0; y < y_count; y++) {
-      glm_mat4_identity(view_matrices.model[m]);
-      glm_translate(view_matrices.model[m],
-                    (vec3){
-                      step * (x - x_count / 2.0f + 0.5f), // x
-                      step * (y - y_count / 2.0f + 0.5f), // y
-                      0.0f                                // z
-                    });
+      glm_vec3_copy(
+        (vec3){
+          step * (x - x_count / 2.0f + 0.5f), // x
+          step * (y - y_count / 2.0f + 0.5f), // y
+          0.0f                                // z
+        },
+        view_matrices.translations[m]);
       ++m;
     }
   }
@@ -1,6 +1,7 @@
 #include "meshes.h"
 
 #include <cglm/cglm.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../core/log.h"
@@ -10,19 +11,20 @@
  * Plane mesh
  * -------------------------------------------------------------------------- */
 
-void plane_mesh_generate_vertices(plane_mesh_t* plane_mesh)
+void plane_mesh_write_vertices(const plane_mesh_t* plane_mesh,
+                               plane_vertex_t* vertices)
 {
-  plane_mesh->vertex_count = 0;
-  const float row_height   = plane_mesh->height / (float)plane_mesh->rows;
-  const float col_width    = plane_mesh->width / (float)plane_mesh->columns;
+  const float row_height = plane_mesh->height / (float)plane_mesh->rows;
+  const float col_width  = plane_mesh->width / (float)plane_mesh->columns;
   float x = 0.0f, y = 0.0f;
+  uint64_t vertex_index = 0;
   for (uint32_t row = 0; row <= plane_mesh->rows; ++row) {
     y = row * row_height;
 
     for (uint32_t col = 0; col <= plane_mesh->columns; ++col) {
       x = col * col_width;
 
-      plane_vertex_t* vertex = &plane_mesh->vertices[plane_mesh->vertex_count];
+      plane_vertex_t* vertex = &vertices[vertex_index];
       {
         // Vertex position
         vertex->position[0] = x;
@@ -35,19 +37,20 @@ void plane_mesh_generate_vertices(plane_mesh_t* plane_mesh)
         vertex->normal[2] = 1.0f;
 
         // Vertex uv
-        vertex->uv[0] = col / plane_mesh->columns;
-        vertex->uv[1] = 1 - row / plane_mesh->rows;
+        vertex->uv[0] = col / (float)plane_mesh->columns;
+        vertex->uv[1] = 1.0f - row / (float)plane_mesh->rows;
       }
-      ++plane_mesh->vertex_count;
+      ++vertex_index;
     }
   }
 }
 
-void plane_mesh_generate_indices(plane_mesh_t* plane_mesh)
+void plane_mesh_write_indices(const plane_mesh_t* plane_mesh,
+                              uint32_t* indices)
 {
-  plane_mesh->index_count       = 0;
   const uint32_t columns_offset = plane_mesh->columns + 1;
   uint32_t left_bottom = 0, right_bottom = 0, left_up = 0, right_up = 0;
+  uint64_t index = 0;
   for (uint32_t row = 0; row < plane_mesh->rows; ++row) {
     for (uint32_t col = 0; col < plane_mesh->columns; ++col) {
       left_bottom  = columns_offset * row + col;
@@ -56,13 +59,13 @@ void plane_mesh_generate_indices(plane_mesh_t* plane_mesh)
       right_up     = columns_offset * (row + 1) + (col + 1);
 
       // CCW frontface
-      plane_mesh->indices[plane_mesh->index_count++] = left_up;
-      plane_mesh->indices[plane_mesh->index_count++] = left_bottom;
-      plane_mesh->indices[plane_mesh->index_count++] = right_bottom;
+      indices[index++] = left_up;
+      indices[index++] = left_bottom;
+      indices[index++] = right_bottom;
 
-      plane_mesh->indices[plane_mesh->index_count++] = right_up;
-      plane_mesh->indices[plane_mesh->index_count++] = left_up;
-      plane_mesh->indices[plane_mesh->index_count++] = right_bottom;
+      indices[index++] = right_up;
+      indices[index++] = left_up;
+      indices[index++] = right_bottom;
     }
   }
 }
@@ -76,12 +79,34 @@ void plane_mesh_init(plane_mesh_t* plane_mesh,
   plane_mesh->rows    = options ? options->rows : 1;
   plane_mesh->columns = options ? options->columns : 1;
 
-  ASSERT((plane_mesh->rows + 1) * (plane_mesh->columns + 1)
-         < MAX_PLANE_VERTEX_COUNT)
+  plane_mesh->vertex_count
+    = (uint64_t)(plane_mesh->rows + 1) * (plane_mesh->columns + 1);
+  plane_mesh->index_count
+    = (uint64_t)plane_mesh->rows * plane_mesh->columns * 6;
+  ASSERT(plane_mesh->vertex_count <= UINT32_MAX)
+
+  plane_mesh->vertices = NULL;
+  plane_mesh->indices  = NULL;
+  if (options && options->counts_only) {
+    return;
+  }
 
   // Generate vertices and indices
-  plane_mesh_generate_vertices(plane_mesh);
-  plane_mesh_generate_indices(plane_mesh);
+  plane_mesh->vertices
+    = malloc(plane_mesh->vertex_count * sizeof(*plane_mesh->vertices));
+  plane_mesh->indices
+    = malloc(plane_mesh->index_count * sizeof(*plane_mesh->indices));
+  ASSERT(plane_mesh->vertices != NULL && plane_mesh->indices != NULL)
+  plane_mesh_write_vertices(plane_mesh, plane_mesh->vertices);
+  plane_mesh_write_indices(plane_mesh, plane_mesh->indices);
+}
+
+void plane_mesh_destroy(plane_mesh_t* plane_mesh)
+{
+  free(plane_mesh->vertices);
+  free(plane_mesh->indices);
+  plane_mesh->vertices = NULL;
+  plane_mesh->indices  = NULL;
 }
 
 /* -------------------------------------------------------------------------- *
@@ -290,6 +315,15 @@ int stanford_dragon_mesh_init(stanford_dragon_mesh_t* stanford_dragon_mesh)
     return 1;
   }
 
+  stanford_dragon_mesh->positions.data = calloc(
+    POSITION_COUNT_RES_4, sizeof(*stanford_dragon_mesh->positions.data));
+  stanford_dragon_mesh->triangles.data
+    = calloc(CELL_COUNT_RES_4, sizeof(*stanford_dragon_mesh->triangles.data));
+  stanford_dragon_mesh->normals.data
+    = calloc(POSITION_COUNT_RES_4, sizeof(*stanford_dragon_mesh->normals.data));
+  stanford_dragon_mesh->uvs.data
+    = calloc(POSITION_COUNT_RES_4, sizeof(*stanford_dragon_mesh->uvs.data));
+
   stanford_dragon_mesh->positions.count
     = ply_set_read_cb(ply, "vertex", "x", vertex_cb, stanford_dragon_mesh, 0);
   ply_set_read_cb(ply, "vertex", "y", vertex_cb, stanford_dragon_mesh, 1);
@@ -297,11 +331,7 @@ int stanford_dragon_mesh_init(stanford_dragon_mesh_t* stanford_dragon_mesh)
   stanford_dragon_mesh->triangles.count = ply_set_read_cb(
     ply, "face", "vertex_indices", face_cb, stanford_dragon_mesh, 0);
   stanford_dragon_mesh->normals.count = stanford_dragon_mesh->positions.count;
-  memset(stanford_dragon_mesh->normals.data, 0,
-         sizeof(stanford_dragon_mesh->normals.data)); // Initialize to zero
-  stanford_dragon_mesh->uvs.count = stanford_dragon_mesh->positions.count;
-  memset(stanford_dragon_mesh->uvs.data, 0,
-         sizeof(stanford_dragon_mesh->uvs.data)); // Initialize to zero
+  stanford_dragon_mesh->uvs.count     = stanford_dragon_mesh->positions.count;
   if (!ply_read(ply)) {
     return 1;
   }
@@ -324,6 +354,15 @@ int stanford_dragon_mesh_init(stanford_dragon_mesh_t* stanford_dragon_mesh)
   return 0;
 }
 
+void stanford_dragon_mesh_destroy(stanford_dragon_mesh_t* stanford_dragon_mesh)
+{
+  free(stanford_dragon_mesh->positions.data);
+  free(stanford_dragon_mesh->triangles.data);
+  free(stanford_dragon_mesh->normals.data);
+  free(stanford_dragon_mesh->uvs.data);
+  memset(stanford_dragon_mesh, 0, sizeof(*stanford_dragon_mesh));
+}
+
 void stanford_dragon_mesh_compute_normals(
   stanford_dragon_mesh_t* stanford_dragon_mesh)
 {
@@ -1,14 +1,13 @@
 #ifndef MESHES_H
 #define MESHES_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /* -------------------------------------------------------------------------- *
  * Plane mesh
  * -------------------------------------------------------------------------- */
 
-#define MAX_PLANE_VERTEX_COUNT 1024 * 1024 * 4
-
 typedef struct plane_vertex_t {
   float position[3];
   float normal[3];
@@ -22,8 +21,9 @@ typedef struct plane_mesh_t {
   uint32_t columns;
   uint64_t vertex_count;
   uint64_t index_count;
-  plane_vertex_t vertices[MAX_PLANE_VERTEX_COUNT];
-  uint32_t indices[MAX_PLANE_VERTEX_COUNT * 6];
+  /* Allocated to the counts, NULL for meshes initialized with counts_only */
+  plane_vertex_t* vertices;
+  uint32_t* indices;
 } plane_mesh_t;
 
 typedef struct plane_mesh_init_options_t {
@@ -31,10 +31,21 @@ typedef struct plane_mesh_init_options_t {
   float height;
   uint32_t rows;
   uint32_t columns;
+  /* Only sets the dimensions and counts, the grid is written by the caller
+   * with plane_mesh_write_vertices() / plane_mesh_write_indices(), e.g. into
+   * buffers mapped at creation */
+  bool counts_only;
 } plane_mesh_init_options_t;
 
 void plane_mesh_init(plane_mesh_t* plane_mesh,
                      plane_mesh_init_options_t* options);
+void plane_mesh_destroy(plane_mesh_t* plane_mesh);
+
+/* Generate the grid into vertex_count vertices / index_count indices */
+void plane_mesh_write_vertices(const plane_mesh_t* plane_mesh,
+                               plane_vertex_t* vertices);
+void plane_mesh_write_indices(const plane_mesh_t* plane_mesh,
+                              uint32_t* indices);
 
 /* -------------------------------------------------------------------------- *
  * Cube mesh
@@ -84,20 +95,21 @@ void indexed_cube_mesh_init(indexed_cube_mesh_t* cube_mesh);
 #define STANFORD_DRAGON_MESH_SCALE 500
 
 typedef struct stanford_dragon_mesh_t {
+  /* Allocated by stanford_dragon_mesh_init() */
   struct {
-    float data[POSITION_COUNT_RES_4][3];
+    float (*data)[3];
     uint64_t count; // number of vertices (should be 5205)
   } positions;
   struct {
-    uint16_t data[CELL_COUNT_RES_4][3];
+    uint16_t (*data)[3];
     uint64_t count; // number of faces (should be 11102)
   } triangles;      // triangles
   struct {
-    float data[POSITION_COUNT_RES_4][3];
+    float (*data)[3];
     uint64_t count; // number of normals (should be 5205)
   } normals;
   struct {
-    float data[POSITION_COUNT_RES_4][2];
+    float (*data)[2];
     uint64_t count; // number of uvs (should be 5205)
   } uvs;
 } stanford_dragon_mesh_t;
@@ -110,6 +122,7 @@ typedef struct stanford_dragon_mesh_t {
  * @see http://w3.impa.br/~diego/software/rply/
  */
 int stanford_dragon_mesh_init(stanford_dragon_mesh_t* stanford_dragon_mesh);
+void stanford_dragon_mesh_destroy(stanford_dragon_mesh_t* stanford_dragon_mesh);
 
 typedef enum projected_plane_enum {
   ProjectedPlane_XY = 0,
@@ -10,9 +10,10 @@
  *
  * The parts of this example enabling MSAA are:
  * *    The render pipeline is created with a sample_count > 1.
- * *    A new texture with a sample_count > 1 is created and set as the
- *      color_attachment instead of the swapchain.
- * *    The swapchain is now specified as a resolve_target.
+ * *    A transient texture with a sample_count > 1 is created and set as the
+ *      color_attachment instead of the swapchain, see wgpu_msaa_target_t.
+ * *    The swapchain is now specified as a resolve_target, the samples are
+ *      resolved in the render pass and not stored.
  *
  * The parts of this example enabling LineList are:
  * *   Set the primitive_topology to PrimitiveTopology::LineList.
@@ -23,7 +24,7 @@
  * -------------------------------------------------------------------------- */
 
 #define NUMBER_OF_LINES 50u
-static const uint32_t sample_count = 4;
+static uint32_t sample_count = 4;
 
 typedef struct {
   vec2 position;
@@ -46,9 +47,8 @@ static WGPURenderPassDescriptor render_pass_desc;
 // Render bundle
 static WGPURenderBundle render_bundle;
 
-// Multi-sampled texture
-static WGPUTexture multisampled_texture;
-static WGPUTextureView multisampled_framebuffer;
+// Multi-sampled color attachment
+static wgpu_msaa_target_t* msaa_target;
 
 // Other variables
 static const char* example_title = "MSAA Line";
@@ -84,36 +84,12 @@ static void prepare_vertex_buffer(wgpu_context_t* wgpu_context)
 
 static void create_multisampled_framebuffer(wgpu_context_t* wgpu_context)
 {
-  // Create the multi-sampled texture
-  WGPUTextureDescriptor multisampled_frame_desc = {
-    .label         = "Multi-sampled texture",
-    .size          = (WGPUExtent3D){
-      .width               = wgpu_context->surface.width,
-      .height              = wgpu_context->surface.height,
-      .depthOrArrayLayers  = 1,
-     },
-    .mipLevelCount = 1,
-    .sampleCount   = sample_count,
-    .dimension     = WGPUTextureDimension_2D,
-    .format        = wgpu_context->swap_chain.format,
-    .usage         = WGPUTextureUsage_RenderAttachment,
-  };
-  multisampled_texture
-    = wgpuDeviceCreateTexture(wgpu_context->device, &multisampled_frame_desc);
-  ASSERT(multisampled_texture != NULL);
-
-  // Create the multi-sampled texture view
-  multisampled_framebuffer = wgpuTextureCreateView(
-    multisampled_texture, &(WGPUTextureViewDescriptor){
-                            .label           = "Multi-sampled texture view",
-                            .format          = wgpu_context->swap_chain.format,
-                            .dimension       = WGPUTextureViewDimension_2D,
-                            .baseMipLevel    = 0,
-                            .mipLevelCount   = 1,
-                            .baseArrayLayer  = 0,
-                            .arrayLayerCount = 1,
-                          });
-  ASSERT(multisampled_framebuffer != NULL);
+  msaa_target = wgpu_msaa_target_create(
+    wgpu_context, &(wgpu_msaa_target_desc_t){
+                    .label        = "Multi-sampled texture",
+                    .sample_count = sample_count,
+                  });
+  sample_count = wgpu_msaa_target_get_sample_count(msaa_target);
 }
 
 static void setup_render_bundle(wgpu_context_t* wgpu_context)
@@ -140,21 +116,7 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   UNUSED_VAR(wgpu_context);
 
-  // Color attachment
-  rp_color_att_descriptors[0] = (WGPURenderPassColorAttachment) {
-      .view          = NULL, // Assigned later
-      .resolveTarget = NULL,
-      .loadOp        = WGPULoadOp_Clear,
-      .storeOp       = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.0f,
-        .g = 0.0f,
-        .b = 0.0f,
-        .a = 1.0f,
-      },
-  };
-
-  // Render pass descriptor
+  // Render pass descriptor, the color attachment is assigned later
   render_pass_desc = (WGPURenderPassDescriptor){
     .colorAttachmentCount = 1,
     .colorAttachments     = rp_color_att_descriptors,
@@ -248,8 +210,8 @@ static int example_initialize(wgpu_example_context_t* context)
   if (context) {
     prepare_vertex_buffer(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
-    prepare_pipelines(context->wgpu_context);
     create_multisampled_framebuffer(context->wgpu_context);
+    prepare_pipelines(context->wgpu_context);
     setup_render_bundle(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
@@ -261,16 +223,10 @@ static int example_initialize(wgpu_example_context_t* context)
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
-  // Set target frame buffer
-  if (sample_count == 1) {
-    rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
-    rp_color_att_descriptors[0].resolveTarget = NULL;
-  }
-  else {
-    rp_color_att_descriptors[0].view = multisampled_framebuffer;
-    rp_color_att_descriptors[0].resolveTarget
-      = wgpu_context->swap_chain.frame_buffer;
-  }
+  // Set target frame buffer, the multi-sampled texture is resolved into it
+  wgpu_msaa_target_get_attachments(
+    msaa_target, wgpu_context->swap_chain.frame_buffer,
+    &(WGPUColor){0.0f, 0.0f, 0.0f, 1.0f}, &rp_color_att_descriptors[0], NULL);
 
   // Create command encoder
   wgpu_context->cmd_enc
@@ -328,8 +284,7 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
-  WGPU_RELEASE_RESOURCE(Texture, multisampled_texture)
-  WGPU_RELEASE_RESOURCE(TextureView, multisampled_framebuffer)
+  wgpu_msaa_target_destroy(msaa_target);
   WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
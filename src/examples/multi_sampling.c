@@ -11,20 +11,22 @@
  *
  * Implements multisample anti-aliasing (MSAA) using a renderpass with
  * multisampled attachment that get resolved into the visible frame buffer.
+ * The multisampled color and depth attachments are transient, the sample
+ * count can be changed at runtime. Primitives outside of the view frustum are
+ * skipped on the CPU, which saves the multi-sampled rasterization of parts of
+ * the model that are zoomed out of view. Zoomed out primitives are drawn with
+ * simplified levels of detail generated at load time, small triangles are
+ * expensive with multiple samples per pixel.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/multisampling/multisampling.cpp
  * -------------------------------------------------------------------------- */
 
-static const uint32_t msaa_sample_count = 4;
-static bool use_msaa                    = false;
+static const uint32_t sample_counts[4]     = {1, 2, 4, 8};
+static const char* sample_count_names[4] = {"1x", "2x", "4x", "8x"};
+static int32_t sample_count_index        = 2;
 
-static struct {
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView view;
-  } color;
-} multi_sample_target = {0};
+static wgpu_msaa_target_t* msaa_target = NULL;
 
 static struct gltf_model_t* gltf_model;
 
@@ -38,18 +40,23 @@ static struct {
   .light_pos = {5.0f, -5.0f, 5.0f, 1.0f},
 };
 
+// Culls the primitives of the model against the view frustum and selects
+// their levels of detail by their projected size
+static mat4 view_projection = GLM_MAT4_IDENTITY_INIT;
+static bool frustum_culling = true;
+static bool select_lod      = true;
+
 static struct {
   WGPUBindGroupLayout ubo_vs;
   WGPUBindGroupLayout textures;
 } bind_group_layouts = {0};
 
-static struct {
-  WGPURenderPipeline normal;
-  WGPURenderPipeline msaa;
-} pipelines = {0};
+// Pipelines of the supported sample counts
+static WGPURenderPipeline pipelines[4] = {0};
 
 // Render pass descriptor for frame buffer writes
 static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
+static WGPURenderPassDepthStencilAttachment rp_depth_stencil_att_descriptor;
 static WGPURenderPassDescriptor render_pass_desc;
 
 static WGPUPipelineLayout pipeline_layout;
@@ -73,7 +80,8 @@ static void setup_camera(wgpu_example_context_t* context)
 static void load_assets(wgpu_context_t* wgpu_context)
 {
   const uint32_t gltf_loading_flags
-    = WGPU_GLTF_FileLoadingFlags_PreTransformVertices;
+    = WGPU_GLTF_FileLoadingFlags_PreTransformVertices
+      | WGPU_GLTF_FileLoadingFlags_GenerateLods;
   gltf_model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
     .wgpu_context       = wgpu_context,
     .filename           = "models/voyager.gltf",
@@ -81,70 +89,36 @@ static void load_assets(wgpu_context_t* wgpu_context)
   });
 }
 
-// Creates a multi sample render target (texture and view) that is used to
-// resolve into the visible frame buffer target in the render pass
-static void setup_multisample_target(wgpu_context_t* wgpu_context)
+static void set_sample_count(uint32_t sample_count)
 {
-  // Color target
-  {
-    // Create the multi-sampled texture
-    WGPUTextureDescriptor multisampled_frame_desc = {
-      .size          = (WGPUExtent3D){
-        .width               = wgpu_context->surface.width,
-        .height              = wgpu_context->surface.height,
-        .depthOrArrayLayers  = 1,
-      },
-      .mipLevelCount = 1,
-      .sampleCount   = msaa_sample_count,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = wgpu_context->swap_chain.format,
-      .usage         = WGPUTextureUsage_RenderAttachment,
-    };
-    multi_sample_target.color.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &multisampled_frame_desc);
-    ASSERT(multi_sample_target.color.texture != NULL);
-
-    // Create the multi-sampled texture view
-    multi_sample_target.color.view
-      = wgpuTextureCreateView(multi_sample_target.color.texture,
-                              &(WGPUTextureViewDescriptor){
-                                .format       = wgpu_context->swap_chain.format,
-                                .dimension    = WGPUTextureViewDimension_2D,
-                                .baseMipLevel = 0,
-                                .mipLevelCount   = 1,
-                                .baseArrayLayer  = 0,
-                                .arrayLayerCount = 1,
-                              });
-    ASSERT(multi_sample_target.color.view != NULL);
+  // Unsupported sample counts fall back to the next lower supported count
+  sample_count = wgpu_msaa_target_set_sample_count(msaa_target, sample_count);
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(sample_counts); ++i) {
+    if (sample_counts[i] == sample_count) {
+      sample_count_index = (int32_t)i;
+    }
   }
 }
 
-static void setup_render_pass(wgpu_context_t* wgpu_context)
+// Creates the multi sample color and depth targets, the color target is
+// resolved into the visible frame buffer target in the render pass
+static void setup_multisample_target(wgpu_context_t* wgpu_context)
 {
-  UNUSED_VAR(wgpu_context);
-
-  // Color attachment
-  rp_color_att_descriptors[0] = (WGPURenderPassColorAttachment) {
-      .view          = NULL, // Assigned later
-      .resolveTarget = NULL,
-      .loadOp        = WGPULoadOp_Clear,
-      .storeOp       = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.0f,
-        .g = 0.0f,
-        .b = 0.0f,
-        .a = 1.0f,
-      },
+  wgpu_msaa_target_desc_t msaa_target_desc = {
+    .label                = "Multi-sampled render target",
+    .depth_stencil_format = WGPUTextureFormat_Depth24PlusStencil8,
   };
+  msaa_target = wgpu_msaa_target_create(wgpu_context, &msaa_target_desc);
+  set_sample_count(sample_counts[sample_count_index]);
+}
 
-  // Depth attachment
-  wgpu_setup_deph_stencil(wgpu_context, NULL);
-
-  // Render pass descriptor
+static void setup_render_pass(void)
+{
+  // Render pass descriptor, the attachments are assigned later
   render_pass_desc = (WGPURenderPassDescriptor){
     .colorAttachmentCount   = 1,
     .colorAttachments       = rp_color_att_descriptors,
-    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+    .depthStencilAttachment = &rp_depth_stencil_att_descriptor,
   };
 }
 
@@ -333,40 +307,22 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
                     .targets      = &color_target_state,
                   });
 
-  // Normal non-MSAA rendering pipeline
-  {
-    // Multisample state
-    WGPUMultisampleState multisample_state
-      = wgpu_create_multisample_state_descriptor(
-        &(create_multisample_state_desc_t){
-          .sample_count = 1,
-        });
-
-    // Create rendering pipeline using the specified states
-    pipelines.normal = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                              .label        = "normal_render_pipeline",
-                              .layout       = pipeline_layout,
-                              .primitive    = primitive_state,
-                              .vertex       = vertex_state,
-                              .fragment     = &fragment_state,
-                              .depthStencil = &depth_stencil_state,
-                              .multisample  = multisample_state,
-                            });
-    ASSERT(pipelines.normal != NULL);
-  }
+  // Rendering pipeline of each supported sample count
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(sample_counts); ++i) {
+    if (!wgpu_msaa_is_sample_count_supported(wgpu_context->swap_chain.format,
+                                             sample_counts[i])) {
+      continue;
+    }
 
-  // MSAA rendering pipeline
-  {
     // Multisample state
     WGPUMultisampleState multisample_state
       = wgpu_create_multisample_state_descriptor(
         &(create_multisample_state_desc_t){
-          .sample_count = msaa_sample_count,
+          .sample_count = sample_counts[i],
         });
 
     // Create rendering pipeline using the specified states
-    pipelines.msaa = wgpuDeviceCreateRenderPipeline(
+    pipelines[i] = wgpuDeviceCreateRenderPipeline(
       wgpu_context->device, &(WGPURenderPipelineDescriptor){
                               .label        = "msaa_render_pipeline",
                               .layout       = pipeline_layout,
@@ -376,7 +332,7 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
                               .depthStencil = &depth_stencil_state,
                               .multisample  = multisample_state,
                             });
-    ASSERT(pipelines.msaa != NULL);
+    ASSERT(pipelines[i] != NULL);
   }
 
   // Partial cleanup
@@ -389,6 +345,8 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   camera_t* camera = context->camera;
   glm_mat4_copy(camera->matrices.perspective, ubo_vs.projection);
   glm_mat4_copy(camera->matrices.view, ubo_vs.model);
+  glm_mat4_mul(camera->matrices.perspective, camera->matrices.view,
+               view_projection);
   wgpu_queue_write_buffer(context->wgpu_context, uniform_buffer.buffer, 0,
                           &ubo_vs, uniform_buffer.size);
 }
@@ -417,7 +375,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_pipelines(context->wgpu_context);
     prepare_uniform_buffers(context);
     setup_bind_groups(context->wgpu_context);
-    setup_render_pass(context->wgpu_context);
+    setup_render_pass();
     prepared = true;
     return 0;
   }
@@ -428,22 +386,26 @@ static int example_initialize(wgpu_example_context_t* context)
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
-    imgui_overlay_checkBox(context->imgui_overlay, "MSAA", &use_msaa);
+    int32_t index = sample_count_index;
+    if (imgui_overlay_combo_box(context->imgui_overlay, "MSAA", &index,
+                                sample_count_names,
+                                (uint32_t)ARRAY_SIZE(sample_count_names))) {
+      set_sample_count(sample_counts[index]);
+    }
+    imgui_overlay_checkBox(context->imgui_overlay, "Frustum culling",
+                           &frustum_culling);
+    imgui_overlay_checkBox(context->imgui_overlay, "Levels of detail",
+                           &select_lod);
   }
 }
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
-  // Set target frame buffer
-  if (use_msaa) {
-    rp_color_att_descriptors[0].view = multi_sample_target.color.view;
-    rp_color_att_descriptors[0].resolveTarget
-      = wgpu_context->swap_chain.frame_buffer;
-  }
-  else {
-    rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
-    rp_color_att_descriptors[0].resolveTarget = NULL;
-  }
+  // Set target frame buffer, the multi-sampled target is resolved into it
+  wgpu_msaa_target_get_attachments(
+    msaa_target, wgpu_context->swap_chain.frame_buffer,
+    &(WGPUColor){0.0f, 0.0f, 0.0f, 1.0f}, &rp_color_att_descriptors[0],
+    &rp_depth_stencil_att_descriptor);
 
   // Create command encoder
   wgpu_context->cmd_enc
@@ -453,25 +415,27 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass_desc);
 
-  // Bind the rendering pipeline
-  if (use_msaa) {
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.msaa);
-  }
-  else {
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.normal);
-  }
+  // Bind the rendering pipeline of the sample count
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                   pipelines[sample_count_index]);
 
   // Bind scene matrices descriptor to set 0
   wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
                                     0);
 
   // Draw model
-  static wgpu_gltf_render_flags_enum_t render_flags
-    = WGPU_GLTF_RenderFlags_BindImages;
-  wgpu_gltf_model_draw(gltf_model, (wgpu_gltf_model_render_options_t){
-                                     .render_flags   = render_flags,
-                                     .bind_image_set = 1,
-                                   });
+  wgpu_gltf_model_render_options_t render_options = {
+    .render_flags   = WGPU_GLTF_RenderFlags_BindImages,
+    .bind_image_set = 1,
+  };
+  glm_mat4_copy(view_projection, render_options.view_projection);
+  if (frustum_culling) {
+    render_options.render_flags |= WGPU_GLTF_RenderFlags_FrustumCulling;
+  }
+  if (select_lod) {
+    render_options.render_flags |= WGPU_GLTF_RenderFlags_SelectLod;
+  }
+  wgpu_gltf_model_draw(gltf_model, render_options);
 
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
@@ -525,13 +489,13 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   camera_release(context->camera);
   wgpu_gltf_model_destroy(gltf_model);
-  WGPU_RELEASE_RESOURCE(Texture, multi_sample_target.color.texture)
-  WGPU_RELEASE_RESOURCE(TextureView, multi_sample_target.color.view)
+  wgpu_msaa_target_destroy(msaa_target);
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_vs)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.textures)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.normal)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.msaa)
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(pipelines); ++i) {
+    WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines[i])
+  }
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
@@ -3,31 +3,64 @@
 
 #include <string.h>
 
+#include "../core/argparse.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/random_fill.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - N-Body Simulation
  *
  * A simple N-body simulation implemented using WebGPU.
  *
+ * The body count is set with --num-bodies=<count> (up to 1M bodies, rounded up
+ * to the workgroup size). The forces are either computed by reading all bodies
+ * from global memory or by the tiled kernel, which stages tiles of bodies in
+ * workgroup memory. For large body counts the grid kernel approximates the
+ * forces: the bodies are sorted into a uniform grid, the bodies of the
+ * neighbouring cells are summed exactly and all other cells act through their
+ * center of mass. The interaction rate of the kernels is shown in the UI,
+ * --turn-off-vsync keeps the frame rate from being limited by the display.
+ *
  * Ref:
  * https://github.com/jrprice/NBody-WebGPU
  * https://en.wikipedia.org/wiki/N-body_simulation
  * -------------------------------------------------------------------------- */
 
 #define NUM_BODIES 8192u
+#define MAX_NUM_BODIES (1024u * 1024u)
 #define WORKGROUP_SIZE 64u
+#define GRID_MAX_DIM 32u
+#define GRID_DOMAIN_MIN -2.0f
+#define GRID_DOMAIN_SIZE 4.0f
 #define INITIAL_EYE_POSITION                                                   \
   {                                                                            \
     0.0f, 0.0f, -1.5f                                                          \
   }
 
 // Simulation parameters
-static const uint32_t num_bodies = NUM_BODIES;
+static uint32_t num_bodies = NUM_BODIES;
 
 // Shader parameters.
 static const uint32_t workgroup_size = WORKGROUP_SIZE;
 
+// Compute kernels
+typedef enum compute_kernel_t {
+  COMPUTE_KERNEL_GLOBAL_MEMORY,
+  COMPUTE_KERNEL_TILED,
+  COMPUTE_KERNEL_GRID,
+  COMPUTE_KERNEL_COUNT,
+} compute_kernel_t;
+
+static int32_t compute_kernel = COMPUTE_KERNEL_TILED;
+static const char* compute_kernel_str[COMPUTE_KERNEL_COUNT] = {
+  "Global memory", /* */
+  "Tiled",         /* */
+  "Grid",          /* */
+};
+
+// Command line arguments
+static bool turn_off_vsync = false;
+
 // Render parameters
 static vec3 eye_position = INITIAL_EYE_POSITION;
 
@@ -48,14 +81,38 @@ static struct {
 
 // Storage buffer block objects
 static struct {
-  struct {
-    wgpu_buffer_t buffer;
-    float positions[NUM_BODIES * 4];
-  } positions_in;
+  wgpu_buffer_t positions_in;
   wgpu_buffer_t positions_out;
   wgpu_buffer_t velocities;
 } storage_buffers = {0};
 
+// Uniform grid of the approximate force kernel
+static struct {
+  uint32_t dim;
+  uint32_t cell_count;
+  struct {
+    float domain_min[3];
+    float cell_size;
+    uint32_t dim;
+    uint32_t cell_count;
+    uint32_t padding[2];
+  } params;
+  wgpu_buffer_t params_buffer;
+  wgpu_buffer_t cells;            /* body count and center sums per cell */
+  wgpu_buffer_t cell_offsets;     /* cell starts and scatter cursors */
+  wgpu_buffer_t sorted_positions; /* positions sorted by cell */
+  wgpu_buffer_t cell_mass;        /* center of mass and mass per cell */
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  struct {
+    WGPUComputePipeline clear;
+    WGPUComputePipeline bin;
+    WGPUComputePipeline scan;
+    WGPUComputePipeline scatter;
+  } pipelines;
+} grid = {0};
+
 // Bind group layouts
 static struct {
   WGPUBindGroupLayout compute;
@@ -76,7 +133,7 @@ static struct {
 
 // Pipelines
 static struct {
-  WGPUComputePipeline compute;
+  WGPUComputePipeline compute[COMPUTE_KERNEL_COUNT];
   WGPURenderPipeline render;
 } pipelines = {0};
 
@@ -86,19 +143,6 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } render_pass = {0};
 
-// FPS counter
-static struct {
-  float fps_update_interval;
-  float num_frames_since_fps_update;
-  float last_fps_update_time;
-  float fps;
-  bool last_fps_update_time_valid;
-} fps_counter = {
-  .fps_update_interval         = 500.0f,
-  .num_frames_since_fps_update = 0.0f,
-  .last_fps_update_time_valid  = false,
-};
-
 static uint32_t frame_idx = 0;
 
 // Other variables
@@ -143,33 +187,37 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   update_uniform_buffers(context);
 }
 
-// Generate initial positions on the surface of a sphere
-static void init_bodies(wgpu_context_t* wgpu_context)
+// Generate initial positions on the surface of a sphere, on the GPU as the
+// body count goes up to 1M
+static void init_bodies(wgpu_example_context_t* context)
 {
-  const float radius = 0.6f;
-  float* positions   = storage_buffers.positions_in.positions;
-  ASSERT(positions)
-  float longitude = 0.0f, latitude = 0.0f;
-  for (uint32_t i = 0; i < num_bodies; ++i) {
-    longitude            = 2.0f * PI * random_float();
-    latitude             = acos((2.0f * random_float() - 1.0f));
-    positions[i * 4 + 0] = radius * sin(latitude) * cos(longitude);
-    positions[i * 4 + 1] = radius * sin(latitude) * sin(longitude);
-    positions[i * 4 + 2] = radius * cos(latitude);
-    positions[i * 4 + 3] = 1.0f;
-  }
+  wgpu_context_t* wgpu_context    = context->wgpu_context;
+  wgpu_random_fill_t* random_fill = wgpu_random_fill_create(wgpu_context);
 
-  // Write the render parameters to the uniform buffer
-  wgpu_queue_write_buffer(wgpu_context,
-                          storage_buffers.positions_in.buffer.buffer, 0,
-                          storage_buffers.positions_in.positions,
-                          storage_buffers.positions_in.buffer.size);
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpu_random_fill_buffer(random_fill, cmd_enc,
+                          storage_buffers.positions_in.buffer, num_bodies,
+                          &(wgpu_random_fill_desc_t){
+                            .distribution = WGPU_RandomDistribution_OnSphere,
+                            // Seeded from the CPU generator for the
+                            // deterministic mode
+                            .seed       = random_uint32(),
+                            .radius     = 0.6f,
+                            .components = 4,
+                          });
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+
+  wgpu_random_fill_destroy(random_fill);
 }
 
 // Create buffers for body positions and velocities.
 static void prepare_storage_buffers(wgpu_example_context_t* context)
 {
-  storage_buffers.positions_in.buffer = wgpu_create_buffer(
+  storage_buffers.positions_in = wgpu_create_buffer(
     context->wgpu_context,
     &(wgpu_buffer_desc_t){
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage
@@ -193,7 +241,7 @@ static void prepare_storage_buffers(wgpu_example_context_t* context)
     });
 
   // Generate initial positions on the surface of a sphere
-  init_bodies(context->wgpu_context);
+  init_bodies(context);
 }
 
 static void setup_compute_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -205,7 +253,7 @@ static void setup_compute_pipeline_layout(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type           = WGPUBufferBindingType_ReadOnlyStorage,
-        .minBindingSize = storage_buffers.positions_in.buffer.size,
+        .minBindingSize = storage_buffers.positions_in.size,
       },
       .sampler = {0},
     },
@@ -284,9 +332,9 @@ static void setup_compute_bind_group(wgpu_context_t* wgpu_context)
     [0] = (WGPUBindGroupEntry) {
       // Binding 0 : Input Positions
       .binding = 0,
-      .buffer  = storage_buffers.positions_in.buffer.buffer,
+      .buffer  = storage_buffers.positions_in.buffer,
       .offset  = 0,
-      .size    = storage_buffers.positions_in.buffer.size,
+      .size    = storage_buffers.positions_in.size,
     },
     [1] = (WGPUBindGroupEntry) {
       // Binding 1 : Output Positions
@@ -325,9 +373,9 @@ static void setup_compute_bind_group(wgpu_context_t* wgpu_context)
       [1] = (WGPUBindGroupEntry) {
         // Binding 1 : Input Positions
         .binding = 1,
-        .buffer  = storage_buffers.positions_in.buffer.buffer,
+        .buffer  = storage_buffers.positions_in.buffer,
         .offset  = 0,
-        .size    = storage_buffers.positions_in.buffer.size,
+        .size    = storage_buffers.positions_in.size,
       },
     [2] = (WGPUBindGroupEntry) {
       // Binding 2 : Velocities
@@ -348,6 +396,104 @@ static void setup_compute_bind_group(wgpu_context_t* wgpu_context)
   }
 }
 
+/* Sizes the grid for the body count: a body interacts with all cells and the
+ * bodies of its 27 neighbouring cells, which is cheapest for a cell count of
+ * about sqrt(27 * num_bodies). */
+static void prepare_grid(wgpu_context_t* wgpu_context)
+{
+  const float cells = sqrtf(27.0f * (float)num_bodies);
+  grid.dim          = CLAMP((uint32_t)roundf(cbrtf(cells)), 4u, GRID_MAX_DIM);
+  grid.cell_count   = grid.dim * grid.dim * grid.dim;
+
+  grid.params.domain_min[0] = GRID_DOMAIN_MIN;
+  grid.params.domain_min[1] = GRID_DOMAIN_MIN;
+  grid.params.domain_min[2] = GRID_DOMAIN_MIN;
+  grid.params.cell_size     = GRID_DOMAIN_SIZE / (float)grid.dim;
+  grid.params.dim           = grid.dim;
+  grid.params.cell_count    = grid.cell_count;
+
+  grid.params_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(grid.params),
+                    .initial.data = &grid.params,
+                  });
+  grid.cells = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = grid.cell_count * 4 * sizeof(uint32_t),
+                  });
+  grid.cell_offsets = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = grid.cell_count * 2 * sizeof(uint32_t),
+                  });
+  grid.sorted_positions = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = num_bodies * 4 * sizeof(float),
+                  });
+  grid.cell_mass = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = grid.cell_count * 4 * sizeof(float),
+                  });
+
+  /* Grid bind group layout, group 1 next to the compute bind group */
+  wgpu_buffer_t* buffers[5] = {
+    &grid.params_buffer,    /* Binding 0 : Grid parameters */
+    &grid.cells,            /* Binding 1 : Cell sums */
+    &grid.cell_offsets,     /* Binding 2 : Cell offsets */
+    &grid.sorted_positions, /* Binding 3 : Sorted positions */
+    &grid.cell_mass,        /* Binding 4 : Cell masses */
+  };
+  WGPUBindGroupLayoutEntry bgl_entries[5] = {0};
+  WGPUBindGroupEntry bg_entries[5]        = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(buffers); ++i) {
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type = (i == 0) ? WGPUBufferBindingType_Uniform :
+                           WGPUBufferBindingType_Storage,
+        .minBindingSize = buffers[i]->size,
+      },
+    };
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding = i,
+      .buffer  = buffers[i]->buffer,
+      .offset  = 0,
+      .size    = buffers[i]->size,
+    };
+  }
+  grid.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(grid.bind_group_layout != NULL);
+
+  grid.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout     = grid.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(grid.bind_group != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts_grid[2] = {
+    bind_group_layouts.compute, /* Group 0 : Bodies */
+    grid.bind_group_layout,     /* Group 1 : Grid */
+  };
+  grid.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts_grid),
+      .bindGroupLayouts     = bind_group_layouts_grid,
+    });
+  ASSERT(grid.pipeline_layout != NULL);
+}
+
 // Create the bind group for the compute shader.
 static void setup_render_bind_group(wgpu_context_t* wgpu_context)
 {
@@ -395,28 +541,315 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   };
 }
 
-// Create the compute pipeline
-static void prepare_compute_pipeline(wgpu_context_t* wgpu_context)
+/* Compute shader, the body count is taken from the buffer size so it can be
+ * chosen at runtime. The body count is a multiple of the workgroup size, which
+ * is also the tile size of the tiled kernel. */
+// clang-format off
+static const char* compute_shader_wgsl = CODE(
+  @group(0) @binding(0) var<storage, read> positionsIn : array<vec4<f32>>;
+  @group(0) @binding(1)
+  var<storage, read_write> positionsOut : array<vec4<f32>>;
+  @group(0) @binding(2)
+  var<storage, read_write> velocities : array<vec4<f32>>;
+
+  const kWorkgroupSize = 64u;
+  const kDelta = 0.000025;
+  const kSoftening = 0.2;
+
+  var<workgroup> tile : array<vec4<f32>, kWorkgroupSize>;
+
+  fn computeForce(ipos : vec4<f32>, jpos : vec4<f32>) -> vec4<f32> {
+    let d = vec4<f32>(jpos.xyz - ipos.xyz, 0.0);
+    let distSq = d.x * d.x + d.y * d.y + d.z * d.z + kSoftening * kSoftening;
+    let dist = inverseSqrt(distSq);
+    let coeff = jpos.w * (dist * dist * dist);
+    return coeff * d;
+  }
+
+  fn integrate(idx : u32, pos : vec4<f32>, force : vec4<f32>) {
+    let vel = velocities[idx] + force * kDelta;
+    velocities[idx] = vel;
+    positionsOut[idx] = pos + vel * kDelta;
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_main(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let idx = gid.x;
+    let numBodies = arrayLength(&positionsIn);
+    let pos = positionsIn[idx];
+
+    var force = vec4<f32>(0.0);
+    for (var i = 0u; i < numBodies; i = i + 1u) {
+      force = force + computeForce(pos, positionsIn[i]);
+    }
+    integrate(idx, pos, force);
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_tiled(@builtin(global_invocation_id) gid : vec3<u32>,
+              @builtin(local_invocation_index) lid : u32) {
+    let idx = gid.x;
+    let numBodies = arrayLength(&positionsIn);
+    let pos = positionsIn[idx];
+
+    var force = vec4<f32>(0.0);
+    for (var t = 0u; t < numBodies; t = t + kWorkgroupSize) {
+      // Each invocation loads one body of the tile
+      tile[lid] = positionsIn[t + lid];
+      workgroupBarrier();
+      for (var i = 0u; i < kWorkgroupSize; i = i + 1u) {
+        force = force + computeForce(pos, tile[i]);
+      }
+      workgroupBarrier();
+    }
+    integrate(idx, pos, force);
+  }
+);
+// clang-format on
+
+/* Grid kernel, built on the bindings and functions of the compute shader. The
+ * shader is split into parts joined by concat_shader_sources() to keep the
+ * string literals short. */
+// clang-format off
+static const char* grid_shader_wgsl[2] = {
+CODE(
+  // Grid kernel
+  struct GridParams {
+    domainMin : vec3<f32>,
+    cellSize : f32,
+    dim : u32,
+    cellCount : u32,
+  }
+
+  struct Cell {
+    count : atomic<u32>,
+    x : atomic<u32>,
+    y : atomic<u32>,
+    z : atomic<u32>,
+  }
+
+  @group(1) @binding(0) var<uniform> grid : GridParams;
+  @group(1) @binding(1) var<storage, read_write> cells : array<Cell>;
+  @group(1) @binding(2)
+  var<storage, read_write> cellOffsets : array<atomic<u32>>;
+  @group(1) @binding(3)
+  var<storage, read_write> sortedPositions : array<vec4<f32>>;
+  @group(1) @binding(4)
+  var<storage, read_write> cellMass : array<vec4<f32>>;
+
+  // Fixed point scale of the positions within a cell
+  const kFixedPointScale = 1024.0;
+  const kScanSize = 256u;
+
+  var<workgroup> scanSums : array<u32, kScanSize>;
+
+  // Position in cell units, bodies outside of the grid are put in the border
+  fn gridCoord(pos : vec3<f32>) -> vec3<f32> {
+    let maxCoord = vec3<f32>(f32(grid.dim) - 0.001);
+    let coord = (pos - grid.domainMin) / grid.cellSize;
+    return clamp(coord, vec3<f32>(0.0), maxCoord);
+  }
+
+  fn cellIndex(cell : vec3<u32>) -> u32 {
+    return cell.x + grid.dim * (cell.y + grid.dim * cell.z);
+  }
+
+  fn cellCoord(index : u32) -> vec3<u32> {
+    return vec3<u32>(index % grid.dim, (index / grid.dim) % grid.dim,
+                     index / (grid.dim * grid.dim));
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_grid_clear(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let c = gid.x;
+    if (c >= grid.cellCount) {
+      return;
+    }
+    atomicStore(&cells[c].count, 0u);
+    atomicStore(&cells[c].x, 0u);
+    atomicStore(&cells[c].y, 0u);
+    atomicStore(&cells[c].z, 0u);
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_grid_bin(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let coord = gridCoord(positionsIn[gid.x].xyz);
+    let inCell = (coord - floor(coord)) * kFixedPointScale;
+    let c = cellIndex(vec3<u32>(coord));
+    atomicAdd(&cells[c].count, 1u);
+    atomicAdd(&cells[c].x, u32(inCell.x));
+    atomicAdd(&cells[c].y, u32(inCell.y));
+    atomicAdd(&cells[c].z, u32(inCell.z));
+  }
+),
+CODE(
+  // Cell offsets from a prefix sum of the cell counts, one workgroup scans
+  // consecutive ranges of cells per invocation
+  @compute @workgroup_size(kScanSize)
+  fn cs_grid_scan(@builtin(local_invocation_index) lid : u32) {
+    let perInvocation = (grid.cellCount + kScanSize - 1u) / kScanSize;
+    let first = min(lid * perInvocation, grid.cellCount);
+    let last = min(first + perInvocation, grid.cellCount);
+    var rangeCount = 0u;
+    for (var c = first; c < last; c = c + 1u) {
+      rangeCount = rangeCount + atomicLoad(&cells[c].count);
+    }
+    scanSums[lid] = rangeCount;
+    workgroupBarrier();
+
+    for (var offset = 1u; offset < kScanSize; offset = offset * 2u) {
+      var value = scanSums[lid];
+      if (lid >= offset) {
+        value = value + scanSums[lid - offset];
+      }
+      workgroupBarrier();
+      scanSums[lid] = value;
+      workgroupBarrier();
+    }
+
+    var start = scanSums[lid] - rangeCount;
+    for (var c = first; c < last; c = c + 1u) {
+      let count = atomicLoad(&cells[c].count);
+      atomicStore(&cellOffsets[c], start);
+      atomicStore(&cellOffsets[grid.cellCount + c], start);
+      // Center of mass of the cell, the bodies have unit masses
+      var center = vec3<f32>(0.0);
+      if (count > 0u) {
+        let sum = vec3<f32>(f32(atomicLoad(&cells[c].x)),
+                            f32(atomicLoad(&cells[c].y)),
+                            f32(atomicLoad(&cells[c].z)));
+        let inCell = sum / (f32(count) * kFixedPointScale);
+        center = grid.domainMin
+                 + (vec3<f32>(cellCoord(c)) + inCell) * grid.cellSize;
+      }
+      cellMass[c] = vec4<f32>(center, f32(count));
+      start = start + count;
+    }
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_grid_scatter(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let pos = positionsIn[gid.x];
+    let c = cellIndex(vec3<u32>(gridCoord(pos.xyz)));
+    let slot = atomicAdd(&cellOffsets[grid.cellCount + c], 1u);
+    sortedPositions[slot] = pos;
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn cs_grid(@builtin(global_invocation_id) gid : vec3<u32>,
+             @builtin(local_invocation_index) lid : u32) {
+    let idx = gid.x;
+    let pos = positionsIn[idx];
+    let cell = vec3<i32>(vec3<u32>(gridCoord(pos.xyz)));
+    let lo = max(cell - vec3<i32>(1), vec3<i32>(0));
+    let hi = min(cell + vec3<i32>(1), vec3<i32>(i32(grid.dim) - 1));
+
+    // Near field, the bodies of the neighbouring cells
+    var force = vec4<f32>(0.0);
+    for (var z = lo.z; z <= hi.z; z = z + 1) {
+      for (var y = lo.y; y <= hi.y; y = y + 1) {
+        for (var x = lo.x; x <= hi.x; x = x + 1) {
+          let c = cellIndex(vec3<u32>(vec3<i32>(x, y, z)));
+          let start = atomicLoad(&cellOffsets[c]);
+          let end = start + atomicLoad(&cells[c].count);
+          for (var i = start; i < end; i = i + 1u) {
+            force = force + computeForce(pos, sortedPositions[i]);
+          }
+        }
+      }
+    }
+
+    // Far field, the centers of mass of the other cells are staged in tiles
+    for (var t = 0u; t < grid.cellCount; t = t + kWorkgroupSize) {
+      let c = min(t + lid, grid.cellCount - 1u);
+      tile[lid] = select(vec4<f32>(0.0), cellMass[c],
+                         t + lid < grid.cellCount);
+      workgroupBarrier();
+      for (var i = 0u; i < kWorkgroupSize; i = i + 1u) {
+        let d = abs(vec3<i32>(cellCoord(t + i)) - cell);
+        if (any(d > vec3<i32>(1))) {
+          force = force + computeForce(pos, tile[i]);
+        }
+      }
+      workgroupBarrier();
+    }
+    integrate(idx, pos, force);
+  }
+)};
+// clang-format on
+
+// Joins shader source parts, the returned string has to be freed
+static char* concat_shader_sources(const char* const* sources, uint32_t count)
+{
+  size_t length = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += strlen(sources[i]);
+  }
+  char* source = malloc(length);
+  ASSERT(source)
+  source[0] = '\0';
+  for (uint32_t i = 0; i < count; ++i) {
+    strcat(source, sources[i]);
+  }
+  return source;
+}
+
+static WGPUComputePipeline create_compute_pipeline(wgpu_context_t* wgpu_context,
+                                                   WGPUPipelineLayout layout,
+                                                   const char* source,
+                                                   const char* entry)
 {
   // Compute shader
   wgpu_shader_t compute_shader = wgpu_shader_create(
     wgpu_context, &(wgpu_shader_desc_t){
                     // Compute shader WGSL
-                    .file  = "shaders/n_body_simulation/n_body_simulation.wgsl",
-                    .entry = "cs_main",
+                    .wgsl_code.source = source,
+                    .entry            = entry,
                   });
 
-  pipelines.compute = wgpuDeviceCreateComputePipeline(
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(
     wgpu_context->device,
     &(WGPUComputePipelineDescriptor){
       .label   = "n_body_simulation_compute_pipeline",
-      .layout  = pipeline_layouts.compute,
+      .layout  = layout,
       .compute = compute_shader.programmable_stage_descriptor,
     });
-  ASSERT(pipelines.compute != NULL);
+  ASSERT(pipeline != NULL);
 
   // Partial cleanup
   wgpu_shader_release(&compute_shader);
+
+  return pipeline;
+}
+
+// Create the compute pipelines
+static void prepare_compute_pipelines(wgpu_context_t* wgpu_context)
+{
+  pipelines.compute[COMPUTE_KERNEL_GLOBAL_MEMORY] = create_compute_pipeline(
+    wgpu_context, pipeline_layouts.compute, compute_shader_wgsl, "cs_main");
+  pipelines.compute[COMPUTE_KERNEL_TILED] = create_compute_pipeline(
+    wgpu_context, pipeline_layouts.compute, compute_shader_wgsl, "cs_tiled");
+
+  // Grid kernel and grid building passes
+  const char* sources[3] = {
+    compute_shader_wgsl, /* */
+    grid_shader_wgsl[0], /* */
+    grid_shader_wgsl[1], /* */
+  };
+  char* grid_source
+    = concat_shader_sources(sources, (uint32_t)ARRAY_SIZE(sources));
+  WGPUPipelineLayout layout = grid.pipeline_layout;
+  pipelines.compute[COMPUTE_KERNEL_GRID]
+    = create_compute_pipeline(wgpu_context, layout, grid_source, "cs_grid");
+  grid.pipelines.clear = create_compute_pipeline(wgpu_context, layout,
+                                                 grid_source, "cs_grid_clear");
+  grid.pipelines.bin   = create_compute_pipeline(wgpu_context, layout,
+                                                 grid_source, "cs_grid_bin");
+  grid.pipelines.scan  = create_compute_pipeline(wgpu_context, layout,
+                                                 grid_source, "cs_grid_scan");
+  grid.pipelines.scatter = create_compute_pipeline(
+    wgpu_context, layout, grid_source, "cs_grid_scatter");
+  free(grid_source);
 }
 
 // Create the graphics pipeline
@@ -508,7 +941,8 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_storage_buffers(context);
     setup_compute_pipeline_layout(context->wgpu_context);
     setup_render_pipeline_layout(context->wgpu_context);
-    prepare_compute_pipeline(context->wgpu_context);
+    prepare_grid(context->wgpu_context);
+    prepare_compute_pipelines(context->wgpu_context);
     prepare_render_pipeline(context->wgpu_context);
     setup_compute_bind_group(context->wgpu_context);
     setup_render_bind_group(context->wgpu_context);
@@ -520,10 +954,56 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+/* Records one simulation step, advancing the positions in place of the
+ * previous ones */
+static void simulation_step(wgpu_example_context_t* context,
+                            WGPUComputePassEncoder cpass_enc)
+{
+  UNUSED_VAR(context);
+
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0,
+                                     bind_groups.compute[frame_idx], 0, NULL);
+  if (compute_kernel == COMPUTE_KERNEL_GRID) {
+    // Sort the bodies into the grid
+    const uint32_t body_groups = num_bodies / workgroup_size;
+    const uint32_t cell_groups
+      = (grid.cell_count + workgroup_size - 1) / workgroup_size;
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, grid.bind_group, 0, NULL);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.pipelines.clear);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, cell_groups, 1, 1);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.pipelines.bin);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, body_groups, 1, 1);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.pipelines.scan);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, grid.pipelines.scatter);
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, body_groups, 1, 1);
+  }
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    pipelines.compute[compute_kernel]);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc,
+                                           num_bodies / workgroup_size, 1, 1);
+  frame_idx = (frame_idx + 1) % 2;
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    imgui_overlay_combo_box(context->imgui_overlay, "Kernel", &compute_kernel,
+                            compute_kernel_str, COMPUTE_KERNEL_COUNT);
+  }
+  if (imgui_overlay_header("Statistics")) {
+    // Every body interacts with every body once per simulation step, the grid
+    // kernel is rated by the interactions of the brute-force step it replaces
+    const double interactions = (double)num_bodies * (double)num_bodies;
+    imgui_overlay_text("Bodies: %u", num_bodies);
+    imgui_overlay_text("Interactions/s: %.3f G",
+                       interactions * context->simulation.steps_per_second
+                         * 1e-9);
+    if (compute_kernel == COMPUTE_KERNEL_GRID) {
+      imgui_overlay_text("Grid: %u^3 cells, brute-force equivalent rate",
+                         grid.dim);
+    }
   }
 }
 
@@ -536,21 +1016,8 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Compute pass
-  if (!context->paused) {
-    // Set up the compute shader dispatch
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      pipelines.compute);
-    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
-                                       bind_groups.compute[frame_idx], 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc, ceil(num_bodies / (float)workgroup_size), 1, 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
-    frame_idx = (frame_idx + 1) % 2;
-  }
+  // Compute pass, the simulation steps scheduled for this frame
+  record_simulation_steps(context, wgpu_context->cmd_enc);
 
   // Render pass
   {
@@ -561,7 +1028,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
                                       bind_groups.render, 0, NULL);
     wgpuRenderPassEncoderSetVertexBuffer(
       wgpu_context->rpass_enc, 0,
-      frame_idx == 0 ? storage_buffers.positions_in.buffer.buffer :
+      frame_idx == 0 ? storage_buffers.positions_in.buffer :
                        storage_buffers.positions_out.buffer,
       0, WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 6, num_bodies, 0, 0);
@@ -600,31 +1067,11 @@ static int example_draw(wgpu_example_context_t* context)
   return 0;
 }
 
-static void update_fps_counter(wgpu_example_context_t* context)
-{
-  if (fps_counter.last_fps_update_time_valid) {
-    const float now                 = context->frame.timestamp_millis;
-    const float time_since_last_log = now - fps_counter.last_fps_update_time;
-    if (time_since_last_log >= fps_counter.fps_update_interval) {
-      fps_counter.fps = fps_counter.num_frames_since_fps_update
-                        / (time_since_last_log / 1000.0);
-      fps_counter.last_fps_update_time        = now;
-      fps_counter.num_frames_since_fps_update = 0;
-    }
-  }
-  else {
-    fps_counter.last_fps_update_time       = context->frame.timestamp_millis;
-    fps_counter.last_fps_update_time_valid = true;
-  }
-  ++fps_counter.num_frames_since_fps_update;
-}
-
 static int example_render(wgpu_example_context_t* context)
 {
   if (!prepared) {
     return 1;
   }
-  update_fps_counter(context);
   bool result = example_draw(context);
   if (render_params.changed) {
     update_uniform_buffers(context);
@@ -653,7 +1100,7 @@ static void example_destroy(wgpu_example_context_t* context)
   UNUSED_VAR(context);
 
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.render_params.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, storage_buffers.positions_in.buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, storage_buffers.positions_in.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, storage_buffers.positions_out.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, storage_buffers.velocities.buffer)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.compute)
@@ -663,23 +1110,83 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.render)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.compute)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.render)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines.compute)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines.compute[0])
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines.compute[1])
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines.compute[2])
+  WGPU_RELEASE_RESOURCE(Buffer, grid.params_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, grid.cells.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, grid.cell_offsets.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, grid.sorted_positions.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, grid.cell_mass.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, grid.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, grid.bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, grid.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.pipelines.clear)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.pipelines.bin)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.pipelines.scan)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, grid.pipelines.scatter)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.render)
 }
 
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]   = {"--num-bodies="};
+  char* filters_flag[2] = {"--turn-off-vsync", "--help-n-body"};
+  char* filtered_argv[1 + 1 + 2 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  int32_t body_count = (int32_t)NUM_BODIES;
+  int vsync_off      = 0;
+  struct argparse_option options[] = {
+    OPT_INTEGER(0, "num-bodies", &body_count, "number of bodies (up to 1M)",
+                NULL, 0, 0),
+    OPT_BOOLEAN(0, "turn-off-vsync", &vsync_off,
+                "do not limit the frame rate to the display", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-n-body", NULL, "show the n-body options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  // Whole workgroups of bodies, the tiled kernel has no partial tiles
+  body_count = CLAMP(body_count, 1, (int32_t)MAX_NUM_BODIES);
+  num_bodies = (((uint32_t)body_count + workgroup_size - 1) / workgroup_size)
+               * workgroup_size;
+  turn_off_vsync = vsync_off != 0;
+}
+
 void example_n_body_simulation(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
       .title   = example_title,
       .overlay = true,
-      .vsync   = true,
+      .vsync   = !turn_off_vsync,
     },
-    .example_initialize_func     = &example_initialize,
-    .example_render_func         = &example_render,
-    .example_destroy_func        = &example_destroy,
-    .example_on_key_pressed_func = &example_on_key_pressed,
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_on_key_pressed_func  = &example_on_key_pressed,
+    .example_simulation_step_func = &simulation_step,
   });
   // clang-format on
 }
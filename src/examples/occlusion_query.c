@@ -12,12 +12,13 @@
  * Demonstrated how to use occlusion queries to get the number of fragment
  * samples that pass all the per-fragment tests for a set of drawing commands.
  *
+ * The results are read back with a ring of query sets, so the readback never
+ * stalls the CPU and the visibility shown lags a few frames behind.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/occlusionquery/occlusionquery.cpp
  * -------------------------------------------------------------------------- */
 
-#define MAX_DEST_BUFFERS 1
-
 static struct {
   struct gltf_model_t* teapot;
   struct gltf_model_t* plane;
@@ -61,13 +62,11 @@ static WGPUPipelineLayout pipeline_layout;
 static WGPUBindGroup bind_group;
 static WGPUBindGroupLayout bind_group_layout;
 
-static WGPUQuerySet occlusion_query_set;
-static WGPUBuffer occlusion_query_set_src_buffer;
-static WGPUBuffer occlusion_query_set_dst_buffer[MAX_DEST_BUFFERS];
-static bool dest_buffer_mapped[MAX_DEST_BUFFERS] = {0};
+static wgpu_occlusion_queries_t* occlusion_queries = NULL;
 
 // Passed query samples
-static uint64_t passed_samples[2] = {1, 1};
+static uint64_t passed_samples[2]      = {1, 1};
+static uint32_t passed_samples_version = 0;
 
 // Other variables
 static const char* example_title = "Occlusion Queries";
@@ -223,19 +222,12 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   // Depth attachment
   wgpu_setup_deph_stencil(wgpu_context, NULL);
 
-  // Occlusion query set
-  occlusion_query_set = wgpuDeviceCreateQuerySet(
-    wgpu_context->device, &(WGPUQuerySetDescriptor){
-                            .type  = WGPUQueryType_Occlusion,
-                            .count = 2,
-                          });
-
   // Render pass descriptor
   render_pass_desc = (WGPURenderPassDescriptor){
     .colorAttachmentCount   = 1,
     .colorAttachments       = rp_color_att_descriptors,
     .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
-    .occlusionQuerySet      = occlusion_query_set,
+    .occlusionQuerySet      = NULL, // Query set of the frame, set per frame
   };
 }
 
@@ -481,26 +473,12 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   update_uniform_buffers(context);
 }
 
-// Create a buffers for storing the occlusion query result
-static void prepare_occlusion_query_set_buffers(wgpu_context_t* wgpu_context)
+// Create the query sets and buffers for reading back the occlusion query
+// results
+static void prepare_occlusion_queries(wgpu_context_t* wgpu_context)
 {
-  occlusion_query_set_src_buffer = wgpuDeviceCreateBuffer(
-    wgpu_context->device,
-    &(WGPUBufferDescriptor){
-      .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
-      .size  = sizeof(passed_samples),
-      .mappedAtCreation = false,
-    });
-
-  for (uint32_t i = 0; i < (uint32_t)MAX_DEST_BUFFERS; ++i) {
-    occlusion_query_set_dst_buffer[i] = wgpuDeviceCreateBuffer(
-      wgpu_context->device,
-      &(WGPUBufferDescriptor){
-        .usage            = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
-        .size             = sizeof(passed_samples),
-        .mappedAtCreation = false,
-      });
-  }
+  occlusion_queries = wgpu_occlusion_queries_create(
+    wgpu_context, (uint32_t)ARRAY_SIZE(passed_samples));
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -509,7 +487,7 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_camera(context);
     load_assets(context->wgpu_context);
     prepare_uniform_buffers(context);
-    prepare_occlusion_query_set_buffers(context->wgpu_context);
+    prepare_occlusion_queries(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_group(context->wgpu_context);
@@ -521,56 +499,17 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
-static int32_t get_unmapped_dest_buffer_index()
-{
-  int32_t index = -1;
-  for (uint32_t i = 0; i < (uint32_t)MAX_DEST_BUFFERS; ++i) {
-    if (!dest_buffer_mapped[i]) {
-      index = i;
-      break;
-    }
-  }
-  return index;
-}
-
-static int32_t get_mapped_dest_buffer_index()
-{
-  int32_t index = -1;
-  for (uint32_t i = 0; i < (uint32_t)MAX_DEST_BUFFERS; ++i) {
-    if (dest_buffer_mapped[i]) {
-      index = i;
-      break;
-    }
-  }
-  return index;
-}
-
-static void read_buffer_map_cb(WGPUBufferMapAsyncStatus status, void* user_data)
+// Takes over the occlusion query results which became available this frame
+static void update_occlusion_query_results(wgpu_example_context_t* context)
 {
-  UNUSED_VAR(user_data);
-
-  if (status == WGPUBufferMapAsyncStatus_Success) {
-    int32_t mapped_dest_buffer_index = get_mapped_dest_buffer_index();
-    uint64_t const* mapping          = (uint64_t*)wgpuBufferGetConstMappedRange(
-               occlusion_query_set_dst_buffer[mapped_dest_buffer_index], 0,
-               sizeof(passed_samples));
-    ASSERT(mapping)
-    memcpy(passed_samples, mapping, sizeof(passed_samples));
-    wgpuBufferUnmap(occlusion_query_set_dst_buffer[mapped_dest_buffer_index]);
-    dest_buffer_mapped[(uint64_t)mapped_dest_buffer_index] = false;
-  }
-}
-
-// Retrieves the results of the occlusion queries submitted to the command
-// buffer
-static void get_occlusion_query_results(void)
-{
-  int32_t unmapped_dest_buffer_index = get_unmapped_dest_buffer_index();
-  if (unmapped_dest_buffer_index != -1) {
-    dest_buffer_mapped[(uint64_t)unmapped_dest_buffer_index] = true;
-    wgpuBufferMapAsync(
-      occlusion_query_set_dst_buffer[(uint64_t)unmapped_dest_buffer_index],
-      WGPUMapMode_Read, 0, sizeof(passed_samples), read_buffer_map_cb, NULL);
+  const uint64_t* results
+    = wgpu_occlusion_queries_get_results(occlusion_queries);
+  const uint32_t version
+    = wgpu_occlusion_queries_get_result_version(occlusion_queries);
+  if (results != NULL && version != passed_samples_version) {
+    memcpy(passed_samples, results, sizeof(passed_samples));
+    passed_samples_version = version;
+    update_uniform_buffers(context);
   }
 }
 
@@ -580,19 +519,8 @@ static WGPUCommandBuffer resolve_query_set(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Resolve occlusion queries
-  wgpuCommandEncoderResolveQuerySet(wgpu_context->cmd_enc, occlusion_query_set,
-                                    0, (uint32_t)ARRAY_SIZE(passed_samples),
-                                    occlusion_query_set_src_buffer, 0);
-
-  int32_t unmapped_dest_buffer_index = get_unmapped_dest_buffer_index();
-  if (unmapped_dest_buffer_index != -1) {
-    // Copy occlusion query result to destination buffer
-    wgpuCommandEncoderCopyBufferToBuffer(
-      wgpu_context->cmd_enc, occlusion_query_set_src_buffer, 0,
-      occlusion_query_set_dst_buffer[(uint64_t)unmapped_dest_buffer_index], 0,
-      sizeof(passed_samples));
-  }
+  // Resolve occlusion queries into the readback buffer of the frame
+  wgpu_occlusion_queries_resolve(occlusion_queries, wgpu_context->cmd_enc);
 
   // Get command buffer
   WGPUCommandBuffer command_buffer
@@ -608,6 +536,8 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
   if (imgui_overlay_header("Occlusion query results")) {
     imgui_overlay_text("Teapot: %d samples passed", passed_samples[0]);
     imgui_overlay_text("Sphere: %d samples passed", passed_samples[1]);
+    imgui_overlay_text("Latency: %u frames",
+                       wgpu_occlusion_queries_get_latency(occlusion_queries));
   }
 }
 
@@ -642,19 +572,30 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                     0);
   wgpu_gltf_model_draw(models.plane, (wgpu_gltf_model_render_options_t){0});
 
+  // The frame has no query set when all readbacks are in flight
+  const bool queries_enabled = render_pass_desc.occlusionQuerySet != NULL;
+
   // Teapot
-  wgpuRenderPassEncoderBeginOcclusionQuery(wgpu_context->rpass_enc, 0);
+  if (queries_enabled) {
+    wgpuRenderPassEncoderBeginOcclusionQuery(wgpu_context->rpass_enc, 0);
+  }
   wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
                                     bind_groups.teapot, 0, 0);
   wgpu_gltf_model_draw(models.teapot, (wgpu_gltf_model_render_options_t){0});
-  wgpuRenderPassEncoderEndOcclusionQuery(wgpu_context->rpass_enc);
+  if (queries_enabled) {
+    wgpuRenderPassEncoderEndOcclusionQuery(wgpu_context->rpass_enc);
+  }
 
   // Sphere
-  wgpuRenderPassEncoderBeginOcclusionQuery(wgpu_context->rpass_enc, 1);
+  if (queries_enabled) {
+    wgpuRenderPassEncoderBeginOcclusionQuery(wgpu_context->rpass_enc, 1);
+  }
   wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
                                     bind_groups.sphere, 0, 0);
   wgpu_gltf_model_draw(models.sphere, (wgpu_gltf_model_render_options_t){0});
-  wgpuRenderPassEncoderEndOcclusionQuery(wgpu_context->rpass_enc);
+  if (queries_enabled) {
+    wgpuRenderPassEncoderEndOcclusionQuery(wgpu_context->rpass_enc);
+  }
 
   // Visible pass
   wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.solid);
@@ -695,6 +636,12 @@ static int example_draw(wgpu_example_context_t* context)
   // Prepare frame
   prepare_frame(context);
 
+  // Take over the results read back since the last frame and get the query
+  // set of this frame
+  render_pass_desc.occlusionQuerySet
+    = wgpu_occlusion_queries_begin_frame(occlusion_queries);
+  update_occlusion_query_results(context);
+
   // Command buffer to be submitted to the queue
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 2;
@@ -706,8 +653,8 @@ static int example_draw(wgpu_example_context_t* context)
   // Submit to queue
   submit_command_buffers(context);
 
-  // Read query results for displaying in next frame
-  get_occlusion_query_results();
+  // Start the readback of the query results of an earlier frame
+  wgpu_occlusion_queries_end_frame(occlusion_queries);
 
   // Submit frame
   submit_frame(context);
@@ -751,15 +698,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
 
-  WGPU_RELEASE_RESOURCE(QuerySet, occlusion_query_set)
-  WGPU_RELEASE_RESOURCE(Buffer, occlusion_query_set_src_buffer)
-  for (uint32_t i = 0; i < (uint32_t)MAX_DEST_BUFFERS; ++i) {
-    if (dest_buffer_mapped[i]) {
-      wgpuBufferUnmap(occlusion_query_set_dst_buffer[i]);
-      dest_buffer_mapped[i] = false;
-    }
-    WGPU_RELEASE_RESOURCE(Buffer, occlusion_query_set_dst_buffer[i])
-  }
+  wgpu_occlusion_queries_destroy(occlusion_queries);
 }
 
 void example_occlusion_query(int argc, char* argv[])
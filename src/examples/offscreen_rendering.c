@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "../webgpu/frame_graph.h"
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
 
@@ -13,13 +14,18 @@
  * scene to a separate framebuffer with color and depth attachments, second pass
  * samples from that color attachment for rendering a mirror surface.
  *
+ * Both passes are declared in a frame graph each frame, the offscreen frame
+ * buffer textures are transient textures of the graph and the offscreen depth
+ * buffer is never stored.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/offscreen
  * -------------------------------------------------------------------------- */
 
 // Offscreen frame buffer properties
-#define FB_DIM 512
+#define FB_DIM 512u
 #define FB_COLOR_FORMAT WGPUTextureFormat_RGBA8Unorm
+#define FB_DEPTH_STENCIL_FORMAT WGPUTextureFormat_Depth24PlusStencil8
 
 static bool debug_display = false;
 
@@ -65,7 +71,6 @@ static struct {
 
 static struct {
   WGPUBindGroup offscreen;
-  WGPUBindGroup mirror;
   WGPUBindGroup model;
 } bind_groups = {0};
 
@@ -74,23 +79,17 @@ static struct {
   WGPUBindGroupLayout textured;
 } bind_group_layouts = {0};
 
-static struct offscreen_pass_t {
+static struct {
   uint32_t width, height;
-  // Framebuffer for offscreen rendering
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView texture_view;
-  } color, depth_stencil;
   WGPUSampler sampler;
-  struct {
-    WGPURenderPassColorAttachment color_attachment[1];
-    WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
-    WGPURenderPassDescriptor render_pass_descriptor;
-  } render_pass;
 } offscreen_pass = {0};
 
-static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
-static WGPURenderPassDescriptor render_pass_desc;
+// Frame graph with the offscreen and the scene pass, the offscreen frame buffer
+// textures are transient textures of the graph
+static struct {
+  wgpu_frame_graph_t* graph;
+  wgpu_frame_graph_resource_t offscreen_color;
+} frame_graph = {0};
 
 static const char* example_title = "Offscreen Rendering";
 static bool prepared             = false;
@@ -126,46 +125,12 @@ static void load_assets(wgpu_context_t* wgpu_context)
     });
 }
 
+// Setup the sampler for the offscreen framebuffer, the framebuffer textures are
+// allocated by the frame graph
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
 {
-  offscreen_pass.width  = (uint32_t)FB_DIM;
-  offscreen_pass.height = (uint32_t)FB_DIM;
-
-  // Create the texture
-  WGPUExtent3D texture_extent = {
-    .width              = offscreen_pass.width,
-    .height             = offscreen_pass.height,
-    .depthOrArrayLayers = 1,
-  };
-
-  // Color attachment
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .size          = texture_extent,
-      .mipLevelCount = 1,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = FB_COLOR_FORMAT,
-      .usage
-      = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
-    };
-    offscreen_pass.color.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(offscreen_pass.color.texture != NULL);
-
-    // Create the texture view
-    WGPUTextureViewDescriptor texture_view_dec = {
-      .dimension       = WGPUTextureViewDimension_2D,
-      .format          = texture_desc.format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = 1,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
-    };
-    offscreen_pass.color.texture_view
-      = wgpuTextureCreateView(offscreen_pass.color.texture, &texture_view_dec);
-    ASSERT(offscreen_pass.color.texture_view != NULL);
-  }
+  offscreen_pass.width  = FB_DIM;
+  offscreen_pass.height = FB_DIM;
 
   // Create sampler to sample from the attachment in the fragment shader
   offscreen_pass.sampler = wgpuDeviceCreateSampler(
@@ -182,69 +147,7 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
                           });
   ASSERT(offscreen_pass.sampler != NULL);
 
-  // Depth stencil attachment
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .size          = texture_extent,
-      .mipLevelCount = 1,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = WGPUTextureFormat_Depth24PlusStencil8,
-      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
-    };
-    offscreen_pass.depth_stencil.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(offscreen_pass.depth_stencil.texture != NULL);
-
-    // Create the texture view
-    WGPUTextureViewDescriptor texture_view_dec = {
-      .dimension       = WGPUTextureViewDimension_2D,
-      .format          = texture_desc.format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = 1,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
-      .aspect          = WGPUTextureAspect_All,
-    };
-    offscreen_pass.depth_stencil.texture_view = wgpuTextureCreateView(
-      offscreen_pass.depth_stencil.texture, &texture_view_dec);
-    ASSERT(offscreen_pass.depth_stencil.texture_view != NULL);
-  }
-
-  // Create a separate render pass for the offscreen rendering as it may differ
-  // from the one used for scene rendering
-  // Color attachment
-  offscreen_pass.render_pass.color_attachment[0]
-    = (WGPURenderPassColorAttachment) {
-      .view       = offscreen_pass.color.texture_view,
-      .loadOp     = WGPULoadOp_Clear,
-      .storeOp    = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.0f,
-        .g = 0.0f,
-        .b = 0.0f,
-        .a = 0.0f,
-      },
-  };
-  // Depth attachment
-  offscreen_pass.render_pass.depth_stencil_attachment
-    = (WGPURenderPassDepthStencilAttachment){
-      .view           = offscreen_pass.depth_stencil.texture_view,
-      .depthLoadOp    = WGPULoadOp_Clear,
-      .depthStoreOp   = WGPUStoreOp_Store,
-      .clearDepth     = 1.0f,
-      .stencilLoadOp  = WGPULoadOp_Clear,
-      .stencilStoreOp = WGPUStoreOp_Store,
-      .clearStencil   = 0,
-    };
-  // Render pass descriptor
-  offscreen_pass.render_pass.render_pass_descriptor
-    = (WGPURenderPassDescriptor){
-      .colorAttachmentCount = 1,
-      .colorAttachments     = offscreen_pass.render_pass.color_attachment,
-      .depthStencilAttachment
-      = &offscreen_pass.render_pass.depth_stencil_attachment,
-    };
+  frame_graph.graph = wgpu_frame_graph_create(wgpu_context);
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -323,37 +226,6 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 
 static void setup_bind_groups(wgpu_context_t* wgpu_context)
 {
-  // Bind group for Mirror
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Vertex shader uniform buffer
-        .binding = 0,
-        .buffer  = uniform_buffers_vs.mirror.buffer,
-        .offset  = 0,
-        .size    =  uniform_buffers_vs.mirror.size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        // Binding 1: Fragment shader image sampler
-        .binding     = 1,
-        .textureView = offscreen_pass.color.texture_view,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        // Binding 2: Fragment shader image sampler
-        .binding = 2,
-        .sampler = offscreen_pass.sampler,
-      },
-    };
-
-    bind_groups.mirror = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .layout     = bind_group_layouts.textured,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_groups.mirror != NULL);
-  }
-
   // Bind group for Model
   {
     WGPUBindGroupEntry bg_entry = {
@@ -391,32 +263,6 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
   }
 }
 
-static void setup_render_pass(wgpu_context_t* wgpu_context)
-{
-  // Color attachment
-  rp_color_att_descriptors[0] = (WGPURenderPassColorAttachment) {
-      .view       = NULL, // Assigned later
-      .loadOp     = WGPULoadOp_Clear,
-      .storeOp    = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.0f,
-        .g = 0.0f,
-        .b = 0.0f,
-        .a = 0.0f,
-      },
-  };
-
-  // Depth attachment
-  wgpu_setup_deph_stencil(wgpu_context, NULL);
-
-  // Render pass descriptor
-  render_pass_desc = (WGPURenderPassDescriptor){
-    .colorAttachmentCount   = 1,
-    .colorAttachments       = rp_color_att_descriptors,
-    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
-  };
-}
-
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
 {
   // Primitive state
@@ -437,7 +283,7 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   // Depth stencil state
   WGPUDepthStencilState depth_stencil_state
     = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
-      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .format              = FB_DEPTH_STENCIL_FORMAT,
       .depth_write_enabled = true,
     });
 
@@ -670,7 +516,7 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
-    setup_render_pass(context->wgpu_context);
+    wgpu_setup_deph_stencil(context->wgpu_context, NULL);
     prepared = true;
     return 0;
   }
@@ -684,96 +530,193 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
     imgui_overlay_checkBox(context->imgui_overlay, "Display render target",
                            &debug_display);
+    wgpu_frame_graph_stats_t stats;
+    wgpu_frame_graph_get_stats(frame_graph.graph, &stats);
+    imgui_overlay_text("Frame graph: %u passes, %u culled", stats.pass_count,
+                       stats.culled_pass_count);
   }
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+// Bind group for the mirror, the offscreen color texture is a pooled texture of
+// the frame graph
+static WGPUBindGroup create_mirror_bind_group(wgpu_context_t* wgpu_context,
+                                              WGPUTextureView offscreen_color)
 {
-  // Create command encoder
-  wgpu_context->cmd_enc
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0: Vertex shader uniform buffer
+      .binding = 0,
+      .buffer  = uniform_buffers_vs.mirror.buffer,
+      .offset  = 0,
+      .size    =  uniform_buffers_vs.mirror.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1: Fragment shader image sampler
+      .binding     = 1,
+      .textureView = offscreen_color,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2: Fragment shader image sampler
+      .binding = 2,
+      .sampler = offscreen_pass.sampler,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .label      = "Mirror bind group",
+                    .layout     = bind_group_layouts.textured,
+                    .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                    .entries    = bg_entries,
+                  });
+  ASSERT(bind_group != NULL);
+  return bind_group;
+}
 
-  /*
-   * First render pass: Offscreen rendering
-   */
+// First render pass: Offscreen rendering
+static void record_offscreen_pass(wgpu_frame_graph_t* graph,
+                                  wgpu_frame_graph_pass_encoder_t encoder,
+                                  void* user_data)
+{
+  UNUSED_VAR(graph);
+
+  wgpu_context_t* wgpu_context    = (wgpu_context_t*)user_data;
+  WGPURenderPassEncoder rpass_enc = encoder.render;
+
+  // Set viewport
+  wgpuRenderPassEncoderSetViewport(rpass_enc, 0.0f, 0.0f,
+                                   (float)offscreen_pass.width,
+                                   (float)offscreen_pass.height, 0.0f, 1.0f);
+
+  // Set scissor rectangle
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u, offscreen_pass.width,
+                                      offscreen_pass.height);
+
+  // Mirrored scene
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.shaded_offscreen);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.offscreen, 0, 0);
+  wgpu_context->rpass_enc = rpass_enc;
+  wgpu_gltf_model_draw(models.dragon, (wgpu_gltf_model_render_options_t){0});
+  wgpu_context->rpass_enc = NULL;
+}
+
+// Second render pass: Scene rendering with the mirror surface
+static void record_scene_pass(wgpu_frame_graph_t* graph,
+                              wgpu_frame_graph_pass_encoder_t encoder,
+                              void* user_data)
+{
+  wgpu_context_t* wgpu_context    = (wgpu_context_t*)user_data;
+  WGPURenderPassEncoder rpass_enc = encoder.render;
+
+  WGPUBindGroup mirror_bind_group = create_mirror_bind_group(
+    wgpu_context,
+    wgpu_frame_graph_get_texture_view(graph, frame_graph.offscreen_color));
+
+  // Set viewport
+  wgpuRenderPassEncoderSetViewport(
+    rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
+    (float)wgpu_context->surface.height, 0.0f, 1.0f);
+
+  // Set scissor rectangle
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u,
+                                      wgpu_context->surface.width,
+                                      wgpu_context->surface.height);
+
+  wgpu_context->rpass_enc = rpass_enc;
+  if (debug_display) {
+    // Display the offscreen render target
+    wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.debug);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, mirror_bind_group, 0, 0);
+    wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+  }
   {
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc,
-      &offscreen_pass.render_pass.render_pass_descriptor);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                     (float)offscreen_pass.width,
-                                     (float)offscreen_pass.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        offscreen_pass.width,
-                                        offscreen_pass.height);
-
-    // Mirrored scene
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.shaded_offscreen);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.offscreen, 0, 0);
+    // Render the scene
+    // Reflection plane
+    wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.mirror);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, mirror_bind_group, 0, 0);
+    wgpu_gltf_model_draw(models.plane, (wgpu_gltf_model_render_options_t){0});
+    // Model
+    wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.shaded);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.model, 0, 0);
     wgpu_gltf_model_draw(models.dragon, (wgpu_gltf_model_render_options_t){0});
-
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
+  wgpu_context->rpass_enc = NULL;
 
-  /*
-   * Second render pass: Scene rendering with applied radial blur
-   */
-  {
-    // Set target frame buffer
-    rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
-
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc, &render_pass_desc);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(
-      wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
-      (float)wgpu_context->surface.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        wgpu_context->surface.width,
-                                        wgpu_context->surface.height);
-
-    if (debug_display) {
-      // Display the offscreen render target
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       pipelines.debug);
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.mirror, 0, 0);
-      wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
-    }
-    {
-      // Render the scene
-      // Reflection plane
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       pipelines.mirror);
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.mirror, 0, 0);
-      wgpu_gltf_model_draw(models.plane, (wgpu_gltf_model_render_options_t){0});
-      // Model
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       pipelines.shaded);
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.model, 0, 0);
-      wgpu_gltf_model_draw(models.dragon,
-                           (wgpu_gltf_model_render_options_t){0});
-    }
+  WGPU_RELEASE_RESOURCE(BindGroup, mirror_bind_group)
+}
 
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-  }
+static void declare_frame_graph(wgpu_context_t* wgpu_context)
+{
+  wgpu_frame_graph_t* graph = frame_graph.graph;
+  wgpu_frame_graph_begin(graph);
+
+  frame_graph.offscreen_color = wgpu_frame_graph_create_texture(
+    graph, &(wgpu_frame_graph_texture_desc_t){
+             .label  = "Offscreen color texture",
+             .format = FB_COLOR_FORMAT,
+             .width  = offscreen_pass.width,
+             .height = offscreen_pass.height,
+           });
+  const wgpu_frame_graph_resource_t offscreen_depth
+    = wgpu_frame_graph_create_texture(
+      graph, &(wgpu_frame_graph_texture_desc_t){
+               .label  = "Offscreen depth stencil texture",
+               .format = FB_DEPTH_STENCIL_FORMAT,
+               .width  = offscreen_pass.width,
+               .height = offscreen_pass.height,
+             });
+  const wgpu_frame_graph_resource_t frame_buffer
+    = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Frame buffer",
+               .view   = wgpu_context->swap_chain.frame_buffer,
+               .format = wgpu_context->swap_chain.format,
+             });
+  const wgpu_frame_graph_resource_t depth_stencil
+    = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Depth stencil",
+               .view   = wgpu_context->depth_stencil.texture_view,
+               .format = wgpu_context->depth_stencil.format,
+             });
+
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Offscreen pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_graph.offscreen_color,
+               .clear_value = (WGPUColor){0.0f, 0.0f, 0.0f, 0.0f},
+             },
+             .depth_stencil_attachment = offscreen_depth,
+             .execute_func             = record_offscreen_pass,
+             .user_data                = wgpu_context,
+           });
+
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Scene pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_buffer,
+               .clear_value = (WGPUColor){0.0f, 0.0f, 0.0f, 0.0f},
+             },
+             .depth_stencil_attachment = depth_stencil,
+             .read_count               = 1,
+             .reads[0]                 = frame_graph.offscreen_color,
+             .execute_func             = record_scene_pass,
+             .user_data                = wgpu_context,
+           });
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+{
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Offscreen and scene pass
+  declare_frame_graph(wgpu_context);
+  wgpu_frame_graph_execute(frame_graph.graph, wgpu_context->cmd_enc);
 
   // Draw ui overlay
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -829,11 +772,7 @@ static void example_destroy(wgpu_example_context_t* context)
   wgpu_gltf_model_destroy(models.dragon);
   wgpu_gltf_model_destroy(models.plane);
 
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color.texture)
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.depth_stencil.texture)
-
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color.texture_view)
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.depth_stencil.texture_view)
+  wgpu_frame_graph_destroy(frame_graph.graph);
 
   WGPU_RELEASE_RESOURCE(Sampler, offscreen_pass.sampler)
 
@@ -850,7 +789,6 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.textured)
 
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.offscreen)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.mirror)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.model)
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.shaded)
@@ -11,13 +11,243 @@
  * WebGPU Example - Parallax Mapping
  *
  * Implements multiple texture mapping methods to simulate depth based on
- * texture information: Normal mapping, parallax mapping, steep parallax mapping
- * and parallax occlusion mapping (best quality, worst performance).
+ * texture information: Normal mapping, parallax mapping, steep parallax
+ * mapping, parallax occlusion mapping and relief mapping (best quality, worst
+ * performance).
+ *
+ * The layer count of the layered methods adapts to the view angle and to the
+ * texel footprint of the pixel, the march stops at the first layer under the
+ * height field. In the distance the parallax offset fades out to plain normal
+ * mapping. Relief mapping refines the layer hit with a binary search.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/parallaxmapping/parallaxmapping.cpp
  * -------------------------------------------------------------------------- */
 
+// Shaders
+// clang-format off
+static const char* parallax_vertex_shader_wgsl = CODE(
+  struct UBO {
+    projection : mat4x4<f32>,
+    view : mat4x4<f32>,
+    model : mat4x4<f32>,
+    light_pos : vec4<f32>,
+    camera_pos : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : UBO;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+    @location(1) tangent_light_pos : vec3<f32>,
+    @location(2) tangent_view_pos : vec3<f32>,
+    @location(3) tangent_frag_pos : vec3<f32>,
+  }
+
+  @vertex
+  fn main(@location(0) position : vec3<f32>,
+          @location(1) uv : vec2<f32>,
+          @location(2) normal : vec3<f32>,
+          @location(3) tangent : vec4<f32>) -> VertexOutput {
+    var output : VertexOutput;
+    let world_pos = ubo.model * vec4<f32>(position, 1.0);
+    output.position = ubo.projection * ubo.view * world_pos;
+    output.uv = uv;
+    let model = mat3x3<f32>(ubo.model[0].xyz, ubo.model[1].xyz,
+                            ubo.model[2].xyz);
+    let n = normalize(model * normal);
+    let t = normalize(model * tangent.xyz);
+    let b = normalize(cross(n, t));
+    let tbn = transpose(mat3x3<f32>(t, b, n));
+    output.tangent_light_pos = tbn * ubo.light_pos.xyz;
+    output.tangent_view_pos = tbn * ubo.camera_pos.xyz;
+    output.tangent_frag_pos = tbn * world_pos.xyz;
+    return output;
+  }
+);
+
+static const char* parallax_fragment_shader_wgsl = CODE(
+  struct UBO {
+    height_scale : f32,
+    parallax_bias : f32,
+    max_layers : f32,
+    mapping_mode : i32,
+    min_layers : f32,
+    fallback_distance : f32,
+    refinement_steps : i32,
+    padding : f32,
+  }
+
+  @group(0) @binding(1) var color_map : texture_2d<f32>;
+  @group(0) @binding(2) var color_sampler : sampler;
+  @group(0) @binding(3) var normal_height_map : texture_2d<f32>;
+  @group(0) @binding(4) var normal_height_sampler : sampler;
+  @group(0) @binding(5) var<uniform> ubo : UBO;
+
+  struct FragmentInput {
+    @location(0) uv : vec2<f32>,
+    @location(1) tangent_light_pos : vec3<f32>,
+    @location(2) tangent_view_pos : vec3<f32>,
+    @location(3) tangent_frag_pos : vec3<f32>,
+  }
+
+  // Derivatives of the unshifted texture coordinates, the taps inside the
+  // loops use them as they are not in uniform control flow
+  struct Gradients {
+    ddx : vec2<f32>,
+    ddy : vec2<f32>,
+  }
+
+  fn sample_depth(uv : vec2<f32>, g : Gradients) -> f32 {
+    return 1.0 - textureSampleGrad(normal_height_map, normal_height_sampler,
+                                   uv, g.ddx, g.ddy).a;
+  }
+
+  fn parallax_mapping(uv : vec2<f32>, view_dir : vec3<f32>,
+                      g : Gradients) -> vec2<f32> {
+    let height = sample_depth(uv, g);
+    let p = view_dir.xy * (height * (ubo.height_scale * 0.5)
+                           + ubo.parallax_bias) / view_dir.z;
+    return uv - p;
+  }
+
+  // Grazing angles need more layers, minified texels need fewer
+  fn layer_count(view_dir : vec3<f32>, g : Gradients) -> f32 {
+    let size = vec2<f32>(textureDimensions(normal_height_map));
+    let dx = g.ddx * size;
+    let dy = g.ddy * size;
+    let lod = max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0);
+    let angle_layers = mix(ubo.max_layers, ubo.min_layers, abs(view_dir.z));
+    return clamp(ceil(angle_layers * exp2(-lod)), ubo.min_layers,
+                 ubo.max_layers);
+  }
+
+  struct LayerHit {
+    uv : vec2<f32>,
+    prev_uv : vec2<f32>,
+    layer_depth : f32,
+    depth : f32,
+    height : f32,
+    prev_height : f32,
+  }
+
+  // Steps through the layers until the view ray is under the height field
+  fn march_layers(uv : vec2<f32>, view_dir : vec3<f32>,
+                  g : Gradients) -> LayerHit {
+    let num_layers = layer_count(view_dir, g);
+    let delta_uv = view_dir.xy * ubo.height_scale / (view_dir.z * num_layers);
+    var hit : LayerHit;
+    hit.uv = uv;
+    hit.prev_uv = uv;
+    hit.layer_depth = 1.0 / num_layers;
+    hit.depth = 0.0;
+    hit.height = sample_depth(uv, g);
+    hit.prev_height = hit.height;
+    for (var i = 0; i < i32(num_layers) && hit.height > hit.depth; i++) {
+      hit.prev_uv = hit.uv;
+      hit.prev_height = hit.height;
+      hit.uv -= delta_uv;
+      hit.depth += hit.layer_depth;
+      hit.height = sample_depth(hit.uv, g);
+    }
+    return hit;
+  }
+
+  fn steep_parallax_mapping(uv : vec2<f32>, view_dir : vec3<f32>,
+                            g : Gradients) -> vec2<f32> {
+    return march_layers(uv, view_dir, g).uv;
+  }
+
+  fn parallax_occlusion_mapping(uv : vec2<f32>, view_dir : vec3<f32>,
+                                g : Gradients) -> vec2<f32> {
+    let hit = march_layers(uv, view_dir, g);
+    let next_depth = hit.height - hit.depth;
+    let prev_depth = hit.prev_height - hit.depth + hit.layer_depth;
+    let weight = next_depth / min(next_depth - prev_depth, -0.0001);
+    return mix(hit.uv, hit.prev_uv, weight);
+  }
+
+  fn relief_mapping(uv : vec2<f32>, view_dir : vec3<f32>,
+                    g : Gradients) -> vec2<f32> {
+    let hit = march_layers(uv, view_dir, g);
+    // Binary search between the last layer above and the first layer under
+    // the height field
+    var above_uv = hit.prev_uv;
+    var above_depth = hit.depth - hit.layer_depth;
+    var below_uv = hit.uv;
+    var below_depth = hit.depth;
+    for (var i = 0; i < ubo.refinement_steps; i++) {
+      let mid_uv = 0.5 * (above_uv + below_uv);
+      let mid_depth = 0.5 * (above_depth + below_depth);
+      if (sample_depth(mid_uv, g) > mid_depth) {
+        above_uv = mid_uv;
+        above_depth = mid_depth;
+      }
+      else {
+        below_uv = mid_uv;
+        below_depth = mid_depth;
+      }
+    }
+    return 0.5 * (above_uv + below_uv);
+  }
+
+  @fragment
+  fn main(input : FragmentInput) -> @location(0) vec4<f32> {
+    let g = Gradients(dpdx(input.uv), dpdy(input.uv));
+    if (ubo.mapping_mode == 0) {
+      return textureSampleGrad(color_map, color_sampler, input.uv, g.ddx,
+                               g.ddy);
+    }
+
+    let view_dir = normalize(input.tangent_view_pos - input.tangent_frag_pos);
+    // Plain normal mapping in the distance
+    let fade = smoothstep(0.75 * ubo.fallback_distance, ubo.fallback_distance,
+                          distance(input.tangent_view_pos,
+                                   input.tangent_frag_pos));
+    var uv = input.uv;
+    if (ubo.mapping_mode >= 2 && fade < 1.0) {
+      var parallax_uv = uv;
+      switch (ubo.mapping_mode) {
+        case 2: {
+          parallax_uv = parallax_mapping(uv, view_dir, g);
+        }
+        case 3: {
+          parallax_uv = steep_parallax_mapping(uv, view_dir, g);
+        }
+        case 4: {
+          parallax_uv = parallax_occlusion_mapping(uv, view_dir, g);
+        }
+        default: {
+          parallax_uv = relief_mapping(uv, view_dir, g);
+        }
+      }
+      uv = mix(parallax_uv, uv, fade);
+    }
+
+    // Perform sampling before (potentially) discarding
+    let normal_height = textureSampleGrad(normal_height_map,
+                                          normal_height_sampler, uv, g.ddx,
+                                          g.ddy).rgb;
+    let color = textureSampleGrad(color_map, color_sampler, uv, g.ddx,
+                                  g.ddy).rgb;
+
+    // Discard fragments at texture border
+    if (any(uv < vec2<f32>(0.0)) || any(uv > vec2<f32>(1.0))) {
+      discard;
+    }
+
+    let n = normalize(normal_height * 2.0 - 1.0);
+    let l = normalize(input.tangent_light_pos - input.tangent_frag_pos);
+    let h = normalize(l + view_dir);
+    let ambient = 0.2 * color;
+    let diffuse = max(dot(l, n), 0.0) * color;
+    let specular = vec3<f32>(0.15) * pow(max(dot(n, h), 0.0), 32.0);
+    return vec4<f32>(ambient + diffuse + specular, 1.0);
+  }
+);
+// clang-format on
+
 static struct {
   texture_t color_map;
   // Normals and height are combined into one texture (height = alpha channel)
@@ -44,11 +274,19 @@ static struct {
     // Basic parallax mapping needs a bias to look any good (and is hard to
     // tweak)
     float parallax_bias;
-    // Number of layers for steep parallax and parallax occlusion (more layer =
-    // better result for less performance)
-    float num_layers;
+    // Maximum number of layers for steep parallax, parallax occlusion and
+    // relief mapping at grazing angles (more layer = better result for less
+    // performance)
+    float max_layers;
     // (Parallax) mapping mode to use
     int32_t mapping_mode;
+    // Number of layers when looking straight at the surface
+    float min_layers;
+    // Distance from which on plain normal mapping is used
+    float fallback_distance;
+    // Binary search steps of relief mapping
+    int32_t refinement_steps;
+    float padding;
   } fragment_shader;
 } ubos = {
   .vertex_shader = {
@@ -57,8 +295,11 @@ static struct {
   .fragment_shader = {
     .height_scale = 0.1f,
     .parallax_bias = -0.02f,
-    .num_layers = 48.0f,
+    .max_layers = 48.0f,
     .mapping_mode = 4,
+    .min_layers = 8.0f,
+    .fallback_distance = 8.0f,
+    .refinement_steps = 5,
   },
 };
 
@@ -71,12 +312,13 @@ static WGPURenderPipeline pipeline;
 static WGPUBindGroupLayout bind_group_layout;
 static WGPUBindGroup bind_group;
 
-static const char* mapping_modes[5] = {
+static const char* mapping_modes[6] = {
   "Color only",                 //
   "Normal mapping",             //
   "Parallax mapping",           //
   "Steep parallax mapping",     //
   "Parallax occlusion mapping", //
+  "Relief mapping",             //
 };
 
 // Other variables
@@ -310,9 +552,10 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
             wgpu_context, &(wgpu_vertex_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Vertex shader SPIR-V
-              .label = "parallax_mapping_vertex_shader",
-              .file  = "shaders/parallax_mapping/parallax.vert.spv",
+              // Vertex shader WGSL
+              .label            = "parallax_mapping_vertex_shader",
+              .wgsl_code.source = parallax_vertex_shader_wgsl,
+              .entry            = "main",
             },
             .buffer_count = 1,
             .buffers      = &quad_vertex_buffer_layout,
@@ -322,9 +565,10 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
             wgpu_context, &(wgpu_fragment_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Fragment shader SPIR-V
-              .label = "parallax_mapping_fragment_shader",
-              .file  = "shaders/parallax_mapping/parallax.frag.spv",
+              // Fragment shader WGSL
+              .label            = "parallax_mapping_fragment_shader",
+              .wgsl_code.source = parallax_fragment_shader_wgsl,
+              .entry            = "main",
             },
             .target_count = 1,
             .targets      = &color_target_state,
@@ -429,9 +673,37 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
     if (imgui_overlay_combo_box(context->imgui_overlay, "Mode",
                                 &ubos.fragment_shader.mapping_mode,
-                                mapping_modes, 5)) {
+                                mapping_modes,
+                                (uint32_t)ARRAY_SIZE(mapping_modes))) {
       update_uniform_buffers(context);
     }
+    if (ubos.fragment_shader.mapping_mode >= 3) {
+      if (imgui_overlay_slider_float(context->imgui_overlay, "Min. layers",
+                                     &ubos.fragment_shader.min_layers, 1.0f,
+                                     ubos.fragment_shader.max_layers)) {
+        update_uniform_buffers(context);
+      }
+      if (imgui_overlay_slider_float(context->imgui_overlay, "Max. layers",
+                                     &ubos.fragment_shader.max_layers,
+                                     ubos.fragment_shader.min_layers, 64.0f)) {
+        update_uniform_buffers(context);
+      }
+    }
+    if (ubos.fragment_shader.mapping_mode == 5) {
+      if (imgui_overlay_slider_int(context->imgui_overlay, "Refinement steps",
+                                   &ubos.fragment_shader.refinement_steps, 0,
+                                   8)) {
+        update_uniform_buffers(context);
+      }
+    }
+    if (ubos.fragment_shader.mapping_mode >= 2) {
+      if (imgui_overlay_slider_float(context->imgui_overlay,
+                                     "Fallback distance",
+                                     &ubos.fragment_shader.fallback_distance,
+                                     1.0f, 32.0f)) {
+        update_uniform_buffers(context);
+      }
+    }
   }
 }
 
@@ -15,11 +15,19 @@
  * demonstrating how metallic reflectance and surface roughness affect the
  * appearance of pbr lit objects.
  *
+ * The instanced mode stores the per-object position and material parameters
+ * in a storage buffer and draws the whole grid with one instanced draw, the
+ * default mode binds dynamic uniform buffer offsets and draws every object.
+ * With grid sizes up to 100x100 both modes stress the CPU overhead of the
+ * PBR draw path.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/pbrbasic/pbrbasic.cpp
  * -------------------------------------------------------------------------- */
 
 #define GRID_DIM 7
+#define MAX_GRID_DIM 100
+#define MAX_OBJECT_COUNT (MAX_GRID_DIM * MAX_GRID_DIM)
 #define ALIGNMENT 256 // 256-byte alignment
 
 static struct {
@@ -73,6 +81,8 @@ static const char* object_names[4] = {"Sphere", "Teapot", "Torusknot", "Venus"};
 
 static int32_t current_material_index = 0;
 static int32_t current_object_index   = 0;
+static int32_t grid_dim               = GRID_DIM;
+static bool instanced                 = false;
 
 static struct {
   // Object vertex shader uniform buffer
@@ -91,6 +101,8 @@ static struct {
     uint64_t buffer_size;
     uint64_t model_size;
   } object_params;
+  // Per-instance parameter storage buffer
+  wgpu_buffer_t instance_params;
 } uniform_buffers;
 
 static struct {
@@ -104,17 +116,28 @@ static struct {
   vec4 lights[4];
 } ubo_params;
 
+// The parameter arrays below are sized for the largest grid (about 5 MB), they
+// are allocated when the example is initialized instead of living in the
+// launcher's static data
 static struct matrial_params_dynamic_t {
   float roughness;
   float metallic;
   vec3 color;
   uint8_t padding[236];
-} material_params_dynamic[GRID_DIM * GRID_DIM] = {0};
+} * material_params_dynamic = NULL;
 
 static struct object_params_dynamic_t {
   vec3 position;
   uint8_t padding[244];
-} object_params_dynamic[GRID_DIM * GRID_DIM] = {0};
+} * object_params_dynamic = NULL;
+
+// Per-instance parameters of the instanced mode
+static struct instance_params_t {
+  vec3 position;
+  float roughness;
+  vec3 color;
+  float metallic;
+} * instance_params = NULL;
 
 static WGPURenderPassColorAttachment rp_color_att_descriptors[1];
 static WGPURenderPassDescriptor render_pass_desc;
@@ -124,10 +147,132 @@ static WGPURenderPipeline pipeline;
 static WGPUBindGroupLayout bind_group_layout;
 static WGPUBindGroup bind_group;
 
+// Instanced mode
+static struct {
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline pipeline;
+  WGPUBindGroup bind_group;
+} instancing = {0};
+
 // Other variables
 static const char* example_title = "Physical Based Shading Basics";
 static bool prepared             = false;
 
+// Shaders
+// clang-format off
+static const char* pbr_instanced_shader_wgsl = CODE(
+  const PI = 3.14159265359;
+
+  struct UBO {
+    projection : mat4x4<f32>,
+    model : mat4x4<f32>,
+    view : mat4x4<f32>,
+    camPos : vec3<f32>,
+  }
+
+  struct UBOShared {
+    lights : array<vec4<f32>, 4>,
+  }
+
+  struct Instance {
+    position : vec3<f32>,
+    roughness : f32,
+    color : vec3<f32>,
+    metallic : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : UBO;
+  @group(0) @binding(1) var<uniform> uboParams : UBOShared;
+  @group(0) @binding(2) var<storage, read> instances : array<Instance>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) worldPos : vec3<f32>,
+    @location(1) normal : vec3<f32>,
+    @location(2) @interpolate(flat) color : vec3<f32>,
+    // x = roughness, y = metallic
+    @location(3) @interpolate(flat) material : vec2<f32>,
+  }
+
+  @vertex
+  fn vs_main(
+    @builtin(instance_index) instanceIndex : u32,
+    @location(0) inPos : vec3<f32>,
+    @location(1) inNormal : vec3<f32>
+  ) -> VertexOutput {
+    let instance = instances[instanceIndex];
+    let locPos = (ubo.model * vec4<f32>(inPos, 1.0)).xyz;
+    let model3 = mat3x3<f32>(ubo.model[0].xyz, ubo.model[1].xyz,
+                             ubo.model[2].xyz);
+    var output : VertexOutput;
+    output.worldPos = locPos + instance.position;
+    output.normal = model3 * inNormal;
+    output.color = instance.color;
+    output.material = vec2<f32>(instance.roughness, instance.metallic);
+    output.position = ubo.projection * ubo.view
+                      * vec4<f32>(output.worldPos, 1.0);
+    return output;
+  }
+
+  // Normal Distribution function
+  fn D_GGX(dotNH : f32, roughness : f32) -> f32 {
+    let alpha = roughness * roughness;
+    let alpha2 = alpha * alpha;
+    let denom = dotNH * dotNH * (alpha2 - 1.0) + 1.0;
+    return alpha2 / (PI * denom * denom);
+  }
+
+  // Geometric Shadowing function
+  fn G_SchlicksmithGGX(dotNL : f32, dotNV : f32, roughness : f32) -> f32 {
+    let r = roughness + 1.0;
+    let k = (r * r) / 8.0;
+    let GL = dotNL / (dotNL * (1.0 - k) + k);
+    let GV = dotNV / (dotNV * (1.0 - k) + k);
+    return GL * GV;
+  }
+
+  // Fresnel function
+  fn F_Schlick(cosTheta : f32, color : vec3<f32>, metallic : f32)
+    -> vec3<f32> {
+    let F0 = mix(vec3<f32>(0.04), color, metallic);
+    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
+  }
+
+  // Specular BRDF composition
+  fn BRDF(L : vec3<f32>, V : vec3<f32>, N : vec3<f32>, color : vec3<f32>,
+          metallic : f32, roughness : f32) -> vec3<f32> {
+    let H = normalize(V + L);
+    let dotNV = clamp(dot(N, V), 0.0, 1.0);
+    let dotNL = clamp(dot(N, L), 0.0, 1.0);
+    let dotNH = clamp(dot(N, H), 0.0, 1.0);
+    var result = vec3<f32>(0.0);
+    if (dotNL > 0.0) {
+      let D = D_GGX(dotNH, roughness);
+      let G = G_SchlicksmithGGX(dotNL, dotNV, max(0.05, roughness));
+      let F = F_Schlick(dotNV, color, metallic);
+      let spec = D * F * G / (4.0 * dotNL * dotNV);
+      result += spec * dotNL;
+    }
+    return result;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let N = normalize(input.normal);
+    let V = normalize(ubo.camPos - input.worldPos);
+    var Lo = vec3<f32>(0.0);
+    for (var i = 0u; i < 4u; i++) {
+      let L = normalize(uboParams.lights[i].xyz - input.worldPos);
+      Lo += BRDF(L, V, N, input.color, input.material.y, input.material.x);
+    }
+    var color = input.color * 0.02 + Lo;
+    color = pow(color, vec3<f32>(0.4545));
+    return vec4<f32>(color, 1.0);
+  }
+);
+// clang-format on
+
 static void setup_camera(wgpu_example_context_t* context)
 {
   context->timer_speed *= 0.5f;
@@ -219,6 +364,37 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
                             .bindGroupLayouts     = &bind_group_layout,
                           });
   ASSERT(pipeline_layout != NULL);
+
+  // Instanced mode bind group layout
+  WGPUBindGroupLayoutEntry instanced_bgl_entries[3] = {
+    [0] = bgl_entries[0],
+    [1] = bgl_entries[1],
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Storage buffer (Vertex shader)
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = sizeof(struct instance_params_t),
+      },
+      .sampler = {0},
+    },
+  };
+  instancing.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device,
+    &(WGPUBindGroupLayoutDescriptor){
+      .entryCount = (uint32_t)ARRAY_SIZE(instanced_bgl_entries),
+      .entries    = instanced_bgl_entries,
+    });
+  ASSERT(instancing.bind_group_layout != NULL);
+
+  // Instanced mode pipeline layout
+  instancing.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &instancing.bind_group_layout,
+                          });
+  ASSERT(instancing.pipeline_layout != NULL);
 }
 
 static void setup_bind_group(wgpu_context_t* wgpu_context)
@@ -262,6 +438,27 @@ static void setup_bind_group(wgpu_context_t* wgpu_context)
                             .entries    = bg_entries,
                           });
   ASSERT(bind_group != NULL);
+
+  // Instanced mode bind group
+  WGPUBindGroupEntry instanced_bg_entries[3] = {
+    [0] = bg_entries[0],
+    [1] = bg_entries[1],
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2: Storage buffer (Vertex shader)
+      .binding = 2,
+      .buffer  = uniform_buffers.instance_params.buffer,
+      .offset  = 0,
+      .size    = uniform_buffers.instance_params.size,
+    },
+  };
+  instancing.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = instancing.bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(instanced_bg_entries),
+      .entries    = instanced_bg_entries,
+    });
+  ASSERT(instancing.bind_group != NULL);
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -370,6 +567,48 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+
+  // Shaders - Instanced PBR pipeline
+  // Vertex state
+  WGPUVertexState instanced_vertex_state = wgpu_create_vertex_state(
+            wgpu_context, &(wgpu_vertex_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Vertex shader WGSL
+              .wgsl_code.source = pbr_instanced_shader_wgsl,
+              .entry            = "vs_main",
+            },
+            .buffer_count = 1,
+            .buffers      = &sphere_vertex_buffer_layout,
+          });
+
+  // Fragment state
+  WGPUFragmentState instanced_fragment_state = wgpu_create_fragment_state(
+            wgpu_context, &(wgpu_fragment_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Fragment shader WGSL
+              .wgsl_code.source = pbr_instanced_shader_wgsl,
+              .entry            = "fs_main",
+            },
+            .target_count = 1,
+            .targets      = &color_target_state,
+          });
+
+  // Create the instanced rendering pipeline
+  instancing.pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label        = "pbr_instanced_render_pipeline",
+                            .layout       = instancing.pipeline_layout,
+                            .primitive    = primitive_state,
+                            .vertex       = instanced_vertex_state,
+                            .fragment     = &instanced_fragment_state,
+                            .depthStencil = &depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+  ASSERT(instancing.pipeline != NULL);
+
+  // Partial cleanup
+  WGPU_RELEASE_RESOURCE(ShaderModule, instanced_vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, instanced_fragment_state.module);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -391,34 +630,51 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
 static void update_dynamic_uniform_buffer(wgpu_context_t* wgpu_context)
 {
   // Set objects positions and material properties
-  uint32_t index = 0;
-  for (uint32_t y = 0; y < GRID_DIM; y++) {
-    for (uint32_t x = 0; x < GRID_DIM; x++) {
+  const uint32_t dim    = (uint32_t)grid_dim;
+  const float grid_step = (dim > 1) ? 1.0f / (float)(dim - 1) : 0.0f;
+  const float* color    = materials[current_material_index].params.color;
+  uint32_t index        = 0;
+  for (uint32_t y = 0; y < dim; y++) {
+    for (uint32_t x = 0; x < dim; x++) {
       // Set object position
       vec3* pos = &object_params_dynamic[index].position;
-      glm_vec3_copy((vec3){(float)(x - (GRID_DIM / 2.0f)) * 2.5f, 0.0f,
-                           (float)(y - (GRID_DIM / 2.0f)) * 2.5f},
+      glm_vec3_copy((vec3){(float)(x - (dim / 2.0f)) * 2.5f, 0.0f,
+                           (float)(y - (dim / 2.0f)) * 2.5f},
                     *pos);
       // Set material metallic and roughness properties
       struct matrial_params_dynamic_t* mat_params
         = &material_params_dynamic[index];
-      mat_params->metallic
-        = glm_clamp((float)x / (float)(GRID_DIM - 1), 0.1f, 1.0f);
-      mat_params->roughness
-        = glm_clamp((float)y / (float)(GRID_DIM - 1), 0.05f, 1.0f);
-      glm_vec3_copy(materials[current_material_index].params.color,
-                    (*mat_params).color);
+      mat_params->metallic  = glm_clamp((float)x * grid_step, 0.1f, 1.0f);
+      mat_params->roughness = glm_clamp((float)y * grid_step, 0.05f, 1.0f);
+      glm_vec3_copy((float*)color, (*mat_params).color);
+      // Same parameters for the instanced mode
+      struct instance_params_t* instance = &instance_params[index];
+      glm_vec3_copy(*pos, instance->position);
+      glm_vec3_copy((float*)color, instance->color);
+      instance->roughness = mat_params->roughness;
+      instance->metallic  = mat_params->metallic;
       index++;
     }
   }
 
-  // Update buffers
-  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.object_params.buffer, 0,
-                          &object_params_dynamic,
-                          uniform_buffers.object_params.buffer_size);
-  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.material_params.buffer,
-                          0, &material_params_dynamic,
-                          uniform_buffers.material_params.buffer_size);
+  // Update buffers, only the objects of the grid
+  const uint32_t object_count = dim * dim;
+  if (instanced) {
+    wgpu_queue_write_buffer(wgpu_context,
+                            uniform_buffers.instance_params.buffer, 0,
+                            instance_params,
+                            object_count * sizeof(struct instance_params_t));
+  }
+  else {
+    wgpu_queue_write_buffer(
+      wgpu_context, uniform_buffers.object_params.buffer, 0,
+      object_params_dynamic,
+      object_count * sizeof(struct object_params_dynamic_t));
+    wgpu_queue_write_buffer(
+      wgpu_context, uniform_buffers.material_params.buffer, 0,
+      material_params_dynamic,
+      object_count * sizeof(struct matrial_params_dynamic_t));
+  }
 }
 
 static void update_lights(wgpu_example_context_t* context)
@@ -450,6 +706,14 @@ static uint64_t calc_constant_buffer_byte_size(uint64_t byte_size)
 // Prepare and initialize uniform buffer containing shader uniforms
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
+  // CPU side parameters of all objects
+  material_params_dynamic
+    = calloc(MAX_OBJECT_COUNT, sizeof(struct matrial_params_dynamic_t));
+  object_params_dynamic
+    = calloc(MAX_OBJECT_COUNT, sizeof(struct object_params_dynamic_t));
+  instance_params = calloc(MAX_OBJECT_COUNT, sizeof(struct instance_params_t));
+  ASSERT(material_params_dynamic && object_params_dynamic && instance_params);
+
   // Object vertex shader uniform buffer
   uniform_buffers.ubo_matrices = wgpu_create_buffer(
     context->wgpu_context,
@@ -470,7 +734,8 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   {
     uniform_buffers.material_params.model_size = sizeof(vec2) + sizeof(vec3);
     uniform_buffers.material_params.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(material_params_dynamic));
+      = calc_constant_buffer_byte_size(
+        MAX_OBJECT_COUNT * sizeof(struct matrial_params_dynamic_t));
     WGPUBufferDescriptor ubo_desc = {
       .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
       .size             = uniform_buffers.material_params.buffer_size,
@@ -485,7 +750,8 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
   {
     uniform_buffers.object_params.model_size = sizeof(vec3);
     uniform_buffers.object_params.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(object_params_dynamic));
+      = calc_constant_buffer_byte_size(
+        MAX_OBJECT_COUNT * sizeof(struct object_params_dynamic_t));
     WGPUBufferDescriptor ubo_desc = {
       .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
       .size             = uniform_buffers.object_params.buffer_size,
@@ -496,6 +762,14 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
     ASSERT(uniform_buffers.object_params.buffer != NULL);
   }
 
+  // Per-instance parameter storage buffer
+  uniform_buffers.instance_params = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+      .size  = MAX_OBJECT_COUNT * sizeof(struct instance_params_t),
+    });
+
   update_uniform_buffers(context);
   update_dynamic_uniform_buffer(context->wgpu_context);
   update_lights(context);
@@ -530,6 +804,17 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                 &current_object_index, object_names, 4)) {
       update_dynamic_uniform_buffer(context->wgpu_context);
     }
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Grid size",
+                                 &grid_dim, 1, MAX_GRID_DIM)) {
+      update_dynamic_uniform_buffer(context->wgpu_context);
+    }
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Instanced",
+                               &instanced)) {
+      update_dynamic_uniform_buffer(context->wgpu_context);
+    }
+    imgui_overlay_text("Objects: %u, draw calls: %u",
+                       (uint32_t)(grid_dim * grid_dim),
+                       instanced ? 1u : (uint32_t)(grid_dim * grid_dim));
   }
 }
 
@@ -556,18 +841,33 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
-  // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
-
-  for (uint32_t i = 0; i < GRID_DIM * GRID_DIM; ++i) {
-    uint32_t dynamic_offset     = i * (uint32_t)ALIGNMENT;
-    uint32_t dynamic_offsets[2] = {dynamic_offset, dynamic_offset};
-    // Bind the bind group for rendering a mesh using the dynamic offset
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 2,
-                                      dynamic_offsets);
-    // Draw object
+  const uint32_t object_count = (uint32_t)(grid_dim * grid_dim);
+  if (instanced) {
+    // Draw the whole grid, the instances read their parameters from the
+    // storage buffer
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                     instancing.pipeline);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      instancing.bind_group, 0, 0);
     wgpu_gltf_model_draw(models[current_object_index].object,
-                         (wgpu_gltf_model_render_options_t){0});
+                         (wgpu_gltf_model_render_options_t){
+                           .instance_count = object_count,
+                         });
+  }
+  else {
+    // Bind the rendering pipeline
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
+
+    for (uint32_t i = 0; i < object_count; ++i) {
+      uint32_t dynamic_offset     = i * (uint32_t)ALIGNMENT;
+      uint32_t dynamic_offsets[2] = {dynamic_offset, dynamic_offset};
+      // Bind the bind group for rendering a mesh using the dynamic offset
+      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group,
+                                        2, dynamic_offsets);
+      // Draw object
+      wgpu_gltf_model_draw(models[current_object_index].object,
+                           (wgpu_gltf_model_render_options_t){0});
+    }
   }
 
   // End render pass
@@ -636,6 +936,17 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.instance_params.buffer)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, instancing.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, instancing.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, instancing.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.bind_group)
+  free(material_params_dynamic);
+  free(object_params_dynamic);
+  free(instance_params);
+  material_params_dynamic = NULL;
+  object_params_dynamic   = NULL;
+  instance_params         = NULL;
 }
 
 void example_pbr_basic(int argc, char* argv[])
@@ -1,10 +1,14 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../webgpu/cubemap_filter.h"
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/texture_compressor.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Physical Based Rendering With Image Based Lighting
@@ -14,7 +18,15 @@
  * even more realistic look the scene as the light contribution used by the
  * materials is now controlled by the environment. Also shows how to generate
  * the BRDF 2D-LUT and irradiance and filtered cube maps from the environment
- * map.
+ * map. A front-to-back depth pre-pass of the objects lets the PBR fragment
+ * shader run once per pixel.
+ *
+ * The models and IBL textures are loaded by staged initialization over the
+ * first frames, the overlay shows the loading progress meanwhile.
+ *
+ * An equirectangular (.hdr) environment is given with --environment=<file>, it
+ * is converted into the environment cubemap on the GPU and baked next to the
+ * file along with the IBL textures.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/pbribl
@@ -29,6 +41,29 @@
 #define IRRADIANCE_CUBE_NUM_MIPS 7 // ((uint32_t)(floor(log2(dim)))) + 1;
 #define PREFILTERED_CUBE_DIM 512
 #define PREFILTERED_CUBE_NUM_MIPS 10 // ((uint32_t)(floor(log2(dim)))) + 1;
+#define ENVIRONMENT_CUBE_DIM 1024 // of equirectangular environments
+
+// Shaders
+// clang-format off
+static const char* depth_prepass_vertex_shader_wgsl = CODE(
+  struct UBO {
+    projection : mat4x4<f32>,
+    model      : mat4x4<f32>,
+    view       : mat4x4<f32>,
+    cam_pos    : vec3<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : UBO;
+  @group(0) @binding(3) var<uniform> obj_pos : vec3<f32>;
+
+  // Same operations as pbribl.vert, the PBR pass tests the depth with Equal
+  @vertex
+  fn main(@location(0) position : vec3<f32>) -> @builtin(position) vec4<f32> {
+    let world_pos = (ubo.model * vec4<f32>(position, 1.0)).xyz + obj_pos;
+    return ubo.projection * ubo.view * vec4<f32>(world_pos, 1.0);
+  }
+);
+// clang-format on
 
 static bool display_skybox = true;
 
@@ -191,7 +226,17 @@ static void setup_camera(wgpu_example_context_t* context)
   camera_set_position(context->camera, (vec3){0.55f, 0.85f, 12.0f});
 }
 
-static void load_assets(wgpu_context_t* wgpu_context)
+// Environment cube map, the generated IBL textures depend on it
+static const char* cubemap_files[6] = {
+  "textures/cubemaps/pisa_cube_px.png", // Right
+  "textures/cubemaps/pisa_cube_nx.png", // Left
+  "textures/cubemaps/pisa_cube_py.png", // Top
+  "textures/cubemaps/pisa_cube_ny.png", // Bottom
+  "textures/cubemaps/pisa_cube_pz.png", // Back
+  "textures/cubemaps/pisa_cube_nz.png", // Front
+};
+
+static void load_models(wgpu_context_t* wgpu_context)
 {
   // Load glTF models
   const uint32_t gltf_loading_flags
@@ -213,17 +258,32 @@ static void load_assets(wgpu_context_t* wgpu_context)
         .file_loading_flags = gltf_loading_flags,
       });
   }
+}
+
+// Optional equirectangular environment, replaces the cube map files
+static const char* environment_file = NULL;
+
+static void load_environment_cube(wgpu_context_t* wgpu_context)
+{
+  if (environment_file != NULL) {
+    char baked_filename[STRMAX];
+    snprintf(baked_filename, sizeof(baked_filename), "%s.cube.bin",
+             environment_file);
+    textures.environment_cube = wgpu_cubemap_load_equirectangular(
+      wgpu_context, environment_file, baked_filename,
+      &(wgpu_equirect_to_cubemap_desc_t){
+        .label = "environment_cube_texture",
+        .size  = ENVIRONMENT_CUBE_DIM,
+      });
+    if (textures.environment_cube.texture != NULL) {
+      return;
+    }
+    environment_file = NULL;
+  }
+
   // Cube map
-  static const char* cubemap[6] = {
-    "textures/cubemaps/pisa_cube_px.png", // Right
-    "textures/cubemaps/pisa_cube_nx.png", // Left
-    "textures/cubemaps/pisa_cube_py.png", // Top
-    "textures/cubemaps/pisa_cube_ny.png", // Bottom
-    "textures/cubemaps/pisa_cube_pz.png", // Back
-    "textures/cubemaps/pisa_cube_nz.png", // Front
-  };
   textures.environment_cube = wgpu_create_texture_cubemap_from_files(
-    wgpu_context, cubemap,
+    wgpu_context, cubemap_files,
     &(struct wgpu_texture_load_options_t){
       .flip_y = true, // Flip y to match pisa_cube.ktx hdr cubemap
     });
@@ -659,8 +719,13 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   {
     primitive_state.cullMode = WGPUCullMode_None;
 
-    // Enable depth write
-    depth_stencil_state.depthWriteEnabled = true;
+    // Test against the depth of the pre-pass
+    depth_stencil_state
+      = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+        .format              = WGPUTextureFormat_Depth24PlusStencil8,
+        .depth_write_enabled = true,
+        .depth_prepass       = true,
+      });
 
     // Vertex state
     WGPUVertexState vertex_state = wgpu_create_vertex_state(
@@ -703,6 +768,19 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
     WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
   }
+
+  // Depth pre-pass pipelines of the selectable objects, position only
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(models.objects); ++i) {
+    wgpu_gltf_model_prepare_depth_pipelines(
+      models.objects[i].object,
+      &(wgpu_gltf_depth_pipeline_desc_t){
+        .layout           = pipeline_layouts.pbr,
+        .vertex_wgsl_code = depth_prepass_vertex_shader_wgsl,
+        .depth_format     = WGPUTextureFormat_Depth24PlusStencil8,
+        .sample_count     = 1,
+        .double_sided     = true,
+      });
+  }
 }
 
 static uint64_t calc_constant_buffer_byte_size(uint64_t byte_size)
@@ -733,12 +811,18 @@ static void generate_brdf_lut(wgpu_context_t* wgpu_context)
       .sampleCount   = 1,
       .dimension     = WGPUTextureDimension_2D,
       .format        = format,
-      .usage
-      = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
+      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc
+               | WGPUTextureUsage_TextureBinding,
     };
     textures.lut_brdf.texture
       = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
     ASSERT(textures.lut_brdf.texture != NULL);
+    textures.lut_brdf.size.width      = dim;
+    textures.lut_brdf.size.height     = dim;
+    textures.lut_brdf.size.depth      = 1;
+    textures.lut_brdf.mip_level_count = 1;
+    textures.lut_brdf.format          = format;
+    textures.lut_brdf.dimension       = WGPUTextureDimension_2D;
   }
 
   // Create the texture view
@@ -894,1133 +978,299 @@ static void generate_brdf_lut(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline);
 }
 
+// HDR environments keep their range in the filtered cube maps
+static WGPUTextureFormat ibl_cube_format(void)
+{
+  return textures.environment_cube.format == WGPUTextureFormat_RGBA16Float ?
+           WGPUTextureFormat_RGBA16Float :
+           WGPUTextureFormat_RGBA8Unorm;
+}
+
 // Generate an irradiance cube map from the environment cube map
 static void generate_irradiance_cube(wgpu_context_t* wgpu_context)
 {
-  const WGPUTextureFormat format = WGPUTextureFormat_RGBA8Unorm;
-  const int32_t dim              = (int32_t)IRRADIANCE_CUBE_DIM;
-  const uint32_t num_mips        = (uint32_t)IRRADIANCE_CUBE_NUM_MIPS;
-  ASSERT(num_mips == ((uint32_t)(floor(log2(dim)))) + 1);
-  const uint32_t array_layer_count = 6; // Cube map
+  textures.irradiance_cube = wgpu_cubemap_filter(
+    wgpu_context, &textures.environment_cube,
+    &(wgpu_cubemap_filter_desc_t){
+      .label           = "irradiance_cube_texture",
+      .type            = WGPU_CubemapFilter_Irradiance,
+      .size            = IRRADIANCE_CUBE_DIM,
+      .mip_level_count = IRRADIANCE_CUBE_NUM_MIPS,
+      .format          = ibl_cube_format(),
+    });
+  ASSERT(textures.irradiance_cube.texture != NULL);
+}
 
-  /** Pre-filtered cube map **/
-  // Texture dimensions
-  WGPUExtent3D texture_extent = {
-    .width              = dim,
-    .height             = dim,
-    .depthOrArrayLayers = array_layer_count,
-  };
+// Prefilter environment cubemap
+// See
+// https://placeholderart.wordpress.com/2015/07/28/implementation-notes-runtime-environment-map-filtering-for-image-based-lighting/
+static void generate_prefiltered_cube(wgpu_context_t* wgpu_context)
+{
+  textures.prefiltered_cube = wgpu_cubemap_filter(
+    wgpu_context, &textures.environment_cube,
+    &(wgpu_cubemap_filter_desc_t){
+      .label           = "prefiltered_cube_texture",
+      .type            = WGPU_CubemapFilter_PrefilterGGX,
+      .size            = PREFILTERED_CUBE_DIM,
+      .mip_level_count = PREFILTERED_CUBE_NUM_MIPS,
+      .format          = ibl_cube_format(),
+      .sample_count    = 32u,
+    });
+  ASSERT(textures.prefiltered_cube.texture != NULL);
+}
 
-  // Create the texture
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .label         = "irradiance_cube_texture",
-      .size          = texture_extent,
-      .mipLevelCount = num_mips,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = format,
-      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopyDst
-               | WGPUTextureUsage_TextureBinding,
-    };
-    textures.irradiance_cube.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(textures.irradiance_cube.texture != NULL);
+// The generated IBL textures are saved next to the environment cube map and
+// loaded from there on later runs
+static struct {
+  texture_t* texture;
+  const char* filename;
+  const char* suffix; // of the files next to an equirectangular environment
+  void (*generate)(wgpu_context_t* wgpu_context);
+  // Sampled format of LDR textures if BC is supported
+  wgpu_texture_compression_enum_t compression;
+} ibl_textures[3] = {
+  {&textures.lut_brdf, "textures/cubemaps/pisa_cube_brdf_lut.bin",
+   "brdf_lut.bin", generate_brdf_lut, WGPU_TextureCompression_BC5},
+  {&textures.irradiance_cube, "textures/cubemaps/pisa_cube_irradiance.bin",
+   "irradiance.bin", generate_irradiance_cube, WGPU_TextureCompression_BC7},
+  {&textures.prefiltered_cube, "textures/cubemaps/pisa_cube_prefiltered.bin",
+   "prefiltered.bin", generate_prefiltered_cube, WGPU_TextureCompression_BC7},
+};
+
+static wgpu_texture_compressor_t* texture_compressor = NULL;
+
+// The LDR IBL textures are sampled compressed, the baked files stay RGBA8
+static void compress_ibl_texture(wgpu_context_t* wgpu_context, uint32_t index)
+{
+  texture_t* texture = ibl_textures[index].texture;
+  if (texture->format != WGPUTextureFormat_RGBA8Unorm
+      || !wgpu_texture_compressor_is_supported(wgpu_context)) {
+    return;
   }
 
-  // Create the texture view
-  {
-    WGPUTextureViewDescriptor texture_view_dec = {
-      .label           = "irradiance_cube_texture_view",
-      .dimension       = WGPUTextureViewDimension_Cube,
-      .format          = format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = num_mips,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = array_layer_count,
-    };
-    textures.irradiance_cube.view = wgpuTextureCreateView(
-      textures.irradiance_cube.texture, &texture_view_dec);
-    ASSERT(textures.irradiance_cube.view != NULL);
+  if (texture_compressor == NULL) {
+    texture_compressor = wgpu_texture_compressor_create(wgpu_context);
   }
+  texture_t compressed = wgpu_texture_compressor_compress(
+    texture_compressor, texture, ibl_textures[index].compression);
+  if (compressed.texture != NULL) {
+    wgpu_destroy_texture(texture);
+    *texture = compressed;
+  }
+}
 
-  // Create the sampler
-  {
-    textures.irradiance_cube.sampler = wgpuDeviceCreateSampler(
-      wgpu_context->device, &(WGPUSamplerDescriptor){
-                              .label        = "irradiance_cube_texture_sampler",
-                              .addressModeU = WGPUAddressMode_ClampToEdge,
-                              .addressModeV = WGPUAddressMode_ClampToEdge,
-                              .addressModeW = WGPUAddressMode_ClampToEdge,
-                              .minFilter    = WGPUFilterMode_Linear,
-                              .magFilter    = WGPUFilterMode_Linear,
-                              .mipmapFilter = WGPUFilterMode_Linear,
-                              .lodMinClamp  = 0.0f,
-                              .lodMaxClamp  = (float)num_mips,
-                              .maxAnisotropy = 1,
-                            });
-    ASSERT(textures.irradiance_cube.sampler != NULL);
+static void prepare_ibl_texture(wgpu_context_t* wgpu_context, uint32_t index)
+{
+  const uint32_t settings[7] = {
+    BRDF_LUT_DIM,
+    IRRADIANCE_CUBE_DIM,
+    IRRADIANCE_CUBE_NUM_MIPS,
+    PREFILTERED_CUBE_DIM,
+    PREFILTERED_CUBE_NUM_MIPS,
+    ENVIRONMENT_CUBE_DIM,
+    (uint32_t)ibl_cube_format(),
+  };
+  char filename[STRMAX];
+  uint64_t key = 0;
+  if (environment_file != NULL) {
+    const char* const environment_files[1] = {environment_file};
+    snprintf(filename, sizeof(filename), "%s.%s", environment_file,
+             ibl_textures[index].suffix);
+    key = wgpu_texture_file_key(environment_files, 1, settings,
+                                sizeof(settings));
+  }
+  else {
+    snprintf(filename, sizeof(filename), "%s", ibl_textures[index].filename);
+    key = wgpu_texture_file_key(cubemap_files,
+                                (uint32_t)ARRAY_SIZE(cubemap_files), settings,
+                                sizeof(settings));
   }
+  *ibl_textures[index].texture = wgpu_texture_load_from_baked_file(
+    wgpu_context, filename, key,
+    &(struct wgpu_texture_load_options_t){
+      .address_mode = WGPUAddressMode_ClampToEdge,
+    });
+  if (ibl_textures[index].texture->texture == NULL) {
+    ibl_textures[index].generate(wgpu_context);
+    wgpu_texture_save_to_baked_file(wgpu_context, ibl_textures[index].texture,
+                                    filename, key);
+  }
+  compress_ibl_texture(wgpu_context, index);
+}
 
-  // Framebuffer for offscreen rendering
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView texture_views[6 * (uint32_t)IRRADIANCE_CUBE_NUM_MIPS];
-  } offscreen;
+static void update_uniform_buffers(wgpu_example_context_t* context)
+{
+  // 3D object
+  camera_t* camera = context->camera;
+  glm_mat4_copy(camera->matrices.perspective, ubo_matrices.projection);
+  glm_mat4_copy(camera->matrices.view, ubo_matrices.view);
+  glm_mat4_identity(ubo_matrices.model);
+  glm_rotate(ubo_matrices.model,
+             glm_rad(-90.0f + (models.object_index == 1 ? 45.0f : 0.0f)),
+             (vec3){0.0f, 1.0f, 0.0f});
+  glm_vec3_scale(camera->position, -1.0f, ubo_matrices.cam_pos);
+  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.object.buffer,
+                          0, &ubo_matrices, uniform_buffers.object.size);
 
-  // Offscreen framebuffer
-  {
-    // Color attachment
-    {
-      // Create the texture
-      WGPUTextureDescriptor texture_desc = {
-        .label         = "irradiance_cube_offscreen_texture",
-        .size          = (WGPUExtent3D) {
-          .width              = dim,
-          .height             = dim,
-          .depthOrArrayLayers = array_layer_count,
-        },
-        .mipLevelCount = num_mips,
-        .sampleCount   = 1,
-        .dimension     = WGPUTextureDimension_2D,
-        .format        = format,
-        .usage = WGPUTextureUsage_CopySrc | WGPUTextureUsage_TextureBinding
-                 | WGPUTextureUsage_RenderAttachment,
-      };
-      offscreen.texture
-        = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-      ASSERT(offscreen.texture != NULL);
-
-      // Create the texture views
-      uint32_t idx = 0;
-      for (uint32_t array_layer = 0; array_layer < array_layer_count;
-           ++array_layer) {
-        for (uint32_t i = 0; i < num_mips; ++i) {
-          idx = (array_layer * num_mips) + i;
-          WGPUTextureViewDescriptor texture_view_dec = {
-            .label           = "irradiance_cube_offscreen_texture_view",
-            .aspect          = WGPUTextureAspect_All,
-            .dimension       = WGPUTextureViewDimension_2D,
-            .format          = texture_desc.format,
-            .baseMipLevel    = i,
-            .mipLevelCount   = 1,
-            .baseArrayLayer  = array_layer,
-            .arrayLayerCount = 1,
-          };
-          offscreen.texture_views[idx]
-            = wgpuTextureCreateView(offscreen.texture, &texture_view_dec);
-          ASSERT(offscreen.texture_views[idx] != NULL);
-        }
-      }
-    }
+  // Skybox
+  mat3 mat3_tmp = GLM_MAT3_ZERO_INIT;
+  glm_mat4_pick3(camera->matrices.view, mat3_tmp);
+  glm_mat4_ins3(mat3_tmp, ubo_matrices.model);
+  ubo_matrices.model[3][3] = 1.0f;
+  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.skybox.buffer,
+                          0, &ubo_matrices, uniform_buffers.skybox.size);
+}
+
+static void update_dynamic_uniform_buffer(wgpu_context_t* wgpu_context)
+{
+  // Set objects positions and material properties
+  uint32_t obj_count = (uint32_t)SINGLE_ROW_OBJECT_COUNT;
+  for (uint32_t x = 0; x < obj_count; ++x) {
+    // Set object position
+    vec3* pos = &object_params_dynamic[x].position;
+    glm_vec3_copy((vec3){((float)(x - (obj_count / 2.0f))) * 2.15f, 0.0f, 0.0f},
+                  *pos);
+    // Set material metallic and roughness properties
+    struct matrial_params_dynamic_t* mat_params = &material_params_dynamic[x];
+    mat_params->roughness
+      = 1.0f - glm_clamp((float)x / (float)obj_count, 0.005f, 1.0f);
+    mat_params->metallic = glm_clamp((float)x / (float)obj_count, 0.005f, 1.0f);
+    glm_vec3_copy(materials[current_material_index].params.color,
+                  (*mat_params).color);
   }
 
-  struct push_block_vs_t {
-    mat4 mvp;
-    uint8_t padding[192];
-  } push_block_vs[(uint32_t)IRRADIANCE_CUBE_NUM_MIPS * 6];
+  // Update buffers
+  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.object_params.buffer, 0,
+                          &object_params_dynamic,
+                          uniform_buffers.object_params.buffer_size);
+  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.material_params.buffer,
+                          0, &material_params_dynamic,
+                          uniform_buffers.material_params.buffer_size);
+}
 
-  struct push_block_fs_t {
-    float delta_phi;
-    float delta_theta;
-    uint8_t padding[248];
-  } push_block_fs[(uint32_t)IRRADIANCE_CUBE_NUM_MIPS * 6];
+static void update_params(wgpu_context_t* wgpu_context)
+{
+  const float p = 15.0f;
+  glm_vec4_copy((vec4){-p, -p * 0.5f, -p, 1.0f}, ubo_params.lights[0]);
+  glm_vec4_copy((vec4){-p, -p * 0.5f, p, 1.0f}, ubo_params.lights[1]);
+  glm_vec4_copy((vec4){p, -p * 0.5f, p, 1.0f}, ubo_params.lights[2]);
+  glm_vec4_copy((vec4){p, -p * 0.5f, -p, 1.0f}, ubo_params.lights[3]);
 
-  // Update shader push constant block data
-  {
-    mat4 matrices[6] = {
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_X
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_X
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_Y
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_Y
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_Z
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_Z
-    };
-    // NEGATIVE_X
-    glm_rotate(matrices[0], glm_rad(90.0f), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(matrices[0], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_X
-    glm_rotate(matrices[1], glm_rad(-90.0f), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(matrices[1], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // POSITIVE_Y
-    glm_rotate(matrices[2], glm_rad(90.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_Y
-    glm_rotate(matrices[3], glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // POSITIVE_Z
-    glm_rotate(matrices[4], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_Z
-    glm_rotate(matrices[5], glm_rad(180.0f), (vec3){0.0f, 0.0f, 1.0f});
-
-    mat4 projection = GLM_MAT4_IDENTITY_INIT;
-    glm_perspective(PI / 2.0f, 1.0f, 0.1f, 512.0f, projection);
-    // Sampling deltas
-    const float delta_phi   = (2.0f * PI) / 180.0f;
-    const float delta_theta = (0.5f * PI) / 64.0f;
-    uint32_t idx            = 0;
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      for (uint32_t f = 0; f < 6; ++f) {
-        idx = (m * 6) + f;
-        // Set vertex shader push constant block
-        glm_mat4_mul(projection, matrices[f], push_block_vs[idx].mvp);
-        // Set fragment shader push constant block
-        push_block_fs[idx].delta_phi   = delta_phi;
-        push_block_fs[idx].delta_theta = delta_theta;
-      }
-    }
-  }
+  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.ubo_params.buffer, 0,
+                          &ubo_params, uniform_buffers.ubo_params.size);
+}
 
-  static struct {
-    // Vertex shader parameter uniform buffer
-    struct {
-      WGPUBuffer buffer;
-      uint64_t buffer_size;
-      uint64_t model_size;
-    } vs;
-    // Fragment parameter uniform buffer
-    struct {
-      WGPUBuffer buffer;
-      uint64_t buffer_size;
-      uint64_t model_size;
-    } fs;
-  } irradiance_cube_ubos;
-
-  // Vertex shader parameter uniform buffer
-  {
-    irradiance_cube_ubos.vs.model_size = sizeof(mat4);
-    irradiance_cube_ubos.vs.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(push_block_vs));
-    irradiance_cube_ubos.vs.buffer = wgpu_create_buffer_from_data(
-      wgpu_context, push_block_vs, irradiance_cube_ubos.vs.buffer_size,
-      WGPUBufferUsage_Uniform);
-  }
+// Prepare and initialize uniform buffer containing shader uniforms
+static void prepare_uniform_buffers(wgpu_example_context_t* context)
+{
+  // Object vertex shader uniform buffer
+  uniform_buffers.object = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ubo_matrices),
+    });
 
-  // Fragment shader parameter uniform buffer
-  {
-    irradiance_cube_ubos.fs.model_size = sizeof(float) * 2;
-    irradiance_cube_ubos.fs.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(push_block_fs));
-    irradiance_cube_ubos.fs.buffer = wgpu_create_buffer_from_data(
-      wgpu_context, push_block_fs, irradiance_cube_ubos.fs.buffer_size,
-      WGPUBufferUsage_Uniform);
-  }
+  // Skybox vertex shader uniform buffer
+  uniform_buffers.skybox = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ubo_matrices),
+    });
 
-  // Bind group layout
-  WGPUBindGroupLayout bind_group_layout = NULL;
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[4] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Vertex shader uniform UBO
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Vertex,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = true,
-          .minBindingSize   = irradiance_cube_ubos.vs.model_size,
-        },
-        .sampler = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: Fragment shader uniform UBO
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = true,
-          .minBindingSize   = irradiance_cube_ubos.fs.model_size,
-        },
-        .sampler = {0},
-      },
-      [2] = (WGPUBindGroupLayoutEntry) {
-        // Binding 2: Fragment shader image view
-        .binding    = 2,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_Cube,
-          .multisampled  = false,
-        },
-        .storageTexture = {0},
-      },
-      [3] = (WGPUBindGroupLayoutEntry) {
-        // Binding 3: Fragment shader image sampler
-        .binding    = 3,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      },
-    };
-    bind_group_layout = wgpuDeviceCreateBindGroupLayout(
-      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
-                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-                              .entries    = bgl_entries,
-                            });
-    ASSERT(bind_group_layout != NULL);
-  }
+  // Shared parameter uniform buffer
+  uniform_buffers.ubo_params = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ubo_params),
+    });
 
-  // Bind group
-  WGPUBindGroup bind_group = NULL;
+  // Material parameter uniform buffer
   {
-    WGPUBindGroupEntry bg_entries[4] = {
-      [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Vertex shader uniform UBO
-        .binding = 0,
-        .buffer  = irradiance_cube_ubos.vs.buffer,
-        .offset  = 0,
-        .size    = irradiance_cube_ubos.vs.model_size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        // Binding 1: Fragment shader uniform UBO
-        .binding = 1,
-        .buffer  = irradiance_cube_ubos.fs.buffer,
-        .offset  = 0,
-        .size    = irradiance_cube_ubos.fs.model_size,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        // Binding 2: Fragment shader image view
-        .binding     = 2,
-        .textureView = textures.environment_cube.view
-      },
-      [3] = (WGPUBindGroupEntry) {
-        // Binding 3: Fragment shader image sampler
-        .binding = 3,
-        .sampler = textures.environment_cube.sampler,
-      },
+    uniform_buffers.material_params.model_size = sizeof(vec3) + sizeof(vec3);
+    uniform_buffers.material_params.buffer_size
+      = calc_constant_buffer_byte_size(sizeof(material_params_dynamic));
+    WGPUBufferDescriptor ubo_desc = {
+      .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size             = uniform_buffers.material_params.buffer_size,
+      .mappedAtCreation = false,
     };
-    bind_group = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .layout     = bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_group != NULL);
+    uniform_buffers.material_params.buffer
+      = wgpuDeviceCreateBuffer(context->wgpu_context->device, &ubo_desc);
   }
 
-  // Pipeline layout
-  WGPUPipelineLayout pipeline_layout = NULL;
+  // Object parameter uniform buffer
   {
-    pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
-                              .bindGroupLayoutCount = 1,
-                              .bindGroupLayouts     = &bind_group_layout,
-                            });
-    ASSERT(pipeline_layout != NULL);
-  }
-
-  // Irradiance cube map pipeline
-  WGPURenderPipeline pipeline = NULL;
-  {
-    // Primitive state
-    WGPUPrimitiveState primitive_state = {
-      .topology  = WGPUPrimitiveTopology_TriangleList,
-      .frontFace = WGPUFrontFace_CCW,
-      .cullMode  = WGPUCullMode_None,
-    };
-
-    // Color target state
-    WGPUBlendState blend_state              = wgpu_create_blend_state(false);
-    WGPUColorTargetState color_target_state = (WGPUColorTargetState){
-      .format    = format,
-      .blend     = &blend_state,
-      .writeMask = WGPUColorWriteMask_All,
+    uniform_buffers.object_params.model_size = sizeof(vec3);
+    uniform_buffers.object_params.buffer_size
+      = calc_constant_buffer_byte_size(sizeof(object_params_dynamic));
+    WGPUBufferDescriptor ubo_desc = {
+      .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size             = uniform_buffers.object_params.buffer_size,
+      .mappedAtCreation = false,
     };
-
-    // Vertex buffer layout
-    WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
-      skybox,
-      // Location 0: Position
-      WGPU_GLTF_VERTATTR_DESC(0, WGPU_GLTF_VertexComponent_Position));
-
-    // Vertex state
-    WGPUVertexState vertex_state = wgpu_create_vertex_state(
-              wgpu_context, &(wgpu_vertex_state_t){
-              .shader_desc = (wgpu_shader_desc_t){
-                // Vertex shader SPIR-
-                .label = "filtercube_vertex_shader",
-                .file  = "shaders/pbr_ibl/filtercube.vert.spv",
-              },
-             .buffer_count = 1,
-             .buffers      = &skybox_vertex_buffer_layout,
-            });
-
-    // Fragment state
-    WGPUFragmentState fragment_state = wgpu_create_fragment_state(
-              wgpu_context, &(wgpu_fragment_state_t){
-              .shader_desc = (wgpu_shader_desc_t){
-                // Fragment shader SPIR-V
-                .label = "irradiancecube_fragment_shader",
-                .file  = "shaders/pbr_ibl/irradiancecube.frag.spv",
-              },
-              .target_count = 1,
-              .targets      = &color_target_state,
-            });
-
-    // Multisample state
-    WGPUMultisampleState multisample_state
-      = wgpu_create_multisample_state_descriptor(
-        &(create_multisample_state_desc_t){
-          .sample_count = 1,
-        });
-
-    // Create rendering pipeline using the specified states
-    pipeline = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                              .label  = "irradiance_cube_map_render_pipeline",
-                              .layout = pipeline_layout,
-                              .primitive    = primitive_state,
-                              .vertex       = vertex_state,
-                              .fragment     = &fragment_state,
-                              .depthStencil = NULL,
-                              .multisample  = multisample_state,
-                            });
-    ASSERT(pipeline != NULL);
-
-    // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    uniform_buffers.object_params.buffer
+      = wgpuDeviceCreateBuffer(context->wgpu_context->device, &ubo_desc);
   }
 
-  // Create the actual renderpass
-  struct {
-    WGPURenderPassColorAttachment color_attachment[1];
-    WGPURenderPassDescriptor render_pass_descriptor;
-  } render_pass = {
-    .color_attachment[0]= (WGPURenderPassColorAttachment) {
-        .view       = NULL,
-        .loadOp     = WGPULoadOp_Clear,
-        .storeOp    = WGPUStoreOp_Store,
-        .clearColor = (WGPUColor) {
-          .r = 0.0f,
-          .g = 0.0f,
-          .b = 0.2f,
-          .a = 0.0f,
-        },
-     },
-  };
-  render_pass.render_pass_descriptor = (WGPURenderPassDescriptor){
-    .colorAttachmentCount   = 1,
-    .colorAttachments       = render_pass.color_attachment,
-    .depthStencilAttachment = NULL,
-  };
-
-  // Render
-  {
-    wgpu_context->cmd_enc
-      = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-
-    uint32_t idx         = 0;
-    float viewport_width = 0.0f, viewport_height = 0.0f;
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      viewport_width  = (float)(dim * pow(0.5f, m));
-      viewport_height = (float)(dim * pow(0.5f, m));
-      for (uint32_t f = 0; f < 6; ++f) {
-        render_pass.color_attachment[0].view
-          = offscreen.texture_views[(f * num_mips) + m];
-        idx = (m * 6) + f;
-        // Render scene from cube face's point of view
-        wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-          wgpu_context->cmd_enc, &render_pass.render_pass_descriptor);
-        wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                         viewport_width, viewport_height, 0.0f,
-                                         1.0f);
-        wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                            (uint32_t)viewport_width,
-                                            (uint32_t)viewport_height);
-        wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
-        // Calculate the dynamic offsets
-        uint32_t dynamic_offset     = idx * (uint32_t)ALIGNMENT;
-        uint32_t dynamic_offsets[2] = {dynamic_offset, dynamic_offset};
-        // Bind the bind group for rendering a mesh using the dynamic offset
-        wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                          bind_group, 2, dynamic_offsets);
-        // Draw object
-        wgpu_gltf_model_draw(models.skybox,
-                             (wgpu_gltf_model_render_options_t){0});
-        // End render pass
-        wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-        WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-      }
-    }
-
-    // Copy region for transfer from framebuffer to cube face
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      WGPUExtent3D copy_size = (WGPUExtent3D){
-        .width              = (float)(dim * pow(0.5f, m)),
-        .height             = (float)(dim * pow(0.5f, m)),
-        .depthOrArrayLayers = array_layer_count,
-      };
-      wgpuCommandEncoderCopyTextureToTexture(
-        wgpu_context->cmd_enc,
-        // source
-        &(WGPUImageCopyTexture){
-          .texture  = offscreen.texture,
-          .mipLevel = m,
-        },
-        // destination
-        &(WGPUImageCopyTexture){
-          .texture  = textures.irradiance_cube.texture,
-          .mipLevel = m,
-        },
-        // copySize
-        &copy_size);
-    }
-
-    WGPUCommandBuffer command_buffer
-      = wgpuCommandEncoderFinish(wgpu_context->cmd_enc, NULL);
-    ASSERT(command_buffer != NULL);
-    WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+  update_uniform_buffers(context);
+  update_dynamic_uniform_buffer(context->wgpu_context);
+  update_params(context->wgpu_context);
+}
 
-    // Sumbit commmand buffer and cleanup
-    wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
-    WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
-  }
+/* Load tasks, see example_queue_load_task() */
 
-  // Cleanup
-  WGPU_RELEASE_RESOURCE(Texture, offscreen.texture)
-  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(offscreen.texture_views); ++i) {
-    WGPU_RELEASE_RESOURCE(TextureView, offscreen.texture_views[i])
-  }
-  WGPU_RELEASE_RESOURCE(Buffer, irradiance_cube_ubos.vs.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, irradiance_cube_ubos.fs.buffer)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+static void load_models_task(wgpu_example_context_t* context)
+{
+  load_models(context->wgpu_context);
 }
 
-// Prefilter environment cubemap
-// See
-// https://placeholderart.wordpress.com/2015/07/28/implementation-notes-runtime-environment-map-filtering-for-image-based-lighting/
-static void generate_prefiltered_cube(wgpu_context_t* wgpu_context)
+static void load_environment_task(wgpu_example_context_t* context)
 {
-  const WGPUTextureFormat format = WGPUTextureFormat_RGBA8Unorm;
-  const int32_t dim              = (int32_t)PREFILTERED_CUBE_DIM;
-  const uint32_t num_mips        = (uint32_t)PREFILTERED_CUBE_NUM_MIPS;
-  ASSERT(num_mips == ((uint32_t)(floor(log2(dim)))) + 1)
-  const uint32_t array_layer_count = 6; // Cube map
-
-  /** Pre-filtered cube map **/
-  // Texture dimensions
-  WGPUExtent3D texture_extent = {
-    .width              = dim,
-    .height             = dim,
-    .depthOrArrayLayers = array_layer_count,
-  };
-
-  // Create the texture
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .label         = "prefiltered_cube_texture",
-      .size          = texture_extent,
-      .mipLevelCount = num_mips,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = format,
-      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopyDst
-               | WGPUTextureUsage_TextureBinding,
-    };
-    textures.prefiltered_cube.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(textures.prefiltered_cube.texture != NULL);
-  }
-
-  // Create the texture view
-  {
-    WGPUTextureViewDescriptor texture_view_dec = {
-      .label           = "prefiltered_cube_texture_view",
-      .dimension       = WGPUTextureViewDimension_Cube,
-      .format          = format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = num_mips,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = array_layer_count,
-    };
-    textures.prefiltered_cube.view = wgpuTextureCreateView(
-      textures.prefiltered_cube.texture, &texture_view_dec);
-    ASSERT(textures.prefiltered_cube.view != NULL);
-  }
-
-  // Create the sampler
-  {
-    textures.prefiltered_cube.sampler = wgpuDeviceCreateSampler(
-      wgpu_context->device, &(WGPUSamplerDescriptor){
-                              .label = "prefiltered_cube_texture_sampler",
-                              .addressModeU  = WGPUAddressMode_ClampToEdge,
-                              .addressModeV  = WGPUAddressMode_ClampToEdge,
-                              .addressModeW  = WGPUAddressMode_ClampToEdge,
-                              .minFilter     = WGPUFilterMode_Linear,
-                              .magFilter     = WGPUFilterMode_Linear,
-                              .mipmapFilter  = WGPUFilterMode_Linear,
-                              .lodMinClamp   = 0.0f,
-                              .lodMaxClamp   = (float)num_mips,
-                              .maxAnisotropy = 1,
-                            });
-    ASSERT(textures.prefiltered_cube.sampler != NULL);
-  }
-
-  // Framebuffer for offscreen rendering
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView texture_views[6 * (uint32_t)PREFILTERED_CUBE_NUM_MIPS];
-  } offscreen;
-
-  // Offscreen framebuffer
-  {
-    // Color attachment
-    {
-      // Create the texture
-      WGPUTextureDescriptor texture_desc = {
-        .label         = "prefiltered_cube_offscreen_texture",
-        .size          = (WGPUExtent3D) {
-          .width              = dim,
-          .height             = dim,
-          .depthOrArrayLayers = array_layer_count,
-        },
-        .mipLevelCount = num_mips,
-        .sampleCount   = 1,
-        .dimension     = WGPUTextureDimension_2D,
-        .format        = format,
-        .usage = WGPUTextureUsage_CopySrc | WGPUTextureUsage_TextureBinding
-                 | WGPUTextureUsage_RenderAttachment,
-      };
-      offscreen.texture
-        = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-      ASSERT(offscreen.texture != NULL)
-
-      // Create the texture views
-      uint32_t idx = 0;
-      for (uint32_t array_layer = 0; array_layer < array_layer_count;
-           ++array_layer) {
-        for (uint32_t i = 0; i < num_mips; ++i) {
-          idx = (array_layer * num_mips) + i;
-          WGPUTextureViewDescriptor texture_view_dec = {
-            .label           = "prefiltered_cube_offscreen_texture_view",
-            .aspect          = WGPUTextureAspect_All,
-            .dimension       = WGPUTextureViewDimension_2D,
-            .format          = texture_desc.format,
-            .baseMipLevel    = i,
-            .mipLevelCount   = 1,
-            .baseArrayLayer  = array_layer,
-            .arrayLayerCount = 1,
-          };
-          offscreen.texture_views[idx]
-            = wgpuTextureCreateView(offscreen.texture, &texture_view_dec);
-          ASSERT(offscreen.texture_views[idx] != NULL)
-        }
-      }
-    }
-  }
-
-  struct push_block_vs_t {
-    mat4 mvp;
-    uint8_t padding[192];
-  } push_block_vs[(uint32_t)PREFILTERED_CUBE_NUM_MIPS * 6];
-
-  struct push_block_fs_t {
-    float roughness;
-    uint32_t num_samples;
-    uint8_t padding[248];
-  } push_block_fs[(uint32_t)PREFILTERED_CUBE_NUM_MIPS * 6];
-
-  // Update shader push constant block data
-  {
-    mat4 matrices[6] = {
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_X
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_X
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_Y
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_Y
-      GLM_MAT4_IDENTITY_INIT, // POSITIVE_Z
-      GLM_MAT4_IDENTITY_INIT, // NEGATIVE_Z
-    };
-    // NEGATIVE_X
-    glm_rotate(matrices[0], glm_rad(90.0f), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(matrices[0], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_X
-    glm_rotate(matrices[1], glm_rad(-90.0f), (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(matrices[1], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // POSITIVE_Y
-    glm_rotate(matrices[2], glm_rad(90.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_Y
-    glm_rotate(matrices[3], glm_rad(-90.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // POSITIVE_Z
-    glm_rotate(matrices[4], glm_rad(180.0f), (vec3){1.0f, 0.0f, 0.0f});
-    // NEGATIVE_Z
-    glm_rotate(matrices[5], glm_rad(180.0f), (vec3){0.0f, 0.0f, 1.0f});
-
-    mat4 projection = GLM_MAT4_IDENTITY_INIT;
-    glm_perspective(PI / 2.0f, 1.0f, 0.1f, 512.0f, projection);
-    // Sampling deltas
-    uint32_t idx = 0;
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      for (uint32_t f = 0; f < 6; ++f) {
-        idx = (m * 6) + f;
-        // Set vertex shader push constant block
-        glm_mat4_mul(projection, matrices[f], push_block_vs[idx].mvp);
-        // Set fragment shader push constant block
-        push_block_fs[idx].roughness   = (float)m / (float)(num_mips - 1);
-        push_block_fs[idx].num_samples = 32u;
-      }
-    }
-  }
-
-  static struct {
-    // Vertex shader parameter uniform buffer
-    struct {
-      WGPUBuffer buffer;
-      uint64_t buffer_size;
-      uint64_t model_size;
-    } vs;
-    // Fragment parameter uniform buffer
-    struct {
-      WGPUBuffer buffer;
-      uint64_t buffer_size;
-      uint64_t model_size;
-    } fs;
-  } prefiltered_cube_ubos;
-
-  // Vertex shader parameter uniform buffer
-  {
-    prefiltered_cube_ubos.vs.model_size = sizeof(mat4);
-    prefiltered_cube_ubos.vs.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(push_block_vs));
-    prefiltered_cube_ubos.vs.buffer = wgpu_create_buffer_from_data(
-      wgpu_context, push_block_vs, prefiltered_cube_ubos.vs.buffer_size,
-      WGPUBufferUsage_Uniform);
-  }
-
-  // Fragment shader parameter uniform buffer
-  {
-    prefiltered_cube_ubos.fs.model_size = sizeof(float) + sizeof(uint32_t);
-    prefiltered_cube_ubos.fs.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(push_block_fs));
-    prefiltered_cube_ubos.fs.buffer = wgpu_create_buffer_from_data(
-      wgpu_context, push_block_fs, prefiltered_cube_ubos.fs.buffer_size,
-      WGPUBufferUsage_Uniform);
-  }
-
-  // Bind group layout
-  WGPUBindGroupLayout bind_group_layout = NULL;
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[4] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: Vertex shader uniform UBO
-        .binding   = 0,
-        .visibility = WGPUShaderStage_Vertex,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = true,
-          .minBindingSize   = prefiltered_cube_ubos.vs.model_size,
-        },
-        .sampler = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: Fragment shader uniform UBO
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment,
-        .buffer = (WGPUBufferBindingLayout) {
-          .type             = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = true,
-          .minBindingSize   = prefiltered_cube_ubos.fs.model_size,
-        },
-        .sampler = {0},
-      },
-      [2] = (WGPUBindGroupLayoutEntry) {
-        // Binding 2: Fragment shader image view
-        .binding    = 2,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_Cube,
-          .multisampled  = false,
-        },
-        .storageTexture = {0},
-      },
-      [3] = (WGPUBindGroupLayoutEntry) {
-        // Binding 3: Fragment shader image sampler
-        .binding    = 3,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      },
-    };
-    bind_group_layout = wgpuDeviceCreateBindGroupLayout(
-      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
-                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-                              .entries    = bgl_entries,
-                            });
-    ASSERT(bind_group_layout != NULL);
-  }
-
-  // Bind group
-  WGPUBindGroup bind_group = NULL;
-  {
-    WGPUBindGroupEntry bg_entries[4] = {
-      [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Vertex shader uniform UBO
-        .binding = 0,
-        .buffer  = prefiltered_cube_ubos.vs.buffer,
-        .offset  = 0,
-        .size    = prefiltered_cube_ubos.vs.model_size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        // Binding 1: Fragment shader uniform UBO
-        .binding = 1,
-        .buffer  = prefiltered_cube_ubos.fs.buffer,
-        .offset  = 0,
-        .size    = prefiltered_cube_ubos.fs.model_size,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        // Binding 2: Fragment shader image view
-        .binding     = 2,
-        .textureView = textures.environment_cube.view
-      },
-      [3] = (WGPUBindGroupEntry) {
-        // Binding 3: Fragment shader image sampler
-        .binding = 3,
-        .sampler = textures.environment_cube.sampler,
-      },
-    };
-    bind_group = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .layout     = bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_group != NULL);
-  }
-
-  // Pipeline layout
-  WGPUPipelineLayout pipeline_layout = NULL;
-  {
-    pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
-                              .bindGroupLayoutCount = 1,
-                              .bindGroupLayouts     = &bind_group_layout,
-                            });
-    ASSERT(pipeline_layout != NULL)
-  }
-
-  // Prefiltered cube map pipeline
-  WGPURenderPipeline pipeline = NULL;
-  {
-    // Primitive state
-    WGPUPrimitiveState primitive_state = {
-      .topology  = WGPUPrimitiveTopology_TriangleList,
-      .frontFace = WGPUFrontFace_CCW,
-      .cullMode  = WGPUCullMode_None,
-    };
-
-    // Color target state
-    WGPUBlendState blend_state              = wgpu_create_blend_state(false);
-    WGPUColorTargetState color_target_state = (WGPUColorTargetState){
-      .format    = format,
-      .blend     = &blend_state,
-      .writeMask = WGPUColorWriteMask_All,
-    };
-
-    // Vertex buffer layout
-    WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
-      skybox,
-      // Location 0: Position
-      WGPU_GLTF_VERTATTR_DESC(0, WGPU_GLTF_VertexComponent_Position));
-
-    // Vertex state
-    WGPUVertexState vertex_state = wgpu_create_vertex_state(
-              wgpu_context, &(wgpu_vertex_state_t){
-              .shader_desc = (wgpu_shader_desc_t){
-                // Vertex shader SPIR-V
-                .label = "filtercube_vertex_shaders",
-                .file  = "shaders/pbr_ibl/filtercube.vert.spv",
-              },
-             .buffer_count = 1,
-             .buffers = &skybox_vertex_buffer_layout,
-            });
-
-    // Fragment state
-    WGPUFragmentState fragment_state = wgpu_create_fragment_state(
-              wgpu_context, &(wgpu_fragment_state_t){
-              .shader_desc = (wgpu_shader_desc_t){
-                // Fragment shader SPIR-V
-                .label = "prefilterenvmap_fragment_shaders",
-                .file  = "shaders/pbr_ibl/prefilterenvmap.frag.spv",
-              },
-              .target_count = 1,
-              .targets = &color_target_state,
-            });
-
-    // Multisample state
-    WGPUMultisampleState multisample_state
-      = wgpu_create_multisample_state_descriptor(
-        &(create_multisample_state_desc_t){
-          .sample_count = 1,
-        });
-
-    // Create rendering pipeline using the specified states
-    pipeline = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                              .label  = "prefiltered_cube_map_render_pipeline",
-                              .layout = pipeline_layout,
-                              .primitive    = primitive_state,
-                              .vertex       = vertex_state,
-                              .fragment     = &fragment_state,
-                              .depthStencil = NULL,
-                              .multisample  = multisample_state,
-                            });
-    ASSERT(pipeline != NULL);
-
-    // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
-  }
-
-  // Create the actual renderpass
-  struct {
-    WGPURenderPassColorAttachment color_attachment[1];
-    WGPURenderPassDescriptor render_pass_descriptor;
-  } render_pass = {
-    .color_attachment[0]= (WGPURenderPassColorAttachment) {
-        .view       = NULL,
-        .loadOp     = WGPULoadOp_Clear,
-        .storeOp    = WGPUStoreOp_Store,
-        .clearColor = (WGPUColor) {
-          .r = 0.0f,
-          .g = 0.0f,
-          .b = 0.2f,
-          .a = 0.0f,
-        },
-     },
-  };
-  render_pass.render_pass_descriptor = (WGPURenderPassDescriptor){
-    .colorAttachmentCount   = 1,
-    .colorAttachments       = render_pass.color_attachment,
-    .depthStencilAttachment = NULL,
-  };
-
-  // Render
-  {
-    wgpu_context->cmd_enc
-      = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-
-    uint32_t idx         = 0;
-    float viewport_width = 0.0f, viewport_height = 0.0f;
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      viewport_width  = (float)(dim * pow(0.5f, m));
-      viewport_height = (float)(dim * pow(0.5f, m));
-      for (uint32_t f = 0; f < 6; ++f) {
-        render_pass.color_attachment[0].view
-          = offscreen.texture_views[(f * num_mips) + m];
-        idx = (m * 6) + f;
-        // Render scene from cube face's point of view
-        wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-          wgpu_context->cmd_enc, &render_pass.render_pass_descriptor);
-        wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                         viewport_width, viewport_height, 0.0f,
-                                         1.0f);
-        wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                            (uint32_t)viewport_width,
-                                            (uint32_t)viewport_height);
-        wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
-        // Calculate the dynamic offsets
-        uint32_t dynamic_offset     = idx * (uint32_t)ALIGNMENT;
-        uint32_t dynamic_offsets[2] = {dynamic_offset, dynamic_offset};
-        // Bind the bind group for rendering a mesh using the dynamic offset
-        wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                          bind_group, 2, dynamic_offsets);
-        // Draw object
-        wgpu_gltf_model_draw(models.skybox,
-                             (wgpu_gltf_model_render_options_t){0});
-        // End render pass
-        wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-        WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-      }
-    }
-
-    // Copy region for transfer from framebuffer to cube face
-    for (uint32_t m = 0; m < num_mips; ++m) {
-      WGPUExtent3D copy_size = (WGPUExtent3D){
-        .width              = (float)(dim * pow(0.5f, m)),
-        .height             = (float)(dim * pow(0.5f, m)),
-        .depthOrArrayLayers = array_layer_count,
-      };
-      wgpuCommandEncoderCopyTextureToTexture(
-        wgpu_context->cmd_enc,
-        // source
-        &(WGPUImageCopyTexture){
-          .texture  = offscreen.texture,
-          .mipLevel = m,
-        },
-        // destination
-        &(WGPUImageCopyTexture){
-          .texture  = textures.prefiltered_cube.texture,
-          .mipLevel = m,
-        },
-        // copySize
-        &copy_size);
-    }
-
-    WGPUCommandBuffer command_buffer
-      = wgpuCommandEncoderFinish(wgpu_context->cmd_enc, NULL);
-    ASSERT(command_buffer != NULL);
-    WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
-
-    // Sumbit commmand buffer and cleanup
-    wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
-    WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
-  }
-
-  // Cleanup
-  WGPU_RELEASE_RESOURCE(Texture, offscreen.texture)
-  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(offscreen.texture_views); ++i) {
-    WGPU_RELEASE_RESOURCE(TextureView, offscreen.texture_views[i])
-  }
-  WGPU_RELEASE_RESOURCE(Buffer, prefiltered_cube_ubos.vs.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, prefiltered_cube_ubos.fs.buffer)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
-  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+  load_environment_cube(context->wgpu_context);
 }
 
-static void update_uniform_buffers(wgpu_example_context_t* context)
+static void prepare_brdf_lut_task(wgpu_example_context_t* context)
 {
-  // 3D object
-  camera_t* camera = context->camera;
-  glm_mat4_copy(camera->matrices.perspective, ubo_matrices.projection);
-  glm_mat4_copy(camera->matrices.view, ubo_matrices.view);
-  glm_mat4_identity(ubo_matrices.model);
-  glm_rotate(ubo_matrices.model,
-             glm_rad(-90.0f + (models.object_index == 1 ? 45.0f : 0.0f)),
-             (vec3){0.0f, 1.0f, 0.0f});
-  glm_vec3_scale(camera->position, -1.0f, ubo_matrices.cam_pos);
-  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.object.buffer,
-                          0, &ubo_matrices, uniform_buffers.object.size);
-
-  // Skybox
-  mat3 mat3_tmp = GLM_MAT3_ZERO_INIT;
-  glm_mat4_pick3(camera->matrices.view, mat3_tmp);
-  glm_mat4_ins3(mat3_tmp, ubo_matrices.model);
-  ubo_matrices.model[3][3] = 1.0f;
-  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffers.skybox.buffer,
-                          0, &ubo_matrices, uniform_buffers.skybox.size);
+  prepare_ibl_texture(context->wgpu_context, 0);
 }
 
-static void update_dynamic_uniform_buffer(wgpu_context_t* wgpu_context)
+static void prepare_irradiance_cube_task(wgpu_example_context_t* context)
 {
-  // Set objects positions and material properties
-  uint32_t obj_count = (uint32_t)SINGLE_ROW_OBJECT_COUNT;
-  for (uint32_t x = 0; x < obj_count; ++x) {
-    // Set object position
-    vec3* pos = &object_params_dynamic[x].position;
-    glm_vec3_copy((vec3){((float)(x - (obj_count / 2.0f))) * 2.15f, 0.0f, 0.0f},
-                  *pos);
-    // Set material metallic and roughness properties
-    struct matrial_params_dynamic_t* mat_params = &material_params_dynamic[x];
-    mat_params->roughness
-      = 1.0f - glm_clamp((float)x / (float)obj_count, 0.005f, 1.0f);
-    mat_params->metallic = glm_clamp((float)x / (float)obj_count, 0.005f, 1.0f);
-    glm_vec3_copy(materials[current_material_index].params.color,
-                  (*mat_params).color);
-  }
-
-  // Update buffers
-  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.object_params.buffer, 0,
-                          &object_params_dynamic,
-                          uniform_buffers.object_params.buffer_size);
-  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.material_params.buffer,
-                          0, &material_params_dynamic,
-                          uniform_buffers.material_params.buffer_size);
+  prepare_ibl_texture(context->wgpu_context, 1);
 }
 
-static void update_params(wgpu_context_t* wgpu_context)
+static void prepare_prefiltered_cube_task(wgpu_example_context_t* context)
 {
-  const float p = 15.0f;
-  glm_vec4_copy((vec4){-p, -p * 0.5f, -p, 1.0f}, ubo_params.lights[0]);
-  glm_vec4_copy((vec4){-p, -p * 0.5f, p, 1.0f}, ubo_params.lights[1]);
-  glm_vec4_copy((vec4){p, -p * 0.5f, p, 1.0f}, ubo_params.lights[2]);
-  glm_vec4_copy((vec4){p, -p * 0.5f, -p, 1.0f}, ubo_params.lights[3]);
-
-  wgpu_queue_write_buffer(wgpu_context, uniform_buffers.ubo_params.buffer, 0,
-                          &ubo_params, uniform_buffers.ubo_params.size);
+  prepare_ibl_texture(context->wgpu_context, 2);
 }
 
-// Prepare and initialize uniform buffer containing shader uniforms
-static void prepare_uniform_buffers(wgpu_example_context_t* context)
+static void prepare_pipelines_task(wgpu_example_context_t* context)
 {
-  // Object vertex shader uniform buffer
-  uniform_buffers.object = wgpu_create_buffer(
-    context->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(ubo_matrices),
-    });
-
-  // Skybox vertex shader uniform buffer
-  uniform_buffers.skybox = wgpu_create_buffer(
-    context->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(ubo_matrices),
-    });
-
-  // Shared parameter uniform buffer
-  uniform_buffers.ubo_params = wgpu_create_buffer(
-    context->wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(ubo_params),
-    });
-
-  // Material parameter uniform buffer
-  {
-    uniform_buffers.material_params.model_size = sizeof(vec3) + sizeof(vec3);
-    uniform_buffers.material_params.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(material_params_dynamic));
-    WGPUBufferDescriptor ubo_desc = {
-      .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size             = uniform_buffers.material_params.buffer_size,
-      .mappedAtCreation = false,
-    };
-    uniform_buffers.material_params.buffer
-      = wgpuDeviceCreateBuffer(context->wgpu_context->device, &ubo_desc);
-  }
-
-  // Object parameter uniform buffer
-  {
-    uniform_buffers.object_params.model_size = sizeof(vec3);
-    uniform_buffers.object_params.buffer_size
-      = calc_constant_buffer_byte_size(sizeof(object_params_dynamic));
-    WGPUBufferDescriptor ubo_desc = {
-      .usage            = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size             = uniform_buffers.object_params.buffer_size,
-      .mappedAtCreation = false,
-    };
-    uniform_buffers.object_params.buffer
-      = wgpuDeviceCreateBuffer(context->wgpu_context->device, &ubo_desc);
-  }
-
-  update_uniform_buffers(context);
-  update_dynamic_uniform_buffer(context->wgpu_context);
-  update_params(context->wgpu_context);
+  prepare_uniform_buffers(context);
+  setup_bind_group_layouts(context->wgpu_context);
+  setup_pipeline_layouts(context->wgpu_context);
+  prepare_pipelines(context->wgpu_context);
+  setup_bind_groups(context->wgpu_context);
+  setup_render_pass(context->wgpu_context);
+  prepared = true;
 }
 
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     setup_camera(context);
-    load_assets(context->wgpu_context);
-    generate_brdf_lut(context->wgpu_context);
-    generate_irradiance_cube(context->wgpu_context);
-    generate_prefiltered_cube(context->wgpu_context);
-    prepare_uniform_buffers(context);
-    setup_bind_group_layouts(context->wgpu_context);
-    setup_pipeline_layouts(context->wgpu_context);
-    prepare_pipelines(context->wgpu_context);
-    setup_bind_groups(context->wgpu_context);
-    setup_render_pass(context->wgpu_context);
-    prepared = true;
+    // Everything else loads over the first frames
+    example_queue_load_task(context, "models", load_models_task);
+    example_queue_load_task(context, "environment cube", load_environment_task);
+    example_queue_load_task(context, "BRDF LUT", prepare_brdf_lut_task);
+    example_queue_load_task(context, "irradiance cube",
+                            prepare_irradiance_cube_task);
+    example_queue_load_task(context, "prefiltered cube",
+                            prepare_prefiltered_cube_task);
+    example_queue_load_task(context, "pipelines", prepare_pipelines_task);
     return 0;
   }
 
@@ -2050,6 +1300,26 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
   }
 }
 
+// Orders the objects by the distance of their positions to the camera
+static void sort_objects_front_to_back(uint32_t* draw_order)
+{
+  float distances[SINGLE_ROW_OBJECT_COUNT];
+  for (uint32_t i = 0; i < (uint32_t)SINGLE_ROW_OBJECT_COUNT; ++i) {
+    distances[i]  = glm_vec3_distance2(object_params_dynamic[i].position,
+                                       ubo_matrices.cam_pos);
+    draw_order[i] = i;
+  }
+  // Insertion sort, the row is short
+  for (uint32_t i = 1; i < (uint32_t)SINGLE_ROW_OBJECT_COUNT; ++i) {
+    const uint32_t object = draw_order[i];
+    uint32_t j            = i;
+    for (; j > 0 && distances[draw_order[j - 1]] > distances[object]; --j) {
+      draw_order[j] = draw_order[j - 1];
+    }
+    draw_order[j] = object;
+  }
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   // Set target frame buffer
@@ -2073,6 +1343,22 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
+  // Depth pre-pass of the objects, front-to-back
+  {
+    uint32_t draw_order[SINGLE_ROW_OBJECT_COUNT];
+    sort_objects_front_to_back(draw_order);
+    for (uint32_t i = 0; i < (uint32_t)SINGLE_ROW_OBJECT_COUNT; ++i) {
+      uint32_t dynamic_offset     = draw_order[i] * (uint32_t)ALIGNMENT;
+      uint32_t dynamic_offsets[2] = {dynamic_offset, dynamic_offset};
+      wgpuRenderPassEncoderSetBindGroup(
+        wgpu_context->rpass_enc, 0, bind_groups.objects, 2, dynamic_offsets);
+      wgpu_gltf_model_draw(models.objects[models.object_index].object,
+                           (wgpu_gltf_model_render_options_t){
+                             .render_flags = WGPU_GLTF_RenderFlags_DepthOnly,
+                           });
+    }
+  }
+
   // Skybox
   if (display_skybox) {
     wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.skybox);
@@ -2152,6 +1438,7 @@ static void example_destroy(wgpu_example_context_t* context)
   wgpu_destroy_texture(&textures.lut_brdf);
   wgpu_destroy_texture(&textures.irradiance_cube);
   wgpu_destroy_texture(&textures.prefiltered_cube);
+  wgpu_texture_compressor_destroy(texture_compressor);
   wgpu_gltf_model_destroy(models.skybox);
   for (uint8_t i = 0; i < (uint8_t)ARRAY_SIZE(models.objects); ++i) {
     wgpu_gltf_model_destroy(models.objects[i].object);
@@ -2171,8 +1458,45 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.skybox)
 }
 
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]   = {"--environment="};
+  char* filters_flag[1] = {"--help-pbr-ibl"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option options[] = {
+    OPT_STRING(0, "environment", &environment_file,
+               "equirectangular environment image (.hdr), converted into the "
+               "environment cube map",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-pbr-ibl", NULL, "show the PBR IBL options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+}
+
 void example_pbr_ibl(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
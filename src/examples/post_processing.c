@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "../webgpu/hiz_culling.h"
 #include "../webgpu/imgui_overlay.h"
 #include "../webgpu/texture.h"
 
@@ -20,7 +21,10 @@
  * Global variables
  * -------------------------------------------------------------------------- */
 
-#define INSTANCES_COUNT 500u
+/* Instance counts, the instance scale shrinks with the count to keep the
+ * density of the first one */
+static const uint32_t instance_counts[4] = {500u, 10000u, 100000u, 1000000u};
+static const char* instance_count_names[4] = {"500", "10K", "100K", "1M"};
 #define WORLD_SIZE_X 20u
 #define WORLD_SIZE_Y 20u
 #define WORLD_SIZE_Z 20u
@@ -300,11 +304,6 @@ typedef struct {
   } indices;
 } geometry_t;
 
-typedef struct {
-  float model_matrix_data[INSTANCES_COUNT * 16];
-  float normal_matrix_data[INSTANCES_COUNT * 16];
-} instanced_geometry_t;
-
 static void geometry_destroy(geometry_t* geometry)
 {
   if ((geometry->positions.data != NULL) && geometry->positions.data_size > 0) {
@@ -786,66 +785,6 @@ geometry_gpu_buffers_destroy(geometry_gpu_buffers_t* geometry_gpu_buffers)
   WGPU_RELEASE_RESOURCE(Buffer, geometry_gpu_buffers->indices.buffer)
 }
 
-typedef struct {
-  wgpu_buffer_t model_matrix;
-  wgpu_buffer_t normal_matrix;
-} instanced_geometry_gpu_buffers_t;
-
-static void instanced_geometry_gpu_buffers_destroy(
-  instanced_geometry_gpu_buffers_t* instanced_geometry_gpu_buffers)
-{
-  WGPU_RELEASE_RESOURCE(Buffer,
-                        instanced_geometry_gpu_buffers->model_matrix.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer,
-                        instanced_geometry_gpu_buffers->normal_matrix.buffer)
-}
-
-typedef void (*generate_instance_on_item_callback)(vec3* position,
-                                                   vec3* rotation, vec3* scale,
-                                                   bool scale_uniformly);
-
-static instanced_geometry_t*
-generate_instance_matrices(instanced_geometry_t* instanced_model,
-                           generate_instance_on_item_callback on_item_callback,
-                           bool scale_uniformly)
-{
-  uint32_t count = ARRAY_SIZE(instanced_model->model_matrix_data) / 16;
-  vec3 instance_move_vector  = GLM_VEC3_ZERO_INIT;
-  mat4 instance_model_matrix = GLM_MAT4_ZERO_INIT,
-       normal_matrix         = GLM_MAT4_ZERO_INIT;
-  vec3 position = GLM_VEC3_ZERO_INIT, rotation = GLM_VEC3_ZERO_INIT,
-       scale = GLM_VEC3_ZERO_INIT;
-  uint32_t r = 0, c = 0;
-  for (uint32_t i = 0; i < count * 16; i += 16) {
-    on_item_callback(&position, &rotation, &scale, scale_uniformly);
-
-    glm_mat4_identity(instance_model_matrix);
-    glm_vec3_copy((vec3){position[0], position[1], position[2]},
-                  instance_move_vector);
-
-    glm_translate(instance_model_matrix, instance_move_vector);
-    glm_rotate(instance_model_matrix, rotation[0], (vec3){1.0f, 0.0f, 0.0f});
-    glm_rotate(instance_model_matrix, rotation[1], (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(instance_model_matrix, rotation[2], (vec3){0.0f, 0.0f, 1.0f});
-
-    glm_vec3_copy((vec3){scale[0], scale[1], scale[2]}, instance_move_vector);
-    glm_scale(instance_model_matrix, instance_move_vector);
-
-    glm_mat4_inv(instance_model_matrix, normal_matrix);
-    glm_mat4_transpose(normal_matrix);
-
-    for (uint32_t n = 0; n < 16; ++n) {
-      r = n / 4;
-      c = n % 4;
-
-      instanced_model->model_matrix_data[i + n]  = instance_model_matrix[r][c];
-      instanced_model->normal_matrix_data[i + n] = normal_matrix[r][c];
-    }
-  }
-
-  return instanced_model;
-}
-
 static void
 generate_gpu_buffers_from_geometry(wgpu_context_t* wgpu_context,
                                    geometry_t* geometry,
@@ -887,25 +826,241 @@ generate_gpu_buffers_from_geometry(wgpu_context_t* wgpu_context,
                   });
 }
 
-static void generate_gpu_buffers_from_instanced_geometry(
-  wgpu_context_t* wgpu_context, instanced_geometry_t* geometry,
-  instanced_geometry_gpu_buffers_t* gpu_buffers)
-{
-  /* Instance model matrix */
-  gpu_buffers->model_matrix = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-                    .size  = sizeof(geometry->model_matrix_data),
-                    .initial.data = geometry->model_matrix_data,
-                  });
+/* -------------------------------------------------------------------------- *
+ * GPU instances
+ *
+ * The instances are generated by a compute shader into a storage buffer of
+ * compact records, which the vertex shader expands into the world transform:
+ *
+ *   struct Instance {
+ *     position : vec3<f32>,
+ *     spin     : f32,       // angular velocity around the y axis (rad/s)
+ *     rotation : vec2<u32>, // quaternion, 4 x snorm16
+ *     scale    : vec2<u32>, // xyz scale, 3 x f16 (+ padding)
+ *   }
+ *
+ * 32 bytes per instance instead of a model and a normal matrix (128 bytes),
+ * nothing is computed or uploaded per instance on the CPU.
+ *
+ * The generation also writes the world space bounds of the instances, which
+ * are culled against the view frustum and the depth pyramid of the previous
+ * frame (see hiz_culling.h). The visible instances are drawn with an indirect
+ * draw and indexed through the visible list.
+ * -------------------------------------------------------------------------- */
 
-  /* Instance model matrix */
-  gpu_buffers->normal_matrix = wgpu_create_buffer(
-    wgpu_context, &(wgpu_buffer_desc_t){
-                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-                    .size  = sizeof(geometry->normal_matrix_data),
-                    .initial.data = geometry->normal_matrix_data,
-                  });
+#define INSTANCE_SIZE 32u
+#define INSTANCE_WORKGROUP_SIZE 64u
+
+// clang-format off
+static const char* instance_generation_shader_wgsl = CODE(
+  struct Instance {
+    position : vec3<f32>,
+    spin : f32,
+    rotation : vec2<u32>,
+    scale : vec2<u32>
+  }
+
+  struct Generation {
+    worldSize : vec3<f32>,
+    count : u32,
+    seed : u32,
+    scale : f32,
+    boundingRadius : f32
+  }
+
+  struct HizObject {
+    aabbMin : vec3<f32>,
+    drawIndex : u32,
+    aabbMax : vec3<f32>,
+    visibleIndex : u32
+  }
+
+  @group(0) @binding(0) var<uniform> generation : Generation;
+  @group(0) @binding(1) var<storage, read_write> instances : array<Instance>;
+  @group(0) @binding(2) var<storage, read_write> objects : array<HizObject>;
+
+  const TAU = 6.28318530718;
+
+  fn hash(value : u32) -> u32 {
+    let state = value * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  fn random(state : ptr<function, u32>) -> f32 {
+    *state = hash(*state);
+    return f32(*state) / 4294967295.0;
+  }
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let index = global_id.x;
+    if (index >= generation.count) {
+      return;
+    }
+
+    var state = hash(index ^ hash(generation.seed));
+    let position = vec3<f32>(random(&state), random(&state), random(&state));
+
+    // Uniformly distributed orientation (Shoemake)
+    let u = vec3<f32>(random(&state), random(&state), random(&state));
+    let rotation = vec4<f32>(sqrt(1.0 - u.x) * sin(TAU * u.y),
+                             sqrt(1.0 - u.x) * cos(TAU * u.y),
+                             sqrt(u.x) * sin(TAU * u.z),
+                             sqrt(u.x) * cos(TAU * u.z));
+
+    let scale = (vec3<f32>(random(&state), random(&state), random(&state))
+                 + 0.25) * generation.scale;
+
+    var item : Instance;
+    item.position = (position * 2.0 - 1.0) * generation.worldSize;
+    item.spin = random(&state) * 2.0 - 1.0;
+    item.rotation = vec2<u32>(pack2x16snorm(rotation.xy),
+                              pack2x16snorm(rotation.zw));
+    item.scale = vec2<u32>(pack2x16float(scale.xy),
+                           pack2x16float(vec2<f32>(scale.z, 0.0)));
+    instances[index] = item;
+
+    // Bounds of any orientation, from the scale as unpacked by the vertex
+    // shader
+    let packedScale = vec3<f32>(unpack2x16float(item.scale.x),
+                                unpack2x16float(item.scale.y).x);
+    let radius = generation.boundingRadius
+                 * max(max(packedScale.x, packedScale.y), packedScale.z);
+    var object : HizObject;
+    object.aabbMin = item.position - vec3<f32>(radius);
+    object.drawIndex = 0u;
+    object.aabbMax = item.position + vec3<f32>(radius);
+    object.visibleIndex = index;
+    objects[index] = object;
+  }
+);
+
+static const char* instanced_vertex_shader_wgsl = CODE(
+  struct Camera {
+    projectionMatrix : mat4x4<f32>,
+    viewMatrix : mat4x4<f32>
+  }
+
+  struct Instance {
+    position : vec3<f32>,
+    spin : f32,
+    rotation : vec2<u32>,
+    scale : vec2<u32>
+  }
+
+  struct Animation {
+    time : f32
+  }
+
+  @group(0) @binding(0) var<uniform> camera : Camera;
+  @group(3) @binding(0) var<storage, read> instances : array<Instance>;
+  @group(3) @binding(1) var<uniform> animation : Animation;
+  @group(3) @binding(2) var<storage, read> visible : array<u32>;
+
+  struct Output {
+    @builtin(position) Position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+    @location(1) pos : vec3<f32>
+  }
+
+  fn quatMul(a : vec4<f32>, b : vec4<f32>) -> vec4<f32> {
+    return vec4<f32>(a.w * b.xyz + b.w * a.xyz + cross(a.xyz, b.xyz),
+                     a.w * b.w - dot(a.xyz, b.xyz));
+  }
+
+  fn quatRotate(q : vec4<f32>, v : vec3<f32>) -> vec3<f32> {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+  }
+
+  @vertex
+  fn main(@builtin(instance_index) instanceIndex : u32,
+          @location(0) position : vec3<f32>,
+          @location(1) normal : vec3<f32>) -> Output {
+    let item = instances[visible[instanceIndex]];
+
+    // Spin around the world y axis on top of the generated orientation
+    let angle = 0.5 * item.spin * animation.time;
+    let spinRotation = vec4<f32>(0.0, sin(angle), 0.0, cos(angle));
+    let rotation = quatMul(spinRotation, normalize(vec4<f32>(
+      unpack2x16snorm(item.rotation.x), unpack2x16snorm(item.rotation.y))));
+    let scale = vec3<f32>(unpack2x16float(item.scale.x),
+                          unpack2x16float(item.scale.y).x);
+
+    let worldPosition = item.position + quatRotate(rotation, position * scale);
+
+    var output : Output;
+    output.Position = camera.projectionMatrix * camera.viewMatrix
+                      * vec4<f32>(worldPosition, 1.0);
+    // Inverse transpose of the rotation and scale
+    output.normal = quatRotate(rotation, normal / scale);
+    output.pos = worldPosition;
+    return output;
+  }
+);
+
+static const char* instanced_fragment_shader_wgsl = CODE(
+  struct Lighting {
+    position : vec3<f32>
+  }
+
+  struct Material {
+    baseColor : vec3<f32>
+  }
+
+  @group(1) @binding(0) var<uniform> lighting : Lighting;
+  @group(2) @binding(0) var<uniform> material : Material;
+
+  @fragment
+  fn main(@location(0) normal : vec3<f32>,
+          @location(1) pos : vec3<f32>) -> @location(0) vec4<f32> {
+    let lightColor = vec3<f32>(1.0);
+    let ambientLight = lightColor * 0.1;
+    let lightDirection = normalize(lighting.position - pos);
+    let diffuseLight
+      = lightColor * max(dot(normalize(normal), lightDirection), 0.0);
+    return vec4<f32>(material.baseColor * (diffuseLight + ambientLight), 1.0);
+  }
+);
+// clang-format on
+
+/* Matches the Generation struct of the instance generation shader */
+typedef struct {
+  float world_size[3];
+  uint32_t count;
+  uint32_t seed;
+  float scale;
+  float bounding_radius;
+  float padding;
+} instance_generation_t;
+
+typedef struct {
+  WGPUBuffer instances;
+  uint32_t count;
+  wgpu_buffer_t generation;
+  WGPUBindGroup generation_bind_group;
+  WGPUBindGroup bind_group; /* Instances and animation of the scene pipeline */
+  /* Occlusion culling of the instances into a single indirect draw */
+  WGPUBuffer objects;
+  WGPUBuffer draw;
+  WGPUBuffer visible;
+  wgpu_hiz_cull_list_t* cull_list;
+} instanced_geometry_gpu_buffers_t;
+
+static void instanced_geometry_gpu_buffers_destroy(
+  instanced_geometry_gpu_buffers_t* instanced_geometry_gpu_buffers)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup,
+                        instanced_geometry_gpu_buffers->generation_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instanced_geometry_gpu_buffers->bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, instanced_geometry_gpu_buffers->instances)
+  WGPU_RELEASE_RESOURCE(Buffer,
+                        instanced_geometry_gpu_buffers->generation.buffer)
+  wgpu_hiz_cull_list_destroy(instanced_geometry_gpu_buffers->cull_list);
+  instanced_geometry_gpu_buffers->cull_list = NULL;
+  WGPU_RELEASE_RESOURCE(Buffer, instanced_geometry_gpu_buffers->objects)
+  WGPU_RELEASE_RESOURCE(Buffer, instanced_geometry_gpu_buffers->draw)
+  WGPU_RELEASE_RESOURCE(Buffer, instanced_geometry_gpu_buffers->visible)
 }
 
 /* -------------------------------------------------------------------------- *
@@ -914,12 +1069,17 @@ static void generate_gpu_buffers_from_instanced_geometry(
 
 static struct {
   bool animatable;
+  bool animate_instances;
+  bool occlusion_culling;
+  int32_t instance_count_index;
   float tween_factor;
   float tween_factor_target;
   vec3 light_position;
   vec3 base_colors[2];
 } options = {
   .animatable          = true,
+  .animate_instances   = true,
+  .occlusion_culling   = true,
   .tween_factor        = 0.0f,
   .tween_factor_target = 0.0f,
   .light_position      = {0.5f, 0.5f, 0.50f},
@@ -940,11 +1100,6 @@ static struct {
   geometry_t sphere;
 } geometries = {0};
 
-static struct {
-  instanced_geometry_t cube;
-  instanced_geometry_t sphere;
-} instanced_geometries = {0};
-
 static struct {
   geometry_gpu_buffers_t quad;
   geometry_gpu_buffers_t cube;
@@ -988,8 +1143,22 @@ static struct {
 static struct {
   WGPURenderPipeline fullscreen_quad;
   WGPURenderPipeline scene_meshes;
+  WGPUComputePipeline instance_generation;
 } pipelines = {0};
 
+/* Instance animation, the time only advances while animated */
+static struct {
+  wgpu_buffer_t buffer;
+  float time;
+  bool generation_pending; /* Generation is recorded with the next frame */
+} instance_animation = {0};
+
+/* Depth pyramids of the cubes and spheres scenes */
+static struct {
+  wgpu_hiz_culling_t* hiz[2];
+  mat4 view_projection;
+} occlusion_culling = {0};
+
 // Render pass descriptor for frame buffer writes
 typedef struct {
   WGPURenderPassColorAttachment color_attachments[1];
@@ -1012,22 +1181,6 @@ static struct {
 static const char* example_title = "Post-processing";
 static bool prepared             = false;
 
-static void get_rand_position_scale_rotation(vec3* position, vec3* rotation,
-                                             vec3* scale, bool scale_uniformly)
-{
-  (*position)[0] = (random_float() * 2.0f - 1.0f) * WORLD_SIZE_X;
-  (*position)[1] = (random_float() * 2.0f - 1.0f) * WORLD_SIZE_Y;
-  (*position)[2] = (random_float() * 2.0f - 1.0f) * WORLD_SIZE_Z;
-
-  (*rotation)[0] = random_float() * PI2;
-  (*rotation)[1] = random_float() * PI2;
-  (*rotation)[2] = random_float() * PI2;
-
-  (*scale)[0] = random_float() + 0.25f;
-  (*scale)[1] = scale_uniformly ? (*scale)[0] : random_float() + 0.25f;
-  (*scale)[2] = scale_uniformly ? (*scale)[0] : random_float() + 0.25f;
-}
-
 // Set up cameras for the demo
 static void setup_cameras(wgpu_example_context_t* context)
 {
@@ -1073,24 +1226,10 @@ static void prepare_geometries(wgpu_context_t* wgpu_context)
   generate_gpu_buffers_from_geometry(
     wgpu_context, create_box(&geometries.cube, NULL), &vertex_buffers.cube);
 
-  /* Prepare instanced cube model matrices as gpu buffers */
-  generate_gpu_buffers_from_instanced_geometry(
-    wgpu_context,
-    generate_instance_matrices(&instanced_geometries.cube,
-                               get_rand_position_scale_rotation, false),
-    &vertex_buffers.instanced_cube);
-
   /* Prepare sphere gpu buffers */
   generate_gpu_buffers_from_geometry(wgpu_context,
                                      create_sphere(&geometries.sphere, NULL),
                                      &vertex_buffers.sphere);
-
-  /* Prepare instanced sphere model matrices as gpu buffers */
-  generate_gpu_buffers_from_instanced_geometry(
-    wgpu_context,
-    generate_instance_matrices(&instanced_geometries.sphere,
-                               get_rand_position_scale_rotation, false),
-    &vertex_buffers.instanced_sphere);
 }
 
 static void update_tween_factor(wgpu_context_t* wgpu_context)
@@ -1130,6 +1269,9 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
     context->wgpu_context, uniform_buffers.persp_camera.buffer,
     16 * sizeof(float), cameras.perspective_camera.view_matrix,
     sizeof(cameras.perspective_camera.view_matrix));
+  glm_mat4_mul(cameras.perspective_camera.projection_matrix,
+               cameras.perspective_camera.view_matrix,
+               occlusion_culling.view_projection);
 
   /* Write ortho camera projection and view matrix to uniform block */
   wgpu_queue_write_buffer(
@@ -1154,6 +1296,14 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
       += (options.tween_factor_target - options.tween_factor) * (dt * 2.0f);
   }
   update_tween_factor(context->wgpu_context);
+
+  /* Write instance animation time */
+  if (options.animate_instances) {
+    instance_animation.time += dt;
+  }
+  wgpu_queue_write_buffer(context->wgpu_context,
+                          instance_animation.buffer.buffer, 0,
+                          &instance_animation.time, sizeof(float));
 }
 
 static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
@@ -1206,6 +1356,14 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
         .initial.data = options.base_colors[i],
       });
   }
+
+  /* Instance animation uniform block */
+  instance_animation.buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(instance_animation.time),
+                    .initial.data = &instance_animation.time,
+                  });
 }
 
 static void prepare_offscreen_framebuffer(wgpu_context_t* wgpu_context)
@@ -1254,7 +1412,8 @@ static void prepare_offscreen_framebuffer(wgpu_context_t* wgpu_context)
       .sampleCount   = 1,
       .dimension     = WGPUTextureDimension_2D,
       .format        = WGPUTextureFormat_Depth24PlusStencil8,
-      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc
+               | WGPUTextureUsage_TextureBinding,
     };
     offscreen_framebuffer.depth_stencil.texture
       = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
@@ -1516,7 +1675,7 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
             wgpu_context->device,
             &(WGPUBindGroupDescriptor) {
              .layout = wgpuRenderPipelineGetBindGroupLayout(
-               pipelines.scene_meshes, i + 1),
+               pipelines.scene_meshes, 2),
              .entryCount = 1,
              .entries    = &(WGPUBindGroupEntry) {
                .binding = 0,
@@ -1721,7 +1880,7 @@ static void prepare_instanced_meshes_pipeline(wgpu_context_t* wgpu_context)
   depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
 
   // Vertex buffer layout
-  WGPUVertexBufferLayout instanced_meshes_vertex_buffer_layouts[4] = {0};
+  WGPUVertexBufferLayout instanced_meshes_vertex_buffer_layouts[2] = {0};
 
   WGPUVertexAttribute attribute_0 = {
     // Shader location 0 : position attribute
@@ -1749,68 +1908,6 @@ static void prepare_instanced_meshes_pipeline(wgpu_context_t* wgpu_context)
     .attributes     = &attribute_1,
   };
 
-  // We need to pass the mat4x4<f32> instance world matrix as 4 vec4<f32>()
-  // components It will occupy 4 input slots
-  WGPUVertexAttribute attributes_2[4] = {
-       [0] = (WGPUVertexAttribute) {
-         .shaderLocation = 2,
-         .offset         = 0 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [1] = (WGPUVertexAttribute) {
-         .shaderLocation = 3,
-         .offset         = 4 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [2] = (WGPUVertexAttribute) {
-         .shaderLocation = 4,
-         .offset         = 8 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [3] = (WGPUVertexAttribute) {
-         .shaderLocation = 5,
-         .offset         = 12 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       }
-     };
-  instanced_meshes_vertex_buffer_layouts[2] = (WGPUVertexBufferLayout){
-    .arrayStride    = 16 * sizeof(float),
-    .stepMode       = WGPUVertexStepMode_Instance,
-    .attributeCount = (uint32_t)ARRAY_SIZE(attributes_2),
-    .attributes     = attributes_2,
-  };
-
-  // We need to pass the mat4x4<f32> instance normal matrix as 4 vec4<f32>()
-  // components It will occupy 4 input slots
-  WGPUVertexAttribute attributes_3[4] = {
-       [0] = (WGPUVertexAttribute) {
-         .shaderLocation = 6,
-         .offset         = 0 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [1] = (WGPUVertexAttribute) {
-         .shaderLocation = 7,
-         .offset         = 4 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [2] = (WGPUVertexAttribute) {
-         .shaderLocation = 8,
-         .offset         = 8 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       },
-       [3] = (WGPUVertexAttribute) {
-         .shaderLocation = 9,
-         .offset         = 12 * sizeof(float),
-         .format         = WGPUVertexFormat_Float32x4,
-       }
-     };
-  instanced_meshes_vertex_buffer_layouts[3] = (WGPUVertexBufferLayout){
-    .arrayStride    = 16 * sizeof(float),
-    .stepMode       = WGPUVertexStepMode_Instance,
-    .attributeCount = (uint32_t)ARRAY_SIZE(attributes_3),
-    .attributes     = attributes_3,
-  };
-
   // Vertex state
   const uint32_t buffer_count
     = (uint32_t)ARRAY_SIZE(instanced_meshes_vertex_buffer_layouts);
@@ -1818,9 +1915,9 @@ static void prepare_instanced_meshes_pipeline(wgpu_context_t* wgpu_context)
               wgpu_context, &(wgpu_vertex_state_t){
               .shader_desc = (wgpu_shader_desc_t){
                 // Vertex shader WGSL
-                .label = "instanced-shader_vertex_shader",
-                .file  = "shaders/post_processing/instanced-shader.vert.wgsl",
-                .entry = "main"
+                .label            = "instanced-shader_vertex_shader",
+                .wgsl_code.source = instanced_vertex_shader_wgsl,
+                .entry            = "main"
               },
               .buffer_count = buffer_count,
               .buffers      = instanced_meshes_vertex_buffer_layouts,
@@ -1831,9 +1928,9 @@ static void prepare_instanced_meshes_pipeline(wgpu_context_t* wgpu_context)
               wgpu_context, &(wgpu_fragment_state_t){
               .shader_desc = (wgpu_shader_desc_t){
                 // Fragment shader WGSL
-                .label = "instanced-shader_fragment_shader",
-                .file  = "shaders/post_processing/instanced-shader.frag.wgsl",
-                .entry = "main"
+                .label            = "instanced-shader_fragment_shader",
+                .wgsl_code.source = instanced_fragment_shader_wgsl,
+                .entry            = "main"
               },
               .target_count = 1,
               .targets      = &color_target_state,
@@ -1863,6 +1960,205 @@ static void prepare_instanced_meshes_pipeline(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+static void prepare_instance_generation_pipeline(wgpu_context_t* wgpu_context)
+{
+  wgpu_shader_t generation_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "instance_generation_shader",
+                    .wgsl_code.source = instance_generation_shader_wgsl,
+                    .entry            = "main",
+                  });
+
+  pipelines.instance_generation = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "instance_generation_pipeline",
+                    .compute = generation_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipelines.instance_generation != NULL);
+
+  // Partial cleanup
+  wgpu_shader_release(&generation_shader);
+}
+
+/* Creates the instance storage and bind groups of an instanced geometry, the
+ * instances are generated with the next recorded frame */
+static void prepare_instances(wgpu_context_t* wgpu_context,
+                              instanced_geometry_gpu_buffers_t* instanced,
+                              uint32_t count, uint32_t seed,
+                              uint32_t index_count, float bounding_radius,
+                              wgpu_hiz_culling_t* hiz)
+{
+  instanced_geometry_gpu_buffers_destroy(instanced);
+
+  instanced->count     = count;
+  instanced->instances = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "instances_buffer",
+                            .usage = WGPUBufferUsage_Storage,
+                            .size  = (uint64_t)count * INSTANCE_SIZE,
+                          });
+  ASSERT(instanced->instances != NULL);
+
+  /* Keep the instance volume constant, the baseline scale is 500 instances */
+  instance_generation_t generation = {
+    .world_size = {WORLD_SIZE_X, WORLD_SIZE_Y, WORLD_SIZE_Z},
+    .count      = count,
+    .seed       = seed,
+    .scale      = cbrtf((float)instance_counts[0] / (float)count),
+    .bounding_radius = bounding_radius,
+  };
+  instanced->generation = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(generation),
+                    .initial.data = &generation,
+                  });
+
+  /* Bounds, indirect draw and visible list of the occlusion culling */
+  instanced->objects = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "instance_bounds_buffer",
+                            .usage = WGPUBufferUsage_Storage,
+                            .size = (uint64_t)count * sizeof(wgpu_hiz_object_t),
+                          });
+  ASSERT(instanced->objects != NULL);
+  const uint32_t draw[5] = {index_count, count, 0, 0, 0};
+  instanced->draw        = wgpu_create_buffer_from_data(
+    wgpu_context, draw, sizeof(draw),
+    WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect);
+  instanced->visible = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "visible_instances_buffer",
+                            .usage = WGPUBufferUsage_Storage,
+                            .size  = (uint64_t)count * sizeof(uint32_t),
+                          });
+  ASSERT(instanced->visible != NULL);
+  instanced->cull_list = wgpu_hiz_cull_list_create(
+    hiz, &(wgpu_hiz_cull_list_desc_t){
+           .objects        = instanced->objects,
+           .object_count   = count,
+           .draws          = instanced->draw,
+           .draw_count     = 1,
+           .visible        = instanced->visible,
+           .visible_stride = count,
+         });
+
+  WGPUBindGroupEntry generation_bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = instanced->generation.buffer,
+      .size    = instanced->generation.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = instanced->instances,
+      .size    = (uint64_t)count * INSTANCE_SIZE,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = instanced->objects,
+      .size    = (uint64_t)count * sizeof(wgpu_hiz_object_t),
+    },
+  };
+  instanced->generation_bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout = wgpuComputePipelineGetBindGroupLayout(
+        pipelines.instance_generation, 0),
+      .entryCount = (uint32_t)ARRAY_SIZE(generation_bg_entries),
+      .entries    = generation_bg_entries,
+    });
+  ASSERT(instanced->generation_bind_group != NULL);
+
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = instanced->instances,
+      .size    = (uint64_t)count * INSTANCE_SIZE,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = instance_animation.buffer.buffer,
+      .size    = instance_animation.buffer.size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = instanced->visible,
+      .size    = (uint64_t)count * sizeof(uint32_t),
+    },
+  };
+  instanced->bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout = wgpuRenderPipelineGetBindGroupLayout(pipelines.scene_meshes, 3),
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(instanced->bind_group != NULL);
+
+  instance_animation.generation_pending = true;
+}
+
+static void prepare_instanced_geometries(wgpu_context_t* wgpu_context)
+{
+  const uint32_t count = instance_counts[options.instance_count_index];
+  /* Bounding radii of the unit cube and the sphere of radius 0.5 */
+  prepare_instances(wgpu_context, &vertex_buffers.instanced_cube, count, 1u,
+                    geometries.cube.indices.count, 0.8660254f,
+                    occlusion_culling.hiz[0]);
+  prepare_instances(wgpu_context, &vertex_buffers.instanced_sphere, count, 2u,
+                    geometries.sphere.indices.count, 0.5f,
+                    occlusion_culling.hiz[1]);
+}
+
+/* Culls the instances of a scene before its draw */
+static void record_instance_culling(instanced_geometry_gpu_buffers_t* instanced,
+                                    WGPUCommandEncoder cmd_enc)
+{
+  wgpu_hiz_cull_list_cull(instanced->cull_list, cmd_enc,
+                          occlusion_culling.view_projection);
+}
+
+/* Builds the depth pyramid of a scene after its draw, used by the next frame */
+static void record_depth_pyramid(wgpu_context_t* wgpu_context,
+                                 wgpu_hiz_culling_t* hiz)
+{
+  if (!options.occlusion_culling) {
+    return;
+  }
+  wgpu_hiz_culling_build(hiz, wgpu_context->cmd_enc,
+                         offscreen_framebuffer.depth_stencil.texture,
+                         wgpu_context->surface.width,
+                         wgpu_context->surface.height, 1,
+                         occlusion_culling.view_projection);
+}
+
+static void record_instance_generation(WGPUCommandEncoder cmd_enc)
+{
+  instanced_geometry_gpu_buffers_t* instanced[2] = {
+    &vertex_buffers.instanced_cube,
+    &vertex_buffers.instanced_sphere,
+  };
+
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, pipelines.instance_generation);
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(instanced); ++i) {
+    wgpuComputePassEncoderSetBindGroup(
+      cpass_enc, 0, instanced[i]->generation_bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      cpass_enc,
+      (instanced[i]->count + INSTANCE_WORKGROUP_SIZE - 1)
+        / INSTANCE_WORKGROUP_SIZE,
+      1, 1);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+
+  instance_animation.generation_pending = false;
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
@@ -1872,6 +2168,20 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                    &options.tween_factor, 0.0f, 1.0f)) {
       update_tween_factor(context->wgpu_context);
     }
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Instances",
+                                &options.instance_count_index,
+                                instance_count_names,
+                                (uint32_t)ARRAY_SIZE(instance_counts))) {
+      prepare_instanced_geometries(context->wgpu_context);
+    }
+    imgui_overlay_checkBox(context->imgui_overlay, "Animate instances",
+                           &options.animate_instances);
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Occlusion culling",
+                               &options.occlusion_culling)
+        && !options.occlusion_culling) {
+      wgpu_hiz_culling_invalidate(occlusion_culling.hiz[0]);
+      wgpu_hiz_culling_invalidate(occlusion_culling.hiz[1]);
+    }
   }
 }
 
@@ -1885,7 +2195,11 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_textures(context->wgpu_context);
     prepare_fullscreen_quad_pipeline(context->wgpu_context);
     prepare_instanced_meshes_pipeline(context->wgpu_context);
+    prepare_instance_generation_pipeline(context->wgpu_context);
+    occlusion_culling.hiz[0] = wgpu_hiz_culling_create(context->wgpu_context);
+    occlusion_culling.hiz[1] = wgpu_hiz_culling_create(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
+    prepare_instanced_geometries(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -1899,6 +2213,17 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  /* Generate the instances after creation or a change of the count */
+  if (instance_animation.generation_pending) {
+    record_instance_generation(wgpu_context->cmd_enc);
+  }
+
+  /* Cull both scenes against the depth pyramids of the previous frame */
+  record_instance_culling(&vertex_buffers.instanced_cube,
+                          wgpu_context->cmd_enc);
+  record_instance_culling(&vertex_buffers.instanced_sphere,
+                          wgpu_context->cmd_enc);
+
   // Set target frame buffer
   render_passes.scene_render.color_attachments[0].view
     = offscreen_framebuffer.color.texture_view;
@@ -1922,27 +2247,24 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       bind_groups.light_position, 0, 0);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 2,
                                       bind_groups.base_colors[0], 0, 0);
+    wgpuRenderPassEncoderSetBindGroup(
+      wgpu_context->rpass_enc, 3, vertex_buffers.instanced_cube.bind_group, 0,
+      0);
     wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
                                          vertex_buffers.cube.vertices.buffer, 0,
                                          WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 1,
                                          vertex_buffers.cube.normals.buffer, 0,
                                          WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 2,
-      vertex_buffers.instanced_cube.model_matrix.buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 3,
-      vertex_buffers.instanced_cube.normal_matrix.buffer, 0, WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetIndexBuffer(
       wgpu_context->rpass_enc, vertex_buffers.cube.indices.buffer,
       WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
-                                     geometries.cube.indices.count,
-                                     INSTANCES_COUNT, 0, 0, 0);
+    wgpuRenderPassEncoderDrawIndexedIndirect(
+      wgpu_context->rpass_enc, vertex_buffers.instanced_cube.draw, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
+  record_depth_pyramid(wgpu_context, occlusion_culling.hiz[0]);
 
   /**
    * Copy offscreen texture to another texture that will be outputted on the
@@ -1988,27 +2310,24 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       bind_groups.light_position, 0, 0);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 2,
                                       bind_groups.base_colors[1], 0, 0);
+    wgpuRenderPassEncoderSetBindGroup(
+      wgpu_context->rpass_enc, 3, vertex_buffers.instanced_sphere.bind_group, 0,
+      0);
     wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
                                          vertex_buffers.sphere.vertices.buffer,
                                          0, WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 1,
                                          vertex_buffers.sphere.normals.buffer,
                                          0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 2,
-      vertex_buffers.instanced_sphere.model_matrix.buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 3,
-      vertex_buffers.instanced_sphere.model_matrix.buffer, 0, WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetIndexBuffer(
       wgpu_context->rpass_enc, vertex_buffers.sphere.indices.buffer,
       WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
-                                     geometries.sphere.indices.count,
-                                     INSTANCES_COUNT, 0, 0, 0);
+    wgpuRenderPassEncoderDrawIndexedIndirect(
+      wgpu_context->rpass_enc, vertex_buffers.instanced_sphere.draw, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
+  record_depth_pyramid(wgpu_context, occlusion_culling.hiz[1]);
 
   /**
    * Copy offscreen texture to another texture that will be outputted on the
@@ -2120,6 +2439,8 @@ static void example_destroy(wgpu_example_context_t* context)
   geometry_gpu_buffers_destroy(&vertex_buffers.sphere);
   instanced_geometry_gpu_buffers_destroy(&vertex_buffers.instanced_cube);
   instanced_geometry_gpu_buffers_destroy(&vertex_buffers.instanced_sphere);
+  wgpu_hiz_culling_destroy(occlusion_culling.hiz[0]);
+  wgpu_hiz_culling_destroy(occlusion_culling.hiz[1]);
 
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.persp_camera.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.ortho_camera.buffer)
@@ -2128,6 +2449,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.light_position.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.base_colors[0].buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.base_colors[1].buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, instance_animation.buffer.buffer)
 
   WGPU_RELEASE_RESOURCE(Texture, textures.post_fx0.texture)
   WGPU_RELEASE_RESOURCE(TextureView, textures.post_fx0.view)
@@ -2153,6 +2475,7 @@ static void example_destroy(wgpu_example_context_t* context)
 
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.fullscreen_quad)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.scene_meshes)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines.instance_generation)
 }
 
 void example_post_processing(int argc, char* argv[])
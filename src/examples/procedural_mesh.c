@@ -19,6 +19,18 @@
  *  - Single-pass wireframe rendering
  *  - Main drawing loop is optimized and changes just one dynamic offset before
  *    each draw call
+ *  - Batched mode: the draw data of all objects is kept in a storage buffer,
+ *    grouped by mesh and indexed by the instance index, and each mesh is drawn
+ *    with a single DrawIndexedIndirect. The first instance of an indirect draw
+ *    must be zero, the group of a mesh is selected with a dynamic offset.
+ *  - GPU scene mode: the objects live in a persistent GPU scene (transforms and
+ *    material IDs in storage buffers indexed by object slot). Moving objects
+ *    only uploads the transforms that changed, while the other modes rewrite
+ *    the draw records of all objects.
+ *  - In the uniform per draw mode the objects are culled on the CPU: their
+ *    bounding spheres are kept in structure of arrays layout and checked
+ *    against the view frustum in one batch (frustum_cull_spheres), only the
+ *    visible objects are drawn.
  *
  * Ref:
  * https://github.com/michal-z/zig-gamedev/tree/main/samples/procedural_mesh_wgpu
@@ -26,13 +38,27 @@
 
 #define ALIGNMENT 256u // 256-byte alignment
 
+#define MESH_COUNT 8u
+#define MAX_DRAWABLES 1024u
+#define DRAWABLE_GRID_COLUMNS 32u
+#define DRAWABLE_GRID_SPACING 2.5f
+#define DRAWABLE_BOB_HEIGHT 0.25f
+
+/* Draw records per storage buffer offset alignment (16 x 80 = 5 x 256 bytes),
+ * the records of a mesh start at a multiple of it */
+#define DRAW_RECORD_ALIGNMENT 16u
+/* Capacity of the draw record group of a mesh in the batched mode */
+#define MESH_MAX_DRAWABLES                                                     \
+  (((MAX_DRAWABLES + MESH_COUNT - 1) / MESH_COUNT + DRAW_RECORD_ALIGNMENT - 1) \
+   / DRAW_RECORD_ALIGNMENT * DRAW_RECORD_ALIGNMENT)
+
 /* -------------------------------------------------------------------------- *
  * WGSl Shaders
  * -------------------------------------------------------------------------- */
 
 // Shaders
 // clang-format off
-static const char* vertex_shader_wgsl = CODE(
+static const char* uniform_vertex_shader_wgsl = CODE(
   struct FrameUniforms {
     world_to_clip: mat4x4<f32>,
     camera_position: vec3<f32>,
@@ -50,6 +76,7 @@ static const char* vertex_shader_wgsl = CODE(
     @location(0) position: vec3<f32>,
     @location(1) normal: vec3<f32>,
     @location(2) barycentrics: vec3<f32>,
+    @location(3) @interpolate(flat) basecolor_roughness: vec4<f32>,
   }
 
   @vertex
@@ -59,9 +86,8 @@ static const char* vertex_shader_wgsl = CODE(
     @builtin(vertex_index) vertex_index: u32,
   ) -> VertexOut {
     var output: VertexOut;
-    output.position_clip = vec4<f32>(position, 1.0);
-    // output.position_clip = vec4(position, 1.0) * draw_uniforms.object_to_world * frame_uniforms.world_to_clip;
     output.position = (vec4(position, 1.0) * draw_uniforms.object_to_world).xyz;
+    output.position_clip = vec4(output.position, 1.0) * frame_uniforms.world_to_clip;
     output.normal = normal * mat3x3(
       draw_uniforms.object_to_world[0].xyz,
       draw_uniforms.object_to_world[1].xyz,
@@ -69,11 +95,12 @@ static const char* vertex_shader_wgsl = CODE(
     );
     let index = vertex_index % 3u;
     output.barycentrics = vec3(f32(index == 0u), f32(index == 1u), f32(index == 2u));
+    output.basecolor_roughness = draw_uniforms.basecolor_roughness;
     return output;
   }
-  );
+);
 
-static const char* fragment_shader_wgsl = CODE(
+static const char* batched_vertex_shader_wgsl = CODE(
   struct FrameUniforms {
     world_to_clip: mat4x4<f32>,
     camera_position: vec3<f32>,
@@ -84,7 +111,93 @@ static const char* fragment_shader_wgsl = CODE(
     object_to_world: mat4x4<f32>,
     basecolor_roughness: vec4<f32>,
   }
-  @group(1) @binding(0) var<uniform> draw_uniforms: DrawUniforms;
+  // Draw records of the mesh, selected with a dynamic offset
+  @group(1) @binding(0) var<storage, read> draws: array<DrawUniforms>;
+
+  struct VertexOut {
+    @builtin(position) position_clip: vec4<f32>,
+    @location(0) position: vec3<f32>,
+    @location(1) normal: vec3<f32>,
+    @location(2) barycentrics: vec3<f32>,
+    @location(3) @interpolate(flat) basecolor_roughness: vec4<f32>,
+  }
+
+  @vertex
+  fn main(
+    @location(0) position: vec3<f32>,
+    @location(1) normal: vec3<f32>,
+    @builtin(vertex_index) vertex_index: u32,
+    @builtin(instance_index) instance_index: u32,
+  ) -> VertexOut {
+    let draw = draws[instance_index];
+    var output: VertexOut;
+    output.position = (vec4(position, 1.0) * draw.object_to_world).xyz;
+    output.position_clip = vec4(output.position, 1.0) * frame_uniforms.world_to_clip;
+    output.normal = normal * mat3x3(
+      draw.object_to_world[0].xyz,
+      draw.object_to_world[1].xyz,
+      draw.object_to_world[2].xyz,
+    );
+    let index = vertex_index % 3u;
+    output.barycentrics = vec3(f32(index == 0u), f32(index == 1u), f32(index == 2u));
+    output.basecolor_roughness = draw.basecolor_roughness;
+    return output;
+  }
+);
+
+static const char* scene_vertex_shader_wgsl = CODE(
+  struct FrameUniforms {
+    world_to_clip: mat4x4<f32>,
+    camera_position: vec3<f32>,
+  }
+  @group(0) @binding(0) var<uniform> frame_uniforms: FrameUniforms;
+
+  // GPU scene attributes, indexed by object slot
+  @group(1) @binding(0) var<storage, read> transforms: array<mat4x4<f32>>;
+  @group(1) @binding(1) var<storage, read> material_ids: array<u32>;
+  @group(1) @binding(2) var<storage, read> materials: array<vec4<f32>>;
+
+  struct VertexOut {
+    @builtin(position) position_clip: vec4<f32>,
+    @location(0) position: vec3<f32>,
+    @location(1) normal: vec3<f32>,
+    @location(2) barycentrics: vec3<f32>,
+    @location(3) @interpolate(flat) basecolor_roughness: vec4<f32>,
+  }
+
+  @vertex
+  fn main(
+    @location(0) position: vec3<f32>,
+    @location(1) normal: vec3<f32>,
+    @builtin(vertex_index) vertex_index: u32,
+    @builtin(instance_index) instance_index: u32,
+  ) -> VertexOut {
+    // The draw of a mesh starts at instance mesh * MESH_MAX_DRAWABLES (128),
+    // the objects cycle through the MESH_COUNT (8) meshes
+    let mesh = instance_index / 128u;
+    let slot = (instance_index % 128u) * 8u + mesh;
+    let object_to_world = transforms[slot];
+    var output: VertexOut;
+    output.position = (object_to_world * vec4(position, 1.0)).xyz;
+    output.position_clip = vec4(output.position, 1.0) * frame_uniforms.world_to_clip;
+    output.normal = mat3x3(
+      object_to_world[0].xyz,
+      object_to_world[1].xyz,
+      object_to_world[2].xyz,
+    ) * normal;
+    let index = vertex_index % 3u;
+    output.barycentrics = vec3(f32(index == 0u), f32(index == 1u), f32(index == 2u));
+    output.basecolor_roughness = materials[material_ids[slot]];
+    return output;
+  }
+);
+
+static const char* fragment_shader_wgsl = CODE(
+  struct FrameUniforms {
+    world_to_clip: mat4x4<f32>,
+    camera_position: vec3<f32>,
+  }
+  @group(0) @binding(0) var<uniform> frame_uniforms: FrameUniforms;
 
   let pi = 3.1415926;
 
@@ -117,13 +230,14 @@ static const char* fragment_shader_wgsl = CODE(
     @location(0) position: vec3<f32>,
     @location(1) normal: vec3<f32>,
     @location(2) barycentrics: vec3<f32>,
+    @location(3) @interpolate(flat) basecolor_roughness: vec4<f32>,
   ) -> @location(0) vec4<f32> {
     let v = normalize(frame_uniforms.camera_position - position);
     let n = normalize(normal);
 
-    let base_color = draw_uniforms.basecolor_roughness.xyz;
+    let base_color = basecolor_roughness.xyz;
     let ao = 1.0;
-    var roughness = draw_uniforms.basecolor_roughness.a;
+    var roughness = basecolor_roughness.a;
     var metallic: f32;
     if (roughness < 0.0) { metallic = 1.0; } else { metallic = 0.0; }
     roughness = abs(roughness);
@@ -333,6 +447,41 @@ static shape_t init_trefoil_knot(int32_t slices, int32_t stacks, float radius)
   return init_shape(par_shapes_create_trefoil_knot(slices, stacks, radius));
 }
 
+static shape_t init_parametric_sphere(int32_t slices, int32_t stacks)
+{
+  return init_shape(par_shapes_create_parametric_sphere(slices, stacks));
+}
+
+static shape_t init_torus(int32_t slices, int32_t stacks, float radius)
+{
+  return init_shape(par_shapes_create_torus(slices, stacks, radius));
+}
+
+static shape_t init_cylinder(int32_t slices, int32_t stacks)
+{
+  return init_shape(par_shapes_create_cylinder(slices, stacks));
+}
+
+static shape_t init_icosahedron(void)
+{
+  return init_shape(par_shapes_create_icosahedron());
+}
+
+static shape_t init_dodecahedron(void)
+{
+  return init_shape(par_shapes_create_dodecahedron());
+}
+
+static shape_t init_octahedron(void)
+{
+  return init_shape(par_shapes_create_octahedron());
+}
+
+static shape_t init_rock(int32_t seed, int32_t subdivisions)
+{
+  return init_shape(par_shapes_create_rock(seed, subdivisions));
+}
+
 /* -------------------------------------------------------------------------- *
  * Procedural Mesh Example
  * -------------------------------------------------------------------------- */
@@ -347,22 +496,34 @@ typedef struct {
   vec3 camera_position;
 } frame_uniforms_t;
 
+/* Plain floats, the records are packed with the WGSL array stride of 80 bytes
+ * in the batched draw storage buffer */
 typedef struct {
-  mat4 object_to_world;
-  vec4 basecolor_roughness;
+  float object_to_world[16];
+  float basecolor_roughness[4];
 } draw_uniforms_t;
 
+typedef struct {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t first_index;
+  int32_t base_vertex;
+  uint32_t first_instance;
+} draw_indexed_indirect_args_t;
+
 typedef struct {
   uint32_t index_offset;
   int32_t vertex_offset;
   uint32_t num_indices;
   uint32_t num_vertices;
+  float bounding_radius; /* around the origin of the mesh */
 } mesh_t;
 
 typedef struct {
   uint32_t mesh_index;
   vec3 position;
   vec4 basecolor_roughness;
+  wgpu_gpu_scene_handle_t handle;
 } drawable_t;
 
 static struct {
@@ -374,6 +535,26 @@ static struct {
   WGPUBindGroup draw_bind_group;
   WGPURenderPipeline pipeline;
 
+  /* Batched mode */
+  struct {
+    WGPUBindGroupLayout draw_bind_group_layout;
+    WGPUPipelineLayout pipeline_layout;
+    WGPUBindGroup draw_bind_group;
+    WGPURenderPipeline pipeline;
+    wgpu_buffer_t draw_buffer;     /* Draw records grouped by mesh */
+    wgpu_buffer_t indirect_buffer; /* Indirect draw arguments per mesh */
+  } batched;
+
+  /* GPU scene mode */
+  struct {
+    wgpu_gpu_scene_t* scene;
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUPipelineLayout pipeline_layout;
+    WGPUBindGroup bind_group;
+    WGPURenderPipeline pipeline;
+    wgpu_buffer_t material_buffer; /* basecolor_roughness per material ID */
+  } gpu_scene;
+
   uint32_t total_num_vertices;
   uint32_t total_num_indices;
 
@@ -394,8 +575,8 @@ static struct {
     WGPURenderPassDescriptor descriptor;
   } render_pass;
 
-  drawable_t drawables[1];
-  mesh_t meshes[1];
+  drawable_t drawables[MAX_DRAWABLES];
+  mesh_t meshes[MESH_COUNT];
 
   struct {
     vec3 position;
@@ -409,7 +590,34 @@ static struct {
   } camera;
 
   frame_uniforms_t frame_uniforms;
-  draw_uniforms_t draw_uniforms;
+
+  /* Draw data uploaded in the last frame */
+  struct {
+    uint64_t bytes;
+    uint32_t copies;
+  } upload_stats;
+  /* The objects below it moved since the last upload */
+  uint32_t changed_count;
+
+  /* CPU frustum culling of the uniform per draw mode, the bounding spheres of
+   * the objects in structure of arrays layout */
+  struct {
+    frustum_t frustum;
+    float x[MAX_DRAWABLES];
+    float y[MAX_DRAWABLES];
+    float z[MAX_DRAWABLES];
+    float radius[MAX_DRAWABLES];
+    uint32_t visible_indices[MAX_DRAWABLES];
+    uint32_t visible_count;
+    float time_us;
+  } culling;
+
+  struct {
+    /* 0 = uniform per draw, 1 = batched indirect draws, 2 = GPU scene */
+    int32_t draw_mode;
+    int32_t drawable_count;
+    int32_t animated_count;
+  } settings;
 
   struct {
     float xpos;
@@ -432,6 +640,10 @@ static struct {
   .mouse.xpos = 0.0f,
   .mouse.ypos = 0.0f,
 
+  .settings.draw_mode      = 1,
+  .settings.drawable_count = 256,
+  .settings.animated_count = 32,
+
   .example_title = "Procedural Mesh",
   .prepared      = false,
 };
@@ -447,6 +659,11 @@ static void append_mesh(uint32_t mesh_index, shape_t* mesh, mesh_t* meshes,
     .num_indices   = mesh->indices.len,
     .num_vertices  = mesh->positions.len,
   };
+  for (size_t i = 0; i < mesh->positions.len; ++i) {
+    meshes[mesh_index].bounding_radius
+      = MAX(meshes[mesh_index].bounding_radius,
+            glm_vec3_norm(mesh->positions.data[i]));
+  }
 
   // Indices
   *meshes_indices_len += mesh->indices.len;
@@ -495,26 +712,49 @@ static void init_scene(drawable_t* drawables, mesh_t* meshes,
                        vec3** meshes_positions, uint32_t* meshes_positions_len,
                        vec3** meshes_normals, uint32_t* meshes_normals_len)
 {
-  uint32_t mesh_index = 0;
-
-  // Trefoil knot
-  {
-    shape_t mesh = init_trefoil_knot(10, 128, 0.8f);
-    shape_rotate(&mesh, PI_2, 1.0, 0.0, 0.0);
-    shape_unweld(&mesh);
-    shape_compute_normals(&mesh);
-
-    drawables[mesh_index] = (drawable_t){
-      .mesh_index          = mesh_index,
-      .position            = {0.f, 1.f, 0.f},
-      .basecolor_roughness = {0.0f, 0.7f, 0.0f, 0.6f},
-    };
-
-    append_mesh(mesh_index, &mesh, meshes, meshes_indices, meshes_indices_len,
+  shape_t shapes[MESH_COUNT] = {
+    init_trefoil_knot(10, 128, 0.8f),
+    init_parametric_sphere(20, 20),
+    init_icosahedron(),
+    init_dodecahedron(),
+    init_cylinder(10, 10),
+    init_torus(10, 30, 0.3f),
+    init_octahedron(),
+    init_rock(123, 4),
+  };
+  shape_rotate(&shapes[0], PI_2, 1.0, 0.0, 0.0);
+  shape_rotate(&shapes[4], -PI_2, 1.0, 0.0, 0.0);
+  shape_rotate(&shapes[5], PI_2, 1.0, 0.0, 0.0);
+
+  for (uint32_t i = 0; i < MESH_COUNT; ++i) {
+    shape_unweld(&shapes[i]);
+    shape_compute_normals(&shapes[i]);
+    append_mesh(i, &shapes[i], meshes, meshes_indices, meshes_indices_len,
                 meshes_positions, meshes_positions_len, meshes_normals,
                 meshes_normals_len);
+    shape_deinit(&shapes[i]);
+  }
 
-    shape_deinit(&mesh);
+  /* Grid of objects cycling through the meshes, a negative roughness is a
+   * metallic surface */
+  static const vec4 basecolor_roughness[MESH_COUNT] = {
+    {0.0f, 0.7f, 0.0f, 0.6f},  {0.7f, 0.0f, 0.0f, 0.2f},
+    {0.7f, 0.7f, 0.0f, 0.4f},  {0.0f, 0.1f, 1.0f, 0.2f},
+    {1.0f, 0.0f, 1.0f, 0.3f},  {0.0f, 1.0f, 1.0f, 0.3f},
+    {0.9f, 0.9f, 0.9f, -0.2f}, {0.6f, 0.5f, 0.3f, -0.4f},
+  };
+  for (uint32_t i = 0; i < MAX_DRAWABLES; ++i) {
+    const uint32_t column = i % DRAWABLE_GRID_COLUMNS;
+    const uint32_t row    = i / DRAWABLE_GRID_COLUMNS;
+    drawable_t* drawable  = &drawables[i];
+    drawable->mesh_index  = i % MESH_COUNT;
+    drawable->position[0]
+      = ((float)column - 0.5f * (float)(DRAWABLE_GRID_COLUMNS - 1))
+        * DRAWABLE_GRID_SPACING;
+    drawable->position[1] = 1.0f;
+    drawable->position[2] = (float)row * DRAWABLE_GRID_SPACING + 2.0f;
+    glm_vec4_copy((float*)basecolor_roughness[drawable->mesh_index],
+                  drawable->basecolor_roughness);
   }
 }
 
@@ -602,7 +842,7 @@ static void setup_bind_group_layouts(wgpu_context_t* wgpu_context)
         .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
         .buffer = (WGPUBufferBindingLayout) {
           .type = WGPUBufferBindingType_Uniform,
-          .hasDynamicOffset = false,
+          .hasDynamicOffset = true,
           .minBindingSize = sizeof(draw_uniforms_t),
         },
         .sampler = {0},
@@ -616,24 +856,122 @@ static void setup_bind_group_layouts(wgpu_context_t* wgpu_context)
       = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
     ASSERT(demo_state.draw_bind_group_layout != NULL);
   }
+
+  /* Batched draw bind group layout */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[1] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        .binding = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+          .hasDynamicOffset = true,
+          .minBindingSize = MESH_MAX_DRAWABLES * sizeof(draw_uniforms_t),
+        },
+        .sampler = {0},
+      },
+    };
+    WGPUBindGroupLayoutDescriptor bgl_desc = {
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    };
+    demo_state.batched.draw_bind_group_layout
+      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
+    ASSERT(demo_state.batched.draw_bind_group_layout != NULL);
+  }
+
+  /* GPU scene bind group layout: transforms, material IDs and materials */
+  {
+    WGPUBindGroupLayoutEntry bgl_entries[3] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        .binding = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = MAX_DRAWABLES * sizeof(mat4),
+        },
+        .sampler = {0},
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        .binding = 1,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = MAX_DRAWABLES * sizeof(uint32_t),
+        },
+        .sampler = {0},
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        .binding = 2,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type = WGPUBufferBindingType_ReadOnlyStorage,
+          .minBindingSize = MESH_COUNT * sizeof(vec4),
+        },
+        .sampler = {0},
+      },
+    };
+    WGPUBindGroupLayoutDescriptor bgl_desc = {
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    };
+    demo_state.gpu_scene.bind_group_layout
+      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
+    ASSERT(demo_state.gpu_scene.bind_group_layout != NULL);
+  }
 }
 
 static void setup_render_pipeline_layout(wgpu_context_t* wgpu_context)
 {
-  WGPUBindGroupLayout bind_group_layouts[2] = {
-    demo_state.frame_bind_group_layout, // Group 0
-    demo_state.draw_bind_group_layout,  // Group 1
-  };
-  demo_state.pipeline_layout = wgpuDeviceCreatePipelineLayout(
-    wgpu_context->device,
-    &(WGPUPipelineLayoutDescriptor){
-      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
-      .bindGroupLayouts     = bind_group_layouts,
-    });
-  ASSERT(demo_state.pipeline_layout != NULL);
+  {
+    WGPUBindGroupLayout bind_group_layouts[2] = {
+      demo_state.frame_bind_group_layout, // Group 0
+      demo_state.draw_bind_group_layout,  // Group 1
+    };
+    demo_state.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+        .bindGroupLayouts     = bind_group_layouts,
+      });
+    ASSERT(demo_state.pipeline_layout != NULL);
+  }
+
+  /* Batched mode */
+  {
+    WGPUBindGroupLayout bind_group_layouts[2] = {
+      demo_state.frame_bind_group_layout,        // Group 0
+      demo_state.batched.draw_bind_group_layout, // Group 1
+    };
+    demo_state.batched.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+        .bindGroupLayouts     = bind_group_layouts,
+      });
+    ASSERT(demo_state.batched.pipeline_layout != NULL);
+  }
+
+  /* GPU scene mode */
+  {
+    WGPUBindGroupLayout bind_group_layouts[2] = {
+      demo_state.frame_bind_group_layout,     // Group 0
+      demo_state.gpu_scene.bind_group_layout, // Group 1
+    };
+    demo_state.gpu_scene.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+        .bindGroupLayouts     = bind_group_layouts,
+      });
+    ASSERT(demo_state.gpu_scene.pipeline_layout != NULL);
+  }
 }
 
-static void prepare_rendering_pipeline(wgpu_context_t* wgpu_context)
+static WGPURenderPipeline
+create_rendering_pipeline(wgpu_context_t* wgpu_context,
+                          WGPUPipelineLayout pipeline_layout,
+                          const char* vertex_shader_wgsl, const char* label)
 {
   // Primitive state
   WGPUPrimitiveState primitive_state = {
@@ -701,34 +1039,53 @@ static void prepare_rendering_pipeline(wgpu_context_t* wgpu_context)
       });
 
   // Create rendering pipeline using the specified states
-  demo_state.pipeline = wgpuDeviceCreateRenderPipeline(
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(
     wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                            .label        = "procedural_mesh_render_pipeline",
-                            .layout       = demo_state.pipeline_layout,
+                            .label        = label,
+                            .layout       = pipeline_layout,
                             .primitive    = primitive_state,
                             .vertex       = vertex_state,
                             .fragment     = &fragment_state,
                             .depthStencil = &depth_stencil_state,
                             .multisample  = multisample_state,
                           });
-  ASSERT(demo_state.pipeline != NULL);
+  ASSERT(pipeline != NULL);
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+
+  return pipeline;
+}
+
+static void prepare_rendering_pipelines(wgpu_context_t* wgpu_context)
+{
+  demo_state.pipeline = create_rendering_pipeline(
+    wgpu_context, demo_state.pipeline_layout, uniform_vertex_shader_wgsl,
+    "procedural_mesh_render_pipeline");
+  demo_state.batched.pipeline = create_rendering_pipeline(
+    wgpu_context, demo_state.batched.pipeline_layout,
+    batched_vertex_shader_wgsl, "procedural_mesh_batched_render_pipeline");
+  demo_state.gpu_scene.pipeline = create_rendering_pipeline(
+    wgpu_context, demo_state.gpu_scene.pipeline_layout,
+    scene_vertex_shader_wgsl, "procedural_mesh_gpu_scene_render_pipeline");
 }
 
 static void update_camera(wgpu_context_t* wgpu_context)
 {
+  const float pitch = demo_state.camera.pitch, yaw = demo_state.camera.yaw;
+  glm_vec3_copy(
+    (vec3){cosf(pitch) * sinf(yaw), -sinf(pitch), cosf(pitch) * cosf(yaw)},
+    demo_state.camera.forward);
   look_to_lh(demo_state.camera.position, demo_state.camera.forward,
              demo_state.camera.updir, &demo_state.camera.cam_world_to_view);
   perspective_fov_lh(0.25f * PI,
                      (float)wgpu_context->surface.width
                        / (float)wgpu_context->surface.height,
                      0.01f, 200.0f, &demo_state.camera.cam_view_to_clip);
-  glm_mat4_mulN((mat4*[]){&demo_state.camera.cam_world_to_view,
-                          &demo_state.camera.cam_view_to_clip},
-                2, demo_state.camera.cam_world_to_clip);
+  glm_mat4_mul(demo_state.camera.cam_view_to_clip,
+               demo_state.camera.cam_world_to_view,
+               demo_state.camera.cam_world_to_clip);
 }
 
 static void update_frame_uniform_buffers(wgpu_context_t* wgpu_context)
@@ -748,26 +1105,176 @@ static void update_frame_uniform_buffers(wgpu_context_t* wgpu_context)
                           demo_state.uniform_buffers.frame.size);
 }
 
-static void update_draw_uniform_buffers(wgpu_context_t* wgpu_context)
+static void get_draw_uniforms(const drawable_t* drawable,
+                              draw_uniforms_t* draw_uniforms)
 {
-  // Update "object to world" xform
-  vec3* drawable_pos   = &demo_state.drawables[0].position;
-  mat4 object_to_world = {
-    {1.0f, 0.0f, 0.0f, 0.0f},                                           //
-    {0.0f, 1.0f, 0.0f, 0.0f},                                           //
-    {0.0f, 0.0f, 1.0f, 0.0f},                                           //
-    {(*drawable_pos)[0], (*drawable_pos)[1], (*drawable_pos)[2], 1.0f}, //
-  };
+  // "Object to world" xform
+  mat4 object_to_world;
+  glm_translate_make(object_to_world, (float*)drawable->position);
   glm_mat4_transpose(object_to_world);
 
-  glm_mat4_copy(object_to_world, demo_state.draw_uniforms.object_to_world);
-  glm_vec4_copy(demo_state.drawables[0].basecolor_roughness,
-                demo_state.draw_uniforms.basecolor_roughness);
+  memcpy(draw_uniforms->object_to_world, object_to_world,
+         sizeof(draw_uniforms->object_to_world));
+  memcpy(draw_uniforms->basecolor_roughness, drawable->basecolor_roughness,
+         sizeof(draw_uniforms->basecolor_roughness));
+}
+
+/* Writes the draw records of all objects, at the dynamic uniform offset
+ * alignment for the uniform mode and grouped by mesh for the batched mode.
+ * Called every frame while the objects move, so the staging data comes from
+ * the frame arena */
+static void update_draw_uniform_buffers(wgpu_context_t* wgpu_context)
+{
+  arena_t* frame_arena
+    = ((wgpu_example_context_t*)wgpu_context->context)->frame_arena;
+  uint8_t* uniform_data = arena_calloc(frame_arena, MAX_DRAWABLES, ALIGNMENT);
+  draw_uniforms_t* batched_data = arena_calloc(
+    frame_arena, MESH_COUNT * MESH_MAX_DRAWABLES, sizeof(draw_uniforms_t));
+  for (uint32_t i = 0; i < MAX_DRAWABLES; ++i) {
+    const drawable_t* drawable = &demo_state.drawables[i];
+    draw_uniforms_t* record    = (draw_uniforms_t*)&uniform_data[i * ALIGNMENT];
+    get_draw_uniforms(drawable, record);
+    batched_data[drawable->mesh_index * MESH_MAX_DRAWABLES + i / MESH_COUNT]
+      = *record;
+  }
 
   // Map uniform buffer and update it
   wgpu_queue_write_buffer(wgpu_context, demo_state.uniform_buffers.draw.buffer,
-                          0, &demo_state.draw_uniforms.object_to_world,
+                          0, uniform_data,
                           demo_state.uniform_buffers.draw.size);
+  wgpu_queue_write_buffer(wgpu_context, demo_state.batched.draw_buffer.buffer,
+                          0, batched_data,
+                          demo_state.batched.draw_buffer.size);
+
+  demo_state.upload_stats.bytes = demo_state.uniform_buffers.draw.size
+                                  + demo_state.batched.draw_buffer.size;
+  demo_state.upload_stats.copies = 2;
+}
+
+/* Adds the objects to the GPU scene, the object i gets slot i */
+static void init_gpu_scene(wgpu_context_t* wgpu_context)
+{
+  demo_state.gpu_scene.scene = wgpu_gpu_scene_create(
+    wgpu_context, &(wgpu_gpu_scene_desc_t){
+                    .max_object_count = MAX_DRAWABLES,
+                  });
+  for (uint32_t i = 0; i < MAX_DRAWABLES; ++i) {
+    drawable_t* drawable                = &demo_state.drawables[i];
+    wgpu_gpu_scene_object_desc_t object = {
+      .bounds_min  = {-1.0f, -1.0f, -1.0f},
+      .bounds_max  = {1.0f, 1.0f, 1.0f},
+      .material_id = drawable->mesh_index,
+      .mesh_id     = drawable->mesh_index,
+    };
+    glm_translate_make(object.transform, drawable->position);
+    drawable->handle = wgpu_gpu_scene_add(demo_state.gpu_scene.scene, &object);
+    ASSERT(wgpu_gpu_scene_get_slot(drawable->handle) == i);
+  }
+  wgpu_gpu_scene_upload(demo_state.gpu_scene.scene);
+
+  // The objects of the first MESH_COUNT slots use all the materials
+  vec4 materials[MESH_COUNT];
+  for (uint32_t i = 0; i < MESH_COUNT; ++i) {
+    glm_vec4_copy(demo_state.drawables[i].basecolor_roughness, materials[i]);
+  }
+  demo_state.gpu_scene.material_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = sizeof(materials),
+                    .initial.data = materials,
+                  });
+}
+
+/* Moves the first animated_count objects up and down */
+static void update_drawables(wgpu_example_context_t* context)
+{
+  const float time = context->frame.timestamp_millis / 1000.0f;
+  for (uint32_t i = 0; i < (uint32_t)demo_state.settings.animated_count; ++i) {
+    demo_state.drawables[i].position[1]
+      = 1.0f + DRAWABLE_BOB_HEIGHT * sinf(2.0f * time + 0.37f * (float)i);
+  }
+  demo_state.changed_count = MAX(demo_state.changed_count,
+                                 (uint32_t)demo_state.settings.animated_count);
+}
+
+/* Checks the bounding spheres of the drawn objects against the view frustum
+ * in one batch, the uniform per draw mode draws the visible ones */
+static void cull_drawables(void)
+{
+  const uint64_t start_time     = platform_get_time_ns();
+  const uint32_t drawable_count = (uint32_t)demo_state.settings.drawable_count;
+  for (uint32_t i = 0; i < drawable_count; ++i) {
+    const drawable_t* drawable = &demo_state.drawables[i];
+    demo_state.culling.x[i]    = drawable->position[0];
+    demo_state.culling.y[i]    = drawable->position[1];
+    demo_state.culling.z[i]    = drawable->position[2];
+    demo_state.culling.radius[i]
+      = demo_state.meshes[drawable->mesh_index].bounding_radius;
+  }
+
+  frustum_update(&demo_state.culling.frustum,
+                 demo_state.camera.cam_world_to_clip);
+  demo_state.culling.visible_count = frustum_cull_spheres(
+    &demo_state.culling.frustum,
+    &(frustum_spheres_t){
+      .x      = demo_state.culling.x,
+      .y      = demo_state.culling.y,
+      .z      = demo_state.culling.z,
+      .radius = demo_state.culling.radius,
+      .count  = drawable_count,
+    },
+    demo_state.culling.visible_indices);
+  demo_state.culling.time_us
+    = (float)(platform_get_time_ns() - start_time) / 1000.0f;
+}
+
+/* The GPU scene uploads the changed transforms only, the other modes rewrite
+ * the records of all objects */
+static void update_draw_data(wgpu_context_t* wgpu_context)
+{
+  demo_state.upload_stats.bytes  = 0;
+  demo_state.upload_stats.copies = 0;
+  if (demo_state.changed_count == 0) {
+    return;
+  }
+
+  if (demo_state.settings.draw_mode == 2) {
+    wgpu_gpu_scene_t* scene = demo_state.gpu_scene.scene;
+    for (uint32_t i = 0; i < demo_state.changed_count; ++i) {
+      mat4 object_to_world;
+      glm_translate_make(object_to_world, demo_state.drawables[i].position);
+      wgpu_gpu_scene_set_transform(scene, demo_state.drawables[i].handle,
+                                   object_to_world);
+    }
+    wgpu_gpu_scene_upload(scene);
+    const wgpu_gpu_scene_stats_t* stats = wgpu_gpu_scene_get_stats(scene);
+    demo_state.upload_stats.bytes       = stats->uploaded_bytes;
+    demo_state.upload_stats.copies      = stats->copy_count;
+  }
+  else {
+    update_draw_uniform_buffers(wgpu_context);
+  }
+  demo_state.changed_count = 0;
+}
+
+/* The objects cycle through the meshes, the first drawable_count objects are
+ * drawn */
+static void update_indirect_draw_args(wgpu_context_t* wgpu_context)
+{
+  const uint32_t drawable_count = (uint32_t)demo_state.settings.drawable_count;
+  draw_indexed_indirect_args_t args[MESH_COUNT] = {0};
+  for (uint32_t i = 0; i < MESH_COUNT; ++i) {
+    args[i] = (draw_indexed_indirect_args_t){
+      .index_count    = demo_state.meshes[i].num_indices,
+      .instance_count = (drawable_count + MESH_COUNT - 1 - i) / MESH_COUNT,
+      .first_index    = demo_state.meshes[i].index_offset,
+      .base_vertex    = demo_state.meshes[i].vertex_offset,
+      .first_instance = 0,
+    };
+  }
+  wgpu_queue_write_buffer(wgpu_context,
+                          demo_state.batched.indirect_buffer.buffer, 0, args,
+                          sizeof(args));
 }
 
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
@@ -780,16 +1287,34 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
       .size  = sizeof(frame_uniforms_t),
     });
 
-  // Create a draw uniform buffer
+  // Create a draw uniform buffer, a record per object
   demo_state.uniform_buffers.draw = wgpu_create_buffer(
     context->wgpu_context,
     &(wgpu_buffer_desc_t){
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = sizeof(draw_uniforms_t),
+      .size  = MAX_DRAWABLES * ALIGNMENT,
+    });
+
+  // Create the batched draw storage buffer, a record group per mesh
+  demo_state.batched.draw_buffer = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+      .size  = MESH_COUNT * MESH_MAX_DRAWABLES * sizeof(draw_uniforms_t),
+    });
+
+  // Create the indirect draw arguments buffer
+  demo_state.batched.indirect_buffer = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Indirect,
+      .size  = MESH_COUNT * sizeof(draw_indexed_indirect_args_t),
     });
 
   update_frame_uniform_buffers(context->wgpu_context);
   update_draw_uniform_buffers(context->wgpu_context);
+  update_indirect_draw_args(context->wgpu_context);
+  init_gpu_scene(context->wgpu_context);
 }
 
 static void prepare_bind_groups(wgpu_context_t* wgpu_context)
@@ -820,7 +1345,7 @@ static void prepare_bind_groups(wgpu_context_t* wgpu_context)
         .binding = 0,
         .buffer  = demo_state.uniform_buffers.draw.buffer,
         .offset  = 0,
-        .size    = demo_state.uniform_buffers.draw.size,
+        .size    = sizeof(draw_uniforms_t),
       },
     };
     demo_state.draw_bind_group = wgpuDeviceCreateBindGroup(
@@ -831,6 +1356,63 @@ static void prepare_bind_groups(wgpu_context_t* wgpu_context)
                             });
     ASSERT(demo_state.draw_bind_group != NULL);
   }
+
+  /* Batched draw bind group, the record group of a mesh */
+  {
+    WGPUBindGroupEntry bg_entries[1] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = demo_state.batched.draw_buffer.buffer,
+        .offset  = 0,
+        .size    = MESH_MAX_DRAWABLES * sizeof(draw_uniforms_t),
+      },
+    };
+    demo_state.batched.draw_bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = demo_state.batched.draw_bind_group_layout,
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(demo_state.batched.draw_bind_group != NULL);
+  }
+
+  /* GPU scene bind group */
+  {
+    wgpu_gpu_scene_t* scene          = demo_state.gpu_scene.scene;
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = wgpu_gpu_scene_get_buffer(scene,
+                     WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM),
+        .offset  = 0,
+        .size    = wgpu_gpu_scene_get_buffer_size(scene,
+                     WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM),
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = wgpu_gpu_scene_get_buffer(scene,
+                     WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID),
+        .offset  = 0,
+        .size    = wgpu_gpu_scene_get_buffer_size(scene,
+                     WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID),
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = demo_state.gpu_scene.material_buffer.buffer,
+        .offset  = 0,
+        .size    = demo_state.gpu_scene.material_buffer.size,
+      },
+    };
+    demo_state.gpu_scene.bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = demo_state.gpu_scene.bind_group_layout,
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(demo_state.gpu_scene.bind_group != NULL);
+  }
 }
 
 static void prepare_depth_texture(wgpu_context_t* wgpu_context)
@@ -910,7 +1492,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_vertex_and_index_buffer(context->wgpu_context);
     setup_bind_group_layouts(context->wgpu_context);
     setup_render_pipeline_layout(context->wgpu_context);
-    prepare_rendering_pipeline(context->wgpu_context);
+    prepare_rendering_pipelines(context->wgpu_context);
     prepare_uniform_buffers(context);
     prepare_bind_groups(context->wgpu_context);
     prepare_depth_texture(context->wgpu_context);
@@ -924,11 +1506,46 @@ static int example_initialize(wgpu_example_context_t* context)
 
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
-  if (imgui_overlay_header("Info")) {
-    UNUSED_VAR(context);
-    // imgui_overlay_text(context->imgui_overlay,
-    //                    "Left Mouse Button + drag  :  rotate camera");
-    // imgui_overlay_text(context->imgui_overlay, "W, A, S, D  :  move camera");
+  if (imgui_overlay_header("Settings")) {
+    static const char* draw_modes[3]
+      = {"Uniform per draw", "Batched indirect", "GPU scene"};
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Draw mode",
+                                &demo_state.settings.draw_mode, draw_modes,
+                                3)) {
+      // The buffers of the mode may predate the last moves
+      demo_state.changed_count = MAX_DRAWABLES;
+    }
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Objects",
+                                 &demo_state.settings.drawable_count, 1,
+                                 MAX_DRAWABLES)) {
+      update_indirect_draw_args(context->wgpu_context);
+    }
+    const uint32_t animated_count
+      = (uint32_t)demo_state.settings.animated_count;
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Animated objects",
+                                 &demo_state.settings.animated_count, 0,
+                                 MAX_DRAWABLES)) {
+      // Objects no longer animated return to the grid
+      for (uint32_t i = (uint32_t)demo_state.settings.animated_count;
+           i < animated_count; ++i) {
+        demo_state.drawables[i].position[1] = 1.0f;
+      }
+      demo_state.changed_count
+        = MAX(demo_state.changed_count, animated_count);
+    }
+    imgui_overlay_text("Draw calls: %u",
+                       demo_state.settings.draw_mode == 0 ?
+                         demo_state.culling.visible_count :
+                         MESH_COUNT);
+    if (demo_state.settings.draw_mode == 0) {
+      imgui_overlay_text("Visible objects: %u / %u (culled in %.1f us)",
+                         demo_state.culling.visible_count,
+                         (uint32_t)demo_state.settings.drawable_count,
+                         demo_state.culling.time_us);
+    }
+    imgui_overlay_text("Draw data upload: %.1f KB in %u copies",
+                       (float)demo_state.upload_stats.bytes / 1024.0f,
+                       demo_state.upload_stats.copies);
   }
 }
 
@@ -956,23 +1573,65 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     wgpu_context->rpass_enc, demo_state.index_buffer.buffer,
     WGPUIndexFormat_Uint16, 0, demo_state.index_buffer.size);
 
-  // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                   demo_state.pipeline);
-
-  // Set the bind group
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                    demo_state.frame_bind_group, 0, 0);
-
-  // Draw indexed geometries
-  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(demo_state.drawables); ++i) {
-    uint32_t dynamic_offset = i * ALIGNMENT;
+  if (demo_state.settings.draw_mode == 0) {
+    // Bind the rendering pipeline
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                     demo_state.pipeline);
+
+    // Set the bind group
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      demo_state.frame_bind_group, 0, 0);
+
+    // Draw the indexed geometries of the visible objects
+    for (uint32_t v = 0; v < demo_state.culling.visible_count; ++v) {
+      const uint32_t i = demo_state.culling.visible_indices[v];
+      const mesh_t* mesh
+        = &demo_state.meshes[demo_state.drawables[i].mesh_index];
+      uint32_t dynamic_offset = i * ALIGNMENT;
+      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 1,
+                                        demo_state.draw_bind_group, 1,
+                                        &dynamic_offset);
+      wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
+                                       mesh->num_indices, 1, mesh->index_offset,
+                                       mesh->vertex_offset, 0);
+    }
+  }
+  else if (demo_state.settings.draw_mode == 2) {
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                     demo_state.gpu_scene.pipeline);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      demo_state.frame_bind_group, 0, 0);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 1,
-                                      demo_state.draw_bind_group, 0,
-                                      &dynamic_offset);
-    wgpuRenderPassEncoderDrawIndexed(
-      wgpu_context->rpass_enc, demo_state.meshes[i].num_indices, 1,
-      demo_state.meshes[i].index_offset, demo_state.meshes[i].vertex_offset, 0);
+                                      demo_state.gpu_scene.bind_group, 0, 0);
+
+    // One instanced draw per mesh, the first instance selects the mesh
+    const uint32_t drawable_count
+      = (uint32_t)demo_state.settings.drawable_count;
+    for (uint32_t i = 0; i < MESH_COUNT; ++i) {
+      const mesh_t* mesh = &demo_state.meshes[i];
+      wgpuRenderPassEncoderDrawIndexed(
+        wgpu_context->rpass_enc, mesh->num_indices,
+        (drawable_count + MESH_COUNT - 1 - i) / MESH_COUNT, mesh->index_offset,
+        mesh->vertex_offset, i * MESH_MAX_DRAWABLES);
+    }
+  }
+  else {
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
+                                     demo_state.batched.pipeline);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      demo_state.frame_bind_group, 0, 0);
+
+    // One indirect draw per mesh, instanced over the objects of the mesh
+    for (uint32_t i = 0; i < MESH_COUNT; ++i) {
+      uint32_t dynamic_offset
+        = i * MESH_MAX_DRAWABLES * sizeof(draw_uniforms_t);
+      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 1,
+                                        demo_state.batched.draw_bind_group, 1,
+                                        &dynamic_offset);
+      wgpuRenderPassEncoderDrawIndexedIndirect(
+        wgpu_context->rpass_enc, demo_state.batched.indirect_buffer.buffer,
+        i * sizeof(draw_indexed_indirect_args_t));
+    }
   }
 
   // End render pass
@@ -992,6 +1651,13 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
 static int example_draw(wgpu_example_context_t* context)
 {
+  // Move the animated objects and upload the draw data
+  update_drawables(context);
+  update_draw_data(context->wgpu_context);
+  if (demo_state.settings.draw_mode == 0) {
+    cull_drawables();
+  }
+
   // Prepare frame
   prepare_frame(context);
 
@@ -1026,19 +1692,33 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, demo_state.index_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, demo_state.uniform_buffers.frame.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, demo_state.uniform_buffers.draw.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, demo_state.batched.draw_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, demo_state.batched.indirect_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, demo_state.gpu_scene.material_buffer.buffer)
+  wgpu_gpu_scene_destroy(demo_state.gpu_scene.scene);
 
   WGPU_RELEASE_RESOURCE(Texture, demo_state.depth_texture)
   WGPU_RELEASE_RESOURCE(TextureView, demo_state.depth_texture_view)
 
   WGPU_RELEASE_RESOURCE(BindGroup, demo_state.draw_bind_group)
   WGPU_RELEASE_RESOURCE(BindGroup, demo_state.frame_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, demo_state.batched.draw_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, demo_state.gpu_scene.bind_group)
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, demo_state.draw_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, demo_state.frame_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        demo_state.batched.draw_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        demo_state.gpu_scene.bind_group_layout)
 
   WGPU_RELEASE_RESOURCE(PipelineLayout, demo_state.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, demo_state.batched.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, demo_state.gpu_scene.pipeline_layout)
 
   WGPU_RELEASE_RESOURCE(RenderPipeline, demo_state.pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, demo_state.batched.pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, demo_state.gpu_scene.pipeline)
 }
 
 void example_procedural_mesh(int argc, char* argv[])
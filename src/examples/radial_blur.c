@@ -13,6 +13,12 @@
  * into an offscreen framebuffer at lower resolution and rendered as a
  * fullscreen quad atop the scene using a radial blur fragment shader.
  *
+ * The passes are declared in a frame graph each frame: the offscreen pass is
+ * culled while the radial blur is disabled and its depth buffer is never
+ * stored. With coarse shading the blur is evaluated by a compute pass at 1/2
+ * or 1/4 rate in screen tiles with little contrast in the offscreen texture
+ * and upsampled, the overlay shows the share of the pixels shaded.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/radialblur
  * http://halisavakis.com/my-take-on-shaders-radial-blur/
@@ -26,6 +32,35 @@
 static bool blur            = true;
 static bool display_texture = false;
 
+// Shaders
+// clang-format off
+static const char* coarse_radial_blur_shader_wgsl = CODE(
+  struct BlurParams {
+    radial_blur_scale    : f32,
+    radial_blur_strength : f32,
+    radial_origin        : vec2<f32>,
+  }
+
+  @group(1) @binding(0) var<uniform> blur_params : BlurParams;
+  @group(1) @binding(1) var blur_texture : texture_2d<f32>;
+  @group(1) @binding(2) var blur_sampler : sampler;
+
+  // Same operations as radialblur.frag
+  fn coarse_shading_effect(uv : vec2<f32>) -> vec4<f32> {
+    let radial_size = 1.0 / vec2<f32>(textureDimensions(blur_texture, 0));
+    let coord = uv + radial_size * 0.5 - blur_params.radial_origin;
+    var color = vec4<f32>(0.0);
+    for (var i = 0; i < 32; i++) {
+      let scale = 1.0 - blur_params.radial_blur_scale * (f32(i) / 31.0);
+      color += textureSampleLevel(blur_texture, blur_sampler,
+                                  coord * scale + blur_params.radial_origin,
+                                  0.0);
+    }
+    return (color / 32.0) * blur_params.radial_blur_strength;
+  }
+);
+// clang-format on
+
 static struct {
   texture_t gradient;
 } textures = {0};
@@ -69,7 +104,6 @@ static struct {
 
 static struct {
   WGPUBindGroup scene;
-  WGPUBindGroup radial_blur;
 } bind_groups = {0};
 
 static struct {
@@ -79,24 +113,23 @@ static struct {
 
 static struct {
   uint32_t width, height;
-  // Framebuffer for offscreen rendering
-  struct {
-    WGPUTexture texture;
-    WGPUTextureView texture_view;
-  } color, depth_stencil;
   WGPUSampler sampler;
-  struct {
-    WGPURenderPassColorAttachment color_attachment[1];
-    WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
-    WGPURenderPassDescriptor render_pass_descriptor;
-  } render_pass;
 } offscreen_pass = {0};
 
-// Render pass descriptor for frame buffer writes
+// Frame graph with the offscreen and the composite pass, the offscreen frame
+// buffer textures are transient textures of the graph
 static struct {
-  WGPURenderPassColorAttachment color_attachments[1];
-  WGPURenderPassDescriptor descriptor;
-} render_pass = {0};
+  wgpu_frame_graph_t* graph;
+  wgpu_frame_graph_resource_t offscreen_color;
+} frame_graph = {0};
+
+// Coarse shading of the radial blur, the output texture is imported into the
+// frame graph
+static struct {
+  wgpu_coarse_shading_t* shading;
+  wgpu_frame_graph_resource_t output;
+  bool enabled;
+} coarse = {0};
 
 static const char* example_title = "Full Screen Radial Blur Effect";
 static bool prepared             = false;
@@ -126,7 +159,8 @@ static void load_assets(wgpu_context_t* wgpu_context)
     wgpu_context, "textures/particle_gradient_rgba.ktx", NULL);
 }
 
-// Setup the offscreen framebuffer for rendering the blurred scene
+// Setup the sampler for the offscreen framebuffer, the framebuffer textures are
+// allocated by the frame graph
 // The color attachment of this framebuffer will then be used to sample frame in
 // the fragment shader of the final pass
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
@@ -134,42 +168,6 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
   offscreen_pass.width  = FB_DIM;
   offscreen_pass.height = FB_DIM;
 
-  // Create the texture
-  WGPUExtent3D texture_extent = {
-    .width              = offscreen_pass.width,
-    .height             = offscreen_pass.height,
-    .depthOrArrayLayers = 1,
-  };
-
-  // Color attachment
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .size          = texture_extent,
-      .mipLevelCount = 1,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = FB_COLOR_FORMAT,
-      .usage
-      = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
-    };
-    offscreen_pass.color.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(offscreen_pass.color.texture != NULL);
-
-    // Create the texture view
-    WGPUTextureViewDescriptor texture_view_desc = {
-      .dimension       = WGPUTextureViewDimension_2D,
-      .format          = texture_desc.format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = 1,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
-    };
-    offscreen_pass.color.texture_view
-      = wgpuTextureCreateView(offscreen_pass.color.texture, &texture_view_desc);
-    ASSERT(offscreen_pass.color.texture_view != NULL);
-  }
-
   // Create sampler to sample from the attachment in the fragment shader
   offscreen_pass.sampler = wgpuDeviceCreateSampler(
     wgpu_context->device, &(WGPUSamplerDescriptor){
@@ -185,71 +183,7 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
                           });
   ASSERT(offscreen_pass.sampler != NULL);
 
-  // Depth stencil attachment
-  {
-    WGPUTextureDescriptor texture_desc = {
-      .size          = texture_extent,
-      .mipLevelCount = 1,
-      .sampleCount   = 1,
-      .dimension     = WGPUTextureDimension_2D,
-      .format        = FB_DEPTH_STENCIL_FORMAT,
-      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
-    };
-    offscreen_pass.depth_stencil.texture
-      = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
-    ASSERT(offscreen_pass.depth_stencil.texture != NULL);
-
-    // Create the texture view
-    WGPUTextureViewDescriptor texture_view_desc = {
-      .dimension       = WGPUTextureViewDimension_2D,
-      .format          = texture_desc.format,
-      .baseMipLevel    = 0,
-      .mipLevelCount   = 1,
-      .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
-      .aspect          = WGPUTextureAspect_All,
-    };
-    offscreen_pass.depth_stencil.texture_view = wgpuTextureCreateView(
-      offscreen_pass.depth_stencil.texture, &texture_view_desc);
-    ASSERT(offscreen_pass.depth_stencil.texture_view != NULL);
-  }
-
-  // Create a separate render pass for the offscreen rendering as it may differ
-  // from the one used for scene rendering
-  // Color attachment
-  offscreen_pass.render_pass.color_attachment[0]
-    = (WGPURenderPassColorAttachment) {
-      .view       = offscreen_pass.color.texture_view,
-      .loadOp     = WGPULoadOp_Clear,
-      .storeOp    = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.0f,
-        .g = 0.0f,
-        .b = 0.0f,
-        .a = 0.0f,
-      },
-  };
-
-  // Depth attachment
-  offscreen_pass.render_pass.depth_stencil_attachment
-    = (WGPURenderPassDepthStencilAttachment){
-      .view           = offscreen_pass.depth_stencil.texture_view,
-      .depthLoadOp    = WGPULoadOp_Clear,
-      .depthStoreOp   = WGPUStoreOp_Store,
-      .clearDepth     = 1.0f,
-      .stencilLoadOp  = WGPULoadOp_Clear,
-      .stencilStoreOp = WGPUStoreOp_Store,
-      .clearStencil   = 0,
-    };
-
-  // Render pass descriptor
-  offscreen_pass.render_pass.render_pass_descriptor
-    = (WGPURenderPassDescriptor){
-      .colorAttachmentCount = 1,
-      .colorAttachments     = offscreen_pass.render_pass.color_attachment,
-      .depthStencilAttachment
-      = &offscreen_pass.render_pass.depth_stencil_attachment,
-    };
+  frame_graph.graph = wgpu_frame_graph_create(wgpu_context);
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -309,13 +243,14 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(pipeline_layouts.scene != NULL);
   }
 
-  // Bind group layout for fullscreen radial blur
+  // Bind group layout for fullscreen radial blur, also group 1 of the coarse
+  // radial blur compute shader
   {
     WGPUBindGroupLayoutEntry bgl_entries[3] = {
       [0] = (WGPUBindGroupLayoutEntry) {
         // Binding 0: Fragment shader uniform buffer
         .binding    = 0,
-        .visibility = WGPUShaderStage_Fragment,
+        .visibility = WGPUShaderStage_Fragment | WGPUShaderStage_Compute,
         .buffer = (WGPUBufferBindingLayout) {
           .type             = WGPUBufferBindingType_Uniform,
           .hasDynamicOffset = false,
@@ -326,7 +261,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       [1] = (WGPUBindGroupLayoutEntry) {
         // Binding 1: Fragment shader image view
         .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment,
+        .visibility = WGPUShaderStage_Fragment | WGPUShaderStage_Compute,
         .texture = (WGPUTextureBindingLayout) {
           .sampleType    = WGPUTextureSampleType_Float,
           .viewDimension = WGPUTextureViewDimension_2D,
@@ -337,7 +272,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       [2] = (WGPUBindGroupLayoutEntry) {
         // Binding 2: Fragment shader image sampler
         .binding    = 2,
-        .visibility = WGPUShaderStage_Fragment,
+        .visibility = WGPUShaderStage_Fragment | WGPUShaderStage_Compute,
         .sampler = (WGPUSamplerBindingLayout){
           .type = WGPUSamplerBindingType_Filtering,
         },
@@ -400,65 +335,6 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
                             });
     ASSERT(bind_groups.scene != NULL);
   }
-
-  // Bind group for fullscreen radial blur
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        // Binding 0: Fragment shader uniform buffer
-        .binding = 0,
-        .buffer  = ubo.blur_params.buffer,
-        .offset  = 0,
-        .size    = ubo.blur_params.size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-       // Binding 1: Fragment shader image sampler
-        .binding     = 1,
-        .textureView = offscreen_pass.color.texture_view,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        // Binding 2: Fragment shader image sampler
-        .binding = 2,
-        .sampler = offscreen_pass.sampler,
-      },
-    };
-
-    bind_groups.radial_blur = wgpuDeviceCreateBindGroup(
-      wgpu_context->device,
-      &(WGPUBindGroupDescriptor){
-        .label      = "Fullscreen radial blur rendering bind group",
-        .layout     = bind_group_layouts.radial_blur,
-        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-        .entries    = bg_entries,
-      });
-    ASSERT(bind_groups.radial_blur != NULL);
-  }
-}
-
-static void setup_render_pass(wgpu_context_t* wgpu_context)
-{
-  // Color attachment
-  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
-      .view       = NULL, // Assigned later
-      .loadOp     = WGPULoadOp_Clear,
-      .storeOp    = WGPUStoreOp_Store,
-      .clearColor = (WGPUColor) {
-        .r = 0.025f,
-        .g = 0.025f,
-        .b = 0.025f,
-        .a = 1.0f,
-      },
-  };
-
-  // Depth attachment
-  wgpu_setup_deph_stencil(wgpu_context, NULL);
-
-  // Render pass descriptor
-  render_pass.descriptor = (WGPURenderPassDescriptor){
-    .colorAttachmentCount   = 1,
-    .colorAttachments       = render_pass.color_attachments,
-    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
-  };
 }
 
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
@@ -744,6 +620,24 @@ void update_uniform_buffer_radial_blur(wgpu_example_context_t* context)
                           &ubo_blur_params, ubo.blur_params.size);
 }
 
+// The coarse radial blur runs at the surface resolution and is added to the
+// scene like the fragment shader blur
+static void prepare_coarse_shading(wgpu_context_t* wgpu_context)
+{
+  coarse.shading = wgpu_coarse_shading_create(
+    wgpu_context,
+    &(wgpu_coarse_shading_desc_t){
+      .label                          = "Coarse radial blur",
+      .width                          = wgpu_context->surface.width,
+      .height                         = wgpu_context->surface.height,
+      .wgsl_code                      = coarse_radial_blur_shader_wgsl,
+      .bind_group_layout              = bind_group_layouts.radial_blur,
+      .composite_format               = wgpu_context->swap_chain.format,
+      .composite_depth_stencil_format = wgpu_context->depth_stencil.format,
+      .composite_additive             = true,
+    });
+}
+
 // Prepare and initialize uniform buffer containing shader uniforms
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
@@ -777,7 +671,8 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
-    setup_render_pass(context->wgpu_context);
+    wgpu_setup_deph_stencil(context->wgpu_context, NULL);
+    prepare_coarse_shading(context->wgpu_context);
     prepared = true;
     return 0;
   }
@@ -792,90 +687,251 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     imgui_overlay_checkBox(context->imgui_overlay, "Radial blur", &blur);
     imgui_overlay_checkBox(context->imgui_overlay, "Display render target",
                            &display_texture);
+    imgui_overlay_checkBox(context->imgui_overlay, "Coarse shading",
+                           &coarse.enabled);
+    if (coarse.output) {
+      wgpu_coarse_shading_stats_t coarse_stats;
+      wgpu_coarse_shading_get_stats(coarse.shading, &coarse_stats);
+      imgui_overlay_text("Shaded pixels: %.1f%%",
+                         coarse_stats.shaded_ratio * 100.0f);
+      imgui_overlay_text("Tiles 1x1 / 2x2 / 4x4: %u / %u / %u",
+                         coarse_stats.tile_counts[0],
+                         coarse_stats.tile_counts[1],
+                         coarse_stats.tile_counts[2]);
+    }
+    wgpu_frame_graph_stats_t stats;
+    wgpu_frame_graph_get_stats(frame_graph.graph, &stats);
+    imgui_overlay_text("Frame graph: %u passes, %u culled", stats.pass_count,
+                       stats.culled_pass_count);
   }
 }
 
+// Bind group for fullscreen radial blur, the offscreen color texture is a
+// pooled texture of the frame graph
+static WGPUBindGroup
+create_radial_blur_bind_group(wgpu_context_t* wgpu_context,
+                              WGPUTextureView offscreen_color)
+{
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0: Fragment shader uniform buffer
+      .binding = 0,
+      .buffer  = ubo.blur_params.buffer,
+      .offset  = 0,
+      .size    = ubo.blur_params.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+     // Binding 1: Fragment shader image sampler
+      .binding     = 1,
+      .textureView = offscreen_color,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2: Fragment shader image sampler
+      .binding = 2,
+      .sampler = offscreen_pass.sampler,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Fullscreen radial blur rendering bind group",
+      .layout     = bind_group_layouts.radial_blur,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(bind_group != NULL);
+  return bind_group;
+}
+
+// First render pass: Offscreen rendering
+static void record_offscreen_pass(wgpu_frame_graph_t* graph,
+                                  wgpu_frame_graph_pass_encoder_t encoder,
+                                  void* user_data)
+{
+  UNUSED_VAR(graph);
+
+  wgpu_context_t* wgpu_context    = (wgpu_context_t*)user_data;
+  WGPURenderPassEncoder rpass_enc = encoder.render;
+
+  // Set viewport
+  wgpuRenderPassEncoderSetViewport(rpass_enc, 0.0f, 0.0f,
+                                   (float)offscreen_pass.width,
+                                   (float)offscreen_pass.height, 0.0f, 1.0f);
+
+  // Set scissor rectangle
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u, offscreen_pass.width,
+                                      offscreen_pass.height);
+
+  // 3D scene
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.color_pass);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.scene, 0, 0);
+  wgpu_context->rpass_enc = rpass_enc;
+  wgpu_gltf_model_draw(scene, (wgpu_gltf_model_render_options_t){0});
+  wgpu_context->rpass_enc = NULL;
+}
+
+// Compute pass: Radial blur at a coarse shading rate in flat screen tiles
+static void record_coarse_radial_blur_pass(
+  wgpu_frame_graph_t* graph, wgpu_frame_graph_pass_encoder_t encoder,
+  void* user_data)
+{
+  wgpu_context_t* wgpu_context = (wgpu_context_t*)user_data;
+
+  WGPUTextureView offscreen_color
+    = wgpu_frame_graph_get_texture_view(graph, frame_graph.offscreen_color);
+  WGPUBindGroup radial_blur_bind_group
+    = create_radial_blur_bind_group(wgpu_context, offscreen_color);
+  wgpu_coarse_shading_dispatch(coarse.shading, encoder.compute,
+                               offscreen_color, radial_blur_bind_group);
+  WGPU_RELEASE_RESOURCE(BindGroup, radial_blur_bind_group)
+}
+
+// Second render pass: Scene rendering with applied radial blur
+static void record_composite_pass(wgpu_frame_graph_t* graph,
+                                  wgpu_frame_graph_pass_encoder_t encoder,
+                                  void* user_data)
+{
+  wgpu_context_t* wgpu_context    = (wgpu_context_t*)user_data;
+  WGPURenderPassEncoder rpass_enc = encoder.render;
+
+  // Set viewport
+  wgpuRenderPassEncoderSetViewport(
+    rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
+    (float)wgpu_context->surface.height, 0.0f, 1.0f);
+
+  // Set scissor rectangle
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u,
+                                      wgpu_context->surface.width,
+                                      wgpu_context->surface.height);
+
+  // 3D scene
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipelines.phong_pass);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.scene, 0, 0);
+  wgpu_context->rpass_enc = rpass_enc;
+  wgpu_gltf_model_draw(scene, (wgpu_gltf_model_render_options_t){0});
+  wgpu_context->rpass_enc = NULL;
+
+  // Fullscreen triangle (clipped to a quad) with radial blur
+  if (blur && coarse.output) {
+    wgpu_coarse_shading_composite(coarse.shading, rpass_enc);
+  }
+  else if (blur) {
+    WGPUBindGroup radial_blur_bind_group = create_radial_blur_bind_group(
+      wgpu_context,
+      wgpu_frame_graph_get_texture_view(graph, frame_graph.offscreen_color));
+
+    wgpuRenderPassEncoderSetPipeline(rpass_enc,
+                                     (display_texture) ?
+                                       pipelines.offscreen_display :
+                                       pipelines.radial_blur);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, radial_blur_bind_group, 0,
+                                      0);
+    wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+    WGPU_RELEASE_RESOURCE(BindGroup, radial_blur_bind_group)
+  }
+}
+
+static void declare_frame_graph(wgpu_context_t* wgpu_context)
+{
+  wgpu_frame_graph_t* graph = frame_graph.graph;
+  wgpu_frame_graph_begin(graph);
+
+  frame_graph.offscreen_color = wgpu_frame_graph_create_texture(
+    graph, &(wgpu_frame_graph_texture_desc_t){
+             .label  = "Offscreen color texture",
+             .format = FB_COLOR_FORMAT,
+             .width  = offscreen_pass.width,
+             .height = offscreen_pass.height,
+           });
+  const wgpu_frame_graph_resource_t offscreen_depth
+    = wgpu_frame_graph_create_texture(
+      graph, &(wgpu_frame_graph_texture_desc_t){
+               .label  = "Offscreen depth stencil texture",
+               .format = FB_DEPTH_STENCIL_FORMAT,
+               .width  = offscreen_pass.width,
+               .height = offscreen_pass.height,
+             });
+  const wgpu_frame_graph_resource_t frame_buffer
+    = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Frame buffer",
+               .view   = wgpu_context->swap_chain.frame_buffer,
+               .format = wgpu_context->swap_chain.format,
+             });
+  const wgpu_frame_graph_resource_t depth_stencil
+    = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Depth stencil",
+               .view   = wgpu_context->depth_stencil.texture_view,
+               .format = wgpu_context->depth_stencil.format,
+             });
+
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Offscreen pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_graph.offscreen_color,
+               .clear_value = (WGPUColor){0.0f, 0.0f, 0.0f, 0.0f},
+             },
+             .depth_stencil_attachment = offscreen_depth,
+             .execute_func             = record_offscreen_pass,
+             .user_data                = wgpu_context,
+           });
+
+  // The coarse radial blur is composited instead of the fragment shader blur
+  coarse.output = 0;
+  if (blur && coarse.enabled && !display_texture) {
+    wgpu_coarse_shading_resize(coarse.shading, wgpu_context->surface.width,
+                               wgpu_context->surface.height);
+    coarse.output = wgpu_frame_graph_import_texture(
+      graph, &(wgpu_frame_graph_import_desc_t){
+               .label  = "Coarse radial blur texture",
+               .view   = wgpu_coarse_shading_get_texture_view(coarse.shading),
+               .format = WGPUTextureFormat_RGBA16Float,
+             });
+    wgpu_frame_graph_add_pass(
+      graph, &(wgpu_frame_graph_pass_desc_t){
+               .label        = "Coarse radial blur pass",
+               .type         = FrameGraph_PassType_Compute,
+               .read_count   = 1,
+               .reads[0]     = frame_graph.offscreen_color,
+               .write_count  = 1,
+               .writes[0]    = coarse.output,
+               .execute_func = record_coarse_radial_blur_pass,
+               .user_data    = wgpu_context,
+             });
+  }
+
+  // Without the radial blur nothing reads the offscreen pass results
+  const wgpu_frame_graph_resource_t blur_source
+    = coarse.output ? coarse.output : frame_graph.offscreen_color;
+  wgpu_frame_graph_add_pass(
+    graph, &(wgpu_frame_graph_pass_desc_t){
+             .label                  = "Composite pass",
+             .color_attachment_count = 1,
+             .color_attachments[0]   = {
+               .resource    = frame_buffer,
+               .clear_value = (WGPUColor){0.025f, 0.025f, 0.025f, 1.0f},
+             },
+             .depth_stencil_attachment = depth_stencil,
+             .read_count               = blur ? 1 : 0,
+             .reads[0]                 = blur_source,
+             .execute_func             = record_composite_pass,
+             .user_data                = wgpu_context,
+           });
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  /*
-   * First render pass: Offscreen rendering
-   */
-  {
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc,
-      &offscreen_pass.render_pass.render_pass_descriptor);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
-                                     (float)offscreen_pass.width,
-                                     (float)offscreen_pass.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        offscreen_pass.width,
-                                        offscreen_pass.height);
-
-    // 3D scene
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.color_pass);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.scene, 0, 0);
-    wgpu_gltf_model_draw(scene, (wgpu_gltf_model_render_options_t){0});
-
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-  }
-
-  /*
-   * Second render pass: Scene rendering with applied radial blur
-   */
-  {
-    // Set target frame buffer
-    render_pass.color_attachments[0].view
-      = wgpu_context->swap_chain.frame_buffer;
-
-    // Create render pass encoder for encoding drawing commands
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc, &render_pass.descriptor);
-
-    // Set viewport
-    wgpuRenderPassEncoderSetViewport(
-      wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
-      (float)wgpu_context->surface.height, 0.0f, 1.0f);
-
-    // Set scissor rectangle
-    wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                        wgpu_context->surface.width,
-                                        wgpu_context->surface.height);
-
-    // 3D scene
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.phong_pass);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.scene, 0, 0);
-    wgpu_gltf_model_draw(scene, (wgpu_gltf_model_render_options_t){0});
-
-    // Fullscreen triangle (clipped to a quad) with radial blur
-    if (blur) {
-      wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                       (display_texture) ?
-                                         pipelines.offscreen_display :
-                                         pipelines.radial_blur);
-      wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                        bind_groups.radial_blur, 0, 0);
-      wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
-    }
-
-    // End render pass
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-  }
+  // Offscreen and composite pass
+  declare_frame_graph(wgpu_context);
+  wgpu_frame_graph_execute(frame_graph.graph, wgpu_context->cmd_enc);
+  wgpu_coarse_shading_resolve(coarse.shading, wgpu_context->cmd_enc);
 
   // Draw ui overlay
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -904,6 +960,7 @@ static int example_draw(wgpu_example_context_t* context)
 
   // Submit frame
   submit_frame(context);
+  wgpu_coarse_shading_end_frame(coarse.shading);
 
   return 0;
 }
@@ -926,11 +983,8 @@ static void example_destroy(wgpu_example_context_t* context)
   wgpu_destroy_texture(&textures.gradient);
   wgpu_gltf_model_destroy(scene);
 
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.color.texture)
-  WGPU_RELEASE_RESOURCE(Texture, offscreen_pass.depth_stencil.texture)
-
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.color.texture_view)
-  WGPU_RELEASE_RESOURCE(TextureView, offscreen_pass.depth_stencil.texture_view)
+  wgpu_frame_graph_destroy(frame_graph.graph);
+  wgpu_coarse_shading_destroy(coarse.shading);
 
   WGPU_RELEASE_RESOURCE(Sampler, offscreen_pass.sampler)
 
@@ -946,7 +1000,6 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.scene)
 
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.scene)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.radial_blur)
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.scene)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.radial_blur)
@@ -3,12 +3,11 @@
 
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../webgpu/frame_capture.h"
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
-
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Saving Framebuffer To Screenshot
  *
@@ -20,13 +19,20 @@
  * sufficient for "taking a screenshot," with the added benefit that this method
  * would not require a window to be created.
  *
+ * The captures go through a ring of readback buffers and are encoded on a
+ * worker thread, so frame sequences can be recorded without hurting the frame
+ * times, e.g. --capture-frames=100 --capture-every=10 writes every 10th of the
+ * first 1000 frames, --capture-raw writes raw RGBA instead of PNG files.
+ *
+ * The dragon is loaded with its triangles reordered for the post-transform
+ * vertex cache and overdraw, its vertices in the order of first use and 16-bit
+ * indices, which keeps the draw cheap while frame sequences are captured.
+ *
  * Ref:
  * https://github.com/gfx-rs/wgpu/tree/master/wgpu/examples/capture
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/screenshot
  * -------------------------------------------------------------------------- */
 
-#define COPY_BYTES_PER_ROW_ALIGNMENT 256
-
 static struct gltf_model_t* dragon;
 static wgpu_buffer_t uniform_buffer;
 
@@ -40,9 +46,18 @@ static WGPUPipelineLayout pipeline_layout;
 static WGPUBindGroupLayout bind_group_layout;
 static WGPUBindGroup bind_group;
 
-static const char* screenshot_filename = "Screenshot.png";
-static bool screenshot_requested       = false;
-static bool screenshot_saved           = false;
+static const char* screenshot_filename_prefix = "Screenshot";
+static bool screenshot_requested              = false;
+
+// Frame capture, a capture sequence is requested from the command line
+static wgpu_frame_capture_t* frame_capture = NULL;
+static struct {
+  int32_t frames; // Frames in the sequence, 0 = until exit
+  int32_t every;  // Capture every n-th frame, 0 = no sequence
+  int32_t raw;
+} capture_sequence = {0};
+static uint32_t frame_index              = 0;
+static uint32_t sequence_frames_recorded = 0;
 
 static struct scene_rendering_t {
   WGPURenderPipeline pipeline;
@@ -65,17 +80,6 @@ static struct offscreen_rendering_t {
     WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
     WGPURenderPassDescriptor render_pass_descriptor;
   } render_pass;
-  // The pixel buffer lets us retrieve the framebuffer data as an array
-  struct {
-    wgpu_buffer_t buffer;
-    bool buffer_mapped;
-    struct {
-      uint64_t width;
-      uint64_t height;
-      uint64_t unpadded_bytes_per_row;
-      uint64_t padded_bytes_per_row;
-    } buffer_dimensions;
-  } pixel_data;
 } offscreen_rendering = {0};
 
 static const char* example_title = "Saving Framebuffer To Screenshot";
@@ -95,7 +99,9 @@ static void load_assets(wgpu_context_t* wgpu_context)
 {
   const uint32_t gltf_loading_flags
     = WGPU_GLTF_FileLoadingFlags_PreTransformVertices
-      | WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors;
+      | WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors
+      | WGPU_GLTF_FileLoadingFlags_OptimizeMeshes
+      | WGPU_GLTF_FileLoadingFlags_CompactIndices;
   dragon = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
     .wgpu_context       = wgpu_context,
     .filename           = "models/chinesedragon.gltf",
@@ -104,46 +110,8 @@ static void load_assets(wgpu_context_t* wgpu_context)
   ASSERT(dragon != NULL);
 }
 
-// It is a WebGPU requirement that ImageCopyBuffer.layout.bytes_per_row %
-// wgpu::COPY_BYTES_PER_ROW_ALIGNMENT == 0 So we calculate padded_bytes_per_row
-// by rounding unpadded_bytes_per_row up to the next multiple of
-// wgpu::COPY_BYTES_PER_ROW_ALIGNMENT.
-// https://en.wikipedia.org/wiki/Data_structure_alignment#Computing_padding
-static void calculate_buffer_dimensions(uint32_t width, uint32_t height)
-{
-  uint32_t bytes_per_pixel        = sizeof(uint8_t) * 4;
-  uint32_t unpadded_bytes_per_row = width * bytes_per_pixel;
-  uint32_t align                  = (uint32_t)COPY_BYTES_PER_ROW_ALIGNMENT;
-  uint32_t padded_bytes_per_row_padding
-    = (align - unpadded_bytes_per_row % align) % align;
-  uint32_t padded_bytes_per_row
-    = unpadded_bytes_per_row + padded_bytes_per_row_padding;
-  {
-    offscreen_rendering.pixel_data.buffer_dimensions.width  = width;
-    offscreen_rendering.pixel_data.buffer_dimensions.height = height;
-    offscreen_rendering.pixel_data.buffer_dimensions.unpadded_bytes_per_row
-      = unpadded_bytes_per_row;
-    offscreen_rendering.pixel_data.buffer_dimensions.padded_bytes_per_row
-      = padded_bytes_per_row;
-  }
-}
-
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
 {
-  // Prepare pixel output buffer
-  calculate_buffer_dimensions(wgpu_context->surface.width,
-                              wgpu_context->surface.height);
-  // The output buffer lets us retrieve the data as an array
-  offscreen_rendering.pixel_data.buffer = wgpu_create_buffer(
-    wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
-      .size
-      = (uint64_t)(offscreen_rendering.pixel_data.buffer_dimensions
-                     .padded_bytes_per_row
-                   * offscreen_rendering.pixel_data.buffer_dimensions.height),
-    });
-
   // Attachment formats
   offscreen_rendering.color.format = WGPUTextureFormat_RGBA8UnormSrgb;
   offscreen_rendering.depth_stencil.format
@@ -151,8 +119,8 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
 
   // Create the texture
   WGPUExtent3D texture_extent = {
-    .width  = offscreen_rendering.pixel_data.buffer_dimensions.width,
-    .height = offscreen_rendering.pixel_data.buffer_dimensions.height,
+    .width              = wgpu_context->surface.width,
+    .height             = wgpu_context->surface.height,
     .depthOrArrayLayers = 1,
   };
 
@@ -249,6 +217,19 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
       .depthStencilAttachment
       = &offscreen_rendering.render_pass.depth_stencil_attachment,
     };
+
+  // Readback ring and worker thread for writing the captured images
+  frame_capture = wgpu_frame_capture_create(
+    wgpu_context, &(wgpu_frame_capture_desc_t){
+                    .width           = wgpu_context->surface.width,
+                    .height          = wgpu_context->surface.height,
+                    .texture_format  = offscreen_rendering.color.format,
+                    .file_format     = capture_sequence.raw ?
+                                         FrameCapture_FileFormat_Raw :
+                                         FrameCapture_FileFormat_PNG,
+                    .filename_prefix = screenshot_filename_prefix,
+                  });
+  ASSERT(frame_capture != NULL);
 }
 
 static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
@@ -478,9 +459,13 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     if (imgui_overlay_button(context->imgui_overlay, "Take screenshot")) {
       screenshot_requested = true;
     }
-    if (screenshot_saved) {
-      imgui_overlay_text("Screenshot saved as: %s", screenshot_filename);
+    wgpu_frame_capture_stats_t stats;
+    wgpu_frame_capture_get_stats(frame_capture, &stats);
+    if (stats.written > 0) {
+      imgui_overlay_text("Screenshot saved as: %s", stats.last_filename);
     }
+    imgui_overlay_text("Captures: %u written, %u dropped", stats.written,
+                       stats.dropped);
   }
 }
 
@@ -520,33 +505,17 @@ build_command_buffer(wgpu_context_t* wgpu_context,
   return command_buffer;
 }
 
+// Records the copy of the offscreen frame buffer into a readback buffer of
+// the frame capture
 static WGPUCommandBuffer
-build_copy_texture_to_buffer_command_buffer(wgpu_context_t* wgpu_context)
+build_capture_command_buffer(wgpu_context_t* wgpu_context, bool* recorded)
 {
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  wgpuCommandEncoderCopyTextureToBuffer(wgpu_context->cmd_enc,
-    // Source
-    &(WGPUImageCopyTexture){
-      .texture  = offscreen_rendering.color.texture,
-      .mipLevel =0,
-    },
-    // Destination
-    &(WGPUImageCopyBuffer){
-      .buffer  = offscreen_rendering.pixel_data.buffer.buffer,
-      .layout = (WGPUTextureDataLayout) {
-        .offset      = 0,
-        .bytesPerRow = offscreen_rendering.pixel_data.buffer_dimensions.padded_bytes_per_row,
-        .rowsPerImage = offscreen_rendering.pixel_data.buffer_dimensions.height,
-      },
-    },
-    // CopySize
-    &(WGPUExtent3D) {
-      .width  = offscreen_rendering.pixel_data.buffer_dimensions.width,
-      .height = offscreen_rendering.pixel_data.buffer_dimensions.height,
-      .depthOrArrayLayers = 1,
-    });
+  *recorded
+    = wgpu_frame_capture_record(frame_capture, wgpu_context->cmd_enc,
+                                offscreen_rendering.color.texture, frame_index);
 
   // Get command buffer
   WGPUCommandBuffer command_buffer
@@ -556,31 +525,17 @@ build_copy_texture_to_buffer_command_buffer(wgpu_context_t* wgpu_context)
   return command_buffer;
 }
 
-static void read_buffer_map_cb(WGPUBufferMapAsyncStatus status, void* user_data)
+// Whether the frame belongs to the capture sequence of the command line
+static bool is_capture_sequence_frame(void)
 {
-  UNUSED_VAR(user_data);
-
-  if (status == WGPUBufferMapAsyncStatus_Success) {
-    int w            = offscreen_rendering.pixel_data.buffer_dimensions.width;
-    int h            = offscreen_rendering.pixel_data.buffer_dimensions.height;
-    int channels_num = 4;
-
-    size_t pixels_size     = w * h * channels_num;
-    uint8_t* pixels        = (uint8_t*)malloc(pixels_size);
-    uint8_t const* mapping = (uint8_t*)wgpuBufferGetConstMappedRange(
-      offscreen_rendering.pixel_data.buffer.buffer, 0,
-      sizeof(offscreen_rendering.pixel_data.buffer.size));
-    ASSERT(mapping);
-    memcpy(pixels, mapping, pixels_size);
-    stbi_write_png(screenshot_filename, w, h, channels_num, pixels,
-                   w * sizeof(int));
-    wgpuBufferUnmap(offscreen_rendering.pixel_data.buffer.buffer);
-    free(pixels);
-
-    offscreen_rendering.pixel_data.buffer_mapped = false;
-    screenshot_requested                         = false;
-    screenshot_saved                             = true;
+  if (capture_sequence.every <= 0) {
+    return false;
+  }
+  if (capture_sequence.frames > 0
+      && sequence_frames_recorded >= (uint32_t)capture_sequence.frames) {
+    return false;
   }
+  return (frame_index % (uint32_t)capture_sequence.every) == 0;
 }
 
 static int example_draw(wgpu_example_context_t* context)
@@ -597,33 +552,35 @@ static int example_draw(wgpu_example_context_t* context)
     = offscreen_rendering.color.texture_view;
 
   // Command buffer to be submitted to the queue
-  bool buffer_mapped   = offscreen_rendering.pixel_data.buffer_mapped;
-  bool save_screenshot = !buffer_mapped && screenshot_requested;
-  wgpu_context->submit_info.command_buffer_count = save_screenshot ? 3 : 1;
+  const bool sequence_frame = is_capture_sequence_frame();
+  const bool capture        = screenshot_requested || sequence_frame;
+  wgpu_context->submit_info.command_buffer_count = capture ? 3 : 1;
   wgpu_context->submit_info.command_buffers[0]   = build_command_buffer(
       wgpu_context, &scene_rendering.render_pass.render_pass_descriptor,
       scene_rendering.pipeline, true);
-  if (save_screenshot) {
+  if (capture) {
+    bool recorded = false;
     wgpu_context->submit_info.command_buffers[1] = build_command_buffer(
       wgpu_context, &offscreen_rendering.render_pass.render_pass_descriptor,
       offscreen_rendering.pipeline, false);
     wgpu_context->submit_info.command_buffers[2]
-      = build_copy_texture_to_buffer_command_buffer(wgpu_context);
+      = build_capture_command_buffer(wgpu_context, &recorded);
+    // A dropped capture is retried in the next frame
+    if (recorded) {
+      screenshot_requested = false;
+      sequence_frames_recorded += sequence_frame ? 1 : 0;
+    }
   }
 
   // Submit to queue
   submit_command_buffers(context);
 
+  // Read back the captured frame asynchronously
+  wgpu_frame_capture_end_frame(frame_capture);
+
   // Submit frame
   submit_frame(context);
-
-  // Read query results for displaying in next frame
-  if (save_screenshot) {
-    offscreen_rendering.pixel_data.buffer_mapped = true;
-    wgpuBufferMapAsync(
-      offscreen_rendering.pixel_data.buffer.buffer, WGPUMapMode_Read, 0,
-      offscreen_rendering.pixel_data.buffer.size, read_buffer_map_cb, NULL);
-  }
+  ++frame_index;
 
   return 0;
 }
@@ -655,7 +612,9 @@ static void example_destroy(wgpu_example_context_t* context)
                         offscreen_rendering.depth_stencil.texture_view)
 
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, offscreen_rendering.pixel_data.buffer.buffer)
+
+  // Writes the pending captures
+  wgpu_frame_capture_destroy(frame_capture);
 
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
@@ -665,8 +624,53 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(RenderPipeline, offscreen_rendering.pipeline)
 }
 
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[2]   = {"--capture-frames=", "--capture-every="};
+  char* filters_flag[2] = {"--capture-raw", "--help-screenshot"};
+  char* filtered_argv[1 + 2 + 2 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option options[] = {
+    OPT_INTEGER(0, "capture-frames", &capture_sequence.frames,
+                "number of frames to capture, 0 = until exit", NULL, 0, 0),
+    OPT_INTEGER(0, "capture-every", &capture_sequence.every,
+                "capture every n-th frame (default 1 with --capture-frames)",
+                NULL, 0, 0),
+    OPT_BOOLEAN(0, "capture-raw", &capture_sequence.raw,
+                "write raw RGBA images instead of PNG files", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-screenshot", NULL, "show the screenshot options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  capture_sequence.frames = MAX(0, capture_sequence.frames);
+  if (capture_sequence.frames > 0 && capture_sequence.every <= 0) {
+    capture_sequence.every = 1;
+  }
+}
+
 void example_screenshot(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
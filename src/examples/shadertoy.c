@@ -3,17 +3,38 @@
 
 #include <string.h>
 
+#include "../core/argparse.h"
+#include "../webgpu/dynamic_resolution.h"
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/profiler.h"
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Shadertoy
  *
  * Minimal "shadertoy launcher" using WebGPU, demonstrating how to load an
  * example Shadertoy shader 'Cube lines'.
  *
+ * The shader renders into a persistent target at a scale of the surface size,
+ * which is upscaled into the frame buffer. The scale is either fixed or
+ * adjusted to a target frame time by the dynamic resolution. For static
+ * scenes the progressive mode pauses the time and renders 1/N of the tiles of
+ * the target per frame, once all tiles are rendered only the upscale pass
+ * remains until the mouse or the shader changes.
+ *
+ * --shader=<file> loads another fragment shader (.spv or .wgsl) with the
+ * inputs of main.frag, with --watch-shaders it is reloaded when it changes.
+ *
  * Ref:
  * https://www.shadertoy.com/view/NslGRN
  * https://www.saschawillems.de/blog/2016/08/13/vulkan-tutorial-on-rendering-a-fullscreen-quad-without-buffers/
  * -------------------------------------------------------------------------- */
 
+// Side of the progressive rendering tiles in pixels
+#define PROGRESSIVE_TILE_SIZE 128u
+
+// Fragment shader file, --shader=<file>
+static const char* fragment_shader_file = "shaders/shadertoy/main.frag.spv";
+
 // Uniform buffer block object
 static wgpu_buffer_t uniform_buffer_vs = {0};
 
@@ -33,25 +54,52 @@ static struct {
   vec2 initial_mouse_position;
   vec2 prev_mouse_position;
   vec2 mouse_drag_distance;
+  // Surface pixel coordinates, iMouse holds the render target coordinates
+  vec2 position;
   bool dragging;
 } mouse_state = {
   .initial_mouse_position = GLM_VEC2_ZERO_INIT,
   .prev_mouse_position    = GLM_VEC2_ZERO_INIT,
   .mouse_drag_distance    = GLM_VEC2_ZERO_INIT,
+  .position               = GLM_VEC2_ZERO_INIT,
   .dragging               = false,
 };
 
+// Persistent render target at the render scale of the surface size
+static struct {
+  WGPUTexture texture;
+  WGPUTextureView view;
+  uint32_t width;
+  uint32_t height;
+} render_target = {0};
+
+// Render scale and progressive rendering settings
+static struct {
+  float render_scale;
+  bool auto_scale;
+  bool progressive;
+  int32_t tile_slices;
+  // Next slice of the tiles and slices left until the target is complete
+  uint32_t slice;
+  uint32_t remaining_slices;
+  // Shader time while progressive rendering
+  float paused_time;
+} settings = {
+  .render_scale = 1.0f,
+  .tile_slices  = 4,
+};
+
 // The pipeline layout
 static WGPUPipelineLayout pipeline_layout;
 
 // Pipeline
 static WGPURenderPipeline pipeline;
 
-// Render pass descriptor for frame buffer writes
+// Render pass descriptors for render target and frame buffer writes
 static struct {
   WGPURenderPassColorAttachment color_attachments[1];
   WGPURenderPassDescriptor descriptor;
-} render_pass;
+} render_pass, upscale_pass;
 
 // The bind group layout
 static WGPUBindGroupLayout bind_group_layout;
@@ -132,21 +180,108 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
     .colorAttachmentCount = 1,
     .colorAttachments     = render_pass.color_attachments,
   };
+
+  // Upscale pass, the upscaled target covers the frame buffer
+  upscale_pass.color_attachments[0] = render_pass.color_attachments[0];
+  upscale_pass.descriptor           = (WGPURenderPassDescriptor){
+    .colorAttachmentCount = 1,
+    .colorAttachments     = upscale_pass.color_attachments,
+  };
+}
+
+// Restarts the progressive rendering of the tiles
+static void restart_progressive(void)
+{
+  settings.remaining_slices = (uint32_t)settings.tile_slices;
+}
+
+static void on_pipeline_ready(void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  // Created or replaced by a reloaded shader
+  restart_progressive();
+}
+
+static float get_render_scale(wgpu_example_context_t* context)
+{
+  return settings.auto_scale ?
+           wgpu_dynamic_resolution_get_scale(context->dynamic_resolution) :
+           settings.render_scale;
+}
+
+static void release_render_target(void)
+{
+  WGPU_RELEASE_RESOURCE(TextureView, render_target.view)
+  WGPU_RELEASE_RESOURCE(Texture, render_target.texture)
+}
+
+// (Re)creates the render target if the surface size or the render scale
+// changed
+static void update_render_target(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  const float scale            = get_render_scale(context);
+  const uint32_t width
+    = MAX((uint32_t)((float)wgpu_context->surface.width * scale), 1u);
+  const uint32_t height
+    = MAX((uint32_t)((float)wgpu_context->surface.height * scale), 1u);
+  if (render_target.texture != NULL && render_target.width == width
+      && render_target.height == height) {
+    return;
+  }
+
+  release_render_target();
+  render_target.width  = width;
+  render_target.height = height;
+
+  WGPUTextureDescriptor texture_desc = {
+    .label         = "Shadertoy render target",
+    .usage         = WGPUTextureUsage_RenderAttachment
+             | WGPUTextureUsage_TextureBinding,
+    .dimension     = WGPUTextureDimension_2D,
+    .size          = (WGPUExtent3D) {
+      .width              = width,
+      .height             = height,
+      .depthOrArrayLayers = 1,
+    },
+    .format        = wgpu_context->swap_chain.format,
+    .mipLevelCount = 1,
+    .sampleCount   = 1,
+  };
+  render_target.texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  ASSERT(render_target.texture != NULL);
+
+  render_target.view = wgpuTextureCreateView(
+    render_target.texture, &(WGPUTextureViewDescriptor){
+                             .label           = "Shadertoy render target view",
+                             .format          = texture_desc.format,
+                             .dimension       = WGPUTextureViewDimension_2D,
+                             .baseMipLevel    = 0,
+                             .mipLevelCount   = 1,
+                             .baseArrayLayer  = 0,
+                             .arrayLayerCount = 1,
+                           });
+  ASSERT(render_target.view != NULL);
+
+  restart_progressive();
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
 {
-  // iResolution: viewport resolution (in pixels)
-  shader_inputs_ubo.iResolution[0]
-    = (float)context->wgpu_context->surface.width;
-  shader_inputs_ubo.iResolution[1]
-    = (float)context->wgpu_context->surface.height;
+  // iResolution: viewport resolution (in pixels), the render target size
+  shader_inputs_ubo.iResolution[0] = (float)render_target.width;
+  shader_inputs_ubo.iResolution[1] = (float)render_target.height;
 
-  // iTime: Time since the shader started (in seconds)
-  shader_inputs_ubo.iTime = context->run_time;
+  // iTime: Time since the shader started (in seconds), paused while rendering
+  // progressively
+  shader_inputs_ubo.iTime
+    = settings.progressive ? settings.paused_time : context->run_time;
 
   // iTimeDelta: time between each frame (duration since the previous frame)
-  shader_inputs_ubo.iTimeDelta = context->frame_timer;
+  shader_inputs_ubo.iTimeDelta
+    = settings.progressive ? 0.0f : context->frame_timer;
 
   // iFrame: shader playback frame
   shader_inputs_ubo.iFrame = (int)context->frame.index;
@@ -161,13 +296,17 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
   else if (mouse_state.dragging && context->mouse_buttons.left) {
     glm_vec2_sub(context->mouse_position, mouse_state.prev_mouse_position,
                  mouse_state.mouse_drag_distance);
-    glm_vec2_add(shader_inputs_ubo.iMouse, mouse_state.mouse_drag_distance,
-                 shader_inputs_ubo.iMouse);
+    glm_vec2_add(mouse_state.position, mouse_state.mouse_drag_distance,
+                 mouse_state.position);
     glm_vec2_copy(context->mouse_position, mouse_state.prev_mouse_position);
+    restart_progressive();
   }
   else if (mouse_state.dragging && !context->mouse_buttons.left) {
     mouse_state.dragging = false;
   }
+  const float scale = (float)render_target.width
+                      / (float)MAX(context->wgpu_context->surface.width, 1u);
+  glm_vec2_scale(mouse_state.position, scale, shader_inputs_ubo.iMouse);
 
   // iDate: year, month, day, time in seconds
   struct date_t current_date;
@@ -187,6 +326,8 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
 
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
+  update_render_target(context);
+
   // Create the uniform bind group (note 'rotDeg' is copied here, not bound in
   // any way)
   uniform_buffer_vs = wgpu_create_buffer(
@@ -234,9 +375,9 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
                     wgpu_context, &(wgpu_fragment_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Fragment shader SPIR-V
+                      // Fragment shader SPIR-V or WGSL
                       .label = "main_fragment_shader",
-                      .file  = "shaders/shadertoy/main.frag.spv",
+                      .file  = fragment_shader_file,
                     },
                     .target_count = 1,
                     .targets      = &color_target_state,
@@ -249,16 +390,19 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
         .sample_count = 1,
       });
 
-  // Create rendering pipeline using the specified states
-  pipeline = wgpuDeviceCreateRenderPipeline(
-    wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                            .label       = "shadertoy_render_pipeline",
-                            .layout      = pipeline_layout,
-                            .primitive   = primitive_state,
-                            .vertex      = vertex_state,
-                            .fragment    = &fragment_state,
-                            .multisample = multisample_state,
-                          });
+  // Create rendering pipeline using the specified states, asynchronously
+  // created pipelines are recreated when the shader files are reloaded
+  wgpu_create_render_pipeline_async(
+    wgpu_context,
+    &(WGPURenderPipelineDescriptor){
+      .label       = "shadertoy_render_pipeline",
+      .layout      = pipeline_layout,
+      .primitive   = primitive_state,
+      .vertex      = vertex_state,
+      .fragment    = &fragment_state,
+      .multisample = multisample_state,
+    },
+    &pipeline, on_pipeline_ready, NULL);
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
@@ -268,6 +412,8 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
+    // The render scale is fixed until auto scale is enabled
+    wgpu_dynamic_resolution_set_enabled(context->dynamic_resolution, false);
     prepare_uniform_buffers(context);
     setup_pipeline_layout(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
@@ -280,43 +426,136 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Auto render scale",
+                               &settings.auto_scale)) {
+      wgpu_dynamic_resolution_set_enabled(context->dynamic_resolution,
+                                          settings.auto_scale);
+    }
+    if (!settings.auto_scale) {
+      imgui_overlay_slider_float(context->imgui_overlay, "Render scale",
+                                 &settings.render_scale, 0.25f, 1.0f);
+    }
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Progressive",
+                               &settings.progressive)) {
+      settings.paused_time = context->run_time;
+      restart_progressive();
+    }
+    if (settings.progressive
+        && imgui_overlay_slider_int(context->imgui_overlay, "Tile slices",
+                                    &settings.tile_slices, 2, 16)) {
+      restart_progressive();
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Render target: %ux%u", render_target.width,
+                       render_target.height);
+    if (settings.progressive) {
+      imgui_overlay_text("Slices left: %u", settings.remaining_slices);
+    }
+  }
+}
+
+// Draws the fullscreen triangle into the tiles of the current slice
+static void draw_progressive_slice(WGPURenderPassEncoder rpass_enc)
 {
-  // Set target frame buffer
-  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+  const uint32_t tiles_x
+    = (render_target.width + PROGRESSIVE_TILE_SIZE - 1) / PROGRESSIVE_TILE_SIZE;
+  const uint32_t tiles_y = (render_target.height + PROGRESSIVE_TILE_SIZE - 1)
+                           / PROGRESSIVE_TILE_SIZE;
+  const uint32_t tile_slices = (uint32_t)settings.tile_slices;
+  for (uint32_t y = 0; y < tiles_y; ++y) {
+    for (uint32_t x = 0; x < tiles_x; ++x) {
+      // Interleaved tiles spread the slice over the target
+      if ((x + y * tiles_x) % tile_slices != settings.slice) {
+        continue;
+      }
+      const uint32_t tile_x = x * PROGRESSIVE_TILE_SIZE;
+      const uint32_t tile_y = y * PROGRESSIVE_TILE_SIZE;
+      wgpuRenderPassEncoderSetScissorRect(
+        rpass_enc, tile_x, tile_y,
+        MIN(PROGRESSIVE_TILE_SIZE, render_target.width - tile_x),
+        MIN(PROGRESSIVE_TILE_SIZE, render_target.height - tile_y));
+      wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+    }
+  }
+  settings.slice = (settings.slice + 1) % tile_slices;
+  --settings.remaining_slices;
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
 
   // Create command encoder
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Create render pass encoder for encoding drawing commands
-  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-    wgpu_context->cmd_enc, &render_pass.descriptor);
-
-  // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
-
-  // Set the bind group
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
-                                    0);
-
-  // Set viewport
-  wgpuRenderPassEncoderSetViewport(
-    wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
-    (float)wgpu_context->surface.height, 0.0f, 1.0f);
+  // Render the shader into the render target, a completed progressive target
+  // is kept as it is
+  const bool render_shader
+    = pipeline != NULL
+      && (!settings.progressive || settings.remaining_slices > 0);
+  if (render_shader) {
+    // The tiles of the other slices are kept
+    render_pass.color_attachments[0].view = render_target.view;
+    render_pass.color_attachments[0].loadOp
+      = settings.progressive ? WGPULoadOp_Load : WGPULoadOp_Clear;
+
+    wgpu_profiler_begin_scope(wgpu_context->profiler, wgpu_context->cmd_enc,
+                              "Shadertoy");
+
+    // Create render pass encoder for encoding drawing commands
+    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &render_pass.descriptor);
+
+    // Bind the rendering pipeline
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
+
+    // Set the bind group
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group,
+                                      0, 0);
+
+    // Set viewport
+    wgpuRenderPassEncoderSetViewport(
+      wgpu_context->rpass_enc, 0.0f, 0.0f, (float)render_target.width,
+      (float)render_target.height, 0.0f, 1.0f);
+
+    if (settings.progressive) {
+      draw_progressive_slice(wgpu_context->rpass_enc);
+    }
+    else {
+      // Set scissor rectangle
+      wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
+                                          render_target.width,
+                                          render_target.height);
+
+      // Draw quad
+      wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+    }
 
-  // Set scissor rectangle
-  wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
-                                      wgpu_context->surface.width,
-                                      wgpu_context->surface.height);
+    // End render pass
+    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
-  // Draw quad
-  wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+    wgpu_profiler_end_scope(wgpu_context->profiler, wgpu_context->cmd_enc);
+  }
 
-  // End render pass
+  // Upscale the render target into the frame buffer
+  upscale_pass.color_attachments[0].view
+    = wgpu_context->swap_chain.frame_buffer;
+  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    wgpu_context->cmd_enc, &upscale_pass.descriptor);
+  wgpu_dynamic_resolution_upscale(context->dynamic_resolution,
+                                  wgpu_context->rpass_enc, render_target.view);
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
+  // Draw ui overlay
+  draw_ui(context, example_on_update_ui_overlay);
+
   // Get command buffer
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
@@ -329,6 +568,9 @@ static int example_draw(wgpu_example_context_t* context)
 {
   wgpu_context_t* wgpu_context = context->wgpu_context;
 
+  // Follow the surface size and the render scale
+  update_render_target(context);
+
   // Update the uniform buffers
   update_uniform_buffers(context);
 
@@ -338,7 +580,7 @@ static int example_draw(wgpu_example_context_t* context)
   // Command buffer to be submitted to the queue
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   // Submit to queue
   submit_command_buffers(context);
@@ -365,15 +607,55 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
+  release_render_target();
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]   = {"--shader="};
+  char* filters_flag[1] = {"--help-shadertoy"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option options[] = {
+    OPT_STRING(0, "shader", &fragment_shader_file,
+               "fragment shader file (.spv or .wgsl) with the inputs of "
+               "main.frag, reloaded with --watch-shaders",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-shadertoy", NULL, "show the shadertoy options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
 }
 
 void example_shadertoy(int argc, char* argv[])
 {
+  parse_arguments(argc, argv);
+
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-     .title = example_title,
-     .vsync = true,
+     .title              = example_title,
+     .overlay            = true,
+     .vsync              = true,
+     .dynamic_resolution = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
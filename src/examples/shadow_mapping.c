@@ -2,8 +2,10 @@
 #include "examples.h"
 #include "meshes.h"
 
+#include <float.h>
 #include <string.h>
 
+#include "../core/cascaded_shadows.h"
 #include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
@@ -11,6 +13,12 @@
  *
  * This example shows how to sample from a depth texture to render shadows.
  *
+ * The shadows use cascaded shadow maps: the view range of the camera is split
+ * into 2 - 4 cascades, each with a light projection fitted tightly around its
+ * slice of the camera frustum and its own layer in a depth texture array. The
+ * casters are culled per cascade against the light frustum, and a cascade is
+ * only rendered again when its light matrix changed, the casters are static.
+ *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/blob/main/src/pages/samples/shadowMapping.ts
  * stanford-dragon: https://github.com/hughsk/stanford-dragon
@@ -20,12 +28,55 @@ static struct {
   vec3 up_vector;
   vec3 origin;
   mat4 projection_matrix;
+  mat4 view_matrix;
   mat4 view_proj_matrix;
 } view_matrices = {0};
 
 static stanford_dragon_mesh_t stanford_dragon_mesh = {0};
 static const uint32_t shadow_depth_texture_size    = 1024;
 
+// Camera parameters, the cascades cover the first shadow_distance units
+static const float camera_fov_y        = (2.0f * PI) / 5.0f;
+static const float camera_near         = 1.0f;
+static const float camera_far          = 2000.0f;
+static const float shadow_distance     = 300.0f;
+static const float shadow_split_lambda = 0.75f;
+
+// Light shining from {50, 100, -100} towards the origin
+static vec3 light_direction = {-0.333333f, -0.666667f, 0.666667f};
+
+static cascaded_shadows_t cascaded_shadows = {0};
+
+// Draw ranges of the meshes with their world space bounding spheres, used for
+// the per-cascade culling
+static struct {
+  uint32_t first_index;
+  uint32_t index_count;
+  vec3 center;
+  float radius;
+} shadow_casters[2] = {0};
+
+// Bounding sphere of all casters
+static struct {
+  vec3 center;
+  float radius;
+} scene_bounds = {0};
+
+// Scene uniforms of the color rendering pipeline
+static struct {
+  mat4 light_view_proj_matrices[CASCADED_SHADOWS_MAX_CASCADES];
+  mat4 camera_view_proj_matrix;
+  vec4 cascade_splits;
+  vec3 light_direction; // Towards the light
+  uint32_t cascade_count;
+  uint32_t show_cascades;
+  uint32_t padding[3];
+} scene_uniforms = {0};
+
+// The light matrices of the shadow passes are 256-byte aligned for dynamic
+// offsets
+#define CASCADE_UNIFORM_STRIDE 256u
+
 // Vertex and index buffers
 static WGPUBuffer vertex_buffer;
 static WGPUBuffer index_buffer;
@@ -35,6 +86,7 @@ static uint32_t index_count;
 static struct {
   WGPUBuffer model;
   WGPUBuffer scene;
+  WGPUBuffer cascades;
 } uniform_buffers = {0};
 
 // The pipeline layout
@@ -83,15 +135,52 @@ static struct {
   } depth_texture;
   struct {
     WGPUTexture texture;
-    WGPUTextureView view;
+    WGPUTextureView view; // All cascades, for sampling
+    WGPUTextureView layer_views[CASCADED_SHADOWS_MAX_CASCADES];
   } shadow_depth_texture;
   WGPUSampler sampler;
 } textures = {0};
 
+// Settings
+static struct {
+  int32_t cascade_count_index;
+  bool show_cascades;
+} settings = {
+  .cascade_count_index = 1,
+};
+
+static const char* cascade_count_items[3] = {"2", "3", "4"};
+
+// Shadow passes and caster draws of the last frame
+static struct {
+  uint32_t shadow_passes;
+  uint32_t caster_draws;
+} shadow_stats = {0};
+
 // Other variables
 static const char* example_title = "Shadow Mapping";
 static bool prepared             = false;
 
+// Bounding sphere around the center of the bounding box of the positions
+static void compute_bounding_sphere(const float* positions, uint64_t count,
+                                    vec3 center, float* radius)
+{
+  vec3 min = {FLT_MAX, FLT_MAX, FLT_MAX}, max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint64_t i = 0; i < count; ++i) {
+    vec3 position = {positions[3 * i], positions[3 * i + 1],
+                     positions[3 * i + 2]};
+    glm_vec3_minv(min, position, min);
+    glm_vec3_maxv(max, position, max);
+  }
+  glm_vec3_center(min, max, center);
+  *radius = 0.0f;
+  for (uint64_t i = 0; i < count; ++i) {
+    vec3 position = {positions[3 * i], positions[3 * i + 1],
+                     positions[3 * i + 2]};
+    *radius       = MAX(*radius, glm_vec3_distance(center, position));
+  }
+}
+
 // Prepare vertex and index buffers for the Stanford dragon mesh
 static void
 prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context,
@@ -137,6 +226,16 @@ prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context,
              sizeof(vec3));
     }
     wgpuBufferUnmap(vertex_buffer);
+
+    // Object space bounding spheres, moved into world space together with the
+    // model
+    compute_bounding_sphere(&dragon_mesh->positions.data[0][0],
+                            dragon_mesh->positions.count,
+                            shadow_casters[0].center,
+                            &shadow_casters[0].radius);
+    compute_bounding_sphere(&ground_plane_positions[0][0],
+                            ground_plane_vertex_count, shadow_casters[1].center,
+                            &shadow_casters[1].radius);
   }
 
   // Create the model index buffer
@@ -171,17 +270,23 @@ prepare_vertex_and_index_buffers(wgpu_context_t* wgpu_context,
              sizeof(uint16_t) * 3);
     }
     wgpuBufferUnmap(index_buffer);
+
+    shadow_casters[0].first_index = 0;
+    shadow_casters[0].index_count = (uint32_t)offset;
+    shadow_casters[1].first_index = (uint32_t)offset;
+    shadow_casters[1].index_count = ground_plane_index_count * 3;
   }
 }
 
 static void prepare_texture(wgpu_context_t* wgpu_context)
 {
-  // Create the depth texture for rendering/sampling the shadow map
+  // Create the depth texture array for rendering/sampling the shadow map, one
+  // layer per cascade
   {
     WGPUExtent3D texture_extent = {
       .width              = shadow_depth_texture_size,
       .height             = shadow_depth_texture_size,
-      .depthOrArrayLayers = 1,
+      .depthOrArrayLayers = CASCADED_SHADOWS_MAX_CASCADES,
     };
     WGPUTextureDescriptor texture_desc = {
       .size          = texture_extent,
@@ -196,18 +301,28 @@ static void prepare_texture(wgpu_context_t* wgpu_context)
       = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
     ASSERT(textures.shadow_depth_texture.texture != NULL);
 
-    // Create the texture view
+    // Create the texture view of all cascades
     WGPUTextureViewDescriptor texture_view_dec = {
-      .dimension       = WGPUTextureViewDimension_2D,
+      .dimension       = WGPUTextureViewDimension_2DArray,
       .format          = WGPUTextureFormat_Depth32Float,
       .baseMipLevel    = 0,
       .mipLevelCount   = 1,
       .baseArrayLayer  = 0,
-      .arrayLayerCount = 1,
+      .arrayLayerCount = CASCADED_SHADOWS_MAX_CASCADES,
     };
     textures.shadow_depth_texture.view = wgpuTextureCreateView(
       textures.shadow_depth_texture.texture, &texture_view_dec);
     ASSERT(textures.shadow_depth_texture.view != NULL);
+
+    // Create the texture views of the cascades for the shadow passes
+    texture_view_dec.dimension       = WGPUTextureViewDimension_2D;
+    texture_view_dec.arrayLayerCount = 1;
+    for (uint32_t i = 0; i < CASCADED_SHADOWS_MAX_CASCADES; ++i) {
+      texture_view_dec.baseArrayLayer = i;
+      textures.shadow_depth_texture.layer_views[i] = wgpuTextureCreateView(
+        textures.shadow_depth_texture.texture, &texture_view_dec);
+      ASSERT(textures.shadow_depth_texture.layer_views[i] != NULL);
+    }
   }
 
   // Create a depth/stencil texture for the color rendering pipeline
@@ -267,7 +382,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 {
   // Bind group layout for unform buffers in shadow pipeline
   {
-    // Bind group layout for scene uniform
+    // Bind group layout for the light matrix of a cascade
     {
       WGPUBindGroupLayoutEntry bgl_entries[1] = {
         [0] = (WGPUBindGroupLayoutEntry) {
@@ -276,8 +391,8 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
           .visibility = WGPUShaderStage_Vertex,
           .buffer = (WGPUBufferBindingLayout) {
             .type             = WGPUBufferBindingType_Uniform,
-            .hasDynamicOffset = false,
-            .minBindingSize   = sizeof(mat4) + sizeof(mat4) + sizeof(vec3),
+            .hasDynamicOffset = true,
+            .minBindingSize   = sizeof(mat4),
           },
           .sampler = {0},
         },
@@ -342,7 +457,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_Uniform,
         .hasDynamicOffset = false,
-        .minBindingSize   = sizeof(mat4) + sizeof(mat4) + sizeof(vec3),
+        .minBindingSize   = sizeof(scene_uniforms),
       },
       .sampler = {0},
     },
@@ -352,7 +467,7 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
       .texture = (WGPUTextureBindingLayout) {
         .sampleType    = WGPUTextureSampleType_Depth,
-        .viewDimension = WGPUTextureViewDimension_2D,
+        .viewDimension = WGPUTextureViewDimension_2DArray,
         .multisampled  = false,
       },
       .storageTexture = {0},
@@ -399,7 +514,7 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
     // Shadow pass descriptor
     shadow_render_pass.depth_stencil_attachment
       = (WGPURenderPassDepthStencilAttachment){
-        .view            = textures.shadow_depth_texture.view,
+        .view            = NULL, // view is set per cascade in render loop.
         .depthLoadOp     = WGPULoadOp_Clear,
         .depthStoreOp    = WGPUStoreOp_Store,
         .depthClearValue = 1.0f,
@@ -460,62 +575,45 @@ static void prepare_view_matrices(wgpu_context_t* wgpu_context)
   memcpy(view_matrices.origin, (vec3){0.0f, 0.0f, 0.0f}, sizeof(vec3));
 
   glm_mat4_identity(view_matrices.projection_matrix);
-  glm_perspective((2.0f * PI) / 5.0f, aspect_ratio, 1.f, 2000.f,
+  glm_perspective(camera_fov_y, aspect_ratio, camera_near, camera_far,
                   view_matrices.projection_matrix);
 
-  mat4 view_matrix = GLM_MAT4_IDENTITY_INIT;
-  glm_lookat(eye_position,            // eye vector
-             view_matrices.origin,    // center vector
-             view_matrices.up_vector, // up vector
-             view_matrix              // result matrix
+  glm_mat4_identity(view_matrices.view_matrix);
+  glm_lookat(eye_position,             // eye vector
+             view_matrices.origin,     // center vector
+             view_matrices.up_vector,  // up vector
+             view_matrices.view_matrix // result matrix
   );
 
-  vec3 light_position    = {50.0f, 100.0f, -100.0f};
-  mat4 light_view_matrix = GLM_MAT4_IDENTITY_INIT;
-  glm_lookat(light_position,          // eye vector
-             view_matrices.origin,    // center vector
-             view_matrices.up_vector, // up vector
-             light_view_matrix        // result matrix
-  );
-
-  mat4 light_projection_matrix = GLM_MAT4_IDENTITY_INIT;
-  {
-    const float left   = -80.0f;
-    const float right  = 80.0f;
-    const float bottom = -80.0f;
-    const float top    = 80.0f;
-    const float near   = -200.0f;
-    const float far    = 300.0f;
-    glm_ortho(left, right, bottom, top, near, far, light_projection_matrix);
-  }
-
-  mat4 light_view_proj_matrix = GLM_MAT4_IDENTITY_INIT;
-  glm_mat4_mulN((mat4*[]){&light_projection_matrix, &light_view_matrix}, 2,
-                light_view_proj_matrix);
-
   glm_mat4_identity(view_matrices.view_proj_matrix);
-  glm_mat4_mulN((mat4*[]){&view_matrices.projection_matrix, &view_matrix}, 2,
-                view_matrices.view_proj_matrix);
+  glm_mat4_mulN(
+    (mat4*[]){&view_matrices.projection_matrix, &view_matrices.view_matrix}, 2,
+    view_matrices.view_proj_matrix);
 
   // Move the model so it's centered.
   mat4 model_matrix = GLM_MAT4_IDENTITY_INIT;
   glm_translate(model_matrix, (vec3){0.0f, -5.0f, 0.0f});
   glm_translate(model_matrix, (vec3){0.0f, -40.0f, 0.0f});
 
-  // The camera/light aren't moving, so write them into buffers now.
-  {
-    wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.scene, 0,
-                         light_view_proj_matrix, sizeof(mat4));
-
-    wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.scene, 64,
-                         view_matrices.view_proj_matrix, sizeof(mat4));
-
-    wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.scene, 128,
-                         light_position, sizeof(vec3));
-
-    wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.model, 0,
-                         model_matrix, sizeof(mat4));
+  // Move the bounding spheres of the casters along with the model, the scene
+  // bounds enclose them around the center of the ground plane
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(shadow_casters); ++i) {
+    glm_mat4_mulv3(model_matrix, shadow_casters[i].center, 1.0f,
+                   shadow_casters[i].center);
+  }
+  glm_vec3_copy(shadow_casters[1].center, scene_bounds.center);
+  scene_bounds.radius = 0.0f;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(shadow_casters); ++i) {
+    scene_bounds.radius
+      = MAX(scene_bounds.radius,
+            glm_vec3_distance(scene_bounds.center, shadow_casters[i].center)
+              + shadow_casters[i].radius);
   }
+
+  // The model and the light aren't moving, so write the model into its buffer
+  // now.
+  wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.model, 0,
+                       model_matrix, sizeof(mat4));
 }
 
 /**
@@ -549,30 +647,64 @@ static void glm_vec3_rotate_y(vec3 a, vec3 b, float rad, vec3* out)
 }
 
 // Rotates the camera around the origin based on time.
-static mat4* get_camera_view_proj_matrix(wgpu_example_context_t* context)
+static void update_camera(wgpu_example_context_t* context)
 {
   vec3 eye_position = {0.0f, 50.0f, -100.0f};
 
   float rad = PI * (context->frame.timestamp_millis / 2000.0f);
   glm_vec3_rotate_y(eye_position, view_matrices.origin, rad, &eye_position);
 
-  mat4 view_matrix = GLM_MAT4_IDENTITY_INIT;
-  glm_lookat(eye_position,            // eye vector
-             view_matrices.origin,    // center vector
-             view_matrices.up_vector, // up vector
-             view_matrix              // result matrix
+  glm_mat4_identity(view_matrices.view_matrix);
+  glm_lookat(eye_position,             // eye vector
+             view_matrices.origin,     // center vector
+             view_matrices.up_vector,  // up vector
+             view_matrices.view_matrix // result matrix
   );
 
-  glm_mat4_mulN((mat4*[]){&view_matrices.projection_matrix, &view_matrix}, 2,
-                view_matrices.view_proj_matrix);
-  return &view_matrices.view_proj_matrix;
+  glm_mat4_mulN(
+    (mat4*[]){&view_matrices.projection_matrix, &view_matrices.view_matrix}, 2,
+    view_matrices.view_proj_matrix);
 }
 
-static void update_uniform_buffers(wgpu_example_context_t* context)
+// Fits the cascades to the camera, only the light matrices of the cascades
+// which changed are written to the shadow pass uniforms.
+static void update_uniform_buffers(wgpu_context_t* wgpu_context)
 {
-  mat4* camera_view_proj = get_camera_view_proj_matrix(context);
-  wgpuQueueWriteBuffer(context->wgpu_context->queue, uniform_buffers.scene, 64,
-                       *camera_view_proj, sizeof(mat4));
+  const uint32_t cascade_count = (uint32_t)settings.cascade_count_index + 2;
+  if (cascade_count != cascaded_shadows.cascade_count) {
+    cascaded_shadows_init(&cascaded_shadows, cascade_count,
+                          shadow_split_lambda, shadow_depth_texture_size);
+  }
+
+  cascaded_shadows_camera_t camera = {
+    .fov_y  = camera_fov_y,
+    .aspect = (float)wgpu_context->surface.width
+              / (float)wgpu_context->surface.height,
+    .near   = camera_near,
+    .far    = shadow_distance,
+  };
+  glm_mat4_copy(view_matrices.view_matrix, camera.view_matrix);
+  cascaded_shadows_update(&cascaded_shadows, &camera, light_direction,
+                          scene_bounds.center, scene_bounds.radius);
+
+  for (uint32_t i = 0; i < cascade_count; ++i) {
+    if (cascaded_shadows_is_dirty(&cascaded_shadows, i)) {
+      wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.cascades,
+                           i * CASCADE_UNIFORM_STRIDE,
+                           cascaded_shadows.view_proj_matrices[i],
+                           sizeof(mat4));
+    }
+    glm_mat4_copy(cascaded_shadows.view_proj_matrices[i],
+                  scene_uniforms.light_view_proj_matrices[i]);
+    scene_uniforms.cascade_splits[i] = cascaded_shadows.split_depths[i];
+  }
+  glm_mat4_copy(view_matrices.view_proj_matrix,
+                scene_uniforms.camera_view_proj_matrix);
+  glm_vec3_negate_to(light_direction, scene_uniforms.light_direction);
+  scene_uniforms.cascade_count = cascade_count;
+  scene_uniforms.show_cascades = settings.show_cascades ? 1u : 0u;
+  wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffers.scene, 0,
+                       &scene_uniforms, sizeof(scene_uniforms));
 }
 
 static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
@@ -593,21 +725,32 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
     uniform_buffers.scene = wgpuDeviceCreateBuffer(
       wgpu_context->device,
       &(WGPUBufferDescriptor){
-        // Two 4x4 viewProj matrices, one for the camera and one for the light.
-        // Then a vec3 for the light position.
-        .size  = sizeof(mat4) + sizeof(mat4) + sizeof(vec3),
+        // The 4x4 viewProj matrices of the cascades and the camera, the
+        // cascade splits and the light direction.
+        .size  = sizeof(scene_uniforms),
         .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
       });
     ASSERT(uniform_buffers.scene);
   }
 
-  // Scene bind group for shadow
+  // Cascade uniform buffer, one 4x4 viewProj matrix per cascade
+  {
+    uniform_buffers.cascades = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .size  = CASCADED_SHADOWS_MAX_CASCADES * CASCADE_UNIFORM_STRIDE,
+        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      });
+    ASSERT(uniform_buffers.cascades);
+  }
+
+  // Scene bind group for shadow, the cascade is selected by dynamic offset
   {
     WGPUBindGroupEntry bg_entries[1] = {
       [0] = (WGPUBindGroupEntry) {
         .binding = 0,
-        .buffer  = uniform_buffers.scene,
-        .size    = sizeof(mat4) + sizeof(mat4) + sizeof(vec3),
+        .buffer  = uniform_buffers.cascades,
+        .size    = sizeof(mat4),
       },
     };
     bind_groups.scene_shadow = wgpuDeviceCreateBindGroup(
@@ -626,7 +769,7 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
       [0] = (WGPUBindGroupEntry) {
         .binding = 0,
         .buffer  = uniform_buffers.scene,
-        .size    = sizeof(mat4) + sizeof(mat4) + sizeof(vec3),
+        .size    = sizeof(scene_uniforms),
       },
       [1] = (WGPUBindGroupEntry) {
         .binding     = 1,
@@ -666,6 +809,125 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
   }
 }
 
+/* -------------------------------------------------------------------------- *
+ * Cascaded shadow mapping shaders
+ * -------------------------------------------------------------------------- */
+
+// Renders the casters into the shadow map layer of one cascade
+// clang-format off
+static const char* vertex_shadow_wgsl = CODE(
+  struct Cascade {
+    lightViewProjMatrix : mat4x4<f32>,
+  }
+  @group(0) @binding(0) var<uniform> cascade : Cascade;
+
+  struct Model {
+    modelMatrix : mat4x4<f32>,
+  }
+  @group(1) @binding(0) var<uniform> model : Model;
+
+  @vertex
+  fn main(@location(0) position : vec3<f32>) -> @builtin(position) vec4<f32> {
+    return cascade.lightViewProjMatrix * model.modelMatrix
+           * vec4<f32>(position, 1.0);
+  }
+);
+// clang-format on
+
+// The view depth selects the cascade, the scene struct matches
+// scene_uniforms
+// clang-format off
+static const char* color_wgsl = CODE(
+  struct Scene {
+    lightViewProjMatrix : array<mat4x4<f32>, 4>,
+    cameraViewProjMatrix : mat4x4<f32>,
+    cascadeSplits : vec4<f32>,
+    lightDir : vec3<f32>,
+    cascadeCount : u32,
+    showCascades : u32,
+  }
+  @group(0) @binding(0) var<uniform> scene : Scene;
+  @group(0) @binding(1) var shadowMap : texture_depth_2d_array;
+  @group(0) @binding(2) var shadowSampler : sampler_comparison;
+
+  struct Model {
+    modelMatrix : mat4x4<f32>,
+  }
+  @group(1) @binding(0) var<uniform> model : Model;
+
+  struct VertexOutput {
+    @location(0) worldPos : vec3<f32>,
+    @location(1) fragNorm : vec3<f32>,
+    @location(2) viewDepth : f32,
+    @builtin(position) position : vec4<f32>,
+  }
+
+  @vertex
+  fn vs_main(@location(0) position : vec3<f32>,
+             @location(1) normal : vec3<f32>) -> VertexOutput {
+    var output : VertexOutput;
+    let worldPos = model.modelMatrix * vec4<f32>(position, 1.0);
+    output.position = scene.cameraViewProjMatrix * worldPos;
+    output.worldPos = worldPos.xyz;
+    output.viewDepth = output.position.w;
+    output.fragNorm = normal;
+    return output;
+  }
+
+  const albedo = vec3<f32>(0.9);
+  const ambientFactor = 0.2;
+  const shadowDepthBias = 0.001;
+
+  fn cascadeIndex(viewDepth : f32) -> u32 {
+    for (var i = 0u; i < scene.cascadeCount; i++) {
+      if (viewDepth <= scene.cascadeSplits[i]) {
+        return i;
+      }
+    }
+    return scene.cascadeCount;
+  }
+
+  fn shadowVisibility(worldPos : vec3<f32>, cascade : u32) -> f32 {
+    if (cascade >= scene.cascadeCount) {
+      return 1.0;
+    }
+    let posFromLight = scene.lightViewProjMatrix[cascade]
+                       * vec4<f32>(worldPos, 1.0);
+    let uv = posFromLight.xy * vec2<f32>(0.5, -0.5) + vec2<f32>(0.5);
+    let depth = posFromLight.z - shadowDepthBias;
+
+    let oneOverSize = 1.0 / vec2<f32>(textureDimensions(shadowMap).xy);
+    var visibility = 0.0;
+    for (var y = -1; y <= 1; y++) {
+      for (var x = -1; x <= 1; x++) {
+        let offset = vec2<f32>(f32(x), f32(y)) * oneOverSize;
+        visibility += textureSampleCompareLevel(
+          shadowMap, shadowSampler, uv + offset, i32(cascade), depth);
+      }
+    }
+    return visibility / 9.0;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let cascade = cascadeIndex(input.viewDepth);
+    let visibility = shadowVisibility(input.worldPos, cascade);
+    let lambertFactor = max(
+      dot(normalize(scene.lightDir), normalize(input.fragNorm)), 0.0);
+    let lightingFactor = min(ambientFactor + visibility * lambertFactor, 1.0);
+
+    var color = albedo;
+    if (scene.showCascades != 0u && cascade < scene.cascadeCount) {
+      var cascadeColors = array<vec3<f32>, 4>(
+        vec3<f32>(1.0, 0.4, 0.4), vec3<f32>(0.4, 1.0, 0.4),
+        vec3<f32>(0.4, 0.4, 1.0), vec3<f32>(1.0, 1.0, 0.4));
+      color *= cascadeColors[cascade];
+    }
+    return vec4<f32>(lightingFactor * color, 1.0);
+  }
+);
+// clang-format on
+
 // Create the shadow pipeline
 static void prepare_shadow_pipeline(wgpu_context_t* wgpu_context)
 {
@@ -697,9 +959,9 @@ static void prepare_shadow_pipeline(wgpu_context_t* wgpu_context)
                 wgpu_context, &(wgpu_vertex_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
                   // Vertex shader WGSL
-                  .label = "vertex_shadow_shader",
-                  .file  = "shaders/shadow_mapping/vertexShadow.wgsl",
-                  .entry = "main",
+                  .label            = "vertex_shadow_shader",
+                  .wgsl_code.source = vertex_shadow_wgsl,
+                  .entry            = "main",
                 },
                 .buffer_count = 1,
                 .buffers      = &shadow_vertex_buffer_layout,
@@ -790,9 +1052,9 @@ static void prepare_color_rendering_pipeline(wgpu_context_t* wgpu_context)
                 wgpu_context, &(wgpu_vertex_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
                   // Vertex shader WGSL
-                  .label = "vertex_shader",
-                  .file  = "shaders/shadow_mapping/vertex.wgsl",
-                  .entry = "main",
+                  .label            = "vertex_shader",
+                  .wgsl_code.source = color_wgsl,
+                  .entry            = "vs_main",
                 },
                 .buffer_count = 1,
                 .buffers      = &color_vertex_buffer_layout,
@@ -803,9 +1065,9 @@ static void prepare_color_rendering_pipeline(wgpu_context_t* wgpu_context)
                 wgpu_context, &(wgpu_fragment_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
                   // Fragment shader WGSL
-                  .label = "fragment_shader",
-                  .file  = "shaders/shadow_mapping/fragment.wgsl",
-                  .entry = "main",
+                  .label            = "fragment_shader",
+                  .wgsl_code.source = color_wgsl,
+                  .entry            = "fs_main",
                 },
                 .target_count = 1,
                 .targets      = &color_target_state,
@@ -842,6 +1104,8 @@ static int example_initialize(wgpu_example_context_t* context)
     stanford_dragon_mesh_init(&stanford_dragon_mesh);
     prepare_vertex_and_index_buffers(context->wgpu_context,
                                      &stanford_dragon_mesh);
+    // The mesh data is in the vertex and index buffers now
+    stanford_dragon_mesh_destroy(&stanford_dragon_mesh);
     prepare_texture(context->wgpu_context);
     prepare_sampler(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
@@ -849,6 +1113,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_color_rendering_pipeline(context->wgpu_context);
     prepare_uniform_buffers(context->wgpu_context);
     prepare_view_matrices(context->wgpu_context);
+    update_uniform_buffers(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -861,6 +1126,16 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    imgui_overlay_combo_box(context->imgui_overlay, "Cascades",
+                            &settings.cascade_count_index, cascade_count_items,
+                            (uint32_t)ARRAY_SIZE(cascade_count_items));
+    imgui_overlay_checkBox(context->imgui_overlay, "Show cascades",
+                           &settings.show_cascades);
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Shadow passes: %u / %u", shadow_stats.shadow_passes,
+                       cascaded_shadows.cascade_count);
+    imgui_overlay_text("Caster draws: %u", shadow_stats.caster_draws);
   }
 }
 
@@ -869,22 +1144,42 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  // Shadow pass
-  {
+  // Shadow passes, the casters are static so the shadow map layer of a
+  // cascade stays valid until its light matrix changes
+  shadow_stats.shadow_passes = 0;
+  shadow_stats.caster_draws  = 0;
+  for (uint32_t i = 0; i < cascaded_shadows.cascade_count; ++i) {
+    if (!cascaded_shadows_is_dirty(&cascaded_shadows, i)) {
+      continue;
+    }
+    shadow_render_pass.depth_stencil_attachment.view
+      = textures.shadow_depth_texture.layer_views[i];
     WGPURenderPassEncoder shadow_pass = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc, &shadow_render_pass.descriptor);
     wgpuRenderPassEncoderSetPipeline(shadow_pass, render_pipelines.shadow);
+    const uint32_t cascade_offset = i * CASCADE_UNIFORM_STRIDE;
     wgpuRenderPassEncoderSetBindGroup(shadow_pass, 0, bind_groups.scene_shadow,
-                                      0, 0);
+                                      1, &cascade_offset);
     wgpuRenderPassEncoderSetBindGroup(shadow_pass, 1, bind_groups.model, 0, 0);
     wgpuRenderPassEncoderSetVertexBuffer(shadow_pass, 0, vertex_buffer, 0,
                                          WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetIndexBuffer(
       shadow_pass, index_buffer, WGPUIndexFormat_Uint16, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderDrawIndexed(shadow_pass, index_count, 1, 0, 0, 0);
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(shadow_casters); ++j) {
+      if (!frustum_check_sphere(&cascaded_shadows.frustums[i],
+                                shadow_casters[j].center,
+                                shadow_casters[j].radius)) {
+        continue;
+      }
+      wgpuRenderPassEncoderDrawIndexed(shadow_pass,
+                                       shadow_casters[j].index_count, 1,
+                                       shadow_casters[j].first_index, 0, 0);
+      ++shadow_stats.caster_draws;
+    }
 
     wgpuRenderPassEncoderEnd(shadow_pass);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, shadow_pass)
+    ++shadow_stats.shadow_passes;
   }
 
   // Color render pass
@@ -946,8 +1241,9 @@ static int example_render(wgpu_example_context_t* context)
   }
   const int draw_result = example_draw(context);
   if (!context->paused) {
-    update_uniform_buffers(context);
+    update_camera(context);
   }
+  update_uniform_buffers(context->wgpu_context);
   return draw_result;
 }
 
@@ -959,6 +1255,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, index_buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.model)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.scene)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.cascades)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.shadow)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.color)
   WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipelines.shadow);
@@ -976,6 +1273,10 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(TextureView, textures.depth_texture.view)
   WGPU_RELEASE_RESOURCE(Texture, textures.shadow_depth_texture.texture)
   WGPU_RELEASE_RESOURCE(TextureView, textures.shadow_depth_texture.view)
+  for (uint32_t i = 0; i < CASCADED_SHADOWS_MAX_CASCADES; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView,
+                          textures.shadow_depth_texture.layer_views[i])
+  }
 }
 
 void example_shadow_mapping(int argc, char* argv[])
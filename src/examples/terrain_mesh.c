@@ -3,35 +3,153 @@
 
 #include <string.h>
 
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/virtual_texture.h"
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Terrain Mesh
  *
  * This example shows how to render an infinite landscape for the camera to
- * meander around in. The terrain consists of a tiled planar mesh that is
- * displaced with a heightmap.
+ * meander around in. The terrain is a planar grid that is displaced with a
+ * heightmap, its level of detail is selected per frame with a CDLOD quadtree
+ * (Strugar, "Continuous Distance-Dependent Level of Detail for Rendering
+ * Heightmaps", 2010):
+ *
+ *  * the quadtree nodes are selected on the CPU against the LOD distance
+ *    ranges and the view frustum, each level halves the node size
+ *  * every node is drawn as four instances of a single patch mesh covering a
+ *    quarter of the node, quarters covered by finer children are skipped
+ *  * vertices morph onto the grid of the next coarser level towards the end
+ *    of the range of their level, so there are no cracks or popping
+ *
+ * The vertex count stays roughly constant per LOD ring, the view distance
+ * grows with the number of levels.
+ *
+ * The color texture is a virtual texture (see virtual_texture.h): a feedback
+ * pass at an eighth of the resolution writes the page IDs the terrain
+ * samples, the pages are streamed from the page file into the page cache
+ * after the feedback is read back. The page file is baked from the color
+ * image on the first run.
  *
  * The example demonstrates the following:
  *  * texture creation and sampling
- *  * displacement mapping in GLSL
+ *  * displacement mapping in WGSL
  *  * bind groups for efficient resource binding
  *  * indexed and instanced draw calls
+ *  * virtual texturing with a feedback pass and asynchronous readback
  *
  * Ref:
  * https://metalbyexample.com/webgpu-part-one/
  * https://metalbyexample.com/webgpu-part-two/
  * https://blogs.igalia.com/itoral/2016/10/13/opengl-terrain-renderer-rendering-the-terrain-mesh/
+ * https://github.com/fstrugar/CDLOD
  * -------------------------------------------------------------------------- */
 
-// Terrain patch parameters
+// Shaders
+// clang-format off
+static const char* terrain_mesh_shader_wgsl = CODE(
+  struct FrameUniforms {
+    view : mat4x4<f32>,
+    view_projection : mat4x4<f32>,
+    camera_position : vec4<f32>,
+    terrain : vec4<f32>,
+    morph_ranges : array<vec4<f32>, 10>,
+    color : VirtualTexture,
+  }
+
+  @group(0) @binding(0) var linear_sampler : sampler;
+  @group(0) @binding(1) var color_indirection : texture_2d<u32>;
+  @group(0) @binding(2) var heightmap : texture_2d<f32>;
+  @group(0) @binding(3) var color_cache : texture_2d<f32>;
+  @group(0) @binding(4) var color_sampler : sampler;
+  @group(1) @binding(0) var<uniform> frame : FrameUniforms;
+
+  // -log2(WGPU_VIRTUAL_TEXTURE_FEEDBACK_SCALE)
+  const FEEDBACK_LOD_BIAS : f32 = -3.0;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+    @location(1) eye_distance : f32,
+  }
+
+  fn terrain_uv(xz : vec2<f32>) -> vec2<f32> {
+    return xz / frame.terrain.x + 0.5;
+  }
+
+  fn terrain_height(xz : vec2<f32>) -> f32 {
+    let height = textureSampleLevel(heightmap, linear_sampler, terrain_uv(xz),
+                                    0.0).r;
+    return height * frame.terrain.y;
+  }
+
+  @vertex
+  fn vs_main(@location(0) grid : vec2<f32>,
+             @location(1) patch_node : vec4<f32>) -> VertexOutput {
+    let spacing = patch_node.z;
+    var xz = patch_node.xy + grid * spacing;
+
+    // Odd grid vertices slide onto the grid of the next coarser level
+    let camera = frame.camera_position.xyz;
+    let camera_distance = length(vec3<f32>(xz.x, terrain_height(xz), xz.y)
+                                 - camera);
+    let morph_range = frame.morph_ranges[u32(patch_node.w)];
+    let morph = clamp((camera_distance - morph_range.x)
+                        / (morph_range.y - morph_range.x), 0.0, 1.0);
+    xz -= fract(grid * 0.5) * 2.0 * spacing * morph;
+
+    let position = vec4<f32>(xz.x, terrain_height(xz), xz.y, 1.0);
+    var output : VertexOutput;
+    output.position = frame.view_projection * position;
+    output.uv = terrain_uv(xz);
+    output.eye_distance = length((frame.view * position).xyz);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let fog_color = vec4<f32>(0.812, 0.914, 1.0, 1.0);
+    let level = vt_level(frame.color, input.uv, 0.0);
+    let color = vt_sample(color_indirection, color_cache, color_sampler,
+                          frame.color, input.uv, level);
+    let fog = clamp((input.eye_distance - frame.terrain.z)
+                      / (frame.terrain.w - frame.terrain.z), 0.0, 1.0);
+    return mix(color, fog_color, fog);
+  }
+
+  @fragment
+  fn fs_feedback(input : VertexOutput) -> @location(0) u32 {
+    let level = vt_level(frame.color, input.uv, FEEDBACK_LOD_BIAS);
+    return vt_page_id(frame.color, input.uv, level);
+  }
+);
+// clang-format on
+
+// Heightmap tiling period and displacement in meters
 #define PATCH_SIZE 50
-#define PATCH_SEGMENT_COUNT 40
+#define TERRAIN_HEIGHT_SCALE 4.0f
+
+// Virtual color texture, texels per side of level 0 and the baked page file
+#define COLOR_TEXTURE_FILE "textures/color.png"
+#define COLOR_PAGE_FILE "textures/color.vt.bin"
+#define COLOR_VIRTUAL_SIZE 4096u
+
+// CDLOD quadtree parameters
+#define CDLOD_LOD_COUNT 10
+#define CDLOD_LEAF_NODE_SIZE 25.0f
+#define CDLOD_NODE_SEGMENT_COUNT 32
+#define CDLOD_MORPH_START_RATIO 0.7f
+#define CDLOD_MAX_PATCH_COUNT 4096
+
+// The patch mesh covers a quarter of a node
+#define PATCH_SEGMENT_COUNT (CDLOD_NODE_SEGMENT_COUNT / 2)
 #define PATCH_INDEX_COUNT PATCH_SEGMENT_COUNT* PATCH_SEGMENT_COUNT * 6
 #define PATCH_VERTEX_COUNT (PATCH_SEGMENT_COUNT + 1) * (PATCH_SEGMENT_COUNT + 1)
-#define PATCH_FLOATS_PER_VERTEX 6
+#define PATCH_FLOATS_PER_VERTEX 2
 
 // Camera parameters
 static const float fov_y  = TO_RADIANS(60.0f);
-static const float near_z = 0.1f, far_z = 150.0f;
+static const float near_z = 0.5f, far_z = 12000.0f;
 static vec3 camera_position                     = {0.0f, 5.0f, 0.0f};
 static float camera_heading                     = PI / 2.0f; // radians
 static float camera_target_heading              = PI / 2.0f; // radians
@@ -39,27 +157,36 @@ static const float camera_angular_easing_factor = 0.005f;
 static const float camera_speed                 = 8.0f; // meters per second
 
 // Used to calculate view and projection matrices
-static float rot_y[16], trans[16], view_matrix[16], projection_matrix[16];
-
-// Camera matrices
-static float model_matrix[16], model_view_matrix[16];
-static float model_view_projection_matrix[16];
+static mat4 rot_y, trans, view_matrix, projection_matrix;
+static mat4 view_projection_matrix;
+static frustum_t frustum = {0};
 
-// Nine terrain patches
-static vec3 patch_centers[9];
+// LOD ranges, a node of level l is selected up to lod_ranges[l] from the
+// camera
+static float lod_ranges[CDLOD_LOD_COUNT] = {0};
 
 // Time-related state
 static float last_frame_time            = -1.0f;
 static float direction_change_countdown = 6.0f; // seconds
 
-// Internal constants
-static const uint32_t instance_length
-  = 16 * 2; // Length of the data associated with a single instance
-static const uint32_t max_instance_count = 9;
-static const uint64_t instance_buffer_length
-  = 4 * instance_length * max_instance_count; // in bytes
-static float* instance_data    = NULL;
-static uint32_t instance_count = 1;
+// Selected patches, one instance each
+typedef struct {
+  float origin[2]; // x, z
+  float spacing;   // grid spacing in meters
+  float lod;
+} terrain_patch_t;
+static terrain_patch_t patches[CDLOD_MAX_PATCH_COUNT] = {0};
+static uint32_t patch_count                           = 0;
+
+// Frame uniforms
+static struct {
+  float view[16];
+  float view_projection[16];
+  vec4 camera_position;
+  vec4 terrain; // x: patch size, y: height scale, z: fog start, w: fog end
+  vec4 morph_ranges[CDLOD_LOD_COUNT]; // x: morph start, y: morph end
+  wgpu_virtual_texture_params_t color;
+} frame_uniforms = {0};
 
 // Vertex buffer
 static wgpu_buffer_t vertices = {0};
@@ -67,30 +194,34 @@ static wgpu_buffer_t vertices = {0};
 // Index buffer
 static wgpu_buffer_t indices = {0};
 
-// Instance buffer
+// Patch instance buffer
 static wgpu_buffer_t instance_buffer = {0};
 
+// Uniform buffer
+static wgpu_buffer_t uniform_buffer = {0};
+
 // Textures
 static struct {
-  texture_t color;
   texture_t heightmap;
 } textures;
-static WGPUSampler linear_sampler = {0};
+static WGPUSampler linear_sampler                   = {0};
+static wgpu_virtual_texture_t* color_virtual_texture = NULL;
 
-// Render pipeline + layout
-static WGPURenderPipeline render_pipeline = {0};
-static WGPUPipelineLayout pipeline_layout = {0};
+// Render pipelines + layout
+static WGPURenderPipeline render_pipeline   = {0};
+static WGPURenderPipeline feedback_pipeline = {0};
+static WGPUPipelineLayout pipeline_layout   = {0};
 
 // Bind group layouts
 static struct {
   WGPUBindGroupLayout frame_constants;
-  WGPUBindGroupLayout instance_buffer;
+  WGPUBindGroupLayout uniform_buffer;
 } bind_group_layouts = {0};
 
 // Bind groups
 static struct {
   WGPUBindGroup frame_constants;
-  WGPUBindGroup instance_buffer;
+  WGPUBindGroup uniform_buffer;
 } bind_groups = {0};
 
 // Render pass descriptor for frame buffer writes
@@ -105,69 +236,21 @@ static bool prepared             = false;
  * Custom math
  * -------------------------------------------------------------------------- */
 
-static void mat4_mul(float (*a)[16], float (*b)[16], float (*m)[16])
-{
-  memset(m, 0, sizeof(*m));
-  // clang-format off
-  (*m)[0]  = (*a)[0] * (*b)[0]  + (*a)[4] * (*b)[1]  + (*a)[8]  * (*b)[2]  + (*a)[12] * (*b)[3];
-  (*m)[1]  = (*a)[1] * (*b)[0]  + (*a)[5] * (*b)[1]  + (*a)[9]  * (*b)[2]  + (*a)[13] * (*b)[3];
-  (*m)[2]  = (*a)[2] * (*b)[0]  + (*a)[6] * (*b)[1]  + (*a)[10] * (*b)[2]  + (*a)[14] * (*b)[3];
-  (*m)[3]  = (*a)[3] * (*b)[0]  + (*a)[7] * (*b)[1]  + (*a)[11] * (*b)[2]  + (*a)[15] * (*b)[3];
-  (*m)[4]  = (*a)[0] * (*b)[4]  + (*a)[4] * (*b)[5]  + (*a)[8]  * (*b)[6]  + (*a)[12] * (*b)[7];
-  (*m)[5]  = (*a)[1] * (*b)[4]  + (*a)[5] * (*b)[5]  + (*a)[9]  * (*b)[6]  + (*a)[13] * (*b)[7];
-  (*m)[6]  = (*a)[2] * (*b)[4]  + (*a)[6] * (*b)[5]  + (*a)[10] * (*b)[6]  + (*a)[14] * (*b)[7];
-  (*m)[7]  = (*a)[3] * (*b)[4]  + (*a)[7] * (*b)[5]  + (*a)[11] * (*b)[6]  + (*a)[15] * (*b)[7];
-  (*m)[8]  = (*a)[0] * (*b)[8]  + (*a)[4] * (*b)[9]  + (*a)[8]  * (*b)[10] + (*a)[12] * (*b)[11];
-  (*m)[9]  = (*a)[1] * (*b)[8]  + (*a)[5] * (*b)[9]  + (*a)[9]  * (*b)[10] + (*a)[13] * (*b)[11];
-  (*m)[10] = (*a)[2] * (*b)[8]  + (*a)[6] * (*b)[9]  + (*a)[10] * (*b)[10] + (*a)[14] * (*b)[11];
-  (*m)[11] = (*a)[3] * (*b)[8]  + (*a)[7] * (*b)[9]  + (*a)[11] * (*b)[10] + (*a)[15] * (*b)[11];
-  (*m)[12] = (*a)[0] * (*b)[12] + (*a)[4] * (*b)[13] + (*a)[8]  * (*b)[14] + (*a)[12] * (*b)[15];
-  (*m)[13] = (*a)[1] * (*b)[12] + (*a)[5] * (*b)[13] + (*a)[9]  * (*b)[14] + (*a)[13] * (*b)[15];
-  (*m)[14] = (*a)[2] * (*b)[12] + (*a)[6] * (*b)[13] + (*a)[10] * (*b)[14] + (*a)[14] * (*b)[15];
-  (*m)[15] = (*a)[3] * (*b)[12] + (*a)[7] * (*b)[13] + (*a)[11] * (*b)[14] + (*a)[15] * (*b)[15];
-  // clang-format on
-}
-
-static void mat4_translation(float (*m)[16], vec3 t)
-{
-  memset(m, 0, sizeof(*m));
-  (*m)[0]  = 1.0f;
-  (*m)[5]  = 1.0f;
-  (*m)[10] = 1.0f;
-  (*m)[12] = t[0];
-  (*m)[13] = t[1];
-  (*m)[14] = t[2];
-  (*m)[15] = 1.0f;
-}
-
-static void mat4_rotation_y(float (*m)[16], float angle)
-{
-  memset(m, 0, sizeof(*m));
-  const float c = cos(angle);
-  const float s = sin(angle);
-  (*m)[0]       = c;
-  (*m)[2]       = -s;
-  (*m)[5]       = 1.0f;
-  (*m)[8]       = s;
-  (*m)[10]      = c;
-  (*m)[15]      = 1.0f;
-}
-
 /*
  * Calculates a perspective projection matrix that maps from right-handed view
  * space to left-handed clip space with z on [0, 1]
  */
 static void mat4_perspective_fov(float fovY, float aspect, float near,
-                                 float far, float (*m)[16])
+                                 float far, mat4 m)
 {
-  memset(m, 0, sizeof(*m));
+  glm_mat4_zero(m);
   const float sy = 1.0f / tan(fovY * 0.5f);
   const float nf = 1.0f / (near - far);
-  (*m)[0]        = sy / aspect;
-  (*m)[5]        = sy;
-  (*m)[10]       = far * nf;
-  (*m)[11]       = -1.0f;
-  (*m)[14]       = far * near * nf;
+  m[0][0]        = sy / aspect;
+  m[1][1]        = sy;
+  m[2][2]        = far * nf;
+  m[2][3]        = -1.0f;
+  m[3][2]        = far * near * nf;
 }
 
 /* -------------------------------------------------------------------------- *
@@ -179,21 +262,15 @@ static void prepare_patch_mesh(wgpu_context_t* wgpu_context)
   float vertices_data[PATCH_VERTEX_COUNT * PATCH_FLOATS_PER_VERTEX] = {0};
   uint32_t indices_data[PATCH_INDEX_COUNT]                          = {0};
 
-  const uint32_t patch_size          = (uint32_t)PATCH_SIZE;
   const uint32_t patch_segment_count = (uint32_t)PATCH_SEGMENT_COUNT;
   const uint32_t floats_per_vertex   = (uint32_t)PATCH_FLOATS_PER_VERTEX;
 
+  // Integer grid coordinates, scaled and offset per instance
   for (uint32_t zi = 0, v = 0; zi < patch_segment_count + 1; ++zi) {
     for (uint32_t xi = 0; xi < patch_segment_count + 1; ++xi) {
-      float s               = xi / (float)patch_segment_count;
-      float t               = zi / (float)patch_segment_count;
       uint64_t vi           = v * floats_per_vertex;
-      vertices_data[vi + 0] = (s * patch_size) - (patch_size * 0.5f); // x
-      vertices_data[vi + 1] = 0.0f;                                   // y
-      vertices_data[vi + 2] = (t * patch_size) - (patch_size * 0.5f); // z
-      vertices_data[vi + 3] = 1.0f;                                   // w
-      vertices_data[vi + 4] = s;
-      vertices_data[vi + 5] = t;
+      vertices_data[vi + 0] = (float)xi; // x
+      vertices_data[vi + 1] = (float)zi; // z
       ++v;
     }
   }
@@ -230,12 +307,23 @@ static void prepare_patch_mesh(wgpu_context_t* wgpu_context)
                   });
 }
 
-static void prepare_textures(wgpu_context_t* wgpu_context)
+static bool prepare_textures(wgpu_context_t* wgpu_context)
 {
-  // Color texture
+  // Color virtual texture, the page file is baked on the first run
   {
-    const char* file = "textures/color.png";
-    textures.color   = wgpu_create_texture_from_file(wgpu_context, file, NULL);
+    if (!file_exists(COLOR_PAGE_FILE)) {
+      wgpu_virtual_texture_bake(COLOR_TEXTURE_FILE, COLOR_PAGE_FILE,
+                                COLOR_VIRTUAL_SIZE, true);
+    }
+    color_virtual_texture = wgpu_virtual_texture_create(
+      wgpu_context, &(wgpu_virtual_texture_desc_t){
+                      .filename = COLOR_PAGE_FILE,
+                    });
+    if (color_virtual_texture == NULL) {
+      return false;
+    }
+    wgpu_virtual_texture_get_params(color_virtual_texture,
+                                    &frame_uniforms.color);
   }
 
   // Heightmap texture
@@ -258,6 +346,8 @@ static void prepare_textures(wgpu_context_t* wgpu_context)
     .maxAnisotropy = 1,
   };
   linear_sampler = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+
+  return true;
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -313,6 +403,102 @@ static void update_camera_pose(float dt)
   direction_change_countdown -= dt;
 }
 
+static void prepare_lod_ranges(void)
+{
+  float previous_range = 0.0f;
+  for (uint32_t lod = 0; lod < (uint32_t)CDLOD_LOD_COUNT; ++lod) {
+    // Twice the node size of the level
+    lod_ranges[lod] = CDLOD_LEAF_NODE_SIZE * (float)(2u << lod);
+
+    // Vertices are fully morphed to the next level at the end of the range
+    frame_uniforms.morph_ranges[lod][0]
+      = previous_range
+        + (lod_ranges[lod] - previous_range) * CDLOD_MORPH_START_RATIO;
+    frame_uniforms.morph_ranges[lod][1] = lod_ranges[lod];
+    previous_range                      = lod_ranges[lod];
+  }
+}
+
+static bool box_intersects_sphere(vec3 min, vec3 max, vec3 center,
+                                  float radius)
+{
+  float distance_sq = 0.0f;
+  for (uint32_t i = 0; i < 3; ++i) {
+    const float d = center[i] - CLAMP(center[i], min[i], max[i]);
+    distance_sq += d * d;
+  }
+  return distance_sq <= radius * radius;
+}
+
+static void add_patch(float x, float z, float size, uint32_t lod)
+{
+  if (patch_count >= (uint32_t)CDLOD_MAX_PATCH_COUNT) {
+    return;
+  }
+  patches[patch_count++] = (terrain_patch_t){
+    .origin  = {x, z},
+    .spacing = size / (float)PATCH_SEGMENT_COUNT,
+    .lod     = (float)lod,
+  };
+}
+
+/**
+ * @brief Selects the patches of a node and its children. Returns false when
+ * the node is out of the range of its level, the parent then covers the
+ * area with a quarter of its own.
+ */
+static bool select_node(float x, float z, float size, uint32_t lod)
+{
+  vec3 min = {x, 0.0f, z};
+  vec3 max = {x + size, TERRAIN_HEIGHT_SCALE, z + size};
+  if (!box_intersects_sphere(min, max, camera_position, lod_ranges[lod])) {
+    return false;
+  }
+
+  // Culled nodes count as selected, nothing is drawn in their place
+  if (!frustum_check_box(&frustum, min, max)) {
+    return true;
+  }
+
+  const float half_size = size * 0.5f;
+  if (lod == 0
+      || !box_intersects_sphere(min, max, camera_position,
+                                lod_ranges[lod - 1])) {
+    // The whole node at this level
+    for (uint32_t i = 0; i < 4; ++i) {
+      add_patch(x + (i % 2) * half_size, z + (i / 2) * half_size, half_size,
+                lod);
+    }
+    return true;
+  }
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    const float cx = x + (i % 2) * half_size;
+    const float cz = z + (i / 2) * half_size;
+    if (!select_node(cx, cz, half_size, lod - 1)) {
+      add_patch(cx, cz, half_size, lod);
+    }
+  }
+  return true;
+}
+
+static void select_patches(void)
+{
+  patch_count = 0;
+
+  // The 3x3 root nodes around the camera cover more than the far plane
+  const uint32_t root_lod = (uint32_t)CDLOD_LOD_COUNT - 1;
+  const float root_size   = CDLOD_LEAF_NODE_SIZE * (float)(1u << root_lod);
+  const float root_x = floorf(camera_position[0] / root_size) * root_size;
+  const float root_z = floorf(camera_position[2] / root_size) * root_size;
+  for (int8_t rz = -1; rz <= 1; ++rz) {
+    for (int8_t rx = -1; rx <= 1; ++rx) {
+      select_node(root_x + root_size * rx, root_z + root_size * rz, root_size,
+                  root_lod);
+    }
+  }
+}
+
 static void update_uniforms(wgpu_example_context_t* context)
 {
   const float frame_timestamp_millis = context->frame.timestamp_millis;
@@ -321,65 +507,53 @@ static void update_uniforms(wgpu_example_context_t* context)
 
   update_camera_pose(dt);
 
-  const float patch_size = (float)PATCH_SIZE;
-
-  // Determine the nearest nine terrain patches and calculate their positions
-  const vec3 nearest_patch_center = {
-    round(camera_position[0] / patch_size) * patch_size, // x
-    0.0f,                                                // y
-    round(camera_position[2] / patch_size) * patch_size  // z
-  };
-  uint32_t patch_index = 0;
-  for (int8_t pz = -1; pz <= 1; ++pz) {
-    for (int8_t px = -1; px <= 1; ++px) {
-      glm_vec3_copy(
-        (vec3){
-          nearest_patch_center[0] + patch_size * px, // x
-          nearest_patch_center[1],                   // y
-          nearest_patch_center[2] + patch_size * pz  // z
-        },
-        patch_centers[patch_index]);
-      ++patch_index;
-    }
-  }
-
   // Calculate view and projection matrices
-  mat4_rotation_y(&rot_y, -camera_heading);
-  mat4_translation(&trans, (vec3){-camera_position[0], -camera_position[1],
-                                  -camera_position[2]});
-  mat4_mul(&rot_y, &trans, &view_matrix);
+  glm_rotate_make(rot_y, -camera_heading, GLM_YUP);
+  glm_translate_make(trans, (vec3){-camera_position[0], -camera_position[1],
+                                   -camera_position[2]});
+  glm_mat4_mul(rot_y, trans, view_matrix);
   const float aspect_ratio = context->window_size.aspect_ratio;
-  mat4_perspective_fov(fov_y, aspect_ratio, near_z, far_z, &projection_matrix);
+  mat4_perspective_fov(fov_y, aspect_ratio, near_z, far_z, projection_matrix);
+  glm_mat4_mul(projection_matrix, view_matrix, view_projection_matrix);
 
-  // Calculate the per-instance matrices
-  if (instance_data == NULL) {
-    instance_data = calloc(instance_buffer_length / 4, sizeof(float));
-  }
-  instance_count = MIN(ARRAY_SIZE(patch_centers), max_instance_count);
-  for (uint32_t i = 0; i < instance_count; ++i) {
-    mat4_translation(&model_matrix, patch_centers[i]);
-    mat4_mul(&view_matrix, &model_matrix, &model_view_matrix);
-    mat4_mul(&projection_matrix, &model_view_matrix,
-             &model_view_projection_matrix);
-    memcpy(instance_data + (i * instance_length), model_view_matrix,
-           sizeof(model_view_matrix));
-    memcpy(instance_data + (i * instance_length + 16),
-           model_view_projection_matrix, sizeof(model_view_projection_matrix));
+  // Select the quadtree nodes in the view frustum
+  frustum_update(&frustum, view_projection_matrix);
+  select_patches();
+
+  // Write the patches to the instance buffer
+  if (patch_count > 0) {
+    wgpu_queue_write_buffer(context->wgpu_context, instance_buffer.buffer, 0,
+                            patches, patch_count * sizeof(terrain_patch_t));
   }
 
-  // Write the instance data to the instance buffer
-  wgpu_queue_write_buffer(context->wgpu_context, instance_buffer.buffer, 0,
-                          instance_data,
-                          (instance_buffer_length / 4) * sizeof(float));
+  // Write the frame uniforms to the uniform buffer
+  memcpy(frame_uniforms.view, view_matrix, sizeof(view_matrix));
+  memcpy(frame_uniforms.view_projection, view_projection_matrix,
+         sizeof(view_projection_matrix));
+  glm_vec4(camera_position, 1.0f, frame_uniforms.camera_position);
+  glm_vec4_copy((vec4){(float)PATCH_SIZE, TERRAIN_HEIGHT_SCALE, far_z * 0.4f,
+                       far_z},
+                frame_uniforms.terrain);
+  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffer.buffer, 0,
+                          &frame_uniforms, sizeof(frame_uniforms));
 }
 
 static void prepare_uniform_buffers(wgpu_example_context_t* context)
 {
+  prepare_lod_ranges();
+
   instance_buffer = wgpu_create_buffer(
+    context->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+      .size  = sizeof(patches),
+    });
+
+  uniform_buffer = wgpu_create_buffer(
     context->wgpu_context,
     &(wgpu_buffer_desc_t){
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-      .size  = instance_buffer_length,
+      .size  = sizeof(frame_uniforms),
     });
 }
 
@@ -387,22 +561,22 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
 {
   // Frame constants bind group layout
   {
-    WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    WGPUBindGroupLayoutEntry bgl_entries[5] = {
       [0] = (WGPUBindGroupLayoutEntry) {
         // Sampler
         .binding    = 0,
-        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+        .visibility = WGPUShaderStage_Vertex,
         .sampler = (WGPUSamplerBindingLayout){
           .type = WGPUSamplerBindingType_Filtering,
         },
         .texture = {0},
       },
       [1] = (WGPUBindGroupLayoutEntry) {
-        // Texture view
+        // Texture view (color indirection texture)
         .binding    = 1,
-        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+        .visibility = WGPUShaderStage_Fragment,
         .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
+          .sampleType    = WGPUTextureSampleType_Uint,
           .viewDimension = WGPUTextureViewDimension_2D,
           .multisampled  = false,
         },
@@ -418,7 +592,27 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
           .multisampled  = false,
         },
         .storageTexture = {0},
-      }
+      },
+      [3] = (WGPUBindGroupLayoutEntry) {
+        // Texture view (color page cache)
+        .binding    = 3,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+          .multisampled  = false,
+        },
+        .storageTexture = {0},
+      },
+      [4] = (WGPUBindGroupLayoutEntry) {
+        // Sampler (color page cache)
+        .binding    = 4,
+        .visibility = WGPUShaderStage_Fragment,
+        .sampler = (WGPUSamplerBindingLayout){
+          .type = WGPUSamplerBindingType_Filtering,
+        },
+        .texture = {0},
+      },
     };
     bind_group_layouts.frame_constants = wgpuDeviceCreateBindGroupLayout(
       wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
@@ -428,34 +622,34 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(bind_group_layouts.frame_constants != NULL)
   }
 
-  // Instance buffer bind group
+  // Uniform buffer bind group
   {
     WGPUBindGroupLayoutEntry bgl_entries[1] = {
       [0] = (WGPUBindGroupLayoutEntry) {
-        // Transform
+        // Frame uniforms
         .binding = 0,
-        .visibility = WGPUShaderStage_Vertex,
+        .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
         .buffer = (WGPUBufferBindingLayout) {
           .type = WGPUBufferBindingType_Uniform,
           .hasDynamicOffset = false,
-          .minBindingSize   = instance_buffer_length,
+          .minBindingSize   = sizeof(frame_uniforms),
         },
         .sampler = {0},
       },
     };
-    bind_group_layouts.instance_buffer = wgpuDeviceCreateBindGroupLayout(
+    bind_group_layouts.uniform_buffer = wgpuDeviceCreateBindGroupLayout(
       wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
                               .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
                               .entries    = bgl_entries,
                             });
-    ASSERT(bind_group_layouts.instance_buffer != NULL)
+    ASSERT(bind_group_layouts.uniform_buffer != NULL)
   }
 
   // Create the pipeline layout that is used to generate the rendering pipelines
   // that are based on this bind group layout
   WGPUBindGroupLayout bindGroupLayouts[2] = {
     bind_group_layouts.frame_constants, // set 0
-    bind_group_layouts.instance_buffer, // set 1
+    bind_group_layouts.uniform_buffer,  // set 1
   };
   pipeline_layout = wgpuDeviceCreatePipelineLayout(
     wgpu_context->device,
@@ -470,19 +664,29 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
 {
   // Frame constants bind group
   {
-    WGPUBindGroupEntry bg_entries[3] = {
+    WGPUBindGroupEntry bg_entries[5] = {
       [0] = (WGPUBindGroupEntry) {
         .binding = 0,
         .sampler = linear_sampler,
       },
       [1] = (WGPUBindGroupEntry) {
         .binding     = 1,
-        .textureView = textures.color.view,
+        .textureView = wgpu_virtual_texture_get_indirection_view(
+                         color_virtual_texture),
       },
       [2] = (WGPUBindGroupEntry) {
         .binding     = 2,
         .textureView = textures.heightmap.view,
-      }
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding     = 3,
+        .textureView = wgpu_virtual_texture_get_cache_view(
+                         color_virtual_texture),
+      },
+      [4] = (WGPUBindGroupEntry) {
+        .binding = 4,
+        .sampler = wgpu_virtual_texture_get_sampler(color_virtual_texture),
+      },
     };
     WGPUBindGroupDescriptor bg_desc = {
       .layout     = bind_group_layouts.frame_constants,
@@ -494,24 +698,24 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
     ASSERT(bind_groups.frame_constants != NULL)
   }
 
-  // Instance buffer bind group
+  // Uniform buffer bind group
   {
     WGPUBindGroupEntry bg_entries[1] = {
       [0] = (WGPUBindGroupEntry) {
         .binding = 0,
-        .buffer  = instance_buffer.buffer,
+        .buffer  = uniform_buffer.buffer,
         .offset  = 0,
-        .size    = instance_buffer.size,
+        .size    = uniform_buffer.size,
       },
     };
     WGPUBindGroupDescriptor bg_desc = {
-      .layout     = bind_group_layouts.instance_buffer,
+      .layout     = bind_group_layouts.uniform_buffer,
       .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
       .entries    = bg_entries,
     };
-    bind_groups.instance_buffer
+    bind_groups.uniform_buffer
       = wgpuDeviceCreateBindGroup(wgpu_context->device, &bg_desc);
-    ASSERT(bind_groups.instance_buffer != NULL)
+    ASSERT(bind_groups.uniform_buffer != NULL)
   }
 }
 
@@ -540,39 +744,82 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     });
   depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
 
-  // Vertex buffer layout
-  WGPU_VERTEX_BUFFER_LAYOUT(
-    terrain_mesh, 24,
-    /* Attribute descriptions */
-    // Attribute location 0: Position
-    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x4, 0),
-    // Attribute location 1: Texture coordinates
-    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x2, 16))
+  // Vertex buffer layouts
+  WGPUVertexAttribute grid_attribute = {
+    // Attribute location 0: Grid coordinates
+    .shaderLocation = 0,
+    .offset         = 0,
+    .format         = WGPUVertexFormat_Float32x2,
+  };
+  WGPUVertexAttribute patch_attribute = {
+    // Attribute location 1: Patch origin, spacing and LOD
+    .shaderLocation = 1,
+    .offset         = 0,
+    .format         = WGPUVertexFormat_Float32x4,
+  };
+  WGPUVertexBufferLayout vertex_buffer_layouts[2] = {
+    [0] = (WGPUVertexBufferLayout) {
+      // Patch mesh
+      .arrayStride    = PATCH_FLOATS_PER_VERTEX * sizeof(float),
+      .stepMode       = WGPUVertexStepMode_Vertex,
+      .attributeCount = 1,
+      .attributes     = &grid_attribute,
+    },
+    [1] = (WGPUVertexBufferLayout) {
+      // Selected patches
+      .arrayStride    = sizeof(terrain_patch_t),
+      .stepMode       = WGPUVertexStepMode_Instance,
+      .attributeCount = 1,
+      .attributes     = &patch_attribute,
+    },
+  };
+
+  // The shader samples the color texture through the virtual texture functions
+  char* shader_wgsl = wgpu_virtual_texture_add_wgsl(terrain_mesh_shader_wgsl);
 
   // Vertex state
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
                     wgpu_context, &(wgpu_vertex_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Vertex shader SPIR-V
-                      .label = "terrain_mesh_vertex_shader",
-                      .file  = "shaders/terrain_mesh/shader.vert.spv",
+                      // Vertex shader WGSL
+                      .label            = "terrain_mesh_vertex_shader",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "vs_main",
                     },
-                    .buffer_count = 1,
-                    .buffers      = &terrain_mesh_vertex_buffer_layout,
+                    .buffer_count = (uint32_t)ARRAY_SIZE(vertex_buffer_layouts),
+                    .buffers      = vertex_buffer_layouts,
                   });
 
   // Fragment state
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
                     wgpu_context, &(wgpu_fragment_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Fragment shader SPIR-V
-                      .label = "terrain_mesh_fragment_shader",
-                      .file  = "shaders/terrain_mesh/shader.frag.spv",
+                      // Fragment shader WGSL
+                      .label            = "terrain_mesh_fragment_shader",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "fs_main",
                     },
                     .target_count = 1,
                     .targets      = &color_target_state,
                   });
 
+  // Feedback fragment state, page IDs into the feedback target
+  WGPUColorTargetState feedback_target_state = (WGPUColorTargetState){
+    .format    = WGPU_VIRTUAL_TEXTURE_FEEDBACK_FORMAT,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  WGPUFragmentState feedback_fragment_state = wgpu_create_fragment_state(
+                    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      // Fragment shader WGSL
+                      .label            = "terrain_mesh_feedback_shader",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "fs_feedback",
+                    },
+                    .target_count = 1,
+                    .targets      = &feedback_target_state,
+                  });
+
   // Multisample state
   WGPUMultisampleState multisample_state
     = wgpu_create_multisample_state_descriptor(
@@ -592,9 +839,26 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
                             .multisample  = multisample_state,
                           });
 
+  // Create the feedback pipeline, same geometry into the feedback target
+  WGPUDepthStencilState feedback_depth_stencil_state = depth_stencil_state;
+  feedback_depth_stencil_state.format
+    = WGPU_VIRTUAL_TEXTURE_FEEDBACK_DEPTH_FORMAT;
+  feedback_pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label        = "terrain_mesh_feedback_pipeline",
+                            .layout       = pipeline_layout,
+                            .primitive    = primitive_state,
+                            .vertex       = vertex_state,
+                            .fragment     = &feedback_fragment_state,
+                            .depthStencil = &feedback_depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, feedback_fragment_state.module);
+  free(shader_wgsl);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -602,7 +866,9 @@ static int example_initialize(wgpu_example_context_t* context)
   if (context) {
     prepare_patch_mesh(context->wgpu_context);
     prepare_uniform_buffers(context);
-    prepare_textures(context->wgpu_context);
+    if (!prepare_textures(context->wgpu_context)) {
+      return 1;
+    }
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_groups(context->wgpu_context);
@@ -614,6 +880,48 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  if (imgui_overlay_header("Virtual texture")) {
+    const wgpu_virtual_texture_stats_t* stats
+      = wgpu_virtual_texture_get_stats(color_virtual_texture);
+    imgui_overlay_text("Virtual size: %u x %u, %u levels (%.1f MB)",
+                       stats->virtual_size, stats->virtual_size,
+                       stats->level_count,
+                       (double)stats->virtual_bytes / (1024.0 * 1024.0));
+    imgui_overlay_text("Page cache: %u / %u pages (%.1f MB)",
+                       stats->resident_page_count, stats->slot_count,
+                       (double)stats->cache_bytes / (1024.0 * 1024.0));
+    imgui_overlay_text("Requested pages: %u, pending: %u",
+                       stats->requested_page_count, stats->pending_page_count);
+    imgui_overlay_text("Uploaded pages: %u, evicted: %u",
+                       stats->uploaded_page_count, stats->evicted_page_count);
+  }
+}
+
+static void draw_terrain(WGPURenderPassEncoder rpass_enc,
+                         WGPURenderPipeline pipeline)
+{
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, 0, vertices.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.frame_constants,
+                                    0, 0);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, 1, instance_buffer.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 1, bind_groups.uniform_buffer,
+                                    0, 0);
+  wgpuRenderPassEncoderSetIndexBuffer(rpass_enc, indices.buffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      WGPU_WHOLE_SIZE);
+  if (patch_count > 0) {
+    wgpuRenderPassEncoderDrawIndexed(rpass_enc, (uint32_t)PATCH_INDEX_COUNT,
+                                     patch_count, 0, 0, 0);
+  }
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   // Set target frame buffer
@@ -623,28 +931,29 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Feedback pass, skipped while the previous feedback is read back
+  WGPURenderPassEncoder feedback_pass_enc
+    = wgpu_virtual_texture_begin_feedback_pass(
+      color_virtual_texture, wgpu_context->cmd_enc,
+      wgpu_context->surface.width, wgpu_context->surface.height);
+  if (feedback_pass_enc != NULL) {
+    draw_terrain(feedback_pass_enc, feedback_pipeline);
+    wgpu_virtual_texture_end_feedback_pass(
+      color_virtual_texture, wgpu_context->cmd_enc, feedback_pass_enc);
+  }
+
   // Create render pass encoder for encoding drawing commands
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass_desc);
-
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, render_pipeline);
-  wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                       vertices.buffer, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                    bind_groups.frame_constants, 0, 0);
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 1,
-                                    bind_groups.instance_buffer, 0, 0);
-  wgpuRenderPassEncoderSetIndexBuffer(wgpu_context->rpass_enc, indices.buffer,
-                                      WGPUIndexFormat_Uint32, 0,
-                                      WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
-                                   (uint32_t)PATCH_INDEX_COUNT, instance_count,
-                                   0, 0, 0);
+  draw_terrain(wgpu_context->rpass_enc, render_pipeline);
 
   // Create command buffer and cleanup
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
 
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
   WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
@@ -678,6 +987,7 @@ static int example_render(wgpu_example_context_t* context)
     return 1;
   }
   update_uniforms(context);
+  wgpu_virtual_texture_update(color_virtual_texture);
   return example_draw(context);
 }
 
@@ -685,23 +995,22 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
 
-  if (instance_data != NULL) {
-    free(instance_data);
-  }
-
-  wgpu_destroy_texture(&textures.color);
+  wgpu_virtual_texture_destroy(color_virtual_texture);
+  color_virtual_texture = NULL;
   wgpu_destroy_texture(&textures.heightmap);
   WGPU_RELEASE_RESOURCE(Sampler, linear_sampler)
 
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, indices.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, instance_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer.buffer)
   WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, feedback_pipeline)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.frame_constants)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.instance_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.uniform_buffer)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.frame_constants)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.instance_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.uniform_buffer)
 }
 
 void example_terrain_mesh(int argc, char* argv[])
@@ -709,7 +1018,8 @@ void example_terrain_mesh(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title = example_title,
+      .title   = example_title,
+      .overlay = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -1,6 +1,7 @@
 #include "example_base.h"
 #include "examples.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "../webgpu/gltf_model.h"
@@ -10,8 +11,14 @@
  * WebGPU Example - Text Overlay
  *
  * Load and render a 2D text overlay created from the bitmap glyph data of a stb
- * font file. This data is uploaded as a texture and used for displaying text on
- * top of a 3D scene in a second pass.
+ * font file. A distance field of the glyphs is uploaded as a texture and used
+ * for displaying text on top of a 3D scene in a second pass, the text can be
+ * scaled with the "+" / "-" keys and stays sharp at any size.
+ *
+ * The cube is drawn without vertex and index buffer bindings, its vertex
+ * shader pulls the indices and vertices from the storage buffers of the glTF
+ * model. The position of a vertex in the index buffer also gives its corner in
+ * the triangle, which outlines the triangle edges.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/textoverlay
@@ -23,10 +30,12 @@ static struct {
   text_overlay_t* handle;
   bool redraw_needed;
   bool visible;
+  float scale;
 } text_overlay = {
   .handle        = NULL,
   .redraw_needed = true,
   .visible       = true,
+  .scale         = 1.5f,
 };
 
 static wgpu_buffer_t uniform_buffer_vs;
@@ -52,10 +61,70 @@ static WGPUPipelineLayout pipeline_layout;
 static WGPUBindGroup bind_group;
 static WGPUBindGroupLayout bind_group_layout;
 
+// Storage buffers of the model's vertices and indices
+static WGPUBindGroupLayout vertex_pulling_bind_group_layout;
+
 // Other variables
 static const char* example_title = "Text Overlay";
 static bool prepared             = false;
 
+// Shaders, prefixed with the vertex pulling prelude of group 1
+// clang-format off
+static const char* mesh_shader_wgsl = CODE(
+  struct UBO {
+    projection : mat4x4<f32>,
+    modelView : mat4x4<f32>,
+    lightPos : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : UBO;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+    @location(1) color : vec3<f32>,
+    @location(2) viewVec : vec3<f32>,
+    @location(3) lightVec : vec3<f32>,
+    @location(4) barycentric : vec3<f32>,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    // Drawn without index buffer, the vertex index is the position in it
+    let vertex = gltf_pull_vertex(gltf_pull_index(vertexIndex));
+    let pos = ubo.modelView * vec4<f32>(vertex.position, 1.0);
+    let modelView3 = mat3x3<f32>(ubo.modelView[0].xyz, ubo.modelView[1].xyz,
+                                 ubo.modelView[2].xyz);
+    var output : VertexOutput;
+    output.position = ubo.projection * pos;
+    output.normal = modelView3 * vertex.normal;
+    output.color = vertex.color.rgb;
+    output.lightVec = modelView3 * ubo.lightPos.xyz - pos.xyz;
+    output.viewVec = -pos.xyz;
+    let corner = vertexIndex % 3u;
+    output.barycentric = vec3<f32>(f32(corner == 0u), f32(corner == 1u),
+                                   f32(corner == 2u));
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let N = normalize(input.normal);
+    let L = normalize(input.lightVec);
+    let V = normalize(input.viewVec);
+    let R = reflect(-L, N);
+    let diffuse = max(dot(N, L), 0.25) * input.color;
+    let specular = pow(max(dot(R, V), 0.0), 16.0) * vec3<f32>(0.5);
+    // Darken the pixels close to the triangle edges
+    let edgeDistance = min(min(input.barycentric.x, input.barycentric.y),
+                           input.barycentric.z);
+    let edge = 1.0 - smoothstep(0.0, 1.5 * fwidth(edgeDistance),
+                                edgeDistance);
+    return vec4<f32>((diffuse + specular) * (1.0 - 0.5 * edge), 1.0);
+  }
+);
+// clang-format on
+
 static void setup_camera(wgpu_example_context_t* context)
 {
   context->camera       = camera_create();
@@ -71,7 +140,8 @@ static void load_assets(wgpu_context_t* wgpu_context)
   const uint32_t gltf_loading_flags
     = WGPU_GLTF_FileLoadingFlags_PreTransformVertices
       | WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors
-      | WGPU_GLTF_FileLoadingFlags_DontLoadImages;
+      | WGPU_GLTF_FileLoadingFlags_DontLoadImages
+      | WGPU_GLTF_FileLoadingFlags_VertexPulling;
   model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
     .wgpu_context       = wgpu_context,
     .filename           = "models/cube.gltf",
@@ -102,12 +172,30 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
                           });
   ASSERT(bind_group_layout != NULL);
 
+  // Vertex pulling bind group layout
+  WGPUBindGroupLayoutEntry
+    vertex_pulling_bgl_entries[WGPU_GLTF_VERTEX_PULLING_BINDING_COUNT];
+  wgpu_gltf_get_vertex_pulling_bind_group_layout_entries(
+    vertex_pulling_bgl_entries);
+  vertex_pulling_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device,
+    &(WGPUBindGroupLayoutDescriptor){
+      .entryCount = (uint32_t)ARRAY_SIZE(vertex_pulling_bgl_entries),
+      .entries    = vertex_pulling_bgl_entries,
+    });
+  ASSERT(vertex_pulling_bind_group_layout != NULL);
+
   // Create the pipeline layout
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    bind_group_layout,                // set 0
+    vertex_pulling_bind_group_layout, // set 1
+  };
   pipeline_layout = wgpuDeviceCreatePipelineLayout(
-    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
-                            .bindGroupLayoutCount = 1,
-                            .bindGroupLayouts     = &bind_group_layout,
-                          });
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+      .bindGroupLayouts     = bind_group_layouts,
+    });
   ASSERT(pipeline_layout != NULL);
 }
 
@@ -131,6 +219,10 @@ static void setup_bind_group(wgpu_context_t* wgpu_context)
                             .entries    = bg_entries,
                           });
   ASSERT(bind_group != NULL);
+
+  // Bind group of the model's vertices and indices
+  wgpu_gltf_model_prepare_vertex_pulling_bind_group(
+    model, vertex_pulling_bind_group_layout);
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -185,39 +277,35 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
       .depth_write_enabled = true,
     });
 
-  // Vertex buffer layout
-  WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
-    tunnel_cylinder,
-    // Location 0: Position
-    WGPU_GLTF_VERTATTR_DESC(0, WGPU_GLTF_VertexComponent_Position),
-    // Location 1: Vertex normal
-    WGPU_GLTF_VERTATTR_DESC(1, WGPU_GLTF_VertexComponent_Normal),
-    // Location 2: Texture coordinates
-    WGPU_GLTF_VERTATTR_DESC(2, WGPU_GLTF_VertexComponent_UV));
+  // Mesh shader, the vertices are pulled from the storage buffers
+  char* mesh_wgsl = wgpu_gltf_create_vertex_pulling_wgsl(
+    wgpu_gltf_model_get_vertex_format(model), 1, mesh_shader_wgsl);
 
   // Vertex state
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
             wgpu_context, &(wgpu_vertex_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Vertex shader SPIR-V
-              .label = "mesh_vertex_shader",
-              .file  = "shaders/text_overlay/mesh.vert.spv",
+              // Vertex shader WGSL
+              .label            = "mesh_vertex_shader",
+              .wgsl_code.source = mesh_wgsl,
+              .entry            = "vs_main",
             },
-            .buffer_count = 1,
-            .buffers      = &tunnel_cylinder_vertex_buffer_layout,
+            .buffer_count = 0,
           });
 
   // Fragment state
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
             wgpu_context, &(wgpu_fragment_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              // Fragment shader SPIR-V
-              .label = "mesh_fragment_shader",
-              .file  = "shaders/text_overlay/mesh.frag.spv",
+              // Fragment shader WGSL
+              .label            = "mesh_fragment_shader",
+              .wgsl_code.source = mesh_wgsl,
+              .entry            = "fs_main",
             },
             .target_count = 1,
             .targets      = &color_target_state,
           });
+  free(mesh_wgsl);
 
   // Multisample state
   WGPUMultisampleState multisample_state
@@ -277,7 +365,10 @@ void update_text_overlay(wgpu_example_context_t* context)
   // Window height
   float width  = (float)context->wgpu_context->surface.width;
   float height = (float)context->wgpu_context->surface.height;
+  // Line height, 20 pixels at the default scale
+  const float line = 20.0f * text_overlay.scale / 1.5f;
 
+  text_overlay_set_scale(text_overlay.handle, text_overlay.scale);
   text_overlay_begin_text_update(text_overlay.handle);
 
   // Display example info
@@ -285,11 +376,11 @@ void update_text_overlay(wgpu_example_context_t* context)
     text_overlay.handle, 5.0f, 5.0f, TextOverlay_Text_AlignLeft,
     "WebGPU Example - %s", context->example_title);
   text_overlay_add_formatted_text(
-    text_overlay.handle, 5.0f, 25.0f, TextOverlay_Text_AlignLeft,
+    text_overlay.handle, 5.0f, 5.0f + line, TextOverlay_Text_AlignLeft,
     "%.2f ms/frame (%.1d fps)", (1000.0f / context->last_fps),
     context->last_fps);
   text_overlay_add_text(text_overlay.handle, context->adapter_info[0], 5.0f,
-                        45.0f, TextOverlay_Text_AlignLeft);
+                        5.0f + 2.0f * line, TextOverlay_Text_AlignLeft);
 
   // Display current model view matrix
   text_overlay_add_text(text_overlay.handle, "Model View Matrix", (float)width,
@@ -297,7 +388,7 @@ void update_text_overlay(wgpu_example_context_t* context)
 
   for (uint32_t i = 0; i < 4; i++) {
     text_overlay_add_formatted_text(
-      text_overlay.handle, (float)width, 25.0f + (float)i * 20.0f,
+      text_overlay.handle, (float)width, 5.0f + (float)(i + 1) * line,
       TextOverlay_Text_AlignRight, "%+.2f %+.2f %+.2f %+.2f",
       ubo_vs.model_view[0][i], ubo_vs.model_view[1][i], ubo_vs.model_view[2][i],
       ubo_vs.model_view[3][i]);
@@ -305,13 +396,16 @@ void update_text_overlay(wgpu_example_context_t* context)
 
   // Display text overlay visibility toggle info
   text_overlay_add_text(text_overlay.handle,
-                        "Press \"space\" to toggle text overlay", 5.0f, 65.0f,
-                        TextOverlay_Text_AlignLeft);
+                        "Press \"space\" to toggle text overlay", 5.0f,
+                        5.0f + 3.0f * line, TextOverlay_Text_AlignLeft);
+  text_overlay_add_text(text_overlay.handle,
+                        "Press \"+\" / \"-\" to scale the text", 5.0f,
+                        5.0f + 4.0f * line, TextOverlay_Text_AlignLeft);
 
   // Display cube dragging related text
   text_overlay_add_text(text_overlay.handle,
                         "Hold middle mouse button and drag to move", 5.0f,
-                        85.0f, TextOverlay_Text_AlignLeft);
+                        5.0f + 5.0f * line, TextOverlay_Text_AlignLeft);
   mat4 model_view_projection = GLM_MAT4_ZERO_INIT;
   glm_mat4_mul(ubo_vs.projection, ubo_vs.model_view, model_view_projection);
   vec3 projected = GLM_VEC3_ZERO_INIT;
@@ -379,8 +473,16 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
   wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
                                     0);
 
-  // Draw model
-  wgpu_gltf_model_draw(model, (wgpu_gltf_model_render_options_t){0});
+  // Set the vertex pulling bind group
+  wgpuRenderPassEncoderSetBindGroup(
+    wgpu_context->rpass_enc, 1,
+    wgpu_gltf_model_get_vertex_pulling_bind_group(model), 0, 0);
+
+  // Draw model, the vertex shader pulls the indices
+  wgpu_gltf_model_draw(
+    model, (wgpu_gltf_model_render_options_t){
+             .render_flags = WGPU_GLTF_RenderFlags_PullIndices,
+           });
 
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
@@ -447,6 +549,12 @@ static void example_on_key_pressed(keycode_t key)
     // Toggle text overlay visibility
     text_overlay.visible = !text_overlay.visible;
   }
+  else if (key == KEY_EQUAL || key == KEY_MINUS) {
+    // Scale the text, the glyphs are drawn from the same distance field
+    const float factor = key == KEY_EQUAL ? 1.25f : 0.8f;
+    text_overlay.scale = CLAMP(text_overlay.scale * factor, 0.5f, 8.0f);
+    text_overlay.redraw_needed = true;
+  }
 }
 
 // Clean up used resources
@@ -459,6 +567,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, vertex_pulling_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
 }
 
@@ -3,6 +3,15 @@
 
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64)                                      \
+  || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SIMD_WIDTH 4
+#else
+#define NOISE_SIMD_WIDTH 1
+#endif
+
+#include "../core/thread_pool.h"
 #include "../webgpu/imgui_overlay.h"
 #include "../webgpu/texture.h"
 
@@ -11,9 +20,20 @@
  *
  * 3D texture loading (and generation using perlin noise) example.
  *
- * Generates a 3D texture on the cpu (using perlin noise), uploads it to the
- * device and samples it to render an animation. 3D textures store volumetric
- * data and interpolate in all three dimensions.
+ * Generates a 3D texture (using perlin noise) and samples it to render an
+ * animation. 3D textures store volumetric data and interpolate in all three
+ * dimensions.
+ *
+ * The noise is generated by a compute shader from the same permutation table
+ * as the CPU implementation, which writes the packed voxels into a buffer that
+ * is copied into the texture. The CPU fallback evaluates four voxels at once
+ * with SSE2 and splits the rows between the threads of a thread pool.
+ *
+ * The volume mode raymarches the noise as a participating medium. A min/max
+ * grid of 8 x 8 x 8 voxel cells is built after every generation, rays jump
+ * over the cells whose maximum is below the density threshold and stop once
+ * the accumulated opacity saturates. The samples per pixel can be shown as a
+ * heat map together with their average, read back from the GPU.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/texture3d/texture3d.cpp
@@ -164,15 +184,149 @@ static float fractal_noise_generate(fractal_noise_t* fractal_noise, float x,
   return (sum + 1.0f) / 2.0f;
 }
 
+/* -------------------------------------------------------------------------- *
+ * SIMD version of the fractal noise, four points along x per call
+ * -------------------------------------------------------------------------- */
+
+#if NOISE_SIMD_WIDTH == 4
+static inline __m128 simd_floor(__m128 x)
+{
+  const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 simd_select(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 simd_fade(__m128 t)
+{
+  const __m128 t6 = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)),
+                               _mm_set1_ps(15.0f));
+  const __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+  return _mm_mul_ps(t3, _mm_add_ps(_mm_mul_ps(t, t6), _mm_set1_ps(10.0f)));
+}
+
+static inline __m128 simd_lerp(__m128 t, __m128 a, __m128 b)
+{
+  return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+// Branchless grad(), the signs are flipped with the low hash bits
+static inline __m128 simd_grad(__m128i hash, __m128 x, __m128 y, __m128 z)
+{
+  const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+  const __m128 h_lt_8
+    = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+  const __m128 h_lt_4
+    = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+  const __m128 h_12_14 = _mm_castsi128_ps(
+    _mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+                 _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+  const __m128 u = simd_select(h_lt_8, x, y);
+  const __m128 v = simd_select(h_lt_4, y, simd_select(h_12_14, x, z));
+  const __m128 sign_u
+    = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+  const __m128 sign_v
+    = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+  return _mm_add_ps(_mm_xor_ps(u, sign_u), _mm_xor_ps(v, sign_v));
+}
+
+static __m128 perlin_noise_generate4(const perlin_noise_t* perlin_noise,
+                                     __m128 x, __m128 y, __m128 z)
+{
+  const uint32_t* p = perlin_noise->permutations;
+
+  // Find unit cubes that contain the points
+  const __m128 fx    = simd_floor(x);
+  const __m128 fy    = simd_floor(y);
+  const __m128 fz    = simd_floor(z);
+  const __m128i mask = _mm_set1_epi32(255);
+  int32_t cx[4], cy[4], cz[4];
+  _mm_storeu_si128((__m128i*)cx, _mm_and_si128(_mm_cvttps_epi32(fx), mask));
+  _mm_storeu_si128((__m128i*)cy, _mm_and_si128(_mm_cvttps_epi32(fy), mask));
+  _mm_storeu_si128((__m128i*)cz, _mm_and_si128(_mm_cvttps_epi32(fz), mask));
+  // Find relative x,y,z of the points in the cubes
+  x = _mm_sub_ps(x, fx);
+  y = _mm_sub_ps(y, fy);
+  z = _mm_sub_ps(z, fz);
+
+  // Hash coordinates of the 8 cube corners, gathered per lane
+  int32_t hashes[8][4];
+  for (uint32_t l = 0; l < 4; ++l) {
+    const uint32_t A  = p[cx[l]] + cy[l];
+    const uint32_t AA = p[A] + cz[l];
+    const uint32_t AB = p[A + 1] + cz[l];
+    const uint32_t B  = p[cx[l] + 1] + cy[l];
+    const uint32_t BA = p[B] + cz[l];
+    const uint32_t BB = p[B + 1] + cz[l];
+    hashes[0][l]      = (int32_t)p[AA];
+    hashes[1][l]      = (int32_t)p[BA];
+    hashes[2][l]      = (int32_t)p[AB];
+    hashes[3][l]      = (int32_t)p[BB];
+    hashes[4][l]      = (int32_t)p[AA + 1];
+    hashes[5][l]      = (int32_t)p[BA + 1];
+    hashes[6][l]      = (int32_t)p[AB + 1];
+    hashes[7][l]      = (int32_t)p[BB + 1];
+  }
+  __m128i h[8];
+  for (uint32_t i = 0; i < 8; ++i) {
+    h[i] = _mm_loadu_si128((const __m128i*)hashes[i]);
+  }
+
+  // Compute fade curves and blend the results of the 8 corners
+  const __m128 u   = simd_fade(x);
+  const __m128 v   = simd_fade(y);
+  const __m128 w   = simd_fade(z);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 x1  = _mm_sub_ps(x, one);
+  const __m128 y1  = _mm_sub_ps(y, one);
+  const __m128 z1  = _mm_sub_ps(z, one);
+  return simd_lerp(
+    w,
+    simd_lerp(v,
+              simd_lerp(u, simd_grad(h[0], x, y, z), simd_grad(h[1], x1, y, z)),
+              simd_lerp(u, simd_grad(h[2], x, y1, z),
+                        simd_grad(h[3], x1, y1, z))),
+    simd_lerp(v,
+              simd_lerp(u, simd_grad(h[4], x, y, z1),
+                        simd_grad(h[5], x1, y, z1)),
+              simd_lerp(u, simd_grad(h[6], x, y1, z1),
+                        simd_grad(h[7], x1, y1, z1))));
+}
+
+static __m128 fractal_noise_generate4(const fractal_noise_t* fractal_noise,
+                                      __m128 x, __m128 y, __m128 z)
+{
+  __m128 sum      = _mm_setzero_ps();
+  float frequency = 1.0f;
+  float amplitude = 1.0f;
+  float max       = 0.0f;
+  for (uint32_t i = 0; i < fractal_noise->octaves; i++) {
+    const __m128 f     = _mm_set1_ps(frequency);
+    const __m128 noise = perlin_noise_generate4(
+      fractal_noise->perlin_noise, _mm_mul_ps(x, f), _mm_mul_ps(y, f),
+      _mm_mul_ps(z, f));
+    sum = _mm_add_ps(sum, _mm_mul_ps(noise, _mm_set1_ps(amplitude)));
+    max += amplitude;
+    amplitude *= fractal_noise->persistence;
+    frequency *= 2.0f;
+  }
+
+  sum = _mm_div_ps(sum, _mm_set1_ps(max));
+  return _mm_mul_ps(_mm_add_ps(sum, _mm_set1_ps(1.0f)), _mm_set1_ps(0.5f));
+}
+#endif
+
 /* -------------------------------------------------------------------------- *
  * WebGPU 3D textures example
  * -------------------------------------------------------------------------- */
 
-#define NOISE_TEXTURE_WIDTH 128
-#define NOISE_TEXTURE_HEIGHT 128
-#define NOISE_TEXTURE_DEPTH 128
-#define NOISE_TEXTURE_SIZE                                                     \
-  (NOISE_TEXTURE_WIDTH * NOISE_TEXTURE_HEIGHT * NOISE_TEXTURE_DEPTH)
+// Edge lengths of the selectable noise textures
+static const uint32_t noise_texture_sizes[3] = {64, 128, 256};
+static const char* noise_texture_size_names[3]
+  = {"64 x 64 x 64", "128 x 128 x 128", "256 x 256 x 256"};
 
 // Contains all Vulkan objects that are required to store and use a 3D texture
 static struct {
@@ -182,13 +336,106 @@ static struct {
   WGPUTextureFormat format;
   uint32_t width, height, depth;
   uint32_t mip_levels;
-  uint8_t data[NOISE_TEXTURE_SIZE];
+  uint8_t* data; // CPU generated voxels
   struct {
     perlin_noise_t perlin_noise;
     fractal_noise_t fractal_noise;
+    float noise_scale;
   } data_generation;
 } noise_texture;
 
+// Compute shader noise generation
+static struct {
+  // Uniform block object of the compute shader
+  struct {
+    uint32_t size[3];
+    uint32_t words_per_row; // Packed voxels per row of the voxel buffer
+    float noise_scale;
+    float persistence;
+    uint32_t octaves;
+    uint32_t _pad;
+  } params;
+  wgpu_buffer_t params_buffer;
+  wgpu_buffer_t permutations_buffer;
+  // Four R8 voxels per word, rows padded to the copy alignment of 256 bytes
+  wgpu_buffer_t voxel_buffer;
+  uint32_t bytes_per_row;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+  bool pending; // Generation is recorded with the next frame
+} noise_generator;
+
+// Edge length of the cells of the occupancy grid in voxels
+#define OCCUPANCY_CELL_SIZE 8u
+
+// Min/max occupancy grid of the noise texture, one u32 per cell: the minimum
+// in bits 0..7, the maximum in bits 8..15. The range of a cell includes the
+// voxels next to it, which trilinear samples inside the cell read.
+static struct {
+  wgpu_buffer_t buffer;
+  uint32_t cell_counts[3];
+  WGPUBindGroup bind_group;
+  WGPUComputePipeline pipeline;
+  bool pending; // Built with the next frame, after the noise generation
+} occupancy_grid;
+
+// Volume raymarching
+static struct {
+  struct {
+    mat4 inverse_view_projection;
+    vec4 camera_position;
+    uint32_t cell_counts[3];
+    uint32_t step_count;
+    float threshold;
+    float density;
+    uint32_t flags; // VOLUME_FLAG_*
+    uint32_t padding;
+  } ubo;
+  wgpu_buffer_t uniform_buffer;
+  // Sample and ray counters of the samples per pixel mode
+  wgpu_buffer_t stats_buffer;
+  WGPUSampler sampler;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline pipeline;
+  bool readback_pending;
+  float samples_per_pixel;
+} volume;
+
+#define VOLUME_FLAG_EMPTY_SPACE_SKIPPING 1u
+#define VOLUME_FLAG_EARLY_TERMINATION 2u
+#define VOLUME_FLAG_SHOW_SAMPLES 4u
+
+// Noise generation and rendering settings
+static struct {
+  int32_t generator; // 0 = compute shader, 1 = CPU
+  int32_t size_index;
+  float cpu_time_ms;
+  float gpu_time_ms;
+  int32_t render_mode; // 0 = slice, 1 = volume
+  int32_t step_count;  // Samples along the diagonal of the volume
+  float threshold;     // Density below which the volume is empty
+  float density;
+  bool empty_space_skipping;
+  bool early_termination;
+  bool show_samples;
+} settings = {
+  .generator            = 0,
+  .size_index           = 1,
+  .render_mode          = 1,
+  .step_count           = 256,
+  .threshold            = 0.6f,
+  .density              = 20.0f,
+  .empty_space_skipping = true,
+  .early_termination    = true,
+};
+
+// CPU noise generation threads
+static thread_pool_t* thread_pool = NULL;
+
 // Vertex layout for this example
 typedef struct vertex_t {
   vec3 pos;
@@ -245,41 +492,327 @@ static void setup_camera(wgpu_example_context_t* context)
                          context->window_size.aspect_ratio, 0.1f, 256.0f);
 }
 
-// Generate randomized noise and upload it to the 3D texture using staging
-static void update_noise_texture(wgpu_context_t* wgpu_context)
+// clang-format off
+static const char* noise_generation_shader_wgsl = CODE(
+  struct Params {
+    size : vec3<u32>,
+    words_per_row : u32,
+    noise_scale : f32,
+    persistence : f32,
+    octaves : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var<storage, read> permutations : array<u32, 512>;
+  @group(0) @binding(2) var<storage, read_write> voxels : array<u32>;
+
+  fn fade(t : vec3<f32>) -> vec3<f32> {
+    return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+  }
+
+  fn grad(hash : u32, x : f32, y : f32, z : f32) -> f32 {
+    let h = hash & 15u;
+    let u = select(y, x, h < 8u);
+    let v = select(select(z, x, h == 12u || h == 14u), y, h < 4u);
+    return select(-u, u, (h & 1u) == 0u) + select(-v, v, (h & 2u) == 0u);
+  }
+
+  fn perlin_noise(p : vec3<f32>) -> f32 {
+    let cell = vec3<u32>(vec3<i32>(floor(p)) & vec3<i32>(255));
+    let f = p - floor(p);
+    let g = f - vec3(1.0);
+    let w = fade(f);
+    let a = permutations[cell.x] + cell.y;
+    let aa = permutations[a] + cell.z;
+    let ab = permutations[a + 1u] + cell.z;
+    let b = permutations[cell.x + 1u] + cell.y;
+    let ba = permutations[b] + cell.z;
+    let bb = permutations[b + 1u] + cell.z;
+    return mix(
+      mix(mix(grad(permutations[aa], f.x, f.y, f.z),
+              grad(permutations[ba], g.x, f.y, f.z), w.x),
+          mix(grad(permutations[ab], f.x, g.y, f.z),
+              grad(permutations[bb], g.x, g.y, f.z), w.x), w.y),
+      mix(mix(grad(permutations[aa + 1u], f.x, f.y, g.z),
+              grad(permutations[ba + 1u], g.x, f.y, g.z), w.x),
+          mix(grad(permutations[ab + 1u], f.x, g.y, g.z),
+              grad(permutations[bb + 1u], g.x, g.y, g.z), w.x), w.y),
+      w.z);
+  }
+
+  fn fractal_noise(p : vec3<f32>) -> f32 {
+    var sum = 0.0;
+    var frequency = 1.0;
+    var amplitude = 1.0;
+    var total = 0.0;
+    for (var i = 0u; i < params.octaves; i = i + 1u) {
+      sum = sum + perlin_noise(p * frequency) * amplitude;
+      total = total + amplitude;
+      amplitude = amplitude * params.persistence;
+      frequency = frequency * 2.0;
+    }
+    return (sum / total + 1.0) / 2.0;
+  }
+
+  // Four voxels along x per invocation, packed into a word
+  @compute @workgroup_size(8, 8, 1)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let x = id.x * 4u;
+    if (x >= params.size.x || id.y >= params.size.y
+        || id.z >= params.size.z) {
+      return;
+    }
+    var word = 0u;
+    for (var i = 0u; i < 4u; i = i + 1u) {
+      let voxel = vec3<f32>(vec3(x + i, id.y, id.z));
+      var n = fractal_noise(voxel / vec3<f32>(params.size)
+                            * params.noise_scale);
+      n = n - floor(n);
+      word = word | (u32(floor(n * 255.0)) << (8u * i));
+    }
+    let row = id.z * params.size.y + id.y;
+    voxels[row * params.words_per_row + id.x] = word;
+  }
+);
+
+static const char* occupancy_grid_shader_wgsl = CODE(
+  @group(0) @binding(0) var noise : texture_3d<f32>;
+  @group(0) @binding(1) var<storage, read_write> cells : array<u32>;
+
+  const CELL_SIZE = 8;
+
+  @compute @workgroup_size(4, 4, 4)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let size = vec3<i32>(textureDimensions(noise));
+    let cellCounts = vec3<u32>(size + CELL_SIZE - 1) / u32(CELL_SIZE);
+    if (any(id >= cellCounts)) {
+      return;
+    }
+    // The cell and its neighbor voxels
+    let first = max(vec3<i32>(id) * CELL_SIZE - 1, vec3<i32>(0));
+    let last = min(vec3<i32>(id) * CELL_SIZE + CELL_SIZE, size - 1);
+    var minValue = 1.0;
+    var maxValue = 0.0;
+    for (var z = first.z; z <= last.z; z++) {
+      for (var y = first.y; y <= last.y; y++) {
+        for (var x = first.x; x <= last.x; x++) {
+          let value = textureLoad(noise, vec3<i32>(x, y, z), 0).r;
+          minValue = min(minValue, value);
+          maxValue = max(maxValue, value);
+        }
+      }
+    }
+    let index = (id.z * cellCounts.y + id.y) * cellCounts.x + id.x;
+    cells[index] = u32(round(minValue * 255.0))
+                   | (u32(round(maxValue * 255.0)) << 8u);
+  }
+);
+
+static const char* volume_shader_wgsl = CODE(
+  struct Params {
+    inverseViewProjection : mat4x4<f32>,
+    cameraPosition : vec4<f32>,
+    cellCounts : vec3<u32>,
+    stepCount : u32,
+    threshold : f32,
+    density : f32,
+    flags : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var noise : texture_3d<f32>;
+  @group(0) @binding(2) var noiseSampler : sampler;
+  @group(0) @binding(3) var<storage, read> cells : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> stats : array<atomic<u32>, 2>;
+
+  const EMPTY_SPACE_SKIPPING = 1u;
+  const EARLY_TERMINATION = 2u;
+  const SHOW_SAMPLES = 4u;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) ndc : vec2<f32>,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    let p = vec2<f32>(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u))
+            * 2.0 - 1.0;
+    var output : VertexOutput;
+    output.position = vec4<f32>(p, 0.0, 1.0);
+    output.ndc = p;
+    return output;
+  }
+
+  // Ray parameters of the entry and the exit of the [-1, 1] box
+  fn intersectBox(origin : vec3<f32>, invDir : vec3<f32>) -> vec2<f32> {
+    let t0 = (vec3<f32>(-1.0) - origin) * invDir;
+    let t1 = (vec3<f32>(1.0) - origin) * invDir;
+    let tMin = min(t0, t1);
+    let tMax = max(t0, t1);
+    return vec2<f32>(max(max(tMin.x, tMin.y), tMin.z),
+                     min(min(tMax.x, tMax.y), tMax.z));
+  }
+
+  fn heatMap(value : f32) -> vec3<f32> {
+    let v = clamp(value, 0.0, 1.0);
+    return vec3<f32>(v, 1.0 - abs(2.0 * v - 1.0), 1.0 - v);
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let far = params.inverseViewProjection * vec4<f32>(input.ndc, 1.0, 1.0);
+    let origin = params.cameraPosition.xyz;
+    let dir = normalize(far.xyz / far.w - origin);
+    let invDir = 1.0 / dir;
+    let range = intersectBox(origin, invDir);
+    let tEnd = range.y;
+    var t = max(range.x, 0.0);
+    if (t >= tEnd) {
+      return vec4<f32>(0.0, 0.0, 0.0, 1.0);
+    }
+
+    // The samples lie on a fixed grid along the ray, skipped cells keep it
+    let dt = 2.0 * sqrt(3.0) / f32(params.stepCount);
+    t = ceil(t / dt) * dt;
+    let volumeSize = vec3<f32>(textureDimensions(noise));
+    // Size of a cell in world units, the volume spans 2 units per axis
+    let cellSize = 2.0 * 8.0 / volumeSize;
+    let maxIterations = params.stepCount + 4u * (params.cellCounts.x
+                        + params.cellCounts.y + params.cellCounts.z);
+
+    var color = vec3<f32>(0.0);
+    var alpha = 0.0;
+    var samples = 0u;
+    for (var i = 0u; i < maxIterations && t < tEnd; i++) {
+      let position = origin + t * dir;
+      let uvw = clamp(position * 0.5 + 0.5, vec3<f32>(0.0), vec3<f32>(1.0));
+      if ((params.flags & EMPTY_SPACE_SKIPPING) != 0u) {
+        let cell = min(vec3<u32>(uvw * volumeSize / 8.0),
+                       params.cellCounts - 1u);
+        let index = (cell.z * params.cellCounts.y + cell.y)
+                    * params.cellCounts.x + cell.x;
+        let maxValue = f32(cells[index] >> 8u) / 255.0;
+        if (maxValue <= params.threshold) {
+          // Jump to the first sample behind the cell
+          let cellMin = vec3<f32>(cell) * cellSize - 1.0;
+          let cellExit = select(cellMin, cellMin + cellSize,
+                                dir > vec3<f32>(0.0));
+          let exits = (cellExit - origin) * invDir;
+          let tExit = min(min(exits.x, exits.y), exits.z);
+          t = max(floor(tExit / dt) * dt + dt, t + dt);
+          continue;
+        }
+      }
+
+      let value = textureSampleLevel(noise, noiseSampler, uvw, 0.0).r;
+      samples++;
+      let extinction = params.density * max(value - params.threshold, 0.0)
+                       / (1.0 - params.threshold);
+      let sampleAlpha = 1.0 - exp(-extinction * dt);
+      let sampleColor = mix(vec3<f32>(0.1, 0.3, 0.8),
+                            vec3<f32>(1.0, 0.9, 0.7), value);
+      color += (1.0 - alpha) * sampleAlpha * sampleColor;
+      alpha += (1.0 - alpha) * sampleAlpha;
+      if ((params.flags & EARLY_TERMINATION) != 0u && alpha > 0.99) {
+        break;
+      }
+      t += dt;
+    }
+
+    if ((params.flags & SHOW_SAMPLES) != 0u) {
+      atomicAdd(&stats[0], samples);
+      atomicAdd(&stats[1], 1u);
+      return vec4<f32>(heatMap(f32(samples) / f32(params.stepCount)), 1.0);
+    }
+    return vec4<f32>(color, 1.0);
+  }
+);
+// clang-format on
+
+// Fills the rows [begin, end) of the CPU voxel data, rows are ordered by y
+// within each z slice
+static void generate_noise_rows(void* arg, uint32_t begin, uint32_t end)
 {
-  memset(noise_texture.data, 0, (uint64_t)NOISE_TEXTURE_SIZE);
+  UNUSED_VAR(arg);
+
+  fractal_noise_t* fractal_noise = &noise_texture.data_generation.fractal_noise;
+  const float noise_scale        = noise_texture.data_generation.noise_scale;
+  const uint32_t width           = noise_texture.width;
+
+  for (uint32_t row = begin; row < end; ++row) {
+    const uint32_t y = row % noise_texture.height;
+    const uint32_t z = row / noise_texture.height;
+    const float ny   = (float)y / (float)noise_texture.height;
+    const float nz   = (float)z / (float)noise_texture.depth;
+    uint8_t* voxels  = &noise_texture.data[row * width];
+
+    uint32_t x = 0;
+#if NOISE_SIMD_WIDTH == 4
+    const __m128 scale = _mm_set1_ps(noise_scale);
+    const __m128 sy    = _mm_set1_ps(ny * noise_scale);
+    const __m128 sz    = _mm_set1_ps(nz * noise_scale);
+    for (; x + 4 <= width; x += 4) {
+      const __m128 nx = _mm_div_ps(
+        _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)),
+        _mm_set1_ps((float)width));
+      __m128 n = fractal_noise_generate4(fractal_noise,
+                                         _mm_mul_ps(nx, scale), sy, sz);
+      n        = _mm_sub_ps(n, simd_floor(n));
+      int32_t values[4];
+      _mm_storeu_si128(
+        (__m128i*)values,
+        _mm_cvttps_epi32(simd_floor(_mm_mul_ps(n, _mm_set1_ps(255.0f)))));
+      for (uint32_t l = 0; l < 4; ++l) {
+        voxels[x + l] = (uint8_t)values[l];
+      }
+    }
+#endif
+    for (; x < width; ++x) {
+      float n   = fractal_noise_generate(
+        fractal_noise, (float)x / (float)width * noise_scale, ny * noise_scale,
+        nz * noise_scale);
+      n         = n - floor(n);
+      voxels[x] = (uint8_t)(floor(n * 255));
+    }
+  }
+}
 
+// Generate randomized noise, on the CPU uploaded to the 3D texture directly
+// and on the GPU recorded into the next frame
+static void update_noise_texture(wgpu_context_t* wgpu_context)
+{
   perlin_noise_init(&noise_texture.data_generation.perlin_noise);
   fractal_noise_init(&noise_texture.data_generation.fractal_noise,
                      &noise_texture.data_generation.perlin_noise);
 
-  const float noiseScale = (float)(rand() % 10) + 4.0f;
-
-#pragma omp parallel for
-  for (int32_t z = 0; z < (int32_t)noise_texture.depth; z++) {
-    for (int32_t y = 0; y < (int32_t)noise_texture.height; y++) {
-      for (int32_t x = 0; x < (int32_t)noise_texture.width; x++) {
-        float nx = (float)x / (float)noise_texture.width;
-        float ny = (float)y / (float)noise_texture.height;
-        float nz = (float)z / (float)noise_texture.depth;
-#define FRACTAL
-#ifdef FRACTAL
-        float n = fractal_noise_generate(
-          &noise_texture.data_generation.fractal_noise, nx * noiseScale,
-          ny * noiseScale, nz * noiseScale);
-#else
-        float n = 20.0 * perlinNoise.noise(nx, ny, nz);
-#endif
-        n = n - floor(n);
-
-        noise_texture.data[x + y * noise_texture.width
-                           + z * noise_texture.width * noise_texture.height]
-          = (uint8_t)(floor(n * 255));
-      }
-    }
+  noise_texture.data_generation.noise_scale = (float)(rand() % 10) + 4.0f;
+  occupancy_grid.pending                    = true;
+
+  if (settings.generator == 0) {
+    const fractal_noise_t* fractal_noise
+      = &noise_texture.data_generation.fractal_noise;
+    noise_generator.params.noise_scale
+      = noise_texture.data_generation.noise_scale;
+    noise_generator.params.persistence = fractal_noise->persistence;
+    noise_generator.params.octaves     = fractal_noise->octaves;
+    wgpu_queue_write_buffer(wgpu_context, noise_generator.params_buffer.buffer,
+                            0, &noise_generator.params,
+                            sizeof(noise_generator.params));
+    wgpu_queue_write_buffer(
+      wgpu_context, noise_generator.permutations_buffer.buffer, 0,
+      noise_texture.data_generation.perlin_noise.permutations,
+      sizeof(noise_texture.data_generation.perlin_noise.permutations));
+    noise_generator.pending = true;
+    return;
   }
 
+  const float start = platform_get_time();
+  thread_pool_parallel_for(thread_pool,
+                           noise_texture.height * noise_texture.depth,
+                           noise_texture.width, generate_noise_rows, NULL);
+  settings.cpu_time_ms = (platform_get_time() - start) * 1000.0f;
+
   // Copy 3D noise data to texture
   wgpu_image_to_texure(wgpu_context, noise_texture.texture, noise_texture.data,
                        (WGPUExtent3D){
@@ -290,6 +823,189 @@ static void update_noise_texture(wgpu_context_t* wgpu_context)
                        1u);
 }
 
+// Records the compute shader generation and the copy into the 3D texture
+static void record_noise_generation(wgpu_context_t* wgpu_context)
+{
+  WGPUCommandEncoder cmd_enc = wgpu_context->cmd_enc;
+
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc,
+                            "Noise generation");
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, noise_generator.pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, noise_generator.bind_group,
+                                     0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc, (noise_texture.width / 4 + 7) / 8,
+    (noise_texture.height + 7) / 8, noise_texture.depth);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+
+  wgpuCommandEncoderCopyBufferToTexture(cmd_enc,
+    // Source
+    &(WGPUImageCopyBuffer) {
+      .buffer = noise_generator.voxel_buffer.buffer,
+      .layout = (WGPUTextureDataLayout) {
+        .offset       = 0,
+        .bytesPerRow  = noise_generator.bytes_per_row,
+        .rowsPerImage = noise_texture.height,
+      },
+    },
+    // Destination
+    &(WGPUImageCopyTexture){
+      .texture  = noise_texture.texture,
+      .mipLevel = 0,
+      .origin   = (WGPUOrigin3D) {
+        .x = 0,
+        .y = 0,
+        .z = 0,
+      },
+      .aspect = WGPUTextureAspect_All,
+    },
+    // Copy size
+    &(WGPUExtent3D){
+      .width              = noise_texture.width,
+      .height             = noise_texture.height,
+      .depthOrArrayLayers = noise_texture.depth,
+    });
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+
+  noise_generator.pending = false;
+}
+
+// Prepare the compute pipeline generating the noise, the bind group is created
+// with the noise texture
+static void prepare_noise_generator(wgpu_context_t* wgpu_context)
+{
+  noise_generator.params_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(noise_generator.params),
+                  });
+  noise_generator.permutations_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = sizeof(perlin_noise_t),
+                  });
+
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Uniform buffer (Compute shader)
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = noise_generator.params_buffer.size,
+      },
+      .sampler = {0},
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Permutation table (Compute shader)
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = noise_generator.permutations_buffer.size,
+      },
+      .sampler = {0},
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Packed voxels (Compute shader)
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = 0,
+      },
+      .sampler = {0},
+    },
+  };
+  noise_generator.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(noise_generator.bind_group_layout != NULL)
+
+  noise_generator.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &noise_generator.bind_group_layout,
+    });
+  ASSERT(noise_generator.pipeline_layout != NULL)
+
+  wgpu_shader_t noise_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "noise_generation_compute_shader",
+                    .wgsl_code.source = noise_generation_shader_wgsl,
+                    .entry            = "main",
+                  });
+  noise_generator.pipeline = wgpuDeviceCreateComputePipeline(
+    wgpu_context->device,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "noise_generation_compute_pipeline",
+      .layout  = noise_generator.pipeline_layout,
+      .compute = noise_comp_shader.programmable_stage_descriptor,
+    });
+  ASSERT(noise_generator.pipeline != NULL)
+  wgpu_shader_release(&noise_comp_shader);
+
+  // Occupancy grid, the layout is derived from the shader
+  wgpu_shader_t occupancy_comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "occupancy_grid_compute_shader",
+                    .wgsl_code.source = occupancy_grid_shader_wgsl,
+                    .entry            = "main",
+                  });
+  occupancy_grid.pipeline = wgpu_create_compute_pipeline(
+    wgpu_context,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "occupancy_grid_compute_pipeline",
+      .compute = occupancy_comp_shader.programmable_stage_descriptor,
+    });
+  ASSERT(occupancy_grid.pipeline != NULL)
+  wgpu_shader_release(&occupancy_comp_shader);
+}
+
+// Records the min/max reduction of the noise texture into the occupancy grid
+static void record_occupancy_grid_build(wgpu_context_t* wgpu_context)
+{
+  WGPUCommandEncoder cmd_enc = wgpu_context->cmd_enc;
+
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc,
+                            "Occupancy grid");
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, occupancy_grid.pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, occupancy_grid.bind_group,
+                                     0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc, (occupancy_grid.cell_counts[0] + 3) / 4,
+    (occupancy_grid.cell_counts[1] + 3) / 4,
+    (occupancy_grid.cell_counts[2] + 3) / 4);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+
+  occupancy_grid.pending = false;
+}
+
+static void release_noise_texture(void)
+{
+  WGPU_RELEASE_RESOURCE(Texture, noise_texture.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, noise_texture.view)
+  WGPU_RELEASE_RESOURCE(Sampler, noise_texture.sampler)
+  WGPU_RELEASE_RESOURCE(Buffer, noise_generator.voxel_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, noise_generator.bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, occupancy_grid.buffer.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, occupancy_grid.bind_group)
+  free(noise_texture.data);
+  noise_texture.data = NULL;
+}
+
 // Prepare all Vulkan resources for the 3D texture
 // Does not fill the texture with data
 static void prepare_noise_texture(wgpu_context_t* wgpu_context, uint32_t width,
@@ -301,6 +1017,7 @@ static void prepare_noise_texture(wgpu_context_t* wgpu_context, uint32_t width,
   noise_texture.depth      = depth;
   noise_texture.mip_levels = 1;
   noise_texture.format     = WGPUTextureFormat_R8Unorm;
+  noise_texture.data       = (uint8_t*)malloc((size_t)width * height * depth);
 
   WGPUExtent3D texture_extent = {
     .width              = noise_texture.width,
@@ -342,6 +1059,90 @@ static void prepare_noise_texture(wgpu_context_t* wgpu_context, uint32_t width,
     = wgpuTextureCreateView(noise_texture.texture, &texture_view_dec);
   ASSERT(noise_texture.view != NULL);
 
+  // Voxel buffer of the compute shader, copied into the texture
+  noise_generator.bytes_per_row        = (width + 255) & ~255u;
+  noise_generator.params.size[0]       = width;
+  noise_generator.params.size[1]       = height;
+  noise_generator.params.size[2]       = depth;
+  noise_generator.params.words_per_row = noise_generator.bytes_per_row / 4;
+  noise_generator.voxel_buffer         = wgpu_create_buffer(
+    wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_Storage,
+      .size  = (uint64_t)noise_generator.bytes_per_row * height * depth,
+    });
+
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0 : Compute shader uniform buffer
+      .binding = 0,
+      .buffer  = noise_generator.params_buffer.buffer,
+      .offset  = 0,
+      .size    = noise_generator.params_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1 : Compute shader permutation table
+      .binding = 1,
+      .buffer  = noise_generator.permutations_buffer.buffer,
+      .offset  = 0,
+      .size    = noise_generator.permutations_buffer.size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2 : Compute shader packed voxels
+      .binding = 2,
+      .buffer  = noise_generator.voxel_buffer.buffer,
+      .offset  = 0,
+      .size    = noise_generator.voxel_buffer.size,
+    },
+  };
+  noise_generator.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout     = noise_generator.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(noise_generator.bind_group != NULL);
+
+  // Occupancy grid of the texture
+  uint32_t cell_count = 1;
+  const uint32_t extent[3] = {width, height, depth};
+  for (uint32_t i = 0; i < 3; ++i) {
+    occupancy_grid.cell_counts[i]
+      = (extent[i] + OCCUPANCY_CELL_SIZE - 1) / OCCUPANCY_CELL_SIZE;
+    cell_count *= occupancy_grid.cell_counts[i];
+  }
+  occupancy_grid.buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "occupancy_grid_buffer",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = cell_count * sizeof(uint32_t),
+                  });
+  WGPUBindGroupLayout occupancy_bind_group_layout
+    = wgpuComputePipelineGetBindGroupLayout(occupancy_grid.pipeline, 0);
+  WGPUBindGroupEntry occupancy_bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0 : Noise texture
+      .binding     = 0,
+      .textureView = noise_texture.view,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1 : Min/max cells
+      .binding = 1,
+      .buffer  = occupancy_grid.buffer.buffer,
+      .offset  = 0,
+      .size    = occupancy_grid.buffer.size,
+    },
+  };
+  occupancy_grid.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = occupancy_bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(occupancy_bg_entries),
+      .entries    = occupancy_bg_entries,
+    });
+  ASSERT(occupancy_grid.bind_group != NULL);
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, occupancy_bind_group_layout)
+
   update_noise_texture(wgpu_context);
 }
 
@@ -628,18 +1429,240 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
 }
 
+static void update_volume_uniform_buffer(wgpu_example_context_t* context)
+{
+  camera_t* camera = context->camera;
+  mat4 view_projection, inverse_view;
+  glm_mat4_mul(camera->matrices.perspective, camera->matrices.view,
+               view_projection);
+  glm_mat4_inv(view_projection, volume.ubo.inverse_view_projection);
+  glm_mat4_inv(camera->matrices.view, inverse_view);
+  glm_vec4_copy(inverse_view[3], volume.ubo.camera_position);
+
+  memcpy(volume.ubo.cell_counts, occupancy_grid.cell_counts,
+         sizeof(volume.ubo.cell_counts));
+  volume.ubo.step_count = (uint32_t)settings.step_count;
+  volume.ubo.threshold  = settings.threshold;
+  volume.ubo.density    = settings.density;
+  volume.ubo.flags
+    = (settings.empty_space_skipping ? VOLUME_FLAG_EMPTY_SPACE_SKIPPING : 0u)
+      | (settings.early_termination ? VOLUME_FLAG_EARLY_TERMINATION : 0u)
+      | (settings.show_samples ? VOLUME_FLAG_SHOW_SAMPLES : 0u);
+
+  wgpu_queue_write_buffer(context->wgpu_context, volume.uniform_buffer.buffer,
+                          0, &volume.ubo, sizeof(volume.ubo));
+}
+
+static void setup_volume_bind_group(wgpu_context_t* wgpu_context)
+{
+  WGPUBindGroupEntry bg_entries[5] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0 : Fragment shader uniform buffer
+      .binding = 0,
+      .buffer  = volume.uniform_buffer.buffer,
+      .offset  = 0,
+      .size    = volume.uniform_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1 : Noise texture
+      .binding     = 1,
+      .textureView = noise_texture.view,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2 : Trilinear sampler
+      .binding = 2,
+      .sampler = volume.sampler,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      // Binding 3 : Occupancy grid
+      .binding = 3,
+      .buffer  = occupancy_grid.buffer.buffer,
+      .offset  = 0,
+      .size    = occupancy_grid.buffer.size,
+    },
+    [4] = (WGPUBindGroupEntry) {
+      // Binding 4 : Sample counters
+      .binding = 4,
+      .buffer  = volume.stats_buffer.buffer,
+      .offset  = 0,
+      .size    = volume.stats_buffer.size,
+    },
+  };
+  volume.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout     = volume.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(volume.bind_group != NULL);
+}
+
+// Create the raymarching pipeline of the volume mode
+static void prepare_volume_pipeline(wgpu_context_t* wgpu_context)
+{
+  volume.uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(volume.ubo),
+                  });
+  volume.stats_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_CopySrc
+                             | WGPUBufferUsage_Storage,
+                    .size  = 2 * sizeof(uint32_t),
+                  });
+  volume.sampler = wgpuDeviceCreateSampler(
+    wgpu_context->device, &(WGPUSamplerDescriptor){
+                            .addressModeU  = WGPUAddressMode_ClampToEdge,
+                            .addressModeV  = WGPUAddressMode_ClampToEdge,
+                            .addressModeW  = WGPUAddressMode_ClampToEdge,
+                            .minFilter     = WGPUFilterMode_Linear,
+                            .magFilter     = WGPUFilterMode_Linear,
+                            .maxAnisotropy = 1,
+                          });
+  ASSERT(volume.sampler != NULL);
+
+  WGPUBindGroupLayoutEntry bgl_entries[5] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Uniform buffer (Fragment shader)
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = volume.uniform_buffer.size,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Noise texture (Fragment shader)
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_3D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Trilinear sampler (Fragment shader)
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout){
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      // Binding 3: Occupancy grid (Fragment shader)
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = 0,
+      },
+    },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      // Binding 4: Sample counters (Fragment shader)
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = volume.stats_buffer.size,
+      },
+    },
+  };
+  volume.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(volume.bind_group_layout != NULL)
+
+  volume.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts     = &volume.bind_group_layout,
+                          });
+  ASSERT(volume.pipeline_layout != NULL);
+
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  WGPUBlendState blend_state              = wgpu_create_blend_state(false);
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = false,
+    });
+
+  // Fullscreen triangle, the rays are generated in the fragment shader
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                wgpu_context, &(wgpu_vertex_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Vertex shader WGSL
+                  .label            = "texture_3d_volume_vertex_shader",
+                  .wgsl_code.source = volume_shader_wgsl,
+                  .entry            = "vs_main",
+                },
+                .buffer_count = 0,
+                .buffers      = NULL,
+              });
+
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                wgpu_context, &(wgpu_fragment_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Fragment shader WGSL
+                  .label            = "texture_3d_volume_fragment_shader",
+                  .wgsl_code.source = volume_shader_wgsl,
+                  .entry            = "fs_main",
+                },
+                .target_count = 1,
+                .targets      = &color_target_state,
+              });
+
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  volume.pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label        = "texture_3d_volume_render_pipeline",
+                            .layout       = volume.pipeline_layout,
+                            .primitive    = primitive_state,
+                            .vertex       = vertex_state,
+                            .fragment     = &fragment_state,
+                            .depthStencil = &depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+  ASSERT(volume.pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     setup_camera(context);
     generate_quad(context->wgpu_context);
     prepare_uniform_buffers(context);
-    prepare_noise_texture(context->wgpu_context, (uint32_t)NOISE_TEXTURE_WIDTH,
-                          (uint32_t)NOISE_TEXTURE_HEIGHT,
-                          (uint32_t)NOISE_TEXTURE_DEPTH);
+    thread_pool = thread_pool_create(0);
+    prepare_noise_generator(context->wgpu_context);
+    const uint32_t size = noise_texture_sizes[settings.size_index];
+    prepare_noise_texture(context->wgpu_context, size, size, size);
     setup_pipeline_layout(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_bind_group(context->wgpu_context);
+    prepare_volume_pipeline(context->wgpu_context);
+    setup_volume_bind_group(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -648,15 +1671,91 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+// Recreates the 3D texture with the selected size and fills it with new noise
+static void resize_noise_texture(wgpu_context_t* wgpu_context)
+{
+  const uint32_t size = noise_texture_sizes[settings.size_index];
+  release_noise_texture();
+  prepare_noise_texture(wgpu_context, size, size, size);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  setup_bind_group(wgpu_context);
+  WGPU_RELEASE_RESOURCE(BindGroup, volume.bind_group)
+  setup_volume_bind_group(wgpu_context);
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
+  // GPU time of the last frame which generated noise
+  wgpu_profiler_t* profiler = context->wgpu_context->profiler;
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  for (uint32_t i = 0; i < wgpu_profiler_get_scope_count(profiler); ++i) {
+    if (strcmp(scopes[i].name, "Noise generation") == 0) {
+      settings.gpu_time_ms = scopes[i].gpu_time_ms;
+    }
+  }
+
   if (imgui_overlay_header("Settings")) {
+    static const char* generators[2] = {"Compute shader", "CPU (SIMD)"};
+    imgui_overlay_combo_box(context->imgui_overlay, "Generator",
+                            &settings.generator, generators, 2);
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Size",
+                                &settings.size_index, noise_texture_size_names,
+                                (uint32_t)ARRAY_SIZE(noise_texture_sizes))) {
+      resize_noise_texture(context->wgpu_context);
+    }
     if (imgui_overlay_button(context->imgui_overlay, "Generate new texture")) {
       update_noise_texture(context->wgpu_context);
     }
+    if (settings.generator == 0) {
+      imgui_overlay_text("GPU generation: %.2f ms", settings.gpu_time_ms);
+    }
+    else {
+      imgui_overlay_text("CPU generation: %.2f ms (%u threads)",
+                         settings.cpu_time_ms,
+                         thread_pool_get_thread_count(thread_pool) + 1);
+    }
+  }
+
+  if (imgui_overlay_header("Rendering")) {
+    static const char* render_modes[2] = {"Slice", "Volume"};
+    imgui_overlay_combo_box(context->imgui_overlay, "Mode",
+                            &settings.render_mode, render_modes, 2);
+    if (settings.render_mode == 1) {
+      imgui_overlay_slider_int(context->imgui_overlay, "Step count",
+                               &settings.step_count, 16, 1024);
+      imgui_overlay_slider_float(context->imgui_overlay, "Threshold",
+                                 &settings.threshold, 0.0f, 0.95f);
+      imgui_overlay_slider_float(context->imgui_overlay, "Density",
+                                 &settings.density, 1.0f, 100.0f);
+      imgui_overlay_checkBox(context->imgui_overlay, "Empty space skipping",
+                             &settings.empty_space_skipping);
+      imgui_overlay_checkBox(context->imgui_overlay, "Early ray termination",
+                             &settings.early_termination);
+      imgui_overlay_checkBox(context->imgui_overlay, "Show samples per pixel",
+                             &settings.show_samples);
+      if (settings.show_samples) {
+        imgui_overlay_text("Samples per pixel: %.1f of %d",
+                           volume.samples_per_pixel, settings.step_count);
+      }
+    }
   }
 }
 
+static void volume_stats_readback_callback(const void* data, uint64_t size,
+                                           void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  // Samples and rays which hit the volume
+  if (data != NULL && size >= 2 * sizeof(uint32_t)) {
+    const uint32_t* counters = (const uint32_t*)data;
+    volume.samples_per_pixel
+      = counters[1] > 0 ? (float)counters[0] / (float)counters[1] : 0.0f;
+  }
+  volume.readback_pending = false;
+}
+
 // Build separate command buffer for the framebuffer image
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
@@ -667,17 +1766,23 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Generate the noise requested with the compute shader
+  if (noise_generator.pending) {
+    record_noise_generation(wgpu_context);
+  }
+  if (occupancy_grid.pending) {
+    record_occupancy_grid_build(wgpu_context);
+  }
+  if (settings.render_mode == 1 && settings.show_samples) {
+    wgpuCommandEncoderClearBuffer(wgpu_context->cmd_enc,
+                                  volume.stats_buffer.buffer, 0,
+                                  volume.stats_buffer.size);
+  }
+
   // Create render pass encoder for encoding drawing commands
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass_desc);
 
-  // Bind the rendering pipeline
-  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.solid);
-
-  // Set the bind group
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
-                                    0);
-
   // Set viewport
   wgpuRenderPassEncoderSetViewport(
     wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
@@ -688,18 +1793,34 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
-  // Bind triangle vertex buffer (contains position and colors)
-  wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                       vertices.buffer, 0, WGPU_WHOLE_SIZE);
-
-  // Bind triangle index buffer
-  wgpuRenderPassEncoderSetIndexBuffer(wgpu_context->rpass_enc, indices.buffer,
-                                      WGPUIndexFormat_Uint16, 0,
-                                      WGPU_WHOLE_SIZE);
-
-  // Draw indexed triangle
-  wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc, indices.count, 1, 0,
-                                   0, 0);
+  if (settings.render_mode == 1) {
+    // Raymarch the volume
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, volume.pipeline);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      volume.bind_group, 0, 0);
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  }
+  else {
+    // Bind the rendering pipeline
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.solid);
+
+    // Set the bind group
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group,
+                                      0, 0);
+
+    // Bind triangle vertex buffer (contains position and colors)
+    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
+                                         vertices.buffer, 0, WGPU_WHOLE_SIZE);
+
+    // Bind triangle index buffer
+    wgpuRenderPassEncoderSetIndexBuffer(wgpu_context->rpass_enc,
+                                        indices.buffer, WGPUIndexFormat_Uint16,
+                                        0, WGPU_WHOLE_SIZE);
+
+    // Draw indexed triangle
+    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc, indices.count, 1,
+                                     0, 0, 0);
+  }
 
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
@@ -721,6 +1842,10 @@ static int example_draw(wgpu_example_context_t* context)
   // Prepare frame
   prepare_frame(context);
 
+  if (settings.render_mode == 1) {
+    update_volume_uniform_buffer(context);
+  }
+
   // Command buffer to be submitted to the queue
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
@@ -730,6 +1855,14 @@ static int example_draw(wgpu_example_context_t* context)
   // Submit to queue
   submit_command_buffers(context);
 
+  // Read back the sample counters of the frame, one readback at a time
+  if (settings.render_mode == 1 && settings.show_samples
+      && !volume.readback_pending) {
+    volume.readback_pending = wgpu_buffer_read_async(
+      wgpu_context, volume.stats_buffer.buffer, 0, volume.stats_buffer.size,
+      volume_stats_readback_callback, NULL);
+  }
+
   // Submit frame
   submit_frame(context);
 
@@ -751,9 +1884,22 @@ static int example_render(wgpu_example_context_t* context)
 static void example_destroy(wgpu_example_context_t* context)
 {
   camera_release(context->camera);
-  WGPU_RELEASE_RESOURCE(Texture, noise_texture.texture)
-  WGPU_RELEASE_RESOURCE(TextureView, noise_texture.view)
-  WGPU_RELEASE_RESOURCE(Sampler, noise_texture.sampler)
+  release_noise_texture();
+  WGPU_RELEASE_RESOURCE(Buffer, noise_generator.params_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, noise_generator.permutations_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, noise_generator.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, noise_generator.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, noise_generator.pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, occupancy_grid.pipeline)
+  WGPU_RELEASE_RESOURCE(Buffer, volume.uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, volume.stats_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Sampler, volume.sampler)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, volume.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, volume.bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, volume.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, volume.pipeline)
+  thread_pool_release(thread_pool);
+  thread_pool = NULL;
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
@@ -5,6 +5,7 @@
 
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/mipmap_tuner.h"
 #include "../webgpu/texture.h"
 
 #ifdef __GNUC__
@@ -22,6 +23,11 @@
  *
  * This example shows how to load and sample textures (including mip maps).
  *
+ * The mip chain of the texture is generated with the fastest method of the
+ * adapter (see mipmap_tuner.h). The benchmark of the overlay compares the
+ * render pass per level, the compute and the CPU methods across texture sizes
+ * and formats, one measurement per frame, timed with timestamp queries.
+ *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/texturemipmapgen/texturemipmapgen.cpp
  * -------------------------------------------------------------------------- */
@@ -67,6 +73,33 @@ static WGPUPipelineLayout pipeline_layout;
 static WGPUBindGroup bind_group;
 static WGPUBindGroupLayout bind_group_layout;
 
+// Mip map generation benchmark
+static const uint32_t benchmark_sizes[3] = {256, 1024, 4096};
+static const WGPUTextureFormat benchmark_formats[3] = {
+  WGPUTextureFormat_RGBA8Unorm,
+  WGPUTextureFormat_RGBA8UnormSrgb,
+  WGPUTextureFormat_RGBA16Float,
+};
+static const char* benchmark_format_names[3]
+  = {"rgba8unorm", "rgba8unorm-srgb", "rgba16float"};
+#define BENCHMARK_CASE_COUNT                                                   \
+  (ARRAY_SIZE(benchmark_formats) * ARRAY_SIZE(benchmark_sizes)                 \
+   * (WGPU_MipmapMethod_Count - 1))
+
+static struct {
+  wgpu_mipmap_generator_t* mipmap_generator;
+  // Method the texture of the scene was generated with
+  wgpu_mipmap_method_enum_t texture_method;
+  // Per format, size and method, the Auto entries are unused
+  wgpu_mipmap_timing_t timings[3][3][WGPU_MipmapMethod_Count];
+  bool measured[3][3][WGPU_MipmapMethod_Count];
+  // Next measurement, BENCHMARK_CASE_COUNT when not running
+  uint32_t next_case;
+  int32_t format_index;
+} benchmark = {
+  .next_case = BENCHMARK_CASE_COUNT,
+};
+
 // Other variables
 static const char* example_title = "Runtime Mip Map Generation";
 static bool prepared             = false;
@@ -90,11 +123,15 @@ static void load_texture(wgpu_context_t* wgpu_context, const char* filename,
   ktxResult result = KTX_NOT_FOUND;
   ktxTexture* ktx_texture;
 
-  if (!file_exists(filename)) {
+  // The image data is copied on creation, the mapping can be released
+  file_mapping_t file_mapping = {0};
+  if (file_map(filename, &file_mapping) != 0) {
     log_fatal("Could not load texture from %s", filename);
   }
-  result = ktxTexture_CreateFromNamedFile(
-    filename, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx_texture);
+  result = ktxTexture_CreateFromMemory(file_mapping.data, file_mapping.size,
+                                       KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                       &ktx_texture);
+  file_unmap(&file_mapping);
 
   ASSERT(result == KTX_SUCCESS);
 
@@ -108,22 +145,6 @@ static void load_texture(wgpu_context_t* wgpu_context, const char* filename,
   // Calculated as log2(max(width, height, depth))c + 1 (see specs)
   texture.mip_levels = floor(log2(MAX(texture.width, texture.height))) + 1;
 
-  // Create a host-visible staging buffer that contains the raw image data
-  WGPUBufferDescriptor staging_buffer_desc = {
-    .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
-    .size             = ktx_texture_size,
-    .mappedAtCreation = true,
-  };
-  WGPUBuffer staging_buffer
-    = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
-  ASSERT(staging_buffer);
-
-  // Copy texture data into staging buffer
-  void* mapping = wgpuBufferGetMappedRange(staging_buffer, 0, ktx_texture_size);
-  ASSERT(mapping)
-  memcpy(mapping, ktx_texture_data, ktx_texture_size);
-  wgpuBufferUnmap(staging_buffer);
-
   // Create texture
   WGPUTextureDescriptor texture_desc = {
     .size          = (WGPUExtent3D) {
@@ -138,42 +159,84 @@ static void load_texture(wgpu_context_t* wgpu_context, const char* filename,
     .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding
                      | WGPUTextureUsage_RenderAttachment,
   };
+
+  // Generate the mip chain with the fastest method of the adapter
+  benchmark.mipmap_generator = wgpu_mipmap_generator_create(wgpu_context);
+  wgpu_mipmap_method_enum_t method = wgpu_tune_mipmap_method(
+    wgpu_context, benchmark.mipmap_generator, format);
+  if (!wgpu_mipmap_method_supports(method, &texture_desc)) {
+    method = WGPU_MipmapMethod_Auto;
+  }
+  if (method != WGPU_MipmapMethod_Render && method != WGPU_MipmapMethod_CPU
+      && wgpu_mipmap_generator_supports_compute(format)) {
+    texture_desc.usage |= WGPUTextureUsage_StorageBinding;
+  }
+  benchmark.texture_method = method;
   texture.texture
     = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
   ASSERT(texture.texture != NULL);
 
-  // Copy the first mip of the chain, remaining mips will be generated
-  // Upload staging buffer to texture
   WGPUCommandEncoder cmd_encoder
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-
-  wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
-    // Source
-    &(WGPUImageCopyBuffer) {
-      .buffer = staging_buffer,
-      .layout = (WGPUTextureDataLayout) {
-        .offset       = 0,
-        .bytesPerRow  = texture.width * 4,
-        .rowsPerImage = texture.height,
+  WGPUBuffer staging_buffer = NULL;
+  if (method == WGPU_MipmapMethod_CPU) {
+    // All levels are generated on the CPU and uploaded
+    wgpu_mipmap_generator_encode_cpu_mipmap(wgpu_context, cmd_encoder,
+                                            texture.texture, &texture_desc,
+                                            ktx_texture_data);
+  }
+  else {
+    // Create a host-visible staging buffer that contains the raw image data
+    WGPUBufferDescriptor staging_buffer_desc = {
+      .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
+      .size             = ktx_texture_size,
+      .mappedAtCreation = true,
+    };
+    staging_buffer
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
+    ASSERT(staging_buffer);
+
+    // Copy texture data into staging buffer
+    void* mapping
+      = wgpuBufferGetMappedRange(staging_buffer, 0, ktx_texture_size);
+    ASSERT(mapping)
+    memcpy(mapping, ktx_texture_data, ktx_texture_size);
+    wgpuBufferUnmap(staging_buffer);
+
+    // Copy the first mip of the chain, remaining mips will be generated
+    wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
+      // Source
+      &(WGPUImageCopyBuffer) {
+        .buffer = staging_buffer,
+        .layout = (WGPUTextureDataLayout) {
+          .offset       = 0,
+          .bytesPerRow  = texture.width * 4,
+          .rowsPerImage = texture.height,
+        },
       },
-    },
-    // Destination
-    &(WGPUImageCopyTexture){
-      .texture = texture.texture,
-      .mipLevel = 0,
-      .origin = (WGPUOrigin3D) {
-        .x = 0,
-        .y = 0,
-        .z = 0,
+      // Destination
+      &(WGPUImageCopyTexture){
+        .texture = texture.texture,
+        .mipLevel = 0,
+        .origin = (WGPUOrigin3D) {
+          .x = 0,
+          .y = 0,
+          .z = 0,
+        },
+        .aspect = WGPUTextureAspect_All,
       },
-      .aspect = WGPUTextureAspect_All,
-    },
-    // Copy size
-    &(WGPUExtent3D){
-      .width               = texture.width,
-      .height              = texture.height,
-      .depthOrArrayLayers  = 1,
-    });
+      // Copy size
+      &(WGPUExtent3D){
+        .width               = texture.width,
+        .height              = texture.height,
+        .depthOrArrayLayers  = 1,
+      });
+
+    // Generate the mip chain
+    wgpu_mipmap_generator_encode_mipmap(benchmark.mipmap_generator,
+                                        cmd_encoder, texture.texture,
+                                        &texture_desc, method);
+  }
 
   WGPUCommandBuffer command_buffer
     = wgpuCommandEncoderFinish(cmd_encoder, NULL);
@@ -192,15 +255,6 @@ static void load_texture(wgpu_context_t* wgpu_context, const char* filename,
   WGPU_RELEASE_RESOURCE(Buffer, staging_buffer)
   ktxTexture_Destroy(ktx_texture);
 
-  // Generate the mip chain
-  // ---------------------------------------------------------------------------
-  wgpu_mipmap_generator_t* mipmap_generator
-    = wgpu_mipmap_generator_create(wgpu_context);
-  texture.texture = wgpu_mipmap_generator_generate_mipmap(
-    mipmap_generator, texture.texture, &texture_desc);
-  wgpu_mipmap_generator_destroy(mipmap_generator);
-  // ---------------------------------------------------------------------------
-
   // Create samplers
   WGPUSamplerDescriptor sampler_desc = {
     .addressModeU  = WGPUAddressMode_MirrorRepeat,
@@ -528,6 +582,63 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+// Runs the next measurement of the benchmark, one per frame
+static void update_benchmark(wgpu_context_t* wgpu_context)
+{
+  if (benchmark.next_case >= BENCHMARK_CASE_COUNT) {
+    return;
+  }
+
+  const uint32_t c = benchmark.next_case++;
+  const uint32_t method_count = WGPU_MipmapMethod_Count - 1;
+  const uint32_t method       = 1 + c % method_count;
+  const uint32_t size_index
+    = (c / method_count) % (uint32_t)ARRAY_SIZE(benchmark_sizes);
+  const uint32_t format_index
+    = c / (method_count * (uint32_t)ARRAY_SIZE(benchmark_sizes));
+  benchmark.measured[format_index][size_index][method]
+    = wgpu_mipmap_tuner_measure(
+      wgpu_context, benchmark.mipmap_generator,
+      benchmark_formats[format_index], benchmark_sizes[size_index],
+      (wgpu_mipmap_method_enum_t)method,
+      &benchmark.timings[format_index][size_index][method]);
+}
+
+static void draw_benchmark_results(uint32_t format_index)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(benchmark_sizes); ++i) {
+    // Total time of every method, the fastest is marked
+    double times_ms[WGPU_MipmapMethod_Count] = {0};
+    uint32_t fastest                         = WGPU_MipmapMethod_Auto;
+    for (uint32_t m = WGPU_MipmapMethod_Render; m < WGPU_MipmapMethod_Count;
+         ++m) {
+      const wgpu_mipmap_timing_t* timing = &benchmark.timings[format_index][i][m];
+      times_ms[m] = timing->cpu_time_ms + timing->gpu_time_ms;
+      if (benchmark.measured[format_index][i][m]
+          && (fastest == WGPU_MipmapMethod_Auto
+              || times_ms[m] < times_ms[fastest])) {
+        fastest = m;
+      }
+    }
+    char line[STRMAX];
+    int length
+      = snprintf(line, sizeof(line), "%ux%u:", benchmark_sizes[i],
+                 benchmark_sizes[i]);
+    for (uint32_t m = WGPU_MipmapMethod_Render;
+         m < WGPU_MipmapMethod_Count && length < (int)sizeof(line); ++m) {
+      const char* name
+        = wgpu_mipmap_method_get_name((wgpu_mipmap_method_enum_t)m);
+      length += benchmark.measured[format_index][i][m] ?
+                  snprintf(line + length, sizeof(line) - length,
+                           " %s%s %.2f ms", m == fastest ? "*" : "", name,
+                           times_ms[m]) :
+                  snprintf(line + length, sizeof(line) - length, " %s -",
+                           name);
+    }
+    imgui_overlay_text("%s", line);
+  }
+}
+
 static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
@@ -542,6 +653,28 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
       update_uniform_buffers(context);
     }
   }
+  if (imgui_overlay_header("Mip map generation")) {
+    imgui_overlay_text(
+      "Texture: %s",
+      wgpu_mipmap_method_get_name(benchmark.texture_method));
+    if (!wgpu_has_feature(context->wgpu_context,
+                          WGPUFeatureName_TimestampQuery)) {
+      imgui_overlay_text("Timestamp queries not supported");
+      return;
+    }
+    if (benchmark.next_case < BENCHMARK_CASE_COUNT) {
+      imgui_overlay_text("Measuring %u / %u", benchmark.next_case,
+                         (uint32_t)BENCHMARK_CASE_COUNT);
+    }
+    else if (imgui_overlay_button(context->imgui_overlay, "Run benchmark")) {
+      memset(benchmark.measured, 0, sizeof(benchmark.measured));
+      benchmark.next_case = 0;
+    }
+    imgui_overlay_combo_box(context->imgui_overlay, "Format",
+                            &benchmark.format_index, benchmark_format_names,
+                            (uint32_t)ARRAY_SIZE(benchmark_format_names));
+    draw_benchmark_results((uint32_t)benchmark.format_index);
+  }
 }
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
@@ -617,6 +750,7 @@ static int example_render(wgpu_example_context_t* context)
   if (!prepared) {
     return 1;
   }
+  update_benchmark(context->wgpu_context);
   const int draw_result = example_draw(context);
   if (!context->paused || context->camera->updated) {
     update_uniform_buffers(context);
@@ -629,6 +763,7 @@ static void example_destroy(wgpu_example_context_t* context)
   camera_release(context->camera);
   wgpu_gltf_model_destroy(model);
   destroy_texture();
+  wgpu_mipmap_generator_destroy(benchmark.mipmap_generator);
   for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(samplers); ++i) {
     WGPU_RELEASE_RESOURCE(Sampler, samplers[i])
   }
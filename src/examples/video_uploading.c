@@ -4,6 +4,8 @@
 #include <string.h>
 
 #include "../core/video_decode.h"
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/texture_compressor.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Video Texture
@@ -13,6 +15,12 @@
  * Note:
  * - Uses FFMPEG for decoding video frames
  * - Video loops by default
+ * - Frames are copied through the persistently mapped staging chunks of the
+ *   upload ring into two alternating textures, a new frame is never written
+ *   into the texture the previous frame is rendered from
+ * - With the TextureCompressionBC feature every new frame can be compressed
+ *   to BC1 or BC7 on the GPU and sampled from the compressed texture, the
+ *   overlay shows the sampled size and the PSNR of the compression
  *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/blob/main/src/pages/samples/videoUploading.ts
@@ -54,8 +62,33 @@ static wgpu_buffer_t vertices = {0};
 // Pipeline
 static WGPURenderPipeline pipeline = {0};
 
-// Bind groups stores the resources bound to the binding points in a shader
-static WGPUBindGroup uniform_bind_group = {0};
+// Bind groups stores the resources bound to the binding points in a shader,
+// one per video texture
+static WGPUBindGroup uniform_bind_groups[2] = {0};
+
+// Sampled texture of the frames, uncompressed or compressed
+typedef enum sampled_format_enum_t {
+  SampledFormat_RGBA8 = 0,
+  SampledFormat_BC1   = 1,
+  SampledFormat_BC7   = 2,
+  SampledFormat_Count = 3,
+} sampled_format_enum_t;
+
+static const wgpu_texture_compression_enum_t
+  sampled_format_compressions[SampledFormat_Count]
+  = {WGPU_TextureCompression_Count, WGPU_TextureCompression_BC1,
+     WGPU_TextureCompression_BC7};
+
+// Compressed copies of the video textures per compressed format
+static struct {
+  wgpu_texture_compressor_t* compressor;
+  WGPUTexture textures[SampledFormat_Count][2];
+  WGPUTextureView views[SampledFormat_Count][2];
+  WGPUBindGroup bind_groups[SampledFormat_Count][2];
+  // The latest frame is compressed before it is rendered
+  bool frame_pending;
+  int32_t sampled_format;
+} compressed_video = {0};
 
 // Render pass descriptor for frame buffer writes
 static struct {
@@ -63,11 +96,15 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } render_pass = {0};
 
-// Texture and sampler
+// Textures and sampler, frames are uploaded alternately into both textures
 static struct {
   WGPUSampler sampler;
-  WGPUTexture texture;
-  WGPUTextureView view;
+  WGPUTexture textures[2];
+  WGPUTextureView views[2];
+  // Convert the 4:2:0 frames of the decoder into the textures
+  wgpu_yuv_converter_t* yuv_converters[2];
+  // Texture holding the latest frame
+  uint32_t current;
 } video_texture = {0};
 
 static struct {
@@ -75,8 +112,22 @@ static struct {
     int32_t width;
     int32_t height;
   } frame_size;
+  // Size of a decoded frame in bytes
+  uint64_t frame_bytes;
 } video_info = {0};
 
+// Upload bandwidth, measured over intervals of one second
+static struct {
+  uint64_t bytes;
+  uint32_t frames;
+  float interval_start;
+  double mib_per_second;
+  double frames_per_second;
+} upload_stats = {0};
+
+// Decoder of the video file
+static video_decoder_t* video_decoder = NULL;
+
 static const char* video_file_location
   = "videos/video_uploading/big_buck_bunny_trailer.mp4";
 
@@ -107,10 +158,10 @@ static void prepare_vertex_buffer(wgpu_context_t* wgpu_context)
                   });
 }
 
-static void prepare_video_texture(wgpu_context_t* wgpu_context)
+static void prepare_video_texture(wgpu_context_t* wgpu_context, uint32_t i)
 {
   // Create the texture
-  video_texture.texture = wgpuDeviceCreateTexture(
+  video_texture.textures[i] = wgpuDeviceCreateTexture(
     wgpu_context->device,
     &(WGPUTextureDescriptor){
       .size          = (WGPUExtent3D){
@@ -122,20 +173,48 @@ static void prepare_video_texture(wgpu_context_t* wgpu_context)
       .sampleCount   = 1,
       .dimension     = WGPUTextureDimension_2D,
       .format        = WGPUTextureFormat_RGBA8Unorm,
-      .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+      .usage         = WGPUTextureUsage_CopyDst
+                       | WGPUTextureUsage_TextureBinding
+                       | WGPUTextureUsage_StorageBinding,
   });
 
   // Create the texture view
-  video_texture.view = wgpuTextureCreateView(
-    video_texture.texture, &(WGPUTextureViewDescriptor){
-                             .format          = WGPUTextureFormat_RGBA8Unorm,
-                             .dimension       = WGPUTextureViewDimension_2D,
-                             .baseMipLevel    = 0,
-                             .mipLevelCount   = 1,
-                             .baseArrayLayer  = 0,
-                             .arrayLayerCount = 1,
-                           });
-  ASSERT(video_texture.view != NULL);
+  video_texture.views[i] = wgpuTextureCreateView(
+    video_texture.textures[i],
+    &(WGPUTextureViewDescriptor){
+      .format          = WGPUTextureFormat_RGBA8Unorm,
+      .dimension       = WGPUTextureViewDimension_2D,
+      .baseMipLevel    = 0,
+      .mipLevelCount   = 1,
+      .baseArrayLayer  = 0,
+      .arrayLayerCount = 1,
+    });
+  ASSERT(video_texture.views[i] != NULL);
+
+  // Planar frames are converted on the GPU
+  video_frame_info_t frame_info = {0};
+  video_decoder_get_frame_info(video_decoder, &frame_info);
+  if (frame_info.format != VIDEO_FRAME_FORMAT_RGBA8) {
+    const wgpu_yuv_format_enum_t yuv_format
+      = frame_info.format == VIDEO_FRAME_FORMAT_NV12 ? WGPU_YUV_Format_NV12 :
+                                                       WGPU_YUV_Format_I420;
+    video_texture.yuv_converters[i] = wgpu_yuv_converter_create(
+      wgpu_context, &(wgpu_yuv_converter_desc_t){
+                      .format     = yuv_format,
+                      .width      = (uint32_t)frame_info.width,
+                      .height     = (uint32_t)frame_info.height,
+                      .bt709      = frame_info.bt709 != 0,
+                      .full_range = frame_info.full_range != 0,
+                      .texture    = video_texture.textures[i],
+                    });
+  }
+}
+
+static void prepare_video_textures(wgpu_context_t* wgpu_context)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(video_texture.textures); ++i) {
+    prepare_video_texture(wgpu_context, i);
+  }
 
   // Create the sampler
   video_texture.sampler = wgpuDeviceCreateSampler(
@@ -151,6 +230,42 @@ static void prepare_video_texture(wgpu_context_t* wgpu_context)
   ASSERT(video_texture.sampler != NULL);
 }
 
+// BC textures need sizes of multiples of 4
+static void prepare_compressed_video_textures(wgpu_context_t* wgpu_context)
+{
+  if (!wgpu_texture_compressor_is_supported(wgpu_context)
+      || video_info.frame_size.width % 4 != 0
+      || video_info.frame_size.height % 4 != 0) {
+    return;
+  }
+
+  compressed_video.compressor = wgpu_texture_compressor_create(wgpu_context);
+  for (uint32_t f = SampledFormat_BC1; f < SampledFormat_Count; ++f) {
+    const WGPUTextureFormat format = wgpu_texture_compression_get_format(
+      sampled_format_compressions[f], false);
+    for (uint32_t i = 0; i < 2; ++i) {
+      compressed_video.textures[f][i] = wgpuDeviceCreateTexture(
+        wgpu_context->device,
+        &(WGPUTextureDescriptor){
+          .size          = (WGPUExtent3D){
+            .width              = video_info.frame_size.width,
+            .height             = video_info.frame_size.height,
+            .depthOrArrayLayers = 1,
+          },
+          .mipLevelCount = 1,
+          .sampleCount   = 1,
+          .dimension     = WGPUTextureDimension_2D,
+          .format        = format,
+          .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+        });
+      ASSERT(compressed_video.textures[f][i] != NULL);
+      compressed_video.views[f][i]
+        = wgpuTextureCreateView(compressed_video.textures[f][i], NULL);
+      ASSERT(compressed_video.views[f][i] != NULL);
+    }
+  }
+}
+
 static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   UNUSED_VAR(wgpu_context);
@@ -175,27 +290,56 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   };
 }
 
-static void prepare_uniform_bind_group(wgpu_context_t* wgpu_context)
+static void prepare_uniform_bind_groups(wgpu_context_t* wgpu_context)
 {
-  // Uniform bind group
-  WGPUBindGroupEntry bg_entries[2] = {
-    [0] = (WGPUBindGroupEntry) {
-      .binding = 0,
-      .sampler = video_texture.sampler,
-    },
-    [1] = (WGPUBindGroupEntry) {
-      .binding     = 1,
-      .textureView = video_texture.view,
-    },
-  };
-  uniform_bind_group = wgpuDeviceCreateBindGroup(
-    wgpu_context->device,
-    &(WGPUBindGroupDescriptor){
-      .layout     = wgpuRenderPipelineGetBindGroupLayout(pipeline, 0),
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
-    });
-  ASSERT(uniform_bind_group != NULL)
+  // Uniform bind groups
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(uniform_bind_groups); ++i) {
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .sampler = video_texture.sampler,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = video_texture.views[i],
+      },
+    };
+    uniform_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = wgpuRenderPipelineGetBindGroupLayout(pipeline, 0),
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(uniform_bind_groups[i] != NULL)
+  }
+
+  // Compressed texture bind groups
+  if (compressed_video.compressor == NULL) {
+    return;
+  }
+  for (uint32_t f = SampledFormat_BC1; f < SampledFormat_Count; ++f) {
+    for (uint32_t i = 0; i < 2; ++i) {
+      WGPUBindGroupEntry bg_entries[2] = {
+        [0] = (WGPUBindGroupEntry) {
+          .binding = 0,
+          .sampler = video_texture.sampler,
+        },
+        [1] = (WGPUBindGroupEntry) {
+          .binding     = 1,
+          .textureView = compressed_video.views[f][i],
+        },
+      };
+      compressed_video.bind_groups[f][i] = wgpuDeviceCreateBindGroup(
+        wgpu_context->device,
+        &(WGPUBindGroupDescriptor){
+          .layout     = wgpuRenderPipelineGetBindGroupLayout(pipeline, 0),
+          .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+          .entries    = bg_entries,
+        });
+      ASSERT(compressed_video.bind_groups[f][i] != NULL)
+    }
+  }
 }
 
 static void prepare_pipelines(wgpu_context_t* wgpu_context)
@@ -272,35 +416,85 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
 
 static int prepare_video(const char* fname)
 {
-  init_video_decode();
-  open_video_file(fname);
+  video_decoder = video_decoder_open(&(video_decoder_desc_t){
+    .filename = fname,
+  });
+  if (video_decoder == NULL) {
+    return 1;
+  }
 
-  get_video_dimension(&video_info.frame_size.width,
-                      &video_info.frame_size.height);
+  video_frame_info_t frame_info = {0};
+  video_decoder_get_frame_info(video_decoder, &frame_info);
+  video_info.frame_size.width  = frame_info.width;
+  video_info.frame_size.height = frame_info.height;
+  if (frame_info.format == VIDEO_FRAME_FORMAT_RGBA8) {
+    video_info.frame_bytes = (uint64_t)frame_info.width * frame_info.height * 4;
+  }
+  else {
+    const uint64_t chroma_bytes = (uint64_t)((frame_info.width + 1) / 2)
+                                  * ((frame_info.height + 1) / 2);
+    video_info.frame_bytes
+      = (uint64_t)frame_info.width * frame_info.height + 2 * chroma_bytes;
+  }
 
-  start_video_decode();
+  video_decoder_start(video_decoder);
 
   return 0;
 }
 
-static int update_capture_texture(wgpu_context_t* wgpu_context)
+static void update_upload_stats(float time)
+{
+  const float interval = time - upload_stats.interval_start;
+  if (interval >= 1.0f) {
+    upload_stats.mib_per_second
+      = (double)upload_stats.bytes / (1024.0 * 1024.0) / interval;
+    upload_stats.frames_per_second = upload_stats.frames / interval;
+    upload_stats.bytes             = 0;
+    upload_stats.frames            = 0;
+    upload_stats.interval_start    = time;
+  }
+}
+
+static int update_capture_texture(wgpu_example_context_t* context)
 {
-  int video_w = 0, video_h = 0;
-  void* video_buf = NULL;
-
-  get_video_dimension(&video_w, &video_h);
-  get_video_buffer(&video_buf);
-
-  if (video_buf) {
-    wgpu_image_to_texure(wgpu_context, video_texture.texture,
-                         (uint8_t*)video_buf,
-                         (WGPUExtent3D){
-                           .width              = video_info.frame_size.width,
-                           .height             = video_info.frame_size.height,
-                           .depthOrArrayLayers = 1,
-                         },
-                         4u);
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  // Only upload frames decoded since the last update, into the texture which
+  // is not used by the previous frame
+  video_frame_t frame = {0};
+  if (video_decoder_acquire_frame(video_decoder, &frame) && frame.data) {
+    const uint32_t next = (video_texture.current + 1)
+                          % (uint32_t)ARRAY_SIZE(video_texture.textures);
+    bool uploaded       = true;
+    if (video_texture.yuv_converters[next] != NULL) {
+      wgpu_yuv_converter_convert(video_texture.yuv_converters[next],
+                                 frame.data);
+    }
+    else {
+      uploaded = wgpu_upload_ring_write_texture(
+        wgpu_context->upload_ring,
+        &(WGPUImageCopyTexture){
+          .texture  = video_texture.textures[next],
+          .mipLevel = 0,
+          .origin   = (WGPUOrigin3D){0},
+          .aspect   = WGPUTextureAspect_All,
+        },
+        frame.data, (uint32_t)video_info.frame_size.width * 4u,
+        &(WGPUExtent3D){
+          .width              = video_info.frame_size.width,
+          .height             = video_info.frame_size.height,
+          .depthOrArrayLayers = 1,
+        });
+    }
+    if (uploaded) {
+      video_texture.current = next;
+      upload_stats.bytes += video_info.frame_bytes;
+      ++upload_stats.frames;
+      compressed_video.frame_pending = true;
+    }
   }
+  video_decoder_release_frame(video_decoder);
+  update_upload_stats(context->run_time);
 
   return 0;
 }
@@ -308,11 +502,14 @@ static int update_capture_texture(wgpu_context_t* wgpu_context)
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
-    prepare_video(video_file_location);
+    if (prepare_video(video_file_location) != 0) {
+      return 1;
+    }
     prepare_vertex_buffer(context->wgpu_context);
-    prepare_video_texture(context->wgpu_context);
+    prepare_video_textures(context->wgpu_context);
+    prepare_compressed_video_textures(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
-    prepare_uniform_bind_group(context->wgpu_context);
+    prepare_uniform_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return 0;
@@ -321,6 +518,42 @@ static int example_initialize(wgpu_example_context_t* context)
   return 1;
 }
 
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Upload")) {
+    imgui_overlay_text("%.1f MiB/s", upload_stats.mib_per_second);
+    imgui_overlay_text("%.1f frames/s", upload_stats.frames_per_second);
+  }
+
+  if (compressed_video.compressor != NULL
+      && imgui_overlay_header("Compression")) {
+    static const char* sampled_formats[SampledFormat_Count]
+      = {"RGBA8", "BC1", "BC7"};
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Sampled format",
+                                &compressed_video.sampled_format,
+                                sampled_formats, SampledFormat_Count)) {
+      compressed_video.frame_pending = true;
+    }
+    // Bytes read when the frame is sampled once
+    const uint64_t texel_count = (uint64_t)video_info.frame_size.width
+                                 * video_info.frame_size.height;
+    const uint64_t sampled_bytes
+      = compressed_video.sampled_format == SampledFormat_RGBA8 ?
+          texel_count * 4 :
+          texel_count / 16
+            * wgpu_texture_compression_get_block_size(
+              sampled_format_compressions[compressed_video.sampled_format]);
+    imgui_overlay_text("Frame: %.0f KiB (RGBA8 %.0f KiB)",
+                       (double)sampled_bytes / 1024.0,
+                       (double)(texel_count * 4) / 1024.0);
+    if (compressed_video.sampled_format != SampledFormat_RGBA8) {
+      imgui_overlay_text(
+        "PSNR: %.1f dB",
+        wgpu_texture_compressor_get_stats(compressed_video.compressor)->psnr);
+    }
+  }
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   // Set target frame buffer
@@ -330,6 +563,25 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  // Compress the new frame into the texture of the sampled format
+  const uint32_t current   = video_texture.current;
+  const int32_t format     = compressed_video.sampled_format;
+  WGPUBindGroup bind_group = uniform_bind_groups[current];
+  if (format != SampledFormat_RGBA8) {
+    if (compressed_video.frame_pending) {
+      wgpu_texture_compressor_encode(
+        compressed_video.compressor, wgpu_context->cmd_enc,
+        video_texture.views[current],
+        compressed_video.textures[format][current],
+        wgpu_texture_compression_get_format(sampled_format_compressions[format],
+                                            false),
+        (uint32_t)video_info.frame_size.width,
+        (uint32_t)video_info.frame_size.height, 0, 0);
+      compressed_video.frame_pending = false;
+    }
+    bind_group = compressed_video.bind_groups[format][current];
+  }
+
   // Create render pass
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass.descriptor);
@@ -337,10 +589,17 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
   wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
                                        vertices.buffer, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                    uniform_bind_group, 0, 0);
+  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0, bind_group, 0,
+                                    0);
   wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, vertices.count, 1, 0, 0);
 
+  // Draw ui overlay into the same pass, there is no depth attachment
+  draw_ui_in_pass(wgpu_context->context, example_on_update_ui_overlay,
+                  wgpu_context->rpass_enc,
+                  &(imgui_overlay_pass_desc_t){
+                    .depth_stencil_format = WGPUTextureFormat_Undefined,
+                  });
+
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
@@ -357,7 +616,7 @@ static int example_draw(wgpu_example_context_t* context)
 {
   wgpu_context_t* wgpu_context = context->wgpu_context;
 
-  update_capture_texture(wgpu_context);
+  update_capture_texture(context);
 
   // Prepare frame
   prepare_frame(context);
@@ -389,10 +648,20 @@ static void example_destroy(wgpu_example_context_t* context)
   UNUSED_VAR(context);
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
-  WGPU_RELEASE_RESOURCE(BindGroup, uniform_bind_group)
   WGPU_RELEASE_RESOURCE(Sampler, video_texture.sampler)
-  WGPU_RELEASE_RESOURCE(Texture, video_texture.texture)
-  WGPU_RELEASE_RESOURCE(TextureView, video_texture.view)
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(video_texture.textures); ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, uniform_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(Texture, video_texture.textures[i])
+    WGPU_RELEASE_RESOURCE(TextureView, video_texture.views[i])
+    wgpu_yuv_converter_destroy(video_texture.yuv_converters[i]);
+    for (uint32_t f = 0; f < (uint32_t)SampledFormat_Count; ++f) {
+      WGPU_RELEASE_RESOURCE(BindGroup, compressed_video.bind_groups[f][i])
+      WGPU_RELEASE_RESOURCE(Texture, compressed_video.textures[f][i])
+      WGPU_RELEASE_RESOURCE(TextureView, compressed_video.views[f][i])
+    }
+  }
+  wgpu_texture_compressor_destroy(compressed_video.compressor);
+  video_decoder_release(video_decoder);
 }
 
 void example_video_uploading(int argc, char* argv[])
@@ -401,6 +670,7 @@ void example_video_uploading(int argc, char* argv[])
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
      .title           = example_title,
+     .overlay         = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -0,0 +1,638 @@
+#include "example_base.h"
+#include "examples.h"
+
+#include <string.h>
+
+#include "../core/argparse.h"
+#include "../core/video_decode.h"
+#include "../core/view_layout.h"
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/swap_chain_set.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Video Wall
+ *
+ * This example shows how a monitoring wall plays several video streams on
+ * several windows from one process:
+ * - Every stream has its own video decoder, the decode jobs of all streams
+ *   run on one shared thread pool
+ * - The added windows get a swap chain of the device of the example (see
+ *   swap_chain_set.h), one frame records a render pass per window and submits
+ *   them together
+ * - The streams are placed on the windows with the view layout (see
+ *   view_layout.h), which splits them evenly over the windows and picks the
+ *   grid with the largest views per window. A stream is drawn into the
+ *   viewport of its view.
+ *
+ * Options: --streams=<count> (default 4), --windows=<count> (default 2),
+ * --fullscreen (window i on monitor i) and --video=<file>.
+ * -------------------------------------------------------------------------- */
+
+#define MAX_STREAMS 64u
+
+// Shaders
+// clang-format off
+static const char* vertex_shader_wgsl = CODE(
+  struct VertexOutput {
+    @builtin(position) Position : vec4<f32>,
+    @location(0) fragUV : vec2<f32>
+  }
+
+  // Triangle covering the viewport of the view
+  @vertex
+  fn main(@builtin(vertex_index) vertex_index : u32) -> VertexOutput {
+    let uv = vec2<f32>(f32((vertex_index << 1u) & 2u), f32(vertex_index & 2u));
+    return VertexOutput(vec4<f32>(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, 0.0, 1.0),
+                        uv);
+  }
+);
+
+static const char* fragment_shader_wgsl = CODE(
+  @group(0) @binding(0) var mySampler: sampler;
+  @group(0) @binding(1) var myTexture: texture_2d<f32>;
+
+  @fragment
+  fn main(@location(0) fragUV : vec2<f32>) -> @location(0) vec4<f32> {
+    return textureSample(myTexture, mySampler, fragUV);
+  }
+);
+// clang-format on
+
+// Command line options
+static struct {
+  int32_t stream_count;
+  int32_t window_count;
+  int fullscreen;
+  const char* video;
+} options = {
+  .stream_count = 4,
+  .window_count = 2,
+  .video        = "videos/video_uploading/big_buck_bunny_trailer.mp4",
+};
+
+// Decoder and texture of a video stream
+typedef struct video_stream_t {
+  video_decoder_t* decoder;
+  WGPUTexture texture;
+  WGPUTextureView view;
+  // Converts the 4:2:0 frames of the decoder into the texture
+  wgpu_yuv_converter_t* yuv_converter;
+  WGPUBindGroup bind_group;
+  uint32_t width;
+  uint32_t height;
+} video_stream_t;
+
+static struct {
+  thread_pool_t* thread_pool;
+  video_stream_t streams[MAX_STREAMS];
+  uint32_t count;
+  // Shown in the overlay
+  int32_t selected;
+} video_streams = {0};
+
+// The windows of the wall, window 0 is the window of the example
+static struct {
+  wgpu_swap_chain_set_t* swap_chain_set;
+  window_t* windows[WGPU_SWAP_CHAIN_SET_MAX_WINDOWS];
+  // Placement of the streams, updated every frame
+  view_layout_t layout;
+} wall = {0};
+
+// Pipeline and sampler
+static WGPURenderPipeline pipeline = {0};
+static WGPUSampler sampler         = {0};
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass = {0};
+
+// Uploaded frames of all streams, measured over intervals of one second
+static struct {
+  uint32_t frames;
+  float interval_start;
+  double frames_per_second;
+} upload_stats = {0};
+
+// Other variables
+static const char* example_title = "Video Wall";
+static bool prepared             = false;
+
+static void prepare_windows(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  wall.swap_chain_set
+    = wgpu_swap_chain_set_create(wgpu_context, context->window);
+  // Headless runs render the wall on the offscreen frame buffer only
+  if (context->window == NULL) {
+    return;
+  }
+
+  const int monitor_count = window_get_monitor_count();
+  for (int32_t i = 1; i < options.window_count; ++i) {
+    char title[STRMAX];
+    snprintf(title, sizeof(title), "%s (%d)", example_title, i + 1);
+    wall.windows[i] = window_create(&(window_config_t){
+      .title     = title,
+      .width     = context->window_size.width,
+      .height    = context->window_size.height,
+      .resizable = 1,
+      .monitor   = options.fullscreen && i < monitor_count ? i + 1 : 0,
+    });
+    wgpu_swap_chain_set_add_window(wall.swap_chain_set, wall.windows[i]);
+  }
+}
+
+static void prepare_video_stream(wgpu_context_t* wgpu_context,
+                                 video_stream_t* stream)
+{
+  video_frame_info_t frame_info = {0};
+  video_decoder_get_frame_info(stream->decoder, &frame_info);
+  stream->width  = (uint32_t)frame_info.width;
+  stream->height = (uint32_t)frame_info.height;
+
+  // Create the texture
+  stream->texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .size          = (WGPUExtent3D){
+        .width              = stream->width,
+        .height             = stream->height,
+        .depthOrArrayLayers = 1,
+      },
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+      .dimension     = WGPUTextureDimension_2D,
+      .format        = WGPUTextureFormat_RGBA8Unorm,
+      .usage         = WGPUTextureUsage_CopyDst
+                       | WGPUTextureUsage_TextureBinding
+                       | WGPUTextureUsage_StorageBinding,
+  });
+  ASSERT(stream->texture != NULL);
+  stream->view = wgpuTextureCreateView(stream->texture, NULL);
+  ASSERT(stream->view != NULL);
+
+  // Planar frames are converted on the GPU
+  if (frame_info.format != VIDEO_FRAME_FORMAT_RGBA8) {
+    const wgpu_yuv_format_enum_t yuv_format
+      = frame_info.format == VIDEO_FRAME_FORMAT_NV12 ? WGPU_YUV_Format_NV12 :
+                                                       WGPU_YUV_Format_I420;
+    stream->yuv_converter = wgpu_yuv_converter_create(
+      wgpu_context, &(wgpu_yuv_converter_desc_t){
+                      .format     = yuv_format,
+                      .width      = stream->width,
+                      .height     = stream->height,
+                      .bt709      = frame_info.bt709 != 0,
+                      .full_range = frame_info.full_range != 0,
+                      .texture    = stream->texture,
+                    });
+  }
+}
+
+static int prepare_video_streams(wgpu_context_t* wgpu_context)
+{
+  video_streams.thread_pool = thread_pool_create(0);
+  for (uint32_t i = 0; i < (uint32_t)options.stream_count; ++i) {
+    video_stream_t* stream = &video_streams.streams[i];
+    stream->decoder        = video_decoder_open(&(video_decoder_desc_t){
+      .filename    = options.video,
+      .thread_pool = video_streams.thread_pool,
+    });
+    if (stream->decoder == NULL) {
+      return 1;
+    }
+    ++video_streams.count;
+    prepare_video_stream(wgpu_context, stream);
+    video_decoder_start(stream->decoder);
+  }
+
+  return 0;
+}
+
+static void prepare_pipelines(wgpu_context_t* wgpu_context)
+{
+  // Primitive state
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  // Color target state
+  WGPUBlendState blend_state              = wgpu_create_blend_state(false);
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // Vertex state
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                wgpu_context, &(wgpu_vertex_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Vertex shader WGSL
+                  .label            = "vertex_shader_wgsl",
+                  .wgsl_code.source = vertex_shader_wgsl,
+                },
+                .buffer_count = 0,
+                .buffers      = NULL,
+              });
+
+  // Fragment state
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                wgpu_context, &(wgpu_fragment_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Fragment shader WGSL
+                  .label            = "fragment_shader_wgsl",
+                  .wgsl_code.source = fragment_shader_wgsl,
+                },
+                .target_count = 1,
+                .targets      = &color_target_state,
+              });
+
+  // Multisample state
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  // Create rendering pipeline using the specified states
+  pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label       = "video_wall_render_pipeline",
+                            .primitive   = primitive_state,
+                            .vertex      = vertex_state,
+                            .fragment    = &fragment_state,
+                            .multisample = multisample_state,
+                          });
+  ASSERT(pipeline != NULL);
+
+  // Partial cleanup
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
+static void prepare_bind_groups(wgpu_context_t* wgpu_context)
+{
+  // Create the sampler
+  sampler = wgpuDeviceCreateSampler(
+    wgpu_context->device, &(WGPUSamplerDescriptor){
+                            .addressModeU  = WGPUAddressMode_ClampToEdge,
+                            .addressModeV  = WGPUAddressMode_ClampToEdge,
+                            .addressModeW  = WGPUAddressMode_ClampToEdge,
+                            .minFilter     = WGPUFilterMode_Linear,
+                            .magFilter     = WGPUFilterMode_Linear,
+                            .mipmapFilter  = WGPUFilterMode_Nearest,
+                            .maxAnisotropy = 1,
+                          });
+  ASSERT(sampler != NULL);
+
+  // One bind group per stream
+  for (uint32_t i = 0; i < video_streams.count; ++i) {
+    video_stream_t* stream           = &video_streams.streams[i];
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .sampler = sampler,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = stream->view,
+      },
+    };
+    stream->bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = wgpuRenderPipelineGetBindGroupLayout(pipeline, 0),
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(stream->bind_group != NULL)
+  }
+}
+
+static void setup_render_pass(void)
+{
+  // Color attachment, the gaps between the views stay dark gray
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, // Assigned later
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearColor = (WGPUColor) {
+        .r = 0.1f,
+        .g = 0.1f,
+        .b = 0.1f,
+        .a = 1.0f,
+      },
+  };
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .colorAttachmentCount = 1,
+    .colorAttachments     = render_pass.color_attachments,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    prepare_windows(context);
+    if (prepare_video_streams(context->wgpu_context) != 0) {
+      return 1;
+    }
+    prepare_pipelines(context->wgpu_context);
+    prepare_bind_groups(context->wgpu_context);
+    setup_render_pass();
+    prepared = true;
+    return 0;
+  }
+
+  return 1;
+}
+
+/* Follows the size of the added windows and places the streams on all
+ * windows, the views have the aspect ratio of the video */
+static void update_layout(wgpu_example_context_t* context)
+{
+  for (uint32_t i = 1;
+       i < wgpu_swap_chain_set_get_window_count(wall.swap_chain_set); ++i) {
+    window_t* window = wgpu_swap_chain_set_get_window(wall.swap_chain_set, i);
+    // Closing any window of the wall ends the example
+    if (window_should_close(window)) {
+      example_request_close(context);
+    }
+    uint32_t width = 0, height = 0;
+    window_get_size(window, &width, &height);
+    wgpu_swap_chain_set_resize(wall.swap_chain_set, i, width, height);
+  }
+
+  const video_stream_t* stream = &video_streams.streams[0];
+  wgpu_swap_chain_set_layout_views(
+    wall.swap_chain_set, video_streams.count,
+    (float)stream->width / (float)stream->height, 8, &wall.layout);
+}
+
+static void update_video_textures(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  // Only upload frames decoded since the last update
+  for (uint32_t i = 0; i < video_streams.count; ++i) {
+    video_stream_t* stream = &video_streams.streams[i];
+    video_frame_t frame    = {0};
+    if (video_decoder_acquire_frame(stream->decoder, &frame) && frame.data) {
+      bool uploaded = true;
+      if (stream->yuv_converter != NULL) {
+        wgpu_yuv_converter_convert(stream->yuv_converter, frame.data);
+      }
+      else {
+        uploaded = wgpu_upload_ring_write_texture(
+          wgpu_context->upload_ring,
+          &(WGPUImageCopyTexture){
+            .texture  = stream->texture,
+            .mipLevel = 0,
+            .origin   = (WGPUOrigin3D){0},
+            .aspect   = WGPUTextureAspect_All,
+          },
+          frame.data, stream->width * 4u,
+          &(WGPUExtent3D){
+            .width              = stream->width,
+            .height             = stream->height,
+            .depthOrArrayLayers = 1,
+          });
+      }
+      if (uploaded) {
+        ++upload_stats.frames;
+      }
+    }
+    video_decoder_release_frame(stream->decoder);
+  }
+
+  const float interval = context->run_time - upload_stats.interval_start;
+  if (interval >= 1.0f) {
+    upload_stats.frames_per_second = upload_stats.frames / interval;
+    upload_stats.frames            = 0;
+    upload_stats.interval_start    = context->run_time;
+  }
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Video wall")) {
+    imgui_overlay_text(
+      "%u streams on %u windows", video_streams.count,
+      wgpu_swap_chain_set_get_window_count(wall.swap_chain_set));
+    imgui_overlay_text("Uploads: %.1f frames/s",
+                       upload_stats.frames_per_second);
+  }
+
+  if (imgui_overlay_header("Stream")) {
+    imgui_overlay_slider_int(context->imgui_overlay, "Stream",
+                             &video_streams.selected, 0,
+                             (int32_t)video_streams.count - 1);
+    const uint32_t index   = (uint32_t)video_streams.selected;
+    const uint32_t display = wall.layout.views[index].display;
+    video_decoder_stats_t stats = {0};
+    video_decoder_get_stats(video_streams.streams[index].decoder, &stats);
+    imgui_overlay_text("Window %u, grid %ux%u", display + 1,
+                       wall.layout.displays[display].columns,
+                       wall.layout.displays[display].rows);
+    imgui_overlay_text("Decoded: %llu, shown: %llu",
+                       (unsigned long long)stats.decoded_frames,
+                       (unsigned long long)stats.acquired_frames);
+    imgui_overlay_text("Decode time: %.2f ms", stats.decode_time_ms);
+  }
+}
+
+/* Draws the views of one window, window 0 gets the overlay */
+static void draw_window(wgpu_example_context_t* context, uint32_t window)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  render_pass.color_attachments[0].view
+    = wgpu_swap_chain_set_get_current_image(wall.swap_chain_set, window);
+  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    wgpu_context->cmd_enc, &render_pass.descriptor);
+
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipeline);
+  const uint32_t first_view = wall.layout.displays[window].first_view;
+  for (uint32_t i = 0; i < wall.layout.displays[window].view_count; ++i) {
+    const uint32_t view     = first_view + i;
+    const view_rect_t* rect = &wall.layout.views[view].rect;
+    if (rect->width == 0 || rect->height == 0) {
+      continue;
+    }
+    wgpuRenderPassEncoderSetViewport(
+      wgpu_context->rpass_enc, (float)rect->x, (float)rect->y,
+      (float)rect->width, (float)rect->height, 0.0f, 1.0f);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      video_streams.streams[view].bind_group,
+                                      0, 0);
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  }
+
+  if (window == 0) {
+    uint32_t width = 0, height = 0;
+    wgpu_swap_chain_set_get_size(wall.swap_chain_set, 0, &width, &height);
+    wgpuRenderPassEncoderSetViewport(wgpu_context->rpass_enc, 0.0f, 0.0f,
+                                     (float)width, (float)height, 0.0f, 1.0f);
+    // Draw ui overlay into the same pass, there is no depth attachment
+    draw_ui_in_pass(context, example_on_update_ui_overlay,
+                    wgpu_context->rpass_enc,
+                    &(imgui_overlay_pass_desc_t){
+                      .depth_stencil_format = WGPUTextureFormat_Undefined,
+                    });
+  }
+
+  // End render pass
+  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // One render pass per window
+  for (uint32_t i = 0;
+       i < wgpu_swap_chain_set_get_window_count(wall.swap_chain_set); ++i) {
+    draw_window(context, i);
+  }
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  update_layout(context);
+  update_video_textures(context);
+
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit to queue
+  submit_command_buffers(context);
+
+  // Present the added windows, then window 0 ends the frame
+  wgpu_swap_chain_set_present(wall.swap_chain_set);
+  submit_frame(context);
+
+  return 0;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return 1;
+  }
+  return example_draw(context);
+}
+
+static void example_destroy(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
+  WGPU_RELEASE_RESOURCE(Sampler, sampler)
+  for (uint32_t i = 0; i < video_streams.count; ++i) {
+    video_stream_t* stream = &video_streams.streams[i];
+    WGPU_RELEASE_RESOURCE(BindGroup, stream->bind_group)
+    WGPU_RELEASE_RESOURCE(TextureView, stream->view)
+    WGPU_RELEASE_RESOURCE(Texture, stream->texture)
+    wgpu_yuv_converter_destroy(stream->yuv_converter);
+    video_decoder_release(stream->decoder);
+  }
+  // The decoders wait for their jobs before the pool is released
+  thread_pool_release(video_streams.thread_pool);
+  memset(&video_streams, 0, sizeof(video_streams));
+
+  // The swap chains are released before their windows
+  wgpu_swap_chain_set_destroy(wall.swap_chain_set);
+  for (uint32_t i = 1; i < WGPU_SWAP_CHAIN_SET_MAX_WINDOWS; ++i) {
+    window_destroy(wall.windows[i]);
+  }
+  memset(&wall, 0, sizeof(wall));
+  prepared = false;
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[3]   = {"--streams=", "--windows=", "--video="};
+  char* filters_flag[2] = {"--fullscreen", "--help-video-wall"};
+  char* filtered_argv[1 + 3 + 2 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option argparse_options[] = {
+    OPT_INTEGER(0, "streams", &options.stream_count,
+                "number of video streams (up to 64)", NULL, 0, 0),
+    OPT_INTEGER(0, "windows", &options.window_count,
+                "number of windows the streams are spread over (up to 16)",
+                NULL, 0, 0),
+    OPT_STRING(0, "video", &options.video, "video file of the streams", NULL,
+               0, 0),
+    OPT_BOOLEAN(0, "fullscreen", &options.fullscreen,
+                "open the windows full screen, one per monitor", NULL, 0, 0),
+    OPT_BOOLEAN(0, "help-video-wall", NULL, "show the video wall options",
+                argparse_help_cb_no_exit, 0, OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, argparse_options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+
+  options.stream_count = CLAMP(options.stream_count, 1, (int32_t)MAX_STREAMS);
+  options.window_count = CLAMP(options.window_count, 1,
+                               (int32_t)WGPU_SWAP_CHAIN_SET_MAX_WINDOWS);
+}
+
+void example_video_wall(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+     .title   = example_title,
+     .overlay = true,
+    },
+    .example_window_config = (window_config_t){
+     .resizable = true,
+     .monitor   = options.fullscreen ? 1 : 0,
+    },
+    .example_initialize_func = &example_initialize,
+    .example_render_func     = &example_render,
+    .example_destroy_func    = &example_destroy,
+  });
+  // clang-format on
+}
@@ -0,0 +1,548 @@
+#include "example_base.h"
+#include "examples.h"
+
+#include <string.h>
+
+#include "../core/argparse.h"
+#include "../webgpu/gltf_model.h"
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/voxelizer.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Voxelization
+ *
+ * Voxelizes a glTF scene (--model=<file>, models/venus.gltf by default) on the
+ * GPU into a 3D r32uint texture with a mip chain of the voxel coverage, the
+ * foundation of voxel cone traced global illumination. Every triangle is
+ * rasterized once along the axis where it covers the most voxels, with
+ * conservative rasterization emulated in the shaders, see
+ * webgpu/voxelizer.h.
+ *
+ * The selected level of the voxel texture is ray marched voxel by voxel and
+ * shaded by the coverage of the voxels. The GPU time of the voxelization is
+ * measured for every grid size, enable "Voxelize every frame" and switch
+ * between the sizes to compare them.
+ *
+ * Ref:
+ * https://developer.nvidia.com/content/basics-gpu-voxelization
+ * https://github.com/gpuweb/gpuweb/issues/137
+ * -------------------------------------------------------------------------- */
+
+static const uint32_t grid_sizes[4]   = {32, 64, 128, 256};
+static const char* grid_size_names[4] = {"32^3", "64^3", "128^3", "256^3"};
+
+// Voxelizer of the scene
+static wgpu_voxelizer_t* voxelizer = NULL;
+
+// Ray marching of the voxel texture
+static struct {
+  wgpu_buffer_t uniform_buffer;
+  struct {
+    mat4 inverse_view_projection;
+    vec4 camera_position;
+    uint32_t level;
+    uint32_t level_size;
+    uint32_t padding[2];
+  } ubo;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPURenderPipeline pipeline;
+} view;
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass;
+
+static struct {
+  int32_t grid_size_index;
+  int32_t level;
+  bool voxelize_every_frame;
+  bool voxelize_pending;
+  // Grid size of the last voxelization and the measured GPU times
+  int32_t voxelized_grid_size_index;
+  float gpu_time_ms[4];
+} settings = {
+  .grid_size_index      = 2,
+  .voxelize_every_frame = true,
+  .voxelize_pending     = true,
+};
+
+static uint32_t triangle_count = 0;
+
+// Command line options
+static struct {
+  const char* model;
+} options = {
+  .model = "models/venus.gltf",
+};
+
+// Other variables
+static const char* example_title = "Voxelization";
+static bool prepared             = false;
+
+// clang-format off
+static const char* voxel_view_shader_wgsl = CODE(
+  struct Uniforms {
+    inverseViewProjection : mat4x4f,
+    cameraPosition        : vec4f,
+    level                 : u32,
+    levelSize             : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> ubo : Uniforms;
+  @group(0) @binding(1) var voxelTexture : texture_3d<u32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) ndc : vec2f,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    let uv = vec2f(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u));
+    var output : VertexOutput;
+    output.position = vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+    output.ndc      = uv * 2.0 - 1.0;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4f {
+    let background = vec4f(0.1, 0.1, 0.12, 1.0);
+
+    // Ray in the voxel space of the level, the grid spans [-1, 1] in world
+    // space with y flipped
+    let far    = ubo.inverseViewProjection * vec4f(input.ndc, 1.0, 1.0);
+    let origin = ubo.cameraPosition.xyz;
+    let flipY  = vec3f(1.0, -1.0, 1.0);
+    let size   = f32(ubo.levelSize);
+    let ro     = (origin * flipY + 1.0) * 0.5 * size;
+    var rd     = normalize(far.xyz / far.w - origin) * flipY;
+    rd = select(rd, vec3f(1e-6), abs(rd) < vec3f(1e-6));
+    let invDir = 1.0 / rd;
+
+    let t0     = -ro * invDir;
+    let t1     = (vec3f(size) - ro) * invDir;
+    let tEntry = min(t0, t1);
+    let tExit  = max(t0, t1);
+    let tNear  = max(max(max(tEntry.x, tEntry.y), tEntry.z), 0.0);
+    let tFar   = min(min(tExit.x, tExit.y), tExit.z);
+    if (tNear >= tFar) {
+      return background;
+    }
+
+    // Amanatides & Woo traversal from the entry voxel
+    let stepDir = vec3i(sign(rd));
+    let tDelta  = abs(invDir);
+    let maxCell = vec3i(i32(ubo.levelSize) - 1);
+    var cell = clamp(vec3i(floor(ro + rd * (tNear + 1e-4))), vec3i(0), maxCell);
+    var tMax = (vec3f(cell) + select(vec3f(0.0), vec3f(1.0), rd > vec3f(0.0))
+                - ro) * invDir;
+    var normal = vec3f(0.0, 0.0, -f32(stepDir.z));
+    if (tEntry.x >= tEntry.y && tEntry.x >= tEntry.z) {
+      normal = vec3f(-f32(stepDir.x), 0.0, 0.0);
+    }
+    else if (tEntry.y >= tEntry.z) {
+      normal = vec3f(0.0, -f32(stepDir.y), 0.0);
+    }
+
+    for (var i = 0u; i < 3u * ubo.levelSize; i++) {
+      let coverage = textureLoad(voxelTexture, cell, ubo.level).r;
+      if (coverage > 0u) {
+        let lightDir = normalize(vec3f(0.4, -0.8, 0.5));
+        let diffuse  = max(dot(normal, -lightDir), 0.0) * 0.7 + 0.3;
+        let albedo   = mix(vec3f(0.3, 0.4, 0.8), vec3f(0.9, 0.8, 0.6),
+                           f32(coverage) / 255.0);
+        return vec4f(albedo * diffuse, 1.0);
+      }
+      if (tMax.x < tMax.y && tMax.x < tMax.z) {
+        cell.x += stepDir.x;
+        tMax.x += tDelta.x;
+        normal = vec3f(-f32(stepDir.x), 0.0, 0.0);
+      }
+      else if (tMax.y < tMax.z) {
+        cell.y += stepDir.y;
+        tMax.y += tDelta.y;
+        normal = vec3f(0.0, -f32(stepDir.y), 0.0);
+      }
+      else {
+        cell.z += stepDir.z;
+        tMax.z += tDelta.z;
+        normal = vec3f(0.0, 0.0, -f32(stepDir.z));
+      }
+      if (any(cell < vec3i(0)) || any(cell > maxCell)) {
+        break;
+      }
+    }
+    return background;
+  }
+);
+// clang-format on
+
+static void setup_camera(wgpu_example_context_t* context)
+{
+  context->camera       = camera_create();
+  context->camera->type = CameraType_LookAt;
+  camera_set_perspective(context->camera, 60.0f,
+                         context->window_size.aspect_ratio, 0.1f, 256.0f);
+  camera_set_rotation(context->camera, (vec3){-20.0f, 30.0f, 0.0f});
+  camera_set_translation(context->camera, (vec3){0.0f, 0.0f, -3.5f});
+  camera_set_rotation_speed(context->camera, 0.25f);
+}
+
+// Loads the triangles of the scene into the voxelizer
+static void prepare_voxelizer(wgpu_context_t* wgpu_context)
+{
+  voxelizer = wgpu_voxelizer_create(
+    wgpu_context, &(wgpu_voxelizer_desc_t){
+                    .label     = "Scene voxels",
+                    .grid_size = grid_sizes[settings.grid_size_index],
+                  });
+
+  const uint32_t gltf_loading_flags
+    = WGPU_GLTF_FileLoadingFlags_PreTransformVertices
+      | WGPU_GLTF_FileLoadingFlags_DontLoadImages
+      | WGPU_GLTF_FileLoadingFlags_RetainTriangles;
+  struct gltf_model_t* model
+    = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
+      .wgpu_context       = wgpu_context,
+      .filename           = options.model,
+      .file_loading_flags = gltf_loading_flags,
+    });
+  const float* positions
+    = model ? wgpu_gltf_model_get_triangles(model, &triangle_count) : NULL;
+  if (triangle_count == 0) {
+    log_warn("No triangles loaded from %s\n", options.model);
+  }
+  wgpu_voxelizer_set_triangles(voxelizer, positions, triangle_count);
+  wgpu_gltf_model_destroy(model);
+}
+
+static void update_uniform_buffer(wgpu_example_context_t* context)
+{
+  camera_t* camera = context->camera;
+  mat4 view_projection, inverse_view;
+  glm_mat4_mul(camera->matrices.perspective, camera->matrices.view,
+               view_projection);
+  glm_mat4_inv(view_projection, view.ubo.inverse_view_projection);
+  glm_mat4_inv(camera->matrices.view, inverse_view);
+  glm_vec4_copy(inverse_view[3], view.ubo.camera_position);
+
+  view.ubo.level      = (uint32_t)settings.level;
+  view.ubo.level_size
+    = wgpu_voxelizer_get_grid_size(voxelizer) >> view.ubo.level;
+
+  wgpu_queue_write_buffer(context->wgpu_context, view.uniform_buffer.buffer, 0,
+                          &view.ubo, sizeof(view.ubo));
+}
+
+static void setup_bind_group(wgpu_context_t* wgpu_context)
+{
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0 : Uniform buffer
+      .binding = 0,
+      .buffer  = view.uniform_buffer.buffer,
+      .offset  = 0,
+      .size    = view.uniform_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1 : Voxel texture with all levels
+      .binding     = 1,
+      .textureView = wgpu_voxelizer_get_view(voxelizer),
+    },
+  };
+  view.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Voxel view bind group",
+                            .layout     = view.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(view.bind_group != NULL);
+}
+
+static void prepare_view_pipeline(wgpu_context_t* wgpu_context)
+{
+  view.uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(view.ubo),
+                  });
+
+  WGPUColorTargetState color_target_state = {
+    .format    = wgpu_context->swap_chain.format,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // Fullscreen triangle, the rays are generated in the fragment shader
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                wgpu_context, &(wgpu_vertex_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Vertex shader WGSL
+                  .label            = "voxel_view_vertex_shader",
+                  .wgsl_code.source = voxel_view_shader_wgsl,
+                  .entry            = "vs_main",
+                },
+                .buffer_count = 0,
+                .buffers      = NULL,
+              });
+
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                wgpu_context, &(wgpu_fragment_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Fragment shader WGSL
+                  .label            = "voxel_view_fragment_shader",
+                  .wgsl_code.source = voxel_view_shader_wgsl,
+                  .entry            = "fs_main",
+                },
+                .target_count = 1,
+                .targets      = &color_target_state,
+              });
+
+  view.pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label     = "voxel_view_render_pipeline",
+                            .primitive = (WGPUPrimitiveState){
+                              .topology  = WGPUPrimitiveTopology_TriangleList,
+                              .frontFace = WGPUFrontFace_CCW,
+                              .cullMode  = WGPUCullMode_None,
+                            },
+                            .vertex      = vertex_state,
+                            .fragment    = &fragment_state,
+                            .multisample = (WGPUMultisampleState){
+                              .count = 1,
+                              .mask  = 0xFFFFFFFF,
+                            },
+                          });
+  ASSERT(view.pipeline != NULL);
+  view.bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(view.pipeline, 0);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
+static void setup_render_pass(void)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, // Assigned later
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor) {
+        .r = 0.0f,
+        .g = 0.0f,
+        .b = 0.0f,
+        .a = 1.0f,
+      },
+  };
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .colorAttachmentCount = 1,
+    .colorAttachments     = render_pass.color_attachments,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    setup_camera(context);
+    prepare_voxelizer(context->wgpu_context);
+    prepare_view_pipeline(context->wgpu_context);
+    setup_bind_group(context->wgpu_context);
+    setup_render_pass();
+    prepared = true;
+    return 0;
+  }
+
+  return 1;
+}
+
+// Recreates the grid with the selected size, the view level is clamped to it
+static void resize_grid(wgpu_context_t* wgpu_context)
+{
+  wgpu_voxelizer_set_grid_size(voxelizer,
+                               grid_sizes[settings.grid_size_index]);
+  settings.level = MIN(settings.level,
+                       (int32_t)wgpu_voxelizer_get_level_count(voxelizer) - 1);
+  settings.voxelize_pending = true;
+  WGPU_RELEASE_RESOURCE(BindGroup, view.bind_group)
+  setup_bind_group(wgpu_context);
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  // GPU time of the last profiled voxelization
+  wgpu_profiler_t* profiler = context->wgpu_context->profiler;
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  for (uint32_t i = 0; i < wgpu_profiler_get_scope_count(profiler); ++i) {
+    if (strcmp(scopes[i].name, "Voxelization") == 0) {
+      settings.gpu_time_ms[settings.voxelized_grid_size_index]
+        = scopes[i].gpu_time_ms;
+    }
+  }
+
+  if (imgui_overlay_header("Settings")) {
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Grid size",
+                                &settings.grid_size_index, grid_size_names,
+                                (uint32_t)ARRAY_SIZE(grid_sizes))) {
+      resize_grid(context->wgpu_context);
+    }
+    imgui_overlay_slider_int(
+      context->imgui_overlay, "Level", &settings.level, 0,
+      (int32_t)wgpu_voxelizer_get_level_count(voxelizer) - 1);
+    imgui_overlay_checkBox(context->imgui_overlay, "Voxelize every frame",
+                           &settings.voxelize_every_frame);
+    if (!settings.voxelize_every_frame
+        && imgui_overlay_button(context->imgui_overlay, "Voxelize")) {
+      settings.voxelize_pending = true;
+    }
+  }
+
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Triangles: %u", triangle_count);
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(grid_sizes); ++i) {
+      if (settings.gpu_time_ms[i] > 0.0f) {
+        imgui_overlay_text("Voxelization %s: %.2f ms", grid_size_names[i],
+                           settings.gpu_time_ms[i]);
+      }
+    }
+  }
+}
+
+// Build separate command buffer for the framebuffer image
+static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+{
+  // Set target frame buffer
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Voxelize the scene and build the mip chain
+  if (settings.voxelize_every_frame || settings.voxelize_pending) {
+    wgpu_voxelizer_voxelize(voxelizer, wgpu_context->cmd_enc);
+    settings.voxelized_grid_size_index = settings.grid_size_index;
+    settings.voxelize_pending          = false;
+  }
+
+  // Ray march the selected level
+  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    wgpu_context->cmd_enc, &render_pass.descriptor);
+  wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, view.pipeline);
+  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                    view.bind_group, 0, 0);
+  wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  update_uniform_buffer(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0]
+    = build_command_buffer(context->wgpu_context);
+
+  // Submit to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return 0;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return 1;
+  }
+  return example_draw(context);
+}
+
+static void example_destroy(wgpu_example_context_t* context)
+{
+  camera_release(context->camera);
+  wgpu_voxelizer_destroy(voxelizer);
+  voxelizer = NULL;
+  WGPU_RELEASE_RESOURCE(Buffer, view.uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, view.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, view.bind_group)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, view.pipeline)
+}
+
+static void parse_arguments(int argc, char* argv[])
+{
+  char* filters_eq[1]                = {"--model="};
+  char* filters_flag[1]              = {"--help-voxelization"};
+  char* filtered_argv[1 + 1 + 1 + 1] = {0};
+  const int max_fargc                = (int)ARRAY_SIZE(filtered_argv) - 1;
+  int fargc                          = 1;
+  for (int32_t i = 0; i < argc && fargc < max_fargc; ++i) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
+      if (has_prefix(argv[i], filters_eq[j])) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argv[i], filters_flag[j]) == 0) {
+        filtered_argv[fargc++] = argv[i];
+      }
+    }
+  }
+
+  struct argparse_option argparse_options[] = {
+    OPT_STRING(0, "model", &options.model,
+               "glTF model to voxelize (default models/venus.gltf)", NULL, 0,
+               0),
+    OPT_BOOLEAN(0, "help-voxelization", NULL,
+                "show the voxelization options", argparse_help_cb_no_exit, 0,
+                OPT_NONEG),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {NULL};
+  argparse_init(&argparse, argparse_options, usages, 0);
+  argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+}
+
+void example_voxelization(int argc, char* argv[])
+{
+  parse_arguments(argc, argv);
+
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+     .title   = example_title,
+     .overlay = true,
+     .vsync   = true,
+    },
+    .example_initialize_func = &example_initialize,
+    .example_render_func     = &example_render,
+    .example_destroy_func    = &example_destroy,
+  });
+  // clang-format on
+}
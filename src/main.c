@@ -6,15 +6,23 @@
 
 #include "core/api.h"
 #include "core/argparse.h"
+#include "core/video_decode.h"
+#include "examples/example_base.h"
 #include "examples/examples.h"
 
 int main(int argc, char* argv[])
 {
   srand((unsigned int)time(NULL));
+  random_seed((uint32_t)time(NULL));
   initialize_default_path();
 
   const char* example_name = NULL;
-  int demo_mode = 0, window_width = 0, window_height = 0;
+  const char* demo_output = NULL;
+  const char* asset_archive = NULL;
+  const char* video_hwaccel = NULL;
+  int demo_mode = 0, demo_frames = 0, demo_duration = 0, log_sync = 0;
+  int list_adapters = 0;
+  int window_width = 0, window_height = 0;
   struct argparse_option options[] = {
     OPT_BOOLEAN('?', "help", NULL, "show this help message and exit",
                 argparse_help_cb, 0, OPT_NONEG),
@@ -25,6 +33,104 @@ int main(int argc, char* argv[])
     OPT_BOOLEAN('d', "demo-mode", &demo_mode,
                 "demo mode, this mode runs every example for 10 seconds", NULL,
                 0, 0),
+    OPT_INTEGER(0, "demo-frames", &demo_frames,
+                "demo mode, number of measured frames per example", NULL, 0,
+                0),
+    OPT_INTEGER(0, "demo-duration", &demo_duration,
+                "demo mode, measured seconds per example (default: 10)", NULL,
+                0, 0),
+    OPT_STRING(0, "demo-output", &demo_output,
+               "demo mode, CSV file for the summary table", NULL, 0, 0),
+    OPT_STRING(0, "asset-archive", &asset_archive,
+               "packed asset archive, paths are resolved through it first "
+               "(default: assets/assets.pak if present)",
+               NULL, 0, 0),
+    OPT_STRING(0, "video-hwaccel", &video_hwaccel,
+               "hardware video decoder: none, auto (VAAPI) or an FFmpeg "
+               "device type (default: none)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "log-sync", &log_sync,
+                "write log messages before the logging call returns instead "
+                "of on the background log thread",
+                NULL, 0, 0),
+    OPT_GROUP("Benchmark options"),
+    OPT_BOOLEAN(0, "benchmark", NULL,
+                "benchmark mode, measures frame times with v-sync disabled and "
+                "exits",
+                NULL, 0, 0),
+    OPT_INTEGER(0, "benchmark-warmup", NULL,
+                "number of warm-up frames (default: 60)", NULL, 0, 0),
+    OPT_INTEGER(0, "benchmark-frames", NULL,
+                "number of measured frames (default: 600)", NULL, 0, 0),
+    OPT_STRING(0, "benchmark-output", NULL,
+               "report file, .csv for CSV otherwise JSON (default: stdout)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "deterministic", NULL,
+                "fixed frame time of 1/60 s and seeded random numbers, every "
+                "run renders the same frames",
+                NULL, 0, 0),
+    OPT_INTEGER(0, "seed", NULL,
+                "random seed of deterministic runs (default: 1)", NULL, 0, 0),
+    OPT_STRING(0, "camera-record", NULL,
+               "record the camera of every frame to a camera path file", NULL,
+               0, 0),
+    OPT_STRING(0, "camera-replay", NULL,
+               "replay the camera of a recorded camera path file", NULL, 0, 0),
+    OPT_STRING(0, "trace", NULL,
+               "write a CPU and GPU timeline in Chrome trace JSON", NULL, 0,
+               0),
+    OPT_GROUP("Run options"),
+    OPT_BOOLEAN(0, "headless", NULL,
+                "render offscreen without window and swap chain", NULL, 0, 0),
+    OPT_INTEGER(0, "frames", NULL,
+                "number of rendered frames, 0 = until the window is closed "
+                "(default: 0)",
+                NULL, 0, 0),
+    OPT_INTEGER(0, "simulation-steps", NULL,
+                "simulation steps per frame of compute examples (default: 1)",
+                NULL, 0, 0),
+    OPT_FLOAT(0, "simulation-rate", NULL,
+              "fixed timestep simulation steps per second, overrides "
+              "--simulation-steps (default: 0)",
+              NULL, 0, 0),
+    OPT_BOOLEAN(0, "low-latency-input", NULL,
+                "apply the camera input before rendering the frame", NULL, 0,
+                0),
+    OPT_BOOLEAN(0, "on-demand", NULL,
+                "render only when input arrives or the example animates",
+                NULL, 0, 0),
+    OPT_FLOAT(0, "max-fps", NULL,
+              "target frame rate of the frame limiter, 0 = unlimited "
+              "(default: 0)",
+              NULL, 0, 0),
+    OPT_GROUP("WebGPU options"),
+    OPT_STRING(0, "validation", NULL,
+               "backend validation level: off, partial or full (default: full "
+               "in debug builds, off in release builds)",
+               NULL, 0, 0),
+    OPT_INTEGER(0, "frames-in-flight", NULL,
+                "max number of frames the CPU can queue ahead of the GPU, 1-3 "
+                "(default: 2)",
+                NULL, 0, 0),
+    OPT_STRING(0, "adapter", NULL,
+               "adapter index, vendor (nvidia, amd, intel, 0x10de) or part of "
+               "the adapter name (default: by power preference)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "low-power", NULL, "prefer integrated over discrete GPUs",
+                NULL, 0, 0),
+    OPT_BOOLEAN(0, "list-adapters", &list_adapters,
+                "list the adapters with their limits and exit", NULL, 0, 0),
+    OPT_STRING(0, "pipeline-cache", NULL,
+               "backend pipeline cache directory, empty to disable (default: "
+               "pipeline_cache)",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "gpu-markers", NULL,
+                "debug groups around the passes for external GPU profilers",
+                NULL, 0, 0),
+    OPT_BOOLEAN(0, "watch-shaders", NULL,
+                "reload shader files when they change and recreate their "
+                "pipelines (Linux only)",
+                NULL, 0, 0),
     OPT_END(),
   };
 
@@ -33,15 +139,44 @@ int main(int argc, char* argv[])
     "wgpu_sample_launcher [options]",
     NULL,
   };
-  argparse_init(&argparse, options, usages, 0);
+  // Options of the examples are passed through, they are parsed by the example
+  // base and the example
+  argparse_init(&argparse, options, usages, ARGPARSE_IGNORE_UNKNOWN_ARGS);
   argparse_describe(
     &argparse, "\nWebGPU Native examples and demos launcher.",
     "\nThis command-line application launches WebGPU Native examples and "
-    "provides several options to configure their run-time behavior.");
-  char** argv_cpy   = argv_copy(argc, argv);
-  int argparse_argc = argparse_parse(&argparse, argc, (const char**)argv_cpy);
+    "provides several options to configure their run-time behavior. Other "
+    "options are passed to the sample, samples with own options list them "
+    "with their help option (e.g. --help-n-body).");
+  char** argv_cpy = argv_copy(argc, argv);
+  argparse_parse(&argparse, argc, (const char**)argv_cpy);
   free(argv_cpy);
 
+  // Log messages are written on a background thread, logging in the render
+  // loop does not wait for the terminal
+  log_set_async(log_sync == 0);
+
+  // Mount the asset archive, loose files in the assets directory are still
+  // used for paths that are not archived
+  if (asset_archive != NULL || file_exists("assets/assets.pak")) {
+    const char* filename = asset_archive ? asset_archive : "assets/assets.pak";
+    const int error      = file_archive_mount(filename);
+    if (error != 0) {
+      fprintf(stderr, "Could not mount asset archive %s: %s\n", filename,
+              strerror(error));
+    }
+  }
+
+  if (video_hwaccel != NULL && set_video_hwaccel(video_hwaccel) != 0) {
+    fprintf(stderr, "Invalid video hwaccel: %s\n", video_hwaccel);
+  }
+
+  // Lists the adapters without launching a sample
+  if (list_adapters != 0) {
+    example_list_adapters();
+    return EXIT_SUCCESS;
+  }
+
   if (argc == 0) {
     examplecase_t* example = get_random_example();
     printf("Randomly selected example: %s\n", example->example_name);
@@ -63,15 +198,16 @@ int main(int argc, char* argv[])
     examplecase_t* examples = get_examples();
     uint32_t example_count  = get_number_of_examples();
     printf("Running demo mode, found %d examples\n", example_count);
-    for (uint32_t i = 0; i < example_count; ++i) {
+    example_demo_begin(&(example_demo_settings_t){
+      .frame_count      = (uint32_t)MAX(0, demo_frames),
+      .duration_seconds = (float)demo_duration,
+      .output_file      = demo_output,
+    });
+    for (uint32_t i = 0; i < example_count && !example_demo_aborted(); ++i) {
       printf("Running example: %s\n", examples[i].example_name);
+      examples[i].example_func(argc, argv);
     }
-  }
-  if (argparse_argc != 0) {
-    printf("argc: %d\n", argparse_argc);
-    for (int32_t i = 0; i < argparse_argc; ++i) {
-      printf("argv[%d]: %s\n", i, *(argv + i));
-    }
+    example_demo_end();
   }
 
   return EXIT_SUCCESS;
@@ -2,6 +2,7 @@
 
 #include "../core/macro.h"
 
+#include <errno.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
@@ -65,3 +66,22 @@ float platform_get_time(void)
   }
   return (float)(get_native_time() - initial);
 }
+
+uint64_t platform_get_time_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void platform_sleep_until_ns(uint64_t deadline_ns)
+{
+  const struct timespec ts = {
+    .tv_sec  = (time_t)(deadline_ns / 1000000000ull),
+    .tv_nsec = (long)(deadline_ns % 1000000000ull),
+  };
+  /* Absolute deadline, a signal interruption resumes the same sleep */
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+         == EINTR) {
+  }
+}
@@ -0,0 +1,271 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../core/asset_archive.h"
+
+/* -------------------------------------------------------------------------- *
+ * wgpu_asset_packer
+ *
+ * Packs the files of the assets directory into a single archive, see
+ * src/core/asset_archive.h for the format. Archives (*.pak) inside the
+ * directory are skipped.
+ *
+ * Usage: wgpu_asset_packer <assets directory> <archive>
+ * -------------------------------------------------------------------------- */
+
+#define PACKER_PATH_SIZE 4096u
+
+typedef struct packer_file_t {
+  char* path; /* relative to the assets directory */
+  uint64_t hash;
+  uint64_t size;
+} packer_file_t;
+
+typedef struct packer_file_list_t {
+  packer_file_t* files;
+  uint32_t count;
+  uint32_t capacity;
+} packer_file_list_t;
+
+static int has_extension(const char* filename, const char* extension)
+{
+  const char* dot = strrchr(filename, '.');
+  return dot != NULL && strcmp(dot + 1, extension) == 0;
+}
+
+static void file_list_add(packer_file_list_t* list, const char* path,
+                          uint64_t size)
+{
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 256u;
+    list->files    = (packer_file_t*)realloc(
+      list->files, list->capacity * sizeof(packer_file_t));
+  }
+  const size_t length = strlen(path);
+  packer_file_t* file = &list->files[list->count++];
+  file->path          = (char*)malloc(length + 1);
+  memcpy(file->path, path, length + 1);
+  file->hash = asset_archive_hash_path(file->path);
+  file->size = size;
+}
+
+/* Adds the regular files below 'directory' recursively */
+static int collect_files(const char* root, const char* directory,
+                         packer_file_list_t* list)
+{
+  char path[PACKER_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s%s%s", root, directory[0] ? "/" : "",
+           directory);
+  DIR* dir = opendir(path);
+  if (dir == NULL) {
+    fprintf(stderr, "Unable to open directory '%s': %s\n", path,
+            strerror(errno));
+    return 1;
+  }
+
+  int result = 0;
+  struct dirent* dirent;
+  while (result == 0 && (dirent = readdir(dir)) != NULL) {
+    if (dirent->d_name[0] == '.') {
+      continue;
+    }
+    char relative_path[PACKER_PATH_SIZE];
+    snprintf(relative_path, sizeof(relative_path), "%s%s%s", directory,
+             directory[0] ? "/" : "", dirent->d_name);
+    const int length
+      = snprintf(path, sizeof(path), "%s/%s", root, relative_path);
+
+    struct stat st;
+    if (length < 0 || (size_t)length >= sizeof(path)) {
+      fprintf(stderr, "Path too long: '%s/%s'\n", root, relative_path);
+      result = 1;
+    }
+    else if (stat(path, &st) != 0) {
+      fprintf(stderr, "Unable to stat '%s': %s\n", path, strerror(errno));
+      result = 1;
+    }
+    else if (S_ISDIR(st.st_mode)) {
+      result = collect_files(root, relative_path, list);
+    }
+    else if (S_ISREG(st.st_mode) && !has_extension(dirent->d_name, "pak")) {
+      file_list_add(list, relative_path, (uint64_t)st.st_size);
+    }
+  }
+  closedir(dir);
+  return result;
+}
+
+static int compare_files(const void* a, const void* b)
+{
+  const packer_file_t* file_a = (const packer_file_t*)a;
+  const packer_file_t* file_b = (const packer_file_t*)b;
+  if (file_a->hash != file_b->hash) {
+    return file_a->hash < file_b->hash ? -1 : 1;
+  }
+  return strcmp(file_a->path, file_b->path);
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/* Writes zero bytes up to the offset */
+static int write_padding(FILE* file, uint64_t* position, uint64_t offset)
+{
+  static const uint8_t zeros[ASSET_ARCHIVE_ALIGNMENT] = {0};
+  while (*position < offset) {
+    const size_t count = (size_t)(offset - *position) < sizeof(zeros) ?
+                           (size_t)(offset - *position) :
+                           sizeof(zeros);
+    if (fwrite(zeros, 1, count, file) != count) {
+      return 1;
+    }
+    *position += count;
+  }
+  return 0;
+}
+
+/* Copies the file payload into the archive */
+static int write_payload(FILE* file, const char* root,
+                         const packer_file_t* packer_file)
+{
+  char path[PACKER_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s", root, packer_file->path);
+  FILE* source = fopen(path, "rb");
+  if (source == NULL) {
+    fprintf(stderr, "Unable to open '%s': %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  uint8_t buffer[65536];
+  uint64_t remaining = packer_file->size;
+  while (remaining > 0) {
+    const size_t count
+      = fread(buffer, 1,
+              remaining < sizeof(buffer) ? (size_t)remaining : sizeof(buffer),
+              source);
+    if (count == 0 || fwrite(buffer, 1, count, file) != count) {
+      fprintf(stderr, "Unable to copy '%s'\n", path);
+      fclose(source);
+      return 1;
+    }
+    remaining -= count;
+  }
+  fclose(source);
+  return 0;
+}
+
+static int write_archive(const char* root, const char* filename,
+                         const packer_file_list_t* list)
+{
+  // Index and path table
+  asset_archive_entry_t* entries
+    = (asset_archive_entry_t*)calloc(list->count, sizeof(*entries));
+  uint64_t path_table_size = 0;
+  for (uint32_t i = 0; i < list->count; ++i) {
+    path_table_size += strlen(list->files[i].path) + 1;
+  }
+  const uint64_t path_table_offset
+    = sizeof(asset_archive_header_t)
+      + (uint64_t)list->count * sizeof(asset_archive_entry_t);
+  char* path_table = (char*)malloc(path_table_size ? path_table_size : 1);
+
+  uint64_t path_offset = 0;
+  uint64_t offset
+    = align_up(path_table_offset + path_table_size, ASSET_ARCHIVE_ALIGNMENT);
+  for (uint32_t i = 0; i < list->count; ++i) {
+    const packer_file_t* file = &list->files[i];
+    const size_t length       = strlen(file->path);
+    memcpy(path_table + path_offset, file->path, length + 1);
+    entries[i] = (asset_archive_entry_t){
+      .path_hash   = file->hash,
+      .offset      = offset,
+      .size        = file->size,
+      .stored_size = file->size,
+      .path_offset = (uint32_t)path_offset,
+      .path_length = (uint32_t)length,
+      .compression = AssetArchiveCompression_None,
+    };
+    path_offset += length + 1;
+    offset = align_up(offset + file->size, ASSET_ARCHIVE_ALIGNMENT);
+  }
+
+  const asset_archive_header_t header = {
+    .magic             = ASSET_ARCHIVE_MAGIC,
+    .version           = ASSET_ARCHIVE_VERSION,
+    .entry_count       = list->count,
+    .alignment         = ASSET_ARCHIVE_ALIGNMENT,
+    .path_table_offset = path_table_offset,
+    .path_table_size   = path_table_size,
+  };
+
+  int result = 1;
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to create '%s': %s\n", filename, strerror(errno));
+  }
+  else if (fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(entries, sizeof(*entries), list->count, file)
+                == list->count
+           && fwrite(path_table, 1, (size_t)path_table_size, file)
+                == path_table_size) {
+    uint64_t position = path_table_offset + path_table_size;
+    result            = 0;
+    for (uint32_t i = 0; result == 0 && i < list->count; ++i) {
+      result = write_padding(file, &position, entries[i].offset)
+               || write_payload(file, root, &list->files[i]);
+      position += list->files[i].size;
+    }
+    result = result || write_padding(file, &position, offset);
+  }
+  if (file != NULL && fclose(file) != 0) {
+    result = 1;
+  }
+
+  free(path_table);
+  free(entries);
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <assets directory> <archive>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char* root     = argv[1];
+  const char* filename = argv[2];
+
+  packer_file_list_t list = {0};
+  int result              = collect_files(root, "", &list);
+  if (result == 0) {
+    qsort(list.files, list.count, sizeof(packer_file_t), compare_files);
+    // Lookups compare the paths, but distinct paths should not share a hash
+    for (uint32_t i = 1; i < list.count; ++i) {
+      if (list.files[i - 1].hash == list.files[i].hash) {
+        fprintf(stderr, "Warning: '%s' and '%s' have the same path hash\n",
+                list.files[i - 1].path, list.files[i].path);
+      }
+    }
+    result = write_archive(root, filename, &list);
+  }
+  if (result == 0) {
+    uint64_t total_size = 0;
+    for (uint32_t i = 0; i < list.count; ++i) {
+      total_size += list.files[i].size;
+    }
+    printf("Packed %u files (%.1f MiB) into %s\n", list.count,
+           (double)total_size / (1024.0 * 1024.0), filename);
+  }
+
+  for (uint32_t i = 0; i < list.count; ++i) {
+    free(list.files[i].path);
+  }
+  free(list.files);
+  return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
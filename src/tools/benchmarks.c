@@ -0,0 +1,1055 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/argparse.h"
+#include "../core/benchmark.h"
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/math.h"
+#include "../webgpu/bind_group_cache.h"
+#include "../webgpu/buffer.h"
+#include "../webgpu/context.h"
+#include "../webgpu/random_fill.h"
+#include "../webgpu/shader.h"
+#include "../webgpu/upload_ring.h"
+#include "../webgpu/write_combiner.h"
+
+/* -------------------------------------------------------------------------- *
+ * wgpu_benchmarks
+ *
+ * Headless microbenchmarks of the core WebGPU operations used by the
+ * examples, run on a wgpu_context_t without window and swap chain:
+ *
+ *   - buffer uploads: wgpuQueueWriteBuffer with and without the write
+ *     combiner, mapped at creation, a copy from the staging pool and the
+ *     upload ring, from 256 bytes to 16 MiB
+ *   - texture uploads: wgpuQueueWriteTexture of a 1024x1024 texture per format
+ *   - object creation: render / compute pipelines and bind groups, uncached
+ *     and through the bind group cache
+ *   - draw call submission: draws with a dynamic offset bind group each
+ *   - compute dispatch overhead: dispatches of a single workgroup
+ *   - random fills: 16 MiB of random vec4 values generated on the GPU per
+ *     distribution, compared to random_float() and a queue write
+ *
+ * Every case runs its iterations per sample, the samples include the wait
+ * for the GPU to finish the submitted work. After the warm-up samples the
+ * median, mean, relative standard deviation and 95th percentile of the time
+ * per iteration are reported, the throughput is derived from the median.
+ *
+ * Usage: wgpu_benchmarks [--samples=<n>] [--warmup=<n>] [--filter=<text>]
+ *                        [--output=<file.csv>] [--adapter=<adapter>]
+ * -------------------------------------------------------------------------- */
+
+#define BENCH_MAX_CASES 64u
+#define BENCH_MAX_UPLOAD_SIZE (16u * 1024u * 1024u)
+#define BENCH_TEXTURE_SIZE 1024u
+#define BENCH_DRAW_COUNT 10000u
+#define BENCH_DISPATCH_COUNT 1000u
+/* vec4 elements of the random fills, 16 MiB */
+#define BENCH_RANDOM_FILL_COUNT (1024u * 1024u)
+/* Dynamic offset alignment of the draw call bind group */
+#define BENCH_UNIFORM_STRIDE 256u
+#define BENCH_UNIFORM_SLOTS 64u
+
+// clang-format off
+static const char* bench_render_shader_wgsl = CODE(
+  @group(0) @binding(0) var<uniform> color : vec4<f32>;
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertex_index : u32)
+    -> @builtin(position) vec4<f32> {
+    let uv = vec2<f32>(f32((vertex_index << 1u) & 2u), f32(vertex_index & 2u));
+    return vec4<f32>(uv * 0.01 - vec2<f32>(1.0), 0.0, 1.0);
+  }
+
+  @fragment
+  fn fs_main() -> @location(0) vec4<f32> {
+    return color;
+  }
+);
+
+static const char* bench_compute_shader_wgsl = CODE(
+  @group(0) @binding(0) var<storage, read_write> data : array<u32>;
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    data[id.x] = data[id.x] + 1u;
+  }
+);
+// clang-format on
+
+typedef struct bench_case_t bench_case_t;
+
+/* Runs the iterations of one sample, false if the case is not supported */
+typedef bool (*bench_run_func_t)(bench_case_t* bench_case);
+
+struct bench_case_t {
+  const char* group;
+  char name[64];
+  /* Iterations per sample */
+  uint32_t iterations;
+  /* Bytes or operations per iteration for the throughput, 0 = none */
+  uint64_t bytes;
+  uint64_t ops;
+  bench_run_func_t run;
+  /* Parameters */
+  uint64_t size;
+  WGPUTextureFormat format;
+  uint32_t bytes_per_texel;
+  wgpu_random_distribution_enum_t distribution;
+};
+
+typedef struct bench_result_t {
+  const bench_case_t* bench_case;
+  bool supported;
+  /* Milliseconds per iteration */
+  benchmark_statistics_t stats;
+} bench_result_t;
+
+/* Benchmark state */
+static struct {
+  wgpu_context_t* wgpu_context;
+  uint8_t* data;
+  WGPUBuffer upload_buffer;
+  uint64_t upload_buffer_size;
+  WGPUTexture texture;
+  WGPUTextureFormat texture_format;
+  /* Draw call and dispatch resources */
+  WGPUShaderModule render_module;
+  WGPUShaderModule compute_module;
+  WGPUBindGroupLayout uniform_layout;
+  WGPUBindGroupLayout storage_layout;
+  WGPUPipelineLayout render_layout;
+  WGPUPipelineLayout compute_layout;
+  WGPURenderPipeline render_pipeline;
+  WGPUComputePipeline compute_pipeline;
+  WGPUBuffer uniform_buffer;
+  WGPUBuffer storage_buffer;
+  WGPUBindGroup uniform_bind_group;
+  WGPUBindGroup storage_bind_group;
+  WGPUTexture render_target;
+  WGPUTextureView render_target_view;
+  /* Random fill resources */
+  wgpu_random_fill_t* random_fill;
+  WGPUBuffer random_fill_buffer;
+  texture_t random_fill_texture;
+} bench = {0};
+
+static double get_time_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* GPU synchronization */
+
+static void queue_work_done_cb(WGPUQueueWorkDoneStatus status, void* user_data)
+{
+  UNUSED_VAR(status);
+  *(bool*)user_data = true;
+}
+
+/* Waits until the GPU finished all submitted work */
+static void wait_for_queue(void)
+{
+  bool done = false;
+  wgpuQueueOnSubmittedWorkDone(bench.wgpu_context->queue, 0,
+                               queue_work_done_cb, &done);
+  while (!done) {
+    wgpuDeviceTick(bench.wgpu_context->device);
+  }
+}
+
+/* Buffer uploads */
+
+static void ensure_upload_buffer(uint64_t size)
+{
+  if (bench.upload_buffer != NULL && bench.upload_buffer_size == size) {
+    return;
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, bench.upload_buffer)
+  bench.upload_buffer_size = size;
+  bench.upload_buffer = wgpuDeviceCreateBuffer(
+    bench.wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Benchmark upload buffer",
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+      .size  = size,
+    });
+  ASSERT(bench.upload_buffer != NULL);
+}
+
+static bool run_queue_write_buffer(bench_case_t* bench_case)
+{
+  ensure_upload_buffer(bench_case->size);
+  wgpu_write_combiner_set_enabled(bench.wgpu_context->write_combiner, false);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    wgpuQueueWriteBuffer(bench.wgpu_context->queue, bench.upload_buffer, 0,
+                         bench.data, bench_case->size);
+  }
+  wait_for_queue();
+  wgpu_write_combiner_set_enabled(bench.wgpu_context->write_combiner, true);
+  return true;
+}
+
+/* Queue writes of the same range, merged into one upload ring copy (writes
+ * above WGPU_WRITE_COMBINER_MAX_WRITE_SIZE go to the queue) */
+static bool run_write_combiner(bench_case_t* bench_case)
+{
+  ensure_upload_buffer(bench_case->size);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    wgpuQueueWriteBuffer(bench.wgpu_context->queue, bench.upload_buffer, 0,
+                         bench.data, bench_case->size);
+  }
+  wait_for_queue();
+  return true;
+}
+
+/* Uploads into a new buffer each iteration, the creation is part of the
+ * cost */
+static bool run_mapped_at_creation(bench_case_t* bench_case)
+{
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+      bench.wgpu_context->device, &(WGPUBufferDescriptor){
+                                    .label = "Benchmark mapped buffer",
+                                    .usage = WGPUBufferUsage_Vertex,
+                                    .size  = bench_case->size,
+                                    .mappedAtCreation = true,
+                                  });
+    memcpy(wgpuBufferGetMappedRange(buffer, 0, bench_case->size), bench.data,
+           bench_case->size);
+    wgpuBufferUnmap(buffer);
+    WGPU_RELEASE_RESOURCE(Buffer, buffer)
+  }
+  wait_for_queue();
+  return true;
+}
+
+static bool run_staging_copy(bench_case_t* bench_case)
+{
+  wgpu_context_t* wgpu_context = bench.wgpu_context;
+  if (wgpu_context->staging_pool == NULL) {
+    wgpu_context->staging_pool = wgpu_staging_pool_create(wgpu_context);
+  }
+  ensure_upload_buffer(bench_case->size);
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    void* mapping      = NULL;
+    WGPUBuffer staging = wgpu_staging_pool_acquire(
+      wgpu_context->staging_pool, bench_case->size, &mapping);
+    memcpy(mapping, bench.data, bench_case->size);
+    wgpuBufferUnmap(staging);
+    wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, staging, 0,
+                                         bench.upload_buffer, 0,
+                                         bench_case->size);
+  }
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  wgpu_staging_pool_end_frame(wgpu_context->staging_pool);
+  wait_for_queue();
+  return true;
+}
+
+static bool run_upload_ring(bench_case_t* bench_case)
+{
+  ensure_upload_buffer(bench_case->size);
+  bool supported = true;
+  for (uint32_t i = 0; supported && i < bench_case->iterations; ++i) {
+    supported = wgpu_upload_ring_write_buffer(
+      bench.wgpu_context->upload_ring, bench.upload_buffer, 0, bench.data,
+      bench_case->size);
+  }
+  wgpu_upload_ring_flush(bench.wgpu_context->upload_ring);
+  wait_for_queue();
+  return supported;
+}
+
+/* Texture uploads */
+
+static bool run_queue_write_texture(bench_case_t* bench_case)
+{
+  if (bench.texture == NULL || bench.texture_format != bench_case->format) {
+    WGPU_RELEASE_RESOURCE(Texture, bench.texture)
+    bench.texture_format = bench_case->format;
+    WGPUTextureDescriptor texture_desc = {
+      .label         = "Benchmark upload texture",
+      .usage         = WGPUTextureUsage_CopyDst
+               | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D) {
+        .width              = BENCH_TEXTURE_SIZE,
+        .height             = BENCH_TEXTURE_SIZE,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = bench_case->format,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    };
+    bench.texture
+      = wgpuDeviceCreateTexture(bench.wgpu_context->device, &texture_desc);
+    ASSERT(bench.texture != NULL);
+  }
+
+  const uint32_t bytes_per_row
+    = BENCH_TEXTURE_SIZE * bench_case->bytes_per_texel;
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    wgpuQueueWriteTexture(bench.wgpu_context->queue,
+      &(WGPUImageCopyTexture) {
+        .texture  = bench.texture,
+        .mipLevel = 0,
+        .aspect   = WGPUTextureAspect_All,
+      },
+      bench.data, bench_case->bytes,
+      &(WGPUTextureDataLayout){
+        .offset       = 0,
+        .bytesPerRow  = bytes_per_row,
+        .rowsPerImage = BENCH_TEXTURE_SIZE,
+      },
+      &(WGPUExtent3D){
+        .width              = BENCH_TEXTURE_SIZE,
+        .height             = BENCH_TEXTURE_SIZE,
+        .depthOrArrayLayers = 1,
+      });
+  }
+  wait_for_queue();
+  return true;
+}
+
+/* Object creation */
+
+static WGPURenderPipeline create_render_pipeline(void)
+{
+  WGPUBlendState blend_state = wgpu_create_blend_state(false);
+  return wgpuDeviceCreateRenderPipeline(
+    bench.wgpu_context->device,
+    &(WGPURenderPipelineDescriptor){
+      .label  = "Benchmark render pipeline",
+      .layout = bench.render_layout,
+      .vertex = (WGPUVertexState){
+        .module     = bench.render_module,
+        .entryPoint = "vs_main",
+      },
+      .primitive = (WGPUPrimitiveState){
+        .topology  = WGPUPrimitiveTopology_TriangleList,
+        .frontFace = WGPUFrontFace_CCW,
+        .cullMode  = WGPUCullMode_None,
+      },
+      .multisample = (WGPUMultisampleState){
+        .count = 1,
+        .mask  = 0xFFFFFFFF,
+      },
+      .fragment = &(WGPUFragmentState){
+        .module      = bench.render_module,
+        .entryPoint  = "fs_main",
+        .targetCount = 1,
+        .targets     = &(WGPUColorTargetState){
+          .format    = WGPUTextureFormat_RGBA8Unorm,
+          .blend     = &blend_state,
+          .writeMask = WGPUColorWriteMask_All,
+        },
+      },
+    });
+}
+
+static WGPUComputePipeline create_compute_pipeline(void)
+{
+  return wgpuDeviceCreateComputePipeline(
+    bench.wgpu_context->device, &(WGPUComputePipelineDescriptor){
+                                  .label   = "Benchmark compute pipeline",
+                                  .layout  = bench.compute_layout,
+                                  .compute = (WGPUProgrammableStageDescriptor){
+                                    .module     = bench.compute_module,
+                                    .entryPoint = "main",
+                                  },
+                                });
+}
+
+/* The pipelines are released right away, Dawn does not deduplicate them with
+ * a previously released pipeline */
+static bool run_render_pipeline_creation(bench_case_t* bench_case)
+{
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    WGPURenderPipeline pipeline = create_render_pipeline();
+    ASSERT(pipeline != NULL);
+    WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
+  }
+  return true;
+}
+
+static bool run_compute_pipeline_creation(bench_case_t* bench_case)
+{
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    WGPUComputePipeline pipeline = create_compute_pipeline();
+    ASSERT(pipeline != NULL);
+    WGPU_RELEASE_RESOURCE(ComputePipeline, pipeline)
+  }
+  return true;
+}
+
+static WGPUBindGroupDescriptor
+get_uniform_bind_group_desc(WGPUBindGroupEntry* entry)
+{
+  *entry = (WGPUBindGroupEntry){
+    .binding = 0,
+    .buffer  = bench.uniform_buffer,
+    .size    = 16,
+  };
+  return (WGPUBindGroupDescriptor){
+    .label      = "Benchmark bind group",
+    .layout     = bench.uniform_layout,
+    .entryCount = 1,
+    .entries    = entry,
+  };
+}
+
+static bool run_bind_group_creation(bench_case_t* bench_case)
+{
+  WGPUBindGroupEntry entry;
+  const WGPUBindGroupDescriptor desc = get_uniform_bind_group_desc(&entry);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    WGPUBindGroup bind_group
+      = wgpuDeviceCreateBindGroup(bench.wgpu_context->device, &desc);
+    ASSERT(bind_group != NULL);
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  }
+  return true;
+}
+
+static bool run_bind_group_cache(bench_case_t* bench_case)
+{
+  WGPUBindGroupEntry entry;
+  const WGPUBindGroupDescriptor desc = get_uniform_bind_group_desc(&entry);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    WGPUBindGroup bind_group
+      = wgpu_create_bind_group(bench.wgpu_context, &desc);
+    ASSERT(bind_group != NULL);
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  }
+  return true;
+}
+
+/* Draw call submission and dispatch overhead */
+
+static bool run_draw_calls(bench_case_t* bench_case)
+{
+  wgpu_context_t* wgpu_context = bench.wgpu_context;
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .colorAttachmentCount = 1,
+               .colorAttachments = &(WGPURenderPassColorAttachment){
+                 .view       = bench.render_target_view,
+                 .loadOp     = WGPULoadOp_Clear,
+                 .storeOp    = WGPUStoreOp_Store,
+                 .clearColor = (WGPUColor){0.0, 0.0, 0.0, 1.0},
+               },
+             });
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, bench.render_pipeline);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    const uint32_t dynamic_offset
+      = (i % BENCH_UNIFORM_SLOTS) * BENCH_UNIFORM_STRIDE;
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bench.uniform_bind_group,
+                                      1, &dynamic_offset);
+    wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+  }
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  wait_for_queue();
+  return true;
+}
+
+static bool run_dispatches(bench_case_t* bench_case)
+{
+  wgpu_context_t* wgpu_context = bench.wgpu_context;
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, bench.compute_pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bench.storage_bind_group, 0,
+                                     NULL);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  wait_for_queue();
+  return true;
+}
+
+/* Random fills */
+
+static bool run_gpu_random_fill(bench_case_t* bench_case)
+{
+  wgpu_context_t* wgpu_context = bench.wgpu_context;
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    const wgpu_random_fill_desc_t desc = {
+      .distribution = bench_case->distribution,
+      .seed         = i,
+      .min          = 0.0f,
+      .max          = 1.0f,
+      .mean         = 0.0f,
+      .std_dev      = 1.0f,
+      .radius       = 1.0f,
+      .components   = 4,
+    };
+    if (bench_case->format != WGPUTextureFormat_Undefined) {
+      wgpu_random_fill_texture(bench.random_fill, cmd_enc,
+                               &bench.random_fill_texture, &desc);
+    }
+    else {
+      wgpu_random_fill_buffer(bench.random_fill, cmd_enc,
+                              bench.random_fill_buffer,
+                              BENCH_RANDOM_FILL_COUNT, &desc);
+    }
+  }
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  wait_for_queue();
+  return true;
+}
+
+/* The CPU initialization the GPU fills replace */
+static bool run_cpu_random_fill(bench_case_t* bench_case)
+{
+  float* values        = (float*)bench.data;
+  const uint32_t count = BENCH_RANDOM_FILL_COUNT * 4u;
+  for (uint32_t i = 0; i < bench_case->iterations; ++i) {
+    for (uint32_t j = 0; j < count; ++j) {
+      values[j] = random_float();
+    }
+    wgpuQueueWriteBuffer(bench.wgpu_context->queue, bench.random_fill_buffer,
+                         0, values, (size_t)count * sizeof(float));
+  }
+  wait_for_queue();
+  return true;
+}
+
+/* Benchmark resources */
+
+static void prepare_resources(void)
+{
+  wgpu_context_t* wgpu_context = bench.wgpu_context;
+  WGPUDevice device            = wgpu_context->device;
+
+  // Source data of the uploads
+  bench.data = (uint8_t*)malloc(
+    MAX(BENCH_MAX_UPLOAD_SIZE, BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE * 16u));
+  for (uint32_t i = 0; i < BENCH_MAX_UPLOAD_SIZE; ++i) {
+    bench.data[i] = (uint8_t)(i * 31u);
+  }
+
+  bench.render_module
+    = wgpu_create_shader_module_from_wgsl(device, bench_render_shader_wgsl);
+  bench.compute_module
+    = wgpu_create_shader_module_from_wgsl(device, bench_compute_shader_wgsl);
+  ASSERT(bench.render_module != NULL && bench.compute_module != NULL);
+
+  bench.uniform_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Benchmark uniform bind group layout",
+              .entryCount = 1,
+              .entries = &(WGPUBindGroupLayoutEntry){
+                .binding    = 0,
+                .visibility = WGPUShaderStage_Fragment,
+                .buffer = (WGPUBufferBindingLayout){
+                  .type             = WGPUBufferBindingType_Uniform,
+                  .hasDynamicOffset = true,
+                  .minBindingSize   = 16,
+                },
+              },
+            });
+  bench.storage_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Benchmark storage bind group layout",
+              .entryCount = 1,
+              .entries = &(WGPUBindGroupLayoutEntry){
+                .binding    = 0,
+                .visibility = WGPUShaderStage_Compute,
+                .buffer = (WGPUBufferBindingLayout){
+                  .type           = WGPUBufferBindingType_Storage,
+                  .minBindingSize = 64 * sizeof(uint32_t),
+                },
+              },
+            });
+  bench.render_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Benchmark render pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &bench.uniform_layout,
+            });
+  bench.compute_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Benchmark compute pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &bench.storage_layout,
+            });
+  bench.render_pipeline  = create_render_pipeline();
+  bench.compute_pipeline = create_compute_pipeline();
+  ASSERT(bench.render_pipeline != NULL && bench.compute_pipeline != NULL);
+
+  bench.uniform_buffer = wgpuDeviceCreateBuffer(
+    device, &(WGPUBufferDescriptor){
+              .label = "Benchmark uniform buffer",
+              .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+              .size  = BENCH_UNIFORM_SLOTS * BENCH_UNIFORM_STRIDE,
+            });
+  bench.storage_buffer = wgpuDeviceCreateBuffer(
+    device, &(WGPUBufferDescriptor){
+              .label = "Benchmark storage buffer",
+              .usage = WGPUBufferUsage_Storage,
+              .size  = 64 * sizeof(uint32_t),
+            });
+
+  WGPUBindGroupEntry entry;
+  const WGPUBindGroupDescriptor desc = get_uniform_bind_group_desc(&entry);
+  bench.uniform_bind_group           = wgpuDeviceCreateBindGroup(device, &desc);
+  bench.storage_bind_group           = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Benchmark storage bind group",
+              .layout     = bench.storage_layout,
+              .entryCount = 1,
+              .entries    = &(WGPUBindGroupEntry){
+                .binding = 0,
+                .buffer  = bench.storage_buffer,
+                .size    = 64 * sizeof(uint32_t),
+              },
+            });
+
+  bench.render_target = wgpuDeviceCreateTexture(
+    device, &(WGPUTextureDescriptor){
+              .label         = "Benchmark render target",
+              .usage         = WGPUTextureUsage_RenderAttachment,
+              .dimension     = WGPUTextureDimension_2D,
+              .size          = (WGPUExtent3D){
+                .width              = 256,
+                .height             = 256,
+                .depthOrArrayLayers = 1,
+              },
+              .format        = WGPUTextureFormat_RGBA8Unorm,
+              .mipLevelCount = 1,
+              .sampleCount   = 1,
+            });
+  bench.render_target_view = wgpuTextureCreateView(bench.render_target, NULL);
+
+  bench.random_fill        = wgpu_random_fill_create(wgpu_context);
+  bench.random_fill_buffer = wgpuDeviceCreateBuffer(
+    device, &(WGPUBufferDescriptor){
+              .label = "Benchmark random fill buffer",
+              .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+              .size  = (uint64_t)BENCH_RANDOM_FILL_COUNT * 4 * sizeof(float),
+            });
+  bench.random_fill_texture = (texture_t){
+    .size = {
+      .width  = BENCH_TEXTURE_SIZE,
+      .height = BENCH_TEXTURE_SIZE,
+      .depth  = 1,
+    },
+    .mip_level_count = 1,
+    .format          = WGPUTextureFormat_RGBA32Float,
+    .dimension       = WGPUTextureDimension_2D,
+  };
+  bench.random_fill_texture.texture = wgpuDeviceCreateTexture(
+    device, &(WGPUTextureDescriptor){
+              .label         = "Benchmark random fill texture",
+              .usage         = WGPUTextureUsage_StorageBinding,
+              .dimension     = WGPUTextureDimension_2D,
+              .size          = (WGPUExtent3D){
+                .width              = BENCH_TEXTURE_SIZE,
+                .height             = BENCH_TEXTURE_SIZE,
+                .depthOrArrayLayers = 1,
+              },
+              .format        = WGPUTextureFormat_RGBA32Float,
+              .mipLevelCount = 1,
+              .sampleCount   = 1,
+            });
+}
+
+static void release_resources(void)
+{
+  WGPU_RELEASE_RESOURCE(Texture, bench.random_fill_texture.texture)
+  WGPU_RELEASE_RESOURCE(Buffer, bench.random_fill_buffer)
+  wgpu_random_fill_destroy(bench.random_fill);
+  WGPU_RELEASE_RESOURCE(TextureView, bench.render_target_view)
+  WGPU_RELEASE_RESOURCE(Texture, bench.render_target)
+  WGPU_RELEASE_RESOURCE(Texture, bench.texture)
+  WGPU_RELEASE_RESOURCE(BindGroup, bench.uniform_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, bench.storage_bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, bench.uniform_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, bench.storage_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, bench.upload_buffer)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, bench.render_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, bench.compute_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, bench.render_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, bench.compute_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bench.uniform_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bench.storage_layout)
+  WGPU_RELEASE_RESOURCE(ShaderModule, bench.render_module)
+  WGPU_RELEASE_RESOURCE(ShaderModule, bench.compute_module)
+  free(bench.data);
+  bench.data = NULL;
+}
+
+/* Benchmark cases */
+
+static uint32_t add_upload_cases(bench_case_t* cases, uint32_t count)
+{
+  static const struct {
+    const char* name;
+    bench_run_func_t run;
+  } methods[5] = {
+    {"queue write", run_queue_write_buffer},
+    {"write combiner", run_write_combiner},
+    {"mapped at creation", run_mapped_at_creation},
+    {"staging pool copy", run_staging_copy},
+    {"upload ring", run_upload_ring},
+  };
+  static const uint64_t sizes[5] = {
+    256u, 4096u, 65536u, 1024u * 1024u, BENCH_MAX_UPLOAD_SIZE,
+  };
+
+  for (uint32_t m = 0; m < (uint32_t)ARRAY_SIZE(methods); ++m) {
+    for (uint32_t s = 0; s < (uint32_t)ARRAY_SIZE(sizes); ++s) {
+      // About 4 MiB per sample, at most 256 uploads
+      const uint64_t iterations
+        = CLAMP((4u * 1024u * 1024u) / sizes[s], 1u, 256u);
+      bench_case_t* bench_case = &cases[count++];
+      *bench_case              = (bench_case_t){
+        .group      = "buffer upload",
+        .iterations = (uint32_t)iterations,
+        .bytes      = sizes[s],
+        .run        = methods[m].run,
+        .size       = sizes[s],
+      };
+      if (sizes[s] < 1024u) {
+        snprintf(bench_case->name, sizeof(bench_case->name), "%s %llu B",
+                 methods[m].name, (unsigned long long)sizes[s]);
+      }
+      else {
+        snprintf(bench_case->name, sizeof(bench_case->name), "%s %llu KiB",
+                 methods[m].name, (unsigned long long)(sizes[s] / 1024u));
+      }
+    }
+  }
+  return count;
+}
+
+static uint32_t add_texture_cases(bench_case_t* cases, uint32_t count)
+{
+  static const struct {
+    const char* name;
+    WGPUTextureFormat format;
+    uint32_t bytes_per_texel;
+  } formats[5] = {
+    {"r8unorm", WGPUTextureFormat_R8Unorm, 1u},
+    {"rgba8unorm", WGPUTextureFormat_RGBA8Unorm, 4u},
+    {"rg16float", WGPUTextureFormat_RG16Float, 4u},
+    {"rgba16float", WGPUTextureFormat_RGBA16Float, 8u},
+    {"rgba32float", WGPUTextureFormat_RGBA32Float, 16u},
+  };
+
+  for (uint32_t f = 0; f < (uint32_t)ARRAY_SIZE(formats); ++f) {
+    bench_case_t* bench_case = &cases[count++];
+    *bench_case              = (bench_case_t){
+      .group           = "texture upload",
+      .iterations      = 4,
+      .bytes           = (uint64_t)BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE
+                * formats[f].bytes_per_texel,
+      .run             = run_queue_write_texture,
+      .format          = formats[f].format,
+      .bytes_per_texel = formats[f].bytes_per_texel,
+    };
+    snprintf(bench_case->name, sizeof(bench_case->name), "queue write %s",
+             formats[f].name);
+  }
+  return count;
+}
+
+static uint32_t add_random_fill_cases(bench_case_t* cases, uint32_t count)
+{
+  static const struct {
+    const char* name;
+    wgpu_random_distribution_enum_t distribution;
+    WGPUTextureFormat format;
+  } fills[5] = {
+    {"gpu uniform", WGPU_RandomDistribution_Uniform,
+     WGPUTextureFormat_Undefined},
+    {"gpu normal", WGPU_RandomDistribution_Normal, WGPUTextureFormat_Undefined},
+    {"gpu in sphere", WGPU_RandomDistribution_InSphere,
+     WGPUTextureFormat_Undefined},
+    {"gpu on sphere", WGPU_RandomDistribution_OnSphere,
+     WGPUTextureFormat_Undefined},
+    {"gpu uniform rgba32float", WGPU_RandomDistribution_Uniform,
+     WGPUTextureFormat_RGBA32Float},
+  };
+
+  const uint64_t bytes = (uint64_t)BENCH_RANDOM_FILL_COUNT * 4 * sizeof(float);
+  for (uint32_t f = 0; f < (uint32_t)ARRAY_SIZE(fills); ++f) {
+    bench_case_t* bench_case = &cases[count++];
+    *bench_case              = (bench_case_t){
+      .group        = "random fill",
+      .iterations   = 8,
+      .bytes        = bytes,
+      .run          = run_gpu_random_fill,
+      .format       = fills[f].format,
+      .distribution = fills[f].distribution,
+    };
+    snprintf(bench_case->name, sizeof(bench_case->name), "%s", fills[f].name);
+  }
+  cases[count++] = (bench_case_t){
+    .group      = "random fill",
+    .name       = "cpu uniform + queue write",
+    .iterations = 2,
+    .bytes      = bytes,
+    .run        = run_cpu_random_fill,
+  };
+  return count;
+}
+
+static uint32_t add_cases(bench_case_t* cases)
+{
+  uint32_t count = 0;
+  count          = add_upload_cases(cases, count);
+  count          = add_texture_cases(cases, count);
+  count          = add_random_fill_cases(cases, count);
+
+  const bench_case_t other_cases[6] = {
+    {
+      .group      = "object creation",
+      .name       = "render pipeline",
+      .iterations = 16,
+      .ops        = 1,
+      .run        = run_render_pipeline_creation,
+    },
+    {
+      .group      = "object creation",
+      .name       = "compute pipeline",
+      .iterations = 16,
+      .ops        = 1,
+      .run        = run_compute_pipeline_creation,
+    },
+    {
+      .group      = "object creation",
+      .name       = "bind group",
+      .iterations = 1000,
+      .ops        = 1,
+      .run        = run_bind_group_creation,
+    },
+    {
+      .group      = "object creation",
+      .name       = "bind group cache hit",
+      .iterations = 1000,
+      .ops        = 1,
+      .run        = run_bind_group_cache,
+    },
+    {
+      .group      = "submission",
+      .name       = "draw + dynamic offset",
+      .iterations = BENCH_DRAW_COUNT,
+      .ops        = 1,
+      .run        = run_draw_calls,
+    },
+    {
+      .group      = "submission",
+      .name       = "dispatch 1 workgroup",
+      .iterations = BENCH_DISPATCH_COUNT,
+      .ops        = 1,
+      .run        = run_dispatches,
+    },
+  };
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(other_cases); ++i) {
+    cases[count++] = other_cases[i];
+  }
+  ASSERT(count <= BENCH_MAX_CASES);
+
+  return count;
+}
+
+/* Benchmark running / reporting */
+
+static void run_case(bench_case_t* bench_case, uint32_t warmup_samples,
+                     uint32_t sample_count, float* samples,
+                     bench_result_t* result)
+{
+  memset(result, 0, sizeof(*result));
+  result->bench_case = bench_case;
+  result->supported  = true;
+
+  for (uint32_t i = 0; result->supported && i < warmup_samples; ++i) {
+    result->supported = bench_case->run(bench_case);
+  }
+  for (uint32_t i = 0; result->supported && i < sample_count; ++i) {
+    const double start = get_time_ms();
+    result->supported  = bench_case->run(bench_case);
+    samples[i] = (float)((get_time_ms() - start) / bench_case->iterations);
+  }
+  if (result->supported) {
+    benchmark_compute_statistics(samples, sample_count, &result->stats);
+  }
+}
+
+static void format_throughput(const bench_result_t* result, char* text,
+                              size_t text_size)
+{
+  const bench_case_t* bench_case = result->bench_case;
+  const double seconds           = (double)result->stats.p50 / 1000.0;
+  if (!result->supported || seconds <= 0.0) {
+    snprintf(text, text_size, "n/a");
+  }
+  else if (bench_case->bytes > 0) {
+    snprintf(text, text_size, "%.2f GiB/s",
+             (double)bench_case->bytes / seconds
+               / (1024.0 * 1024.0 * 1024.0));
+  }
+  else {
+    snprintf(text, text_size, "%.3f M/s",
+             (double)bench_case->ops / seconds / 1e6);
+  }
+}
+
+static void print_result(const bench_result_t* result)
+{
+  const bench_case_t* bench_case = result->bench_case;
+  if (!result->supported) {
+    printf("%-16s %-30s %10s\n", bench_case->group, bench_case->name,
+           "not supported");
+    return;
+  }
+  const benchmark_statistics_t* stats = &result->stats;
+  const double rsd
+    = stats->mean > 0.0f ? 100.0 * stats->std_dev / stats->mean : 0.0;
+  char throughput[32];
+  format_throughput(result, throughput, sizeof(throughput));
+  printf("%-16s %-30s %10.2f %10.2f %6.1f%% %10.2f %14s\n", bench_case->group,
+         bench_case->name, stats->p50 * 1000.0f, stats->mean * 1000.0f, rsd,
+         stats->p95 * 1000.0f, throughput);
+}
+
+static int write_csv_report(const char* filename,
+                            const bench_result_t* results,
+                            uint32_t result_count)
+{
+  FILE* file = fopen(filename, "w");
+  if (file == NULL) {
+    log_error("Unable to write the benchmark report %s", filename);
+    return 1;
+  }
+  fprintf(file, "group,case,iterations,median_us,mean_us,std_dev_us,p95_us,"
+                "throughput\n");
+  for (uint32_t i = 0; i < result_count; ++i) {
+    const bench_result_t* result = &results[i];
+    char throughput[32];
+    format_throughput(result, throughput, sizeof(throughput));
+    fprintf(file, "%s,%s,%u,%.3f,%.3f,%.3f,%.3f,%s\n",
+            result->bench_case->group, result->bench_case->name,
+            result->bench_case->iterations,
+            result->stats.p50 * 1000.0f, result->stats.mean * 1000.0f,
+            result->stats.std_dev * 1000.0f, result->stats.p95 * 1000.0f,
+            throughput);
+  }
+  fclose(file);
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  int sample_count = 30, warmup_samples = 3;
+  const char* filter  = NULL;
+  const char* output  = NULL;
+  const char* adapter = NULL;
+  struct argparse_option options[] = {
+    OPT_BOOLEAN('?', "help", NULL, "show this help message and exit",
+                argparse_help_cb, 0, OPT_NONEG),
+    OPT_INTEGER(0, "samples", &sample_count,
+                "measured samples per case (default: 30)", NULL, 0, 0),
+    OPT_INTEGER(0, "warmup", &warmup_samples,
+                "warm-up samples per case (default: 3)", NULL, 0, 0),
+    OPT_STRING(0, "filter", &filter,
+               "only run the cases with the text in their group or name",
+               NULL, 0, 0),
+    OPT_STRING(0, "output", &output, "CSV report file", NULL, 0, 0),
+    OPT_STRING(0, "adapter", &adapter,
+               "adapter index, vendor or part of the adapter name", NULL, 0,
+               0),
+    OPT_END(),
+  };
+  struct argparse argparse;
+  const char* const usages[] = {
+    "wgpu_benchmarks [options]",
+    NULL,
+  };
+  argparse_init(&argparse, options, usages, 0);
+  argparse_parse(&argparse, argc, (const char**)argv);
+  sample_count   = MAX(sample_count, 1);
+  warmup_samples = MAX(warmup_samples, 0);
+
+  // Headless device without validation, the validation layers would dominate
+  // the measured CPU times
+  bench.wgpu_context = wgpu_context_create(&(wgpu_context_create_options_t){
+    .validation_level = BackendValidationLevel_Disabled,
+    .adapter          = adapter,
+  });
+  wgpu_create_device_and_queue(bench.wgpu_context);
+  prepare_resources();
+
+  char adapter_info[3][256] = {0};
+  wgpu_get_context_info(adapter_info);
+  printf("Adapter: %s (%s, %s), %d samples\n\n", adapter_info[0],
+         adapter_info[1], adapter_info[2], sample_count);
+  printf("%-16s %-30s %10s %10s %7s %10s %14s\n", "group", "case",
+         "median us", "mean us", "rsd", "p95 us", "throughput");
+
+  static bench_case_t cases[BENCH_MAX_CASES];
+  static bench_result_t results[BENCH_MAX_CASES];
+  const uint32_t case_count = add_cases(cases);
+  float* samples = (float*)malloc((size_t)sample_count * sizeof(float));
+  uint32_t result_count = 0;
+  for (uint32_t i = 0; i < case_count; ++i) {
+    if (filter != NULL && strstr(cases[i].group, filter) == NULL
+        && strstr(cases[i].name, filter) == NULL) {
+      continue;
+    }
+    bench_result_t* result = &results[result_count++];
+    run_case(&cases[i], (uint32_t)warmup_samples, (uint32_t)sample_count,
+             samples, result);
+    print_result(result);
+  }
+  free(samples);
+
+  int status = 0;
+  if (output != NULL) {
+    status = write_csv_report(output, results, result_count);
+  }
+
+  wait_for_queue();
+  release_resources();
+  wgpu_context_release(bench.wgpu_context);
+
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
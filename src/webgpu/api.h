@@ -3,9 +3,48 @@
 
 #include <dawn/webgpu.h>
 
+#include "auto_exposure.h"
+#include "bin_sort.h"
+#include "bind_group_cache.h"
+#include "bloom.h"
+#include "coarse_shading.h"
 #include "buffer.h"
+#include "compute_primitives.h"
+#include "compute_scheduler.h"
 #include "context.h"
+#include "cubemap_filter.h"
+#include "debug_markers.h"
+#include "dynamic_resolution.h"
+#include "frame_capture.h"
+#include "frame_graph.h"
+#include "gpu_scene.h"
+#include "gpu_stats.h"
+#include "image_filter.h"
+#include "indirect_dispatch.h"
+#include "mipmap_tuner.h"
+#include "msaa.h"
+#include "occlusion_queries.h"
+#include "parallel_recorder.h"
+#include "particle_system.h"
+#include "pipeline_cache.h"
+#include "pipeline_statistics.h"
+#include "profiler.h"
+#include "random_fill.h"
+#include "readback.h"
+#include "render_bundle_cache.h"
+#include "sampler_cache.h"
 #include "shader.h"
+#include "shader_watch.h"
+#include "temporal_aa.h"
 #include "texture.h"
+#include "texture_compressor.h"
+#include "uniform_allocator.h"
+#include "upload_batch.h"
+#include "upload_ring.h"
+#include "virtual_texture.h"
+#include "voxelizer.h"
+#include "weighted_oit.h"
+#include "workgroup_tuner.h"
+#include "write_combiner.h"
 
 #endif
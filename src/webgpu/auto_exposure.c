@@ -0,0 +1,434 @@
+#include "auto_exposure.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "shader.h"
+
+/* Texels per histogram workgroup side */
+#define AUTO_EXPOSURE_TILE_SIZE 16u
+
+// clang-format off
+static const char* auto_exposure_shader_wgsl = CODE(
+  struct Params {
+    min_log_luminance   : f32,
+    log_luminance_range : f32,
+    time_coefficient    : f32,
+    key_value           : f32,
+    texel_count         : f32,
+    input_mode          : u32,
+  }
+
+  struct Result {
+    average_luminance : f32,
+    exposure          : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var source_texture : texture_2d<f32>;
+  @group(0) @binding(2) var<storage, read_write> histogram
+    : array<atomic<u32>, 256>;
+  @group(0) @binding(3) var<storage, read_write> result : Result;
+
+  var<workgroup> bins : array<atomic<u32>, 256>;
+  var<workgroup> weighted : array<f32, 256>;
+
+  // Bin 0 holds the texels below the luminance range, bins 1 - 255 the log2
+  // luminance range
+  fn luminance_bin(color : vec3<f32>) -> u32 {
+    var c = color;
+    if (params.input_mode == 1u) {
+      // Inverse of 1 - exp(-c * exposure)
+      c = -log(max(vec3<f32>(1.0) - c, vec3<f32>(1e-4)))
+          / max(result.exposure, 1e-4);
+    }
+    let luminance = dot(c, vec3<f32>(0.2126, 0.7152, 0.0722));
+    if (luminance < 1e-4) {
+      return 0u;
+    }
+    let t = clamp((log2(luminance) - params.min_log_luminance)
+                    / params.log_luminance_range, 0.0, 1.0);
+    return u32(t * 254.0 + 1.0);
+  }
+
+  @compute @workgroup_size(16, 16)
+  fn build_histogram(@builtin(global_invocation_id) id : vec3<u32>,
+                     @builtin(local_invocation_index) index : u32) {
+    atomicStore(&bins[index], 0u);
+    workgroupBarrier();
+
+    let size = vec2<u32>(textureDimensions(source_texture));
+    if (id.x < size.x && id.y < size.y) {
+      let color = textureLoad(source_texture, vec2<i32>(id.xy), 0).rgb;
+      atomicAdd(&bins[luminance_bin(color)], 1u);
+    }
+    workgroupBarrier();
+
+    // One global atomic per bin and workgroup
+    let count = atomicLoad(&bins[index]);
+    if (count > 0u) {
+      atomicAdd(&histogram[index], count);
+    }
+  }
+
+  @compute @workgroup_size(256)
+  fn average_histogram(@builtin(local_invocation_index) index : u32) {
+    let count = atomicLoad(&histogram[index]);
+    weighted[index] = f32(count) * f32(index);
+    // Cleared for the next frame
+    atomicStore(&histogram[index], 0u);
+    workgroupBarrier();
+
+    // Parallel reduction of the weighted bins
+    for (var stride = 128u; stride > 0u; stride = stride / 2u) {
+      if (index < stride) {
+        weighted[index] = weighted[index] + weighted[index + stride];
+      }
+      workgroupBarrier();
+    }
+
+    if (index == 0u) {
+      // count is the number of texels in bin 0
+      let binned_count = max(params.texel_count - f32(count), 1.0);
+      let log_average = weighted[0] / binned_count - 1.0;
+      let luminance = exp2(log_average / 254.0 * params.log_luminance_range
+                           + params.min_log_luminance);
+      let adapted = result.average_luminance
+                    + (luminance - result.average_luminance)
+                      * params.time_coefficient;
+      result.average_luminance = adapted;
+      result.exposure = params.key_value / max(adapted, 1e-4);
+    }
+  }
+);
+// clang-format on
+
+/* Layout of the WGSL Params struct */
+typedef struct auto_exposure_uniforms_t {
+  float min_log_luminance;
+  float log_luminance_range;
+  float time_coefficient;
+  float key_value;
+  float texel_count;
+  uint32_t input_mode;
+  float padding[2];
+} auto_exposure_uniforms_t;
+
+/**
+ * @brief Auto exposure class
+ */
+struct wgpu_auto_exposure {
+  wgpu_context_t* wgpu_context;
+  wgpu_auto_exposure_input_enum_t input;
+  wgpu_auto_exposure_params_t params;
+  /* Source size */
+  uint32_t width;
+  uint32_t height;
+  WGPUBuffer uniform_buffer;
+  WGPUBuffer histogram_buffer;
+  WGPUBuffer result_buffer;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline histogram_pipeline;
+  WGPUComputePipeline average_pipeline;
+};
+
+/* Pipelines */
+
+static WGPUComputePipeline
+auto_exposure_create_pipeline(wgpu_auto_exposure_t* auto_exposure,
+                              const char* entry)
+{
+  wgpu_context_t* wgpu_context = auto_exposure->wgpu_context;
+
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "Auto exposure shader",
+                    .wgsl_code.source = auto_exposure_shader_wgsl,
+                    .entry            = entry,
+                  });
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Auto exposure pipeline",
+                    .layout  = auto_exposure->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&shader);
+
+  return pipeline;
+}
+
+static void auto_exposure_create_pipelines(wgpu_auto_exposure_t* auto_exposure)
+{
+  WGPUDevice device = auto_exposure->wgpu_context->device;
+
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Parameters
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(auto_exposure_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Source texture
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Histogram
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = WGPU_AUTO_EXPOSURE_BIN_COUNT * sizeof(uint32_t),
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      // Binding 3: Result
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = sizeof(wgpu_auto_exposure_result_t),
+      },
+    },
+  };
+  auto_exposure->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Auto exposure bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(auto_exposure->bind_group_layout != NULL);
+
+  auto_exposure->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Auto exposure pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &auto_exposure->bind_group_layout,
+            });
+  ASSERT(auto_exposure->pipeline_layout != NULL);
+
+  auto_exposure->histogram_pipeline
+    = auto_exposure_create_pipeline(auto_exposure, "build_histogram");
+  auto_exposure->average_pipeline
+    = auto_exposure_create_pipeline(auto_exposure, "average_histogram");
+}
+
+/* Auto exposure creating / destroying */
+
+static WGPUBuffer auto_exposure_create_buffer(wgpu_context_t* wgpu_context,
+                                              const char* label,
+                                              WGPUBufferUsageFlags usage,
+                                              uint64_t size)
+{
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = label,
+                            .usage = usage,
+                            .size  = size,
+                          });
+  ASSERT(buffer != NULL);
+
+  return buffer;
+}
+
+wgpu_auto_exposure_t*
+wgpu_auto_exposure_create(wgpu_context_t* wgpu_context,
+                          const wgpu_auto_exposure_desc_t* desc)
+{
+  ASSERT(desc->width > 0 && desc->height > 0);
+
+  wgpu_auto_exposure_t* auto_exposure
+    = (wgpu_auto_exposure_t*)calloc(1, sizeof(*auto_exposure));
+  auto_exposure->wgpu_context = wgpu_context;
+  auto_exposure->input        = desc->input;
+  auto_exposure->width        = desc->width;
+  auto_exposure->height       = desc->height;
+
+  auto_exposure->params.min_log_luminance = -8.0f;
+  auto_exposure->params.max_log_luminance = 4.0f;
+  auto_exposure->params.adaptation_rate   = 1.1f;
+  auto_exposure->params.key_value         = 0.18f;
+
+  auto_exposure->uniform_buffer = auto_exposure_create_buffer(
+    wgpu_context, "Auto exposure uniform buffer",
+    WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+    sizeof(auto_exposure_uniforms_t));
+  // Buffers are zero initialized, so the histogram starts cleared
+  auto_exposure->histogram_buffer = auto_exposure_create_buffer(
+    wgpu_context, "Auto exposure histogram buffer", WGPUBufferUsage_Storage,
+    WGPU_AUTO_EXPOSURE_BIN_COUNT * sizeof(uint32_t));
+  auto_exposure->result_buffer = auto_exposure_create_buffer(
+    wgpu_context, "Auto exposure result buffer",
+    WGPUBufferUsage_Storage | WGPUBufferUsage_Uniform | WGPUBufferUsage_CopySrc
+      | WGPUBufferUsage_CopyDst,
+    sizeof(wgpu_auto_exposure_result_t));
+
+  auto_exposure_create_pipelines(auto_exposure);
+  wgpu_auto_exposure_reset(auto_exposure);
+
+  return auto_exposure;
+}
+
+void wgpu_auto_exposure_destroy(wgpu_auto_exposure_t* auto_exposure)
+{
+  if (auto_exposure == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(ComputePipeline, auto_exposure->histogram_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, auto_exposure->average_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, auto_exposure->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, auto_exposure->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Buffer, auto_exposure->uniform_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, auto_exposure->histogram_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, auto_exposure->result_buffer)
+  free(auto_exposure);
+}
+
+void wgpu_auto_exposure_resize(wgpu_auto_exposure_t* auto_exposure,
+                               uint32_t width, uint32_t height)
+{
+  ASSERT(width > 0 && height > 0);
+
+  auto_exposure->width  = width;
+  auto_exposure->height = height;
+}
+
+/* Parameters */
+
+void wgpu_auto_exposure_set_params(wgpu_auto_exposure_t* auto_exposure,
+                                   const wgpu_auto_exposure_params_t* params)
+{
+  ASSERT(params->max_log_luminance > params->min_log_luminance);
+
+  auto_exposure->params = *params;
+}
+
+void wgpu_auto_exposure_get_params(wgpu_auto_exposure_t* auto_exposure,
+                                   wgpu_auto_exposure_params_t* params)
+{
+  *params = auto_exposure->params;
+}
+
+void wgpu_auto_exposure_reset(wgpu_auto_exposure_t* auto_exposure)
+{
+  const wgpu_auto_exposure_result_t result = {
+    .average_luminance = auto_exposure->params.key_value,
+    .exposure          = 1.0f,
+  };
+  wgpu_queue_write_buffer(auto_exposure->wgpu_context,
+                          auto_exposure->result_buffer, 0, &result,
+                          sizeof(result));
+}
+
+/* Recording */
+
+void wgpu_auto_exposure_encode(wgpu_auto_exposure_t* auto_exposure,
+                               WGPUCommandEncoder cmd_enc,
+                               WGPUTextureView source, float delta_time)
+{
+  ASSERT(source != NULL);
+
+  wgpu_context_t* wgpu_context              = auto_exposure->wgpu_context;
+  const wgpu_auto_exposure_params_t* params = &auto_exposure->params;
+
+  // Frame rate independent exponential adaptation
+  const auto_exposure_uniforms_t uniforms = {
+    .min_log_luminance = params->min_log_luminance,
+    .log_luminance_range
+    = params->max_log_luminance - params->min_log_luminance,
+    .time_coefficient
+    = 1.0f - expf(-MAX(delta_time, 0.0f) * params->adaptation_rate),
+    .key_value   = params->key_value,
+    .texel_count = (float)auto_exposure->width * (float)auto_exposure->height,
+    .input_mode  = (uint32_t)auto_exposure->input,
+  };
+  wgpu_queue_write_buffer(wgpu_context, auto_exposure->uniform_buffer, 0,
+                          &uniforms, sizeof(uniforms));
+
+  WGPUBindGroupEntry bg_entries[4] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = auto_exposure->uniform_buffer,
+      .size    = sizeof(auto_exposure_uniforms_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = source,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = auto_exposure->histogram_buffer,
+      .size    = WGPU_AUTO_EXPOSURE_BIN_COUNT * sizeof(uint32_t),
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding = 3,
+      .buffer  = auto_exposure->result_buffer,
+      .size    = sizeof(wgpu_auto_exposure_result_t),
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .label      = "Auto exposure bind group",
+                    .layout     = auto_exposure->bind_group_layout,
+                    .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                    .entries    = bg_entries,
+                  });
+
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Auto exposure");
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Auto exposure compute pass",
+             });
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 0, NULL);
+  // Histogram of the source texels
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    auto_exposure->histogram_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (auto_exposure->width + AUTO_EXPOSURE_TILE_SIZE - 1)
+      / AUTO_EXPOSURE_TILE_SIZE,
+    (auto_exposure->height + AUTO_EXPOSURE_TILE_SIZE - 1)
+      / AUTO_EXPOSURE_TILE_SIZE,
+    1);
+  // Average luminance and adaptation, one workgroup of one thread per bin
+  wgpuComputePassEncoderSetPipeline(cpass_enc, auto_exposure->average_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
+
+void wgpu_auto_exposure_copy_exposure(wgpu_auto_exposure_t* auto_exposure,
+                                      WGPUCommandEncoder cmd_enc,
+                                      WGPUBuffer dst, uint64_t dst_offset)
+{
+  wgpuCommandEncoderCopyBufferToBuffer(
+    cmd_enc, auto_exposure->result_buffer,
+    offsetof(wgpu_auto_exposure_result_t, exposure), dst, dst_offset,
+    sizeof(float));
+}
+
+WGPUBuffer wgpu_auto_exposure_get_buffer(wgpu_auto_exposure_t* auto_exposure)
+{
+  return auto_exposure->result_buffer;
+}
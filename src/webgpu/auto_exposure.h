@@ -0,0 +1,97 @@
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include "context.h"
+
+#define WGPU_AUTO_EXPOSURE_BIN_COUNT 256u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU auto exposure
+ *
+ * Adapts the exposure to the average luminance of an HDR texture, entirely on
+ * the GPU without a readback. One compute pass records two dispatches:
+ *
+ *   - histogram: every workgroup bins the log2 luminance of 16x16 texels into
+ *     atomic workgroup memory bins, which are added to the global histogram
+ *   - average: a single workgroup reduces the histogram to the weighted
+ *     average in workgroup memory, adapts it over time and clears the
+ *     histogram for the next frame
+ *
+ * Texels below the luminance range fall into bin 0 and are not part of the
+ * average. The result buffer holds a wgpu_auto_exposure_result_t and can be
+ * bound as uniform or storage buffer, or its exposure is copied into the
+ * uniform buffer of the shaders applying it:
+ *
+ *   wgpu_auto_exposure_encode(auto_exposure, cmd_enc, hdr_view, delta_time);
+ *   wgpu_auto_exposure_copy_exposure(auto_exposure, cmd_enc, ubo, offset);
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_auto_exposure wgpu_auto_exposure_t;
+
+typedef enum wgpu_auto_exposure_input_enum_t {
+  /* Linear scene luminance */
+  WGPU_AutoExposureInput_Linear = 0,
+  /* Tone mapped with 1 - exp(-color * exposure), the exposure of the result
+   * buffer is used to reconstruct the scene luminance, so the exposure has to
+   * be the one the source was rendered with */
+  WGPU_AutoExposureInput_ExponentialToneMapped = 1,
+} wgpu_auto_exposure_input_enum_t;
+
+typedef struct wgpu_auto_exposure_desc_t {
+  /* Size of the source texture */
+  uint32_t width;
+  uint32_t height;
+  wgpu_auto_exposure_input_enum_t input;
+} wgpu_auto_exposure_desc_t;
+
+typedef struct wgpu_auto_exposure_params_t {
+  /* log2 luminance range of the histogram */
+  float min_log_luminance;
+  float max_log_luminance;
+  /* Adaptation speed, higher values adapt faster */
+  float adaptation_rate;
+  /* Average luminance after the exposure, 0.18 = middle gray */
+  float key_value;
+} wgpu_auto_exposure_params_t;
+
+/* Contents of the result buffer */
+typedef struct wgpu_auto_exposure_result_t {
+  float average_luminance; /* adapted average scene luminance */
+  float exposure;          /* key value / average luminance */
+} wgpu_auto_exposure_result_t;
+
+/* Auto exposure creating / destroying */
+wgpu_auto_exposure_t*
+wgpu_auto_exposure_create(wgpu_context_t* wgpu_context,
+                          const wgpu_auto_exposure_desc_t* desc);
+void wgpu_auto_exposure_destroy(wgpu_auto_exposure_t* auto_exposure);
+
+void wgpu_auto_exposure_resize(wgpu_auto_exposure_t* auto_exposure,
+                               uint32_t width, uint32_t height);
+
+/* Defaults: log2 luminance range [-8, 4], adaptation rate 1.1, key value
+ * 0.18 */
+void wgpu_auto_exposure_set_params(wgpu_auto_exposure_t* auto_exposure,
+                                   const wgpu_auto_exposure_params_t* params);
+void wgpu_auto_exposure_get_params(wgpu_auto_exposure_t* auto_exposure,
+                                   wgpu_auto_exposure_params_t* params);
+
+/* Restarts the adaptation at an exposure of 1.0 */
+void wgpu_auto_exposure_reset(wgpu_auto_exposure_t* auto_exposure);
+
+/* Records the histogram and the average dispatches of the source texture view,
+ * the time since the last frame drives the adaptation */
+void wgpu_auto_exposure_encode(wgpu_auto_exposure_t* auto_exposure,
+                               WGPUCommandEncoder cmd_enc,
+                               WGPUTextureView source, float delta_time);
+
+/* Copies the adapted exposure (a float) into dst at dst_offset, dst needs the
+ * CopyDst usage */
+void wgpu_auto_exposure_copy_exposure(wgpu_auto_exposure_t* auto_exposure,
+                                      WGPUCommandEncoder cmd_enc,
+                                      WGPUBuffer dst, uint64_t dst_offset);
+
+/* Result buffer, Uniform | Storage | CopySrc | CopyDst usage */
+WGPUBuffer wgpu_auto_exposure_get_buffer(wgpu_auto_exposure_t* auto_exposure);
+
+#endif /* AUTO_EXPOSURE_H */
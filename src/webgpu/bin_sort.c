@@ -0,0 +1,301 @@
+#include "bin_sort.h"
+
+#include <stdlib.h>
+
+#include "../core/macro.h"
+#include "buffer.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+#define BIN_SORT_WORKGROUP_SIZE 64u
+
+// clang-format off
+static const char* bin_sort_shader_wgsl = CODE(
+  struct Params {
+    count : u32,
+    binCount : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var<storage, read> keys : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> ranks : array<u32>;
+  @group(0) @binding(3)
+  var<storage, read_write> binCounts : array<atomic<u32>>;
+  @group(0) @binding(4) var<storage, read_write> offsets : array<u32>;
+  @group(0) @binding(5) var<storage, read_write> indices : array<u32>;
+
+  const kWorkgroupSize = 64u;
+  const kScanSize = 256u;
+
+  var<workgroup> scanSums : array<u32, kScanSize>;
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn clear_bins(@builtin(global_invocation_id) gid : vec3<u32>) {
+    if (gid.x < params.binCount) {
+      atomicStore(&binCounts[gid.x], 0u);
+    }
+  }
+
+  // The rank of an element is its position within the bin
+  @compute @workgroup_size(kWorkgroupSize)
+  fn count_keys(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let i = gid.x;
+    if (i < params.count) {
+      ranks[i] = atomicAdd(&binCounts[keys[i]], 1u);
+    }
+  }
+
+  // Exclusive prefix sum of the bin counts, every invocation sums a range of
+  // consecutive bins
+  @compute @workgroup_size(kScanSize)
+  fn scan_bins(@builtin(local_invocation_index) lid : u32) {
+    let perInvocation = (params.binCount + kScanSize - 1u) / kScanSize;
+    let first = min(lid * perInvocation, params.binCount);
+    let last = min(first + perInvocation, params.binCount);
+    var rangeCount = 0u;
+    for (var b = first; b < last; b = b + 1u) {
+      rangeCount = rangeCount + atomicLoad(&binCounts[b]);
+    }
+    scanSums[lid] = rangeCount;
+    workgroupBarrier();
+
+    for (var offset = 1u; offset < kScanSize; offset = offset * 2u) {
+      var value = scanSums[lid];
+      if (lid >= offset) {
+        value = value + scanSums[lid - offset];
+      }
+      workgroupBarrier();
+      scanSums[lid] = value;
+      workgroupBarrier();
+    }
+
+    if (lid == 0u) {
+      offsets[0] = 0u;
+    }
+    var start = scanSums[lid] - rangeCount;
+    for (var b = first; b < last; b = b + 1u) {
+      start = start + atomicLoad(&binCounts[b]);
+      offsets[b + 1u] = start;
+    }
+  }
+
+  @compute @workgroup_size(kWorkgroupSize)
+  fn scatter(@builtin(global_invocation_id) gid : vec3<u32>) {
+    let i = gid.x;
+    if (i < params.count) {
+      indices[offsets[keys[i]] + ranks[i]] = i;
+    }
+  }
+);
+// clang-format on
+
+typedef enum bin_sort_pass_t {
+  BinSort_Pass_ClearBins = 0,
+  BinSort_Pass_CountKeys = 1,
+  BinSort_Pass_ScanBins  = 2,
+  BinSort_Pass_Scatter   = 3,
+  BinSort_Pass_Count     = 4,
+} bin_sort_pass_t;
+
+static const char* bin_sort_pass_entries[BinSort_Pass_Count] = {
+  "clear_bins", /* */
+  "count_keys", /* */
+  "scan_bins",  /* */
+  "scatter",    /* */
+};
+
+struct wgpu_bin_sort {
+  wgpu_context_t* wgpu_context;
+  wgpu_bin_sort_desc_t desc;
+  wgpu_buffer_t params;
+  wgpu_buffer_t keys;
+  wgpu_buffer_t ranks;
+  wgpu_buffer_t bin_counts;
+  wgpu_buffer_t offsets;
+  wgpu_buffer_t indices;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipelines[BinSort_Pass_Count];
+};
+
+static wgpu_buffer_t bin_sort_create_storage_buffer(wgpu_context_t* context,
+                                                    const char* label,
+                                                    uint32_t count)
+{
+  return wgpu_create_buffer(
+    context, &(wgpu_buffer_desc_t){
+               .label = label,
+               .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+               .size  = count * sizeof(uint32_t),
+               .count = count,
+             });
+}
+
+wgpu_bin_sort_t* wgpu_bin_sort_create(wgpu_context_t* wgpu_context,
+                                      const wgpu_bin_sort_desc_t* desc)
+{
+  ASSERT(desc->count > 0 && desc->bin_count > 0);
+
+  wgpu_bin_sort_t* bin_sort
+    = (wgpu_bin_sort_t*)calloc(1, sizeof(wgpu_bin_sort_t));
+  bin_sort->wgpu_context = wgpu_context;
+  bin_sort->desc         = *desc;
+
+  // Buffers
+  const uint32_t params[2] = {desc->count, desc->bin_count};
+  bin_sort->params         = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label        = "bin_sort_params_buffer",
+                    .usage        = WGPUBufferUsage_Uniform,
+                    .size         = sizeof(params),
+                    .initial.data = params,
+                  });
+  bin_sort->keys = bin_sort_create_storage_buffer(
+    wgpu_context, "bin_sort_keys_buffer", desc->count);
+  bin_sort->ranks = bin_sort_create_storage_buffer(
+    wgpu_context, "bin_sort_ranks_buffer", desc->count);
+  bin_sort->bin_counts = bin_sort_create_storage_buffer(
+    wgpu_context, "bin_sort_bin_counts_buffer", desc->bin_count);
+  bin_sort->offsets = bin_sort_create_storage_buffer(
+    wgpu_context, "bin_sort_offsets_buffer", desc->bin_count + 1);
+  bin_sort->indices = bin_sort_create_storage_buffer(
+    wgpu_context, "bin_sort_indices_buffer", desc->count);
+
+  // Bind group layout and bind group shared by all passes
+  wgpu_buffer_t* buffers[6] = {
+    &bin_sort->params,     /* Binding 0 : Parameters */
+    &bin_sort->keys,       /* Binding 1 : Keys */
+    &bin_sort->ranks,      /* Binding 2 : Ranks within the bins */
+    &bin_sort->bin_counts, /* Binding 3 : Bin counts */
+    &bin_sort->offsets,    /* Binding 4 : Bin offsets */
+    &bin_sort->indices,    /* Binding 5 : Sorted indices */
+  };
+  WGPUBindGroupLayoutEntry bgl_entries[6] = {0};
+  WGPUBindGroupEntry bg_entries[6]        = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(buffers); ++i) {
+    WGPUBufferBindingType type = WGPUBufferBindingType_Storage;
+    if (i == 0) {
+      type = WGPUBufferBindingType_Uniform;
+    }
+    else if (i == 1) {
+      type = WGPUBufferBindingType_ReadOnlyStorage;
+    }
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type           = type,
+        .minBindingSize = buffers[i]->size,
+      },
+    };
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding = i,
+      .buffer  = buffers[i]->buffer,
+      .offset  = 0,
+      .size    = buffers[i]->size,
+    };
+  }
+  bin_sort->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "bin_sort_bind_group_layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(bin_sort->bind_group_layout != NULL);
+  bin_sort->bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "bin_sort_bind_group",
+                            .layout     = bin_sort->bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(bin_sort->bind_group != NULL);
+
+  // Compute pipelines
+  bin_sort->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &bin_sort->bind_group_layout,
+                          });
+  ASSERT(bin_sort->pipeline_layout != NULL);
+  for (uint32_t i = 0; i < (uint32_t)BinSort_Pass_Count; ++i) {
+    wgpu_shader_t shader = wgpu_shader_create(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      // Compute shader WGSL
+                      .wgsl_code.source = bin_sort_shader_wgsl,
+                      .entry            = bin_sort_pass_entries[i],
+                    });
+    bin_sort->pipelines[i] = wgpu_create_compute_pipeline(
+      wgpu_context, &(WGPUComputePipelineDescriptor){
+                      .label   = "bin_sort_pipeline",
+                      .layout  = bin_sort->pipeline_layout,
+                      .compute = shader.programmable_stage_descriptor,
+                    });
+    ASSERT(bin_sort->pipelines[i] != NULL);
+    wgpu_shader_release(&shader);
+  }
+
+  return bin_sort;
+}
+
+void wgpu_bin_sort_destroy(wgpu_bin_sort_t* bin_sort)
+{
+  if (bin_sort == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < (uint32_t)BinSort_Pass_Count; ++i) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, bin_sort->pipelines[i])
+  }
+  WGPU_RELEASE_RESOURCE(PipelineLayout, bin_sort->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, bin_sort->bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bin_sort->bind_group_layout)
+  wgpu_destroy_buffer(&bin_sort->params);
+  wgpu_destroy_buffer(&bin_sort->keys);
+  wgpu_destroy_buffer(&bin_sort->ranks);
+  wgpu_destroy_buffer(&bin_sort->bin_counts);
+  wgpu_destroy_buffer(&bin_sort->offsets);
+  wgpu_destroy_buffer(&bin_sort->indices);
+  free(bin_sort);
+}
+
+WGPUBuffer wgpu_bin_sort_get_keys(wgpu_bin_sort_t* bin_sort)
+{
+  return bin_sort->keys.buffer;
+}
+
+WGPUBuffer wgpu_bin_sort_get_indices(wgpu_bin_sort_t* bin_sort)
+{
+  return bin_sort->indices.buffer;
+}
+
+WGPUBuffer wgpu_bin_sort_get_offsets(wgpu_bin_sort_t* bin_sort)
+{
+  return bin_sort->offsets.buffer;
+}
+
+void wgpu_bin_sort_dispatch(wgpu_bin_sort_t* bin_sort,
+                            WGPUComputePassEncoder pass_encoder)
+{
+  const uint32_t workgroup_counts[BinSort_Pass_Count] = {
+    // Clear bins
+    (bin_sort->desc.bin_count + BIN_SORT_WORKGROUP_SIZE - 1)
+      / BIN_SORT_WORKGROUP_SIZE,
+    // Count keys
+    (bin_sort->desc.count + BIN_SORT_WORKGROUP_SIZE - 1)
+      / BIN_SORT_WORKGROUP_SIZE,
+    // Scan bins, single workgroup
+    1,
+    // Scatter
+    (bin_sort->desc.count + BIN_SORT_WORKGROUP_SIZE - 1)
+      / BIN_SORT_WORKGROUP_SIZE,
+  };
+
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bin_sort->bind_group, 0,
+                                     NULL);
+  for (uint32_t i = 0; i < (uint32_t)BinSort_Pass_Count; ++i) {
+    wgpuComputePassEncoderSetPipeline(pass_encoder, bin_sort->pipelines[i]);
+    wgpuComputePassEncoderDispatchWorkgroups(pass_encoder,
+                                             workgroup_counts[i], 1, 1);
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef BIN_SORT_H
+#define BIN_SORT_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU bin sort
+ *
+ * Counting sort of elements by a bin key on the GPU, e.g. particles by the
+ * cell of a uniform grid for neighbour searches. The application writes one
+ * key per element into the keys buffer, wgpu_bin_sort_dispatch() counts the
+ * elements per bin, computes the bin offsets with a prefix sum and writes the
+ * element indices ordered by bin. The order of the elements within a bin is
+ * not deterministic.
+ *
+ * The prefix sum is done by a single workgroup, which suits bin counts of up
+ * to about a million bins.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_bin_sort wgpu_bin_sort_t;
+
+typedef struct wgpu_bin_sort_desc_t {
+  uint32_t count;     /* number of elements */
+  uint32_t bin_count; /* number of bins, the keys are in [0, bin_count) */
+} wgpu_bin_sort_desc_t;
+
+/* Bin sort creating / destroying */
+wgpu_bin_sort_t* wgpu_bin_sort_create(wgpu_context_t* wgpu_context,
+                                      const wgpu_bin_sort_desc_t* desc);
+void wgpu_bin_sort_destroy(wgpu_bin_sort_t* bin_sort);
+
+/* Storage buffer of count u32 keys, written by the application */
+WGPUBuffer wgpu_bin_sort_get_keys(wgpu_bin_sort_t* bin_sort);
+/* Storage buffer of count u32 element indices ordered by bin */
+WGPUBuffer wgpu_bin_sort_get_indices(wgpu_bin_sort_t* bin_sort);
+/* Storage buffer of bin_count + 1 u32 offsets into the indices, the elements
+ * of bin b are at [offsets[b], offsets[b + 1]) */
+WGPUBuffer wgpu_bin_sort_get_offsets(wgpu_bin_sort_t* bin_sort);
+
+/**
+ * @brief Records the sort into the compute pass. The pipeline and the bind
+ * group 0 of the pass are replaced, the keys have to be written by a previous
+ * dispatch or queue write.
+ */
+void wgpu_bin_sort_dispatch(wgpu_bin_sort_t* bin_sort,
+                            WGPUComputePassEncoder pass_encoder);
+
+#endif /* BIN_SORT_H */
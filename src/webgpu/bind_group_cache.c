@@ -0,0 +1,252 @@
+#include "bind_group_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+#define BIND_GROUP_CACHE_BUCKET_COUNT 1024u
+
+typedef struct bind_group_key_entry_t {
+  uint32_t binding;
+  WGPUBuffer buffer;
+  uint64_t offset;
+  uint64_t size;
+  WGPUSampler sampler;
+  WGPUTextureView texture_view;
+} bind_group_key_entry_t;
+
+typedef struct bind_group_cache_entry_t {
+  struct bind_group_cache_entry_t* next;
+  uint64_t hash;
+  uint64_t last_used_frame;
+  WGPUBindGroup bind_group;
+  WGPUBindGroupLayout layout;
+  uint32_t entry_count;
+  bind_group_key_entry_t entries[];
+} bind_group_cache_entry_t;
+
+struct wgpu_bind_group_cache {
+  WGPUDevice device;
+  bind_group_cache_entry_t* buckets[BIND_GROUP_CACHE_BUCKET_COUNT];
+  uint32_t count;
+  uint64_t frame_index;
+};
+
+/* Key hashing / comparison */
+
+/* 64-bit FNV-1a */
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static bind_group_key_entry_t
+bind_group_key_entry(const WGPUBindGroupEntry* entry)
+{
+  return (bind_group_key_entry_t){
+    .binding      = entry->binding,
+    .buffer       = entry->buffer,
+    .offset       = entry->offset,
+    .size         = entry->size,
+    .sampler      = entry->sampler,
+    .texture_view = entry->textureView,
+  };
+}
+
+static bool bind_group_key_entry_equal(const bind_group_key_entry_t* a,
+                                       const bind_group_key_entry_t* b)
+{
+  return a->binding == b->binding && a->buffer == b->buffer
+         && a->offset == b->offset && a->size == b->size
+         && a->sampler == b->sampler && a->texture_view == b->texture_view;
+}
+
+/* The fields are hashed one by one, the key entries contain padding */
+static uint64_t bind_group_key_hash(const WGPUBindGroupDescriptor* descriptor)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  hash = hash_bytes(hash, &descriptor->layout, sizeof(descriptor->layout));
+  for (uint32_t i = 0; i < descriptor->entryCount; ++i) {
+    const WGPUBindGroupEntry* entry = &descriptor->entries[i];
+    hash = hash_bytes(hash, &entry->binding, sizeof(entry->binding));
+    hash = hash_bytes(hash, &entry->buffer, sizeof(entry->buffer));
+    hash = hash_bytes(hash, &entry->offset, sizeof(entry->offset));
+    hash = hash_bytes(hash, &entry->size, sizeof(entry->size));
+    hash = hash_bytes(hash, &entry->sampler, sizeof(entry->sampler));
+    hash = hash_bytes(hash, &entry->textureView, sizeof(entry->textureView));
+  }
+  return hash;
+}
+
+static bool is_cacheable(const WGPUBindGroupDescriptor* descriptor)
+{
+  if (descriptor->nextInChain != NULL) {
+    return false;
+  }
+  for (uint32_t i = 0; i < descriptor->entryCount; ++i) {
+    if (descriptor->entries[i].nextInChain != NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Bind group cache creating / releasing */
+
+static wgpu_bind_group_cache_t*
+bind_group_cache_get(wgpu_context_t* wgpu_context)
+{
+  wgpu_bind_group_cache_t* cache = wgpu_context->bind_group_cache;
+  if (cache != NULL && cache->device != wgpu_context->device) {
+    // Bind groups of another device can not be shared
+    wgpu_bind_group_cache_release(cache);
+    cache = NULL;
+  }
+  if (cache == NULL) {
+    cache         = (wgpu_bind_group_cache_t*)calloc(1, sizeof(*cache));
+    cache->device = wgpu_context->device;
+  }
+  wgpu_context->bind_group_cache = cache;
+  return cache;
+}
+
+static void bind_group_cache_remove_all(wgpu_bind_group_cache_t* cache)
+{
+  for (uint32_t i = 0; i < BIND_GROUP_CACHE_BUCKET_COUNT; ++i) {
+    bind_group_cache_entry_t* entry = cache->buckets[i];
+    while (entry != NULL) {
+      bind_group_cache_entry_t* next = entry->next;
+      WGPU_RELEASE_RESOURCE(BindGroup, entry->bind_group)
+      free(entry);
+      entry = next;
+    }
+    cache->buckets[i] = NULL;
+  }
+  cache->count = 0;
+}
+
+void wgpu_bind_group_cache_release(wgpu_bind_group_cache_t* bind_group_cache)
+{
+  if (bind_group_cache == NULL) {
+    return;
+  }
+  bind_group_cache_remove_all(bind_group_cache);
+  free(bind_group_cache);
+}
+
+void wgpu_bind_group_cache_clear(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->bind_group_cache != NULL) {
+    bind_group_cache_remove_all(wgpu_context->bind_group_cache);
+  }
+}
+
+/* Bind group cache lookup / insertion */
+
+static bind_group_cache_entry_t*
+bind_group_cache_find(wgpu_bind_group_cache_t* cache,
+                      const WGPUBindGroupDescriptor* descriptor, uint64_t hash)
+{
+  bind_group_cache_entry_t* entry
+    = cache->buckets[hash % BIND_GROUP_CACHE_BUCKET_COUNT];
+  for (; entry != NULL; entry = entry->next) {
+    if (entry->hash != hash || entry->layout != descriptor->layout
+        || entry->entry_count != descriptor->entryCount) {
+      continue;
+    }
+    uint32_t i = 0;
+    for (; i < entry->entry_count; ++i) {
+      const bind_group_key_entry_t key_entry
+        = bind_group_key_entry(&descriptor->entries[i]);
+      if (!bind_group_key_entry_equal(&entry->entries[i], &key_entry)) {
+        break;
+      }
+    }
+    if (i == entry->entry_count) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* The entry takes over the bind group reference */
+static void bind_group_cache_insert(wgpu_bind_group_cache_t* cache,
+                                    const WGPUBindGroupDescriptor* descriptor,
+                                    uint64_t hash, WGPUBindGroup bind_group)
+{
+  bind_group_cache_entry_t* entry = (bind_group_cache_entry_t*)malloc(
+    sizeof(bind_group_cache_entry_t)
+    + descriptor->entryCount * sizeof(bind_group_key_entry_t));
+  entry->hash            = hash;
+  entry->last_used_frame = cache->frame_index;
+  entry->bind_group      = bind_group;
+  entry->layout          = descriptor->layout;
+  entry->entry_count     = descriptor->entryCount;
+  for (uint32_t i = 0; i < descriptor->entryCount; ++i) {
+    entry->entries[i] = bind_group_key_entry(&descriptor->entries[i]);
+  }
+
+  const uint32_t bucket  = hash % BIND_GROUP_CACHE_BUCKET_COUNT;
+  entry->next            = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+  ++cache->count;
+}
+
+WGPUBindGroup wgpu_create_bind_group(wgpu_context_t* wgpu_context,
+                                     const WGPUBindGroupDescriptor* descriptor)
+{
+  if (!is_cacheable(descriptor)) {
+    return wgpuDeviceCreateBindGroup(wgpu_context->device, descriptor);
+  }
+
+  wgpu_bind_group_cache_t* cache = bind_group_cache_get(wgpu_context);
+  const uint64_t hash            = bind_group_key_hash(descriptor);
+  bind_group_cache_entry_t* entry
+    = bind_group_cache_find(cache, descriptor, hash);
+  if (entry != NULL) {
+    entry->last_used_frame = cache->frame_index;
+    wgpuBindGroupReference(entry->bind_group);
+    return entry->bind_group;
+  }
+
+  WGPUBindGroup bind_group
+    = wgpuDeviceCreateBindGroup(wgpu_context->device, descriptor);
+  if (bind_group == NULL) {
+    return NULL;
+  }
+  wgpuBindGroupReference(bind_group);
+  bind_group_cache_insert(cache, descriptor, hash, bind_group);
+  return bind_group;
+}
+
+/* Bind group cache eviction */
+
+void wgpu_bind_group_cache_end_frame(wgpu_bind_group_cache_t* bind_group_cache)
+{
+  if (bind_group_cache == NULL) {
+    return;
+  }
+
+  const uint64_t frame_index = bind_group_cache->frame_index++;
+  for (uint32_t i = 0; i < BIND_GROUP_CACHE_BUCKET_COUNT; ++i) {
+    bind_group_cache_entry_t** link = &bind_group_cache->buckets[i];
+    while (*link != NULL) {
+      bind_group_cache_entry_t* entry = *link;
+      if (frame_index - entry->last_used_frame
+          < WGPU_BIND_GROUP_CACHE_MAX_UNUSED_FRAMES) {
+        link = &entry->next;
+        continue;
+      }
+      *link = entry->next;
+      WGPU_RELEASE_RESOURCE(BindGroup, entry->bind_group)
+      free(entry);
+      --bind_group_cache->count;
+    }
+  }
+}
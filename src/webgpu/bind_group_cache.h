@@ -0,0 +1,42 @@
+#ifndef BIND_GROUP_CACHE_H
+#define BIND_GROUP_CACHE_H
+
+#include "context.h"
+
+/* Frames a cached bind group is kept without being requested */
+#define WGPU_BIND_GROUP_CACHE_MAX_UNUSED_FRAMES 60u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU bind group cache
+ *
+ * Deduplicates bind groups per device, for code paths which request the same
+ * bind groups every frame, e.g. per dispatch. The key is the bind group
+ * layout handle plus the entries: binding, buffer, offset and size, sampler
+ * and texture view. Labels are not part of the key, descriptors and entries
+ * with chained structs are not cached.
+ *
+ * A cached bind group holds references to its resources, so the handles of a
+ * key can not be reused by new objects while the entry exists. Entries not
+ * requested for WGPU_BIND_GROUP_CACHE_MAX_UNUSED_FRAMES frames are evicted on
+ * present, which also bounds how long released resources are kept alive.
+ * Buffers and textures destroyed explicitly have to be followed by
+ * wgpu_bind_group_cache_clear().
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_bind_group_cache wgpu_bind_group_cache_t;
+
+/* Bind group cache releasing */
+void wgpu_bind_group_cache_release(wgpu_bind_group_cache_t* bind_group_cache);
+
+/* Replacement of wgpuDeviceCreateBindGroup, every returned bind group holds
+ * its own reference and is released as usual */
+WGPUBindGroup wgpu_create_bind_group(wgpu_context_t* wgpu_context,
+                                     const WGPUBindGroupDescriptor* descriptor);
+
+/* Evicts the entries not requested recently, called on present */
+void wgpu_bind_group_cache_end_frame(wgpu_bind_group_cache_t* bind_group_cache);
+
+/* Releases all cached bind groups */
+void wgpu_bind_group_cache_clear(wgpu_context_t* wgpu_context);
+
+#endif /* BIND_GROUP_CACHE_H */
@@ -0,0 +1,723 @@
+#include "bloom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
+#include "shader.h"
+
+/* Uniform slots: the downsample passes, the upsample passes, the composite */
+#define BLOOM_DOWNSAMPLE_SLOT(level) (level)
+#define BLOOM_UPSAMPLE_SLOT(level) (WGPU_BLOOM_MAX_MIP_COUNT + (level))
+#define BLOOM_COMPOSITE_SLOT (2u * WGPU_BLOOM_MAX_MIP_COUNT)
+#define BLOOM_UNIFORM_SLOT_COUNT (BLOOM_COMPOSITE_SLOT + 1u)
+
+/* Smallest level size of the default mip chain */
+#define BLOOM_MIN_LEVEL_SIZE 4u
+
+// clang-format off
+static const char* bloom_shader_wgsl = CODE(
+  struct Params {
+    texel_size : vec2<f32>,
+    threshold  : f32,
+    knee       : f32,
+    radius     : f32,
+    intensity  : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var src : texture_2d<f32>;
+  @group(0) @binding(2) var src_sampler : sampler;
+
+  var<private> pos : array<vec2<f32>, 3> = array<vec2<f32>, 3>(
+    vec2<f32>(-1.0, -1.0), vec2<f32>(-1.0, 3.0), vec2<f32>(3.0, -1.0)
+  );
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertex_index : u32) -> VertexOutput {
+    var output : VertexOutput;
+    output.uv       = pos[vertex_index] * vec2<f32>(0.5, -0.5) + vec2<f32>(0.5);
+    output.position = vec4<f32>(pos[vertex_index], 0.0, 1.0);
+    return output;
+  }
+
+  fn fetch(uv : vec2<f32>, offset : vec2<f32>) -> vec3<f32> {
+    return textureSampleLevel(src, src_sampler,
+                              uv + offset * params.texel_size, 0.0).rgb;
+  }
+
+  fn karis_weight(c : vec3<f32>) -> f32 {
+    return 1.0 / (1.0 + dot(c, vec3<f32>(0.2126, 0.7152, 0.0722)));
+  }
+
+  fn soft_threshold(c : vec3<f32>) -> vec3<f32> {
+    let brightness = max(c.r, max(c.g, c.b));
+    var soft = clamp(brightness - params.threshold + params.knee, 0.0,
+                     2.0 * params.knee);
+    soft = soft * soft / (4.0 * params.knee + 1e-4);
+    let contribution = max(soft, brightness - params.threshold)
+                       / max(brightness, 1e-4);
+    return c * contribution;
+  }
+
+  struct Taps {
+    center  : vec3<f32>,
+    inner   : array<vec3<f32>, 4>,
+    outer   : array<vec3<f32>, 4>,
+    edge    : array<vec3<f32>, 4>,
+  }
+
+  fn fetch13(uv : vec2<f32>) -> Taps {
+    var taps : Taps;
+    taps.center   = fetch(uv, vec2<f32>( 0.0,  0.0));
+    taps.inner[0] = fetch(uv, vec2<f32>(-1.0,  1.0));
+    taps.inner[1] = fetch(uv, vec2<f32>( 1.0,  1.0));
+    taps.inner[2] = fetch(uv, vec2<f32>(-1.0, -1.0));
+    taps.inner[3] = fetch(uv, vec2<f32>( 1.0, -1.0));
+    taps.outer[0] = fetch(uv, vec2<f32>(-2.0,  2.0));
+    taps.outer[1] = fetch(uv, vec2<f32>( 2.0,  2.0));
+    taps.outer[2] = fetch(uv, vec2<f32>(-2.0, -2.0));
+    taps.outer[3] = fetch(uv, vec2<f32>( 2.0, -2.0));
+    taps.edge[0]  = fetch(uv, vec2<f32>( 0.0,  2.0));
+    taps.edge[1]  = fetch(uv, vec2<f32>(-2.0,  0.0));
+    taps.edge[2]  = fetch(uv, vec2<f32>( 2.0,  0.0));
+    taps.edge[3]  = fetch(uv, vec2<f32>( 0.0, -2.0));
+    return taps;
+  }
+
+  @fragment
+  fn fs_downsample(@location(0) uv : vec2<f32>) -> @location(0) vec4<f32> {
+    let t = fetch13(uv);
+    var c = (t.inner[0] + t.inner[1] + t.inner[2] + t.inner[3]) * 0.125;
+    c += (t.outer[0] + t.outer[1] + t.outer[2] + t.outer[3]) * 0.03125;
+    c += (t.edge[0] + t.edge[1] + t.edge[2] + t.edge[3]) * 0.0625;
+    c += t.center * 0.125;
+    return vec4<f32>(c, 1.0);
+  }
+
+  @fragment
+  fn fs_prefilter(@location(0) uv : vec2<f32>) -> @location(0) vec4<f32> {
+    let t = fetch13(uv);
+    var groups = array<vec3<f32>, 5>(
+      (t.inner[0] + t.inner[1] + t.inner[2] + t.inner[3]) * 0.25,
+      (t.outer[0] + t.edge[0] + t.edge[1] + t.center) * 0.25,
+      (t.edge[0] + t.outer[1] + t.center + t.edge[2]) * 0.25,
+      (t.edge[1] + t.center + t.outer[2] + t.edge[3]) * 0.25,
+      (t.center + t.edge[2] + t.edge[3] + t.outer[3]) * 0.25
+    );
+    var weights = array<f32, 5>(0.5, 0.125, 0.125, 0.125, 0.125);
+    var c = vec3<f32>(0.0);
+    var weight_sum = 0.0;
+    for (var i = 0u; i < 5u; i++) {
+      let w = weights[i] * karis_weight(groups[i]);
+      c += groups[i] * w;
+      weight_sum += w;
+    }
+    return vec4<f32>(soft_threshold(c / weight_sum), 1.0);
+  }
+
+  fn tent9(uv : vec2<f32>) -> vec3<f32> {
+    let r = params.radius;
+    var c = fetch(uv, vec2<f32>(0.0, 0.0)) * 4.0;
+    c += (fetch(uv, vec2<f32>(0.0, r)) + fetch(uv, vec2<f32>(-r, 0.0))
+          + fetch(uv, vec2<f32>(r, 0.0)) + fetch(uv, vec2<f32>(0.0, -r)))
+         * 2.0;
+    c += fetch(uv, vec2<f32>(-r, r)) + fetch(uv, vec2<f32>(r, r))
+         + fetch(uv, vec2<f32>(-r, -r)) + fetch(uv, vec2<f32>(r, -r));
+    return c * (1.0 / 16.0);
+  }
+
+  @fragment
+  fn fs_upsample(@location(0) uv : vec2<f32>) -> @location(0) vec4<f32> {
+    return vec4<f32>(tent9(uv), 1.0);
+  }
+
+  @fragment
+  fn fs_composite(@location(0) uv : vec2<f32>) -> @location(0) vec4<f32> {
+    return vec4<f32>(tent9(uv) * params.intensity, 1.0);
+  }
+);
+// clang-format on
+
+/* Per pass uniforms, layout of the WGSL Params struct */
+typedef struct bloom_uniforms_t {
+  float texel_size[2];
+  float threshold;
+  float knee;
+  float radius;
+  float intensity;
+  float padding[2];
+} bloom_uniforms_t;
+
+/**
+ * @brief Bloom class
+ */
+struct wgpu_bloom {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  WGPUTextureFormat format;
+  WGPUTextureFormat composite_format;
+  WGPUTextureFormat composite_depth_stencil_format;
+  bool unfilterable_source;
+  uint32_t requested_mip_count;
+  wgpu_bloom_params_t params;
+  /* Source size */
+  uint32_t width;
+  uint32_t height;
+  /* Mip chain */
+  uint32_t mip_count;
+  uint32_t mip_widths[WGPU_BLOOM_MAX_MIP_COUNT];
+  uint32_t mip_heights[WGPU_BLOOM_MAX_MIP_COUNT];
+  WGPUTexture texture;
+  WGPUTextureView mip_views[WGPU_BLOOM_MAX_MIP_COUNT];
+  /* Bind groups of the levels sampled by the passes, the source bind group
+   * of the first downsample pass is taken from the bind group cache */
+  WGPUBindGroup downsample_bind_groups[WGPU_BLOOM_MAX_MIP_COUNT];
+  WGPUBindGroup upsample_bind_groups[WGPU_BLOOM_MAX_MIP_COUNT];
+  WGPUBindGroup composite_bind_group;
+  /* Shared objects */
+  WGPUSampler sampler;
+  WGPUBuffer uniform_buffer;
+  uint32_t uniform_stride;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  /* Layouts of the first downsample pass for unfilterable sources, the shared
+   * layouts otherwise */
+  WGPUBindGroupLayout source_bind_group_layout;
+  WGPUPipelineLayout source_pipeline_layout;
+  WGPUSampler source_sampler;
+  WGPURenderPipeline prefilter_pipeline;
+  WGPURenderPipeline downsample_pipeline;
+  WGPURenderPipeline upsample_pipeline;
+  WGPURenderPipeline composite_pipeline;
+};
+
+/* Pipelines */
+
+static WGPURenderPipeline
+bloom_create_pipeline(wgpu_bloom_t* bloom, WGPUPipelineLayout layout,
+                      const char* fragment_entry, WGPUTextureFormat format,
+                      bool additive, WGPUTextureFormat depth_stencil_format)
+{
+  wgpu_context_t* wgpu_context = bloom->wgpu_context;
+
+  // Additive blending of the upsampled levels and the composite
+  WGPUBlendState blend_state = {
+    .color.operation = WGPUBlendOperation_Add,
+    .color.srcFactor = WGPUBlendFactor_One,
+    .color.dstFactor = WGPUBlendFactor_One,
+    .alpha.operation = WGPUBlendOperation_Add,
+    .alpha.srcFactor = WGPUBlendFactor_Zero,
+    .alpha.dstFactor = WGPUBlendFactor_One,
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = format,
+    .blend     = additive ? &blend_state : NULL,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // The composite is drawn in render passes with a depth attachment
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = depth_stencil_format,
+      .depth_write_enabled = false,
+    });
+  depth_stencil_state.depthCompare = WGPUCompareFunction_Always;
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Bloom vertex shader",
+                      .wgsl_code.source = bloom_shader_wgsl,
+                      .entry            = "vs_main",
+                    },
+                  });
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Bloom fragment shader",
+                      .wgsl_code.source = bloom_shader_wgsl,
+                      .entry            = fragment_entry,
+                    },
+                    .target_count = 1,
+                    .targets      = &color_target_state,
+                  });
+
+  WGPURenderPipeline pipeline = wgpu_create_render_pipeline(
+    wgpu_context,
+    &(WGPURenderPipelineDescriptor){
+      .label     = bloom->label,
+      .layout    = layout,
+      .primitive = {
+        .topology  = WGPUPrimitiveTopology_TriangleList,
+        .frontFace = WGPUFrontFace_CCW,
+        .cullMode  = WGPUCullMode_None,
+      },
+      .vertex       = vertex_state,
+      .fragment     = &fragment_state,
+      .depthStencil = depth_stencil_format != WGPUTextureFormat_Undefined ?
+                        &depth_stencil_state :
+                        NULL,
+      .multisample  = wgpu_create_multisample_state_descriptor(
+        &(create_multisample_state_desc_t){
+          .sample_count = 1,
+        }),
+    });
+  ASSERT(pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module)
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module)
+
+  return pipeline;
+}
+
+static void bloom_create_pipelines(wgpu_bloom_t* bloom)
+{
+  WGPUDevice device = bloom->wgpu_context->device;
+
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Pass parameters
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(bloom_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Sampled level
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Bilinear sampler
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+  };
+  bloom->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Bloom bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(bloom->bind_group_layout != NULL);
+
+  bloom->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Bloom pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &bloom->bind_group_layout,
+            });
+  ASSERT(bloom->pipeline_layout != NULL);
+
+  // Unfilterable sources are sampled with a non-filtering sampler, the taps
+  // of the first downsample pass read the nearest source texels
+  bloom->source_bind_group_layout = bloom->bind_group_layout;
+  bloom->source_pipeline_layout   = bloom->pipeline_layout;
+  if (bloom->unfilterable_source) {
+    bgl_entries[1].texture.sampleType = WGPUTextureSampleType_UnfilterableFloat;
+    bgl_entries[2].sampler.type       = WGPUSamplerBindingType_NonFiltering;
+    bloom->source_bind_group_layout   = wgpuDeviceCreateBindGroupLayout(
+      device, &(WGPUBindGroupLayoutDescriptor){
+                .label      = "Bloom source bind group layout",
+                .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                .entries    = bgl_entries,
+              });
+    ASSERT(bloom->source_bind_group_layout != NULL);
+
+    bloom->source_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      device, &(WGPUPipelineLayoutDescriptor){
+                .label                = "Bloom source pipeline layout",
+                .bindGroupLayoutCount = 1,
+                .bindGroupLayouts     = &bloom->source_bind_group_layout,
+              });
+    ASSERT(bloom->source_pipeline_layout != NULL);
+  }
+
+  bloom->prefilter_pipeline
+    = bloom_create_pipeline(bloom, bloom->source_pipeline_layout,
+                            "fs_prefilter", bloom->format, false,
+                            WGPUTextureFormat_Undefined);
+  bloom->downsample_pipeline = bloom_create_pipeline(
+    bloom, bloom->pipeline_layout, "fs_downsample", bloom->format, false,
+    WGPUTextureFormat_Undefined);
+  bloom->upsample_pipeline = bloom_create_pipeline(
+    bloom, bloom->pipeline_layout, "fs_upsample", bloom->format, true,
+    WGPUTextureFormat_Undefined);
+  if (bloom->composite_format != WGPUTextureFormat_Undefined) {
+    bloom->composite_pipeline = bloom_create_pipeline(
+      bloom, bloom->pipeline_layout, "fs_composite", bloom->composite_format,
+      true, bloom->composite_depth_stencil_format);
+  }
+}
+
+/* Uniforms */
+
+static void bloom_set_uniforms(bloom_uniforms_t* uniforms,
+                               const wgpu_bloom_params_t* params,
+                               uint32_t width, uint32_t height)
+{
+  *uniforms = (bloom_uniforms_t){
+    .texel_size = {1.0f / (float)width, 1.0f / (float)height},
+    .threshold  = params->threshold,
+    .knee       = params->knee,
+    .radius     = params->radius,
+    .intensity  = params->intensity,
+  };
+}
+
+static void bloom_write_uniforms(wgpu_bloom_t* bloom)
+{
+  const uint32_t stride = bloom->uniform_stride;
+  uint8_t* data         = (uint8_t*)calloc(BLOOM_UNIFORM_SLOT_COUNT, stride);
+
+  for (uint32_t i = 0; i < bloom->mip_count; ++i) {
+    // Downsample pass i samples the source or level i - 1
+    bloom_set_uniforms(
+      (bloom_uniforms_t*)(data + BLOOM_DOWNSAMPLE_SLOT(i) * stride),
+      &bloom->params, i == 0 ? bloom->width : bloom->mip_widths[i - 1],
+      i == 0 ? bloom->height : bloom->mip_heights[i - 1]);
+    // Upsample pass i samples level i
+    bloom_set_uniforms(
+      (bloom_uniforms_t*)(data + BLOOM_UPSAMPLE_SLOT(i) * stride),
+      &bloom->params, bloom->mip_widths[i], bloom->mip_heights[i]);
+  }
+  bloom_set_uniforms(
+    (bloom_uniforms_t*)(data + BLOOM_COMPOSITE_SLOT * stride), &bloom->params,
+    bloom->mip_widths[0], bloom->mip_heights[0]);
+
+  wgpu_queue_write_buffer(bloom->wgpu_context, bloom->uniform_buffer, 0, data,
+                          BLOOM_UNIFORM_SLOT_COUNT * stride);
+  free(data);
+}
+
+/* Mip chain */
+
+static WGPUBindGroup bloom_create_bind_group(wgpu_bloom_t* bloom,
+                                             uint32_t slot,
+                                             WGPUTextureView view,
+                                             bool source)
+{
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = bloom->uniform_buffer,
+      .offset  = slot * bloom->uniform_stride,
+      .size    = sizeof(bloom_uniforms_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = view,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .sampler = source ? bloom->source_sampler : bloom->sampler,
+    },
+  };
+  return wgpu_create_bind_group(
+    bloom->wgpu_context, &(WGPUBindGroupDescriptor){
+                           .label      = "Bloom bind group",
+                           .layout     = source ?
+                                           bloom->source_bind_group_layout :
+                                           bloom->bind_group_layout,
+                           .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                           .entries    = bg_entries,
+                         });
+}
+
+static void bloom_release_mip_chain(wgpu_bloom_t* bloom)
+{
+  for (uint32_t i = 0; i < bloom->mip_count; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, bloom->downsample_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, bloom->upsample_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(TextureView, bloom->mip_views[i])
+  }
+  WGPU_RELEASE_RESOURCE(BindGroup, bloom->composite_bind_group)
+  WGPU_RELEASE_RESOURCE(Texture, bloom->texture)
+  bloom->mip_count = 0;
+}
+
+static void bloom_create_mip_chain(wgpu_bloom_t* bloom)
+{
+  const uint32_t width  = MAX(bloom->width / 2, 1u);
+  const uint32_t height = MAX(bloom->height / 2, 1u);
+
+  // Level count down to the smallest level size
+  uint32_t mip_count = bloom->requested_mip_count;
+  if (mip_count == 0) {
+    mip_count = 1;
+    uint32_t size = MIN(width, height);
+    while (size >= 2 * BLOOM_MIN_LEVEL_SIZE
+           && mip_count < WGPU_BLOOM_MAX_MIP_COUNT) {
+      size /= 2;
+      ++mip_count;
+    }
+  }
+  bloom->mip_count = MIN(mip_count, WGPU_BLOOM_MAX_MIP_COUNT);
+
+  bloom->texture = wgpuDeviceCreateTexture(
+    bloom->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = bloom->label,
+      .usage         = WGPUTextureUsage_RenderAttachment
+                       | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = width,
+        .height             = height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = bloom->format,
+      .mipLevelCount = bloom->mip_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(bloom->texture != NULL);
+
+  for (uint32_t i = 0; i < bloom->mip_count; ++i) {
+    bloom->mip_widths[i]  = MAX(width >> i, 1u);
+    bloom->mip_heights[i] = MAX(height >> i, 1u);
+    bloom->mip_views[i]   = wgpuTextureCreateView(
+      bloom->texture, &(WGPUTextureViewDescriptor){
+                        .label           = "Bloom level texture view",
+                        .format          = bloom->format,
+                        .dimension       = WGPUTextureViewDimension_2D,
+                        .baseMipLevel    = i,
+                        .mipLevelCount   = 1,
+                        .baseArrayLayer  = 0,
+                        .arrayLayerCount = 1,
+                      });
+    ASSERT(bloom->mip_views[i] != NULL);
+  }
+
+  // Downsample pass i > 0 samples level i - 1, upsample pass i samples level i
+  for (uint32_t i = 0; i < bloom->mip_count; ++i) {
+    if (i > 0) {
+      bloom->downsample_bind_groups[i] = bloom_create_bind_group(
+        bloom, BLOOM_DOWNSAMPLE_SLOT(i), bloom->mip_views[i - 1], false);
+    }
+    bloom->upsample_bind_groups[i] = bloom_create_bind_group(
+      bloom, BLOOM_UPSAMPLE_SLOT(i), bloom->mip_views[i], false);
+  }
+  bloom->composite_bind_group = bloom_create_bind_group(
+    bloom, BLOOM_COMPOSITE_SLOT, bloom->mip_views[0], false);
+
+  bloom_write_uniforms(bloom);
+}
+
+/* Bloom creating / destroying */
+
+wgpu_bloom_t* wgpu_bloom_create(wgpu_context_t* wgpu_context,
+                                const wgpu_bloom_desc_t* desc)
+{
+  ASSERT(desc->width > 0 && desc->height > 0);
+
+  WGPUSupportedLimits supported_limits = {0};
+  wgpuDeviceGetLimits(wgpu_context->device, &supported_limits);
+
+  wgpu_bloom_t* bloom = (wgpu_bloom_t*)calloc(1, sizeof(*bloom));
+  bloom->wgpu_context = wgpu_context;
+  bloom->label        = desc->label != NULL ? desc->label : "Bloom";
+  bloom->format       = desc->format != WGPUTextureFormat_Undefined ?
+                          desc->format :
+                          WGPUTextureFormat_RGBA16Float;
+  bloom->composite_format               = desc->composite_format;
+  bloom->composite_depth_stencil_format = desc->composite_depth_stencil_format;
+  bloom->unfilterable_source            = desc->unfilterable_source;
+  bloom->requested_mip_count            = desc->mip_count;
+  bloom->width                          = desc->width;
+  bloom->height                         = desc->height;
+
+  bloom->params.threshold = 1.0f;
+  bloom->params.knee      = 0.5f;
+  bloom->params.radius    = 1.0f;
+  bloom->params.intensity = 1.0f;
+
+  // One uniform slot per pass at the uniform buffer offset alignment
+  const uint32_t alignment
+    = supported_limits.limits.minUniformBufferOffsetAlignment > 0 ?
+        supported_limits.limits.minUniformBufferOffsetAlignment :
+        256u;
+  bloom->uniform_stride
+    = (sizeof(bloom_uniforms_t) + alignment - 1) / alignment * alignment;
+  bloom->uniform_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Bloom uniform buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = BLOOM_UNIFORM_SLOT_COUNT * bloom->uniform_stride,
+    });
+  ASSERT(bloom->uniform_buffer != NULL);
+
+  bloom->sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .label         = "Bloom sampler",
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Nearest,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = 1.0f,
+                    .maxAnisotropy = 1,
+                  });
+  ASSERT(bloom->sampler != NULL);
+
+  bloom->source_sampler = bloom->sampler;
+  if (bloom->unfilterable_source) {
+    bloom->source_sampler = wgpu_create_sampler(
+      wgpu_context, &(WGPUSamplerDescriptor){
+                      .label         = "Bloom source sampler",
+                      .addressModeU  = WGPUAddressMode_ClampToEdge,
+                      .addressModeV  = WGPUAddressMode_ClampToEdge,
+                      .addressModeW  = WGPUAddressMode_ClampToEdge,
+                      .minFilter     = WGPUFilterMode_Nearest,
+                      .magFilter     = WGPUFilterMode_Nearest,
+                      .mipmapFilter  = WGPUFilterMode_Nearest,
+                      .lodMinClamp   = 0.0f,
+                      .lodMaxClamp   = 1.0f,
+                      .maxAnisotropy = 1,
+                    });
+    ASSERT(bloom->source_sampler != NULL);
+  }
+
+  bloom_create_pipelines(bloom);
+  bloom_create_mip_chain(bloom);
+
+  return bloom;
+}
+
+void wgpu_bloom_destroy(wgpu_bloom_t* bloom)
+{
+  if (bloom == NULL) {
+    return;
+  }
+
+  bloom_release_mip_chain(bloom);
+  WGPU_RELEASE_RESOURCE(RenderPipeline, bloom->prefilter_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, bloom->downsample_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, bloom->upsample_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, bloom->composite_pipeline)
+  if (bloom->unfilterable_source) {
+    WGPU_RELEASE_RESOURCE(PipelineLayout, bloom->source_pipeline_layout)
+    WGPU_RELEASE_RESOURCE(BindGroupLayout, bloom->source_bind_group_layout)
+    WGPU_RELEASE_RESOURCE(Sampler, bloom->source_sampler)
+  }
+  WGPU_RELEASE_RESOURCE(PipelineLayout, bloom->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bloom->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, bloom->sampler)
+  WGPU_RELEASE_RESOURCE(Buffer, bloom->uniform_buffer)
+  free(bloom);
+}
+
+void wgpu_bloom_resize(wgpu_bloom_t* bloom, uint32_t width, uint32_t height)
+{
+  ASSERT(width > 0 && height > 0);
+
+  if (width == bloom->width && height == bloom->height) {
+    return;
+  }
+
+  bloom_release_mip_chain(bloom);
+  bloom->width  = width;
+  bloom->height = height;
+  bloom_create_mip_chain(bloom);
+}
+
+/* Parameters */
+
+void wgpu_bloom_set_params(wgpu_bloom_t* bloom,
+                           const wgpu_bloom_params_t* params)
+{
+  bloom->params = *params;
+  bloom_write_uniforms(bloom);
+}
+
+void wgpu_bloom_get_params(wgpu_bloom_t* bloom, wgpu_bloom_params_t* params)
+{
+  *params = bloom->params;
+}
+
+/* Rendering */
+
+static void bloom_draw_pass(WGPUCommandEncoder cmd_enc, WGPUTextureView target,
+                            WGPULoadOp load_op, WGPURenderPipeline pipeline,
+                            WGPUBindGroup bind_group)
+{
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .colorAttachmentCount = 1,
+               .colorAttachments     = &(WGPURenderPassColorAttachment){
+                 .view       = target,
+                 .loadOp     = load_op,
+                 .storeOp    = WGPUStoreOp_Store,
+                 .clearColor = (WGPUColor){0.0f, 0.0f, 0.0f, 1.0f},
+               },
+             });
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_group, 0, 0);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+}
+
+void wgpu_bloom_encode(wgpu_bloom_t* bloom, WGPUCommandEncoder cmd_enc,
+                       WGPUTextureView source)
+{
+  ASSERT(source != NULL);
+
+  // Downsample chain, the first level is filtered from the source
+  WGPUBindGroup source_bind_group
+    = bloom_create_bind_group(bloom, BLOOM_DOWNSAMPLE_SLOT(0), source, true);
+  bloom_draw_pass(cmd_enc, bloom->mip_views[0], WGPULoadOp_Clear,
+                  bloom->prefilter_pipeline, source_bind_group);
+  WGPU_RELEASE_RESOURCE(BindGroup, source_bind_group)
+  for (uint32_t i = 1; i < bloom->mip_count; ++i) {
+    bloom_draw_pass(cmd_enc, bloom->mip_views[i], WGPULoadOp_Clear,
+                    bloom->downsample_pipeline,
+                    bloom->downsample_bind_groups[i]);
+  }
+
+  // Upsample chain, each level is added to the next larger one
+  for (uint32_t i = bloom->mip_count - 1; i > 0; --i) {
+    bloom_draw_pass(cmd_enc, bloom->mip_views[i - 1], WGPULoadOp_Load,
+                    bloom->upsample_pipeline, bloom->upsample_bind_groups[i]);
+  }
+}
+
+void wgpu_bloom_composite(wgpu_bloom_t* bloom, WGPURenderPassEncoder rpass_enc)
+{
+  ASSERT(bloom->composite_pipeline != NULL);
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, bloom->composite_pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bloom->composite_bind_group,
+                                    0, 0);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+}
+
+WGPUTextureView wgpu_bloom_get_texture_view(wgpu_bloom_t* bloom)
+{
+  return bloom->mip_views[0];
+}
+
+uint32_t wgpu_bloom_get_mip_count(wgpu_bloom_t* bloom)
+{
+  return bloom->mip_count;
+}
@@ -0,0 +1,87 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "context.h"
+
+#define WGPU_BLOOM_MAX_MIP_COUNT 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU bloom
+ *
+ * Progressive downsample / upsample bloom (Jimenez, "Next Generation Post
+ * Processing in Call of Duty: Advanced Warfare", SIGGRAPH 2014). The source is
+ * filtered into a mip chain starting at half its resolution:
+ *
+ *   - downsample: 13-tap filter per level, the first level applies the soft
+ *     threshold and the Karis average against fireflies
+ *   - upsample: 3x3 tent filter from the smallest level up, each level is
+ *     added to the next larger one
+ *
+ * Every level costs 13 + 9 fetches at a quarter of the texels of the previous
+ * level, so the blur radius grows with the chain length while the cost stays
+ * close to a single full resolution pass of the first level.
+ *
+ *   wgpu_bloom_encode(bloom, cmd_enc, scene_view);
+ *   ...
+ *   wgpu_bloom_composite(bloom, rpass_enc);  adds the bloom to the target
+ *
+ * The result can also be sampled directly from wgpu_bloom_get_texture_view().
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_bloom wgpu_bloom_t;
+
+typedef struct wgpu_bloom_desc_t {
+  const char* label;
+  /* Size of the source texture */
+  uint32_t width;
+  uint32_t height;
+  /* Levels of the mip chain, 0 = down to 4 texels */
+  uint32_t mip_count;
+  /* Format of the mip chain, WGPUTextureFormat_Undefined = RGBA16Float */
+  WGPUTextureFormat format;
+  /* Render pass formats of wgpu_bloom_composite(), Undefined = no composite
+   * pipeline / no depth stencil attachment */
+  WGPUTextureFormat composite_format;
+  WGPUTextureFormat composite_depth_stencil_format;
+  /* The source is read without filtering, for unfilterable source formats
+   * such as RGBA32Float */
+  bool unfilterable_source;
+} wgpu_bloom_desc_t;
+
+typedef struct wgpu_bloom_params_t {
+  /* Brightness the bloom starts at, 0 = the whole source blooms */
+  float threshold;
+  /* Width of the soft transition below the threshold */
+  float knee;
+  /* Upsample filter radius in texels */
+  float radius;
+  /* Scale of the bloom added by wgpu_bloom_composite() */
+  float intensity;
+} wgpu_bloom_params_t;
+
+/* Bloom creating / destroying */
+wgpu_bloom_t* wgpu_bloom_create(wgpu_context_t* wgpu_context,
+                                const wgpu_bloom_desc_t* desc);
+void wgpu_bloom_destroy(wgpu_bloom_t* bloom);
+
+/* Recreates the mip chain for a new source size */
+void wgpu_bloom_resize(wgpu_bloom_t* bloom, uint32_t width, uint32_t height);
+
+/* Defaults: threshold 1.0, knee 0.5, radius 1.0, intensity 1.0 */
+void wgpu_bloom_set_params(wgpu_bloom_t* bloom,
+                           const wgpu_bloom_params_t* params);
+void wgpu_bloom_get_params(wgpu_bloom_t* bloom, wgpu_bloom_params_t* params);
+
+/* Records the downsample and upsample passes of the source texture view */
+void wgpu_bloom_encode(wgpu_bloom_t* bloom, WGPUCommandEncoder cmd_enc,
+                       WGPUTextureView source);
+
+/* Adds the bloom to the color target of the render pass */
+void wgpu_bloom_composite(wgpu_bloom_t* bloom,
+                          WGPURenderPassEncoder rpass_enc);
+
+/* Largest level of the mip chain holding the bloom, half the source size */
+WGPUTextureView wgpu_bloom_get_texture_view(wgpu_bloom_t* bloom);
+uint32_t wgpu_bloom_get_mip_count(wgpu_bloom_t* bloom);
+
+#endif /* BLOOM_H */
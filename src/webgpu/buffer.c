@@ -1,10 +1,13 @@
 #include "buffer.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#include "../core/log.h"
 #include "../core/macro.h"
 
 #include "context.h"
+#include "upload_batch.h"
 
 wgpu_buffer_t wgpu_create_buffer(struct wgpu_context_t* wgpu_context,
                                  const wgpu_buffer_desc_t* desc)
@@ -44,6 +47,20 @@ wgpu_buffer_t wgpu_create_buffer(struct wgpu_context_t* wgpu_context,
       = wgpuDeviceCreateBuffer(wgpu_context->device, &buffer_desc);
     ASSERT(wgpu_buffer.buffer != NULL);
   }
+
+  if (desc->shadow.enabled) {
+    ASSERT(desc->usage & WGPUBufferUsage_CopyDst);
+    wgpu_buffer_shadow_t* shadow
+      = (wgpu_buffer_shadow_t*)calloc(1, sizeof(wgpu_buffer_shadow_t));
+    shadow->owns_data = desc->shadow.data == NULL;
+    shadow->data      = shadow->owns_data ? (uint8_t*)calloc(1, size) :
+                                            (uint8_t*)desc->shadow.data;
+    if (shadow->owns_data && buffer_desc.mappedAtCreation) {
+      memcpy(shadow->data, desc->initial.data, initial_size);
+    }
+    wgpu_buffer.shadow = shadow;
+  }
+
   return wgpu_buffer;
 }
 
@@ -51,6 +68,99 @@ void wgpu_destroy_buffer(wgpu_buffer_t* buffer)
 {
   ASSERT(buffer->buffer);
   WGPU_RELEASE_RESOURCE(Buffer, buffer->buffer)
+  if (buffer->shadow != NULL) {
+    if (buffer->shadow->owns_data) {
+      free(buffer->shadow->data);
+    }
+    free(buffer->shadow);
+    buffer->shadow = NULL;
+  }
+}
+
+/* Partial updates of buffers with a shadow copy */
+
+void wgpu_buffer_write(wgpu_buffer_t* buffer, uint32_t offset,
+                       const void* data, uint32_t size)
+{
+  ASSERT(buffer->shadow != NULL && data != NULL);
+  ASSERT(offset + size <= buffer->size);
+
+  memcpy(buffer->shadow->data + offset, data, size);
+  wgpu_buffer_mark_dirty(buffer, offset, size);
+}
+
+void wgpu_buffer_mark_dirty(wgpu_buffer_t* buffer, uint32_t offset,
+                            uint32_t size)
+{
+  ASSERT(buffer->shadow != NULL);
+  if (size == 0) {
+    return;
+  }
+
+  /* Queue writes require 4 bytes aligned offsets and sizes */
+  wgpu_buffer_shadow_t* shadow = buffer->shadow;
+  uint32_t begin               = offset & ~3u;
+  uint32_t end                 = MIN((offset + size + 3u) & ~3u, buffer->size);
+
+  /* Merge with the overlapping and adjacent ranges, the ranges before stay in
+   * place and the ranges after move to close the gap */
+  uint32_t first = 0;
+  while (first < shadow->dirty_range_count
+         && shadow->dirty_ranges[first].end < begin) {
+    ++first;
+  }
+  uint32_t last = first;
+  while (last < shadow->dirty_range_count
+         && shadow->dirty_ranges[last].begin <= end) {
+    begin = MIN(begin, shadow->dirty_ranges[last].begin);
+    end   = MAX(end, shadow->dirty_ranges[last].end);
+    ++last;
+  }
+  const uint32_t merged_count = last - first;
+  if (merged_count != 1) {
+    memmove(&shadow->dirty_ranges[first + 1], &shadow->dirty_ranges[last],
+            (shadow->dirty_range_count - last)
+              * sizeof(shadow->dirty_ranges[0]));
+    shadow->dirty_range_count = shadow->dirty_range_count + 1 - merged_count;
+  }
+  shadow->dirty_ranges[first].begin = begin;
+  shadow->dirty_ranges[first].end   = end;
+
+  /* One slot is kept free for the next insertion, the two closest ranges are
+   * merged uploading the gap in between */
+  if (shadow->dirty_range_count == WGPU_BUFFER_MAX_DIRTY_RANGES) {
+    uint32_t closest = 0;
+    for (uint32_t i = 1; i + 1 < shadow->dirty_range_count; ++i) {
+      if (shadow->dirty_ranges[i + 1].begin - shadow->dirty_ranges[i].end
+          < shadow->dirty_ranges[closest + 1].begin
+              - shadow->dirty_ranges[closest].end) {
+        closest = i;
+      }
+    }
+    shadow->dirty_ranges[closest].end = shadow->dirty_ranges[closest + 1].end;
+    memmove(&shadow->dirty_ranges[closest + 1],
+            &shadow->dirty_ranges[closest + 2],
+            (shadow->dirty_range_count - closest - 2)
+              * sizeof(shadow->dirty_ranges[0]));
+    --shadow->dirty_range_count;
+  }
+}
+
+void wgpu_buffer_flush(struct wgpu_context_t* wgpu_context,
+                       wgpu_buffer_t* buffer)
+{
+  wgpu_buffer_shadow_t* shadow = buffer->shadow;
+  if (shadow == NULL || buffer->buffer == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < shadow->dirty_range_count; ++i) {
+    const uint32_t begin = shadow->dirty_ranges[i].begin;
+    const uint32_t end   = shadow->dirty_ranges[i].end;
+    wgpu_queue_write_buffer(wgpu_context, buffer->buffer, begin,
+                            shadow->data + begin, end - begin);
+  }
+  shadow->dirty_range_count = 0;
 }
 
 void wgpu_record_copy_data_to_buffer(struct wgpu_context_t* wgpu_context,
@@ -65,38 +175,159 @@ void wgpu_record_copy_data_to_buffer(struct wgpu_context_t* wgpu_context,
     && (buff->usage & (WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc)));*/
   ASSERT(buff_size % 4 == 0);
 
-  WGPUBufferDescriptor staging_buffer_desc = {
-    .usage            = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
-    .size             = buff_size,
-    .mappedAtCreation = true,
-  };
+  if (wgpu_context->staging_pool == NULL) {
+    wgpu_context->staging_pool = wgpu_staging_pool_create(wgpu_context);
+  }
 
-  WGPUBuffer staging
-    = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
-  ASSERT(staging != NULL);
-  void* mapping = wgpuBufferGetMappedRange(staging, 0, buff_size);
-  ASSERT(mapping != NULL);
+  void* mapping      = NULL;
+  WGPUBuffer staging = wgpu_staging_pool_acquire(wgpu_context->staging_pool,
+                                                 buff_size, &mapping);
+  ASSERT(staging != NULL && mapping != NULL);
   memcpy(mapping, data, data_size);
   wgpuBufferUnmap(staging);
 
   wgpuCommandEncoderCopyBufferToBuffer(wgpu_context->cmd_enc, staging, 0,
                                        buff->buffer, buff_offset, buff_size);
-  WGPU_RELEASE_RESOURCE(Buffer, staging);
 }
 
-WGPUCommandBuffer wgpu_copy_buffer_to_texture(
-  struct wgpu_context_t* wgpu_context, WGPUImageCopyBuffer* buffer_copy_view,
-  WGPUImageCopyTexture* texture_copy_view, WGPUExtent3D* texture_size)
+/* Staging buffer pool */
+
+typedef enum wgpu_staging_buffer_state_t {
+  StagingBuffer_State_Available = 0, /* mapped, ready to be written */
+  StagingBuffer_State_InUse     = 1, /* copy source in the current frame */
+  StagingBuffer_State_Mapping   = 2, /* waiting for the GPU to finish */
+} wgpu_staging_buffer_state_t;
+
+typedef struct wgpu_staging_buffer_t {
+  WGPUBuffer buffer;
+  uint64_t size;
+  wgpu_staging_buffer_state_t state;
+} wgpu_staging_buffer_t;
+
+struct wgpu_staging_pool {
+  struct wgpu_context_t* wgpu_context;
+  wgpu_staging_buffer_t** buffers;
+  uint32_t buffer_count;
+  uint32_t capacity;
+};
+
+wgpu_staging_pool_t*
+wgpu_staging_pool_create(struct wgpu_context_t* wgpu_context)
 {
-  WGPUCommandEncoder cmd_encoder
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-  wgpuCommandEncoderCopyBufferToTexture(cmd_encoder, buffer_copy_view,
-                                        texture_copy_view, texture_size);
-  WGPUCommandBuffer command_buffer
-    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
-  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+  wgpu_staging_pool_t* pool
+    = (wgpu_staging_pool_t*)malloc(sizeof(wgpu_staging_pool_t));
+  memset(pool, 0, sizeof(wgpu_staging_pool_t));
+  pool->wgpu_context = wgpu_context;
 
-  ASSERT(command_buffer != NULL);
+  return pool;
+}
+
+void wgpu_staging_pool_release(wgpu_staging_pool_t* pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < pool->buffer_count; ++i) {
+    wgpu_staging_buffer_t* staging = pool->buffers[i];
+    if (staging->state != StagingBuffer_State_InUse) {
+      /* Cancels pending map requests */
+      wgpuBufferUnmap(staging->buffer);
+    }
+    WGPU_RELEASE_RESOURCE(Buffer, staging->buffer)
+    free(staging);
+  }
+  free(pool->buffers);
+  free(pool);
+}
+
+/* Smallest power-of-two bucket size that fits the requested size */
+static uint64_t staging_pool_bucket_size(uint64_t size)
+{
+  uint64_t bucket_size = WGPU_STAGING_POOL_MIN_BUCKET_SIZE;
+  while (bucket_size < size) {
+    bucket_size <<= 1;
+  }
+  return bucket_size;
+}
+
+WGPUBuffer wgpu_staging_pool_acquire(wgpu_staging_pool_t* pool, uint64_t size,
+                                     void** mapping)
+{
+  const uint64_t bucket_size = staging_pool_bucket_size(size);
+
+  /* Reuse an available buffer of the bucket */
+  for (uint32_t i = 0; i < pool->buffer_count; ++i) {
+    wgpu_staging_buffer_t* staging = pool->buffers[i];
+    if (staging->size == bucket_size
+        && staging->state == StagingBuffer_State_Available) {
+      staging->state = StagingBuffer_State_InUse;
+      *mapping = wgpuBufferGetMappedRange(staging->buffer, 0, bucket_size);
+      return staging->buffer;
+    }
+  }
+
+  /* Add a new buffer to the bucket */
+  if (pool->buffer_count == pool->capacity) {
+    pool->capacity = pool->capacity > 0 ? pool->capacity * 2 : 16;
+    pool->buffers  = (wgpu_staging_buffer_t**)realloc(
+      pool->buffers, pool->capacity * sizeof(wgpu_staging_buffer_t*));
+  }
+  wgpu_staging_buffer_t* staging
+    = (wgpu_staging_buffer_t*)malloc(sizeof(wgpu_staging_buffer_t));
+  staging->size   = bucket_size;
+  staging->state  = StagingBuffer_State_InUse;
+  staging->buffer = wgpuDeviceCreateBuffer(
+    pool->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label            = "Staging pool buffer",
+      .usage            = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+      .size             = bucket_size,
+      .mappedAtCreation = true,
+    });
+  ASSERT(staging->buffer != NULL);
+  pool->buffers[pool->buffer_count++] = staging;
 
-  return command_buffer;
+  *mapping = wgpuBufferGetMappedRange(staging->buffer, 0, bucket_size);
+  return staging->buffer;
+}
+
+static void staging_buffer_map_cb(WGPUBufferMapAsyncStatus status,
+                                  void* user_data)
+{
+  wgpu_staging_buffer_t* staging = (wgpu_staging_buffer_t*)user_data;
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    staging->state = StagingBuffer_State_Available;
+  }
+  else {
+    /* The buffer stays out of the pool, e.g. when the device is lost */
+    log_warn("Staging buffer mapping failed (status %d)\n", (int)status);
+  }
+}
+
+void wgpu_staging_pool_end_frame(wgpu_staging_pool_t* pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < pool->buffer_count; ++i) {
+    wgpu_staging_buffer_t* staging = pool->buffers[i];
+    if (staging->state == StagingBuffer_State_InUse) {
+      staging->state = StagingBuffer_State_Mapping;
+      wgpuBufferMapAsync(staging->buffer, WGPUMapMode_Write, 0, staging->size,
+                         staging_buffer_map_cb, staging);
+    }
+  }
+}
+
+void wgpu_copy_buffer_to_texture(struct wgpu_context_t* wgpu_context,
+                                 WGPUImageCopyBuffer* buffer_copy_view,
+                                 WGPUImageCopyTexture* texture_copy_view,
+                                 WGPUExtent3D* texture_size)
+{
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  wgpuCommandEncoderCopyBufferToTexture(cmd_encoder, buffer_copy_view,
+                                        texture_copy_view, texture_size);
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
 }
@@ -1,10 +1,14 @@
 #ifndef BUFFER_H_
 #define BUFFER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <dawn/webgpu.h>
 
+/* Dirty ranges of a shadow copy, closest ranges are merged beyond this */
+#define WGPU_BUFFER_MAX_DIRTY_RANGES 16u
+
 /* Forward declarations */
 struct wgpu_context_t;
 
@@ -18,13 +22,36 @@ typedef struct wgpu_buffer_desc_t {
     const void* data;
     uint32_t size;
   } initial;
+  /* CPU shadow copy of the contents for partial updates, see
+   * wgpu_buffer_write() and wgpu_buffer_flush(). The buffer needs the CopyDst
+   * usage. */
+  struct {
+    bool enabled;
+    /* Memory owned by the caller used as shadow copy, of size bytes rounded
+     * up to a multiple of 4. NULL = allocated and initialized with the
+     * initial data. */
+    void* data;
+  } shadow;
 } wgpu_buffer_desc_t;
 
+/* Shadow copy with the changed byte ranges not uploaded yet, the ranges are
+ * sorted and disjoint */
+typedef struct wgpu_buffer_shadow_t {
+  uint8_t* data;
+  bool owns_data;
+  uint32_t dirty_range_count;
+  struct {
+    uint32_t begin;
+    uint32_t end;
+  } dirty_ranges[WGPU_BUFFER_MAX_DIRTY_RANGES];
+} wgpu_buffer_shadow_t;
+
 typedef struct wgpu_buffer_t {
   WGPUBuffer buffer;
   WGPUBufferUsage usage;
   uint32_t size;
   uint32_t count; /* numer of elements in the buffer (optional) */
+  wgpu_buffer_shadow_t* shadow; /* NULL without shadow copy */
 } wgpu_buffer_t;
 
 /* WebGPU buffer creating  / destroy */
@@ -32,17 +59,75 @@ wgpu_buffer_t wgpu_create_buffer(struct wgpu_context_t* wgpu_context,
                                  const wgpu_buffer_desc_t* desc);
 void wgpu_destroy_buffer(wgpu_buffer_t* buffer);
 
+/* Partial updates of buffers with a shadow copy */
+
+/* Copies the data into the shadow copy and marks the range as changed */
+void wgpu_buffer_write(wgpu_buffer_t* buffer, uint32_t offset,
+                       const void* data, uint32_t size);
+
+/* Marks a range of the shadow copy changed in place as changed, the range is
+ * widened to 4 bytes alignment. Overlapping and adjacent ranges are merged. */
+void wgpu_buffer_mark_dirty(wgpu_buffer_t* buffer, uint32_t offset,
+                            uint32_t size);
+
+/**
+ * @brief Uploads the changed ranges of the shadow copy with one queue write
+ * per range, so the upload is proportional to the changed data. The writes
+ * are combined by the write combiner of the context.
+ */
+void wgpu_buffer_flush(struct wgpu_context_t* wgpu_context,
+                       wgpu_buffer_t* buffer);
+
 /*
- * Copies data into buff.buffer via a temporary staging buffer, doesn't submit
- * the resulting command
+ * Copies data into buff.buffer via a staging buffer from the staging pool of
+ * the context, doesn't submit the resulting command
  */
 void wgpu_record_copy_data_to_buffer(struct wgpu_context_t* wgpu_context,
                                      wgpu_buffer_t* buff, uint32_t buff_offset,
                                      uint32_t buff_size, const void* data,
                                      uint32_t data_size);
 
-WGPUCommandBuffer wgpu_copy_buffer_to_texture(
-  struct wgpu_context_t* wgpu_context, WGPUImageCopyBuffer* buffer_copy_view,
-  WGPUImageCopyTexture* texture_copy_view, WGPUExtent3D* texture_size);
+/* -------------------------------------------------------------------------- *
+ * WebGPU staging buffer pool
+ *
+ * MapWrite | CopySrc buffers grouped in power-of-two size buckets. A buffer is
+ * handed out mapped, used as copy source for one frame and mapped again at the
+ * end of the frame. The map request completes once the GPU finished the copy,
+ * after which the buffer is available again.
+ * -------------------------------------------------------------------------- */
+
+#define WGPU_STAGING_POOL_MIN_BUCKET_SIZE 256u
+
+typedef struct wgpu_staging_pool wgpu_staging_pool_t;
+
+/* Staging pool creating / releasing */
+wgpu_staging_pool_t*
+wgpu_staging_pool_create(struct wgpu_context_t* wgpu_context);
+void wgpu_staging_pool_release(wgpu_staging_pool_t* pool);
+
+/**
+ * @brief Returns a mapped staging buffer of at least the specified size. The
+ * buffer must be unmapped and can only be used as copy source until
+ * wgpu_staging_pool_end_frame() is called.
+ * @param mapping pointer to the writable mapped range of the buffer
+ */
+WGPUBuffer wgpu_staging_pool_acquire(wgpu_staging_pool_t* pool, uint64_t size,
+                                     void** mapping);
+
+/**
+ * @brief Recycles the staging buffers used in the current frame, must be
+ * called after the last submit of the frame. This is done by
+ * wgpu_swap_chain_present().
+ */
+void wgpu_staging_pool_end_frame(wgpu_staging_pool_t* pool);
+
+/*
+ * Copies the buffer into the texture, the copy is recorded into the active
+ * upload batch (see upload_batch.h) or submitted at once
+ */
+void wgpu_copy_buffer_to_texture(struct wgpu_context_t* wgpu_context,
+                                 WGPUImageCopyBuffer* buffer_copy_view,
+                                 WGPUImageCopyTexture* texture_copy_view,
+                                 WGPUExtent3D* texture_size);
 
 #endif // BUFFER_H_
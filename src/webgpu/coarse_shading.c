@@ -0,0 +1,803 @@
+#include "coarse_shading.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
+#include "shader.h"
+
+#define COARSE_SHADING_OUTPUT_FORMAT WGPUTextureFormat_RGBA16Float
+/* Evaluated pixels and the tiles per rate */
+#define COARSE_SHADING_COUNTER_COUNT 4u
+#define COARSE_SHADING_COUNTERS_SIZE (COARSE_SHADING_COUNTER_COUNT * 4u)
+
+// clang-format off
+static const char* coarse_shading_kernel_wgsl = CODE(
+  const TILE_SIZE : u32 = 16u;
+
+  struct CoarseShadingParams {
+    size               : vec2<u32>,
+    contrast_threshold : f32,
+    edge_threshold     : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> coarse_shading : CoarseShadingParams;
+  @group(0) @binding(1) var classify_src : texture_2d<f32>;
+  @group(0) @binding(2) var classify_sampler : sampler;
+  @group(0) @binding(3) var output_texture
+    : texture_storage_2d<rgba16float, write>;
+  @group(0) @binding(4) var<storage, read_write> counters
+    : array<atomic<u32>, 4>;
+
+  var<workgroup> tile_luminance : array<f32, 256>;
+  var<workgroup> tile_stats : array<vec4<f32>, 256>;
+  var<workgroup> tile_samples : array<vec4<f32>, 256>;
+  var<workgroup> tile_rate : u32;
+  var<workgroup> tile_shaded : atomic<u32>;
+
+  fn luminance(c : vec3<f32>) -> f32 {
+    return dot(c, vec3<f32>(0.2126, 0.7152, 0.0722));
+  }
+
+  @compute @workgroup_size(16, 16)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>,
+          @builtin(local_invocation_id) local_id : vec3<u32>,
+          @builtin(local_invocation_index) local_index : u32,
+          @builtin(workgroup_id) group_id : vec3<u32>) {
+    let size       = coarse_shading.size;
+    let pixel      = global_id.xy;
+    let inside     = all(pixel < size);
+    let texel_size = 1.0 / vec2<f32>(size);
+
+    // Classification: luminance mean, deviation and largest neighbor
+    // difference of the tile
+    var l = 0.0;
+    if (inside) {
+      let uv = (vec2<f32>(pixel) + 0.5) * texel_size;
+      l = luminance(
+        textureSampleLevel(classify_src, classify_sampler, uv, 0.0).rgb);
+    }
+    tile_luminance[local_index] = l;
+    if (local_index == 0u) {
+      atomicStore(&tile_shaded, 0u);
+    }
+    workgroupBarrier();
+
+    var edge = 0.0;
+    if (local_id.x + 1u < TILE_SIZE && pixel.x + 1u < size.x) {
+      edge = abs(tile_luminance[local_index + 1u] - l);
+    }
+    if (local_id.y + 1u < TILE_SIZE && pixel.y + 1u < size.y) {
+      edge = max(edge, abs(tile_luminance[local_index + TILE_SIZE] - l));
+    }
+    tile_stats[local_index] = select(vec4<f32>(0.0),
+                                     vec4<f32>(l, l * l, edge, 1.0), inside);
+    workgroupBarrier();
+    for (var stride = 128u; stride > 0u; stride = stride >> 1u) {
+      if (local_index < stride) {
+        let a = tile_stats[local_index];
+        let b = tile_stats[local_index + stride];
+        tile_stats[local_index] = vec4<f32>(a.xy + b.xy, max(a.z, b.z),
+                                            a.w + b.w);
+      }
+      workgroupBarrier();
+    }
+
+    if (local_index == 0u) {
+      // The first pixel of a tile is always inside, differences are less
+      // visible in dark tiles
+      let stats      = tile_stats[0];
+      let mean       = stats.x / stats.w;
+      let deviation  = sqrt(max(stats.y / stats.w - mean * mean, 0.0));
+      let adaptation = mean + 0.05;
+      let contrast   = deviation / adaptation;
+      let edges      = stats.z / adaptation;
+      var rate = 1u;
+      if (contrast < 2.0 * coarse_shading.contrast_threshold
+          && edges < 2.0 * coarse_shading.edge_threshold) {
+        rate = 2u;
+      }
+      if (contrast < coarse_shading.contrast_threshold
+          && edges < coarse_shading.edge_threshold) {
+        rate = 4u;
+      }
+      tile_rate = rate;
+      atomicAdd(&counters[1u + rate / 2u], 1u);
+    }
+    workgroupBarrier();
+
+    // Shading: the first pixel of every rate x rate block evaluates the
+    // effect at the block center
+    let rate   = tile_rate;
+    let blocks = TILE_SIZE / rate;
+    let block  = local_id.xy / rate;
+    if (inside && all(local_id.xy % vec2<u32>(rate) == vec2<u32>(0u))) {
+      let uv = (vec2<f32>(pixel) + 0.5 * f32(rate)) * texel_size;
+      tile_samples[block.y * blocks + block.x] = coarse_shading_effect(uv);
+      atomicAdd(&tile_shaded, 1u);
+    }
+    workgroupBarrier();
+
+    // Upsampling: bilinear interpolation between the block centers of the
+    // tile, blocks past the output edge are not evaluated
+    if (inside) {
+      let tile_origin = group_id.xy * TILE_SIZE;
+      let valid
+        = (min(vec2<u32>(TILE_SIZE), size - tile_origin) + rate - 1u) / rate;
+      let p  = (vec2<f32>(local_id.xy) + 0.5) / f32(rate) - 0.5;
+      let p0 = clamp(floor(p), vec2<f32>(0.0), vec2<f32>(valid - 1u));
+      let f  = clamp(p - p0, vec2<f32>(0.0), vec2<f32>(1.0));
+      let b0 = vec2<u32>(p0);
+      let b1 = min(b0 + 1u, valid - 1u);
+      let c00 = tile_samples[b0.y * blocks + b0.x];
+      let c10 = tile_samples[b0.y * blocks + b1.x];
+      let c01 = tile_samples[b1.y * blocks + b0.x];
+      let c11 = tile_samples[b1.y * blocks + b1.x];
+      textureStore(output_texture, vec2<i32>(pixel),
+                   mix(mix(c00, c10, f.x), mix(c01, c11, f.x), f.y));
+    }
+    if (local_index == 0u) {
+      atomicAdd(&counters[0], atomicLoad(&tile_shaded));
+    }
+  }
+);
+
+static const char* coarse_shading_composite_wgsl = CODE(
+  @group(0) @binding(0) var output_texture : texture_2d<f32>;
+
+  var<private> pos : array<vec2<f32>, 3> = array<vec2<f32>, 3>(
+    vec2<f32>(-1.0, -1.0), vec2<f32>(-1.0, 3.0), vec2<f32>(3.0, -1.0)
+  );
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertex_index : u32)
+    -> @builtin(position) vec4<f32> {
+    return vec4<f32>(pos[vertex_index], 0.0, 1.0);
+  }
+
+  // The output has the size of the composite target
+  @fragment
+  fn fs_main(@builtin(position) position : vec4<f32>)
+    -> @location(0) vec4<f32> {
+    return textureLoad(output_texture, vec2<i32>(position.xy), 0);
+  }
+);
+// clang-format on
+
+typedef enum wgpu_coarse_shading_frame_state_t {
+  CoarseShadingFrame_State_Available = 0,
+  CoarseShadingFrame_State_Recording = 1,
+  CoarseShadingFrame_State_Submitted = 2,
+  CoarseShadingFrame_State_Mapping   = 3,
+} wgpu_coarse_shading_frame_state_t;
+
+typedef struct wgpu_coarse_shading_frame_t {
+  struct wgpu_coarse_shading* coarse_shading;
+  WGPUBuffer readback_buffer;
+  wgpu_coarse_shading_frame_state_t state;
+  uint64_t frame_index; /* frame the counters were recorded in */
+  uint64_t pixel_count; /* output pixels of the dispatch */
+} wgpu_coarse_shading_frame_t;
+
+/* Per dispatch uniforms, layout of the WGSL CoarseShadingParams struct */
+typedef struct coarse_shading_uniforms_t {
+  uint32_t size[2];
+  float contrast_threshold;
+  float edge_threshold;
+} coarse_shading_uniforms_t;
+
+/**
+ * @brief Coarse shading class
+ */
+struct wgpu_coarse_shading {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  wgpu_coarse_shading_params_t params;
+  uint32_t width;
+  uint32_t height;
+  /* Output */
+  WGPUTexture texture;
+  WGPUTextureView texture_view;
+  WGPUBindGroup composite_bind_group;
+  /* Classification and shading */
+  WGPUSampler sampler;
+  WGPUBuffer uniform_buffer;
+  WGPUBuffer counter_buffer;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+  /* Composite */
+  WGPUBindGroupLayout composite_bind_group_layout;
+  WGPUPipelineLayout composite_pipeline_layout;
+  WGPURenderPipeline composite_pipeline;
+  /* Statistics readback */
+  wgpu_coarse_shading_frame_t frames[WGPU_COARSE_SHADING_FRAME_COUNT];
+  wgpu_coarse_shading_frame_t* current_frame;
+  uint64_t frame_index;
+  uint64_t stats_frame_index;
+  bool dispatched;
+  wgpu_coarse_shading_stats_t stats;
+};
+
+/* Pipelines */
+
+static void coarse_shading_create_pipeline(wgpu_coarse_shading_t* cs,
+                                           const char* effect_wgsl,
+                                           WGPUBindGroupLayout effect_layout)
+{
+  wgpu_context_t* wgpu_context = cs->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[5] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Parameters
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(coarse_shading_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Classification source
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Classification sampler
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      // Binding 3: Output texture
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .storageTexture = (WGPUStorageTextureBindingLayout) {
+        .access        = WGPUStorageTextureAccess_WriteOnly,
+        .format        = COARSE_SHADING_OUTPUT_FORMAT,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      // Binding 4: Statistics counters
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = COARSE_SHADING_COUNTERS_SIZE,
+      },
+    },
+  };
+  cs->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Coarse shading bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(cs->bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts[2]
+    = {cs->bind_group_layout, effect_layout};
+  cs->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "Coarse shading pipeline layout",
+      .bindGroupLayoutCount = effect_layout != NULL ? 2 : 1,
+      .bindGroupLayouts     = bind_group_layouts,
+    });
+  ASSERT(cs->pipeline_layout != NULL);
+
+  // The kernel calls the effect function
+  const size_t effect_length = strlen(effect_wgsl);
+  const size_t kernel_length = strlen(coarse_shading_kernel_wgsl);
+  char* wgsl = (char*)malloc(effect_length + kernel_length + 2);
+  memcpy(wgsl, effect_wgsl, effect_length);
+  wgsl[effect_length] = '\n';
+  memcpy(wgsl + effect_length + 1, coarse_shading_kernel_wgsl,
+         kernel_length + 1);
+
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "Coarse shading shader",
+                    .wgsl_code.source = wgsl,
+                    .entry            = "main",
+                  });
+  cs->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = cs->label,
+                    .layout  = cs->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(cs->pipeline != NULL);
+  wgpu_shader_release(&shader);
+  free(wgsl);
+}
+
+static void
+coarse_shading_create_composite_pipeline(wgpu_coarse_shading_t* cs,
+                                         const wgpu_coarse_shading_desc_t* desc)
+{
+  wgpu_context_t* wgpu_context = cs->wgpu_context;
+
+  cs->composite_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device,
+    &(WGPUBindGroupLayoutDescriptor){
+      .label      = "Coarse shading composite bind group layout",
+      .entryCount = 1,
+      .entries    = &(WGPUBindGroupLayoutEntry){
+        // Binding 0: Output texture
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Fragment,
+        .texture = (WGPUTextureBindingLayout) {
+          .sampleType    = WGPUTextureSampleType_Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+    });
+  ASSERT(cs->composite_bind_group_layout != NULL);
+
+  cs->composite_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "Coarse shading composite pipeline layout",
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &cs->composite_bind_group_layout,
+    });
+  ASSERT(cs->composite_pipeline_layout != NULL);
+
+  // Additive blending
+  WGPUBlendState blend_state = {
+    .color.operation = WGPUBlendOperation_Add,
+    .color.srcFactor = WGPUBlendFactor_One,
+    .color.dstFactor = WGPUBlendFactor_One,
+    .alpha.operation = WGPUBlendOperation_Add,
+    .alpha.srcFactor = WGPUBlendFactor_Zero,
+    .alpha.dstFactor = WGPUBlendFactor_One,
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = desc->composite_format,
+    .blend     = desc->composite_additive ? &blend_state : NULL,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // The composite is drawn in render passes with a depth attachment
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = desc->composite_depth_stencil_format,
+      .depth_write_enabled = false,
+    });
+  depth_stencil_state.depthCompare = WGPUCompareFunction_Always;
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Coarse shading vertex shader",
+                      .wgsl_code.source = coarse_shading_composite_wgsl,
+                      .entry            = "vs_main",
+                    },
+                  });
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Coarse shading fragment shader",
+                      .wgsl_code.source = coarse_shading_composite_wgsl,
+                      .entry            = "fs_main",
+                    },
+                    .target_count = 1,
+                    .targets      = &color_target_state,
+                  });
+
+  cs->composite_pipeline = wgpu_create_render_pipeline(
+    wgpu_context,
+    &(WGPURenderPipelineDescriptor){
+      .label     = "Coarse shading composite pipeline",
+      .layout    = cs->composite_pipeline_layout,
+      .primitive = {
+        .topology  = WGPUPrimitiveTopology_TriangleList,
+        .frontFace = WGPUFrontFace_CCW,
+        .cullMode  = WGPUCullMode_None,
+      },
+      .vertex       = vertex_state,
+      .fragment     = &fragment_state,
+      .depthStencil = desc->composite_depth_stencil_format
+                          != WGPUTextureFormat_Undefined ?
+                        &depth_stencil_state :
+                        NULL,
+      .multisample  = wgpu_create_multisample_state_descriptor(
+        &(create_multisample_state_desc_t){
+          .sample_count = 1,
+        }),
+    });
+  ASSERT(cs->composite_pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module)
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module)
+}
+
+/* Uniforms */
+
+static void coarse_shading_write_uniforms(wgpu_coarse_shading_t* cs)
+{
+  coarse_shading_uniforms_t uniforms = {
+    .size               = {cs->width, cs->height},
+    .contrast_threshold = cs->params.contrast_threshold,
+    .edge_threshold     = cs->params.edge_threshold,
+  };
+  wgpu_queue_write_buffer(cs->wgpu_context, cs->uniform_buffer, 0, &uniforms,
+                          sizeof(uniforms));
+}
+
+/* Output texture */
+
+static void coarse_shading_release_output(wgpu_coarse_shading_t* cs)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup, cs->composite_bind_group)
+  WGPU_RELEASE_RESOURCE(TextureView, cs->texture_view)
+  WGPU_RELEASE_RESOURCE(Texture, cs->texture)
+}
+
+static void coarse_shading_create_output(wgpu_coarse_shading_t* cs)
+{
+  cs->texture = wgpuDeviceCreateTexture(
+    cs->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = cs->label,
+      .usage         = WGPUTextureUsage_StorageBinding
+                       | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = cs->width,
+        .height             = cs->height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = COARSE_SHADING_OUTPUT_FORMAT,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(cs->texture != NULL);
+
+  cs->texture_view = wgpuTextureCreateView(
+    cs->texture, &(WGPUTextureViewDescriptor){
+                   .label           = "Coarse shading texture view",
+                   .format          = COARSE_SHADING_OUTPUT_FORMAT,
+                   .dimension       = WGPUTextureViewDimension_2D,
+                   .baseMipLevel    = 0,
+                   .mipLevelCount   = 1,
+                   .baseArrayLayer  = 0,
+                   .arrayLayerCount = 1,
+                 });
+  ASSERT(cs->texture_view != NULL);
+
+  if (cs->composite_pipeline != NULL) {
+    cs->composite_bind_group = wgpuDeviceCreateBindGroup(
+      cs->wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .label      = "Coarse shading composite bind group",
+        .layout     = cs->composite_bind_group_layout,
+        .entryCount = 1,
+        .entries    = &(WGPUBindGroupEntry){
+          .binding     = 0,
+          .textureView = cs->texture_view,
+        },
+      });
+    ASSERT(cs->composite_bind_group != NULL);
+  }
+
+  coarse_shading_write_uniforms(cs);
+}
+
+/* Coarse shading creating / destroying */
+
+wgpu_coarse_shading_t*
+wgpu_coarse_shading_create(wgpu_context_t* wgpu_context,
+                           const wgpu_coarse_shading_desc_t* desc)
+{
+  ASSERT(desc->width > 0 && desc->height > 0);
+  ASSERT(desc->wgsl_code != NULL);
+
+  wgpu_coarse_shading_t* cs
+    = (wgpu_coarse_shading_t*)calloc(1, sizeof(*cs));
+  cs->wgpu_context = wgpu_context;
+  cs->label        = desc->label != NULL ? desc->label : "Coarse shading";
+
+  cs->width                     = desc->width;
+  cs->height                    = desc->height;
+  cs->params.contrast_threshold = 0.05f;
+  cs->params.edge_threshold     = 0.1f;
+  cs->stats.shaded_ratio        = 1.0f;
+
+  cs->uniform_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Coarse shading uniform buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = sizeof(coarse_shading_uniforms_t),
+    });
+  cs->counter_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Coarse shading counter buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc
+               | WGPUBufferUsage_CopyDst,
+      .size  = COARSE_SHADING_COUNTERS_SIZE,
+    });
+  ASSERT(cs->uniform_buffer && cs->counter_buffer);
+
+  for (uint32_t i = 0; i < WGPU_COARSE_SHADING_FRAME_COUNT; ++i) {
+    wgpu_coarse_shading_frame_t* frame = &cs->frames[i];
+    frame->coarse_shading              = cs;
+    frame->state                       = CoarseShadingFrame_State_Available;
+    frame->readback_buffer             = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Coarse shading readback buffer",
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size  = COARSE_SHADING_COUNTERS_SIZE,
+      });
+    ASSERT(frame->readback_buffer != NULL);
+  }
+
+  cs->sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .label         = "Coarse shading sampler",
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Nearest,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = 1.0f,
+                    .maxAnisotropy = 1,
+                  });
+  ASSERT(cs->sampler != NULL);
+
+  coarse_shading_create_pipeline(cs, desc->wgsl_code,
+                                 desc->bind_group_layout);
+  if (desc->composite_format != WGPUTextureFormat_Undefined) {
+    coarse_shading_create_composite_pipeline(cs, desc);
+  }
+  coarse_shading_create_output(cs);
+
+  return cs;
+}
+
+void wgpu_coarse_shading_destroy(wgpu_coarse_shading_t* coarse_shading)
+{
+  if (coarse_shading == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < WGPU_COARSE_SHADING_FRAME_COUNT; ++i) {
+    wgpu_coarse_shading_frame_t* frame = &coarse_shading->frames[i];
+    if (frame->state == CoarseShadingFrame_State_Mapping) {
+      /* Cancels the pending map request */
+      wgpuBufferUnmap(frame->readback_buffer);
+    }
+    WGPU_RELEASE_RESOURCE(Buffer, frame->readback_buffer)
+  }
+
+  coarse_shading_release_output(coarse_shading);
+  WGPU_RELEASE_RESOURCE(ComputePipeline, coarse_shading->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, coarse_shading->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, coarse_shading->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, coarse_shading->composite_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout,
+                        coarse_shading->composite_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        coarse_shading->composite_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, coarse_shading->sampler)
+  WGPU_RELEASE_RESOURCE(Buffer, coarse_shading->uniform_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, coarse_shading->counter_buffer)
+  free(coarse_shading);
+}
+
+void wgpu_coarse_shading_resize(wgpu_coarse_shading_t* coarse_shading,
+                                uint32_t width, uint32_t height)
+{
+  ASSERT(width > 0 && height > 0);
+
+  if (width == coarse_shading->width && height == coarse_shading->height) {
+    return;
+  }
+
+  coarse_shading_release_output(coarse_shading);
+  coarse_shading->width  = width;
+  coarse_shading->height = height;
+  coarse_shading_create_output(coarse_shading);
+}
+
+/* Parameters */
+
+void wgpu_coarse_shading_set_params(
+  wgpu_coarse_shading_t* coarse_shading,
+  const wgpu_coarse_shading_params_t* params)
+{
+  coarse_shading->params = *params;
+  coarse_shading_write_uniforms(coarse_shading);
+}
+
+void wgpu_coarse_shading_get_params(wgpu_coarse_shading_t* coarse_shading,
+                                    wgpu_coarse_shading_params_t* params)
+{
+  *params = coarse_shading->params;
+}
+
+/* Shading */
+
+void wgpu_coarse_shading_dispatch(wgpu_coarse_shading_t* coarse_shading,
+                                  WGPUComputePassEncoder cpass_enc,
+                                  WGPUTextureView source,
+                                  WGPUBindGroup bind_group)
+{
+  ASSERT(source != NULL);
+
+  // The counters are reset before the commands of the submit are executed
+  static const uint32_t zero_counters[COARSE_SHADING_COUNTER_COUNT] = {0};
+  wgpu_queue_write_buffer(coarse_shading->wgpu_context,
+                          coarse_shading->counter_buffer, 0, zero_counters,
+                          sizeof(zero_counters));
+
+  // The source can be a pooled texture, the bind group is taken from the bind
+  // group cache
+  WGPUBindGroupEntry bg_entries[5] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = coarse_shading->uniform_buffer,
+      .offset  = 0,
+      .size    = sizeof(coarse_shading_uniforms_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = source,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .sampler = coarse_shading->sampler,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding     = 3,
+      .textureView = coarse_shading->texture_view,
+    },
+    [4] = (WGPUBindGroupEntry) {
+      .binding = 4,
+      .buffer  = coarse_shading->counter_buffer,
+      .offset  = 0,
+      .size    = COARSE_SHADING_COUNTERS_SIZE,
+    },
+  };
+  WGPUBindGroup system_bind_group = wgpu_create_bind_group(
+    coarse_shading->wgpu_context,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Coarse shading bind group",
+      .layout     = coarse_shading->bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(system_bind_group != NULL);
+
+  wgpuComputePassEncoderSetPipeline(cpass_enc, coarse_shading->pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, system_bind_group, 0, 0);
+  if (bind_group != NULL) {
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, bind_group, 0, 0);
+  }
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (coarse_shading->width + WGPU_COARSE_SHADING_TILE_SIZE - 1)
+      / WGPU_COARSE_SHADING_TILE_SIZE,
+    (coarse_shading->height + WGPU_COARSE_SHADING_TILE_SIZE - 1)
+      / WGPU_COARSE_SHADING_TILE_SIZE,
+    1);
+  WGPU_RELEASE_RESOURCE(BindGroup, system_bind_group)
+
+  coarse_shading->dispatched = true;
+}
+
+void wgpu_coarse_shading_resolve(wgpu_coarse_shading_t* coarse_shading,
+                                 WGPUCommandEncoder cmd_enc)
+{
+  if (!coarse_shading->dispatched) {
+    return;
+  }
+  coarse_shading->dispatched = false;
+
+  wgpu_coarse_shading_frame_t* frame
+    = &coarse_shading->frames[coarse_shading->frame_index
+                              % WGPU_COARSE_SHADING_FRAME_COUNT];
+  if (frame->state != CoarseShadingFrame_State_Available) {
+    /* The readback of this frame is still in flight, skip this frame */
+    return;
+  }
+
+  wgpuCommandEncoderCopyBufferToBuffer(
+    cmd_enc, coarse_shading->counter_buffer, 0, frame->readback_buffer, 0,
+    COARSE_SHADING_COUNTERS_SIZE);
+  frame->state       = CoarseShadingFrame_State_Recording;
+  frame->frame_index = coarse_shading->frame_index;
+  frame->pixel_count
+    = (uint64_t)coarse_shading->width * (uint64_t)coarse_shading->height;
+  coarse_shading->current_frame = frame;
+}
+
+static void coarse_shading_readback_map_cb(WGPUBufferMapAsyncStatus status,
+                                           void* user_data)
+{
+  wgpu_coarse_shading_frame_t* frame = (wgpu_coarse_shading_frame_t*)user_data;
+  wgpu_coarse_shading_t* cs          = frame->coarse_shading;
+
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    uint32_t const* counters = (uint32_t const*)wgpuBufferGetConstMappedRange(
+      frame->readback_buffer, 0, COARSE_SHADING_COUNTERS_SIZE);
+    ASSERT(counters);
+    /* Keep the newest statistics if several maps complete in one frame */
+    if (frame->frame_index >= cs->stats_frame_index) {
+      cs->stats.shaded_ratio = (float)counters[0] / (float)frame->pixel_count;
+      memcpy(cs->stats.tile_counts, &counters[1],
+             sizeof(cs->stats.tile_counts));
+      cs->stats_frame_index = frame->frame_index;
+    }
+    wgpuBufferUnmap(frame->readback_buffer);
+  }
+
+  frame->state = CoarseShadingFrame_State_Available;
+}
+
+void wgpu_coarse_shading_end_frame(wgpu_coarse_shading_t* coarse_shading)
+{
+  if (coarse_shading->current_frame != NULL) {
+    coarse_shading->current_frame->state = CoarseShadingFrame_State_Submitted;
+    coarse_shading->current_frame        = NULL;
+  }
+
+  /* Map the frames submitted WGPU_COARSE_SHADING_MAP_LATENCY frames ago,
+   * mapping them earlier would make the map wait for the GPU */
+  for (uint32_t i = 0; i < WGPU_COARSE_SHADING_FRAME_COUNT; ++i) {
+    wgpu_coarse_shading_frame_t* frame = &coarse_shading->frames[i];
+    if (frame->state == CoarseShadingFrame_State_Submitted
+        && frame->frame_index + WGPU_COARSE_SHADING_MAP_LATENCY
+             <= coarse_shading->frame_index) {
+      frame->state = CoarseShadingFrame_State_Mapping;
+      wgpuBufferMapAsync(frame->readback_buffer, WGPUMapMode_Read, 0,
+                         COARSE_SHADING_COUNTERS_SIZE,
+                         coarse_shading_readback_map_cb, frame);
+    }
+  }
+
+  ++coarse_shading->frame_index;
+}
+
+void wgpu_coarse_shading_composite(wgpu_coarse_shading_t* coarse_shading,
+                                   WGPURenderPassEncoder rpass_enc)
+{
+  ASSERT(coarse_shading->composite_pipeline != NULL);
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc,
+                                   coarse_shading->composite_pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0,
+                                    coarse_shading->composite_bind_group, 0, 0);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+}
+
+/* Results */
+
+WGPUTextureView
+wgpu_coarse_shading_get_texture_view(wgpu_coarse_shading_t* coarse_shading)
+{
+  return coarse_shading->texture_view;
+}
+
+void wgpu_coarse_shading_get_stats(wgpu_coarse_shading_t* coarse_shading,
+                                   wgpu_coarse_shading_stats_t* stats)
+{
+  *stats = coarse_shading->stats;
+}
@@ -0,0 +1,129 @@
+#ifndef COARSE_SHADING_H
+#define COARSE_SHADING_H
+
+#include "context.h"
+
+/* Size of the screen tiles a shading rate is selected for */
+#define WGPU_COARSE_SHADING_TILE_SIZE 16u
+#define WGPU_COARSE_SHADING_FRAME_COUNT 4u
+/* Frames between recording the statistics of a frame and mapping them */
+#define WGPU_COARSE_SHADING_MAP_LATENCY 2u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU coarse shading
+ *
+ * Variable rate shading emulation for expensive full screen effects. The
+ * effect is evaluated by a compute shader with a workgroup per
+ * WGPU_COARSE_SHADING_TILE_SIZE² screen tile:
+ *
+ *   - classify: the luminance of a classification source, e.g. the input of
+ *     the effect, is sampled at the tile pixels. The standard deviation and the
+ *     largest difference between neighboring pixels relative to the mean
+ *     luminance select the shading rate of the tile, 1/4 below the thresholds,
+ *     1/2 below twice the thresholds and full rate otherwise
+ *   - shade: the effect is evaluated once per rate² block at its center
+ *   - upsample: every pixel of the tile is bilinearly interpolated from the
+ *     block samples of the tile
+ *
+ * The effect is WGSL code defining
+ *
+ *   fn coarse_shading_effect(uv : vec2<f32>) -> vec4<f32>
+ *
+ * which can use its own resources bound to group 1 with compute visibility.
+ * Compute shaders have no derivatives, textures are sampled with
+ * textureSampleLevel(). The result is written to an RGBA16Float texture of the
+ * output size:
+ *
+ *   cpass_enc = begin compute pass
+ *   wgpu_coarse_shading_dispatch(coarse_shading, cpass_enc, source, bg);
+ *   end compute pass
+ *   wgpu_coarse_shading_resolve(coarse_shading, cmd_enc);
+ *   ... composite pass: wgpu_coarse_shading_composite(coarse_shading, rpass)
+ *   ... submit ...
+ *   wgpu_coarse_shading_end_frame(coarse_shading);
+ *
+ * The numbers of evaluated pixels and tiles per rate are counted on the GPU
+ * and read back asynchronously like the occlusion queries, the statistics lag
+ * WGPU_COARSE_SHADING_MAP_LATENCY frames or more. One dispatch can be
+ * recorded per submit.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_coarse_shading wgpu_coarse_shading_t;
+
+typedef struct wgpu_coarse_shading_desc_t {
+  const char* label;
+  /* Size of the output texture */
+  uint32_t width;
+  uint32_t height;
+  /* WGSL effect code, see above */
+  const char* wgsl_code;
+  /* Group 1 of the effect, NULL = no resources */
+  WGPUBindGroupLayout bind_group_layout;
+  /* Render pass formats of wgpu_coarse_shading_composite(), Undefined = no
+   * composite pipeline / no depth stencil attachment */
+  WGPUTextureFormat composite_format;
+  WGPUTextureFormat composite_depth_stencil_format;
+  /* Adds the output to the color target instead of replacing it */
+  bool composite_additive;
+} wgpu_coarse_shading_desc_t;
+
+typedef struct wgpu_coarse_shading_params_t {
+  /* Luminance standard deviation relative to the mean luminance */
+  float contrast_threshold;
+  /* Neighbor pixel luminance difference relative to the mean luminance */
+  float edge_threshold;
+} wgpu_coarse_shading_params_t;
+
+typedef struct wgpu_coarse_shading_stats_t {
+  /* Evaluated pixels of the output pixels, 1.0 until the first readback */
+  float shaded_ratio;
+  /* Tiles shaded at full, 1/2 and 1/4 rate */
+  uint32_t tile_counts[3];
+} wgpu_coarse_shading_stats_t;
+
+/* Coarse shading creating / destroying */
+wgpu_coarse_shading_t*
+wgpu_coarse_shading_create(wgpu_context_t* wgpu_context,
+                           const wgpu_coarse_shading_desc_t* desc);
+void wgpu_coarse_shading_destroy(wgpu_coarse_shading_t* coarse_shading);
+
+/* Recreates the output texture for a new output size */
+void wgpu_coarse_shading_resize(wgpu_coarse_shading_t* coarse_shading,
+                                uint32_t width, uint32_t height);
+
+/* Defaults: contrast threshold 0.05, edge threshold 0.1 */
+void wgpu_coarse_shading_set_params(
+  wgpu_coarse_shading_t* coarse_shading,
+  const wgpu_coarse_shading_params_t* params);
+void wgpu_coarse_shading_get_params(wgpu_coarse_shading_t* coarse_shading,
+                                    wgpu_coarse_shading_params_t* params);
+
+/**
+ * @brief Records the classification and the coarse evaluation of the effect
+ * into the compute pass, source is sampled for the classification and
+ * bind_group is set to group 1.
+ */
+void wgpu_coarse_shading_dispatch(wgpu_coarse_shading_t* coarse_shading,
+                                  WGPUComputePassEncoder cpass_enc,
+                                  WGPUTextureView source,
+                                  WGPUBindGroup bind_group);
+
+/* Copies the counters of the dispatch for the readback, recorded after the
+ * compute pass */
+void wgpu_coarse_shading_resolve(wgpu_coarse_shading_t* coarse_shading,
+                                 WGPUCommandEncoder cmd_enc);
+
+/* Completes the frame after its submit and maps the counters of the frame
+ * WGPU_COARSE_SHADING_MAP_LATENCY frames back */
+void wgpu_coarse_shading_end_frame(wgpu_coarse_shading_t* coarse_shading);
+
+/* Draws the output over the color target of the render pass */
+void wgpu_coarse_shading_composite(wgpu_coarse_shading_t* coarse_shading,
+                                   WGPURenderPassEncoder rpass_enc);
+
+WGPUTextureView
+wgpu_coarse_shading_get_texture_view(wgpu_coarse_shading_t* coarse_shading);
+void wgpu_coarse_shading_get_stats(wgpu_coarse_shading_t* coarse_shading,
+                                   wgpu_coarse_shading_stats_t* stats);
+
+#endif /* COARSE_SHADING_H */
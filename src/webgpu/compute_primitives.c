@@ -0,0 +1,614 @@
+#include "compute_primitives.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Elements per workgroup of all kernels */
+#define PRIMITIVES_BLOCK_SIZE 256u
+/* Workgroups per dispatch row, larger dispatches use several rows */
+#define PRIMITIVES_MAX_GROUPS_X 32768u
+/* Reduction levels of the scan, 256^4 covers all u32 counts */
+#define PRIMITIVES_MAX_SCAN_LEVELS 4u
+/* Uniform buffer offset alignment of the parameter slots */
+#define PRIMITIVES_PARAM_SLOT_SIZE 256u
+#define PRIMITIVES_RADIX_BITS 4u
+#define PRIMITIVES_RADIX_DIGITS (1u << PRIMITIVES_RADIX_BITS)
+#define PRIMITIVES_MAX_BINDINGS 6u
+
+/* -------------------------------------------------------------------------- *
+ * Kernels
+ *
+ * The kernels are separate modules sharing the parameter declaration, the
+ * block of a workgroup is derived from a two-dimensional dispatch.
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* primitives_common_wgsl = CODE(
+  struct Params {
+    count : u32,
+    shift : u32,
+    blockCount : u32,
+    groupsX : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+
+  const kBlockSize = 256u;
+
+  fn blockIndex(wid : vec3<u32>) -> u32 {
+    return wid.x + wid.y * params.groupsX;
+  }
+);
+
+// Exclusive scan of every block and the sum of the block
+static const char* primitives_scan_blocks_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> src : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> dst : array<u32>;
+  @group(0) @binding(3) var<storage, read_write> blockSums : array<u32>;
+
+  var<workgroup> sums : array<u32, kBlockSize>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let block = blockIndex(wid);
+    if (block >= params.blockCount) {
+      return;
+    }
+    let i = block * kBlockSize + lid;
+    var value = 0u;
+    if (i < params.count) {
+      value = src[i];
+    }
+    sums[lid] = value;
+    workgroupBarrier();
+
+    for (var offset = 1u; offset < kBlockSize; offset = offset * 2u) {
+      var sum = sums[lid];
+      if (lid >= offset) {
+        sum = sum + sums[lid - offset];
+      }
+      workgroupBarrier();
+      sums[lid] = sum;
+      workgroupBarrier();
+    }
+
+    if (i < params.count) {
+      dst[i] = sums[lid] - value;
+    }
+    if (lid == kBlockSize - 1u) {
+      blockSums[block] = sums[lid];
+    }
+  }
+);
+
+// Adds the scanned block sums to the blocks
+static const char* primitives_add_offsets_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> blockOffsets : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> data : array<u32>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let block = blockIndex(wid);
+    let i = block * kBlockSize + lid;
+    if (block < params.blockCount && i < params.count) {
+      data[i] = data[i] + blockOffsets[block];
+    }
+  }
+);
+
+// Writes the flagged values to their scanned offsets
+static const char* primitives_compact_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> flags : array<u32>;
+  @group(0) @binding(2) var<storage, read> values : array<u32>;
+  @group(0) @binding(3) var<storage, read> offsets : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> compacted : array<u32>;
+  @group(0) @binding(5) var<storage, read_write> compactedCount : array<u32>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let i = blockIndex(wid) * kBlockSize + lid;
+    if (i >= params.count) {
+      return;
+    }
+    let flagged = flags[i] != 0u;
+    if (flagged) {
+      compacted[offsets[i]] = values[i];
+    }
+    if (i == params.count - 1u) {
+      compactedCount[0] = offsets[i] + select(0u, 1u, flagged);
+    }
+  }
+);
+
+// Digit counts of every block, stored digit-major so that the exclusive scan
+// of the histogram yields the destination of every digit and block
+static const char* primitives_radix_histogram_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> keys : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> histogram : array<u32>;
+
+  var<workgroup> digitCounts : array<atomic<u32>, 16>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let block = blockIndex(wid);
+    if (block >= params.blockCount) {
+      return;
+    }
+    if (lid < 16u) {
+      atomicStore(&digitCounts[lid], 0u);
+    }
+    workgroupBarrier();
+    let i = block * kBlockSize + lid;
+    if (i < params.count) {
+      atomicAdd(&digitCounts[(keys[i] >> params.shift) & 15u], 1u);
+    }
+    workgroupBarrier();
+    if (lid < 16u) {
+      histogram[lid * params.blockCount + block]
+        = atomicLoad(&digitCounts[lid]);
+    }
+  }
+);
+
+// Sorts the block by the digit with one stable split per digit bit and
+// scatters the elements behind the elements of the previous blocks
+static const char* primitives_radix_scatter_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> keysIn : array<u32>;
+  @group(0) @binding(2) var<storage, read> valuesIn : array<u32>;
+  @group(0) @binding(3) var<storage, read> digitOffsets : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> keysOut : array<u32>;
+  @group(0) @binding(5) var<storage, read_write> valuesOut : array<u32>;
+
+  var<workgroup> localKeys : array<u32, kBlockSize>;
+  var<workgroup> localValues : array<u32, kBlockSize>;
+  var<workgroup> zeros : array<u32, kBlockSize>;
+  var<workgroup> digitStarts : array<atomic<u32>, 16>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let block = blockIndex(wid);
+    if (block >= params.blockCount) {
+      return;
+    }
+    // Padding keys sort behind the keys of the block
+    let i = block * kBlockSize + lid;
+    var key = 0xffffffffu;
+    var value = 0u;
+    if (i < params.count) {
+      key = keysIn[i];
+      value = valuesIn[i];
+    }
+
+    for (var bit = 0u; bit < 4u; bit = bit + 1u) {
+      let isZero = 1u - ((key >> (params.shift + bit)) & 1u);
+      zeros[lid] = isZero;
+      workgroupBarrier();
+      for (var offset = 1u; offset < kBlockSize; offset = offset * 2u) {
+        var sum = zeros[lid];
+        if (lid >= offset) {
+          sum = sum + zeros[lid - offset];
+        }
+        workgroupBarrier();
+        zeros[lid] = sum;
+        workgroupBarrier();
+      }
+      let zerosBefore = zeros[lid] - isZero;
+      var pos = zerosBefore;
+      if (isZero == 0u) {
+        pos = zeros[kBlockSize - 1u] + lid - zerosBefore;
+      }
+      localKeys[pos] = key;
+      localValues[pos] = value;
+      workgroupBarrier();
+      key = localKeys[lid];
+      value = localValues[lid];
+    }
+
+    let digit = (key >> params.shift) & 15u;
+    if (lid < 16u) {
+      atomicStore(&digitStarts[lid], kBlockSize);
+    }
+    workgroupBarrier();
+    atomicMin(&digitStarts[digit], lid);
+    workgroupBarrier();
+    if (block * kBlockSize + lid < params.count) {
+      let rank = lid - atomicLoad(&digitStarts[digit]);
+      let index = digitOffsets[digit * params.blockCount + block] + rank;
+      keysOut[index] = key;
+      valuesOut[index] = value;
+    }
+  }
+);
+// clang-format on
+
+typedef struct primitives_params_t {
+  uint32_t count;
+  uint32_t shift;
+  uint32_t block_count;
+  uint32_t groups_x;
+} primitives_params_t;
+
+typedef struct primitives_kernel_t {
+  uint32_t binding_count;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+} primitives_kernel_t;
+
+struct wgpu_compute_primitives {
+  wgpu_context_t* wgpu_context;
+  uint32_t max_count;
+  WGPUBuffer params_buffer;
+  uint32_t param_slot;
+  struct {
+    primitives_kernel_t scan_blocks;
+    primitives_kernel_t add_offsets;
+    primitives_kernel_t compact;
+    primitives_kernel_t radix_histogram;
+    primitives_kernel_t radix_scatter;
+  } kernels;
+  // Block sums and scanned block sums of the scan levels
+  uint32_t scan_level_count;
+  WGPUBuffer scan_sums[PRIMITIVES_MAX_SCAN_LEVELS];
+  WGPUBuffer scan_offsets[PRIMITIVES_MAX_SCAN_LEVELS];
+  WGPUBuffer compact_offsets;
+  WGPUBuffer sort_keys;
+  WGPUBuffer sort_values;
+  WGPUBuffer sort_histogram;
+  WGPUBuffer sort_histogram_offsets;
+};
+
+static uint32_t primitives_block_count(uint32_t count)
+{
+  return (count + PRIMITIVES_BLOCK_SIZE - 1) / PRIMITIVES_BLOCK_SIZE;
+}
+
+static WGPUBuffer primitives_create_buffer(wgpu_context_t* wgpu_context,
+                                           const char* label, uint32_t count)
+{
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = label,
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+      .size  = (uint64_t)MAX(count, 1u) * sizeof(uint32_t),
+    });
+  ASSERT(buffer != NULL);
+  return buffer;
+}
+
+/* The read-only mask has a bit per storage binding bound read-only */
+static void primitives_create_kernel(wgpu_context_t* wgpu_context,
+                                     primitives_kernel_t* kernel,
+                                     const char* source, uint32_t binding_count,
+                                     uint32_t read_only_mask)
+{
+  ASSERT(binding_count <= PRIMITIVES_MAX_BINDINGS);
+  kernel->binding_count = binding_count;
+
+  WGPUBindGroupLayoutEntry bgl_entries[PRIMITIVES_MAX_BINDINGS] = {0};
+  bgl_entries[0] = (WGPUBindGroupLayoutEntry){
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Compute,
+    .buffer = (WGPUBufferBindingLayout){
+      .type             = WGPUBufferBindingType_Uniform,
+      .hasDynamicOffset = true,
+      .minBindingSize   = sizeof(primitives_params_t),
+    },
+  };
+  for (uint32_t i = 1; i < binding_count; ++i) {
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type = ((read_only_mask >> i) & 1u) ?
+                  WGPUBufferBindingType_ReadOnlyStorage :
+                  WGPUBufferBindingType_Storage,
+      },
+    };
+  }
+  kernel->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = binding_count,
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(kernel->bind_group_layout != NULL);
+  kernel->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &kernel->bind_group_layout,
+                          });
+  ASSERT(kernel->pipeline_layout != NULL);
+
+  // Kernel module, prefixed by the common declarations
+  const size_t common_length = strlen(primitives_common_wgsl);
+  const size_t length        = common_length + strlen(source) + 1;
+  char* wgsl                 = (char*)malloc(length);
+  memcpy(wgsl, primitives_common_wgsl, common_length);
+  memcpy(wgsl + common_length, source, length - common_length);
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = wgsl,
+                    .entry            = "main",
+                  });
+  kernel->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "compute_primitives_pipeline",
+                    .layout  = kernel->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(kernel->pipeline != NULL);
+  wgpu_shader_release(&shader);
+  free(wgsl);
+}
+
+static void primitives_release_kernel(primitives_kernel_t* kernel)
+{
+  WGPU_RELEASE_RESOURCE(ComputePipeline, kernel->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, kernel->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, kernel->bind_group_layout)
+}
+
+/* Records a dispatch of a workgroup per block of count elements, the buffers
+ * are bound to the bindings after the parameters */
+static void primitives_dispatch(wgpu_compute_primitives_t* primitives,
+                                WGPUComputePassEncoder pass_encoder,
+                                const primitives_kernel_t* kernel,
+                                const WGPUBuffer* buffers, uint32_t count,
+                                uint32_t block_count, uint32_t shift)
+{
+  wgpu_context_t* wgpu_context = primitives->wgpu_context;
+  const uint32_t groups_x = MIN(MAX(block_count, 1u), PRIMITIVES_MAX_GROUPS_X);
+  const uint32_t groups_y = (MAX(block_count, 1u) + groups_x - 1) / groups_x;
+
+  // Parameters of the dispatch
+  const uint32_t param_offset
+    = primitives->param_slot * PRIMITIVES_PARAM_SLOT_SIZE;
+  primitives->param_slot
+    = (primitives->param_slot + 1) % WGPU_COMPUTE_PRIMITIVES_PARAM_SLOTS;
+  const primitives_params_t params = {
+    .count       = count,
+    .shift       = shift,
+    .block_count = block_count,
+    .groups_x    = groups_x,
+  };
+  wgpuQueueWriteBuffer(wgpu_context->queue, primitives->params_buffer,
+                       param_offset, &params, sizeof(params));
+
+  WGPUBindGroupEntry bg_entries[PRIMITIVES_MAX_BINDINGS] = {0};
+  bg_entries[0] = (WGPUBindGroupEntry){
+    .binding = 0,
+    .buffer  = primitives->params_buffer,
+    .offset  = 0,
+    .size    = sizeof(primitives_params_t),
+  };
+  for (uint32_t i = 1; i < kernel->binding_count; ++i) {
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding = i,
+      .buffer  = buffers[i - 1],
+      .offset  = 0,
+      .size    = WGPU_WHOLE_SIZE,
+    };
+  }
+  // The same buffers are bound every frame, the cache saves the creation
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .layout     = kernel->bind_group_layout,
+                    .entryCount = kernel->binding_count,
+                    .entries    = bg_entries,
+                  });
+  ASSERT(bind_group != NULL);
+
+  wgpuComputePassEncoderSetPipeline(pass_encoder, kernel->pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 1,
+                                     &param_offset);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, groups_x, groups_y,
+                                           1);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
+
+wgpu_compute_primitives_t*
+wgpu_compute_primitives_create(wgpu_context_t* wgpu_context,
+                               uint32_t max_count)
+{
+  ASSERT(max_count > 0);
+
+  wgpu_compute_primitives_t* primitives
+    = (wgpu_compute_primitives_t*)calloc(1, sizeof(*primitives));
+  primitives->wgpu_context = wgpu_context;
+  primitives->max_count    = max_count;
+
+  primitives->params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "compute_primitives_params_buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = WGPU_COMPUTE_PRIMITIVES_PARAM_SLOTS * PRIMITIVES_PARAM_SLOT_SIZE,
+    });
+  ASSERT(primitives->params_buffer != NULL);
+
+  // Kernels, bit i of the mask marks binding i as read-only storage
+  primitives_create_kernel(wgpu_context, &primitives->kernels.scan_blocks,
+                           primitives_scan_blocks_wgsl, 4, 0x2u);
+  primitives_create_kernel(wgpu_context, &primitives->kernels.add_offsets,
+                           primitives_add_offsets_wgsl, 3, 0x2u);
+  primitives_create_kernel(wgpu_context, &primitives->kernels.compact,
+                           primitives_compact_wgsl, 6, 0xEu);
+  primitives_create_kernel(wgpu_context, &primitives->kernels.radix_histogram,
+                           primitives_radix_histogram_wgsl, 3, 0x2u);
+  primitives_create_kernel(wgpu_context, &primitives->kernels.radix_scatter,
+                           primitives_radix_scatter_wgsl, 6, 0xEu);
+
+  // Scan levels, also covering the digit histogram of the radix sort
+  const uint32_t sort_blocks = primitives_block_count(max_count);
+  uint32_t count = MAX(max_count, sort_blocks * PRIMITIVES_RADIX_DIGITS);
+  do {
+    ASSERT(primitives->scan_level_count < PRIMITIVES_MAX_SCAN_LEVELS);
+    count = primitives_block_count(count);
+    primitives->scan_sums[primitives->scan_level_count]
+      = primitives_create_buffer(wgpu_context, "scan_sums_buffer", count);
+    primitives->scan_offsets[primitives->scan_level_count]
+      = primitives_create_buffer(wgpu_context, "scan_offsets_buffer", count);
+    ++primitives->scan_level_count;
+  } while (count > 1);
+
+  // Scratch buffers of the compaction and the sort
+  primitives->compact_offsets = primitives_create_buffer(
+    wgpu_context, "compact_offsets_buffer", max_count);
+  primitives->sort_keys
+    = primitives_create_buffer(wgpu_context, "sort_keys_buffer", max_count);
+  primitives->sort_values
+    = primitives_create_buffer(wgpu_context, "sort_values_buffer", max_count);
+  primitives->sort_histogram = primitives_create_buffer(
+    wgpu_context, "sort_histogram_buffer",
+    sort_blocks * PRIMITIVES_RADIX_DIGITS);
+  primitives->sort_histogram_offsets = primitives_create_buffer(
+    wgpu_context, "sort_histogram_offsets_buffer",
+    sort_blocks * PRIMITIVES_RADIX_DIGITS);
+
+  return primitives;
+}
+
+void wgpu_compute_primitives_destroy(wgpu_compute_primitives_t* primitives)
+{
+  if (primitives == NULL) {
+    return;
+  }
+  primitives_release_kernel(&primitives->kernels.scan_blocks);
+  primitives_release_kernel(&primitives->kernels.add_offsets);
+  primitives_release_kernel(&primitives->kernels.compact);
+  primitives_release_kernel(&primitives->kernels.radix_histogram);
+  primitives_release_kernel(&primitives->kernels.radix_scatter);
+  for (uint32_t i = 0; i < primitives->scan_level_count; ++i) {
+    WGPU_RELEASE_RESOURCE(Buffer, primitives->scan_sums[i])
+    WGPU_RELEASE_RESOURCE(Buffer, primitives->scan_offsets[i])
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->compact_offsets)
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->sort_keys)
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->sort_values)
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->sort_histogram)
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->sort_histogram_offsets)
+  WGPU_RELEASE_RESOURCE(Buffer, primitives->params_buffer)
+  free(primitives);
+}
+
+/* Scans the blocks, scans the block sums on the next level and adds them */
+static void primitives_record_scan(wgpu_compute_primitives_t* primitives,
+                                   WGPUComputePassEncoder pass_encoder,
+                                   WGPUBuffer input, WGPUBuffer output,
+                                   uint32_t count, uint32_t level)
+{
+  ASSERT(level < primitives->scan_level_count);
+  const uint32_t block_count = primitives_block_count(count);
+  WGPUBuffer block_sums      = primitives->scan_sums[level];
+  WGPUBuffer block_offsets   = primitives->scan_offsets[level];
+
+  primitives_dispatch(primitives, pass_encoder,
+                      &primitives->kernels.scan_blocks,
+                      (WGPUBuffer[3]){input, output, block_sums}, count,
+                      block_count, 0);
+  if (block_count > 1) {
+    primitives_record_scan(primitives, pass_encoder, block_sums, block_offsets,
+                           block_count, level + 1);
+    primitives_dispatch(primitives, pass_encoder,
+                        &primitives->kernels.add_offsets,
+                        (WGPUBuffer[2]){block_offsets, output}, count,
+                        block_count, 0);
+  }
+}
+
+void wgpu_compute_exclusive_scan(wgpu_compute_primitives_t* primitives,
+                                 WGPUCommandEncoder cmd_enc, WGPUBuffer input,
+                                 WGPUBuffer output, uint32_t count)
+{
+  ASSERT(count <= primitives->max_count);
+  if (count == 0) {
+    return;
+  }
+  WGPUComputePassEncoder pass_encoder
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  primitives_record_scan(primitives, pass_encoder, input, output, count, 0);
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+}
+
+void wgpu_compute_compact(wgpu_compute_primitives_t* primitives,
+                          WGPUCommandEncoder cmd_enc, WGPUBuffer values,
+                          WGPUBuffer flags, WGPUBuffer output,
+                          WGPUBuffer output_count, uint32_t count)
+{
+  ASSERT(count <= primitives->max_count);
+  if (count == 0) {
+    return;
+  }
+  WGPUComputePassEncoder pass_encoder
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  primitives_record_scan(primitives, pass_encoder, flags,
+                         primitives->compact_offsets, count, 0);
+  primitives_dispatch(
+    primitives, pass_encoder, &primitives->kernels.compact,
+    (WGPUBuffer[5]){flags, values, primitives->compact_offsets, output,
+                    output_count},
+    count, primitives_block_count(count), 0);
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+}
+
+void wgpu_compute_radix_sort(wgpu_compute_primitives_t* primitives,
+                             WGPUCommandEncoder cmd_enc, WGPUBuffer keys,
+                             WGPUBuffer values, uint32_t count)
+{
+  wgpu_compute_radix_sort_bits(primitives, cmd_enc, keys, values, count, 32);
+}
+
+void wgpu_compute_radix_sort_bits(wgpu_compute_primitives_t* primitives,
+                                  WGPUCommandEncoder cmd_enc, WGPUBuffer keys,
+                                  WGPUBuffer values, uint32_t count,
+                                  uint32_t key_bits)
+{
+  ASSERT(count <= primitives->max_count);
+  ASSERT(key_bits > 0 && key_bits <= 32
+         && key_bits % (2 * PRIMITIVES_RADIX_BITS) == 0);
+  if (count <= 1) {
+    return;
+  }
+  const uint32_t block_count = primitives_block_count(count);
+  WGPUBuffer key_buffers[2]   = {keys, primitives->sort_keys};
+  WGPUBuffer value_buffers[2] = {values, primitives->sort_values};
+
+  // The passes alternate between the buffers and the scratch buffers, after
+  // an even number of passes the result is in the buffers
+  WGPUComputePassEncoder pass_encoder
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  for (uint32_t shift = 0; shift < key_bits; shift += PRIMITIVES_RADIX_BITS) {
+    const uint32_t src = (shift / PRIMITIVES_RADIX_BITS) % 2;
+    const uint32_t dst = 1 - src;
+    primitives_dispatch(
+      primitives, pass_encoder, &primitives->kernels.radix_histogram,
+      (WGPUBuffer[2]){key_buffers[src], primitives->sort_histogram}, count,
+      block_count, shift);
+    primitives_record_scan(primitives, pass_encoder,
+                           primitives->sort_histogram,
+                           primitives->sort_histogram_offsets,
+                           block_count * PRIMITIVES_RADIX_DIGITS, 0);
+    primitives_dispatch(
+      primitives, pass_encoder, &primitives->kernels.radix_scatter,
+      (WGPUBuffer[5]){key_buffers[src], value_buffers[src],
+                      primitives->sort_histogram_offsets, key_buffers[dst],
+                      value_buffers[dst]},
+      count, block_count, shift);
+  }
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+}
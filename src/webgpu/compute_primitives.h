@@ -0,0 +1,73 @@
+#ifndef COMPUTE_PRIMITIVES_H
+#define COMPUTE_PRIMITIVES_H
+
+#include "context.h"
+
+/* Parameter sets available per submit, see below */
+#define WGPU_COMPUTE_PRIMITIVES_PARAM_SLOTS 256u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU compute primitives
+ *
+ * Parallel building blocks on u32 storage buffers:
+ *  - exclusive prefix sum (scan)
+ *  - stream compaction of the values flagged with 1
+ *  - key/value radix sort of 32-bit keys (4 bits per pass, stable)
+ *
+ * Every call records one compute pass on the command encoder. The buffers
+ * need the Storage usage and at least count elements, the input and output
+ * buffers of a call have to be different buffers. The scratch buffers are
+ * sized for max_count elements at creation, the calls accept up to max_count
+ * elements.
+ *
+ * The element counts of the passes are written into parameter slots with
+ * queue writes when the pass is recorded. A scan uses about two slots per
+ * 256x reduction level, a sort about 8 times the slots of a scan, the slots
+ * are reused after WGPU_COMPUTE_PRIMITIVES_PARAM_SLOTS parameter sets. The
+ * calls recorded before a submit must not use more slots than that.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_compute_primitives wgpu_compute_primitives_t;
+
+/* Compute primitives creating / destroying */
+wgpu_compute_primitives_t*
+wgpu_compute_primitives_create(wgpu_context_t* wgpu_context,
+                               uint32_t max_count);
+void wgpu_compute_primitives_destroy(wgpu_compute_primitives_t* primitives);
+
+/**
+ * @brief Exclusive prefix sum: output[i] = input[0] + ... + input[i - 1]
+ */
+void wgpu_compute_exclusive_scan(wgpu_compute_primitives_t* primitives,
+                                 WGPUCommandEncoder cmd_enc, WGPUBuffer input,
+                                 WGPUBuffer output, uint32_t count);
+
+/**
+ * @brief Stream compaction: writes the values whose flag is 1 to the front of
+ * the output buffer, preserving their order. The flags have to be 0 or 1, they
+ * are summed to get the output offsets. The number of written values is stored
+ * as u32 in output_count.
+ */
+void wgpu_compute_compact(wgpu_compute_primitives_t* primitives,
+                          WGPUCommandEncoder cmd_enc, WGPUBuffer values,
+                          WGPUBuffer flags, WGPUBuffer output,
+                          WGPUBuffer output_count, uint32_t count);
+
+/**
+ * @brief Sorts the keys in ascending order and moves the values along, in
+ * place. Sorting equal keys keeps the order of their values.
+ */
+void wgpu_compute_radix_sort(wgpu_compute_primitives_t* primitives,
+                             WGPUCommandEncoder cmd_enc, WGPUBuffer keys,
+                             WGPUBuffer values, uint32_t count);
+
+/**
+ * @brief Radix sort of the keys by their low key_bits bits, the higher bits
+ * have to be 0. Takes a pass per 4 bits, key_bits has to be a multiple of 8.
+ */
+void wgpu_compute_radix_sort_bits(wgpu_compute_primitives_t* primitives,
+                                  WGPUCommandEncoder cmd_enc, WGPUBuffer keys,
+                                  WGPUBuffer values, uint32_t count,
+                                  uint32_t key_bits);
+
+#endif /* COMPUTE_PRIMITIVES_H */
@@ -0,0 +1,183 @@
+#include "compute_scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "../webgpu/profiler.h"
+
+typedef struct compute_task_t {
+  wgpu_compute_task_desc_t desc;
+  uint32_t level;
+} compute_task_t;
+
+/**
+ * @brief Compute scheduler class
+ */
+struct wgpu_compute_scheduler {
+  wgpu_context_t* wgpu_context;
+  compute_task_t tasks[WGPU_COMPUTE_SCHEDULER_MAX_TASKS];
+  uint32_t task_count;
+  uint32_t level_count;
+  uint32_t submitted_level_count;
+};
+
+/* Compute scheduler creating / destroying */
+
+wgpu_compute_scheduler_t*
+wgpu_compute_scheduler_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_compute_scheduler_t* scheduler
+    = (wgpu_compute_scheduler_t*)malloc(sizeof(*scheduler));
+  memset(scheduler, 0, sizeof(*scheduler));
+  scheduler->wgpu_context = wgpu_context;
+
+  return scheduler;
+}
+
+void wgpu_compute_scheduler_destroy(wgpu_compute_scheduler_t* scheduler)
+{
+  free(scheduler);
+}
+
+/* Dependency tracking */
+
+static bool resources_overlap(const void* const* a, uint32_t a_count,
+                              const void* const* b, uint32_t b_count)
+{
+  for (uint32_t i = 0; i < a_count; ++i) {
+    for (uint32_t j = 0; j < b_count; ++j) {
+      if (a[i] == b[j]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* Read after write, write after read and write after write */
+static bool task_depends_on(const wgpu_compute_task_desc_t* task,
+                            const wgpu_compute_task_desc_t* earlier)
+{
+  return resources_overlap(task->reads, task->read_count, earlier->writes,
+                           earlier->write_count)
+         || resources_overlap(task->writes, task->write_count, earlier->reads,
+                              earlier->read_count)
+         || resources_overlap(task->writes, task->write_count,
+                              earlier->writes, earlier->write_count);
+}
+
+uint32_t
+wgpu_compute_scheduler_add_task(wgpu_compute_scheduler_t* scheduler,
+                                const wgpu_compute_task_desc_t* task_desc)
+{
+  ASSERT(scheduler->task_count < WGPU_COMPUTE_SCHEDULER_MAX_TASKS);
+  ASSERT((task_desc->pass_func != NULL) != (task_desc->encoder_func != NULL));
+  ASSERT(task_desc->read_count <= WGPU_COMPUTE_SCHEDULER_MAX_TASK_RESOURCES
+         && task_desc->write_count
+              <= WGPU_COMPUTE_SCHEDULER_MAX_TASK_RESOURCES);
+
+  /* One level after the latest task it depends on */
+  uint32_t level = 0;
+  for (uint32_t i = 0; i < scheduler->task_count; ++i) {
+    const compute_task_t* earlier = &scheduler->tasks[i];
+    if (earlier->level >= level && task_depends_on(task_desc, &earlier->desc)) {
+      level = earlier->level + 1;
+    }
+  }
+
+  compute_task_t* task = &scheduler->tasks[scheduler->task_count++];
+  task->desc           = *task_desc;
+  task->level          = level;
+
+  scheduler->level_count = MAX(scheduler->level_count, level + 1);
+
+  return level;
+}
+
+/* Task recording */
+
+static void record_level(wgpu_compute_scheduler_t* scheduler,
+                         WGPUCommandEncoder cmd_enc, uint32_t level)
+{
+  uint32_t task_count = 0, pass_task_count = 0;
+  const char* label   = NULL;
+  for (uint32_t i = 0; i < scheduler->task_count; ++i) {
+    const compute_task_t* task = &scheduler->tasks[i];
+    if (task->level == level) {
+      label = task->desc.label;
+      ++task_count;
+      pass_task_count += (task->desc.pass_func != NULL) ? 1 : 0;
+    }
+  }
+  if (task_count == 0) {
+    return;
+  }
+
+  char scope_name[64];
+  if (task_count == 1 && label != NULL) {
+    snprintf(scope_name, sizeof(scope_name), "%s", label);
+  }
+  else {
+    snprintf(scope_name, sizeof(scope_name), "Compute level %u", level);
+  }
+  wgpu_profiler_t* profiler = scheduler->wgpu_context->profiler;
+  wgpu_profiler_begin_scope(profiler, cmd_enc, scope_name);
+
+  /* The independent dispatches of the level share a compute pass */
+  if (pass_task_count > 0) {
+    WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+      cmd_enc, &(WGPUComputePassDescriptor){
+                 .label = scope_name,
+               });
+    for (uint32_t i = 0; i < scheduler->task_count; ++i) {
+      const compute_task_t* task = &scheduler->tasks[i];
+      if (task->level == level && task->desc.pass_func != NULL) {
+        task->desc.pass_func(cpass_enc, task->desc.user_data);
+      }
+    }
+    wgpuComputePassEncoderEnd(cpass_enc);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  }
+  for (uint32_t i = 0; i < scheduler->task_count; ++i) {
+    const compute_task_t* task = &scheduler->tasks[i];
+    if (task->level == level && task->desc.encoder_func != NULL) {
+      task->desc.encoder_func(cmd_enc, task->desc.user_data);
+    }
+  }
+
+  wgpu_profiler_end_scope(profiler, cmd_enc);
+}
+
+void wgpu_compute_scheduler_submit(wgpu_compute_scheduler_t* scheduler)
+{
+  scheduler->submitted_level_count = scheduler->level_count;
+  if (scheduler->task_count == 0) {
+    return;
+  }
+
+  wgpu_context_t* wgpu_context = scheduler->wgpu_context;
+  WGPUCommandEncoder cmd_enc   = wgpuDeviceCreateCommandEncoder(
+    wgpu_context->device, &(WGPUCommandEncoderDescriptor){
+                            .label = "Compute scheduler command encoder",
+                          });
+  for (uint32_t level = 0; level < scheduler->level_count; ++level) {
+    record_level(scheduler, cmd_enc, level);
+  }
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+
+  /* Flushes the pending uploads the tasks depend on first */
+  wgpu_flush_command_buffers(wgpu_context, &command_buffer, 1);
+
+  scheduler->task_count  = 0;
+  scheduler->level_count = 0;
+}
+
+uint32_t
+wgpu_compute_scheduler_get_level_count(wgpu_compute_scheduler_t* scheduler)
+{
+  return scheduler->submitted_level_count;
+}
@@ -0,0 +1,77 @@
+#ifndef COMPUTE_SCHEDULER_H
+#define COMPUTE_SCHEDULER_H
+
+#include "context.h"
+
+#define WGPU_COMPUTE_SCHEDULER_MAX_TASKS 32u
+#define WGPU_COMPUTE_SCHEDULER_MAX_TASK_RESOURCES 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU compute scheduler
+ *
+ * Submits the compute work of a frame ahead of its render passes, in a
+ * command buffer of its own. WebGPU has a single queue, the scheduler emulates
+ * async compute scheduling on it:
+ *
+ *   wgpu_compute_scheduler_add_task(scheduler, &task_desc);  per compute task
+ *   wgpu_compute_scheduler_submit(scheduler);
+ *   prepare_frame(context);
+ *   ... record and submit the render passes ...
+ *
+ * Submitted before the swap chain image is acquired, the GPU runs the
+ * simulation while the CPU waits for the image and records the render
+ * passes, and the backend can overlap it with the end of the previous frame.
+ * The render passes of the frame see the results, they are submitted later.
+ *
+ * The tasks declare the buffers and textures they read and write. A task
+ * depends on the tasks added before it which write a resource it reads or
+ * writes, or read a resource it writes. The tasks are recorded by dependency
+ * level: the independent tasks of a level share a compute pass, so the
+ * backend does not have to wait for one before starting the next, and the
+ * levels follow each other. Every level is a profiler scope.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_compute_scheduler wgpu_compute_scheduler_t;
+
+/* Records the dispatches of a task into the shared compute pass of its level */
+typedef void (*wgpu_compute_task_pass_func_t)(WGPUComputePassEncoder cpass_enc,
+                                              void* user_data);
+/* Records a task with passes or copies of its own, e.g. a prefix scan */
+typedef void (*wgpu_compute_task_encoder_func_t)(WGPUCommandEncoder cmd_enc,
+                                                 void* user_data);
+
+typedef struct wgpu_compute_task_desc_t {
+  const char* label;
+  /* Handles of the buffers and textures the task reads / writes */
+  uint32_t read_count;
+  const void* reads[WGPU_COMPUTE_SCHEDULER_MAX_TASK_RESOURCES];
+  uint32_t write_count;
+  const void* writes[WGPU_COMPUTE_SCHEDULER_MAX_TASK_RESOURCES];
+  /* Exactly one of the record functions */
+  wgpu_compute_task_pass_func_t pass_func;
+  wgpu_compute_task_encoder_func_t encoder_func;
+  void* user_data;
+} wgpu_compute_task_desc_t;
+
+/* Compute scheduler creating / destroying */
+wgpu_compute_scheduler_t*
+wgpu_compute_scheduler_create(wgpu_context_t* wgpu_context);
+void wgpu_compute_scheduler_destroy(wgpu_compute_scheduler_t* scheduler);
+
+/**
+ * @brief Adds a task to the tasks of the next submit.
+ * @return the dependency level of the task, 0 for tasks without dependencies
+ */
+uint32_t
+wgpu_compute_scheduler_add_task(wgpu_compute_scheduler_t* scheduler,
+                                const wgpu_compute_task_desc_t* task_desc);
+
+/* Records the tasks by dependency level into a command buffer and submits it,
+ * the tasks are removed afterwards */
+void wgpu_compute_scheduler_submit(wgpu_compute_scheduler_t* scheduler);
+
+/* Dependency levels of the last submit */
+uint32_t
+wgpu_compute_scheduler_get_level_count(wgpu_compute_scheduler_t* scheduler);
+
+#endif /* COMPUTE_SCHEDULER_H */
@@ -8,11 +8,42 @@
 #include "../core/platform.h"
 #include "../core/window.h"
 
+#include "../webgpu/bind_group_cache.h"
 #include "../webgpu/buffer.h"
+#include "../webgpu/debug_markers.h"
+#include "../webgpu/gpu_stats.h"
+#include "../webgpu/mipmap_tuner.h"
+#include "../webgpu/pipeline_cache.h"
+#include "../webgpu/pipeline_statistics.h"
+#include "../webgpu/profiler.h"
+#include "../webgpu/readback.h"
+#include "../webgpu/sampler_cache.h"
+#include "../webgpu/shader.h"
+#include "../webgpu/shader_watch.h"
 #include "../webgpu/texture.h"
+#include "../webgpu/upload_batch.h"
+#include "../webgpu/upload_ring.h"
+#include "../webgpu/workgroup_tuner.h"
+#include "../webgpu/write_combiner.h"
 
 #include "../../lib/wgpu_native/wgpu_native.h"
 
+/* Depth convention of the pipeline state factories, these have no context */
+static bool depth_reversed_z = false;
+
+/* Proc table hook, the debug markers wrap the counting procs, every submit
+ * is preceded by the combined queue writes and then the pending upload batch
+ * (the batch wraps the write combiner, queue writes stay before it) */
+static void context_hook_procs(DawnProcTable* procs)
+{
+#ifdef WGPU_STATS_ENABLED
+  wgpu_stats_hook_procs(procs);
+#endif
+  wgpu_debug_markers_hook_procs(procs);
+  wgpu_write_combiner_hook_procs(procs);
+  wgpu_upload_batch_hook_procs(procs);
+}
+
 /* WebGPU context creating/releasing */
 wgpu_context_t* wgpu_context_create(wgpu_context_create_options_t* options)
 {
@@ -24,9 +55,64 @@ wgpu_context_t* wgpu_context_create(wgpu_context_create_options_t* options)
         (options->vsync ? WGPUPresentMode_Fifo : WGPUPresentMode_Mailbox) :
         WGPUPresentMode_Mailbox;
 
+  context->frame_pacing.frames_in_flight
+    = (options && options->frames_in_flight > 0) ?
+        MIN(options->frames_in_flight, WGPU_MAX_FRAMES_IN_FLIGHT) :
+        WGPU_DEFAULT_FRAMES_IN_FLIGHT;
+
+  /* Backend validation, the pipeline cache, the adapter selection and the
+   * statistics and debug marker proc hook have to be configured before
+   * requesting the adapter */
+  wgpu_set_backend_validation_level(
+    options ? options->validation_level : BackendValidationLevel_Default);
+  wgpu_set_pipeline_cache_dir(options ? options->pipeline_cache_dir : NULL);
+  wgpu_adapter_selection_t adapter_selection;
+  wgpu_parse_adapter_selection(options ? options->adapter : NULL,
+                               &adapter_selection);
+  wgpu_set_adapter_selection(&adapter_selection);
+  if (options && options->required_limits) {
+    context->required_limits = *options->required_limits;
+  }
+  context->power_preference = (options && options->low_power) ?
+                                WGPUPowerPreference_LowPower :
+                                WGPUPowerPreference_HighPerformance;
+  wgpu_debug_markers_set_enabled(options && options->gpu_markers);
+  wgpu_set_proc_table_hook(context_hook_procs);
+
+  if (options && options->watch_shaders) {
+    context->shader_watch = wgpu_shader_watch_create();
+  }
+
+  wgpu_set_reversed_z(context, options && options->reversed_z);
+
   return context;
 }
 
+/* Subsystems created with the device in wgpu_create_device_and_queue() */
+static void release_device_subsystems(wgpu_context_t* wgpu_context)
+{
+  wgpu_profiler_release(wgpu_context->profiler);
+  wgpu_context->profiler = NULL;
+  wgpu_pipeline_statistics_release(wgpu_context->pipeline_statistics);
+  wgpu_context->pipeline_statistics = NULL;
+  wgpu_staging_pool_release(wgpu_context->staging_pool);
+  wgpu_context->staging_pool = NULL;
+  wgpu_write_combiner_release(wgpu_context->write_combiner);
+  wgpu_context->write_combiner = NULL;
+  wgpu_upload_ring_release(wgpu_context->upload_ring);
+  wgpu_context->upload_ring = NULL;
+}
+
+static void release_device(wgpu_context_t* wgpu_context)
+{
+  /* Releasing the device is no device loss to recover from */
+  if (wgpu_context->device != NULL) {
+    wgpuDeviceSetDeviceLostCallback(wgpu_context->device, NULL, NULL);
+  }
+  WGPU_RELEASE_RESOURCE(Queue, wgpu_context->queue);
+  WGPU_RELEASE_RESOURCE(Device, wgpu_context->device);
+}
+
 void wgpu_context_release(wgpu_context_t* wgpu_context)
 {
   if (wgpu_context->texture_client != NULL) {
@@ -34,15 +120,135 @@ void wgpu_context_release(wgpu_context_t* wgpu_context)
     wgpu_context->texture_client = NULL;
   }
 
+  /* Work done callbacks reference the context */
+  wgpu_wait_for_pending_frames(wgpu_context);
+
+  wgpu_upload_batch_flush(wgpu_context);
+  wgpu_readback_pool_release(wgpu_context->readback_pool);
+  wgpu_context->readback_pool = NULL;
+  release_device_subsystems(wgpu_context);
+  wgpu_bind_group_cache_release(wgpu_context->bind_group_cache);
+  wgpu_context->bind_group_cache = NULL;
+  wgpu_sampler_cache_release(wgpu_context->sampler_cache);
+  wgpu_context->sampler_cache = NULL;
+  wgpu_pipeline_cache_release(wgpu_context->pipeline_cache);
+  wgpu_context->pipeline_cache = NULL;
+  wgpu_shader_cache_release(wgpu_context->shader_cache);
+  wgpu_context->shader_cache = NULL;
+  wgpu_shader_watch_release(wgpu_context->shader_watch);
+  wgpu_context->shader_watch = NULL;
+  wgpu_workgroup_tuner_release(wgpu_context->workgroup_tuner);
+  wgpu_context->workgroup_tuner = NULL;
+  wgpu_mipmap_tuner_release(wgpu_context->mipmap_tuner);
+  wgpu_context->mipmap_tuner = NULL;
+
   WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->depth_stencil.texture_view);
   WGPU_RELEASE_RESOURCE(Texture, wgpu_context->depth_stencil.texture);
   WGPU_RELEASE_RESOURCE(SwapChain, wgpu_context->swap_chain.instance);
-  WGPU_RELEASE_RESOURCE(Queue, wgpu_context->queue);
-  WGPU_RELEASE_RESOURCE(Device, wgpu_context->device);
+  WGPU_RELEASE_RESOURCE(Texture, wgpu_context->swap_chain.offscreen_texture);
+
+  /* All buffers and textures should be released by now */
+  wgpu_stats_report_memory();
+
+  release_device(wgpu_context);
 
   free(wgpu_context);
 }
 
+void wgpu_context_reset(wgpu_context_t* wgpu_context)
+{
+  /* Uploads recorded by the example */
+  wgpu_upload_batch_flush(wgpu_context);
+  wgpu_context->upload_batch.depth = 0;
+  /* The readback callbacks belong to the example */
+  wgpu_readback_pool_release(wgpu_context->readback_pool);
+  wgpu_context->readback_pool = NULL;
+  if (wgpu_context->texture_client != NULL) {
+    wgpu_texture_client_destroy(wgpu_context->texture_client);
+    wgpu_context->texture_client = NULL;
+  }
+  wgpu_bind_group_cache_release(wgpu_context->bind_group_cache);
+  wgpu_context->bind_group_cache = NULL;
+  wgpu_sampler_cache_release(wgpu_context->sampler_cache);
+  wgpu_context->sampler_cache = NULL;
+  wgpu_pipeline_cache_release(wgpu_context->pipeline_cache);
+  wgpu_context->pipeline_cache = NULL;
+  wgpu_shader_cache_release(wgpu_context->shader_cache);
+  wgpu_context->shader_cache = NULL;
+
+  WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->depth_stencil.texture_view);
+  WGPU_RELEASE_RESOURCE(Texture, wgpu_context->depth_stencil.texture);
+  WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->swap_chain.frame_buffer);
+  memset(&wgpu_context->depth_stencil.att_desc, 0,
+         sizeof(wgpu_context->depth_stencil.att_desc));
+  /* The depth convention belongs to the example, this also resets the one of
+   * the pipeline state factories */
+  wgpu_set_reversed_z(wgpu_context, false);
+
+  wgpu_context->context                          = NULL;
+  wgpu_context->cmd_enc                          = NULL;
+  wgpu_context->rpass_enc                        = NULL;
+  wgpu_context->cpass_enc                        = NULL;
+  wgpu_context->submit_info.command_buffer_count = 0;
+}
+
+/* Device loss */
+static void wgpu_device_lost_callback(WGPUDeviceLostReason reason,
+                                      char const* message, void* userdata)
+{
+  wgpu_context_t* wgpu_context = (wgpu_context_t*)userdata;
+  wgpu_context->device_lost    = true;
+  log_error("Device lost(%d): %s", (int)reason, message);
+}
+
+void wgpu_recreate_device(wgpu_context_t* wgpu_context)
+{
+  const float time_start = platform_get_time();
+
+  /* The caches and per-example resources, the owner of the context stays */
+  void* owner = wgpu_context->context;
+  wgpu_context_reset(wgpu_context);
+  wgpu_context->context = owner;
+
+  /* The work done callbacks of a lost device may never be called */
+  release_device_subsystems(wgpu_context);
+  WGPU_RELEASE_RESOURCE(SwapChain, wgpu_context->swap_chain.instance);
+  WGPU_RELEASE_RESOURCE(Texture, wgpu_context->swap_chain.offscreen_texture);
+  release_device(wgpu_context);
+  wgpu_context->frame_pacing.pending_frames = 0;
+  wgpu_context->frame_pacing.frame_index    = 0;
+  wgpu_context->device_lost                 = false;
+
+  /* Same adapter selection, features and limits as before */
+  wgpu_create_device_and_queue(wgpu_context);
+  wgpu_setup_swap_chain(wgpu_context);
+
+  log_info("Device recreated in %.2f s", platform_get_time() - time_start);
+}
+
+/* Frame pacing */
+static void wgpu_frame_work_done_callback(WGPUQueueWorkDoneStatus status,
+                                          void* userdata)
+{
+  UNUSED_VAR(status);
+
+  wgpu_context_t* wgpu_context = (wgpu_context_t*)userdata;
+  if (wgpu_context->frame_pacing.pending_frames > 0) {
+    --wgpu_context->frame_pacing.pending_frames;
+  }
+}
+
+void wgpu_wait_for_pending_frames(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->device == NULL) {
+    return;
+  }
+  while (wgpu_context->frame_pacing.pending_frames > 0
+         && !wgpu_context->device_lost) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+}
+
 /* WebGPU info functions */
 void wgpu_get_context_info(char (*adapter_info)[256])
 {
@@ -64,42 +270,157 @@ WGPUBuffer wgpu_create_buffer_from_data(wgpu_context_t* wgpu_context,
   return buffer;
 }
 
+/* Features queried after device creation, the supported ones are requested */
+static const WGPUFeatureName feature_names[WGPU_FEATURE_COUNT] = {
+  WGPUFeatureName_Depth32FloatStencil8,
+  WGPUFeatureName_TimestampQuery,
+  WGPUFeatureName_PipelineStatisticsQuery,
+  WGPUFeatureName_TextureCompressionBC,
+  WGPUFeatureName_TextureCompressionETC2,
+  WGPUFeatureName_TextureCompressionASTC,
+  WGPUFeatureName_IndirectFirstInstance,
+  WGPUFeatureName_DepthClamping,
+  WGPUFeatureName_DawnShaderFloat16,
+  WGPUFeatureName_DawnInternalUsages,
+  WGPUFeatureName_DawnMultiPlanarFormats,
+};
+
+/* Maximum limits, "better" is larger */
+#define WGPU_MAX_LIMITS_U32(X)                                                 \
+  X(maxTextureDimension1D)                                                     \
+  X(maxTextureDimension2D)                                                     \
+  X(maxTextureDimension3D)                                                     \
+  X(maxTextureArrayLayers)                                                     \
+  X(maxBindGroups)                                                             \
+  X(maxDynamicUniformBuffersPerPipelineLayout)                                 \
+  X(maxDynamicStorageBuffersPerPipelineLayout)                                 \
+  X(maxSampledTexturesPerShaderStage)                                          \
+  X(maxSamplersPerShaderStage)                                                 \
+  X(maxStorageBuffersPerShaderStage)                                           \
+  X(maxStorageTexturesPerShaderStage)                                          \
+  X(maxUniformBuffersPerShaderStage)                                           \
+  X(maxVertexBuffers)                                                          \
+  X(maxVertexAttributes)                                                       \
+  X(maxVertexBufferArrayStride)                                                \
+  X(maxInterStageShaderComponents)                                             \
+  X(maxComputeWorkgroupStorageSize)                                            \
+  X(maxComputeInvocationsPerWorkgroup)                                         \
+  X(maxComputeWorkgroupSizeX)                                                  \
+  X(maxComputeWorkgroupSizeY)                                                  \
+  X(maxComputeWorkgroupSizeZ)                                                  \
+  X(maxComputeWorkgroupsPerDimension)
+#define WGPU_MAX_LIMITS_U64(X)                                                 \
+  X(maxUniformBufferBindingSize)                                               \
+  X(maxStorageBufferBindingSize)
+/* Alignment limits, "better" is smaller */
+#define WGPU_MIN_LIMITS_U32(X)                                                 \
+  X(minUniformBufferOffsetAlignment)                                           \
+  X(minStorageBufferOffsetAlignment)
+
+/**
+ * @brief Limits of the device request: the adapter limits if no limit is
+ * requested, otherwise the non-zero requested limits clamped to the adapter
+ * limits and the defaults for the others.
+ */
+static void get_required_limits(const WGPULimits* requested,
+                                const WGPULimits* adapter,
+                                WGPULimits* required)
+{
+  static const WGPULimits no_limits = {0};
+  if (memcmp(requested, &no_limits, sizeof(no_limits)) == 0) {
+    *required = *adapter;
+    return;
+  }
+
+#define REQUIRE_LIMIT(name, undefined, better)                                 \
+  if (requested->name == 0) {                                                  \
+    required->name = undefined;                                                \
+  }                                                                            \
+  else {                                                                       \
+    required->name = better(requested->name, adapter->name);                   \
+    if (required->name != requested->name) {                                   \
+      log_warn("Limit " #name " %llu not supported, using %llu\n",             \
+               (unsigned long long)requested->name,                            \
+               (unsigned long long)required->name);                            \
+    }                                                                          \
+  }
+#define REQUIRE_MAX_LIMIT_U32(name)                                            \
+  REQUIRE_LIMIT(name, WGPU_LIMIT_U32_UNDEFINED, MIN)
+#define REQUIRE_MAX_LIMIT_U64(name)                                            \
+  REQUIRE_LIMIT(name, WGPU_LIMIT_U64_UNDEFINED, MIN)
+#define REQUIRE_MIN_LIMIT_U32(name)                                            \
+  REQUIRE_LIMIT(name, WGPU_LIMIT_U32_UNDEFINED, MAX)
+
+  WGPU_MAX_LIMITS_U32(REQUIRE_MAX_LIMIT_U32)
+  WGPU_MAX_LIMITS_U64(REQUIRE_MAX_LIMIT_U64)
+  WGPU_MIN_LIMITS_U32(REQUIRE_MIN_LIMIT_U32)
+
+#undef REQUIRE_MIN_LIMIT_U32
+#undef REQUIRE_MAX_LIMIT_U64
+#undef REQUIRE_MAX_LIMIT_U32
+#undef REQUIRE_LIMIT
+}
+
 void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context)
 {
   wgpu_log_available_adapters();
 
   /* WebGPU adapter creation */
   wgpu_context->adapter = wgpu_request_adapter(&(WGPURequestAdapterOptions){
-    .powerPreference = WGPUPowerPreference_HighPerformance,
+    .powerPreference = wgpu_context->power_preference,
   });
-
-  /* WebGPU device creation */
-  WGPUFeatureName required_features[1] = {
-    WGPUFeatureName_TextureCompressionBC,
-  };
+  ASSERT(wgpu_context->adapter != NULL);
+  wgpuAdapterGetLimits(wgpu_context->adapter, &wgpu_context->adapter_limits);
+
+  /* WebGPU device creation, every feature of the feature table the adapter
+   * supports is requested */
+  WGPUFeatureName required_features[WGPU_FEATURE_COUNT] = {0};
+  uint32_t required_features_count = 0;
+  bool unsafe_features_required    = false;
+  for (uint32_t i = 0; i < WGPU_FEATURE_COUNT; ++i) {
+    if (feature_names[i] != WGPUFeatureName_Undefined
+        && wgpuAdapterHasFeature(wgpu_context->adapter, feature_names[i])) {
+      required_features[required_features_count++] = feature_names[i];
+      unsafe_features_required
+        = unsafe_features_required
+          || feature_names[i] == WGPUFeatureName_TimestampQuery
+          || feature_names[i] == WGPUFeatureName_PipelineStatisticsQuery;
+    }
+  }
+  WGPURequiredLimits required_limits = {0};
+  get_required_limits(&wgpu_context->required_limits,
+                      &wgpu_context->adapter_limits.limits,
+                      &required_limits.limits);
   WGPUDeviceDescriptor deviceDescriptor = {
-    .requiredFeaturesCount = (uint32_t)ARRAY_SIZE(required_features),
+    .requiredFeaturesCount = required_features_count,
     .requiredFeatures      = required_features,
+    .requiredLimits        = &required_limits,
   };
+
+  /* Timestamp queries are used by the GPU profiler, they and the pipeline
+   * statistics queries are considered an unsafe API by Dawn */
+  static const char* disabled_toggles[1] = {"disallow_unsafe_apis"};
+  WGPUDawnTogglesDeviceDescriptor toggles_desc = {
+    .chain = {
+      .sType = WGPUSType_DawnTogglesDeviceDescriptor,
+    },
+    .forceDisabledTogglesCount = (uint32_t)ARRAY_SIZE(disabled_toggles),
+    .forceDisabledToggles      = disabled_toggles,
+  };
+  if (unsafe_features_required) {
+    deviceDescriptor.nextInChain = &toggles_desc.chain;
+  }
+
   wgpu_context->device
     = wgpuAdapterCreateDevice(wgpu_context->adapter, &deviceDescriptor);
+  ASSERT(wgpu_context->device != NULL);
   wgpuDeviceSetUncapturedErrorCallback(
     wgpu_context->device, &wgpu_error_callback, (void*)wgpu_context);
+  wgpuDeviceSetDeviceLostCallback(
+    wgpu_context->device, &wgpu_device_lost_callback, (void*)wgpu_context);
+  wgpuDeviceGetLimits(wgpu_context->device, &wgpu_context->limits);
 
   /* Query device features */
-  static const WGPUFeatureName feature_names[WGPU_FEATURE_COUNT] = {
-    WGPUFeatureName_Depth32FloatStencil8,
-    WGPUFeatureName_TimestampQuery,
-    WGPUFeatureName_PipelineStatisticsQuery,
-    WGPUFeatureName_TextureCompressionBC,
-    WGPUFeatureName_TextureCompressionETC2,
-    WGPUFeatureName_TextureCompressionASTC,
-    WGPUFeatureName_IndirectFirstInstance,
-    WGPUFeatureName_DepthClamping,
-    WGPUFeatureName_DawnShaderFloat16,
-    WGPUFeatureName_DawnInternalUsages,
-    WGPUFeatureName_DawnMultiPlanarFormats,
-  };
   for (uint32_t i = 0; i < WGPU_FEATURE_COUNT; ++i) {
     wgpu_context->features[i].feature_name = feature_names[i];
     wgpu_context->features[i].is_supported
@@ -108,6 +429,23 @@ void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context)
 
   /* Get the default queue from the device */
   wgpu_context->queue = wgpuDeviceGetQueue(wgpu_context->device);
+
+  /* Upload ring for per-frame buffer updates */
+  wgpu_context->upload_ring = wgpu_upload_ring_create(wgpu_context, NULL);
+  /* Small queue buffer writes are combined into upload ring copies */
+  wgpu_context->write_combiner = wgpu_write_combiner_create(wgpu_context);
+
+  /* GPU profiler */
+  if (wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery)) {
+    wgpu_context->profiler = wgpu_profiler_create(wgpu_context);
+  }
+
+  /* Shader invocation counts of the tagged passes */
+  if (wgpu_has_feature(wgpu_context,
+                       WGPUFeatureName_PipelineStatisticsQuery)) {
+    wgpu_context->pipeline_statistics
+      = wgpu_pipeline_statistics_create(wgpu_context);
+  }
 }
 
 bool wgpu_has_feature(wgpu_context_t* wgpu_context,
@@ -130,24 +468,55 @@ void wgpu_setup_window_surface(wgpu_context_t* wgpu_context, void* window)
                   &wgpu_context->surface.height);
 }
 
+void wgpu_setup_offscreen_surface(wgpu_context_t* wgpu_context, uint32_t width,
+                                  uint32_t height)
+{
+  wgpu_context->surface.instance    = NULL;
+  wgpu_context->surface.width       = width;
+  wgpu_context->surface.height      = height;
+  wgpu_context->swap_chain.headless = true;
+}
+
+WGPUTextureFormat
+wgpu_get_default_depth_stencil_format(wgpu_context_t* wgpu_context)
+{
+  /* Reversed-Z only pays off with a floating point depth buffer */
+  return wgpu_context->depth_stencil.reversed_z ?
+           WGPUTextureFormat_Depth32Float :
+           WGPUTextureFormat_Depth24PlusStencil8;
+}
+
 void wgpu_setup_deph_stencil(
   wgpu_context_t* wgpu_context,
   struct deph_stencil_texture_creation_options_t* options)
 {
+  WGPUTextureFormat format
+    = (options != NULL && options->format != WGPUTextureFormat_Undefined) ?
+        options->format :
+        wgpu_get_default_depth_stencil_format(wgpu_context);
+  uint32_t sample_count = options != NULL ? MAX(1, options->sample_count) : 1;
+
+  /* Only (re)create the texture if the size or the format changed */
   if ((wgpu_context->depth_stencil.texture != NULL)
       && (wgpu_context->depth_stencil.texture_view != NULL)) {
-    return;
+    if (wgpu_context->depth_stencil.format == format
+        && wgpu_context->depth_stencil.sample_count == sample_count
+        && wgpu_context->depth_stencil.width == wgpu_context->surface.width
+        && wgpu_context->depth_stencil.height == wgpu_context->surface.height) {
+      return;
+    }
   }
-
-  WGPUTextureFormat format = options != NULL ?
-                               (options->format != WGPUTextureFormat_Undefined ?
-                                  options->format :
-                                  WGPUTextureFormat_Depth24PlusStencil8) :
-                               WGPUTextureFormat_Depth24PlusStencil8;
-  uint32_t sample_count = options != NULL ? MAX(1, options->sample_count) : 1;
-
+  WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->depth_stencil.texture_view)
+  WGPU_RELEASE_RESOURCE(Texture, wgpu_context->depth_stencil.texture)
+  wgpu_context->depth_stencil.format       = format;
+  wgpu_context->depth_stencil.sample_count = sample_count;
+  wgpu_context->depth_stencil.width        = wgpu_context->surface.width;
+  wgpu_context->depth_stencil.height       = wgpu_context->surface.height;
+
+  /* Texture binding for the depth pyramid of the Hi-Z culling */
   WGPUTextureDescriptor depth_texture_desc = {
-    .usage         = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+    .usage         = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc
+             | WGPUTextureUsage_TextureBinding,
     .format        = format,
     .dimension     = WGPUTextureDimension_2D,
     .mipLevelCount = 1,
@@ -177,8 +546,8 @@ void wgpu_setup_deph_stencil(
     .view            = wgpu_context->depth_stencil.texture_view,
     .depthLoadOp     = WGPULoadOp_Clear,
     .depthStoreOp    = WGPUStoreOp_Store,
-    .depthClearValue = 1.0f,
-    .clearDepth      = 1.0f,
+    .depthClearValue = wgpu_context->depth_stencil.reversed_z ? 0.0f : 1.0f,
+    .clearDepth      = wgpu_context->depth_stencil.reversed_z ? 0.0f : 1.0f,
     .clearStencil    = 0,
   };
 
@@ -190,12 +559,50 @@ void wgpu_setup_deph_stencil(
   }
 }
 
+/* Headless replacement of the swap chain images */
+static void setup_offscreen_frame_buffer(wgpu_context_t* wgpu_context,
+                                         WGPUTextureFormat format)
+{
+  WGPU_RELEASE_RESOURCE(Texture, wgpu_context->swap_chain.offscreen_texture)
+
+  WGPUTextureDescriptor texture_desc = {
+    .label         = "Offscreen frame buffer",
+    .usage         = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc
+             | WGPUTextureUsage_TextureBinding,
+    .format        = format,
+    .dimension     = WGPUTextureDimension_2D,
+    .mipLevelCount = 1,
+    .sampleCount   = 1,
+    .size          = (WGPUExtent3D) {
+      .width               = wgpu_context->surface.width,
+      .height              = wgpu_context->surface.height,
+      .depthOrArrayLayers  = 1,
+     },
+  };
+  wgpu_context->swap_chain.offscreen_texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  ASSERT(wgpu_context->swap_chain.offscreen_texture);
+
+  wgpu_context->swap_chain.format = format;
+}
+
 void wgpu_setup_swap_chain(wgpu_context_t* wgpu_context)
 {
+  /* Keep the format when the swap chain is recreated */
+  WGPUTextureFormat format
+    = wgpu_context->swap_chain.format != WGPUTextureFormat_Undefined ?
+        wgpu_context->swap_chain.format :
+        WGPUTextureFormat_BGRA8Unorm;
+
+  if (wgpu_context->swap_chain.headless) {
+    setup_offscreen_frame_buffer(wgpu_context, format);
+    return;
+  }
+
   /* Create the swap chain */
   WGPUSwapChainDescriptor swap_chain_descriptor = {
     .usage       = WGPUTextureUsage_RenderAttachment,
-    .format      = WGPUTextureFormat_BGRA8Unorm,
+    .format      = format,
     .width       = wgpu_context->surface.width,
     .height      = wgpu_context->surface.height,
     .presentMode = wgpu_context->swap_chain.present_mode,
@@ -212,10 +619,54 @@ void wgpu_setup_swap_chain(wgpu_context_t* wgpu_context)
   wgpu_context->swap_chain.format = swap_chain_descriptor.format;
 }
 
+void wgpu_resize_swap_chain(wgpu_context_t* wgpu_context, uint32_t width,
+                            uint32_t height)
+{
+  /* A minimized window has a zero sized surface */
+  if (width == 0 || height == 0
+      || (width == wgpu_context->surface.width
+          && height == wgpu_context->surface.height)) {
+    return;
+  }
+
+  wgpu_context->surface.width  = width;
+  wgpu_context->surface.height = height;
+  wgpu_setup_swap_chain(wgpu_context);
+
+  if (wgpu_context->depth_stencil.texture != NULL) {
+    wgpu_setup_deph_stencil(
+      wgpu_context, &(struct deph_stencil_texture_creation_options_t){
+                      .format       = wgpu_context->depth_stencil.format,
+                      .sample_count = wgpu_context->depth_stencil.sample_count,
+                    });
+  }
+}
+
+void wgpu_set_present_mode(wgpu_context_t* wgpu_context,
+                           WGPUPresentMode present_mode)
+{
+  wgpu_context->swap_chain.requested_present_mode = present_mode;
+  wgpu_context->swap_chain.present_mode_changed
+    = (wgpu_context->swap_chain.present_mode != present_mode);
+}
+
+void wgpu_set_reversed_z(wgpu_context_t* wgpu_context, bool enabled)
+{
+  wgpu_context->depth_stencil.reversed_z = enabled;
+  depth_reversed_z                       = enabled;
+
+  /* An existing attachment keeps its format, only the clear value changes */
+  if (wgpu_context->depth_stencil.texture_view != NULL) {
+    const float clear_depth = enabled ? 0.0f : 1.0f;
+    wgpu_context->depth_stencil.att_desc.depthClearValue = clear_depth;
+    wgpu_context->depth_stencil.att_desc.clearDepth      = clear_depth;
+  }
+}
+
 void wgpu_error_callback(WGPUErrorType error_type, char const* message,
                          void* userdata)
 {
-  UNUSED_VAR(userdata);
+  wgpu_context_t* wgpu_context = (wgpu_context_t*)userdata;
 
   const char* error_type_name = "";
   switch (error_type) {
@@ -230,6 +681,9 @@ void wgpu_error_callback(WGPUErrorType error_type, char const* message,
       break;
     case WGPUErrorType_DeviceLost:
       error_type_name = "Device lost";
+      if (wgpu_context != NULL) {
+        wgpu_context->device_lost = true;
+      }
       break;
     default:
       return;
@@ -257,7 +711,10 @@ WGPUCommandBuffer wgpu_get_command_buffer(WGPUCommandEncoder cmd_encoder)
 WGPUTextureView wgpu_swap_chain_get_current_image(wgpu_context_t* wgpu_context)
 {
   wgpu_context->swap_chain.frame_buffer
-    = wgpuSwapChainGetCurrentTextureView(wgpu_context->swap_chain.instance);
+    = wgpu_context->swap_chain.headless ?
+        wgpuTextureCreateView(wgpu_context->swap_chain.offscreen_texture,
+                              NULL) :
+        wgpuSwapChainGetCurrentTextureView(wgpu_context->swap_chain.instance);
   return wgpu_context->swap_chain.frame_buffer;
 }
 
@@ -268,6 +725,11 @@ void wgpu_flush_command_buffers(wgpu_context_t* wgpu_context,
 {
   ASSERT(command_buffers != NULL)
 
+  /* Submit the combined writes and the upload ring copies first, the frame
+   * depends on them */
+  wgpu_write_combiner_flush(wgpu_context->write_combiner);
+  wgpu_upload_ring_flush(wgpu_context->upload_ring);
+
   /* Submit to the queue */
   wgpuQueueSubmit(wgpu_context->queue, command_buffer_count, command_buffers);
 
@@ -279,9 +741,49 @@ void wgpu_flush_command_buffers(wgpu_context_t* wgpu_context,
 
 void wgpu_swap_chain_present(wgpu_context_t* wgpu_context)
 {
-  wgpuSwapChainPresent(wgpu_context->swap_chain.instance);
+  /* Resolve the GPU timestamps and pipeline statistics of this frame */
+  wgpu_profiler_end_frame(wgpu_context->profiler);
+  wgpu_pipeline_statistics_end_frame(wgpu_context->pipeline_statistics);
+  /* Recycle the staging buffers once the GPU finished the copies */
+  wgpu_staging_pool_end_frame(wgpu_context->staging_pool);
+  /* Complete the draw call and upload counters of this frame */
+  wgpu_stats_end_frame();
+  /* Evict the bind groups not requested recently */
+  wgpu_bind_group_cache_end_frame(wgpu_context->bind_group_cache);
+  /* Number the unlabeled passes of the next frame from zero */
+  wgpu_debug_markers_end_frame();
+
+  /* Headless frames stay in the offscreen frame buffer */
+  if (!wgpu_context->swap_chain.headless) {
+    wgpuSwapChainPresent(wgpu_context->swap_chain.instance);
+  }
 
   WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->swap_chain.frame_buffer)
+
+  /* Switch the present mode between two frames */
+  if (wgpu_context->swap_chain.present_mode_changed) {
+    wgpu_context->swap_chain.present_mode
+      = wgpu_context->swap_chain.requested_present_mode;
+    wgpu_context->swap_chain.present_mode_changed = false;
+    if (!wgpu_context->swap_chain.headless) {
+      wgpu_setup_swap_chain(wgpu_context);
+    }
+  }
+
+  /* Frame pacing: the CPU only blocks when it is frames_in_flight frames
+   * ahead of the GPU, afterwards the next per-frame resource slot is used */
+  ++wgpu_context->frame_pacing.pending_frames;
+  wgpuQueueOnSubmittedWorkDone(wgpu_context->queue, 0,
+                               wgpu_frame_work_done_callback, wgpu_context);
+  wgpuDeviceTick(wgpu_context->device);
+  while (wgpu_context->frame_pacing.pending_frames
+           >= wgpu_context->frame_pacing.frames_in_flight
+         && !wgpu_context->device_lost) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+  wgpu_context->frame_pacing.frame_index
+    = (wgpu_context->frame_pacing.frame_index + 1)
+      % wgpu_context->frame_pacing.frames_in_flight;
 }
 
 /* Texture client creation */
@@ -324,10 +826,17 @@ wgpu_create_depth_stencil_state(create_depth_stencil_state_desc_t* desc)
     .passOp      = WGPUStencilOperation_Keep,
   };
 
+  WGPUCompareFunction depth_compare = depth_reversed_z ?
+                                        WGPUCompareFunction_GreaterEqual :
+                                        WGPUCompareFunction_LessEqual;
+  if (desc->depth_prepass) {
+    depth_compare = WGPUCompareFunction_Equal;
+  }
+
   return (WGPUDepthStencilState){
-    .depthWriteEnabled   = desc->depth_write_enabled,
+    .depthWriteEnabled   = desc->depth_write_enabled && !desc->depth_prepass,
     .format              = desc->format,
-    .depthCompare        = WGPUCompareFunction_LessEqual,
+    .depthCompare        = depth_compare,
     .stencilFront        = stencil_state_face_descriptor,
     .stencilBack         = stencil_state_face_descriptor,
     .stencilReadMask     = 0xFFFFFFFF,
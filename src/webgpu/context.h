@@ -3,6 +3,8 @@
 
 #include <dawn/webgpu.h>
 
+#include "../../lib/wgpu_native/wgpu_native.h"
+
 #define WGPU_RELEASE_RESOURCE(Type, Name)                                      \
   if (Name) {                                                                  \
     wgpu##Type##Release(Name);                                                 \
@@ -41,17 +43,49 @@
     = WGPU_VERTBUFFERLAYOUT_DESC(bind_size, vert_attr_desc_##name);
 
 #define MAX_COMMAND_BUFFER_COUNT 256
+#define WGPU_MAX_FRAMES_IN_FLIGHT 3u
+#define WGPU_DEFAULT_FRAMES_IN_FLIGHT 2u
 #define WGPU_FEATURE_COUNT 12u
 
 /* Initializers */
 
 /* Forward declarations */
+struct wgpu_bind_group_cache;
 struct wgpu_buffer_t;
+struct wgpu_pipeline_statistics;
+struct wgpu_profiler;
+struct wgpu_readback_pool;
+struct wgpu_sampler_cache;
+struct wgpu_staging_pool;
+struct wgpu_upload_ring;
+struct wgpu_write_combiner;
 struct wgpu_texture_client_t;
 
 /* WebGPU context create options */
 typedef struct wgpu_context_create_options_t {
   bool vsync;
+  backend_validation_level_enum validation_level;
+  /* Max number of frames the CPU can queue ahead of the GPU (1-3), 0 = use
+   * WGPU_DEFAULT_FRAMES_IN_FLIGHT */
+  uint32_t frames_in_flight;
+  /* Directory of the persistent backend pipeline cache, NULL or an empty
+   * string disables it */
+  const char* pipeline_cache_dir;
+  /* Reload shader files when they change on disk */
+  bool watch_shaders;
+  /* Debug groups around the passes for external GPU profilers, see
+   * debug_markers.h */
+  bool gpu_markers;
+  /* Reversed-Z depth, see wgpu_set_reversed_z() */
+  bool reversed_z;
+  /* Adapter selection, see wgpu_parse_adapter_selection(), NULL = select by
+   * power preference */
+  const char* adapter;
+  /* Prefer integrated over discrete GPUs */
+  bool low_power;
+  /* Device limits, the non-zero limits are requested. NULL or all zero =
+   * request the adapter limits. */
+  const WGPULimits* required_limits;
 } wgpu_context_create_options_t;
 
 /* WebGPU context */
@@ -65,6 +99,13 @@ typedef struct wgpu_context_t {
     WGPUFeatureName feature_name;
     bool is_supported;
   } features[WGPU_FEATURE_COUNT];
+  /* Power preference of the adapter request, limits of the selected adapter */
+  WGPUPowerPreference power_preference;
+  WGPUSupportedLimits adapter_limits;
+  /* Limits requested on device creation (all zero = the adapter limits) and
+   * the limits of the device */
+  WGPULimits required_limits;
+  WGPUSupportedLimits limits;
   struct {
     void* instance;
     uint32_t width;
@@ -75,6 +116,13 @@ typedef struct wgpu_context_t {
     WGPUTextureFormat format;
     WGPUTextureView frame_buffer;
     WGPUPresentMode present_mode;
+    /* Present mode change requested during a frame, applied after present */
+    bool present_mode_changed;
+    WGPUPresentMode requested_present_mode;
+    /* Headless mode: frame_buffer is a view of this offscreen texture, it has
+     * the CopySrc usage for capturing the frames */
+    bool headless;
+    WGPUTexture offscreen_texture;
   } swap_chain;
   WGPUCommandEncoder cmd_enc;       /* Command encoder */
   WGPURenderPassEncoder rpass_enc;  /* Render pass encoder */
@@ -83,17 +131,65 @@ typedef struct wgpu_context_t {
     WGPUTexture texture;
     WGPUTextureView texture_view;
     WGPURenderPassDepthStencilAttachment att_desc;
+    /* Creation parameters, used to recreate the texture on resize */
+    WGPUTextureFormat format;
+    uint32_t sample_count;
+    uint32_t width;
+    uint32_t height;
+    /* Depth 1.0 at the near plane and 0.0 at the (infinite) far plane */
+    bool reversed_z;
   } depth_stencil;
   struct {
     uint32_t command_buffer_count;
     WGPUCommandBuffer command_buffers[MAX_COMMAND_BUFFER_COUNT];
   } submit_info;
+  struct {
+    uint32_t frames_in_flight; /* Max number of frames queued ahead */
+    uint32_t frame_index;      /* Slot of the per-frame resources in use */
+    uint32_t pending_frames;   /* Presented frames not yet done on the GPU */
+  } frame_pacing;
+  /* Load time uploads submitted together, see upload_batch.h */
+  struct {
+    WGPUCommandEncoder cmd_encoder; /* NULL until the first upload */
+    uint32_t depth;                 /* Nesting level, 0 = no batch */
+  } upload_batch;
   struct wgpu_texture_client_t* texture_client;
+  struct wgpu_profiler* profiler; /* NULL if timestamps are not supported */
+  /* NULL if pipeline statistics queries are not supported */
+  struct wgpu_pipeline_statistics* pipeline_statistics;
+  struct wgpu_staging_pool* staging_pool;
+  struct wgpu_readback_pool* readback_pool;
+  struct wgpu_upload_ring* upload_ring;
+  struct wgpu_write_combiner* write_combiner;
+  struct wgpu_shader_cache* shader_cache;
+  struct wgpu_pipeline_cache* pipeline_cache;
+  struct wgpu_bind_group_cache* bind_group_cache;
+  struct wgpu_sampler_cache* sampler_cache;
+  struct wgpu_shader_watch* shader_watch; /* NULL if hot reload is disabled */
+  struct wgpu_workgroup_tuner* workgroup_tuner;
+  struct wgpu_mipmap_tuner* mipmap_tuner;
+  /* Set when the device is lost, see wgpu_recreate_device() */
+  bool device_lost;
 } wgpu_context_t;
 
 /* WebGPU context creating/releasing */
 wgpu_context_t* wgpu_context_create(wgpu_context_create_options_t* options);
 void wgpu_context_release(wgpu_context_t* wgpu_context);
+/* Releases the per-example resources but keeps the device and swap chain */
+void wgpu_context_reset(wgpu_context_t* wgpu_context);
+
+/**
+ * @brief Replaces a lost device by a new device of the same adapter selection,
+ * features and limits. Releases the per-example resources like
+ * wgpu_context_reset() and the subsystems created with the device, then
+ * creates the device, queue and swap chain anew. The owner of the context
+ * recreates its resources afterwards. The persistent pipeline cache and the
+ * workgroup tuning results are kept, so the recreation is mostly loading.
+ */
+void wgpu_recreate_device(wgpu_context_t* wgpu_context);
+
+/* Frame pacing */
+void wgpu_wait_for_pending_frames(wgpu_context_t* wgpu_context);
 
 /* WebGPU info functions */
 void wgpu_get_context_info(char (*adapter_info)[256]);
@@ -111,10 +207,32 @@ WGPUBuffer wgpu_create_buffer_from_data(wgpu_context_t* wgpu_context,
                                         WGPUBufferUsage usage);
 void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context);
 void wgpu_setup_window_surface(wgpu_context_t* wgpu_context, void* window);
+/* Headless mode without window and swap chain, wgpu_setup_swap_chain()
+ * creates an offscreen frame buffer of the given size and presenting only
+ * completes the frame */
+void wgpu_setup_offscreen_surface(wgpu_context_t* wgpu_context, uint32_t width,
+                                  uint32_t height);
 void wgpu_setup_deph_stencil(
   wgpu_context_t* wgpu_context,
   struct deph_stencil_texture_creation_options_t* options);
+/* Format of the depth-stencil texture when no format is requested */
+WGPUTextureFormat
+wgpu_get_default_depth_stencil_format(wgpu_context_t* wgpu_context);
 void wgpu_setup_swap_chain(wgpu_context_t* wgpu_context);
+/* Recreates the swap chain (and the depth-stencil texture if present) */
+void wgpu_resize_swap_chain(wgpu_context_t* wgpu_context, uint32_t width,
+                            uint32_t height);
+/* The swap chain is recreated with the new mode after the current frame */
+void wgpu_set_present_mode(wgpu_context_t* wgpu_context,
+                           WGPUPresentMode present_mode);
+/**
+ * @brief Switches the depth convention of the context. With reversed-Z the
+ * depth-stencil texture defaults to Depth32Float and is cleared to 0.0, and
+ * wgpu_create_depth_stencil_state() compares with GreaterEqual. The float
+ * precision is then spread evenly over the view distance, which pairs with
+ * perspective_matrix_reversed_z_infinite_far() (see camera_t.reversed_z).
+ */
+void wgpu_set_reversed_z(wgpu_context_t* wgpu_context, bool enabled);
 void wgpu_error_callback(WGPUErrorType type, char const* message,
                          void* userdata);
 
@@ -140,6 +258,8 @@ WGPUBlendState wgpu_create_blend_state(bool enable_blend);
 typedef struct create_depth_stencil_state_desc_t {
   WGPUTextureFormat format;
   bool depth_write_enabled;
+  /* The depth was laid down by a depth pre-pass: Equal test without writes */
+  bool depth_prepass;
 } create_depth_stencil_state_desc_t;
 WGPUDepthStencilState
 wgpu_create_depth_stencil_state(create_depth_stencil_state_desc_t* desc);
@@ -0,0 +1,749 @@
+#include "cubemap_filter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
+#include "shader.h"
+#include "upload_batch.h"
+
+#define CUBEMAP_FILTER_WORKGROUP_SIZE 8u
+#define CUBEMAP_FILTER_MAX_MIP_LEVELS 16u
+#define CUBEMAP_FILTER_DEFAULT_SAMPLE_COUNT 32u
+/* Minimum uniform buffer offset alignment (WebGPU default limit) */
+#define CUBEMAP_FILTER_PARAMS_STRIDE 256u
+
+/* Parameters of one mip level */
+typedef struct cubemap_filter_params_t {
+  uint32_t face_size;
+  uint32_t sample_count;
+  float roughness;
+  float delta_phi;
+  float delta_theta;
+  uint32_t padding[3];
+} cubemap_filter_params_t;
+
+static const struct {
+  WGPUTextureFormat format;
+  const char* wgsl_format;
+} cubemap_filter_formats[3] = {
+  {WGPUTextureFormat_RGBA8Unorm, "rgba8unorm"},
+  {WGPUTextureFormat_RGBA16Float, "rgba16float"},
+  {WGPUTextureFormat_RGBA32Float, "rgba32float"},
+};
+
+// clang-format off
+static const char* cubemap_filter_shader_wgsl_format = CODE(
+  struct Params {
+    face_size : u32,
+    sample_count : u32,
+    roughness : f32,
+    delta_phi : f32,
+    delta_theta : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var environment_map : texture_cube<f32>;
+  @group(0) @binding(2) var environment_sampler : sampler;
+  @group(0) @binding(3) var filtered_map : texture_storage_2d_array<%s, write>;
+
+  const PI = 3.1415926535897932384626433832795;
+
+  // Direction of the texel center, WebGPU cubemap face layout
+  fn texel_direction(texel : vec2<u32>, face : u32) -> vec3<f32> {
+    let uv = (vec2<f32>(texel) + 0.5) / f32(params.face_size) * 2.0 - 1.0;
+    switch (face) {
+      case 0u: { return normalize(vec3<f32>(1.0, -uv.y, -uv.x)); }
+      case 1u: { return normalize(vec3<f32>(-1.0, -uv.y, uv.x)); }
+      case 2u: { return normalize(vec3<f32>(uv.x, 1.0, uv.y)); }
+      case 3u: { return normalize(vec3<f32>(uv.x, -1.0, -uv.y)); }
+      case 4u: { return normalize(vec3<f32>(uv.x, -uv.y, 1.0)); }
+      default: { return normalize(vec3<f32>(-uv.x, -uv.y, -1.0)); }
+    }
+  }
+
+  fn tangent_up(normal : vec3<f32>) -> vec3<f32> {
+    return select(vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 0.0, 1.0),
+                  abs(normal.z) < 0.999);
+  }
+
+  fn irradiance(normal : vec3<f32>) -> vec3<f32> {
+    let right = normalize(cross(tangent_up(normal), normal));
+    let up = cross(normal, right);
+    var color = vec3<f32>(0.0);
+    var sample_count = 0u;
+    for (var phi = 0.0; phi < 2.0 * PI; phi += params.delta_phi) {
+      for (var theta = 0.0; theta < 0.5 * PI; theta += params.delta_theta) {
+        let tangent = cos(phi) * right + sin(phi) * up;
+        let direction = cos(theta) * normal + sin(theta) * tangent;
+        color += textureSampleLevel(environment_map, environment_sampler,
+                                    direction, 0.0).rgb
+                 * cos(theta) * sin(theta);
+        sample_count++;
+      }
+    }
+    return PI * color / f32(max(sample_count, 1u));
+  }
+
+  fn random(co : vec2<f32>) -> f32 {
+    let dt = dot(co, vec2<f32>(12.9898, 78.233));
+    let sn = dt - 3.14 * floor(dt / 3.14);
+    return fract(sin(sn) * 43758.5453);
+  }
+
+  fn hammersley_2d(i : u32, n : u32) -> vec2<f32> {
+    return vec2<f32>(f32(i) / f32(n),
+                     f32(reverseBits(i)) * 2.3283064365386963e-10);
+  }
+
+  // Based on Karis, Real Shading in Unreal Engine 4
+  fn importance_sample_ggx(xi : vec2<f32>, roughness : f32,
+                           normal : vec3<f32>) -> vec3<f32> {
+    let alpha = roughness * roughness;
+    let phi = 2.0 * PI * xi.y + random(normal.xz) * 0.1;
+    let cos_theta = sqrt((1.0 - xi.x) / (1.0 + (alpha * alpha - 1.0) * xi.x));
+    let sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+    let h = vec3<f32>(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+    let tangent_x = normalize(cross(tangent_up(normal), normal));
+    let tangent_y = normalize(cross(normal, tangent_x));
+    return normalize(tangent_x * h.x + tangent_y * h.y + normal * h.z);
+  }
+
+  fn d_ggx(dot_nh : f32, roughness : f32) -> f32 {
+    let alpha = roughness * roughness;
+    let alpha2 = alpha * alpha;
+    let denom = dot_nh * dot_nh * (alpha2 - 1.0) + 1.0;
+    return alpha2 / (PI * denom * denom);
+  }
+
+  fn prefilter(r : vec3<f32>) -> vec3<f32> {
+    let roughness = params.roughness;
+    let sample_count = params.sample_count;
+    let env_map_dim = f32(textureDimensions(environment_map).x);
+    // Solid angle of a texel of the source mip level 0
+    let omega_p = 4.0 * PI / (6.0 * env_map_dim * env_map_dim);
+    var color = vec3<f32>(0.0);
+    var total_weight = 0.0;
+    for (var i = 0u; i < sample_count; i++) {
+      let xi = hammersley_2d(i, sample_count);
+      let h = importance_sample_ggx(xi, roughness, r);
+      let l = 2.0 * dot(r, h) * h - r;
+      let dot_nl = clamp(dot(r, l), 0.0, 1.0);
+      if (dot_nl > 0.0) {
+        let dot_nh = clamp(dot(r, h), 0.0, 1.0);
+        let dot_vh = clamp(dot(r, h), 0.0, 1.0);
+        // Probability distribution function and solid angle of the sample
+        let pdf = d_ggx(dot_nh, roughness) * dot_nh / (4.0 * dot_vh) + 0.0001;
+        let omega_s = 1.0 / (f32(sample_count) * pdf);
+        let mip_level = select(max(0.5 * log2(omega_s / omega_p) + 1.0, 0.0),
+                               0.0, roughness == 0.0);
+        color += textureSampleLevel(environment_map, environment_sampler, l,
+                                    mip_level).rgb * dot_nl;
+        total_weight += dot_nl;
+      }
+    }
+    return color / max(total_weight, 0.0001);
+  }
+
+  @compute @workgroup_size(8, 8, 1)
+  fn irradiance_main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= vec2<u32>(params.face_size))) {
+      return;
+    }
+    let color = irradiance(texel_direction(id.xy, id.z));
+    textureStore(filtered_map, vec2<i32>(id.xy), i32(id.z),
+                 vec4<f32>(color, 1.0));
+  }
+
+  @compute @workgroup_size(8, 8, 1)
+  fn prefilter_main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= vec2<u32>(params.face_size))) {
+      return;
+    }
+    let color = prefilter(texel_direction(id.xy, id.z));
+    textureStore(filtered_map, vec2<i32>(id.xy), i32(id.z),
+                 vec4<f32>(color, 1.0));
+  }
+);
+// clang-format on
+
+static const char* cubemap_filter_get_wgsl_format(WGPUTextureFormat format)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(cubemap_filter_formats); ++i) {
+    if (cubemap_filter_formats[i].format == format) {
+      return cubemap_filter_formats[i].wgsl_format;
+    }
+  }
+  return NULL;
+}
+
+static WGPUComputePipeline
+cubemap_filter_create_pipeline(wgpu_context_t* wgpu_context,
+                               wgpu_cubemap_filter_type_enum_t type,
+                               const char* wgsl_format)
+{
+  // The storage texture format is part of the shader
+  const size_t wgsl_size
+    = strlen(cubemap_filter_shader_wgsl_format) + strlen(wgsl_format) + 1;
+  char* wgsl_code = (char*)malloc(wgsl_size);
+  snprintf(wgsl_code, wgsl_size, cubemap_filter_shader_wgsl_format,
+           wgsl_format);
+
+  wgpu_shader_t filter_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = type == WGPU_CubemapFilter_Irradiance ?
+                                          "irradiance_main" :
+                                          "prefilter_main",
+                  });
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "cubemap_filter_compute_pipeline",
+                    .compute = filter_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&filter_shader);
+  free(wgsl_code);
+
+  return pipeline;
+}
+
+texture_t wgpu_cubemap_filter(wgpu_context_t* wgpu_context,
+                              const texture_t* source,
+                              const wgpu_cubemap_filter_desc_t* desc)
+{
+  ASSERT(source && source->view && source->size.depth == 6);
+  ASSERT(desc->size > 0 && desc->mip_level_count > 0
+         && desc->mip_level_count <= CUBEMAP_FILTER_MAX_MIP_LEVELS);
+
+  const WGPUTextureFormat format = desc->format != WGPUTextureFormat_Undefined ?
+                                     desc->format :
+                                     WGPUTextureFormat_RGBA8Unorm;
+  const char* wgsl_format        = cubemap_filter_get_wgsl_format(format);
+  if (wgsl_format == NULL) {
+    log_error("Cubemap filter: unsupported storage format %d", format);
+    return (texture_t){0};
+  }
+  const uint32_t mip_level_count = desc->mip_level_count;
+
+  // Filtered cubemap
+  WGPUTextureDescriptor texture_desc = {
+    .label         = desc->label ? desc->label : "cubemap_filter_texture",
+    .usage         = WGPUTextureUsage_TextureBinding
+             | WGPUTextureUsage_StorageBinding | WGPUTextureUsage_CopySrc,
+    .dimension     = WGPUTextureDimension_2D,
+    .size          = (WGPUExtent3D){
+      .width              = desc->size,
+      .height             = desc->size,
+      .depthOrArrayLayers = 6,
+    },
+    .format        = format,
+    .mipLevelCount = mip_level_count,
+    .sampleCount   = 1,
+  };
+  WGPUTexture texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  ASSERT(texture != NULL);
+
+  // Parameters of every mip level, the roughness of the prefiltered levels
+  // goes from 0 to 1
+  cubemap_filter_params_t params[CUBEMAP_FILTER_MAX_MIP_LEVELS] = {0};
+  uint8_t params_data[CUBEMAP_FILTER_MAX_MIP_LEVELS
+                      * CUBEMAP_FILTER_PARAMS_STRIDE]
+    = {0};
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    params[m] = (cubemap_filter_params_t){
+      .face_size    = MAX(desc->size >> m, 1u),
+      .sample_count = desc->sample_count > 0 ?
+                        desc->sample_count :
+                        CUBEMAP_FILTER_DEFAULT_SAMPLE_COUNT,
+      .roughness
+      = mip_level_count > 1 ? (float)m / (float)(mip_level_count - 1) : 0.0f,
+      .delta_phi   = (2.0f * PI) / 180.0f,
+      .delta_theta = (0.5f * PI) / 64.0f,
+    };
+    memcpy(params_data + m * CUBEMAP_FILTER_PARAMS_STRIDE, &params[m],
+           sizeof(params[m]));
+  }
+  WGPUBuffer params_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, params_data,
+    (size_t)mip_level_count * CUBEMAP_FILTER_PARAMS_STRIDE,
+    WGPUBufferUsage_Uniform);
+
+  WGPUComputePipeline pipeline
+    = cubemap_filter_create_pipeline(wgpu_context, desc->type, wgsl_format);
+  WGPUBindGroupLayout bind_group_layout
+    = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+  WGPUSampler source_sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Linear,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = (float)source->mip_level_count,
+                    .maxAnisotropy = 1,
+                  });
+
+  // One dispatch per mip level, the faces are the z dimension
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_encoder, &(WGPUComputePassDescriptor){
+                   .label = "Cubemap filter compute pass",
+                 });
+  wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    WGPUTextureView level_view = wgpuTextureCreateView(
+      texture, &(WGPUTextureViewDescriptor){
+                 .label           = "cubemap_filter_level_view",
+                 .format          = format,
+                 .dimension       = WGPUTextureViewDimension_2DArray,
+                 .baseMipLevel    = m,
+                 .mipLevelCount   = 1,
+                 .baseArrayLayer  = 0,
+                 .arrayLayerCount = 6,
+                 .aspect          = WGPUTextureAspect_All,
+               });
+    WGPUBindGroupEntry bg_entries[4] = {
+      [0] = (WGPUBindGroupEntry){
+        .binding = 0,
+        .buffer  = params_buffer,
+        .offset  = m * CUBEMAP_FILTER_PARAMS_STRIDE,
+        .size    = sizeof(cubemap_filter_params_t),
+      },
+      [1] = (WGPUBindGroupEntry){
+        .binding     = 1,
+        .textureView = source->view,
+      },
+      [2] = (WGPUBindGroupEntry){
+        .binding = 2,
+        .sampler = source_sampler,
+      },
+      [3] = (WGPUBindGroupEntry){
+        .binding     = 3,
+        .textureView = level_view,
+      },
+    };
+    WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .layout     = bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+
+    const uint32_t workgroup_count
+      = (params[m].face_size + CUBEMAP_FILTER_WORKGROUP_SIZE - 1)
+        / CUBEMAP_FILTER_WORKGROUP_SIZE;
+    wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, workgroup_count,
+                                             workgroup_count, 6);
+
+    // The command encoder keeps the resources alive until the submit
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+    WGPU_RELEASE_RESOURCE(TextureView, level_view)
+  }
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
+
+  WGPU_RELEASE_RESOURCE(Sampler, source_sampler)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipeline)
+  WGPU_RELEASE_RESOURCE(Buffer, params_buffer)
+
+  // Cube view and sampler of the filtered cubemap
+  WGPUTextureView view = wgpuTextureCreateView(
+    texture, &(WGPUTextureViewDescriptor){
+               .label           = "cubemap_filter_texture_view",
+               .format          = format,
+               .dimension       = WGPUTextureViewDimension_Cube,
+               .baseMipLevel    = 0,
+               .mipLevelCount   = mip_level_count,
+               .baseArrayLayer  = 0,
+               .arrayLayerCount = 6,
+               .aspect          = WGPUTextureAspect_All,
+             });
+  WGPUSampler sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Linear,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = (float)mip_level_count,
+                    .maxAnisotropy = 1,
+                  });
+
+  return (texture_t){
+    .size = {
+      .width  = desc->size,
+      .height = desc->size,
+      .depth  = 6,
+    },
+    .mip_level_count = mip_level_count,
+    .format          = format,
+    .dimension       = WGPUTextureDimension_2D,
+    .texture         = texture,
+    .view            = view,
+    .sampler         = sampler,
+  };
+}
+
+/* -------------------------------------------------------------------------- *
+ * Equirectangular to cubemap conversion
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* equirect_to_cubemap_shader_wgsl_format = CODE(
+  struct Params {
+    face_size : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var panorama : texture_2d<f32>;
+  @group(0) @binding(2) var source_level : texture_2d_array<f32>;
+  @group(0) @binding(3) var cube_level : texture_storage_2d_array<%s, write>;
+
+  const PI = 3.1415926535897932384626433832795;
+
+  // Direction of a face position in [-1, 1], WebGPU cubemap face layout
+  fn face_direction(uv : vec2<f32>, face : u32) -> vec3<f32> {
+    switch (face) {
+      case 0u: { return normalize(vec3<f32>(1.0, -uv.y, -uv.x)); }
+      case 1u: { return normalize(vec3<f32>(-1.0, -uv.y, uv.x)); }
+      case 2u: { return normalize(vec3<f32>(uv.x, 1.0, uv.y)); }
+      case 3u: { return normalize(vec3<f32>(uv.x, -1.0, -uv.y)); }
+      case 4u: { return normalize(vec3<f32>(uv.x, -uv.y, 1.0)); }
+      default: { return normalize(vec3<f32>(-uv.x, -uv.y, -1.0)); }
+    }
+  }
+
+  // Texels are loaded, float panoramas are not filterable
+  fn load_panorama(texel : vec2<i32>, size : vec2<i32>) -> vec4<f32> {
+    let x = ((texel.x % size.x) + size.x) % size.x; // wraps around
+    let y = clamp(texel.y, 0, size.y - 1);
+    return textureLoad(panorama, vec2<i32>(x, y), 0);
+  }
+
+  fn sample_panorama(direction : vec3<f32>) -> vec4<f32> {
+    let size = vec2<i32>(textureDimensions(panorama));
+    let uv = vec2<f32>(atan2(direction.x, -direction.z) / (2.0 * PI) + 0.5,
+                       acos(clamp(direction.y, -1.0, 1.0)) / PI);
+    let position = uv * vec2<f32>(size) - 0.5;
+    let texel = vec2<i32>(floor(position));
+    let f = position - floor(position);
+    let top = mix(load_panorama(texel, size),
+                  load_panorama(texel + vec2<i32>(1, 0), size), f.x);
+    let bottom = mix(load_panorama(texel + vec2<i32>(0, 1), size),
+                     load_panorama(texel + vec2<i32>(1, 1), size), f.x);
+    return mix(top, bottom, f.y);
+  }
+
+  // Mip level 0, 2 x 2 samples of the panorama per texel
+  @compute @workgroup_size(8, 8, 1)
+  fn equirect_main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= vec2<u32>(params.face_size))) {
+      return;
+    }
+    var color = vec4<f32>(0.0);
+    for (var i = 0u; i < 4u; i++) {
+      let offset = vec2<f32>(f32(i & 1u), f32(i >> 1u)) * 0.5 + 0.25;
+      let uv = (vec2<f32>(id.xy) + offset) / f32(params.face_size) * 2.0
+               - 1.0;
+      color += sample_panorama(face_direction(uv, id.z));
+    }
+    textureStore(cube_level, vec2<i32>(id.xy), i32(id.z), color * 0.25);
+  }
+
+  // Mip levels 1..n, box filter of the previous level
+  @compute @workgroup_size(8, 8, 1)
+  fn downsample_main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(id.xy >= vec2<u32>(params.face_size))) {
+      return;
+    }
+    let last = vec2<i32>(textureDimensions(source_level)) - 1;
+    let texel = vec2<i32>(id.xy) * 2;
+    var color = vec4<f32>(0.0);
+    for (var i = 0; i < 4; i++) {
+      let offset = vec2<i32>(i & 1, i >> 1u);
+      color += textureLoad(source_level, min(texel + offset, last),
+                           i32(id.z), 0);
+    }
+    textureStore(cube_level, vec2<i32>(id.xy), i32(id.z), color * 0.25);
+  }
+);
+// clang-format on
+
+static WGPUComputePipeline
+equirect_to_cubemap_create_pipeline(wgpu_context_t* wgpu_context,
+                                    const char* wgsl_code, const char* entry)
+{
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = entry,
+                  });
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "equirect_to_cubemap_compute_pipeline",
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&shader);
+
+  return pipeline;
+}
+
+texture_t
+wgpu_cubemap_from_equirectangular(wgpu_context_t* wgpu_context,
+                                  const texture_t* source,
+                                  const wgpu_equirect_to_cubemap_desc_t* desc)
+{
+  ASSERT(source && source->texture && source->view);
+
+  const bool float_source = source->format == WGPUTextureFormat_RGBA16Float
+                            || source->format == WGPUTextureFormat_RGBA32Float;
+  const WGPUTextureFormat format
+    = desc->format != WGPUTextureFormat_Undefined ?
+        desc->format :
+        (float_source ? WGPUTextureFormat_RGBA16Float :
+                        WGPUTextureFormat_RGBA8Unorm);
+  const char* wgsl_format = cubemap_filter_get_wgsl_format(format);
+  if (wgsl_format == NULL) {
+    log_error("Equirect to cubemap: unsupported storage format %d", format);
+    return (texture_t){0};
+  }
+  const uint32_t size
+    = desc->size > 0 ? desc->size : MAX(source->size.width / 4u, 1u);
+  uint32_t max_mip_level_count = 1;
+  while ((size >> max_mip_level_count) > 0
+         && max_mip_level_count < CUBEMAP_FILTER_MAX_MIP_LEVELS) {
+    ++max_mip_level_count;
+  }
+  const uint32_t mip_level_count
+    = desc->mip_level_count > 0 ?
+        MIN(desc->mip_level_count, max_mip_level_count) :
+        max_mip_level_count;
+
+  // Cubemap
+  WGPUTexture texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = desc->label ? desc->label : "equirect_to_cubemap_texture",
+      .usage = WGPUTextureUsage_TextureBinding
+               | WGPUTextureUsage_StorageBinding | WGPUTextureUsage_CopySrc,
+      .dimension = WGPUTextureDimension_2D,
+      .size      = (WGPUExtent3D){
+        .width              = size,
+        .height             = size,
+        .depthOrArrayLayers = 6,
+      },
+      .format        = format,
+      .mipLevelCount = mip_level_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(texture != NULL);
+
+  // Face size of every mip level
+  uint8_t params_data[CUBEMAP_FILTER_MAX_MIP_LEVELS
+                      * CUBEMAP_FILTER_PARAMS_STRIDE]
+    = {0};
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    const cubemap_filter_params_t params = {
+      .face_size = MAX(size >> m, 1u),
+    };
+    memcpy(params_data + m * CUBEMAP_FILTER_PARAMS_STRIDE, &params,
+           sizeof(params));
+  }
+  WGPUBuffer params_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, params_data,
+    (size_t)mip_level_count * CUBEMAP_FILTER_PARAMS_STRIDE,
+    WGPUBufferUsage_Uniform);
+
+  // The storage texture format is part of the shader
+  const size_t wgsl_size
+    = strlen(equirect_to_cubemap_shader_wgsl_format) + strlen(wgsl_format) + 1;
+  char* wgsl_code = (char*)malloc(wgsl_size);
+  snprintf(wgsl_code, wgsl_size, equirect_to_cubemap_shader_wgsl_format,
+           wgsl_format);
+  WGPUComputePipeline pipelines[2] = {
+    equirect_to_cubemap_create_pipeline(wgpu_context, wgsl_code,
+                                        "equirect_main"),
+    equirect_to_cubemap_create_pipeline(wgpu_context, wgsl_code,
+                                        "downsample_main"),
+  };
+  free(wgsl_code);
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    wgpuComputePipelineGetBindGroupLayout(pipelines[0], 0),
+    wgpuComputePipelineGetBindGroupLayout(pipelines[1], 0),
+  };
+
+  // One dispatch per mip level, the faces are the z dimension. Level m is
+  // reduced from level m - 1.
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_encoder, &(WGPUComputePassDescriptor){
+                   .label = "Equirect to cubemap compute pass",
+                 });
+  WGPUTextureView level_views[CUBEMAP_FILTER_MAX_MIP_LEVELS] = {0};
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    level_views[m] = wgpuTextureCreateView(
+      texture, &(WGPUTextureViewDescriptor){
+                 .label           = "equirect_to_cubemap_level_view",
+                 .format          = format,
+                 .dimension       = WGPUTextureViewDimension_2DArray,
+                 .baseMipLevel    = m,
+                 .mipLevelCount   = 1,
+                 .baseArrayLayer  = 0,
+                 .arrayLayerCount = 6,
+                 .aspect          = WGPUTextureAspect_All,
+               });
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry){
+        .binding = 0,
+        .buffer  = params_buffer,
+        .offset  = m * CUBEMAP_FILTER_PARAMS_STRIDE,
+        .size    = sizeof(cubemap_filter_params_t),
+      },
+      [1] = (WGPUBindGroupEntry){
+        .binding     = m == 0 ? 1 : 2,
+        .textureView = m == 0 ? source->view : level_views[m - 1],
+      },
+      [2] = (WGPUBindGroupEntry){
+        .binding     = 3,
+        .textureView = level_views[m],
+      },
+    };
+    WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .layout     = bind_group_layouts[m == 0 ? 0 : 1],
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+
+    const uint32_t face_size = MAX(size >> m, 1u);
+    const uint32_t workgroup_count
+      = (face_size + CUBEMAP_FILTER_WORKGROUP_SIZE - 1)
+        / CUBEMAP_FILTER_WORKGROUP_SIZE;
+    wgpuComputePassEncoderSetPipeline(pass_encoder,
+                                      pipelines[m == 0 ? 0 : 1]);
+    wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, workgroup_count,
+                                             workgroup_count, 6);
+
+    // The command encoder keeps the resources alive until the submit
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  }
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
+
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    WGPU_RELEASE_RESOURCE(TextureView, level_views[m])
+  }
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts[i])
+    WGPU_RELEASE_RESOURCE(ComputePipeline, pipelines[i])
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, params_buffer)
+
+  // Cube view and sampler of the cubemap
+  WGPUTextureView view = wgpuTextureCreateView(
+    texture, &(WGPUTextureViewDescriptor){
+               .label           = "equirect_to_cubemap_texture_view",
+               .format          = format,
+               .dimension       = WGPUTextureViewDimension_Cube,
+               .baseMipLevel    = 0,
+               .mipLevelCount   = mip_level_count,
+               .baseArrayLayer  = 0,
+               .arrayLayerCount = 6,
+               .aspect          = WGPUTextureAspect_All,
+             });
+  WGPUSampler sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Linear,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = (float)mip_level_count,
+                    .maxAnisotropy = 1,
+                  });
+
+  return (texture_t){
+    .size = {
+      .width  = size,
+      .height = size,
+      .depth  = 6,
+    },
+    .mip_level_count = mip_level_count,
+    .format          = format,
+    .dimension       = WGPUTextureDimension_2D,
+    .texture         = texture,
+    .view            = view,
+    .sampler         = sampler,
+  };
+}
+
+texture_t
+wgpu_cubemap_load_equirectangular(wgpu_context_t* wgpu_context,
+                                  const char* filename,
+                                  const char* baked_filename,
+                                  const wgpu_equirect_to_cubemap_desc_t* desc)
+{
+  // The baked cubemap depends on the image and the description
+  const uint32_t settings[3] = {
+    desc->size,
+    desc->mip_level_count,
+    (uint32_t)desc->format,
+  };
+  const char* const filenames[1] = {filename};
+  const uint64_t key
+    = baked_filename ?
+        wgpu_texture_file_key(filenames, 1, settings, sizeof(settings)) :
+        0;
+  if (baked_filename != NULL) {
+    texture_t cubemap = wgpu_texture_load_from_baked_file(
+      wgpu_context, baked_filename, key,
+      &(struct wgpu_texture_load_options_t){
+        .address_mode = WGPUAddressMode_ClampToEdge,
+      });
+    if (cubemap.texture != NULL) {
+      return cubemap;
+    }
+  }
+
+  // Decode and convert the panorama
+  texture_t panorama
+    = wgpu_create_texture_from_file(wgpu_context, filename, NULL);
+  if (panorama.texture == NULL) {
+    log_error("Equirect to cubemap: cannot load %s", filename);
+    return (texture_t){0};
+  }
+  texture_t cubemap
+    = wgpu_cubemap_from_equirectangular(wgpu_context, &panorama, desc);
+  wgpu_destroy_texture(&panorama);
+
+  if (baked_filename != NULL && cubemap.texture != NULL) {
+    wgpu_texture_save_to_baked_file(wgpu_context, &cubemap, baked_filename,
+                                    key);
+  }
+
+  return cubemap;
+}
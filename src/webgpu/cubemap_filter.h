@@ -0,0 +1,105 @@
+#ifndef CUBEMAP_FILTER_H
+#define CUBEMAP_FILTER_H
+
+#include "context.h"
+#include "texture.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU cubemap filter
+ *
+ * Filters an environment cubemap into the cubemaps of image based lighting
+ * with compute shaders. Every mip level is one dispatch covering all six faces
+ * (the faces are the z dimension of the dispatch), all levels are recorded
+ * into one compute pass of one command buffer:
+ *
+ *   - irradiance: cosine weighted convolution of the hemisphere around each
+ *     texel direction, the diffuse lighting
+ *   - GGX prefiltering: GGX importance sampled specular lighting, the
+ *     roughness goes from 0 at mip level 0 to 1 at the last level. The source
+ *     mip level of each sample follows the sample's solid angle (GPU Gems 3,
+ *     chapter 20) which needs a complete mip chain of the source.
+ *
+ *   texture_t irradiance = wgpu_cubemap_filter(
+ *     wgpu_context, &environment_cube,
+ *     &(wgpu_cubemap_filter_desc_t){
+ *       .type            = WGPU_CubemapFilter_Irradiance,
+ *       .size            = 64,
+ *       .mip_level_count = 7,
+ *     });
+ *
+ * The texel directions follow the WebGPU cubemap face layout, so the result
+ * is sampled with the same directions as the source.
+ * -------------------------------------------------------------------------- */
+
+typedef enum wgpu_cubemap_filter_type_enum_t {
+  WGPU_CubemapFilter_Irradiance   = 0,
+  WGPU_CubemapFilter_PrefilterGGX = 1,
+} wgpu_cubemap_filter_type_enum_t;
+
+typedef struct wgpu_cubemap_filter_desc_t {
+  const char* label;
+  wgpu_cubemap_filter_type_enum_t type;
+  /* Face size and mip levels of the filtered cubemap */
+  uint32_t size;
+  uint32_t mip_level_count;
+  /* RGBA8Unorm, RGBA16Float or RGBA32Float, Undefined = RGBA8Unorm */
+  WGPUTextureFormat format;
+  /* Samples per texel of the GGX prefiltering, 0 = 32 */
+  uint32_t sample_count;
+} wgpu_cubemap_filter_desc_t;
+
+/**
+ * @brief Creates the filtered cubemap of the source cubemap and submits the
+ * filtering. The texture has the TextureBinding, StorageBinding and CopySrc
+ * usages, it is destroyed with wgpu_destroy_texture().
+ */
+texture_t wgpu_cubemap_filter(wgpu_context_t* wgpu_context,
+                              const texture_t* source,
+                              const wgpu_cubemap_filter_desc_t* desc);
+
+/* -------------------------------------------------------------------------- *
+ * Equirectangular to cubemap conversion
+ *
+ * Resamples an equirectangular (latitude-longitude) panorama into a cubemap
+ * with a complete mip chain, one compute dispatch per mip level. The -z
+ * direction looks at the center of the panorama, +y at its top row. The
+ * conversion runs once, the cubemap is sampled with a single cube lookup per
+ * pixel and can be baked next to the panorama, see
+ * wgpu_cubemap_load_equirectangular().
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_equirect_to_cubemap_desc_t {
+  const char* label;
+  /* Face size, 0 = a quarter of the panorama width */
+  uint32_t size;
+  /* Mip levels, 0 = complete mip chain */
+  uint32_t mip_level_count;
+  /* RGBA8Unorm, RGBA16Float or RGBA32Float, Undefined = RGBA16Float for float
+   * panoramas and RGBA8Unorm otherwise */
+  WGPUTextureFormat format;
+} wgpu_equirect_to_cubemap_desc_t;
+
+/**
+ * @brief Creates the cubemap of an equirectangular panorama and submits the
+ * conversion. The texture has the TextureBinding, StorageBinding and CopySrc
+ * usages, it is destroyed with wgpu_destroy_texture().
+ */
+texture_t
+wgpu_cubemap_from_equirectangular(wgpu_context_t* wgpu_context,
+                                  const texture_t* source,
+                                  const wgpu_equirect_to_cubemap_desc_t* desc);
+
+/**
+ * @brief Loads the cubemap of a panorama image file (.hdr, .jpg, .png, ...)
+ * from its baked file. If the baked file is missing or was made from another
+ * image or description, the image is decoded, converted and the baked file is
+ * written for the next runs.
+ * @param baked_filename file of the baked cubemap, NULL = no baking
+ */
+texture_t
+wgpu_cubemap_load_equirectangular(wgpu_context_t* wgpu_context,
+                                  const char* filename,
+                                  const char* baked_filename,
+                                  const wgpu_equirect_to_cubemap_desc_t* desc);
+
+#endif /* CUBEMAP_FILTER_H */
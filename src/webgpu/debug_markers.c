@@ -0,0 +1,228 @@
+#include "debug_markers.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+/* Passes open at the same time, e.g. recorded by the parallel recorder */
+#define WGPU_DEBUG_MARKERS_MAX_OPEN_PASSES 64u
+#define WGPU_DEBUG_MARKERS_LABEL_SIZE 32u
+
+/* Pass begun with a debug group on its command encoder */
+typedef struct wgpu_debug_markers_pass_t {
+  const void* pass; /* NULL = empty slot */
+  WGPUCommandEncoder cmd_enc;
+} wgpu_debug_markers_pass_t;
+
+static struct {
+  bool enabled;
+  bool hooked;
+  DawnProcTable procs; /* native procs */
+  /* Guards the open passes and the pass counters */
+  pthread_mutex_t mutex;
+  wgpu_debug_markers_pass_t open_passes[WGPU_DEBUG_MARKERS_MAX_OPEN_PASSES];
+  uint32_t render_pass_count;
+  uint32_t compute_pass_count;
+} debug_markers = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* -------------------------------------------------------------------------- *
+ * Pass interception
+ * -------------------------------------------------------------------------- */
+
+static bool open_pass_add(const void* pass, WGPUCommandEncoder cmd_enc)
+{
+  bool added = false;
+  pthread_mutex_lock(&debug_markers.mutex);
+  for (uint32_t i = 0; i < WGPU_DEBUG_MARKERS_MAX_OPEN_PASSES; ++i) {
+    if (debug_markers.open_passes[i].pass == NULL) {
+      debug_markers.open_passes[i] = (wgpu_debug_markers_pass_t){
+        .pass    = pass,
+        .cmd_enc = cmd_enc,
+      };
+      added = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&debug_markers.mutex);
+  return added;
+}
+
+/* Command encoder of the pass, NULL if the pass has no debug group */
+static WGPUCommandEncoder open_pass_remove(const void* pass)
+{
+  WGPUCommandEncoder cmd_enc = NULL;
+  pthread_mutex_lock(&debug_markers.mutex);
+  for (uint32_t i = 0; i < WGPU_DEBUG_MARKERS_MAX_OPEN_PASSES; ++i) {
+    if (debug_markers.open_passes[i].pass == pass) {
+      cmd_enc                      = debug_markers.open_passes[i].cmd_enc;
+      debug_markers.open_passes[i] = (wgpu_debug_markers_pass_t){0};
+      break;
+    }
+  }
+  pthread_mutex_unlock(&debug_markers.mutex);
+  return cmd_enc;
+}
+
+static uint32_t next_pass_index(uint32_t* counter)
+{
+  pthread_mutex_lock(&debug_markers.mutex);
+  const uint32_t index = (*counter)++;
+  pthread_mutex_unlock(&debug_markers.mutex);
+  return index;
+}
+
+static WGPURenderPassEncoder
+markers_command_encoder_begin_render_pass(WGPUCommandEncoder cmd_enc,
+                                          WGPURenderPassDescriptor const* desc)
+{
+  char label[WGPU_DEBUG_MARKERS_LABEL_SIZE];
+  WGPURenderPassDescriptor labeled_desc = *desc;
+  if (labeled_desc.label == NULL) {
+    snprintf(label, sizeof(label), "Render pass %u",
+             next_pass_index(&debug_markers.render_pass_count));
+    labeled_desc.label = label;
+  }
+
+  debug_markers.procs.commandEncoderPushDebugGroup(cmd_enc,
+                                                   labeled_desc.label);
+  WGPURenderPassEncoder rpass_enc
+    = debug_markers.procs.commandEncoderBeginRenderPass(cmd_enc,
+                                                        &labeled_desc);
+  if (!open_pass_add(rpass_enc, cmd_enc)) {
+    /* Too many open passes, the pass stays without debug group */
+    debug_markers.procs.commandEncoderPopDebugGroup(cmd_enc);
+  }
+  return rpass_enc;
+}
+
+static WGPUComputePassEncoder markers_command_encoder_begin_compute_pass(
+  WGPUCommandEncoder cmd_enc, WGPUComputePassDescriptor const* desc)
+{
+  char label[WGPU_DEBUG_MARKERS_LABEL_SIZE];
+  WGPUComputePassDescriptor labeled_desc = desc ?
+                                             *desc :
+                                             (WGPUComputePassDescriptor){0};
+  if (labeled_desc.label == NULL) {
+    snprintf(label, sizeof(label), "Compute pass %u",
+             next_pass_index(&debug_markers.compute_pass_count));
+    labeled_desc.label = label;
+  }
+
+  debug_markers.procs.commandEncoderPushDebugGroup(cmd_enc,
+                                                   labeled_desc.label);
+  WGPUComputePassEncoder cpass_enc
+    = debug_markers.procs.commandEncoderBeginComputePass(cmd_enc,
+                                                         &labeled_desc);
+  if (!open_pass_add(cpass_enc, cmd_enc)) {
+    debug_markers.procs.commandEncoderPopDebugGroup(cmd_enc);
+  }
+  return cpass_enc;
+}
+
+static void markers_render_pass_end(WGPURenderPassEncoder rpass_enc)
+{
+  debug_markers.procs.renderPassEncoderEnd(rpass_enc);
+  WGPUCommandEncoder cmd_enc = open_pass_remove(rpass_enc);
+  if (cmd_enc != NULL) {
+    debug_markers.procs.commandEncoderPopDebugGroup(cmd_enc);
+  }
+}
+
+static void markers_compute_pass_end(WGPUComputePassEncoder cpass_enc)
+{
+  debug_markers.procs.computePassEncoderEnd(cpass_enc);
+  WGPUCommandEncoder cmd_enc = open_pass_remove(cpass_enc);
+  if (cmd_enc != NULL) {
+    debug_markers.procs.commandEncoderPopDebugGroup(cmd_enc);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+void wgpu_debug_markers_set_enabled(bool enabled)
+{
+  debug_markers.enabled = enabled;
+}
+
+bool wgpu_debug_markers_enabled(void)
+{
+  return debug_markers.enabled;
+}
+
+void wgpu_debug_markers_hook_procs(DawnProcTable* procs)
+{
+  if (!debug_markers.enabled) {
+    return;
+  }
+
+  debug_markers.hooked = true;
+  debug_markers.procs  = *procs;
+
+  procs->commandEncoderBeginRenderPass
+    = markers_command_encoder_begin_render_pass;
+  procs->commandEncoderBeginComputePass
+    = markers_command_encoder_begin_compute_pass;
+  procs->renderPassEncoderEnd  = markers_render_pass_end;
+  procs->computePassEncoderEnd = markers_compute_pass_end;
+}
+
+void wgpu_debug_markers_end_frame(void)
+{
+  if (!debug_markers.hooked) {
+    return;
+  }
+
+  pthread_mutex_lock(&debug_markers.mutex);
+  debug_markers.render_pass_count  = 0;
+  debug_markers.compute_pass_count = 0;
+  pthread_mutex_unlock(&debug_markers.mutex);
+}
+
+/* Debug groups */
+
+void wgpu_debug_group_push(WGPUCommandEncoder cmd_enc, const char* name)
+{
+  if (debug_markers.enabled && cmd_enc != NULL) {
+    wgpuCommandEncoderPushDebugGroup(cmd_enc, name ? name : "");
+  }
+}
+
+void wgpu_debug_group_pop(WGPUCommandEncoder cmd_enc)
+{
+  if (debug_markers.enabled && cmd_enc != NULL) {
+    wgpuCommandEncoderPopDebugGroup(cmd_enc);
+  }
+}
+
+void wgpu_render_pass_debug_group_push(WGPURenderPassEncoder rpass_enc,
+                                       const char* name)
+{
+  if (debug_markers.enabled && rpass_enc != NULL) {
+    wgpuRenderPassEncoderPushDebugGroup(rpass_enc, name ? name : "");
+  }
+}
+
+void wgpu_render_pass_debug_group_pop(WGPURenderPassEncoder rpass_enc)
+{
+  if (debug_markers.enabled && rpass_enc != NULL) {
+    wgpuRenderPassEncoderPopDebugGroup(rpass_enc);
+  }
+}
+
+void wgpu_compute_pass_debug_group_push(WGPUComputePassEncoder cpass_enc,
+                                        const char* name)
+{
+  if (debug_markers.enabled && cpass_enc != NULL) {
+    wgpuComputePassEncoderPushDebugGroup(cpass_enc, name ? name : "");
+  }
+}
+
+void wgpu_compute_pass_debug_group_pop(WGPUComputePassEncoder cpass_enc)
+{
+  if (debug_markers.enabled && cpass_enc != NULL) {
+    wgpuComputePassEncoderPopDebugGroup(cpass_enc);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef DEBUG_MARKERS_H
+#define DEBUG_MARKERS_H
+
+#include <stdbool.h>
+
+#include <dawn/dawn_proc_table.h>
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU debug markers
+ *
+ * Debug groups and labels for external GPU profilers and frame debuggers
+ * (RenderDoc, Nsight Graphics, Radeon GPU Profiler, PIX). With markers
+ * enabled (--gpu-markers):
+ *
+ *   - every render and compute pass is wrapped into a debug group named after
+ *     its label, unlabeled passes are labeled "Render pass <n>" / "Compute
+ *     pass <n>" in the order they are begun within the frame
+ *   - the GPU profiler scopes push a debug group of the same name, so the
+ *     scopes of the examples and the framework also show up in captures
+ *
+ * The passes are intercepted with the Dawn proc table hook, installed by
+ * wgpu_context_create() before the adapter is requested. Without markers all
+ * functions return immediately, debug groups are not free on every backend.
+ *
+ *   wgpu_debug_group_push(cmd_enc, "Shadow maps");
+ *   ... record the shadow passes ...
+ *   wgpu_debug_group_pop(cmd_enc);
+ * -------------------------------------------------------------------------- */
+
+/* Needs to be called before the first adapter is requested */
+void wgpu_debug_markers_set_enabled(bool enabled);
+bool wgpu_debug_markers_enabled(void);
+
+/* Proc table hook, see wgpu_set_proc_table_hook() */
+void wgpu_debug_markers_hook_procs(DawnProcTable* procs);
+
+/* Restarts the pass numbering, done by wgpu_swap_chain_present() */
+void wgpu_debug_markers_end_frame(void);
+
+/* Debug groups, nothing is recorded without markers */
+void wgpu_debug_group_push(WGPUCommandEncoder cmd_enc, const char* name);
+void wgpu_debug_group_pop(WGPUCommandEncoder cmd_enc);
+void wgpu_render_pass_debug_group_push(WGPURenderPassEncoder rpass_enc,
+                                       const char* name);
+void wgpu_render_pass_debug_group_pop(WGPURenderPassEncoder rpass_enc);
+void wgpu_compute_pass_debug_group_push(WGPUComputePassEncoder cpass_enc,
+                                        const char* name);
+void wgpu_compute_pass_debug_group_pop(WGPUComputePassEncoder cpass_enc);
+
+#endif /* DEBUG_MARKERS_H */
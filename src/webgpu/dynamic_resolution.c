@@ -0,0 +1,368 @@
+#include "dynamic_resolution.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "sampler_cache.h"
+#include "shader.h"
+
+#define DYNAMIC_RESOLUTION_DEFAULT_TARGET_MS (1000.0f / 60.0f)
+
+// clang-format off
+static const char* dynamic_resolution_shader_wgsl = CODE(
+  @group(0) @binding(0) var src : texture_2d<f32>;
+  @group(0) @binding(1) var src_sampler : sampler;
+
+  var<private> pos : array<vec2<f32>, 3> = array<vec2<f32>, 3>(
+    vec2<f32>(-1.0, -1.0), vec2<f32>(-1.0, 3.0), vec2<f32>(3.0, -1.0)
+  );
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertex_index : u32) -> VertexOutput {
+    var output : VertexOutput;
+    output.uv       = pos[vertex_index] * vec2<f32>(0.5, -0.5) + vec2<f32>(0.5);
+    output.position = vec4<f32>(pos[vertex_index], 0.0, 1.0);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(@location(0) uv : vec2<f32>) -> @location(0) vec4<f32> {
+    return textureSampleLevel(src, src_sampler, uv, 0.0);
+  }
+);
+// clang-format on
+
+/**
+ * @brief Dynamic resolution class
+ */
+struct wgpu_dynamic_resolution {
+  wgpu_context_t* wgpu_context;
+  bool enabled;
+  float target_frame_time_ms;
+  float min_scale;
+  float max_scale;
+  float scale;
+  /* Frames since the last scale change */
+  uint32_t frame_counter;
+  /* GPU frame times measured at the current scale */
+  float frame_time_sum;
+  uint32_t sample_count;
+  float frame_time_ms;
+  /* Upscale pass */
+  WGPUSampler sampler;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline pipeline;
+};
+
+/* Upscale pipeline */
+
+static void dynamic_resolution_create_pipeline(
+  wgpu_dynamic_resolution_t* dynamic_resolution, WGPUTextureFormat format)
+{
+  wgpu_context_t* wgpu_context = dynamic_resolution->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Scaled source texture
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Bilinear sampler
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+  };
+  dynamic_resolution->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device,
+    &(WGPUBindGroupLayoutDescriptor){
+      .label      = "Dynamic resolution bind group layout",
+      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+      .entries    = bgl_entries,
+    });
+  ASSERT(dynamic_resolution->bind_group_layout != NULL);
+
+  dynamic_resolution->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "Dynamic resolution pipeline layout",
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &dynamic_resolution->bind_group_layout,
+    });
+  ASSERT(dynamic_resolution->pipeline_layout != NULL);
+
+  WGPUColorTargetState color_target_state = {
+    .format    = format,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Dynamic resolution vertex shader",
+                      .wgsl_code.source = dynamic_resolution_shader_wgsl,
+                      .entry            = "vs_main",
+                    },
+                  });
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "Dynamic resolution fragment shader",
+                      .wgsl_code.source = dynamic_resolution_shader_wgsl,
+                      .entry            = "fs_main",
+                    },
+                    .target_count = 1,
+                    .targets      = &color_target_state,
+                  });
+
+  dynamic_resolution->pipeline = wgpu_create_render_pipeline(
+    wgpu_context,
+    &(WGPURenderPipelineDescriptor){
+      .label     = "Dynamic resolution upscale pipeline",
+      .layout    = dynamic_resolution->pipeline_layout,
+      .primitive = {
+        .topology  = WGPUPrimitiveTopology_TriangleList,
+        .frontFace = WGPUFrontFace_CCW,
+        .cullMode  = WGPUCullMode_None,
+      },
+      .vertex      = vertex_state,
+      .fragment    = &fragment_state,
+      .multisample = wgpu_create_multisample_state_descriptor(
+        &(create_multisample_state_desc_t){
+          .sample_count = 1,
+        }),
+    });
+  ASSERT(dynamic_resolution->pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module)
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module)
+}
+
+/* Dynamic resolution creating / destroying */
+
+wgpu_dynamic_resolution_t*
+wgpu_dynamic_resolution_create(wgpu_context_t* wgpu_context,
+                               const wgpu_dynamic_resolution_desc_t* desc)
+{
+  wgpu_dynamic_resolution_t* dynamic_resolution
+    = (wgpu_dynamic_resolution_t*)calloc(1, sizeof(*dynamic_resolution));
+  dynamic_resolution->wgpu_context = wgpu_context;
+  dynamic_resolution->enabled      = true;
+  dynamic_resolution->target_frame_time_ms
+    = desc->target_frame_time_ms > 0.0f ?
+        desc->target_frame_time_ms :
+        DYNAMIC_RESOLUTION_DEFAULT_TARGET_MS;
+  dynamic_resolution->min_scale
+    = desc->min_scale > 0.0f ? desc->min_scale : 0.5f;
+  dynamic_resolution->max_scale
+    = desc->max_scale > 0.0f ? MIN(desc->max_scale, 1.0f) : 1.0f;
+  ASSERT(dynamic_resolution->min_scale <= dynamic_resolution->max_scale);
+  dynamic_resolution->scale = dynamic_resolution->max_scale;
+
+  if (wgpu_context->profiler == NULL) {
+    log_warn("Dynamic resolution requires timestamp queries, the resolution "
+             "is not scaled");
+  }
+
+  dynamic_resolution->sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .label         = "Dynamic resolution sampler",
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Nearest,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = 1.0f,
+                    .maxAnisotropy = 1,
+                  });
+  ASSERT(dynamic_resolution->sampler != NULL);
+
+  dynamic_resolution_create_pipeline(
+    dynamic_resolution, desc->format != WGPUTextureFormat_Undefined ?
+                          desc->format :
+                          wgpu_context->swap_chain.format);
+
+  return dynamic_resolution;
+}
+
+void wgpu_dynamic_resolution_destroy(
+  wgpu_dynamic_resolution_t* dynamic_resolution)
+{
+  if (dynamic_resolution == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(RenderPipeline, dynamic_resolution->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, dynamic_resolution->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, dynamic_resolution->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, dynamic_resolution->sampler)
+  free(dynamic_resolution);
+}
+
+/* Scale control */
+
+static void
+dynamic_resolution_reset(wgpu_dynamic_resolution_t* dynamic_resolution)
+{
+  dynamic_resolution->frame_counter  = 0;
+  dynamic_resolution->frame_time_sum = 0.0f;
+  dynamic_resolution->sample_count   = 0;
+}
+
+/* GPU time of the most recently read back frame, 0 = nothing measured */
+static float dynamic_resolution_measure(wgpu_profiler_t* profiler)
+{
+  const wgpu_profiler_scope_result_t* scopes
+    = wgpu_profiler_get_scope_results(profiler);
+  const uint32_t scope_count = wgpu_profiler_get_scope_count(profiler);
+
+  float gpu_time_ms = 0.0f;
+  for (uint32_t i = 0; i < scope_count; ++i) {
+    if (scopes[i].depth == 0) {
+      gpu_time_ms += scopes[i].gpu_time_ms;
+    }
+  }
+  return gpu_time_ms;
+}
+
+void wgpu_dynamic_resolution_update(
+  wgpu_dynamic_resolution_t* dynamic_resolution)
+{
+  wgpu_profiler_t* profiler = dynamic_resolution->wgpu_context->profiler;
+  if (!dynamic_resolution->enabled || profiler == NULL) {
+    return;
+  }
+
+  // The results of the frames in flight were rendered at the previous scale
+  if (++dynamic_resolution->frame_counter <= WGPU_PROFILER_FRAME_COUNT) {
+    return;
+  }
+  const float gpu_time_ms = dynamic_resolution_measure(profiler);
+  if (gpu_time_ms <= 0.0f) {
+    return;
+  }
+  dynamic_resolution->frame_time_sum += gpu_time_ms;
+  if (++dynamic_resolution->sample_count
+      < WGPU_DYNAMIC_RESOLUTION_SAMPLE_FRAMES) {
+    return;
+  }
+
+  const float frame_time_ms = dynamic_resolution->frame_time_sum
+                              / (float)dynamic_resolution->sample_count;
+  dynamic_resolution->frame_time_ms  = frame_time_ms;
+  dynamic_resolution->frame_time_sum = 0.0f;
+  dynamic_resolution->sample_count   = 0;
+
+  // The pixel cost grows with the square of the scale
+  const float step = WGPU_DYNAMIC_RESOLUTION_SCALE_STEP;
+  const float ideal_scale
+    = dynamic_resolution->scale
+      * sqrtf(dynamic_resolution->target_frame_time_ms / frame_time_ms);
+  float scale = floorf(ideal_scale / step + 1e-3f) * step;
+  scale       = MIN(MAX(scale, dynamic_resolution->min_scale),
+                    dynamic_resolution->max_scale);
+  if (fabsf(scale - dynamic_resolution->scale) >= 0.5f * step) {
+    dynamic_resolution->scale = scale;
+    dynamic_resolution_reset(dynamic_resolution);
+  }
+}
+
+void wgpu_dynamic_resolution_set_enabled(
+  wgpu_dynamic_resolution_t* dynamic_resolution, bool enabled)
+{
+  dynamic_resolution->enabled = enabled;
+  if (!enabled) {
+    dynamic_resolution->scale = dynamic_resolution->max_scale;
+  }
+  dynamic_resolution_reset(dynamic_resolution);
+}
+
+void wgpu_dynamic_resolution_set_target_frame_time(
+  wgpu_dynamic_resolution_t* dynamic_resolution, float target_frame_time_ms)
+{
+  ASSERT(target_frame_time_ms > 0.0f);
+  dynamic_resolution->target_frame_time_ms = target_frame_time_ms;
+}
+
+void wgpu_dynamic_resolution_set_scale_range(
+  wgpu_dynamic_resolution_t* dynamic_resolution, float min_scale,
+  float max_scale)
+{
+  ASSERT(min_scale > 0.0f && min_scale <= max_scale);
+  dynamic_resolution->min_scale = min_scale;
+  dynamic_resolution->max_scale = MIN(max_scale, 1.0f);
+  dynamic_resolution->scale
+    = dynamic_resolution->enabled ?
+        MIN(MAX(dynamic_resolution->scale, dynamic_resolution->min_scale),
+            dynamic_resolution->max_scale) :
+        dynamic_resolution->max_scale;
+  dynamic_resolution_reset(dynamic_resolution);
+}
+
+float wgpu_dynamic_resolution_get_scale(
+  wgpu_dynamic_resolution_t* dynamic_resolution)
+{
+  return dynamic_resolution->scale;
+}
+
+float wgpu_dynamic_resolution_get_frame_time(
+  wgpu_dynamic_resolution_t* dynamic_resolution)
+{
+  return dynamic_resolution->frame_time_ms;
+}
+
+/* Upscaling */
+
+void wgpu_dynamic_resolution_upscale(
+  wgpu_dynamic_resolution_t* dynamic_resolution,
+  WGPURenderPassEncoder rpass_enc, WGPUTextureView source)
+{
+  ASSERT(source != NULL);
+
+  // The pooled source views change with the scale only, the bind groups are
+  // taken from the bind group cache
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding     = 0,
+      .textureView = source,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .sampler = dynamic_resolution->sampler,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    dynamic_resolution->wgpu_context,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Dynamic resolution bind group",
+      .layout     = dynamic_resolution->bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(bind_group != NULL);
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, dynamic_resolution->pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_group, 0, 0);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
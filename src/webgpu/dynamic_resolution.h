@@ -0,0 +1,85 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include "context.h"
+
+/* Granularity of the resolution scale */
+#define WGPU_DYNAMIC_RESOLUTION_SCALE_STEP 0.05f
+/* Measured frames the scale is adjusted from */
+#define WGPU_DYNAMIC_RESOLUTION_SAMPLE_FRAMES 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU dynamic resolution
+ *
+ * Trades resolution for frame rate: the scene is rendered at a scale of the
+ * surface size into a pooled texture, e.g. a frame graph transient texture
+ * declared with .scale = wgpu_dynamic_resolution_get_scale(), and upscaled
+ * with bilinear filtering into the frame buffer in the final pass:
+ *
+ *   wgpu_dynamic_resolution_update(dynamic_resolution);  once per frame
+ *   ... render the scene into the scaled texture ...
+ *   wgpu_dynamic_resolution_upscale(dynamic_resolution, rpass_enc, scene);
+ *
+ * The scale is adjusted from the GPU time of the frame measured by the
+ * profiler, the sum of its outermost scopes. The GPU time is averaged over
+ * WGPU_DYNAMIC_RESOLUTION_SAMPLE_FRAMES frames, the frames still in flight
+ * after a change are skipped. The pixel cost grows with the square of the
+ * scale, the new scale is
+ *
+ *   scale * sqrt(target frame time / measured frame time)
+ *
+ * rounded down to a multiple of WGPU_DYNAMIC_RESOLUTION_SCALE_STEP within
+ * [min_scale, max_scale]. Rounding down keeps the frame time below the
+ * target, a larger scale is only taken when the frame time has the headroom
+ * for a full step, and the texture pool only sees a few sizes. Without
+ * timestamp queries the scale stays at max_scale.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_dynamic_resolution wgpu_dynamic_resolution_t;
+
+typedef struct wgpu_dynamic_resolution_desc_t {
+  /* GPU frame time to stay below, 0 = 16.6 ms */
+  float target_frame_time_ms;
+  /* Scale range, 0 = 0.5 / 1.0 */
+  float min_scale;
+  float max_scale;
+  /* Color format of the upscale pass, Undefined = the swap chain format */
+  WGPUTextureFormat format;
+} wgpu_dynamic_resolution_desc_t;
+
+/* Dynamic resolution creating / destroying */
+wgpu_dynamic_resolution_t*
+wgpu_dynamic_resolution_create(wgpu_context_t* wgpu_context,
+                               const wgpu_dynamic_resolution_desc_t* desc);
+void wgpu_dynamic_resolution_destroy(
+  wgpu_dynamic_resolution_t* dynamic_resolution);
+
+/* Takes the latest profiler results into account, called once per frame
+ * before the scaled textures are declared */
+void wgpu_dynamic_resolution_update(
+  wgpu_dynamic_resolution_t* dynamic_resolution);
+
+/* Disabling resets the scale to max_scale */
+void wgpu_dynamic_resolution_set_enabled(
+  wgpu_dynamic_resolution_t* dynamic_resolution, bool enabled);
+void wgpu_dynamic_resolution_set_target_frame_time(
+  wgpu_dynamic_resolution_t* dynamic_resolution, float target_frame_time_ms);
+/* Changes the scale range, e.g. to 0.5 - 0.75 for a temporal upscaler, the
+ * current scale is clamped to the range */
+void wgpu_dynamic_resolution_set_scale_range(
+  wgpu_dynamic_resolution_t* dynamic_resolution, float min_scale,
+  float max_scale);
+
+float wgpu_dynamic_resolution_get_scale(
+  wgpu_dynamic_resolution_t* dynamic_resolution);
+/* Average GPU frame time the scale was last adjusted from */
+float wgpu_dynamic_resolution_get_frame_time(
+  wgpu_dynamic_resolution_t* dynamic_resolution);
+
+/* Draws the scaled source texture over the color target of the render pass,
+ * the render pass has no depth stencil attachment */
+void wgpu_dynamic_resolution_upscale(
+  wgpu_dynamic_resolution_t* dynamic_resolution,
+  WGPURenderPassEncoder rpass_enc, WGPUTextureView source);
+
+#endif /* DYNAMIC_RESOLUTION_H */
@@ -0,0 +1,322 @@
+#include "frame_capture.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/thread_pool.h"
+
+#define FRAME_CAPTURE_BYTES_PER_PIXEL 4u
+#define FRAME_CAPTURE_COPY_BYTES_PER_ROW_ALIGNMENT 256u
+
+typedef enum wgpu_frame_capture_buffer_state_t {
+  FrameCapture_BufferState_Available = 0,
+  FrameCapture_BufferState_Recorded  = 1,
+  FrameCapture_BufferState_Mapping   = 2,
+} wgpu_frame_capture_buffer_state_t;
+
+typedef struct wgpu_frame_capture_buffer_t {
+  struct wgpu_frame_capture* capture;
+  WGPUBuffer buffer;
+  wgpu_frame_capture_buffer_state_t state;
+  uint32_t frame_index;
+} wgpu_frame_capture_buffer_t;
+
+/* Image handed over to the worker thread */
+typedef struct frame_capture_job_t {
+  struct wgpu_frame_capture* capture;
+  uint8_t* pixels;
+  char filename[WGPU_FRAME_CAPTURE_FILENAME_SIZE];
+} frame_capture_job_t;
+
+/**
+ * @brief Frame capture class
+ */
+struct wgpu_frame_capture {
+  wgpu_context_t* wgpu_context;
+  uint32_t width;
+  uint32_t height;
+  uint32_t unpadded_bytes_per_row;
+  uint32_t padded_bytes_per_row;
+  bool swizzle_bgra;
+  wgpu_frame_capture_file_format_t file_format;
+  char filename_prefix[WGPU_FRAME_CAPTURE_FILENAME_SIZE];
+  uint32_t buffer_count;
+  wgpu_frame_capture_buffer_t buffers[WGPU_FRAME_CAPTURE_MAX_BUFFER_COUNT];
+  uint32_t pending_maps;
+  /* Single worker, the images are written in capture order */
+  thread_pool_t* thread_pool;
+  /* Guards the stats, the worker thread counts the written files */
+  pthread_mutex_t mutex;
+  wgpu_frame_capture_stats_t stats;
+};
+
+/* Frame capture creating / destroying */
+
+wgpu_frame_capture_t*
+wgpu_frame_capture_create(wgpu_context_t* wgpu_context,
+                          const wgpu_frame_capture_desc_t* desc)
+{
+  ASSERT(desc->width > 0 && desc->height > 0);
+
+  bool swizzle_bgra = false;
+  switch (desc->texture_format) {
+    case WGPUTextureFormat_RGBA8Unorm:
+    case WGPUTextureFormat_RGBA8UnormSrgb:
+      break;
+    case WGPUTextureFormat_BGRA8Unorm:
+    case WGPUTextureFormat_BGRA8UnormSrgb:
+      swizzle_bgra = true;
+      break;
+    default:
+      log_error("Frame capture: unsupported texture format %d\n",
+                desc->texture_format);
+      return NULL;
+  }
+
+  wgpu_frame_capture_t* capture
+    = (wgpu_frame_capture_t*)malloc(sizeof(*capture));
+  memset(capture, 0, sizeof(*capture));
+  capture->wgpu_context = wgpu_context;
+  capture->width        = desc->width;
+  capture->height       = desc->height;
+  capture->swizzle_bgra = swizzle_bgra;
+  capture->file_format  = desc->file_format;
+  snprintf(capture->filename_prefix, sizeof(capture->filename_prefix), "%s",
+           desc->filename_prefix ? desc->filename_prefix : "capture");
+  capture->buffer_count
+    = desc->buffer_count > 0 ?
+        MIN(desc->buffer_count, WGPU_FRAME_CAPTURE_MAX_BUFFER_COUNT) :
+        WGPU_FRAME_CAPTURE_DEFAULT_BUFFER_COUNT;
+
+  // Rows of texture to buffer copies are aligned to 256 bytes
+  const uint32_t align = FRAME_CAPTURE_COPY_BYTES_PER_ROW_ALIGNMENT;
+  capture->unpadded_bytes_per_row
+    = capture->width * FRAME_CAPTURE_BYTES_PER_PIXEL;
+  capture->padded_bytes_per_row
+    = (capture->unpadded_bytes_per_row + align - 1) / align * align;
+
+  const uint64_t buffer_size
+    = (uint64_t)capture->padded_bytes_per_row * capture->height;
+  for (uint32_t i = 0; i < capture->buffer_count; ++i) {
+    wgpu_frame_capture_buffer_t* buffer = &capture->buffers[i];
+    buffer->capture                     = capture;
+    buffer->state                       = FrameCapture_BufferState_Available;
+    buffer->buffer                      = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Frame capture readback buffer",
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size  = buffer_size,
+      });
+    ASSERT(buffer->buffer);
+  }
+
+  capture->thread_pool = thread_pool_create(1);
+  pthread_mutex_init(&capture->mutex, NULL);
+
+  return capture;
+}
+
+void wgpu_frame_capture_destroy(wgpu_frame_capture_t* capture)
+{
+  if (capture == NULL) {
+    return;
+  }
+
+  wgpu_frame_capture_flush(capture);
+  thread_pool_release(capture->thread_pool);
+  pthread_mutex_destroy(&capture->mutex);
+  for (uint32_t i = 0; i < capture->buffer_count; ++i) {
+    WGPU_RELEASE_RESOURCE(Buffer, capture->buffers[i].buffer)
+  }
+
+  free(capture);
+}
+
+/* Capture recording */
+
+bool wgpu_frame_capture_record(wgpu_frame_capture_t* capture,
+                               WGPUCommandEncoder cmd_enc, WGPUTexture texture,
+                               uint32_t frame_index)
+{
+  wgpu_frame_capture_buffer_t* buffer = NULL;
+  for (uint32_t i = 0; i < capture->buffer_count; ++i) {
+    if (capture->buffers[i].state == FrameCapture_BufferState_Available) {
+      buffer = &capture->buffers[i];
+      break;
+    }
+  }
+
+  pthread_mutex_lock(&capture->mutex);
+  if (buffer == NULL) {
+    ++capture->stats.dropped;
+  }
+  else {
+    ++capture->stats.recorded;
+  }
+  pthread_mutex_unlock(&capture->mutex);
+  if (buffer == NULL) {
+    return false;
+  }
+
+  wgpuCommandEncoderCopyTextureToBuffer(cmd_enc,
+    // Source
+    &(WGPUImageCopyTexture){
+      .texture  = texture,
+      .mipLevel = 0,
+    },
+    // Destination
+    &(WGPUImageCopyBuffer){
+      .buffer = buffer->buffer,
+      .layout = (WGPUTextureDataLayout){
+        .offset       = 0,
+        .bytesPerRow  = capture->padded_bytes_per_row,
+        .rowsPerImage = capture->height,
+      },
+    },
+    // CopySize
+    &(WGPUExtent3D){
+      .width              = capture->width,
+      .height             = capture->height,
+      .depthOrArrayLayers = 1,
+    });
+  buffer->state       = FrameCapture_BufferState_Recorded;
+  buffer->frame_index = frame_index;
+
+  return true;
+}
+
+/* Image writing */
+
+static void frame_capture_write_job(void* arg)
+{
+  frame_capture_job_t* job      = (frame_capture_job_t*)arg;
+  wgpu_frame_capture_t* capture = job->capture;
+  const size_t pixels_size
+    = (size_t)capture->unpadded_bytes_per_row * capture->height;
+
+  if (capture->swizzle_bgra) {
+    for (size_t i = 0; i < pixels_size; i += FRAME_CAPTURE_BYTES_PER_PIXEL) {
+      const uint8_t b    = job->pixels[i];
+      job->pixels[i]     = job->pixels[i + 2];
+      job->pixels[i + 2] = b;
+    }
+  }
+
+  bool written = false;
+  if (capture->file_format == FrameCapture_FileFormat_PNG) {
+    written = stbi_write_png(job->filename, (int)capture->width,
+                             (int)capture->height,
+                             (int)FRAME_CAPTURE_BYTES_PER_PIXEL, job->pixels,
+                             (int)capture->unpadded_bytes_per_row)
+              != 0;
+  }
+  else {
+    FILE* file = fopen(job->filename, "wb");
+    if (file != NULL) {
+      written = fwrite(job->pixels, 1, pixels_size, file) == pixels_size;
+      written = (fclose(file) == 0) && written;
+    }
+  }
+
+  pthread_mutex_lock(&capture->mutex);
+  if (written) {
+    ++capture->stats.written;
+    snprintf(capture->stats.last_filename,
+             sizeof(capture->stats.last_filename), "%s", job->filename);
+  }
+  else {
+    ++capture->stats.failed;
+  }
+  pthread_mutex_unlock(&capture->mutex);
+
+  free(job->pixels);
+  free(job);
+}
+
+static void frame_capture_map_cb(WGPUBufferMapAsyncStatus status,
+                                 void* user_data)
+{
+  wgpu_frame_capture_buffer_t* buffer = (wgpu_frame_capture_buffer_t*)user_data;
+  wgpu_frame_capture_t* capture       = buffer->capture;
+
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    const uint64_t buffer_size
+      = (uint64_t)capture->padded_bytes_per_row * capture->height;
+    uint8_t const* mapping = (uint8_t const*)wgpuBufferGetConstMappedRange(
+      buffer->buffer, 0, buffer_size);
+    ASSERT(mapping);
+
+    // Remove the row padding, the worker thread gets its own copy so the
+    // buffer can be reused right away
+    frame_capture_job_t* job
+      = (frame_capture_job_t*)malloc(sizeof(frame_capture_job_t));
+    job->capture = capture;
+    job->pixels
+      = (uint8_t*)malloc((size_t)capture->unpadded_bytes_per_row
+                         * capture->height);
+    for (uint32_t y = 0; y < capture->height; ++y) {
+      memcpy(job->pixels + (size_t)y * capture->unpadded_bytes_per_row,
+             mapping + (size_t)y * capture->padded_bytes_per_row,
+             capture->unpadded_bytes_per_row);
+    }
+    wgpuBufferUnmap(buffer->buffer);
+
+    if (capture->file_format == FrameCapture_FileFormat_PNG) {
+      snprintf(job->filename, sizeof(job->filename), "%s_%05u.png",
+               capture->filename_prefix, buffer->frame_index);
+    }
+    else {
+      snprintf(job->filename, sizeof(job->filename), "%s_%05u_%ux%u.rgba",
+               capture->filename_prefix, buffer->frame_index, capture->width,
+               capture->height);
+    }
+    thread_pool_submit(capture->thread_pool, frame_capture_write_job, job);
+  }
+  else {
+    pthread_mutex_lock(&capture->mutex);
+    ++capture->stats.failed;
+    pthread_mutex_unlock(&capture->mutex);
+  }
+
+  buffer->state = FrameCapture_BufferState_Available;
+  --capture->pending_maps;
+}
+
+void wgpu_frame_capture_end_frame(wgpu_frame_capture_t* capture)
+{
+  const uint64_t buffer_size
+    = (uint64_t)capture->padded_bytes_per_row * capture->height;
+  for (uint32_t i = 0; i < capture->buffer_count; ++i) {
+    wgpu_frame_capture_buffer_t* buffer = &capture->buffers[i];
+    if (buffer->state == FrameCapture_BufferState_Recorded) {
+      buffer->state = FrameCapture_BufferState_Mapping;
+      ++capture->pending_maps;
+      wgpuBufferMapAsync(buffer->buffer, WGPUMapMode_Read, 0, buffer_size,
+                         frame_capture_map_cb, buffer);
+    }
+  }
+}
+
+void wgpu_frame_capture_flush(wgpu_frame_capture_t* capture)
+{
+  while (capture->pending_maps > 0) {
+    wgpuDeviceTick(capture->wgpu_context->device);
+  }
+  thread_pool_wait(capture->thread_pool);
+}
+
+void wgpu_frame_capture_get_stats(wgpu_frame_capture_t* capture,
+                                  wgpu_frame_capture_stats_t* stats)
+{
+  pthread_mutex_lock(&capture->mutex);
+  memcpy(stats, &capture->stats, sizeof(*stats));
+  pthread_mutex_unlock(&capture->mutex);
+}
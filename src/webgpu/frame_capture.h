@@ -0,0 +1,82 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "context.h"
+
+#define WGPU_FRAME_CAPTURE_DEFAULT_BUFFER_COUNT 3u
+#define WGPU_FRAME_CAPTURE_MAX_BUFFER_COUNT 8u
+#define WGPU_FRAME_CAPTURE_FILENAME_SIZE 256u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU frame capture
+ *
+ * Captures textures into image files without stalling the render loop: the
+ * texture is copied into one of a ring of readback buffers, the buffer is
+ * mapped asynchronously after the submit and the pixels are encoded and
+ * written by a worker thread, e.g.:
+ *
+ *   wgpu_frame_capture_record(capture, cmd_enc, texture, frame_index);
+ *   ... submit ...
+ *   wgpu_frame_capture_end_frame(capture);
+ *
+ * When all readback buffers are in flight the capture of a frame is dropped
+ * instead of waiting, the stats count the dropped frames. The captured
+ * texture needs the CopySrc usage and one of the RGBA8 / BGRA8 formats, the
+ * images are written as RGBA.
+ *
+ * The files are named <prefix>_<frame index>.png, raw images are written as
+ * <prefix>_<frame index>_<width>x<height>.rgba with tightly packed rows.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_frame_capture wgpu_frame_capture_t;
+
+typedef enum wgpu_frame_capture_file_format_t {
+  FrameCapture_FileFormat_PNG = 0,
+  FrameCapture_FileFormat_Raw = 1,
+} wgpu_frame_capture_file_format_t;
+
+typedef struct wgpu_frame_capture_desc_t {
+  uint32_t width;
+  uint32_t height;
+  WGPUTextureFormat texture_format;
+  wgpu_frame_capture_file_format_t file_format;
+  const char* filename_prefix;
+  /* Readback buffers, 0 = WGPU_FRAME_CAPTURE_DEFAULT_BUFFER_COUNT */
+  uint32_t buffer_count;
+} wgpu_frame_capture_desc_t;
+
+typedef struct wgpu_frame_capture_stats_t {
+  uint32_t recorded; /* copies recorded into a readback buffer */
+  uint32_t dropped;  /* captures skipped, all buffers were in flight */
+  uint32_t written;  /* image files written by the worker thread */
+  uint32_t failed;   /* failed readbacks and file writes */
+  char last_filename[WGPU_FRAME_CAPTURE_FILENAME_SIZE];
+} wgpu_frame_capture_stats_t;
+
+/* Frame capture creating / destroying, destroying writes the pending images */
+wgpu_frame_capture_t*
+wgpu_frame_capture_create(wgpu_context_t* wgpu_context,
+                          const wgpu_frame_capture_desc_t* desc);
+void wgpu_frame_capture_destroy(wgpu_frame_capture_t* capture);
+
+/**
+ * @brief Records the copy of the texture into a free readback buffer.
+ * @return false if the capture was dropped because no buffer is free
+ */
+bool wgpu_frame_capture_record(wgpu_frame_capture_t* capture,
+                               WGPUCommandEncoder cmd_enc, WGPUTexture texture,
+                               uint32_t frame_index);
+
+/**
+ * @brief Starts mapping the readback buffers recorded this frame, called after
+ * the command buffers with the copies are submitted.
+ */
+void wgpu_frame_capture_end_frame(wgpu_frame_capture_t* capture);
+
+/* Waits until all recorded captures are written */
+void wgpu_frame_capture_flush(wgpu_frame_capture_t* capture);
+
+void wgpu_frame_capture_get_stats(wgpu_frame_capture_t* capture,
+                                  wgpu_frame_capture_stats_t* stats);
+
+#endif /* FRAME_CAPTURE_H */
@@ -0,0 +1,495 @@
+#include "frame_graph.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "profiler.h"
+
+/* Pooled texture backing transient resources */
+typedef struct frame_graph_texture_t {
+  WGPUTexture texture;
+  WGPUTextureView view;
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  WGPUTextureUsageFlags usage;
+  uint64_t last_used_frame;
+  /* Last pass of the resource holding the texture in this frame, -1 = free */
+  int32_t busy_until;
+} frame_graph_texture_t;
+
+typedef struct frame_graph_resource_t {
+  const char* label;
+  bool imported;
+  bool load;
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  WGPUTextureUsageFlags usage;
+  WGPUTextureView view;
+  /* First and last live pass using the resource, -1 = unused */
+  int32_t first_pass;
+  int32_t last_pass;
+  /* Contents needed by a live pass or an output */
+  bool needed;
+  /* Written by a recorded pass of this frame */
+  bool written;
+} frame_graph_resource_t;
+
+typedef struct frame_graph_pass_t {
+  wgpu_frame_graph_pass_desc_t desc;
+  bool live;
+} frame_graph_pass_t;
+
+/**
+ * @brief Frame graph class
+ */
+struct wgpu_frame_graph {
+  wgpu_context_t* wgpu_context;
+  frame_graph_pass_t passes[WGPU_FRAME_GRAPH_MAX_PASSES];
+  uint32_t pass_count;
+  frame_graph_resource_t resources[WGPU_FRAME_GRAPH_MAX_RESOURCES];
+  uint32_t resource_count;
+  frame_graph_texture_t* pool;
+  uint32_t pool_count;
+  uint32_t pool_capacity;
+  uint64_t frame_index;
+  wgpu_frame_graph_stats_t stats;
+};
+
+/* Frame graph creating / destroying */
+
+wgpu_frame_graph_t* wgpu_frame_graph_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_frame_graph_t* graph = (wgpu_frame_graph_t*)calloc(1, sizeof(*graph));
+  graph->wgpu_context       = wgpu_context;
+  return graph;
+}
+
+static void frame_graph_texture_release(frame_graph_texture_t* texture)
+{
+  WGPU_RELEASE_RESOURCE(TextureView, texture->view)
+  WGPU_RELEASE_RESOURCE(Texture, texture->texture)
+}
+
+void wgpu_frame_graph_destroy(wgpu_frame_graph_t* graph)
+{
+  if (graph == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < graph->pool_count; ++i) {
+    frame_graph_texture_release(&graph->pool[i]);
+  }
+  free(graph->pool);
+  free(graph);
+}
+
+/* Declaration */
+
+void wgpu_frame_graph_begin(wgpu_frame_graph_t* graph)
+{
+  graph->pass_count     = 0;
+  graph->resource_count = 0;
+}
+
+static frame_graph_resource_t*
+frame_graph_get_resource(wgpu_frame_graph_t* graph,
+                         wgpu_frame_graph_resource_t resource)
+{
+  ASSERT(resource > 0 && resource <= graph->resource_count);
+  return &graph->resources[resource - 1];
+}
+
+static wgpu_frame_graph_resource_t
+frame_graph_add_resource(wgpu_frame_graph_t* graph,
+                         const frame_graph_resource_t* resource)
+{
+  ASSERT(graph->resource_count < WGPU_FRAME_GRAPH_MAX_RESOURCES);
+
+  frame_graph_resource_t* added = &graph->resources[graph->resource_count++];
+  *added                        = *resource;
+  added->first_pass             = -1;
+  added->last_pass              = -1;
+  return graph->resource_count;
+}
+
+wgpu_frame_graph_resource_t
+wgpu_frame_graph_create_texture(wgpu_frame_graph_t* graph,
+                                const wgpu_frame_graph_texture_desc_t* desc)
+{
+  const float scale = desc->scale > 0.0f ? desc->scale : 1.0f;
+  uint32_t width    = desc->width;
+  uint32_t height   = desc->height;
+  if (width == 0 || height == 0) {
+    width  = (uint32_t)((float)graph->wgpu_context->surface.width * scale);
+    height = (uint32_t)((float)graph->wgpu_context->surface.height * scale);
+  }
+
+  return frame_graph_add_resource(
+    graph, &(frame_graph_resource_t){
+             .label  = desc->label,
+             .format = desc->format,
+             .width  = MAX(width, 1u),
+             .height = MAX(height, 1u),
+           });
+}
+
+wgpu_frame_graph_resource_t
+wgpu_frame_graph_import_texture(wgpu_frame_graph_t* graph,
+                                const wgpu_frame_graph_import_desc_t* desc)
+{
+  ASSERT(desc->view != NULL);
+
+  return frame_graph_add_resource(graph, &(frame_graph_resource_t){
+                                           .label    = desc->label,
+                                           .imported = true,
+                                           .load     = desc->load,
+                                           .format   = desc->format,
+                                           .view     = desc->view,
+                                           .needed   = true,
+                                         });
+}
+
+void wgpu_frame_graph_add_pass(wgpu_frame_graph_t* graph,
+                               const wgpu_frame_graph_pass_desc_t* desc)
+{
+  ASSERT(graph->pass_count < WGPU_FRAME_GRAPH_MAX_PASSES);
+  ASSERT(desc->color_attachment_count
+         <= WGPU_FRAME_GRAPH_MAX_COLOR_ATTACHMENTS);
+  ASSERT(desc->read_count <= WGPU_FRAME_GRAPH_MAX_PASS_RESOURCES);
+  ASSERT(desc->write_count <= WGPU_FRAME_GRAPH_MAX_PASS_RESOURCES);
+  ASSERT(desc->execute_func != NULL);
+
+  graph->passes[graph->pass_count++] = (frame_graph_pass_t){
+    .desc = *desc,
+  };
+}
+
+/* Compilation */
+
+/* Runs body for every resource written by the pass */
+#define FOR_EACH_PASS_WRITE(desc, resource, body)                              \
+  for (uint32_t _i = 0; _i < (desc)->color_attachment_count; ++_i) {           \
+    const wgpu_frame_graph_resource_t resource                                 \
+      = (desc)->color_attachments[_i].resource;                                \
+    body                                                                       \
+  }                                                                            \
+  if ((desc)->depth_stencil_attachment) {                                      \
+    const wgpu_frame_graph_resource_t resource                                 \
+      = (desc)->depth_stencil_attachment;                                      \
+    body                                                                       \
+  }                                                                            \
+  for (uint32_t _i = 0; _i < (desc)->write_count; ++_i) {                      \
+    const wgpu_frame_graph_resource_t resource = (desc)->writes[_i];           \
+    body                                                                       \
+  }
+
+// Walks the passes backwards from the outputs: a pass is live if a texture it
+// writes is needed, the textures a live pass reads become needed. Earlier
+// writers of a needed texture stay live, the later passes load their results.
+static void frame_graph_cull_passes(wgpu_frame_graph_t* graph)
+{
+  for (int32_t i = (int32_t)graph->pass_count - 1; i >= 0; --i) {
+    frame_graph_pass_t* pass                 = &graph->passes[i];
+    const wgpu_frame_graph_pass_desc_t* desc = &pass->desc;
+    FOR_EACH_PASS_WRITE(desc, resource, {
+      if (frame_graph_get_resource(graph, resource)->needed) {
+        pass->live = true;
+      }
+    })
+    if (!pass->live) {
+      ++graph->stats.culled_pass_count;
+      continue;
+    }
+    for (uint32_t j = 0; j < desc->read_count; ++j) {
+      frame_graph_get_resource(graph, desc->reads[j])->needed = true;
+    }
+  }
+}
+
+static void frame_graph_use_resource(wgpu_frame_graph_t* graph,
+                                     wgpu_frame_graph_resource_t resource,
+                                     int32_t pass_index,
+                                     WGPUTextureUsageFlags usage)
+{
+  frame_graph_resource_t* res = frame_graph_get_resource(graph, resource);
+  if (res->first_pass < 0) {
+    res->first_pass = pass_index;
+  }
+  res->last_pass = pass_index;
+  res->usage |= usage;
+}
+
+static void frame_graph_compute_lifetimes(wgpu_frame_graph_t* graph)
+{
+  for (uint32_t i = 0; i < graph->pass_count; ++i) {
+    const frame_graph_pass_t* pass = &graph->passes[i];
+    if (!pass->live) {
+      continue;
+    }
+    const wgpu_frame_graph_pass_desc_t* desc = &pass->desc;
+    for (uint32_t j = 0; j < desc->color_attachment_count; ++j) {
+      frame_graph_use_resource(graph, desc->color_attachments[j].resource,
+                               (int32_t)i, WGPUTextureUsage_RenderAttachment);
+    }
+    if (desc->depth_stencil_attachment) {
+      frame_graph_use_resource(graph, desc->depth_stencil_attachment,
+                               (int32_t)i, WGPUTextureUsage_RenderAttachment);
+    }
+    for (uint32_t j = 0; j < desc->read_count; ++j) {
+      frame_graph_use_resource(graph, desc->reads[j], (int32_t)i,
+                               WGPUTextureUsage_TextureBinding);
+    }
+    for (uint32_t j = 0; j < desc->write_count; ++j) {
+      frame_graph_use_resource(graph, desc->writes[j], (int32_t)i,
+                               WGPUTextureUsage_StorageBinding);
+    }
+  }
+}
+
+static frame_graph_texture_t*
+frame_graph_acquire_texture(wgpu_frame_graph_t* graph,
+                            const frame_graph_resource_t* resource)
+{
+  for (uint32_t i = 0; i < graph->pool_count; ++i) {
+    frame_graph_texture_t* texture = &graph->pool[i];
+    if (texture->busy_until < resource->first_pass
+        && texture->format == resource->format
+        && texture->width == resource->width
+        && texture->height == resource->height
+        && texture->usage == resource->usage) {
+      return texture;
+    }
+  }
+
+  if (graph->pool_count == graph->pool_capacity) {
+    graph->pool_capacity = graph->pool_capacity ? graph->pool_capacity * 2 : 8;
+    graph->pool          = (frame_graph_texture_t*)realloc(
+      graph->pool, graph->pool_capacity * sizeof(frame_graph_texture_t));
+  }
+  frame_graph_texture_t* texture = &graph->pool[graph->pool_count++];
+  *texture                       = (frame_graph_texture_t){
+    .format = resource->format,
+    .width  = resource->width,
+    .height = resource->height,
+    .usage  = resource->usage,
+  };
+  texture->texture = wgpuDeviceCreateTexture(
+    graph->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = resource->label,
+      .usage         = resource->usage,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = resource->width,
+        .height             = resource->height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = resource->format,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(texture->texture != NULL);
+  texture->view = wgpuTextureCreateView(texture->texture, NULL);
+  ASSERT(texture->view != NULL);
+  return texture;
+}
+
+// Assigns the pooled textures in pass order, a texture is free again for the
+// resources starting after the last pass of its current resource
+static void frame_graph_allocate_textures(wgpu_frame_graph_t* graph)
+{
+  for (uint32_t i = 0; i < graph->pool_count; ++i) {
+    graph->pool[i].busy_until = -1;
+  }
+
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    for (uint32_t r = 0; r < graph->resource_count; ++r) {
+      frame_graph_resource_t* resource = &graph->resources[r];
+      if (resource->imported || resource->first_pass != (int32_t)p) {
+        continue;
+      }
+      frame_graph_texture_t* texture
+        = frame_graph_acquire_texture(graph, resource);
+      texture->busy_until      = resource->last_pass;
+      texture->last_used_frame = graph->frame_index;
+      resource->view           = texture->view;
+      ++graph->stats.transient_count;
+    }
+  }
+}
+
+static void frame_graph_evict_textures(wgpu_frame_graph_t* graph)
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < graph->pool_count; ++i) {
+    frame_graph_texture_t* texture = &graph->pool[i];
+    if (texture->busy_until >= 0) {
+      ++graph->stats.allocated_count;
+    }
+    if (graph->frame_index - texture->last_used_frame
+        > WGPU_FRAME_GRAPH_MAX_UNUSED_FRAMES) {
+      frame_graph_texture_release(texture);
+      continue;
+    }
+    graph->pool[count++] = *texture;
+  }
+  graph->pool_count         = count;
+  graph->stats.pooled_count = count;
+}
+
+/* Execution */
+
+static bool format_has_stencil(WGPUTextureFormat format)
+{
+  return format == WGPUTextureFormat_Stencil8
+         || format == WGPUTextureFormat_Depth24PlusStencil8
+         || format == WGPUTextureFormat_Depth32FloatStencil8;
+}
+
+/* Clears the resource on its first write unless imported contents are
+ * loaded */
+static WGPULoadOp frame_graph_load_op(frame_graph_resource_t* resource)
+{
+  const bool load = resource->written || (resource->imported && resource->load);
+  resource->written = true;
+  return load ? WGPULoadOp_Load : WGPULoadOp_Clear;
+}
+
+/* Stores the attachment if a later pass uses the resource or it is an output */
+static WGPUStoreOp frame_graph_store_op(const frame_graph_resource_t* resource,
+                                        uint32_t pass_index)
+{
+  return (resource->imported || resource->last_pass > (int32_t)pass_index) ?
+           WGPUStoreOp_Store :
+           WGPUStoreOp_Discard;
+}
+
+static void frame_graph_record_render_pass(wgpu_frame_graph_t* graph,
+                                           const frame_graph_pass_t* pass,
+                                           uint32_t pass_index,
+                                           WGPUCommandEncoder cmd_enc)
+{
+  const wgpu_frame_graph_pass_desc_t* desc = &pass->desc;
+
+  WGPURenderPassColorAttachment
+    color_attachments[WGPU_FRAME_GRAPH_MAX_COLOR_ATTACHMENTS];
+  for (uint32_t i = 0; i < desc->color_attachment_count; ++i) {
+    frame_graph_resource_t* resource
+      = frame_graph_get_resource(graph, desc->color_attachments[i].resource);
+    color_attachments[i] = (WGPURenderPassColorAttachment){
+      .view       = resource->view,
+      .loadOp     = frame_graph_load_op(resource),
+      .storeOp    = frame_graph_store_op(resource, pass_index),
+      .clearValue = desc->color_attachments[i].clear_value,
+    };
+  }
+
+  WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {0};
+  if (desc->depth_stencil_attachment) {
+    frame_graph_resource_t* resource
+      = frame_graph_get_resource(graph, desc->depth_stencil_attachment);
+    const WGPULoadOp load_op   = frame_graph_load_op(resource);
+    const WGPUStoreOp store_op = frame_graph_store_op(resource, pass_index);
+    depth_stencil_attachment   = (WGPURenderPassDepthStencilAttachment){
+      .view            = resource->view,
+      .depthLoadOp     = load_op,
+      .depthStoreOp    = store_op,
+      .depthClearValue = graph->wgpu_context->depth_stencil.reversed_z ?
+                           0.0f :
+                           1.0f,
+    };
+    if (format_has_stencil(resource->format)) {
+      depth_stencil_attachment.stencilLoadOp     = load_op;
+      depth_stencil_attachment.stencilStoreOp    = store_op;
+      depth_stencil_attachment.stencilClearValue = 0;
+    }
+  }
+
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .label                = desc->label,
+               .colorAttachmentCount = desc->color_attachment_count,
+               .colorAttachments     = color_attachments,
+               .depthStencilAttachment
+               = desc->depth_stencil_attachment ? &depth_stencil_attachment :
+                                                  NULL,
+             });
+  desc->execute_func(graph,
+                     (wgpu_frame_graph_pass_encoder_t){.render = rpass_enc},
+                     desc->user_data);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+}
+
+static void frame_graph_record_compute_pass(wgpu_frame_graph_t* graph,
+                                            const frame_graph_pass_t* pass,
+                                            WGPUCommandEncoder cmd_enc)
+{
+  const wgpu_frame_graph_pass_desc_t* desc = &pass->desc;
+  for (uint32_t i = 0; i < desc->write_count; ++i) {
+    frame_graph_get_resource(graph, desc->writes[i])->written = true;
+  }
+
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = desc->label,
+             });
+  desc->execute_func(graph,
+                     (wgpu_frame_graph_pass_encoder_t){.compute = cpass_enc},
+                     desc->user_data);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+void wgpu_frame_graph_execute(wgpu_frame_graph_t* graph,
+                              WGPUCommandEncoder cmd_enc)
+{
+  memset(&graph->stats, 0, sizeof(graph->stats));
+  graph->stats.pass_count = graph->pass_count;
+
+  frame_graph_cull_passes(graph);
+  frame_graph_compute_lifetimes(graph);
+  frame_graph_allocate_textures(graph);
+
+  wgpu_profiler_t* profiler = graph->wgpu_context->profiler;
+  for (uint32_t i = 0; i < graph->pass_count; ++i) {
+    const frame_graph_pass_t* pass = &graph->passes[i];
+    if (!pass->live) {
+      continue;
+    }
+    wgpu_profiler_begin_scope(profiler, cmd_enc,
+                              pass->desc.label ? pass->desc.label : "Pass");
+    if (pass->desc.type == FrameGraph_PassType_Compute) {
+      frame_graph_record_compute_pass(graph, pass, cmd_enc);
+    }
+    else {
+      frame_graph_record_render_pass(graph, pass, i, cmd_enc);
+    }
+    wgpu_profiler_end_scope(profiler, cmd_enc);
+  }
+
+  frame_graph_evict_textures(graph);
+  ++graph->frame_index;
+}
+
+WGPUTextureView
+wgpu_frame_graph_get_texture_view(wgpu_frame_graph_t* graph,
+                                  wgpu_frame_graph_resource_t resource)
+{
+  const frame_graph_resource_t* res = frame_graph_get_resource(graph, resource);
+  if (res->view == NULL) {
+    log_warn("Frame graph texture %s is not used by a live pass",
+             res->label ? res->label : "");
+  }
+  return res->view;
+}
+
+void wgpu_frame_graph_get_stats(wgpu_frame_graph_t* graph,
+                                wgpu_frame_graph_stats_t* stats)
+{
+  *stats = graph->stats;
+}
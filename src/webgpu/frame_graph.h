@@ -0,0 +1,151 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include "context.h"
+
+#define WGPU_FRAME_GRAPH_MAX_PASSES 32u
+#define WGPU_FRAME_GRAPH_MAX_RESOURCES 64u
+#define WGPU_FRAME_GRAPH_MAX_COLOR_ATTACHMENTS 4u
+#define WGPU_FRAME_GRAPH_MAX_PASS_RESOURCES 8u
+/* Frames a pooled texture is kept without being used */
+#define WGPU_FRAME_GRAPH_MAX_UNUSED_FRAMES 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU frame graph
+ *
+ * Lightweight frame graph for multi-pass rendering, e.g. post-processing. The
+ * passes of a frame are declared together with the textures they render to,
+ * read and write, and are recorded in declaration order by
+ * wgpu_frame_graph_execute():
+ *
+ *   wgpu_frame_graph_begin(graph);
+ *   scene = wgpu_frame_graph_create_texture(graph, &scene_desc);
+ *   frame = wgpu_frame_graph_import_texture(graph, &swap_chain_desc);
+ *   wgpu_frame_graph_add_pass(graph, &scene_pass_desc);      writes scene
+ *   wgpu_frame_graph_add_pass(graph, &composite_pass_desc);  reads scene,
+ *                                                            writes frame
+ *   wgpu_frame_graph_execute(graph, cmd_enc);
+ *
+ * Imported textures, e.g. the swap chain, are the outputs of the graph. Passes
+ * which do not contribute to an output are culled. Transient textures are
+ * taken from a texture pool by lifetime: a pooled texture is reused by later
+ * transient textures with the same format, size and usage once its last pass
+ * was recorded, and across frames. Pooled textures not used for
+ * WGPU_FRAME_GRAPH_MAX_UNUSED_FRAMES frames are released.
+ *
+ * The load and store operations are derived from the graph: the first pass
+ * writing a texture clears it (depth to 1.0, 0.0 with reversed-Z, stencil to
+ * 0), later passes load it, and attachments are only stored when a later pass
+ * uses them or the texture is imported. WebGPU tracks the usage transitions
+ * between the passes itself, the graph does not record barriers. Every live
+ * pass is recorded in a profiler scope named by its label.
+ *
+ * Bind groups referencing transient textures are created during the pass
+ * execution, with wgpu_create_bind_group() they are taken from the bind group
+ * cache since the pooled texture views stay the same from frame to frame.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_frame_graph wgpu_frame_graph_t;
+
+/* Resource handle, 0 = no resource */
+typedef uint32_t wgpu_frame_graph_resource_t;
+
+typedef struct wgpu_frame_graph_texture_desc_t {
+  const char* label;
+  WGPUTextureFormat format;
+  /* Size in texels, 0 = the surface size multiplied by scale */
+  uint32_t width;
+  uint32_t height;
+  /* Scale of the surface size, 0 = 1 */
+  float scale;
+} wgpu_frame_graph_texture_desc_t;
+
+typedef struct wgpu_frame_graph_import_desc_t {
+  const char* label;
+  WGPUTextureView view;
+  WGPUTextureFormat format;
+  /* Load the contents written before the graph instead of clearing them */
+  bool load;
+} wgpu_frame_graph_import_desc_t;
+
+typedef enum wgpu_frame_graph_pass_type_t {
+  FrameGraph_PassType_Render  = 0,
+  FrameGraph_PassType_Compute = 1,
+} wgpu_frame_graph_pass_type_t;
+
+typedef struct wgpu_frame_graph_color_attachment_t {
+  wgpu_frame_graph_resource_t resource;
+  WGPUColor clear_value;
+} wgpu_frame_graph_color_attachment_t;
+
+typedef struct wgpu_frame_graph_pass_encoder_t {
+  WGPURenderPassEncoder render;   /* Set for render passes */
+  WGPUComputePassEncoder compute; /* Set for compute passes */
+} wgpu_frame_graph_pass_encoder_t;
+
+typedef void (*wgpu_frame_graph_execute_func_t)(
+  wgpu_frame_graph_t* graph, wgpu_frame_graph_pass_encoder_t encoder,
+  void* user_data);
+
+typedef struct wgpu_frame_graph_pass_desc_t {
+  const char* label;
+  wgpu_frame_graph_pass_type_t type;
+  /* Render pass attachments */
+  uint32_t color_attachment_count;
+  wgpu_frame_graph_color_attachment_t
+    color_attachments[WGPU_FRAME_GRAPH_MAX_COLOR_ATTACHMENTS];
+  wgpu_frame_graph_resource_t depth_stencil_attachment;
+  /* Textures sampled by the pass */
+  uint32_t read_count;
+  wgpu_frame_graph_resource_t reads[WGPU_FRAME_GRAPH_MAX_PASS_RESOURCES];
+  /* Textures written as storage textures by the pass */
+  uint32_t write_count;
+  wgpu_frame_graph_resource_t writes[WGPU_FRAME_GRAPH_MAX_PASS_RESOURCES];
+  /* Records the commands of the pass into the pass encoder */
+  wgpu_frame_graph_execute_func_t execute_func;
+  void* user_data;
+} wgpu_frame_graph_pass_desc_t;
+
+typedef struct wgpu_frame_graph_stats_t {
+  uint32_t pass_count;        /* passes declared in the last frame */
+  uint32_t culled_pass_count; /* passes culled in the last frame */
+  uint32_t transient_count;   /* transient textures used in the last frame */
+  uint32_t allocated_count;   /* pooled textures used in the last frame */
+  uint32_t pooled_count;      /* textures in the pool */
+} wgpu_frame_graph_stats_t;
+
+/* Frame graph creating / destroying */
+wgpu_frame_graph_t* wgpu_frame_graph_create(wgpu_context_t* wgpu_context);
+void wgpu_frame_graph_destroy(wgpu_frame_graph_t* graph);
+
+/* Starts declaring the passes of a new frame */
+void wgpu_frame_graph_begin(wgpu_frame_graph_t* graph);
+
+/* Resource declaration */
+wgpu_frame_graph_resource_t
+wgpu_frame_graph_create_texture(wgpu_frame_graph_t* graph,
+                                const wgpu_frame_graph_texture_desc_t* desc);
+wgpu_frame_graph_resource_t
+wgpu_frame_graph_import_texture(wgpu_frame_graph_t* graph,
+                                const wgpu_frame_graph_import_desc_t* desc);
+
+/* Pass declaration */
+void wgpu_frame_graph_add_pass(wgpu_frame_graph_t* graph,
+                               const wgpu_frame_graph_pass_desc_t* desc);
+
+/**
+ * @brief Culls the passes, assigns the pooled textures and records the passes
+ * into the command encoder.
+ */
+void wgpu_frame_graph_execute(wgpu_frame_graph_t* graph,
+                              WGPUCommandEncoder cmd_enc);
+
+/* Texture view of a resource, valid during the execution of the passes */
+WGPUTextureView
+wgpu_frame_graph_get_texture_view(wgpu_frame_graph_t* graph,
+                                  wgpu_frame_graph_resource_t resource);
+
+void wgpu_frame_graph_get_stats(wgpu_frame_graph_t* graph,
+                                wgpu_frame_graph_stats_t* stats);
+
+#endif /* FRAME_GRAPH_H */
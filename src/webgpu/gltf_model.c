@@ -1,14 +1,57 @@
 #include "gltf_model.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <cgltf.h>
 
+#include "../core/async_io.h"
 #include "../core/file.h"
+#include "../core/frustum.h"
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "../core/mesh_decoder.h"
+#include "../core/mesh_optimizer.h"
+#include "../core/thread_pool.h"
+#include "../core/trace.h"
+#include "hiz_culling.h"
+#include "upload_batch.h"
+
+/* Minimum uniform / storage buffer offset alignment (WebGPU default limits) */
+#define WGPU_GLTF_UNIFORM_OFFSET_ALIGNMENT 256u
+#define WGPU_GLTF_STORAGE_OFFSET_ALIGNMENT 256u
+
+/* Workgroup size of the compute skinning shader */
+#define WGPU_GLTF_SKINNING_WORKGROUP_SIZE 64u
+
+/* Render flags selecting materials by their alpha mode */
+#define GLTF_ALPHA_MODE_RENDER_FLAGS                                           \
+  (WGPU_GLTF_RenderFlags_RenderOpaqueNodes                                     \
+   | WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes                              \
+   | WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes)
+
+/* Meshlet limits, the culling shader copies the indices with 64 threads */
+#define WGPU_GLTF_MESHLET_MAX_VERTICES 64u
+#define WGPU_GLTF_MESHLET_MAX_TRIANGLES 128u
+#define WGPU_GLTF_MAX_WORKGROUPS_PER_DIMENSION 65535u
+
+/* Levels of detail: simplification error limit relative to the primitive's
+ * extent, smallest primitive simplified, maximum index count of a level
+ * relative to the previous one and default projected size threshold */
+#define GLTF_LOD_MAX_ERROR 0.05f
+#define GLTF_LOD_MIN_INDEX_COUNT 192u
+#define GLTF_LOD_MAX_REDUCTION 0.8f
+#define GLTF_LOD_DEFAULT_THRESHOLD 0.25f
+
+/* Layers of a packed texture array (WebGPU default limit) */
+#define GLTF_PACKED_TEXTURE_MAX_LAYERS 256u
+/* Packed layer of a missing or unpacked material texture */
+#define GLTF_PACKED_TEXTURE_NONE 0xffffffffu
 
 /*
  * Forward declarations
@@ -18,6 +61,14 @@ struct gltf_node_t;
 static struct gltf_node_t*
 gltf_model_node_from_index(struct gltf_model_t* model, uint32_t index);
 static void gltf_model_get_scene_dimensions(struct gltf_model_t* model);
+static void gltf_model_release_compute_skinning(struct gltf_model_t* model);
+static void gltf_model_release_meshlet_culling(struct gltf_model_t* model);
+static char* gltf_concat_wgsl(const char* const* sources, uint32_t count);
+
+static uint64_t gltf_align_size(uint64_t size, uint64_t alignment)
+{
+  return (size + alignment - 1) & ~(alignment - 1);
+}
 
 /*
  * glTF enums
@@ -53,30 +104,20 @@ static vec3* vec3_max(vec3* x, vec3* y)
 static void bounding_get_aabb(bounding_box_t* bounding_box, mat4 m,
                               bounding_box_t* dest)
 {
-  vec3 min = {m[0][3], m[0][3], m[0][3]};
-  vec3 max = GLM_VEC3_ZERO_INIT;
-  glm_vec3_copy(min, max);
-  vec3 v0 = GLM_VEC3_ZERO_INIT, v1 = GLM_VEC3_ZERO_INIT;
-
-  vec3 right = {m[0][0], m[0][0], m[0][0]};
-  glm_vec3_scale(right, bounding_box->min[0], v0);
-  glm_vec3_scale(right, bounding_box->max[0], v1);
-  glm_vec3_add(min, *vec3_min(&v0, &v1), min);
-  glm_vec3_add(max, *vec3_max(&v0, &v1), max);
-
-  vec3 up = {m[0][1], m[0][1], m[0][1]};
-  glm_vec3_scale(up, bounding_box->min[1], v0);
-  glm_vec3_scale(up, bounding_box->max[1], v1);
-  glm_vec3_add(min, *vec3_min(&v0, &v1), min);
-  glm_vec3_add(max, *vec3_max(&v0, &v1), max);
-
-  vec3 back = {m[0][2], m[0][2], m[0][2]};
-  glm_vec3_scale(back, bounding_box->min[2], v0);
-  glm_vec3_scale(back, bounding_box->max[2], v1);
-  glm_vec3_add(min, *vec3_min(&v0, &v1), min);
-  glm_vec3_add(max, *vec3_max(&v0, &v1), max);
+  // Transformed box (Jim Arvo, "Transforming Axis-Aligned Bounding Boxes")
+  vec3 min = {m[3][0], m[3][1], m[3][2]};
+  vec3 max = {m[3][0], m[3][1], m[3][2]};
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      const float v0 = m[axis][i] * bounding_box->min[axis];
+      const float v1 = m[axis][i] * bounding_box->max[axis];
+      min[i] += MIN(v0, v1);
+      max[i] += MAX(v0, v1);
+    }
+  }
 
   bounding_box_init(dest, min, max);
+  dest->valid = true;
 }
 
 /*
@@ -133,6 +174,8 @@ static void gltf_texture_init(gltf_texture_t* texture,
                               wgpu_context_t* wgpu_context)
 {
   texture->wgpu_context = wgpu_context;
+  texture->packed_array = -1;
+  texture->packed_layer = 0;
 }
 
 static void gltf_texture_destroy(gltf_texture_t* texture)
@@ -141,7 +184,36 @@ static void gltf_texture_destroy(gltf_texture_t* texture)
     return;
   }
 
-  wgpu_destroy_texture(&texture->wgpu_texture);
+  if (texture->shared) {
+    wgpu_release_texture(texture->wgpu_context, &texture->wgpu_texture);
+    texture->shared = false;
+  }
+  else {
+    wgpu_destroy_texture(&texture->wgpu_texture);
+  }
+}
+
+/* Load options of the image files referenced by a model, images with the same
+ * path and options are shared between models */
+static struct wgpu_texture_load_options_t gltf_image_file_load_options(void)
+{
+  return (struct wgpu_texture_load_options_t){
+    .generate_mipmaps = true,
+    .address_mode     = WGPUAddressMode_Repeat,
+  };
+}
+
+/* Data of a buffer view, views compressed with EXT_meshopt_compression point to
+ * their decoded data (owned by cgltf) */
+static uint8_t* gltf_buffer_view_data(const cgltf_buffer_view* view)
+{
+  return view->data != NULL ? (uint8_t*)view->data :
+                              (uint8_t*)view->buffer->data + view->offset;
+}
+
+static uint8_t* gltf_accessor_data(const cgltf_accessor* accessor)
+{
+  return gltf_buffer_view_data(accessor->buffer_view) + accessor->offset;
 }
 
 static void get_relative_file_path(const char* base_path, const char* new_path,
@@ -171,20 +243,17 @@ static void gltf_texture_from_gltf_image(const char* model_uri,
     if (filename_has_extension(image_uri, "jpg")
         || filename_has_extension(image_uri, "png")
         || filename_has_extension(image_uri, "ktx")) {
-      texture->wgpu_texture = wgpu_create_texture_from_file(
-        texture->wgpu_context, image_uri,
-        &(struct wgpu_texture_load_options_t){
-          .generate_mipmaps = true,
-          .address_mode     = WGPUAddressMode_Repeat,
-        });
+      struct wgpu_texture_load_options_t options
+        = gltf_image_file_load_options();
+      texture->wgpu_texture = wgpu_acquire_texture_from_file(
+        texture->wgpu_context, image_uri, &options);
+      texture->shared = (texture->wgpu_texture.texture != NULL);
     }
   }
   else if (gltf_image->buffer_view) {
     /* Load image data from memory */
     texture->wgpu_texture = wgpu_create_texture_from_memory(
-      texture->wgpu_context,
-      (void*)((uint8_t*)gltf_image->buffer_view->buffer->data
-              + gltf_image->buffer_view->offset),
+      texture->wgpu_context, gltf_buffer_view_data(gltf_image->buffer_view),
       gltf_image->buffer_view->size, NULL);
   }
 }
@@ -227,17 +296,25 @@ static void gltf_material_init(gltf_material_t* material,
   material->pbr_workflows.specular_glossiness = false;
   material->bind_group                        = NULL;
   material->pipeline                          = NULL;
+  material->depth_pipeline                    = NULL;
 }
 
 static void gltf_material_destroy(gltf_material_t* material)
 {
   WGPU_RELEASE_RESOURCE(BindGroup, material->bind_group)
   WGPU_RELEASE_RESOURCE(RenderPipeline, material->pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, material->depth_pipeline)
 }
 
 /*
  * glTF primitive
  */
+typedef struct gltf_primitive_lod_t {
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t first_compact_index;
+} gltf_primitive_lod_t;
+
 typedef struct gltf_primitive_t {
   uint32_t first_index;
   uint32_t index_count;
@@ -245,7 +322,18 @@ typedef struct gltf_primitive_t {
   uint32_t vertex_count;
   gltf_material_t* material;
   bool has_indices;
+  /* Uint16 = drawn from the compact indices relative to the first vertex */
+  WGPUIndexFormat index_format;
+  uint32_t first_compact_index;
+  /* Simplified levels of detail after the full detail level */
+  uint32_t lod_count;
+  gltf_primitive_lod_t lods[WGPU_GLTF_MAX_LOD_COUNT - 1];
+  /* Morph target deltas in the model's delta array, position, normal and
+   * tangent (3 vec4) per vertex of every target */
+  uint32_t first_morph_delta;
+  uint32_t morph_target_count;
   bounding_box_t bb;
+  int32_t draw_index; /* indirect draw of the meshlet culling, -1 = none */
 } gltf_primitive_t;
 
 static void gltf_primitive_init(gltf_primitive_t* primitive,
@@ -258,9 +346,29 @@ static void gltf_primitive_init(gltf_primitive_t* primitive,
   primitive->vertex_count = 0;
   primitive->material     = material;
   primitive->has_indices  = index_count > 0;
+  primitive->index_format        = WGPUIndexFormat_Uint32;
+  primitive->first_compact_index = 0;
+  primitive->lod_count           = 0;
+  primitive->first_morph_delta   = 0;
+  primitive->morph_target_count  = 0;
+  primitive->draw_index   = -1;
   bounding_box_init(&primitive->bb, GLM_VEC3_ZERO, GLM_VEC3_ZERO);
 }
 
+/* Index range of a level of detail, 0 = full detail */
+static gltf_primitive_lod_t gltf_primitive_get_lod(const gltf_primitive_t* p,
+                                                   uint32_t lod)
+{
+  if (lod == 0 || lod > p->lod_count) {
+    return (gltf_primitive_lod_t){
+      .first_index         = p->first_index,
+      .index_count         = p->index_count,
+      .first_compact_index = p->first_compact_index,
+    };
+  }
+  return p->lods[lod - 1];
+}
+
 static void gltf_primitive_set_bounding_box(gltf_primitive_t* primitive,
                                             vec3 min, vec3 max)
 {
@@ -272,6 +380,12 @@ static void gltf_primitive_set_bounding_box(gltf_primitive_t* primitive,
 /*
  * glTF mesh
  */
+typedef struct gltf_mesh_uniform_block_t {
+  mat4 matrix;
+  mat4 joint_matrix[WGPU_GLTF_MAX_NUM_JOINTS];
+  float joint_count;
+} gltf_mesh_uniform_block_t;
+
 typedef struct gltf_mesh_t {
   wgpu_context_t* wgpu_context;
   gltf_primitive_t* primitives;
@@ -279,34 +393,49 @@ typedef struct gltf_mesh_t {
   char name[STRMAX];
   bounding_box_t bb;
   bounding_box_t aabb;
+  /* Range of the mesh in the uniform buffer shared by all meshes of a model */
   struct {
-    WGPUBuffer buffer;
+    uint64_t offset;
     uint64_t size;
     WGPUBindGroup bind_group;
+    bool dirty;
   } uniform_buffer;
+  /* Points into the CPU copy of the shared uniform buffer */
+  gltf_mesh_uniform_block_t* uniform_block;
+  /* Range of the mesh in the instance buffer of
+   * WGPU_GLTF_FileLoadingFlags_MeshInstancing, the first node referencing the
+   * mesh draws all instances */
+  struct {
+    struct gltf_node_t* node;
+    uint32_t first;
+    uint32_t count;
+    bounding_box_t bb; /* world space bounds of all instances */
+    bool dirty;
+  } instances;
+  /* Range of the morph target weights in the weight buffer of the model */
   struct {
-    mat4 matrix;
-    mat4 joint_matrix[WGPU_GLTF_MAX_NUM_JOINTS];
-    float joint_count;
-  } uniform_block;
+    uint32_t first;
+    uint32_t count;
+    bool dirty;
+  } weights;
 } gltf_mesh_t;
 
 static void gltf_mesh_init(gltf_mesh_t* mesh, wgpu_context_t* wgpu_context,
+                           uint8_t* uniform_data, uint64_t uniform_offset,
                            mat4 matrix)
 {
   memset(mesh, 0, sizeof(gltf_mesh_t));
 
-  mesh->wgpu_context = wgpu_context;
-  glm_mat4_copy(matrix, mesh->uniform_block.matrix);
-  mesh->uniform_buffer.size   = sizeof(mesh->uniform_block);
-  mesh->uniform_buffer.buffer = wgpu_create_buffer_from_data(
-    wgpu_context, &mesh->uniform_block, mesh->uniform_buffer.size,
-    WGPUBufferUsage_Uniform);
+  mesh->wgpu_context          = wgpu_context;
+  mesh->uniform_buffer.offset = uniform_offset;
+  mesh->uniform_buffer.size   = sizeof(gltf_mesh_uniform_block_t);
+  mesh->uniform_block
+    = (gltf_mesh_uniform_block_t*)(uniform_data + uniform_offset);
+  glm_mat4_copy(matrix, mesh->uniform_block->matrix);
 }
 
 static void gltf_mesh_destroy(gltf_mesh_t* mesh)
 {
-  WGPU_RELEASE_RESOURCE(Buffer, mesh->uniform_buffer.buffer);
   WGPU_RELEASE_RESOURCE(BindGroup, mesh->uniform_buffer.bind_group);
 
   if (mesh->primitives != NULL) {
@@ -332,11 +461,16 @@ typedef struct gltf_skin_t {
   struct gltf_node_t** joints;
   uint32_t current_joint_index;
   uint32_t joint_count;
+  /* Range of the skin in the joint palette shared by all skins of a model */
   struct {
-    WGPUBuffer buffer;
+    uint64_t offset;
     uint64_t size;
     WGPUBindGroup bind_group;
+    bool dirty;
   } ssbo;
+  /* Points into the CPU copy of the joint palette, not limited to
+   * WGPU_GLTF_MAX_NUM_JOINTS */
+  mat4* joint_matrices;
 } gltf_skin_t;
 
 /*
@@ -358,6 +492,15 @@ typedef struct gltf_node_t {
   versor rotation;
   bounding_box_t bvh;
   bounding_box_t aabb;
+  /* Cached world matrix, updated by gltf_model_update_world_matrices() */
+  mat4 world_matrix;
+  bool dirty;         /* local transform changed since the last update */
+  bool world_updated; /* world matrix changed in the last update */
+  /* EXT_mesh_gpu_instancing transforms relative to the node, NULL = the node
+   * is a single instance of its mesh */
+  mat4* instance_matrices;
+  uint32_t instance_count;
+  uint32_t first_instance; /* first instance in the model's instance buffer */
 } gltf_node_t;
 
 static void gltf_node_init(gltf_node_t* node)
@@ -375,6 +518,12 @@ static void gltf_node_init(gltf_node_t* node)
   glm_quat_identity(node->rotation);
   bounding_box_init(&node->bvh, GLM_VEC3_ZERO, GLM_VEC3_ZERO);
   bounding_box_init(&node->aabb, GLM_VEC3_ZERO, GLM_VEC3_ZERO);
+  glm_mat4_identity(node->world_matrix);
+  node->dirty             = true;
+  node->world_updated     = false;
+  node->instance_matrices = NULL;
+  node->instance_count    = 0;
+  node->first_instance    = 0;
 }
 
 static void glm_cast_versor_to_mat3(versor q, mat3* result)
@@ -429,56 +578,79 @@ static void gltf_node_get_local_matrix(gltf_node_t* node, mat4* dest)
 }
 
 /*
- * Traverse the node hierarchy to the top-most parent to get the local matrix of
- * the given node
+ * Get the world matrix of the given node, the cached matrix is up to date
+ * after gltf_model_update_world_matrices()
  */
 static void gltf_node_get_matrix(gltf_node_t* node, mat4* dest)
 {
-  gltf_node_get_local_matrix(node, dest);
-  gltf_node_t* p    = node->parent;
-  mat4 local_matrix = GLM_MAT4_ZERO_INIT;
-  while (p != NULL) {
-    gltf_node_get_local_matrix(p, &local_matrix);
-    glm_mat4_mul(local_matrix, *dest, *dest);
-    p = p->parent;
+  glm_mat4_copy(node->world_matrix, *dest);
+}
+
+/*
+ * Update the cached world matrix of the node if its local transform or the
+ * world matrix of its parent changed. The parent has to be updated first.
+ */
+static void gltf_node_update_world_matrix(gltf_node_t* node)
+{
+  gltf_node_t* parent = node->parent;
+  node->world_updated
+    = node->dirty || (parent != NULL && parent->world_updated);
+  if (!node->world_updated) {
+    return;
+  }
+  gltf_node_get_local_matrix(node, &node->world_matrix);
+  if (parent != NULL) {
+    glm_mat4_mul(parent->world_matrix, node->world_matrix, node->world_matrix);
   }
+  node->dirty = false;
 }
 
-static void gltf_node_update(wgpu_context_t* wgpu_context, gltf_node_t* node)
+static bool gltf_skin_joints_updated(gltf_skin_t* skin)
 {
-  if (node->mesh != NULL) {
-    mat4 m = GLM_MAT4_ZERO_INIT;
-    gltf_node_get_local_matrix(node, &m);
-    if (node->skin != NULL) {
-      gltf_skin_t* skin = node->skin;
-      glm_mat4_copy(m, node->mesh->uniform_block.matrix);
-      // Update the joint matrices
-      mat4 inverse_transform = GLM_MAT4_ZERO_INIT;
-      glm_mat4_inv(m, inverse_transform);
-      size_t num_joints = MIN(skin->joint_count, WGPU_GLTF_MAX_NUM_JOINTS);
-      for (size_t i = 0; i < num_joints; ++i) {
-        gltf_node_t* joint_node = skin->joints[i];
-        mat4 joint_mat          = GLM_MAT4_ZERO_INIT;
-        mat4 joint_node_mat     = GLM_MAT4_ZERO_INIT;
-        gltf_node_get_matrix(joint_node, &joint_node_mat);
-        glm_mat4_mul(joint_node_mat, skin->inverse_bind_matrices[i], joint_mat);
-        glm_mat4_mul(inverse_transform, joint_mat, joint_mat);
-        glm_mat4_copy(joint_mat, node->mesh->uniform_block.joint_matrix[i]);
-      }
-      node->mesh->uniform_block.joint_count = (float)skin->joint_count;
-      wgpu_queue_write_buffer(wgpu_context, node->mesh->uniform_buffer.buffer,
-                              0, &node->mesh->uniform_block,
-                              sizeof(node->mesh->uniform_buffer));
-    }
-    else {
-      wgpu_queue_write_buffer(wgpu_context, node->mesh->uniform_buffer.buffer,
-                              0, &m, sizeof(mat4));
+  for (uint32_t i = 0; i < skin->joint_count; ++i) {
+    if (skin->joints[i] != NULL && skin->joints[i]->world_updated) {
+      return true;
     }
   }
+  return false;
+}
 
-  for (uint32_t i = 0; i < node->child_count; ++i) {
-    gltf_node_update(wgpu_context, node->children[i]);
+/*
+ * Update the uniform block of the node's mesh from the cached world matrices.
+ * The block is only updated on the CPU side and marked dirty, all dirty blocks
+ * of the model are uploaded at once by gltf_model_write_mesh_uniforms().
+ */
+static void gltf_node_update(gltf_node_t* node)
+{
+  if (node->mesh == NULL) {
+    return;
+  }
+
+  gltf_mesh_uniform_block_t* uniform_block = node->mesh->uniform_block;
+  glm_mat4_copy(node->world_matrix, uniform_block->matrix);
+  if (node->skin != NULL) {
+    gltf_skin_t* skin = node->skin;
+    // Update the joint matrices
+    mat4 inverse_transform = GLM_MAT4_ZERO_INIT;
+    glm_mat4_inv(node->world_matrix, inverse_transform);
+    size_t num_joints = MIN(skin->joint_count, WGPU_GLTF_MAX_NUM_JOINTS);
+    for (size_t i = 0; i < skin->joint_count; ++i) {
+      gltf_node_t* joint_node = skin->joints[i];
+      if (joint_node == NULL) {
+        continue;
+      }
+      mat4* joint_mat = &skin->joint_matrices[i];
+      glm_mat4_mul(joint_node->world_matrix, skin->inverse_bind_matrices[i],
+                   *joint_mat);
+      glm_mat4_mul(inverse_transform, *joint_mat, *joint_mat);
+      if (i < num_joints) {
+        glm_mat4_copy(*joint_mat, uniform_block->joint_matrix[i]);
+      }
+    }
+    uniform_block->joint_count = (float)skin->joint_count;
+    skin->ssbo.dirty           = true;
   }
+  node->mesh->uniform_buffer.dirty = true;
 }
 
 static void gltf_node_destroy(gltf_node_t* node)
@@ -486,12 +658,20 @@ static void gltf_node_destroy(gltf_node_t* node)
   if (node->children != NULL) {
     free(node->children);
   }
+  free(node->instance_matrices);
+}
+
+/* Instances of the node's mesh drawn for the node */
+static uint32_t gltf_node_get_instance_count(const gltf_node_t* node)
+{
+  return node->instance_matrices != NULL ? node->instance_count : 1;
 }
 
 typedef enum path_type_enum {
   PathType_TRANSLATION = 0,
   PathType_ROTATION    = 1,
   PathType_SCALE       = 2,
+  PathType_WEIGHTS     = 3,
 } path_type_enum;
 
 /*
@@ -501,14 +681,16 @@ typedef struct gltf_animation_channel_t {
   path_type_enum path;
   gltf_node_t* node;
   uint32_t sampler_index;
+  uint32_t keyframe_cursor; /* keyframe of the last update */
   bool is_valid;
 } gltf_animation_channel_t;
 
 static void gltf_animation_channel_init(gltf_animation_channel_t* channel)
 {
-  channel->node          = NULL;
-  channel->sampler_index = 0;
-  channel->is_valid      = false;
+  channel->node            = NULL;
+  channel->sampler_index   = 0;
+  channel->keyframe_cursor = 0;
+  channel->is_valid        = false;
 }
 
 typedef enum interpolation_type_enum {
@@ -526,6 +708,9 @@ typedef struct gltf_animation_sampler_t {
   uint32_t input_count;
   vec4* outputs_vec4;
   uint32_t outputs_vec4_count;
+  /* Scalar outputs, the morph target weights of all targets per keyframe */
+  float* outputs_float;
+  uint32_t outputs_float_count;
 } gltf_animation_sampler_t;
 
 static void gltf_animation_sampler_init(gltf_animation_sampler_t* sampler)
@@ -535,6 +720,166 @@ static void gltf_animation_sampler_init(gltf_animation_sampler_t* sampler)
 
   sampler->outputs_vec4       = NULL;
   sampler->outputs_vec4_count = 0;
+
+  sampler->outputs_float       = NULL;
+  sampler->outputs_float_count = 0;
+}
+
+/*
+ * Find the keyframe k with inputs[k] <= time <= inputs[k + 1]. The keyframe of
+ * the previous update and its successor are checked first, as the time usually
+ * advances only slightly between two updates, otherwise a binary search is
+ * done. Returns false if the time is outside of the sampler's time range.
+ */
+static bool gltf_animation_sampler_find_keyframe(
+  gltf_animation_sampler_t* sampler, float time, uint32_t* cursor)
+{
+  const float* inputs = sampler->inputs;
+  const uint32_t last = sampler->input_count - 1;
+  if (sampler->input_count < 2 || time < inputs[0] || time > inputs[last]) {
+    return false;
+  }
+
+  for (uint32_t k = *cursor; k < MIN(*cursor + 2, last); ++k) {
+    if (time >= inputs[k] && time <= inputs[k + 1]) {
+      *cursor = k;
+      return true;
+    }
+  }
+
+  uint32_t low = 0, high = last;
+  while (high - low > 1) {
+    const uint32_t mid = low + (high - low) / 2;
+    if (time < inputs[mid]) {
+      high = mid;
+    }
+    else {
+      low = mid;
+    }
+  }
+  *cursor = low;
+  return true;
+}
+
+/*
+ * Cubic Hermite spline interpolation between the keyframes k and k + 1, the
+ * outputs are stored as (in-tangent, value, out-tangent) triplets.
+ * See https://github.com/KhronosGroup/glTF/tree/main/specification/2.0#appendix-c-interpolation
+ */
+static void gltf_animation_sampler_cubic_spline(
+  gltf_animation_sampler_t* sampler, uint32_t k, float u, vec4 dest)
+{
+  const float dt  = sampler->inputs[k + 1] - sampler->inputs[k];
+  const float u2  = u * u;
+  const float u3  = u2 * u;
+  const float h00 = 2.0f * u3 - 3.0f * u2 + 1.0f;
+  const float h10 = (u3 - 2.0f * u2 + u) * dt;
+  const float h01 = -2.0f * u3 + 3.0f * u2;
+  const float h11 = (u3 - u2) * dt;
+
+  vec4* v0 = &sampler->outputs_vec4[k * 3 + 1];
+  vec4* b0 = &sampler->outputs_vec4[k * 3 + 2];
+  vec4* a1 = &sampler->outputs_vec4[(k + 1) * 3 + 0];
+  vec4* v1 = &sampler->outputs_vec4[(k + 1) * 3 + 1];
+  for (uint32_t i = 0; i < 4; ++i) {
+    dest[i] = h00 * (*v0)[i] + h10 * (*b0)[i] + h01 * (*v1)[i]
+              + h11 * (*a1)[i];
+  }
+}
+
+/*
+ * Sample the keyframe output at the given time, returns false if the time is
+ * outside of the sampler's time range
+ */
+static bool gltf_animation_sampler_sample(gltf_animation_sampler_t* sampler,
+                                          path_type_enum path, float time,
+                                          uint32_t* cursor, vec4 dest)
+{
+  const uint32_t outputs_per_keyframe
+    = sampler->interpolation == InterpolationType_CUBICSPLINE ? 3 : 1;
+  if (sampler->outputs_vec4_count
+      < sampler->input_count * outputs_per_keyframe) {
+    return false;
+  }
+  if (!gltf_animation_sampler_find_keyframe(sampler, time, cursor)) {
+    return false;
+  }
+
+  const uint32_t k = *cursor;
+  const float dt   = sampler->inputs[k + 1] - sampler->inputs[k];
+  const float u    = dt > 0.0f ? (time - sampler->inputs[k]) / dt : 0.0f;
+  switch (sampler->interpolation) {
+    case InterpolationType_STEP: {
+      glm_vec4_copy(sampler->outputs_vec4[k], dest);
+    } break;
+    case InterpolationType_CUBICSPLINE: {
+      gltf_animation_sampler_cubic_spline(sampler, k, u, dest);
+      if (path == PathType_ROTATION) {
+        glm_quat_normalize(dest);
+      }
+    } break;
+    case InterpolationType_LINEAR:
+    default: {
+      if (path == PathType_ROTATION) {
+        glm_quat_slerp(sampler->outputs_vec4[k], sampler->outputs_vec4[k + 1],
+                       u, dest);
+        glm_quat_normalize(dest);
+      }
+      else {
+        glm_vec4_lerp(sampler->outputs_vec4[k], sampler->outputs_vec4[k + 1],
+                      u, dest);
+      }
+    } break;
+  }
+  return true;
+}
+
+/*
+ * Sample the morph target weights at the given time, the outputs hold count
+ * weights per keyframe (per in-tangent, value and out-tangent of cubic spline
+ * samplers). Returns false if the time is outside of the sampler's time
+ * range.
+ */
+static bool gltf_animation_sampler_sample_weights(
+  gltf_animation_sampler_t* sampler, float time, uint32_t* cursor,
+  uint32_t count, float* dest)
+{
+  const bool cubic = sampler->interpolation == InterpolationType_CUBICSPLINE;
+  const uint32_t outputs_per_keyframe = (cubic ? 3 : 1) * count;
+  if (count == 0
+      || sampler->outputs_float_count
+           < sampler->input_count * outputs_per_keyframe) {
+    return false;
+  }
+  if (!gltf_animation_sampler_find_keyframe(sampler, time, cursor)) {
+    return false;
+  }
+
+  const uint32_t k   = *cursor;
+  const float dt     = sampler->inputs[k + 1] - sampler->inputs[k];
+  const float u      = dt > 0.0f ? (time - sampler->inputs[k]) / dt : 0.0f;
+  const float* k0    = &sampler->outputs_float[k * outputs_per_keyframe];
+  const float* k1    = &sampler->outputs_float[(k + 1) * outputs_per_keyframe];
+  for (uint32_t i = 0; i < count; ++i) {
+    switch (sampler->interpolation) {
+      case InterpolationType_STEP: {
+        dest[i] = k0[i];
+      } break;
+      case InterpolationType_CUBICSPLINE: {
+        const float u2 = u * u;
+        const float u3 = u2 * u;
+        dest[i] = (2.0f * u3 - 3.0f * u2 + 1.0f) * k0[count + i]
+                  + (u3 - 2.0f * u2 + u) * dt * k0[2 * count + i]
+                  + (-2.0f * u3 + 3.0f * u2) * k1[count + i]
+                  + (u3 - u2) * dt * k1[i];
+      } break;
+      case InterpolationType_LINEAR:
+      default: {
+        dest[i] = k0[i] + (k1[i] - k0[i]) * u;
+      } break;
+    }
+  }
+  return true;
 }
 
 /* glTF animation */
@@ -571,7 +916,20 @@ typedef struct gltf_vertex_t {
   vec4 tangent;
 } gltf_vertex_t;
 
-WGPUVertexAttribute wgpu_gltf_get_vertex_attribute_description(
+/*
+ * Quantized glTF vertex, see WGPU_GLTF_VertexFormat_Quantized
+ */
+typedef struct gltf_quantized_vertex_t {
+  float pos[3];
+  int16_t normal[4];  /* snorm16, w = 0 */
+  uint16_t uv[2];     /* float16 */
+  uint8_t color[4];   /* unorm8 */
+  uint8_t joint0[4];  /* uint8 */
+  uint8_t weight0[4]; /* unorm8, the weights sum up to 255 */
+  int16_t tangent[4]; /* snorm16 */
+} gltf_quantized_vertex_t;
+
+static WGPUVertexAttribute gltf_get_default_vertex_attribute_description(
   uint32_t shader_location, wgpu_gltf_vertex_component_enum_t component)
 {
   switch (component) {
@@ -622,11 +980,182 @@ WGPUVertexAttribute wgpu_gltf_get_vertex_attribute_description(
   }
 }
 
+
+static WGPUVertexAttribute gltf_get_quantized_vertex_attribute_description(
+  uint32_t shader_location, wgpu_gltf_vertex_component_enum_t component)
+{
+  switch (component) {
+    case WGPU_GLTF_VertexComponent_Position:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Float32x3,
+        .offset         = offsetof(gltf_quantized_vertex_t, pos),
+      };
+    case WGPU_GLTF_VertexComponent_Normal:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Snorm16x4,
+        .offset         = offsetof(gltf_quantized_vertex_t, normal),
+      };
+    case WGPU_GLTF_VertexComponent_UV:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Float16x2,
+        .offset         = offsetof(gltf_quantized_vertex_t, uv),
+      };
+    case WGPU_GLTF_VertexComponent_Color:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Unorm8x4,
+        .offset         = offsetof(gltf_quantized_vertex_t, color),
+      };
+    case WGPU_GLTF_VertexComponent_Tangent:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Snorm16x4,
+        .offset         = offsetof(gltf_quantized_vertex_t, tangent),
+      };
+    case WGPU_GLTF_VertexComponent_Joint0:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Uint8x4,
+        .offset         = offsetof(gltf_quantized_vertex_t, joint0),
+      };
+    case WGPU_GLTF_VertexComponent_Weight0:
+      return (WGPUVertexAttribute){
+        .shaderLocation = shader_location,
+        .format         = WGPUVertexFormat_Unorm8x4,
+        .offset         = offsetof(gltf_quantized_vertex_t, weight0),
+      };
+    default:
+      return (WGPUVertexAttribute){0};
+  }
+}
+
+
+WGPUVertexAttribute wgpu_gltf_get_vertex_format_attribute_description(
+  wgpu_gltf_vertex_format_enum_t format, uint32_t shader_location,
+  wgpu_gltf_vertex_component_enum_t component)
+{
+  return (format == WGPU_GLTF_VertexFormat_Quantized) ?
+           gltf_get_quantized_vertex_attribute_description(shader_location,
+                                                           component) :
+           gltf_get_default_vertex_attribute_description(shader_location,
+                                                         component);
+}
+
+WGPUVertexAttribute wgpu_gltf_get_vertex_attribute_description(
+  uint32_t shader_location, wgpu_gltf_vertex_component_enum_t component)
+{
+  return gltf_get_default_vertex_attribute_description(shader_location,
+                                                       component);
+}
+
 uint64_t wgpu_gltf_get_vertex_size()
 {
   return sizeof(gltf_vertex_t);
 }
 
+uint64_t wgpu_gltf_get_vertex_format_size(wgpu_gltf_vertex_format_enum_t format)
+{
+  return (format == WGPU_GLTF_VertexFormat_Quantized) ?
+           sizeof(gltf_quantized_vertex_t) :
+           sizeof(gltf_vertex_t);
+}
+
+static int16_t gltf_quantize_snorm16(float value)
+{
+  return (int16_t)roundf(glm_clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static uint8_t gltf_quantize_unorm8(float value)
+{
+  return (uint8_t)roundf(glm_clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+/* Float to half float conversion, rounds to nearest */
+static uint16_t gltf_quantize_half(float value)
+{
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = value};
+
+  const uint32_t sign     = (bits.u >> 16) & 0x8000u;
+  const int32_t exponent  = (int32_t)((bits.u >> 23) & 0xFFu) - 127 + 15;
+  const uint32_t mantissa = bits.u & 0x7FFFFFu;
+  if (((bits.u >> 23) & 0xFFu) == 0xFFu) {
+    /* Infinity or NaN */
+    return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+  }
+  if (exponent >= 31) {
+    /* Overflow, infinity */
+    return (uint16_t)(sign | 0x7C00u);
+  }
+  if (exponent <= 0) {
+    /* Denormal or zero */
+    if (exponent < -10) {
+      return (uint16_t)sign;
+    }
+    const uint32_t shift = (uint32_t)(14 - exponent);
+    return (uint16_t)(sign
+                      | (((mantissa | 0x800000u) + (1u << (shift - 1)))
+                         >> shift));
+  }
+  /* The rounding may carry into the exponent */
+  return (uint16_t)(sign
+                    | ((((uint32_t)exponent << 10) | (mantissa >> 13))
+                       + ((mantissa >> 12) & 1u)));
+}
+
+static void gltf_quantize_vertex(const gltf_vertex_t* vertex,
+                                 gltf_quantized_vertex_t* dest)
+{
+  memcpy(dest->pos, vertex->pos, sizeof(dest->pos));
+  for (uint32_t i = 0; i < 3; ++i) {
+    dest->normal[i] = gltf_quantize_snorm16(vertex->normal[i]);
+  }
+  dest->normal[3] = 0;
+  dest->uv[0]     = gltf_quantize_half(vertex->uv[0]);
+  dest->uv[1]     = gltf_quantize_half(vertex->uv[1]);
+  for (uint32_t i = 0; i < 4; ++i) {
+    dest->color[i]   = gltf_quantize_unorm8(vertex->color[i]);
+    dest->joint0[i]  = (uint8_t)MIN(vertex->joint0[i], 255.0f);
+    dest->tangent[i] = gltf_quantize_snorm16(vertex->tangent[i]);
+  }
+  /* Keep the sum of the weights at 1.0, the rounding error is added to the
+   * largest weight */
+  int32_t weight_sum = 0;
+  uint32_t max_index = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    dest->weight0[i] = gltf_quantize_unorm8(vertex->weight0[i]);
+    weight_sum += dest->weight0[i];
+    if (dest->weight0[i] > dest->weight0[max_index]) {
+      max_index = i;
+    }
+  }
+  if (weight_sum > 0) {
+    const int32_t weight     = dest->weight0[max_index] + 255 - weight_sum;
+    dest->weight0[max_index] = (uint8_t)MAX(MIN(weight, 255), 0);
+  }
+}
+
+/*
+ * Converts the vertices into the quantized vertex format, the returned array
+ * has to be freed by the caller
+ */
+static gltf_quantized_vertex_t*
+gltf_quantize_vertices(const gltf_vertex_t* vertices, uint32_t vertex_count)
+{
+  gltf_quantized_vertex_t* quantized_vertices
+    = (gltf_quantized_vertex_t*)malloc(vertex_count
+                                       * sizeof(gltf_quantized_vertex_t));
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    gltf_quantize_vertex(&vertices[i], &quantized_vertices[i]);
+  }
+  return quantized_vertices;
+}
+
 /*
  * glTF model loading and rendering class
  */
@@ -636,11 +1165,20 @@ typedef struct gltf_model_t {
   struct {
     WGPUBuffer buffer;
     uint32_t count;
+    wgpu_gltf_vertex_format_enum_t format;
   } vertices;
   struct {
     WGPUBuffer buffer;
     uint32_t count;
+    uint32_t lod_start; /* first index of the generated levels of detail */
   } indices;
+  /* 16-bit indices of WGPU_GLTF_FileLoadingFlags_CompactIndices */
+  struct {
+    bool enabled;
+    WGPUBuffer buffer;
+    uint32_t count;
+    WGPUIndexFormat bound_format; /* format of the index buffer bound by draw */
+  } compact_indices;
 
   mat4 aabb;
 
@@ -650,6 +1188,9 @@ typedef struct gltf_model_t {
   gltf_node_t** linear_nodes;
   uint32_t linear_node_count;
 
+  /* Nodes sorted topologically, parents are stored before their children */
+  gltf_node_t** sorted_nodes;
+
   gltf_skin_t* skins;
   uint32_t skin_count;
 
@@ -667,6 +1208,106 @@ typedef struct gltf_model_t {
   gltf_mesh_t* meshes;
   uint32_t mesh_count;
 
+  /* Uniform blocks of all meshes, packed into a single uniform buffer, the
+   * data is the shadow copy of the buffer */
+  struct {
+    wgpu_buffer_t buffer;
+    uint8_t* data;
+    uint64_t stride;
+    uint64_t size;
+  } mesh_uniforms;
+
+  /* Joint matrices of all skins, packed into a single storage buffer, the
+   * data is the shadow copy of the buffer */
+  struct {
+    wgpu_buffer_t buffer;
+    uint8_t* data;
+    uint64_t size;
+  } joint_palette;
+
+  /* Compute skinning pre-pass, see wgpu_gltf_model_compute_skinning() */
+  struct {
+    bool enabled;
+    WGPUBuffer vertex_buffer; /* skinned vertices, used for drawing */
+    WGPUBuffer job_buffer;
+    uint32_t* job_vertex_counts;
+    uint32_t job_count;
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUBindGroup bind_group;
+    WGPUPipelineLayout pipeline_layout;
+    WGPUComputePipeline pipeline;
+  } compute_skinning;
+
+  /* Meshlet culling pre-pass, see wgpu_gltf_model_cull_meshlets() */
+  struct {
+    bool enabled;
+    uint32_t meshlet_count;
+    WGPUBuffer meshlet_buffer;
+    WGPUBuffer draw_buffer;       /* indirect draw arguments per primitive */
+    WGPUBuffer draw_reset_buffer; /* draw arguments without indices */
+    uint64_t draw_buffer_size;
+    WGPUBuffer index_buffer; /* indices of the visible meshlets */
+    WGPUBuffer params_buffer;
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUBindGroup bind_group;
+    WGPUPipelineLayout pipeline_layout;
+    WGPUComputePipeline pipeline;
+    /* Variant with Hi-Z occlusion culling, created with its first use */
+    WGPUPipelineLayout hiz_pipeline_layout;
+    WGPUComputePipeline hiz_pipeline;
+  } meshlet_culling;
+
+  /* Storage buffer bindings of the vertices and indices for vertex pulling */
+  struct {
+    bool enabled;
+    WGPUBindGroup bind_group;
+  } vertex_pulling;
+
+  /* Texture arrays of WGPU_GLTF_FileLoadingFlags_PackTextures */
+  struct {
+    bool enabled;
+    texture_t arrays[WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT];
+    uint32_t array_count;
+    WGPUBuffer material_buffer; /* packed layers of all materials */
+    uint64_t material_stride;
+    WGPUBindGroup bind_group;
+  } packed_textures;
+
+  /* Parameters of all materials of WGPU_GLTF_FileLoadingFlags_MaterialTable */
+  struct {
+    bool enabled;
+    WGPUBuffer buffer;
+    WGPUBindGroup bind_group;
+  } material_table;
+
+  /* Morph targets, blended by the compute skinning pass. The weights are the
+   * shadow copy of the weight buffer, the deltas are uploaded once. */
+  struct {
+    bool enabled;
+    uint32_t delta_count; /* vec4 */
+    WGPUBuffer delta_buffer;
+    float* weights;
+    uint32_t weight_count;
+    wgpu_buffer_t weight_buffer;
+  } morph_targets;
+
+  /* World matrices of all mesh instances of
+   * WGPU_GLTF_FileLoadingFlags_MeshInstancing, the matrices are the shadow
+   * copy of the buffer */
+  struct {
+    bool enabled;
+    wgpu_buffer_t buffer;
+    mat4* matrices;
+    uint32_t count;
+    WGPUBindGroup bind_group;
+  } instancing;
+
+  /* Triangle soup of WGPU_GLTF_FileLoadingFlags_RetainTriangles */
+  struct {
+    float* positions; /* 9 floats per triangle */
+    uint32_t count;
+  } triangles;
+
   gltf_animation_t* animations;
   uint32_t animation_count;
 
@@ -676,9 +1317,16 @@ typedef struct gltf_model_t {
   } dimensions;
 
   bool buffers_bound;
+  bool pre_transformed; /* the primitive bounds are in model space */
   char path[STRMAX];
 } gltf_model_t;
 
+static uint32_t gltf_model_get_material_index(gltf_model_t* model,
+                                              const gltf_material_t* material)
+{
+  return (uint32_t)(material - model->materials);
+}
+
 /*
  * In this WebGPU glTF model, each texture is represented by a single image,
  * therefore WebGPU texture = glTF image. This function maps a glTF texture to a
@@ -697,10 +1345,8 @@ static gltf_texture_t* gltf_model_get_texture(gltf_model_t* model,
 
 static void gltf_model_create_empty_texture(gltf_model_t* model)
 {
-  gltf_texture_t* empty_texture = calloc(1, sizeof(gltf_texture_t));
-  model->empty_texture          = empty_texture;
-  empty_texture->wgpu_context   = model->wgpu_context;
-  empty_texture->wgpu_texture = wgpu_create_empty_texture(model->wgpu_context);
+  model->empty_texture->wgpu_texture
+    = wgpu_create_empty_texture(model->wgpu_context);
 }
 
 /*
@@ -721,6 +1367,8 @@ static void gltf_model_init(gltf_model_t* model,
   model->linear_nodes      = NULL;
   model->linear_node_count = 0;
 
+  model->sorted_nodes = NULL;
+
   model->skins      = NULL;
   model->skin_count = 0;
 
@@ -738,6 +1386,88 @@ static void gltf_model_init(gltf_model_t* model,
   model->meshes     = NULL;
   model->mesh_count = 0;
 
+  memset(&model->mesh_uniforms, 0, sizeof(model->mesh_uniforms));
+  memset(&model->joint_palette, 0, sizeof(model->joint_palette));
+  memset(&model->compute_skinning, 0, sizeof(model->compute_skinning));
+  memset(&model->meshlet_culling, 0, sizeof(model->meshlet_culling));
+  memset(&model->vertex_pulling, 0, sizeof(model->vertex_pulling));
+  memset(&model->packed_textures, 0, sizeof(model->packed_textures));
+  memset(&model->material_table, 0, sizeof(model->material_table));
+  memset(&model->instancing, 0, sizeof(model->instancing));
+  memset(&model->morph_targets, 0, sizeof(model->morph_targets));
+  memset(&model->triangles, 0, sizeof(model->triangles));
+  memset(&model->compact_indices, 0, sizeof(model->compact_indices));
+  model->vertex_pulling.enabled
+    = (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_VertexPulling)
+      != 0;
+  model->packed_textures.enabled
+    = (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_PackTextures)
+      != 0;
+  model->material_table.enabled
+    = (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_MaterialTable)
+      != 0;
+  model->meshlet_culling.enabled
+    = (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_MeshletCulling)
+      != 0;
+  model->pre_transformed
+    = (options->file_loading_flags
+       & WGPU_GLTF_FileLoadingFlags_PreTransformVertices)
+      != 0;
+  model->compute_skinning.enabled
+    = (options->file_loading_flags
+       & WGPU_GLTF_FileLoadingFlags_ComputeSkinning)
+      != 0;
+
+  // The meshlet culling pass and pulled vertex shaders read 32-bit indices
+  if (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_CompactIndices) {
+    if (model->meshlet_culling.enabled || model->vertex_pulling.enabled) {
+      log_warn("Meshlet culling and vertex pulling require 32-bit indices, "
+               "indices are not compacted\n");
+    }
+    else {
+      model->compact_indices.enabled = true;
+    }
+  }
+
+  // The instance matrices are in world space, the material table and the
+  // indirect draws of culled meshlets use the first instance otherwise
+  if (options->file_loading_flags & WGPU_GLTF_FileLoadingFlags_MeshInstancing) {
+    if (model->pre_transformed || model->material_table.enabled
+        || model->meshlet_culling.enabled) {
+      log_warn("Mesh instancing is not supported with pre-transformed "
+               "vertices, the material table and meshlet culling, meshes are "
+               "not instanced\n");
+    }
+    else {
+      model->instancing.enabled = true;
+    }
+  }
+
+  // The morph targets are blended by the compute skinning pass, before the
+  // vertices would be pre-transformed
+  if (model->compute_skinning.enabled) {
+    if (model->pre_transformed) {
+      log_warn("Morph targets are not supported with pre-transformed "
+               "vertices, morph targets are ignored\n");
+    }
+    else {
+      model->morph_targets.enabled = true;
+    }
+  }
+
+  // The compute skinning shader reads the default vertex format
+  model->vertices.format = WGPU_GLTF_VertexFormat_Default;
+  if (options->file_loading_flags
+      & WGPU_GLTF_FileLoadingFlags_QuantizeVertices) {
+    if (model->compute_skinning.enabled) {
+      log_warn("Compute skinning requires the default vertex format, "
+               "vertices are not quantized\n");
+    }
+    else {
+      model->vertices.format = WGPU_GLTF_VertexFormat_Quantized;
+    }
+  }
+
   model->animations      = NULL;
   model->animation_count = 0;
 
@@ -756,12 +1486,15 @@ void wgpu_gltf_model_destroy(gltf_model_t* model)
 
   WGPU_RELEASE_RESOURCE(Buffer, model->vertices.buffer);
   WGPU_RELEASE_RESOURCE(Buffer, model->indices.buffer);
+  WGPU_RELEASE_RESOURCE(Buffer, model->compact_indices.buffer);
 
   if (model->skin_count > 0) {
     for (uint32_t i = 0; i < model->skin_count; ++i) {
       if (model->skins[i].joint_count > 0) {
         free(model->skins[i].joints);
+        free(model->skins[i].inverse_bind_matrices);
       }
+      WGPU_RELEASE_RESOURCE(BindGroup, model->skins[i].ssbo.bind_group);
     }
     free(model->skins);
   }
@@ -780,11 +1513,44 @@ void wgpu_gltf_model_destroy(gltf_model_t* model)
   }
   free(model->meshes);
 
+  if (model->mesh_uniforms.buffer.buffer != NULL) {
+    wgpu_destroy_buffer(&model->mesh_uniforms.buffer);
+  }
+  free(model->mesh_uniforms.data);
+
+  if (model->joint_palette.buffer.buffer != NULL) {
+    wgpu_destroy_buffer(&model->joint_palette.buffer);
+  }
+  free(model->joint_palette.data);
+
+  gltf_model_release_compute_skinning(model);
+  gltf_model_release_meshlet_culling(model);
+  WGPU_RELEASE_RESOURCE(BindGroup, model->vertex_pulling.bind_group)
+  for (uint32_t i = 0; i < model->packed_textures.array_count; ++i) {
+    wgpu_destroy_texture(&model->packed_textures.arrays[i]);
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, model->packed_textures.material_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, model->packed_textures.bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, model->material_table.buffer)
+  WGPU_RELEASE_RESOURCE(BindGroup, model->material_table.bind_group)
+  if (model->instancing.buffer.buffer != NULL) {
+    wgpu_destroy_buffer(&model->instancing.buffer);
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, model->morph_targets.delta_buffer)
+  if (model->morph_targets.weight_buffer.buffer != NULL) {
+    wgpu_destroy_buffer(&model->morph_targets.weight_buffer);
+  }
+  free(model->morph_targets.weights);
+  free(model->instancing.matrices);
+  WGPU_RELEASE_RESOURCE(BindGroup, model->instancing.bind_group)
+  free(model->triangles.positions);
+
   for (uint32_t i = 0; i < model->node_count; ++i) {
     gltf_node_destroy(&model->nodes[i]);
   }
   free(model->nodes);
   free(model->linear_nodes);
+  free(model->sorted_nodes);
 
   gltf_texture_destroy(model->empty_texture);
   free(model->empty_texture);
@@ -797,382 +1563,2180 @@ void wgpu_gltf_model_destroy(gltf_model_t* model)
   free(model);
 }
 
-static void gltf_model_load_node(gltf_model_t* model, cgltf_node* parent,
-                                 cgltf_node* node, cgltf_data* data,
-                                 gltf_vertex_t** vertices,
-                                 uint32_t* vertex_count, uint32_t** indices,
-                                 uint32_t* index_count, float global_scale)
+/*
+ * Allocate the CPU copy of the uniform blocks of all meshes. The blocks are
+ * aligned to the minimum uniform buffer offset alignment, so every mesh can
+ * bind its range of the shared buffer.
+ */
+static void gltf_model_init_mesh_uniforms(gltf_model_t* model)
 {
-  gltf_node_t* new_node = &model->nodes[node - data->nodes];
-  gltf_node_init(new_node);
-  new_node->index = (int32_t)(node - data->nodes);
-  if (node->name) {
-    snprintf(new_node->name, strlen(node->name) + 1, "%s", node->name);
-  }
-  new_node->skin_index  = (int32_t)(node->skin - data->skins);
-  new_node->children    = calloc(node->children_count, sizeof(gltf_node_t*));
-  new_node->child_count = node->children_count;
+  model->mesh_uniforms.stride = gltf_align_size(
+    sizeof(gltf_mesh_uniform_block_t), WGPU_GLTF_UNIFORM_OFFSET_ALIGNMENT);
+  model->mesh_uniforms.size = model->mesh_count * model->mesh_uniforms.stride;
+  model->mesh_uniforms.data
+    = model->mesh_uniforms.size > 0 ?
+        (uint8_t*)calloc(1, model->mesh_uniforms.size) :
+        NULL;
+}
 
-  // Generate local node matrix
-  // It's either made up from translation, rotation, scale or a 4x4 matrix
-  if (node->has_translation) {
-    glm_vec3_copy(node->translation, new_node->translation);
-  }
-  if (node->has_rotation) {
-    versor q = GLM_VEC4_ONE_INIT;
-    memcpy(q, node->rotation, sizeof(node->rotation));
-    glm_quat_copy(q, new_node->rotation);
+static void gltf_model_create_mesh_uniform_buffer(gltf_model_t* model)
+{
+  if (model->mesh_uniforms.size == 0) {
+    return;
   }
-  if (node->has_scale) {
-    glm_vec3_copy(node->scale, new_node->scale);
+  // The meshlet culling shader reads the mesh matrices
+  const WGPUBufferUsage usage
+    = model->meshlet_culling.enabled ?
+        WGPUBufferUsage_Uniform | WGPUBufferUsage_Storage :
+        WGPUBufferUsage_Uniform;
+  model->mesh_uniforms.buffer = wgpu_create_buffer(
+    model->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label        = "glTF mesh uniforms",
+      .usage        = WGPUBufferUsage_CopyDst | usage,
+      .size         = (uint32_t)model->mesh_uniforms.size,
+      .initial.data = model->mesh_uniforms.data,
+      .shadow       = {
+        .enabled = true,
+        .data    = model->mesh_uniforms.data,
+      },
+    });
+}
+
+/*
+ * Upload the uniform blocks of the updated meshes, only the changed ranges are
+ * written
+ */
+static void gltf_model_write_mesh_uniforms(gltf_model_t* model)
+{
+  if (model->mesh_uniforms.buffer.buffer == NULL) {
+    return;
   }
-  if (node->has_matrix) {
-    memcpy(new_node->matrix, node->matrix, sizeof(node->matrix));
-    if (global_scale != 1.0f) {
-      // Not support yet
+  for (uint32_t i = 0; i < model->mesh_count; ++i) {
+    gltf_mesh_t* mesh = &model->meshes[i];
+    if (mesh->uniform_buffer.dirty) {
+      wgpu_buffer_mark_dirty(&model->mesh_uniforms.buffer,
+                             (uint32_t)mesh->uniform_buffer.offset,
+                             (uint32_t)mesh->uniform_buffer.size);
+      mesh->uniform_buffer.dirty = false;
     }
   }
+  wgpu_buffer_flush(model->wgpu_context, &model->mesh_uniforms.buffer);
+}
 
-  // Node with children
-  if (node->children_count > 0) {
-    for (cgltf_size i = 0, len = node->children_count; i < len; ++i) {
-      gltf_model_load_node(model, node, node->children[i], data, vertices,
-                           vertex_count, indices, index_count, global_scale);
-    }
+/*
+ * Allocate the joint palette of all skins. Every skin binds its range of the
+ * palette, the ranges are aligned to the minimum storage buffer offset
+ * alignment.
+ */
+static void gltf_model_init_joint_palette(gltf_model_t* model)
+{
+  uint64_t size = 0;
+  for (uint32_t i = 0; i < model->skin_count; ++i) {
+    gltf_skin_t* skin = &model->skins[i];
+    skin->ssbo.offset = size;
+    skin->ssbo.size   = MAX(skin->joint_count, 1u) * sizeof(mat4);
+    size += gltf_align_size(skin->ssbo.size,
+                            WGPU_GLTF_STORAGE_OFFSET_ALIGNMENT);
+  }
+  // The compute skinning pass binds the palette for morphed meshes as well
+  if (size == 0 && model->morph_targets.weight_count > 0) {
+    size = sizeof(mat4);
+  }
+  model->joint_palette.size = size;
+  if (size == 0) {
+    return;
   }
 
-  // If the node contains mesh data, we load vertices and indices from the
-  // buffers. In glTF this is done via accessors and buffer views.
-  if (node->mesh != NULL) {
-    cgltf_mesh* mesh      = node->mesh;
-    gltf_mesh_t* new_mesh = &model->meshes[node->mesh - data->meshes];
-    gltf_mesh_init(new_mesh, model->wgpu_context, new_node->matrix);
-    if (mesh->name) {
-      snprintf(new_mesh->name, strlen(mesh->name) + 1, "%s", mesh->name);
+  model->joint_palette.data = (uint8_t*)calloc(1, size);
+  for (uint32_t i = 0; i < model->skin_count; ++i) {
+    gltf_skin_t* skin = &model->skins[i];
+    skin->joint_matrices
+      = (mat4*)(model->joint_palette.data + skin->ssbo.offset);
+    for (uint32_t j = 0; j < skin->joint_count; ++j) {
+      glm_mat4_identity(skin->joint_matrices[j]);
     }
+  }
+}
 
-    new_mesh->primitive_count = (uint32_t)mesh->primitives_count;
-    new_mesh->primitives
-      = mesh->primitives_count > 0 ?
-          calloc(new_mesh->primitive_count, sizeof(*new_mesh->primitives)) :
-          NULL;
-
-    // Iterate through all primitives of this node's mesh
-    for (uint32_t i = 0; i < mesh->primitives_count; ++i) {
-      cgltf_primitive* primitive = &mesh->primitives[i];
-      if (primitive->indices == NULL) {
-        continue;
-      }
-      uint32_t index_start       = *index_count;
-      uint32_t vertex_start      = *vertex_count;
-      uint32_t prim_index_count  = 0;
-      uint32_t prim_vertex_count = 0;
-      vec3 pos_min               = GLM_VEC3_ZERO_INIT;
-      vec3 pos_max               = GLM_VEC3_ZERO_INIT;
-      bool has_skin              = false;
+static void gltf_model_create_joint_palette_buffer(gltf_model_t* model)
+{
+  if (model->joint_palette.size == 0) {
+    return;
+  }
+  model->joint_palette.buffer = wgpu_create_buffer(
+    model->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label        = "glTF joint palette",
+      .usage        = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+      .size         = (uint32_t)model->joint_palette.size,
+      .initial.data = model->joint_palette.data,
+      .shadow       = {
+        .enabled = true,
+        .data    = model->joint_palette.data,
+      },
+    });
+}
 
-      // Vertices
-      {
-        const float* buffer_pos       = NULL;
-        const float* buffer_normals   = NULL;
-        const float* buffer_texcoords = NULL;
-        const float* buffer_colors    = NULL;
-        const float* buffer_tangents  = NULL;
-        uint32_t num_color_components = 0;
-        const uint16_t* buffer_joints = NULL;
-        const float* buffer_weights   = NULL;
-
-        cgltf_accessor* pos_accessor = NULL;
-
-        for (uint32_t j = 0; j < primitive->attributes_count; ++j) {
-          // Get buffer data for vertex normals
-          if (primitive->attributes[j].type == cgltf_attribute_type_position) {
-            pos_accessor                = primitive->attributes[j].data;
-            cgltf_buffer_view* pos_view = pos_accessor->buffer_view;
-            buffer_pos
-              = (float*)&((unsigned char*)pos_view->buffer
-                            ->data)[pos_accessor->offset + pos_view->offset];
-            if (pos_accessor->has_min) {
-              glm_vec3_copy(
-                (vec3){
-                  pos_accessor->min[0],
-                  pos_accessor->min[1],
-                  pos_accessor->min[2],
-                },
-                pos_min);
-            }
-            if (pos_accessor->has_max) {
-              glm_vec3_copy(
-                (vec3){
-                  pos_accessor->max[0],
-                  pos_accessor->max[1],
-                  pos_accessor->max[2],
-                },
-                pos_max);
-            }
-          }
-          // Get buffer data for vertex normals
-          if (primitive->attributes[j].type == cgltf_attribute_type_normal) {
-            cgltf_accessor* normal_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* normal_view  = normal_accessor->buffer_view;
-            buffer_normals                  = (float*)&(
-              (unsigned char*)normal_view->buffer
-                ->data)[normal_accessor->offset + normal_view->offset];
-          }
-          // Get buffer data for vertex texture coordinates
-          if (primitive->attributes[j].type == cgltf_attribute_type_texcoord) {
-            cgltf_accessor* texcoord_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* texcoord_view  = texcoord_accessor->buffer_view;
-            buffer_texcoords                  = (float*)&(
-              ((unsigned char*)texcoord_view->buffer
-                 ->data)[texcoord_accessor->offset + texcoord_view->offset]);
-          }
-          // Get buffer data for vertex colors
-          if (primitive->attributes[j].type == cgltf_attribute_type_color) {
-            cgltf_accessor* color_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* color_view  = color_accessor->buffer_view;
-            // Color buffer are either of type vec3 or vec4
-            num_color_components
-              = color_accessor->type == cgltf_type_vec3 ? 3 : 4;
-            buffer_colors = (float*)&(
-              ((unsigned char*)color_view->buffer
-                 ->data)[color_accessor->offset + color_view->offset]);
-          }
-          // Get buffer data for vertex tangents
-          if (primitive->attributes[j].type == cgltf_attribute_type_tangent) {
-            cgltf_accessor* tangent_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* tangent_view  = tangent_accessor->buffer_view;
-            buffer_tangents                  = (float*)&(
-              ((unsigned char*)tangent_view->buffer
-                 ->data)[tangent_accessor->offset + tangent_view->offset]);
-          }
+/*
+ * Upload the joint matrices of the updated skins, only the changed ranges are
+ * written
+ */
+static void gltf_model_write_joint_palette(gltf_model_t* model)
+{
+  if (model->joint_palette.buffer.buffer == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < model->skin_count; ++i) {
+    gltf_skin_t* skin = &model->skins[i];
+    if (skin->ssbo.dirty) {
+      wgpu_buffer_mark_dirty(&model->joint_palette.buffer,
+                             (uint32_t)skin->ssbo.offset,
+                             (uint32_t)skin->ssbo.size);
+      skin->ssbo.dirty = false;
+    }
+  }
+  wgpu_buffer_flush(model->wgpu_context, &model->joint_palette.buffer);
+}
 
-          // Skinning
-          // Get vertex joint indices
-          if (primitive->attributes[j].type == cgltf_attribute_type_joints) {
-            cgltf_accessor* joint_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* joint_view  = joint_accessor->buffer_view;
-            buffer_joints                  = (uint16_t*)&(
-              ((unsigned char*)joint_view->buffer
-                 ->data)[joint_accessor->offset + joint_view->offset]);
-          }
-          // Get vertex joint weights
-          if (primitive->attributes[j].type == cgltf_attribute_type_weights) {
-            cgltf_accessor* weight_accessor = primitive->attributes[j].data;
-            cgltf_buffer_view* weight_view  = weight_accessor->buffer_view;
-            buffer_weights                  = (float*)&(
-              ((unsigned char*)weight_view->buffer
-                 ->data)[weight_accessor->offset + weight_view->offset]);
-          }
-        }
+/*
+ * Morph targets
+ *
+ * Reserve the weight range of a mesh, the weights are initialized with the
+ * default weights of the mesh
+ */
+static void gltf_model_init_mesh_weights(gltf_model_t* model,
+                                         gltf_mesh_t* mesh,
+                                         const cgltf_mesh* data)
+{
+  mesh->weights.first = model->morph_targets.weight_count;
+  mesh->weights.dirty = false;
+  if (mesh->weights.count == 0) {
+    return;
+  }
+  model->morph_targets.weight_count += mesh->weights.count;
+  model->morph_targets.weights
+    = realloc(model->morph_targets.weights,
+              model->morph_targets.weight_count * sizeof(float));
+  float* weights = &model->morph_targets.weights[mesh->weights.first];
+  for (uint32_t i = 0; i < mesh->weights.count; ++i) {
+    weights[i] = i < data->weights_count ? data->weights[i] : 0.0f;
+  }
+}
 
-        has_skin = (buffer_joints != NULL && buffer_weights != NULL);
+/*
+ * Create the delta buffer and the weight buffer, empty buffers hold one
+ * element since they are always bound by the compute skinning pass
+ */
+static void gltf_model_create_morph_target_buffers(gltf_model_t* model,
+                                                   const vec4* deltas)
+{
+  if (!model->morph_targets.enabled) {
+    return;
+  }
+  model->morph_targets.delta_buffer = wgpu_create_buffer_from_data(
+    model->wgpu_context, deltas,
+    MAX(model->morph_targets.delta_count, 1u) * sizeof(vec4),
+    WGPUBufferUsage_Storage);
 
-        // Position attribute is required
-        ASSERT(pos_accessor != NULL);
+  if (model->morph_targets.weight_count == 0) {
+    model->morph_targets.weights = calloc(1, sizeof(float));
+  }
+  const uint32_t weight_buffer_size
+    = MAX(model->morph_targets.weight_count, 1u) * (uint32_t)sizeof(float);
+  model->morph_targets.weight_buffer = wgpu_create_buffer(
+    model->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label        = "glTF morph target weights",
+      .usage        = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+      .size         = weight_buffer_size,
+      .initial.data = model->morph_targets.weights,
+      .shadow       = {
+        .enabled = true,
+        .data    = model->morph_targets.weights,
+      },
+    });
+}
 
-        prim_vertex_count = (uint32_t)pos_accessor->count;
+/*
+ * Upload the weights of the meshes updated by the animations, only the changed
+ * ranges are written
+ */
+static void gltf_model_write_morph_weights(gltf_model_t* model)
+{
+  if (model->morph_targets.weight_buffer.buffer == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < model->mesh_count; ++i) {
+    gltf_mesh_t* mesh = &model->meshes[i];
+    if (mesh->weights.dirty) {
+      wgpu_buffer_mark_dirty(&model->morph_targets.weight_buffer,
+                             mesh->weights.first * (uint32_t)sizeof(float),
+                             mesh->weights.count * (uint32_t)sizeof(float));
+      mesh->weights.dirty = false;
+    }
+  }
+  wgpu_buffer_flush(model->wgpu_context, &model->morph_targets.weight_buffer);
+}
 
-        *vertex_count += prim_vertex_count;
-        *vertices = realloc(*vertices, (*vertex_count) * sizeof(gltf_vertex_t));
+/*
+ * Mesh instancing
+ *
+ * Assign the instance ranges, the instances of all nodes referencing a mesh
+ * are contiguous. The matrices are written by gltf_model_update_nodes().
+ */
+static void gltf_model_init_instances(gltf_model_t* model)
+{
+  if (!model->instancing.enabled) {
+    return;
+  }
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_t* node = model->linear_nodes[i];
+    if (node->mesh != NULL) {
+      node->mesh->instances.count += gltf_node_get_instance_count(node);
+    }
+  }
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < model->mesh_count; ++i) {
+    gltf_mesh_t* mesh     = &model->meshes[i];
+    mesh->instances.first = count;
+    count += mesh->instances.count;
+    mesh->instances.count = 0;
+  }
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_t* node = model->linear_nodes[i];
+    if (node->mesh != NULL) {
+      gltf_mesh_t* mesh    = node->mesh;
+      node->first_instance = mesh->instances.first + mesh->instances.count;
+      mesh->instances.count += gltf_node_get_instance_count(node);
+    }
+  }
+  model->instancing.count    = count;
+  model->instancing.matrices = calloc(MAX(count, 1u), sizeof(mat4));
+}
 
-        // Append data to model's vertex buffer
-        for (uint32_t v = 0; v < pos_accessor->count; ++v) {
-          gltf_vertex_t vert = {0};
-          memcpy(&vert.pos, &buffer_pos[v * 3], sizeof(vec3));
-          if (buffer_normals != NULL) {
-            memcpy(&vert.normal, &buffer_normals[v * 3], sizeof(vec3));
-          }
-          if (buffer_texcoords != NULL) {
-            memcpy(&vert.uv, &buffer_texcoords[v * 2], sizeof(vec2));
-          }
-          if (buffer_colors) {
-            switch (num_color_components) {
-              case 3: {
-                glm_vec4_one(vert.color);
-                vec3 tmp_vec3 = GLM_VEC3_ZERO_INIT;
-                memcpy(&tmp_vec3, &buffer_colors[v * 3], sizeof(vec3));
-                glm_vec4_copy3(tmp_vec3, vert.color);
-              } break;
-              case 4:
-                memcpy(&vert.color, &buffer_colors[v * 4], sizeof(vec4));
-                break;
-            }
-          }
-          else {
-            glm_vec4_one(vert.color);
-          }
-          if (buffer_tangents) {
-            memcpy(&vert.tangent, &buffer_tangents[v * 4], sizeof(vec4));
-          }
-          if (has_skin) {
-            uint16_t tmp_joint[4] = {0};
-            memcpy(&tmp_joint, &buffer_joints[v * 4], sizeof(tmp_joint));
-            glm_vec4_copy(
-              (vec4){tmp_joint[0], tmp_joint[1], tmp_joint[2], tmp_joint[3]},
-              vert.joint0);
-          }
-          if (has_skin) {
-            memcpy(&vert.weight0, &buffer_weights[v * 4], sizeof(vec4));
-          }
-          (*vertices)[(*vertex_count) - pos_accessor->count + v] = vert;
-        }
-      }
+/* Update the world matrices of the node's instances from its world matrix */
+static void gltf_model_update_node_instances(gltf_model_t* model,
+                                             gltf_node_t* node)
+{
+  mat4* matrices = &model->instancing.matrices[node->first_instance];
+  if (node->instance_matrices == NULL) {
+    glm_mat4_copy(node->world_matrix, matrices[0]);
+  }
+  else {
+    for (uint32_t i = 0; i < node->instance_count; ++i) {
+      glm_mat4_mul(node->world_matrix, node->instance_matrices[i],
+                   matrices[i]);
+    }
+  }
+  node->mesh->instances.dirty = true;
+}
 
-      // Indices
-      {
-        cgltf_accessor* accessor       = primitive->indices;
-        cgltf_buffer_view* buffer_view = accessor->buffer_view;
-        cgltf_buffer* buffer           = buffer_view->buffer;
-
-        prim_index_count = (uint32_t)accessor->count;
-
-        *index_count += prim_index_count;
-        *indices = realloc(*indices, (*index_count) * sizeof(**indices));
-
-        // glTF supports different component types of indices
-        switch (accessor->component_type) {
-          case cgltf_component_type_r_32u: {
-            uint32_t* buf = calloc(accessor->count, sizeof(*buf));
-            memcpy(buf,
-                   &((unsigned char*)
-                       buffer->data)[accessor->offset + buffer_view->offset],
-                   accessor->count * sizeof(*buf));
-            for (size_t index = 0; index < accessor->count; index++) {
-              (*indices)[(*index_count) - prim_index_count + index]
-                = buf[index] + vertex_start;
-            }
-            free(buf);
-            break;
-          }
-          case cgltf_component_type_r_16u: {
-            uint16_t* buf = calloc(accessor->count, sizeof(*buf));
-            memcpy(buf,
-                   &((unsigned char*)
-                       buffer->data)[accessor->offset + buffer_view->offset],
-                   accessor->count * sizeof(*buf));
-            for (size_t index = 0; index < accessor->count; index++) {
-              (*indices)[(*index_count) - prim_index_count + index]
-                = buf[index] + vertex_start;
-            }
-            free(buf);
-            break;
-          }
-          case cgltf_component_type_r_8u: {
-            uint8_t* buf = calloc(accessor->count, sizeof(*buf));
-            memcpy(buf,
-                   &((unsigned char*)
-                       buffer->data)[accessor->offset + buffer_view->offset],
-                   accessor->count * sizeof(*buf));
-            for (size_t index = 0; index < accessor->count; index++) {
-              (*indices)[(*index_count) - prim_index_count + index]
-                = buf[index] + vertex_start;
-            }
-            free(buf);
-            break;
-          }
-          default: {
-            assert(false);
-          }
-        }
-      }
-      gltf_primitive_t new_primitive = {0};
-      gltf_primitive_init(
-        &new_primitive, index_start, prim_index_count,
-        &model->materials[primitive->material - data->materials]);
-      new_primitive.first_vertex = vertex_start;
-      new_primitive.vertex_count = prim_vertex_count;
-      gltf_primitive_set_bounding_box(&new_primitive, pos_min, pos_max);
-      new_mesh->primitives[i] = new_primitive;
+/*
+ * Update the bounds of the meshes with moved instances and upload their
+ * instance ranges
+ */
+static void gltf_model_write_instances(gltf_model_t* model)
+{
+  if (!model->instancing.enabled) {
+    return;
+  }
+  for (uint32_t i = 0; i < model->mesh_count; ++i) {
+    gltf_mesh_t* mesh = &model->meshes[i];
+    if (!mesh->instances.dirty) {
+      continue;
     }
-    // Mesh BB from BBs of primitives
-    for (uint32_t pi = 0; pi < new_mesh->primitive_count; ++pi) {
-      gltf_primitive_t* p = &new_mesh->primitives[pi];
-      if (p->bb.valid && !new_mesh->bb.valid) {
-        memcpy(&new_mesh->bb, &p->bb, sizeof(p->bb));
-        new_mesh->bb.valid = true;
+    mesh->instances.bb.valid = false;
+    for (uint32_t j = 0; mesh->bb.valid && j < mesh->instances.count; ++j) {
+      bounding_box_t bb;
+      bounding_get_aabb(&mesh->bb,
+                        model->instancing.matrices[mesh->instances.first + j],
+                        &bb);
+      if (!mesh->instances.bb.valid) {
+        mesh->instances.bb = bb;
       }
-      glm_vec3_copy(*vec3_min(&new_mesh->bb.min, &p->bb.min), new_mesh->bb.min);
-      glm_vec3_copy(*vec3_min(&new_mesh->bb.max, &p->bb.max), new_mesh->bb.max);
+      glm_vec3_minv(mesh->instances.bb.min, bb.min, mesh->instances.bb.min);
+      glm_vec3_maxv(mesh->instances.bb.max, bb.max, mesh->instances.bb.max);
     }
-    if (node->mesh != NULL) {
-      new_node->mesh = &model->meshes[node->mesh - data->meshes];
+    if (model->instancing.buffer.buffer != NULL
+        && mesh->instances.count > 0) {
+      wgpu_buffer_mark_dirty(&model->instancing.buffer,
+                             mesh->instances.first * (uint32_t)sizeof(mat4),
+                             mesh->instances.count * (uint32_t)sizeof(mat4));
     }
+    mesh->instances.dirty = false;
   }
-  if (parent != NULL) {
-    new_node->parent = &model->nodes[parent - data->nodes];
-    new_node->parent->children[new_node->parent->current_child_index++]
-      = new_node;
+  if (model->instancing.buffer.buffer != NULL) {
+    wgpu_buffer_flush(model->wgpu_context, &model->instancing.buffer);
   }
-  model->linear_nodes[model->linear_node_count++] = new_node;
 }
 
-static void gltf_model_load_skins(gltf_model_t* model, cgltf_data* data)
+static void gltf_model_create_instance_buffer(gltf_model_t* model)
 {
-  model->skin_count = (uint32_t)data->skins_count;
-  model->skins      = model->skin_count > 0 ?
-                        calloc(model->skin_count, sizeof(*model->skins)) :
-                        NULL;
-  for (uint32_t i = 0; i < model->skin_count; ++i) {
-    cgltf_skin* skin      = &data->skins[i];
-    gltf_skin_t* new_skin = &model->skins[i];
-    snprintf(new_skin->name, strlen(skin->name) + 1, "%s", skin->name);
+  const uint32_t size = MAX(model->instancing.count, 1u) * sizeof(mat4);
+  model->instancing.buffer = wgpu_create_buffer(
+    model->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label        = "glTF instance matrices",
+      .usage        = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+      .size         = size,
+      .initial.data = model->instancing.matrices,
+      .shadow       = {
+        .enabled = true,
+        .data    = model->instancing.matrices,
+      },
+    });
+}
 
-    // Find the root node of the skeleton
-    if (skin->skeleton != NULL) {
-      new_skin->skeleton_root
-        = gltf_model_node_from_index(model, skin->skeleton - data->nodes);
+/*
+ * Compute skinning
+ */
+typedef struct gltf_skinning_job_t {
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  uint32_t joint_offset; /* first joint matrix of the skin in the palette */
+  uint32_t joint_count;  /* 0 = morph targets only */
+  uint32_t first_morph_delta;
+  uint32_t morph_target_count;
+  uint32_t first_weight; /* first morph target weight of the mesh */
+  uint32_t padding;
+} gltf_skinning_job_t;
+
+// clang-format off
+static const char* gltf_compute_skinning_shader_wgsl = CODE(
+  struct SkinningJob {
+    firstVertex : u32,
+    vertexCount : u32,
+    jointOffset : u32,
+    jointCount : u32,
+    firstMorphDelta : u32,
+    morphTargetCount : u32,
+    firstWeight : u32,
+    padding : u32,
+  }
+
+  @group(0) @binding(0) var<storage, read> inVertices : array<f32>;
+  @group(0) @binding(1) var<storage, read_write> outVertices : array<f32>;
+  @group(0) @binding(2) var<storage, read> jointMatrices : array<mat4x4<f32>>;
+  @group(0) @binding(3) var<uniform> job : SkinningJob;
+  // Position, normal and tangent delta per vertex of every morph target
+  @group(0) @binding(4) var<storage, read> morphDeltas : array<vec4<f32>>;
+  @group(0) @binding(5) var<storage, read> morphWeights : array<f32>;
+
+  // gltf_vertex_t: pos(3), normal(3), uv(2), color(4), joint0(4), weight0(4),
+  // tangent(4)
+  fn vertexStride() -> u32 {
+    return 24u;
+  }
+
+  fn readVec4(base : u32) -> vec4<f32> {
+    return vec4<f32>(inVertices[base], inVertices[base + 1u],
+                     inVertices[base + 2u], inVertices[base + 3u]);
+  }
+
+  fn jointMatrix(joint : f32) -> mat4x4<f32> {
+    let index = min(u32(joint), job.jointCount - 1u);
+    return jointMatrices[job.jointOffset + index];
+  }
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x >= job.vertexCount) {
+      return;
+    }
+    let base = (job.firstVertex + global_id.x) * vertexStride();
+    for (var i = 0u; i < vertexStride(); i = i + 1u) {
+      outVertices[base + i] = inVertices[base + i];
     }
 
-    // Find joint nodes
-    new_skin->joint_count = (uint32_t)skin->joints_count;
-    new_skin->joints
-      = new_skin->joint_count > 0 ?
-          calloc(new_skin->joint_count, sizeof(*new_skin->joints)) :
-          NULL;
-    for (uint32_t j = 0; j < new_skin->joint_count; ++j) {
-      gltf_node_t* node
-        = gltf_model_node_from_index(model, skin->joints[i] - data->nodes);
-      if (node != NULL) {
-        new_skin->joints[new_skin->current_joint_index++] = node;
+    var pos = vec3<f32>(inVertices[base], inVertices[base + 1u],
+                        inVertices[base + 2u]);
+    var normal = vec3<f32>(inVertices[base + 3u], inVertices[base + 4u],
+                           inVertices[base + 5u]);
+    var tangent3 = readVec4(base + 20u).xyz;
+
+    // Morph targets, blended before skinning
+    for (var t = 0u; t < job.morphTargetCount; t = t + 1u) {
+      let w = morphWeights[job.firstWeight + t];
+      if (w == 0.0) {
+        continue;
       }
+      let delta = job.firstMorphDelta
+                  + (t * job.vertexCount + global_id.x) * 3u;
+      pos = pos + w * morphDeltas[delta].xyz;
+      normal = normal + w * morphDeltas[delta + 1u].xyz;
+      tangent3 = tangent3 + w * morphDeltas[delta + 2u].xyz;
     }
 
-    // Get the inverse bind matrices from the buffer associated to this skin
-    if (skin->inverse_bind_matrices != NULL) {
-      cgltf_accessor* accessor            = skin->inverse_bind_matrices;
-      cgltf_buffer_view* buffer_view      = accessor->buffer_view;
-      new_skin->inverse_bind_matrix_count = accessor->count;
-      memcpy(new_skin->inverse_bind_matrices,
-             (mat4*)&((unsigned char*)buffer_view->buffer
-                        ->data)[accessor->offset + buffer_view->offset],
-             new_skin->inverse_bind_matrix_count
-               * sizeof(*new_skin->inverse_bind_matrices));
+    let joint = readVec4(base + 12u);
+    let weight = readVec4(base + 16u);
+    if (job.jointCount > 0u
+        && weight.x + weight.y + weight.z + weight.w > 0.0) {
+      let skin = weight.x * jointMatrix(joint.x)
+               + weight.y * jointMatrix(joint.y)
+               + weight.z * jointMatrix(joint.z)
+               + weight.w * jointMatrix(joint.w);
+      let skin3 = mat3x3<f32>(skin[0].xyz, skin[1].xyz, skin[2].xyz);
+      pos = (skin * vec4<f32>(pos, 1.0)).xyz;
+      normal = skin3 * normal;
+      tangent3 = skin3 * tangent3;
+    }
+    if (dot(normal, normal) > 0.0) {
+      normal = normalize(normal);
     }
-  }
-}
 
-static void gltf_model_load_images(gltf_model_t* model, cgltf_data* data)
-{
-  model->texture_count = (uint32_t)data->images_count;
-  model->textures      = model->texture_count > 0 ?
-                           calloc(model->texture_count, sizeof(*model->textures)) :
-                           NULL;
-  for (uint32_t i = 0; i < model->texture_count; ++i) {
-    cgltf_image* image      = &data->images[i];
-    gltf_texture_t* texture = &model->textures[i];
-    gltf_texture_init(texture, model->wgpu_context);
-    gltf_texture_from_gltf_image(model->uri, texture, image);
+    outVertices[base] = pos.x;
+    outVertices[base + 1u] = pos.y;
+    outVertices[base + 2u] = pos.z;
+    outVertices[base + 3u] = normal.x;
+    outVertices[base + 4u] = normal.y;
+    outVertices[base + 5u] = normal.z;
+    outVertices[base + 20u] = tangent3.x;
+    outVertices[base + 21u] = tangent3.y;
+    outVertices[base + 22u] = tangent3.z;
   }
-  // Create an empty texture to be used for empty material images
-  gltf_model_create_empty_texture(model);
-}
+);
+// clang-format on
 
-static void gltf_model_load_texture_samplers(gltf_model_t* model,
-                                             cgltf_data* data)
+/*
+ * Create one skinning job per primitive of the skinned and morphed meshes, the
+ * jobs are stored in a uniform buffer and bound with dynamic offsets
+ */
+static void gltf_model_create_skinning_jobs(gltf_model_t* model)
 {
-  model->texture_sampler_count = (uint32_t)data->samplers_count;
-  model->texture_samplers
+  const uint64_t job_stride = gltf_align_size(
+    sizeof(gltf_skinning_job_t), WGPU_GLTF_UNIFORM_OFFSET_ALIGNMENT);
+  uint32_t job_count      = 0;
+  uint8_t* jobs           = NULL;
+  uint32_t* vertex_counts = NULL;
+  bool* mesh_skinned      = calloc(MAX(model->mesh_count, 1u), sizeof(bool));
+
+  for (uint32_t n = 0; n < model->linear_node_count; ++n) {
+    gltf_node_t* node = model->sorted_nodes[n];
+    if (node->mesh == NULL
+        || (node->skin == NULL && node->mesh->weights.count == 0)
+        || mesh_skinned[node->mesh - model->meshes]) {
+      continue;
+    }
+    // A mesh holds a single set of joint matrices, skin it only once
+    mesh_skinned[node->mesh - model->meshes] = true;
+    for (uint32_t p = 0; p < node->mesh->primitive_count; ++p) {
+      gltf_primitive_t* primitive = &node->mesh->primitives[p];
+      if (primitive->vertex_count == 0
+          || (node->skin == NULL && primitive->morph_target_count == 0)) {
+        continue;
+      }
+      jobs = realloc(jobs, (job_count + 1) * job_stride);
+      vertex_counts
+        = realloc(vertex_counts, (job_count + 1) * sizeof(*vertex_counts));
+      gltf_skinning_job_t* job
+        = (gltf_skinning_job_t*)(jobs + job_count * job_stride);
+      memset(job, 0, job_stride);
+      job->first_vertex = primitive->first_vertex;
+      job->vertex_count = primitive->vertex_count;
+      if (node->skin != NULL) {
+        job->joint_offset
+          = (uint32_t)(node->skin->ssbo.offset / sizeof(mat4));
+        job->joint_count = MAX(node->skin->joint_count, 1u);
+      }
+      job->first_morph_delta  = primitive->first_morph_delta;
+      job->morph_target_count = primitive->morph_target_count;
+      job->first_weight       = node->mesh->weights.first;
+      vertex_counts[job_count] = primitive->vertex_count;
+      ++job_count;
+    }
+  }
+  free(mesh_skinned);
+
+  model->compute_skinning.job_count         = job_count;
+  model->compute_skinning.job_vertex_counts = vertex_counts;
+  if (job_count > 0) {
+    model->compute_skinning.job_buffer
+      = wgpu_create_buffer_from_data(model->wgpu_context, jobs,
+                                     job_count * job_stride,
+                                     WGPUBufferUsage_Uniform);
+  }
+  free(jobs);
+}
+
+/*
+ * Create the compute skinning pipeline and the skinned vertex buffer, which is
+ * initialized with the unskinned vertices
+ */
+static void gltf_model_create_compute_skinning(gltf_model_t* model,
+                                               const gltf_vertex_t* vertices,
+                                               size_t vertex_buffer_size)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+
+  /* The shader addresses the vertices as an array of 24 floats */
+  ASSERT(sizeof(gltf_vertex_t) == 24 * sizeof(float));
+  ASSERT(offsetof(gltf_vertex_t, joint0) == 12 * sizeof(float));
+  ASSERT(offsetof(gltf_vertex_t, weight0) == 16 * sizeof(float));
+  ASSERT(offsetof(gltf_vertex_t, tangent) == 20 * sizeof(float));
+
+  gltf_model_create_skinning_jobs(model);
+  if (model->compute_skinning.job_count == 0) {
+    log_warn("Compute skinning enabled, but the model has no skinned or "
+             "morphed meshes");
+    model->compute_skinning.enabled = false;
+    return;
+  }
+
+  model->compute_skinning.vertex_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, vertices, vertex_buffer_size,
+    WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage);
+  const uint64_t delta_buffer_size
+    = MAX(model->morph_targets.delta_count, 1u) * sizeof(vec4);
+
+  /* Bind group layout */
+  WGPUBindGroupLayoutEntry bgl_entries[6] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Input vertices */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = vertex_buffer_size,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Skinned vertices */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = vertex_buffer_size,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 2: Joint palette */
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = model->joint_palette.size,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 3: Skinning job */
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_Uniform,
+        .hasDynamicOffset = true,
+        .minBindingSize   = sizeof(gltf_skinning_job_t),
+      },
+    },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 4: Morph target deltas */
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = delta_buffer_size,
+      },
+    },
+    [5] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 5: Morph target weights */
+      .binding    = 5,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = model->morph_targets.weight_buffer.size,
+      },
+    },
+  };
+  model->compute_skinning.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(model->compute_skinning.bind_group_layout != NULL)
+
+  /* Bind group */
+  WGPUBindGroupEntry bg_entries[6] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = model->vertices.buffer,
+      .size    = vertex_buffer_size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = model->compute_skinning.vertex_buffer,
+      .size    = vertex_buffer_size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = model->joint_palette.buffer.buffer,
+      .size    = model->joint_palette.size,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding = 3,
+      .buffer  = model->compute_skinning.job_buffer,
+      .size    = sizeof(gltf_skinning_job_t),
+    },
+    [4] = (WGPUBindGroupEntry) {
+      .binding = 4,
+      .buffer  = model->morph_targets.delta_buffer,
+      .size    = delta_buffer_size,
+    },
+    [5] = (WGPUBindGroupEntry) {
+      .binding = 5,
+      .buffer  = model->morph_targets.weight_buffer.buffer,
+      .size    = model->morph_targets.weight_buffer.size,
+    },
+  };
+  model->compute_skinning.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout = model->compute_skinning.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(model->compute_skinning.bind_group != NULL)
+
+  /* Compute pipeline */
+  model->compute_skinning.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &model->compute_skinning.bind_group_layout,
+    });
+  ASSERT(model->compute_skinning.pipeline_layout != NULL)
+
+  wgpu_shader_t skinning_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .wgsl_code.source = gltf_compute_skinning_shader_wgsl,
+                    .entry            = "main",
+                  });
+  model->compute_skinning.pipeline = wgpu_create_compute_pipeline(
+    wgpu_context,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "glTF compute skinning pipeline",
+      .layout  = model->compute_skinning.pipeline_layout,
+      .compute = skinning_shader.programmable_stage_descriptor,
+    });
+  ASSERT(model->compute_skinning.pipeline != NULL)
+  wgpu_shader_release(&skinning_shader);
+}
+
+static void gltf_model_release_compute_skinning(gltf_model_t* model)
+{
+  WGPU_RELEASE_RESOURCE(Buffer, model->compute_skinning.vertex_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, model->compute_skinning.job_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        model->compute_skinning.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, model->compute_skinning.bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, model->compute_skinning.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, model->compute_skinning.pipeline)
+  free(model->compute_skinning.job_vertex_counts);
+  model->compute_skinning.job_vertex_counts = NULL;
+}
+
+void wgpu_gltf_model_compute_skinning(gltf_model_t* model,
+                                      WGPUCommandEncoder cmd_enc)
+{
+  if (!model->compute_skinning.enabled) {
+    return;
+  }
+
+  const uint64_t job_stride = gltf_align_size(
+    sizeof(gltf_skinning_job_t), WGPU_GLTF_UNIFORM_OFFSET_ALIGNMENT);
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    model->compute_skinning.pipeline);
+  for (uint32_t i = 0; i < model->compute_skinning.job_count; ++i) {
+    const uint32_t dynamic_offset = (uint32_t)(i * job_stride);
+    const uint32_t vertex_count = model->compute_skinning.job_vertex_counts[i];
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 0,
+                                       model->compute_skinning.bind_group, 1,
+                                       &dynamic_offset);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      cpass_enc,
+      (vertex_count + WGPU_GLTF_SKINNING_WORKGROUP_SIZE - 1)
+        / WGPU_GLTF_SKINNING_WORKGROUP_SIZE,
+      1, 1);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+/*
+ * Meshlet culling
+ */
+typedef struct gltf_meshlet_t {
+  vec3 center;  /* bounding sphere in the vertex space of the mesh */
+  float radius; /* < 0 = never culled, e.g. skinned meshes */
+  vec3 cone_axis;
+  float cone_cutoff; /* 1 = no backface culling */
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t draw_index;
+  uint32_t mesh_index; /* mesh matrix, WGPU_GLTF_MESHLET_NO_MESH = identity */
+} gltf_meshlet_t;
+
+#define WGPU_GLTF_MESHLET_NO_MESH 0xFFFFFFFFu
+
+typedef struct gltf_draw_indexed_indirect_t {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t first_index;
+  int32_t base_vertex;
+  uint32_t first_instance;
+} gltf_draw_indexed_indirect_t;
+
+typedef struct gltf_meshlet_cull_params_t {
+  vec4 planes[6]; /* frustum planes, see frustum_update() */
+  vec4 camera_position;
+  uint32_t meshlet_count;
+  uint32_t mesh_stride; /* stride of the mesh uniform blocks in vec4s */
+  uint32_t padding[2];
+} gltf_meshlet_cull_params_t;
+
+// clang-format off
+static const char* gltf_meshlet_culling_shader_wgsl = CODE(
+  struct Meshlet {
+    center : vec3<f32>,
+    radius : f32,
+    coneAxis : vec3<f32>,
+    coneCutoff : f32,
+    firstIndex : u32,
+    indexCount : u32,
+    drawIndex : u32,
+    meshIndex : u32,
+  }
+
+  struct DrawIndexedIndirect {
+    indexCount : atomic<u32>,
+    instanceCount : u32,
+    firstIndex : u32,
+    baseVertex : i32,
+    firstInstance : u32,
+  }
+
+  struct CullParams {
+    planes : array<vec4<f32>, 6>,
+    cameraPosition : vec4<f32>,
+    meshletCount : u32,
+    meshStride : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : CullParams;
+  @group(0) @binding(1) var<storage, read> meshlets : array<Meshlet>;
+  @group(0) @binding(2) var<storage, read> meshMatrices : array<vec4<f32>>;
+  @group(0) @binding(3) var<storage, read> inIndices : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> outIndices : array<u32>;
+  @group(0) @binding(5)
+  var<storage, read_write> draws : array<DrawIndexedIndirect>;
+
+  var<workgroup> outOffset : u32;
+
+  fn meshMatrix(meshIndex : u32) -> mat4x4<f32> {
+    if (meshIndex == 0xFFFFFFFFu) {
+      return mat4x4<f32>(vec4<f32>(1.0, 0.0, 0.0, 0.0),
+                         vec4<f32>(0.0, 1.0, 0.0, 0.0),
+                         vec4<f32>(0.0, 0.0, 1.0, 0.0),
+                         vec4<f32>(0.0, 0.0, 0.0, 1.0));
+    }
+    let base = meshIndex * params.meshStride;
+    return mat4x4<f32>(meshMatrices[base], meshMatrices[base + 1u],
+                       meshMatrices[base + 2u], meshMatrices[base + 3u]);
+  }
+
+  fn isVisible(meshlet : Meshlet) -> bool {
+    if (meshlet.radius < 0.0) {
+      return true;
+    }
+    let m = meshMatrix(meshlet.meshIndex);
+    let center = (m * vec4<f32>(meshlet.center, 1.0)).xyz;
+    let scale = max(max(length(m[0].xyz), length(m[1].xyz)), length(m[2].xyz));
+    let radius = meshlet.radius * scale;
+    // Frustum culling
+    for (var i = 0u; i < 6u; i = i + 1u) {
+      if (dot(params.planes[i].xyz, center) + params.planes[i].w < -radius) {
+        return false;
+      }
+    }
+    // Occlusion culling
+    if (meshletOccluded(center, radius)) {
+      return false;
+    }
+    // Backface culling with the normal cone
+    if (meshlet.coneCutoff < 1.0) {
+      let axis = normalize((m * vec4<f32>(meshlet.coneAxis, 0.0)).xyz);
+      let view = center - params.cameraPosition.xyz;
+      if (dot(view, axis) >= meshlet.coneCutoff * length(view) + radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // One workgroup per meshlet, the indices of visible meshlets are appended to
+  // the index range of their primitive
+  @compute @workgroup_size(64)
+  fn main(@builtin(workgroup_id) workgroup_id : vec3<u32>,
+          @builtin(num_workgroups) num_workgroups : vec3<u32>,
+          @builtin(local_invocation_index) local_index : u32) {
+    let meshletIndex = workgroup_id.x + workgroup_id.y * num_workgroups.x;
+    if (meshletIndex >= params.meshletCount) {
+      return;
+    }
+    let meshlet = meshlets[meshletIndex];
+    if (local_index == 0u) {
+      outOffset = 0xFFFFFFFFu;
+      if (isVisible(meshlet)) {
+        outOffset = atomicAdd(&draws[meshlet.drawIndex].indexCount,
+                              meshlet.indexCount);
+      }
+    }
+    workgroupBarrier();
+    let offset = outOffset;
+    if (offset == 0xFFFFFFFFu) {
+      return;
+    }
+    let dst = draws[meshlet.drawIndex].firstIndex + offset;
+    for (var i = local_index; i < meshlet.indexCount; i = i + 64u) {
+      outIndices[dst + i] = inIndices[meshlet.firstIndex + i];
+    }
+  }
+);
+
+static const char* gltf_meshlet_no_occlusion_wgsl = CODE(
+  fn meshletOccluded(center : vec3<f32>, radius : f32) -> bool {
+    return false;
+  }
+);
+
+static const char* gltf_meshlet_hiz_occlusion_wgsl = CODE(
+  fn meshletOccluded(center : vec3<f32>, radius : f32) -> bool {
+    return hizIsSphereOccluded(center, radius);
+  }
+);
+// clang-format on
+
+/*
+ * Create the meshlet culling pipeline and buffers. Every primitive with
+ * meshlets is drawn with an indirect draw whose index count is written by the
+ * culling pass, the buffers are initialized to draw all meshlets.
+ */
+static void
+gltf_model_create_meshlet_culling(gltf_model_t* model,
+                                  const gltf_meshlet_t* meshlets,
+                                  uint32_t meshlet_count,
+                                  gltf_draw_indexed_indirect_t* draws,
+                                  uint32_t draw_count, const uint32_t* indices,
+                                  size_t index_buffer_size)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+
+  if (meshlet_count == 0 || draw_count == 0) {
+    log_warn("Meshlet culling enabled, but the model has no meshlets");
+    model->meshlet_culling.enabled = false;
+    return;
+  }
+
+  model->meshlet_culling.meshlet_count    = meshlet_count;
+  model->meshlet_culling.draw_buffer_size = draw_count * sizeof(*draws);
+
+  // The indirect draws pass the material index as first instance too, a non
+  // zero first instance requires the indirect-first-instance feature
+  if (model->material_table.enabled
+      && wgpu_has_feature(wgpu_context,
+                          WGPUFeatureName_IndirectFirstInstance)) {
+    for (uint32_t m = 0; m < model->mesh_count; ++m) {
+      const gltf_mesh_t* mesh = &model->meshes[m];
+      for (uint32_t i = 0; i < mesh->primitive_count; ++i) {
+        const gltf_primitive_t* primitive = &mesh->primitives[i];
+        if (primitive->draw_index >= 0) {
+          draws[primitive->draw_index].first_instance
+            = gltf_model_get_material_index(model, primitive->material);
+        }
+      }
+    }
+  }
+  else if (model->material_table.enabled) {
+    log_warn("Meshlet culled primitives are drawn with material index 0, the "
+             "device has no indirect-first-instance feature");
+  }
+
+  /* Buffers */
+  model->meshlet_culling.meshlet_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, meshlets, meshlet_count * sizeof(*meshlets),
+    WGPUBufferUsage_Storage);
+  model->meshlet_culling.draw_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, draws, model->meshlet_culling.draw_buffer_size,
+    WGPUBufferUsage_Indirect | WGPUBufferUsage_Storage);
+  for (uint32_t i = 0; i < draw_count; ++i) {
+    draws[i].index_count = 0;
+  }
+  model->meshlet_culling.draw_reset_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, draws, model->meshlet_culling.draw_buffer_size,
+    WGPUBufferUsage_CopySrc);
+  model->meshlet_culling.index_buffer = wgpu_create_buffer_from_data(
+    wgpu_context, indices, index_buffer_size,
+    WGPUBufferUsage_Index | WGPUBufferUsage_Storage);
+  model->meshlet_culling.params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "glTF meshlet culling params buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = sizeof(gltf_meshlet_cull_params_t),
+    });
+
+  /* Bind group layout */
+  WGPUBindGroupLayoutEntry bgl_entries[6] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Culling parameters */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(gltf_meshlet_cull_params_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Meshlets */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = meshlet_count * sizeof(*meshlets),
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 2: Mesh uniform blocks */
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = model->mesh_uniforms.size,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 3: Input indices */
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = index_buffer_size,
+      },
+    },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 4: Indices of the visible meshlets */
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = index_buffer_size,
+      },
+    },
+    [5] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 5: Indirect draw arguments */
+      .binding    = 5,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = model->meshlet_culling.draw_buffer_size,
+      },
+    },
+  };
+  model->meshlet_culling.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(model->meshlet_culling.bind_group_layout != NULL)
+
+  /* Bind group */
+  WGPUBindGroupEntry bg_entries[6] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = model->meshlet_culling.params_buffer,
+      .size    = sizeof(gltf_meshlet_cull_params_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = model->meshlet_culling.meshlet_buffer,
+      .size    = meshlet_count * sizeof(*meshlets),
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = model->mesh_uniforms.buffer.buffer,
+      .size    = model->mesh_uniforms.size,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding = 3,
+      .buffer  = model->indices.buffer,
+      .size    = index_buffer_size,
+    },
+    [4] = (WGPUBindGroupEntry) {
+      .binding = 4,
+      .buffer  = model->meshlet_culling.index_buffer,
+      .size    = index_buffer_size,
+    },
+    [5] = (WGPUBindGroupEntry) {
+      .binding = 5,
+      .buffer  = model->meshlet_culling.draw_buffer,
+      .size    = model->meshlet_culling.draw_buffer_size,
+    },
+  };
+  model->meshlet_culling.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .layout = model->meshlet_culling.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(model->meshlet_culling.bind_group != NULL)
+
+  /* Compute pipeline */
+  model->meshlet_culling.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts     = &model->meshlet_culling.bind_group_layout,
+    });
+  ASSERT(model->meshlet_culling.pipeline_layout != NULL)
+
+  const char* sources[2] = {
+    gltf_meshlet_culling_shader_wgsl,
+    gltf_meshlet_no_occlusion_wgsl,
+  };
+  char* wgsl_code = gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+  wgpu_shader_t culling_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "main",
+                  });
+  model->meshlet_culling.pipeline = wgpu_create_compute_pipeline(
+    wgpu_context,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "glTF meshlet culling pipeline",
+      .layout  = model->meshlet_culling.pipeline_layout,
+      .compute = culling_shader.programmable_stage_descriptor,
+    });
+  ASSERT(model->meshlet_culling.pipeline != NULL)
+  wgpu_shader_release(&culling_shader);
+  free(wgsl_code);
+}
+
+/* Meshlet culling pipeline with the depth pyramid bound to group 1 */
+static void gltf_model_create_meshlet_hiz_culling(gltf_model_t* model,
+                                                  wgpu_hiz_culling_t* hiz)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    model->meshlet_culling.bind_group_layout,
+    wgpu_hiz_culling_get_bind_group_layout(hiz),
+  };
+  model->meshlet_culling.hiz_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+      .bindGroupLayouts     = bind_group_layouts,
+    });
+  ASSERT(model->meshlet_culling.hiz_pipeline_layout != NULL)
+
+  const char* sources[2] = {
+    gltf_meshlet_culling_shader_wgsl,
+    gltf_meshlet_hiz_occlusion_wgsl,
+  };
+  char* culling_wgsl = gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+  char* wgsl_code    = wgpu_hiz_culling_create_wgsl(1, culling_wgsl);
+  wgpu_shader_t culling_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "main",
+                  });
+  model->meshlet_culling.hiz_pipeline = wgpu_create_compute_pipeline(
+    wgpu_context,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "glTF meshlet Hi-Z culling pipeline",
+      .layout  = model->meshlet_culling.hiz_pipeline_layout,
+      .compute = culling_shader.programmable_stage_descriptor,
+    });
+  ASSERT(model->meshlet_culling.hiz_pipeline != NULL)
+  wgpu_shader_release(&culling_shader);
+  free(wgsl_code);
+  free(culling_wgsl);
+}
+
+static void gltf_model_release_meshlet_culling(gltf_model_t* model)
+{
+  WGPU_RELEASE_RESOURCE(Buffer, model->meshlet_culling.meshlet_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, model->meshlet_culling.draw_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, model->meshlet_culling.draw_reset_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, model->meshlet_culling.index_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, model->meshlet_culling.params_buffer)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        model->meshlet_culling.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroup, model->meshlet_culling.bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, model->meshlet_culling.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, model->meshlet_culling.pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout,
+                        model->meshlet_culling.hiz_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, model->meshlet_culling.hiz_pipeline)
+}
+
+void wgpu_gltf_model_cull_meshlets(gltf_model_t* model,
+                                   WGPUCommandEncoder cmd_enc,
+                                   mat4 view_projection, vec3 camera_position,
+                                   wgpu_hiz_culling_t* hiz)
+{
+  if (!model->meshlet_culling.enabled) {
+    return;
+  }
+  if (hiz != NULL && model->meshlet_culling.hiz_pipeline == NULL) {
+    gltf_model_create_meshlet_hiz_culling(model, hiz);
+  }
+
+  /* Culling parameters */
+  frustum_t frustum;
+  frustum_update(&frustum, view_projection);
+  gltf_meshlet_cull_params_t params = {
+    .meshlet_count = model->meshlet_culling.meshlet_count,
+    .mesh_stride   = (uint32_t)(model->mesh_uniforms.stride / sizeof(vec4)),
+  };
+  memcpy(params.planes, frustum.planes, sizeof(params.planes));
+  glm_vec4(camera_position, 1.0f, params.camera_position);
+  wgpu_queue_write_buffer(model->wgpu_context,
+                          model->meshlet_culling.params_buffer, 0, &params,
+                          sizeof(params));
+
+  /* Reset the index counts of the indirect draws */
+  wgpuCommandEncoderCopyBufferToBuffer(
+    cmd_enc, model->meshlet_culling.draw_reset_buffer, 0,
+    model->meshlet_culling.draw_buffer, 0,
+    model->meshlet_culling.draw_buffer_size);
+
+  /* One workgroup per meshlet */
+  const uint32_t meshlet_count = model->meshlet_culling.meshlet_count;
+  const uint32_t workgroups_x
+    = MIN(meshlet_count, WGPU_GLTF_MAX_WORKGROUPS_PER_DIMENSION);
+  const uint32_t workgroups_y
+    = (meshlet_count + workgroups_x - 1) / workgroups_x;
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    hiz != NULL ?
+                                      model->meshlet_culling.hiz_pipeline :
+                                      model->meshlet_culling.pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0,
+                                     model->meshlet_culling.bind_group, 0, 0);
+  if (hiz != NULL) {
+    wgpuComputePassEncoderSetBindGroup(
+      cpass_enc, 1, wgpu_hiz_culling_get_bind_group(hiz), 0, 0);
+  }
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, workgroups_x,
+                                           workgroups_y, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+/*
+ * Nodes are appended to the linear nodes after their children were loaded, so
+ * the reversed linear nodes are sorted topologically (parents first).
+ */
+static void gltf_model_sort_nodes(gltf_model_t* model)
+{
+  model->sorted_nodes
+    = model->linear_node_count > 0 ?
+        calloc(model->linear_node_count, sizeof(*model->sorted_nodes)) :
+        NULL;
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    model->sorted_nodes[i]
+      = model->linear_nodes[model->linear_node_count - 1 - i];
+  }
+}
+
+/*
+ * Update the cached world matrices of the dirty nodes and their descendants in
+ * a single linear pass
+ */
+static void gltf_model_update_world_matrices(gltf_model_t* model)
+{
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_update_world_matrix(model->sorted_nodes[i]);
+  }
+}
+
+/*
+ * Update the uniform blocks of the meshes whose node or skin joints moved and
+ * upload them
+ */
+static void gltf_model_update_nodes(gltf_model_t* model)
+{
+  gltf_model_update_world_matrices(model);
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_t* node = model->sorted_nodes[i];
+    if (node->mesh != NULL
+        && (node->world_updated
+            || (node->skin != NULL && gltf_skin_joints_updated(node->skin)))) {
+      gltf_node_update(node);
+    }
+    if (model->instancing.enabled && node->mesh != NULL
+        && node->world_updated) {
+      gltf_model_update_node_instances(model, node);
+    }
+  }
+  gltf_model_write_mesh_uniforms(model);
+  gltf_model_write_joint_palette(model);
+  gltf_model_write_morph_weights(model);
+  gltf_model_write_instances(model);
+}
+
+/*
+ * Copies the vertices and indices of a primitive into its range of the model's
+ * vertex and index arrays. The ranges are reserved while the nodes are loaded,
+ * so the jobs of all primitives can run in parallel.
+ */
+typedef struct gltf_primitive_load_job_t {
+  cgltf_primitive* primitive;
+  uint32_t vertex_start;
+  uint32_t vertex_count;
+  uint32_t index_start;
+  uint32_t index_count;
+  gltf_vertex_t* vertices; /* vertex array of the model */
+  uint32_t* indices;       /* index array of the model */
+  bool optimize;           /* reorder for vertex cache, overdraw and fetch */
+  /* Meshlets, built after the pre-calculations */
+  gltf_primitive_t* gltf_primitive;
+  uint32_t mesh_index;
+  bool skinned;
+  mesh_optimizer_meshlet_t* meshlets;
+  uint32_t meshlet_count;
+  /* Levels of detail, offset to the model's vertex array */
+  uint32_t* lod_indices;
+  uint32_t lod_index_counts[WGPU_GLTF_MAX_LOD_COUNT - 1];
+  uint32_t lod_count;
+  /* Morph target deltas, loaded by gltf_primitive_load_morph_targets_job_run */
+  vec4* morph_deltas; /* delta array of the model */
+  bool flip_y;
+} gltf_primitive_load_job_t;
+
+typedef struct gltf_primitive_load_jobs_t {
+  gltf_primitive_load_job_t* jobs;
+  uint32_t count;
+  uint32_t capacity;
+  bool optimize;
+} gltf_primitive_load_jobs_t;
+
+static gltf_primitive_load_job_t*
+gltf_primitive_load_jobs_add(gltf_primitive_load_jobs_t* jobs,
+                             cgltf_primitive* primitive, uint32_t vertex_start,
+                             uint32_t vertex_count, uint32_t index_start,
+                             uint32_t index_count)
+{
+  if (jobs->count == jobs->capacity) {
+    jobs->capacity = MAX(jobs->capacity * 2, 64u);
+    jobs->jobs = realloc(jobs->jobs, jobs->capacity * sizeof(*jobs->jobs));
+  }
+  jobs->jobs[jobs->count++] = (gltf_primitive_load_job_t){
+    .primitive    = primitive,
+    .vertex_start = vertex_start,
+    .vertex_count = vertex_count,
+    .index_start  = index_start,
+    .index_count  = index_count,
+    .optimize     = jobs->optimize,
+  };
+  return &jobs->jobs[jobs->count - 1];
+}
+
+static void gltf_primitive_load_job_run(void* arg)
+{
+  gltf_primitive_load_job_t* job = (gltf_primitive_load_job_t*)arg;
+  cgltf_primitive* primitive     = job->primitive;
+  gltf_vertex_t* vertices        = job->vertices + job->vertex_start;
+  uint32_t* indices              = job->indices + job->index_start;
+
+  // Vertices
+  {
+    const float* buffer_pos       = NULL;
+    const float* buffer_normals   = NULL;
+    const float* buffer_texcoords = NULL;
+    const float* buffer_colors    = NULL;
+    const float* buffer_tangents  = NULL;
+    uint32_t num_color_components = 0;
+    const uint16_t* buffer_joints = NULL;
+    const float* buffer_weights   = NULL;
+
+    cgltf_accessor* pos_accessor = NULL;
+
+    for (uint32_t j = 0; j < primitive->attributes_count; ++j) {
+      // Get buffer data for vertex normals
+      if (primitive->attributes[j].type == cgltf_attribute_type_position) {
+        pos_accessor = primitive->attributes[j].data;
+        buffer_pos = (float*)gltf_accessor_data(pos_accessor);
+      }
+      // Get buffer data for vertex normals
+      if (primitive->attributes[j].type == cgltf_attribute_type_normal) {
+        cgltf_accessor* normal_accessor = primitive->attributes[j].data;
+        buffer_normals = (float*)gltf_accessor_data(normal_accessor);
+      }
+      // Get buffer data for vertex texture coordinates
+      if (primitive->attributes[j].type == cgltf_attribute_type_texcoord) {
+        cgltf_accessor* texcoord_accessor = primitive->attributes[j].data;
+        buffer_texcoords = (float*)gltf_accessor_data(texcoord_accessor);
+      }
+      // Get buffer data for vertex colors
+      if (primitive->attributes[j].type == cgltf_attribute_type_color) {
+        cgltf_accessor* color_accessor = primitive->attributes[j].data;
+        // Color buffer are either of type vec3 or vec4
+        num_color_components
+          = color_accessor->type == cgltf_type_vec3 ? 3 : 4;
+        buffer_colors = (float*)gltf_accessor_data(color_accessor);
+      }
+      // Get buffer data for vertex tangents
+      if (primitive->attributes[j].type == cgltf_attribute_type_tangent) {
+        cgltf_accessor* tangent_accessor = primitive->attributes[j].data;
+        buffer_tangents = (float*)gltf_accessor_data(tangent_accessor);
+      }
+
+      // Skinning
+      // Get vertex joint indices
+      if (primitive->attributes[j].type == cgltf_attribute_type_joints) {
+        cgltf_accessor* joint_accessor = primitive->attributes[j].data;
+        buffer_joints = (uint16_t*)gltf_accessor_data(joint_accessor);
+      }
+      // Get vertex joint weights
+      if (primitive->attributes[j].type == cgltf_attribute_type_weights) {
+        cgltf_accessor* weight_accessor = primitive->attributes[j].data;
+        buffer_weights = (float*)gltf_accessor_data(weight_accessor);
+      }
+    }
+
+    const bool has_skin = (buffer_joints != NULL && buffer_weights != NULL);
+
+    // Position attribute is required
+    ASSERT(pos_accessor != NULL);
+
+    // Write data into the primitive's range of the model's vertex buffer
+    for (uint32_t v = 0; v < pos_accessor->count; ++v) {
+      gltf_vertex_t vert = {0};
+      memcpy(&vert.pos, &buffer_pos[v * 3], sizeof(vec3));
+      if (buffer_normals != NULL) {
+        memcpy(&vert.normal, &buffer_normals[v * 3], sizeof(vec3));
+      }
+      if (buffer_texcoords != NULL) {
+        memcpy(&vert.uv, &buffer_texcoords[v * 2], sizeof(vec2));
+      }
+      if (buffer_colors) {
+        switch (num_color_components) {
+          case 3: {
+            glm_vec4_one(vert.color);
+            vec3 tmp_vec3 = GLM_VEC3_ZERO_INIT;
+            memcpy(&tmp_vec3, &buffer_colors[v * 3], sizeof(vec3));
+            glm_vec4_copy3(tmp_vec3, vert.color);
+          } break;
+          case 4:
+            memcpy(&vert.color, &buffer_colors[v * 4], sizeof(vec4));
+            break;
+        }
+      }
+      else {
+        glm_vec4_one(vert.color);
+      }
+      if (buffer_tangents) {
+        memcpy(&vert.tangent, &buffer_tangents[v * 4], sizeof(vec4));
+      }
+      if (has_skin) {
+        uint16_t tmp_joint[4] = {0};
+        memcpy(&tmp_joint, &buffer_joints[v * 4], sizeof(tmp_joint));
+        glm_vec4_copy(
+          (vec4){tmp_joint[0], tmp_joint[1], tmp_joint[2], tmp_joint[3]},
+          vert.joint0);
+      }
+      if (has_skin) {
+        memcpy(&vert.weight0, &buffer_weights[v * 4], sizeof(vec4));
+      }
+      vertices[v] = vert;
+    }
+  }
+
+  // Indices
+  {
+    cgltf_accessor* accessor = primitive->indices;
+
+    // glTF supports different component types of indices
+    switch (accessor->component_type) {
+      case cgltf_component_type_r_32u: {
+        uint32_t* buf = calloc(accessor->count, sizeof(*buf));
+        memcpy(buf, gltf_accessor_data(accessor),
+               accessor->count * sizeof(*buf));
+        for (size_t index = 0; index < accessor->count; index++) {
+          indices[index] = buf[index];
+        }
+        free(buf);
+        break;
+      }
+      case cgltf_component_type_r_16u: {
+        uint16_t* buf = calloc(accessor->count, sizeof(*buf));
+        memcpy(buf, gltf_accessor_data(accessor),
+               accessor->count * sizeof(*buf));
+        for (size_t index = 0; index < accessor->count; index++) {
+          indices[index] = buf[index];
+        }
+        free(buf);
+        break;
+      }
+      case cgltf_component_type_r_8u: {
+        uint8_t* buf = calloc(accessor->count, sizeof(*buf));
+        memcpy(buf, gltf_accessor_data(accessor),
+               accessor->count * sizeof(*buf));
+        for (size_t index = 0; index < accessor->count; index++) {
+          indices[index] = buf[index];
+        }
+        free(buf);
+        break;
+      }
+      default: {
+        assert(false);
+      }
+    }
+  }
+
+  // Reorder the triangles and vertices of the primitive, the indices are still
+  // relative to the primitive's first vertex. The vertices of morphed
+  // primitives keep the order of the morph target deltas.
+  if (job->optimize && primitive->type == cgltf_primitive_type_triangles) {
+    mesh_optimizer_optimize_vertex_cache(indices, job->index_count,
+                                         job->vertex_count);
+    mesh_optimizer_optimize_overdraw(
+      indices, job->index_count, vertices[0].pos, job->vertex_count,
+      sizeof(gltf_vertex_t), MESH_OPTIMIZER_DEFAULT_OVERDRAW_THRESHOLD);
+    if (primitive->targets_count == 0) {
+      mesh_optimizer_optimize_vertex_fetch(vertices, indices,
+                                           job->index_count, job->vertex_count,
+                                           sizeof(gltf_vertex_t));
+    }
+  }
+
+  // Offset the indices to the primitive's range of the vertex buffer
+  for (uint32_t i = 0; i < job->index_count; ++i) {
+    indices[i] += job->vertex_start;
+  }
+}
+
+/*
+ * Copies the position, normal and tangent deltas of all morph targets of a
+ * primitive into its range of the model's delta array, missing attributes
+ * stay zero
+ */
+static void gltf_primitive_load_morph_targets_job_run(void* arg)
+{
+  gltf_primitive_load_job_t* job = (gltf_primitive_load_job_t*)arg;
+  cgltf_primitive* primitive     = job->primitive;
+  const gltf_primitive_t* dst    = job->gltf_primitive;
+  float* buf = malloc(MAX(job->vertex_count, 1u) * sizeof(vec3));
+
+  for (uint32_t t = 0; t < dst->morph_target_count; ++t) {
+    const cgltf_morph_target* target = &primitive->targets[t];
+    vec4* deltas
+      = &job->morph_deltas[dst->first_morph_delta + t * job->vertex_count * 3];
+    memset(deltas, 0, job->vertex_count * 3 * sizeof(vec4));
+    for (uint32_t a = 0; a < target->attributes_count; ++a) {
+      const cgltf_attribute* attribute = &target->attributes[a];
+      uint32_t component = 0;
+      switch (attribute->type) {
+        case cgltf_attribute_type_position:
+          component = 0;
+          break;
+        case cgltf_attribute_type_normal:
+          component = 1;
+          break;
+        case cgltf_attribute_type_tangent:
+          component = 2;
+          break;
+        default:
+          continue;
+      }
+      const cgltf_accessor* accessor = attribute->data;
+      if (accessor->count < job->vertex_count
+          || cgltf_num_components(accessor->type) != 3) {
+        continue;
+      }
+      cgltf_accessor_unpack_floats(accessor, buf, job->vertex_count * 3);
+      for (uint32_t v = 0; v < job->vertex_count; ++v) {
+        float* delta = deltas[v * 3 + component];
+        memcpy(delta, &buf[v * 3], sizeof(vec3));
+        if (job->flip_y && component < 2) {
+          delta[1] *= -1.0f;
+        }
+      }
+    }
+  }
+  free(buf);
+}
+
+static void gltf_primitive_build_meshlets_job_run(void* arg)
+{
+  gltf_primitive_load_job_t* job = (gltf_primitive_load_job_t*)arg;
+  if (job->primitive->type != cgltf_primitive_type_triangles) {
+    return;
+  }
+  // The indices are offset to the model's vertex array at this point
+  job->meshlet_count = (uint32_t)mesh_optimizer_build_meshlets(
+    &job->meshlets, job->indices + job->index_start, job->index_count,
+    job->vertices[0].pos, sizeof(gltf_vertex_t),
+    WGPU_GLTF_MESHLET_MAX_VERTICES, WGPU_GLTF_MESHLET_MAX_TRIANGLES);
+}
+
+/*
+ * Simplifies the primitive into its levels of detail, every level targets half
+ * of the triangles of the previous one
+ */
+static void gltf_primitive_build_lods_job_run(void* arg)
+{
+  gltf_primitive_load_job_t* job = (gltf_primitive_load_job_t*)arg;
+  if (job->primitive->type != cgltf_primitive_type_triangles
+      || job->index_count < GLTF_LOD_MIN_INDEX_COUNT) {
+    return;
+  }
+  // The simplifier reads the indices relative to the primitive's vertices
+  const uint32_t* indices = job->indices + job->index_start;
+  uint32_t* src           = malloc(job->index_count * sizeof(uint32_t));
+  uint32_t* dst           = malloc(job->index_count * sizeof(uint32_t));
+  for (uint32_t i = 0; i < job->index_count; ++i) {
+    src[i] = indices[i] - job->vertex_start;
+  }
+
+  uint32_t previous_count = job->index_count;
+  uint32_t total_count    = 0;
+  for (uint32_t l = 0; l < WGPU_GLTF_MAX_LOD_COUNT - 1; ++l) {
+    const uint32_t target_count = previous_count / 6 * 3;
+    const uint32_t count        = (uint32_t)mesh_optimizer_simplify(
+      dst, src, job->index_count, job->vertices[job->vertex_start].pos,
+      job->vertex_count, sizeof(gltf_vertex_t), target_count,
+      GLTF_LOD_MAX_ERROR, NULL);
+    if (count == 0 || count > previous_count * GLTF_LOD_MAX_REDUCTION) {
+      break;
+    }
+    if (job->optimize) {
+      mesh_optimizer_optimize_vertex_cache(dst, count, job->vertex_count);
+    }
+    job->lod_indices
+      = realloc(job->lod_indices, (total_count + count) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i) {
+      job->lod_indices[total_count + i] = dst[i] + job->vertex_start;
+    }
+    job->lod_index_counts[job->lod_count++] = count;
+    total_count += count;
+    previous_count = count;
+  }
+  free(dst);
+  free(src);
+}
+
+static cgltf_accessor*
+gltf_primitive_get_position_accessor(cgltf_primitive* primitive)
+{
+  for (uint32_t j = 0; j < primitive->attributes_count; ++j) {
+    if (primitive->attributes[j].type == cgltf_attribute_type_position) {
+      return primitive->attributes[j].data;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Read the EXT_mesh_gpu_instancing transforms of the node, every attribute
+ * holds one element per instance. Normalized rotations are converted by
+ * cgltf_accessor_read_float().
+ */
+static void gltf_node_load_gpu_instances(gltf_node_t* new_node,
+                                         cgltf_node* node)
+{
+  const cgltf_mesh_gpu_instancing* instancing = &node->mesh_gpu_instancing;
+  cgltf_accessor* translations                = NULL;
+  cgltf_accessor* rotations                   = NULL;
+  cgltf_accessor* scales                      = NULL;
+  cgltf_size count                            = 0;
+  for (cgltf_size i = 0; i < instancing->attributes_count; ++i) {
+    const cgltf_attribute* attribute = &instancing->attributes[i];
+    if (attribute->name == NULL || attribute->data == NULL) {
+      continue;
+    }
+    if (strcmp(attribute->name, "TRANSLATION") == 0) {
+      translations = attribute->data;
+    }
+    else if (strcmp(attribute->name, "ROTATION") == 0) {
+      rotations = attribute->data;
+    }
+    else if (strcmp(attribute->name, "SCALE") == 0) {
+      scales = attribute->data;
+    }
+    else {
+      continue;
+    }
+    count = count == 0 ? attribute->data->count :
+                         MIN(count, attribute->data->count);
+  }
+  if (count == 0) {
+    return;
+  }
+
+  new_node->instance_count    = (uint32_t)count;
+  new_node->instance_matrices = calloc(count, sizeof(mat4));
+  for (cgltf_size i = 0; i < count; ++i) {
+    vec3 translation = GLM_VEC3_ZERO_INIT;
+    versor rotation  = GLM_QUAT_IDENTITY_INIT;
+    vec3 scale       = GLM_VEC3_ONE_INIT;
+    if (translations != NULL) {
+      cgltf_accessor_read_float(translations, i, translation, 3);
+    }
+    if (rotations != NULL) {
+      cgltf_accessor_read_float(rotations, i, rotation, 4);
+    }
+    if (scales != NULL) {
+      cgltf_accessor_read_float(scales, i, scale, 3);
+    }
+    mat4* matrix = &new_node->instance_matrices[i];
+    glm_translate_make(*matrix, translation);
+    glm_quat_rotate(*matrix, rotation, *matrix);
+    glm_scale(*matrix, scale);
+  }
+}
+
+static void gltf_model_load_node(gltf_model_t* model, cgltf_node* parent,
+                                 cgltf_node* node, cgltf_data* data,
+                                 gltf_primitive_load_jobs_t* jobs,
+                                 uint32_t* vertex_count, uint32_t* index_count,
+                                 float global_scale)
+{
+  gltf_node_t* new_node = &model->nodes[node - data->nodes];
+  gltf_node_init(new_node);
+  new_node->index = (int32_t)(node - data->nodes);
+  if (node->name) {
+    snprintf(new_node->name, strlen(node->name) + 1, "%s", node->name);
+  }
+  new_node->skin_index  = (int32_t)(node->skin - data->skins);
+  new_node->children    = calloc(node->children_count, sizeof(gltf_node_t*));
+  new_node->child_count = node->children_count;
+
+  // Generate local node matrix
+  // It's either made up from translation, rotation, scale or a 4x4 matrix
+  if (node->has_translation) {
+    glm_vec3_copy(node->translation, new_node->translation);
+  }
+  if (node->has_rotation) {
+    versor q = GLM_VEC4_ONE_INIT;
+    memcpy(q, node->rotation, sizeof(node->rotation));
+    glm_quat_copy(q, new_node->rotation);
+  }
+  if (node->has_scale) {
+    glm_vec3_copy(node->scale, new_node->scale);
+  }
+  if (node->has_matrix) {
+    memcpy(new_node->matrix, node->matrix, sizeof(node->matrix));
+    if (global_scale != 1.0f) {
+      // Not support yet
+    }
+  }
+
+  // Node with children
+  if (node->children_count > 0) {
+    for (cgltf_size i = 0, len = node->children_count; i < len; ++i) {
+      gltf_model_load_node(model, node, node->children[i], data, jobs,
+                           vertex_count, index_count, global_scale);
+    }
+  }
+
+  // Local transforms of the EXT_mesh_gpu_instancing instances of the node
+  if (node->mesh != NULL && node->has_mesh_gpu_instancing
+      && model->instancing.enabled) {
+    gltf_node_load_gpu_instances(new_node, node);
+  }
+
+  // If the node contains mesh data, we load vertices and indices from the
+  // buffers. In glTF this is done via accessors and buffer views. A mesh
+  // referenced by several nodes is only loaded by the first one.
+  const bool mesh_loaded
+    = node->mesh != NULL
+      && model->meshes[node->mesh - data->meshes].instances.node != NULL;
+  if (node->mesh != NULL && !mesh_loaded) {
+    cgltf_mesh* mesh          = node->mesh;
+    gltf_mesh_t* new_mesh     = &model->meshes[node->mesh - data->meshes];
+    const uint64_t mesh_index = (uint64_t)(node->mesh - data->meshes);
+    gltf_mesh_init(new_mesh, model->wgpu_context, model->mesh_uniforms.data,
+                   mesh_index * model->mesh_uniforms.stride, new_node->matrix);
+    new_mesh->instances.node = new_node;
+    if (mesh->name) {
+      snprintf(new_mesh->name, strlen(mesh->name) + 1, "%s", mesh->name);
+    }
+
+    new_mesh->primitive_count = (uint32_t)mesh->primitives_count;
+    new_mesh->primitives
+      = mesh->primitives_count > 0 ?
+          calloc(new_mesh->primitive_count, sizeof(*new_mesh->primitives)) :
+          NULL;
+
+    // Iterate through all primitives of this node's mesh
+    for (uint32_t i = 0; i < mesh->primitives_count; ++i) {
+      cgltf_primitive* primitive = &mesh->primitives[i];
+      if (primitive->indices == NULL) {
+        new_mesh->primitives[i].draw_index = -1;
+        continue;
+      }
+      // Position attribute is required
+      cgltf_accessor* pos_accessor
+        = gltf_primitive_get_position_accessor(primitive);
+      ASSERT(pos_accessor != NULL);
+
+      // Reserve the ranges in the vertex and index arrays, the data is copied
+      // by the primitive load jobs once all nodes are loaded
+      const uint32_t index_start       = *index_count;
+      const uint32_t vertex_start      = *vertex_count;
+      const uint32_t prim_index_count  = (uint32_t)primitive->indices->count;
+      const uint32_t prim_vertex_count = (uint32_t)pos_accessor->count;
+      *index_count += prim_index_count;
+      *vertex_count += prim_vertex_count;
+      gltf_primitive_load_job_t* job = gltf_primitive_load_jobs_add(
+        jobs, primitive, vertex_start, prim_vertex_count, index_start,
+        prim_index_count);
+      job->gltf_primitive = &new_mesh->primitives[i];
+      job->mesh_index     = (uint32_t)mesh_index;
+      // Morphed vertices move as well
+      job->skinned = node->skin != NULL
+                     || (model->morph_targets.enabled
+                         && primitive->targets_count > 0);
+
+      vec3 pos_min = GLM_VEC3_ZERO_INIT;
+      vec3 pos_max = GLM_VEC3_ZERO_INIT;
+      if (pos_accessor->has_min) {
+        glm_vec3_copy(
+          (vec3){
+            pos_accessor->min[0],
+            pos_accessor->min[1],
+            pos_accessor->min[2],
+          },
+          pos_min);
+      }
+      if (pos_accessor->has_max) {
+        glm_vec3_copy(
+          (vec3){
+            pos_accessor->max[0],
+            pos_accessor->max[1],
+            pos_accessor->max[2],
+          },
+          pos_max);
+      }
+
+      gltf_primitive_t new_primitive = {0};
+      gltf_primitive_init(
+        &new_primitive, index_start, prim_index_count,
+        &model->materials[primitive->material - data->materials]);
+      new_primitive.first_vertex = vertex_start;
+      new_primitive.vertex_count = prim_vertex_count;
+      if (model->morph_targets.enabled && primitive->targets_count > 0) {
+        new_primitive.first_morph_delta = model->morph_targets.delta_count;
+        new_primitive.morph_target_count = (uint32_t)primitive->targets_count;
+        model->morph_targets.delta_count
+          += new_primitive.morph_target_count * prim_vertex_count * 3;
+        new_mesh->weights.count = MAX(new_mesh->weights.count,
+                                      new_primitive.morph_target_count);
+      }
+      gltf_primitive_set_bounding_box(&new_primitive, pos_min, pos_max);
+      new_mesh->primitives[i] = new_primitive;
+    }
+    gltf_model_init_mesh_weights(model, new_mesh, mesh);
+    // Mesh BB from BBs of primitives
+    for (uint32_t pi = 0; pi < new_mesh->primitive_count; ++pi) {
+      gltf_primitive_t* p = &new_mesh->primitives[pi];
+      if (p->bb.valid && !new_mesh->bb.valid) {
+        memcpy(&new_mesh->bb, &p->bb, sizeof(p->bb));
+        new_mesh->bb.valid = true;
+      }
+      glm_vec3_copy(*vec3_min(&new_mesh->bb.min, &p->bb.min), new_mesh->bb.min);
+      glm_vec3_copy(*vec3_min(&new_mesh->bb.max, &p->bb.max), new_mesh->bb.max);
+    }
+    if (node->mesh != NULL) {
+      new_node->mesh = &model->meshes[node->mesh - data->meshes];
+    }
+  }
+  else if (mesh_loaded) {
+    new_node->mesh = &model->meshes[node->mesh - data->meshes];
+  }
+  // The weights of a node override the default weights of its mesh
+  if (new_node->mesh != NULL && node->weights_count > 0) {
+    gltf_mesh_t* mesh = new_node->mesh;
+    for (uint32_t i = 0; i < MIN((uint32_t)node->weights_count,
+                                 mesh->weights.count);
+         ++i) {
+      model->morph_targets.weights[mesh->weights.first + i] = node->weights[i];
+    }
+  }
+  if (parent != NULL) {
+    new_node->parent = &model->nodes[parent - data->nodes];
+    new_node->parent->children[new_node->parent->current_child_index++]
+      = new_node;
+  }
+  model->linear_nodes[model->linear_node_count++] = new_node;
+}
+
+static void gltf_model_load_skins(gltf_model_t* model, cgltf_data* data)
+{
+  model->skin_count = (uint32_t)data->skins_count;
+  model->skins      = model->skin_count > 0 ?
+                        calloc(model->skin_count, sizeof(*model->skins)) :
+                        NULL;
+  for (uint32_t i = 0; i < model->skin_count; ++i) {
+    cgltf_skin* skin      = &data->skins[i];
+    gltf_skin_t* new_skin = &model->skins[i];
+    snprintf(new_skin->name, strlen(skin->name) + 1, "%s", skin->name);
+
+    // Find the root node of the skeleton
+    if (skin->skeleton != NULL) {
+      new_skin->skeleton_root
+        = gltf_model_node_from_index(model, skin->skeleton - data->nodes);
+    }
+
+    // Find joint nodes
+    new_skin->joint_count = (uint32_t)skin->joints_count;
+    new_skin->joints
+      = new_skin->joint_count > 0 ?
+          calloc(new_skin->joint_count, sizeof(*new_skin->joints)) :
+          NULL;
+    for (uint32_t j = 0; j < new_skin->joint_count; ++j) {
+      gltf_node_t* node
+        = gltf_model_node_from_index(model, skin->joints[j] - data->nodes);
+      if (node != NULL) {
+        new_skin->joints[new_skin->current_joint_index++] = node;
+      }
+    }
+
+    // Get the inverse bind matrices from the buffer associated to this skin,
+    // joints without inverse bind matrix use the identity matrix
+    new_skin->inverse_bind_matrices
+      = new_skin->joint_count > 0 ?
+          calloc(new_skin->joint_count, sizeof(mat4)) :
+          NULL;
+    for (uint32_t j = 0; j < new_skin->joint_count; ++j) {
+      glm_mat4_identity(new_skin->inverse_bind_matrices[j]);
+    }
+    if (skin->inverse_bind_matrices != NULL) {
+      cgltf_accessor* accessor = skin->inverse_bind_matrices;
+      new_skin->inverse_bind_matrix_count
+        = (uint32_t)MIN(accessor->count, new_skin->joint_count);
+      memcpy(new_skin->inverse_bind_matrices, gltf_accessor_data(accessor),
+             new_skin->inverse_bind_matrix_count
+               * sizeof(*new_skin->inverse_bind_matrices));
+    }
+  }
+}
+
+/*
+ * Decodes a jpg / png image of the model into memory, the jobs of all images
+ * run on the thread pool. Image files are read asynchronously first, their
+ * decode jobs are submitted as the reads finish. The textures are created from
+ * the decoded images on the main thread, images which are not decoded (e.g.
+ * ktx) are loaded there.
+ */
+typedef struct gltf_image_decode_job_t {
+  const char* model_uri;
+  cgltf_image* image;
+  thread_pool_t* thread_pool;
+  file_read_result_t file_data; /* read image file, NULL once decoded */
+  bool from_file;
+  bool decoded;
+  image_data_t image_data;
+} gltf_image_decode_job_t;
+
+static void gltf_image_decode_job_run(void* arg)
+{
+  gltf_image_decode_job_t* job = (gltf_image_decode_job_t*)arg;
+  cgltf_image* gltf_image      = job->image;
+
+  if (gltf_image->uri != NULL) {
+    job->from_file = true;
+    job->decoded   = wgpu_image_data_load_from_memory(
+      job->file_data.data, job->file_data.size, false, &job->image_data);
+    free(job->file_data.data);
+    job->file_data = (file_read_result_t){0};
+  }
+  else if (gltf_image->buffer_view) {
+    job->decoded = wgpu_image_data_load_from_memory(
+      gltf_buffer_view_data(gltf_image->buffer_view),
+      gltf_image->buffer_view->size, false, &job->image_data);
+  }
+}
+
+/* Submits the decode job once the image file is read */
+static void gltf_image_file_read_callback(int error, file_read_result_t* result,
+                                          void* user_data)
+{
+  gltf_image_decode_job_t* job = (gltf_image_decode_job_t*)user_data;
+  if (error != 0) {
+    // The image is loaded again on the main thread, which reports the error
+    job->from_file = true;
+    return;
+  }
+  job->file_data = *result;
+  thread_pool_submit(job->thread_pool, gltf_image_decode_job_run, job);
+}
+
+static void gltf_model_load_images(gltf_model_t* model, cgltf_data* data,
+                                   thread_pool_t* thread_pool,
+                                   async_io_t* async_io,
+                                   gltf_image_decode_job_t** image_jobs)
+{
+  model->texture_count = (uint32_t)data->images_count;
+  model->textures      = model->texture_count > 0 ?
+                           calloc(model->texture_count, sizeof(*model->textures)) :
+                           NULL;
+  *image_jobs = model->texture_count > 0 ?
+                  calloc(model->texture_count, sizeof(**image_jobs)) :
+                  NULL;
+  for (uint32_t i = 0; i < model->texture_count; ++i) {
+    gltf_texture_init(&model->textures[i], model->wgpu_context);
+    gltf_image_decode_job_t* job = &(*image_jobs)[i];
+    job->model_uri               = model->uri;
+    job->image                   = &data->images[i];
+    job->thread_pool             = thread_pool;
+    if (job->image->uri != NULL) {
+      // Resident images are taken from the texture cache without decoding,
+      // packed images are always decoded
+      char image_uri[STRMAX];
+      get_relative_file_path(model->uri, job->image->uri, image_uri);
+      struct wgpu_texture_load_options_t options
+        = gltf_image_file_load_options();
+      if (!model->packed_textures.enabled
+          && wgpu_texture_is_resident(model->wgpu_context, image_uri,
+                                      &options)) {
+        continue;
+      }
+      if (filename_has_extension(image_uri, "jpg")
+          || filename_has_extension(image_uri, "png")) {
+        async_io_read_file(async_io, image_uri, gltf_image_file_read_callback,
+                           job);
+      }
+      else {
+        job->from_file = true;
+      }
+      continue;
+    }
+    thread_pool_submit(thread_pool, gltf_image_decode_job_run, job);
+  }
+  // Allocate an empty texture to be used for empty material images, the
+  // texture itself is created with the other textures
+  model->empty_texture = calloc(1, sizeof(gltf_texture_t));
+  gltf_texture_init(model->empty_texture, model->wgpu_context);
+}
+
+/*
+ * Packs the decoded RGBA images into a texture array per image size, the
+ * images of further sizes keep their own texture. The packed images are
+ * released.
+ */
+static void gltf_model_pack_textures(gltf_model_t* model,
+                                     gltf_image_decode_job_t* image_jobs)
+{
+  const image_data_t* images[WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT]
+                            [GLTF_PACKED_TEXTURE_MAX_LAYERS];
+  uint32_t layer_counts[WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT] = {0};
+  uint32_t array_count = 0, unpacked_count = 0;
+  for (uint32_t i = 0; i < model->texture_count; ++i) {
+    const image_data_t* image_data = &image_jobs[i].image_data;
+    if (!image_jobs[i].decoded || image_data->channel_count != 4) {
+      ++unpacked_count;
+      continue;
+    }
+    uint32_t a = 0;
+    while (a < array_count
+           && (images[a][0]->width != image_data->width
+               || images[a][0]->height != image_data->height
+               || layer_counts[a] == GLTF_PACKED_TEXTURE_MAX_LAYERS)) {
+      ++a;
+    }
+    if (a == WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT) {
+      ++unpacked_count;
+      continue;
+    }
+    array_count                     = MAX(array_count, a + 1);
+    model->textures[i].packed_array = (int32_t)a;
+    model->textures[i].packed_layer = layer_counts[a];
+    images[a][layer_counts[a]++]    = image_data;
+  }
+  if (unpacked_count > 0) {
+    log_warn("%u of %u images are not packed into texture arrays",
+             unpacked_count, model->texture_count);
+  }
+
+  struct wgpu_texture_load_options_t options = gltf_image_file_load_options();
+  for (uint32_t a = 0; a < array_count; ++a) {
+    model->packed_textures.arrays[a]
+      = wgpu_create_texture_array_from_image_data(
+        model->wgpu_context, images[a], layer_counts[a], &options);
+  }
+  model->packed_textures.array_count = array_count;
+
+  for (uint32_t i = 0; i < model->texture_count; ++i) {
+    if (model->textures[i].packed_array >= 0) {
+      wgpu_image_data_release(&image_jobs[i].image_data);
+      image_jobs[i].decoded = false;
+    }
+  }
+}
+
+/* Packed layers of a material, (array << 16) | layer per texture */
+typedef struct gltf_packed_material_t {
+  uint32_t base_color;
+  uint32_t metallic_roughness;
+  uint32_t normal;
+  uint32_t occlusion;
+  uint32_t emissive;
+} gltf_packed_material_t;
+
+static uint32_t gltf_texture_get_packed_layer(const gltf_texture_t* texture)
+{
+  if (texture == NULL || texture->packed_array < 0) {
+    return GLTF_PACKED_TEXTURE_NONE;
+  }
+  return ((uint32_t)texture->packed_array << 16) | texture->packed_layer;
+}
+
+/*
+ * Storage buffer with the packed layers of every material, the records are
+ * aligned to the minimum storage buffer offset alignment so every material can
+ * be bound with a dynamic offset.
+ */
+static void gltf_model_create_packed_material_buffer(gltf_model_t* model)
+{
+  const uint64_t stride = gltf_align_size(sizeof(gltf_packed_material_t),
+                                          WGPU_GLTF_STORAGE_OFFSET_ALIGNMENT);
+  const uint64_t size   = model->material_count * stride;
+  uint8_t* data         = (uint8_t*)calloc(1, size);
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    const gltf_material_t* material = &model->materials[i];
+    *(gltf_packed_material_t*)(data + i * stride) = (gltf_packed_material_t){
+      .base_color = gltf_texture_get_packed_layer(material->base_color_texture),
+      .metallic_roughness
+      = gltf_texture_get_packed_layer(material->metallic_roughness_texture),
+      .normal    = gltf_texture_get_packed_layer(material->normal_texture),
+      .occlusion = gltf_texture_get_packed_layer(material->occlusion_texture),
+      .emissive  = gltf_texture_get_packed_layer(material->emissive_texture),
+    };
+  }
+  model->packed_textures.material_buffer = wgpu_create_buffer_from_data(
+    model->wgpu_context, data, size, WGPUBufferUsage_Storage);
+  model->packed_textures.material_stride = stride;
+  free(data);
+}
+
+/* Material table record, matches GltfMaterial of the prelude */
+typedef struct gltf_material_record_t {
+  vec4 base_color_factor;
+  vec4 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  uint32_t alpha_mode;
+  gltf_packed_material_t textures;
+  uint32_t tex_coord_sets;
+  uint32_t double_sided;
+  uint32_t padding;
+} gltf_material_record_t;
+
+/* Writes the records of all materials into the material table */
+static void gltf_model_write_material_table(gltf_model_t* model)
+{
+  gltf_material_record_t* records
+    = (gltf_material_record_t*)calloc(model->material_count, sizeof(*records));
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    const gltf_material_t* material = &model->materials[i];
+    gltf_material_record_t* record  = &records[i];
+    glm_vec4_copy((float*)material->base_color_factor,
+                  record->base_color_factor);
+    glm_vec4_copy((float*)material->emissive_factor, record->emissive_factor);
+    record->metallic_factor  = material->metallic_factor;
+    record->roughness_factor = material->roughness_factor;
+    record->alpha_cutoff     = material->alpha_cutoff;
+    record->alpha_mode       = (uint32_t)material->alpha_mode;
+    record->textures         = (gltf_packed_material_t){
+      .base_color = gltf_texture_get_packed_layer(material->base_color_texture),
+      .metallic_roughness
+      = gltf_texture_get_packed_layer(material->metallic_roughness_texture),
+      .normal    = gltf_texture_get_packed_layer(material->normal_texture),
+      .occlusion = gltf_texture_get_packed_layer(material->occlusion_texture),
+      .emissive  = gltf_texture_get_packed_layer(material->emissive_texture),
+    };
+    const uint8_t tex_coord_sets[5] = {
+      material->tex_coord_sets.base_color,
+      material->tex_coord_sets.metallic_roughness,
+      material->tex_coord_sets.normal,
+      material->tex_coord_sets.occlusion,
+      material->tex_coord_sets.emissive,
+    };
+    for (uint32_t t = 0; t < (uint32_t)ARRAY_SIZE(tex_coord_sets); ++t) {
+      record->tex_coord_sets |= (tex_coord_sets[t] & 0xfu) << (4 * t);
+    }
+    record->double_sided = material->double_sided ? 1u : 0u;
+  }
+  wgpu_queue_write_buffer(model->wgpu_context, model->material_table.buffer, 0,
+                          records, model->material_count * sizeof(*records));
+  free(records);
+}
+
+static void gltf_model_create_material_table(gltf_model_t* model)
+{
+  model->material_table.buffer = wgpuDeviceCreateBuffer(
+    model->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "glTF material table buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+      .size  = model->material_count * sizeof(gltf_material_record_t),
+    });
+  gltf_model_write_material_table(model);
+}
+
+static void gltf_model_create_textures(gltf_model_t* model, cgltf_data* data,
+                                       gltf_image_decode_job_t* image_jobs)
+{
+  // The copies and mipmap generation of all textures are submitted at once
+  wgpu_upload_batch_begin(model->wgpu_context);
+  if (model->packed_textures.enabled && model->texture_count > 0) {
+    gltf_model_pack_textures(model, image_jobs);
+  }
+  for (uint32_t i = 0; i < model->texture_count; ++i) {
+    gltf_texture_t* texture      = &model->textures[i];
+    gltf_image_decode_job_t* job = &image_jobs[i];
+    if (texture->packed_array >= 0) {
+      continue;
+    }
+    if (job->decoded && job->from_file) {
+      char image_uri[STRMAX];
+      get_relative_file_path(model->uri, job->image->uri, image_uri);
+      struct wgpu_texture_load_options_t options
+        = gltf_image_file_load_options();
+      texture->wgpu_texture = wgpu_acquire_texture_from_image_data(
+        model->wgpu_context, image_uri, &job->image_data, &options);
+      texture->shared = (texture->wgpu_texture.texture != NULL);
+      wgpu_image_data_release(&job->image_data);
+    }
+    else if (job->decoded) {
+      texture->wgpu_texture = wgpu_create_texture_from_image_data(
+        model->wgpu_context, &job->image_data, NULL);
+      wgpu_image_data_release(&job->image_data);
+    }
+    else {
+      gltf_texture_from_gltf_image(model->uri, texture, &data->images[i]);
+    }
+  }
+  if (model->empty_texture != NULL) {
+    gltf_model_create_empty_texture(model);
+  }
+  wgpu_upload_batch_end(model->wgpu_context);
+}
+
+static void gltf_model_load_texture_samplers(gltf_model_t* model,
+                                             cgltf_data* data)
+{
+  model->texture_sampler_count = (uint32_t)data->samplers_count;
+  model->texture_samplers
     = model->texture_sampler_count > 0 ?
         calloc(model->texture_sampler_count, sizeof(*model->texture_samplers)) :
         NULL;
@@ -1187,418 +3751,2082 @@ static void gltf_model_load_texture_samplers(gltf_model_t* model,
   }
 }
 
-static void gltf_model_load_materials(gltf_model_t* model, cgltf_data* data)
+static void gltf_model_load_materials(gltf_model_t* model, cgltf_data* data)
+{
+  model->material_count = (uint32_t)data->materials_count + 1;
+  model->materials
+    = model->material_count > 0 ?
+        calloc(model->material_count, sizeof(*model->materials)) :
+        NULL;
+  for (uint32_t i = 0; i < data->materials_count; ++i) {
+    cgltf_material* mat       = &data->materials[i];
+    gltf_material_t* material = &model->materials[i];
+    gltf_material_init(material, model->wgpu_context);
+
+    // Metallic roughness workflow
+    if (mat->has_pbr_metallic_roughness) {
+      cgltf_pbr_metallic_roughness* mr_config = &mat->pbr_metallic_roughness;
+      if (mr_config->base_color_texture.texture != NULL) {
+        material->base_color_texture = gltf_model_get_texture(
+          model, data, mr_config->base_color_texture.texture);
+      }
+      if (mr_config->metallic_roughness_texture.texture != NULL) {
+        material->metallic_roughness_texture = gltf_model_get_texture(
+          model, data, mr_config->metallic_roughness_texture.texture);
+      }
+      material->roughness_factor = mr_config->roughness_factor;
+      material->metallic_factor  = mr_config->metallic_factor;
+      const float* c             = mr_config->base_color_factor;
+      memcpy(material->base_color_factor, (vec4){c[0], c[1], c[2], c[3]},
+             sizeof(vec4));
+    }
+    if (mat->normal_texture.texture != NULL) {
+      material->normal_texture
+        = gltf_model_get_texture(model, data, mat->normal_texture.texture);
+    }
+    else {
+      material->normal_texture = model->empty_texture;
+    }
+    if (mat->emissive_texture.texture != NULL) {
+      material->emissive_texture
+        = gltf_model_get_texture(model, data, mat->emissive_texture.texture);
+    }
+    if (mat->occlusion_texture.texture != NULL) {
+      material->occlusion_texture
+        = gltf_model_get_texture(model, data, mat->occlusion_texture.texture);
+    }
+    if (mat->alpha_mode == cgltf_alpha_mode_blend) {
+      material->alpha_mode = AlphaMode_BLEND;
+      material->blend      = true;
+    }
+    if (mat->alpha_mode == cgltf_alpha_mode_mask) {
+      material->alpha_mode = AlphaMode_MASK;
+      material->blend      = true;
+    }
+    material->alpha_cutoff = mat->alpha_cutoff;
+    material->double_sided = mat->double_sided;
+  }
+  // Push a default material at the end of the list for meshes with no material
+  // assigned
+  gltf_material_init(&model->materials[model->material_count - 1],
+                     model->wgpu_context);
+}
+
+/*
+ * Load the animations from the glTF model
+ */
+static void gltf_model_load_animations(gltf_model_t* model, cgltf_data* data)
+{
+  model->animation_count = (uint32_t)data->animations_count;
+  model->animations
+    = model->animation_count > 0 ?
+        calloc(model->animation_count, sizeof(*model->animations)) :
+        NULL;
+  for (uint32_t i = 0; i < model->animation_count; ++i) {
+    cgltf_animation* anim       = &data->animations[i];
+    gltf_animation_t* animation = &model->animations[i];
+    gltf_animation_init(animation);
+    snprintf(animation->name, strlen(anim->name) + 1, "%s", anim->name);
+
+    // Samplers
+    animation->sampler_count = (uint32_t)anim->samplers_count;
+    animation->samplers
+      = animation->sampler_count > 0 ?
+          calloc(animation->sampler_count, sizeof(*animation->samplers)) :
+          NULL;
+    for (uint32_t j = 0; j < animation->sampler_count; ++j) {
+      cgltf_animation_sampler* samp     = &anim->samplers[j];
+      gltf_animation_sampler_t* sampler = &animation->samplers[j];
+      gltf_animation_sampler_init(sampler);
+
+      if (samp->interpolation == cgltf_interpolation_type_linear) {
+        sampler->interpolation = InterpolationType_LINEAR;
+      }
+      if (samp->interpolation == cgltf_interpolation_type_step) {
+        sampler->interpolation = InterpolationType_STEP;
+      }
+      if (samp->interpolation == cgltf_interpolation_type_cubic_spline) {
+        sampler->interpolation = InterpolationType_CUBICSPLINE;
+      }
+
+      // Read sampler input time values
+      {
+        cgltf_accessor* accessor = samp->input;
+
+        ASSERT(accessor->component_type == cgltf_component_type_r_32f);
+
+        sampler->input_count = (uint32_t)accessor->count;
+        sampler->inputs
+          = sampler->input_count > 0 ?
+              calloc(sampler->input_count, sizeof(*sampler->inputs)) :
+              NULL;
+
+        float* buf = calloc(accessor->count, sizeof(float));
+        memcpy(buf, gltf_accessor_data(accessor),
+               accessor->count * sizeof(*buf));
+        for (size_t index = 0; index < accessor->count; index++) {
+          sampler->inputs[index] = buf[index];
+        }
+        free(buf);
+
+        // Adjust animation's start and end times
+        for (uint32_t k = 0; k < sampler->input_count; ++k) {
+          float input = sampler->inputs[k];
+          if (input < animation->start) {
+            animation->start = input;
+          };
+          if (input > animation->end) {
+            animation->end = input;
+          }
+        }
+      }
+
+      // Read sampler keyframe output translate/rotate/scale values
+      {
+        cgltf_accessor* accessor = samp->output;
+
+        ASSERT(accessor->component_type == cgltf_component_type_r_32f);
+
+        switch (accessor->type) {
+          case cgltf_type_vec3: {
+            sampler->outputs_vec4_count = (uint32_t)accessor->count;
+            sampler->outputs_vec4       = calloc(sampler->outputs_vec4_count,
+                                           sizeof(*sampler->outputs_vec4));
+
+            vec3* buf = calloc(accessor->count, sizeof(vec3));
+            memcpy(buf, gltf_accessor_data(accessor),
+                   accessor->count * sizeof(*buf));
+
+            for (size_t index = 0; index < accessor->count; ++index) {
+              glm_vec4_zero(sampler->outputs_vec4[index]);
+              glm_vec4_copy3(buf[index], sampler->outputs_vec4[index]);
+            }
+
+            free(buf);
+          } break;
+          case cgltf_type_vec4: {
+            sampler->outputs_vec4_count = (uint32_t)accessor->count;
+            sampler->outputs_vec4       = calloc(sampler->outputs_vec4_count,
+                                           sizeof(*sampler->outputs_vec4));
+
+            vec4* buf = calloc(accessor->count, sizeof(vec4));
+            memcpy(buf, gltf_accessor_data(accessor),
+                   accessor->count * sizeof(*buf));
+
+            for (size_t index = 0; index < accessor->count; ++index) {
+              glm_vec4_copy(buf[index], sampler->outputs_vec4[index]);
+            }
+
+            free(buf);
+          } break;
+          case cgltf_type_scalar: {
+            // Morph target weights
+            sampler->outputs_float_count = (uint32_t)accessor->count;
+            sampler->outputs_float       = calloc(
+              MAX(sampler->outputs_float_count, 1u), sizeof(float));
+            memcpy(sampler->outputs_float, gltf_accessor_data(accessor),
+                   accessor->count * sizeof(float));
+          } break;
+          default: {
+            log_warn("unknown type");
+            break;
+          }
+        }
+      }
+    }
+
+    // Channels
+    animation->channel_count = (uint32_t)anim->channels_count;
+    animation->channels
+      = calloc(animation->channel_count, sizeof(*animation->channels));
+    for (uint32_t j = 0; j < animation->channel_count; ++j) {
+      cgltf_animation_channel* chan     = &anim->channels[j];
+      gltf_animation_channel_t* channel = &animation->channels[j];
+      gltf_animation_channel_init(channel);
+
+      if (chan->target_path == cgltf_animation_path_type_rotation) {
+        channel->path = PathType_ROTATION;
+      }
+      if (chan->target_path == cgltf_animation_path_type_translation) {
+        channel->path = PathType_TRANSLATION;
+      }
+      if (chan->target_path == cgltf_animation_path_type_scale) {
+        channel->path = PathType_SCALE;
+      }
+      if (chan->target_path == cgltf_animation_path_type_weights) {
+        if (!model->morph_targets.enabled) {
+          log_warn("weights require compute skinning, skipping channel");
+          continue;
+        }
+        channel->path = PathType_WEIGHTS;
+      }
+      channel->sampler_index = chan->sampler - anim->samplers;
+      channel->node
+        = gltf_model_node_from_index(model, chan->target_node - data->nodes);
+      if (!channel->node) {
+        continue;
+      }
+
+      channel->is_valid = true;
+    }
+  }
+}
+
+/*
+ * glTF model loader, the model is loaded in two stages:
+ *  - CPU stage: parses the file, decodes the images and loads the nodes,
+ *    vertices, indices, animations and skins. The work is spread over a thread
+ *    pool and the stage can run on any thread.
+ *  - GPU stage: creates the textures and buffers, this stage runs on the main
+ *    thread since the WebGPU device is not thread-safe.
+ */
+struct wgpu_gltf_model_loader {
+  wgpu_gltf_model_load_options_t load_options;
+  char filename[STRMAX];
+  cgltf_data* gltf_data;
+  gltf_model_t* model;
+  gltf_vertex_t* vertices;
+  uint32_t* indices;
+  vec4* morph_deltas; /* not cached, loaded from the glTF buffers */
+  gltf_image_decode_job_t* image_jobs;
+  /* Memory mapped glTF and buffer files, released by cgltf_free() */
+  file_mapping_t* file_mappings;
+  uint32_t file_mapping_count;
+  /* Mesh cache, the vertices, indices and meshlets point into the read-only
+   * mapping if the cache was valid */
+  file_mapping_t mesh_cache;
+  char mesh_cache_filename[STRMAX];
+  uint64_t mesh_cache_key;
+  /* Meshlet culling */
+  gltf_meshlet_t* meshlets;
+  uint32_t meshlet_count;
+  gltf_draw_indexed_indirect_t* draws;
+  uint32_t draw_count;
+  bool cpu_stage_succeeded;
+  /* Asynchronous loading */
+  pthread_t thread;
+  bool thread_started;
+  pthread_mutex_t mutex;
+  bool cpu_stage_finished;
+};
+
+static wgpu_gltf_model_loader_t*
+gltf_model_loader_create(wgpu_gltf_model_load_options_t* load_options)
+{
+  wgpu_gltf_model_loader_t* loader = calloc(1, sizeof(*loader));
+  loader->load_options             = *load_options;
+  snprintf(loader->filename, sizeof(loader->filename), "%s",
+           load_options->filename);
+  loader->load_options.filename = loader->filename;
+  pthread_mutex_init(&loader->mutex, NULL);
+  return loader;
+}
+
+static void gltf_model_loader_release(wgpu_gltf_model_loader_t* loader)
+{
+  if (loader->image_jobs != NULL) {
+    for (uint32_t i = 0; i < loader->model->texture_count; ++i) {
+      wgpu_image_data_release(&loader->image_jobs[i].image_data);
+    }
+    free(loader->image_jobs);
+  }
+  if (loader->mesh_cache.data != NULL) {
+    file_unmap(&loader->mesh_cache);
+  }
+  else {
+    free(loader->vertices);
+    free(loader->indices);
+    free(loader->meshlets);
+  }
+  free(loader->morph_deltas);
+  free(loader->draws);
+  if (loader->gltf_data != NULL) {
+    cgltf_free(loader->gltf_data);
+  }
+  free(loader->file_mappings);
+  pthread_mutex_destroy(&loader->mutex);
+  free(loader);
+}
+
+/*
+ * Appends the levels of detail of all primitives to the model's index array
+ */
+static void gltf_model_loader_gather_lods(wgpu_gltf_model_loader_t* loader,
+                                          gltf_primitive_load_jobs_t* jobs)
 {
-  model->material_count = (uint32_t)data->materials_count + 1;
-  model->materials
-    = model->material_count > 0 ?
-        calloc(model->material_count, sizeof(*model->materials)) :
-        NULL;
-  for (uint32_t i = 0; i < data->materials_count; ++i) {
-    cgltf_material* mat       = &data->materials[i];
-    gltf_material_t* material = &model->materials[i];
-    gltf_material_init(material, model->wgpu_context);
+  gltf_model_t* model = loader->model;
 
-    // Metallic roughness workflow
-    if (mat->has_pbr_metallic_roughness) {
-      cgltf_pbr_metallic_roughness* mr_config = &mat->pbr_metallic_roughness;
-      if (mr_config->base_color_texture.texture != NULL) {
-        material->base_color_texture = gltf_model_get_texture(
-          model, data, mr_config->base_color_texture.texture);
+  uint32_t lod_index_count = 0;
+  for (uint32_t i = 0; i < jobs->count; ++i) {
+    for (uint32_t l = 0; l < jobs->jobs[i].lod_count; ++l) {
+      lod_index_count += jobs->jobs[i].lod_index_counts[l];
+    }
+  }
+  if (lod_index_count == 0) {
+    return;
+  }
+  loader->indices
+    = realloc(loader->indices,
+              (model->indices.count + lod_index_count) * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < jobs->count; ++i) {
+    gltf_primitive_load_job_t* job = &jobs->jobs[i];
+    gltf_primitive_t* primitive    = job->gltf_primitive;
+    const uint32_t* lod_indices    = job->lod_indices;
+    for (uint32_t l = 0; l < job->lod_count; ++l) {
+      const uint32_t count = job->lod_index_counts[l];
+      primitive->lods[l]   = (gltf_primitive_lod_t){
+        .first_index = model->indices.count,
+        .index_count = count,
+      };
+      memcpy(&loader->indices[model->indices.count], lod_indices,
+             count * sizeof(uint32_t));
+      model->indices.count += count;
+      lod_indices += count;
+    }
+    primitive->lod_count = job->lod_count;
+    free(job->lod_indices);
+    job->lod_indices = NULL;
+  }
+}
+
+/*
+ * Concatenates the meshlets of all primitives and assigns an indirect draw to
+ * every primitive with meshlets
+ */
+static void gltf_model_loader_gather_meshlets(wgpu_gltf_model_loader_t* loader,
+                                              gltf_primitive_load_jobs_t* jobs)
+{
+  const uint32_t file_loading_flags = loader->load_options.file_loading_flags;
+  const bool pre_transformed
+    = (file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreTransformVertices)
+      != 0;
+
+  uint32_t meshlet_count = 0;
+  for (uint32_t i = 0; i < jobs->count; ++i) {
+    meshlet_count += jobs->jobs[i].meshlet_count;
+  }
+  if (meshlet_count == 0) {
+    return;
+  }
+  loader->meshlets = calloc(meshlet_count, sizeof(*loader->meshlets));
+  loader->draws    = calloc(jobs->count, sizeof(*loader->draws));
+
+  for (uint32_t i = 0; i < jobs->count; ++i) {
+    gltf_primitive_load_job_t* job = &jobs->jobs[i];
+    if (job->meshlet_count == 0) {
+      continue;
+    }
+    const uint32_t draw_index          = loader->draw_count++;
+    gltf_draw_indexed_indirect_t* draw = &loader->draws[draw_index];
+    draw->index_count                  = job->index_count;
+    draw->instance_count               = 1;
+    draw->first_index                  = job->index_start;
+    job->gltf_primitive->draw_index    = (int32_t)draw_index;
+    const bool double_sided = job->gltf_primitive->material->double_sided;
+    for (uint32_t m = 0; m < job->meshlet_count; ++m) {
+      const mesh_optimizer_meshlet_t* src = &job->meshlets[m];
+      gltf_meshlet_t* dst = &loader->meshlets[loader->meshlet_count++];
+      memcpy(dst->center, src->center, sizeof(dst->center));
+      memcpy(dst->cone_axis, src->cone_axis, sizeof(dst->cone_axis));
+      // The vertices of skinned meshes move, their bounds are unknown
+      dst->radius      = job->skinned ? -1.0f : src->radius;
+      dst->cone_cutoff = double_sided ? 1.0f : src->cone_cutoff;
+      dst->first_index = job->index_start + src->first_index;
+      dst->index_count = src->index_count;
+      dst->draw_index  = draw_index;
+      dst->mesh_index
+        = pre_transformed ? WGPU_GLTF_MESHLET_NO_MESH : job->mesh_index;
+    }
+    free(job->meshlets);
+    job->meshlets = NULL;
+  }
+}
+
+/*
+ * Mesh cache, stores the final vertices and indices of the model after the
+ * optimizations and pre-calculations, the bounds of the primitives and the
+ * meshlets. The nodes, materials, animations and skins are still loaded from
+ * the glTF data. The cache file is stored next to the model, its name contains
+ * the load options changing the cached data and its key the modification time
+ * and size of the model and buffer files.
+ *
+ * Layout: header, primitives (in load job order), vertices, indices, meshlets
+ * and draws.
+ */
+#define GLTF_MESH_CACHE_MAGIC 0x4853454du /* "MESH" */
+#define GLTF_MESH_CACHE_VERSION 3u
+#define GLTF_MESH_CACHE_FLAGS                                                  \
+  (WGPU_GLTF_FileLoadingFlags_PreTransformVertices                             \
+   | WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors                        \
+   | WGPU_GLTF_FileLoadingFlags_FlipY                                          \
+   | WGPU_GLTF_FileLoadingFlags_OptimizeMeshes                                 \
+   | WGPU_GLTF_FileLoadingFlags_MeshletCulling                                 \
+   | WGPU_GLTF_FileLoadingFlags_GenerateLods)
+
+typedef struct gltf_mesh_cache_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t primitive_count;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t lod_index_count; /* appended to the indices */
+  uint32_t meshlet_count;
+  uint32_t draw_count;
+  uint32_t vertex_size;
+} gltf_mesh_cache_header_t;
+
+typedef struct gltf_mesh_cache_primitive_t {
+  vec3 bb_min;
+  vec3 bb_max;
+  uint32_t bb_valid;
+  int32_t draw_index;
+  uint32_t lod_count;
+  uint32_t lod_first_index[WGPU_GLTF_MAX_LOD_COUNT - 1];
+  uint32_t lod_index_count[WGPU_GLTF_MAX_LOD_COUNT - 1];
+} gltf_mesh_cache_primitive_t;
+
+static uint64_t gltf_mesh_cache_hash(uint64_t hash, const void* data,
+                                     size_t size)
+{
+  /* 64-bit FNV-1a */
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/* Hashes the modification time and size of the file */
+static uint64_t gltf_mesh_cache_hash_file(uint64_t hash, const char* filename)
+{
+  uint64_t values[2] = {0};
+  struct stat st;
+  if (stat(filename, &st) == 0) {
+    values[0] = (uint64_t)st.st_mtime;
+    values[1] = (uint64_t)st.st_size;
+  }
+  else {
+    // Files in the asset archive have no modification time
+    file_mapping_t mapping = {0};
+    if (file_map(filename, &mapping) == 0) {
+      values[1] = (uint64_t)mapping.size;
+      file_unmap(&mapping);
+    }
+  }
+  return gltf_mesh_cache_hash(hash, values, sizeof(values));
+}
+
+/* Determines the cache file name and key of the parsed model */
+static void gltf_mesh_cache_init(wgpu_gltf_model_loader_t* loader)
+{
+  const wgpu_gltf_model_load_options_t* load_options = &loader->load_options;
+  const struct {
+    uint32_t version;
+    uint32_t flags;
+    float scale;
+    uint32_t vertex_size;
+  } options = {
+    .version     = GLTF_MESH_CACHE_VERSION,
+    .flags       = load_options->file_loading_flags & GLTF_MESH_CACHE_FLAGS,
+    .scale       = load_options->scale,
+    .vertex_size = (uint32_t)sizeof(gltf_vertex_t),
+  };
+  const uint64_t options_hash
+    = gltf_mesh_cache_hash(0xcbf29ce484222325ull, &options, sizeof(options));
+  snprintf(loader->mesh_cache_filename, sizeof(loader->mesh_cache_filename),
+           "%s.%08x.mesh", load_options->filename, (uint32_t)options_hash);
+
+  uint64_t key
+    = gltf_mesh_cache_hash_file(options_hash, load_options->filename);
+  const cgltf_data* gltf_data = loader->gltf_data;
+  for (cgltf_size i = 0; i < gltf_data->buffers_count; ++i) {
+    const char* uri = gltf_data->buffers[i].uri;
+    if (uri != NULL && strncmp(uri, "data:", 5) != 0) {
+      char buffer_uri[STRMAX];
+      get_relative_file_path(load_options->filename, uri, buffer_uri);
+      key = gltf_mesh_cache_hash_file(key, buffer_uri);
+    }
+  }
+  loader->mesh_cache_key = key;
+}
+
+/**
+ * @brief Loads the vertices, indices and meshlets from a valid cache file and
+ * restores the bounds and draws of the primitives.
+ * @return true if the cache was valid
+ */
+static bool gltf_mesh_cache_read(wgpu_gltf_model_loader_t* loader,
+                                 gltf_primitive_load_jobs_t* jobs)
+{
+  file_mapping_t mapping = {0};
+  if (file_map(loader->mesh_cache_filename, &mapping) != 0) {
+    return false;
+  }
+
+  gltf_model_t* model             = loader->model;
+  gltf_mesh_cache_header_t header = {0};
+  bool valid                      = mapping.size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, mapping.data, sizeof(header));
+    valid = header.magic == GLTF_MESH_CACHE_MAGIC
+            && header.version == GLTF_MESH_CACHE_VERSION
+            && header.key == loader->mesh_cache_key
+            && header.primitive_count == jobs->count
+            && header.vertex_count == model->vertices.count
+            && header.index_count == model->indices.count
+            && header.lod_index_count <= UINT32_MAX - header.index_count
+            && header.draw_count <= jobs->count
+            && header.vertex_size == sizeof(gltf_vertex_t);
+  }
+  const size_t primitives_offset = sizeof(header);
+  const size_t vertices_offset
+    = primitives_offset
+      + (size_t)header.primitive_count * sizeof(gltf_mesh_cache_primitive_t);
+  const size_t indices_offset
+    = vertices_offset + (size_t)header.vertex_count * sizeof(gltf_vertex_t);
+  const size_t meshlets_offset
+    = indices_offset
+      + ((size_t)header.index_count + header.lod_index_count)
+          * sizeof(uint32_t);
+  const size_t draws_offset
+    = meshlets_offset + (size_t)header.meshlet_count * sizeof(gltf_meshlet_t);
+  const size_t size
+    = draws_offset
+      + (size_t)header.draw_count * sizeof(gltf_draw_indexed_indirect_t);
+  valid = valid && size == mapping.size;
+  if (!valid) {
+    log_debug("Ignoring outdated mesh cache %s", loader->mesh_cache_filename);
+    file_unmap(&mapping);
+    return false;
+  }
+
+  const gltf_mesh_cache_primitive_t* primitives
+    = (const gltf_mesh_cache_primitive_t*)(mapping.data + primitives_offset);
+  for (uint32_t i = 0; i < jobs->count; ++i) {
+    gltf_primitive_t* primitive = jobs->jobs[i].gltf_primitive;
+    glm_vec3_copy((float*)primitives[i].bb_min, primitive->bb.min);
+    glm_vec3_copy((float*)primitives[i].bb_max, primitive->bb.max);
+    primitive->bb.valid   = primitives[i].bb_valid != 0;
+    primitive->draw_index = primitives[i].draw_index;
+    primitive->lod_count
+      = MIN(primitives[i].lod_count, WGPU_GLTF_MAX_LOD_COUNT - 1);
+    for (uint32_t l = 0; l < primitive->lod_count; ++l) {
+      primitive->lods[l] = (gltf_primitive_lod_t){
+        .first_index = primitives[i].lod_first_index[l],
+        .index_count = primitives[i].lod_index_count[l],
+      };
+    }
+  }
+
+  // The vertices, indices and meshlets are only read by the GPU stage, the
+  // draws are reset after the upload and copied
+  uint8_t* data         = (uint8_t*)mapping.data;
+  loader->mesh_cache    = mapping;
+  loader->vertices      = (gltf_vertex_t*)(data + vertices_offset);
+  loader->indices       = (uint32_t*)(data + indices_offset);
+  model->indices.count += header.lod_index_count;
+  loader->meshlet_count = header.meshlet_count;
+  loader->meshlets
+    = header.meshlet_count > 0 ? (gltf_meshlet_t*)(data + meshlets_offset) :
+                                 NULL;
+  loader->draw_count = header.draw_count;
+  if (header.draw_count > 0) {
+    loader->draws = malloc(header.draw_count * sizeof(*loader->draws));
+    memcpy(loader->draws, data + draws_offset,
+           header.draw_count * sizeof(*loader->draws));
+  }
+  log_debug("Loaded meshes of %s from %s", loader->load_options.filename,
+            loader->mesh_cache_filename);
+  return true;
+}
+
+static void gltf_mesh_cache_write(wgpu_gltf_model_loader_t* loader,
+                                  const gltf_primitive_load_jobs_t* jobs)
+{
+  FILE* file = fopen(loader->mesh_cache_filename, "wb");
+  if (file == NULL) {
+    log_warn("Unable to write mesh cache %s", loader->mesh_cache_filename);
+    return;
+  }
+
+  const gltf_model_t* model             = loader->model;
+  const gltf_mesh_cache_header_t header = {
+    .magic           = GLTF_MESH_CACHE_MAGIC,
+    .version         = GLTF_MESH_CACHE_VERSION,
+    .key             = loader->mesh_cache_key,
+    .primitive_count = jobs->count,
+    .vertex_count    = model->vertices.count,
+    .index_count     = model->indices.lod_start,
+    .lod_index_count = model->indices.count - model->indices.lod_start,
+    .meshlet_count   = loader->meshlet_count,
+    .draw_count      = loader->draw_count,
+    .vertex_size     = (uint32_t)sizeof(gltf_vertex_t),
+  };
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (uint32_t i = 0; written && i < jobs->count; ++i) {
+    const gltf_primitive_t* primitive  = jobs->jobs[i].gltf_primitive;
+    gltf_mesh_cache_primitive_t cached = {
+      .bb_valid   = primitive->bb.valid ? 1u : 0u,
+      .draw_index = primitive->draw_index,
+      .lod_count  = primitive->lod_count,
+    };
+    for (uint32_t l = 0; l < primitive->lod_count; ++l) {
+      cached.lod_first_index[l] = primitive->lods[l].first_index;
+      cached.lod_index_count[l] = primitive->lods[l].index_count;
+    }
+    glm_vec3_copy((float*)primitive->bb.min, cached.bb_min);
+    glm_vec3_copy((float*)primitive->bb.max, cached.bb_max);
+    written = fwrite(&cached, sizeof(cached), 1, file) == 1;
+  }
+  written = written
+            && fwrite(loader->vertices, sizeof(gltf_vertex_t),
+                      header.vertex_count, file)
+                 == header.vertex_count
+            && fwrite(loader->indices, sizeof(uint32_t), model->indices.count,
+                      file)
+                 == model->indices.count
+            && fwrite(loader->meshlets, sizeof(gltf_meshlet_t),
+                      header.meshlet_count, file)
+                 == header.meshlet_count
+            && fwrite(loader->draws, sizeof(gltf_draw_indexed_indirect_t),
+                      header.draw_count, file)
+                 == header.draw_count;
+  fclose(file);
+  if (!written) {
+    log_warn("Unable to write mesh cache %s", loader->mesh_cache_filename);
+    remove(loader->mesh_cache_filename);
+  }
+}
+
+/*
+ * cgltf file callbacks, the glTF file and the external buffers are mapped into
+ * memory instead of being read into a copy. The buffer data is only read, GPU
+ * buffers and decoded images are created from it.
+ */
+static cgltf_result
+gltf_model_loader_map_file(const struct cgltf_memory_options* memory_options,
+                           const struct cgltf_file_options* file_options,
+                           const char* path, cgltf_size* size, void** data)
+{
+  UNUSED_VAR(memory_options);
+  wgpu_gltf_model_loader_t* loader
+    = (wgpu_gltf_model_loader_t*)file_options->user_data;
+
+  file_mapping_t file_mapping = {0};
+  const int error             = file_map(path, &file_mapping);
+  if (error != 0) {
+    return error == ENOENT ? cgltf_result_file_not_found :
+                             cgltf_result_io_error;
+  }
+  if (file_mapping.data == NULL) {
+    return cgltf_result_data_too_short;
+  }
+
+  loader->file_mappings = realloc(
+    loader->file_mappings,
+    (loader->file_mapping_count + 1) * sizeof(*loader->file_mappings));
+  loader->file_mappings[loader->file_mapping_count++] = file_mapping;
+  *size = file_mapping.size;
+  *data = (void*)file_mapping.data;
+  return cgltf_result_success;
+}
+
+static void
+gltf_model_loader_unmap_file(const struct cgltf_memory_options* memory_options,
+                             const struct cgltf_file_options* file_options,
+                             void* data)
+{
+  UNUSED_VAR(memory_options);
+  wgpu_gltf_model_loader_t* loader
+    = (wgpu_gltf_model_loader_t*)file_options->user_data;
+
+  for (uint32_t i = 0; i < loader->file_mapping_count; ++i) {
+    if (loader->file_mappings[i].data == data) {
+      file_unmap(&loader->file_mappings[i]);
+      loader->file_mappings[i]
+        = loader->file_mappings[--loader->file_mapping_count];
+      return;
+    }
+  }
+}
+
+/*
+ * Decodes a buffer view compressed with EXT_meshopt_compression, the decoded
+ * data is freed by cgltf_free()
+ */
+static void gltf_buffer_view_decode_job_run(void* arg)
+{
+  cgltf_buffer_view* view                  = (cgltf_buffer_view*)arg;
+  const cgltf_meshopt_compression* meshopt = &view->meshopt_compression;
+  const uint8_t* source
+    = (const uint8_t*)meshopt->buffer->data + meshopt->offset;
+  const size_t size = meshopt->count * meshopt->stride;
+  uint8_t* data     = malloc(size > 0 ? size : 1);
+
+  int error = -1;
+  switch (meshopt->mode) {
+    case cgltf_meshopt_compression_mode_attributes:
+      error = mesh_decoder_decode_vertex_buffer(
+        data, meshopt->count, meshopt->stride, source, meshopt->size);
+      break;
+    case cgltf_meshopt_compression_mode_triangles:
+      error = mesh_decoder_decode_index_buffer(
+        data, meshopt->count, meshopt->stride, source, meshopt->size);
+      break;
+    case cgltf_meshopt_compression_mode_indices:
+      error = mesh_decoder_decode_index_sequence(
+        data, meshopt->count, meshopt->stride, source, meshopt->size);
+      break;
+    default:
+      break;
+  }
+  if (error != 0) {
+    free(data);
+    return;
+  }
+
+  switch (meshopt->filter) {
+    case cgltf_meshopt_compression_filter_octahedral:
+      mesh_decoder_filter_octahedral(data, meshopt->count, meshopt->stride);
+      break;
+    case cgltf_meshopt_compression_filter_quaternion:
+      mesh_decoder_filter_quaternion(data, meshopt->count, meshopt->stride);
+      break;
+    case cgltf_meshopt_compression_filter_exponential:
+      mesh_decoder_filter_exponential(data, meshopt->count, meshopt->stride);
+      break;
+    default:
+      break;
+  }
+  view->data = data;
+}
+
+/*
+ * Decodes the compressed buffer views in parallel, the accessors of the
+ * primitives read the decoded data. Draco compressed primitives are only
+ * loaded from their uncompressed fallback data.
+ */
+static bool gltf_model_loader_decode_buffer_views(const char* filename,
+                                                  cgltf_data* gltf_data,
+                                                  thread_pool_t* thread_pool)
+{
+  for (cgltf_size i = 0; i < gltf_data->meshes_count; ++i) {
+    const cgltf_mesh* mesh = &gltf_data->meshes[i];
+    for (cgltf_size p = 0; p < mesh->primitives_count; ++p) {
+      const cgltf_primitive* primitive = &mesh->primitives[p];
+      if (!primitive->has_draco_mesh_compression) {
+        continue;
       }
-      if (mr_config->metallic_roughness_texture.texture != NULL) {
-        material->metallic_roughness_texture = gltf_model_get_texture(
-          model, data, mr_config->metallic_roughness_texture.texture);
+      bool has_fallback = (primitive->indices == NULL
+                           || primitive->indices->buffer_view != NULL);
+      for (cgltf_size a = 0; a < primitive->attributes_count; ++a) {
+        has_fallback
+          = has_fallback && primitive->attributes[a].data->buffer_view != NULL;
+      }
+      if (!has_fallback) {
+        log_error("KHR_draco_mesh_compression is not supported: %s, mesh: "
+                  "%s\n",
+                  filename, mesh->name ? mesh->name : "");
+        return false;
       }
-      material->roughness_factor = mr_config->roughness_factor;
-      material->metallic_factor  = mr_config->metallic_factor;
-      const float* c             = mr_config->base_color_factor;
-      memcpy(material->base_color_factor, (vec4){c[0], c[1], c[2], c[3]},
-             sizeof(vec4));
     }
-    if (mat->normal_texture.texture != NULL) {
-      material->normal_texture
-        = gltf_model_get_texture(model, data, mat->normal_texture.texture);
+  }
+
+  uint32_t submitted = 0;
+  for (cgltf_size i = 0; i < gltf_data->buffer_views_count; ++i) {
+    cgltf_buffer_view* view = &gltf_data->buffer_views[i];
+    if (view->has_meshopt_compression && view->data == NULL) {
+      if (view->meshopt_compression.buffer->data == NULL) {
+        log_error("Missing EXT_meshopt_compression buffer: %s\n", filename);
+        thread_pool_wait(thread_pool);
+        return false;
+      }
+      thread_pool_submit(thread_pool, gltf_buffer_view_decode_job_run, view);
+      ++submitted;
     }
-    else {
-      material->normal_texture = model->empty_texture;
+  }
+  if (submitted == 0) {
+    return true;
+  }
+  thread_pool_wait(thread_pool);
+
+  for (cgltf_size i = 0; i < gltf_data->buffer_views_count; ++i) {
+    const cgltf_buffer_view* view = &gltf_data->buffer_views[i];
+    if (view->has_meshopt_compression && view->data == NULL) {
+      log_error("Could not decode EXT_meshopt_compression buffer view: %s, "
+                "view: %u\n",
+                filename, (uint32_t)i);
+      return false;
     }
-    if (mat->emissive_texture.texture != NULL) {
-      material->emissive_texture
-        = gltf_model_get_texture(model, data, mat->emissive_texture.texture);
+  }
+  return true;
+}
+
+static bool gltf_model_loader_run_cpu_stage(wgpu_gltf_model_loader_t* loader)
+{
+  wgpu_gltf_model_load_options_t* load_options = &loader->load_options;
+  const uint32_t file_loading_flags = load_options->file_loading_flags;
+
+  cgltf_options options = {
+    .file = {
+      .read      = gltf_model_loader_map_file,
+      .release   = gltf_model_loader_unmap_file,
+      .user_data = loader,
+    },
+  };
+  cgltf_result result
+    = cgltf_parse_file(&options, load_options->filename, &loader->gltf_data);
+  if (result != cgltf_result_success) {
+    log_error("Could not load gltf file: %s, error: %d\n",
+              load_options->filename, result);
+    return false;
+  }
+
+  cgltf_data* gltf_data = loader->gltf_data;
+  result = cgltf_load_buffers(&options, gltf_data, load_options->filename);
+  if (result != cgltf_result_success) {
+    log_error("Could not load gltf buffers: %s, error: %d\n",
+              load_options->filename, result);
+    return false;
+  }
+
+  // If there is no default scene specified, then the default is the first
+  // one. It is not an error for a glTF file to have zero scenes.
+  const cgltf_scene* scene
+    = gltf_data->scene ? gltf_data->scene : gltf_data->scenes;
+  if (!scene) {
+    return false;
+  }
+
+  thread_pool_t* thread_pool = thread_pool_create(0);
+  if (!gltf_model_loader_decode_buffer_views(load_options->filename, gltf_data,
+                                             thread_pool)) {
+    thread_pool_release(thread_pool);
+    return false;
+  }
+
+  gltf_model_t* model = calloc(1, sizeof(gltf_model_t));
+  loader->model       = model;
+  gltf_model_init(model, load_options);
+
+  async_io_t* async_io = async_io_create();
+
+  // Load samplers, read and decode images in parallel to the node loading
+  if (!(file_loading_flags & WGPU_GLTF_FileLoadingFlags_DontLoadImages)) {
+    gltf_model_load_texture_samplers(model, gltf_data);
+    gltf_model_load_images(model, gltf_data, thread_pool, async_io,
+                           &loader->image_jobs);
+  }
+
+  // Load materials
+  gltf_model_load_materials(model, gltf_data);
+
+  // Vertex buffer & Index buffer
+  model->vertices.count = 0;
+  model->indices.count  = 0;
+
+  // Nodes and meshes
+  model->node_count   = (uint32_t)gltf_data->nodes_count;
+  model->nodes        = calloc(model->node_count, sizeof(gltf_node_t));
+  model->linear_nodes = calloc(model->node_count, sizeof(gltf_node_t*));
+
+  model->mesh_count = (uint32_t)gltf_data->meshes_count;
+  model->meshes     = calloc(model->mesh_count, sizeof(gltf_mesh_t));
+  gltf_model_init_mesh_uniforms(model);
+
+  // Recursively create all nodes, this reserves the vertex and index ranges of
+  // the primitives
+  gltf_primitive_load_jobs_t primitive_jobs = {
+    .optimize = (file_loading_flags & WGPU_GLTF_FileLoadingFlags_OptimizeMeshes)
+                != 0,
+  };
+  for (cgltf_size i = 0, len = scene->nodes_count; i < len; ++i) {
+    gltf_model_load_node(model, NULL, scene->nodes[i], gltf_data,
+                         &primitive_jobs, &model->vertices.count,
+                         &model->indices.count, load_options->scale);
+  }
+  model->indices.lod_start = model->indices.count;
+  gltf_model_init_instances(model);
+
+  // Use the processed vertices, indices and meshlets of the mesh cache if it
+  // is up to date, otherwise copy the vertices and indices of all primitives
+  // in parallel
+  gltf_mesh_cache_init(loader);
+  const bool cached = gltf_mesh_cache_read(loader, &primitive_jobs);
+  if (!cached) {
+    loader->vertices
+      = model->vertices.count > 0 ?
+          malloc(model->vertices.count * sizeof(gltf_vertex_t)) :
+          NULL;
+    loader->indices = model->indices.count > 0 ?
+                        malloc(model->indices.count * sizeof(uint32_t)) :
+                        NULL;
+    for (uint32_t i = 0; i < primitive_jobs.count; ++i) {
+      primitive_jobs.jobs[i].vertices = loader->vertices;
+      primitive_jobs.jobs[i].indices  = loader->indices;
+      thread_pool_submit(thread_pool, gltf_primitive_load_job_run,
+                         &primitive_jobs.jobs[i]);
     }
-    if (mat->occlusion_texture.texture != NULL) {
-      material->occlusion_texture
-        = gltf_model_get_texture(model, data, mat->occlusion_texture.texture);
+  }
+
+  // Morph target deltas of the morphed primitives
+  if (model->morph_targets.enabled) {
+    loader->morph_deltas
+      = calloc(MAX(model->morph_targets.delta_count, 1u), sizeof(vec4));
+    for (uint32_t i = 0; i < primitive_jobs.count; ++i) {
+      gltf_primitive_load_job_t* job = &primitive_jobs.jobs[i];
+      if (job->gltf_primitive->morph_target_count == 0) {
+        continue;
+      }
+      job->morph_deltas = loader->morph_deltas;
+      job->flip_y
+        = (file_loading_flags & WGPU_GLTF_FileLoadingFlags_FlipY) != 0;
+      thread_pool_submit(thread_pool,
+                         gltf_primitive_load_morph_targets_job_run, job);
     }
-    if (mat->alpha_mode == cgltf_alpha_mode_blend) {
-      material->alpha_mode = AlphaMode_BLEND;
-      material->blend      = true;
+  }
+
+  // Load animations
+  if (gltf_data->animations_count > 0) {
+    gltf_model_load_animations(model, gltf_data);
+  }
+
+  // Load skins
+  gltf_model_load_skins(model, gltf_data);
+  gltf_model_init_joint_palette(model);
+
+  // Assign skins
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_t* node = model->linear_nodes[i];
+    if (node->skin_index > -1) {
+      node->skin = &model->skins[(uint32_t)node->skin_index];
     }
-    if (mat->alpha_mode == cgltf_alpha_mode_mask) {
-      material->alpha_mode = AlphaMode_MASK;
-      material->blend      = true;
+  }
+
+  // Initial pose, all nodes are dirty after loading. The buffers do not exist
+  // yet, they are created from the updated CPU data in the GPU stage.
+  gltf_model_sort_nodes(model);
+  gltf_model_update_nodes(model);
+
+  // The vertices are required by the pre-calculations, the images by the GPU
+  // stage. The decode jobs are submitted while waiting for the image reads.
+  async_io_wait(async_io);
+  async_io_release(async_io);
+  thread_pool_wait(thread_pool);
+
+  // Pre-Calculations for requested features, the mesh cache contains the
+  // results
+  if (!cached
+      && (file_loading_flags
+          & (WGPU_GLTF_FileLoadingFlags_PreTransformVertices
+             | WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors
+             | WGPU_GLTF_FileLoadingFlags_FlipY))) {
+    const bool preTransform
+      = file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreTransformVertices;
+    const bool preMultiplyColor
+      = file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors;
+    const bool flipY = file_loading_flags & WGPU_GLTF_FileLoadingFlags_FlipY;
+    for (uint32_t n = 0; n < model->linear_node_count; ++n) {
+      gltf_node_t* node = model->linear_nodes[n];
+      // Shared meshes are transformed once, by their first node
+      if (node->mesh != NULL && node->mesh->instances.node == node) {
+        mat4 local_matrix = GLM_MAT4_ZERO_INIT;
+        gltf_node_get_matrix(node, &local_matrix);
+        for (uint32_t p = 0; p < node->mesh->primitive_count; ++p) {
+          gltf_primitive_t* primitive = &node->mesh->primitives[p];
+          // Keep the bounds used for frustum culling in sync
+          if (preTransform) {
+            bounding_get_aabb(&primitive->bb, local_matrix, &primitive->bb);
+          }
+          if (flipY) {
+            const float min_y    = primitive->bb.min[1];
+            primitive->bb.min[1] = -primitive->bb.max[1];
+            primitive->bb.max[1] = -min_y;
+          }
+          for (uint32_t i = 0; i < primitive->vertex_count; ++i) {
+            gltf_vertex_t* vertex
+              = &loader->vertices[primitive->first_vertex + i];
+            // Pre-transform vertex positions by node-hierarchy
+            if (preTransform) {
+              // Vertex position
+              vec4 vertex_pos_tmp = GLM_VEC4_ZERO_INIT;
+              glm_vec4(vertex->pos, 1.0f, vertex_pos_tmp);
+              glm_mat4_mulv(local_matrix, vertex_pos_tmp, vertex_pos_tmp);
+              glm_vec3(vertex_pos_tmp, vertex->pos);
+              // Vertex normal
+              mat3 local_matrix_tmp = GLM_MAT3_ZERO_INIT;
+              glm_mat4_pick3(local_matrix, local_matrix_tmp);
+              vec3 mulv_result;
+              glm_mat3_mulv(local_matrix_tmp, vertex->normal, mulv_result);
+              glm_normalize_to(mulv_result, vertex->normal);
+            }
+            // Flip Y-Axis of vertex positions
+            if (flipY) {
+              vertex->pos[1] *= -1.0f;
+              vertex->normal[1] *= -1.0f;
+            }
+            // Pre-Multiply vertex colors with material base color
+            if (preMultiplyColor) {
+              glm_vec4_mul(primitive->material->base_color_factor,
+                           vertex->color, vertex->color);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Build the meshlets from the final vertex positions
+  if (!cached && model->meshlet_culling.enabled) {
+    for (uint32_t i = 0; i < primitive_jobs.count; ++i) {
+      thread_pool_submit(thread_pool, gltf_primitive_build_meshlets_job_run,
+                         &primitive_jobs.jobs[i]);
+    }
+    thread_pool_wait(thread_pool);
+    gltf_model_loader_gather_meshlets(loader, &primitive_jobs);
+  }
+
+  // Simplify the primitives into their levels of detail
+  if (!cached
+      && (file_loading_flags & WGPU_GLTF_FileLoadingFlags_GenerateLods)) {
+    for (uint32_t i = 0; i < primitive_jobs.count; ++i) {
+      thread_pool_submit(thread_pool, gltf_primitive_build_lods_job_run,
+                         &primitive_jobs.jobs[i]);
+    }
+    thread_pool_wait(thread_pool);
+    gltf_model_loader_gather_lods(loader, &primitive_jobs);
+  }
+  thread_pool_release(thread_pool);
+
+  if (!cached) {
+    gltf_mesh_cache_write(loader, &primitive_jobs);
+  }
+  free(primitive_jobs.jobs);
+
+  return true;
+}
+
+/*
+ * Copies the positions of the indexed triangles of the full detail levels, the
+ * indices of all primitives refer to the shared vertex array
+ */
+static void gltf_model_retain_triangles(gltf_model_t* model,
+                                        const gltf_vertex_t* vertices,
+                                        const uint32_t* indices)
+{
+  const uint32_t triangle_count = model->indices.lod_start / 3;
+  float* positions               = malloc(triangle_count * 9 * sizeof(float));
+  for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+    memcpy(&positions[i * 3], vertices[indices[i]].pos, sizeof(vec3));
+  }
+  model->triangles.positions = positions;
+  model->triangles.count     = triangle_count;
+}
+
+/* Converts an index range of the primitive into 16-bit indices relative to
+ * its first vertex, false if an index is outside of the primitive's vertices */
+static bool gltf_primitive_compact_indices(const gltf_primitive_t* primitive,
+                                           const uint32_t* indices,
+                                           uint32_t index_count, uint16_t* dst)
+{
+  for (uint32_t i = 0; i < index_count; ++i) {
+    if (indices[i] < primitive->first_vertex
+        || indices[i] - primitive->first_vertex >= primitive->vertex_count) {
+      return false;
     }
-    material->alpha_cutoff = mat->alpha_cutoff;
-    material->double_sided = mat->double_sided;
+    dst[i] = (uint16_t)(indices[i] - primitive->first_vertex);
   }
-  // Push a default material at the end of the list for meshes with no material
-  // assigned
-  gltf_material_init(&model->materials[model->material_count - 1],
-                     model->wgpu_context);
+  return true;
 }
 
 /*
- * Load the animations from the glTF model
+ * Converts the indices of the primitives with up to 65536 vertices into 16-bit
+ * indices relative to their first vertex, the other primitives keep drawing
+ * their 32-bit indices
  */
-static void gltf_model_load_animations(gltf_model_t* model, cgltf_data* data)
+static void gltf_model_create_compact_index_buffer(gltf_model_t* model,
+                                                   const uint32_t* indices)
 {
-  model->animation_count = (uint32_t)data->animations_count;
-  model->animations
-    = model->animation_count > 0 ?
-        calloc(model->animation_count, sizeof(*model->animations)) :
-        NULL;
-  for (uint32_t i = 0; i < model->animation_count; ++i) {
-    cgltf_animation* anim       = &data->animations[i];
-    gltf_animation_t* animation = &model->animations[i];
-    gltf_animation_init(animation);
-    snprintf(animation->name, strlen(anim->name) + 1, "%s", anim->name);
-
-    // Samplers
-    animation->sampler_count = (uint32_t)anim->samplers_count;
-    animation->samplers
-      = animation->sampler_count > 0 ?
-          calloc(animation->sampler_count, sizeof(*animation->samplers)) :
-          NULL;
-    for (uint32_t j = 0; j < animation->sampler_count; ++j) {
-      cgltf_animation_sampler* samp     = &anim->samplers[j];
-      gltf_animation_sampler_t* sampler = &animation->samplers[j];
-      gltf_animation_sampler_init(sampler);
+  uint32_t capacity = 0;
+  for (uint32_t m = 0; m < model->mesh_count; ++m) {
+    const gltf_mesh_t* mesh = &model->meshes[m];
+    for (uint32_t i = 0; i < mesh->primitive_count; ++i) {
+      const gltf_primitive_t* primitive = &mesh->primitives[i];
+      if (primitive->has_indices && primitive->vertex_count <= 65536u) {
+        for (uint32_t l = 0; l <= primitive->lod_count; ++l) {
+          capacity += gltf_primitive_get_lod(primitive, l).index_count;
+        }
+      }
+    }
+  }
+  if (capacity == 0) {
+    model->compact_indices.enabled = false;
+    return;
+  }
 
-      if (samp->interpolation == cgltf_interpolation_type_linear) {
-        sampler->interpolation = InterpolationType_LINEAR;
+  // Padded to a multiple of 4 bytes for the queue write
+  uint16_t* compact_indices = malloc((capacity + 1) * sizeof(uint16_t));
+  uint32_t count            = 0;
+  for (uint32_t m = 0; m < model->mesh_count; ++m) {
+    gltf_mesh_t* mesh = &model->meshes[m];
+    for (uint32_t i = 0; i < mesh->primitive_count; ++i) {
+      gltf_primitive_t* primitive = &mesh->primitives[i];
+      if (!primitive->has_indices || primitive->vertex_count > 65536u) {
+        continue;
       }
-      if (samp->interpolation == cgltf_interpolation_type_step) {
-        sampler->interpolation = InterpolationType_STEP;
+      // All levels of detail are converted, indices outside of the
+      // primitive's vertex range keep the primitive 32-bit
+      uint32_t primitive_count = 0;
+      bool compact             = true;
+      for (uint32_t l = 0; compact && l <= primitive->lod_count; ++l) {
+        const gltf_primitive_lod_t lod = gltf_primitive_get_lod(primitive, l);
+        compact                        = gltf_primitive_compact_indices(
+          primitive, &indices[lod.first_index], lod.index_count,
+          &compact_indices[count + primitive_count]);
+        primitive_count += lod.index_count;
       }
-      if (samp->interpolation == cgltf_interpolation_type_cubic_spline) {
-        sampler->interpolation = InterpolationType_CUBICSPLINE;
+      if (!compact) {
+        continue;
+      }
+      primitive->index_format        = WGPUIndexFormat_Uint16;
+      primitive->first_compact_index = count;
+      count += primitive->index_count;
+      for (uint32_t l = 0; l < primitive->lod_count; ++l) {
+        primitive->lods[l].first_compact_index = count;
+        count += primitive->lods[l].index_count;
       }
+    }
+  }
+  if (count % 2 != 0) {
+    compact_indices[count] = 0;
+  }
 
-      // Read sampler input time values
-      {
-        cgltf_accessor* accessor       = samp->input;
-        cgltf_buffer_view* buffer_view = accessor->buffer_view;
-        cgltf_buffer* buffer           = buffer_view->buffer;
+  if (count > 0) {
+    model->compact_indices.count  = count;
+    model->compact_indices.buffer = wgpu_create_buffer_from_data(
+      model->wgpu_context, compact_indices,
+      ((count + 1) & ~1u) * sizeof(uint16_t), WGPUBufferUsage_Index);
+  }
+  else {
+    model->compact_indices.enabled = false;
+  }
+  free(compact_indices);
+}
 
-        ASSERT(accessor->component_type == cgltf_component_type_r_32f);
+static gltf_model_t*
+gltf_model_loader_run_gpu_stage(wgpu_gltf_model_loader_t* loader)
+{
+  gltf_model_t* model = loader->model;
 
-        sampler->input_count = (uint32_t)accessor->count;
-        sampler->inputs
-          = sampler->input_count > 0 ?
-              calloc(sampler->input_count, sizeof(*sampler->inputs)) :
-              NULL;
+  // Textures
+  gltf_model_create_textures(model, loader->gltf_data, loader->image_jobs);
+  if (model->packed_textures.array_count > 0) {
+    gltf_model_create_packed_material_buffer(model);
+  }
+  if (model->material_table.enabled) {
+    gltf_model_create_material_table(model);
+  }
+  if (model->instancing.enabled) {
+    gltf_model_create_instance_buffer(model);
+  }
 
-        float* buf = calloc(accessor->count, sizeof(float));
-        memcpy(buf,
-               (float*)&(((unsigned char*)buffer
-                            ->data)[accessor->offset + buffer_view->offset]),
-               accessor->count * sizeof(*buf));
-        for (size_t index = 0; index < accessor->count; index++) {
-          sampler->inputs[index] = buf[index];
-        }
-        free(buf);
+  // Uniform buffer shared by all meshes and joint palette of all skins
+  gltf_model_create_mesh_uniform_buffer(model);
+  gltf_model_create_joint_palette_buffer(model);
 
-        // Adjust animation's start and end times
-        for (uint32_t k = 0; k < sampler->input_count; ++k) {
-          float input = sampler->inputs[k];
-          if (input < animation->start) {
-            animation->start = input;
-          };
-          if (input > animation->end) {
-            animation->end = input;
-          }
-        }
-      }
+  // Vertex and index buffers
+  size_t vertex_buffer_size
+    = model->vertices.count
+      * wgpu_gltf_get_vertex_format_size(model->vertices.format);
+  size_t index_buffer_size = model->indices.count * sizeof(uint32_t);
 
-      // Read sampler keyframe output translate/rotate/scale values
-      {
-        cgltf_accessor* accessor       = samp->output;
-        cgltf_buffer_view* buffer_view = accessor->buffer_view;
-        cgltf_buffer* buffer           = buffer_view->buffer;
+  assert((vertex_buffer_size > 0) && (index_buffer_size > 0));
 
-        ASSERT(accessor->component_type == cgltf_component_type_r_32f);
+  // Convert the vertices into the quantized vertex format
+  void* vertex_data = loader->vertices;
+  if (model->vertices.format == WGPU_GLTF_VertexFormat_Quantized) {
+    vertex_data = gltf_quantize_vertices(loader->vertices,
+                                         model->vertices.count);
+  }
 
-        switch (accessor->type) {
-          case cgltf_type_vec3: {
-            sampler->outputs_vec4_count = (uint32_t)accessor->count;
-            sampler->outputs_vec4       = calloc(sampler->outputs_vec4_count,
-                                           sizeof(*sampler->outputs_vec4));
+  // Create vertex buffer, the compute skinning pass and pulled vertex shaders
+  // read it as storage buffer
+  const WGPUBufferUsage vertex_buffer_usage
+    = (model->compute_skinning.enabled || model->vertex_pulling.enabled) ?
+        WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage :
+        WGPUBufferUsage_Vertex;
+  model->vertices.buffer
+    = wgpu_create_buffer_from_data(model->wgpu_context, vertex_data,
+                                   vertex_buffer_size, vertex_buffer_usage);
+  if (vertex_data != loader->vertices) {
+    free(vertex_data);
+  }
+  if (model->compute_skinning.enabled) {
+    gltf_model_create_morph_target_buffers(model, loader->morph_deltas);
+    gltf_model_create_compute_skinning(model, loader->vertices,
+                                       vertex_buffer_size);
+  }
 
-            vec3* buf = calloc(accessor->count, sizeof(vec3));
-            memcpy(buf,
-                   (vec3*)&(((unsigned char*)buffer
-                               ->data)[accessor->offset + buffer_view->offset]),
-                   accessor->count * sizeof(*buf));
+  // Create index buffer, the meshlet culling pass and pulled vertex shaders
+  // read it as storage buffer
+  const WGPUBufferUsage index_buffer_usage
+    = (model->meshlet_culling.enabled || model->vertex_pulling.enabled) ?
+        WGPUBufferUsage_Index | WGPUBufferUsage_Storage :
+        WGPUBufferUsage_Index;
+  model->indices.buffer
+    = wgpu_create_buffer_from_data(model->wgpu_context, loader->indices,
+                                   index_buffer_size, index_buffer_usage);
+  if (model->meshlet_culling.enabled) {
+    gltf_model_create_meshlet_culling(model, loader->meshlets,
+                                      loader->meshlet_count, loader->draws,
+                                      loader->draw_count, loader->indices,
+                                      index_buffer_size);
+  }
+  if (model->compact_indices.enabled) {
+    gltf_model_create_compact_index_buffer(model, loader->indices);
+  }
 
-            for (size_t index = 0; index < accessor->count; ++index) {
-              glm_vec4_zero(sampler->outputs_vec4[i]);
-              glm_vec4_copy3(buf[index], sampler->outputs_vec4[i]);
-            }
+  // Keep the triangles for the CPU, the vertices are freed with the loader
+  if (loader->load_options.file_loading_flags
+      & WGPU_GLTF_FileLoadingFlags_RetainTriangles) {
+    gltf_model_retain_triangles(model, loader->vertices, loader->indices);
+  }
 
-            free(buf);
-          } break;
-          case cgltf_type_vec4: {
-            sampler->outputs_vec4_count = (uint32_t)accessor->count;
-            sampler->outputs_vec4       = calloc(sampler->outputs_vec4_count,
-                                           sizeof(*sampler->outputs_vec4));
+  // Get scene dimensions
+  gltf_model_get_scene_dimensions(model);
 
-            vec4* buf = calloc(accessor->count, sizeof(vec4));
-            memcpy(buf,
-                   (vec4*)&(((unsigned char*)buffer
-                               ->data)[accessor->offset + buffer_view->offset]),
-                   accessor->count * sizeof(*buf));
+  return model;
+}
 
-            for (size_t index = 0; index < accessor->count; ++index) {
-              glm_vec4_copy(buf[index], sampler->outputs_vec4[i]);
-            }
+/*
+ * Finishes the loading on the calling thread and releases the loader
+ */
+static gltf_model_t*
+gltf_model_loader_finish(wgpu_gltf_model_loader_t* loader)
+{
+  gltf_model_t* model = NULL;
+  if (loader->cpu_stage_succeeded) {
+    const uint64_t trace_ns = trace_begin();
+    model                   = gltf_model_loader_run_gpu_stage(loader);
+    trace_end("gltf_upload", trace_ns);
+  }
+  else if (loader->model != NULL) {
+    wgpu_gltf_model_destroy(loader->model);
+  }
+  gltf_model_loader_release(loader);
+  return model;
+}
 
-            free(buf);
-          } break;
-          default: {
-            log_warn("unknown type");
-            break;
-          }
-        }
-      }
-    }
+gltf_model_t* wgpu_gltf_model_load_from_file(
+  struct wgpu_gltf_model_load_options_t* load_options)
+{
+  const uint64_t trace_ns          = trace_begin();
+  wgpu_gltf_model_loader_t* loader = gltf_model_loader_create(load_options);
+  loader->cpu_stage_succeeded      = gltf_model_loader_run_cpu_stage(loader);
+  gltf_model_t* model              = gltf_model_loader_finish(loader);
+  trace_end("gltf_load", trace_ns);
+  return model;
+}
 
-    // Channels
-    animation->channel_count = (uint32_t)anim->channels_count;
-    animation->channels
-      = calloc(animation->channel_count, sizeof(*animation->channels));
-    for (uint32_t j = 0; j < animation->channel_count; ++j) {
-      cgltf_animation_channel* chan     = &anim->channels[j];
-      gltf_animation_channel_t* channel = &animation->channels[j];
-      gltf_animation_channel_init(channel);
+static void* gltf_model_loader_thread_main(void* arg)
+{
+  wgpu_gltf_model_loader_t* loader = (wgpu_gltf_model_loader_t*)arg;
+  const uint64_t trace_ns          = trace_begin();
+  const bool succeeded             = gltf_model_loader_run_cpu_stage(loader);
+  trace_end("gltf_parse", trace_ns);
 
-      if (chan->target_path == cgltf_animation_path_type_rotation) {
-        channel->path = PathType_ROTATION;
-      }
-      if (chan->target_path == cgltf_animation_path_type_translation) {
-        channel->path = PathType_TRANSLATION;
+  pthread_mutex_lock(&loader->mutex);
+  loader->cpu_stage_succeeded = succeeded;
+  loader->cpu_stage_finished  = true;
+  pthread_mutex_unlock(&loader->mutex);
+
+  return NULL;
+}
+
+wgpu_gltf_model_loader_t* wgpu_gltf_model_load_from_file_async(
+  struct wgpu_gltf_model_load_options_t* load_options)
+{
+  wgpu_gltf_model_loader_t* loader = gltf_model_loader_create(load_options);
+  loader->thread_started
+    = pthread_create(&loader->thread, NULL, gltf_model_loader_thread_main,
+                     loader)
+      == 0;
+  if (!loader->thread_started) {
+    // Fall back to loading on the calling thread
+    log_warn("Could not create glTF loader thread, loading synchronously\n");
+    loader->cpu_stage_succeeded = gltf_model_loader_run_cpu_stage(loader);
+    loader->cpu_stage_finished  = true;
+  }
+  return loader;
+}
+
+bool wgpu_gltf_model_loader_is_ready(wgpu_gltf_model_loader_t* loader)
+{
+  pthread_mutex_lock(&loader->mutex);
+  const bool ready = loader->cpu_stage_finished;
+  pthread_mutex_unlock(&loader->mutex);
+  return ready;
+}
+
+gltf_model_t* wgpu_gltf_model_loader_finish(wgpu_gltf_model_loader_t* loader)
+{
+  if (loader->thread_started) {
+    pthread_join(loader->thread, NULL);
+  }
+  return gltf_model_loader_finish(loader);
+}
+
+static WGPUBuffer gltf_model_get_vertex_buffer(gltf_model_t* model)
+{
+  return model->compute_skinning.enabled ?
+           model->compute_skinning.vertex_buffer :
+           model->vertices.buffer;
+}
+
+static WGPUBuffer gltf_model_get_index_buffer(gltf_model_t* model)
+{
+  return model->meshlet_culling.enabled ? model->meshlet_culling.index_buffer :
+                                          model->indices.buffer;
+}
+
+static void gltf_model_bind_buffers(gltf_model_t* model)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+  wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
+                                       gltf_model_get_vertex_buffer(model), 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(
+    wgpu_context->rpass_enc, gltf_model_get_index_buffer(model),
+    WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
+  model->compact_indices.bound_format = WGPUIndexFormat_Uint32;
+  // model->buffers_bound = true;
+}
+
+/* Binds the index buffer of the primitive's index format if the other one is
+ * bound */
+static void gltf_model_bind_index_format(gltf_model_t* model,
+                                         WGPUIndexFormat index_format)
+{
+  if (model->compact_indices.bound_format == index_format) {
+    return;
+  }
+  wgpuRenderPassEncoderSetIndexBuffer(
+    model->wgpu_context->rpass_enc,
+    index_format == WGPUIndexFormat_Uint16 ?
+      model->compact_indices.buffer :
+      gltf_model_get_index_buffer(model),
+    index_format, 0, WGPU_WHOLE_SIZE);
+  model->compact_indices.bound_format = index_format;
+}
+
+/*
+ * Vertex pulling
+ */
+// clang-format off
+static const char* gltf_vertex_pulling_common_wgsl = CODE(
+  struct GltfVertex {
+    position : vec3<f32>,
+    normal : vec3<f32>,
+    uv : vec2<f32>,
+    color : vec4<f32>,
+    joint0 : vec4<u32>,
+    weight0 : vec4<f32>,
+    tangent : vec4<f32>
+  }
+
+  fn gltf_pull_index(index : u32) -> u32 {
+    return gltf_index_data[index];
+  }
+);
+
+/* gltf_vertex_t, 24 floats */
+static const char* gltf_vertex_pulling_default_wgsl = CODE(
+  fn gltf_pull_vec4(offset : u32) -> vec4<f32> {
+    return vec4<f32>(bitcast<f32>(gltf_vertex_data[offset]),
+                     bitcast<f32>(gltf_vertex_data[offset + 1u]),
+                     bitcast<f32>(gltf_vertex_data[offset + 2u]),
+                     bitcast<f32>(gltf_vertex_data[offset + 3u]));
+  }
+
+  fn gltf_pull_vertex(vertex : u32) -> GltfVertex {
+    let offset = vertex * 24u;
+    var result : GltfVertex;
+    result.position = gltf_pull_vec4(offset).xyz;
+    result.normal = gltf_pull_vec4(offset + 3u).xyz;
+    result.uv = gltf_pull_vec4(offset + 6u).xy;
+    result.color = gltf_pull_vec4(offset + 8u);
+    result.joint0 = vec4<u32>(gltf_pull_vec4(offset + 12u));
+    result.weight0 = gltf_pull_vec4(offset + 16u);
+    result.tangent = gltf_pull_vec4(offset + 20u);
+    return result;
+  }
+);
+
+/* gltf_quantized_vertex_t, 11 words */
+static const char* gltf_vertex_pulling_quantized_wgsl = CODE(
+  fn gltf_pull_vertex(vertex : u32) -> GltfVertex {
+    let offset = vertex * 11u;
+    let joint0 = gltf_vertex_data[offset + 7u];
+    var result : GltfVertex;
+    result.position = vec3<f32>(bitcast<f32>(gltf_vertex_data[offset]),
+                                bitcast<f32>(gltf_vertex_data[offset + 1u]),
+                                bitcast<f32>(gltf_vertex_data[offset + 2u]));
+    result.normal = vec3<f32>(unpack2x16snorm(gltf_vertex_data[offset + 3u]),
+                              unpack2x16snorm(gltf_vertex_data[offset + 4u]).x);
+    result.uv = unpack2x16float(gltf_vertex_data[offset + 5u]);
+    result.color = unpack4x8unorm(gltf_vertex_data[offset + 6u]);
+    result.joint0 = (vec4<u32>(joint0) >> vec4<u32>(0u, 8u, 16u, 24u))
+                    & vec4<u32>(255u);
+    result.weight0 = unpack4x8unorm(gltf_vertex_data[offset + 8u]);
+    result.tangent = vec4<f32>(unpack2x16snorm(gltf_vertex_data[offset + 9u]),
+                               unpack2x16snorm(gltf_vertex_data[offset + 10u]));
+    return result;
+  }
+);
+// clang-format on
+
+void wgpu_gltf_get_vertex_pulling_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries)
+{
+  for (uint32_t i = 0; i < WGPU_GLTF_VERTEX_PULLING_BINDING_COUNT; ++i) {
+    entries[i] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: vertices, binding 1: indices
+      .binding    = i,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = 0,
+      },
+      .sampler = {0},
+    };
+  }
+}
+
+/* Concatenates the sources separated by new lines, free() the result */
+static char* gltf_concat_wgsl(const char* const* sources, uint32_t count)
+{
+  size_t length = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += strlen(sources[i]) + 1;
+  }
+  char* wgsl = (char*)malloc(length);
+  char* cur  = wgsl;
+  for (uint32_t i = 0; i < count; ++i) {
+    const size_t source_length = strlen(sources[i]);
+    memcpy(cur, sources[i], source_length);
+    cur += source_length;
+    *cur++ = '\n';
+  }
+  *cur = '\0';
+  return wgsl;
+}
+
+char* wgpu_gltf_create_vertex_pulling_wgsl(
+  wgpu_gltf_vertex_format_enum_t format, uint32_t group, const char* shader)
+{
+  char bindings[256];
+  snprintf(bindings, sizeof(bindings),
+           "@group(%u) @binding(0) var<storage, read> gltf_vertex_data : "
+           "array<u32>;\n"
+           "@group(%u) @binding(1) var<storage, read> gltf_index_data : "
+           "array<u32>;\n",
+           group, group);
+  const char* sources[4] = {
+    bindings,
+    gltf_vertex_pulling_common_wgsl,
+    format == WGPU_GLTF_VertexFormat_Quantized ?
+      gltf_vertex_pulling_quantized_wgsl :
+      gltf_vertex_pulling_default_wgsl,
+    shader,
+  };
+  return gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+}
+
+void wgpu_gltf_model_prepare_vertex_pulling_bind_group(
+  gltf_model_t* model, WGPUBindGroupLayout bind_group_layout)
+{
+  ASSERT(model->vertex_pulling.enabled);
+
+  WGPUBindGroupEntry bg_entries[WGPU_GLTF_VERTEX_PULLING_BINDING_COUNT] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = gltf_model_get_vertex_buffer(model),
+      .offset  = 0,
+      .size    = model->vertices.count
+                 * wgpu_gltf_get_vertex_format_size(model->vertices.format),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = model->indices.buffer,
+      .offset  = 0,
+      .size    = model->indices.count * sizeof(uint32_t),
+    },
+  };
+  WGPU_RELEASE_RESOURCE(BindGroup, model->vertex_pulling.bind_group)
+  model->vertex_pulling.bind_group = wgpuDeviceCreateBindGroup(
+    model->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(model->vertex_pulling.bind_group != NULL)
+}
+
+WGPUBindGroup wgpu_gltf_model_get_vertex_pulling_bind_group(gltf_model_t* model)
+{
+  return model->vertex_pulling.bind_group;
+}
+
+/*
+ * Packed textures
+ */
+// clang-format off
+static const char* gltf_packed_textures_wgsl = CODE(
+  struct GltfPackedMaterial {
+    base_color : u32,
+    metallic_roughness : u32,
+    normal : u32,
+    occlusion : u32,
+    emissive : u32
+  }
+
+  fn gltf_sample_packed(layer : u32, uv : vec2<f32>,
+                        fallback : vec4<f32>) -> vec4<f32> {
+    // The gradients are taken before branching on the layer
+    let ddx = dpdx(uv);
+    let ddy = dpdy(uv);
+    if (layer == 0xffffffffu) {
+      return fallback;
+    }
+    let index = i32(layer & 0xffffu);
+    switch (layer >> 16u) {
+      case 0u: {
+        return textureSampleGrad(gltf_packed_texture_0, gltf_packed_sampler,
+                                 uv, index, ddx, ddy);
       }
-      if (chan->target_path == cgltf_animation_path_type_scale) {
-        channel->path = PathType_SCALE;
+      case 1u: {
+        return textureSampleGrad(gltf_packed_texture_1, gltf_packed_sampler,
+                                 uv, index, ddx, ddy);
       }
-      if (chan->target_path == cgltf_animation_path_type_weights) {
-        log_warn("weights not yet supported, skipping channel");
-        continue;
+      case 2u: {
+        return textureSampleGrad(gltf_packed_texture_2, gltf_packed_sampler,
+                                 uv, index, ddx, ddy);
       }
-      channel->sampler_index = chan->sampler - anim->samplers;
-      channel->node
-        = gltf_model_node_from_index(model, chan->target_node - data->nodes);
-      if (!channel->node) {
-        continue;
+      default: {
+        return textureSampleGrad(gltf_packed_texture_3, gltf_packed_sampler,
+                                 uv, index, ddx, ddy);
       }
+    }
+  }
+);
+// clang-format on
 
-      channel->is_valid = true;
+void wgpu_gltf_get_packed_textures_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries)
+{
+  entries[0] = (WGPUBindGroupLayoutEntry) {
+    // Binding 0: packed layers of the material
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Fragment,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type             = WGPUBufferBindingType_ReadOnlyStorage,
+      .hasDynamicOffset = true,
+      .minBindingSize   = sizeof(gltf_packed_material_t),
+    },
+    .sampler = {0},
+  };
+  for (uint32_t i = 0; i < WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT; ++i) {
+    entries[1 + i] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1 - 4: texture arrays
+      .binding    = 1 + i,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2DArray,
+        .multisampled  = false,
+      },
+      .storageTexture = {0},
+    };
+  }
+  const uint32_t sampler_binding = WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT - 1;
+  entries[sampler_binding]       = (WGPUBindGroupLayoutEntry) {
+    // Binding 5: sampler of the texture arrays
+    .binding    = sampler_binding,
+    .visibility = WGPUShaderStage_Fragment,
+    .sampler = (WGPUSamplerBindingLayout) {
+      .type = WGPUSamplerBindingType_Filtering,
+    },
+    .texture = {0},
+  };
+}
+
+char* wgpu_gltf_create_packed_textures_wgsl(uint32_t group, const char* shader)
+{
+  char bindings[512];
+  int length = snprintf(bindings, sizeof(bindings),
+                        "@group(%u) @binding(0) var<storage, read> "
+                        "gltf_packed_material : GltfPackedMaterial;\n",
+                        group);
+  for (uint32_t i = 0; i < WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT; ++i) {
+    length += snprintf(bindings + length, sizeof(bindings) - length,
+                       "@group(%u) @binding(%u) var gltf_packed_texture_%u : "
+                       "texture_2d_array<f32>;\n",
+                       group, 1 + i, i);
+  }
+  snprintf(bindings + length, sizeof(bindings) - length,
+           "@group(%u) @binding(%u) var gltf_packed_sampler : sampler;\n",
+           group, WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT - 1);
+  const char* sources[3] = {
+    bindings,
+    gltf_packed_textures_wgsl,
+    shader,
+  };
+  return gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+}
+
+void wgpu_gltf_model_prepare_packed_textures_bind_group(
+  gltf_model_t* model, WGPUBindGroupLayout bind_group_layout)
+{
+  ASSERT(model->packed_textures.array_count > 0);
+
+  WGPUBindGroupEntry bg_entries[WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT] = {0};
+  bg_entries[0] = (WGPUBindGroupEntry){
+    .binding = 0,
+    .buffer  = model->packed_textures.material_buffer,
+    .offset  = 0,
+    .size    = sizeof(gltf_packed_material_t),
+  };
+  // The unused bindings repeat the first array, the sampler of the array with
+  // the most mip levels doesn't clamp the level of detail of the others
+  const texture_t* arrays = model->packed_textures.arrays;
+  uint32_t sampler_array  = 0;
+  for (uint32_t i = 0; i < WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT; ++i) {
+    const uint32_t a = (i < model->packed_textures.array_count) ? i : 0;
+    bg_entries[1 + i] = (WGPUBindGroupEntry){
+      .binding     = 1 + i,
+      .textureView = arrays[a].view,
+    };
+    if (arrays[a].mip_level_count > arrays[sampler_array].mip_level_count) {
+      sampler_array = a;
     }
   }
+  const uint32_t sampler_binding = WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT - 1;
+  bg_entries[sampler_binding]    = (WGPUBindGroupEntry){
+    .binding = sampler_binding,
+    .sampler = arrays[sampler_array].sampler,
+  };
+  WGPU_RELEASE_RESOURCE(BindGroup, model->packed_textures.bind_group)
+  model->packed_textures.bind_group = wgpuDeviceCreateBindGroup(
+    model->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(model->packed_textures.bind_group != NULL)
+}
+
+WGPUBindGroup
+wgpu_gltf_model_get_packed_textures_bind_group(gltf_model_t* model)
+{
+  return model->packed_textures.bind_group;
 }
 
-gltf_model_t* wgpu_gltf_model_load_from_file(
-  struct wgpu_gltf_model_load_options_t* load_options)
+uint32_t wgpu_gltf_model_get_packed_texture_array_count(gltf_model_t* model)
 {
-  uint32_t file_loading_flags = load_options->file_loading_flags;
-
-  gltf_model_t* gltf_model = NULL;
-
-  cgltf_options options = {0};
-  cgltf_data* gltf_data = NULL;
-  cgltf_result result
-    = cgltf_parse_file(&options, load_options->filename, &gltf_data);
+  return model->packed_textures.array_count;
+}
 
-  // Vertex buffer & Index buffer
-  gltf_vertex_t* vertices = NULL;
-  uint32_t* indices       = NULL;
+/*
+ * Material table
+ */
+// clang-format off
+static const char* gltf_material_table_wgsl = CODE(
+  struct GltfMaterial {
+    base_color_factor : vec4<f32>,
+    emissive_factor : vec4<f32>,
+    metallic_factor : f32,
+    roughness_factor : f32,
+    alpha_cutoff : f32,
+    alpha_mode : u32,
+    base_color_texture : u32,
+    metallic_roughness_texture : u32,
+    normal_texture : u32,
+    occlusion_texture : u32,
+    emissive_texture : u32,
+    tex_coord_sets : u32,
+    double_sided : u32,
+    padding : u32
+  }
 
-  if (result == cgltf_result_success) {
-    cgltf_result buffers_result
-      = cgltf_load_buffers(&options, gltf_data, load_options->filename);
+  fn gltf_get_material(material_index : u32) -> GltfMaterial {
+    return gltf_materials[material_index];
+  }
+);
+// clang-format on
 
-    if (buffers_result == cgltf_result_success) {
-      gltf_model = calloc(1, sizeof(gltf_model_t));
-      gltf_model_init(gltf_model, load_options);
+void wgpu_gltf_get_material_table_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries)
+{
+  entries[0] = (WGPUBindGroupLayoutEntry) {
+    // Binding 0: records of all materials
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type           = WGPUBufferBindingType_ReadOnlyStorage,
+      .minBindingSize = sizeof(gltf_material_record_t),
+    },
+    .sampler = {0},
+  };
+}
 
-      // Load samplers and images
-      if (!(file_loading_flags & WGPU_GLTF_FileLoadingFlags_DontLoadImages)) {
-        gltf_model_load_texture_samplers(gltf_model, gltf_data);
-        gltf_model_load_images(gltf_model, gltf_data);
-      }
+char* wgpu_gltf_create_material_table_wgsl(uint32_t group, const char* shader)
+{
+  char bindings[128];
+  snprintf(bindings, sizeof(bindings),
+           "@group(%u) @binding(0) var<storage, read> gltf_materials : "
+           "array<GltfMaterial>;\n",
+           group);
+  const char* sources[3] = {
+    bindings,
+    gltf_material_table_wgsl,
+    shader,
+  };
+  return gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+}
 
-      // Load materials
-      gltf_model_load_materials(gltf_model, gltf_data);
+void wgpu_gltf_model_prepare_material_table_bind_group(
+  gltf_model_t* model, WGPUBindGroupLayout bind_group_layout)
+{
+  ASSERT(model->material_table.enabled);
+
+  WGPUBindGroupEntry bg_entries[WGPU_GLTF_MATERIAL_TABLE_BINDING_COUNT] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = model->material_table.buffer,
+      .offset  = 0,
+      .size    = model->material_count * sizeof(gltf_material_record_t),
+    },
+  };
+  WGPU_RELEASE_RESOURCE(BindGroup, model->material_table.bind_group)
+  model->material_table.bind_group = wgpuDeviceCreateBindGroup(
+    model->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(model->material_table.bind_group != NULL)
+}
 
-      // If there is no default scene specified, then the default is the first
-      // one. It is not an error for a glTF file to have zero scenes.
-      const cgltf_scene* scene
-        = gltf_data->scene ? gltf_data->scene : gltf_data->scenes;
-      if (!scene) {
-        return NULL;
-      }
+WGPUBindGroup wgpu_gltf_model_get_material_table_bind_group(gltf_model_t* model)
+{
+  return model->material_table.bind_group;
+}
 
-      // Vertex buffer & Index buffer
-      gltf_model->vertices.count = 0;
-      gltf_model->indices.count  = 0;
+void wgpu_gltf_model_update_material_table(gltf_model_t* model)
+{
+  if (model->material_table.buffer != NULL) {
+    gltf_model_write_material_table(model);
+  }
+}
 
-      // Nodes and meshes
-      gltf_model->node_count = (uint32_t)gltf_data->nodes_count;
-      gltf_model->nodes = calloc(gltf_model->node_count, sizeof(gltf_node_t));
+/*
+ * Mesh instancing
+ */
+// clang-format off
+static const char* gltf_instancing_wgsl = CODE(
+  fn gltf_get_instance_matrix(instance_index : u32) -> mat4x4<f32> {
+    return gltf_instances[instance_index];
+  }
+);
+// clang-format on
 
-      gltf_model->linear_nodes
-        = calloc(gltf_model->node_count, sizeof(gltf_node_t*));
+void wgpu_gltf_get_instancing_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries)
+{
+  entries[0] = (WGPUBindGroupLayoutEntry) {
+    // Binding 0: world matrices of all instances
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Vertex,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type           = WGPUBufferBindingType_ReadOnlyStorage,
+      .minBindingSize = sizeof(mat4),
+    },
+    .sampler = {0},
+  };
+}
 
-      gltf_model->mesh_count = (uint32_t)gltf_data->meshes_count;
-      gltf_model->meshes = calloc(gltf_model->mesh_count, sizeof(gltf_mesh_t));
+char* wgpu_gltf_create_instancing_wgsl(uint32_t group, const char* shader)
+{
+  char bindings[128];
+  snprintf(bindings, sizeof(bindings),
+           "@group(%u) @binding(0) var<storage, read> gltf_instances : "
+           "array<mat4x4<f32>>;\n",
+           group);
+  const char* sources[3] = {
+    bindings,
+    gltf_instancing_wgsl,
+    shader,
+  };
+  return gltf_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+}
 
-      // Recursively create all nodes.
-      for (cgltf_size i = 0, len = scene->nodes_count; i < len; ++i) {
-        gltf_model_load_node(gltf_model, NULL, scene->nodes[i], gltf_data,
-                             &vertices, &gltf_model->vertices.count, &indices,
-                             &gltf_model->indices.count, load_options->scale);
-      }
+void wgpu_gltf_model_prepare_instancing_bind_group(
+  gltf_model_t* model, WGPUBindGroupLayout bind_group_layout)
+{
+  ASSERT(model->instancing.enabled);
+
+  WGPUBindGroupEntry bg_entries[WGPU_GLTF_INSTANCING_BINDING_COUNT] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = model->instancing.buffer.buffer,
+      .offset  = 0,
+      .size    = model->instancing.buffer.size,
+    },
+  };
+  WGPU_RELEASE_RESOURCE(BindGroup, model->instancing.bind_group)
+  model->instancing.bind_group = wgpuDeviceCreateBindGroup(
+    model->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(model->instancing.bind_group != NULL)
+}
 
-      // Load animations
-      if (gltf_data->animations_count > 0) {
-        gltf_model_load_animations(gltf_model, gltf_data);
-      }
+WGPUBindGroup wgpu_gltf_model_get_instancing_bind_group(gltf_model_t* model)
+{
+  return model->instancing.bind_group;
+}
 
-      // Load skins
-      gltf_model_load_skins(gltf_model, gltf_data);
+void wgpu_gltf_model_prepare_depth_pipelines(
+  gltf_model_t* model, const wgpu_gltf_depth_pipeline_desc_t* desc)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
 
-      // Assign skins and initial pose
-      for (uint32_t i = 0; i < gltf_model->linear_node_count; ++i) {
-        gltf_node_t* node = gltf_model->linear_nodes[i];
-        // Assign skins
-        if (node->skin_index > -1) {
-          node->skin = &gltf_model->skins[(uint32_t)node->skin_index];
-        }
-        // Initial pose
-        if (node->mesh != NULL) {
-          gltf_node_update(gltf_model->wgpu_context, node);
-        }
-      }
-    }
-  }
-  else {
-    log_error("Could not load gltf file: %s, error: %d\n",
-              load_options->filename, result);
-    return NULL;
+  // Vertex buffer layout, only the positions are read
+  WGPU_GLTF_VERTEX_FORMAT_BUFFER_LAYOUT(
+    depth, model->vertices.format,
+    // Location 0: Position
+    WGPU_GLTF_VERTATTR_FORMAT_DESC(model->vertices.format, 0,
+                                   WGPU_GLTF_VertexComponent_Position));
+
+  // Vertex state
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label            = "glTF depth pre-pass vertex shader",
+                      .wgsl_code.source = desc->vertex_wgsl_code,
+                    },
+                    .buffer_count = 1,
+                    .buffers      = &depth_vertex_buffer_layout,
+                  });
+
+  // Optional fragment state of the color target
+  WGPUColorTargetState color_target_state = {
+    .format    = desc->color_format,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  WGPUFragmentState fragment_state = {0};
+  if (desc->fragment_wgsl_code != NULL) {
+    ASSERT(desc->color_format != WGPUTextureFormat_Undefined);
+    fragment_state = wgpu_create_fragment_state(
+      wgpu_context, &(wgpu_fragment_state_t){
+                      .shader_desc = (wgpu_shader_desc_t){
+                        .label = "glTF depth pre-pass fragment shader",
+                        .wgsl_code.source = desc->fragment_wgsl_code,
+                      },
+                      .target_count = 1,
+                      .targets      = &color_target_state,
+                    });
   }
 
-  ASSERT(gltf_model != NULL);
+  // Depth stencil state
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = desc->depth_format,
+      .depth_write_enabled = true,
+    });
 
-  // Pre-Calculations for requested features
-  if ((file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreTransformVertices)
-      || (file_loading_flags
-          & WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors)
-      || (file_loading_flags & WGPU_GLTF_FileLoadingFlags_FlipY)) {
-    const bool preTransform
-      = file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreTransformVertices;
-    const bool preMultiplyColor
-      = file_loading_flags & WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors;
-    const bool flipY = file_loading_flags & WGPU_GLTF_FileLoadingFlags_FlipY;
-    for (uint32_t n = 0; n < gltf_model->linear_node_count; ++n) {
-      gltf_node_t* node = gltf_model->linear_nodes[n];
-      if (node->mesh != NULL) {
-        mat4 local_matrix = GLM_MAT4_ZERO_INIT;
-        gltf_node_get_matrix(node, &local_matrix);
-        for (uint32_t p = 0; p < node->mesh->primitive_count; ++p) {
-          gltf_primitive_t* primitive = &node->mesh->primitives[p];
-          for (uint32_t i = 0; i < primitive->vertex_count; ++i) {
-            gltf_vertex_t* vertex = &vertices[primitive->first_vertex + i];
-            // Pre-transform vertex positions by node-hierarchy
-            if (preTransform) {
-              // Vertex position
-              vec4 vertex_pos_tmp = GLM_VEC4_ZERO_INIT;
-              glm_vec4(vertex->pos, 1.0f, vertex_pos_tmp);
-              glm_mat4_mulv(local_matrix, vertex_pos_tmp, vertex_pos_tmp);
-              glm_vec3(vertex_pos_tmp, vertex->pos);
-              // Vertex normal
-              mat3 local_matrix_tmp = GLM_MAT3_ZERO_INIT;
-              glm_mat4_pick3(local_matrix, local_matrix_tmp);
-              vec3 mulv_result;
-              glm_mat3_mulv(local_matrix_tmp, vertex->normal, mulv_result);
-              glm_normalize_to(mulv_result, vertex->normal);
-            }
-            // Flip Y-Axis of vertex positions
-            if (flipY) {
-              vertex->pos[1] *= -1.0f;
-              vertex->normal[1] *= -1.0f;
-            }
-            // Pre-Multiply vertex colors with material base color
-            if (preMultiplyColor) {
-              glm_vec4_mul(primitive->material->base_color_factor,
-                           vertex->color, vertex->color);
-            }
-          }
-        }
-      }
+  // Materials with the same cull mode share the pipeline
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    gltf_material_t* material = &model->materials[i];
+    WGPU_RELEASE_RESOURCE(RenderPipeline, material->depth_pipeline)
+    if (material->alpha_mode != AlphaMode_OPAQUE) {
+      continue;
     }
+    material->depth_pipeline = wgpu_create_render_pipeline(
+      wgpu_context,
+      &(WGPURenderPipelineDescriptor){
+        .label     = "glTF depth pre-pass render pipeline",
+        .layout    = desc->layout,
+        .primitive = (WGPUPrimitiveState){
+          .topology  = WGPUPrimitiveTopology_TriangleList,
+          .frontFace = WGPUFrontFace_CCW,
+          .cullMode  = (desc->double_sided || material->double_sided) ?
+                         WGPUCullMode_None :
+                         WGPUCullMode_Back,
+        },
+        .vertex       = vertex_state,
+        .fragment     = desc->fragment_wgsl_code ? &fragment_state : NULL,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = wgpu_create_multisample_state_descriptor(
+          &(create_multisample_state_desc_t){
+            .sample_count = MAX(desc->sample_count, 1u),
+          }),
+      });
+    ASSERT(material->depth_pipeline != NULL)
   }
 
-  // Vertex and index buffers
-  size_t vertex_buffer_size
-    = gltf_model->vertices.count * sizeof(gltf_vertex_t);
-  size_t index_buffer_size = gltf_model->indices.count * sizeof(uint32_t);
-
-  assert((vertex_buffer_size > 0) && (index_buffer_size > 0));
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module)
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module)
+}
 
-  // Create vertex buffer
-  gltf_model->vertices.buffer
-    = wgpu_create_buffer_from_data(load_options->wgpu_context, vertices,
-                                   vertex_buffer_size, WGPUBufferUsage_Vertex);
+static uint32_t gltf_material_get_render_flag(gltf_material_t* material)
+{
+  switch (material->alpha_mode) {
+    case AlphaMode_MASK:
+      return WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes;
+    case AlphaMode_BLEND:
+      return WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes;
+    default:
+      return WGPU_GLTF_RenderFlags_RenderOpaqueNodes;
+  }
+}
 
-  // Create index buffer
-  gltf_model->indices.buffer
-    = wgpu_create_buffer_from_data(load_options->wgpu_context, indices,
-                                   index_buffer_size, WGPUBufferUsage_Index);
+/* The alpha mode render flags can be combined, all materials are rendered if
+ * none of them is set */
+static bool gltf_material_skip(gltf_material_t* material,
+                               uint32_t render_flags)
+{
+  const uint32_t alpha_mode_flags = render_flags & GLTF_ALPHA_MODE_RENDER_FLAGS;
+  return alpha_mode_flags != 0
+         && !(alpha_mode_flags & gltf_material_get_render_flag(material));
+}
 
-  if (vertices != NULL) {
-    free(vertices);
+/* Tests the world space bounds of the primitive against the frustum, skinned
+ * meshes are not culled since their bounds change with the animation */
+static bool gltf_model_primitive_visible(gltf_model_t* model,
+                                         gltf_node_t* node,
+                                         gltf_primitive_t* primitive,
+                                         frustum_t* frustum)
+{
+  // The bounds of skinned and morphed primitives are unknown
+  if (frustum == NULL || !primitive->bb.valid || node->skin != NULL
+      || primitive->morph_target_count > 0) {
+    return true;
   }
-  if (indices != NULL) {
-    free(indices);
+  if (model->instancing.enabled) {
+    // Bounds of all instances of the mesh
+    const bounding_box_t* bb = &node->mesh->instances.bb;
+    return !bb->valid || frustum_check_box(frustum, bb->min, bb->max);
   }
+  bounding_box_t world_bb = primitive->bb;
+  if (!model->pre_transformed) {
+    bounding_get_aabb(&primitive->bb, node->world_matrix, &world_bb);
+  }
+  return frustum_check_box(frustum, world_bb.min, world_bb.max);
+}
 
-  // Get scene dimensions
-  gltf_model_get_scene_dimensions(gltf_model);
+/*
+ * Selects the level of detail by the projected size of the primitive's world
+ * space bounds: the diameter of the bounding sphere relative to the viewport
+ * height. The clip space w is the view depth and the length of the clip space
+ * y row the vertical projection scale.
+ */
+static uint32_t
+gltf_model_select_lod(gltf_model_t* model, gltf_node_t* node,
+                      gltf_primitive_t* primitive,
+                      const wgpu_gltf_model_render_options_t* render_options)
+{
+  if (primitive->lod_count == 0 || !primitive->bb.valid || node->skin != NULL
+      || (model->instancing.enabled && node->mesh->instances.count > 1)) {
+    return 0;
+  }
+  bounding_box_t world_bb = primitive->bb;
+  if (!model->pre_transformed) {
+    bounding_get_aabb(&primitive->bb, node->world_matrix, &world_bb);
+  }
+  vec3 center;
+  glm_vec3_center(world_bb.min, world_bb.max, center);
+  const float radius = glm_vec3_distance(world_bb.min, world_bb.max) * 0.5f;
+
+  const vec4* vp  = render_options->view_projection;
+  const float w   = vp[0][3] * center[0] + vp[1][3] * center[1]
+                  + vp[2][3] * center[2] + vp[3][3];
+  const float p_y = sqrtf(vp[0][1] * vp[0][1] + vp[1][1] * vp[1][1]
+                          + vp[2][1] * vp[2][1]);
+  if (w <= radius) {
+    // The camera is inside of the bounds
+    return 0;
+  }
+  const float size = radius * p_y / w;
+
+  float threshold = render_options->lod_threshold > 0.0f ?
+                      render_options->lod_threshold :
+                      GLTF_LOD_DEFAULT_THRESHOLD;
+  uint32_t lod = 0;
+  while (lod < primitive->lod_count && size < threshold) {
+    ++lod;
+    threshold *= 0.5f;
+  }
+  return lod;
+}
 
-  // Cleanup
-  cgltf_free(gltf_data);
+/* The draws of material table models pass the material index as first
+ * instance, the draws of instancing models the first instance of the mesh */
+static uint32_t gltf_model_get_first_instance(gltf_model_t* model,
+                                              const gltf_mesh_t* mesh,
+                                              const gltf_material_t* material)
+{
+  if (model->instancing.enabled) {
+    return mesh->instances.first;
+  }
+  return model->material_table.enabled ?
+           gltf_model_get_material_index(model, material) :
+           0;
+}
 
-  return gltf_model;
+/* Instances drawn by the node, the first node of an instanced mesh draws the
+ * instances of all nodes referencing it and the others none */
+static uint32_t gltf_model_get_instance_count(gltf_model_t* model,
+                                              const gltf_node_t* node,
+                                              uint32_t instance_count)
+{
+  if (!model->instancing.enabled) {
+    return instance_count;
+  }
+  return node->mesh->instances.node == node ? node->mesh->instances.count : 0;
 }
 
-static void gltf_model_bind_buffers(gltf_model_t* model)
+/* Dynamic offset of the packed layers of the material */
+static uint32_t
+gltf_model_get_packed_material_offset(gltf_model_t* model,
+                                      const gltf_material_t* material)
 {
-  wgpu_context_t* wgpu_context = model->wgpu_context;
-  wgpuRenderPassEncoderSetVertexBuffer(
-    wgpu_context->rpass_enc, 0, model->vertices.buffer, 0, WGPU_WHOLE_SIZE);
-  wgpuRenderPassEncoderSetIndexBuffer(
-    wgpu_context->rpass_enc, model->indices.buffer, WGPUIndexFormat_Uint32, 0,
-    WGPU_WHOLE_SIZE);
-  // model->buffers_bound = true;
+  return gltf_model_get_material_index(model, material)
+         * (uint32_t)model->packed_textures.material_stride;
 }
 
 static void
 gltf_model_draw_node(gltf_model_t* model, gltf_node_t* node,
-                     wgpu_gltf_model_render_options_t render_options)
+                     wgpu_gltf_model_render_options_t render_options,
+                     frustum_t* frustum)
 {
   uint32_t render_flags = render_options.render_flags;
+  const bool depth_only = (render_flags & WGPU_GLTF_RenderFlags_DepthOnly);
 
-  if (node->mesh && node->mesh->primitive_count > 0) {
+  const uint32_t instance_count
+    = node->mesh ? gltf_model_get_instance_count(
+                     model, node, MAX(render_options.instance_count, 1)) :
+                   0;
+
+  if (node->mesh && node->mesh->primitive_count > 0 && instance_count > 0) {
     if (node->mesh->uniform_buffer.bind_group) {
       wgpuRenderPassEncoderSetBindGroup(
         model->wgpu_context->rpass_enc, render_options.bind_mesh_model_set,
@@ -1606,37 +5834,74 @@ gltf_model_draw_node(gltf_model_t* model, gltf_node_t* node,
     }
     for (uint32_t i = 0; i < node->mesh->primitive_count; ++i) {
       gltf_primitive_t* primitive = &node->mesh->primitives[i];
-      bool skip                   = false;
       gltf_material_t* material   = primitive->material;
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderOpaqueNodes) {
-        skip = (material->alpha_mode != AlphaMode_OPAQUE);
-      }
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes) {
-        skip = (material->alpha_mode != AlphaMode_MASK);
-      }
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes) {
-        skip = (material->alpha_mode != AlphaMode_BLEND);
+      if (depth_only && material->depth_pipeline == NULL) {
+        continue;
       }
-      if (!skip) {
+      if (!gltf_material_skip(material, render_flags)
+          && gltf_model_primitive_visible(model, node, primitive, frustum)) {
         // Bind the pipeline for the node's material if present
-        if (material->pipeline) {
+        WGPURenderPipeline pipeline
+          = depth_only ? material->depth_pipeline : material->pipeline;
+        if (pipeline) {
           wgpuRenderPassEncoderSetPipeline(model->wgpu_context->rpass_enc,
-                                           material->pipeline);
+                                           pipeline);
         }
-        if ((render_flags & WGPU_GLTF_RenderFlags_BindImages)
-            && material->bind_group) {
+        if ((render_flags & WGPU_GLTF_RenderFlags_BindImages) && !depth_only
+            && model->packed_textures.bind_group) {
+          const uint32_t offset = gltf_model_get_packed_material_offset(
+            model, material);
+          wgpuRenderPassEncoderSetBindGroup(
+            model->wgpu_context->rpass_enc, render_options.bind_image_set,
+            model->packed_textures.bind_group, 1, &offset);
+        }
+        else if ((render_flags & WGPU_GLTF_RenderFlags_BindImages)
+                 && !depth_only && material->bind_group) {
           wgpuRenderPassEncoderSetBindGroup(model->wgpu_context->rpass_enc,
                                             render_options.bind_image_set,
                                             material->bind_group, 0, 0);
         }
-        wgpuRenderPassEncoderDrawIndexed(model->wgpu_context->rpass_enc,
-                                         primitive->index_count, 1,
-                                         primitive->first_index, 0, 0);
+        if (model->meshlet_culling.enabled && primitive->draw_index >= 0) {
+          // The index count is written by the meshlet culling pass
+          wgpuRenderPassEncoderDrawIndexedIndirect(
+            model->wgpu_context->rpass_enc, model->meshlet_culling.draw_buffer,
+            (uint64_t)primitive->draw_index
+              * sizeof(gltf_draw_indexed_indirect_t));
+        }
+        else {
+          const gltf_primitive_lod_t lod = gltf_primitive_get_lod(
+            primitive,
+            (render_flags & WGPU_GLTF_RenderFlags_SelectLod) ?
+              gltf_model_select_lod(model, node, primitive, &render_options) :
+              0);
+          if (render_flags & WGPU_GLTF_RenderFlags_PullIndices) {
+            // The vertex shader pulls the indices
+            wgpuRenderPassEncoderDraw(
+              model->wgpu_context->rpass_enc, lod.index_count, instance_count,
+              lod.first_index,
+              gltf_model_get_first_instance(model, node->mesh, material));
+          }
+          else if (primitive->index_format == WGPUIndexFormat_Uint16) {
+            // The compact indices are relative to the first vertex
+            gltf_model_bind_index_format(model, WGPUIndexFormat_Uint16);
+            wgpuRenderPassEncoderDrawIndexed(
+              model->wgpu_context->rpass_enc, lod.index_count, instance_count,
+              lod.first_compact_index, (int32_t)primitive->first_vertex,
+              gltf_model_get_first_instance(model, node->mesh, material));
+          }
+          else {
+            gltf_model_bind_index_format(model, WGPUIndexFormat_Uint32);
+            wgpuRenderPassEncoderDrawIndexed(
+              model->wgpu_context->rpass_enc, lod.index_count, instance_count,
+              lod.first_index, 0,
+              gltf_model_get_first_instance(model, node->mesh, material));
+          }
+        }
       }
     }
   }
   for (uint32_t i = 0; i < node->child_count; ++i) {
-    gltf_model_draw_node(model, node->children[i], render_options);
+    gltf_model_draw_node(model, node->children[i], render_options, frustum);
   }
 }
 
@@ -1649,10 +5914,409 @@ void wgpu_gltf_model_draw(gltf_model_t* model,
     // bind once
     gltf_model_bind_buffers(model);
   }
+  // Frustum planes for culling the primitives
+  frustum_t frustum;
+  const bool frustum_culling
+    = (render_options.render_flags & WGPU_GLTF_RenderFlags_FrustumCulling) != 0;
+  if (frustum_culling) {
+    frustum_update(&frustum, render_options.view_projection);
+  }
   // Render all nodes at top-level
   for (uint32_t i = 0; i < model->node_count; ++i) {
-    gltf_model_draw_node(model, &model->nodes[i], render_options);
+    gltf_model_draw_node(model, &model->nodes[i], render_options,
+                         frustum_culling ? &frustum : NULL);
+  }
+}
+
+/*
+ * Retained draw list
+ */
+typedef struct gltf_draw_item_t {
+  WGPURenderPipeline pipeline;
+  WGPURenderPipeline depth_pipeline;
+  WGPUBindGroup material_bind_group;
+  /* Offset of the packed textures bind group, see material_offset_count */
+  uint32_t material_offset;
+  uint32_t material_offset_count;
+  /* material index of material table models, first instance of the mesh of
+   * instancing models */
+  uint32_t first_instance;
+  uint32_t instance_count;
+  WGPUBindGroup mesh_bind_group;
+  gltf_node_t* node;
+  gltf_primitive_t* primitive;
+  float distance; /* squared distance to the camera, sorted items */
+} gltf_draw_item_t;
+
+/* The buckets are drawn in this order */
+typedef enum gltf_draw_bucket_t {
+  DrawBucket_Opaque       = 0,
+  DrawBucket_AlphaMasked  = 1,
+  DrawBucket_AlphaBlended = 2,
+  DrawBucket_Count        = 3,
+} gltf_draw_bucket_t;
+
+static const uint32_t gltf_draw_bucket_render_flags[DrawBucket_Count] = {
+  [DrawBucket_Opaque]       = WGPU_GLTF_RenderFlags_RenderOpaqueNodes,
+  [DrawBucket_AlphaMasked]  = WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes,
+  [DrawBucket_AlphaBlended] = WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes,
+};
+
+struct wgpu_gltf_draw_list {
+  gltf_model_t* model;
+  wgpu_gltf_model_render_options_t render_options;
+  gltf_draw_item_t* items;
+  struct {
+    gltf_draw_item_t* items; /* points into the items array */
+    uint32_t count;
+  } buckets[DrawBucket_Count];
+  /* Order of the opaque items in depth-only draws */
+  gltf_draw_item_t** depth_order;
+};
+
+static gltf_draw_bucket_t gltf_material_get_draw_bucket(gltf_material_t* m)
+{
+  switch (m->alpha_mode) {
+    case AlphaMode_MASK:
+      return DrawBucket_AlphaMasked;
+    case AlphaMode_BLEND:
+      return DrawBucket_AlphaBlended;
+    default:
+      return DrawBucket_Opaque;
+  }
+}
+
+static int gltf_compare_handles(const void* a, const void* b)
+{
+  const uintptr_t ha = (uintptr_t)a, hb = (uintptr_t)b;
+  return (ha > hb) - (ha < hb);
+}
+
+/* Sort by pipeline, then material bind group and offset, then mesh */
+static int gltf_draw_item_compare(const void* a, const void* b)
+{
+  const gltf_draw_item_t* ia = (const gltf_draw_item_t*)a;
+  const gltf_draw_item_t* ib = (const gltf_draw_item_t*)b;
+  int result                 = gltf_compare_handles(ia->pipeline, ib->pipeline);
+  if (result == 0) {
+    result = gltf_compare_handles(ia->material_bind_group,
+                                  ib->material_bind_group);
+  }
+  if (result == 0) {
+    result = (ia->material_offset > ib->material_offset)
+             - (ia->material_offset < ib->material_offset);
+  }
+  if (result == 0) {
+    result = gltf_compare_handles(ia->mesh_bind_group, ib->mesh_bind_group);
+  }
+  if (result == 0) {
+    result = (ia->primitive->first_index > ib->primitive->first_index)
+             - (ia->primitive->first_index < ib->primitive->first_index);
+  }
+  return result;
+}
+
+/* Sort back-to-front */
+static int gltf_draw_item_compare_distance(const void* a, const void* b)
+{
+  const gltf_draw_item_t* ia = (const gltf_draw_item_t*)a;
+  const gltf_draw_item_t* ib = (const gltf_draw_item_t*)b;
+  return (ia->distance < ib->distance) - (ia->distance > ib->distance);
+}
+
+/* Sort item pointers front-to-back */
+static int gltf_draw_item_ref_compare_distance(const void* a, const void* b)
+{
+  const gltf_draw_item_t* ia = *(gltf_draw_item_t* const*)a;
+  const gltf_draw_item_t* ib = *(gltf_draw_item_t* const*)b;
+  return (ia->distance > ib->distance) - (ia->distance < ib->distance);
+}
+
+/* Records the buckets of the draw list selected by the render flags,
+ * redundant pipeline and bind group changes are skipped. Type is
+ * RenderPassEncoder or RenderBundleEncoder. */
+#define GLTF_DRAW_LIST_RECORD(Type, enc, draw_list, render_flags)              \
+  {                                                                            \
+    gltf_model_t* model = (draw_list)->model;                                  \
+    const wgpu_gltf_model_render_options_t* options                            \
+      = &(draw_list)->render_options;                                          \
+    WGPURenderPipeline bound_pipeline  = NULL;                                 \
+    WGPUBindGroup bound_material_group = NULL;                                 \
+    uint32_t bound_material_offset     = 0;                                    \
+    WGPUBindGroup bound_mesh_group     = NULL;                                 \
+    wgpu##Type##SetVertexBuffer(enc, 0, gltf_model_get_vertex_buffer(model),   \
+                                0, WGPU_WHOLE_SIZE);                           \
+    wgpu##Type##SetIndexBuffer(enc, gltf_model_get_index_buffer(model),        \
+                               WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);    \
+    WGPUIndexFormat bound_index_format = WGPUIndexFormat_Uint32;               \
+    const bool depth_only = (render_flags & WGPU_GLTF_RenderFlags_DepthOnly);  \
+    for (uint32_t b = 0; b < DrawBucket_Count; ++b) {                          \
+      if (!gltf_draw_list_bucket_selected(b, render_flags)) {                  \
+        continue;                                                              \
+      }                                                                        \
+      for (uint32_t i = 0; i < (draw_list)->buckets[b].count; ++i) {           \
+        const gltf_draw_item_t* item                                           \
+          = (depth_only && b == DrawBucket_Opaque) ?                           \
+              (draw_list)->depth_order[i] :                                    \
+              &(draw_list)->buckets[b].items[i];                               \
+        WGPURenderPipeline pipeline                                            \
+          = depth_only ? item->depth_pipeline : item->pipeline;                \
+        if (depth_only && pipeline == NULL) {                                  \
+          continue;                                                            \
+        }                                                                      \
+        if (pipeline && pipeline != bound_pipeline) {                          \
+          wgpu##Type##SetPipeline(enc, pipeline);                              \
+          bound_pipeline = pipeline;                                           \
+        }                                                                      \
+        if (!depth_only && item->material_bind_group                           \
+            && (item->material_bind_group != bound_material_group              \
+                || item->material_offset != bound_material_offset)) {          \
+          wgpu##Type##SetBindGroup(enc, options->bind_image_set,               \
+                                   item->material_bind_group,                  \
+                                   item->material_offset_count,                \
+                                   &item->material_offset);                    \
+          bound_material_group  = item->material_bind_group;                   \
+          bound_material_offset = item->material_offset;                       \
+        }                                                                      \
+        if (item->mesh_bind_group                                              \
+            && item->mesh_bind_group != bound_mesh_group) {                    \
+          wgpu##Type##SetBindGroup(enc, options->bind_mesh_model_set,          \
+                                   item->mesh_bind_group, 0, 0);               \
+          bound_mesh_group = item->mesh_bind_group;                            \
+        }                                                                      \
+        const gltf_primitive_t* primitive = item->primitive;                   \
+        if (model->meshlet_culling.enabled && primitive->draw_index >= 0) {    \
+          wgpu##Type##DrawIndexedIndirect(                                     \
+            enc, model->meshlet_culling.draw_buffer,                           \
+            (uint64_t)primitive->draw_index                                    \
+              * sizeof(gltf_draw_indexed_indirect_t));                         \
+        }                                                                      \
+        else if (render_flags & WGPU_GLTF_RenderFlags_PullIndices) {           \
+          wgpu##Type##Draw(enc, primitive->index_count, item->instance_count,  \
+                           primitive->first_index, item->first_instance);      \
+        }                                                                      \
+        else {                                                                 \
+          const WGPUIndexFormat index_format = primitive->index_format;        \
+          if (index_format != bound_index_format) {                            \
+            wgpu##Type##SetIndexBuffer(                                        \
+              enc,                                                             \
+              index_format == WGPUIndexFormat_Uint16 ?                         \
+                model->compact_indices.buffer :                                \
+                gltf_model_get_index_buffer(model),                            \
+              index_format, 0, WGPU_WHOLE_SIZE);                               \
+            bound_index_format = index_format;                                 \
+          }                                                                    \
+          if (index_format == WGPUIndexFormat_Uint16) {                        \
+            wgpu##Type##DrawIndexed(enc, primitive->index_count,               \
+                                    item->instance_count,                      \
+                                    primitive->first_compact_index,            \
+                                    (int32_t)primitive->first_vertex,          \
+                                    item->first_instance);                     \
+          }                                                                    \
+          else {                                                               \
+            wgpu##Type##DrawIndexed(enc, primitive->index_count,               \
+                                    item->instance_count,                      \
+                                    primitive->first_index, 0,                 \
+                                    item->first_instance);                     \
+          }                                                                    \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }
+
+static bool gltf_draw_list_bucket_selected(uint32_t bucket,
+                                           uint32_t render_flags)
+{
+  return !(render_flags & GLTF_ALPHA_MODE_RENDER_FLAGS)
+         || (render_flags & gltf_draw_bucket_render_flags[bucket]);
+}
+
+wgpu_gltf_draw_list_t*
+wgpu_gltf_draw_list_create(gltf_model_t* model,
+                           wgpu_gltf_model_render_options_t render_options)
+{
+  wgpu_gltf_draw_list_t* draw_list = calloc(1, sizeof(*draw_list));
+  draw_list->model                 = model;
+  draw_list->render_options        = render_options;
+
+  // Count the items of each bucket, every node is visited once since the
+  // linear nodes contain the whole hierarchy
+  const uint32_t render_flags = render_options.render_flags;
+  uint32_t item_count         = 0;
+  for (uint32_t n = 0; n < model->linear_node_count; ++n) {
+    gltf_node_t* node = model->linear_nodes[n];
+    gltf_mesh_t* mesh = node->mesh;
+    if (mesh == NULL || gltf_model_get_instance_count(model, node, 1) == 0) {
+      continue;
+    }
+    for (uint32_t i = 0; i < mesh->primitive_count; ++i) {
+      gltf_primitive_t* primitive = &mesh->primitives[i];
+      if (primitive->index_count == 0
+          || gltf_material_skip(primitive->material, render_flags)) {
+        continue;
+      }
+      draw_list->buckets[gltf_material_get_draw_bucket(primitive->material)]
+        .count++;
+      ++item_count;
+    }
+  }
+  if (item_count == 0) {
+    return draw_list;
+  }
+  draw_list->items = calloc(item_count, sizeof(gltf_draw_item_t));
+  for (uint32_t b = 0, offset = 0; b < DrawBucket_Count; ++b) {
+    draw_list->buckets[b].items = draw_list->items + offset;
+    offset += draw_list->buckets[b].count;
+    draw_list->buckets[b].count = 0;
+  }
+
+  // Fill the buckets in a single traversal, all materials share the packed
+  // textures bind group with their own offset
+  const bool bind_images = (render_flags & WGPU_GLTF_RenderFlags_BindImages);
+  const bool bind_packed = bind_images && model->packed_textures.bind_group;
+  for (uint32_t n = 0; n < model->linear_node_count; ++n) {
+    gltf_node_t* node = model->linear_nodes[n];
+    gltf_mesh_t* mesh = node->mesh;
+    const uint32_t instance_count
+      = mesh != NULL ? gltf_model_get_instance_count(model, node, 1) : 0;
+    for (uint32_t i = 0; instance_count > 0 && i < mesh->primitive_count; ++i) {
+      gltf_primitive_t* primitive = &mesh->primitives[i];
+      gltf_material_t* material   = primitive->material;
+      if (primitive->index_count == 0
+          || gltf_material_skip(material, render_flags)) {
+        continue;
+      }
+      const gltf_draw_bucket_t b = gltf_material_get_draw_bucket(material);
+      gltf_draw_item_t* item
+        = &draw_list->buckets[b].items[draw_list->buckets[b].count++];
+      const uint32_t first_instance
+        = gltf_model_get_first_instance(model, mesh, material);
+      *item = (gltf_draw_item_t){
+        .pipeline            = material->pipeline,
+        .depth_pipeline      = material->depth_pipeline,
+        .material_bind_group = bind_images ? material->bind_group : NULL,
+        .first_instance      = first_instance,
+        .instance_count      = instance_count,
+        .mesh_bind_group     = mesh->uniform_buffer.bind_group,
+        .node                = node,
+        .primitive           = primitive,
+      };
+      if (bind_packed) {
+        item->material_bind_group = model->packed_textures.bind_group;
+        item->material_offset
+          = gltf_model_get_packed_material_offset(model, material);
+        item->material_offset_count = 1;
+      }
+    }
+  }
+
+  // Opaque and alpha masked items are sorted by state, alpha blended items
+  // keep the tree order until wgpu_gltf_draw_list_sort_blended() is called
+  for (uint32_t b = DrawBucket_Opaque; b <= DrawBucket_AlphaMasked; ++b) {
+    if (draw_list->buckets[b].count > 1) {
+      qsort(draw_list->buckets[b].items, draw_list->buckets[b].count,
+            sizeof(gltf_draw_item_t), gltf_draw_item_compare);
+    }
+  }
+
+  // Depth-only draws use the state sorted order until
+  // wgpu_gltf_draw_list_sort_opaque() is called
+  const uint32_t opaque_count = draw_list->buckets[DrawBucket_Opaque].count;
+  draw_list->depth_order = calloc(opaque_count, sizeof(gltf_draw_item_t*));
+  for (uint32_t i = 0; i < opaque_count; ++i) {
+    draw_list->depth_order[i] = &draw_list->buckets[DrawBucket_Opaque].items[i];
+  }
+
+  return draw_list;
+}
+
+void wgpu_gltf_draw_list_release(wgpu_gltf_draw_list_t* draw_list)
+{
+  if (draw_list == NULL) {
+    return;
+  }
+  free(draw_list->items);
+  free(draw_list->depth_order);
+  free(draw_list);
+}
+
+/* Squared distances of the node bounding box centers to the camera */
+static void gltf_draw_items_update_distances(gltf_draw_item_t* items,
+                                             uint32_t count,
+                                             vec3 camera_position)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    gltf_node_t* node = items[i].node;
+    vec3 center       = GLM_VEC3_ZERO_INIT;
+    if (node->aabb.valid) {
+      glm_vec3_add(node->aabb.min, node->aabb.max, center);
+      glm_vec3_scale(center, 0.5f, center);
+    }
+    else {
+      // No bounding box, use the origin of the node
+      mat4 node_matrix;
+      gltf_node_get_matrix(node, &node_matrix);
+      glm_vec3(node_matrix[3], center);
+    }
+    items[i].distance = glm_vec3_distance2(center, camera_position);
+  }
+}
+
+void wgpu_gltf_draw_list_sort_blended(wgpu_gltf_draw_list_t* draw_list,
+                                      vec3 camera_position)
+{
+  gltf_draw_item_t* items = draw_list->buckets[DrawBucket_AlphaBlended].items;
+  const uint32_t count    = draw_list->buckets[DrawBucket_AlphaBlended].count;
+  if (count < 2) {
+    return;
+  }
+
+  gltf_draw_items_update_distances(items, count, camera_position);
+  qsort(items, count, sizeof(gltf_draw_item_t),
+        gltf_draw_item_compare_distance);
+}
+
+void wgpu_gltf_draw_list_sort_opaque(wgpu_gltf_draw_list_t* draw_list,
+                                     vec3 camera_position)
+{
+  gltf_draw_item_t* items = draw_list->buckets[DrawBucket_Opaque].items;
+  const uint32_t count    = draw_list->buckets[DrawBucket_Opaque].count;
+  if (count < 2) {
+    return;
   }
+
+  // The items stay in state order, only the depth-only order is sorted
+  gltf_draw_items_update_distances(items, count, camera_position);
+  qsort(draw_list->depth_order, count, sizeof(gltf_draw_item_t*),
+        gltf_draw_item_ref_compare_distance);
+}
+
+void wgpu_gltf_draw_list_draw(wgpu_gltf_draw_list_t* draw_list,
+                              uint32_t render_flags)
+{
+  WGPURenderPassEncoder rpass_enc = draw_list->model->wgpu_context->rpass_enc;
+  GLTF_DRAW_LIST_RECORD(RenderPassEncoder, rpass_enc, draw_list, render_flags)
+}
+
+void wgpu_gltf_draw_list_record_render_bundle(
+  wgpu_gltf_draw_list_t* draw_list, WGPURenderBundleEncoder render_bundle_enc,
+  uint32_t render_flags)
+{
+  GLTF_DRAW_LIST_RECORD(RenderBundleEncoder, render_bundle_enc, draw_list,
+                        render_flags)
+}
+
+wgpu_gltf_vertex_format_enum_t
+wgpu_gltf_model_get_vertex_format(gltf_model_t* model)
+{
+  return model->vertices.format;
+}
+
+const float* wgpu_gltf_model_get_triangles(gltf_model_t* model,
+                                           uint32_t* triangle_count)
+{
+  *triangle_count = model->triangles.count;
+  return model->triangles.positions;
 }
 
 wgpu_gltf_materials_t wgpu_gltf_model_get_materials(gltf_model_t* model)
@@ -1673,9 +6337,9 @@ gltf_model_prepare_node_bind_group(gltf_model_t* model, gltf_node_t* node,
       .entryCount = 1,
       .entries    = &(WGPUBindGroupEntry) {
         .binding = 0,
-        .buffer  = node->mesh->uniform_buffer.buffer,
-        .offset  = 0,
-        .size    =  node->mesh->uniform_buffer.size,
+        .buffer  = model->mesh_uniforms.buffer.buffer,
+        .offset  = node->mesh->uniform_buffer.offset,
+        .size    = node->mesh->uniform_buffer.size,
       },
     };
     node->mesh->uniform_buffer.bind_group
@@ -1706,9 +6370,9 @@ gltf_model_prepare_skin_bind_group(gltf_model_t* model, gltf_skin_t* skin,
       .entryCount = 1,
       .entries    = &(WGPUBindGroupEntry) {
         .binding = 0,
-        .buffer  = skin->ssbo.buffer,
-        .offset  = 0,
-        .size    =  skin->ssbo.size,
+        .buffer  = model->joint_palette.buffer.buffer,
+        .offset  = skin->ssbo.offset,
+        .size    = skin->ssbo.size,
       },
     };
   skin->ssbo.bind_group
@@ -1733,6 +6397,18 @@ static void gltf_model_node_calculate_bounding_box(gltf_node_t* node,
       mat4 node_matrix;
       gltf_node_get_matrix(node, &node_matrix);
       bounding_get_aabb(&node->mesh->bb, node_matrix, &node->aabb);
+      // The bounds of the node include all of its GPU instances
+      for (uint32_t i = 0; i < node->instance_count; ++i) {
+        mat4 instance_matrix;
+        glm_mat4_mul(node_matrix, node->instance_matrices[i], instance_matrix);
+        bounding_box_t bb;
+        bounding_get_aabb(&node->mesh->bb, instance_matrix, &bb);
+        if (i == 0) {
+          node->aabb = bb;
+        }
+        glm_vec3_minv(node->aabb.min, bb.min, node->aabb.min);
+        glm_vec3_maxv(node->aabb.max, bb.max, node->aabb.max);
+      }
       if (node->child_count == 0) {
         glm_vec3_copy(node->aabb.min, node->bvh.min);
         glm_vec3_copy(node->aabb.max, node->bvh.max);
@@ -1785,6 +6461,14 @@ static void gltf_model_get_scene_dimensions(gltf_model_t* model)
   model->aabb[3][2] = model->dimensions.min[2];
 }
 
+float gltf_model_get_animation_end(gltf_model_t* model, uint32_t index)
+{
+  if (index >= model->animation_count) {
+    return 0.0f;
+  }
+  return model->animations[index].end;
+}
+
 void gltf_model_update_animation(gltf_model_t* model, uint32_t index,
                                  float time)
 {
@@ -1801,61 +6485,45 @@ void gltf_model_update_animation(gltf_model_t* model, uint32_t index,
   bool updated = false;
   for (uint32_t c = 0; c < animation->channel_count; ++c) {
     gltf_animation_channel_t* channel = &animation->channels[c];
+    if (!channel->is_valid) {
+      continue;
+    }
     gltf_animation_sampler_t* sampler
       = &animation->samplers[channel->sampler_index];
-    if (sampler->input_count > sampler->outputs_vec4_count) {
+    if (channel->path == PathType_WEIGHTS) {
+      gltf_mesh_t* mesh = channel->node->mesh;
+      if (mesh != NULL && mesh->weights.count > 0
+          && gltf_animation_sampler_sample_weights(
+            sampler, time, &channel->keyframe_cursor, mesh->weights.count,
+            &model->morph_targets.weights[mesh->weights.first])) {
+        mesh->weights.dirty = true;
+        updated             = true;
+      }
       continue;
     }
-
-    for (uint32_t i = 0; i < sampler->input_count - 1; ++i) {
-      if ((time >= sampler->inputs[i]) && (time <= sampler->inputs[i + 1])) {
-        float u = MAX(0.0f, time - sampler->inputs[i])
-                  / (sampler->inputs[i + 1] - sampler->inputs[i]);
-        if (u <= 1.0f) {
-          switch (channel->path) {
-            case PathType_TRANSLATION: {
-              vec4 trans = GLM_VEC4_ZERO_INIT;
-              glm_vec4_mix(sampler->outputs_vec4[i],
-                           sampler->outputs_vec4[i + 1], u, trans);
-              glm_vec3_copy((vec3){trans[0], trans[1], trans[2]},
-                            channel->node->translation);
-              break;
-            }
-            case PathType_SCALE: {
-              vec4 trans = GLM_VEC4_ZERO_INIT;
-              glm_vec4_mix(sampler->outputs_vec4[i],
-                           sampler->outputs_vec4[i + 1], u, trans);
-              glm_vec3_copy((vec3){trans[0], trans[1], trans[2]},
-                            channel->node->scale);
-              break;
-            }
-            case PathType_ROTATION: {
-              versor q1  = GLM_VEC4_ZERO_INIT;
-              q1[0]      = sampler->outputs_vec4[i][0];
-              q1[1]      = sampler->outputs_vec4[i][1];
-              q1[2]      = sampler->outputs_vec4[i][2];
-              q1[3]      = sampler->outputs_vec4[i][3];
-              versor q2  = GLM_VEC4_ZERO_INIT;
-              q2[0]      = sampler->outputs_vec4[i + 1][0];
-              q2[1]      = sampler->outputs_vec4[i + 1][1];
-              q2[2]      = sampler->outputs_vec4[i + 1][2];
-              q2[3]      = sampler->outputs_vec4[i + 1][3];
-              versor tmp = GLM_VEC4_ZERO_INIT;
-              glm_quat_slerp(q1, q2, u, tmp);
-              glm_quat_normalize(tmp);
-              glm_vec4_copy(tmp, channel->node->rotation);
-              break;
-            }
-          }
-          updated = true;
-        }
-      }
+    vec4 value = GLM_VEC4_ZERO_INIT;
+    if (!gltf_animation_sampler_sample(sampler, channel->path, time,
+                                       &channel->keyframe_cursor, value)) {
+      continue;
     }
+    switch (channel->path) {
+      case PathType_TRANSLATION:
+        glm_vec3(value, channel->node->translation);
+        break;
+      case PathType_SCALE:
+        glm_vec3(value, channel->node->scale);
+        break;
+      case PathType_ROTATION:
+        glm_quat_copy(value, channel->node->rotation);
+        break;
+      default:
+        break;
+    }
+    channel->node->dirty = true;
+    updated              = true;
   }
   if (updated) {
-    for (uint32_t i = 0; i < model->node_count; ++i) {
-      gltf_node_update(model->wgpu_context, &model->nodes[i]);
-    }
+    gltf_model_update_nodes(model);
   }
 }
 
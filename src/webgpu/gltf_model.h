@@ -9,6 +9,7 @@
 
 struct gltf_model_t;
 struct wgpu_context_t;
+struct wgpu_hiz_culling;
 
 // Changing this value here also requires changing it in the vertex shader
 #define WGPU_GLTF_MAX_NUM_JOINTS 128u
@@ -22,6 +23,17 @@ struct wgpu_context_t;
   WGPUVertexBufferLayout name##_vertex_buffer_layout                           \
     = WGPU_VERTBUFFERLAYOUT_DESC(array_stride, vert_attr_desc_##name);
 
+/* Vertex buffer layout for models loaded with a given vertex format, the
+ * attributes are described with WGPU_GLTF_VERTATTR_FORMAT_DESC */
+#define WGPU_GLTF_VERTATTR_FORMAT_DESC(f, l, c)                                \
+  wgpu_gltf_get_vertex_format_attribute_description(f, l, c)
+
+#define WGPU_GLTF_VERTEX_FORMAT_BUFFER_LAYOUT(name, format, ...)               \
+  uint64_t array_stride = wgpu_gltf_get_vertex_format_size(format);            \
+  WGPUVertexAttribute vert_attr_desc_##name[] = {__VA_ARGS__};                 \
+  WGPUVertexBufferLayout name##_vertex_buffer_layout                           \
+    = WGPU_VERTBUFFERLAYOUT_DESC(array_stride, vert_attr_desc_##name);
+
 /*
  * glTF model loading options
  */
@@ -30,19 +42,65 @@ typedef enum wgpu_gltf_file_loading_flags_enum_t {
   WGPU_GLTF_FileLoadingFlags_PreTransformVertices    = 0x00000001,
   WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors = 0x00000002,
   WGPU_GLTF_FileLoadingFlags_FlipY                   = 0x00000004,
-  WGPU_GLTF_FileLoadingFlags_DontLoadImages          = 0x00000008
+  WGPU_GLTF_FileLoadingFlags_DontLoadImages          = 0x00000008,
+  WGPU_GLTF_FileLoadingFlags_ComputeSkinning         = 0x00000010,
+  WGPU_GLTF_FileLoadingFlags_OptimizeMeshes          = 0x00000020,
+  WGPU_GLTF_FileLoadingFlags_QuantizeVertices        = 0x00000040,
+  WGPU_GLTF_FileLoadingFlags_MeshletCulling          = 0x00000080,
+  WGPU_GLTF_FileLoadingFlags_RetainTriangles         = 0x00000100,
+  WGPU_GLTF_FileLoadingFlags_VertexPulling           = 0x00000200,
+  WGPU_GLTF_FileLoadingFlags_PackTextures            = 0x00000400,
+  WGPU_GLTF_FileLoadingFlags_MaterialTable           = 0x00000800,
+  WGPU_GLTF_FileLoadingFlags_CompactIndices          = 0x00001000,
+  WGPU_GLTF_FileLoadingFlags_GenerateLods            = 0x00002000,
+  WGPU_GLTF_FileLoadingFlags_MeshInstancing          = 0x00004000
 } wgpu_gltf_file_loading_flags_enum_t;
 
 /*
- * glTF model render options
+ * Compact indices
+ *
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_CompactIndices store the
+ * indices of every primitive with up to 65536 vertices as 16-bit indices
+ * relative to the primitive's first vertex in a separate index buffer, they
+ * are drawn with the first vertex as base vertex. Larger primitives keep their
+ * 32-bit indices. The index format is selected per primitive by the draw
+ * functions. Ignored with WGPU_GLTF_FileLoadingFlags_MeshletCulling and
+ * WGPU_GLTF_FileLoadingFlags_VertexPulling, which read the 32-bit indices as
+ * storage buffer.
+ */
+
+/*
+ * glTF model render options, the alpha mode flags can be combined and all
+ * nodes are rendered if none of them is set
  */
 typedef enum wgpu_gltf_render_flags_enum_t {
   WGPU_GLTF_RenderFlags_BindImages              = 0x00000001,
   WGPU_GLTF_RenderFlags_RenderOpaqueNodes       = 0x00000002,
   WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes  = 0x00000004,
-  WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes = 0x00000008
+  WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes = 0x00000008,
+  WGPU_GLTF_RenderFlags_FrustumCulling          = 0x00000010,
+  WGPU_GLTF_RenderFlags_PullIndices             = 0x00000020,
+  WGPU_GLTF_RenderFlags_DepthOnly               = 0x00000040,
+  WGPU_GLTF_RenderFlags_SelectLod               = 0x00000080
 } wgpu_gltf_render_flags_enum_t;
 
+/*
+ * Levels of detail
+ *
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_GenerateLods get up to
+ * WGPU_GLTF_MAX_LOD_COUNT - 1 simplified index ranges per triangle primitive
+ * (quadric error edge collapses, see mesh_optimizer_simplify()), appended to
+ * the shared index buffer and referring to the same vertices. Each level
+ * halves the triangles of the previous one, levels which would exceed the
+ * simplification error limit or barely reduce the triangles are dropped.
+ * With WGPU_GLTF_RenderFlags_SelectLod wgpu_gltf_model_draw() draws level 1
+ * for primitives whose projected world space bounds (diameter relative to the
+ * viewport height, from render_options.view_projection) are smaller than
+ * render_options.lod_threshold, every further level halves the threshold.
+ * Skinned primitives and draw lists always draw the full detail.
+ */
+#define WGPU_GLTF_MAX_LOD_COUNT 4u
+
 /*
  * glTF default vertex layout with easy WebGPU mapping functions
  */
@@ -56,6 +114,19 @@ typedef enum wgpu_gltf_vertex_component_enum_t {
   WGPU_GLTF_VertexComponent_Weight0  = 6,
 } wgpu_gltf_vertex_component_enum_t;
 
+/*
+ * glTF vertex formats
+ *  - Default: float32 components (96 bytes per vertex)
+ *  - Quantized: float32x3 positions, snorm16x4 normals / tangents, float16x2
+ *    UVs, unorm8x4 colors / weights and uint8x4 joints (44 bytes per vertex).
+ *    The joints are read as vec4<u32> by the shaders, normals as vec4<f32>
+ *    with w = 0. Selected with WGPU_GLTF_FileLoadingFlags_QuantizeVertices.
+ */
+typedef enum wgpu_gltf_vertex_format_enum_t {
+  WGPU_GLTF_VertexFormat_Default   = 0,
+  WGPU_GLTF_VertexFormat_Quantized = 1,
+} wgpu_gltf_vertex_format_enum_t;
+
 typedef enum wgpu_gltf_alpha_mode_enum_t {
   AlphaMode_OPAQUE = 0,
   AlphaMode_MASK   = 1,
@@ -68,6 +139,11 @@ typedef enum wgpu_gltf_alpha_mode_enum_t {
 typedef struct wgpu_gltf_texture_t {
   wgpu_context_t* wgpu_context;
   texture_t wgpu_texture;
+  bool shared; /* acquired from the texture cache of the texture client */
+  /* Texture array of WGPU_GLTF_FileLoadingFlags_PackTextures holding the
+   * image, -1 = not packed. Packed textures have no wgpu_texture. */
+  int32_t packed_array;
+  uint32_t packed_layer;
 } wgpu_gltf_texture_t;
 
 /*
@@ -108,6 +184,8 @@ typedef struct wgpu_gltf_material_t {
   } pbr_workflows;
   WGPUBindGroup bind_group;
   WGPURenderPipeline pipeline;
+  /* Position only pipeline of the depth pre-pass, NULL = not pre-passed */
+  WGPURenderPipeline depth_pipeline;
 } wgpu_gltf_material_t;
 
 typedef struct wgpu_gltf_materials_t {
@@ -132,21 +210,252 @@ struct gltf_model_t* wgpu_gltf_model_load_from_file(
   struct wgpu_gltf_model_load_options_t* load_options);
 void wgpu_gltf_model_destroy(struct gltf_model_t* model);
 
+/**
+ * @brief Asynchronous glTF model loading. The file is parsed and the vertices,
+ * indices and images are decoded on a background thread (using a thread pool),
+ * the WebGPU resources are created on the thread calling
+ * wgpu_gltf_model_loader_finish(), which has to be the main thread. Poll
+ * wgpu_gltf_model_loader_is_ready() once per frame to avoid blocking it.
+ */
+typedef struct wgpu_gltf_model_loader wgpu_gltf_model_loader_t;
+wgpu_gltf_model_loader_t* wgpu_gltf_model_load_from_file_async(
+  struct wgpu_gltf_model_load_options_t* load_options);
+bool wgpu_gltf_model_loader_is_ready(wgpu_gltf_model_loader_t* loader);
+/* Waits for the background thread, releases the loader and returns the model
+ * or NULL if the loading failed */
+struct gltf_model_t*
+wgpu_gltf_model_loader_finish(wgpu_gltf_model_loader_t* loader);
+
 /**
  * @brief Returns the vertex attribute description for the given shader location
  * and component.
  */
 WGPUVertexAttribute wgpu_gltf_get_vertex_attribute_description(
   uint32_t shader_location, wgpu_gltf_vertex_component_enum_t component);
+WGPUVertexAttribute wgpu_gltf_get_vertex_format_attribute_description(
+  wgpu_gltf_vertex_format_enum_t format, uint32_t shader_location,
+  wgpu_gltf_vertex_component_enum_t component);
 
 /** glTF helper functions */
 uint64_t wgpu_gltf_get_vertex_size();
+uint64_t
+wgpu_gltf_get_vertex_format_size(wgpu_gltf_vertex_format_enum_t format);
+/* The vertex format of the model's vertex buffer */
+wgpu_gltf_vertex_format_enum_t
+wgpu_gltf_model_get_vertex_format(struct gltf_model_t* model);
 wgpu_gltf_materials_t wgpu_gltf_model_get_materials();
+/**
+ * @brief Returns the indexed triangles of the model as triangle soup, 9 floats
+ * (3 vertex positions) per triangle, e.g. to build ray tracing acceleration
+ * structures. Requires the model to be loaded with
+ * WGPU_GLTF_FileLoadingFlags_RetainTriangles, the positions are in world space
+ * with WGPU_GLTF_FileLoadingFlags_PreTransformVertices and in mesh space
+ * otherwise. The array is owned by the model.
+ */
+const float* wgpu_gltf_model_get_triangles(struct gltf_model_t* model,
+                                           uint32_t* triangle_count);
 void wgpu_gltf_model_prepare_nodes_bind_group(
   struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
 void wgpu_gltf_model_prepare_skins_bind_group(
   struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
 
+/*
+ * Vertex pulling
+ *
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_VertexPulling can bind their
+ * vertex and index buffers as read-only storage buffers, binding 0 holds the
+ * vertices and binding 1 the indices. A pulled vertex shader has no vertex
+ * buffer layout, it is prefixed with the prelude of the model's vertex format
+ * which declares both bindings of the given group and
+ *
+ *   struct GltfVertex {
+ *     position : vec3<f32>, normal : vec3<f32>, uv : vec2<f32>,
+ *     color : vec4<f32>, joint0 : vec4<u32>, weight0 : vec4<f32>,
+ *     tangent : vec4<f32>,
+ *   }
+ *   fn gltf_pull_vertex(vertex : u32) -> GltfVertex
+ *   fn gltf_pull_index(index : u32) -> u32
+ *
+ * Indexed draws pass the vertex as @builtin(vertex_index). The primitives are
+ * drawn without index buffer with WGPU_GLTF_RenderFlags_PullIndices, the
+ * vertex index is then the position in the index buffer, so
+ * gltf_pull_vertex(gltf_pull_index(vertex_index)) is the vertex and
+ * vertex_index % 3 its corner in the triangle, e.g. for barycentric
+ * wireframes. Meshlet culled primitives keep their indexed indirect draws.
+ */
+#define WGPU_GLTF_VERTEX_PULLING_BINDING_COUNT 2u
+
+/* Fills the WGPU_GLTF_VERTEX_PULLING_BINDING_COUNT layout entries */
+void wgpu_gltf_get_vertex_pulling_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries);
+/* Returns the prelude of the given group followed by shader, free() it */
+char* wgpu_gltf_create_vertex_pulling_wgsl(
+  wgpu_gltf_vertex_format_enum_t format, uint32_t group, const char* shader);
+void wgpu_gltf_model_prepare_vertex_pulling_bind_group(
+  struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
+WGPUBindGroup
+wgpu_gltf_model_get_vertex_pulling_bind_group(struct gltf_model_t* model);
+
+/*
+ * Packed textures
+ *
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_PackTextures upload their
+ * decoded RGBA images into up to WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT texture
+ * arrays, one per image size, the images are layers of the array of their
+ * size. Images of other sizes and images which are not decoded (e.g. ktx) keep
+ * their own texture. All materials then share one bind group:
+ *
+ *   binding 0: the packed layers of the material, a read-only storage buffer
+ *              with dynamic offset, one record per material
+ *   binding 1 .. WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT: texture_2d_array<f32>
+ *   last binding: the sampler of the arrays
+ *
+ * A fragment shader using the bind group is prefixed with the prelude of the
+ * given group, which declares the bindings and
+ *
+ *   struct GltfPackedMaterial {
+ *     base_color : u32, metallic_roughness : u32, normal : u32,
+ *     occlusion : u32, emissive : u32,
+ *   }
+ *   var<storage, read> gltf_packed_material : GltfPackedMaterial;
+ *   fn gltf_sample_packed(layer : u32, uv : vec2<f32>,
+ *                         fallback : vec4<f32>) -> vec4<f32>
+ *
+ * e.g. gltf_sample_packed(gltf_packed_material.base_color, uv, vec4(1.0)),
+ * the fallback is returned for textures which are missing or not packed.
+ * Once the bind group is prepared, WGPU_GLTF_RenderFlags_BindImages binds it
+ * with the offset of the primitive's material instead of the material bind
+ * group, so draw lists only change the dynamic offset between materials.
+ */
+// Changing this value here also requires changing it in the prelude
+#define WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT 4u
+#define WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT                                \
+  (WGPU_GLTF_PACKED_TEXTURE_ARRAY_COUNT + 2u)
+
+/* Fills the WGPU_GLTF_PACKED_TEXTURES_BINDING_COUNT layout entries */
+void wgpu_gltf_get_packed_textures_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries);
+/* Returns the prelude of the given group followed by shader, free() it */
+char* wgpu_gltf_create_packed_textures_wgsl(uint32_t group, const char* shader);
+void wgpu_gltf_model_prepare_packed_textures_bind_group(
+  struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
+WGPUBindGroup
+wgpu_gltf_model_get_packed_textures_bind_group(struct gltf_model_t* model);
+/* Number of texture arrays the images of the model are packed into */
+uint32_t wgpu_gltf_model_get_packed_texture_array_count(
+  struct gltf_model_t* model);
+
+/*
+ * Material table
+ *
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_MaterialTable keep the
+ * parameters of all materials in one read-only storage buffer, indexed by the
+ * material index. The draws of these models pass the material index of the
+ * primitive as first instance, so @builtin(instance_index) is the material
+ * index for single instance draws (the instances of instanced draws follow
+ * it). The indirect draws of meshlet culled primitives only do so with the
+ * indirect-first-instance feature. A shader using the table is prefixed with
+ * the prelude of the given group, which declares the binding and
+ *
+ *   struct GltfMaterial {
+ *     base_color_factor : vec4<f32>, emissive_factor : vec4<f32>,
+ *     metallic_factor : f32, roughness_factor : f32, alpha_cutoff : f32,
+ *     alpha_mode : u32, (AlphaMode_*)
+ *     base_color_texture : u32, metallic_roughness_texture : u32,
+ *     normal_texture : u32, occlusion_texture : u32, emissive_texture : u32,
+ *     tex_coord_sets : u32, (4 bits per texture in the order above)
+ *     double_sided : u32,
+ *   }
+ *   fn gltf_get_material(material_index : u32) -> GltfMaterial
+ *
+ * The textures are the layers of WGPU_GLTF_FileLoadingFlags_PackTextures, to
+ * be sampled with gltf_sample_packed(). Without material bind groups and with
+ * the packed textures bound once, materials no longer split the draws of a
+ * pipeline. Changed materials are uploaded with
+ * wgpu_gltf_model_update_material_table().
+ */
+#define WGPU_GLTF_MATERIAL_TABLE_BINDING_COUNT 1u
+
+/* Fills the WGPU_GLTF_MATERIAL_TABLE_BINDING_COUNT layout entries */
+void wgpu_gltf_get_material_table_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries);
+/* Returns the prelude of the given group followed by shader, free() it */
+char* wgpu_gltf_create_material_table_wgsl(uint32_t group, const char* shader);
+void wgpu_gltf_model_prepare_material_table_bind_group(
+  struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
+WGPUBindGroup
+wgpu_gltf_model_get_material_table_bind_group(struct gltf_model_t* model);
+void wgpu_gltf_model_update_material_table(struct gltf_model_t* model);
+
+/*
+ * Depth pre-pass
+ *
+ * Heavy fragment shaders can be shaded once per pixel by laying down the depth
+ * of the opaque primitives first. The pre-pass draws the model with
+ * WGPU_GLTF_RenderFlags_DepthOnly, which binds the depth pipelines of the
+ * materials instead of their pipelines and no material bind groups,
+ * primitives whose material has no depth pipeline are skipped. The main pass
+ * pipelines of the pre-passed materials then test with Equal and don't write
+ * depth (see create_depth_stencil_state_desc_t.depth_prepass), so the overdraw
+ * only costs the depth test. The vertex shader of the pre-pass has to compute
+ * the position with the same operations as the main pass vertex shader.
+ *
+ * The pre-pass can write one color target, e.g. the motion vectors of
+ * temporal anti-aliasing, with a fragment shader.
+ */
+typedef struct wgpu_gltf_depth_pipeline_desc_t {
+  WGPUPipelineLayout layout;
+  /* WGSL vertex shader, the position is read from location 0 */
+  const char* vertex_wgsl_code;
+  /* Optional WGSL fragment shader writing location 0 of color_format */
+  const char* fragment_wgsl_code;
+  WGPUTextureFormat color_format;
+  WGPUTextureFormat depth_format;
+  uint32_t sample_count;
+  /* Disables culling for all materials, for main passes which don't cull */
+  bool double_sided;
+} wgpu_gltf_depth_pipeline_desc_t;
+
+/* Creates the depth pipelines of the opaque materials, vertex only without
+ * fragment shader, the cull mode follows the double sided property of the
+ * materials */
+void wgpu_gltf_model_prepare_depth_pipelines(
+  struct gltf_model_t* model, const wgpu_gltf_depth_pipeline_desc_t* desc);
+
+/*
+ * Mesh instancing
+ *
+ * Nodes referencing the same mesh share its geometry and mesh uniform block.
+ * Models loaded with WGPU_GLTF_FileLoadingFlags_MeshInstancing keep the world
+ * matrices of all nodes referencing a mesh, including the instances of nodes
+ * with the EXT_mesh_gpu_instancing extension, in a contiguous range of one
+ * read-only storage buffer. The first node of a mesh draws each primitive once
+ * for all instances with the first instance of the range, the other nodes of
+ * the mesh draw nothing, so @builtin(instance_index) indexes the instance
+ * matrices. A vertex shader reading them is prefixed with the prelude of the
+ * given group, which declares the binding and
+ *
+ *   fn gltf_get_instance_matrix(instance_index : u32) -> mat4x4<f32>
+ *
+ * The matrix replaces the matrix of the mesh uniform block. Frustum culling
+ * tests the bounds of all instances of a mesh, render_options.instance_count
+ * is ignored and meshes with several instances are drawn at full detail.
+ * Ignored with WGPU_GLTF_FileLoadingFlags_PreTransformVertices,
+ * WGPU_GLTF_FileLoadingFlags_MaterialTable and
+ * WGPU_GLTF_FileLoadingFlags_MeshletCulling.
+ */
+#define WGPU_GLTF_INSTANCING_BINDING_COUNT 1u
+
+/* Fills the WGPU_GLTF_INSTANCING_BINDING_COUNT layout entries */
+void wgpu_gltf_get_instancing_bind_group_layout_entries(
+  WGPUBindGroupLayoutEntry* entries);
+/* Returns the prelude of the given group followed by shader, free() it */
+char* wgpu_gltf_create_instancing_wgsl(uint32_t group, const char* shader);
+void wgpu_gltf_model_prepare_instancing_bind_group(
+  struct gltf_model_t* model, WGPUBindGroupLayout bind_group_layout);
+WGPUBindGroup
+wgpu_gltf_model_get_instancing_bind_group(struct gltf_model_t* model);
+
 /**
  *  @brief glTF model rendering
  */
@@ -154,10 +463,97 @@ typedef struct wgpu_gltf_model_render_options_t {
   uint32_t render_flags;
   uint32_t bind_mesh_model_set;
   uint32_t bind_image_set;
+  /* Used by WGPU_GLTF_RenderFlags_FrustumCulling, primitives whose world space
+   * bounds are outside of the view frustum are skipped (not by draw lists),
+   * and by WGPU_GLTF_RenderFlags_SelectLod */
+  mat4 view_projection;
+  /* Instances of each primitive, 0 = 1. The indirect draws of meshlet culled
+   * primitives always draw one instance, mesh instancing models draw the
+   * instances of the meshes */
+  uint32_t instance_count;
+  /* Projected size below which WGPU_GLTF_RenderFlags_SelectLod draws the
+   * first simplified level, 0 = 0.25 */
+  float lod_threshold;
 } wgpu_gltf_model_render_options_t;
 void wgpu_gltf_model_draw(struct gltf_model_t* model,
                           wgpu_gltf_model_render_options_t render_options);
 void gltf_model_update_animation(struct gltf_model_t* model, uint32_t index,
                                  float time);
+/* Time of the last keyframe of an animation in seconds, 0 without it */
+float gltf_model_get_animation_end(struct gltf_model_t* model, uint32_t index);
+
+/*
+ * Retained glTF draw list
+ *
+ * The primitives of a model, filtered by the render flags and split into
+ * opaque, alpha masked and alpha blended buckets in a single traversal. The
+ * opaque and alpha masked buckets are sorted by pipeline, material bind group
+ * and mesh, the alpha blended bucket back-to-front. Recording the list skips
+ * redundant pipeline and bind group changes, it can also be recorded into a
+ * render bundle for static scenes. The list has to be recreated when the
+ * pipelines or bind groups of the materials or meshes change.
+ */
+typedef struct wgpu_gltf_draw_list wgpu_gltf_draw_list_t;
+
+wgpu_gltf_draw_list_t*
+wgpu_gltf_draw_list_create(struct gltf_model_t* model,
+                           wgpu_gltf_model_render_options_t render_options);
+void wgpu_gltf_draw_list_release(wgpu_gltf_draw_list_t* draw_list);
+/* Sorts the alpha blended bucket back-to-front by the node bounding boxes */
+void wgpu_gltf_draw_list_sort_blended(wgpu_gltf_draw_list_t* draw_list,
+                                      vec3 camera_position);
+/**
+ * @brief Sorts the depth-only order of the opaque bucket front-to-back, which
+ * WGPU_GLTF_RenderFlags_DepthOnly draws use so that the early depth test
+ * rejects most of the hidden fragments. The state sorted order of the other
+ * draws is kept.
+ */
+void wgpu_gltf_draw_list_sort_opaque(wgpu_gltf_draw_list_t* draw_list,
+                                     vec3 camera_position);
+/**
+ * @brief Records the buckets selected by the alpha mode render flags into the
+ * current render pass of the model's context, in the order opaque, alpha
+ * masked, alpha blended. All buckets are drawn if no alpha mode flag is set.
+ */
+void wgpu_gltf_draw_list_draw(wgpu_gltf_draw_list_t* draw_list,
+                              uint32_t render_flags);
+/* Records the selected buckets into a render bundle encoder, the bind groups
+ * of the other sets have to be set by the caller before */
+void wgpu_gltf_draw_list_record_render_bundle(
+  wgpu_gltf_draw_list_t* draw_list, WGPURenderBundleEncoder render_bundle_enc,
+  uint32_t render_flags);
+
+/**
+ * @brief Skins the vertices of all skinned meshes into a separate vertex
+ * buffer using a compute pass. Requires the model to be loaded with
+ * WGPU_GLTF_FileLoadingFlags_ComputeSkinning, wgpu_gltf_model_draw() then
+ * binds the skinned vertices, so all passes of a frame reuse them and the
+ * vertex shaders must not apply the joint matrices again. Record it once per
+ * frame before the first pass drawing the model.
+ *
+ * The pass also blends the morph targets of the meshes before skinning, the
+ * weights of the meshes and nodes are animated by
+ * gltf_model_update_animation(). Morph targets are only evaluated with compute
+ * skinning.
+ */
+void wgpu_gltf_model_compute_skinning(struct gltf_model_t* model,
+                                      WGPUCommandEncoder cmd_enc);
+
+/**
+ * @brief Culls the meshlets of the model against the view frustum and by their
+ * normal cones on the GPU. Requires the model to be loaded with
+ * WGPU_GLTF_FileLoadingFlags_MeshletCulling, wgpu_gltf_model_draw() then draws
+ * the primitives with indirect draws of the visible meshlets. Record it once
+ * per view before the render pass, all passes drawing the model until the next
+ * call reuse the result. Skinned meshes are never culled.
+ * @param view_projection the view projection matrix of the camera
+ * @param camera_position the world space position of the camera
+ * @param hiz optional depth pyramid of the previous frame, meshlets hidden
+ * behind it are culled as well, see wgpu_hiz_culling_build()
+ */
+void wgpu_gltf_model_cull_meshlets(struct gltf_model_t* model,
+                                   WGPUCommandEncoder cmd_enc,
+                                   mat4 view_projection, vec3 camera_position,
+                                   struct wgpu_hiz_culling* hiz);
 
 #endif
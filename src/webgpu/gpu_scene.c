@@ -0,0 +1,383 @@
+#include "gpu_scene.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "upload_ring.h"
+
+/* Dirty runs closer than this are uploaded with one copy, including the clean
+ * slots in between */
+#define GPU_SCENE_MERGE_GAP 8u
+#define GPU_SCENE_SLOT_BITS 24u
+#define GPU_SCENE_MAX_SLOT_COUNT (1u << GPU_SCENE_SLOT_BITS)
+
+/* Bytes per slot of the attributes */
+static const uint32_t gpu_scene_strides[WGPU_GPU_SCENE_ATTRIBUTE_COUNT] = {
+  [WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM]   = sizeof(mat4),
+  [WGPU_GPU_SCENE_ATTRIBUTE_BOUNDS]      = 2 * sizeof(vec4),
+  [WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID] = sizeof(uint32_t),
+  [WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID]     = sizeof(uint32_t),
+};
+
+static const char* gpu_scene_buffer_labels[WGPU_GPU_SCENE_ATTRIBUTE_COUNT] = {
+  [WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM]   = "GPU scene - Transforms",
+  [WGPU_GPU_SCENE_ATTRIBUTE_BOUNDS]      = "GPU scene - Bounds",
+  [WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID] = "GPU scene - Material IDs",
+  [WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID]     = "GPU scene - Mesh IDs",
+};
+
+typedef struct gpu_scene_attribute_t {
+  WGPUBuffer buffer;
+  uint64_t size;
+  /* CPU copy of the buffer, the source of the uploads */
+  uint8_t* data;
+  /* A bit per slot, and the range of the set bits */
+  uint64_t* dirty_bits;
+  uint32_t dirty_first;
+  uint32_t dirty_end;
+} gpu_scene_attribute_t;
+
+/**
+ * @brief GPU scene class
+ */
+struct wgpu_gpu_scene {
+  wgpu_context_t* wgpu_context;
+  uint32_t max_object_count;
+  uint32_t object_count;
+  uint32_t slot_count;
+  gpu_scene_attribute_t attributes[WGPU_GPU_SCENE_ATTRIBUTE_COUNT];
+  /* Generation of the handles of every slot, bumped on removal */
+  uint8_t* generations;
+  /* Removed slots, reused last in first out */
+  uint32_t* free_slots;
+  uint32_t free_slot_count;
+  bool overflow_logged;
+  wgpu_gpu_scene_stats_t stats;
+};
+
+/* GPU scene creating / destroying */
+
+wgpu_gpu_scene_t* wgpu_gpu_scene_create(wgpu_context_t* wgpu_context,
+                                        const wgpu_gpu_scene_desc_t* desc)
+{
+  wgpu_gpu_scene_t* scene = (wgpu_gpu_scene_t*)malloc(sizeof(*scene));
+  memset(scene, 0, sizeof(*scene));
+  scene->wgpu_context = wgpu_context;
+
+  const uint32_t max_object_count
+    = (desc != NULL && desc->max_object_count > 0) ?
+        desc->max_object_count :
+        WGPU_GPU_SCENE_DEFAULT_MAX_OBJECT_COUNT;
+  scene->max_object_count = MIN(max_object_count, GPU_SCENE_MAX_SLOT_COUNT);
+  scene->generations      = (uint8_t*)malloc(scene->max_object_count);
+  memset(scene->generations, 1, scene->max_object_count);
+  scene->free_slots
+    = (uint32_t*)malloc(scene->max_object_count * sizeof(uint32_t));
+
+  const uint32_t dirty_word_count = (scene->max_object_count + 63) / 64;
+  for (uint32_t i = 0; i < (uint32_t)WGPU_GPU_SCENE_ATTRIBUTE_COUNT; ++i) {
+    gpu_scene_attribute_t* attribute = &scene->attributes[i];
+    attribute->size
+      = (uint64_t)scene->max_object_count * gpu_scene_strides[i];
+    attribute->data = (uint8_t*)calloc(attribute->size, 1);
+    attribute->dirty_bits
+      = (uint64_t*)calloc(dirty_word_count, sizeof(uint64_t));
+    attribute->dirty_first = scene->max_object_count;
+    attribute->dirty_end   = 0;
+    attribute->buffer      = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label            = gpu_scene_buffer_labels[i],
+        .usage            = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+        .size             = attribute->size,
+        .mappedAtCreation = (i == WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID),
+      });
+    ASSERT(attribute->buffer != NULL);
+  }
+
+  // All slots start free
+  gpu_scene_attribute_t* mesh_ids
+    = &scene->attributes[WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID];
+  memset(mesh_ids->data, 0xff, mesh_ids->size);
+  void* mapping
+    = wgpuBufferGetMappedRange(mesh_ids->buffer, 0, mesh_ids->size);
+  ASSERT(mapping != NULL);
+  memcpy(mapping, mesh_ids->data, mesh_ids->size);
+  wgpuBufferUnmap(mesh_ids->buffer);
+
+  return scene;
+}
+
+void wgpu_gpu_scene_destroy(wgpu_gpu_scene_t* scene)
+{
+  if (scene == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < (uint32_t)WGPU_GPU_SCENE_ATTRIBUTE_COUNT; ++i) {
+    WGPU_RELEASE_RESOURCE(Buffer, scene->attributes[i].buffer)
+    free(scene->attributes[i].data);
+    free(scene->attributes[i].dirty_bits);
+  }
+  free(scene->generations);
+  free(scene->free_slots);
+  free(scene);
+}
+
+/* Objects */
+
+static void gpu_scene_mark_dirty(wgpu_gpu_scene_t* this,
+                                 wgpu_gpu_scene_attribute_t attribute_index,
+                                 uint32_t slot)
+{
+  gpu_scene_attribute_t* attribute = &this->attributes[attribute_index];
+  attribute->dirty_bits[slot / 64] |= 1ull << (slot % 64);
+  attribute->dirty_first = MIN(attribute->dirty_first, slot);
+  attribute->dirty_end   = MAX(attribute->dirty_end, slot + 1);
+}
+
+static void* gpu_scene_get_slot_data(wgpu_gpu_scene_t* this,
+                                     wgpu_gpu_scene_attribute_t attribute,
+                                     uint32_t slot)
+{
+  return &this->attributes[attribute]
+            .data[(uint64_t)slot * gpu_scene_strides[attribute]];
+}
+
+static void gpu_scene_write(wgpu_gpu_scene_t* this,
+                            wgpu_gpu_scene_attribute_t attribute,
+                            uint32_t slot, const void* data)
+{
+  void* slot_data = gpu_scene_get_slot_data(this, attribute, slot);
+  if (memcmp(slot_data, data, gpu_scene_strides[attribute]) != 0) {
+    memcpy(slot_data, data, gpu_scene_strides[attribute]);
+    gpu_scene_mark_dirty(this, attribute, slot);
+  }
+}
+
+wgpu_gpu_scene_handle_t
+wgpu_gpu_scene_add(wgpu_gpu_scene_t* scene,
+                   const wgpu_gpu_scene_object_desc_t* desc)
+{
+  uint32_t slot = 0;
+  if (scene->free_slot_count > 0) {
+    slot = scene->free_slots[--scene->free_slot_count];
+  }
+  else if (scene->slot_count < scene->max_object_count) {
+    slot = scene->slot_count++;
+  }
+  else {
+    if (!scene->overflow_logged) {
+      log_error("GPU scene full (%u objects)", scene->max_object_count);
+      scene->overflow_logged = true;
+    }
+    return WGPU_GPU_SCENE_INVALID_HANDLE;
+  }
+  ++scene->object_count;
+
+  const wgpu_gpu_scene_handle_t handle
+    = ((uint32_t)scene->generations[slot] << GPU_SCENE_SLOT_BITS) | slot;
+  wgpu_gpu_scene_set_transform(scene, handle, (vec4*)desc->transform);
+  wgpu_gpu_scene_set_bounds(scene, handle, (float*)desc->bounds_min,
+                            (float*)desc->bounds_max);
+  wgpu_gpu_scene_set_material_id(scene, handle, desc->material_id);
+  wgpu_gpu_scene_set_mesh_id(scene, handle, desc->mesh_id);
+  return handle;
+}
+
+void wgpu_gpu_scene_remove(wgpu_gpu_scene_t* scene,
+                           wgpu_gpu_scene_handle_t handle)
+{
+  if (!wgpu_gpu_scene_is_valid(scene, handle)) {
+    return;
+  }
+
+  const uint32_t slot   = wgpu_gpu_scene_get_slot(handle);
+  const uint32_t free_id = WGPU_GPU_SCENE_INVALID_ID;
+  gpu_scene_write(scene, WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID, slot, &free_id);
+  // Generation 0 is skipped, no handle is WGPU_GPU_SCENE_INVALID_HANDLE
+  if (++scene->generations[slot] == 0) {
+    scene->generations[slot] = 1;
+  }
+  scene->free_slots[scene->free_slot_count++] = slot;
+  --scene->object_count;
+}
+
+bool wgpu_gpu_scene_is_valid(wgpu_gpu_scene_t* scene,
+                             wgpu_gpu_scene_handle_t handle)
+{
+  const uint32_t slot = wgpu_gpu_scene_get_slot(handle);
+  return handle != WGPU_GPU_SCENE_INVALID_HANDLE && slot < scene->slot_count
+         && scene->generations[slot] == (handle >> GPU_SCENE_SLOT_BITS);
+}
+
+uint32_t wgpu_gpu_scene_get_slot(wgpu_gpu_scene_handle_t handle)
+{
+  return handle & (GPU_SCENE_MAX_SLOT_COUNT - 1);
+}
+
+/* Attributes */
+
+void wgpu_gpu_scene_set_transform(wgpu_gpu_scene_t* scene,
+                                  wgpu_gpu_scene_handle_t handle,
+                                  mat4 transform)
+{
+  ASSERT(wgpu_gpu_scene_is_valid(scene, handle));
+  gpu_scene_write(scene, WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM,
+                  wgpu_gpu_scene_get_slot(handle), transform);
+}
+
+void wgpu_gpu_scene_set_bounds(wgpu_gpu_scene_t* scene,
+                               wgpu_gpu_scene_handle_t handle,
+                               vec3 bounds_min, vec3 bounds_max)
+{
+  ASSERT(wgpu_gpu_scene_is_valid(scene, handle));
+  const vec4 bounds[2] = {
+    {bounds_min[0], bounds_min[1], bounds_min[2], 0.0f},
+    {bounds_max[0], bounds_max[1], bounds_max[2], 0.0f},
+  };
+  gpu_scene_write(scene, WGPU_GPU_SCENE_ATTRIBUTE_BOUNDS,
+                  wgpu_gpu_scene_get_slot(handle), bounds);
+}
+
+void wgpu_gpu_scene_set_material_id(wgpu_gpu_scene_t* scene,
+                                    wgpu_gpu_scene_handle_t handle,
+                                    uint32_t material_id)
+{
+  ASSERT(wgpu_gpu_scene_is_valid(scene, handle));
+  gpu_scene_write(scene, WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID,
+                  wgpu_gpu_scene_get_slot(handle), &material_id);
+}
+
+void wgpu_gpu_scene_set_mesh_id(wgpu_gpu_scene_t* scene,
+                                wgpu_gpu_scene_handle_t handle,
+                                uint32_t mesh_id)
+{
+  ASSERT(wgpu_gpu_scene_is_valid(scene, handle));
+  gpu_scene_write(scene, WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID,
+                  wgpu_gpu_scene_get_slot(handle), &mesh_id);
+}
+
+const vec4* wgpu_gpu_scene_get_transform(wgpu_gpu_scene_t* scene,
+                                         wgpu_gpu_scene_handle_t handle)
+{
+  ASSERT(wgpu_gpu_scene_is_valid(scene, handle));
+  return (const vec4*)gpu_scene_get_slot_data(
+    scene, WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM, wgpu_gpu_scene_get_slot(handle));
+}
+
+/* Uploading */
+
+static bool gpu_scene_is_dirty(const gpu_scene_attribute_t* attribute,
+                               uint32_t slot)
+{
+  return (attribute->dirty_bits[slot / 64] >> (slot % 64)) & 1u;
+}
+
+/* Next dirty slot in [slot, end), end if there is none. Clean words are
+ * skipped at once. */
+static uint32_t gpu_scene_find_dirty(const gpu_scene_attribute_t* attribute,
+                                     uint32_t slot, uint32_t end)
+{
+  while (slot < end) {
+    if (attribute->dirty_bits[slot / 64] >> (slot % 64) == 0) {
+      slot = (slot / 64 + 1) * 64;
+      continue;
+    }
+    if (gpu_scene_is_dirty(attribute, slot)) {
+      return slot;
+    }
+    ++slot;
+  }
+  return end;
+}
+
+static void gpu_scene_clear_dirty(gpu_scene_attribute_t* attribute,
+                                  uint32_t first, uint32_t end)
+{
+  for (uint32_t slot = first; slot < end; ++slot) {
+    attribute->dirty_bits[slot / 64] &= ~(1ull << (slot % 64));
+  }
+}
+
+/* Uploads a run of slots, through the queue if the upload ring is full */
+static void gpu_scene_upload_run(wgpu_gpu_scene_t* this,
+                                 gpu_scene_attribute_t* attribute,
+                                 uint32_t stride, uint32_t first, uint32_t end)
+{
+  wgpu_context_t* wgpu_context = this->wgpu_context;
+  const uint64_t offset        = (uint64_t)first * stride;
+  const uint64_t size          = (uint64_t)(end - first) * stride;
+  if (wgpu_context->upload_ring == NULL
+      || !wgpu_upload_ring_write_buffer(wgpu_context->upload_ring,
+                                        attribute->buffer, offset,
+                                        &attribute->data[offset], size)) {
+    wgpu_queue_write_buffer(wgpu_context, attribute->buffer, offset,
+                            &attribute->data[offset], size);
+  }
+
+  ++this->stats.copy_count;
+  this->stats.uploaded_bytes += size;
+}
+
+void wgpu_gpu_scene_upload(wgpu_gpu_scene_t* scene)
+{
+  scene->stats = (wgpu_gpu_scene_stats_t){
+    .object_count = scene->object_count,
+    .slot_count   = scene->slot_count,
+  };
+
+  for (uint32_t i = 0; i < (uint32_t)WGPU_GPU_SCENE_ATTRIBUTE_COUNT; ++i) {
+    gpu_scene_attribute_t* attribute = &scene->attributes[i];
+    const uint32_t end               = attribute->dirty_end;
+    uint32_t first
+      = gpu_scene_find_dirty(attribute, attribute->dirty_first, end);
+    while (first < end) {
+      // Extend the run over dirty slots and short clean gaps
+      uint32_t run_end = first + 1;
+      uint32_t next    = gpu_scene_find_dirty(attribute, run_end, end);
+      while (next < end && next - run_end < GPU_SCENE_MERGE_GAP) {
+        run_end = next + 1;
+        next    = gpu_scene_find_dirty(attribute, run_end, end);
+      }
+      gpu_scene_upload_run(scene, attribute, gpu_scene_strides[i], first,
+                           run_end);
+      gpu_scene_clear_dirty(attribute, first, run_end);
+      scene->stats.dirty_slot_count += run_end - first;
+      first = next;
+    }
+    attribute->dirty_first = scene->max_object_count;
+    attribute->dirty_end   = 0;
+  }
+}
+
+/* Buffers and statistics */
+
+WGPUBuffer wgpu_gpu_scene_get_buffer(wgpu_gpu_scene_t* scene,
+                                     wgpu_gpu_scene_attribute_t attribute)
+{
+  return scene->attributes[attribute].buffer;
+}
+
+uint64_t wgpu_gpu_scene_get_buffer_size(wgpu_gpu_scene_t* scene,
+                                        wgpu_gpu_scene_attribute_t attribute)
+{
+  return scene->attributes[attribute].size;
+}
+
+uint32_t wgpu_gpu_scene_get_object_count(wgpu_gpu_scene_t* scene)
+{
+  return scene->object_count;
+}
+
+uint32_t wgpu_gpu_scene_get_slot_count(wgpu_gpu_scene_t* scene)
+{
+  return scene->slot_count;
+}
+
+const wgpu_gpu_scene_stats_t* wgpu_gpu_scene_get_stats(wgpu_gpu_scene_t* scene)
+{
+  return &scene->stats;
+}
@@ -0,0 +1,126 @@
+#ifndef GPU_SCENE_H
+#define GPU_SCENE_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+#define WGPU_GPU_SCENE_DEFAULT_MAX_OBJECT_COUNT 65536u
+/* Mesh ID of the free slots, GPU passes over the slots skip them */
+#define WGPU_GPU_SCENE_INVALID_ID 0xffffffffu
+/* Never returned for a live object */
+#define WGPU_GPU_SCENE_INVALID_HANDLE 0u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU GPU scene
+ *
+ * Persistent object table on the GPU: the transform, the bounds, the material
+ * ID and the mesh ID of every object are kept in one storage buffer per
+ * attribute (structure of arrays), indexed by the slot of the object. Culling
+ * passes, indirect draw generation and vertex shaders read the attributes
+ * they need by slot, e.g.:
+ *
+ *   @group(1) @binding(0) var<storage, read> transforms : array<mat4x4<f32>>;
+ *   let model = transforms[slot];
+ *
+ * Objects are added and removed through stable handles, removed slots go to a
+ * free list and are reused. Setters only mark the attribute of the slot dirty,
+ * wgpu_gpu_scene_upload() uploads the dirty slots of the frame through the
+ * upload ring, nearby dirty slots merged into one copy. The per frame CPU and
+ * upload cost scale with the number of changed objects, not with the scene
+ * size.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_gpu_scene wgpu_gpu_scene_t;
+
+/* Slot index (low 24 bits) and generation (high 8 bits) of an object */
+typedef uint32_t wgpu_gpu_scene_handle_t;
+
+typedef enum wgpu_gpu_scene_attribute_t {
+  WGPU_GPU_SCENE_ATTRIBUTE_TRANSFORM   = 0, /* mat4x4<f32>, object to world */
+  WGPU_GPU_SCENE_ATTRIBUTE_BOUNDS      = 1, /* 2 x vec4<f32>, local AABB */
+  WGPU_GPU_SCENE_ATTRIBUTE_MATERIAL_ID = 2, /* u32 */
+  WGPU_GPU_SCENE_ATTRIBUTE_MESH_ID     = 3, /* u32 */
+  WGPU_GPU_SCENE_ATTRIBUTE_COUNT       = 4,
+} wgpu_gpu_scene_attribute_t;
+
+typedef struct wgpu_gpu_scene_desc_t {
+  /* Slot count, 0 = WGPU_GPU_SCENE_DEFAULT_MAX_OBJECT_COUNT */
+  uint32_t max_object_count;
+} wgpu_gpu_scene_desc_t;
+
+typedef struct wgpu_gpu_scene_object_desc_t {
+  mat4 transform;
+  vec3 bounds_min;
+  vec3 bounds_max;
+  uint32_t material_id;
+  uint32_t mesh_id;
+} wgpu_gpu_scene_object_desc_t;
+
+/* Upload statistics of the last wgpu_gpu_scene_upload() */
+typedef struct wgpu_gpu_scene_stats_t {
+  uint32_t object_count;
+  uint32_t slot_count;
+  uint32_t dirty_slot_count; /* attribute slots uploaded */
+  uint32_t copy_count;
+  uint64_t uploaded_bytes;
+} wgpu_gpu_scene_stats_t;
+
+/* GPU scene creating / destroying */
+wgpu_gpu_scene_t* wgpu_gpu_scene_create(wgpu_context_t* wgpu_context,
+                                        const wgpu_gpu_scene_desc_t* desc);
+void wgpu_gpu_scene_destroy(wgpu_gpu_scene_t* scene);
+
+/**
+ * @brief Adds an object, the slot of a removed object is reused first.
+ * @return the handle, WGPU_GPU_SCENE_INVALID_HANDLE if all slots are in use
+ */
+wgpu_gpu_scene_handle_t
+wgpu_gpu_scene_add(wgpu_gpu_scene_t* scene,
+                   const wgpu_gpu_scene_object_desc_t* desc);
+/* Frees the slot of the object, its mesh ID becomes WGPU_GPU_SCENE_INVALID_ID.
+ * The handle and copies of it become invalid. */
+void wgpu_gpu_scene_remove(wgpu_gpu_scene_t* scene,
+                           wgpu_gpu_scene_handle_t handle);
+bool wgpu_gpu_scene_is_valid(wgpu_gpu_scene_t* scene,
+                             wgpu_gpu_scene_handle_t handle);
+/* Slot of the object, its index in the attribute buffers */
+uint32_t wgpu_gpu_scene_get_slot(wgpu_gpu_scene_handle_t handle);
+
+/* Attribute setters, the changes are uploaded on the next upload */
+void wgpu_gpu_scene_set_transform(wgpu_gpu_scene_t* scene,
+                                  wgpu_gpu_scene_handle_t handle,
+                                  mat4 transform);
+void wgpu_gpu_scene_set_bounds(wgpu_gpu_scene_t* scene,
+                               wgpu_gpu_scene_handle_t handle,
+                               vec3 bounds_min, vec3 bounds_max);
+void wgpu_gpu_scene_set_material_id(wgpu_gpu_scene_t* scene,
+                                    wgpu_gpu_scene_handle_t handle,
+                                    uint32_t material_id);
+void wgpu_gpu_scene_set_mesh_id(wgpu_gpu_scene_t* scene,
+                                wgpu_gpu_scene_handle_t handle,
+                                uint32_t mesh_id);
+/* CPU copy of the transform of the object */
+const vec4* wgpu_gpu_scene_get_transform(wgpu_gpu_scene_t* scene,
+                                         wgpu_gpu_scene_handle_t handle);
+
+/**
+ * @brief Uploads the dirty slots, called once per frame before the passes
+ * reading the scene are submitted. Runs the upload ring has no space for are
+ * written through the queue.
+ */
+void wgpu_gpu_scene_upload(wgpu_gpu_scene_t* scene);
+
+/* Storage buffer of an attribute, valid for the lifetime of the scene */
+WGPUBuffer wgpu_gpu_scene_get_buffer(wgpu_gpu_scene_t* scene,
+                                     wgpu_gpu_scene_attribute_t attribute);
+uint64_t wgpu_gpu_scene_get_buffer_size(wgpu_gpu_scene_t* scene,
+                                        wgpu_gpu_scene_attribute_t attribute);
+/* Live objects, and the slots up to the highest slot ever used: passes over
+ * the scene dispatch over the slot count and skip the free slots */
+uint32_t wgpu_gpu_scene_get_object_count(wgpu_gpu_scene_t* scene);
+uint32_t wgpu_gpu_scene_get_slot_count(wgpu_gpu_scene_t* scene);
+const wgpu_gpu_scene_stats_t*
+wgpu_gpu_scene_get_stats(wgpu_gpu_scene_t* scene);
+
+#endif /* GPU_SCENE_H */
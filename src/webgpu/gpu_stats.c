@@ -0,0 +1,648 @@
+#include "gpu_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#define WGPU_STATS_INITIAL_RESOURCE_CAPACITY 1024u
+#define WGPU_STATS_MAX_BIND_GROUPS 4u
+#define WGPU_STATS_MAX_LABEL_LENGTH 48u
+/* Leaked allocations listed by wgpu_stats_report_memory() */
+#define WGPU_STATS_MAX_REPORTED_LEAKS 32u
+
+typedef enum wgpu_stats_resource_type_t {
+  StatsResource_Buffer  = 0,
+  StatsResource_Texture = 1,
+} wgpu_stats_resource_type_t;
+
+/* Live buffer or texture, key NULL = empty slot */
+typedef struct wgpu_stats_resource_t {
+  const void* key;
+  uint64_t size; /* 0 once destroyed */
+  uint32_t refs;
+  wgpu_stats_resource_type_t type;
+  wgpu_memory_category_t category;
+  uint32_t usage;
+  char label[WGPU_STATS_MAX_LABEL_LENGTH];
+} wgpu_stats_resource_t;
+
+static struct {
+  bool enabled;
+  DawnProcTable procs; /* native procs */
+  wgpu_frame_counters_t frame;
+  wgpu_frame_counters_t last_frame;
+  /* State bound in the current pass */
+  struct {
+    const void* pipeline;
+    const void* bind_groups[WGPU_STATS_MAX_BIND_GROUPS];
+  } pass;
+  wgpu_memory_stats_t memory;
+  /* Open addressing hash table with linear probing */
+  struct {
+    wgpu_stats_resource_t* slots;
+    uint32_t capacity; /* power of two */
+    uint32_t count;
+  } resources;
+} wgpu_stats = {0};
+
+/* -------------------------------------------------------------------------- *
+ * Resource table
+ * -------------------------------------------------------------------------- */
+
+static uint32_t resource_slot(const void* key, uint32_t capacity)
+{
+  uint64_t hash = (uint64_t)(uintptr_t)key;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return (uint32_t)hash & (capacity - 1);
+}
+
+static wgpu_stats_resource_t* resource_find(const void* key)
+{
+  if (wgpu_stats.resources.capacity == 0) {
+    return NULL;
+  }
+  const uint32_t mask = wgpu_stats.resources.capacity - 1;
+  for (uint32_t i = resource_slot(key, wgpu_stats.resources.capacity);;
+       i          = (i + 1) & mask) {
+    wgpu_stats_resource_t* slot = &wgpu_stats.resources.slots[i];
+    if (slot->key == key) {
+      return slot;
+    }
+    if (slot->key == NULL) {
+      return NULL;
+    }
+  }
+}
+
+static void resource_insert_slot(wgpu_stats_resource_t* slots,
+                                 uint32_t capacity,
+                                 const wgpu_stats_resource_t* resource)
+{
+  uint32_t i = resource_slot(resource->key, capacity);
+  while (slots[i].key != NULL) {
+    i = (i + 1) & (capacity - 1);
+  }
+  slots[i] = *resource;
+}
+
+static void resource_insert(const wgpu_stats_resource_t* resource)
+{
+  /* Keep the load factor below 3/4 */
+  if ((wgpu_stats.resources.count + 1) * 4
+      > wgpu_stats.resources.capacity * 3) {
+    const uint32_t capacity
+      = MAX(wgpu_stats.resources.capacity * 2,
+            WGPU_STATS_INITIAL_RESOURCE_CAPACITY);
+    wgpu_stats_resource_t* slots = (wgpu_stats_resource_t*)calloc(
+      capacity, sizeof(wgpu_stats_resource_t));
+    for (uint32_t i = 0; i < wgpu_stats.resources.capacity; ++i) {
+      if (wgpu_stats.resources.slots[i].key != NULL) {
+        resource_insert_slot(slots, capacity, &wgpu_stats.resources.slots[i]);
+      }
+    }
+    free(wgpu_stats.resources.slots);
+    wgpu_stats.resources.slots    = slots;
+    wgpu_stats.resources.capacity = capacity;
+  }
+  resource_insert_slot(wgpu_stats.resources.slots,
+                       wgpu_stats.resources.capacity, resource);
+  ++wgpu_stats.resources.count;
+}
+
+/* Removes the slot and moves the following entries of the probe sequence */
+static void resource_remove(wgpu_stats_resource_t* slot)
+{
+  wgpu_stats_resource_t* slots = wgpu_stats.resources.slots;
+  const uint32_t mask          = wgpu_stats.resources.capacity - 1;
+  uint32_t hole                = (uint32_t)(slot - slots);
+  for (uint32_t i = (hole + 1) & mask; slots[i].key != NULL;
+       i          = (i + 1) & mask) {
+    const uint32_t home = resource_slot(slots[i].key, mask + 1);
+    /* Move the entry if its home slot is not between the hole and the entry */
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots[hole] = slots[i];
+      hole        = i;
+    }
+  }
+  slots[hole].key = NULL;
+  --wgpu_stats.resources.count;
+}
+
+static void memory_add(const wgpu_stats_resource_t* resource, int64_t count,
+                       int64_t bytes)
+{
+  wgpu_memory_stats_t* memory = &wgpu_stats.memory;
+  if (resource->type == StatsResource_Buffer) {
+    memory->buffer_count += (uint32_t)count;
+    memory->buffer_bytes += (uint64_t)bytes;
+  }
+  else {
+    memory->texture_count += (uint32_t)count;
+    memory->texture_bytes += (uint64_t)bytes;
+  }
+  memory->peak_bytes
+    = MAX(memory->peak_bytes, memory->buffer_bytes + memory->texture_bytes);
+
+  wgpu_memory_category_stats_t* category
+    = &memory->categories[resource->category];
+  category->count += (uint32_t)count;
+  category->bytes += (uint64_t)bytes;
+  category->peak_bytes = MAX(category->peak_bytes, category->bytes);
+}
+
+static wgpu_memory_category_t buffer_category(WGPUBufferUsageFlags usage)
+{
+  if (usage & (WGPUBufferUsage_MapRead | WGPUBufferUsage_MapWrite)) {
+    return MemoryCategory_Staging;
+  }
+  if (usage & WGPUBufferUsage_Vertex) {
+    return MemoryCategory_Vertex;
+  }
+  if (usage & WGPUBufferUsage_Index) {
+    return MemoryCategory_Index;
+  }
+  if (usage & WGPUBufferUsage_Uniform) {
+    return MemoryCategory_Uniform;
+  }
+  if (usage & WGPUBufferUsage_Storage) {
+    return MemoryCategory_Storage;
+  }
+  return MemoryCategory_OtherBuffer;
+}
+
+static wgpu_memory_category_t texture_category(WGPUTextureUsageFlags usage)
+{
+  return (usage & WGPUTextureUsage_RenderAttachment) ?
+           MemoryCategory_RenderTarget :
+           MemoryCategory_Texture;
+}
+
+static void resource_created(const void* key, wgpu_stats_resource_type_t type,
+                             uint64_t size, uint32_t usage, const char* label)
+{
+  if (key == NULL) {
+    return;
+  }
+  wgpu_stats_resource_t resource = {
+    .key      = key,
+    .size     = size,
+    .refs     = 1,
+    .type     = type,
+    .category = type == StatsResource_Buffer ? buffer_category(usage) :
+                                               texture_category(usage),
+    .usage    = usage,
+  };
+  snprintf(resource.label, sizeof(resource.label), "%s",
+           label != NULL ? label : "");
+  resource_insert(&resource);
+  memory_add(&resource, 1, (int64_t)size);
+}
+
+static void resource_destroyed(const void* key)
+{
+  wgpu_stats_resource_t* resource = resource_find(key);
+  if (resource != NULL && resource->size > 0) {
+    memory_add(resource, -1, -(int64_t)resource->size);
+    resource->size = 0;
+  }
+}
+
+static void resource_referenced(const void* key)
+{
+  wgpu_stats_resource_t* resource = resource_find(key);
+  if (resource != NULL) {
+    ++resource->refs;
+  }
+}
+
+static void resource_released(const void* key)
+{
+  wgpu_stats_resource_t* resource = resource_find(key);
+  if (resource != NULL && --resource->refs == 0) {
+    resource_destroyed(key);
+    resource_remove(resource);
+  }
+}
+
+/* Bytes of a texel, or of a 4x4 block for the BC formats */
+static uint32_t texture_format_size(WGPUTextureFormat format,
+                                    uint32_t* block_size)
+{
+  *block_size = 1;
+  switch (format) {
+    case WGPUTextureFormat_R8Unorm:
+    case WGPUTextureFormat_R8Snorm:
+    case WGPUTextureFormat_R8Uint:
+    case WGPUTextureFormat_R8Sint:
+    case WGPUTextureFormat_Stencil8:
+      return 1;
+    case WGPUTextureFormat_RG8Unorm:
+    case WGPUTextureFormat_R16Uint:
+    case WGPUTextureFormat_R16Float:
+    case WGPUTextureFormat_Depth16Unorm:
+      return 2;
+    case WGPUTextureFormat_RGBA16Float:
+    case WGPUTextureFormat_RGBA16Uint:
+    case WGPUTextureFormat_RG32Float:
+    case WGPUTextureFormat_RG32Uint:
+      return 8;
+    case WGPUTextureFormat_RGBA32Float:
+    case WGPUTextureFormat_RGBA32Uint:
+      return 16;
+    case WGPUTextureFormat_BC1RGBAUnorm:
+    case WGPUTextureFormat_BC1RGBAUnormSrgb:
+    case WGPUTextureFormat_BC4RUnorm:
+      *block_size = 4;
+      return 8;
+    case WGPUTextureFormat_BC3RGBAUnorm:
+    case WGPUTextureFormat_BC3RGBAUnormSrgb:
+    case WGPUTextureFormat_BC5RGUnorm:
+    case WGPUTextureFormat_BC7RGBAUnorm:
+    case WGPUTextureFormat_BC7RGBAUnormSrgb:
+      *block_size = 4;
+      return 16;
+    default:
+      /* 32-bit color and depth formats */
+      return 4;
+  }
+}
+
+static uint64_t texture_size(const WGPUTextureDescriptor* desc)
+{
+  uint32_t block_size   = 1;
+  const uint32_t bytes  = texture_format_size(desc->format, &block_size);
+  const bool is_3d      = desc->dimension == WGPUTextureDimension_3D;
+  const uint32_t layers = is_3d ? 1 : desc->size.depthOrArrayLayers;
+  uint32_t width        = desc->size.width;
+  uint32_t height       = desc->size.height;
+  uint32_t depth        = is_3d ? desc->size.depthOrArrayLayers : 1;
+  uint64_t size         = 0;
+  for (uint32_t level = 0; level < MAX(desc->mipLevelCount, 1u); ++level) {
+    const uint64_t blocks_x = (width + block_size - 1) / block_size;
+    const uint64_t blocks_y = (height + block_size - 1) / block_size;
+    size += blocks_x * blocks_y * depth * bytes;
+    width  = MAX(width / 2, 1u);
+    height = MAX(height / 2, 1u);
+    depth  = MAX(depth / 2, 1u);
+  }
+  return size * layers * MAX(desc->sampleCount, 1u);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Intercepted procs
+ * -------------------------------------------------------------------------- */
+
+static WGPUBuffer stats_device_create_buffer(WGPUDevice device,
+                                             WGPUBufferDescriptor const* desc)
+{
+  WGPUBuffer buffer = wgpu_stats.procs.deviceCreateBuffer(device, desc);
+  resource_created(buffer, StatsResource_Buffer, desc->size, desc->usage,
+                   desc->label);
+  ++wgpu_stats.frame.buffer_creations;
+  return buffer;
+}
+
+static void stats_buffer_reference(WGPUBuffer buffer)
+{
+  resource_referenced(buffer);
+  wgpu_stats.procs.bufferReference(buffer);
+}
+
+static void stats_buffer_release(WGPUBuffer buffer)
+{
+  resource_released(buffer);
+  wgpu_stats.procs.bufferRelease(buffer);
+}
+
+static void stats_buffer_destroy(WGPUBuffer buffer)
+{
+  resource_destroyed(buffer);
+  wgpu_stats.procs.bufferDestroy(buffer);
+}
+
+static WGPUTexture
+stats_device_create_texture(WGPUDevice device,
+                            WGPUTextureDescriptor const* desc)
+{
+  WGPUTexture texture = wgpu_stats.procs.deviceCreateTexture(device, desc);
+  resource_created(texture, StatsResource_Texture, texture_size(desc),
+                   desc->usage, desc->label);
+  ++wgpu_stats.frame.texture_creations;
+  return texture;
+}
+
+static void stats_texture_reference(WGPUTexture texture)
+{
+  resource_referenced(texture);
+  wgpu_stats.procs.textureReference(texture);
+}
+
+static void stats_texture_release(WGPUTexture texture)
+{
+  resource_released(texture);
+  wgpu_stats.procs.textureRelease(texture);
+}
+
+static void stats_texture_destroy(WGPUTexture texture)
+{
+  resource_destroyed(texture);
+  wgpu_stats.procs.textureDestroy(texture);
+}
+
+static WGPURenderPassEncoder
+stats_command_encoder_begin_render_pass(WGPUCommandEncoder cmd_enc,
+                                        WGPURenderPassDescriptor const* desc)
+{
+  ++wgpu_stats.frame.render_passes;
+  memset(&wgpu_stats.pass, 0, sizeof(wgpu_stats.pass));
+  return wgpu_stats.procs.commandEncoderBeginRenderPass(cmd_enc, desc);
+}
+
+static WGPUComputePassEncoder
+stats_command_encoder_begin_compute_pass(WGPUCommandEncoder cmd_enc,
+                                         WGPUComputePassDescriptor const* desc)
+{
+  ++wgpu_stats.frame.compute_passes;
+  memset(&wgpu_stats.pass, 0, sizeof(wgpu_stats.pass));
+  return wgpu_stats.procs.commandEncoderBeginComputePass(cmd_enc, desc);
+}
+
+static void stats_render_pass_draw(WGPURenderPassEncoder rpass_enc,
+                                   uint32_t vertex_count,
+                                   uint32_t instance_count,
+                                   uint32_t first_vertex,
+                                   uint32_t first_instance)
+{
+  ++wgpu_stats.frame.draw_calls;
+  wgpu_stats.frame.vertices += (uint64_t)vertex_count * instance_count;
+  wgpu_stats.frame.instances += instance_count;
+  wgpu_stats.procs.renderPassEncoderDraw(rpass_enc, vertex_count,
+                                         instance_count, first_vertex,
+                                         first_instance);
+}
+
+static void stats_render_pass_draw_indexed(WGPURenderPassEncoder rpass_enc,
+                                           uint32_t index_count,
+                                           uint32_t instance_count,
+                                           uint32_t first_index,
+                                           int32_t base_vertex,
+                                           uint32_t first_instance)
+{
+  ++wgpu_stats.frame.draw_calls;
+  wgpu_stats.frame.indices += (uint64_t)index_count * instance_count;
+  wgpu_stats.frame.instances += instance_count;
+  wgpu_stats.procs.renderPassEncoderDrawIndexed(rpass_enc, index_count,
+                                                instance_count, first_index,
+                                                base_vertex, first_instance);
+}
+
+static void stats_render_pass_draw_indirect(WGPURenderPassEncoder rpass_enc,
+                                            WGPUBuffer indirect_buffer,
+                                            uint64_t indirect_offset)
+{
+  ++wgpu_stats.frame.draw_calls;
+  wgpu_stats.procs.renderPassEncoderDrawIndirect(rpass_enc, indirect_buffer,
+                                                 indirect_offset);
+}
+
+static void
+stats_render_pass_draw_indexed_indirect(WGPURenderPassEncoder rpass_enc,
+                                        WGPUBuffer indirect_buffer,
+                                        uint64_t indirect_offset)
+{
+  ++wgpu_stats.frame.draw_calls;
+  wgpu_stats.procs.renderPassEncoderDrawIndexedIndirect(
+    rpass_enc, indirect_buffer, indirect_offset);
+}
+
+static void stats_count_pipeline(const void* pipeline)
+{
+  ++wgpu_stats.frame.pipeline_sets;
+  if (pipeline == wgpu_stats.pass.pipeline) {
+    ++wgpu_stats.frame.redundant_pipeline_sets;
+  }
+  wgpu_stats.pass.pipeline = pipeline;
+}
+
+static void stats_count_bind_group(uint32_t group_index, const void* group,
+                                   uint32_t dynamic_offset_count)
+{
+  ++wgpu_stats.frame.bind_group_sets;
+  if (group_index >= WGPU_STATS_MAX_BIND_GROUPS) {
+    return;
+  }
+  /* Dynamic offsets can differ between binds of the same group */
+  if (dynamic_offset_count == 0
+      && group == wgpu_stats.pass.bind_groups[group_index]) {
+    ++wgpu_stats.frame.redundant_bind_group_sets;
+  }
+  wgpu_stats.pass.bind_groups[group_index] = group;
+}
+
+static void stats_render_pass_set_pipeline(WGPURenderPassEncoder rpass_enc,
+                                           WGPURenderPipeline pipeline)
+{
+  stats_count_pipeline(pipeline);
+  wgpu_stats.procs.renderPassEncoderSetPipeline(rpass_enc, pipeline);
+}
+
+static void stats_compute_pass_set_pipeline(WGPUComputePassEncoder cpass_enc,
+                                            WGPUComputePipeline pipeline)
+{
+  stats_count_pipeline(pipeline);
+  wgpu_stats.procs.computePassEncoderSetPipeline(cpass_enc, pipeline);
+}
+
+static void stats_render_pass_set_bind_group(WGPURenderPassEncoder rpass_enc,
+                                             uint32_t group_index,
+                                             WGPUBindGroup group,
+                                             uint32_t dynamic_offset_count,
+                                             uint32_t const* dynamic_offsets)
+{
+  stats_count_bind_group(group_index, group, dynamic_offset_count);
+  wgpu_stats.procs.renderPassEncoderSetBindGroup(
+    rpass_enc, group_index, group, dynamic_offset_count, dynamic_offsets);
+}
+
+static void stats_compute_pass_set_bind_group(WGPUComputePassEncoder cpass_enc,
+                                              uint32_t group_index,
+                                              WGPUBindGroup group,
+                                              uint32_t dynamic_offset_count,
+                                              uint32_t const* dynamic_offsets)
+{
+  stats_count_bind_group(group_index, group, dynamic_offset_count);
+  wgpu_stats.procs.computePassEncoderSetBindGroup(
+    cpass_enc, group_index, group, dynamic_offset_count, dynamic_offsets);
+}
+
+static void stats_compute_pass_dispatch(WGPUComputePassEncoder cpass_enc,
+                                        uint32_t x, uint32_t y, uint32_t z)
+{
+  ++wgpu_stats.frame.dispatches;
+  wgpu_stats.procs.computePassEncoderDispatchWorkgroups(cpass_enc, x, y, z);
+}
+
+static void
+stats_compute_pass_dispatch_indirect(WGPUComputePassEncoder cpass_enc,
+                                     WGPUBuffer indirect_buffer,
+                                     uint64_t indirect_offset)
+{
+  ++wgpu_stats.frame.dispatches;
+  wgpu_stats.procs.computePassEncoderDispatchWorkgroupsIndirect(
+    cpass_enc, indirect_buffer, indirect_offset);
+}
+
+static void stats_queue_write_buffer(WGPUQueue queue, WGPUBuffer buffer,
+                                     uint64_t buffer_offset, void const* data,
+                                     size_t size)
+{
+  wgpu_stats.frame.upload_bytes += size;
+  wgpu_stats.procs.queueWriteBuffer(queue, buffer, buffer_offset, data, size);
+}
+
+static void stats_queue_write_texture(WGPUQueue queue,
+                                      WGPUImageCopyTexture const* destination,
+                                      void const* data, size_t data_size,
+                                      WGPUTextureDataLayout const* data_layout,
+                                      WGPUExtent3D const* write_size)
+{
+  wgpu_stats.frame.upload_bytes += data_size;
+  wgpu_stats.procs.queueWriteTexture(queue, destination, data, data_size,
+                                     data_layout, write_size);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+void wgpu_stats_hook_procs(DawnProcTable* procs)
+{
+  wgpu_stats.enabled = true;
+  wgpu_stats.procs   = *procs;
+
+  procs->deviceCreateBuffer  = stats_device_create_buffer;
+  procs->bufferReference     = stats_buffer_reference;
+  procs->bufferRelease       = stats_buffer_release;
+  procs->bufferDestroy       = stats_buffer_destroy;
+  procs->deviceCreateTexture = stats_device_create_texture;
+  procs->textureReference    = stats_texture_reference;
+  procs->textureRelease      = stats_texture_release;
+  procs->textureDestroy      = stats_texture_destroy;
+
+  procs->commandEncoderBeginRenderPass
+    = stats_command_encoder_begin_render_pass;
+  procs->commandEncoderBeginComputePass
+    = stats_command_encoder_begin_compute_pass;
+  procs->renderPassEncoderDraw         = stats_render_pass_draw;
+  procs->renderPassEncoderDrawIndexed  = stats_render_pass_draw_indexed;
+  procs->renderPassEncoderDrawIndirect = stats_render_pass_draw_indirect;
+  procs->renderPassEncoderDrawIndexedIndirect
+    = stats_render_pass_draw_indexed_indirect;
+  procs->computePassEncoderDispatchWorkgroups = stats_compute_pass_dispatch;
+  procs->computePassEncoderDispatchWorkgroupsIndirect
+    = stats_compute_pass_dispatch_indirect;
+
+  procs->renderPassEncoderSetPipeline   = stats_render_pass_set_pipeline;
+  procs->computePassEncoderSetPipeline  = stats_compute_pass_set_pipeline;
+  procs->renderPassEncoderSetBindGroup  = stats_render_pass_set_bind_group;
+  procs->computePassEncoderSetBindGroup = stats_compute_pass_set_bind_group;
+
+  procs->queueWriteBuffer  = stats_queue_write_buffer;
+  procs->queueWriteTexture = stats_queue_write_texture;
+}
+
+bool wgpu_stats_enabled(void)
+{
+  return wgpu_stats.enabled;
+}
+
+void wgpu_stats_add_upload_bytes(uint64_t size)
+{
+  wgpu_stats.frame.upload_bytes += size;
+}
+
+void wgpu_stats_end_frame(void)
+{
+  wgpu_stats.last_frame = wgpu_stats.frame;
+  wgpu_stats.frame      = (wgpu_frame_counters_t){0};
+}
+
+void wgpu_stats_get_frame_counters(wgpu_frame_counters_t* counters)
+{
+  *counters = wgpu_stats.last_frame;
+}
+
+void wgpu_stats_get_memory(wgpu_memory_stats_t* memory)
+{
+  *memory = wgpu_stats.memory;
+}
+
+const char*
+wgpu_stats_get_memory_category_name(wgpu_memory_category_t category)
+{
+  static const char* names[MemoryCategory_Count] = {
+    "staging",        /* */
+    "vertex",         /* */
+    "index",          /* */
+    "uniform",        /* */
+    "storage",        /* */
+    "other buffers",  /* */
+    "render targets", /* */
+    "textures",       /* */
+  };
+  return category < MemoryCategory_Count ? names[category] : "?";
+}
+
+void wgpu_stats_report_memory(void)
+{
+  if (!wgpu_stats.enabled) {
+    return;
+  }
+
+  const wgpu_memory_stats_t* memory = &wgpu_stats.memory;
+  log_info("GPU memory high-water mark: %.1f MiB",
+           (double)memory->peak_bytes / (1024.0 * 1024.0));
+  for (uint32_t i = 0; i < MemoryCategory_Count; ++i) {
+    const wgpu_memory_category_stats_t* category = &memory->categories[i];
+    const char* name
+      = wgpu_stats_get_memory_category_name((wgpu_memory_category_t)i);
+    if (category->peak_bytes > 0) {
+      log_info("  %-14s peak %8.1f MiB", name,
+               (double)category->peak_bytes / (1024.0 * 1024.0));
+    }
+  }
+
+  /* Allocations still alive, handles destroyed but not released hold no
+   * memory and are only counted */
+  uint32_t leak_count = 0, destroyed_count = 0;
+  for (uint32_t i = 0; i < wgpu_stats.resources.capacity; ++i) {
+    const wgpu_stats_resource_t* resource = &wgpu_stats.resources.slots[i];
+    if (resource->key == NULL) {
+      continue;
+    }
+    if (resource->size == 0) {
+      ++destroyed_count;
+      continue;
+    }
+    if (leak_count++ < WGPU_STATS_MAX_REPORTED_LEAKS) {
+      log_warn("Leaked %s '%s': %llu bytes, usage 0x%x",
+               wgpu_stats_get_memory_category_name(resource->category),
+               resource->label, (unsigned long long)resource->size,
+               resource->usage);
+    }
+  }
+  if (leak_count > 0) {
+    log_warn("%u buffers and textures leaked (%.1f MiB)", leak_count,
+             (double)(memory->buffer_bytes + memory->texture_bytes)
+               / (1024.0 * 1024.0));
+  }
+  if (destroyed_count > 0) {
+    log_warn("%u destroyed buffers and textures not released",
+             destroyed_count);
+  }
+}
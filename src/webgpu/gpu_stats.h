@@ -0,0 +1,97 @@
+#ifndef GPU_STATS_H
+#define GPU_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dawn/dawn_proc_table.h>
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU statistics
+ *
+ * Counts the draw calls, state changes and uploads of a frame and keeps track
+ * of the memory of the live buffers and textures. The calls are intercepted
+ * by replacing entries of the Dawn proc table, wgpu_stats_hook_procs() is set
+ * as the proc table hook of wgpu_native before the adapter is requested.
+ *
+ * The hook is only installed when the WGPU_STATS_ENABLED option is compiled
+ * in, otherwise all counters stay zero and wgpu_stats_enabled() is false.
+ *
+ * The counters are not synchronized, the intercepted WebGPU calls are made by
+ * the render thread. Redundant binds are detected against the state of the
+ * most recently begun pass. Memory is counted for the application references:
+ * a buffer or texture is freed once it is destroyed or its last reference is
+ * released.
+ *
+ * Every live allocation is recorded with its size, usage and label, the
+ * memory is summed per category with high-water marks. The allocations still
+ * alive when the context is released are reported as leaks.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_frame_counters_t {
+  uint32_t render_passes;
+  uint32_t compute_passes;
+  uint32_t draw_calls; /* direct and indirect draws */
+  uint64_t vertices;   /* vertices of the direct non-indexed draws */
+  uint64_t indices;    /* indices of the direct indexed draws */
+  uint64_t instances;  /* instances of the direct draws */
+  uint32_t dispatches; /* direct and indirect dispatches */
+  uint32_t pipeline_sets;
+  uint32_t redundant_pipeline_sets; /* pipeline already set in the pass */
+  uint32_t bind_group_sets;
+  uint32_t redundant_bind_group_sets; /* same group without dynamic offsets */
+  uint64_t upload_bytes; /* queue writes and upload ring copies */
+  uint32_t buffer_creations;  /* allocation churn */
+  uint32_t texture_creations; /* allocation churn */
+} wgpu_frame_counters_t;
+
+/* Category of an allocation, from its usage in this order of precedence */
+typedef enum wgpu_memory_category_t {
+  MemoryCategory_Staging      = 0, /* mappable buffers */
+  MemoryCategory_Vertex       = 1,
+  MemoryCategory_Index        = 2,
+  MemoryCategory_Uniform      = 3,
+  MemoryCategory_Storage      = 4,
+  MemoryCategory_OtherBuffer  = 5, /* indirect, query resolve, copy only */
+  MemoryCategory_RenderTarget = 6, /* render attachment textures */
+  MemoryCategory_Texture      = 7,
+  MemoryCategory_Count        = 8,
+} wgpu_memory_category_t;
+
+typedef struct wgpu_memory_category_stats_t {
+  uint32_t count;
+  uint64_t bytes;
+  uint64_t peak_bytes; /* high-water mark */
+} wgpu_memory_category_stats_t;
+
+typedef struct wgpu_memory_stats_t {
+  uint32_t buffer_count;
+  uint64_t buffer_bytes;
+  uint32_t texture_count;
+  uint64_t texture_bytes; /* estimated from the format, size and mip levels */
+  uint64_t peak_bytes;    /* high-water mark of the buffers and textures */
+  wgpu_memory_category_stats_t categories[MemoryCategory_Count];
+} wgpu_memory_stats_t;
+
+/* Proc table hook, see wgpu_set_proc_table_hook() */
+void wgpu_stats_hook_procs(DawnProcTable* procs);
+/* Whether the WebGPU calls are counted */
+bool wgpu_stats_enabled(void);
+
+/* Adds uploads which are not made with queue writes, e.g. mapped memory */
+void wgpu_stats_add_upload_bytes(uint64_t size);
+
+/* Completes the counters of the frame, done by wgpu_swap_chain_present() */
+void wgpu_stats_end_frame(void);
+
+/* Counters of the last completed frame */
+void wgpu_stats_get_frame_counters(wgpu_frame_counters_t* counters);
+void wgpu_stats_get_memory(wgpu_memory_stats_t* memory);
+const char*
+wgpu_stats_get_memory_category_name(wgpu_memory_category_t category);
+
+/* Logs the high-water marks and the buffers and textures still alive, done by
+ * wgpu_context_release() once the context resources are released */
+void wgpu_stats_report_memory(void);
+
+#endif /* GPU_STATS_H */
@@ -0,0 +1,954 @@
+#include "hiz_culling.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/frustum.h"
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "shader.h"
+
+/* Texels per pyramid workgroup side */
+#define HIZ_CULLING_TILE_SIZE 8u
+
+/* Layout of the WGSL HizParams struct */
+typedef struct hiz_culling_params_t {
+  mat4 view_projection;
+  float depth_size[2];
+  uint32_t level_count;
+  uint32_t flags;
+} hiz_culling_params_t;
+
+#define HIZ_CULLING_FLAG_VALID 0x1u
+#define HIZ_CULLING_FLAG_REVERSED_Z 0x2u
+
+/* Layout of the WGSL CullParams struct */
+typedef struct hiz_cull_list_params_t {
+  vec4 planes[6];
+  uint32_t object_count;
+  uint32_t draw_count;
+  uint32_t visible_stride;
+  uint32_t write_visible;
+} hiz_cull_list_params_t;
+
+/* Sources of the pyramid reduction, the first level reads the depth texture */
+// clang-format off
+static const char* hiz_source_depth_wgsl = CODE(
+  @group(0) @binding(0) var source : texture_depth_2d;
+
+  fn loadSource(coord : vec2<i32>) -> f32 {
+    return textureLoad(source, coord, 0);
+  }
+);
+
+static const char* hiz_source_depth_multisampled_wgsl = CODE(
+  @group(0) @binding(0) var source : texture_depth_multisampled_2d;
+
+  fn loadSource(coord : vec2<i32>) -> f32 {
+    var depth = textureLoad(source, coord, 0);
+    for (var i = 1u; i < textureNumSamples(source); i = i + 1u) {
+      depth = farthest(depth, textureLoad(source, coord, i32(i)));
+    }
+    return depth;
+  }
+);
+
+static const char* hiz_source_level_wgsl = CODE(
+  @group(0) @binding(0) var source : texture_2d<f32>;
+
+  fn loadSource(coord : vec2<i32>) -> f32 {
+    return textureLoad(source, coord, 0).r;
+  }
+);
+
+static const char* hiz_reduce_wgsl = CODE(
+  struct ReduceParams {
+    reversedZ : u32,
+  }
+
+  @group(0) @binding(1) var destination : texture_storage_2d<r32float, write>;
+  @group(0) @binding(2) var<uniform> reduce : ReduceParams;
+
+  fn farthest(a : f32, b : f32) -> f32 {
+    if (reduce.reversedZ != 0u) {
+      return min(a, b);
+    }
+    return max(a, b);
+  }
+);
+
+// Every texel is the farthest depth of its 2 x 2 source texels, the level
+// sizes are rounded up so the last row and column only clamp to the source
+static const char* hiz_reduce_main_wgsl = CODE(
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let size = vec2<u32>(textureDimensions(destination));
+    if (global_id.x >= size.x || global_id.y >= size.y) {
+      return;
+    }
+    let last = vec2<i32>(textureDimensions(source)) - vec2<i32>(1);
+    let s = vec2<i32>(global_id.xy) * 2;
+    var depth = loadSource(s);
+    depth = farthest(depth, loadSource(min(s + vec2<i32>(1, 0), last)));
+    depth = farthest(depth, loadSource(min(s + vec2<i32>(0, 1), last)));
+    depth = farthest(depth, loadSource(min(s + vec2<i32>(1, 1), last)));
+    textureStore(destination, vec2<i32>(global_id.xy),
+                 vec4<f32>(depth, 0.0, 0.0, 0.0));
+  }
+);
+
+/* Occlusion test, the bindings are prepended by wgpu_hiz_culling_create_wgsl */
+static const char* hiz_test_wgsl = CODE(
+  fn hizIsOccluded(aabbMin : vec3<f32>, aabbMax : vec3<f32>) -> bool {
+    if ((hiz.flags & 1u) == 0u) {
+      return false;
+    }
+    let reversedZ = (hiz.flags & 2u) != 0u;
+
+    // Bounds of the projected corners, bounds crossing the near plane are
+    // never occluded
+    var ndcMin = vec3<f32>(1.0e30);
+    var ndcMax = vec3<f32>(-1.0e30);
+    for (var i = 0u; i < 8u; i = i + 1u) {
+      let corner = select(aabbMin, aabbMax,
+                          vec3<bool>((i & 1u) != 0u, (i & 2u) != 0u,
+                                     (i & 4u) != 0u));
+      let clip = hiz.viewProjection * vec4<f32>(corner, 1.0);
+      if (clip.w <= 0.0) {
+        return false;
+      }
+      let ndc = clip.xyz / clip.w;
+      ndcMin = min(ndcMin, ndc);
+      ndcMax = max(ndcMax, ndc);
+    }
+    if (any(ndcMax.xy < vec2<f32>(-1.0)) || any(ndcMin.xy > vec2<f32>(1.0))) {
+      return false;
+    }
+
+    // Screen rectangle in pixels, the pyramid texels of a level cover
+    // 2^(level + 1) pixels, the rectangle covers at most 2 x 2 of them
+    let pxMin = clamp(vec2<f32>(ndcMin.x, -ndcMax.y) * 0.5 + 0.5,
+                      vec2<f32>(0.0), vec2<f32>(1.0)) * hiz.depthSize;
+    let pxMax = clamp(vec2<f32>(ndcMax.x, -ndcMin.y) * 0.5 + 0.5,
+                      vec2<f32>(0.0), vec2<f32>(1.0)) * hiz.depthSize;
+    let extent = max(max(pxMax.x - pxMin.x, pxMax.y - pxMin.y), 1.0);
+    let level = u32(max(ceil(log2(extent)), 1.0)) - 1u;
+    if (level >= hiz.levelCount) {
+      return false;
+    }
+    let texelSize = f32(1u << (level + 1u));
+    let last = vec2<i32>(textureDimensions(hizPyramid, level)) - vec2<i32>(1);
+    let t0 = min(vec2<i32>(pxMin / texelSize), last);
+    let t1 = min(vec2<i32>(pxMax / texelSize), last);
+    let d0 = textureLoad(hizPyramid, t0, level).r;
+    let d1 = textureLoad(hizPyramid, vec2<i32>(t1.x, t0.y), level).r;
+    let d2 = textureLoad(hizPyramid, vec2<i32>(t0.x, t1.y), level).r;
+    let d3 = textureLoad(hizPyramid, t1, level).r;
+
+    // Occluded if the nearest depth of the bounds is behind the farthest
+    // depth of the texels
+    if (reversedZ) {
+      return ndcMax.z < min(min(d0, d1), min(d2, d3));
+    }
+    return ndcMin.z > max(max(d0, d1), max(d2, d3));
+  }
+
+  fn hizIsSphereOccluded(center : vec3<f32>, radius : f32) -> bool {
+    let extent = vec3<f32>(radius);
+    return hizIsOccluded(center - extent, center + extent);
+  }
+);
+
+/* Generic culling of the objects of a cull list */
+static const char* hiz_cull_list_wgsl = CODE(
+  struct HizObject {
+    aabbMin : vec3<f32>,
+    drawIndex : u32,
+    aabbMax : vec3<f32>,
+    visibleIndex : u32,
+  }
+
+  struct DrawIndexedIndirect {
+    indexCount : u32,
+    instanceCount : atomic<u32>,
+    firstIndex : u32,
+    baseVertex : i32,
+    firstInstance : u32,
+  }
+
+  struct CullParams {
+    planes : array<vec4<f32>, 6>,
+    objectCount : u32,
+    drawCount : u32,
+    visibleStride : u32,
+    writeVisible : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : CullParams;
+  @group(0) @binding(1) var<storage, read> objects : array<HizObject>;
+  @group(0) @binding(2)
+  var<storage, read_write> draws : array<DrawIndexedIndirect>;
+  @group(0) @binding(3) var<storage, read_write> visible : array<u32>;
+
+  fn isInFrustum(aabbMin : vec3<f32>, aabbMax : vec3<f32>) -> bool {
+    for (var i = 0u; i < 6u; i = i + 1u) {
+      let plane = params.planes[i];
+      let p = select(aabbMin, aabbMax, plane.xyz >= vec3<f32>(0.0));
+      if (dot(plane.xyz, p) + plane.w < 0.0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  @compute @workgroup_size(64)
+  fn reset(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x < params.drawCount) {
+      atomicStore(&draws[global_id.x].instanceCount, 0u);
+    }
+  }
+
+  @compute @workgroup_size(64)
+  fn main(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x >= params.objectCount) {
+      return;
+    }
+    let object = objects[global_id.x];
+    if (!isInFrustum(object.aabbMin, object.aabbMax)
+        || hizIsOccluded(object.aabbMin, object.aabbMax)) {
+      return;
+    }
+    let slot = atomicAdd(&draws[object.drawIndex].instanceCount, 1u);
+    if (params.writeVisible != 0u) {
+      visible[object.drawIndex * params.visibleStride + slot]
+        = object.visibleIndex;
+    }
+  }
+);
+// clang-format on
+
+/**
+ * @brief Hi-Z culling class
+ */
+struct wgpu_hiz_culling {
+  wgpu_context_t* wgpu_context;
+  /* Depth pyramid, level 0 has half the depth resolution */
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view; /* all levels, read by the occlusion test */
+    WGPUTextureView level_views[WGPU_HIZ_CULLING_MAX_LEVELS];
+    uint32_t level_count;
+    uint32_t depth_width;
+    uint32_t depth_height;
+  } pyramid;
+  /* Depth view of the last built depth texture, it keeps the texture alive */
+  WGPUTexture depth_texture;
+  WGPUTextureView depth_view;
+  /* Pyramid reduction */
+  struct {
+    WGPUBindGroupLayout bind_group_layouts[3];
+    WGPUPipelineLayout pipeline_layouts[3];
+    WGPUComputePipeline pipelines[3]; /* depth, multisampled depth, level */
+    WGPUBuffer params_buffer;
+  } reduce;
+  /* Occlusion test parameters and bind group, the parameters of a build are
+   * staged and copied after the pyramid pass, queue writes would be visible to
+   * the culling recorded before it */
+  hiz_culling_params_t params;
+  WGPUBuffer params_buffer;
+  WGPUBuffer staging_params_buffer;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  /* Generic culling of cull lists, created with the first cull list */
+  struct {
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUPipelineLayout pipeline_layout;
+    WGPUComputePipeline reset_pipeline;
+    WGPUComputePipeline cull_pipeline;
+  } cull;
+};
+
+/**
+ * @brief Cull list class
+ */
+struct wgpu_hiz_cull_list {
+  wgpu_hiz_culling_t* hiz;
+  wgpu_hiz_cull_list_desc_t desc;
+  WGPUBuffer params_buffer;
+  WGPUBuffer dummy_visible_buffer; /* bound without visible list */
+  WGPUBindGroup bind_group;
+};
+
+static char* hiz_concat_wgsl(const char* const* sources, uint32_t count)
+{
+  size_t length = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += strlen(sources[i]) + 1;
+  }
+  char* wgsl = (char*)malloc(length);
+  char* cur  = wgsl;
+  for (uint32_t i = 0; i < count; ++i) {
+    const size_t source_length = strlen(sources[i]);
+    memcpy(cur, sources[i], source_length);
+    cur += source_length;
+    *cur++ = '\n';
+  }
+  *cur = '\0';
+  return wgsl;
+}
+
+/* Pyramid reduction pipelines */
+
+static void hiz_culling_create_reduce_pipelines(wgpu_hiz_culling_t* hiz)
+{
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+  const char* sources[3]       = {
+    hiz_source_depth_wgsl,
+    hiz_source_depth_multisampled_wgsl,
+    hiz_source_level_wgsl,
+  };
+  const WGPUTextureBindingLayout source_layouts[3] = {
+    {
+      .sampleType    = WGPUTextureSampleType_Depth,
+      .viewDimension = WGPUTextureViewDimension_2D,
+    },
+    {
+      .sampleType    = WGPUTextureSampleType_Depth,
+      .viewDimension = WGPUTextureViewDimension_2D,
+      .multisampled  = true,
+    },
+    {
+      .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+      .viewDimension = WGPUTextureViewDimension_2D,
+    },
+  };
+
+  for (uint32_t i = 0; i < 3; ++i) {
+    WGPUBindGroupLayoutEntry bgl_entries[3] = {
+      [0] = (WGPUBindGroupLayoutEntry) {
+        /* Binding 0: Source depth or pyramid level */
+        .binding    = 0,
+        .visibility = WGPUShaderStage_Compute,
+        .texture    = source_layouts[i],
+      },
+      [1] = (WGPUBindGroupLayoutEntry) {
+        /* Binding 1: Reduced pyramid level */
+        .binding    = 1,
+        .visibility = WGPUShaderStage_Compute,
+        .storageTexture = (WGPUStorageTextureBindingLayout) {
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = WGPUTextureFormat_R32Float,
+          .viewDimension = WGPUTextureViewDimension_2D,
+        },
+      },
+      [2] = (WGPUBindGroupLayoutEntry) {
+        /* Binding 2: Reduction parameters */
+        .binding    = 2,
+        .visibility = WGPUShaderStage_Compute,
+        .buffer = (WGPUBufferBindingLayout) {
+          .type           = WGPUBufferBindingType_Uniform,
+          .minBindingSize = 4 * sizeof(uint32_t),
+        },
+      },
+    };
+    hiz->reduce.bind_group_layouts[i] = wgpuDeviceCreateBindGroupLayout(
+      wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                              .label = "Hi-Z reduce bind group layout",
+                              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                              .entries    = bgl_entries,
+                            });
+    ASSERT(hiz->reduce.bind_group_layouts[i] != NULL);
+
+    hiz->reduce.pipeline_layouts[i] = wgpuDeviceCreatePipelineLayout(
+      wgpu_context->device,
+      &(WGPUPipelineLayoutDescriptor){
+        .label                = "Hi-Z reduce pipeline layout",
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts     = &hiz->reduce.bind_group_layouts[i],
+      });
+    ASSERT(hiz->reduce.pipeline_layouts[i] != NULL);
+
+    // The source declares loadSource(), which uses farthest() of the reduction
+    const char* shader_sources[3] = {
+      hiz_reduce_wgsl,
+      sources[i],
+      hiz_reduce_main_wgsl,
+    };
+    char* wgsl_code = hiz_concat_wgsl(shader_sources, 3);
+    wgpu_shader_t reduce_shader = wgpu_shader_create(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      /* Compute shader WGSL */
+                      .wgsl_code.source = wgsl_code,
+                      .entry            = "main",
+                    });
+    hiz->reduce.pipelines[i] = wgpu_create_compute_pipeline(
+      wgpu_context, &(WGPUComputePipelineDescriptor){
+                      .label   = "Hi-Z reduce pipeline",
+                      .layout  = hiz->reduce.pipeline_layouts[i],
+                      .compute = reduce_shader.programmable_stage_descriptor,
+                    });
+    ASSERT(hiz->reduce.pipelines[i] != NULL);
+    wgpu_shader_release(&reduce_shader);
+    free(wgsl_code);
+  }
+}
+
+/* Depth pyramid */
+
+static void hiz_culling_release_pyramid(wgpu_hiz_culling_t* hiz)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup, hiz->bind_group)
+  for (uint32_t i = 0; i < hiz->pyramid.level_count; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, hiz->pyramid.level_views[i])
+  }
+  WGPU_RELEASE_RESOURCE(TextureView, hiz->pyramid.view)
+  WGPU_RELEASE_RESOURCE(Texture, hiz->pyramid.texture)
+  hiz->pyramid.level_count = 0;
+}
+
+/* Creates the pyramid of the given depth size, the bind group of the occlusion
+ * test is recreated with it */
+static void hiz_culling_create_pyramid(wgpu_hiz_culling_t* hiz,
+                                       uint32_t depth_width,
+                                       uint32_t depth_height)
+{
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+  hiz_culling_release_pyramid(hiz);
+
+  const uint32_t width  = MAX((depth_width + 1) / 2, 1u);
+  const uint32_t height = MAX((depth_height + 1) / 2, 1u);
+  uint32_t level_count  = 1;
+  while ((MAX(width, height) >> level_count) > 0
+         && level_count < WGPU_HIZ_CULLING_MAX_LEVELS) {
+    ++level_count;
+  }
+  hiz->pyramid.level_count  = level_count;
+  hiz->pyramid.depth_width  = depth_width;
+  hiz->pyramid.depth_height = depth_height;
+
+  hiz->pyramid.texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = "Hi-Z depth pyramid",
+      .usage = WGPUTextureUsage_StorageBinding
+               | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = width,
+        .height             = height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = WGPUTextureFormat_R32Float,
+      .mipLevelCount = level_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(hiz->pyramid.texture != NULL);
+
+  WGPUTextureViewDescriptor view_desc = {
+    .label           = "Hi-Z depth pyramid view",
+    .format          = WGPUTextureFormat_R32Float,
+    .dimension       = WGPUTextureViewDimension_2D,
+    .baseMipLevel    = 0,
+    .mipLevelCount   = level_count,
+    .baseArrayLayer  = 0,
+    .arrayLayerCount = 1,
+    .aspect          = WGPUTextureAspect_All,
+  };
+  hiz->pyramid.view = wgpuTextureCreateView(hiz->pyramid.texture, &view_desc);
+  ASSERT(hiz->pyramid.view != NULL);
+  view_desc.label         = "Hi-Z depth pyramid level view";
+  view_desc.mipLevelCount = 1;
+  for (uint32_t i = 0; i < level_count; ++i) {
+    view_desc.baseMipLevel = i;
+    hiz->pyramid.level_views[i]
+      = wgpuTextureCreateView(hiz->pyramid.texture, &view_desc);
+    ASSERT(hiz->pyramid.level_views[i] != NULL);
+  }
+
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding     = 0,
+      .textureView = hiz->pyramid.view,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = hiz->params_buffer,
+      .size    = sizeof(hiz_culling_params_t),
+    },
+  };
+  hiz->bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Hi-Z culling bind group",
+                            .layout     = hiz->bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(hiz->bind_group != NULL);
+}
+
+/* Hi-Z culling creating / destroying */
+
+wgpu_hiz_culling_t* wgpu_hiz_culling_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_hiz_culling_t* hiz
+    = (wgpu_hiz_culling_t*)calloc(1, sizeof(wgpu_hiz_culling_t));
+  hiz->wgpu_context = wgpu_context;
+
+  hiz->params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "Hi-Z culling params buffer",
+                            .usage = WGPUBufferUsage_CopyDst
+                                     | WGPUBufferUsage_Uniform,
+                            .size = sizeof(hiz_culling_params_t),
+                          });
+  hiz->staging_params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "Hi-Z culling staging params buffer",
+                            .usage = WGPUBufferUsage_CopyDst
+                                     | WGPUBufferUsage_CopySrc,
+                            .size = sizeof(hiz_culling_params_t),
+                          });
+  hiz->reduce.params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "Hi-Z reduce params buffer",
+                            .usage = WGPUBufferUsage_CopyDst
+                                     | WGPUBufferUsage_Uniform,
+                            .size = 4 * sizeof(uint32_t),
+                          });
+
+  /* Bind group layout of the occlusion test */
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Depth pyramid */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute | WGPUShaderStage_Vertex,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Pyramid parameters */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute | WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(hiz_culling_params_t),
+      },
+    },
+  };
+  hiz->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Hi-Z culling bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(hiz->bind_group_layout != NULL);
+
+  hiz_culling_create_reduce_pipelines(hiz);
+
+  /* Placeholder pyramid, nothing is culled until the first build */
+  hiz_culling_create_pyramid(hiz, 1, 1);
+  wgpu_hiz_culling_invalidate(hiz);
+
+  return hiz;
+}
+
+void wgpu_hiz_culling_destroy(wgpu_hiz_culling_t* hiz)
+{
+  if (hiz == NULL) {
+    return;
+  }
+
+  hiz_culling_release_pyramid(hiz);
+  WGPU_RELEASE_RESOURCE(TextureView, hiz->depth_view)
+  for (uint32_t i = 0; i < 3; ++i) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, hiz->reduce.pipelines[i])
+    WGPU_RELEASE_RESOURCE(PipelineLayout, hiz->reduce.pipeline_layouts[i])
+    WGPU_RELEASE_RESOURCE(BindGroupLayout, hiz->reduce.bind_group_layouts[i])
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, hiz->reduce.params_buffer)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, hiz->cull.reset_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, hiz->cull.cull_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, hiz->cull.pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, hiz->cull.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, hiz->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Buffer, hiz->params_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, hiz->staging_params_buffer)
+  free(hiz);
+}
+
+/* Depth pyramid building */
+
+static void hiz_culling_reduce_level(wgpu_hiz_culling_t* hiz,
+                                     WGPUComputePassEncoder cpass_enc,
+                                     uint32_t pipeline_index,
+                                     WGPUTextureView source, uint32_t level)
+{
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding     = 0,
+      .textureView = source,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = hiz->pyramid.level_views[level],
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = hiz->reduce.params_buffer,
+      .size    = 4 * sizeof(uint32_t),
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    hiz->wgpu_context,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Hi-Z reduce bind group",
+      .layout     = hiz->reduce.bind_group_layouts[pipeline_index],
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+
+  const uint32_t width
+    = MAX(((hiz->pyramid.depth_width + 1) / 2) >> level, 1u);
+  const uint32_t height
+    = MAX(((hiz->pyramid.depth_height + 1) / 2) >> level, 1u);
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    hiz->reduce.pipelines[pipeline_index]);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc, (width + HIZ_CULLING_TILE_SIZE - 1) / HIZ_CULLING_TILE_SIZE,
+    (height + HIZ_CULLING_TILE_SIZE - 1) / HIZ_CULLING_TILE_SIZE, 1);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
+
+void wgpu_hiz_culling_build(wgpu_hiz_culling_t* hiz, WGPUCommandEncoder cmd_enc,
+                            WGPUTexture depth_texture, uint32_t width,
+                            uint32_t height, uint32_t sample_count,
+                            mat4 view_projection)
+{
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+  ASSERT(depth_texture != NULL && width > 0 && height > 0);
+
+  if (hiz->pyramid.depth_width != width
+      || hiz->pyramid.depth_height != height) {
+    hiz_culling_create_pyramid(hiz, width, height);
+  }
+  if (hiz->depth_texture != depth_texture) {
+    WGPU_RELEASE_RESOURCE(TextureView, hiz->depth_view)
+    hiz->depth_texture = depth_texture;
+    hiz->depth_view    = wgpuTextureCreateView(
+      depth_texture, &(WGPUTextureViewDescriptor){
+                          .label           = "Hi-Z depth view",
+                          .dimension       = WGPUTextureViewDimension_2D,
+                          .baseMipLevel    = 0,
+                          .mipLevelCount   = 1,
+                          .baseArrayLayer  = 0,
+                          .arrayLayerCount = 1,
+                          .aspect          = WGPUTextureAspect_DepthOnly,
+                        });
+    ASSERT(hiz->depth_view != NULL);
+  }
+
+  const bool reversed_z           = wgpu_context->depth_stencil.reversed_z;
+  const uint32_t reduce_params[4] = {reversed_z ? 1u : 0u, 0, 0, 0};
+  wgpu_queue_write_buffer(wgpu_context, hiz->reduce.params_buffer, 0,
+                          reduce_params, sizeof(reduce_params));
+
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Hi-Z pyramid");
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Hi-Z pyramid compute pass",
+             });
+  hiz_culling_reduce_level(hiz, cpass_enc, sample_count > 1 ? 1 : 0,
+                           hiz->depth_view, 0);
+  for (uint32_t level = 1; level < hiz->pyramid.level_count; ++level) {
+    hiz_culling_reduce_level(hiz, cpass_enc, 2,
+                             hiz->pyramid.level_views[level - 1], level);
+  }
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+
+  /* Used by the culling of the next frame */
+  glm_mat4_copy(view_projection, hiz->params.view_projection);
+  hiz->params.depth_size[0] = (float)width;
+  hiz->params.depth_size[1] = (float)height;
+  hiz->params.level_count   = hiz->pyramid.level_count;
+  hiz->params.flags         = HIZ_CULLING_FLAG_VALID
+                      | (reversed_z ? HIZ_CULLING_FLAG_REVERSED_Z : 0u);
+  wgpu_queue_write_buffer(wgpu_context, hiz->staging_params_buffer, 0,
+                          &hiz->params, sizeof(hiz->params));
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, hiz->staging_params_buffer, 0,
+                                       hiz->params_buffer, 0,
+                                       sizeof(hiz->params));
+}
+
+void wgpu_hiz_culling_invalidate(wgpu_hiz_culling_t* hiz)
+{
+  hiz->params.flags = 0;
+  wgpu_queue_write_buffer(hiz->wgpu_context, hiz->params_buffer, 0,
+                          &hiz->params, sizeof(hiz->params));
+}
+
+/* Custom culling shaders */
+
+WGPUBindGroupLayout
+wgpu_hiz_culling_get_bind_group_layout(wgpu_hiz_culling_t* hiz)
+{
+  return hiz->bind_group_layout;
+}
+
+WGPUBindGroup wgpu_hiz_culling_get_bind_group(wgpu_hiz_culling_t* hiz)
+{
+  return hiz->bind_group;
+}
+
+char* wgpu_hiz_culling_create_wgsl(uint32_t group, const char* shader)
+{
+  char bindings[512];
+  snprintf(bindings, sizeof(bindings),
+           "struct HizParams {\n"
+           "  viewProjection : mat4x4<f32>,\n"
+           "  depthSize : vec2<f32>,\n"
+           "  levelCount : u32,\n"
+           "  flags : u32,\n"
+           "}\n"
+           "@group(%u) @binding(0) var hizPyramid : texture_2d<f32>;\n"
+           "@group(%u) @binding(1) var<uniform> hiz : HizParams;\n",
+           group, group);
+  const char* sources[3] = {
+    bindings,
+    hiz_test_wgsl,
+    shader,
+  };
+  return hiz_concat_wgsl(sources, (uint32_t)ARRAY_SIZE(sources));
+}
+
+/* Generic culling of object lists */
+
+static void hiz_culling_create_cull_pipelines(wgpu_hiz_culling_t* hiz)
+{
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Culling parameters */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(hiz_cull_list_params_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Objects */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = sizeof(wgpu_hiz_object_t),
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 2: Indirect draw arguments */
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = 5 * sizeof(uint32_t),
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 3: Visible lists */
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = sizeof(uint32_t),
+      },
+    },
+  };
+  hiz->cull.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Hi-Z cull list bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(hiz->cull.bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    hiz->cull.bind_group_layout, /* Group 0: Cull list */
+    hiz->bind_group_layout,      /* Group 1: Depth pyramid */
+  };
+  hiz->cull.pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "Hi-Z cull list pipeline layout",
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+      .bindGroupLayouts     = bind_group_layouts,
+    });
+  ASSERT(hiz->cull.pipeline_layout != NULL);
+
+  char* wgsl_code = wgpu_hiz_culling_create_wgsl(1, hiz_cull_list_wgsl);
+  wgpu_shader_t reset_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "reset",
+                  });
+  hiz->cull.reset_pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Hi-Z cull list reset pipeline",
+                    .layout  = hiz->cull.pipeline_layout,
+                    .compute = reset_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(hiz->cull.reset_pipeline != NULL);
+  wgpu_shader_release(&reset_shader);
+
+  wgpu_shader_t cull_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "main",
+                  });
+  hiz->cull.cull_pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Hi-Z cull list pipeline",
+                    .layout  = hiz->cull.pipeline_layout,
+                    .compute = cull_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(hiz->cull.cull_pipeline != NULL);
+  wgpu_shader_release(&cull_shader);
+  free(wgsl_code);
+}
+
+wgpu_hiz_cull_list_t*
+wgpu_hiz_cull_list_create(wgpu_hiz_culling_t* hiz,
+                          const wgpu_hiz_cull_list_desc_t* desc)
+{
+  ASSERT(desc->objects != NULL && desc->object_count > 0);
+  ASSERT(desc->draws != NULL && desc->draw_count > 0);
+
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+  if (hiz->cull.cull_pipeline == NULL) {
+    hiz_culling_create_cull_pipelines(hiz);
+  }
+
+  wgpu_hiz_cull_list_t* cull_list
+    = (wgpu_hiz_cull_list_t*)calloc(1, sizeof(wgpu_hiz_cull_list_t));
+  cull_list->hiz  = hiz;
+  cull_list->desc = *desc;
+
+  cull_list->params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "Hi-Z cull list params buffer",
+                            .usage = WGPUBufferUsage_CopyDst
+                                     | WGPUBufferUsage_Uniform,
+                            .size = sizeof(hiz_cull_list_params_t),
+                          });
+  WGPUBuffer visible = desc->visible;
+  if (visible == NULL) {
+    cull_list->dummy_visible_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device, &(WGPUBufferDescriptor){
+                              .label = "Hi-Z cull list dummy visible buffer",
+                              .usage = WGPUBufferUsage_Storage,
+                              .size  = sizeof(uint32_t),
+                            });
+    visible = cull_list->dummy_visible_buffer;
+  }
+
+  WGPUBindGroupEntry bg_entries[4] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = cull_list->params_buffer,
+      .size    = sizeof(hiz_cull_list_params_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = desc->objects,
+      .size    = desc->object_count * sizeof(wgpu_hiz_object_t),
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = desc->draws,
+      .size    = desc->draw_count * 5 * sizeof(uint32_t),
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding = 3,
+      .buffer  = visible,
+      .size    = WGPU_WHOLE_SIZE,
+    },
+  };
+  cull_list->bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Hi-Z cull list bind group",
+                            .layout     = hiz->cull.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(cull_list->bind_group != NULL);
+
+  return cull_list;
+}
+
+void wgpu_hiz_cull_list_destroy(wgpu_hiz_cull_list_t* cull_list)
+{
+  if (cull_list == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(BindGroup, cull_list->bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, cull_list->params_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, cull_list->dummy_visible_buffer)
+  free(cull_list);
+}
+
+void wgpu_hiz_cull_list_cull(wgpu_hiz_cull_list_t* cull_list,
+                             WGPUCommandEncoder cmd_enc,
+                             mat4 view_projection)
+{
+  wgpu_hiz_culling_t* hiz      = cull_list->hiz;
+  wgpu_context_t* wgpu_context = hiz->wgpu_context;
+
+  /* Culling parameters */
+  frustum_t frustum;
+  frustum_update(&frustum, view_projection);
+  hiz_cull_list_params_t params = {
+    .object_count   = cull_list->desc.object_count,
+    .draw_count     = cull_list->desc.draw_count,
+    .visible_stride = cull_list->desc.visible_stride,
+    .write_visible  = cull_list->desc.visible != NULL ? 1u : 0u,
+  };
+  memcpy(params.planes, frustum.planes, sizeof(params.planes));
+  wgpu_queue_write_buffer(wgpu_context, cull_list->params_buffer, 0, &params,
+                          sizeof(params));
+
+  /* Reset the instance counts, then append the visible objects */
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Hi-Z culling");
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Hi-Z culling compute pass",
+             });
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, cull_list->bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, hiz->bind_group, 0, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, hiz->cull.reset_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (params.draw_count + WGPU_HIZ_CULLING_WORKGROUP_SIZE - 1)
+      / WGPU_HIZ_CULLING_WORKGROUP_SIZE,
+    1, 1);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, hiz->cull.cull_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (params.object_count + WGPU_HIZ_CULLING_WORKGROUP_SIZE - 1)
+      / WGPU_HIZ_CULLING_WORKGROUP_SIZE,
+    1, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+}
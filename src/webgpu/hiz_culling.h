@@ -0,0 +1,118 @@
+#ifndef HIZ_CULLING_H
+#define HIZ_CULLING_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* Levels of the depth pyramid, enough for 65536 x 65536 depth textures */
+#define WGPU_HIZ_CULLING_MAX_LEVELS 16u
+#define WGPU_HIZ_CULLING_WORKGROUP_SIZE 64u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Hi-Z occlusion culling
+ *
+ * GPU-only occlusion culling against a hierarchical depth buffer. Once per
+ * frame, after the opaque geometry was drawn, wgpu_hiz_culling_build() reduces
+ * the depth texture into a pyramid of the farthest depth per texel, level 0
+ * has half the depth resolution. The culling of the next frame tests the
+ * screen rectangle of the world space bounds against the pyramid level where
+ * the rectangle covers at most 2 x 2 texels, projected with the view
+ * projection of the frame which laid down the depth.
+ *
+ * The test is available to custom culling shaders, see
+ * wgpu_hiz_culling_create_wgsl(), and as a generic culling pass of object
+ * lists which writes DrawIndexedIndirect arguments, see wgpu_hiz_cull_list_t.
+ * Nothing is read back to the CPU.
+ *
+ * Objects are never culled before the first pyramid is built and when their
+ * bounds cross the near plane. Geometry which was hidden in the last frame and
+ * becomes visible is drawn one frame late.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_hiz_culling wgpu_hiz_culling_t;
+
+/* Hi-Z culling creating / destroying */
+wgpu_hiz_culling_t* wgpu_hiz_culling_create(wgpu_context_t* wgpu_context);
+void wgpu_hiz_culling_destroy(wgpu_hiz_culling_t* hiz);
+
+/**
+ * @brief Builds the depth pyramid from the depth texture of the frame, the
+ * pyramid is resized with the depth texture.
+ * @param depth_texture single or multisampled depth texture with the
+ * TextureBinding usage, the depth aspect is read
+ * @param view_projection the view projection matrix the depth was rendered with
+ */
+void wgpu_hiz_culling_build(wgpu_hiz_culling_t* hiz, WGPUCommandEncoder cmd_enc,
+                            WGPUTexture depth_texture, uint32_t width,
+                            uint32_t height, uint32_t sample_count,
+                            mat4 view_projection);
+
+/* Drops the pyramid, nothing is culled until the next build, e.g. after a
+ * camera cut */
+void wgpu_hiz_culling_invalidate(wgpu_hiz_culling_t* hiz);
+
+/* Custom culling shaders */
+
+/* Bind group layout of the pyramid and its parameters */
+WGPUBindGroupLayout
+wgpu_hiz_culling_get_bind_group_layout(wgpu_hiz_culling_t* hiz);
+
+/* Bind group of the current pyramid, it changes when the pyramid is resized */
+WGPUBindGroup wgpu_hiz_culling_get_bind_group(wgpu_hiz_culling_t* hiz);
+
+/**
+ * @brief Prepends the bindings of the given group and the test functions to a
+ * shader:
+ *
+ *   fn hizIsOccluded(aabbMin : vec3<f32>, aabbMax : vec3<f32>) -> bool
+ *   fn hizIsSphereOccluded(center : vec3<f32>, radius : f32) -> bool
+ *
+ * @return the WGSL code, to be freed by the caller
+ */
+char* wgpu_hiz_culling_create_wgsl(uint32_t group, const char* shader);
+
+/* Generic culling of object lists */
+
+/* Object of a cull list, 32 bytes, matches the HizObject struct in WGSL */
+typedef struct wgpu_hiz_object_t {
+  vec3 aabb_min; /* world space bounds */
+  uint32_t draw_index;
+  vec3 aabb_max;
+  uint32_t visible_index; /* written to the visible list of the draw */
+} wgpu_hiz_object_t;
+
+typedef struct wgpu_hiz_cull_list_desc_t {
+  /* Storage buffer of wgpu_hiz_object_t */
+  WGPUBuffer objects;
+  uint32_t object_count;
+  /* Storage | Indirect buffer of DrawIndexedIndirect arguments, the instance
+   * counts are reset and incremented per visible object of the draw */
+  WGPUBuffer draws;
+  uint32_t draw_count;
+  /* Optional storage buffer of u32, the visible index of the i-th visible
+   * object of draw d is written to visible[d * visible_stride + i] */
+  WGPUBuffer visible;
+  uint32_t visible_stride;
+} wgpu_hiz_cull_list_desc_t;
+
+typedef struct wgpu_hiz_cull_list wgpu_hiz_cull_list_t;
+
+/* Cull list creating / destroying */
+wgpu_hiz_cull_list_t*
+wgpu_hiz_cull_list_create(wgpu_hiz_culling_t* hiz,
+                          const wgpu_hiz_cull_list_desc_t* desc);
+void wgpu_hiz_cull_list_destroy(wgpu_hiz_cull_list_t* cull_list);
+
+/**
+ * @brief Culls the objects against the view frustum and the depth pyramid and
+ * writes the instance counts (and visible lists) of the draws, recorded before
+ * the draws of the frame.
+ * @param view_projection the view projection matrix of the current frame, used
+ * for frustum culling
+ */
+void wgpu_hiz_cull_list_cull(wgpu_hiz_cull_list_t* cull_list,
+                             WGPUCommandEncoder cmd_enc,
+                             mat4 view_projection);
+
+#endif /* HIZ_CULLING_H */
@@ -0,0 +1,573 @@
+#include "image_filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Uniform buffer offset alignment of the pass parameters */
+#define IMAGE_FILTER_PASS_SLOT_SIZE 256u
+
+/* Stage of the chain, matches Stage in WGSL */
+typedef struct image_filter_stage_params_t {
+  float weights[3][4]; /* rows of the kernel in xyz */
+  float scale;
+  float bias;
+  uint32_t radius;
+  uint32_t grayscale;
+} image_filter_stage_params_t;
+
+/* Stages of a dispatch, matches Pass in WGSL */
+typedef struct image_filter_pass_params_t {
+  uint32_t first_stage;
+  uint32_t stage_count;
+  uint32_t radius;
+  uint32_t padding;
+} image_filter_pass_params_t;
+
+/* The workgroup memory holds two regions of the tile and its halo, the stage
+ * results are read from one and written into the other */
+// clang-format off
+static const char* image_filter_wgsl = CODE(
+  struct Stage {
+    weights   : array<vec4f, 3>,
+    scale     : f32,
+    bias      : f32,
+    radius    : u32,
+    grayscale : u32,
+  }
+
+  struct Pass {
+    firstStage : u32,
+    stageCount : u32,
+    radius     : u32,
+    padding    : u32,
+  }
+
+  /* WGPU_IMAGE_FILTER_TILE_SIZE and WGPU_IMAGE_FILTER_MAX_FUSED_RADIUS */
+  const kTileSize   = 16u;
+  const kMaxRadius  = 4u;
+  const kRegionSize = kTileSize + 2u * kMaxRadius;
+
+  @group(0) @binding(0) var<uniform> stages : array<Stage, 16>;
+  @group(0) @binding(1) var<uniform> params : Pass;
+  @group(0) @binding(2) var srcImage : texture_2d<f32>;
+  @group(0) @binding(3) var dstImage : texture_storage_2d<rgba8unorm, write>;
+
+  var<workgroup> region : array<array<u32, kRegionSize * kRegionSize>, 2>;
+
+  fn regionIndex(p : vec2i) -> u32 {
+    return u32(p.x) + u32(p.y) * kRegionSize;
+  }
+
+  fn channels(stage : Stage, color : vec4f) -> vec3f {
+    if (stage.grayscale != 0u) {
+      return vec3f((color.r + color.g + color.b) / 3.0);
+    }
+    return color.rgb;
+  }
+
+  /* Rounded to 8 bits like an RGBA8Unorm intermediate image */
+  fn finish(stage : Stage, sum : vec3f) -> vec4f {
+    let color = clamp(sum * stage.scale + stage.bias, vec3f(0.0), vec3f(1.0));
+    return unpack4x8unorm(pack4x8unorm(vec4f(color, 1.0)));
+  }
+
+  /* End of the point-wise stages starting at first */
+  fn pointStagesEnd(first : u32, end : u32) -> u32 {
+    var s = first;
+    while (s < end && stages[s].radius == 0u) {
+      s += 1u;
+    }
+    return s;
+  }
+
+  fn applyPointStages(first : u32, end : u32, color : vec4f) -> vec4f {
+    var result = color;
+    for (var s = first; s < end; s += 1u) {
+      let stage = stages[s];
+      result = finish(stage, stage.weights[1].y * channels(stage, result));
+    }
+    return result;
+  }
+
+  fn applyStencil(stage : Stage, src : u32, p : vec2i, origin : vec2i,
+                  size : vec2i) -> vec4f {
+    var sum = vec3f(0.0);
+    for (var y = 0; y < 3; y += 1) {
+      for (var x = 0; x < 3; x += 1) {
+        let q = clamp(p + vec2i(x - 1, y - 1), vec2i(0), size - 1) - origin;
+        let color = unpack4x8unorm(region[src][regionIndex(q)]);
+        sum += stage.weights[y][x] * channels(stage, color);
+      }
+    }
+    return finish(stage, sum);
+  }
+
+  @compute @workgroup_size(16, 16)
+  fn main(@builtin(workgroup_id) workgroup_id : vec3u,
+          @builtin(local_invocation_id) local_id : vec3u,
+          @builtin(local_invocation_index) local_index : u32) {
+    let size   = vec2i(textureDimensions(srcImage));
+    let radius = i32(params.radius);
+    let origin = vec2i(workgroup_id.xy * kTileSize) - vec2i(radius);
+    let extent = kTileSize + 2u * params.radius;
+    let end    = params.firstStage + params.stageCount;
+
+    /* Tile and halo, edge clamped, with the leading point-wise stages */
+    var first = params.firstStage;
+    var last  = pointStagesEnd(first, end);
+    for (var i = local_index; i < extent * extent;
+         i += kTileSize * kTileSize) {
+      let p = vec2i(vec2u(i % extent, i / extent));
+      let color = textureLoad(srcImage, clamp(origin + p, vec2i(0), size - 1),
+                              0);
+      region[0][regionIndex(p)]
+        = pack4x8unorm(applyPointStages(first, last, color));
+    }
+    workgroupBarrier();
+
+    /* Every stencil shrinks the region by its radius, the pixels outside of
+     * the image are never read, the reads are clamped to the image */
+    var src    = 0u;
+    var margin = 0u;
+    first      = last;
+    while (first < end) {
+      let stage = stages[first];
+      margin += stage.radius;
+      last = pointStagesEnd(first + 1u, end);
+      let inner = extent - 2u * margin;
+      for (var i = local_index; i < inner * inner;
+           i += kTileSize * kTileSize) {
+        let p     = vec2i(vec2u(margin + i % inner, margin + i / inner));
+        let pixel = origin + p;
+        if (all(pixel >= vec2i(0)) && all(pixel < size)) {
+          let color = applyStencil(stage, src, pixel, origin, size);
+          region[1u - src][regionIndex(p)]
+            = pack4x8unorm(applyPointStages(first + 1u, last, color));
+        }
+      }
+      src   = 1u - src;
+      first = last;
+      workgroupBarrier();
+    }
+
+    let pixel = vec2i(workgroup_id.xy * kTileSize + local_id.xy);
+    if (all(pixel < size)) {
+      let p = vec2i(local_id.xy) + vec2i(radius);
+      textureStore(dstImage, pixel,
+                   unpack4x8unorm(region[src][regionIndex(p)]));
+    }
+  }
+);
+// clang-format on
+
+/**
+ * @brief Image filter class
+ */
+struct wgpu_image_filter {
+  wgpu_context_t* wgpu_context;
+  bool fused;
+  /* Chain */
+  wgpu_image_filter_stage_t stages[WGPU_IMAGE_FILTER_MAX_STAGES];
+  uint32_t stage_count;
+  image_filter_pass_params_t passes[WGPU_IMAGE_FILTER_MAX_STAGES];
+  uint32_t pass_count;
+  WGPUBuffer stages_buffer;
+  WGPUBuffer passes_buffer;
+  /* Intermediate images between the dispatches */
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+  } images[2];
+  uint32_t width;
+  uint32_t height;
+  /* Pipeline */
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+};
+
+/* Predefined kernels */
+
+static const struct {
+  const char* name;
+  wgpu_image_filter_stage_t stage;
+} image_filter_kernels[WGPU_ImageFilter_Count] = {
+  [WGPU_ImageFilter_Emboss] = {
+    .name  = "Emboss",
+    .stage = {
+      .weights   = {-1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 2.0f},
+      .scale     = 1.0f,
+      .bias      = 0.5f,
+      .grayscale = true,
+    },
+  },
+  [WGPU_ImageFilter_EdgeDetect] = {
+    .name  = "Edge detect",
+    .stage = {
+      .weights   = {-0.125f, -0.125f, -0.125f, -0.125f, 1.0f, -0.125f,
+                    -0.125f, -0.125f, -0.125f},
+      .scale     = 10.0f,
+      .grayscale = true,
+    },
+  },
+  [WGPU_ImageFilter_Sharpen] = {
+    .name  = "Sharpen",
+    .stage = {
+      .weights = {-1.0f, -1.0f, -1.0f, -1.0f, 9.0f, -1.0f, -1.0f, -1.0f,
+                  -1.0f},
+      .scale   = 1.0f,
+    },
+  },
+  [WGPU_ImageFilter_Blur] = {
+    .name  = "Blur",
+    .stage = {
+      .weights = {1.0f, 2.0f, 1.0f, 2.0f, 4.0f, 2.0f, 1.0f, 2.0f, 1.0f},
+      .scale   = 1.0f / 16.0f,
+    },
+  },
+  [WGPU_ImageFilter_Grayscale] = {
+    .name  = "Grayscale",
+    .stage = {
+      .weights   = {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+      .scale     = 1.0f,
+      .grayscale = true,
+    },
+  },
+  [WGPU_ImageFilter_Invert] = {
+    .name  = "Invert",
+    .stage = {
+      .weights = {0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+      .scale   = 1.0f,
+      .bias    = 1.0f,
+    },
+  },
+};
+
+wgpu_image_filter_stage_t
+wgpu_image_filter_get_kernel(wgpu_image_filter_kernel_enum_t kernel)
+{
+  ASSERT(kernel < WGPU_ImageFilter_Count);
+  return image_filter_kernels[kernel].stage;
+}
+
+const char*
+wgpu_image_filter_get_kernel_name(wgpu_image_filter_kernel_enum_t kernel)
+{
+  ASSERT(kernel < WGPU_ImageFilter_Count);
+  return image_filter_kernels[kernel].name;
+}
+
+/* Image filter creating / destroying */
+
+static void image_filter_create_pipeline(wgpu_image_filter_t* filter)
+{
+  wgpu_context_t* wgpu_context = filter->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Stages */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(image_filter_stage_params_t)
+                          * WGPU_IMAGE_FILTER_MAX_STAGES,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Pass */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_Uniform,
+        .hasDynamicOffset = true,
+        .minBindingSize   = sizeof(image_filter_pass_params_t),
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 2: Source image */
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 3: Destination image */
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .storageTexture = (WGPUStorageTextureBindingLayout) {
+        .access        = WGPUStorageTextureAccess_WriteOnly,
+        .format        = WGPUTextureFormat_RGBA8Unorm,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+  };
+  filter->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Image filter bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(filter->bind_group_layout != NULL);
+
+  filter->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .label = "Image filter pipeline layout",
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &filter->bind_group_layout,
+                          });
+  ASSERT(filter->pipeline_layout != NULL);
+
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .label            = "Image filter compute shader",
+                    .wgsl_code.source = image_filter_wgsl,
+                    .entry            = "main",
+                  });
+  filter->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Image filter pipeline",
+                    .layout  = filter->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(filter->pipeline != NULL);
+  wgpu_shader_release(&shader);
+}
+
+wgpu_image_filter_t* wgpu_image_filter_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_image_filter_t* filter
+    = (wgpu_image_filter_t*)calloc(1, sizeof(*filter));
+  filter->wgpu_context = wgpu_context;
+  filter->fused        = true;
+
+  filter->stages_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Image filter stages",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size
+      = sizeof(image_filter_stage_params_t) * WGPU_IMAGE_FILTER_MAX_STAGES,
+    });
+  ASSERT(filter->stages_buffer != NULL);
+  filter->passes_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Image filter passes",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size = IMAGE_FILTER_PASS_SLOT_SIZE * WGPU_IMAGE_FILTER_MAX_STAGES,
+    });
+  ASSERT(filter->passes_buffer != NULL);
+
+  image_filter_create_pipeline(filter);
+  wgpu_image_filter_set_stages(filter, NULL, 0);
+
+  return filter;
+}
+
+static void image_filter_release_images(wgpu_image_filter_t* filter)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(filter->images); ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, filter->images[i].view)
+    WGPU_RELEASE_RESOURCE(Texture, filter->images[i].texture)
+  }
+  filter->width  = 0;
+  filter->height = 0;
+}
+
+void wgpu_image_filter_destroy(wgpu_image_filter_t* filter)
+{
+  if (filter == NULL) {
+    return;
+  }
+
+  image_filter_release_images(filter);
+  WGPU_RELEASE_RESOURCE(ComputePipeline, filter->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, filter->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, filter->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Buffer, filter->stages_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, filter->passes_buffer)
+  free(filter);
+}
+
+/* Chain */
+
+static uint32_t image_filter_stage_radius(const wgpu_image_filter_stage_t* s)
+{
+  for (uint32_t i = 0; i < 9; ++i) {
+    if (i != 4 && s->weights[i] != 0.0f) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Splits the chain into dispatches of at most the fused radius, every stage
+ * is its own dispatch without fusion */
+static void image_filter_update_passes(wgpu_image_filter_t* filter)
+{
+  image_filter_pass_params_t* pass = &filter->passes[0];
+  memset(pass, 0, sizeof(*pass));
+  filter->pass_count = 1;
+  for (uint32_t i = 0; i < filter->stage_count; ++i) {
+    const uint32_t radius = image_filter_stage_radius(&filter->stages[i]);
+    if (pass->stage_count > 0
+        && (!filter->fused
+            || pass->radius + radius > WGPU_IMAGE_FILTER_MAX_FUSED_RADIUS)) {
+      pass = &filter->passes[filter->pass_count++];
+      *pass = (image_filter_pass_params_t){
+        .first_stage = i,
+      };
+    }
+    ++pass->stage_count;
+    pass->radius += radius;
+  }
+
+  for (uint32_t i = 0; i < filter->pass_count; ++i) {
+    wgpuQueueWriteBuffer(filter->wgpu_context->queue, filter->passes_buffer,
+                         i * IMAGE_FILTER_PASS_SLOT_SIZE, &filter->passes[i],
+                         sizeof(image_filter_pass_params_t));
+  }
+}
+
+void wgpu_image_filter_set_stages(wgpu_image_filter_t* filter,
+                                  const wgpu_image_filter_stage_t* stages,
+                                  uint32_t stage_count)
+{
+  ASSERT(stage_count <= WGPU_IMAGE_FILTER_MAX_STAGES);
+
+  image_filter_stage_params_t params[WGPU_IMAGE_FILTER_MAX_STAGES] = {0};
+  for (uint32_t i = 0; i < stage_count; ++i) {
+    const wgpu_image_filter_stage_t* stage = &stages[i];
+    for (uint32_t j = 0; j < 9; ++j) {
+      params[i].weights[j / 3][j % 3] = stage->weights[j];
+    }
+    params[i].scale     = stage->scale;
+    params[i].bias      = stage->bias;
+    params[i].radius    = image_filter_stage_radius(stage);
+    params[i].grayscale = stage->grayscale ? 1u : 0u;
+    filter->stages[i]   = *stage;
+  }
+  filter->stage_count = stage_count;
+  wgpuQueueWriteBuffer(filter->wgpu_context->queue, filter->stages_buffer, 0,
+                       params, sizeof(params));
+
+  image_filter_update_passes(filter);
+}
+
+void wgpu_image_filter_set_fused(wgpu_image_filter_t* filter, bool fused)
+{
+  if (filter->fused != fused) {
+    filter->fused = fused;
+    image_filter_update_passes(filter);
+  }
+}
+
+uint32_t wgpu_image_filter_get_pass_count(wgpu_image_filter_t* filter)
+{
+  return filter->pass_count;
+}
+
+/* Filtering */
+
+static void image_filter_prepare_images(wgpu_image_filter_t* filter,
+                                        uint32_t width, uint32_t height)
+{
+  if (filter->images[0].texture != NULL && filter->width == width
+      && filter->height == height) {
+    return;
+  }
+  image_filter_release_images(filter);
+
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(filter->images); ++i) {
+    filter->images[i].texture = wgpuDeviceCreateTexture(
+      filter->wgpu_context->device,
+      &(WGPUTextureDescriptor){
+        .label = "Image filter intermediate texture",
+        .usage
+        = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_StorageBinding,
+        .dimension     = WGPUTextureDimension_2D,
+        .size          = (WGPUExtent3D){width, height, 1},
+        .format        = WGPUTextureFormat_RGBA8Unorm,
+        .mipLevelCount = 1,
+        .sampleCount   = 1,
+      });
+    ASSERT(filter->images[i].texture != NULL);
+    filter->images[i].view
+      = wgpuTextureCreateView(filter->images[i].texture, NULL);
+    ASSERT(filter->images[i].view != NULL);
+  }
+  filter->width  = width;
+  filter->height = height;
+}
+
+void wgpu_image_filter_apply(wgpu_image_filter_t* filter,
+                             WGPUCommandEncoder cmd_enc,
+                             WGPUTextureView input, WGPUTextureView output,
+                             uint32_t width, uint32_t height)
+{
+  wgpu_context_t* wgpu_context = filter->wgpu_context;
+  if (filter->pass_count > 1) {
+    image_filter_prepare_images(filter, width, height);
+  }
+
+  const uint32_t tile = WGPU_IMAGE_FILTER_TILE_SIZE;
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Image filter");
+  /* The intermediate image of a dispatch is read by the next one, which
+   * needs a new compute pass */
+  for (uint32_t i = 0; i < filter->pass_count; ++i) {
+    WGPUTextureView src = (i == 0) ? input : filter->images[(i - 1) % 2].view;
+    WGPUTextureView dst
+      = (i + 1 == filter->pass_count) ? output : filter->images[i % 2].view;
+    WGPUBindGroupEntry bg_entries[4] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = filter->stages_buffer,
+        .size    = sizeof(image_filter_stage_params_t)
+                   * WGPU_IMAGE_FILTER_MAX_STAGES,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = filter->passes_buffer,
+        .size    = sizeof(image_filter_pass_params_t),
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding     = 2,
+        .textureView = src,
+      },
+      [3] = (WGPUBindGroupEntry) {
+        .binding     = 3,
+        .textureView = dst,
+      },
+    };
+    WGPUBindGroup bind_group = wgpu_create_bind_group(
+      wgpu_context, &(WGPUBindGroupDescriptor){
+                      .label      = "Image filter bind group",
+                      .layout     = filter->bind_group_layout,
+                      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                      .entries    = bg_entries,
+                    });
+    ASSERT(bind_group != NULL);
+
+    const uint32_t pass_offset = i * IMAGE_FILTER_PASS_SLOT_SIZE;
+    WGPUComputePassEncoder cpass_enc
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(cpass_enc, filter->pipeline);
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 1,
+                                       &pass_offset);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      cpass_enc, (width + tile - 1) / tile, (height + tile - 1) / tile, 1);
+    wgpuComputePassEncoderEnd(cpass_enc);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  }
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+}
@@ -0,0 +1,89 @@
+#ifndef IMAGE_FILTER_H
+#define IMAGE_FILTER_H
+
+#include "context.h"
+
+/* Stages of a filter chain */
+#define WGPU_IMAGE_FILTER_MAX_STAGES 16u
+/* Halo of a fused dispatch, the sum of the stage radii it covers */
+#define WGPU_IMAGE_FILTER_MAX_FUSED_RADIUS 4u
+/* Output pixels per workgroup in x and y */
+#define WGPU_IMAGE_FILTER_TILE_SIZE 16u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU image filter
+ *
+ * Applies a chain of 3x3 convolution kernels and point-wise operations to an
+ * RGBA8Unorm image, e.g. emboss -> edge detect -> sharpen. Each stage
+ * computes
+ *
+ *   result = clamp(sum(weights * pixels) * scale + bias, 0, 1)
+ *
+ * per color channel, or on the average of r, g and b for grayscale stages,
+ * with the image edges clamped. A stage with only a center weight is
+ * point-wise (radius 0), any other weight makes it a stencil of radius 1.
+ *
+ * Adjacent stages are fused into one tiled dispatch: a workgroup loads its
+ * tile with a halo of the summed stage radii into workgroup memory, every
+ * stencil stage computes the region shrunk by its radius, the point-wise
+ * stages are applied in the same step as the stage before them. A chain is
+ * split into dispatches of at most WGPU_IMAGE_FILTER_MAX_FUSED_RADIUS halo,
+ * beyond that the recomputed halo costs more than an intermediate image. The
+ * pixels between the stages are quantized to 8 bits like in an RGBA8Unorm
+ * intermediate, so fused and unfused chains give the same image.
+ *
+ *   wgpu_image_filter_set_stages(filter, stages, stage_count);
+ *   wgpu_image_filter_apply(filter, cmd_enc, input, output, width, height);
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_image_filter wgpu_image_filter_t;
+
+typedef enum wgpu_image_filter_kernel_enum_t {
+  WGPU_ImageFilter_Emboss     = 0,
+  WGPU_ImageFilter_EdgeDetect = 1,
+  WGPU_ImageFilter_Sharpen    = 2,
+  WGPU_ImageFilter_Blur       = 3,
+  WGPU_ImageFilter_Grayscale  = 4,
+  WGPU_ImageFilter_Invert     = 5,
+  WGPU_ImageFilter_Count      = 6,
+} wgpu_image_filter_kernel_enum_t;
+
+typedef struct wgpu_image_filter_stage_t {
+  /* 3x3 kernel, row major, the center is weights[4] */
+  float weights[9];
+  float scale;
+  float bias;
+  /* Weights the average of r, g and b, the result is gray */
+  bool grayscale;
+} wgpu_image_filter_stage_t;
+
+/* Image filter creating / destroying */
+wgpu_image_filter_t* wgpu_image_filter_create(wgpu_context_t* wgpu_context);
+void wgpu_image_filter_destroy(wgpu_image_filter_t* filter);
+
+/* Stage of a predefined kernel */
+wgpu_image_filter_stage_t
+wgpu_image_filter_get_kernel(wgpu_image_filter_kernel_enum_t kernel);
+const char* wgpu_image_filter_get_kernel_name(
+  wgpu_image_filter_kernel_enum_t kernel);
+
+/* Replaces the chain, at most WGPU_IMAGE_FILTER_MAX_STAGES stages, an empty
+ * chain copies the input */
+void wgpu_image_filter_set_stages(wgpu_image_filter_t* filter,
+                                  const wgpu_image_filter_stage_t* stages,
+                                  uint32_t stage_count);
+/* Fusion is enabled by default, disabled every stage is its own dispatch
+ * through an intermediate image, for comparing both */
+void wgpu_image_filter_set_fused(wgpu_image_filter_t* filter, bool fused);
+/* Dispatches of the chain */
+uint32_t wgpu_image_filter_get_pass_count(wgpu_image_filter_t* filter);
+
+/* Records the chain from the input view (TextureBinding usage) into the
+ * output view (RGBA8Unorm, StorageBinding usage) of the size, in its own
+ * compute passes */
+void wgpu_image_filter_apply(wgpu_image_filter_t* filter,
+                             WGPUCommandEncoder cmd_enc,
+                             WGPUTextureView input, WGPUTextureView output,
+                             uint32_t width, uint32_t height);
+
+#endif /* IMAGE_FILTER_H */
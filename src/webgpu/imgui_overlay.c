@@ -1,5 +1,6 @@
 #include "imgui_overlay.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,12 +15,27 @@
 #endif
 #define ImDrawCallback_ResetRenderState (ImDrawCallback)(-1)
 
+#include "../core/distance_field.h"
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "sampler_cache.h"
 #include "shader.h"
-
-#define _IMGUI_MAX_VERTEX_DATA_SIZE_DEFAULT 40000
-#define _IMGUI_MAX_INDEX_DATA_SIZE_DEFAULT 10000
+#include "upload_ring.h"
+
+// Initial vertex / index buffer capacity, the buffers grow geometrically
+#define _IMGUI_VERTEX_BUFFER_CAPACITY_DEFAULT 4096
+#define _IMGUI_INDEX_BUFFER_CAPACITY_DEFAULT 8192
+// Pipeline variants for the render passes of the caller
+#define _IMGUI_MAX_PASS_PIPELINES 4
+// Distance field font: the font is rasterized at _IMGUI_FONT_FIELD_DOWNSAMPLE
+// times its size and stored as a distance field at its size, so the glyphs are
+// sharp at any overlay scale without rasterizing the font again
+#define _IMGUI_FONT_SIZE 13.0f
+#define _IMGUI_FONT_FIELD_DOWNSAMPLE 4u
+#define _IMGUI_FONT_FIELD_SPREAD 2.0f
+#define _IMGUI_FONT_FIELD_CACHE_FILENAME "imgui_font.sdf"
 
 // Vertex buffer and attributes
 typedef struct vertex_uniform_buffer_t {
@@ -43,6 +59,11 @@ typedef struct imgui_overlay {
     WGPUSampler sampler;
   } font;
   WGPURenderPipeline pipeline;
+  struct {
+    imgui_overlay_pass_desc_t desc;
+    WGPURenderPipeline pipeline;
+  } pass_pipelines[_IMGUI_MAX_PASS_PIPELINES];
+  uint32_t pass_pipeline_count;
   WGPUPipelineLayout pipeline_layout;
   wgpu_buffer_t uniform_buffer;
   wgpu_buffer_t vertex_buffer;
@@ -53,20 +74,61 @@ typedef struct imgui_overlay {
   WGPURenderPassColorAttachment rp_color_att_descriptors[1];
   WGPURenderPassDescriptor render_pass_desc;
   struct {
-    struct {
-      ImDrawVert data[_IMGUI_MAX_VERTEX_DATA_SIZE_DEFAULT];
-      int32_t size;
-    } vertex;
-    struct {
-      ImDrawIdx data[_IMGUI_MAX_INDEX_DATA_SIZE_DEFAULT];
-      int32_t size;
-    } index;
+    // Capacity of the vertex / index buffer in elements
+    int32_t vertex_capacity;
+    int32_t index_capacity;
+    // Hash of the uploaded draw lists, 0 if the buffers need an upload
+    uint64_t hash;
+    // Last uploaded projection
+    vertex_uniform_buffer_t uniforms;
+    bool uniforms_valid;
   } draw_buffers;
   bool visible;
   bool updated;
   float scale;
 } imgui_overlay;
 
+// clang-format off
+static const char* imgui_overlay_shader_wgsl = CODE(
+  struct Uniforms {
+    mvp : mat4x4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> uniforms : Uniforms;
+  @group(0) @binding(1) var font_sampler : sampler;
+  @group(0) @binding(2) var font_texture : texture_2d<f32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+    @location(1) color : vec4<f32>,
+  }
+
+  @vertex
+  fn vertexMain(@location(0) position : vec2<f32>,
+                @location(1) uv : vec2<f32>,
+                @location(2) color : vec4<f32>) -> VertexOutput {
+    var output : VertexOutput;
+    output.position = uniforms.mvp * vec4<f32>(position, 0.0, 1.0);
+    output.uv       = uv;
+    output.color    = color;
+    return output;
+  }
+
+  // Alpha from the distance field of the font, the edge is smoothed over about
+  // one pixel at any scale. The untextured shapes sample the solid block of
+  // the field, the distance is constant over them and the alpha 1.
+  @fragment
+  fn fragmentMain(input : VertexOutput) -> @location(0) vec4<f32> {
+    let distance = textureSample(font_texture, font_sampler, input.uv).r;
+    let width = max(fwidth(distance) * 0.5, 1e-4);
+    return vec4<f32>(input.color.rgb,
+                     input.color.a
+                       * smoothstep(0.5 - width, 0.5 + width, distance));
+  }
+);
+// clang-format on
+
 // Initialize styles, keys, etc.
 static void imgui_overlay_init(imgui_overlay_t* imgui_overlay,
                                wgpu_context_t* wgpu_context)
@@ -77,8 +139,10 @@ static void imgui_overlay_init(imgui_overlay_t* imgui_overlay,
   imgui_overlay->vertex_buffer.size = 0;
   imgui_overlay->index_buffer.size  = 0;
 
-  imgui_overlay->draw_buffers.index.size        = 3000;
-  imgui_overlay->draw_buffers.vertex.size       = 3000;
+  imgui_overlay->draw_buffers.vertex_capacity   = 0;
+  imgui_overlay->draw_buffers.index_capacity    = 0;
+  imgui_overlay->draw_buffers.hash              = 0;
+  imgui_overlay->draw_buffers.uniforms_valid    = false;
   imgui_overlay->settings.enable_alpha_blending = true;
   imgui_overlay->settings.msaa_sample_count     = 1;
   imgui_overlay->settings.scale                 = 1.0f;
@@ -96,10 +160,16 @@ static void imgui_overlay_init(imgui_overlay_t* imgui_overlay,
 
   // Setup back-end capabilities flags
   ImGuiIO* io = igGetIO();
-  ImFontAtlas_AddFontDefault(io->Fonts, NULL);
+  // The font is rasterized at a multiple of its size for the distance field
+  // and scaled back with the global font scale
+  ImFontConfig* font_config = ImFontConfig_ImFontConfig();
+  font_config->SizePixels = _IMGUI_FONT_SIZE * _IMGUI_FONT_FIELD_DOWNSAMPLE;
+  ImFontAtlas_AddFontDefault(io->Fonts, font_config);
+  ImFontConfig_destroy(font_config);
   io->BackendRendererName = "imgui_overlay";
   io->Fonts->TexID        = 0;
-  io->FontGlobalScale     = imgui_overlay->settings.scale;
+  io->FontGlobalScale
+    = imgui_overlay->settings.scale / _IMGUI_FONT_FIELD_DOWNSAMPLE;
   io->BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
   io->DisplaySize.x             = (float)wgpu_context->surface.width;
   io->DisplaySize.y             = (float)wgpu_context->surface.height;
@@ -107,10 +177,11 @@ static void imgui_overlay_init(imgui_overlay_t* imgui_overlay,
   io->DisplayFramebufferScale.y = 1.0f;
 }
 
-static void imgui_overlay_setup_render_state(imgui_overlay_t* imgui_overlay)
+static void imgui_overlay_setup_render_state(imgui_overlay_t* imgui_overlay,
+                                             WGPURenderPassEncoder rpass_enc,
+                                             WGPURenderPipeline pipeline)
 {
-  WGPURenderPassEncoder rpass_enc = imgui_overlay->wgpu_context->rpass_enc;
-  wgpuRenderPassEncoderSetPipeline(rpass_enc, imgui_overlay->pipeline);
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
   wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, imgui_overlay->bind_group, 0,
                                     NULL);
   wgpuRenderPassEncoderSetVertexBuffer(
@@ -120,25 +191,101 @@ static void imgui_overlay_setup_render_state(imgui_overlay_t* imgui_overlay)
     WGPU_WHOLE_SIZE);
 }
 
+/**
+ * @brief Builds the font atlas for the distance field: the glyphs are apart by
+ * twice the distance range, so their fields do not overlap, and the untextured
+ * shapes sample a solid block instead of the white pixel, which would be an
+ * edge in the field.
+ */
+static void imgui_overlay_build_font_atlas(unsigned char** font_pixels,
+                                           int* font_width, int* font_height)
+{
+  ImFontAtlas* atlas = igGetIO()->Fonts;
+  atlas->Flags
+    |= ImFontAtlasFlags_NoMouseCursors | ImFontAtlasFlags_NoBakedLines;
+  atlas->TexGlyphPadding
+    = (int)(2.0f * _IMGUI_FONT_FIELD_SPREAD * _IMGUI_FONT_FIELD_DOWNSAMPLE);
+  // Rows of the field are a multiple of the 256 bytes copy alignment
+  atlas->TexDesiredWidth = 256 * _IMGUI_FONT_FIELD_DOWNSAMPLE;
+  const int solid_size = 4 * _IMGUI_FONT_FIELD_DOWNSAMPLE;
+  const int solid_id
+    = ImFontAtlas_AddCustomRectRegular(atlas, solid_size, solid_size);
+
+  int bytes_per_pixel;
+  ImFontAtlas_GetTexDataAsAlpha8(atlas, font_pixels, font_width, font_height,
+                                 &bytes_per_pixel);
+
+  const ImFontAtlasCustomRect* solid
+    = ImFontAtlas_GetCustomRectByIndex(atlas, solid_id);
+  for (int y = 0; y < solid_size; ++y) {
+    memset(&(*font_pixels)[(solid->Y + y) * (*font_width) + solid->X], 0xff,
+           (size_t)solid_size);
+  }
+  atlas->TexUvWhitePixel = (ImVec2){
+    .x = (solid->X + 0.5f * solid_size) / (float)(*font_width),
+    .y = (solid->Y + 0.5f * solid_size) / (float)(*font_height),
+  };
+}
+
+/**
+ * @brief Creates the distance field of the font atlas. The field is generated
+ * once and then loaded from the cache next to the pipeline cache.
+ */
+static uint8_t* imgui_overlay_create_font_field(const unsigned char* font_pixels,
+                                                int font_width, int font_height,
+                                                uint32_t* field_width,
+                                                uint32_t* field_height)
+{
+  const distance_field_desc_t field_desc = {
+    .coverage   = font_pixels,
+    .width      = (uint32_t)font_width,
+    .height     = (uint32_t)font_height,
+    .downsample = _IMGUI_FONT_FIELD_DOWNSAMPLE,
+    .spread     = _IMGUI_FONT_FIELD_SPREAD,
+  };
+  distance_field_get_size(&field_desc, field_width, field_height);
+  uint8_t* field = (uint8_t*)malloc((*field_width) * (*field_height));
+
+  const uint64_t field_key    = distance_field_hash(&field_desc);
+  const char* cache_dir       = wgpu_get_pipeline_cache_dir();
+  char cache_filename[STRMAX] = {0};
+  if (cache_dir != NULL) {
+    snprintf(cache_filename, sizeof(cache_filename), "%s/%s", cache_dir,
+             _IMGUI_FONT_FIELD_CACHE_FILENAME);
+  }
+  if (cache_dir == NULL
+      || !distance_field_cache_read(cache_filename, field_key, *field_width,
+                                    *field_height, field)) {
+    distance_field_generate(&field_desc, field);
+    if (cache_dir != NULL) {
+      distance_field_cache_write(cache_filename, field_key, *field_width,
+                                 *field_height, field);
+    }
+  }
+
+  return field;
+}
+
 static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
 {
   wgpu_context_t* wgpu_context = imgui_overlay->wgpu_context;
 
-  // Build texture atlas
+  // Build texture atlas and its distance field
   ImGuiIO* io = igGetIO();
   unsigned char* font_pixels;
   int font_width;
   int font_height;
-  int bytes_per_pixel;
-  ImFontAtlas_GetTexDataAsRGBA32(io->Fonts, &font_pixels, &font_width,
-                                 &font_height, &bytes_per_pixel);
-  const uint32_t pixels_size_bytes = font_width * font_height * bytes_per_pixel;
+  imgui_overlay_build_font_atlas(&font_pixels, &font_width, &font_height);
+  uint32_t field_width, field_height;
+  uint8_t* field = imgui_overlay_create_font_field(
+    font_pixels, font_width, font_height, &field_width, &field_height);
+  const uint32_t pixels_size_bytes = field_width * field_height;
 
   // Upload texture to graphics system
   {
     WGPUExtent3D texture_size = {
-      .width              = font_width,
-      .height             = font_height,
+      .width              = field_width,
+      .height             = field_height,
       .depthOrArrayLayers = 1,
     };
     WGPUTextureDescriptor texture_desc = {
@@ -146,7 +293,7 @@ static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
       .usage     = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
       .dimension = WGPUTextureDimension_2D,
       .size      = texture_size,
-      .format    = WGPUTextureFormat_RGBA8Unorm,
+      .format    = WGPUTextureFormat_R8Unorm,
       .mipLevelCount = 1,
       .sampleCount   = 1,
     };
@@ -158,7 +305,7 @@ static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
       wgpu_context, &(wgpu_buffer_desc_t){.usage   = WGPUBufferUsage_CopySrc,
                                           .size    = pixels_size_bytes,
                                           .initial = {
-                                            .data = font_pixels,
+                                            .data = field,
                                             .size = pixels_size_bytes,
                                           }});
 
@@ -166,8 +313,8 @@ static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
       = {.buffer = gpu_buffer.buffer,
          .layout = (WGPUTextureDataLayout){
            .offset       = 0,
-           .bytesPerRow  = font_width * bytes_per_pixel,
-           .rowsPerImage = font_height,
+           .bytesPerRow  = field_width,
+           .rowsPerImage = field_height,
          }};
 
     WGPUImageCopyTexture texture_copy_view = {
@@ -181,19 +328,17 @@ static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
       .aspect = WGPUTextureAspect_All,
     };
 
-    WGPUCommandBuffer copy_command = wgpu_copy_buffer_to_texture(
-      wgpu_context, &buffer_copy_view, &texture_copy_view, &texture_size);
-    // Submit to the queue
-    wgpuQueueSubmit(wgpu_context->queue, 1, &copy_command);
+    wgpu_copy_buffer_to_texture(wgpu_context, &buffer_copy_view,
+                                &texture_copy_view, &texture_size);
 
-    // Release command buffer and staging buffer
-    WGPU_RELEASE_RESOURCE(CommandBuffer, copy_command)
+    // Release staging buffer
     wgpu_destroy_buffer(&gpu_buffer);
+    free(field);
 
     // Create texture view
     WGPUTextureViewDescriptor texture_view_desc = {
       .label           = "imgui-texture-view",
-      .format          = WGPUTextureFormat_RGBA8Unorm,
+      .format          = WGPUTextureFormat_R8Unorm,
       .dimension       = WGPUTextureViewDimension_2D,
       .baseMipLevel    = 0,
       .mipLevelCount   = 1,
@@ -222,7 +367,7 @@ static void imgui_overlay_create_fonts_texture(imgui_overlay_t* imgui_overlay)
     };
 
     imgui_overlay->font.sampler
-      = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+      = wgpu_create_sampler(wgpu_context, &sampler_desc);
     ASSERT(imgui_overlay->font.sampler);
   }
 
@@ -251,6 +396,7 @@ static void imgui_overlay_setup_render_pass(imgui_overlay_t* imgui_overlay)
 
   // Render pass descriptor
   imgui_overlay->render_pass_desc = (WGPURenderPassDescriptor){
+    .label                  = "ImGui overlay render pass",
     .colorAttachmentCount   = 1,
     .colorAttachments       = imgui_overlay->rp_color_att_descriptors,
     .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
@@ -320,7 +466,12 @@ static void imgui_overlay_setup_pipeline_layout(imgui_overlay_t* imgui_overlay)
   }
 }
 
-static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
+// Creates a pipeline for the attachments of the render pass, UI elements are
+// drawn on top of the pass content if depth_test is disabled
+static WGPURenderPipeline
+imgui_overlay_create_pipeline(imgui_overlay_t* imgui_overlay,
+                              const imgui_overlay_pass_desc_t* pass_desc,
+                              bool depth_test)
 {
   wgpu_context_t* wgpu_context = imgui_overlay->wgpu_context;
 
@@ -335,7 +486,7 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
   WGPUBlendState blend_state
     = wgpu_create_blend_state(imgui_overlay->settings.enable_alpha_blending);
   WGPUColorTargetState color_target_state_desc = (WGPUColorTargetState){
-    .format    = wgpu_context->swap_chain.format,
+    .format    = pass_desc->color_format,
     .blend     = &blend_state,
     .writeMask = WGPUColorWriteMask_All,
   };
@@ -343,9 +494,12 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
   // Depth stencil state
   WGPUDepthStencilState depth_stencil_state_desc
     = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
-      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .format              = pass_desc->depth_stencil_format,
       .depth_write_enabled = false,
     });
+  if (!depth_test) {
+    depth_stencil_state_desc.depthCompare = WGPUCompareFunction_Always;
+  }
 
   // Vertex buffer layout
   WGPU_VERTEX_BUFFER_LAYOUT(
@@ -362,8 +516,10 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
   WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
                 wgpu_context, &(wgpu_vertex_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
-                  // Vertex shader SPIR-V
-                  .file = "shaders/imgui_overlay/imgui.vert.spv",
+                  // Vertex shader WGSL
+                  .label            = "imgui_vertex_shader",
+                  .wgsl_code.source = imgui_overlay_shader_wgsl,
+                  .entry            = "vertexMain",
                 },
                 .buffer_count = 1,
                 .buffers = &imgui_vertex_buffer_layout,
@@ -373,8 +529,10 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
   WGPUFragmentState fragment_state_desc = wgpu_create_fragment_state(
                 wgpu_context, &(wgpu_fragment_state_t){
                 .shader_desc = (wgpu_shader_desc_t){
-                  // Fragment shader SPIR-V
-                  .file = "shaders/imgui_overlay/imgui.frag.spv",
+                  // Fragment shader WGSL
+                  .label            = "imgui_fragment_shader",
+                  .wgsl_code.source = imgui_overlay_shader_wgsl,
+                  .entry            = "fragmentMain",
                 },
                 .target_count = 1,
                 .targets = &color_target_state_desc,
@@ -384,24 +542,83 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
   WGPUMultisampleState multisample_state_desc
     = wgpu_create_multisample_state_descriptor(
       &(create_multisample_state_desc_t){
-        .sample_count = imgui_overlay->settings.msaa_sample_count,
+        .sample_count = pass_desc->sample_count,
       });
 
   // Create rendering pipeline using the specified states
-  imgui_overlay->pipeline = wgpuDeviceCreateRenderPipeline(
-    wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                            .label        = "imgui_render_pipeline",
-                            .layout       = imgui_overlay->pipeline_layout,
-                            .primitive    = primitive_state_desc,
-                            .vertex       = vertex_state_desc,
-                            .fragment     = &fragment_state_desc,
-                            .depthStencil = &depth_stencil_state_desc,
-                            .multisample  = multisample_state_desc,
-                          });
+  WGPURenderPipeline pipeline = wgpu_create_render_pipeline(
+    wgpu_context,
+    &(WGPURenderPipelineDescriptor){
+      .label        = "imgui_render_pipeline",
+      .layout       = imgui_overlay->pipeline_layout,
+      .primitive    = primitive_state_desc,
+      .vertex       = vertex_state_desc,
+      .fragment     = &fragment_state_desc,
+      .depthStencil = pass_desc->depth_stencil_format
+                          != WGPUTextureFormat_Undefined ?
+                        &depth_stencil_state_desc :
+                        NULL,
+      .multisample  = multisample_state_desc,
+    });
 
   // Partial cleanup
   WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
   WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+
+  return pipeline;
+}
+
+static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
+{
+  // Pipeline of the overlay render pass
+  imgui_overlay->pipeline = imgui_overlay_create_pipeline(
+    imgui_overlay,
+    &(imgui_overlay_pass_desc_t){
+      .color_format = imgui_overlay->wgpu_context->swap_chain.format,
+      .depth_stencil_format
+      = wgpu_get_default_depth_stencil_format(imgui_overlay->wgpu_context),
+      .sample_count         = imgui_overlay->settings.msaa_sample_count,
+    },
+    true);
+}
+
+// Returns the pipeline variant for the render pass of the caller
+static WGPURenderPipeline
+imgui_overlay_get_pass_pipeline(imgui_overlay_t* imgui_overlay,
+                                const imgui_overlay_pass_desc_t* pass_desc)
+{
+  imgui_overlay_pass_desc_t desc = {
+    .depth_stencil_format
+    = wgpu_get_default_depth_stencil_format(imgui_overlay->wgpu_context),
+  };
+  if (pass_desc != NULL) {
+    desc = *pass_desc;
+  }
+  if (desc.color_format == WGPUTextureFormat_Undefined) {
+    desc.color_format = imgui_overlay->wgpu_context->swap_chain.format;
+  }
+  desc.sample_count = MAX(desc.sample_count, 1u);
+
+  for (uint32_t i = 0; i < imgui_overlay->pass_pipeline_count; ++i) {
+    const imgui_overlay_pass_desc_t* cached
+      = &imgui_overlay->pass_pipelines[i].desc;
+    if (cached->color_format == desc.color_format
+        && cached->depth_stencil_format == desc.depth_stencil_format
+        && cached->sample_count == desc.sample_count) {
+      return imgui_overlay->pass_pipelines[i].pipeline;
+    }
+  }
+  if (imgui_overlay->pass_pipeline_count >= _IMGUI_MAX_PASS_PIPELINES) {
+    log_error("ImGui overlay pass pipeline limit reached\n");
+    return NULL;
+  }
+
+  const uint32_t i = imgui_overlay->pass_pipeline_count++;
+
+  imgui_overlay->pass_pipelines[i].desc = desc;
+  imgui_overlay->pass_pipelines[i].pipeline
+    = imgui_overlay_create_pipeline(imgui_overlay, &desc, false);
+  return imgui_overlay->pass_pipelines[i].pipeline;
 }
 
 static void imgui_overlay_prepare_uniform_buffer(imgui_overlay_t* imgui_overlay)
@@ -454,6 +671,7 @@ imgui_overlay_t* imgui_overlay_create(wgpu_context_t* wgpu_context)
 {
   imgui_overlay_t* imgui_overlay
     = (imgui_overlay_t*)malloc(sizeof(imgui_overlay_t));
+  memset(imgui_overlay, 0, sizeof(imgui_overlay_t));
 
   // Prepare ImGui overlay
   imgui_overlay_init(imgui_overlay, wgpu_context);
@@ -475,6 +693,10 @@ imgui_overlay_t* imgui_overlay_create(wgpu_context_t* wgpu_context)
 void imgui_overlay_release(imgui_overlay_t* imgui_overlay)
 {
   WGPU_RELEASE_RESOURCE(RenderPipeline, imgui_overlay->pipeline);
+  for (uint32_t i = 0; i < imgui_overlay->pass_pipeline_count; ++i) {
+    WGPU_RELEASE_RESOURCE(RenderPipeline,
+                          imgui_overlay->pass_pipelines[i].pipeline);
+  }
   WGPU_RELEASE_RESOURCE(PipelineLayout, imgui_overlay->pipeline_layout);
   WGPU_RELEASE_RESOURCE(BindGroup, imgui_overlay->bind_group);
   WGPU_RELEASE_RESOURCE(BindGroupLayout, imgui_overlay->bind_group_layout);
@@ -494,6 +716,14 @@ float imgui_overlay_get_scale(imgui_overlay_t* imgui_overlay)
   return imgui_overlay->scale;
 }
 
+void imgui_overlay_set_scale(imgui_overlay_t* imgui_overlay, float scale)
+{
+  imgui_overlay->scale = scale > 0.0f ? scale : 1.0f;
+  // The distance field font is only scaled, not rasterized again
+  igGetIO()->FontGlobalScale
+    = imgui_overlay->scale / _IMGUI_FONT_FIELD_DOWNSAMPLE;
+}
+
 // Starts a new imGui frame
 void imgui_overlay_new_frame(imgui_overlay_t* imgui_overlay,
                              wgpu_example_context_t* context)
@@ -534,34 +764,28 @@ static void imgui_overlay_update_uniform_buffers(imgui_overlay_t* imgui_overlay,
     memcpy(&vertex_constant_buffer.mvp, mvp, sizeof(mvp));
   }
 
-  wgpu_record_copy_data_to_buffer(
-    imgui_overlay->wgpu_context, &imgui_overlay->uniform_buffer, 0,
-    sizeof(vertex_uniform_buffer_t), &vertex_constant_buffer.mvp,
+  // The projection only changes with the display size
+  if (imgui_overlay->draw_buffers.uniforms_valid
+      && memcmp(&imgui_overlay->draw_buffers.uniforms, &vertex_constant_buffer,
+                sizeof(vertex_uniform_buffer_t))
+           == 0) {
+    return;
+  }
+  imgui_overlay->draw_buffers.uniforms_valid = wgpu_upload_ring_write_buffer(
+    imgui_overlay->wgpu_context->upload_ring,
+    imgui_overlay->uniform_buffer.buffer, 0, &vertex_constant_buffer,
     sizeof(vertex_uniform_buffer_t));
+  imgui_overlay->draw_buffers.uniforms = vertex_constant_buffer;
 }
 
-// Draw current imGui frame into a command buffer
-void imgui_overlay_draw_frame(imgui_overlay_t* imgui_overlay,
-                              WGPUTextureView view)
+// Records the draw commands of all draw lists
+static void imgui_overlay_record_draw_lists(imgui_overlay_t* imgui_overlay,
+                                            ImDrawData* draw_data,
+                                            WGPURenderPassEncoder rpass_enc,
+                                            WGPURenderPipeline pipeline)
 {
-  ImDrawData* draw_data = igGetDrawData();
-
-  // Check if there is content to tbe rendered
-  if (!draw_data || draw_data->CmdListsCount == 0) {
-    return;
-  }
-
-  // UI scale and translate
-  imgui_overlay_update_uniform_buffers(imgui_overlay, draw_data);
-
-  // Set texture view
-  imgui_overlay->rp_color_att_descriptors[0].view = view;
-  imgui_overlay->wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-    imgui_overlay->wgpu_context->cmd_enc, &imgui_overlay->render_pass_desc);
-  WGPURenderPassEncoder rpass_enc = imgui_overlay->wgpu_context->rpass_enc;
-
   // Setup desired Dawn state
-  imgui_overlay_setup_render_state(imgui_overlay);
+  imgui_overlay_setup_render_state(imgui_overlay, rpass_enc, pipeline);
 
   // Render pass
   // (Because we merged all buffers into a single one, we maintain our own
@@ -579,7 +803,7 @@ void imgui_overlay_draw_frame(imgui_overlay_t* imgui_overlay,
         // (ImDrawCallback_ResetRenderState is a special callback value used by
         // the user to request the renderer to reset render state.)
         if (pcmd->UserCallback == ImDrawCallback_ResetRenderState) {
-          imgui_overlay_setup_render_state(imgui_overlay);
+          imgui_overlay_setup_render_state(imgui_overlay, rpass_enc, pipeline);
         }
         else {
           pcmd->UserCallback(cmd_list, pcmd);
@@ -605,9 +829,119 @@ void imgui_overlay_draw_frame(imgui_overlay_t* imgui_overlay,
     global_idx_offset += cmd_list->IdxBuffer.Size;
     global_vtx_offset += cmd_list->VtxBuffer.Size;
   }
+}
+
+// Draw current imGui frame into a command buffer
+void imgui_overlay_draw_frame(imgui_overlay_t* imgui_overlay,
+                              WGPUTextureView view)
+{
+  ImDrawData* draw_data = igGetDrawData();
+
+  // Check if there is content to tbe rendered
+  if (!draw_data || draw_data->CmdListsCount == 0) {
+    return;
+  }
+
+  // UI scale and translate
+  imgui_overlay_update_uniform_buffers(imgui_overlay, draw_data);
+
+  // Set texture view
+  imgui_overlay->rp_color_att_descriptors[0].view = view;
+  wgpu_profiler_begin_scope(imgui_overlay->wgpu_context->profiler,
+                            imgui_overlay->wgpu_context->cmd_enc, "ImGui");
+  imgui_overlay->wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    imgui_overlay->wgpu_context->cmd_enc, &imgui_overlay->render_pass_desc);
+  WGPURenderPassEncoder rpass_enc = imgui_overlay->wgpu_context->rpass_enc;
+
+  imgui_overlay_record_draw_lists(imgui_overlay, draw_data, rpass_enc,
+                                  imgui_overlay->pipeline);
 
   wgpuRenderPassEncoderEnd(rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+  wgpu_profiler_end_scope(imgui_overlay->wgpu_context->profiler,
+                          imgui_overlay->wgpu_context->cmd_enc);
+}
+
+// Draw current imGui frame into a render pass of the caller
+void imgui_overlay_draw_in_pass(imgui_overlay_t* imgui_overlay,
+                                WGPURenderPassEncoder rpass_enc,
+                                const imgui_overlay_pass_desc_t* pass_desc)
+{
+  ImDrawData* draw_data = igGetDrawData();
+
+  // Check if there is content to tbe rendered
+  if (!draw_data || draw_data->CmdListsCount == 0) {
+    return;
+  }
+
+  WGPURenderPipeline pipeline
+    = imgui_overlay_get_pass_pipeline(imgui_overlay, pass_desc);
+  if (pipeline == NULL) {
+    return;
+  }
+
+  // UI scale and translate, the buffers are copied by the upload ring before
+  // the pass is submitted
+  imgui_overlay_update_uniform_buffers(imgui_overlay, draw_data);
+
+  // The viewport and scissor rectangle of the caller are replaced
+  wgpu_context_t* wgpu_context = imgui_overlay->wgpu_context;
+  wgpuRenderPassEncoderSetViewport(rpass_enc, 0.0f, 0.0f,
+                                   (float)wgpu_context->surface.width,
+                                   (float)wgpu_context->surface.height, 0.0f,
+                                   1.0f);
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u,
+                                      wgpu_context->surface.width,
+                                      wgpu_context->surface.height);
+
+  imgui_overlay_record_draw_lists(imgui_overlay, draw_data, rpass_enc,
+                                  pipeline);
+}
+
+// FNV-1a over 64-bit words, the tail is zero padded
+static uint64_t imgui_overlay_hash(uint64_t hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ull;
+    bytes += sizeof(uint64_t);
+  }
+  if (size > 0) {
+    uint64_t word = 0;
+    memcpy(&word, bytes, size);
+    hash = (hash ^ word) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Hash of the vertex and index data of all draw lists, never 0
+static uint64_t imgui_overlay_hash_draw_data(const ImDrawData* draw_data)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int n = 0; n < draw_data->CmdListsCount; ++n) {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    const int32_t sizes[2]
+      = {cmd_list->VtxBuffer.Size, cmd_list->IdxBuffer.Size};
+    hash = imgui_overlay_hash(hash, sizes, sizeof(sizes));
+    hash = imgui_overlay_hash(hash, cmd_list->VtxBuffer.Data,
+                              cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+    hash = imgui_overlay_hash(hash, cmd_list->IdxBuffer.Data,
+                              cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+  }
+  return hash != 0 ? hash : 1;
+}
+
+// Returns the grown capacity (a multiple of 4 elements) holding count elements
+static int32_t imgui_overlay_grow_capacity(int32_t capacity, int32_t count,
+                                           int32_t initial_capacity)
+{
+  int32_t new_capacity = MAX(capacity, initial_capacity);
+  while (new_capacity < count) {
+    new_capacity *= 2;
+  }
+  return (new_capacity + 3) & ~3;
 }
 
 // Update vertex and index buffer containing the imGui elements when required
@@ -627,17 +961,13 @@ static void imgui_overlay_update_buffers(imgui_overlay_t* imgui_overlay)
 
   wgpu_context_t* wgpu_context = imgui_overlay->wgpu_context;
 
-  // Update buffers only if vertex or index count has been changed compared to
-  // current buffer size
-
-  // Create and grow index buffers if needed
-  int32_t vertex_buffer_size = imgui_overlay->draw_buffers.vertex.size;
+  // Create and grow the vertex buffer if needed, the content is uploaded again
   if (imgui_overlay->vertex_buffer.size == 0
-      || vertex_buffer_size < draw_data->TotalVtxCount) {
-    vertex_buffer_size = draw_data->TotalVtxCount + 5000;
-    vertex_buffer_size = vertex_buffer_size % 4 == 0 ?
-                           vertex_buffer_size :
-                           vertex_buffer_size + 4 - vertex_buffer_size % 4;
+      || imgui_overlay->draw_buffers.vertex_capacity
+           < draw_data->TotalVtxCount) {
+    const int32_t vertex_capacity = imgui_overlay_grow_capacity(
+      imgui_overlay->draw_buffers.vertex_capacity, draw_data->TotalVtxCount,
+      _IMGUI_VERTEX_BUFFER_CAPACITY_DEFAULT);
 
     if (imgui_overlay->vertex_buffer.size > 0) {
       wgpu_destroy_buffer(&imgui_overlay->vertex_buffer);
@@ -647,19 +977,19 @@ static void imgui_overlay_update_buffers(imgui_overlay_t* imgui_overlay)
       wgpu_context, &(wgpu_buffer_desc_t){
                       .label = "imgui-vertex-buffer",
                       .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
-                      .size  = vertex_buffer_size * sizeof(ImDrawVert),
+                      .size  = vertex_capacity * sizeof(ImDrawVert),
                     });
-    imgui_overlay->draw_buffers.vertex.size = vertex_buffer_size;
+    imgui_overlay->draw_buffers.vertex_capacity = vertex_capacity;
+    imgui_overlay->draw_buffers.hash            = 0;
   }
 
-  // Create and grow index buffers if needed
-  int32_t indexBuffer_size = imgui_overlay->draw_buffers.index.size;
+  // Create and grow the index buffer if needed
   if (imgui_overlay->index_buffer.size == 0
-      || indexBuffer_size < draw_data->TotalIdxCount) {
-    indexBuffer_size = draw_data->TotalIdxCount + 10000;
-    indexBuffer_size = indexBuffer_size % 4 == 0 ?
-                         indexBuffer_size :
-                         indexBuffer_size + 4 - indexBuffer_size % 4;
+      || imgui_overlay->draw_buffers.index_capacity
+           < draw_data->TotalIdxCount) {
+    const int32_t index_capacity = imgui_overlay_grow_capacity(
+      imgui_overlay->draw_buffers.index_capacity, draw_data->TotalIdxCount,
+      _IMGUI_INDEX_BUFFER_CAPACITY_DEFAULT);
 
     if (imgui_overlay->index_buffer.size > 0) {
       wgpu_destroy_buffer(&imgui_overlay->index_buffer);
@@ -669,41 +999,51 @@ static void imgui_overlay_update_buffers(imgui_overlay_t* imgui_overlay)
       wgpu_context, &(wgpu_buffer_desc_t){
                       .label = "imgui-index-buffer",
                       .usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
-                      .size  = indexBuffer_size * sizeof(ImDrawIdx),
+                      .size  = index_capacity * sizeof(ImDrawIdx),
                     });
-    imgui_overlay->draw_buffers.index.size = indexBuffer_size;
+    imgui_overlay->draw_buffers.index_capacity = index_capacity;
+    imgui_overlay->draw_buffers.hash           = 0;
+  }
+
+  // Skip the upload if the draw lists did not change since the last frame,
+  // which is the common case for a static overlay
+  const uint64_t hash = imgui_overlay_hash_draw_data(draw_data);
+  if (hash == imgui_overlay->draw_buffers.hash) {
+    return;
   }
 
-  // Upload vertex/index data into a single contiguous GPU buffer
-  uint32_t vtx_dst    = 0;
-  uint32_t idx_dst    = 0;
-  ImDrawVert* pVertex = imgui_overlay->draw_buffers.vertex.data;
-  ImDrawIdx* pIndex   = imgui_overlay->draw_buffers.index.data;
+  // Write the vertex/index data of all draw lists directly into the mapped
+  // staging memory of a single contiguous GPU buffer (copy sizes are a
+  // multiple of 4 bytes, the buffer capacities are rounded accordingly)
+  uint64_t vtx_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
+  uint64_t idx_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+  vtx_size          = (vtx_size + 3) & ~3ull;
+  idx_size          = (idx_size + 3) & ~3ull;
+  if (vtx_size == 0 || idx_size == 0) {
+    return;
+  }
+
+  ImDrawVert* vtx_dst = (ImDrawVert*)wgpu_upload_ring_reserve_buffer(
+    wgpu_context->upload_ring, imgui_overlay->vertex_buffer.buffer, 0,
+    vtx_size);
+  ImDrawIdx* idx_dst = (ImDrawIdx*)wgpu_upload_ring_reserve_buffer(
+    wgpu_context->upload_ring, imgui_overlay->index_buffer.buffer, 0,
+    idx_size);
+  if (vtx_dst == NULL || idx_dst == NULL) {
+    // Copies of a partially written reservation are re-uploaded next frame
+    imgui_overlay->draw_buffers.hash = 0;
+    return;
+  }
   for (int n = 0; n < draw_data->CmdListsCount; ++n) {
     const ImDrawList* cmd_list = draw_data->CmdLists[n];
-    memcpy(pVertex, cmd_list->VtxBuffer.Data,
+    memcpy(vtx_dst, cmd_list->VtxBuffer.Data,
            cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-    memcpy(pIndex, cmd_list->IdxBuffer.Data,
+    memcpy(idx_dst, cmd_list->IdxBuffer.Data,
            cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-
-    pVertex += cmd_list->VtxBuffer.Size;
-    pIndex += cmd_list->IdxBuffer.Size;
-    vtx_dst += cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
-    idx_dst += cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
-  }
-  vtx_dst = vtx_dst % 4 == 0 ? vtx_dst : vtx_dst + 4 - vtx_dst % 4;
-  idx_dst = idx_dst % 4 == 0 ? idx_dst : idx_dst + 4 - idx_dst % 4;
-
-  if (vtx_dst != 0 && idx_dst != 0) {
-    wgpu_record_copy_data_to_buffer(
-      wgpu_context, &imgui_overlay->vertex_buffer, 0, vtx_dst,
-      imgui_overlay->draw_buffers.vertex.data,
-      (pVertex - imgui_overlay->draw_buffers.vertex.data) * sizeof(ImDrawVert));
-    wgpu_record_copy_data_to_buffer(
-      wgpu_context, &imgui_overlay->index_buffer, 0, idx_dst,
-      imgui_overlay->draw_buffers.index.data,
-      (pIndex - imgui_overlay->draw_buffers.index.data) * sizeof(ImDrawIdx));
+    vtx_dst += cmd_list->VtxBuffer.Size;
+    idx_dst += cmd_list->IdxBuffer.Size;
   }
+  imgui_overlay->draw_buffers.hash = hash;
 }
 
 // Render function
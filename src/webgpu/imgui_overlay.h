@@ -10,12 +10,22 @@
 struct ImDrawData;
 typedef struct imgui_overlay imgui_overlay_t;
 
+/* Attachments of a render pass the overlay is recorded into */
+typedef struct imgui_overlay_pass_desc_t {
+  WGPUTextureFormat color_format;         /* Undefined = swap chain format */
+  WGPUTextureFormat depth_stencil_format; /* Undefined = no depth attachment */
+  uint32_t sample_count;                  /* 0 = 1 */
+} imgui_overlay_pass_desc_t;
+
 /* imgui overlay creating/releasing */
 imgui_overlay_t* imgui_overlay_create(wgpu_context_t* wgpu_context);
 void imgui_overlay_release(imgui_overlay_t* imgui_overlay);
 
 /* Property getters / setters */
 float imgui_overlay_get_scale(imgui_overlay_t* imgui_overlay);
+/* Font scale, e.g. of the display content scale. The font is drawn from a
+ * distance field, it stays sharp at any scale without a new font atlas. */
+void imgui_overlay_set_scale(imgui_overlay_t* imgui_overlay, float scale);
 
 /* imgui overlay rendering */
 void imgui_overlay_new_frame(imgui_overlay_t* imgui_overlay,
@@ -23,6 +33,17 @@ void imgui_overlay_new_frame(imgui_overlay_t* imgui_overlay,
 void imgui_overlay_render(imgui_overlay_t* imgui_overlay);
 void imgui_overlay_draw_frame(imgui_overlay_t* imgui_overlay,
                               WGPUTextureView view);
+/**
+ * @brief Records the imGui frame into a render pass of the caller, e.g. the
+ * final pass of the frame, which saves the load / store of the frame buffer in
+ * an extra overlay pass. The UI is drawn on top of the pass content, the
+ * viewport and scissor rectangle of the pass are reset.
+ * @param pass_desc the attachments of the pass, NULL = swap chain format and
+ * the depth stencil attachment of the context
+ */
+void imgui_overlay_draw_in_pass(imgui_overlay_t* imgui_overlay,
+                                WGPURenderPassEncoder rpass_enc,
+                                const imgui_overlay_pass_desc_t* pass_desc);
 bool imgui_overlay_want_capture_mouse();
 
 bool imgui_overlay_header(const char* caption);
@@ -0,0 +1,250 @@
+#include "indirect_dispatch.h"
+
+#include <stdlib.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Uniform buffer offset alignment of the parameter slots */
+#define INDIRECT_DISPATCH_PARAM_SLOT_SIZE 256u
+
+/* Parameters of a call, matches Params in WGSL */
+typedef struct indirect_dispatch_params_t {
+  uint32_t count_index;
+  uint32_t args_index;
+  uint32_t workgroup_size;
+  uint32_t max_count;
+} indirect_dispatch_params_t;
+
+/* The count is read from its own binding or, when both share a buffer, from
+ * the arguments binding, writable bindings of a dispatch must not alias */
+// clang-format off
+static const char* indirect_dispatch_wgsl = CODE(
+  struct Params {
+    countIndex    : u32,
+    argsIndex     : u32,
+    workgroupSize : u32,
+    maxCount      : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var<storage, read> counts : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> args : array<u32>;
+
+  const kMaxGroupsX = 65535u;
+
+  fn writeArgs(elementCount : u32) {
+    var count = elementCount;
+    if (params.maxCount > 0u) {
+      count = min(count, params.maxCount);
+    }
+    let groups = count / params.workgroupSize
+                 + select(0u, 1u, count % params.workgroupSize != 0u);
+    let groupsX = min(groups, kMaxGroupsX);
+    args[params.argsIndex]      = groupsX;
+    args[params.argsIndex + 1u] = max((groups + kMaxGroupsX - 1u) / kMaxGroupsX,
+                                      1u);
+    args[params.argsIndex + 2u] = 1u;
+  }
+
+  @compute @workgroup_size(1)
+  fn main() {
+    writeArgs(counts[params.countIndex]);
+  }
+
+  @compute @workgroup_size(1)
+  fn main_shared() {
+    writeArgs(args[params.countIndex]);
+  }
+);
+// clang-format on
+
+typedef struct indirect_dispatch_kernel_t {
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+} indirect_dispatch_kernel_t;
+
+/**
+ * @brief Indirect dispatch class
+ */
+struct wgpu_indirect_dispatch {
+  wgpu_context_t* wgpu_context;
+  WGPUBuffer params_buffer;
+  uint32_t param_slot;
+  indirect_dispatch_kernel_t separate; /* count and arguments in two buffers */
+  indirect_dispatch_kernel_t shared;   /* count and arguments in one buffer */
+};
+
+static void indirect_dispatch_create_kernel(wgpu_context_t* wgpu_context,
+                                            indirect_dispatch_kernel_t* kernel,
+                                            const char* entry, bool shared)
+{
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 0: Parameters */
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_Uniform,
+        .hasDynamicOffset = true,
+        .minBindingSize   = sizeof(indirect_dispatch_params_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 2: Arguments */
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_Storage,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      /* Binding 1: Counts */
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_ReadOnlyStorage,
+      },
+    },
+  };
+  kernel->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "Indirect dispatch bind group layout",
+                            .entryCount = shared ? 2 : 3,
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(kernel->bind_group_layout != NULL);
+
+  kernel->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .label = "Indirect dispatch pipeline layout",
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &kernel->bind_group_layout,
+                          });
+  ASSERT(kernel->pipeline_layout != NULL);
+
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .label            = "Indirect dispatch compute shader",
+                    .wgsl_code.source = indirect_dispatch_wgsl,
+                    .entry            = entry,
+                  });
+  kernel->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Indirect dispatch pipeline",
+                    .layout  = kernel->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(kernel->pipeline != NULL);
+  wgpu_shader_release(&shader);
+}
+
+static void indirect_dispatch_release_kernel(indirect_dispatch_kernel_t* kernel)
+{
+  WGPU_RELEASE_RESOURCE(ComputePipeline, kernel->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, kernel->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, kernel->bind_group_layout)
+}
+
+/* Indirect dispatch creating / destroying */
+
+wgpu_indirect_dispatch_t*
+wgpu_indirect_dispatch_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_indirect_dispatch_t* dispatch
+    = (wgpu_indirect_dispatch_t*)calloc(1, sizeof(*dispatch));
+  dispatch->wgpu_context = wgpu_context;
+
+  dispatch->params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Indirect dispatch parameters",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = WGPU_INDIRECT_DISPATCH_PARAM_SLOTS
+              * INDIRECT_DISPATCH_PARAM_SLOT_SIZE,
+    });
+  ASSERT(dispatch->params_buffer != NULL);
+
+  indirect_dispatch_create_kernel(wgpu_context, &dispatch->separate, "main",
+                                  false);
+  indirect_dispatch_create_kernel(wgpu_context, &dispatch->shared,
+                                  "main_shared", true);
+
+  return dispatch;
+}
+
+void wgpu_indirect_dispatch_destroy(wgpu_indirect_dispatch_t* dispatch)
+{
+  if (dispatch == NULL) {
+    return;
+  }
+
+  indirect_dispatch_release_kernel(&dispatch->separate);
+  indirect_dispatch_release_kernel(&dispatch->shared);
+  WGPU_RELEASE_RESOURCE(Buffer, dispatch->params_buffer)
+  free(dispatch);
+}
+
+void wgpu_indirect_dispatch_write_args(
+  wgpu_indirect_dispatch_t* dispatch, WGPUComputePassEncoder cpass_enc,
+  const wgpu_indirect_dispatch_args_desc_t* desc)
+{
+  ASSERT(desc->count_buffer != NULL && desc->args_buffer != NULL);
+  ASSERT(desc->workgroup_size > 0);
+  ASSERT(desc->count_offset % 4 == 0 && desc->args_offset % 4 == 0);
+  wgpu_context_t* wgpu_context = dispatch->wgpu_context;
+
+  /* Parameters of the call */
+  const uint32_t param_offset
+    = dispatch->param_slot * INDIRECT_DISPATCH_PARAM_SLOT_SIZE;
+  dispatch->param_slot
+    = (dispatch->param_slot + 1) % WGPU_INDIRECT_DISPATCH_PARAM_SLOTS;
+  const indirect_dispatch_params_t params = {
+    .count_index    = (uint32_t)(desc->count_offset / sizeof(uint32_t)),
+    .args_index     = (uint32_t)(desc->args_offset / sizeof(uint32_t)),
+    .workgroup_size = desc->workgroup_size,
+    .max_count      = desc->max_count,
+  };
+  wgpuQueueWriteBuffer(wgpu_context->queue, dispatch->params_buffer,
+                       param_offset, &params, sizeof(params));
+
+  const bool shared = desc->count_buffer == desc->args_buffer;
+  const indirect_dispatch_kernel_t* kernel
+    = shared ? &dispatch->shared : &dispatch->separate;
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = dispatch->params_buffer,
+      .size    = sizeof(indirect_dispatch_params_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = desc->args_buffer,
+      .size    = WGPU_WHOLE_SIZE,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = desc->count_buffer,
+      .size    = WGPU_WHOLE_SIZE,
+    },
+  };
+  /* The same buffers are bound every frame, the cache saves the creation */
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .label      = "Indirect dispatch bind group",
+                    .layout     = kernel->bind_group_layout,
+                    .entryCount = shared ? 2 : 3,
+                    .entries    = bg_entries,
+                  });
+  ASSERT(bind_group != NULL);
+
+  wgpuComputePassEncoderSetPipeline(cpass_enc, kernel->pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 1,
+                                     &param_offset);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
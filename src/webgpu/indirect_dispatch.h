@@ -0,0 +1,65 @@
+#ifndef INDIRECT_DISPATCH_H
+#define INDIRECT_DISPATCH_H
+
+#include "context.h"
+
+/* Parameter sets available per submit, see below */
+#define WGPU_INDIRECT_DISPATCH_PARAM_SLOTS 64u
+/* Size of the DispatchWorkgroupsIndirect arguments (x, y, z) */
+#define WGPU_INDIRECT_DISPATCH_ARGS_SIZE (3u * sizeof(uint32_t))
+/* Workgroups per dispatch row, larger dispatches use several rows */
+#define WGPU_INDIRECT_DISPATCH_MAX_GROUPS_X 65535u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU indirect dispatch
+ *
+ * Turns an element count produced on the GPU, e.g. the live particles, the
+ * active marching cubes cells or the instances left after culling, into the
+ * arguments of a DispatchWorkgroupsIndirect without a readback. A single
+ * invocation reads the u32 count, clamps it and writes the workgroup counts
+ * of a kernel with the given elements per workgroup:
+ *
+ *   wgpu_indirect_dispatch_write_args(indirect_dispatch, cpass_enc, &desc);
+ *   wgpuComputePassEncoderSetPipeline(cpass_enc, pipeline);
+ *   ...
+ *   wgpuComputePassEncoderDispatchWorkgroupsIndirect(cpass_enc, args,
+ *                                                    args_offset);
+ *
+ * Counts beyond WGPU_INDIRECT_DISPATCH_MAX_GROUPS_X workgroups are dispatched
+ * in several rows, the kernel derives the element from
+ * gid.x + gid.y * num_workgroups.x * workgroup_size and skips the elements at
+ * and past the count. A count of 0 dispatches no workgroups.
+ *
+ * The count and the arguments can share a buffer. The parameters of the
+ * calls are written into slots with queue writes when they are recorded, the
+ * slots are reused after WGPU_INDIRECT_DISPATCH_PARAM_SLOTS calls, the calls
+ * recorded before a submit must not use more slots than that.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_indirect_dispatch wgpu_indirect_dispatch_t;
+
+typedef struct wgpu_indirect_dispatch_args_desc_t {
+  /* Buffer with the u32 element count, Storage usage */
+  WGPUBuffer count_buffer;
+  uint64_t count_offset; /* multiple of 4 */
+  /* Buffer with the arguments, Storage and Indirect usage */
+  WGPUBuffer args_buffer;
+  uint64_t args_offset; /* multiple of 4 */
+  /* Elements processed per workgroup */
+  uint32_t workgroup_size;
+  /* Elements at most, e.g. the capacity of the data, 0 = unlimited */
+  uint32_t max_count;
+} wgpu_indirect_dispatch_args_desc_t;
+
+/* Indirect dispatch creating / destroying */
+wgpu_indirect_dispatch_t*
+wgpu_indirect_dispatch_create(wgpu_context_t* wgpu_context);
+void wgpu_indirect_dispatch_destroy(wgpu_indirect_dispatch_t* dispatch);
+
+/* Records the writing of the arguments into the compute pass, the dispatches
+ * recorded after it in the pass read them */
+void wgpu_indirect_dispatch_write_args(
+  wgpu_indirect_dispatch_t* dispatch, WGPUComputePassEncoder cpass_enc,
+  const wgpu_indirect_dispatch_args_desc_t* desc);
+
+#endif /* INDIRECT_DISPATCH_H */
@@ -0,0 +1,421 @@
+#include "mipmap_tuner.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/platform.h"
+
+#define MIPMAP_TUNER_FILENAME "mipmap_methods.txt"
+#define MIPMAP_TUNER_INITIAL_CAPACITY 8u
+/* Measured passes per method, the first pass is a warm-up */
+#define MIPMAP_TUNER_PASS_COUNT 4u
+
+/* Adapter the results were measured on */
+typedef struct mipmap_tuner_adapter_t {
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint32_t backend_type;
+} mipmap_tuner_adapter_t;
+
+typedef struct mipmap_tuner_entry_t {
+  mipmap_tuner_adapter_t adapter;
+  uint32_t format;
+  uint32_t method;
+} mipmap_tuner_entry_t;
+
+struct wgpu_mipmap_tuner {
+  mipmap_tuner_adapter_t adapter; /* adapter of the context */
+  char filename[STRMAX];          /* empty if the results are not stored */
+  mipmap_tuner_entry_t* entries;  /* results of all adapters in the file */
+  uint32_t count;
+  uint32_t capacity;
+};
+
+/* -------------------------------------------------------------------------- *
+ * Results cache
+ * -------------------------------------------------------------------------- */
+
+static void mipmap_tuner_insert(wgpu_mipmap_tuner_t* tuner,
+                                const mipmap_tuner_entry_t* entry)
+{
+  if (tuner->count == tuner->capacity) {
+    tuner->capacity = tuner->capacity ? tuner->capacity * 2 :
+                                        MIPMAP_TUNER_INITIAL_CAPACITY;
+    tuner->entries  = (mipmap_tuner_entry_t*)realloc(
+      tuner->entries, tuner->capacity * sizeof(mipmap_tuner_entry_t));
+  }
+  tuner->entries[tuner->count++] = *entry;
+}
+
+static void mipmap_tuner_load(wgpu_mipmap_tuner_t* tuner)
+{
+  FILE* file = fopen(tuner->filename, "r");
+  if (file == NULL) {
+    return;
+  }
+  // One result per line: vendor ID, device ID, backend, format, method
+  mipmap_tuner_entry_t entry = {0};
+  while (fscanf(file, "%x %x %u %u %u", &entry.adapter.vendor_id,
+                &entry.adapter.device_id, &entry.adapter.backend_type,
+                &entry.format, &entry.method)
+         == 5) {
+    if (entry.method < (uint32_t)WGPU_MipmapMethod_Count) {
+      mipmap_tuner_insert(tuner, &entry);
+    }
+  }
+  fclose(file);
+}
+
+static void mipmap_tuner_store(wgpu_mipmap_tuner_t* tuner,
+                               const mipmap_tuner_entry_t* entry)
+{
+  if (tuner->filename[0] == '\0') {
+    return;
+  }
+  FILE* file = fopen(tuner->filename, "a");
+  if (file == NULL) {
+    log_warn("Unable to store the mip map method in %s", tuner->filename);
+    return;
+  }
+  fprintf(file, "%08x %08x %u %u %u\n", entry->adapter.vendor_id,
+          entry->adapter.device_id, entry->adapter.backend_type, entry->format,
+          entry->method);
+  fclose(file);
+}
+
+static wgpu_mipmap_tuner_t* mipmap_tuner_get(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->mipmap_tuner != NULL) {
+    return wgpu_context->mipmap_tuner;
+  }
+
+  wgpu_mipmap_tuner_t* tuner
+    = (wgpu_mipmap_tuner_t*)calloc(1, sizeof(wgpu_mipmap_tuner_t));
+  WGPUAdapterProperties properties = {0};
+  wgpuAdapterGetProperties(wgpu_context->adapter, &properties);
+  tuner->adapter = (mipmap_tuner_adapter_t){
+    .vendor_id    = properties.vendorID,
+    .device_id    = properties.deviceID,
+    .backend_type = (uint32_t)properties.backendType,
+  };
+  // Results are stored next to the backend pipeline cache
+  const char* directory = wgpu_get_pipeline_cache_dir();
+  if (directory != NULL) {
+    snprintf(tuner->filename, sizeof(tuner->filename), "%s/%s", directory,
+             MIPMAP_TUNER_FILENAME);
+    mipmap_tuner_load(tuner);
+  }
+
+  wgpu_context->mipmap_tuner = tuner;
+  return tuner;
+}
+
+static const mipmap_tuner_entry_t*
+mipmap_tuner_find(const wgpu_mipmap_tuner_t* tuner, WGPUTextureFormat format)
+{
+  // The last result of a format wins
+  for (uint32_t i = tuner->count; i > 0; --i) {
+    const mipmap_tuner_entry_t* entry = &tuner->entries[i - 1];
+    if (memcmp(&entry->adapter, &tuner->adapter, sizeof(tuner->adapter)) == 0
+        && entry->format == (uint32_t)format) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void wgpu_mipmap_tuner_release(wgpu_mipmap_tuner_t* mipmap_tuner)
+{
+  if (mipmap_tuner == NULL) {
+    return;
+  }
+  free(mipmap_tuner->entries);
+  free(mipmap_tuner);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Measurement
+ * -------------------------------------------------------------------------- */
+
+typedef struct mipmap_tuner_readback_t {
+  bool done;
+  WGPUBufferMapAsyncStatus status;
+} mipmap_tuner_readback_t;
+
+static void mipmap_tuner_map_callback(WGPUBufferMapAsyncStatus status,
+                                      void* user_data)
+{
+  mipmap_tuner_readback_t* readback = (mipmap_tuner_readback_t*)user_data;
+  readback->status                  = status;
+  readback->done                    = true;
+}
+
+/* Texel size of the formats the mip map generator supports, 0 otherwise */
+static uint32_t mipmap_tuner_bytes_per_texel(WGPUTextureFormat format)
+{
+  switch (format) {
+    case WGPUTextureFormat_RGBA8Unorm:
+    case WGPUTextureFormat_RGBA8UnormSrgb:
+    case WGPUTextureFormat_RGBA8Snorm:
+    case WGPUTextureFormat_BGRA8Unorm:
+    case WGPUTextureFormat_BGRA8UnormSrgb:
+    case WGPUTextureFormat_R32Float:
+      return 4;
+    case WGPUTextureFormat_RGBA16Float:
+    case WGPUTextureFormat_RG32Float:
+      return 8;
+    case WGPUTextureFormat_RGBA32Float:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+/* Noise of finite values, the filters run at the speed of real images */
+static void mipmap_tuner_fill_pixels(uint8_t* pixels, uint64_t size,
+                                     WGPUTextureFormat format)
+{
+  uint32_t state = 0x9e3779b9u;
+  for (uint64_t i = 0; i + 4 <= size; i += 4) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    uint32_t value = state;
+    if (format == WGPUTextureFormat_RGBA16Float) {
+      // Two halfs in [0.5, 1)
+      value = 0x38003800u | (state & 0x03ff03ffu);
+    }
+    else if (format == WGPUTextureFormat_RGBA32Float
+             || format == WGPUTextureFormat_R32Float
+             || format == WGPUTextureFormat_RG32Float) {
+      // Float in [1, 2)
+      value = 0x3f800000u | (state & 0x007fffffu);
+    }
+    memcpy(pixels + i, &value, sizeof(value));
+  }
+}
+
+bool wgpu_mipmap_tuner_measure(wgpu_context_t* wgpu_context,
+                               wgpu_mipmap_generator_t* mipmap_generator,
+                               WGPUTextureFormat format, uint32_t size,
+                               wgpu_mipmap_method_enum_t method,
+                               wgpu_mipmap_timing_t* timing)
+{
+  ASSERT(size > 0 && timing != NULL);
+
+  const uint32_t bytes_per_texel = mipmap_tuner_bytes_per_texel(format);
+  WGPUTextureDescriptor texture_desc = {
+    .label         = "Mipmap tuner texture",
+    .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+    .dimension     = WGPUTextureDimension_2D,
+    .size          = (WGPUExtent3D){
+      .width              = size,
+      .height             = size,
+      .depthOrArrayLayers = 1,
+    },
+    .format        = format,
+    .mipLevelCount = (uint32_t)floor(log2((double)size)) + 1,
+    .sampleCount   = 1,
+  };
+  if (method == WGPU_MipmapMethod_Auto || bytes_per_texel == 0
+      || !wgpu_mipmap_method_supports(method, &texture_desc)
+      || !wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery)) {
+    return false;
+  }
+  if (method == WGPU_MipmapMethod_Compute) {
+    texture_desc.usage |= WGPUTextureUsage_StorageBinding;
+  }
+  WGPUTexture texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  ASSERT(texture != NULL);
+
+  // Level 0 in CPU memory, and in a staging buffer for the GPU methods
+  const uint32_t bytes_per_row = size * bytes_per_texel;
+  const uint32_t staging_bytes_per_row = (bytes_per_row + 255) & ~255u;
+  const uint64_t pixels_size           = (uint64_t)bytes_per_row * size;
+  uint8_t* pixels                      = (uint8_t*)malloc(pixels_size);
+  ASSERT(pixels != NULL);
+  mipmap_tuner_fill_pixels(pixels, pixels_size, format);
+  WGPUBuffer staging_buffer = NULL;
+  if (method != WGPU_MipmapMethod_CPU) {
+    staging_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label            = "Mipmap tuner staging buffer",
+        .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
+        .size             = (uint64_t)staging_bytes_per_row * size,
+        .mappedAtCreation = true,
+      });
+    ASSERT(staging_buffer != NULL);
+    uint8_t* staging_data = (uint8_t*)wgpuBufferGetMappedRange(
+      staging_buffer, 0, (uint64_t)staging_bytes_per_row * size);
+    for (uint32_t y = 0; y < size; ++y) {
+      memcpy(staging_data + (uint64_t)y * staging_bytes_per_row,
+             pixels + (uint64_t)y * bytes_per_row, bytes_per_row);
+    }
+    wgpuBufferUnmap(staging_buffer);
+  }
+
+  const uint32_t query_count  = MIPMAP_TUNER_PASS_COUNT * 2;
+  const uint64_t buffer_size  = query_count * sizeof(uint64_t);
+  WGPUQuerySet query_set      = wgpuDeviceCreateQuerySet(
+    wgpu_context->device, &(WGPUQuerySetDescriptor){
+                                 .label = "Mipmap tuner timestamp query set",
+                                 .type  = WGPUQueryType_Timestamp,
+                                 .count = query_count,
+                               });
+  WGPUBuffer resolve_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Mipmap tuner resolve buffer",
+      .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+      .size  = buffer_size,
+    });
+  WGPUBuffer readback_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Mipmap tuner readback buffer",
+      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+      .size  = buffer_size,
+    });
+  ASSERT(query_set && resolve_buffer && readback_buffer);
+
+  // Every pass regenerates the whole chain from the level 0 pixels
+  double cpu_time_ms = DBL_MAX;
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t pass = 0; pass < MIPMAP_TUNER_PASS_COUNT; ++pass) {
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, query_set, pass * 2);
+    if (method == WGPU_MipmapMethod_CPU) {
+      const uint64_t begin_ns = platform_get_time_ns();
+      wgpu_mipmap_generator_encode_cpu_mipmap(wgpu_context, cmd_enc, texture,
+                                              &texture_desc, pixels);
+      if (pass > 0) {
+        cpu_time_ms
+          = MIN(cpu_time_ms, (platform_get_time_ns() - begin_ns) / 1.0e6);
+      }
+    }
+    else {
+      wgpuCommandEncoderCopyBufferToTexture(cmd_enc,
+        // Source
+        &(WGPUImageCopyBuffer) {
+          .buffer = staging_buffer,
+          .layout = (WGPUTextureDataLayout) {
+            .offset       = 0,
+            .bytesPerRow  = staging_bytes_per_row,
+            .rowsPerImage = size,
+          },
+        },
+        // Destination
+        &(WGPUImageCopyTexture){
+          .texture  = texture,
+          .mipLevel = 0,
+          .origin   = (WGPUOrigin3D){0},
+          .aspect   = WGPUTextureAspect_All,
+        },
+        // Copy size
+        &texture_desc.size);
+      wgpu_mipmap_generator_encode_mipmap(mipmap_generator, cmd_enc, texture,
+                                          &texture_desc, method);
+    }
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, query_set, pass * 2 + 1);
+  }
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, query_set, 0, query_count,
+                                    resolve_buffer, 0);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, resolve_buffer, 0,
+                                       readback_buffer, 0, buffer_size);
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+
+  mipmap_tuner_readback_t readback = {0};
+  wgpuBufferMapAsync(readback_buffer, WGPUMapMode_Read, 0, buffer_size,
+                     mipmap_tuner_map_callback, &readback);
+  while (!readback.done) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+  double gpu_time_ms = DBL_MAX;
+  if (readback.status == WGPUBufferMapAsyncStatus_Success) {
+    const uint64_t* timestamps = (const uint64_t*)wgpuBufferGetConstMappedRange(
+      readback_buffer, 0, buffer_size);
+    for (uint32_t pass = 1; pass < MIPMAP_TUNER_PASS_COUNT; ++pass) {
+      const uint64_t begin = timestamps[pass * 2];
+      const uint64_t end   = timestamps[pass * 2 + 1];
+      // Timestamps are in nanoseconds
+      if (end > begin) {
+        gpu_time_ms = MIN(gpu_time_ms, (end - begin) / 1.0e6);
+      }
+    }
+    wgpuBufferUnmap(readback_buffer);
+  }
+
+  WGPU_RELEASE_RESOURCE(Buffer, readback_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, resolve_buffer)
+  WGPU_RELEASE_RESOURCE(QuerySet, query_set)
+  WGPU_RELEASE_RESOURCE(Buffer, staging_buffer)
+  WGPU_RELEASE_RESOURCE(Texture, texture)
+  free(pixels);
+
+  if (gpu_time_ms == DBL_MAX) {
+    return false;
+  }
+  *timing = (wgpu_mipmap_timing_t){
+    .cpu_time_ms = cpu_time_ms < DBL_MAX ? cpu_time_ms : 0.0,
+    .gpu_time_ms = gpu_time_ms,
+  };
+  return true;
+}
+
+wgpu_mipmap_method_enum_t
+wgpu_tune_mipmap_method(wgpu_context_t* wgpu_context,
+                        wgpu_mipmap_generator_t* mipmap_generator,
+                        WGPUTextureFormat format)
+{
+  wgpu_mipmap_tuner_t* tuner = mipmap_tuner_get(wgpu_context);
+  const mipmap_tuner_entry_t* cached = mipmap_tuner_find(tuner, format);
+  if (cached != NULL) {
+    return (wgpu_mipmap_method_enum_t)cached->method;
+  }
+
+  mipmap_tuner_entry_t entry = {
+    .adapter = tuner->adapter,
+    .format  = (uint32_t)format,
+    .method  = (uint32_t)WGPU_MipmapMethod_Auto,
+  };
+  double best_time_ms = DBL_MAX;
+  for (uint32_t method = WGPU_MipmapMethod_Render;
+       method < (uint32_t)WGPU_MipmapMethod_Count; ++method) {
+    wgpu_mipmap_timing_t timing = {0};
+    if (!wgpu_mipmap_tuner_measure(wgpu_context, mipmap_generator, format,
+                                   WGPU_MIPMAP_TUNER_TEXTURE_SIZE,
+                                   (wgpu_mipmap_method_enum_t)method,
+                                   &timing)) {
+      continue;
+    }
+    const double time_ms = timing.cpu_time_ms + timing.gpu_time_ms;
+    log_debug("Mip map method %s of format %u: %.3f ms",
+              wgpu_mipmap_method_get_name((wgpu_mipmap_method_enum_t)method),
+              (uint32_t)format, time_ms);
+    if (time_ms < best_time_ms) {
+      best_time_ms = time_ms;
+      entry.method = method;
+    }
+  }
+
+  // Without measurements the default is kept for the lifetime of the context
+  mipmap_tuner_insert(tuner, &entry);
+  if (entry.method != (uint32_t)WGPU_MipmapMethod_Auto) {
+    mipmap_tuner_store(tuner, &entry);
+    log_info("Tuned mip map method of format %u: %s", (uint32_t)format,
+             wgpu_mipmap_method_get_name(
+               (wgpu_mipmap_method_enum_t)entry.method));
+  }
+
+  return (wgpu_mipmap_method_enum_t)entry.method;
+}
@@ -0,0 +1,55 @@
+#ifndef MIPMAP_TUNER_H
+#define MIPMAP_TUNER_H
+
+#include "context.h"
+#include "texture.h"
+
+/* -------------------------------------------------------------------------- *
+ * Mip map generation tuner
+ *
+ * Measures the generation of a complete mip chain from level 0 pixels in CPU
+ * memory with the render, compute and CPU methods of the mip map generator
+ * using timestamp queries, and picks the fastest method per texture format.
+ * The GPU methods are timed from the copy of level 0 to the last generated
+ * level, the CPU method adds the CPU time of the box filter and the staging
+ * copy to the GPU time of the upload of all levels.
+ *
+ * Results are cached per adapter (vendor ID, device ID and backend) and
+ * format like the workgroup sizes (see workgroup_tuner.h): in memory for the
+ * lifetime of the context and in the pipeline cache directory across runs.
+ * Tuning blocks until the measurements are read back, the texture client
+ * tunes a format on the first texture of the format it generates mip maps for.
+ * -------------------------------------------------------------------------- */
+
+/* Size of the square texture the methods are compared with */
+#define WGPU_MIPMAP_TUNER_TEXTURE_SIZE 1024u
+
+typedef struct wgpu_mipmap_timing_t {
+  double cpu_time_ms; /* mip chain generation and staging, CPU method only */
+  double gpu_time_ms; /* uploads and generation on the GPU */
+} wgpu_mipmap_timing_t;
+
+/**
+ * @brief Measures the generation of the mip chain of a size x size texture of
+ * the format with the method, the fastest of several passes.
+ * @return false if the method does not support the format or timestamp
+ * queries are not supported
+ */
+bool wgpu_mipmap_tuner_measure(wgpu_context_t* wgpu_context,
+                               wgpu_mipmap_generator_t* mipmap_generator,
+                               WGPUTextureFormat format, uint32_t size,
+                               wgpu_mipmap_method_enum_t method,
+                               wgpu_mipmap_timing_t* timing);
+
+/* Returns the fastest method for textures of the format on the current
+ * adapter, WGPU_MipmapMethod_Auto without timestamp query support */
+wgpu_mipmap_method_enum_t
+wgpu_tune_mipmap_method(wgpu_context_t* wgpu_context,
+                        wgpu_mipmap_generator_t* mipmap_generator,
+                        WGPUTextureFormat format);
+
+/* Tuning results releasing */
+typedef struct wgpu_mipmap_tuner wgpu_mipmap_tuner_t;
+void wgpu_mipmap_tuner_release(wgpu_mipmap_tuner_t* mipmap_tuner);
+
+#endif
@@ -0,0 +1,249 @@
+#include "msaa.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+/* WebGPU guarantees 4 samples for the multisample capable formats, Dawn
+ * rejects 2 and 8 samples */
+static const uint32_t supported_sample_counts[] = {1u, 4u};
+
+/**
+ * @brief MSAA target class
+ */
+struct wgpu_msaa_target {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  WGPUTextureFormat color_format;
+  WGPUTextureFormat depth_stencil_format;
+  uint32_t sample_count;
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+  } color, depth_stencil;
+  /* Creation parameters of the attachments */
+  uint32_t width;
+  uint32_t height;
+  uint32_t created_sample_count;
+};
+
+/* Sample count validation */
+
+/* The formats with 32-bit integer or multi-channel 32-bit float texels cannot
+ * be multisampled */
+static bool is_multisample_capable(WGPUTextureFormat format)
+{
+  switch (format) {
+    case WGPUTextureFormat_R32Uint:
+    case WGPUTextureFormat_R32Sint:
+    case WGPUTextureFormat_RG32Float:
+    case WGPUTextureFormat_RG32Uint:
+    case WGPUTextureFormat_RG32Sint:
+    case WGPUTextureFormat_RGBA32Float:
+    case WGPUTextureFormat_RGBA32Uint:
+    case WGPUTextureFormat_RGBA32Sint:
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool wgpu_msaa_is_sample_count_supported(WGPUTextureFormat format,
+                                         uint32_t sample_count)
+{
+  if (sample_count > 1 && !is_multisample_capable(format)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(supported_sample_counts);
+       ++i) {
+    if (supported_sample_counts[i] == sample_count) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t wgpu_msaa_get_supported_sample_count(WGPUTextureFormat format,
+                                              uint32_t sample_count)
+{
+  uint32_t supported = 1;
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(supported_sample_counts);
+       ++i) {
+    const uint32_t count = supported_sample_counts[i];
+    if (count <= sample_count
+        && wgpu_msaa_is_sample_count_supported(format, count)) {
+      supported = MAX(supported, count);
+    }
+  }
+  return supported;
+}
+
+/* MSAA target creating / destroying */
+
+wgpu_msaa_target_t*
+wgpu_msaa_target_create(wgpu_context_t* wgpu_context,
+                        const wgpu_msaa_target_desc_t* desc)
+{
+  wgpu_msaa_target_t* msaa_target
+    = (wgpu_msaa_target_t*)malloc(sizeof(*msaa_target));
+  memset(msaa_target, 0, sizeof(*msaa_target));
+  msaa_target->wgpu_context = wgpu_context;
+  msaa_target->label        = desc->label;
+  msaa_target->color_format
+    = (desc->color_format != WGPUTextureFormat_Undefined) ?
+        desc->color_format :
+        wgpu_context->swap_chain.format;
+  msaa_target->depth_stencil_format = desc->depth_stencil_format;
+  wgpu_msaa_target_set_sample_count(msaa_target, MAX(desc->sample_count, 1));
+
+  return msaa_target;
+}
+
+static void release_attachments(wgpu_msaa_target_t* msaa_target)
+{
+  WGPU_RELEASE_RESOURCE(TextureView, msaa_target->color.view)
+  WGPU_RELEASE_RESOURCE(Texture, msaa_target->color.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, msaa_target->depth_stencil.view)
+  WGPU_RELEASE_RESOURCE(Texture, msaa_target->depth_stencil.texture)
+}
+
+void wgpu_msaa_target_destroy(wgpu_msaa_target_t* msaa_target)
+{
+  if (msaa_target == NULL) {
+    return;
+  }
+
+  release_attachments(msaa_target);
+  free(msaa_target);
+}
+
+uint32_t wgpu_msaa_target_set_sample_count(wgpu_msaa_target_t* msaa_target,
+                                           uint32_t sample_count)
+{
+  const uint32_t supported = wgpu_msaa_get_supported_sample_count(
+    msaa_target->color_format, sample_count);
+  if (supported != sample_count) {
+    log_warn("%u samples are not supported, using %u samples", sample_count,
+             supported);
+  }
+  msaa_target->sample_count = supported;
+
+  return supported;
+}
+
+uint32_t wgpu_msaa_target_get_sample_count(wgpu_msaa_target_t* msaa_target)
+{
+  return msaa_target->sample_count;
+}
+
+/* Attachments */
+
+static void create_attachment(wgpu_msaa_target_t* msaa_target,
+                              WGPUTextureFormat format, uint32_t sample_count,
+                              WGPUTexture* texture, WGPUTextureView* view)
+{
+  WGPUDevice device = msaa_target->wgpu_context->device;
+
+  WGPUTextureDescriptor texture_desc = {
+    .label         = msaa_target->label,
+    .usage         = WGPUTextureUsage_RenderAttachment,
+    .dimension     = WGPUTextureDimension_2D,
+    .size          = (WGPUExtent3D) {
+      .width              = msaa_target->width,
+      .height             = msaa_target->height,
+      .depthOrArrayLayers = 1,
+    },
+    .format        = format,
+    .mipLevelCount = 1,
+    .sampleCount   = sample_count,
+  };
+  *texture = wgpuDeviceCreateTexture(device, &texture_desc);
+  ASSERT(*texture != NULL);
+
+  WGPUTextureViewDescriptor view_desc = {
+    .label           = msaa_target->label,
+    .format          = format,
+    .dimension       = WGPUTextureViewDimension_2D,
+    .baseMipLevel    = 0,
+    .mipLevelCount   = 1,
+    .baseArrayLayer  = 0,
+    .arrayLayerCount = 1,
+  };
+  *view = wgpuTextureCreateView(*texture, &view_desc);
+  ASSERT(*view != NULL);
+}
+
+/* (Re)creates the attachments if the surface size or the sample count
+ * changed */
+static void update_attachments(wgpu_msaa_target_t* msaa_target)
+{
+  wgpu_context_t* wgpu_context = msaa_target->wgpu_context;
+  if (msaa_target->width == wgpu_context->surface.width
+      && msaa_target->height == wgpu_context->surface.height
+      && msaa_target->created_sample_count == msaa_target->sample_count) {
+    return;
+  }
+
+  release_attachments(msaa_target);
+  msaa_target->width                = wgpu_context->surface.width;
+  msaa_target->height               = wgpu_context->surface.height;
+  msaa_target->created_sample_count = msaa_target->sample_count;
+
+  /* With 1 sample the pass renders into the resolve target */
+  if (msaa_target->sample_count > 1) {
+    create_attachment(msaa_target, msaa_target->color_format,
+                      msaa_target->sample_count, &msaa_target->color.texture,
+                      &msaa_target->color.view);
+  }
+  if (msaa_target->depth_stencil_format != WGPUTextureFormat_Undefined) {
+    create_attachment(msaa_target, msaa_target->depth_stencil_format,
+                      msaa_target->sample_count,
+                      &msaa_target->depth_stencil.texture,
+                      &msaa_target->depth_stencil.view);
+  }
+}
+
+void wgpu_msaa_target_get_attachments(
+  wgpu_msaa_target_t* msaa_target, WGPUTextureView resolve_target,
+  const WGPUColor* clear_color, WGPURenderPassColorAttachment* color_att,
+  WGPURenderPassDepthStencilAttachment* depth_stencil_att)
+{
+  update_attachments(msaa_target);
+
+  const bool multisampled = msaa_target->sample_count > 1;
+  const WGPUColor clear_value
+    = (clear_color != NULL) ? *clear_color : (WGPUColor){0.0, 0.0, 0.0, 0.0};
+  *color_att = (WGPURenderPassColorAttachment){
+    .view          = multisampled ? msaa_target->color.view : resolve_target,
+    .resolveTarget = multisampled ? resolve_target : NULL,
+    .loadOp        = WGPULoadOp_Clear,
+    .storeOp       = multisampled ? WGPUStoreOp_Discard : WGPUStoreOp_Store,
+    .clearColor    = clear_value,
+  };
+
+  if (depth_stencil_att == NULL) {
+    return;
+  }
+  ASSERT(msaa_target->depth_stencil.view != NULL);
+
+  const float clear_depth
+    = msaa_target->wgpu_context->depth_stencil.reversed_z ? 0.0f : 1.0f;
+  *depth_stencil_att = (WGPURenderPassDepthStencilAttachment){
+    .view            = msaa_target->depth_stencil.view,
+    .depthLoadOp     = WGPULoadOp_Clear,
+    .depthStoreOp    = WGPUStoreOp_Discard,
+    .depthClearValue = clear_depth,
+    .clearDepth      = clear_depth,
+    .clearStencil    = 0,
+  };
+  /* stencilLoadOp & stencilStoreOp must be set if the attachment has stencil
+   * aspect */
+  const WGPUTextureFormat format = msaa_target->depth_stencil_format;
+  if (format == WGPUTextureFormat_Depth24PlusStencil8
+      || format == WGPUTextureFormat_Depth32FloatStencil8) {
+    depth_stencil_att->stencilLoadOp  = WGPULoadOp_Clear;
+    depth_stencil_att->stencilStoreOp = WGPUStoreOp_Discard;
+  }
+}
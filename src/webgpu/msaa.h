@@ -0,0 +1,74 @@
+#ifndef MSAA_H
+#define MSAA_H
+
+#include "context.h"
+
+#define WGPU_MSAA_MAX_SAMPLE_COUNT 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU MSAA target
+ *
+ * Multisampled color and depth-stencil attachments of the surface size,
+ * resolved in the render pass:
+ *
+ *   wgpu_msaa_target_get_attachments(msaa_target, frame_buffer, &clear_color,
+ *                                    &color_att, &depth_stencil_att);
+ *   ... begin the render pass with the attachments ...
+ *
+ * The multisampled attachments are transient: they are cleared on load, the
+ * color attachment is resolved into the resolve target by the render pass and
+ * none of the samples are stored (StoreOp_Discard), so the samples never leave
+ * the tile memory of tiled GPUs and are not written back on the others. The
+ * textures only have the RenderAttachment usage.
+ *
+ * With 1 sample the color attachment is the resolve target itself and stored,
+ * the depth-stencil attachment is still discarded. The attachments are
+ * recreated when the surface size or the sample count changes.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_msaa_target wgpu_msaa_target_t;
+
+typedef struct wgpu_msaa_target_desc_t {
+  const char* label;
+  /* Undefined = swap chain format */
+  WGPUTextureFormat color_format;
+  /* Undefined = no depth-stencil attachment */
+  WGPUTextureFormat depth_stencil_format;
+  /* 1, 2, 4 or 8, see wgpu_msaa_get_supported_sample_count() */
+  uint32_t sample_count;
+} wgpu_msaa_target_desc_t;
+
+/* Sample count validation */
+bool wgpu_msaa_is_sample_count_supported(WGPUTextureFormat format,
+                                         uint32_t sample_count);
+/* Highest supported sample count up to sample_count, at least 1 */
+uint32_t wgpu_msaa_get_supported_sample_count(WGPUTextureFormat format,
+                                              uint32_t sample_count);
+
+/* MSAA target creating / destroying */
+wgpu_msaa_target_t*
+wgpu_msaa_target_create(wgpu_context_t* wgpu_context,
+                        const wgpu_msaa_target_desc_t* desc);
+void wgpu_msaa_target_destroy(wgpu_msaa_target_t* msaa_target);
+
+/**
+ * @brief Changes the sample count, unsupported counts fall back to the next
+ * lower supported count. The attachments are recreated by the next
+ * wgpu_msaa_target_get_attachments().
+ * @return the sample count used
+ */
+uint32_t wgpu_msaa_target_set_sample_count(wgpu_msaa_target_t* msaa_target,
+                                           uint32_t sample_count);
+uint32_t wgpu_msaa_target_get_sample_count(wgpu_msaa_target_t* msaa_target);
+
+/**
+ * @brief Fills the attachments of a render pass rendering into resolve_target.
+ * @param clear_color NULL = transparent black
+ * @param depth_stencil_att NULL if the pass has no depth-stencil attachment
+ */
+void wgpu_msaa_target_get_attachments(
+  wgpu_msaa_target_t* msaa_target, WGPUTextureView resolve_target,
+  const WGPUColor* clear_color, WGPURenderPassColorAttachment* color_att,
+  WGPURenderPassDepthStencilAttachment* depth_stencil_att);
+
+#endif /* MSAA_H */
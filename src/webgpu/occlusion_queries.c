@@ -0,0 +1,232 @@
+#include "occlusion_queries.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+typedef enum wgpu_occlusion_frame_state_t {
+  OcclusionFrame_State_Available = 0,
+  OcclusionFrame_State_Recording = 1,
+  OcclusionFrame_State_Submitted = 2,
+  OcclusionFrame_State_Mapping   = 3,
+} wgpu_occlusion_frame_state_t;
+
+typedef struct wgpu_occlusion_frame_t {
+  struct wgpu_occlusion_queries* queries;
+  WGPUQuerySet query_set;
+  WGPUBuffer resolve_buffer;
+  WGPUBuffer readback_buffer;
+  wgpu_occlusion_frame_state_t state;
+  uint64_t frame_index; /* frame the queries were recorded in */
+} wgpu_occlusion_frame_t;
+
+/**
+ * @brief Occlusion queries class
+ */
+struct wgpu_occlusion_queries {
+  wgpu_context_t* wgpu_context;
+  uint32_t query_count;
+  wgpu_occlusion_frame_t frames[WGPU_OCCLUSION_QUERIES_FRAME_COUNT];
+  wgpu_occlusion_frame_t* current_frame;
+  uint64_t frame_index;
+  /* Results read back during the current frame */
+  struct {
+    uint64_t* samples;
+    uint64_t frame_index;
+    bool available;
+  } pending;
+  /* Results consumed at the beginning of the current frame */
+  struct {
+    uint64_t* samples;
+    uint64_t frame_index;
+    bool available;
+    uint32_t version;
+  } current;
+};
+
+/* Occlusion queries creating / destroying */
+
+wgpu_occlusion_queries_t*
+wgpu_occlusion_queries_create(wgpu_context_t* wgpu_context,
+                              uint32_t query_count)
+{
+  ASSERT(query_count > 0);
+
+  wgpu_occlusion_queries_t* queries
+    = (wgpu_occlusion_queries_t*)malloc(sizeof(*queries));
+  memset(queries, 0, sizeof(*queries));
+  queries->wgpu_context    = wgpu_context;
+  queries->query_count     = query_count;
+  queries->pending.samples = (uint64_t*)calloc(query_count, sizeof(uint64_t));
+  queries->current.samples = (uint64_t*)calloc(query_count, sizeof(uint64_t));
+
+  const uint64_t buffer_size = query_count * sizeof(uint64_t);
+  for (uint32_t i = 0; i < WGPU_OCCLUSION_QUERIES_FRAME_COUNT; ++i) {
+    wgpu_occlusion_frame_t* frame = &queries->frames[i];
+    frame->queries                = queries;
+    frame->state                  = OcclusionFrame_State_Available;
+    frame->query_set              = wgpuDeviceCreateQuerySet(
+      wgpu_context->device, &(WGPUQuerySetDescriptor){
+                              .label = "Occlusion query set",
+                              .type  = WGPUQueryType_Occlusion,
+                              .count = query_count,
+                            });
+    frame->resolve_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Occlusion query resolve buffer",
+        .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        .size  = buffer_size,
+      });
+    frame->readback_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Occlusion query readback buffer",
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size  = buffer_size,
+      });
+    ASSERT(frame->query_set && frame->resolve_buffer
+           && frame->readback_buffer);
+  }
+
+  return queries;
+}
+
+void wgpu_occlusion_queries_destroy(wgpu_occlusion_queries_t* queries)
+{
+  if (queries == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < WGPU_OCCLUSION_QUERIES_FRAME_COUNT; ++i) {
+    wgpu_occlusion_frame_t* frame = &queries->frames[i];
+    if (frame->state == OcclusionFrame_State_Mapping) {
+      /* Cancels the pending map request */
+      wgpuBufferUnmap(frame->readback_buffer);
+    }
+    WGPU_RELEASE_RESOURCE(QuerySet, frame->query_set)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->resolve_buffer)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->readback_buffer)
+  }
+
+  free(queries->pending.samples);
+  free(queries->current.samples);
+  free(queries);
+}
+
+/* Frame recording */
+
+WGPUQuerySet
+wgpu_occlusion_queries_begin_frame(wgpu_occlusion_queries_t* queries)
+{
+  /* Consume the results which arrived during the last frame */
+  if (queries->pending.available) {
+    memcpy(queries->current.samples, queries->pending.samples,
+           queries->query_count * sizeof(uint64_t));
+    queries->current.frame_index = queries->pending.frame_index;
+    queries->current.available   = true;
+    ++queries->current.version;
+    queries->pending.available = false;
+  }
+
+  wgpu_occlusion_frame_t* frame
+    = &queries->frames[queries->frame_index
+                       % WGPU_OCCLUSION_QUERIES_FRAME_COUNT];
+  if (frame->state != OcclusionFrame_State_Available) {
+    /* The readback of this query set is still in flight, skip this frame */
+    queries->current_frame = NULL;
+    return NULL;
+  }
+
+  frame->state           = OcclusionFrame_State_Recording;
+  frame->frame_index     = queries->frame_index;
+  queries->current_frame = frame;
+  return frame->query_set;
+}
+
+void wgpu_occlusion_queries_resolve(wgpu_occlusion_queries_t* queries,
+                                    WGPUCommandEncoder cmd_enc)
+{
+  wgpu_occlusion_frame_t* frame = queries->current_frame;
+  if (frame == NULL) {
+    return;
+  }
+
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, frame->query_set, 0,
+                                    queries->query_count,
+                                    frame->resolve_buffer, 0);
+  wgpuCommandEncoderCopyBufferToBuffer(
+    cmd_enc, frame->resolve_buffer, 0, frame->readback_buffer, 0,
+    queries->query_count * sizeof(uint64_t));
+}
+
+static void occlusion_readback_map_cb(WGPUBufferMapAsyncStatus status,
+                                      void* user_data)
+{
+  wgpu_occlusion_frame_t* frame     = (wgpu_occlusion_frame_t*)user_data;
+  wgpu_occlusion_queries_t* queries = frame->queries;
+
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    const uint64_t size     = queries->query_count * sizeof(uint64_t);
+    uint64_t const* samples = (uint64_t const*)wgpuBufferGetConstMappedRange(
+      frame->readback_buffer, 0, size);
+    ASSERT(samples);
+    /* Keep the newest results if several maps complete in one frame */
+    if (!queries->pending.available
+        || frame->frame_index > queries->pending.frame_index) {
+      memcpy(queries->pending.samples, samples, size);
+      queries->pending.frame_index = frame->frame_index;
+      queries->pending.available   = true;
+    }
+    wgpuBufferUnmap(frame->readback_buffer);
+  }
+
+  frame->state = OcclusionFrame_State_Available;
+}
+
+void wgpu_occlusion_queries_end_frame(wgpu_occlusion_queries_t* queries)
+{
+  if (queries->current_frame != NULL) {
+    queries->current_frame->state = OcclusionFrame_State_Submitted;
+    queries->current_frame        = NULL;
+  }
+
+  /* Map the frames submitted WGPU_OCCLUSION_QUERIES_MAP_LATENCY frames ago,
+   * mapping them earlier would make the map wait for the GPU */
+  for (uint32_t i = 0; i < WGPU_OCCLUSION_QUERIES_FRAME_COUNT; ++i) {
+    wgpu_occlusion_frame_t* frame = &queries->frames[i];
+    if (frame->state == OcclusionFrame_State_Submitted
+        && frame->frame_index + WGPU_OCCLUSION_QUERIES_MAP_LATENCY
+             <= queries->frame_index) {
+      frame->state = OcclusionFrame_State_Mapping;
+      wgpuBufferMapAsync(frame->readback_buffer, WGPUMapMode_Read, 0,
+                         queries->query_count * sizeof(uint64_t),
+                         occlusion_readback_map_cb, frame);
+    }
+  }
+
+  ++queries->frame_index;
+}
+
+/* Results */
+
+const uint64_t*
+wgpu_occlusion_queries_get_results(wgpu_occlusion_queries_t* queries)
+{
+  return queries->current.available ? queries->current.samples : NULL;
+}
+
+uint32_t wgpu_occlusion_queries_get_latency(wgpu_occlusion_queries_t* queries)
+{
+  return queries->current.available ?
+           (uint32_t)(queries->frame_index - queries->current.frame_index) :
+           0;
+}
+
+uint32_t
+wgpu_occlusion_queries_get_result_version(wgpu_occlusion_queries_t* queries)
+{
+  return queries->current.version;
+}
@@ -0,0 +1,74 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include "context.h"
+
+#define WGPU_OCCLUSION_QUERIES_FRAME_COUNT 4u
+/* Frames between recording the queries of a frame and mapping its results */
+#define WGPU_OCCLUSION_QUERIES_MAP_LATENCY 2u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU occlusion queries
+ *
+ * Pipelined readback of occlusion query results without CPU stalls. Each
+ * frame records its queries into its own query set from a ring of
+ * WGPU_OCCLUSION_QUERIES_FRAME_COUNT, e.g.:
+ *
+ *   render_pass_desc.occlusionQuerySet
+ *     = wgpu_occlusion_queries_begin_frame(occlusion_queries);
+ *   ... render pass with Begin/EndOcclusionQuery if the query set is set ...
+ *   wgpu_occlusion_queries_resolve(occlusion_queries, cmd_enc);
+ *   ... submit ...
+ *   wgpu_occlusion_queries_end_frame(occlusion_queries);
+ *
+ * The results of frame N are mapped asynchronously in frame
+ * N + WGPU_OCCLUSION_QUERIES_MAP_LATENCY, when the GPU normally has finished
+ * the frame, and become the current results at the beginning of the frame
+ * after the map completed. The current results therefore stay the same during
+ * a frame. When all query sets are still in flight, the frame records no
+ * queries instead of waiting for a readback.
+ *
+ * Queries which are not written by a frame read back as 0 passed samples.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_occlusion_queries wgpu_occlusion_queries_t;
+
+/* Occlusion queries creating / destroying */
+wgpu_occlusion_queries_t*
+wgpu_occlusion_queries_create(wgpu_context_t* wgpu_context,
+                              uint32_t query_count);
+void wgpu_occlusion_queries_destroy(wgpu_occlusion_queries_t* queries);
+
+/**
+ * @brief Consumes the results read back since the last frame and returns the
+ * query set of the new frame, or NULL when no query set is available and the
+ * frame must not begin occlusion queries.
+ */
+WGPUQuerySet
+wgpu_occlusion_queries_begin_frame(wgpu_occlusion_queries_t* queries);
+
+/**
+ * @brief Resolves the queries of the frame into its readback buffer, recorded
+ * after the render passes of the frame.
+ */
+void wgpu_occlusion_queries_resolve(wgpu_occlusion_queries_t* queries,
+                                    WGPUCommandEncoder cmd_enc);
+
+/**
+ * @brief Completes the frame after its submit and maps the readback buffer of
+ * the frame WGPU_OCCLUSION_QUERIES_MAP_LATENCY frames back.
+ */
+void wgpu_occlusion_queries_end_frame(wgpu_occlusion_queries_t* queries);
+
+/* Results */
+
+/* Passed samples of the current results, NULL until the first readback */
+const uint64_t*
+wgpu_occlusion_queries_get_results(wgpu_occlusion_queries_t* queries);
+/* Number of frames the current results lag behind the current frame */
+uint32_t wgpu_occlusion_queries_get_latency(wgpu_occlusion_queries_t* queries);
+/* Increased each time new results become current */
+uint32_t
+wgpu_occlusion_queries_get_result_version(wgpu_occlusion_queries_t* queries);
+
+#endif /* OCCLUSION_QUERIES_H */
@@ -0,0 +1,255 @@
+#include "parallel_recorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "../core/thread_pool.h"
+
+/* Element size of the parallel for which makes every job a chunk of its own,
+ * jobs are coarse and take very different times */
+#define PARALLEL_RECORDER_JOB_ELEMENT_SIZE 64u
+
+typedef enum parallel_job_type_t {
+  ParallelJob_Type_Commands     = 0,
+  ParallelJob_Type_RenderBundle = 1,
+} parallel_job_type_t;
+
+typedef struct parallel_job_t {
+  parallel_job_type_t type;
+  const char* label;
+  wgpu_parallel_command_func_t command_func;
+  wgpu_parallel_bundle_func_t bundle_func;
+  void* user_data;
+  /* Render bundle encoder descriptor */
+  uint32_t color_format_count;
+  WGPUTextureFormat color_formats[WGPU_PARALLEL_RECORDER_MAX_COLOR_FORMATS];
+  WGPUTextureFormat depth_stencil_format;
+  uint32_t sample_count;
+  /* Encoders created by the calling thread before the jobs run */
+  WGPUCommandEncoder cmd_enc;
+  WGPURenderBundleEncoder bundle_enc;
+  WGPURenderBundle render_bundle;
+} parallel_job_t;
+
+/**
+ * @brief Parallel recorder class
+ */
+struct wgpu_parallel_recorder {
+  wgpu_context_t* wgpu_context;
+  thread_pool_t* thread_pool;
+  parallel_job_t jobs[WGPU_PARALLEL_RECORDER_MAX_JOBS];
+  uint32_t job_count;
+  /* Jobs recorded by the last wgpu_parallel_recorder_record() */
+  uint32_t recorded_job_count;
+};
+
+/* Parallel recorder creating / destroying */
+
+wgpu_parallel_recorder_t*
+wgpu_parallel_recorder_create(wgpu_context_t* wgpu_context,
+                              uint32_t thread_count)
+{
+  wgpu_parallel_recorder_t* recorder
+    = (wgpu_parallel_recorder_t*)malloc(sizeof(*recorder));
+  memset(recorder, 0, sizeof(*recorder));
+  recorder->wgpu_context = wgpu_context;
+  recorder->thread_pool  = thread_pool_create(thread_count);
+
+  return recorder;
+}
+
+void wgpu_parallel_recorder_destroy(wgpu_parallel_recorder_t* recorder)
+{
+  if (recorder == NULL) {
+    return;
+  }
+
+  wgpu_parallel_recorder_reset(recorder);
+  thread_pool_release(recorder->thread_pool);
+  free(recorder);
+}
+
+void wgpu_parallel_recorder_reset(wgpu_parallel_recorder_t* recorder)
+{
+  for (uint32_t i = 0; i < recorder->job_count; ++i) {
+    WGPU_RELEASE_RESOURCE(RenderBundle, recorder->jobs[i].render_bundle)
+  }
+  recorder->job_count          = 0;
+  recorder->recorded_job_count = 0;
+}
+
+/* Job adding */
+
+static parallel_job_t* add_job(wgpu_parallel_recorder_t* recorder,
+                               parallel_job_type_t type, const char* label,
+                               void* user_data)
+{
+  ASSERT(recorder->job_count < WGPU_PARALLEL_RECORDER_MAX_JOBS);
+
+  parallel_job_t* job = &recorder->jobs[recorder->job_count++];
+  memset(job, 0, sizeof(*job));
+  job->type      = type;
+  job->label     = label;
+  job->user_data = user_data;
+
+  return job;
+}
+
+uint32_t
+wgpu_parallel_recorder_add_commands(wgpu_parallel_recorder_t* recorder,
+                                    const char* label,
+                                    wgpu_parallel_command_func_t record_func,
+                                    void* user_data)
+{
+  ASSERT(record_func != NULL);
+
+  parallel_job_t* job
+    = add_job(recorder, ParallelJob_Type_Commands, label, user_data);
+  job->command_func = record_func;
+
+  return recorder->job_count - 1;
+}
+
+uint32_t wgpu_parallel_recorder_add_render_bundle(
+  wgpu_parallel_recorder_t* recorder, const wgpu_parallel_bundle_desc_t* desc)
+{
+  ASSERT(desc->record_func != NULL);
+  ASSERT(desc->color_format_count
+         <= WGPU_PARALLEL_RECORDER_MAX_COLOR_FORMATS);
+
+  parallel_job_t* job = add_job(recorder, ParallelJob_Type_RenderBundle,
+                                desc->label, desc->user_data);
+  job->bundle_func          = desc->record_func;
+  job->color_format_count   = desc->color_format_count;
+  job->depth_stencil_format = desc->depth_stencil_format;
+  job->sample_count         = desc->sample_count > 0 ? desc->sample_count : 1;
+  if (desc->color_format_count > 0) {
+    memcpy(job->color_formats, desc->color_formats,
+           desc->color_format_count * sizeof(WGPUTextureFormat));
+  }
+
+  return recorder->job_count - 1;
+}
+
+/* Job recording */
+
+static void create_job_encoder(wgpu_parallel_recorder_t* recorder,
+                               parallel_job_t* job)
+{
+  WGPUDevice device = recorder->wgpu_context->device;
+
+  if (job->type == ParallelJob_Type_Commands) {
+    job->cmd_enc = wgpuDeviceCreateCommandEncoder(
+      device, &(WGPUCommandEncoderDescriptor){
+                .label = job->label,
+              });
+    ASSERT(job->cmd_enc != NULL);
+  }
+  else {
+    job->bundle_enc = wgpuDeviceCreateRenderBundleEncoder(
+      device, &(WGPURenderBundleEncoderDescriptor){
+                .label              = job->label,
+                .colorFormatsCount  = job->color_format_count,
+                .colorFormats       = job->color_formats,
+                .depthStencilFormat = job->depth_stencil_format,
+                .sampleCount        = job->sample_count,
+              });
+    ASSERT(job->bundle_enc != NULL);
+  }
+}
+
+/* Worker thread: only encodes into the encoders of its jobs */
+static void record_job_range(void* arg, uint32_t begin, uint32_t end)
+{
+  wgpu_parallel_recorder_t* recorder = (wgpu_parallel_recorder_t*)arg;
+
+  for (uint32_t i = recorder->recorded_job_count + begin;
+       i < recorder->recorded_job_count + end; ++i) {
+    parallel_job_t* job = &recorder->jobs[i];
+    if (job->type == ParallelJob_Type_Commands) {
+      job->command_func(job->cmd_enc, job->user_data);
+    }
+    else {
+      job->bundle_func(job->bundle_enc, job->user_data);
+    }
+  }
+}
+
+static void finish_job(wgpu_parallel_recorder_t* recorder, parallel_job_t* job)
+{
+  wgpu_context_t* wgpu_context = recorder->wgpu_context;
+
+  if (job->type == ParallelJob_Type_Commands) {
+    ASSERT(wgpu_context->submit_info.command_buffer_count
+           < MAX_COMMAND_BUFFER_COUNT);
+    wgpu_context->submit_info
+      .command_buffers[wgpu_context->submit_info.command_buffer_count++]
+      = wgpu_get_command_buffer(job->cmd_enc);
+    WGPU_RELEASE_RESOURCE(CommandEncoder, job->cmd_enc)
+  }
+  else {
+    job->render_bundle = wgpuRenderBundleEncoderFinish(
+      job->bundle_enc, &(WGPURenderBundleDescriptor){
+                         .label = job->label,
+                       });
+    ASSERT(job->render_bundle != NULL);
+    WGPU_RELEASE_RESOURCE(RenderBundleEncoder, job->bundle_enc)
+  }
+}
+
+void wgpu_parallel_recorder_record(wgpu_parallel_recorder_t* recorder)
+{
+  const uint32_t first_job = recorder->recorded_job_count;
+  const uint32_t job_count = recorder->job_count - first_job;
+  if (job_count == 0) {
+    return;
+  }
+
+  for (uint32_t i = first_job; i < recorder->job_count; ++i) {
+    create_job_encoder(recorder, &recorder->jobs[i]);
+  }
+
+  thread_pool_parallel_for(recorder->thread_pool, job_count,
+                           PARALLEL_RECORDER_JOB_ELEMENT_SIZE,
+                           record_job_range, recorder);
+
+  /* Gather the results in the order the jobs were added */
+  for (uint32_t i = first_job; i < recorder->job_count; ++i) {
+    finish_job(recorder, &recorder->jobs[i]);
+  }
+  recorder->recorded_job_count = recorder->job_count;
+}
+
+/* Render bundle executing */
+
+WGPURenderBundle
+wgpu_parallel_recorder_get_render_bundle(wgpu_parallel_recorder_t* recorder,
+                                         uint32_t job_index)
+{
+  ASSERT(job_index < recorder->recorded_job_count);
+  ASSERT(recorder->jobs[job_index].type == ParallelJob_Type_RenderBundle);
+
+  return recorder->jobs[job_index].render_bundle;
+}
+
+void wgpu_parallel_recorder_execute_bundles(
+  wgpu_parallel_recorder_t* recorder, WGPURenderPassEncoder rpass_enc)
+{
+  WGPURenderBundle bundles[WGPU_PARALLEL_RECORDER_MAX_JOBS];
+  uint32_t bundle_count = 0;
+  for (uint32_t i = 0; i < recorder->recorded_job_count; ++i) {
+    if (recorder->jobs[i].type == ParallelJob_Type_RenderBundle) {
+      bundles[bundle_count++] = recorder->jobs[i].render_bundle;
+    }
+  }
+  if (bundle_count > 0) {
+    wgpuRenderPassEncoderExecuteBundles(rpass_enc, bundle_count, bundles);
+  }
+}
+
+uint32_t
+wgpu_parallel_recorder_get_thread_count(wgpu_parallel_recorder_t* recorder)
+{
+  return thread_pool_get_thread_count(recorder->thread_pool) + 1;
+}
@@ -0,0 +1,100 @@
+#ifndef PARALLEL_RECORDER_H
+#define PARALLEL_RECORDER_H
+
+#include "context.h"
+
+#define WGPU_PARALLEL_RECORDER_MAX_JOBS 64u
+#define WGPU_PARALLEL_RECORDER_MAX_COLOR_FORMATS 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU parallel recorder
+ *
+ * Records the commands of a frame on several CPU cores. Each job gets its own
+ * command encoder or render bundle encoder, the jobs run on the worker
+ * threads of a thread pool and on the calling thread:
+ *
+ *   wgpu_parallel_recorder_reset(recorder);
+ *   wgpu_parallel_recorder_add_commands(recorder, "Shadows", func, data);
+ *   job = wgpu_parallel_recorder_add_render_bundle(recorder, &bundle_desc);
+ *   wgpu_parallel_recorder_record(recorder);
+ *   bundle = wgpu_parallel_recorder_get_render_bundle(recorder, job);
+ *   ... wgpuRenderPassEncoderExecuteBundles(rpass_enc, 1, &bundle) ...
+ *
+ * The encoders are created and finished by the calling thread, the jobs only
+ * record commands into their encoder and must not create or release WebGPU
+ * objects. The results are gathered in the order the jobs were added: the
+ * command buffers of the command jobs are appended to the submit_info of the
+ * context, independent of which thread finished first.
+ *
+ * The WGPU_STATS_ENABLED counters are not synchronized, render and compute
+ * passes recorded by command jobs are counted approximately. Render bundle
+ * encoder calls are not counted.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_parallel_recorder wgpu_parallel_recorder_t;
+
+typedef void (*wgpu_parallel_command_func_t)(WGPUCommandEncoder cmd_enc,
+                                             void* user_data);
+typedef void (*wgpu_parallel_bundle_func_t)(
+  WGPURenderBundleEncoder bundle_enc, void* user_data);
+
+typedef struct wgpu_parallel_bundle_desc_t {
+  const char* label;
+  /* Attachments of the render pass the bundle is executed in */
+  uint32_t color_format_count;
+  const WGPUTextureFormat* color_formats;
+  /* WGPUTextureFormat_Undefined for render passes without depth attachment */
+  WGPUTextureFormat depth_stencil_format;
+  /* 0 = 1 sample */
+  uint32_t sample_count;
+  wgpu_parallel_bundle_func_t record_func;
+  void* user_data;
+} wgpu_parallel_bundle_desc_t;
+
+/* Parallel recorder creating / destroying, thread_count 0 = number of CPU
+ * cores */
+wgpu_parallel_recorder_t*
+wgpu_parallel_recorder_create(wgpu_context_t* wgpu_context,
+                              uint32_t thread_count);
+void wgpu_parallel_recorder_destroy(wgpu_parallel_recorder_t* recorder);
+
+/* Removes the jobs and releases the render bundles of the last recording */
+void wgpu_parallel_recorder_reset(wgpu_parallel_recorder_t* recorder);
+
+/**
+ * @brief Adds a job recording into its own command encoder.
+ * @return the job index
+ */
+uint32_t
+wgpu_parallel_recorder_add_commands(wgpu_parallel_recorder_t* recorder,
+                                    const char* label,
+                                    wgpu_parallel_command_func_t record_func,
+                                    void* user_data);
+
+/**
+ * @brief Adds a job recording a portion of a render pass into a render bundle.
+ * @return the job index
+ */
+uint32_t wgpu_parallel_recorder_add_render_bundle(
+  wgpu_parallel_recorder_t* recorder, const wgpu_parallel_bundle_desc_t* desc);
+
+/**
+ * @brief Runs the jobs added since the last reset or record and waits for
+ * them. The command buffers are appended to submit_info in job order.
+ */
+void wgpu_parallel_recorder_record(wgpu_parallel_recorder_t* recorder);
+
+/* Render bundle of a bundle job, valid until the next reset */
+WGPURenderBundle
+wgpu_parallel_recorder_get_render_bundle(wgpu_parallel_recorder_t* recorder,
+                                         uint32_t job_index);
+
+/* Executes the render bundles of all bundle jobs in job order */
+void wgpu_parallel_recorder_execute_bundles(
+  wgpu_parallel_recorder_t* recorder, WGPURenderPassEncoder rpass_enc);
+
+/* Threads recording the jobs, including the calling thread */
+uint32_t
+wgpu_parallel_recorder_get_thread_count(wgpu_parallel_recorder_t* recorder);
+
+#endif /* PARALLEL_RECORDER_H */
@@ -0,0 +1,764 @@
+#include "particle_system.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "compute_primitives.h"
+#include "pipeline_cache.h"
+#include "pipeline_statistics.h"
+#include "shader.h"
+
+/* Workgroups per dispatch of the emission and the update */
+#define PARTICLE_SYSTEM_MAX_GROUPS 65535u
+/* Indirect arguments: emission dispatch, update dispatch, draw */
+#define PARTICLE_SYSTEM_EMIT_ARGS_OFFSET (0u * sizeof(uint32_t))
+#define PARTICLE_SYSTEM_UPDATE_ARGS_OFFSET (4u * sizeof(uint32_t))
+#define PARTICLE_SYSTEM_DRAW_ARGS_OFFSET (8u * sizeof(uint32_t))
+#define PARTICLE_SYSTEM_ARGS_SIZE (12u * sizeof(uint32_t))
+/* Bindings of group 0, the depth sort adds the keys, values and sorted draws */
+#define PARTICLE_SYSTEM_BINDING_COUNT 6u
+#define PARTICLE_SYSTEM_SORT_BINDING_COUNT 9u
+/* Sorted bits of the depth keys, the sign and exponent and 15 mantissa bits */
+#define PARTICLE_SYSTEM_SORT_KEY_BITS 24u
+
+typedef struct particle_system_params_t {
+  uint32_t capacity;
+  uint32_t emit_request;
+  uint32_t vertex_count;
+  uint32_t parity;
+  uint32_t frame;
+  uint32_t seed;
+  uint32_t padding[2];
+  /* Row of the view matrix giving the view space z */
+  float view_depth[4];
+} particle_system_params_t;
+
+typedef struct particle_system_state_t {
+  uint32_t dead_count;
+  uint32_t alive_counts[2];
+  uint32_t emit_count;
+} particle_system_state_t;
+
+/* -------------------------------------------------------------------------- *
+ * Kernels
+ *
+ * The control kernels run on a single thread between the dispatches and write
+ * the indirect arguments, they are a module of their own binding the argument
+ * buffer to group 1. The argument buffer is not bound during the emission and
+ * update dispatches, which use it as indirect buffer. The emission and update
+ * kernels are compiled together with the behavior, which owns group 1 there.
+ *
+ * Alive list parity p is updated in the frame, the survivors are appended to
+ * alive list 1 - p, which is the draw count as well.
+ *
+ * The depth sort kernels are appended to the behavior when the system sorts:
+ * the keys kernel writes a key per slot of the capacity, the gather kernel
+ * copies the draws in the sorted order.
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* particle_system_common_wgsl = CODE(
+  struct ParticleSystem {
+    capacity     : u32,
+    emit_request : u32,
+    vertex_count : u32,
+    parity       : u32,
+    frame        : u32,
+    seed         : u32,
+    view_depth   : vec4<f32>,
+  }
+
+  struct ParticleState {
+    dead_count   : atomic<u32>,
+    alive_counts : array<atomic<u32>, 2>,
+    emit_count   : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> particle_system : ParticleSystem;
+  @group(0) @binding(1) var<storage, read_write> particle_state : ParticleState;
+
+  const particle_workgroup_size = 64u;
+
+  fn particle_hash(value : u32) -> u32 {
+    let state = value * 747796405u + 2891336453u;
+    let word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  // Uniform random number in [0, 1) per value, stream and frame
+  fn particle_random(value : u32, stream : u32) -> f32 {
+    let seed = particle_hash(particle_system.frame ^ particle_system.seed);
+    let hash = particle_hash(value ^ particle_hash(stream ^ seed));
+    return f32(hash >> 8u) / 16777216.0;
+  }
+);
+
+static const char* particle_system_control_wgsl = CODE(
+  @group(1) @binding(0) var<storage, read_write> args : array<u32, 12>;
+
+  fn group_count(count : u32) -> u32 {
+    return (count + particle_workgroup_size - 1u) / particle_workgroup_size;
+  }
+
+  @compute @workgroup_size(1)
+  fn prepare_emit() {
+    let emit_count = min(particle_system.emit_request,
+                         atomicLoad(&particle_state.dead_count));
+    particle_state.emit_count = emit_count;
+    args[0] = group_count(emit_count);
+    args[1] = 1u;
+    args[2] = 1u;
+    atomicStore(&particle_state.alive_counts[1u - particle_system.parity], 0u);
+  }
+
+  @compute @workgroup_size(1)
+  fn prepare_update() {
+    let parity = particle_system.parity;
+    args[4] = group_count(atomicLoad(&particle_state.alive_counts[parity]));
+    args[5] = 1u;
+    args[6] = 1u;
+  }
+
+  @compute @workgroup_size(1)
+  fn finalize() {
+    let parity = particle_system.parity;
+    let count  = atomicLoad(&particle_state.alive_counts[1u - parity]);
+    if (particle_system.vertex_count == 0u) {
+      args[8] = count;
+      args[9] = 1u;
+    }
+    else {
+      args[8] = particle_system.vertex_count;
+      args[9] = count;
+    }
+    args[10] = 0u;
+    args[11] = 0u;
+  }
+);
+
+static const char* particle_system_kernels_wgsl = CODE(
+  @group(0) @binding(2) var<storage, read_write> particles : array<Particle>;
+  @group(0) @binding(3) var<storage, read_write> dead_list : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> alive_lists : array<u32>;
+  @group(0) @binding(5) var<storage, read_write> draws : array<Particle>;
+
+  @compute @workgroup_size(particle_workgroup_size)
+  fn emit(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    if (global_id.x >= particle_state.emit_count) {
+      return;
+    }
+    let dead  = atomicSub(&particle_state.dead_count, 1u) - 1u;
+    let index = dead_list[dead];
+    particles[index] = particle_emit(global_id.x);
+
+    let parity = particle_system.parity;
+    let slot   = atomicAdd(&particle_state.alive_counts[parity], 1u);
+    alive_lists[parity * particle_system.capacity + slot] = index;
+  }
+
+  @compute @workgroup_size(particle_workgroup_size)
+  fn update(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let parity = particle_system.parity;
+    if (global_id.x >= atomicLoad(&particle_state.alive_counts[parity])) {
+      return;
+    }
+    let index = alive_lists[parity * particle_system.capacity + global_id.x];
+    var particle = particles[index];
+    if (!particle_update(&particle)) {
+      let dead = atomicAdd(&particle_state.dead_count, 1u);
+      dead_list[dead] = index;
+      return;
+    }
+    particles[index] = particle;
+
+    let next_parity = 1u - parity;
+    let slot = atomicAdd(&particle_state.alive_counts[next_parity], 1u);
+    alive_lists[next_parity * particle_system.capacity + slot] = index;
+    draws[slot] = particle;
+  }
+);
+
+static const char* particle_system_sort_wgsl = CODE(
+  @group(0) @binding(6) var<storage, read_write> sort_keys : array<u32>;
+  @group(0) @binding(7) var<storage, read_write> sort_values : array<u32>;
+  @group(0) @binding(8) var<storage, read_write> sorted_draws : array<Particle>;
+
+  fn draw_count() -> u32 {
+    let parity = particle_system.parity;
+    return atomicLoad(&particle_state.alive_counts[1u - parity]);
+  }
+
+  // Back to front: the keys ascend with decreasing view distance, the upper
+  // bits of a positive float sort like the float
+  @compute @workgroup_size(particle_workgroup_size)
+  fn write_sort_keys(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let i = global_id.x;
+    if (i >= particle_system.capacity) {
+      return;
+    }
+    var key = 0xFFFFFFu;
+    if (i < draw_count()) {
+      let position = vec4<f32>(particle_position(draws[i]), 1.0);
+      let distance = max(-dot(particle_system.view_depth, position), 0.0);
+      key = 0xFFFFFFu - (bitcast<u32>(distance) >> 8u);
+    }
+    sort_keys[i]   = key;
+    sort_values[i] = i;
+  }
+
+  @compute @workgroup_size(particle_workgroup_size)
+  fn gather_sorted(@builtin(global_invocation_id) global_id : vec3<u32>) {
+    let i = global_id.x;
+    if (i >= draw_count()) {
+      return;
+    }
+    sorted_draws[i] = draws[sort_values[i]];
+  }
+);
+// clang-format on
+
+struct wgpu_particle_system {
+  wgpu_context_t* wgpu_context;
+  uint32_t capacity;
+  uint32_t particle_size;
+  uint32_t vertex_count;
+  uint32_t parity;
+  uint32_t frame;
+  uint32_t seed;
+  float view_depth[4];
+  bool depth_sort;
+  bool depth_sort_enabled;
+  wgpu_compute_primitives_t* compute_primitives;
+  struct {
+    WGPUBuffer params;
+    WGPUBuffer state;
+    WGPUBuffer particles;
+    WGPUBuffer dead_list;
+    WGPUBuffer alive_lists;
+    WGPUBuffer draws;
+    WGPUBuffer args;
+    WGPUBuffer sort_keys;
+    WGPUBuffer sort_values;
+    WGPUBuffer sorted_draws;
+  } buffers;
+  WGPUBindGroupLayout system_bind_group_layout;
+  WGPUBindGroupLayout control_bind_group_layout;
+  WGPUBindGroupLayout empty_bind_group_layout;
+  WGPUPipelineLayout control_pipeline_layout;
+  WGPUPipelineLayout behavior_pipeline_layout;
+  WGPUBindGroup system_bind_group;
+  WGPUBindGroup control_bind_group;
+  WGPUBindGroup behavior_bind_group;
+  struct {
+    WGPUComputePipeline prepare_emit;
+    WGPUComputePipeline emit;
+    WGPUComputePipeline prepare_update;
+    WGPUComputePipeline update;
+    WGPUComputePipeline finalize;
+    WGPUComputePipeline write_sort_keys;
+    WGPUComputePipeline gather_sorted;
+  } pipelines;
+};
+
+static WGPUBuffer particle_system_create_buffer(wgpu_context_t* wgpu_context,
+                                                const char* label,
+                                                WGPUBufferUsageFlags usage,
+                                                uint64_t size)
+{
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = label,
+                            .usage = usage | WGPUBufferUsage_CopyDst,
+                            .size  = size,
+                          });
+  ASSERT(buffer != NULL);
+  return buffer;
+}
+
+static void particle_system_create_buffers(wgpu_particle_system_t* ps)
+{
+  wgpu_context_t* wgpu_context = ps->wgpu_context;
+  const uint64_t capacity      = ps->capacity;
+
+  ps->buffers.params = particle_system_create_buffer(
+    wgpu_context, "particle_system_params_buffer", WGPUBufferUsage_Uniform,
+    sizeof(particle_system_params_t));
+  ps->buffers.state = particle_system_create_buffer(
+    wgpu_context, "particle_system_state_buffer", WGPUBufferUsage_Storage,
+    sizeof(particle_system_state_t));
+  ps->buffers.particles = particle_system_create_buffer(
+    wgpu_context, "particle_system_particles_buffer", WGPUBufferUsage_Storage,
+    capacity * ps->particle_size);
+  ps->buffers.dead_list = particle_system_create_buffer(
+    wgpu_context, "particle_system_dead_list_buffer", WGPUBufferUsage_Storage,
+    capacity * sizeof(uint32_t));
+  ps->buffers.alive_lists = particle_system_create_buffer(
+    wgpu_context, "particle_system_alive_lists_buffer",
+    WGPUBufferUsage_Storage, 2 * capacity * sizeof(uint32_t));
+  ps->buffers.draws = particle_system_create_buffer(
+    wgpu_context, "particle_system_draw_buffer",
+    WGPUBufferUsage_Storage | WGPUBufferUsage_Vertex,
+    capacity * ps->particle_size);
+  ps->buffers.args = particle_system_create_buffer(
+    wgpu_context, "particle_system_args_buffer",
+    WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect,
+    PARTICLE_SYSTEM_ARGS_SIZE);
+  if (ps->depth_sort) {
+    ps->buffers.sort_keys = particle_system_create_buffer(
+      wgpu_context, "particle_system_sort_keys_buffer", WGPUBufferUsage_Storage,
+      capacity * sizeof(uint32_t));
+    ps->buffers.sort_values = particle_system_create_buffer(
+      wgpu_context, "particle_system_sort_values_buffer",
+      WGPUBufferUsage_Storage, capacity * sizeof(uint32_t));
+    ps->buffers.sorted_draws = particle_system_create_buffer(
+      wgpu_context, "particle_system_sorted_draw_buffer",
+      WGPUBufferUsage_Storage | WGPUBufferUsage_Vertex,
+      capacity * ps->particle_size);
+  }
+
+  // All particles start on the dead list
+  const particle_system_state_t state = {
+    .dead_count = ps->capacity,
+  };
+  wgpuQueueWriteBuffer(wgpu_context->queue, ps->buffers.state, 0, &state,
+                       sizeof(state));
+  uint32_t* dead_list = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+  for (uint32_t i = 0; i < ps->capacity; ++i) {
+    dead_list[i] = i;
+  }
+  wgpuQueueWriteBuffer(wgpu_context->queue, ps->buffers.dead_list, 0,
+                       dead_list, capacity * sizeof(uint32_t));
+  free(dead_list);
+  const uint32_t args[12] = {0};
+  wgpuQueueWriteBuffer(wgpu_context->queue, ps->buffers.args, 0, args,
+                       sizeof(args));
+}
+
+static void particle_system_create_layouts(wgpu_particle_system_t* ps,
+                                           WGPUBindGroupLayout behavior_layout)
+{
+  WGPUDevice device = ps->wgpu_context->device;
+
+  // Group 0: parameters, state, particles, dead list, alive lists, draws and
+  // the sort buffers
+  const uint32_t binding_count = ps->depth_sort ?
+                                   PARTICLE_SYSTEM_SORT_BINDING_COUNT :
+                                   PARTICLE_SYSTEM_BINDING_COUNT;
+  WGPUBindGroupLayoutEntry bgl_entries[PARTICLE_SYSTEM_SORT_BINDING_COUNT]
+    = {0};
+  bgl_entries[0] = (WGPUBindGroupLayoutEntry){
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Compute,
+    .buffer = (WGPUBufferBindingLayout){
+      .type           = WGPUBufferBindingType_Uniform,
+      .minBindingSize = sizeof(particle_system_params_t),
+    },
+  };
+  for (uint32_t i = 1; i < binding_count; ++i) {
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type = WGPUBufferBindingType_Storage,
+      },
+    };
+  }
+  ps->system_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "particle_system_bind_group_layout",
+              .entryCount = binding_count,
+              .entries    = bgl_entries,
+            });
+  ASSERT(ps->system_bind_group_layout != NULL);
+
+  // Group 1 of the control kernels: indirect arguments
+  ps->control_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "particle_system_control_bind_group_layout",
+              .entryCount = 1,
+              .entries = &(WGPUBindGroupLayoutEntry){
+                .binding    = 0,
+                .visibility = WGPUShaderStage_Compute,
+                .buffer = (WGPUBufferBindingLayout){
+                  .type           = WGPUBufferBindingType_Storage,
+                  .minBindingSize = PARTICLE_SYSTEM_ARGS_SIZE,
+                },
+              },
+            });
+  ASSERT(ps->control_bind_group_layout != NULL);
+
+  WGPUBindGroupLayout control_layouts[2]
+    = {ps->system_bind_group_layout, ps->control_bind_group_layout};
+  ps->control_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .bindGroupLayoutCount = 2,
+              .bindGroupLayouts     = control_layouts,
+            });
+  ASSERT(ps->control_pipeline_layout != NULL);
+
+  // Behaviors without resources get an empty group 1, the control group is
+  // never left bound during the emission and update dispatches
+  if (behavior_layout == NULL) {
+    ps->empty_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+      device, &(WGPUBindGroupLayoutDescriptor){
+                .label = "particle_system_empty_bind_group_layout",
+              });
+    ASSERT(ps->empty_bind_group_layout != NULL);
+    behavior_layout = ps->empty_bind_group_layout;
+  }
+  WGPUBindGroupLayout behavior_layouts[2]
+    = {ps->system_bind_group_layout, behavior_layout};
+  ps->behavior_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .bindGroupLayoutCount = 2,
+              .bindGroupLayouts     = behavior_layouts,
+            });
+  ASSERT(ps->behavior_pipeline_layout != NULL);
+}
+
+static void particle_system_create_bind_groups(wgpu_particle_system_t* ps)
+{
+  WGPUDevice device = ps->wgpu_context->device;
+
+  const WGPUBuffer buffers[PARTICLE_SYSTEM_SORT_BINDING_COUNT] = {
+    ps->buffers.params,    ps->buffers.state,       ps->buffers.particles,
+    ps->buffers.dead_list, ps->buffers.alive_lists, ps->buffers.draws,
+    ps->buffers.sort_keys, ps->buffers.sort_values, ps->buffers.sorted_draws,
+  };
+  const uint32_t binding_count = ps->depth_sort ?
+                                   PARTICLE_SYSTEM_SORT_BINDING_COUNT :
+                                   PARTICLE_SYSTEM_BINDING_COUNT;
+  WGPUBindGroupEntry bg_entries[PARTICLE_SYSTEM_SORT_BINDING_COUNT] = {0};
+  for (uint32_t i = 0; i < binding_count; ++i) {
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding = i,
+      .buffer  = buffers[i],
+      .offset  = 0,
+      .size    = WGPU_WHOLE_SIZE,
+    };
+  }
+  ps->system_bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "particle_system_bind_group",
+              .layout     = ps->system_bind_group_layout,
+              .entryCount = binding_count,
+              .entries    = bg_entries,
+            });
+  ASSERT(ps->system_bind_group != NULL);
+
+  ps->control_bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "particle_system_control_bind_group",
+              .layout     = ps->control_bind_group_layout,
+              .entryCount = 1,
+              .entries = &(WGPUBindGroupEntry){
+                .binding = 0,
+                .buffer  = ps->buffers.args,
+                .offset  = 0,
+                .size    = PARTICLE_SYSTEM_ARGS_SIZE,
+              },
+            });
+  ASSERT(ps->control_bind_group != NULL);
+}
+
+static WGPUComputePipeline
+particle_system_create_pipeline(wgpu_context_t* wgpu_context,
+                                WGPUPipelineLayout layout, const char* source,
+                                const char* entry)
+{
+  // The entries of a source share the shader module of the shader cache
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "particle_system_shader",
+                    .wgsl_code.source = source,
+                    .entry            = entry,
+                  });
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "particle_system_pipeline",
+                    .layout  = layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&shader);
+  return pipeline;
+}
+
+/* Concatenates the WGSL sources into a new string */
+static char* particle_system_concat_wgsl(const char* const* sources,
+                                         uint32_t source_count)
+{
+  size_t length = 1;
+  for (uint32_t i = 0; i < source_count; ++i) {
+    length += strlen(sources[i]) + 1;
+  }
+  char* wgsl = (char*)malloc(length);
+  char* cur  = wgsl;
+  for (uint32_t i = 0; i < source_count; ++i) {
+    const size_t source_length = strlen(sources[i]);
+    memcpy(cur, sources[i], source_length);
+    cur += source_length;
+    *cur++ = '\n';
+  }
+  *cur = '\0';
+  return wgsl;
+}
+
+static void particle_system_create_pipelines(wgpu_particle_system_t* ps,
+                                             const char* behavior_wgsl)
+{
+  wgpu_context_t* wgpu_context = ps->wgpu_context;
+
+  char* control_wgsl = particle_system_concat_wgsl(
+    (const char*[]){particle_system_common_wgsl, particle_system_control_wgsl},
+    2);
+  ps->pipelines.prepare_emit = particle_system_create_pipeline(
+    wgpu_context, ps->control_pipeline_layout, control_wgsl, "prepare_emit");
+  ps->pipelines.prepare_update = particle_system_create_pipeline(
+    wgpu_context, ps->control_pipeline_layout, control_wgsl, "prepare_update");
+  ps->pipelines.finalize = particle_system_create_pipeline(
+    wgpu_context, ps->control_pipeline_layout, control_wgsl, "finalize");
+  free(control_wgsl);
+
+  char* kernels_wgsl = particle_system_concat_wgsl(
+    (const char*[]){particle_system_common_wgsl, behavior_wgsl,
+                    particle_system_kernels_wgsl, particle_system_sort_wgsl},
+    ps->depth_sort ? 4 : 3);
+  ps->pipelines.emit = particle_system_create_pipeline(
+    wgpu_context, ps->behavior_pipeline_layout, kernels_wgsl, "emit");
+  ps->pipelines.update = particle_system_create_pipeline(
+    wgpu_context, ps->behavior_pipeline_layout, kernels_wgsl, "update");
+  if (ps->depth_sort) {
+    ps->pipelines.write_sort_keys = particle_system_create_pipeline(
+      wgpu_context, ps->behavior_pipeline_layout, kernels_wgsl,
+      "write_sort_keys");
+    ps->pipelines.gather_sorted = particle_system_create_pipeline(
+      wgpu_context, ps->behavior_pipeline_layout, kernels_wgsl,
+      "gather_sorted");
+  }
+  free(kernels_wgsl);
+}
+
+wgpu_particle_system_t*
+wgpu_particle_system_create(wgpu_context_t* wgpu_context,
+                            const wgpu_particle_system_desc_t* desc)
+{
+  ASSERT(desc->capacity > 0
+         && desc->capacity
+              <= PARTICLE_SYSTEM_MAX_GROUPS
+                   * WGPU_PARTICLE_SYSTEM_WORKGROUP_SIZE);
+  ASSERT(desc->particle_size > 0 && desc->particle_size % 4 == 0);
+  ASSERT(desc->wgsl_code != NULL);
+  ASSERT((desc->bind_group_layout == NULL) == (desc->bind_group == NULL));
+
+  wgpu_particle_system_t* ps
+    = (wgpu_particle_system_t*)calloc(1, sizeof(*ps));
+  ps->wgpu_context  = wgpu_context;
+  ps->capacity      = desc->capacity;
+  ps->particle_size = desc->particle_size;
+  ps->vertex_count  = desc->vertex_count;
+  ps->seed          = (uint32_t)rand();
+  ps->depth_sort    = desc->depth_sort;
+  // View space z of the identity view until a view matrix is set
+  ps->view_depth[2] = 1.0f;
+
+  particle_system_create_buffers(ps);
+  particle_system_create_layouts(ps, desc->bind_group_layout);
+  particle_system_create_bind_groups(ps);
+  particle_system_create_pipelines(ps, desc->wgsl_code);
+  if (ps->depth_sort) {
+    ps->compute_primitives
+      = wgpu_compute_primitives_create(wgpu_context, ps->capacity);
+    ps->depth_sort_enabled = true;
+  }
+
+  if (desc->bind_group != NULL) {
+    wgpuBindGroupReference(desc->bind_group);
+    ps->behavior_bind_group = desc->bind_group;
+  }
+  else {
+    ps->behavior_bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label  = "particle_system_empty_bind_group",
+                              .layout = ps->empty_bind_group_layout,
+                            });
+    ASSERT(ps->behavior_bind_group != NULL);
+  }
+
+  return ps;
+}
+
+void wgpu_particle_system_destroy(wgpu_particle_system_t* ps)
+{
+  if (ps == NULL) {
+    return;
+  }
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.prepare_emit)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.emit)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.prepare_update)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.update)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.finalize)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.write_sort_keys)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines.gather_sorted)
+  wgpu_compute_primitives_destroy(ps->compute_primitives);
+  WGPU_RELEASE_RESOURCE(BindGroup, ps->system_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, ps->control_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, ps->behavior_bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ps->control_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ps->behavior_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->system_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->control_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->empty_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.params)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.state)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.particles)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.dead_list)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.alive_lists)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.draws)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.args)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.sort_keys)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.sort_values)
+  WGPU_RELEASE_RESOURCE(Buffer, ps->buffers.sorted_draws)
+  free(ps);
+}
+
+/* Sets the pipeline of a kernel together with its group 1 */
+static void particle_system_set_pipeline(WGPUComputePassEncoder pass_encoder,
+                                         WGPUComputePipeline pipeline,
+                                         WGPUBindGroup bind_group)
+{
+  wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 1, bind_group, 0, NULL);
+}
+
+/* Writes the keys in the update pass and ends it, sorts the keys in a pass of
+ * the compute primitives and gathers the sorted draws in a final pass */
+static void particle_system_record_depth_sort(wgpu_particle_system_t* ps,
+                                              WGPUCommandEncoder cmd_enc,
+                                              WGPUComputePassEncoder pass_enc)
+{
+  const uint32_t group_count
+    = (ps->capacity + WGPU_PARTICLE_SYSTEM_WORKGROUP_SIZE - 1)
+      / WGPU_PARTICLE_SYSTEM_WORKGROUP_SIZE;
+
+  particle_system_set_pipeline(pass_enc, ps->pipelines.write_sort_keys,
+                               ps->behavior_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_enc, group_count, 1, 1);
+  wgpu_pipeline_statistics_end_compute_pass(
+    ps->wgpu_context->pipeline_statistics, pass_enc);
+  wgpuComputePassEncoderEnd(pass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_enc)
+
+  wgpu_compute_radix_sort_bits(ps->compute_primitives, cmd_enc,
+                               ps->buffers.sort_keys, ps->buffers.sort_values,
+                               ps->capacity, PARTICLE_SYSTEM_SORT_KEY_BITS);
+
+  pass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "particle_system_gather_pass",
+             });
+  wgpuComputePassEncoderSetBindGroup(pass_enc, 0, ps->system_bind_group, 0,
+                                     NULL);
+  particle_system_set_pipeline(pass_enc, ps->pipelines.gather_sorted,
+                               ps->behavior_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_enc, group_count, 1, 1);
+  wgpuComputePassEncoderEnd(pass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_enc)
+}
+
+void wgpu_particle_system_update(wgpu_particle_system_t* ps,
+                                 WGPUCommandEncoder cmd_enc,
+                                 uint32_t emit_count)
+{
+  particle_system_params_t params = {
+    .capacity     = ps->capacity,
+    .emit_request = emit_count,
+    .vertex_count = ps->vertex_count,
+    .parity       = ps->parity,
+    .frame        = ps->frame,
+    .seed         = ps->seed,
+  };
+  memcpy(params.view_depth, ps->view_depth, sizeof(params.view_depth));
+  wgpuQueueWriteBuffer(ps->wgpu_context->queue, ps->buffers.params, 0,
+                       &params, sizeof(params));
+
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "particle_system_compute_pass",
+             });
+  wgpu_pipeline_statistics_begin_compute_pass(
+    ps->wgpu_context->pipeline_statistics, pass_encoder, "Particle update");
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, ps->system_bind_group, 0,
+                                     NULL);
+
+  // Emission from the dead list
+  particle_system_set_pipeline(pass_encoder, ps->pipelines.prepare_emit,
+                               ps->control_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, 1, 1, 1);
+  particle_system_set_pipeline(pass_encoder, ps->pipelines.emit,
+                               ps->behavior_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+    pass_encoder, ps->buffers.args, PARTICLE_SYSTEM_EMIT_ARGS_OFFSET);
+
+  // Update of the alive list into the next alive list and the draw buffer
+  particle_system_set_pipeline(pass_encoder, ps->pipelines.prepare_update,
+                               ps->control_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, 1, 1, 1);
+  particle_system_set_pipeline(pass_encoder, ps->pipelines.update,
+                               ps->behavior_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+    pass_encoder, ps->buffers.args, PARTICLE_SYSTEM_UPDATE_ARGS_OFFSET);
+
+  // Draw arguments of the survivors
+  particle_system_set_pipeline(pass_encoder, ps->pipelines.finalize,
+                               ps->control_bind_group);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, 1, 1, 1);
+
+  if (ps->depth_sort_enabled) {
+    particle_system_record_depth_sort(ps, cmd_enc, pass_encoder);
+  }
+  else {
+    wgpu_pipeline_statistics_end_compute_pass(
+      ps->wgpu_context->pipeline_statistics, pass_encoder);
+    wgpuComputePassEncoderEnd(pass_encoder);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+  }
+
+  ps->parity = 1u - ps->parity;
+  ++ps->frame;
+}
+
+void wgpu_particle_system_draw(wgpu_particle_system_t* ps,
+                               WGPURenderPassEncoder rpass_enc,
+                               uint32_t vertex_buffer_slot)
+{
+  WGPUBuffer draws
+    = ps->depth_sort_enabled ? ps->buffers.sorted_draws : ps->buffers.draws;
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, vertex_buffer_slot, draws, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderDrawIndirect(rpass_enc, ps->buffers.args,
+                                    PARTICLE_SYSTEM_DRAW_ARGS_OFFSET);
+}
+
+void wgpu_particle_system_set_depth_sort(wgpu_particle_system_t* ps,
+                                         bool enabled)
+{
+  ASSERT(ps->depth_sort || !enabled);
+  ps->depth_sort_enabled = enabled;
+}
+
+void wgpu_particle_system_set_view_matrix(wgpu_particle_system_t* ps,
+                                          mat4 view)
+{
+  // Third row of the column major matrix
+  for (uint32_t i = 0; i < 4; ++i) {
+    ps->view_depth[i] = view[i][2];
+  }
+}
+
+uint32_t wgpu_particle_system_get_capacity(wgpu_particle_system_t* ps)
+{
+  return ps->capacity;
+}
@@ -0,0 +1,110 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* Threads per workgroup of the particle kernels */
+#define WGPU_PARTICLE_SYSTEM_WORKGROUP_SIZE 64u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU particle system
+ *
+ * GPU particle pool with a fixed capacity. Free particles are kept on a dead
+ * list, living particles on an alive list, both are maintained with atomic
+ * counters on the GPU. A frame records one compute pass:
+ *
+ *   - emit: takes up to emit_count particles from the dead list and
+ *     initializes them
+ *   - update: simulates the living particles, particles which die are pushed
+ *     back onto the dead list, survivors are appended to the next alive list
+ *     and copied to the draw buffer
+ *
+ * The emission and update dispatches are sized by the GPU counters with
+ * indirect dispatches, wgpu_particle_system_draw() draws the live particles
+ * of the draw buffer with an indirect draw, nothing is read back.
+ *
+ * The behavior is WGSL code defining the particle and two functions:
+ *
+ *   struct Particle { ... }
+ *   fn particle_emit(index : u32) -> Particle
+ *   fn particle_update(particle : ptr<function, Particle>) -> bool
+ *
+ * particle_emit() is called with the emission index within the frame,
+ * particle_update() returns false when the particle dies. The behavior can use
+ * the particle_system uniform (capacity, frame, ...) and particle_random(), its
+ * own resources are bound to group 1.
+ *
+ * The draw buffer holds the Particle structs of the live particles and is
+ * bound as vertex buffer, one vertex per particle or one instance of
+ * vertex_count vertices per particle. The vertex attributes follow the WGSL
+ * layout of the Particle struct.
+ *
+ * Depth sorting orders the draw buffer back to front for alpha blending. The
+ * behavior then also defines
+ *
+ *   fn particle_position(particle : Particle) -> vec3<f32>
+ *
+ * and the view matrix is set per frame. After the update the view depths of the
+ * live particles are radix sorted with the compute primitives, by the upper 24
+ * bits of the float depth, and the particles are gathered into the draw buffer
+ * in that order. The sort covers the whole capacity, the slots past the live
+ * particles sort to the end.
+ *
+ * The uniforms of a frame are written with a queue write when the update is
+ * recorded, one update can be recorded per submit.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_particle_system wgpu_particle_system_t;
+
+typedef struct wgpu_particle_system_desc_t {
+  const char* label;
+  /* Maximum number of living particles */
+  uint32_t capacity;
+  /* Size of the WGSL Particle struct, the vertex stride of the draw buffer */
+  uint32_t particle_size;
+  /* Vertices per particle instance, 0 = a vertex per particle */
+  uint32_t vertex_count;
+  /* WGSL behavior of the particles, see above */
+  const char* wgsl_code;
+  /* Group 1 of the behavior with compute visibility, NULL = no resources */
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+  /* Creates the depth sort resources and enables the sort */
+  bool depth_sort;
+} wgpu_particle_system_desc_t;
+
+/* Particle system creating / destroying */
+wgpu_particle_system_t*
+wgpu_particle_system_create(wgpu_context_t* wgpu_context,
+                            const wgpu_particle_system_desc_t* desc);
+void wgpu_particle_system_destroy(wgpu_particle_system_t* particle_system);
+
+/**
+ * @brief Records the emission of up to emit_count particles and the update of
+ * the living particles. Requests above the number of dead particles are
+ * clamped.
+ */
+void wgpu_particle_system_update(wgpu_particle_system_t* particle_system,
+                                 WGPUCommandEncoder cmd_enc,
+                                 uint32_t emit_count);
+
+/**
+ * @brief Binds the draw buffer to the vertex buffer slot and draws the live
+ * particles, the pipeline and bind groups are set by the caller.
+ */
+void wgpu_particle_system_draw(wgpu_particle_system_t* particle_system,
+                               WGPURenderPassEncoder rpass_enc,
+                               uint32_t vertex_buffer_slot);
+
+/* Depth sort of the draw buffer, for systems created with depth_sort */
+void wgpu_particle_system_set_depth_sort(
+  wgpu_particle_system_t* particle_system, bool enabled);
+void wgpu_particle_system_set_view_matrix(
+  wgpu_particle_system_t* particle_system, mat4 view);
+
+uint32_t wgpu_particle_system_get_capacity(
+  wgpu_particle_system_t* particle_system);
+
+#endif /* PARTICLE_SYSTEM_H */
@@ -0,0 +1,1017 @@
+#include "pipeline_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/trace.h"
+
+#define PIPELINE_CACHE_INITIAL_CAPACITY 32u
+
+/* -------------------------------------------------------------------------- *
+ * Pipeline keys
+ * -------------------------------------------------------------------------- */
+
+typedef enum pipeline_type_t {
+  PipelineType_Render  = 0,
+  PipelineType_Compute = 1,
+} pipeline_type_t;
+
+/* Serialized pipeline descriptor */
+typedef struct pipeline_key_t {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+} pipeline_key_t;
+
+static void pipeline_key_write(pipeline_key_t* key, const void* data,
+                               size_t size)
+{
+  if (key->size + size > key->capacity) {
+    key->capacity = MAX(key->capacity * 2, key->size + size);
+    key->data     = (uint8_t*)realloc(key->data, key->capacity);
+  }
+  memcpy(key->data + key->size, data, size);
+  key->size += size;
+}
+
+static void pipeline_key_write_u32(pipeline_key_t* key, uint32_t value)
+{
+  pipeline_key_write(key, &value, sizeof(value));
+}
+
+static void pipeline_key_write_u64(pipeline_key_t* key, uint64_t value)
+{
+  pipeline_key_write(key, &value, sizeof(value));
+}
+
+static void pipeline_key_write_handle(pipeline_key_t* key, const void* handle)
+{
+  pipeline_key_write_u64(key, (uint64_t)(uintptr_t)handle);
+}
+
+static void pipeline_key_write_string(pipeline_key_t* key, const char* str)
+{
+  if (str == NULL) {
+    pipeline_key_write_u32(key, UINT32_MAX);
+    return;
+  }
+  const uint32_t length = (uint32_t)strlen(str);
+  pipeline_key_write_u32(key, length);
+  pipeline_key_write(key, str, length);
+}
+
+static void pipeline_key_write_constants(pipeline_key_t* key,
+                                         uint32_t constant_count,
+                                         const WGPUConstantEntry* constants)
+{
+  pipeline_key_write_u32(key, constant_count);
+  for (uint32_t i = 0; i < constant_count; ++i) {
+    pipeline_key_write_string(key, constants[i].key);
+    pipeline_key_write(key, &constants[i].value, sizeof(constants[i].value));
+  }
+}
+
+static void pipeline_key_write_stencil_face(pipeline_key_t* key,
+                                            const WGPUStencilFaceState* face)
+{
+  pipeline_key_write_u32(key, (uint32_t)face->compare);
+  pipeline_key_write_u32(key, (uint32_t)face->failOp);
+  pipeline_key_write_u32(key, (uint32_t)face->depthFailOp);
+  pipeline_key_write_u32(key, (uint32_t)face->passOp);
+}
+
+static void pipeline_key_write_blend_component(pipeline_key_t* key,
+                                               const WGPUBlendComponent* c)
+{
+  pipeline_key_write_u32(key, (uint32_t)c->operation);
+  pipeline_key_write_u32(key, (uint32_t)c->srcFactor);
+  pipeline_key_write_u32(key, (uint32_t)c->dstFactor);
+}
+
+/**
+ * @brief Serializes a render pipeline descriptor.
+ * @return false if the descriptor uses chained structs, it is not cached then
+ */
+static bool pipeline_key_write_render(pipeline_key_t* key,
+                                      const WGPURenderPipelineDescriptor* desc)
+{
+  const WGPUVertexState* vertex           = &desc->vertex;
+  const WGPUPrimitiveState* primitive     = &desc->primitive;
+  const WGPUDepthStencilState* depth      = desc->depthStencil;
+  const WGPUMultisampleState* multisample = &desc->multisample;
+  const WGPUFragmentState* fragment       = desc->fragment;
+  if (desc->nextInChain || vertex->nextInChain || primitive->nextInChain
+      || multisample->nextInChain || (depth && depth->nextInChain)
+      || (fragment && fragment->nextInChain)) {
+    return false;
+  }
+
+  pipeline_key_write_u32(key, PipelineType_Render);
+  pipeline_key_write_handle(key, desc->layout);
+
+  // Vertex state
+  pipeline_key_write_handle(key, vertex->module);
+  pipeline_key_write_string(key, vertex->entryPoint);
+  pipeline_key_write_constants(key, vertex->constantCount, vertex->constants);
+  pipeline_key_write_u32(key, vertex->bufferCount);
+  for (uint32_t i = 0; i < vertex->bufferCount; ++i) {
+    const WGPUVertexBufferLayout* buffer = &vertex->buffers[i];
+    pipeline_key_write_u64(key, buffer->arrayStride);
+    pipeline_key_write_u32(key, (uint32_t)buffer->stepMode);
+    pipeline_key_write_u32(key, buffer->attributeCount);
+    for (uint32_t a = 0; a < buffer->attributeCount; ++a) {
+      const WGPUVertexAttribute* attribute = &buffer->attributes[a];
+      pipeline_key_write_u32(key, (uint32_t)attribute->format);
+      pipeline_key_write_u64(key, attribute->offset);
+      pipeline_key_write_u32(key, attribute->shaderLocation);
+    }
+  }
+
+  // Primitive state
+  pipeline_key_write_u32(key, (uint32_t)primitive->topology);
+  pipeline_key_write_u32(key, (uint32_t)primitive->stripIndexFormat);
+  pipeline_key_write_u32(key, (uint32_t)primitive->frontFace);
+  pipeline_key_write_u32(key, (uint32_t)primitive->cullMode);
+
+  // Depth stencil state
+  pipeline_key_write_u32(key, depth != NULL);
+  if (depth != NULL) {
+    pipeline_key_write_u32(key, (uint32_t)depth->format);
+    pipeline_key_write_u32(key, depth->depthWriteEnabled);
+    pipeline_key_write_u32(key, (uint32_t)depth->depthCompare);
+    pipeline_key_write_stencil_face(key, &depth->stencilFront);
+    pipeline_key_write_stencil_face(key, &depth->stencilBack);
+    pipeline_key_write_u32(key, depth->stencilReadMask);
+    pipeline_key_write_u32(key, depth->stencilWriteMask);
+    pipeline_key_write(key, &depth->depthBias, sizeof(depth->depthBias));
+    pipeline_key_write(key, &depth->depthBiasSlopeScale,
+                       sizeof(depth->depthBiasSlopeScale));
+    pipeline_key_write(key, &depth->depthBiasClamp,
+                       sizeof(depth->depthBiasClamp));
+  }
+
+  // Multisample state
+  pipeline_key_write_u32(key, multisample->count);
+  pipeline_key_write_u32(key, multisample->mask);
+  pipeline_key_write_u32(key, multisample->alphaToCoverageEnabled);
+
+  // Fragment state
+  pipeline_key_write_u32(key, fragment != NULL);
+  if (fragment != NULL) {
+    pipeline_key_write_handle(key, fragment->module);
+    pipeline_key_write_string(key, fragment->entryPoint);
+    pipeline_key_write_constants(key, fragment->constantCount,
+                                 fragment->constants);
+    pipeline_key_write_u32(key, fragment->targetCount);
+    for (uint32_t i = 0; i < fragment->targetCount; ++i) {
+      const WGPUColorTargetState* target = &fragment->targets[i];
+      if (target->nextInChain) {
+        return false;
+      }
+      pipeline_key_write_u32(key, (uint32_t)target->format);
+      pipeline_key_write_u32(key, (uint32_t)target->writeMask);
+      pipeline_key_write_u32(key, target->blend != NULL);
+      if (target->blend != NULL) {
+        pipeline_key_write_blend_component(key, &target->blend->color);
+        pipeline_key_write_blend_component(key, &target->blend->alpha);
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool
+pipeline_key_write_compute(pipeline_key_t* key,
+                           const WGPUComputePipelineDescriptor* desc)
+{
+  const WGPUProgrammableStageDescriptor* compute = &desc->compute;
+  if (desc->nextInChain || compute->nextInChain) {
+    return false;
+  }
+
+  pipeline_key_write_u32(key, PipelineType_Compute);
+  pipeline_key_write_handle(key, desc->layout);
+  pipeline_key_write_handle(key, compute->module);
+  pipeline_key_write_string(key, compute->entryPoint);
+  pipeline_key_write_constants(key, compute->constantCount,
+                               compute->constants);
+
+  return true;
+}
+
+static uint64_t pipeline_key_hash(const pipeline_key_t* key)
+{
+  /* 64-bit FNV-1a */
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < key->size; ++i) {
+    hash = (hash ^ key->data[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Pipeline key decoding
+ *
+ * Rebuilds the descriptor of a cached pipeline, used to recreate the pipeline
+ * with a reloaded shader module.
+ * -------------------------------------------------------------------------- */
+
+typedef struct pipeline_key_reader_t {
+  const pipeline_key_t* key;
+  size_t offset;
+  /* Shader module handles replaced while decoding */
+  WGPUShaderModule previous_module;
+  WGPUShaderModule module;
+  /* Arrays and strings of the decoded descriptor */
+  void** allocations;
+  uint32_t allocation_count;
+} pipeline_key_reader_t;
+
+static void* pipeline_key_reader_alloc(pipeline_key_reader_t* reader,
+                                       size_t size)
+{
+  reader->allocations = (void**)realloc(
+    reader->allocations, (reader->allocation_count + 1) * sizeof(void*));
+  void* data = calloc(1, MAX(size, 1));
+  reader->allocations[reader->allocation_count++] = data;
+  return data;
+}
+
+static void pipeline_key_reader_release(pipeline_key_reader_t* reader)
+{
+  for (uint32_t i = 0; i < reader->allocation_count; ++i) {
+    free(reader->allocations[i]);
+  }
+  free(reader->allocations);
+}
+
+static void pipeline_key_read(pipeline_key_reader_t* reader, void* data,
+                              size_t size)
+{
+  ASSERT(reader->offset + size <= reader->key->size);
+  memcpy(data, reader->key->data + reader->offset, size);
+  reader->offset += size;
+}
+
+static uint32_t pipeline_key_read_u32(pipeline_key_reader_t* reader)
+{
+  uint32_t value = 0;
+  pipeline_key_read(reader, &value, sizeof(value));
+  return value;
+}
+
+static uint64_t pipeline_key_read_u64(pipeline_key_reader_t* reader)
+{
+  uint64_t value = 0;
+  pipeline_key_read(reader, &value, sizeof(value));
+  return value;
+}
+
+static void* pipeline_key_read_handle(pipeline_key_reader_t* reader)
+{
+  return (void*)(uintptr_t)pipeline_key_read_u64(reader);
+}
+
+static WGPUShaderModule pipeline_key_read_module(pipeline_key_reader_t* reader)
+{
+  WGPUShaderModule module = (WGPUShaderModule)pipeline_key_read_handle(reader);
+  return (module == reader->previous_module) ? reader->module : module;
+}
+
+static const char* pipeline_key_read_string(pipeline_key_reader_t* reader)
+{
+  const uint32_t length = pipeline_key_read_u32(reader);
+  if (length == UINT32_MAX) {
+    return NULL;
+  }
+  char* str = (char*)pipeline_key_reader_alloc(reader, length + 1);
+  pipeline_key_read(reader, str, length);
+  return str;
+}
+
+static const WGPUConstantEntry*
+pipeline_key_read_constants(pipeline_key_reader_t* reader,
+                            uint32_t* constant_count)
+{
+  *constant_count = pipeline_key_read_u32(reader);
+  if (*constant_count == 0) {
+    return NULL;
+  }
+  WGPUConstantEntry* constants = (WGPUConstantEntry*)pipeline_key_reader_alloc(
+    reader, *constant_count * sizeof(WGPUConstantEntry));
+  for (uint32_t i = 0; i < *constant_count; ++i) {
+    constants[i].key = pipeline_key_read_string(reader);
+    pipeline_key_read(reader, &constants[i].value, sizeof(constants[i].value));
+  }
+  return constants;
+}
+
+static void pipeline_key_read_stencil_face(pipeline_key_reader_t* reader,
+                                           WGPUStencilFaceState* face)
+{
+  face->compare     = (WGPUCompareFunction)pipeline_key_read_u32(reader);
+  face->failOp      = (WGPUStencilOperation)pipeline_key_read_u32(reader);
+  face->depthFailOp = (WGPUStencilOperation)pipeline_key_read_u32(reader);
+  face->passOp      = (WGPUStencilOperation)pipeline_key_read_u32(reader);
+}
+
+static void pipeline_key_read_blend_component(pipeline_key_reader_t* reader,
+                                              WGPUBlendComponent* c)
+{
+  c->operation = (WGPUBlendOperation)pipeline_key_read_u32(reader);
+  c->srcFactor = (WGPUBlendFactor)pipeline_key_read_u32(reader);
+  c->dstFactor = (WGPUBlendFactor)pipeline_key_read_u32(reader);
+}
+
+/* Inverse of pipeline_key_write_render(), labels are not restored */
+static void pipeline_key_read_render(pipeline_key_reader_t* reader,
+                                     WGPURenderPipelineDescriptor* desc)
+{
+  memset(desc, 0, sizeof(*desc));
+  pipeline_key_read_u32(reader); // PipelineType_Render
+  desc->layout = (WGPUPipelineLayout)pipeline_key_read_handle(reader);
+
+  // Vertex state
+  WGPUVertexState* vertex = &desc->vertex;
+  vertex->module          = pipeline_key_read_module(reader);
+  vertex->entryPoint      = pipeline_key_read_string(reader);
+  vertex->constants
+    = pipeline_key_read_constants(reader, &vertex->constantCount);
+  vertex->bufferCount             = pipeline_key_read_u32(reader);
+  WGPUVertexBufferLayout* buffers = pipeline_key_reader_alloc(
+    reader, vertex->bufferCount * sizeof(WGPUVertexBufferLayout));
+  for (uint32_t i = 0; i < vertex->bufferCount; ++i) {
+    WGPUVertexBufferLayout* buffer = &buffers[i];
+    buffer->arrayStride            = pipeline_key_read_u64(reader);
+    buffer->stepMode       = (WGPUVertexStepMode)pipeline_key_read_u32(reader);
+    buffer->attributeCount = pipeline_key_read_u32(reader);
+    WGPUVertexAttribute* attributes = pipeline_key_reader_alloc(
+      reader, buffer->attributeCount * sizeof(WGPUVertexAttribute));
+    for (uint32_t a = 0; a < buffer->attributeCount; ++a) {
+      attributes[a].format = (WGPUVertexFormat)pipeline_key_read_u32(reader);
+      attributes[a].offset = pipeline_key_read_u64(reader);
+      attributes[a].shaderLocation = pipeline_key_read_u32(reader);
+    }
+    buffer->attributes = attributes;
+  }
+  vertex->buffers = buffers;
+
+  // Primitive state
+  WGPUPrimitiveState* primitive = &desc->primitive;
+  primitive->topology = (WGPUPrimitiveTopology)pipeline_key_read_u32(reader);
+  primitive->stripIndexFormat = (WGPUIndexFormat)pipeline_key_read_u32(reader);
+  primitive->frontFace        = (WGPUFrontFace)pipeline_key_read_u32(reader);
+  primitive->cullMode         = (WGPUCullMode)pipeline_key_read_u32(reader);
+
+  // Depth stencil state
+  if (pipeline_key_read_u32(reader)) {
+    WGPUDepthStencilState* depth
+      = pipeline_key_reader_alloc(reader, sizeof(WGPUDepthStencilState));
+    depth->format = (WGPUTextureFormat)pipeline_key_read_u32(reader);
+    depth->depthWriteEnabled = pipeline_key_read_u32(reader) != 0;
+    depth->depthCompare = (WGPUCompareFunction)pipeline_key_read_u32(reader);
+    pipeline_key_read_stencil_face(reader, &depth->stencilFront);
+    pipeline_key_read_stencil_face(reader, &depth->stencilBack);
+    depth->stencilReadMask  = pipeline_key_read_u32(reader);
+    depth->stencilWriteMask = pipeline_key_read_u32(reader);
+    pipeline_key_read(reader, &depth->depthBias, sizeof(depth->depthBias));
+    pipeline_key_read(reader, &depth->depthBiasSlopeScale,
+                      sizeof(depth->depthBiasSlopeScale));
+    pipeline_key_read(reader, &depth->depthBiasClamp,
+                      sizeof(depth->depthBiasClamp));
+    desc->depthStencil = depth;
+  }
+
+  // Multisample state
+  desc->multisample.count                  = pipeline_key_read_u32(reader);
+  desc->multisample.mask                   = pipeline_key_read_u32(reader);
+  desc->multisample.alphaToCoverageEnabled = pipeline_key_read_u32(reader) != 0;
+
+  // Fragment state
+  if (pipeline_key_read_u32(reader)) {
+    WGPUFragmentState* fragment
+      = pipeline_key_reader_alloc(reader, sizeof(WGPUFragmentState));
+    fragment->module     = pipeline_key_read_module(reader);
+    fragment->entryPoint = pipeline_key_read_string(reader);
+    fragment->constants
+      = pipeline_key_read_constants(reader, &fragment->constantCount);
+    fragment->targetCount         = pipeline_key_read_u32(reader);
+    WGPUColorTargetState* targets = pipeline_key_reader_alloc(
+      reader, fragment->targetCount * sizeof(WGPUColorTargetState));
+    for (uint32_t i = 0; i < fragment->targetCount; ++i) {
+      targets[i].format    = (WGPUTextureFormat)pipeline_key_read_u32(reader);
+      targets[i].writeMask = pipeline_key_read_u32(reader);
+      if (pipeline_key_read_u32(reader)) {
+        WGPUBlendState* blend
+          = pipeline_key_reader_alloc(reader, sizeof(WGPUBlendState));
+        pipeline_key_read_blend_component(reader, &blend->color);
+        pipeline_key_read_blend_component(reader, &blend->alpha);
+        targets[i].blend = blend;
+      }
+    }
+    fragment->targets = targets;
+    desc->fragment    = fragment;
+  }
+}
+
+/* Inverse of pipeline_key_write_compute(), labels are not restored */
+static void pipeline_key_read_compute(pipeline_key_reader_t* reader,
+                                      WGPUComputePipelineDescriptor* desc)
+{
+  memset(desc, 0, sizeof(*desc));
+  pipeline_key_read_u32(reader); // PipelineType_Compute
+  desc->layout = (WGPUPipelineLayout)pipeline_key_read_handle(reader);
+  WGPUProgrammableStageDescriptor* compute = &desc->compute;
+  compute->module                          = pipeline_key_read_module(reader);
+  compute->entryPoint = pipeline_key_read_string(reader);
+  compute->constants
+    = pipeline_key_read_constants(reader, &compute->constantCount);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Pipeline cache
+ * -------------------------------------------------------------------------- */
+
+/* Handles referenced by a pipeline key, the cache keeps a reference on them
+ * so that a released module or layout can not be replaced by a new object at
+ * the same address */
+typedef struct pipeline_key_handles_t {
+  WGPUPipelineLayout layout;
+  WGPUShaderModule modules[2];
+} pipeline_key_handles_t;
+
+/* Caller storage of a pipeline created asynchronously, updated when the
+ * pipeline is recreated after a shader reload */
+typedef struct pipeline_slot_t {
+  void** target;
+  wgpu_pipeline_ready_callback_t callback;
+  void* user_data;
+} pipeline_slot_t;
+
+typedef struct pipeline_cache_entry_t {
+  uint64_t hash;
+  pipeline_key_t key;
+  pipeline_type_t type;
+  void* pipeline; /* WGPURenderPipeline or WGPUComputePipeline */
+  pipeline_key_handles_t handles;
+  pipeline_slot_t* slots; /* tracked if shader hot reload is enabled */
+  uint32_t slot_count;
+} pipeline_cache_entry_t;
+
+struct wgpu_pipeline_cache {
+  WGPUDevice device;
+  pipeline_cache_entry_t* entries;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t pending_count; /* asynchronous creations in flight */
+};
+
+static void pipeline_reference(pipeline_type_t type, void* pipeline)
+{
+  if (type == PipelineType_Render) {
+    wgpuRenderPipelineReference((WGPURenderPipeline)pipeline);
+  }
+  else {
+    wgpuComputePipelineReference((WGPUComputePipeline)pipeline);
+  }
+}
+
+static void pipeline_release(pipeline_type_t type, void* pipeline)
+{
+  if (type == PipelineType_Render) {
+    wgpuRenderPipelineRelease((WGPURenderPipeline)pipeline);
+  }
+  else {
+    wgpuComputePipelineRelease((WGPUComputePipeline)pipeline);
+  }
+}
+
+static pipeline_key_handles_t
+pipeline_key_handles_reference(WGPUPipelineLayout layout,
+                               WGPUShaderModule module0,
+                               WGPUShaderModule module1)
+{
+  pipeline_key_handles_t handles = {
+    .layout  = layout,
+    .modules = {module0, module1},
+  };
+  if (handles.layout != NULL) {
+    wgpuPipelineLayoutReference(handles.layout);
+  }
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(handles.modules); ++i) {
+    if (handles.modules[i] != NULL) {
+      wgpuShaderModuleReference(handles.modules[i]);
+    }
+  }
+  return handles;
+}
+
+static void pipeline_key_handles_release(pipeline_key_handles_t* handles)
+{
+  WGPU_RELEASE_RESOURCE(PipelineLayout, handles->layout)
+  WGPU_RELEASE_RESOURCE(ShaderModule, handles->modules[0])
+  WGPU_RELEASE_RESOURCE(ShaderModule, handles->modules[1])
+}
+
+static wgpu_pipeline_cache_t* pipeline_cache_get(wgpu_context_t* wgpu_context)
+{
+  wgpu_pipeline_cache_t* cache = wgpu_context->pipeline_cache;
+  if (cache != NULL && cache->device != wgpu_context->device) {
+    // Pipelines of another device can not be shared
+    wgpu_pipeline_cache_release(cache);
+    cache = NULL;
+  }
+  if (cache == NULL) {
+    cache         = (wgpu_pipeline_cache_t*)calloc(1, sizeof(*cache));
+    cache->device = wgpu_context->device;
+  }
+  wgpu_context->pipeline_cache = cache;
+  return cache;
+}
+
+static pipeline_cache_entry_t* pipeline_cache_find(wgpu_pipeline_cache_t* cache,
+                                                   const pipeline_key_t* key,
+                                                   uint64_t hash)
+{
+  for (uint32_t i = 0; i < cache->count; ++i) {
+    pipeline_cache_entry_t* entry = &cache->entries[i];
+    if (entry->hash == hash && entry->key.size == key->size
+        && memcmp(entry->key.data, key->data, key->size) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* The entry takes over the key data, the handle references and the pipeline
+ * reference */
+static pipeline_cache_entry_t*
+pipeline_cache_insert(wgpu_pipeline_cache_t* cache, pipeline_key_t* key,
+                      uint64_t hash, pipeline_type_t type, void* pipeline,
+                      const pipeline_key_handles_t* handles)
+{
+  if (cache->count == cache->capacity) {
+    cache->capacity = cache->capacity ? cache->capacity * 2 :
+                                        PIPELINE_CACHE_INITIAL_CAPACITY;
+    cache->entries  = (pipeline_cache_entry_t*)realloc(
+      cache->entries, cache->capacity * sizeof(pipeline_cache_entry_t));
+  }
+  cache->entries[cache->count++] = (pipeline_cache_entry_t){
+    .hash     = hash,
+    .key      = *key,
+    .type     = type,
+    .pipeline = pipeline,
+    .handles  = *handles,
+  };
+  *key = (pipeline_key_t){0};
+  return &cache->entries[cache->count - 1];
+}
+
+static void
+pipeline_cache_entry_add_slot(pipeline_cache_entry_t* entry, void** target,
+                              wgpu_pipeline_ready_callback_t callback,
+                              void* user_data)
+{
+  for (uint32_t i = 0; i < entry->slot_count; ++i) {
+    if (entry->slots[i].target == target) {
+      entry->slots[i].callback  = callback;
+      entry->slots[i].user_data = user_data;
+      return;
+    }
+  }
+  entry->slots = (pipeline_slot_t*)realloc(
+    entry->slots, (entry->slot_count + 1) * sizeof(pipeline_slot_t));
+  entry->slots[entry->slot_count++] = (pipeline_slot_t){
+    .target    = target,
+    .callback  = callback,
+    .user_data = user_data,
+  };
+}
+
+static void wait_for_pending_pipelines(wgpu_pipeline_cache_t* cache)
+{
+  while (cache->pending_count > 0) {
+    wgpuDeviceTick(cache->device);
+  }
+}
+
+void wgpu_pipeline_cache_release(wgpu_pipeline_cache_t* pipeline_cache)
+{
+  if (pipeline_cache == NULL) {
+    return;
+  }
+  // Creation callbacks reference the cache
+  wait_for_pending_pipelines(pipeline_cache);
+  for (uint32_t i = 0; i < pipeline_cache->count; ++i) {
+    pipeline_cache_entry_t* entry = &pipeline_cache->entries[i];
+    pipeline_release(entry->type, entry->pipeline);
+    pipeline_key_handles_release(&entry->handles);
+    free(entry->key.data);
+    free(entry->slots);
+  }
+  free(pipeline_cache->entries);
+  free(pipeline_cache);
+}
+
+/**
+ * @brief Looks up the entry with the given key and takes a new reference on its
+ * pipeline for the caller. The key data is freed on a hit.
+ * @return the entry or NULL if there is none
+ */
+static pipeline_cache_entry_t*
+pipeline_cache_acquire(wgpu_pipeline_cache_t* cache, pipeline_key_t* key,
+                       uint64_t hash)
+{
+  pipeline_cache_entry_t* entry = pipeline_cache_find(cache, key, hash);
+  if (entry == NULL) {
+    return NULL;
+  }
+  free(key->data);
+  *key = (pipeline_key_t){0};
+  pipeline_reference(entry->type, entry->pipeline);
+  return entry;
+}
+
+WGPURenderPipeline
+wgpu_create_render_pipeline(wgpu_context_t* wgpu_context,
+                            const WGPURenderPipelineDescriptor* descriptor)
+{
+  pipeline_key_t key = {0};
+  if (!pipeline_key_write_render(&key, descriptor)) {
+    free(key.data);
+    return wgpuDeviceCreateRenderPipeline(wgpu_context->device, descriptor);
+  }
+
+  wgpu_pipeline_cache_t* cache  = pipeline_cache_get(wgpu_context);
+  const uint64_t hash           = pipeline_key_hash(&key);
+  pipeline_cache_entry_t* entry = pipeline_cache_acquire(cache, &key, hash);
+  if (entry != NULL) {
+    return (WGPURenderPipeline)entry->pipeline;
+  }
+
+  const uint64_t trace_ns = trace_begin();
+  WGPURenderPipeline pipeline
+    = wgpuDeviceCreateRenderPipeline(wgpu_context->device, descriptor);
+  trace_end("create_render_pipeline", trace_ns);
+  if (pipeline == NULL) {
+    free(key.data);
+    return NULL;
+  }
+  const pipeline_key_handles_t handles = pipeline_key_handles_reference(
+    descriptor->layout, descriptor->vertex.module,
+    descriptor->fragment ? descriptor->fragment->module : NULL);
+  wgpuRenderPipelineReference(pipeline);
+  pipeline_cache_insert(cache, &key, hash, PipelineType_Render, pipeline,
+                        &handles);
+  return pipeline;
+}
+
+WGPUComputePipeline
+wgpu_create_compute_pipeline(wgpu_context_t* wgpu_context,
+                             const WGPUComputePipelineDescriptor* descriptor)
+{
+  pipeline_key_t key = {0};
+  if (!pipeline_key_write_compute(&key, descriptor)) {
+    free(key.data);
+    return wgpuDeviceCreateComputePipeline(wgpu_context->device, descriptor);
+  }
+
+  wgpu_pipeline_cache_t* cache  = pipeline_cache_get(wgpu_context);
+  const uint64_t hash           = pipeline_key_hash(&key);
+  pipeline_cache_entry_t* entry = pipeline_cache_acquire(cache, &key, hash);
+  if (entry != NULL) {
+    return (WGPUComputePipeline)entry->pipeline;
+  }
+
+  const uint64_t trace_ns = trace_begin();
+  WGPUComputePipeline pipeline
+    = wgpuDeviceCreateComputePipeline(wgpu_context->device, descriptor);
+  trace_end("create_compute_pipeline", trace_ns);
+  if (pipeline == NULL) {
+    free(key.data);
+    return NULL;
+  }
+  const pipeline_key_handles_t handles = pipeline_key_handles_reference(
+    descriptor->layout, descriptor->compute.module, NULL);
+  wgpuComputePipelineReference(pipeline);
+  pipeline_cache_insert(cache, &key, hash, PipelineType_Compute, pipeline,
+                        &handles);
+  return pipeline;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Asynchronous pipeline creation
+ * -------------------------------------------------------------------------- */
+
+/* Entry index of requests creating a new pipeline */
+#define PIPELINE_REQUEST_NEW_ENTRY UINT32_MAX
+
+typedef struct pipeline_request_t {
+  wgpu_pipeline_cache_t* cache;
+  pipeline_type_t type;
+  bool cached;     /* false for descriptors with chained structs */
+  bool reloadable; /* the target is tracked for shader hot reload */
+  uint32_t entry;  /* entry recreated after a shader reload */
+  pipeline_key_t key;
+  uint64_t hash;
+  pipeline_key_handles_t handles;
+  void** target; /* WGPURenderPipeline* or WGPUComputePipeline* */
+  wgpu_pipeline_ready_callback_t callback;
+  void* user_data;
+} pipeline_request_t;
+
+/**
+ * @brief Starts an asynchronous creation. Returns NULL if the pipeline was
+ * found in the cache, the target and callback are processed then.
+ */
+static pipeline_request_t*
+pipeline_request_create(wgpu_context_t* wgpu_context, pipeline_type_t type,
+                        pipeline_key_t* key, bool cached, void** target,
+                        wgpu_pipeline_ready_callback_t callback,
+                        void* user_data)
+{
+  wgpu_pipeline_cache_t* cache = pipeline_cache_get(wgpu_context);
+  const uint64_t hash          = cached ? pipeline_key_hash(key) : 0;
+  const bool reloadable        = cached && wgpu_context->shader_watch != NULL;
+  pipeline_cache_entry_t* entry
+    = cached ? pipeline_cache_acquire(cache, key, hash) : NULL;
+  if (entry != NULL) {
+    *target = entry->pipeline;
+    if (reloadable) {
+      pipeline_cache_entry_add_slot(entry, target, callback, user_data);
+    }
+    if (callback != NULL) {
+      callback(user_data);
+    }
+    return NULL;
+  }
+  *target = NULL;
+  if (!cached) {
+    free(key->data);
+    *key = (pipeline_key_t){0};
+  }
+
+  pipeline_request_t* request = calloc(1, sizeof(pipeline_request_t));
+  *request                    = (pipeline_request_t){
+    .cache      = cache,
+    .type       = type,
+    .cached     = cached,
+    .reloadable = reloadable,
+    .entry      = PIPELINE_REQUEST_NEW_ENTRY,
+    .key        = *key,
+    .hash       = hash,
+    .target     = target,
+    .callback   = callback,
+    .user_data  = user_data,
+  };
+  *key = (pipeline_key_t){0};
+  ++cache->pending_count;
+  return request;
+}
+
+/* Stores a new pipeline into the target of the caller */
+static void pipeline_request_store(pipeline_request_t* request, void* pipeline)
+{
+  wgpu_pipeline_cache_t* cache  = request->cache;
+  pipeline_cache_entry_t* entry = NULL;
+  if (pipeline != NULL && request->cached) {
+    entry = pipeline_cache_acquire(cache, &request->key, request->hash);
+    if (entry != NULL) {
+      // An identical pipeline became ready in the meantime
+      pipeline_release(request->type, pipeline);
+      pipeline = entry->pipeline;
+    }
+    else {
+      pipeline_reference(request->type, pipeline);
+      entry            = pipeline_cache_insert(cache, &request->key,
+                                               request->hash, request->type,
+                                               pipeline, &request->handles);
+      request->handles = (pipeline_key_handles_t){0};
+    }
+    if (request->reloadable) {
+      pipeline_cache_entry_add_slot(entry, request->target, request->callback,
+                                    request->user_data);
+    }
+  }
+
+  *request->target = pipeline;
+  if (pipeline != NULL && request->callback != NULL) {
+    request->callback(request->user_data);
+  }
+}
+
+/* Replaces the pipeline of a cache entry with its recreated version */
+static void pipeline_request_swap(pipeline_request_t* request, void* pipeline)
+{
+  wgpu_pipeline_cache_t* cache  = request->cache;
+  pipeline_cache_entry_t* entry = &cache->entries[request->entry];
+  void* previous_pipeline       = entry->pipeline;
+  pipeline_key_handles_release(&entry->handles);
+  free(entry->key.data);
+  entry->pipeline  = pipeline;
+  entry->key       = request->key;
+  entry->hash      = request->hash;
+  entry->handles   = request->handles;
+  request->key     = (pipeline_key_t){0};
+  request->handles = (pipeline_key_handles_t){0};
+
+  // Targets that still hold the previous pipeline receive the new one, the
+  // callbacks can create pipelines so the entry is looked up again
+  for (uint32_t i = 0; i < cache->entries[request->entry].slot_count; ++i) {
+    const pipeline_slot_t slot = cache->entries[request->entry].slots[i];
+    if (*slot.target != previous_pipeline) {
+      continue;
+    }
+    pipeline_release(request->type, previous_pipeline);
+    pipeline_reference(request->type, pipeline);
+    *slot.target = pipeline;
+    if (slot.callback != NULL) {
+      slot.callback(slot.user_data);
+    }
+  }
+  pipeline_release(request->type, previous_pipeline);
+}
+
+static void pipeline_request_complete(pipeline_request_t* request,
+                                      WGPUCreatePipelineAsyncStatus status,
+                                      void* pipeline, char const* message)
+{
+  --request->cache->pending_count;
+
+  const bool recreate = request->entry != PIPELINE_REQUEST_NEW_ENTRY;
+  if (status != WGPUCreatePipelineAsyncStatus_Success || pipeline == NULL) {
+    log_error("Pipeline %s failed: %s", recreate ? "recreation" : "creation",
+              message ? message : "");
+    if (pipeline != NULL) {
+      pipeline_release(request->type, pipeline);
+    }
+    pipeline = NULL;
+  }
+
+  if (!recreate) {
+    pipeline_request_store(request, pipeline);
+  }
+  else if (pipeline != NULL) {
+    // A failed recreation keeps the previous pipeline
+    pipeline_request_swap(request, pipeline);
+  }
+
+  pipeline_key_handles_release(&request->handles);
+  free(request->key.data);
+  free(request);
+}
+
+static void pipeline_request_render_callback(
+  WGPUCreatePipelineAsyncStatus status, WGPURenderPipeline pipeline,
+  char const* message, void* userdata)
+{
+  pipeline_request_complete((pipeline_request_t*)userdata, status, pipeline,
+                            message);
+}
+
+static void pipeline_request_compute_callback(
+  WGPUCreatePipelineAsyncStatus status, WGPUComputePipeline pipeline,
+  char const* message, void* userdata)
+{
+  pipeline_request_complete((pipeline_request_t*)userdata, status, pipeline,
+                            message);
+}
+
+void wgpu_create_render_pipeline_async(
+  wgpu_context_t* wgpu_context, const WGPURenderPipelineDescriptor* descriptor,
+  WGPURenderPipeline* pipeline, wgpu_pipeline_ready_callback_t callback,
+  void* user_data)
+{
+  pipeline_key_t key          = {0};
+  const bool cached           = pipeline_key_write_render(&key, descriptor);
+  pipeline_request_t* request = pipeline_request_create(
+    wgpu_context, PipelineType_Render, &key, cached, (void**)pipeline,
+    callback, user_data);
+  if (request == NULL) {
+    return;
+  }
+  if (cached) {
+    request->handles = pipeline_key_handles_reference(
+      descriptor->layout, descriptor->vertex.module,
+      descriptor->fragment ? descriptor->fragment->module : NULL);
+  }
+  wgpuDeviceCreateRenderPipelineAsync(wgpu_context->device, descriptor,
+                                      pipeline_request_render_callback,
+                                      request);
+}
+
+void wgpu_create_compute_pipeline_async(
+  wgpu_context_t* wgpu_context, const WGPUComputePipelineDescriptor* descriptor,
+  WGPUComputePipeline* pipeline, wgpu_pipeline_ready_callback_t callback,
+  void* user_data)
+{
+  pipeline_key_t key          = {0};
+  const bool cached           = pipeline_key_write_compute(&key, descriptor);
+  pipeline_request_t* request = pipeline_request_create(
+    wgpu_context, PipelineType_Compute, &key, cached, (void**)pipeline,
+    callback, user_data);
+  if (request == NULL) {
+    return;
+  }
+  if (cached) {
+    request->handles = pipeline_key_handles_reference(
+      descriptor->layout, descriptor->compute.module, NULL);
+  }
+  wgpuDeviceCreateComputePipelineAsync(wgpu_context->device, descriptor,
+                                       pipeline_request_compute_callback,
+                                       request);
+}
+
+uint32_t wgpu_get_pending_pipeline_count(wgpu_context_t* wgpu_context)
+{
+  return wgpu_context->pipeline_cache ?
+           wgpu_context->pipeline_cache->pending_count :
+           0;
+}
+
+void wgpu_wait_for_pending_pipelines(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->pipeline_cache != NULL) {
+    wait_for_pending_pipelines(wgpu_context->pipeline_cache);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Pipeline recreation
+ * -------------------------------------------------------------------------- */
+
+/* Recreates the pipeline of an entry with a shader module replaced */
+static void pipeline_request_recreate(wgpu_pipeline_cache_t* cache,
+                                      uint32_t entry_index,
+                                      WGPUShaderModule previous_module,
+                                      WGPUShaderModule module)
+{
+  const pipeline_cache_entry_t* entry = &cache->entries[entry_index];
+  pipeline_key_reader_t reader        = {
+    .key             = &entry->key,
+    .previous_module = previous_module,
+    .module          = module,
+  };
+
+  pipeline_request_t* request = calloc(1, sizeof(pipeline_request_t));
+  *request                    = (pipeline_request_t){
+    .cache  = cache,
+    .type   = entry->type,
+    .cached = true,
+    .entry  = entry_index,
+  };
+  ++cache->pending_count;
+
+  if (entry->type == PipelineType_Render) {
+    WGPURenderPipelineDescriptor descriptor;
+    pipeline_key_read_render(&reader, &descriptor);
+    pipeline_key_write_render(&request->key, &descriptor);
+    request->handles = pipeline_key_handles_reference(
+      descriptor.layout, descriptor.vertex.module,
+      descriptor.fragment ? descriptor.fragment->module : NULL);
+    request->hash = pipeline_key_hash(&request->key);
+    wgpuDeviceCreateRenderPipelineAsync(cache->device, &descriptor,
+                                        pipeline_request_render_callback,
+                                        request);
+  }
+  else {
+    WGPUComputePipelineDescriptor descriptor;
+    pipeline_key_read_compute(&reader, &descriptor);
+    pipeline_key_write_compute(&request->key, &descriptor);
+    request->handles = pipeline_key_handles_reference(
+      descriptor.layout, descriptor.compute.module, NULL);
+    request->hash = pipeline_key_hash(&request->key);
+    wgpuDeviceCreateComputePipelineAsync(cache->device, &descriptor,
+                                         pipeline_request_compute_callback,
+                                         request);
+  }
+
+  pipeline_key_reader_release(&reader);
+}
+
+uint32_t wgpu_pipeline_cache_replace_module(wgpu_context_t* wgpu_context,
+                                            WGPUShaderModule previous_module,
+                                            WGPUShaderModule module)
+{
+  wgpu_pipeline_cache_t* cache = wgpu_context->pipeline_cache;
+  if (cache == NULL || previous_module == NULL) {
+    return 0;
+  }
+
+  uint32_t recreated_count = 0;
+  for (uint32_t i = 0; i < cache->count; ++i) {
+    const pipeline_cache_entry_t* entry = &cache->entries[i];
+    // Pipelines without tracked targets can not be swapped
+    if (entry->slot_count == 0
+        || (entry->handles.modules[0] != previous_module
+            && entry->handles.modules[1] != previous_module)) {
+      continue;
+    }
+    pipeline_request_recreate(cache, i, previous_module, module);
+    ++recreated_count;
+  }
+  return recreated_count;
+}
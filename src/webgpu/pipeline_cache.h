@@ -0,0 +1,76 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU pipeline cache
+ *
+ * Deduplicates render and compute pipelines per device. The descriptor is
+ * serialized into the cache key: the pipeline layout and shader module
+ * handles, the entry points and constants, the vertex buffer layouts and the
+ * primitive, depth stencil, multisample and color target states. Labels are
+ * not part of the key, descriptors with chained structs are not cached.
+ *
+ * Shader modules created with wgpu_create_shader_module() are shared between
+ * identical sources, so pipelines created from the same files and states
+ * resolve to the same pipeline.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_pipeline_cache wgpu_pipeline_cache_t;
+
+/* Pipeline cache releasing */
+void wgpu_pipeline_cache_release(wgpu_pipeline_cache_t* pipeline_cache);
+
+/* Replacements of wgpuDeviceCreateRenderPipeline and
+ * wgpuDeviceCreateComputePipeline, every returned pipeline holds its own
+ * reference and is released as usual */
+WGPURenderPipeline
+wgpu_create_render_pipeline(wgpu_context_t* wgpu_context,
+                            const WGPURenderPipelineDescriptor* descriptor);
+WGPUComputePipeline
+wgpu_create_compute_pipeline(wgpu_context_t* wgpu_context,
+                             const WGPUComputePipelineDescriptor* descriptor);
+
+/* -------------------------------------------------------------------------- *
+ * Asynchronous pipeline creation
+ *
+ * The pipeline is compiled without blocking and stored in *pipeline once it
+ * is ready, *pipeline stays NULL until then. The render loop skips the draws
+ * and dispatches of pipelines that are not ready yet. The creation callbacks
+ * run during wgpuDeviceTick(), which happens at least once per frame on swap
+ * chain present. Cached pipelines are stored immediately.
+ * -------------------------------------------------------------------------- */
+
+/* Called once the pipeline is stored, e.g. to create bind groups from the
+ * layout of the pipeline */
+typedef void (*wgpu_pipeline_ready_callback_t)(void* user_data);
+
+void wgpu_create_render_pipeline_async(
+  wgpu_context_t* wgpu_context, const WGPURenderPipelineDescriptor* descriptor,
+  WGPURenderPipeline* pipeline, wgpu_pipeline_ready_callback_t callback,
+  void* user_data);
+void wgpu_create_compute_pipeline_async(
+  wgpu_context_t* wgpu_context, const WGPUComputePipelineDescriptor* descriptor,
+  WGPUComputePipeline* pipeline, wgpu_pipeline_ready_callback_t callback,
+  void* user_data);
+
+uint32_t wgpu_get_pending_pipeline_count(wgpu_context_t* wgpu_context);
+/* Blocks until all asynchronous creations completed, the pipeline pointers
+ * passed to them have to stay valid until then */
+void wgpu_wait_for_pending_pipelines(wgpu_context_t* wgpu_context);
+
+/**
+ * @brief Recreates the cached pipelines using a shader module with the new
+ * module, used for shader hot reload. Only pipelines created with
+ * wgpu_create_*_pipeline_async() while the shader watch was enabled are
+ * recreated. Once ready they are swapped into the pipeline pointers that
+ * still hold the previous pipeline and the ready callbacks are called again,
+ * the pointers have to stay valid as long as the pipeline cache.
+ * @return the number of pipelines being recreated
+ */
+uint32_t wgpu_pipeline_cache_replace_module(wgpu_context_t* wgpu_context,
+                                            WGPUShaderModule previous_module,
+                                            WGPUShaderModule module);
+
+#endif /* PIPELINE_CACHE_H */
@@ -0,0 +1,358 @@
+#include "pipeline_statistics.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#define WGPU_PIPELINE_STATISTICS_RENDER_COUNT 4u
+#define WGPU_PIPELINE_STATISTICS_COMPUTE_COUNT 1u
+/* Resolve offsets have to be 256 byte aligned */
+#define WGPU_PIPELINE_STATISTICS_RENDER_SIZE                                   \
+  (WGPU_PIPELINE_STATISTICS_MAX_PASSES * WGPU_PIPELINE_STATISTICS_RENDER_COUNT \
+   * sizeof(uint64_t))
+#define WGPU_PIPELINE_STATISTICS_COMPUTE_OFFSET                                \
+  ((WGPU_PIPELINE_STATISTICS_RENDER_SIZE + 255u) & ~(uint64_t)255u)
+#define WGPU_PIPELINE_STATISTICS_BUFFER_SIZE                                   \
+  (WGPU_PIPELINE_STATISTICS_COMPUTE_OFFSET                                     \
+   + WGPU_PIPELINE_STATISTICS_MAX_PASSES                                       \
+       * WGPU_PIPELINE_STATISTICS_COMPUTE_COUNT * sizeof(uint64_t))
+
+/* The statistics are listed in the order of the enum values, in which they are
+ * written by a query */
+static const WGPUPipelineStatisticName
+  render_statistics[WGPU_PIPELINE_STATISTICS_RENDER_COUNT]
+  = {
+    WGPUPipelineStatisticName_VertexShaderInvocations,
+    WGPUPipelineStatisticName_ClipperInvocations,
+    WGPUPipelineStatisticName_ClipperPrimitivesOut,
+    WGPUPipelineStatisticName_FragmentShaderInvocations,
+};
+static const WGPUPipelineStatisticName
+  compute_statistics[WGPU_PIPELINE_STATISTICS_COMPUTE_COUNT]
+  = {
+    WGPUPipelineStatisticName_ComputeShaderInvocations,
+};
+
+typedef enum wgpu_pipeline_statistics_frame_state_t {
+  StatisticsFrame_State_Available = 0,
+  StatisticsFrame_State_Recording = 1,
+  StatisticsFrame_State_Mapping   = 2,
+} wgpu_pipeline_statistics_frame_state_t;
+
+typedef struct wgpu_pipeline_statistics_frame_t {
+  struct wgpu_pipeline_statistics* statistics;
+  WGPUQuerySet render_query_set;
+  WGPUQuerySet compute_query_set;
+  WGPUBuffer resolve_buffer;
+  WGPUBuffer readback_buffer;
+  wgpu_pipeline_statistics_frame_state_t state;
+  uint32_t render_query_count;
+  uint32_t compute_query_count;
+  uint32_t pass_count;
+  struct {
+    char name[WGPU_PIPELINE_STATISTICS_NAME_SIZE];
+    bool compute;
+    uint32_t query_index;
+  } passes[WGPU_PIPELINE_STATISTICS_MAX_PASSES];
+} wgpu_pipeline_statistics_frame_t;
+
+/**
+ * @brief Pipeline statistics class
+ */
+struct wgpu_pipeline_statistics {
+  wgpu_context_t* wgpu_context;
+  wgpu_pipeline_statistics_frame_t
+    frames[WGPU_PIPELINE_STATISTICS_FRAME_COUNT];
+  wgpu_pipeline_statistics_frame_t* current_frame;
+  uint32_t next_frame_index;
+  /* A pass has at most one open query */
+  bool query_open;
+  /* Results of the most recently read back frame */
+  uint32_t result_count;
+  wgpu_pipeline_statistics_result_t
+    results[WGPU_PIPELINE_STATISTICS_MAX_PASSES];
+};
+
+/* Pipeline statistics creating / releasing */
+
+wgpu_pipeline_statistics_t*
+wgpu_pipeline_statistics_create(wgpu_context_t* wgpu_context)
+{
+  if (!wgpu_has_feature(wgpu_context,
+                        WGPUFeatureName_PipelineStatisticsQuery)) {
+    log_warn("Pipeline statistics queries not supported\n");
+    return NULL;
+  }
+
+  wgpu_pipeline_statistics_t* statistics
+    = (wgpu_pipeline_statistics_t*)malloc(sizeof(*statistics));
+  memset(statistics, 0, sizeof(*statistics));
+  statistics->wgpu_context = wgpu_context;
+
+  for (uint32_t i = 0; i < WGPU_PIPELINE_STATISTICS_FRAME_COUNT; ++i) {
+    wgpu_pipeline_statistics_frame_t* frame = &statistics->frames[i];
+    frame->statistics                       = statistics;
+    frame->state                            = StatisticsFrame_State_Available;
+    frame->render_query_set                 = wgpuDeviceCreateQuerySet(
+      wgpu_context->device,
+      &(WGPUQuerySetDescriptor){
+        .label                   = "Render pipeline statistics query set",
+        .type                    = WGPUQueryType_PipelineStatistics,
+        .count                   = WGPU_PIPELINE_STATISTICS_MAX_PASSES,
+        .pipelineStatistics      = render_statistics,
+        .pipelineStatisticsCount = WGPU_PIPELINE_STATISTICS_RENDER_COUNT,
+      });
+    frame->compute_query_set = wgpuDeviceCreateQuerySet(
+      wgpu_context->device,
+      &(WGPUQuerySetDescriptor){
+        .label                   = "Compute pipeline statistics query set",
+        .type                    = WGPUQueryType_PipelineStatistics,
+        .count                   = WGPU_PIPELINE_STATISTICS_MAX_PASSES,
+        .pipelineStatistics      = compute_statistics,
+        .pipelineStatisticsCount = WGPU_PIPELINE_STATISTICS_COMPUTE_COUNT,
+      });
+    frame->resolve_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Pipeline statistics resolve buffer",
+        .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        .size  = WGPU_PIPELINE_STATISTICS_BUFFER_SIZE,
+      });
+    frame->readback_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Pipeline statistics readback buffer",
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size  = WGPU_PIPELINE_STATISTICS_BUFFER_SIZE,
+      });
+    ASSERT(frame->render_query_set && frame->compute_query_set
+           && frame->resolve_buffer && frame->readback_buffer);
+  }
+
+  return statistics;
+}
+
+void wgpu_pipeline_statistics_release(wgpu_pipeline_statistics_t* statistics)
+{
+  if (statistics == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < WGPU_PIPELINE_STATISTICS_FRAME_COUNT; ++i) {
+    wgpu_pipeline_statistics_frame_t* frame = &statistics->frames[i];
+    if (frame->state == StatisticsFrame_State_Mapping) {
+      /* Cancels the pending map request */
+      wgpuBufferUnmap(frame->readback_buffer);
+    }
+    WGPU_RELEASE_RESOURCE(QuerySet, frame->render_query_set)
+    WGPU_RELEASE_RESOURCE(QuerySet, frame->compute_query_set)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->resolve_buffer)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->readback_buffer)
+  }
+
+  free(statistics);
+}
+
+/* Pass tagging */
+
+static wgpu_pipeline_statistics_frame_t*
+get_recording_frame(wgpu_pipeline_statistics_t* statistics)
+{
+  if (statistics->current_frame == NULL) {
+    wgpu_pipeline_statistics_frame_t* frame
+      = &statistics->frames[statistics->next_frame_index];
+    if (frame->state != StatisticsFrame_State_Available) {
+      /* All readback buffers are in flight, skip this frame */
+      return NULL;
+    }
+    frame->state               = StatisticsFrame_State_Recording;
+    frame->render_query_count  = 0;
+    frame->compute_query_count = 0;
+    frame->pass_count          = 0;
+    statistics->current_frame  = frame;
+  }
+  return statistics->current_frame;
+}
+
+/* Query index of a new tagged pass, UINT32_MAX if the frame is not measured */
+static uint32_t begin_pass(wgpu_pipeline_statistics_t* statistics,
+                           const char* name, bool compute)
+{
+  if (statistics->query_open) {
+    log_warn("Pipeline statistics query of the previous pass not ended\n");
+    return UINT32_MAX;
+  }
+
+  wgpu_pipeline_statistics_frame_t* frame = get_recording_frame(statistics);
+  if (frame == NULL
+      || frame->pass_count >= WGPU_PIPELINE_STATISTICS_MAX_PASSES) {
+    return UINT32_MAX;
+  }
+
+  const uint32_t pass_index = frame->pass_count++;
+  snprintf(frame->passes[pass_index].name, WGPU_PIPELINE_STATISTICS_NAME_SIZE,
+           "%s", name ? name : "");
+  frame->passes[pass_index].compute     = compute;
+  frame->passes[pass_index].query_index = compute ?
+                                            frame->compute_query_count++ :
+                                            frame->render_query_count++;
+  statistics->query_open                = true;
+  return frame->passes[pass_index].query_index;
+}
+
+void wgpu_pipeline_statistics_begin_render_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPURenderPassEncoder rpass_enc,
+  const char* name)
+{
+  if (statistics == NULL) {
+    return;
+  }
+
+  const uint32_t query_index = begin_pass(statistics, name, false);
+  if (query_index != UINT32_MAX) {
+    wgpuRenderPassEncoderBeginPipelineStatisticsQuery(
+      rpass_enc, statistics->current_frame->render_query_set, query_index);
+  }
+}
+
+void wgpu_pipeline_statistics_end_render_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPURenderPassEncoder rpass_enc)
+{
+  if (statistics == NULL || !statistics->query_open) {
+    return;
+  }
+
+  wgpuRenderPassEncoderEndPipelineStatisticsQuery(rpass_enc);
+  statistics->query_open = false;
+}
+
+void wgpu_pipeline_statistics_begin_compute_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPUComputePassEncoder cpass_enc,
+  const char* name)
+{
+  if (statistics == NULL) {
+    return;
+  }
+
+  const uint32_t query_index = begin_pass(statistics, name, true);
+  if (query_index != UINT32_MAX) {
+    wgpuComputePassEncoderBeginPipelineStatisticsQuery(
+      cpass_enc, statistics->current_frame->compute_query_set, query_index);
+  }
+}
+
+void wgpu_pipeline_statistics_end_compute_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPUComputePassEncoder cpass_enc)
+{
+  if (statistics == NULL || !statistics->query_open) {
+    return;
+  }
+
+  wgpuComputePassEncoderEndPipelineStatisticsQuery(cpass_enc);
+  statistics->query_open = false;
+}
+
+/* Frame resolving */
+
+static void statistics_readback_map_cb(WGPUBufferMapAsyncStatus status,
+                                       void* user_data)
+{
+  wgpu_pipeline_statistics_frame_t* frame
+    = (wgpu_pipeline_statistics_frame_t*)user_data;
+  wgpu_pipeline_statistics_t* statistics = frame->statistics;
+
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    uint64_t const* values = (uint64_t const*)wgpuBufferGetConstMappedRange(
+      frame->readback_buffer, 0, WGPU_PIPELINE_STATISTICS_BUFFER_SIZE);
+    ASSERT(values);
+    uint64_t const* compute_values
+      = values + WGPU_PIPELINE_STATISTICS_COMPUTE_OFFSET / sizeof(uint64_t);
+    for (uint32_t i = 0; i < frame->pass_count; ++i) {
+      wgpu_pipeline_statistics_result_t* result = &statistics->results[i];
+      memset(result, 0, sizeof(*result));
+      snprintf(result->name, WGPU_PIPELINE_STATISTICS_NAME_SIZE, "%s",
+               frame->passes[i].name);
+      result->compute            = frame->passes[i].compute;
+      const uint32_t query_index = frame->passes[i].query_index;
+      if (result->compute) {
+        result->compute_invocations = compute_values[query_index];
+      }
+      else {
+        uint64_t const* query
+          = values + query_index * WGPU_PIPELINE_STATISTICS_RENDER_COUNT;
+        result->vertex_invocations     = query[0];
+        result->clipper_invocations    = query[1];
+        result->clipper_primitives_out = query[2];
+        result->fragment_invocations   = query[3];
+      }
+    }
+    statistics->result_count = frame->pass_count;
+    wgpuBufferUnmap(frame->readback_buffer);
+  }
+
+  frame->state = StatisticsFrame_State_Available;
+}
+
+void wgpu_pipeline_statistics_end_frame(wgpu_pipeline_statistics_t* statistics)
+{
+  if (statistics == NULL || statistics->current_frame == NULL) {
+    return;
+  }
+
+  wgpu_pipeline_statistics_frame_t* frame = statistics->current_frame;
+  wgpu_context_t* wgpu_context            = statistics->wgpu_context;
+  statistics->current_frame               = NULL;
+  statistics->query_open                  = false;
+  statistics->next_frame_index
+    = (statistics->next_frame_index + 1) % WGPU_PIPELINE_STATISTICS_FRAME_COUNT;
+
+  if (frame->pass_count == 0) {
+    frame->state = StatisticsFrame_State_Available;
+    return;
+  }
+
+  /* Resolve the queries and copy them into the readback buffer */
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  if (frame->render_query_count > 0) {
+    wgpuCommandEncoderResolveQuerySet(cmd_enc, frame->render_query_set, 0,
+                                      frame->render_query_count,
+                                      frame->resolve_buffer, 0);
+  }
+  if (frame->compute_query_count > 0) {
+    wgpuCommandEncoderResolveQuerySet(
+      cmd_enc, frame->compute_query_set, 0, frame->compute_query_count,
+      frame->resolve_buffer, WGPU_PIPELINE_STATISTICS_COMPUTE_OFFSET);
+  }
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, frame->resolve_buffer, 0,
+                                       frame->readback_buffer, 0,
+                                       WGPU_PIPELINE_STATISTICS_BUFFER_SIZE);
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+
+  /* Read back asynchronously, results are available in a later frame */
+  frame->state = StatisticsFrame_State_Mapping;
+  wgpuBufferMapAsync(frame->readback_buffer, WGPUMapMode_Read, 0,
+                     WGPU_PIPELINE_STATISTICS_BUFFER_SIZE,
+                     statistics_readback_map_cb, frame);
+}
+
+/* Results */
+
+uint32_t
+wgpu_pipeline_statistics_get_result_count(wgpu_pipeline_statistics_t* stats)
+{
+  return stats ? stats->result_count : 0;
+}
+
+const wgpu_pipeline_statistics_result_t*
+wgpu_pipeline_statistics_get_results(wgpu_pipeline_statistics_t* stats)
+{
+  return stats ? stats->results : NULL;
+}
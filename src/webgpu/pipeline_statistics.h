@@ -0,0 +1,73 @@
+#ifndef PIPELINE_STATISTICS_H
+#define PIPELINE_STATISTICS_H
+
+#include "context.h"
+
+#define WGPU_PIPELINE_STATISTICS_MAX_PASSES 16u
+#define WGPU_PIPELINE_STATISTICS_FRAME_COUNT 3u
+#define WGPU_PIPELINE_STATISTICS_NAME_SIZE 32u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU pipeline statistics
+ *
+ * Counts the shader invocations of tagged passes with pipeline statistics
+ * queries: the vertex shader, clipper and fragment shader invocations of
+ * render passes and the compute shader invocations of compute passes, e.g.:
+ *
+ *   rpass_enc = wgpuCommandEncoderBeginRenderPass(cmd_enc, &desc);
+ *   wgpu_pipeline_statistics_begin_render_pass(
+ *     wgpu_context->pipeline_statistics, rpass_enc, "G-Buffer");
+ *   ... draws ...
+ *   wgpu_pipeline_statistics_end_render_pass(
+ *     wgpu_context->pipeline_statistics, rpass_enc);
+ *   wgpuRenderPassEncoderEnd(rpass_enc);
+ *
+ * The fragment invocations per pixel of a pass is its overdraw, the vertex
+ * and clipper invocations show the effect of culling. Like the GPU profiler
+ * the queries are resolved into one of WGPU_PIPELINE_STATISTICS_FRAME_COUNT
+ * readback buffers at the end of the frame, the results lag a few frames and
+ * a frame is not measured when all readback buffers are still in flight.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_pipeline_statistics wgpu_pipeline_statistics_t;
+
+typedef struct wgpu_pipeline_statistics_result_t {
+  char name[WGPU_PIPELINE_STATISTICS_NAME_SIZE];
+  bool compute; /* compute pass, only compute_invocations is counted */
+  uint64_t vertex_invocations;
+  uint64_t clipper_invocations;    /* primitives entering the clipper */
+  uint64_t clipper_primitives_out; /* primitives not culled or clipped away */
+  uint64_t fragment_invocations;
+  uint64_t compute_invocations;
+} wgpu_pipeline_statistics_result_t;
+
+/* Pipeline statistics creating / releasing */
+wgpu_pipeline_statistics_t*
+wgpu_pipeline_statistics_create(wgpu_context_t* wgpu_context);
+void wgpu_pipeline_statistics_release(wgpu_pipeline_statistics_t* statistics);
+
+/* Pass tagging inside of the pass, all functions accept a NULL statistics */
+void wgpu_pipeline_statistics_begin_render_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPURenderPassEncoder rpass_enc,
+  const char* name);
+void wgpu_pipeline_statistics_end_render_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPURenderPassEncoder rpass_enc);
+void wgpu_pipeline_statistics_begin_compute_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPUComputePassEncoder cpass_enc,
+  const char* name);
+void wgpu_pipeline_statistics_end_compute_pass(
+  wgpu_pipeline_statistics_t* statistics, WGPUComputePassEncoder cpass_enc);
+
+/**
+ * @brief Resolves the queries of the current frame and starts the asynchronous
+ * readback, done by wgpu_swap_chain_present().
+ */
+void wgpu_pipeline_statistics_end_frame(wgpu_pipeline_statistics_t* statistics);
+
+/* Results of the most recently read back frame, in the order of tagging */
+uint32_t
+wgpu_pipeline_statistics_get_result_count(wgpu_pipeline_statistics_t* stats);
+const wgpu_pipeline_statistics_result_t*
+wgpu_pipeline_statistics_get_results(wgpu_pipeline_statistics_t* stats);
+
+#endif /* PIPELINE_STATISTICS_H */
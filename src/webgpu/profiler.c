@@ -0,0 +1,327 @@
+#include "profiler.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/trace.h"
+#include "debug_markers.h"
+
+#define WGPU_PROFILER_MAX_DEPTH 8u
+#define WGPU_PROFILER_INVALID_SCOPE 0xFFFFFFFFu
+
+/* Weight of the newest sample in the moving average */
+#define WGPU_PROFILER_AVG_WEIGHT 0.1f
+
+typedef enum wgpu_profiler_frame_state_t {
+  ProfilerFrame_State_Available = 0,
+  ProfilerFrame_State_Recording = 1,
+  ProfilerFrame_State_Mapping   = 2,
+} wgpu_profiler_frame_state_t;
+
+typedef struct wgpu_profiler_frame_t {
+  struct wgpu_profiler* profiler;
+  WGPUQuerySet query_set;
+  WGPUBuffer resolve_buffer;
+  WGPUBuffer readback_buffer;
+  wgpu_profiler_frame_state_t state;
+  uint32_t query_count;
+  uint32_t scope_count;
+  /* CPU time of the frame end, anchors the scopes on the trace timeline */
+  uint64_t submit_ns;
+  struct {
+    char name[WGPU_PROFILER_SCOPE_NAME_SIZE];
+    uint32_t depth;
+    uint32_t begin_query;
+    uint32_t end_query;
+  } scopes[WGPU_PROFILER_MAX_SCOPES];
+} wgpu_profiler_frame_t;
+
+/**
+ * @brief GPU profiler class
+ */
+struct wgpu_profiler {
+  wgpu_context_t* wgpu_context;
+  wgpu_profiler_frame_t frames[WGPU_PROFILER_FRAME_COUNT];
+  wgpu_profiler_frame_t* current_frame;
+  uint32_t next_frame_index;
+  /* Stack of open scopes */
+  struct {
+    uint32_t scopes[WGPU_PROFILER_MAX_DEPTH];
+    uint32_t depth;
+  } open;
+  /* Results of the most recently read back frame */
+  uint32_t result_count;
+  wgpu_profiler_scope_result_t results[WGPU_PROFILER_MAX_SCOPES];
+  /* End of the last GPU frame added to the trace */
+  uint64_t trace_end_ns;
+};
+
+/* Profiler creating / releasing */
+
+wgpu_profiler_t* wgpu_profiler_create(wgpu_context_t* wgpu_context)
+{
+  if (!wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery)) {
+    log_warn("Timestamp queries not supported, GPU profiler disabled\n");
+    return NULL;
+  }
+
+  wgpu_profiler_t* profiler = (wgpu_profiler_t*)malloc(sizeof(*profiler));
+  memset(profiler, 0, sizeof(*profiler));
+  profiler->wgpu_context = wgpu_context;
+
+  const uint32_t query_count = WGPU_PROFILER_MAX_SCOPES * 2;
+  const uint64_t buffer_size = query_count * sizeof(uint64_t);
+  for (uint32_t i = 0; i < WGPU_PROFILER_FRAME_COUNT; ++i) {
+    wgpu_profiler_frame_t* frame = &profiler->frames[i];
+    frame->profiler              = profiler;
+    frame->state                 = ProfilerFrame_State_Available;
+    frame->query_set             = wgpuDeviceCreateQuerySet(
+      wgpu_context->device, &(WGPUQuerySetDescriptor){
+                              .label = "Profiler timestamp query set",
+                              .type  = WGPUQueryType_Timestamp,
+                              .count = query_count,
+                            });
+    frame->resolve_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Profiler resolve buffer",
+        .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        .size  = buffer_size,
+      });
+    frame->readback_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Profiler readback buffer",
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size  = buffer_size,
+      });
+    ASSERT(frame->query_set && frame->resolve_buffer
+           && frame->readback_buffer);
+  }
+
+  return profiler;
+}
+
+void wgpu_profiler_release(wgpu_profiler_t* profiler)
+{
+  if (profiler == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < WGPU_PROFILER_FRAME_COUNT; ++i) {
+    wgpu_profiler_frame_t* frame = &profiler->frames[i];
+    if (frame->state == ProfilerFrame_State_Mapping) {
+      /* Cancels the pending map request */
+      wgpuBufferUnmap(frame->readback_buffer);
+    }
+    WGPU_RELEASE_RESOURCE(QuerySet, frame->query_set)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->resolve_buffer)
+    WGPU_RELEASE_RESOURCE(Buffer, frame->readback_buffer)
+  }
+
+  free(profiler);
+}
+
+/* Scope recording */
+
+static wgpu_profiler_frame_t* get_recording_frame(wgpu_profiler_t* profiler)
+{
+  if (profiler->current_frame == NULL) {
+    wgpu_profiler_frame_t* frame
+      = &profiler->frames[profiler->next_frame_index];
+    if (frame->state != ProfilerFrame_State_Available) {
+      /* All readback buffers are in flight, skip this frame */
+      return NULL;
+    }
+    frame->state            = ProfilerFrame_State_Recording;
+    frame->query_count      = 0;
+    frame->scope_count      = 0;
+    profiler->current_frame = frame;
+  }
+  return profiler->current_frame;
+}
+
+void wgpu_profiler_begin_scope(wgpu_profiler_t* profiler,
+                               WGPUCommandEncoder cmd_enc, const char* name)
+{
+  /* The scopes are also debug groups for external GPU profilers */
+  wgpu_debug_group_push(cmd_enc, name);
+
+  if (profiler == NULL) {
+    return;
+  }
+
+  uint32_t scope_index         = WGPU_PROFILER_INVALID_SCOPE;
+  wgpu_profiler_frame_t* frame = get_recording_frame(profiler);
+  if (frame != NULL && frame->scope_count < WGPU_PROFILER_MAX_SCOPES) {
+    scope_index = frame->scope_count++;
+    snprintf(frame->scopes[scope_index].name, WGPU_PROFILER_SCOPE_NAME_SIZE,
+             "%s", name ? name : "");
+    frame->scopes[scope_index].depth       = profiler->open.depth;
+    frame->scopes[scope_index].begin_query = frame->query_count++;
+    frame->scopes[scope_index].end_query   = WGPU_PROFILER_INVALID_SCOPE;
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, frame->query_set,
+                                     frame->scopes[scope_index].begin_query);
+  }
+
+  if (profiler->open.depth < WGPU_PROFILER_MAX_DEPTH) {
+    profiler->open.scopes[profiler->open.depth] = scope_index;
+  }
+  ++profiler->open.depth;
+}
+
+void wgpu_profiler_end_scope(wgpu_profiler_t* profiler,
+                             WGPUCommandEncoder cmd_enc)
+{
+  wgpu_debug_group_pop(cmd_enc);
+
+  if (profiler == NULL || profiler->open.depth == 0) {
+    return;
+  }
+
+  --profiler->open.depth;
+  if (profiler->open.depth >= WGPU_PROFILER_MAX_DEPTH) {
+    return;
+  }
+
+  const uint32_t scope_index   = profiler->open.scopes[profiler->open.depth];
+  wgpu_profiler_frame_t* frame = profiler->current_frame;
+  if (frame == NULL || scope_index == WGPU_PROFILER_INVALID_SCOPE) {
+    return;
+  }
+
+  frame->scopes[scope_index].end_query = frame->query_count++;
+  wgpuCommandEncoderWriteTimestamp(cmd_enc, frame->query_set,
+                                   frame->scopes[scope_index].end_query);
+}
+
+/* Frame resolving */
+
+/**
+ * @brief Adds the scopes of a read back frame to the GPU track of the trace.
+ * The GPU timestamps are not correlated with the CPU clock, the frame is
+ * placed at the CPU time it was submitted and after the previous GPU frame.
+ */
+static void profiler_trace_frame(wgpu_profiler_t* profiler,
+                                 wgpu_profiler_frame_t* frame,
+                                 uint64_t const* timestamps)
+{
+  uint64_t frame_begin = UINT64_MAX;
+  for (uint32_t i = 0; i < frame->scope_count; ++i) {
+    frame_begin = MIN(frame_begin, timestamps[frame->scopes[i].begin_query]);
+  }
+
+  const uint64_t anchor_ns = MAX(frame->submit_ns, profiler->trace_end_ns);
+  for (uint32_t i = 0; i < frame->scope_count; ++i) {
+    if (frame->scopes[i].end_query == WGPU_PROFILER_INVALID_SCOPE) {
+      continue;
+    }
+    const uint64_t begin = timestamps[frame->scopes[i].begin_query];
+    const uint64_t end   = timestamps[frame->scopes[i].end_query];
+    if (end <= begin) {
+      continue;
+    }
+    trace_add_event(frame->scopes[i].name, TRACE_TRACK_GPU,
+                    anchor_ns + (begin - frame_begin), end - begin);
+    profiler->trace_end_ns
+      = MAX(profiler->trace_end_ns, anchor_ns + (end - frame_begin));
+  }
+}
+
+static void profiler_readback_map_cb(WGPUBufferMapAsyncStatus status,
+                                     void* user_data)
+{
+  wgpu_profiler_frame_t* frame = (wgpu_profiler_frame_t*)user_data;
+  wgpu_profiler_t* profiler    = frame->profiler;
+
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    uint64_t const* timestamps = (uint64_t const*)wgpuBufferGetConstMappedRange(
+      frame->readback_buffer, 0, frame->query_count * sizeof(uint64_t));
+    ASSERT(timestamps);
+    if (trace_is_enabled()) {
+      profiler_trace_frame(profiler, frame, timestamps);
+    }
+    for (uint32_t i = 0; i < frame->scope_count; ++i) {
+      wgpu_profiler_scope_result_t* result = &profiler->results[i];
+      const bool same_scope
+        = (i < profiler->result_count)
+          && (strcmp(result->name, frame->scopes[i].name) == 0);
+      float gpu_time_ms = 0.0f;
+      if (frame->scopes[i].end_query != WGPU_PROFILER_INVALID_SCOPE) {
+        const uint64_t begin = timestamps[frame->scopes[i].begin_query];
+        const uint64_t end   = timestamps[frame->scopes[i].end_query];
+        /* Timestamps are in nanoseconds */
+        gpu_time_ms = (end > begin) ? (float)((end - begin) / 1.0e6) : 0.0f;
+      }
+      snprintf(result->name, WGPU_PROFILER_SCOPE_NAME_SIZE, "%s",
+               frame->scopes[i].name);
+      result->depth           = frame->scopes[i].depth;
+      result->gpu_time_ms     = gpu_time_ms;
+      result->avg_gpu_time_ms = same_scope ?
+                                  result->avg_gpu_time_ms
+                                    + WGPU_PROFILER_AVG_WEIGHT
+                                        * (gpu_time_ms
+                                           - result->avg_gpu_time_ms) :
+                                  gpu_time_ms;
+    }
+    profiler->result_count = frame->scope_count;
+    wgpuBufferUnmap(frame->readback_buffer);
+  }
+
+  frame->state = ProfilerFrame_State_Available;
+}
+
+void wgpu_profiler_end_frame(wgpu_profiler_t* profiler)
+{
+  if (profiler == NULL || profiler->current_frame == NULL) {
+    return;
+  }
+
+  wgpu_profiler_frame_t* frame = profiler->current_frame;
+  wgpu_context_t* wgpu_context = profiler->wgpu_context;
+  frame->submit_ns             = trace_get_time_ns();
+  profiler->current_frame      = NULL;
+  profiler->open.depth         = 0;
+  profiler->next_frame_index
+    = (profiler->next_frame_index + 1) % WGPU_PROFILER_FRAME_COUNT;
+
+  if (frame->query_count == 0) {
+    frame->state = ProfilerFrame_State_Available;
+    return;
+  }
+
+  /* Resolve the timestamps and copy them into the readback buffer */
+  const uint64_t size = frame->query_count * sizeof(uint64_t);
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, frame->query_set, 0,
+                                    frame->query_count, frame->resolve_buffer,
+                                    0);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, frame->resolve_buffer, 0,
+                                       frame->readback_buffer, 0, size);
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+
+  /* Read back asynchronously, results are available in a later frame */
+  frame->state = ProfilerFrame_State_Mapping;
+  wgpuBufferMapAsync(frame->readback_buffer, WGPUMapMode_Read, 0, size,
+                     profiler_readback_map_cb, frame);
+}
+
+/* Results */
+
+uint32_t wgpu_profiler_get_scope_count(wgpu_profiler_t* profiler)
+{
+  return profiler ? profiler->result_count : 0;
+}
+
+const wgpu_profiler_scope_result_t*
+wgpu_profiler_get_scope_results(wgpu_profiler_t* profiler)
+{
+  return profiler ? profiler->results : NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "context.h"
+
+#define WGPU_PROFILER_MAX_SCOPES 32u
+#define WGPU_PROFILER_FRAME_COUNT 3u
+#define WGPU_PROFILER_SCOPE_NAME_SIZE 32u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU GPU Profiler
+ *
+ * Measures the GPU time of named scopes using timestamp queries. Scopes are
+ * recorded on a command encoder outside of render / compute passes, e.g.:
+ *
+ *   wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Scene");
+ *   ... begin pass, encode commands, end pass ...
+ *   wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+ *
+ * At the end of a frame the timestamps are resolved into one of
+ * WGPU_PROFILER_FRAME_COUNT readback buffers which is mapped asynchronously,
+ * the results therefore lag a few frames behind. When all readback buffers are
+ * still in flight, the frame is not profiled instead of stalling the CPU.
+ * During a trace session (core/trace.h) the read back scopes are also added to
+ * the GPU track of the trace. With debug markers enabled every scope is also a
+ * debug group (see debug_markers.h), also without timestamp query support.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_profiler wgpu_profiler_t;
+
+typedef struct wgpu_profiler_scope_result_t {
+  char name[WGPU_PROFILER_SCOPE_NAME_SIZE];
+  uint32_t depth;         /* nesting depth of the scope */
+  float gpu_time_ms;      /* last measured GPU time */
+  float avg_gpu_time_ms;  /* exponential moving average of the GPU time */
+} wgpu_profiler_scope_result_t;
+
+/* Profiler creating / releasing */
+wgpu_profiler_t* wgpu_profiler_create(wgpu_context_t* wgpu_context);
+void wgpu_profiler_release(wgpu_profiler_t* profiler);
+
+/* Scope recording, all functions accept a NULL profiler */
+void wgpu_profiler_begin_scope(wgpu_profiler_t* profiler,
+                               WGPUCommandEncoder cmd_enc, const char* name);
+void wgpu_profiler_end_scope(wgpu_profiler_t* profiler,
+                             WGPUCommandEncoder cmd_enc);
+
+/**
+ * @brief Resolves the timestamp queries of the current frame and starts the
+ * asynchronous readback. Called once per frame after the last submit, this is
+ * done by wgpu_swap_chain_present().
+ */
+void wgpu_profiler_end_frame(wgpu_profiler_t* profiler);
+
+/* Results of the most recently read back frame */
+uint32_t wgpu_profiler_get_scope_count(wgpu_profiler_t* profiler);
+const wgpu_profiler_scope_result_t*
+wgpu_profiler_get_scope_results(wgpu_profiler_t* profiler);
+
+#endif /* PROFILER_H */
@@ -0,0 +1,479 @@
+#include "random_fill.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Elements per workgroup of the buffer kernel */
+#define RANDOM_FILL_BLOCK_SIZE 256u
+/* Workgroups per dispatch row, larger dispatches use several rows */
+#define RANDOM_FILL_MAX_GROUPS_X 32768u
+/* Uniform buffer offset alignment of the parameter slots */
+#define RANDOM_FILL_PARAM_SLOT_SIZE 256u
+#define RANDOM_FILL_TEXTURE_FORMAT_COUNT 4u
+
+/* -------------------------------------------------------------------------- *
+ * Kernels
+ *
+ * The kernels are separate modules sharing the parameters and the random
+ * number generation. The values of an element only depend on the seed and the
+ * element index, not on the dispatch.
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* random_fill_common_wgsl = CODE(
+  struct Params {
+    count : u32,
+    seed : u32,
+    distribution : u32,
+    components : u32,
+    stride : u32,
+    offset : u32,
+    groupsX : u32,
+    padding : u32,
+    range : vec2<f32>,
+    radius : f32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : Params;
+
+  const kBlockSize = 256u;
+  const kTwoPi = 6.283185307179586;
+
+  fn pcgHash(input : u32) -> u32 {
+    let state = input * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  // Uniform in [0, 1), the state advances with every value
+  fn nextUniform(state : ptr<function, u32>) -> f32 {
+    *state = pcgHash(*state);
+    return f32(*state >> 8u) * (1.0 / 16777216.0);
+  }
+
+  // Two normally distributed values (Box-Muller transform)
+  fn nextNormal2(state : ptr<function, u32>) -> vec2<f32> {
+    let u0 = 1.0 - nextUniform(state);
+    let u1 = nextUniform(state);
+    let r = sqrt(-2.0 * log(u0));
+    return r * vec2<f32>(cos(kTwoPi * u1), sin(kTwoPi * u1));
+  }
+
+  fn nextOnUnitSphere(state : ptr<function, u32>) -> vec3<f32> {
+    let z = 2.0 * nextUniform(state) - 1.0;
+    let phi = kTwoPi * nextUniform(state);
+    let r = sqrt(max(1.0 - z * z, 0.0));
+    return vec3<f32>(r * cos(phi), r * sin(phi), z);
+  }
+
+  fn randomValue(index : u32) -> vec4<f32> {
+    var state = pcgHash(index ^ pcgHash(params.seed));
+    switch (params.distribution) {
+      case 0u: {
+        let u = vec4<f32>(nextUniform(&state), nextUniform(&state),
+                          nextUniform(&state), nextUniform(&state));
+        return mix(vec4<f32>(params.range.x), vec4<f32>(params.range.y), u);
+      }
+      case 1u: {
+        let n = vec4<f32>(nextNormal2(&state), nextNormal2(&state));
+        return params.range.x + params.range.y * n;
+      }
+      case 2u: {
+        // The cube root keeps the density uniform over the volume
+        let r = params.radius * pow(nextUniform(&state), 1.0 / 3.0);
+        return vec4<f32>(nextOnUnitSphere(&state) * r, 1.0);
+      }
+      default: {
+        return vec4<f32>(nextOnUnitSphere(&state) * params.radius, 1.0);
+      }
+    }
+  }
+);
+
+static const char* random_fill_buffer_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read_write> data : array<f32>;
+
+  @compute @workgroup_size(kBlockSize)
+  fn main(@builtin(workgroup_id) wid : vec3<u32>,
+          @builtin(local_invocation_index) lid : u32) {
+    let i = (wid.x + wid.y * params.groupsX) * kBlockSize + lid;
+    if (i >= params.count) {
+      return;
+    }
+    let value = randomValue(i);
+    let base = params.offset + i * params.stride;
+    for (var c = 0u; c < params.components; c = c + 1u) {
+      data[base + c] = value[c];
+    }
+  }
+);
+
+// The storage texture format is inserted with snprintf
+static const char* random_fill_texture_2d_wgsl_format = CODE(
+  @group(0) @binding(1) var dst : texture_storage_2d_array<%s, write>;
+
+  @compute @workgroup_size(8, 8, 1)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let size = vec2<u32>(textureDimensions(dst));
+    if (any(id.xy >= size) || id.z >= u32(textureNumLayers(dst))) {
+      return;
+    }
+    let index = id.x + (id.y + id.z * size.y) * size.x;
+    textureStore(dst, vec2<i32>(id.xy), i32(id.z), randomValue(index));
+  }
+);
+
+static const char* random_fill_texture_3d_wgsl_format = CODE(
+  @group(0) @binding(1) var dst : texture_storage_3d<%s, write>;
+
+  @compute @workgroup_size(4, 4, 4)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let size = vec3<u32>(textureDimensions(dst));
+    if (any(id >= size)) {
+      return;
+    }
+    let index = id.x + (id.y + id.z * size.y) * size.x;
+    textureStore(dst, vec3<i32>(id), randomValue(index));
+  }
+);
+// clang-format on
+
+static const struct {
+  WGPUTextureFormat format;
+  const char* wgsl_format;
+} random_fill_texture_formats[RANDOM_FILL_TEXTURE_FORMAT_COUNT] = {
+  {WGPUTextureFormat_RGBA8Unorm, "rgba8unorm"},
+  {WGPUTextureFormat_RGBA16Float, "rgba16float"},
+  {WGPUTextureFormat_RGBA32Float, "rgba32float"},
+  {WGPUTextureFormat_R32Float, "r32float"},
+};
+
+typedef struct random_fill_params_t {
+  uint32_t count;
+  uint32_t seed;
+  uint32_t distribution;
+  uint32_t components;
+  uint32_t stride;
+  uint32_t offset;
+  uint32_t groups_x;
+  uint32_t padding;
+  float range[2];
+  float radius;
+  float padding2;
+} random_fill_params_t;
+
+typedef struct random_fill_kernel_t {
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+} random_fill_kernel_t;
+
+struct wgpu_random_fill {
+  wgpu_context_t* wgpu_context;
+  WGPUBuffer params_buffer;
+  uint32_t param_slot;
+  random_fill_kernel_t buffer_kernel;
+  // Texture kernels by format, 2D array and 3D, created on first use
+  random_fill_kernel_t texture_kernels[RANDOM_FILL_TEXTURE_FORMAT_COUNT][2];
+};
+
+/* The destination is a storage buffer when the storage texture layout is
+ * NULL */
+static void random_fill_create_kernel(
+  wgpu_context_t* wgpu_context, random_fill_kernel_t* kernel,
+  const char* source, const WGPUStorageTextureBindingLayout* storage_texture)
+{
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry){
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout){
+        .type             = WGPUBufferBindingType_Uniform,
+        .hasDynamicOffset = true,
+        .minBindingSize   = sizeof(random_fill_params_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry){
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+    },
+  };
+  if (storage_texture != NULL) {
+    bgl_entries[1].storageTexture = *storage_texture;
+  }
+  else {
+    bgl_entries[1].buffer = (WGPUBufferBindingLayout){
+      .type = WGPUBufferBindingType_Storage,
+    };
+  }
+  kernel->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(kernel->bind_group_layout != NULL);
+  kernel->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &kernel->bind_group_layout,
+                          });
+  ASSERT(kernel->pipeline_layout != NULL);
+
+  // Kernel module, prefixed by the common declarations
+  const size_t common_length = strlen(random_fill_common_wgsl);
+  const size_t length        = common_length + strlen(source) + 1;
+  char* wgsl                 = (char*)malloc(length);
+  memcpy(wgsl, random_fill_common_wgsl, common_length);
+  memcpy(wgsl + common_length, source, length - common_length);
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = wgsl,
+                    .entry            = "main",
+                  });
+  kernel->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "random_fill_pipeline",
+                    .layout  = kernel->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(kernel->pipeline != NULL);
+  wgpu_shader_release(&shader);
+  free(wgsl);
+}
+
+static void random_fill_release_kernel(random_fill_kernel_t* kernel)
+{
+  WGPU_RELEASE_RESOURCE(ComputePipeline, kernel->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, kernel->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, kernel->bind_group_layout)
+}
+
+static random_fill_kernel_t*
+random_fill_get_texture_kernel(wgpu_random_fill_t* random_fill,
+                               WGPUTextureFormat format, bool is_3d)
+{
+  for (uint32_t i = 0; i < RANDOM_FILL_TEXTURE_FORMAT_COUNT; ++i) {
+    if (random_fill_texture_formats[i].format != format) {
+      continue;
+    }
+    random_fill_kernel_t* kernel
+      = &random_fill->texture_kernels[i][is_3d ? 1 : 0];
+    if (kernel->pipeline == NULL) {
+      const char* source_format = is_3d ?
+                                    random_fill_texture_3d_wgsl_format :
+                                    random_fill_texture_2d_wgsl_format;
+      const char* wgsl_format   = random_fill_texture_formats[i].wgsl_format;
+      const size_t size = strlen(source_format) + strlen(wgsl_format) + 1;
+      char* source      = (char*)malloc(size);
+      snprintf(source, size, source_format, wgsl_format);
+      random_fill_create_kernel(
+        random_fill->wgpu_context, kernel, source,
+        &(WGPUStorageTextureBindingLayout){
+          .access        = WGPUStorageTextureAccess_WriteOnly,
+          .format        = format,
+          .viewDimension = is_3d ? WGPUTextureViewDimension_3D :
+                                   WGPUTextureViewDimension_2DArray,
+        });
+      free(source);
+    }
+    return kernel;
+  }
+  return NULL;
+}
+
+/* Writes the parameters of a fill into the next slot, returns its offset */
+static uint32_t random_fill_write_params(wgpu_random_fill_t* random_fill,
+                                         const wgpu_random_fill_desc_t* desc,
+                                         uint32_t count, uint32_t components,
+                                         uint32_t groups_x)
+{
+  const uint32_t param_offset
+    = random_fill->param_slot * RANDOM_FILL_PARAM_SLOT_SIZE;
+  random_fill->param_slot
+    = (random_fill->param_slot + 1) % WGPU_RANDOM_FILL_PARAM_SLOTS;
+
+  const bool is_normal = desc->distribution == WGPU_RandomDistribution_Normal;
+  const random_fill_params_t params = {
+    .count        = count,
+    .seed         = desc->seed,
+    .distribution = (uint32_t)desc->distribution,
+    .components   = components,
+    .stride       = desc->stride > 0 ? desc->stride : components,
+    .offset       = desc->offset,
+    .groups_x     = groups_x,
+    .range        = {
+      is_normal ? desc->mean : desc->min,
+      is_normal ? desc->std_dev : desc->max,
+    },
+    .radius       = desc->radius,
+  };
+  wgpuQueueWriteBuffer(random_fill->wgpu_context->queue,
+                       random_fill->params_buffer, param_offset, &params,
+                       sizeof(params));
+  return param_offset;
+}
+
+/* Records the dispatch of the kernel with the destination bound to binding 1 */
+static void random_fill_dispatch(wgpu_random_fill_t* random_fill,
+                                 WGPUCommandEncoder cmd_enc,
+                                 const random_fill_kernel_t* kernel,
+                                 WGPUBindGroupEntry destination,
+                                 uint32_t param_offset,
+                                 const uint32_t groups[3])
+{
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry){
+      .binding = 0,
+      .buffer  = random_fill->params_buffer,
+      .offset  = 0,
+      .size    = sizeof(random_fill_params_t),
+    },
+    [1] = destination,
+  };
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+    random_fill->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = kernel->bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(bind_group != NULL);
+
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Random fill compute pass",
+             });
+  wgpuComputePassEncoderSetPipeline(pass_encoder, kernel->pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 1,
+                                     &param_offset);
+  wgpuComputePassEncoderDispatchWorkgroups(pass_encoder, groups[0], groups[1],
+                                           groups[2]);
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+
+  // The command encoder keeps the bind group alive until the submit
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
+
+wgpu_random_fill_t* wgpu_random_fill_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_random_fill_t* random_fill
+    = (wgpu_random_fill_t*)calloc(1, sizeof(wgpu_random_fill_t));
+  random_fill->wgpu_context = wgpu_context;
+
+  random_fill->params_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "random_fill_params_buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = WGPU_RANDOM_FILL_PARAM_SLOTS * RANDOM_FILL_PARAM_SLOT_SIZE,
+    });
+  ASSERT(random_fill->params_buffer != NULL);
+
+  random_fill_create_kernel(wgpu_context, &random_fill->buffer_kernel,
+                            random_fill_buffer_wgsl, NULL);
+
+  return random_fill;
+}
+
+void wgpu_random_fill_destroy(wgpu_random_fill_t* random_fill)
+{
+  random_fill_release_kernel(&random_fill->buffer_kernel);
+  for (uint32_t i = 0; i < RANDOM_FILL_TEXTURE_FORMAT_COUNT; ++i) {
+    random_fill_release_kernel(&random_fill->texture_kernels[i][0]);
+    random_fill_release_kernel(&random_fill->texture_kernels[i][1]);
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, random_fill->params_buffer)
+  free(random_fill);
+}
+
+void wgpu_random_fill_buffer(wgpu_random_fill_t* random_fill,
+                             WGPUCommandEncoder cmd_enc, WGPUBuffer buffer,
+                             uint32_t count,
+                             const wgpu_random_fill_desc_t* desc)
+{
+  const uint32_t components = desc->components > 0 ? desc->components : 1u;
+  ASSERT(components <= 4u);
+  ASSERT(components >= 3u
+         || desc->distribution == WGPU_RandomDistribution_Uniform
+         || desc->distribution == WGPU_RandomDistribution_Normal);
+  ASSERT(desc->stride == 0 || desc->stride >= components);
+  if (count == 0) {
+    return;
+  }
+
+  const uint32_t block_count
+    = (count + RANDOM_FILL_BLOCK_SIZE - 1) / RANDOM_FILL_BLOCK_SIZE;
+  const uint32_t groups_x = MIN(block_count, RANDOM_FILL_MAX_GROUPS_X);
+  const uint32_t groups[3] = {
+    groups_x,
+    (block_count + groups_x - 1) / groups_x,
+    1,
+  };
+  const uint32_t param_offset
+    = random_fill_write_params(random_fill, desc, count, components, groups_x);
+  random_fill_dispatch(random_fill, cmd_enc, &random_fill->buffer_kernel,
+                       (WGPUBindGroupEntry){
+                         .binding = 1,
+                         .buffer  = buffer,
+                         .offset  = 0,
+                         .size    = WGPU_WHOLE_SIZE,
+                       },
+                       param_offset, groups);
+}
+
+bool wgpu_random_fill_texture(wgpu_random_fill_t* random_fill,
+                              WGPUCommandEncoder cmd_enc,
+                              const texture_t* texture,
+                              const wgpu_random_fill_desc_t* desc)
+{
+  const bool is_3d = texture->dimension == WGPUTextureDimension_3D;
+  random_fill_kernel_t* kernel
+    = random_fill_get_texture_kernel(random_fill, texture->format, is_3d);
+  if (kernel == NULL) {
+    log_error("Random fill: unsupported storage texture format %d",
+              texture->format);
+    return false;
+  }
+
+  const uint32_t depth = MAX(texture->size.depth, 1u);
+  WGPUTextureView view = wgpuTextureCreateView(
+    texture->texture, &(WGPUTextureViewDescriptor){
+                        .label  = "random_fill_texture_view",
+                        .format = texture->format,
+                        .dimension = is_3d ? WGPUTextureViewDimension_3D :
+                                             WGPUTextureViewDimension_2DArray,
+                        .baseMipLevel    = 0,
+                        .mipLevelCount   = 1,
+                        .baseArrayLayer  = 0,
+                        .arrayLayerCount = is_3d ? 1 : depth,
+                        .aspect          = WGPUTextureAspect_All,
+                      });
+  ASSERT(view != NULL);
+
+  const uint32_t workgroup_size[3] = {is_3d ? 4u : 8u, is_3d ? 4u : 8u,
+                                      is_3d ? 4u : 1u};
+  const uint32_t groups[3]         = {
+    (texture->size.width + workgroup_size[0] - 1) / workgroup_size[0],
+    (texture->size.height + workgroup_size[1] - 1) / workgroup_size[1],
+    (depth + workgroup_size[2] - 1) / workgroup_size[2],
+  };
+  const uint32_t param_offset
+    = random_fill_write_params(random_fill, desc, 0, 4u, 0);
+  random_fill_dispatch(random_fill, cmd_enc, kernel,
+                       (WGPUBindGroupEntry){
+                         .binding     = 1,
+                         .textureView = view,
+                       },
+                       param_offset, groups);
+  WGPU_RELEASE_RESOURCE(TextureView, view)
+
+  return true;
+}
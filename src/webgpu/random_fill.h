@@ -0,0 +1,77 @@
+#ifndef RANDOM_FILL_H
+#define RANDOM_FILL_H
+
+#include "context.h"
+#include "texture.h"
+
+/* Parameter sets available per submit, see below */
+#define WGPU_RANDOM_FILL_PARAM_SLOTS 64u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU random fill
+ *
+ * Fills f32 storage buffers and storage textures with random values on the
+ * GPU, initializing millions of simulation elements takes one dispatch instead
+ * of a CPU loop and an upload. The values are a PCG hash of the seed and the
+ * element index, the same seed generates the same values on every run and
+ * every GPU.
+ *
+ * Every call records one compute pass on the command encoder. The parameters
+ * of a fill are written into parameter slots with queue writes when the pass
+ * is recorded, the slots are reused after WGPU_RANDOM_FILL_PARAM_SLOTS fills.
+ * The fills recorded before a submit must not use more slots than that.
+ * -------------------------------------------------------------------------- */
+
+typedef enum wgpu_random_distribution_enum_t {
+  WGPU_RandomDistribution_Uniform  = 0, /* uniform in [min, max) */
+  WGPU_RandomDistribution_Normal   = 1, /* normal with mean and std_dev */
+  WGPU_RandomDistribution_InSphere = 2, /* uniform in a sphere of radius */
+  WGPU_RandomDistribution_OnSphere = 3, /* uniform on a sphere of radius */
+} wgpu_random_distribution_enum_t;
+
+typedef struct wgpu_random_fill_desc_t {
+  wgpu_random_distribution_enum_t distribution;
+  uint32_t seed;
+  /* Uniform distribution */
+  float min;
+  float max;
+  /* Normal distribution */
+  float mean;
+  float std_dev;
+  /* Sphere distributions, the points are centered at the origin. The fourth
+   * component of the points is 1. */
+  float radius;
+  /* Buffer layout in floats: the components of element i start at
+   * offset + i * stride. Textures always fill all four channels. */
+  uint32_t components; /* 1 - 4, 0 = 1, 3 or 4 for the sphere distributions */
+  uint32_t stride;     /* 0 = components */
+  uint32_t offset;
+} wgpu_random_fill_desc_t;
+
+typedef struct wgpu_random_fill wgpu_random_fill_t;
+
+/* Random fill creating / destroying */
+wgpu_random_fill_t* wgpu_random_fill_create(wgpu_context_t* wgpu_context);
+void wgpu_random_fill_destroy(wgpu_random_fill_t* random_fill);
+
+/**
+ * @brief Fills count elements of the f32 storage buffer, the buffer needs the
+ * Storage usage. The floats between the elements are left unchanged, several
+ * fills with different offsets initialize interleaved attributes.
+ */
+void wgpu_random_fill_buffer(wgpu_random_fill_t* random_fill,
+                             WGPUCommandEncoder cmd_enc, WGPUBuffer buffer,
+                             uint32_t count,
+                             const wgpu_random_fill_desc_t* desc);
+
+/**
+ * @brief Fills mip level 0 of all layers of a 2D or 3D texture created with
+ * the StorageBinding usage. The format has to be RGBA8Unorm, RGBA16Float,
+ * RGBA32Float or R32Float, returns false for other formats.
+ */
+bool wgpu_random_fill_texture(wgpu_random_fill_t* random_fill,
+                              WGPUCommandEncoder cmd_enc,
+                              const texture_t* texture,
+                              const wgpu_random_fill_desc_t* desc);
+
+#endif /* RANDOM_FILL_H */
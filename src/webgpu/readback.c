@@ -0,0 +1,225 @@
+#include "readback.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+typedef enum wgpu_readback_state_t {
+  Readback_State_Available = 0, /* unmapped, ready for a copy */
+  Readback_State_Recorded  = 1, /* copy recorded, not submitted yet */
+  Readback_State_Mapping   = 2, /* waiting for the GPU to finish the copy */
+  Readback_State_Mapped    = 3, /* ready to be delivered */
+  Readback_State_Failed    = 4, /* mapping failed, delivered without data */
+} wgpu_readback_state_t;
+
+typedef struct wgpu_readback_t {
+  WGPUBuffer buffer;
+  uint64_t bucket_size;
+  uint64_t size; /* size of the readback in flight */
+  wgpu_readback_state_t state;
+  wgpu_readback_callback_t callback;
+  void* user_data;
+} wgpu_readback_t;
+
+/**
+ * @brief Readback pool class
+ */
+struct wgpu_readback_pool {
+  wgpu_context_t* wgpu_context;
+  /* Readbacks are referenced by the map callbacks, never moved */
+  wgpu_readback_t** readbacks;
+  uint32_t readback_count;
+  uint32_t capacity;
+  WGPUCommandEncoder encoder; /* NULL if no copies are recorded */
+};
+
+/* Readback pool creating / releasing */
+
+wgpu_readback_pool_t* wgpu_readback_pool_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_readback_pool_t* pool
+    = (wgpu_readback_pool_t*)malloc(sizeof(wgpu_readback_pool_t));
+  memset(pool, 0, sizeof(wgpu_readback_pool_t));
+  pool->wgpu_context = wgpu_context;
+
+  return pool;
+}
+
+void wgpu_readback_pool_release(wgpu_readback_pool_t* pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(CommandEncoder, pool->encoder)
+  for (uint32_t i = 0; i < pool->readback_count; ++i) {
+    wgpu_readback_t* readback = pool->readbacks[i];
+    if (readback->state == Readback_State_Mapping
+        || readback->state == Readback_State_Mapped) {
+      /* Cancels pending map requests */
+      wgpuBufferUnmap(readback->buffer);
+    }
+    WGPU_RELEASE_RESOURCE(Buffer, readback->buffer)
+    free(readback);
+  }
+  free(pool->readbacks);
+  free(pool);
+}
+
+/* Smallest power-of-two bucket size that fits the requested size */
+static uint64_t readback_pool_bucket_size(uint64_t size)
+{
+  uint64_t bucket_size = WGPU_READBACK_POOL_MIN_BUCKET_SIZE;
+  while (bucket_size < size) {
+    bucket_size <<= 1;
+  }
+  return bucket_size;
+}
+
+static wgpu_readback_t* readback_pool_acquire(wgpu_readback_pool_t* pool,
+                                              uint64_t size)
+{
+  const uint64_t bucket_size = readback_pool_bucket_size(size);
+
+  /* Reuse an available buffer of the bucket */
+  for (uint32_t i = 0; i < pool->readback_count; ++i) {
+    wgpu_readback_t* readback = pool->readbacks[i];
+    if (readback->bucket_size == bucket_size
+        && readback->state == Readback_State_Available) {
+      return readback;
+    }
+  }
+
+  if (pool->readback_count >= WGPU_READBACK_POOL_MAX_BUFFER_COUNT) {
+    return NULL;
+  }
+
+  /* Add a new buffer to the bucket */
+  if (pool->readback_count == pool->capacity) {
+    pool->capacity  = pool->capacity > 0 ? pool->capacity * 2 : 8;
+    pool->readbacks = (wgpu_readback_t**)realloc(
+      pool->readbacks, pool->capacity * sizeof(wgpu_readback_t*));
+  }
+  wgpu_readback_t* readback
+    = (wgpu_readback_t*)calloc(1, sizeof(wgpu_readback_t));
+  readback->bucket_size = bucket_size;
+  readback->state       = Readback_State_Available;
+  readback->buffer      = wgpuDeviceCreateBuffer(
+    pool->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Readback pool buffer",
+      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+      .size  = bucket_size,
+    });
+  ASSERT(readback->buffer != NULL);
+  pool->readbacks[pool->readback_count++] = readback;
+
+  return readback;
+}
+
+/* Reading back */
+
+bool wgpu_buffer_read_async(wgpu_context_t* wgpu_context, WGPUBuffer buffer,
+                            uint64_t offset, uint64_t size,
+                            wgpu_readback_callback_t callback,
+                            void* user_data)
+{
+  ASSERT(buffer != NULL && callback != NULL);
+  ASSERT(offset % 4 == 0 && size % 4 == 0 && size > 0);
+
+  if (wgpu_context->readback_pool == NULL) {
+    wgpu_context->readback_pool = wgpu_readback_pool_create(wgpu_context);
+  }
+  wgpu_readback_pool_t* pool = wgpu_context->readback_pool;
+
+  wgpu_readback_t* readback = readback_pool_acquire(pool, size);
+  if (readback == NULL) {
+    return false;
+  }
+
+  if (pool->encoder == NULL) {
+    pool->encoder = wgpuDeviceCreateCommandEncoder(
+      wgpu_context->device, &(WGPUCommandEncoderDescriptor){
+                              .label = "Readback pool command encoder",
+                            });
+  }
+  wgpuCommandEncoderCopyBufferToBuffer(pool->encoder, buffer, offset,
+                                       readback->buffer, 0, size);
+  readback->size      = size;
+  readback->state     = Readback_State_Recorded;
+  readback->callback  = callback;
+  readback->user_data = user_data;
+
+  return true;
+}
+
+static void readback_map_callback(WGPUBufferMapAsyncStatus status,
+                                  void* user_data)
+{
+  wgpu_readback_t* readback = (wgpu_readback_t*)user_data;
+  if (readback->state != Readback_State_Mapping) {
+    return;
+  }
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    readback->state = Readback_State_Mapped;
+  }
+  else {
+    log_warn("Readback buffer mapping failed (status %d)\n", (int)status);
+    readback->state = Readback_State_Failed;
+  }
+}
+
+static void readback_deliver(wgpu_readback_t* readback)
+{
+  if (readback->state == Readback_State_Mapped) {
+    const void* data
+      = wgpuBufferGetConstMappedRange(readback->buffer, 0, readback->size);
+    ASSERT(data != NULL);
+    readback->callback(data, readback->size, readback->user_data);
+    wgpuBufferUnmap(readback->buffer);
+  }
+  else {
+    readback->callback(NULL, 0, readback->user_data);
+  }
+  /* Available after the callback, a readback requested by the callback uses
+   * another buffer */
+  readback->state = Readback_State_Available;
+}
+
+void wgpu_readback_pool_tick(wgpu_readback_pool_t* pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+
+  /* Deliver the readbacks mapped since the last tick */
+  for (uint32_t i = 0; i < pool->readback_count; ++i) {
+    wgpu_readback_t* readback = pool->readbacks[i];
+    if (readback->state == Readback_State_Mapped
+        || readback->state == Readback_State_Failed) {
+      readback_deliver(readback);
+    }
+  }
+
+  /* Submit the copies recorded since the last tick */
+  if (pool->encoder == NULL) {
+    return;
+  }
+  WGPUCommandBuffer copy = wgpu_get_command_buffer(pool->encoder);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, pool->encoder)
+  wgpuQueueSubmit(pool->wgpu_context->queue, 1, &copy);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, copy)
+
+  /* Async function, the buffers are delivered by a later tick */
+  for (uint32_t i = 0; i < pool->readback_count; ++i) {
+    wgpu_readback_t* readback = pool->readbacks[i];
+    if (readback->state == Readback_State_Recorded) {
+      readback->state = Readback_State_Mapping;
+      wgpuBufferMapAsync(readback->buffer, WGPUMapMode_Read, 0,
+                         readback->bucket_size, readback_map_callback,
+                         readback);
+    }
+  }
+}
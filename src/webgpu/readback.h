@@ -0,0 +1,57 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "context.h"
+
+#define WGPU_READBACK_POOL_MIN_BUCKET_SIZE 256u
+#define WGPU_READBACK_POOL_MAX_BUFFER_COUNT 64u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU readback pool
+ *
+ * Asynchronous GPU to CPU buffer readbacks without stalls. A readback copies
+ * the buffer range into a MapRead | CopyDst buffer of the pool (power-of-two
+ * size buckets). wgpu_readback_pool_tick(), called once per frame by the
+ * render loop, submits the copies recorded since the last tick, so they read
+ * the contents at the end of the frame, requests the mapping and delivers the
+ * mapped readbacks to their callbacks. The results arrive some frames later,
+ * the tick never waits for the GPU.
+ *
+ * The readbacks of an example are dropped without callback by
+ * wgpu_context_reset().
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_readback_pool wgpu_readback_pool_t;
+
+/**
+ * @brief Readback result callback, called from wgpu_readback_pool_tick().
+ * @param data the mapped data, only valid during the callback, NULL if the
+ * mapping failed, e.g. when the device was lost
+ */
+typedef void (*wgpu_readback_callback_t)(const void* data, uint64_t size,
+                                         void* user_data);
+
+/* Readback pool creating / releasing, pending readbacks are dropped */
+wgpu_readback_pool_t*
+wgpu_readback_pool_create(wgpu_context_t* wgpu_context);
+void wgpu_readback_pool_release(wgpu_readback_pool_t* pool);
+
+/**
+ * @brief Reads a buffer range back to the CPU. The buffer requires the CopySrc
+ * usage, the offset and the size must be multiples of 4. The pool of the
+ * context is created on the first readback.
+ * @return false if all buffers of the pool are in flight
+ */
+bool wgpu_buffer_read_async(wgpu_context_t* wgpu_context, WGPUBuffer buffer,
+                            uint64_t offset, uint64_t size,
+                            wgpu_readback_callback_t callback,
+                            void* user_data);
+
+/**
+ * @brief Delivers the mapped readbacks and submits the recorded copies, must
+ * be called after the last submit of a frame. This is done by the render loop
+ * of the examples.
+ */
+void wgpu_readback_pool_tick(wgpu_readback_pool_t* pool);
+
+#endif /* READBACK_H */
@@ -0,0 +1,127 @@
+#include "render_bundle_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+/**
+ * @brief Render bundle cache class
+ */
+struct wgpu_render_bundle_cache {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  uint32_t color_format_count;
+  WGPUTextureFormat color_formats[WGPU_RENDER_BUNDLE_CACHE_MAX_COLOR_FORMATS];
+  WGPUTextureFormat depth_stencil_format;
+  uint32_t sample_count;
+  wgpu_render_bundle_record_func_t record_func;
+  void* user_data;
+  const void* dependencies[WGPU_RENDER_BUNDLE_CACHE_MAX_DEPENDENCIES];
+  WGPURenderBundle bundle;
+  uint32_t record_count;
+};
+
+/* Render bundle cache creating / destroying */
+
+wgpu_render_bundle_cache_t*
+wgpu_render_bundle_cache_create(wgpu_context_t* wgpu_context,
+                                const wgpu_render_bundle_cache_desc_t* desc)
+{
+  ASSERT(desc->record_func != NULL);
+  ASSERT(desc->color_format_count
+         <= WGPU_RENDER_BUNDLE_CACHE_MAX_COLOR_FORMATS);
+
+  wgpu_render_bundle_cache_t* cache
+    = (wgpu_render_bundle_cache_t*)malloc(sizeof(*cache));
+  memset(cache, 0, sizeof(*cache));
+  cache->wgpu_context         = wgpu_context;
+  cache->label                = desc->label;
+  cache->color_format_count   = desc->color_format_count;
+  cache->depth_stencil_format = desc->depth_stencil_format;
+  cache->sample_count = desc->sample_count > 0 ? desc->sample_count : 1;
+  cache->record_func  = desc->record_func;
+  cache->user_data    = desc->user_data;
+  if (desc->color_format_count > 0) {
+    memcpy(cache->color_formats, desc->color_formats,
+           desc->color_format_count * sizeof(WGPUTextureFormat));
+  }
+
+  return cache;
+}
+
+void wgpu_render_bundle_cache_destroy(wgpu_render_bundle_cache_t* cache)
+{
+  if (cache == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(RenderBundle, cache->bundle)
+  free(cache);
+}
+
+/* Render bundle cache invalidation */
+
+void wgpu_render_bundle_cache_invalidate(wgpu_render_bundle_cache_t* cache)
+{
+  WGPU_RELEASE_RESOURCE(RenderBundle, cache->bundle)
+}
+
+void wgpu_render_bundle_cache_set_dependency(wgpu_render_bundle_cache_t* cache,
+                                             uint32_t index,
+                                             const void* handle)
+{
+  ASSERT(index < WGPU_RENDER_BUNDLE_CACHE_MAX_DEPENDENCIES);
+
+  if (cache->dependencies[index] != handle) {
+    cache->dependencies[index] = handle;
+    wgpu_render_bundle_cache_invalidate(cache);
+  }
+}
+
+/* Render bundle recording / executing */
+
+static void record_bundle(wgpu_render_bundle_cache_t* cache)
+{
+  WGPURenderBundleEncoder bundle_encoder = wgpuDeviceCreateRenderBundleEncoder(
+    cache->wgpu_context->device,
+    &(WGPURenderBundleEncoderDescriptor){
+      .label              = cache->label,
+      .colorFormatsCount  = cache->color_format_count,
+      .colorFormats       = cache->color_formats,
+      .depthStencilFormat = cache->depth_stencil_format,
+      .sampleCount        = cache->sample_count,
+    });
+  cache->record_func(bundle_encoder, cache->user_data);
+  cache->bundle = wgpuRenderBundleEncoderFinish(
+    bundle_encoder, &(WGPURenderBundleDescriptor){
+                      .label = cache->label,
+                    });
+  ASSERT(cache->bundle != NULL);
+  ++cache->record_count;
+
+  WGPU_RELEASE_RESOURCE(RenderBundleEncoder, bundle_encoder)
+}
+
+WGPURenderBundle
+wgpu_render_bundle_cache_get_bundle(wgpu_render_bundle_cache_t* cache)
+{
+  if (cache->bundle == NULL) {
+    record_bundle(cache);
+  }
+  return cache->bundle;
+}
+
+void wgpu_render_bundle_cache_execute(wgpu_render_bundle_cache_t* cache,
+                                      WGPURenderPassEncoder rpass_enc)
+{
+  const WGPURenderBundle bundles[1]
+    = {wgpu_render_bundle_cache_get_bundle(cache)};
+  wgpuRenderPassEncoderExecuteBundles(rpass_enc, 1, bundles);
+}
+
+uint32_t
+wgpu_render_bundle_cache_get_record_count(wgpu_render_bundle_cache_t* cache)
+{
+  return cache->record_count;
+}
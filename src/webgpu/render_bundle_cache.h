@@ -0,0 +1,78 @@
+#ifndef RENDER_BUNDLE_CACHE_H
+#define RENDER_BUNDLE_CACHE_H
+
+#include "context.h"
+
+#define WGPU_RENDER_BUNDLE_CACHE_MAX_COLOR_FORMATS 8u
+#define WGPU_RENDER_BUNDLE_CACHE_MAX_DEPENDENCIES 8u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU render bundle cache
+ *
+ * Records the draw commands of static geometry once into a render bundle and
+ * replays the bundle in the following frames, which reduces the per-frame CPU
+ * encoding cost to a single ExecuteBundles call, e.g.:
+ *
+ *   wgpu_render_bundle_cache_set_dependency(cache, 0, pipeline);
+ *   wgpu_render_bundle_cache_set_dependency(cache, 1, bind_group);
+ *   wgpu_render_bundle_cache_execute(cache, rpass_enc);
+ *
+ * The commands are recorded by the record callback of the descriptor, lazily
+ * on the first execute after creating or invalidating the cache. The handles
+ * of the objects the commands use (pipelines, bind groups, buffers) can be
+ * registered as dependencies, setting a dependency to a different handle
+ * invalidates the bundle. Changes the cache cannot observe, e.g. of the draw
+ * count, have to be signaled with wgpu_render_bundle_cache_invalidate.
+ *
+ * The color formats, depth stencil format and sample count have to match the
+ * render pass the bundle is executed in.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_render_bundle_cache wgpu_render_bundle_cache_t;
+
+typedef void (*wgpu_render_bundle_record_func_t)(
+  WGPURenderBundleEncoder bundle_encoder, void* user_data);
+
+typedef struct wgpu_render_bundle_cache_desc_t {
+  const char* label;
+  uint32_t color_format_count;
+  const WGPUTextureFormat* color_formats;
+  /* WGPUTextureFormat_Undefined for render passes without depth attachment */
+  WGPUTextureFormat depth_stencil_format;
+  /* 0 = 1 sample */
+  uint32_t sample_count;
+  wgpu_render_bundle_record_func_t record_func;
+  void* user_data;
+} wgpu_render_bundle_cache_desc_t;
+
+/* Render bundle cache creating / destroying */
+wgpu_render_bundle_cache_t*
+wgpu_render_bundle_cache_create(wgpu_context_t* wgpu_context,
+                                const wgpu_render_bundle_cache_desc_t* desc);
+void wgpu_render_bundle_cache_destroy(wgpu_render_bundle_cache_t* cache);
+
+/* Re-records the bundle on the next execute */
+void wgpu_render_bundle_cache_invalidate(wgpu_render_bundle_cache_t* cache);
+
+/**
+ * @brief Sets the handle of a dependency of the recorded commands, the bundle
+ * is invalidated if the handle differs from the one of the last call.
+ * @param index dependency slot, < WGPU_RENDER_BUNDLE_CACHE_MAX_DEPENDENCIES
+ */
+void wgpu_render_bundle_cache_set_dependency(wgpu_render_bundle_cache_t* cache,
+                                             uint32_t index,
+                                             const void* handle);
+
+/* Returns the render bundle, recorded first if the cache is invalid */
+WGPURenderBundle
+wgpu_render_bundle_cache_get_bundle(wgpu_render_bundle_cache_t* cache);
+
+/* Executes the render bundle in the render pass, recorded first if invalid */
+void wgpu_render_bundle_cache_execute(wgpu_render_bundle_cache_t* cache,
+                                      WGPURenderPassEncoder rpass_enc);
+
+/* Number of times the bundle was recorded */
+uint32_t
+wgpu_render_bundle_cache_get_record_count(wgpu_render_bundle_cache_t* cache);
+
+#endif /* RENDER_BUNDLE_CACHE_H */
@@ -0,0 +1,174 @@
+#include "sampler_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+#define SAMPLER_CACHE_BUCKET_COUNT 64u
+
+typedef struct sampler_key_t {
+  WGPUAddressMode address_mode_u;
+  WGPUAddressMode address_mode_v;
+  WGPUAddressMode address_mode_w;
+  WGPUFilterMode mag_filter;
+  WGPUFilterMode min_filter;
+  WGPUFilterMode mipmap_filter;
+  float lod_min_clamp;
+  float lod_max_clamp;
+  WGPUCompareFunction compare;
+  uint16_t max_anisotropy;
+} sampler_key_t;
+
+typedef struct sampler_cache_entry_t {
+  struct sampler_cache_entry_t* next;
+  uint64_t hash;
+  sampler_key_t key;
+  WGPUSampler sampler;
+} sampler_cache_entry_t;
+
+struct wgpu_sampler_cache {
+  WGPUDevice device;
+  sampler_cache_entry_t* buckets[SAMPLER_CACHE_BUCKET_COUNT];
+  uint32_t count;
+};
+
+/* Key hashing / comparison */
+
+/* 64-bit FNV-1a */
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static sampler_key_t sampler_key(const WGPUSamplerDescriptor* descriptor)
+{
+  return (sampler_key_t){
+    .address_mode_u = descriptor->addressModeU,
+    .address_mode_v = descriptor->addressModeV,
+    .address_mode_w = descriptor->addressModeW,
+    .mag_filter     = descriptor->magFilter,
+    .min_filter     = descriptor->minFilter,
+    .mipmap_filter  = descriptor->mipmapFilter,
+    .lod_min_clamp  = descriptor->lodMinClamp,
+    .lod_max_clamp  = descriptor->lodMaxClamp,
+    .compare        = descriptor->compare,
+    .max_anisotropy = descriptor->maxAnisotropy,
+  };
+}
+
+static bool sampler_key_equal(const sampler_key_t* a, const sampler_key_t* b)
+{
+  return a->address_mode_u == b->address_mode_u
+         && a->address_mode_v == b->address_mode_v
+         && a->address_mode_w == b->address_mode_w
+         && a->mag_filter == b->mag_filter && a->min_filter == b->min_filter
+         && a->mipmap_filter == b->mipmap_filter
+         && a->lod_min_clamp == b->lod_min_clamp
+         && a->lod_max_clamp == b->lod_max_clamp && a->compare == b->compare
+         && a->max_anisotropy == b->max_anisotropy;
+}
+
+/* The fields are hashed one by one, the key contains padding */
+static uint64_t sampler_key_hash(const sampler_key_t* key)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  hash = hash_bytes(hash, &key->address_mode_u, sizeof(key->address_mode_u));
+  hash = hash_bytes(hash, &key->address_mode_v, sizeof(key->address_mode_v));
+  hash = hash_bytes(hash, &key->address_mode_w, sizeof(key->address_mode_w));
+  hash = hash_bytes(hash, &key->mag_filter, sizeof(key->mag_filter));
+  hash = hash_bytes(hash, &key->min_filter, sizeof(key->min_filter));
+  hash = hash_bytes(hash, &key->mipmap_filter, sizeof(key->mipmap_filter));
+  hash = hash_bytes(hash, &key->lod_min_clamp, sizeof(key->lod_min_clamp));
+  hash = hash_bytes(hash, &key->lod_max_clamp, sizeof(key->lod_max_clamp));
+  hash = hash_bytes(hash, &key->compare, sizeof(key->compare));
+  hash = hash_bytes(hash, &key->max_anisotropy, sizeof(key->max_anisotropy));
+  return hash;
+}
+
+/* Sampler cache creating / releasing */
+
+static wgpu_sampler_cache_t* sampler_cache_get(wgpu_context_t* wgpu_context)
+{
+  wgpu_sampler_cache_t* cache = wgpu_context->sampler_cache;
+  if (cache != NULL && cache->device != wgpu_context->device) {
+    // Samplers of another device can not be shared
+    wgpu_sampler_cache_release(cache);
+    cache = NULL;
+  }
+  if (cache == NULL) {
+    cache         = (wgpu_sampler_cache_t*)calloc(1, sizeof(*cache));
+    cache->device = wgpu_context->device;
+  }
+  wgpu_context->sampler_cache = cache;
+  return cache;
+}
+
+void wgpu_sampler_cache_release(wgpu_sampler_cache_t* sampler_cache)
+{
+  if (sampler_cache == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < SAMPLER_CACHE_BUCKET_COUNT; ++i) {
+    sampler_cache_entry_t* entry = sampler_cache->buckets[i];
+    while (entry != NULL) {
+      sampler_cache_entry_t* next = entry->next;
+      WGPU_RELEASE_RESOURCE(Sampler, entry->sampler)
+      free(entry);
+      entry = next;
+    }
+  }
+  free(sampler_cache);
+}
+
+/* Sampler cache lookup / insertion */
+
+WGPUSampler wgpu_create_sampler(wgpu_context_t* wgpu_context,
+                                const WGPUSamplerDescriptor* descriptor)
+{
+  if (descriptor == NULL || descriptor->nextInChain != NULL) {
+    return wgpuDeviceCreateSampler(wgpu_context->device, descriptor);
+  }
+
+  wgpu_sampler_cache_t* cache  = sampler_cache_get(wgpu_context);
+  const sampler_key_t key      = sampler_key(descriptor);
+  const uint64_t hash          = sampler_key_hash(&key);
+  const uint32_t bucket        = hash % SAMPLER_CACHE_BUCKET_COUNT;
+  sampler_cache_entry_t* entry = cache->buckets[bucket];
+  for (; entry != NULL; entry = entry->next) {
+    if (entry->hash == hash && sampler_key_equal(&entry->key, &key)) {
+      wgpuSamplerReference(entry->sampler);
+      return entry->sampler;
+    }
+  }
+
+  WGPUSampler sampler
+    = wgpuDeviceCreateSampler(wgpu_context->device, descriptor);
+  if (sampler == NULL) {
+    return NULL;
+  }
+
+  /* The entry holds its own reference */
+  wgpuSamplerReference(sampler);
+  entry = (sampler_cache_entry_t*)malloc(sizeof(sampler_cache_entry_t));
+  entry->hash            = hash;
+  entry->key             = key;
+  entry->sampler         = sampler;
+  entry->next            = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+  ++cache->count;
+  return sampler;
+}
+
+uint32_t wgpu_sampler_cache_get_count(wgpu_context_t* wgpu_context)
+{
+  return wgpu_context->sampler_cache != NULL ?
+           wgpu_context->sampler_cache->count :
+           0;
+}
@@ -0,0 +1,32 @@
+#ifndef SAMPLER_CACHE_H
+#define SAMPLER_CACHE_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU sampler cache
+ *
+ * Deduplicates samplers per device: textures loaded with the same options
+ * share one sampler instead of creating one each, which also lets the bind
+ * groups of these textures share more entries in the bind group cache. The
+ * key is the full sampler descriptor without the label, descriptors with
+ * chained structs are not cached.
+ *
+ * Samplers hold no references to other resources, the cached samplers are
+ * kept until the cache is released with the context.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_sampler_cache wgpu_sampler_cache_t;
+
+/* Sampler cache releasing */
+void wgpu_sampler_cache_release(wgpu_sampler_cache_t* sampler_cache);
+
+/* Replacement of wgpuDeviceCreateSampler, every returned sampler holds its own
+ * reference and is released as usual */
+WGPUSampler wgpu_create_sampler(wgpu_context_t* wgpu_context,
+                                const WGPUSamplerDescriptor* descriptor);
+
+/* Number of distinct samplers in the cache */
+uint32_t wgpu_sampler_cache_get_count(wgpu_context_t* wgpu_context);
+
+#endif /* SAMPLER_CACHE_H */
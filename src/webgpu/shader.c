@@ -7,6 +7,8 @@
 #include "../core/log.h"
 #include "../core/macro.h"
 
+#include "shader_watch.h"
+
 static void
 wgpu_compilation_info_callback(WGPUCompilationInfoRequestStatus status,
                                WGPUCompilationInfo const* compilationInfo,
@@ -25,13 +27,18 @@ wgpu_compilation_info_callback(WGPUCompilationInfoRequestStatus status,
 WGPUShaderModule wgpu_create_shader_module_from_spirv_file(WGPUDevice device,
                                                            const char* filename)
 {
-  file_read_result_t result;
-  read_file(filename, &result, 0);
-  log_debug("Read file: %s, size: %d bytes\n", filename, result.size);
+  // The bytecode is passed straight from the mapped pages
+  file_mapping_t mapping = {0};
+  const int error        = file_map(filename, &mapping);
+  if (error != 0) {
+    log_error("Unable to map file '%s': %s", filename, strerror(error));
+    return NULL;
+  }
+  log_debug("Mapped file: %s, size: %zu bytes\n", filename, mapping.size);
   WGPUShaderModule shader_module
-    = wgpu_create_shader_module_from_spirv_bytecode(device, result.data,
-                                                    result.size);
-  free(result.data);
+    = wgpu_create_shader_module_from_spirv_bytecode(device, mapping.data,
+                                                    (uint32_t)mapping.size);
+  file_unmap(&mapping);
   return shader_module;
 }
 
@@ -47,39 +54,233 @@ WGPUShaderModule wgpu_create_shader_module_from_wgsl_file(WGPUDevice device,
   return shader_module;
 }
 
+/* -------------------------------------------------------------------------- *
+ * Shader module cache
+ * -------------------------------------------------------------------------- */
+
+#define SHADER_CACHE_INITIAL_CAPACITY 32u
+
+typedef enum shader_source_type_t {
+  ShaderSourceType_File    = 0,
+  ShaderSourceType_SPIRV   = 1,
+  ShaderSourceType_WGSL    = 2,
+  ShaderSourceType_Invalid = 3,
+} shader_source_type_t;
+
+/* Identifies the source of a shader module, a module contains all entry
+ * points so the entry point is not part of the key */
+typedef struct shader_cache_key_t {
+  shader_source_type_t type;
+  uint64_t hash;
+  uint64_t size;
+} shader_cache_key_t;
+
+typedef struct shader_cache_entry_t {
+  shader_cache_key_t key;
+  char* filename;          /* file sources only, compared on lookup */
+  WGPUShaderModule module; /* the cache holds one reference */
+} shader_cache_entry_t;
+
+struct wgpu_shader_cache {
+  WGPUDevice device;
+  shader_cache_entry_t* entries;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+static uint64_t shader_cache_hash(const void* data, size_t size)
+{
+  /* 64-bit FNV-1a */
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint64_t hash        = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static shader_cache_key_t
+shader_cache_get_key(const wgpu_shader_desc_t* shader_desc)
+{
+  shader_cache_key_t key = {.type = ShaderSourceType_Invalid};
+  if (shader_desc->file != NULL) {
+    key.type = ShaderSourceType_File;
+    key.size = strlen(shader_desc->file);
+    key.hash = shader_cache_hash(shader_desc->file, key.size);
+  }
+  else if ((shader_desc->byte_code.data != NULL)
+           && (shader_desc->byte_code.size != 0)) {
+    key.type = ShaderSourceType_SPIRV;
+    key.size = shader_desc->byte_code.size;
+    key.hash = shader_cache_hash(shader_desc->byte_code.data, key.size);
+  }
+  else if (shader_desc->wgsl_code.source != NULL) {
+    key.type = ShaderSourceType_WGSL;
+    key.size = strlen(shader_desc->wgsl_code.source);
+    key.hash = shader_cache_hash(shader_desc->wgsl_code.source, key.size);
+  }
+  return key;
+}
+
+static wgpu_shader_cache_t* shader_cache_get(wgpu_context_t* wgpu_context)
+{
+  wgpu_shader_cache_t* cache = wgpu_context->shader_cache;
+  if (cache != NULL && cache->device != wgpu_context->device) {
+    // Modules of another device can not be shared
+    wgpu_shader_cache_release(cache);
+    cache = NULL;
+  }
+  if (cache == NULL) {
+    cache         = (wgpu_shader_cache_t*)calloc(1, sizeof(*cache));
+    cache->device = wgpu_context->device;
+  }
+  wgpu_context->shader_cache = cache;
+  return cache;
+}
+
+static WGPUShaderModule shader_cache_find(wgpu_shader_cache_t* cache,
+                                          const shader_cache_key_t* key,
+                                          const char* filename)
+{
+  for (uint32_t i = 0; i < cache->count; ++i) {
+    const shader_cache_entry_t* entry = &cache->entries[i];
+    if (entry->key.type == key->type && entry->key.hash == key->hash
+        && entry->key.size == key->size
+        && (filename == NULL || strcmp(entry->filename, filename) == 0)) {
+      return entry->module;
+    }
+  }
+  return NULL;
+}
+
+static void shader_cache_insert(wgpu_shader_cache_t* cache,
+                                const shader_cache_key_t* key,
+                                const char* filename, WGPUShaderModule module)
+{
+  if (cache->count == cache->capacity) {
+    cache->capacity = cache->capacity ? cache->capacity * 2 :
+                                        SHADER_CACHE_INITIAL_CAPACITY;
+    cache->entries  = (shader_cache_entry_t*)realloc(
+      cache->entries, cache->capacity * sizeof(shader_cache_entry_t));
+  }
+  shader_cache_entry_t* entry = &cache->entries[cache->count++];
+  *entry                      = (shader_cache_entry_t){
+    .key    = *key,
+    .module = module,
+  };
+  if (filename != NULL) {
+    entry->filename = (char*)malloc(key->size + 1);
+    memcpy(entry->filename, filename, key->size + 1);
+  }
+  wgpuShaderModuleReference(module);
+}
+
+static WGPUShaderModule shader_create_module_from_file(WGPUDevice device,
+                                                       const char* filename)
+{
+  if (filename_has_extension(filename, "spv")) {
+    return wgpu_create_shader_module_from_spirv_file(device, filename);
+  }
+  else if (filename_has_extension(filename, "wgsl")) {
+    return wgpu_create_shader_module_from_wgsl_file(device, filename);
+  }
+  return NULL;
+}
+
+void wgpu_shader_cache_release(wgpu_shader_cache_t* cache)
+{
+  if (cache == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < cache->count; ++i) {
+    free(cache->entries[i].filename);
+    WGPU_RELEASE_RESOURCE(ShaderModule, cache->entries[i].module)
+  }
+  free(cache->entries);
+  free(cache);
+}
+
 WGPUShaderModule
 wgpu_create_shader_module(wgpu_context_t* wgpu_context,
                           const wgpu_shader_desc_t* shader_desc)
 {
-  WGPUShaderModule shader_module = NULL;
+  const shader_cache_key_t key = shader_cache_get_key(shader_desc);
+  if (key.type == ShaderSourceType_Invalid) {
+    return NULL;
+  }
 
-  if (shader_desc->file != NULL) {
+  // Modules are shared between all pipelines using the same source
+  wgpu_shader_cache_t* cache = shader_cache_get(wgpu_context);
+  WGPUShaderModule shader_module
+    = shader_cache_find(cache, &key, shader_desc->file);
+  if (shader_module != NULL) {
+    wgpuShaderModuleReference(shader_module);
+    return shader_module;
+  }
+
+  if (key.type == ShaderSourceType_File) {
     /* WebGPU Shader from file */
-    if (filename_has_extension(shader_desc->file, "spv")) {
-      shader_module = wgpu_create_shader_module_from_spirv_file(
-        wgpu_context->device, shader_desc->file);
-    }
-    else if (filename_has_extension(shader_desc->file, "wgsl")) {
-      shader_module = wgpu_create_shader_module_from_wgsl_file(
-        wgpu_context->device, shader_desc->file);
+    shader_module
+      = shader_create_module_from_file(wgpu_context->device, shader_desc->file);
+    if (shader_module != NULL && wgpu_context->shader_watch != NULL) {
+      wgpu_shader_watch_add_file(wgpu_context->shader_watch, shader_desc->file);
     }
   }
-  else if ((shader_desc->byte_code.data != NULL)
-           && (shader_desc->byte_code.size != 0)) {
+  else if (key.type == ShaderSourceType_SPIRV) {
     /* WebGPU Shader from SPIR-V bytecode */
     shader_module = wgpu_create_shader_module_from_spirv_bytecode(
       wgpu_context->device, shader_desc->byte_code.data,
       shader_desc->byte_code.size);
   }
-  else if (shader_desc->wgsl_code.source != NULL) {
+  else {
     /* WebGPU Shader from WGSL code */
     shader_module = wgpu_create_shader_module_from_wgsl(
       wgpu_context->device, shader_desc->wgsl_code.source);
   }
 
+  if (shader_module != NULL) {
+    shader_cache_insert(cache, &key,
+                        key.type == ShaderSourceType_File ? shader_desc->file :
+                                                            NULL,
+                        shader_module);
+  }
+
   return shader_module;
 }
 
+WGPUShaderModule
+wgpu_shader_cache_reload_file(wgpu_context_t* wgpu_context,
+                              const char* filename,
+                              WGPUShaderModule* previous_module)
+{
+  *previous_module           = NULL;
+  wgpu_shader_cache_t* cache = wgpu_context->shader_cache;
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  const size_t length = strlen(filename);
+  const uint64_t hash = shader_cache_hash(filename, length);
+  for (uint32_t i = 0; i < cache->count; ++i) {
+    shader_cache_entry_t* entry = &cache->entries[i];
+    if (entry->key.type != ShaderSourceType_File || entry->key.hash != hash
+        || entry->key.size != length || strcmp(entry->filename, filename)) {
+      continue;
+    }
+    WGPUShaderModule module
+      = shader_create_module_from_file(cache->device, filename);
+    if (module == NULL) {
+      return NULL;
+    }
+    // Modules created from now on use the new source
+    *previous_module = entry->module;
+    entry->module    = module;
+    wgpuShaderModuleReference(module);
+    return module;
+  }
+  return NULL;
+}
+
 WGPUShaderModule wgpu_create_shader_module_from_spirv_bytecode(
   WGPUDevice device, const uint8_t* data, const uint32_t size)
 {
@@ -127,6 +328,110 @@ WGPUShaderModule wgpu_create_shader_module_from_wgsl(WGPUDevice device,
   return shader_module;
 }
 
+uint32_t wgpu_get_workgroup_size(wgpu_context_t* wgpu_context,
+                                 uint32_t preferred_size,
+                                 uint32_t dimension_count)
+{
+  ASSERT(preferred_size > 0 && dimension_count >= 1 && dimension_count <= 3);
+
+  WGPUSupportedLimits supported_limits = {0};
+  if (!wgpuDeviceGetLimits(wgpu_context->device, &supported_limits)) {
+    return preferred_size;
+  }
+  const WGPULimits* limits   = &supported_limits.limits;
+  const uint32_t max_size[3] = {
+    limits->maxComputeWorkgroupSizeX,
+    limits->maxComputeWorkgroupSizeY,
+    limits->maxComputeWorkgroupSizeZ,
+  };
+
+  uint32_t size = 1;
+  while (size * 2 <= preferred_size) {
+    size *= 2;
+  }
+  for (; size > 1; size /= 2) {
+    bool fits            = true;
+    uint64_t invocations = 1;
+    for (uint32_t d = 0; d < dimension_count; ++d) {
+      fits = fits && size <= max_size[d];
+      invocations *= size;
+    }
+    if (fits && invocations <= limits->maxComputeInvocationsPerWorkgroup) {
+      break;
+    }
+  }
+  return size;
+}
+
+/* Storage precision declarations, the arithmetic of the shaders stays f32 */
+// clang-format off
+static const char* storage_precision_wgsl[2] = {
+CODE(
+  alias StorageScalar = f32;
+  alias StorageVec4 = vec4<f32>;
+
+  fn to_storage(value : f32) -> StorageScalar {
+    return value;
+  }
+
+  fn to_storage_vec4(value : vec4<f32>) -> StorageVec4 {
+    return value;
+  }
+),
+CODE(
+  enable f16;
+
+  alias StorageScalar = f16;
+  alias StorageVec4 = vec4<f16>;
+
+  // Largest finite f16, larger values would be stored as infinity
+  const kStorageMax = 65504.0;
+
+  fn to_storage(value : f32) -> StorageScalar {
+    return StorageScalar(clamp(value, -kStorageMax, kStorageMax));
+  }
+
+  fn to_storage_vec4(value : vec4<f32>) -> StorageVec4 {
+    return StorageVec4(clamp(value, vec4<f32>(-kStorageMax),
+                             vec4<f32>(kStorageMax)));
+  }
+)};
+// clang-format on
+
+wgpu_shader_storage_precision_t
+wgpu_get_storage_precision(wgpu_context_t* wgpu_context,
+                           wgpu_shader_storage_precision_t preferred)
+{
+  if (preferred == Shader_StoragePrecision_F16
+      && !wgpu_has_feature(wgpu_context, WGPUFeatureName_DawnShaderFloat16)) {
+    return Shader_StoragePrecision_F32;
+  }
+  return preferred;
+}
+
+uint32_t
+wgpu_get_storage_scalar_size(wgpu_shader_storage_precision_t precision)
+{
+  return precision == Shader_StoragePrecision_F16 ? 2 : 4;
+}
+
+char* wgpu_add_storage_precision(const char* wgsl_source,
+                                 wgpu_shader_storage_precision_t precision)
+{
+  const char* prelude         = storage_precision_wgsl[precision];
+  const size_t prelude_length = strlen(prelude);
+  const size_t source_length  = strlen(wgsl_source);
+
+  /* The enable directive has to come first, the prelude is put in front */
+  char* source = (char*)malloc(prelude_length + 1 + source_length + 1);
+  ASSERT(source != NULL);
+  memcpy(source, prelude, prelude_length);
+  source[prelude_length] = '\n';
+  memcpy(source + prelude_length + 1, wgsl_source, source_length + 1);
+
+  return source;
+}
+
 wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
                                  const wgpu_shader_desc_t* desc)
 {
@@ -139,8 +444,10 @@ wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
   ASSERT(shader.module);
 
   shader.programmable_stage_descriptor = (WGPUProgrammableStageDescriptor){
-    .module     = shader.module,
-    .entryPoint = desc->entry ? desc->entry : "main",
+    .module        = shader.module,
+    .entryPoint    = desc->entry ? desc->entry : "main",
+    .constantCount = desc->constants.count,
+    .constants     = desc->constants.entries,
   };
 
   return shader;
@@ -168,9 +475,11 @@ WGPUVertexState wgpu_create_vertex_state(wgpu_context_t* wgpu_context,
   vertex_state.module = wgpu_create_shader_module(wgpu_context, shader_desc);
   ASSERT(vertex_state.module);
 
-  vertex_state.entryPoint  = shader_desc->entry ? shader_desc->entry : "main",
-  vertex_state.bufferCount = desc->buffer_count,
-  vertex_state.buffers     = desc->buffers;
+  vertex_state.entryPoint    = shader_desc->entry ? shader_desc->entry : "main",
+  vertex_state.constantCount = shader_desc->constants.count,
+  vertex_state.constants     = shader_desc->constants.entries,
+  vertex_state.bufferCount   = desc->buffer_count,
+  vertex_state.buffers       = desc->buffers;
 
   return vertex_state;
 }
@@ -191,9 +500,12 @@ WGPUFragmentState wgpu_create_fragment_state(wgpu_context_t* wgpu_context,
   fragment_state.module = wgpu_create_shader_module(wgpu_context, shader_desc);
   ASSERT(fragment_state.module);
 
-  fragment_state.entryPoint  = shader_desc->entry ? shader_desc->entry : "main",
-  fragment_state.targetCount = desc->target_count,
-  fragment_state.targets     = desc->targets;
+  fragment_state.entryPoint
+    = shader_desc->entry ? shader_desc->entry : "main",
+  fragment_state.constantCount = shader_desc->constants.count,
+  fragment_state.constants     = shader_desc->constants.entries,
+  fragment_state.targetCount   = desc->target_count,
+  fragment_state.targets       = desc->targets;
 
   return fragment_state;
 }
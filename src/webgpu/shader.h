@@ -15,6 +15,13 @@ typedef struct wgpu_shader_desc_t {
     const char* source;
   } wgsl_code; /* WGSL source code ( ref: https://www.w3.org/TR/WGSL ) */
   const char* entry;
+  /* Pipeline-overridable constants (WGSL override declarations), each set of
+   * values is a separate pipeline in the pipeline cache while the shader
+   * module is shared */
+  struct {
+    uint32_t count;
+    const WGPUConstantEntry* entries;
+  } constants;
 } wgpu_shader_desc_t;
 
 typedef struct wgpu_shader_t {
@@ -32,10 +39,58 @@ WGPUShaderModule wgpu_create_shader_module_from_spirv_bytecode(
   WGPUDevice device, const uint8_t* data, const uint32_t size);
 WGPUShaderModule wgpu_create_shader_module_from_wgsl(WGPUDevice device,
                                                      const char* source);
+/* Modules are cached per device and shared between callers using the same
+ * file, SPIR-V bytecode or WGSL source. Every returned module holds its own
+ * reference and is released as usual. */
 WGPUShaderModule
 wgpu_create_shader_module(wgpu_context_t* wgpu_context,
                           const wgpu_shader_desc_t* shader_desc);
 
+/* Shader module cache releasing */
+typedef struct wgpu_shader_cache wgpu_shader_cache_t;
+void wgpu_shader_cache_release(wgpu_shader_cache_t* cache);
+/* Recompiles the cached module of a shader file, used for shader hot reload.
+ * Returns a new reference on the new module and hands the cache reference on
+ * the previous module over to previous_module, NULL if the file is not
+ * cached. */
+WGPUShaderModule
+wgpu_shader_cache_reload_file(wgpu_context_t* wgpu_context,
+                              const char* filename,
+                              WGPUShaderModule* previous_module);
+
+/**
+ * @brief Returns the largest power of two size not exceeding preferred_size
+ * for which a workgroup of size^dimension_count invocations fits the device
+ * limits, used to specialize the workgroup_size override of compute shaders.
+ */
+uint32_t wgpu_get_workgroup_size(wgpu_context_t* wgpu_context,
+                                 uint32_t preferred_size,
+                                 uint32_t dimension_count);
+
+/* Storage precision of the shaders with a half precision variant */
+typedef enum wgpu_shader_storage_precision_t {
+  Shader_StoragePrecision_F32 = 0,
+  Shader_StoragePrecision_F16 = 1,
+} wgpu_shader_storage_precision_t;
+
+/* Half precision needs the DawnShaderFloat16 feature, falls back to F32 */
+wgpu_shader_storage_precision_t
+wgpu_get_storage_precision(wgpu_context_t* wgpu_context,
+                           wgpu_shader_storage_precision_t preferred);
+/* Size in bytes of a StorageScalar of the precision */
+uint32_t
+wgpu_get_storage_scalar_size(wgpu_shader_storage_precision_t precision);
+/**
+ * @brief Prepends the storage precision declarations to a WGSL source:
+ *   - alias StorageScalar / StorageVec4, f16 or f32
+ *   - fn to_storage(f32) / to_storage_vec4(vec4<f32>), clamped to the f16
+ *     range, values are read back with f32() / vec4<f32>()
+ * The shaders do their arithmetic in f32, only their buffers change size. The
+ * returned string has to be freed.
+ */
+char* wgpu_add_storage_precision(const char* wgsl_source,
+                                 wgpu_shader_storage_precision_t precision);
+
 /* Shader creating/releasing */
 wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
                                  const wgpu_shader_desc_t* desc);
@@ -0,0 +1,196 @@
+#include "shader_watch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define SHADER_WATCH_SUPPORTED 1
+#else
+#define SHADER_WATCH_SUPPORTED 0
+#endif
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "pipeline_cache.h"
+#include "shader.h"
+
+#define SHADER_WATCH_INITIAL_CAPACITY 32u
+
+typedef struct shader_watch_file_t {
+  char* filename;
+  const char* name;     /* file name without the directory */
+  int watch_descriptor; /* watch of the directory containing the file */
+  bool changed;
+} shader_watch_file_t;
+
+struct wgpu_shader_watch {
+  int fd;
+  shader_watch_file_t* files;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+#if SHADER_WATCH_SUPPORTED
+
+wgpu_shader_watch_t* wgpu_shader_watch_create(void)
+{
+  const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    log_warn("Shader hot reload disabled, inotify_init1 failed: %s",
+             strerror(errno));
+    return NULL;
+  }
+
+  wgpu_shader_watch_t* shader_watch
+    = (wgpu_shader_watch_t*)calloc(1, sizeof(wgpu_shader_watch_t));
+  shader_watch->fd = fd;
+  return shader_watch;
+}
+
+void wgpu_shader_watch_release(wgpu_shader_watch_t* shader_watch)
+{
+  if (shader_watch == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < shader_watch->count; ++i) {
+    free(shader_watch->files[i].filename);
+  }
+  free(shader_watch->files);
+  close(shader_watch->fd);
+  free(shader_watch);
+}
+
+void wgpu_shader_watch_add_file(wgpu_shader_watch_t* shader_watch,
+                                const char* filename)
+{
+  for (uint32_t i = 0; i < shader_watch->count; ++i) {
+    if (strcmp(shader_watch->files[i].filename, filename) == 0) {
+      return;
+    }
+  }
+
+  // Editors often save by renaming a new file over the old one, so the
+  // directory is watched instead of the file. Watching the same directory
+  // again returns the existing watch descriptor.
+  const char* separator  = strrchr(filename, '/');
+  char directory[STRMAX] = ".";
+  if (separator != NULL) {
+    snprintf(directory, sizeof(directory), "%.*s",
+             (int)(separator - filename), filename);
+  }
+  const int watch_descriptor = inotify_add_watch(
+    shader_watch->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watch_descriptor < 0) {
+    log_warn("Failed to watch shader directory %s: %s", directory,
+             strerror(errno));
+    return;
+  }
+
+  if (shader_watch->count == shader_watch->capacity) {
+    shader_watch->capacity = shader_watch->capacity ?
+                               shader_watch->capacity * 2 :
+                               SHADER_WATCH_INITIAL_CAPACITY;
+    shader_watch->files    = (shader_watch_file_t*)realloc(
+      shader_watch->files,
+      shader_watch->capacity * sizeof(shader_watch_file_t));
+  }
+  const size_t length       = strlen(filename);
+  shader_watch_file_t* file = &shader_watch->files[shader_watch->count++];
+  file->filename            = (char*)malloc(length + 1);
+  memcpy(file->filename, filename, length + 1);
+  file->name = separator ? file->filename + (separator - filename) + 1 :
+                           file->filename;
+  file->watch_descriptor = watch_descriptor;
+  file->changed          = false;
+}
+
+/* Marks the watched files changed since the previous call */
+static bool shader_watch_poll(wgpu_shader_watch_t* shader_watch)
+{
+  bool changed = false;
+  union {
+    struct inotify_event event;
+    char data[4096];
+  } buffer;
+  ssize_t length = 0;
+  while ((length = read(shader_watch->fd, buffer.data, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const struct inotify_event* event
+        = (const struct inotify_event*)(buffer.data + offset);
+      offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+      if (event->len == 0) {
+        continue;
+      }
+      for (uint32_t i = 0; i < shader_watch->count; ++i) {
+        shader_watch_file_t* file = &shader_watch->files[i];
+        if (file->watch_descriptor == event->wd
+            && strcmp(file->name, event->name) == 0) {
+          file->changed = true;
+          changed       = true;
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+void wgpu_reload_changed_shaders(wgpu_context_t* wgpu_context)
+{
+  wgpu_shader_watch_t* shader_watch = wgpu_context->shader_watch;
+  if (shader_watch == NULL || !shader_watch_poll(shader_watch)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < shader_watch->count; ++i) {
+    shader_watch_file_t* file = &shader_watch->files[i];
+    if (!file->changed) {
+      continue;
+    }
+    file->changed = false;
+
+    WGPUShaderModule previous_module = NULL;
+    WGPUShaderModule module          = wgpu_shader_cache_reload_file(
+      wgpu_context, file->filename, &previous_module);
+    if (module == NULL) {
+      continue;
+    }
+    const uint32_t pipeline_count = wgpu_pipeline_cache_replace_module(
+      wgpu_context, previous_module, module);
+    log_info("Reloaded shader %s, recreating %u pipeline(s)", file->filename,
+             pipeline_count);
+    WGPU_RELEASE_RESOURCE(ShaderModule, previous_module)
+    WGPU_RELEASE_RESOURCE(ShaderModule, module)
+  }
+}
+
+#else
+
+wgpu_shader_watch_t* wgpu_shader_watch_create(void)
+{
+  log_warn("Shader hot reload is not supported on this platform");
+  return NULL;
+}
+
+void wgpu_shader_watch_release(wgpu_shader_watch_t* shader_watch)
+{
+  UNUSED_VAR(shader_watch);
+}
+
+void wgpu_shader_watch_add_file(wgpu_shader_watch_t* shader_watch,
+                                const char* filename)
+{
+  UNUSED_VAR(shader_watch);
+  UNUSED_VAR(filename);
+}
+
+void wgpu_reload_changed_shaders(wgpu_context_t* wgpu_context)
+{
+  UNUSED_VAR(wgpu_context);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SHADER_WATCH_H
+#define SHADER_WATCH_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * Shader hot reload
+ *
+ * Watches the shader files loaded with wgpu_create_shader_module() for
+ * changes (inotify, Linux only). A changed file is compiled into a new module
+ * and the pipelines using the previous module are recreated in the background,
+ * see wgpu_pipeline_cache_replace_module(). Pipelines keep rendering with the
+ * previous module until their replacement is ready or if it fails to compile.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_shader_watch wgpu_shader_watch_t;
+
+/* Shader watch creating/releasing, NULL if file watching is not supported */
+wgpu_shader_watch_t* wgpu_shader_watch_create(void);
+void wgpu_shader_watch_release(wgpu_shader_watch_t* shader_watch);
+
+/* Adds a file to the watch list, files already watched are ignored */
+void wgpu_shader_watch_add_file(wgpu_shader_watch_t* shader_watch,
+                                const char* filename);
+
+/* Reloads the shader files changed since the previous call, called once per
+ * frame */
+void wgpu_reload_changed_shaders(wgpu_context_t* wgpu_context);
+
+#endif
@@ -0,0 +1,206 @@
+#include "swap_chain_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/window.h"
+
+typedef struct wgpu_swap_chain_window_t {
+  window_t* window;
+  void* surface;
+  WGPUSwapChain swap_chain;
+  uint32_t width;
+  uint32_t height;
+  WGPUTextureView frame_buffer; /* NULL if not acquired in this frame */
+} wgpu_swap_chain_window_t;
+
+/**
+ * @brief Swap chain set class, window 0 is the window of the context
+ */
+struct wgpu_swap_chain_set {
+  wgpu_context_t* wgpu_context;
+  wgpu_swap_chain_window_t windows[WGPU_SWAP_CHAIN_SET_MAX_WINDOWS];
+  uint32_t window_count;
+};
+
+/* Swap chain set creating / destroying */
+
+wgpu_swap_chain_set_t* wgpu_swap_chain_set_create(wgpu_context_t* wgpu_context,
+                                                  window_t* window)
+{
+  wgpu_swap_chain_set_t* set
+    = (wgpu_swap_chain_set_t*)calloc(1, sizeof(wgpu_swap_chain_set_t));
+  set->wgpu_context      = wgpu_context;
+  set->windows[0].window = window;
+  set->window_count      = 1;
+
+  return set;
+}
+
+void wgpu_swap_chain_set_destroy(wgpu_swap_chain_set_t* set)
+{
+  if (set == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 1; i < set->window_count; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, set->windows[i].frame_buffer)
+    WGPU_RELEASE_RESOURCE(SwapChain, set->windows[i].swap_chain)
+  }
+  free(set);
+}
+
+/* Windows */
+
+static void swap_chain_set_create_swap_chain(wgpu_swap_chain_set_t* set,
+                                             wgpu_swap_chain_window_t* window,
+                                             WGPUPresentMode present_mode)
+{
+  wgpu_context_t* wgpu_context = set->wgpu_context;
+
+  WGPU_RELEASE_RESOURCE(SwapChain, window->swap_chain)
+  window->swap_chain = wgpuDeviceCreateSwapChain(
+    wgpu_context->device, window->surface,
+    &(WGPUSwapChainDescriptor){
+      .usage       = WGPUTextureUsage_RenderAttachment,
+      .format      = wgpu_context->swap_chain.format,
+      .width       = window->width,
+      .height      = window->height,
+      .presentMode = present_mode,
+    });
+  ASSERT(window->swap_chain);
+}
+
+int32_t wgpu_swap_chain_set_add_window(wgpu_swap_chain_set_t* set,
+                                       window_t* window)
+{
+  if (set->window_count >= WGPU_SWAP_CHAIN_SET_MAX_WINDOWS) {
+    log_warn("Swap chain set is full (%u windows)\n",
+             WGPU_SWAP_CHAIN_SET_MAX_WINDOWS);
+    return -1;
+  }
+
+  wgpu_swap_chain_window_t* set_window = &set->windows[set->window_count];
+  memset(set_window, 0, sizeof(*set_window));
+  set_window->window  = window;
+  set_window->surface = window_get_surface(window);
+  window_get_size(window, &set_window->width, &set_window->height);
+  swap_chain_set_create_swap_chain(set, set_window,
+                                   set->wgpu_context->swap_chain.present_mode);
+
+  return (int32_t)set->window_count++;
+}
+
+uint32_t wgpu_swap_chain_set_get_window_count(wgpu_swap_chain_set_t* set)
+{
+  return set->window_count;
+}
+
+window_t* wgpu_swap_chain_set_get_window(wgpu_swap_chain_set_t* set,
+                                         uint32_t index)
+{
+  ASSERT(index < set->window_count);
+  return set->windows[index].window;
+}
+
+void wgpu_swap_chain_set_resize(wgpu_swap_chain_set_t* set, uint32_t index,
+                                uint32_t width, uint32_t height)
+{
+  ASSERT(index < set->window_count);
+  if (index == 0) {
+    wgpu_resize_swap_chain(set->wgpu_context, width, height);
+    return;
+  }
+
+  wgpu_swap_chain_window_t* window = &set->windows[index];
+  if (width == 0 || height == 0
+      || (width == window->width && height == window->height)) {
+    return;
+  }
+  window->width  = width;
+  window->height = height;
+  swap_chain_set_create_swap_chain(set, window,
+                                   set->wgpu_context->swap_chain.present_mode);
+}
+
+void wgpu_swap_chain_set_get_size(wgpu_swap_chain_set_t* set, uint32_t index,
+                                  uint32_t* width, uint32_t* height)
+{
+  ASSERT(index < set->window_count);
+  if (index == 0) {
+    *width  = set->wgpu_context->surface.width;
+    *height = set->wgpu_context->surface.height;
+    return;
+  }
+  *width  = set->windows[index].width;
+  *height = set->windows[index].height;
+}
+
+void wgpu_swap_chain_set_recreate(wgpu_swap_chain_set_t* set)
+{
+  for (uint32_t i = 1; i < set->window_count; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, set->windows[i].frame_buffer)
+    swap_chain_set_create_swap_chain(
+      set, &set->windows[i], set->wgpu_context->swap_chain.present_mode);
+  }
+}
+
+/* Frames */
+
+WGPUTextureView
+wgpu_swap_chain_set_get_current_image(wgpu_swap_chain_set_t* set,
+                                      uint32_t index)
+{
+  ASSERT(index < set->window_count);
+  if (index == 0) {
+    return set->wgpu_context->swap_chain.frame_buffer != NULL ?
+             set->wgpu_context->swap_chain.frame_buffer :
+             wgpu_swap_chain_get_current_image(set->wgpu_context);
+  }
+
+  wgpu_swap_chain_window_t* window = &set->windows[index];
+  if (window->frame_buffer == NULL) {
+    window->frame_buffer
+      = wgpuSwapChainGetCurrentTextureView(window->swap_chain);
+  }
+  return window->frame_buffer;
+}
+
+void wgpu_swap_chain_set_present(wgpu_swap_chain_set_t* set)
+{
+  wgpu_context_t* wgpu_context = set->wgpu_context;
+  for (uint32_t i = 1; i < set->window_count; ++i) {
+    wgpu_swap_chain_window_t* window = &set->windows[i];
+    if (window->frame_buffer != NULL) {
+      wgpuSwapChainPresent(window->swap_chain);
+      WGPU_RELEASE_RESOURCE(TextureView, window->frame_buffer)
+    }
+    /* Follow the present mode change of window 0, which is applied by the
+     * present of the context */
+    if (wgpu_context->swap_chain.present_mode_changed) {
+      swap_chain_set_create_swap_chain(
+        set, window, wgpu_context->swap_chain.requested_present_mode);
+    }
+  }
+}
+
+/* View layout */
+
+int wgpu_swap_chain_set_layout_views(wgpu_swap_chain_set_t* set,
+                                     uint32_t view_count, float view_aspect,
+                                     uint32_t spacing, view_layout_t* layout)
+{
+  view_layout_desc_t desc = {
+    .view_count    = view_count,
+    .view_aspect   = view_aspect,
+    .display_count = set->window_count,
+    .spacing       = spacing,
+  };
+  for (uint32_t i = 0; i < set->window_count; ++i) {
+    wgpu_swap_chain_set_get_size(set, i, &desc.displays[i].width,
+                                 &desc.displays[i].height);
+  }
+  return view_layout_compute(&desc, layout);
+}
@@ -0,0 +1,79 @@
+#ifndef SWAP_CHAIN_SET_H
+#define SWAP_CHAIN_SET_H
+
+#include "../core/view_layout.h"
+#include "context.h"
+
+#define WGPU_SWAP_CHAIN_SET_MAX_WINDOWS VIEW_LAYOUT_MAX_DISPLAYS
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU swap chain set
+ *
+ * Renders to several windows with the device and queue of one context, e.g.
+ * the monitors of a monitoring wall driven by a single process. Window 0 is
+ * the window of the context, the added windows get their own swap chain of the
+ * context format and present mode.
+ *
+ * A frame records the passes of all windows into the command buffers of the
+ * frame and submits them once, then presents with
+ * wgpu_swap_chain_set_present() followed by wgpu_swap_chain_present(), which
+ * presents window 0 and ends the frame. The depth-stencil texture of the
+ * context has the size of window 0.
+ *
+ * The views are placed on the windows with a shared view layout (see
+ * view_layout.h), so N views of one large surface and N windows are the same
+ * code path.
+ * -------------------------------------------------------------------------- */
+
+struct window;
+
+typedef struct wgpu_swap_chain_set wgpu_swap_chain_set_t;
+
+/**
+ * @brief Swap chain set creating / destroying, the windows are not destroyed.
+ * @param window the window of the context surface, NULL if headless
+ */
+wgpu_swap_chain_set_t* wgpu_swap_chain_set_create(wgpu_context_t* wgpu_context,
+                                                  struct window* window);
+void wgpu_swap_chain_set_destroy(wgpu_swap_chain_set_t* set);
+
+/**
+ * @brief Adds a window, created with window_create().
+ * @return the index of the window or -1 if the set is full
+ */
+int32_t wgpu_swap_chain_set_add_window(wgpu_swap_chain_set_t* set,
+                                       struct window* window);
+uint32_t wgpu_swap_chain_set_get_window_count(wgpu_swap_chain_set_t* set);
+struct window* wgpu_swap_chain_set_get_window(wgpu_swap_chain_set_t* set,
+                                              uint32_t index);
+
+/* Recreates the swap chain of a window, a zero size (minimized window) keeps
+ * the swap chain */
+void wgpu_swap_chain_set_resize(wgpu_swap_chain_set_t* set, uint32_t index,
+                                uint32_t width, uint32_t height);
+void wgpu_swap_chain_set_get_size(wgpu_swap_chain_set_t* set, uint32_t index,
+                                  uint32_t* width, uint32_t* height);
+
+/* Recreates the swap chains of the added windows, after
+ * wgpu_recreate_device() */
+void wgpu_swap_chain_set_recreate(wgpu_swap_chain_set_t* set);
+
+/* Current image of a window, valid until the present of the frame */
+WGPUTextureView
+wgpu_swap_chain_set_get_current_image(wgpu_swap_chain_set_t* set,
+                                      uint32_t index);
+
+/* Presents the added windows whose image was acquired in this frame, called
+ * after the submit and before wgpu_swap_chain_present() */
+void wgpu_swap_chain_set_present(wgpu_swap_chain_set_t* set);
+
+/**
+ * @brief Places the views on the windows of the set, the displays of the
+ * layout are the windows.
+ * @return 0 on success, 1 if the view count is invalid
+ */
+int wgpu_swap_chain_set_layout_views(wgpu_swap_chain_set_t* set,
+                                     uint32_t view_count, float view_aspect,
+                                     uint32_t spacing, view_layout_t* layout);
+
+#endif /* SWAP_CHAIN_SET_H */
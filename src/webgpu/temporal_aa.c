@@ -0,0 +1,538 @@
+#include "temporal_aa.h"
+
+#include <stdlib.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
+#include "shader.h"
+
+#define TEMPORAL_AA_WORKGROUP_SIZE 8u
+#define TEMPORAL_AA_DEFAULT_CURRENT_WEIGHT 0.1f
+
+#define TEMPORAL_AA_FLAG_HISTORY_VALID 1u
+#define TEMPORAL_AA_FLAG_MOTION_VECTORS 2u
+#define TEMPORAL_AA_FLAG_REVERSED_Z 4u
+
+// clang-format off
+static const char* temporal_aa_shader_wgsl = CODE(
+  struct Params {
+    /* Previous view projection * inverse(view projection), unjittered */
+    reprojection  : mat4x4<f32>,
+    renderSize    : vec2<f32>,
+    outputSize    : vec2<f32>,
+    /* Offset of the samples in render texels, y down */
+    jitter        : vec2<f32>,
+    currentWeight : f32,
+    flags         : u32,
+  }
+
+  const FLAG_HISTORY_VALID  = 1u;
+  const FLAG_MOTION_VECTORS = 2u;
+  const FLAG_REVERSED_Z     = 4u;
+
+  @group(0) @binding(0) var<uniform> params : Params;
+  @group(0) @binding(1) var colorTexture : texture_2d<f32>;
+  @group(0) @binding(2) var depthTexture : texture_depth_2d;
+  @group(0) @binding(3) var motionTexture : texture_2d<f32>;
+  @group(0) @binding(4) var historyTexture : texture_2d<f32>;
+  @group(0) @binding(5) var historySampler : sampler;
+  @group(0) @binding(6) var outputTexture
+    : texture_storage_2d<rgba16float, write>;
+
+  fn luminance(c : vec3<f32>) -> f32 {
+    return dot(c, vec3<f32>(0.2126, 0.7152, 0.0722));
+  }
+
+  // Reversible tone mapping, bright samples don't dominate the filter and the
+  // neighborhood box
+  fn compress(c : vec3<f32>) -> vec3<f32> {
+    return c / (1.0 + luminance(c));
+  }
+
+  fn uncompress(c : vec3<f32>) -> vec3<f32> {
+    return c / max(1.0 - luminance(c), 1e-4);
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    if (any(vec2<f32>(id.xy) >= params.outputSize)) {
+      return;
+    }
+
+    let uv = (vec2<f32>(id.xy) + 0.5) / params.outputSize;
+    let position = uv * params.renderSize;
+    let renderMax = vec2<i32>(params.renderSize) - 1;
+    // Texel whose sample is nearest to the output pixel
+    let center = vec2<i32>(floor(position + params.jitter));
+    // Filter distances are measured in output pixels
+    let filterScale = max(params.outputSize / params.renderSize,
+                          vec2<f32>(1.0));
+    let reversedZ = (params.flags & FLAG_REVERSED_Z) != 0u;
+
+    var sum = vec3<f32>(0.0);
+    var weightSum = 0.0;
+    var m1 = vec3<f32>(0.0);
+    var m2 = vec3<f32>(0.0);
+    var closestTexel = clamp(center, vec2<i32>(0), renderMax);
+    var closestDepth = select(1.0, 0.0, reversedZ);
+    for (var y = -1; y <= 1; y++) {
+      for (var x = -1; x <= 1; x++) {
+        let texel = clamp(center + vec2<i32>(x, y), vec2<i32>(0), renderMax);
+        let c = compress(textureLoad(colorTexture, texel, 0).rgb);
+        let d = (vec2<f32>(texel) + 0.5 - params.jitter - position)
+                * filterScale;
+        let w = exp(-2.29 * dot(d, d));
+        sum += c * w;
+        weightSum += w;
+        m1 += c;
+        m2 += c * c;
+        let depth = textureLoad(depthTexture, texel, 0);
+        if (select(depth < closestDepth, depth > closestDepth, reversedZ)) {
+          closestDepth = depth;
+          closestTexel = texel;
+        }
+      }
+    }
+    let current = sum / max(weightSum, 1e-4);
+
+    // Variance box of the neighborhood
+    let mean = m1 / 9.0;
+    let sigma = sqrt(max(m2 / 9.0 - mean * mean, vec3<f32>(0.0)));
+    let boxMin = mean - 1.25 * sigma;
+    let boxMax = mean + 1.25 * sigma;
+
+    // Motion of the front-most surface of the neighborhood, the edges of
+    // moving objects keep their history
+    var motion : vec2<f32>;
+    if ((params.flags & FLAG_MOTION_VECTORS) != 0u) {
+      motion = textureLoad(motionTexture, closestTexel, 0).xy;
+    }
+    else {
+      let ndc = vec4<f32>(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, closestDepth,
+                          1.0);
+      let previous = params.reprojection * ndc;
+      let previousUv = previous.xy / previous.w * vec2<f32>(0.5, -0.5)
+                       + vec2<f32>(0.5);
+      motion = previousUv - uv;
+    }
+    let historyUv = uv + motion;
+
+    var result = current;
+    let onScreen = all(historyUv >= vec2<f32>(0.0))
+                   && all(historyUv <= vec2<f32>(1.0));
+    if ((params.flags & FLAG_HISTORY_VALID) != 0u && onScreen) {
+      let history = compress(
+        textureSampleLevel(historyTexture, historySampler, historyUv, 0.0).rgb);
+      result = mix(clamp(history, boxMin, boxMax), current,
+                   params.currentWeight);
+    }
+    textureStore(outputTexture, vec2<i32>(id.xy),
+                 vec4<f32>(uncompress(result), 1.0));
+  }
+);
+// clang-format on
+
+/* Uniforms of the resolve, matches the Params struct in WGSL */
+typedef struct temporal_aa_uniforms_t {
+  mat4 reprojection;
+  vec2 render_size;
+  vec2 output_size;
+  vec2 jitter;
+  float current_weight;
+  uint32_t flags;
+} temporal_aa_uniforms_t;
+
+/**
+ * @brief Temporal anti-aliasing class
+ */
+struct wgpu_temporal_aa {
+  wgpu_context_t* wgpu_context;
+  float current_weight;
+  bool reversed_z;
+  /* Jitter sequence */
+  uint32_t frame_index;
+  uint32_t render_width;
+  uint32_t render_height;
+  vec2 jitter; /* render texels, y down */
+  /* History of the output size, written alternately */
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+  } history[2];
+  uint32_t output_width;
+  uint32_t output_height;
+  bool history_valid;
+  /* Bound without motion vectors */
+  WGPUTexture dummy_motion_texture;
+  WGPUTextureView dummy_motion_view;
+  /* Resolve pass */
+  WGPUBuffer uniform_buffer;
+  WGPUSampler sampler;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUComputePipeline pipeline;
+};
+
+/* Resolve pipeline */
+
+static void temporal_aa_create_pipeline(wgpu_temporal_aa_t* taa)
+{
+  wgpu_context_t* wgpu_context = taa->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[7] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Parameters
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(temporal_aa_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Color of the frame
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Depth of the frame
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Depth,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      // Binding 3: Motion vectors of the frame
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [4] = (WGPUBindGroupLayoutEntry) {
+      // Binding 4: History of the previous frame
+      .binding    = 4,
+      .visibility = WGPUShaderStage_Compute,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [5] = (WGPUBindGroupLayoutEntry) {
+      // Binding 5: Bilinear history sampler
+      .binding    = 5,
+      .visibility = WGPUShaderStage_Compute,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+    [6] = (WGPUBindGroupLayoutEntry) {
+      // Binding 6: Output, the history of the next frame
+      .binding    = 6,
+      .visibility = WGPUShaderStage_Compute,
+      .storageTexture = (WGPUStorageTextureBindingLayout) {
+        .access        = WGPUStorageTextureAccess_WriteOnly,
+        .format        = WGPU_TEMPORAL_AA_OUTPUT_FORMAT,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+  };
+  taa->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "Temporal AA bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(taa->bind_group_layout != NULL);
+
+  taa->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .label = "Temporal AA pipeline layout",
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &taa->bind_group_layout,
+                          });
+  ASSERT(taa->pipeline_layout != NULL);
+
+  wgpu_shader_t shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .label            = "Temporal AA resolve shader",
+                    .wgsl_code.source = temporal_aa_shader_wgsl,
+                    .entry            = "main",
+                  });
+  taa->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "Temporal AA resolve pipeline",
+                    .layout  = taa->pipeline_layout,
+                    .compute = shader.programmable_stage_descriptor,
+                  });
+  ASSERT(taa->pipeline != NULL);
+  wgpu_shader_release(&shader);
+}
+
+/* Textures */
+
+static void temporal_aa_create_texture(wgpu_temporal_aa_t* taa,
+                                       const char* label,
+                                       WGPUTextureFormat format,
+                                       WGPUTextureUsageFlags usage,
+                                       uint32_t width, uint32_t height,
+                                       WGPUTexture* texture,
+                                       WGPUTextureView* view)
+{
+  *texture = wgpuDeviceCreateTexture(
+    taa->wgpu_context->device, &(WGPUTextureDescriptor){
+                                 .label         = label,
+                                 .usage         = usage,
+                                 .dimension     = WGPUTextureDimension_2D,
+                                 .size          = (WGPUExtent3D){
+                                   .width              = width,
+                                   .height             = height,
+                                   .depthOrArrayLayers = 1,
+                                 },
+                                 .format        = format,
+                                 .mipLevelCount = 1,
+                                 .sampleCount   = 1,
+                               });
+  ASSERT(*texture != NULL);
+  *view = wgpuTextureCreateView(*texture, NULL);
+  ASSERT(*view != NULL);
+}
+
+static void temporal_aa_release_history(wgpu_temporal_aa_t* taa)
+{
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(taa->history); ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, taa->history[i].view)
+    WGPU_RELEASE_RESOURCE(Texture, taa->history[i].texture)
+  }
+}
+
+static void temporal_aa_create_history(wgpu_temporal_aa_t* taa,
+                                       uint32_t width, uint32_t height)
+{
+  temporal_aa_release_history(taa);
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(taa->history); ++i) {
+    temporal_aa_create_texture(
+      taa, "Temporal AA history texture", WGPU_TEMPORAL_AA_OUTPUT_FORMAT,
+      WGPUTextureUsage_StorageBinding | WGPUTextureUsage_TextureBinding, width,
+      height, &taa->history[i].texture, &taa->history[i].view);
+  }
+  taa->output_width  = width;
+  taa->output_height = height;
+  taa->history_valid = false;
+}
+
+/* Temporal anti-aliasing creating / destroying */
+
+wgpu_temporal_aa_t*
+wgpu_temporal_aa_create(wgpu_context_t* wgpu_context,
+                        const wgpu_temporal_aa_desc_t* desc)
+{
+  wgpu_temporal_aa_t* taa = (wgpu_temporal_aa_t*)calloc(1, sizeof(*taa));
+  taa->wgpu_context       = wgpu_context;
+  taa->current_weight     = desc->current_weight > 0.0f ?
+                              MIN(desc->current_weight, 1.0f) :
+                              TEMPORAL_AA_DEFAULT_CURRENT_WEIGHT;
+  taa->reversed_z         = desc->reversed_z;
+
+  taa->uniform_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "Temporal AA uniform buffer",
+                            .usage = WGPUBufferUsage_Uniform
+                                     | WGPUBufferUsage_CopyDst,
+                            .size  = sizeof(temporal_aa_uniforms_t),
+                          });
+  ASSERT(taa->uniform_buffer != NULL);
+
+  taa->sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .label         = "Temporal AA history sampler",
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Nearest,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = 1.0f,
+                    .maxAnisotropy = 1,
+                  });
+  ASSERT(taa->sampler != NULL);
+
+  // Zero motion, textures are zero initialized
+  temporal_aa_create_texture(
+    taa, "Temporal AA dummy motion vector texture",
+    WGPU_TEMPORAL_AA_MOTION_VECTOR_FORMAT, WGPUTextureUsage_TextureBinding, 1,
+    1, &taa->dummy_motion_texture, &taa->dummy_motion_view);
+
+  temporal_aa_create_pipeline(taa);
+
+  return taa;
+}
+
+void wgpu_temporal_aa_destroy(wgpu_temporal_aa_t* taa)
+{
+  if (taa == NULL) {
+    return;
+  }
+
+  temporal_aa_release_history(taa);
+  WGPU_RELEASE_RESOURCE(TextureView, taa->dummy_motion_view)
+  WGPU_RELEASE_RESOURCE(Texture, taa->dummy_motion_texture)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, taa->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, taa->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, taa->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, taa->sampler)
+  WGPU_RELEASE_RESOURCE(Buffer, taa->uniform_buffer)
+  free(taa);
+}
+
+/* Frames */
+
+/* Radical inverse of the index in the given base, in [0, 1) */
+static float temporal_aa_halton(uint32_t index, uint32_t base)
+{
+  float result = 0.0f;
+  float f      = 1.0f;
+  while (index > 0) {
+    f /= (float)base;
+    result += f * (float)(index % base);
+    index /= base;
+  }
+  return result;
+}
+
+void wgpu_temporal_aa_begin_frame(wgpu_temporal_aa_t* taa,
+                                  uint32_t render_width,
+                                  uint32_t render_height,
+                                  uint32_t output_width,
+                                  uint32_t output_height)
+{
+  ASSERT(render_width > 0 && render_height > 0);
+  ASSERT(output_width > 0 && output_height > 0);
+
+  if (taa->history[0].texture == NULL || taa->output_width != output_width
+      || taa->output_height != output_height) {
+    temporal_aa_create_history(taa, output_width, output_height);
+  }
+
+  // The sequence starts at index 1, index 0 is (0, 0) in both bases
+  ++taa->frame_index;
+  const uint32_t phase = taa->frame_index % WGPU_TEMPORAL_AA_JITTER_PHASES;
+  taa->jitter[0]       = temporal_aa_halton(phase + 1, 2) - 0.5f;
+  taa->jitter[1]       = temporal_aa_halton(phase + 1, 3) - 0.5f;
+  taa->render_width    = render_width;
+  taa->render_height   = render_height;
+}
+
+void wgpu_temporal_aa_get_jitter(wgpu_temporal_aa_t* taa, vec2 jitter)
+{
+  // NDC y goes up, texel rows go down
+  jitter[0] = 2.0f * taa->jitter[0] / (float)MAX(taa->render_width, 1u);
+  jitter[1] = -2.0f * taa->jitter[1] / (float)MAX(taa->render_height, 1u);
+}
+
+void wgpu_temporal_aa_reset(wgpu_temporal_aa_t* taa)
+{
+  taa->history_valid = false;
+}
+
+WGPUTextureView wgpu_temporal_aa_get_output_view(wgpu_temporal_aa_t* taa)
+{
+  ASSERT(taa->history[0].view != NULL);
+  return taa->history[taa->frame_index & 1].view;
+}
+
+/* Resolving */
+
+void wgpu_temporal_aa_resolve(wgpu_temporal_aa_t* taa,
+                              WGPUComputePassEncoder cpass_enc,
+                              const wgpu_temporal_aa_inputs_t* inputs)
+{
+  ASSERT(inputs->color != NULL && inputs->depth != NULL);
+  ASSERT(taa->history[0].view != NULL);
+
+  wgpu_context_t* wgpu_context = taa->wgpu_context;
+
+  temporal_aa_uniforms_t uniforms = {
+    .render_size    = {(float)taa->render_width, (float)taa->render_height},
+    .output_size    = {(float)taa->output_width, (float)taa->output_height},
+    .jitter         = {taa->jitter[0], taa->jitter[1]},
+    .current_weight = taa->current_weight,
+    .flags = (taa->history_valid ? TEMPORAL_AA_FLAG_HISTORY_VALID : 0u)
+             | (inputs->motion_vectors ? TEMPORAL_AA_FLAG_MOTION_VECTORS : 0u)
+             | (taa->reversed_z ? TEMPORAL_AA_FLAG_REVERSED_Z : 0u),
+  };
+  if (inputs->motion_vectors == NULL) {
+    mat4 inverse_view_projection;
+    glm_mat4_inv((vec4*)inputs->view_projection, inverse_view_projection);
+    glm_mat4_mul((vec4*)inputs->previous_view_projection,
+                 inverse_view_projection, uniforms.reprojection);
+  }
+  wgpu_queue_write_buffer(wgpu_context, taa->uniform_buffer, 0, &uniforms,
+                          sizeof(uniforms));
+
+  const uint32_t output = taa->frame_index & 1;
+  WGPUBindGroupEntry bg_entries[7] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = taa->uniform_buffer,
+      .size    = sizeof(temporal_aa_uniforms_t),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = inputs->color,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding     = 2,
+      .textureView = inputs->depth,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      .binding     = 3,
+      .textureView = inputs->motion_vectors ? inputs->motion_vectors :
+                                              taa->dummy_motion_view,
+    },
+    [4] = (WGPUBindGroupEntry) {
+      .binding     = 4,
+      .textureView = taa->history[output ^ 1].view,
+    },
+    [5] = (WGPUBindGroupEntry) {
+      .binding = 5,
+      .sampler = taa->sampler,
+    },
+    [6] = (WGPUBindGroupEntry) {
+      .binding     = 6,
+      .textureView = taa->history[output].view,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .label      = "Temporal AA bind group",
+                    .layout     = taa->bind_group_layout,
+                    .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                    .entries    = bg_entries,
+                  });
+  ASSERT(bind_group != NULL);
+
+  wgpuComputePassEncoderSetPipeline(cpass_enc, taa->pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (taa->output_width + TEMPORAL_AA_WORKGROUP_SIZE - 1)
+      / TEMPORAL_AA_WORKGROUP_SIZE,
+    (taa->output_height + TEMPORAL_AA_WORKGROUP_SIZE - 1)
+      / TEMPORAL_AA_WORKGROUP_SIZE,
+    1);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+
+  taa->history_valid = true;
+}
@@ -0,0 +1,95 @@
+#ifndef TEMPORAL_AA_H
+#define TEMPORAL_AA_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* Length of the Halton (2, 3) jitter sequence */
+#define WGPU_TEMPORAL_AA_JITTER_PHASES 8u
+/* Format of the resolved color and the history */
+#define WGPU_TEMPORAL_AA_OUTPUT_FORMAT WGPUTextureFormat_RGBA16Float
+/* Format of the motion vector textures */
+#define WGPU_TEMPORAL_AA_MOTION_VECTOR_FORMAT WGPUTextureFormat_RG16Float
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU temporal anti-aliasing
+ *
+ * Accumulates the samples of several frames into a history of the output
+ * size. Every frame renders the scene with the projection offset by a sub-pixel
+ * jitter (see camera_set_jitter()), the resolve compute pass reprojects the
+ * history with the motion vectors, clamps it to the variance box of the 3 x 3
+ * neighborhood of the current frame and blends the current frame in:
+ *
+ *   wgpu_temporal_aa_begin_frame(taa, render_w, render_h, output_w, output_h);
+ *   wgpu_temporal_aa_get_jitter(taa, jitter);
+ *   camera_set_jitter(camera, jitter);
+ *   ... render color, depth and motion vectors at the render size ...
+ *   wgpu_temporal_aa_resolve(taa, cpass_enc, &inputs);
+ *   ... draw wgpu_temporal_aa_get_output_view(taa) ...
+ *
+ * The render size can be smaller than the output size, the samples of the
+ * current frame are then splatted into the output pixels with a Gaussian
+ * filter and the history converges to the output resolution over the jitter
+ * phases, e.g. at a 50 - 75 % render scale driven by dynamic resolution.
+ *
+ * Motion vectors are UV offsets from the current to the previous position of
+ * the surface, previous_uv - uv with UVs going down, written at the render
+ * size. Without a motion vector texture the motion of static geometry is
+ * reconstructed from the depth and the unjittered view projection matrices of
+ * the two frames. The history is dropped on reset(), when the output size
+ * changes and where the reprojection leaves the screen.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_temporal_aa wgpu_temporal_aa_t;
+
+typedef struct wgpu_temporal_aa_desc_t {
+  /* Weight of the current frame in the history, 0 = 0.1 */
+  float current_weight;
+  /* The depth inputs are reversed-Z, the nearest depth of a neighborhood
+   * selects its motion vector */
+  bool reversed_z;
+} wgpu_temporal_aa_desc_t;
+
+typedef struct wgpu_temporal_aa_inputs_t {
+  /* Color of the frame at the render size */
+  WGPUTextureView color;
+  /* Depth of the frame, a texture_depth_2d compatible view (no stencil) */
+  WGPUTextureView depth;
+  /* Motion vectors of the frame, NULL = reconstructed from the depth */
+  WGPUTextureView motion_vectors;
+  /* Unjittered view projection matrices of the frame and of the previous
+   * frame, only read without motion vectors */
+  mat4 view_projection;
+  mat4 previous_view_projection;
+} wgpu_temporal_aa_inputs_t;
+
+/* Temporal anti-aliasing creating / destroying */
+wgpu_temporal_aa_t*
+wgpu_temporal_aa_create(wgpu_context_t* wgpu_context,
+                        const wgpu_temporal_aa_desc_t* desc);
+void wgpu_temporal_aa_destroy(wgpu_temporal_aa_t* taa);
+
+/* Advances the jitter sequence and (re)creates the history of the output size,
+ * called before the jittered projection of the frame is used */
+void wgpu_temporal_aa_begin_frame(wgpu_temporal_aa_t* taa,
+                                  uint32_t render_width,
+                                  uint32_t render_height,
+                                  uint32_t output_width,
+                                  uint32_t output_height);
+
+/* Jitter of the frame in NDC */
+void wgpu_temporal_aa_get_jitter(wgpu_temporal_aa_t* taa, vec2 jitter);
+
+/* Drops the history, e.g. after a camera cut */
+void wgpu_temporal_aa_reset(wgpu_temporal_aa_t* taa);
+
+/* Output of the frame, valid until the next wgpu_temporal_aa_begin_frame() */
+WGPUTextureView wgpu_temporal_aa_get_output_view(wgpu_temporal_aa_t* taa);
+
+/* Records the resolve of the frame into the output */
+void wgpu_temporal_aa_resolve(wgpu_temporal_aa_t* taa,
+                              WGPUComputePassEncoder cpass_enc,
+                              const wgpu_temporal_aa_inputs_t* inputs);
+
+#endif /* TEMPORAL_AA_H */
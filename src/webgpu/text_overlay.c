@@ -1,28 +1,79 @@
 #include "text_overlay.h"
 
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <cglm/cglm.h>
 
+#include "../core/distance_field.h"
 #include "../core/macro.h"
 #include "buffer.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
 #include "shader.h"
+#include "upload_ring.h"
 
 // https://nothings.org/stb/font/
 // https://www.nothings.org/stb/font/latin1/consolas/
 #include <stb_font_consolas_24_latin1.h>
 
-/* Max. number of chars the text overlay buffer can hold */
-#define TEXTOVERLAY_MAX_CHAR_COUNT 2048
+/* Initial number of chars the text overlay buffer can hold, grows on demand */
+#define TEXTOVERLAY_INITIAL_CHAR_CAPACITY 2048u
+#define TEXTOVERLAY_INITIAL_TEXT_CAPACITY 64u
+
+/* Glyph size relative to the 24 pixel font */
+#define TEXTOVERLAY_DEFAULT_SCALE 1.5f
+
+/* Distance field font atlas: the glyphs of the font bitmap are repacked with
+ * a border of TEXTOVERLAY_SDF_PADDING texels, the distance range of the field,
+ * so the fields of neighboring glyphs do not overlap */
+#define TEXTOVERLAY_SDF_ATLAS_WIDTH 512u
+#define TEXTOVERLAY_SDF_PADDING 4u
+#define TEXTOVERLAY_SDF_CACHE_FILENAME "text_overlay_consolas_24.sdf"
+
+/**
+ * @brief Glyph instance, one per character. The quad of the glyph is expanded
+ * in the vertex shader.
+ */
+typedef struct text_glyph_instance_t {
+  vec2 position;  /* pen position in normalized device coordinates */
+  uint32_t glyph; /* index into the glyph table */
+  uint32_t color; /* RGBA8 */
+} text_glyph_instance_t;
+
+/**
+ * @brief Glyph table entry (storage buffer)
+ */
+typedef struct text_glyph_t {
+  vec4 rect; /* x0, y0, x1, y1 in pixels relative to the pen position */
+  vec4 uv;   /* s0, t0, s1, t1 */
+} text_glyph_t;
 
 /**
- * @brief Text vertex class
+ * @brief Layout of one text_overlay_add_text() call. The glyph instances of a
+ * text are reused in the next text update if the text, its position and its
+ * place in the buffer did not change.
  */
-typedef struct text_vertex_t {
-  vec2 position;
-  vec2 uv;
-} text_vertex_t;
+typedef struct text_run_t {
+  uint64_t key;
+  uint32_t first_instance;
+  uint32_t instance_count;
+} text_run_t;
+
+typedef struct text_run_list_t {
+  text_run_t* data;
+  uint32_t count;
+  uint32_t previous_count; /* number of texts of the previous update */
+  uint32_t capacity;
+} text_run_list_t;
+
+/* Uniform data of the vertex shader */
+typedef struct text_uniforms_t {
+  vec2 char_scale; /* pixel to normalized device coordinates */
+  vec2 padding;
+} text_uniforms_t;
 
 /**
  * @brief Text overlay class
@@ -31,7 +82,9 @@ typedef struct text_overlay {
   wgpu_context_t* wgpu_context;
   WGPURenderPipeline pipeline;
   WGPUPipelineLayout pipeline_layout;
-  wgpu_buffer_t vertex_buffer;
+  wgpu_buffer_t instance_buffer;
+  wgpu_buffer_t glyph_buffer;
+  wgpu_buffer_t uniform_buffer;
   WGPUBindGroup bind_group;
   WGPUBindGroupLayout bind_group_layout;
   struct {
@@ -47,39 +100,253 @@ typedef struct text_overlay {
     WGPURenderPassDescriptor render_pass_descriptor;
   } render_pass;
   struct {
+    // Glyph instances of the current text update
     struct {
-      text_vertex_t data[TEXTOVERLAY_MAX_CHAR_COUNT * 4];
-      size_t size;
-    } vertex;
+      text_glyph_instance_t* data;
+      uint32_t capacity;
+    } instances;
+    // Texts of the current and the previous text update
+    text_run_list_t runs;
+    // Range of instances which changed since the last upload
+    uint32_t dirty_first;
+    uint32_t dirty_end;
+    text_uniforms_t uniforms;
   } draw_buffer;
   stb_fontchar stb_font_data[STB_FONT_consolas_24_latin1_NUM_CHARS];
+  text_glyph_t glyphs[STB_FONT_consolas_24_latin1_NUM_CHARS];
   uint32_t num_letters;
-  bool flip_y; /* false: Y-axis up / true: Y-axis down */
+  uint32_t text_color; /* RGBA8 color of the added texts */
+  float scale;         /* glyph size relative to the 24 pixel font */
+  bool flip_y;         /* false: Y-axis up / true: Y-axis down */
 } text_overlay;
 
+// clang-format off
+static const char* text_overlay_shader_wgsl = CODE(
+  struct Glyph {
+    rect : vec4<f32>,
+    uv : vec4<f32>,
+  }
+
+  struct Uniforms {
+    char_scale : vec2<f32>,
+  }
+
+  @group(0) @binding(0) var font_texture : texture_2d<f32>;
+  @group(0) @binding(1) var font_sampler : sampler;
+  @group(0) @binding(2) var<storage, read> glyphs : array<Glyph>;
+  @group(0) @binding(3) var<uniform> uniforms : Uniforms;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+    @location(1) color : vec4<f32>,
+  }
+
+  @vertex
+  fn vertexMain(@builtin(vertex_index) vertex_index : u32,
+                @location(0) position : vec2<f32>,
+                @location(1) glyph_index : u32,
+                @location(2) color : vec4<f32>) -> VertexOutput {
+    let glyph = glyphs[glyph_index];
+    // Triangle strip corners: (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+    let corner = vec2<bool>((vertex_index & 1u) != 0u, vertex_index >= 2u);
+    let offset = select(glyph.rect.xy, glyph.rect.zw, corner);
+    var output : VertexOutput;
+    output.position = vec4<f32>(
+      position + vec2<f32>(offset.x, -offset.y) * uniforms.char_scale, 0.0,
+      1.0);
+    output.uv    = select(glyph.uv.xy, glyph.uv.zw, corner);
+    output.color = color;
+    return output;
+  }
+
+  // Alpha from the distance field in the red channel of the font texture,
+  // the edge is smoothed over about one pixel at any scale
+  @fragment
+  fn fragmentMain(input : VertexOutput) -> @location(0) vec4<f32> {
+    let distance = textureSample(font_texture, font_sampler, input.uv).r;
+    let width = max(fwidth(distance) * 0.5, 1e-4);
+    return input.color * smoothstep(0.5 - width, 0.5 + width, distance);
+  }
+);
+// clang-format on
+
+static uint64_t text_overlay_hash(uint64_t hash, const void* data, size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
 static void text_overlay_init(text_overlay_t* text_overlay,
                               wgpu_context_t* wgpu_context)
 {
   text_overlay->wgpu_context         = wgpu_context;
   text_overlay->color.format         = wgpu_context->swap_chain.format;
   text_overlay->depth_stencil.format = WGPUTextureFormat_Depth24PlusStencil8;
+  text_overlay->text_color           = 0xffffffffu;
+  text_overlay->scale                = TEXTOVERLAY_DEFAULT_SCALE;
   text_overlay->flip_y               = false;
+
+  text_overlay->draw_buffer.instances.capacity
+    = TEXTOVERLAY_INITIAL_CHAR_CAPACITY;
+  text_overlay->draw_buffer.instances.data
+    = (text_glyph_instance_t*)malloc(TEXTOVERLAY_INITIAL_CHAR_CAPACITY
+                                     * sizeof(text_glyph_instance_t));
+  text_overlay->draw_buffer.runs.capacity = TEXTOVERLAY_INITIAL_TEXT_CAPACITY;
+  text_overlay->draw_buffer.runs.data     = (text_run_t*)malloc(
+    TEXTOVERLAY_INITIAL_TEXT_CAPACITY * sizeof(text_run_t));
 }
 
-static void text_overlay_create_vertex_buffer(text_overlay_t* text_overlay)
+static void text_overlay_create_instance_buffer(text_overlay_t* text_overlay,
+                                                uint32_t capacity)
 {
-  text_overlay->draw_buffer.vertex.size
-    = sizeof(text_overlay->draw_buffer.vertex.data);
-
-  text_overlay->vertex_buffer = wgpu_create_buffer(
+  text_overlay->instance_buffer = wgpu_create_buffer(
     text_overlay->wgpu_context,
     &(wgpu_buffer_desc_t){
-      .label = "text-overlay-vertex-buffer",
+      .label = "text-overlay-instance-buffer",
       .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
-      .size  = text_overlay->draw_buffer.vertex.size,
+      .size  = capacity * sizeof(text_glyph_instance_t),
+    });
+}
+
+static void text_overlay_create_buffers(text_overlay_t* text_overlay)
+{
+  text_overlay_create_instance_buffer(text_overlay,
+                                      TEXTOVERLAY_INITIAL_CHAR_CAPACITY);
+
+  // Glyph table, filled when the fonts texture is created
+  text_overlay->glyph_buffer = wgpu_create_buffer(
+    text_overlay->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label   = "text-overlay-glyph-buffer",
+      .usage   = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+      .size    = sizeof(text_overlay->glyphs),
+      .initial = {
+        .data = text_overlay->glyphs,
+        .size = sizeof(text_overlay->glyphs),
+      },
+    });
+
+  text_overlay->uniform_buffer = wgpu_create_buffer(
+    text_overlay->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "text-overlay-uniform-buffer",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = sizeof(text_uniforms_t),
     });
 }
 
+/**
+ * @brief Packs the glyphs of the font bitmap into the distance field atlas,
+ * each with a border of TEXTOVERLAY_SDF_PADDING texels, and fills the glyph
+ * table. The quads and texture coordinates of the glyphs include the border,
+ * which holds the smoothed edge at large scales.
+ * @param origins the atlas position of each glyph
+ * @return the height of the atlas
+ */
+static uint32_t text_overlay_pack_glyphs(
+  text_overlay_t* text_overlay,
+  uint32_t origins[STB_FONT_consolas_24_latin1_NUM_CHARS][2])
+{
+  const int32_t pad   = (int32_t)TEXTOVERLAY_SDF_PADDING;
+  uint32_t x          = 0;
+  uint32_t y          = 0;
+  uint32_t row_height = 0;
+  // Shelf packing in glyph order
+  for (uint32_t i = 0; i < STB_FONT_consolas_24_latin1_NUM_CHARS; ++i) {
+    const stb_fontchar* char_data = &text_overlay->stb_font_data[i];
+    const uint32_t w = (uint32_t)(char_data->x1 - char_data->x0 + 2 * pad);
+    const uint32_t h = (uint32_t)(char_data->y1 - char_data->y0 + 2 * pad);
+    if (x + w > TEXTOVERLAY_SDF_ATLAS_WIDTH) {
+      x = 0;
+      y += row_height;
+      row_height = 0;
+    }
+    origins[i][0] = x;
+    origins[i][1] = y;
+    x += w;
+    row_height = MAX(row_height, h);
+  }
+  const uint32_t atlas_height = y + row_height;
+
+  const float atlas_width = (float)TEXTOVERLAY_SDF_ATLAS_WIDTH;
+  for (uint32_t i = 0; i < STB_FONT_consolas_24_latin1_NUM_CHARS; ++i) {
+    const stb_fontchar* char_data = &text_overlay->stb_font_data[i];
+    const float w = (float)(char_data->x1 - char_data->x0 + 2 * pad);
+    const float h = (float)(char_data->y1 - char_data->y0 + 2 * pad);
+    text_overlay->glyphs[i] = (text_glyph_t){
+      .rect = {
+        (float)(char_data->x0 - pad), (float)(char_data->y0 - pad),
+        (float)(char_data->x1 + pad), (float)(char_data->y1 + pad),
+      },
+      .uv = {
+        (float)origins[i][0] / atlas_width,
+        (float)origins[i][1] / (float)atlas_height,
+        ((float)origins[i][0] + w) / atlas_width,
+        ((float)origins[i][1] + h) / (float)atlas_height,
+      },
+    };
+  }
+
+  return atlas_height;
+}
+
+/**
+ * @brief Creates the distance field of the packed glyphs. The field is
+ * generated once and then loaded from the cache next to the pipeline cache.
+ */
+static void text_overlay_create_glyph_field(
+  text_overlay_t* text_overlay, const uint8_t* font_pixels,
+  uint32_t font_width, uint32_t font_height,
+  uint32_t origins[STB_FONT_consolas_24_latin1_NUM_CHARS][2],
+  uint32_t atlas_height, uint8_t* field)
+{
+  const uint32_t atlas_width = TEXTOVERLAY_SDF_ATLAS_WIDTH;
+  uint8_t* coverage = (uint8_t*)calloc(atlas_width * atlas_height, 1);
+  for (uint32_t i = 0; i < STB_FONT_consolas_24_latin1_NUM_CHARS; ++i) {
+    const stb_fontchar* char_data = &text_overlay->stb_font_data[i];
+    const uint32_t w = (uint32_t)(char_data->x1 - char_data->x0);
+    const uint32_t h = (uint32_t)(char_data->y1 - char_data->y0);
+    // Glyph pixels in the font bitmap
+    const uint32_t sx = (uint32_t)(char_data->s0 * (float)font_width + 0.5f);
+    const uint32_t sy = (uint32_t)(char_data->t0 * (float)font_height + 0.5f);
+    const uint32_t dx = origins[i][0] + TEXTOVERLAY_SDF_PADDING;
+    const uint32_t dy = origins[i][1] + TEXTOVERLAY_SDF_PADDING;
+    for (uint32_t row = 0; row < h; ++row) {
+      memcpy(&coverage[(dy + row) * atlas_width + dx],
+             &font_pixels[(sy + row) * font_width + sx], w);
+    }
+  }
+
+  const distance_field_desc_t field_desc = {
+    .coverage = coverage,
+    .width    = atlas_width,
+    .height   = atlas_height,
+    .spread   = (float)TEXTOVERLAY_SDF_PADDING,
+  };
+  const uint64_t field_key    = distance_field_hash(&field_desc);
+  const char* cache_dir       = wgpu_get_pipeline_cache_dir();
+  char cache_filename[STRMAX] = {0};
+  if (cache_dir != NULL) {
+    snprintf(cache_filename, sizeof(cache_filename), "%s/%s", cache_dir,
+             TEXTOVERLAY_SDF_CACHE_FILENAME);
+  }
+  if (cache_dir == NULL
+      || !distance_field_cache_read(cache_filename, field_key, atlas_width,
+                                    atlas_height, field)) {
+    distance_field_generate(&field_desc, field);
+    if (cache_dir != NULL) {
+      distance_field_cache_write(cache_filename, field_key, atlas_width,
+                                 atlas_height, field);
+    }
+  }
+
+  free(coverage);
+}
+
 static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
 {
   wgpu_context_t* wgpu_context = text_overlay->wgpu_context;
@@ -91,14 +358,25 @@ static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
                                    [STB_FONT_consolas_24_latin1_BITMAP_WIDTH];
   stb_font_consolas_24_latin1(text_overlay->stb_font_data, font24pixels,
                               font_height);
+
+  /* The glyphs are repacked with a border, the distance field replaces the
+   * coverage of the font bitmap */
+  uint32_t origins[STB_FONT_consolas_24_latin1_NUM_CHARS][2];
+  const uint32_t atlas_height = text_overlay_pack_glyphs(text_overlay, origins);
+  const uint32_t atlas_width  = TEXTOVERLAY_SDF_ATLAS_WIDTH;
+  uint8_t* field = (uint8_t*)malloc(atlas_width * atlas_height);
+  text_overlay_create_glyph_field(text_overlay, &font24pixels[0][0],
+                                  font_width, font_height, origins,
+                                  atlas_height, field);
+
   /* Size of the font texture is WIDTH * HEIGHT * 1 byte (only one channel) */
-  size_t bytes_per_pixel   = 1;
-  size_t font24pixels_size = font_width * font_height * bytes_per_pixel;
+  size_t bytes_per_pixel = 1;
+  size_t field_size      = atlas_width * atlas_height * bytes_per_pixel;
 
   /* Upload font texture to graphics system */
   WGPUExtent3D texture_size = {
-    .width              = font_width,
-    .height             = font_height,
+    .width              = atlas_width,
+    .height             = atlas_height,
     .depthOrArrayLayers = 1,
   };
   WGPUTextureDescriptor texture_desc = {
@@ -119,10 +397,10 @@ static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
       wgpu_context, &(wgpu_buffer_desc_t){
         .label   = "text-overlay-font-texture_staging_buffer",
         .usage   = WGPUBufferUsage_CopySrc,
-        .size    = font24pixels_size,
+        .size    = field_size,
         .initial = {
-          .data  = font24pixels,
-          .size  = font24pixels_size,
+          .data  = field,
+          .size  = field_size,
         },
     });
 
@@ -131,8 +409,8 @@ static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
       .buffer = gpu_buffer.buffer,
       .layout = (WGPUTextureDataLayout){
           .offset       = 0,
-          .bytesPerRow  = font_width * bytes_per_pixel,
-          .rowsPerImage = font_height,
+          .bytesPerRow  = atlas_width * bytes_per_pixel,
+          .rowsPerImage = atlas_height,
       },
     };
 
@@ -147,14 +425,12 @@ static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
       .aspect = WGPUTextureAspect_All,
     };
 
-  WGPUCommandBuffer copy_command = wgpu_copy_buffer_to_texture(
-    wgpu_context, &buffer_copy_view, &texture_copy_view, &texture_size);
-  /* Submit to the queue */
-  wgpuQueueSubmit(wgpu_context->queue, 1, &copy_command);
+  wgpu_copy_buffer_to_texture(wgpu_context, &buffer_copy_view,
+                              &texture_copy_view, &texture_size);
 
-  /* Release command buffer and staging buffer */
-  WGPU_RELEASE_RESOURCE(CommandBuffer, copy_command)
+  /* Release staging buffer */
   wgpu_destroy_buffer(&gpu_buffer);
+  free(field);
 
   /* Create texture view */
   WGPUTextureViewDescriptor texture_view_desc = {
@@ -188,7 +464,7 @@ static void text_overlay_create_fonts_texture(text_overlay_t* text_overlay)
   };
 
   text_overlay->font.sampler
-    = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+    = wgpu_create_sampler(wgpu_context, &sampler_desc);
   ASSERT(text_overlay->font.sampler);
 }
 
@@ -197,7 +473,7 @@ static void text_overlay_setup_pipeline_layout(text_overlay_t* text_overlay)
   wgpu_context_t* wgpu_context = text_overlay->wgpu_context;
 
   // Bind group layout
-  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
     [0] = (WGPUBindGroupLayoutEntry) {
       // Binding 0: Texture view (Fragment shader)
       .binding = 0,
@@ -217,7 +493,25 @@ static void text_overlay_setup_pipeline_layout(text_overlay_t* text_overlay)
         .type=WGPUSamplerBindingType_Filtering,
       },
       .texture = {0},
-    }
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      // Binding 2: Glyph table (Vertex shader)
+      .binding = 2,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = sizeof(text_glyph_t),
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      // Binding 3: Uniform buffer (Vertex shader)
+      .binding = 3,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(text_uniforms_t),
+      },
+    },
   };
   text_overlay->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
     wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
@@ -242,7 +536,7 @@ static void text_overlay_setup_bind_group(text_overlay_t* text_overlay)
   wgpu_context_t* wgpu_context = text_overlay->wgpu_context;
 
   // Bind Group
-  WGPUBindGroupEntry bg_entries[2] = {
+  WGPUBindGroupEntry bg_entries[4] = {
     [0] = (WGPUBindGroupEntry) {
       // Binding 0 : Fragment shader texture view
       .binding = 0,
@@ -253,6 +547,18 @@ static void text_overlay_setup_bind_group(text_overlay_t* text_overlay)
       .binding = 1,
       .sampler = text_overlay->font.sampler,
     },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2: Vertex shader glyph table
+      .binding = 2,
+      .buffer  = text_overlay->glyph_buffer.buffer,
+      .size    = text_overlay->glyph_buffer.size,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      // Binding 3: Vertex shader uniform buffer
+      .binding = 3,
+      .buffer  = text_overlay->uniform_buffer.buffer,
+      .size    = text_overlay->uniform_buffer.size,
+    },
   };
 
   text_overlay->bind_group = wgpuDeviceCreateBindGroup(
@@ -293,22 +599,28 @@ static void text_overlay_prepare_pipeline(text_overlay_t* text_overlay)
       .depth_write_enabled = true,
     });
 
-  // Vertex buffer layout
+  // Vertex buffer layout, one glyph instance per character
   WGPU_VERTEX_BUFFER_LAYOUT(
-    text_overlay, sizeof(text_vertex_t),
+    text_overlay, sizeof(text_glyph_instance_t),
     // Attribute location 0: Position
     WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x2,
-                       offsetof(text_vertex_t, position)),
-    // Attribute location 1: UV
-    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x2,
-                       offsetof(text_vertex_t, uv)))
+                       offsetof(text_glyph_instance_t, position)),
+    // Attribute location 1: Glyph index
+    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Uint32,
+                       offsetof(text_glyph_instance_t, glyph)),
+    // Attribute location 2: Color
+    WGPU_VERTATTR_DESC(2, WGPUVertexFormat_Unorm8x4,
+                       offsetof(text_glyph_instance_t, color)))
+  text_overlay_vertex_buffer_layout.stepMode = WGPUVertexStepMode_Instance;
 
   // Vertex state
   WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
         wgpu_context, &(wgpu_vertex_state_t){
         .shader_desc = (wgpu_shader_desc_t){
-          // Vertex shader SPIR-V
-          .file = "shaders/text_overlay/text.vert.spv",
+          // Vertex shader WGSL
+          .label            = "text_overlay_vertex_shader",
+          .wgsl_code.source = text_overlay_shader_wgsl,
+          .entry            = "vertexMain",
         },
         .buffer_count = 1,
         .buffers = &text_overlay_vertex_buffer_layout,
@@ -318,8 +630,10 @@ static void text_overlay_prepare_pipeline(text_overlay_t* text_overlay)
   WGPUFragmentState fragment_state_desc = wgpu_create_fragment_state(
         wgpu_context, &(wgpu_fragment_state_t){
         .shader_desc = (wgpu_shader_desc_t){
-          // Fragment shader SPIR-V
-          .file = "shaders/text_overlay/text.frag.spv",
+          // Fragment shader WGSL
+          .label            = "text_overlay_fragment_shader",
+          .wgsl_code.source = text_overlay_shader_wgsl,
+          .entry            = "fragmentMain",
         },
         .target_count = 1,
         .targets = &color_target_state_desc,
@@ -333,16 +647,16 @@ static void text_overlay_prepare_pipeline(text_overlay_t* text_overlay)
       });
 
   // Create rendering pipeline using the specified states
-  text_overlay->pipeline = wgpuDeviceCreateRenderPipeline(
-    wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                            .label        = "text_overlay_render_pipeline",
-                            .layout       = text_overlay->pipeline_layout,
-                            .primitive    = primitive_state_desc,
-                            .vertex       = vertex_state_desc,
-                            .fragment     = &fragment_state_desc,
-                            .depthStencil = &depth_stencil_state_desc,
-                            .multisample  = multisample_state_desc,
-                          });
+  text_overlay->pipeline = wgpu_create_render_pipeline(
+    wgpu_context, &(WGPURenderPipelineDescriptor){
+                    .label        = "text_overlay_render_pipeline",
+                    .layout       = text_overlay->pipeline_layout,
+                    .primitive    = primitive_state_desc,
+                    .vertex       = vertex_state_desc,
+                    .fragment     = &fragment_state_desc,
+                    .depthStencil = &depth_stencil_state_desc,
+                    .multisample  = multisample_state_desc,
+                  });
   ASSERT(text_overlay->pipeline);
 
   // Shader modules are no longer needed once the graphics pipeline has been
@@ -376,6 +690,7 @@ static void text_overlay_setup_render_pass(text_overlay_t* text_overlay)
 
   // Render pass descriptor
   text_overlay->render_pass.render_pass_descriptor = (WGPURenderPassDescriptor){
+    .label                  = "Text overlay render pass",
     .colorAttachmentCount   = 1,
     .colorAttachments       = text_overlay->render_pass.color_attachment,
     .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
@@ -390,13 +705,13 @@ text_overlay_t* text_overlay_create(wgpu_context_t* wgpu_context)
 
   // Prepare ImGui overlay
   text_overlay_init(text_overlay, wgpu_context);
-  // Create the vertex buffer containing the text overloy vertices
-  text_overlay_create_vertex_buffer(text_overlay);
   // Create the pipeline layout that is used to generate the rendering
   // pipelines
   text_overlay_setup_pipeline_layout(text_overlay);
-  // Create the fonts texture
+  // Create the distance field fonts texture
   text_overlay_create_fonts_texture(text_overlay);
+  // Create the glyph instance buffer, glyph table and uniform buffer
+  text_overlay_create_buffers(text_overlay);
   // Setup the bind group containing the texture bindings
   text_overlay_setup_bind_group(text_overlay);
   // Create the graphics pipeline
@@ -414,45 +729,127 @@ void text_overlay_release(text_overlay_t* text_overlay)
   WGPU_RELEASE_RESOURCE(BindGroup, text_overlay->bind_group);
   WGPU_RELEASE_RESOURCE(BindGroupLayout, text_overlay->bind_group_layout);
 
-  WGPU_RELEASE_RESOURCE(Buffer, text_overlay->vertex_buffer.buffer);
+  WGPU_RELEASE_RESOURCE(Buffer, text_overlay->instance_buffer.buffer);
+  WGPU_RELEASE_RESOURCE(Buffer, text_overlay->glyph_buffer.buffer);
+  WGPU_RELEASE_RESOURCE(Buffer, text_overlay->uniform_buffer.buffer);
   WGPU_RELEASE_RESOURCE(Texture, text_overlay->font.texture);
   WGPU_RELEASE_RESOURCE(TextureView, text_overlay->font.texture_view);
   WGPU_RELEASE_RESOURCE(Sampler, text_overlay->font.sampler);
 
+  free(text_overlay->draw_buffer.instances.data);
+  free(text_overlay->draw_buffer.runs.data);
   free(text_overlay);
 }
 
+void text_overlay_set_text_color(text_overlay_t* text_overlay, float r,
+                                 float g, float b, float a)
+{
+  const float rgba[4] = {r, g, b, a};
+  uint32_t color      = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    const float c = rgba[i] < 0.0f ? 0.0f : rgba[i] > 1.0f ? 1.0f : rgba[i];
+    color |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+  }
+  text_overlay->text_color = color;
+}
+
+void text_overlay_set_scale(text_overlay_t* text_overlay, float scale)
+{
+  text_overlay->scale = scale > 0.0f ? scale : TEXTOVERLAY_DEFAULT_SCALE;
+}
+
 void text_overlay_begin_text_update(text_overlay_t* text_overlay)
 {
+  text_run_list_t* runs = &text_overlay->draw_buffer.runs;
+
   text_overlay->num_letters = 0;
+  runs->previous_count      = runs->count;
+  runs->count               = 0;
+}
+
+/* Marks the instances of a text as changed */
+static void text_overlay_mark_dirty(text_overlay_t* text_overlay,
+                                    uint32_t first, uint32_t count)
+{
+  if (count == 0) {
+    return;
+  }
+  if (text_overlay->draw_buffer.dirty_first
+      >= text_overlay->draw_buffer.dirty_end) {
+    text_overlay->draw_buffer.dirty_first = first;
+    text_overlay->draw_buffer.dirty_end   = first + count;
+  }
+  else {
+    text_overlay->draw_buffer.dirty_first
+      = MIN(text_overlay->draw_buffer.dirty_first, first);
+    text_overlay->draw_buffer.dirty_end
+      = MAX(text_overlay->draw_buffer.dirty_end, first + count);
+  }
+}
+
+static void text_overlay_reserve_instances(text_overlay_t* text_overlay,
+                                           uint32_t count)
+{
+  uint32_t capacity = text_overlay->draw_buffer.instances.capacity;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  if (capacity != text_overlay->draw_buffer.instances.capacity) {
+    text_overlay->draw_buffer.instances.data = (text_glyph_instance_t*)realloc(
+      text_overlay->draw_buffer.instances.data,
+      capacity * sizeof(text_glyph_instance_t));
+    text_overlay->draw_buffer.instances.capacity = capacity;
+  }
+}
+
+/* Returns the slot of the next text, on a cache hit its instances are kept */
+static text_run_t* text_overlay_next_run(text_overlay_t* text_overlay,
+                                         uint64_t key, bool* cached)
+{
+  text_run_list_t* runs = &text_overlay->draw_buffer.runs;
+  if (runs->count == runs->capacity) {
+    runs->capacity *= 2;
+    runs->data
+      = (text_run_t*)realloc(runs->data, runs->capacity * sizeof(text_run_t));
+  }
+  text_run_t* run = &runs->data[runs->count];
+  *cached         = runs->count < runs->previous_count && run->key == key
+            && run->first_instance == text_overlay->num_letters;
+  runs->count++;
+  return run;
+}
+
+/* Chars outside of the font are drawn as a space */
+static uint32_t text_overlay_glyph_index(char c)
+{
+  const uint32_t glyph
+    = (uint32_t)(unsigned char)c - STB_FONT_consolas_24_latin1_FIRST_CHAR;
+  return glyph < STB_FONT_consolas_24_latin1_NUM_CHARS ? glyph : 0u;
 }
 
 void text_overlay_add_text(text_overlay_t* text_overlay, const char* text,
                            float x, float y, text_overlay_text_align_enum align)
 {
-  const uint32_t first_char = STB_FONT_consolas_24_latin1_FIRST_CHAR;
-
   wgpu_context_t* wgpu_context = text_overlay->wgpu_context;
 
   const bool flip_y                  = text_overlay->flip_y;
   const uint32_t frame_buffer_width  = wgpu_context->surface.width;
   const uint32_t frame_buffer_height = wgpu_context->surface.height;
 
-  const float charW = 1.5f / frame_buffer_width;
-  const float charH = 1.5f / frame_buffer_height;
+  // The glyph heights are scaled in the vertex shader
+  const float charW = text_overlay->scale / frame_buffer_width;
 
-  float fbW      = (float)frame_buffer_width;
-  float fbH      = (float)frame_buffer_height;
-  x              = (x / fbW * 2.0f) - 1.0f;
-  y              = flip_y ? (y / fbH * 2.0f) - 1.0f : 1.0f - (y / fbH * 2.0f);
-  float fbYScale = flip_y ? -1.0f : 1.0f;
+  float fbW = (float)frame_buffer_width;
+  float fbH = (float)frame_buffer_height;
+  x         = (x / fbW * 2.0f) - 1.0f;
+  y         = flip_y ? (y / fbH * 2.0f) - 1.0f : 1.0f - (y / fbH * 2.0f);
 
   // Calculate text width
   float textWidth    = 0.0f;
   size_t text_length = strlen(text);
   for (size_t i = 0; i < text_length; ++i) {
     stb_fontchar* charData
-      = &text_overlay->stb_font_data[(uint32_t)text[i] - first_char];
+      = &text_overlay->stb_font_data[text_overlay_glyph_index(text[i])];
     textWidth += charData->advance * charW;
   }
 
@@ -467,41 +864,45 @@ void text_overlay_add_text(text_overlay_t* text_overlay, const char* text,
       break;
   }
 
-  // Generate a uv mapped quad per char in the new text
-  text_vertex_t* mapped
-    = &text_overlay->draw_buffer.vertex.data[text_overlay->num_letters * 4];
+  // Reuse the glyph instances of the previous update for unchanged texts
+  const float layout[3] = {x, y, charW};
+  uint64_t key = text_overlay_hash(0xcbf29ce484222325ull, text, text_length);
+  key          = text_overlay_hash(key, layout, sizeof(layout));
+  key          = text_overlay_hash(key, &text_overlay->text_color,
+                                   sizeof(text_overlay->text_color));
+
+  bool cached     = false;
+  text_run_t* run = text_overlay_next_run(text_overlay, key, &cached);
+  if (cached) {
+    text_overlay->num_letters += run->instance_count;
+    return;
+  }
+
+  // Generate a glyph instance per char in the new text
+  text_overlay_reserve_instances(text_overlay,
+                                 text_overlay->num_letters + text_length);
+  text_glyph_instance_t* instance
+    = &text_overlay->draw_buffer.instances.data[text_overlay->num_letters];
   for (size_t i = 0; i < text_length; ++i) {
-    stb_fontchar* charData
-      = &text_overlay->stb_font_data[(uint32_t)text[i] - first_char];
-
-    mapped->position[0] = (x + (float)charData->x0 * charW);
-    mapped->position[1] = (y - (float)charData->y0 * charH * fbYScale);
-    mapped->uv[0]       = charData->s0;
-    mapped->uv[1]       = charData->t0;
-    mapped++;
-
-    mapped->position[0] = (x + (float)charData->x1 * charW);
-    mapped->position[1] = (y - (float)charData->y0 * charH * fbYScale);
-    mapped->uv[0]       = charData->s1;
-    mapped->uv[1]       = charData->t0;
-    mapped++;
-
-    mapped->position[0] = (x + (float)charData->x0 * charW);
-    mapped->position[1] = (y - (float)charData->y1 * charH * fbYScale);
-    mapped->uv[0]       = charData->s0;
-    mapped->uv[1]       = charData->t1;
-    mapped++;
-
-    mapped->position[0] = (x + (float)charData->x1 * charW);
-    mapped->position[1] = (y - (float)charData->y1 * charH * fbYScale);
-    mapped->uv[0]       = charData->s1;
-    mapped->uv[1]       = charData->t1;
-    mapped++;
+    const uint32_t glyph = text_overlay_glyph_index(text[i]);
+    stb_fontchar* charData = &text_overlay->stb_font_data[glyph];
 
-    x += charData->advance * charW;
+    instance->position[0] = x;
+    instance->position[1] = y;
+    instance->glyph       = glyph;
+    instance->color       = text_overlay->text_color;
+    instance++;
 
-    text_overlay->num_letters++;
+    x += charData->advance * charW;
   }
+  *run = (text_run_t){
+    .key            = key,
+    .first_instance = text_overlay->num_letters,
+    .instance_count = (uint32_t)text_length,
+  };
+  text_overlay_mark_dirty(text_overlay, run->first_instance,
+                          run->instance_count);
+  text_overlay->num_letters += (uint32_t)text_length;
 }
 
 void text_overlay_add_formatted_text(text_overlay_t* text_overlay, float x,
@@ -517,15 +918,53 @@ void text_overlay_add_formatted_text(text_overlay_t* text_overlay, float x,
   text_overlay_add_text(text_overlay, text, x, y, align);
 }
 
-// Unmap buffer
+// Upload the changed glyph instances
 void text_overlay_end_text_update(text_overlay_t* text_overlay)
 {
-  uint32_t data_size = text_overlay->num_letters * sizeof(text_vertex_t)
-                       * 4 /* => 4 vertices per character */;
+  wgpu_context_t* wgpu_context = text_overlay->wgpu_context;
+
+  // Pixel to normalized device coordinates scale of the glyph quads
+  const text_uniforms_t uniforms = {
+    .char_scale = {
+      text_overlay->scale / wgpu_context->surface.width,
+      (text_overlay->flip_y ? -text_overlay->scale : text_overlay->scale)
+        / wgpu_context->surface.height,
+    },
+  };
+  if (memcmp(&uniforms, &text_overlay->draw_buffer.uniforms, sizeof(uniforms))
+      != 0) {
+    if (wgpu_upload_ring_write_buffer(
+          wgpu_context->upload_ring, text_overlay->uniform_buffer.buffer, 0,
+          &uniforms, sizeof(uniforms))) {
+      text_overlay->draw_buffer.uniforms = uniforms;
+    }
+  }
 
-  wgpu_record_copy_data_to_buffer(
-    text_overlay->wgpu_context, &text_overlay->vertex_buffer, 0, data_size,
-    text_overlay->draw_buffer.vertex.data, data_size);
+  // Grow the instance buffer, everything is uploaded again
+  const uint32_t instance_capacity = text_overlay->instance_buffer.size
+                                     / (uint32_t)sizeof(text_glyph_instance_t);
+  if (text_overlay->num_letters > instance_capacity) {
+    wgpu_destroy_buffer(&text_overlay->instance_buffer);
+    text_overlay_create_instance_buffer(
+      text_overlay, text_overlay->draw_buffer.instances.capacity);
+    text_overlay->draw_buffer.dirty_first = 0;
+    text_overlay->draw_buffer.dirty_end   = text_overlay->num_letters;
+  }
+
+  const uint32_t first = text_overlay->draw_buffer.dirty_first;
+  const uint32_t end
+    = MIN(text_overlay->draw_buffer.dirty_end, text_overlay->num_letters);
+  if (first < end
+      && !wgpu_upload_ring_write_buffer(
+        wgpu_context->upload_ring, text_overlay->instance_buffer.buffer,
+        first * sizeof(text_glyph_instance_t),
+        &text_overlay->draw_buffer.instances.data[first],
+        (end - first) * sizeof(text_glyph_instance_t))) {
+    // Retried in the next text update
+    return;
+  }
+  text_overlay->draw_buffer.dirty_first = 0;
+  text_overlay->draw_buffer.dirty_end   = 0;
 }
 
 void text_overlay_draw_frame(text_overlay_t* text_overlay, WGPUTextureView view)
@@ -540,9 +979,10 @@ void text_overlay_draw_frame(text_overlay_t* text_overlay, WGPUTextureView view)
   wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, text_overlay->bind_group, 0,
                                     NULL);
   wgpuRenderPassEncoderSetVertexBuffer(
-    rpass_enc, 0, text_overlay->vertex_buffer.buffer, 0, WGPU_WHOLE_SIZE);
-  for (uint32_t j = 0; j < text_overlay->num_letters; ++j) {
-    wgpuRenderPassEncoderDraw(rpass_enc, 4, 1, j * 4, 0);
+    rpass_enc, 0, text_overlay->instance_buffer.buffer, 0, WGPU_WHOLE_SIZE);
+  // One instanced call, the vertex shader expands each glyph into a quad
+  if (text_overlay->num_letters > 0) {
+    wgpuRenderPassEncoderDraw(rpass_enc, 4, text_overlay->num_letters, 0, 0);
   }
 
   wgpuRenderPassEncoderEnd(rpass_enc);
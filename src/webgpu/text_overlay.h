@@ -15,6 +15,23 @@ typedef enum text_overlay_text_align_enum {
 text_overlay_t* text_overlay_create(wgpu_context_t* wgpu_context);
 void text_overlay_release(text_overlay_t* text_overlay);
 
+/* Color of the texts added afterwards (default: white) */
+void text_overlay_set_text_color(text_overlay_t* text_overlay, float r,
+                                 float g, float b, float a);
+
+/* Glyph size relative to the 24 pixel font (default: 1.5), applies from the
+ * next text update. The glyphs are drawn from a distance field, they stay sharp
+ * at any scale without a new font texture. */
+void text_overlay_set_scale(text_overlay_t* text_overlay, float scale);
+
+/*
+ * Text updates: each character is one glyph instance which is expanded into a
+ * quad in the vertex shader, the buffer grows as needed. A text which matches
+ * the text at the same place in the previous update (same string, position and
+ * color, and no length change of the texts before it) keeps its instances, only
+ * changed texts are uploaded.
+ */
+
 /* Prepare for text update */
 void text_overlay_begin_text_update(text_overlay_t* text_overlay);
 /* Add text to the current buffer */
@@ -1,13 +1,26 @@
 #include "texture.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../core/file.h"
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "../core/thread_pool.h"
+#include "debug_markers.h"
+#include "mipmap_tuner.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
 #include "shader.h"
+#include "upload_batch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)                                       \
+  || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_CHAIN_SSE2 1
+#endif
 
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -100,15 +113,49 @@ static int make_multiple_of_256(int value)
   return resized_width;
 }
 
-static void copy_padding_buffer(unsigned char* dst, unsigned char* src,
-                                int width, int height, int padding)
+/**
+ * @brief Returns the size of a texel block in texels and in bytes, the block
+ * size is 1 for uncompressed formats.
+ */
+static void texture_format_get_block_info(WGPUTextureFormat format,
+                                          uint32_t* block_size,
+                                          uint32_t* block_bytes)
 {
-  unsigned char* s = src;
-  unsigned char* d = dst;
-  for (int i = 0; i < height; ++i) {
-    memcpy(d, s, width * 4);
-    s += width * 4;
-    d += padding * 4;
+  *block_size = 1;
+  switch (format) {
+    case WGPUTextureFormat_R8Unorm:
+      *block_bytes = 1;
+      break;
+    case WGPUTextureFormat_RG32Float:
+    case WGPUTextureFormat_RGBA16Float:
+      *block_bytes = 8;
+      break;
+    case WGPUTextureFormat_RGBA32Float:
+      *block_bytes = 16;
+      break;
+    case WGPUTextureFormat_BC1RGBAUnorm:
+    case WGPUTextureFormat_BC1RGBAUnormSrgb:
+    case WGPUTextureFormat_ETC2RGB8Unorm:
+    case WGPUTextureFormat_ETC2RGB8UnormSrgb:
+      *block_size  = 4;
+      *block_bytes = 8;
+      break;
+    case WGPUTextureFormat_BC2RGBAUnorm:
+    case WGPUTextureFormat_BC2RGBAUnormSrgb:
+    case WGPUTextureFormat_BC3RGBAUnorm:
+    case WGPUTextureFormat_BC3RGBAUnormSrgb:
+    case WGPUTextureFormat_BC7RGBAUnorm:
+    case WGPUTextureFormat_BC7RGBAUnormSrgb:
+    case WGPUTextureFormat_ETC2RGBA8Unorm:
+    case WGPUTextureFormat_ETC2RGBA8UnormSrgb:
+    case WGPUTextureFormat_ASTC4x4Unorm:
+    case WGPUTextureFormat_ASTC4x4UnormSrgb:
+      *block_size  = 4;
+      *block_bytes = 16;
+      break;
+    default:
+      *block_bytes = 4;
+      break;
   }
 }
 
@@ -178,69 +225,201 @@ static uint32_t calculate_mip_level_count(int width, int height)
   return (uint32_t)(floor((float)(log2(MAX(width, height))))) + 1;
 }
 
+/* -------------------------------------------------------------------------- *
+ * CPU mip chain generation
+ * -------------------------------------------------------------------------- */
+
+#define MIP_CHAIN_MAX_LEVELS 32u
+#define MIP_CHAIN_SRGB_LUT_SIZE 4096u
+
+typedef struct mip_chain_level_t {
+  size_t offset; /* byte offset of the level in the mip chain */
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row; /* multiple of 256 as required for uploads */
+} mip_chain_level_t;
+
+/* RGBA8 mip chain, all levels share one allocation that can be copied to a
+ * staging buffer as is */
+typedef struct mip_chain_t {
+  uint8_t* pixels;
+  size_t size;
+  uint32_t level_count;
+  mip_chain_level_t levels[MIP_CHAIN_MAX_LEVELS];
+} mip_chain_t;
+
+static float mip_chain_srgb_to_linear[256];
+static uint8_t mip_chain_linear_to_srgb[MIP_CHAIN_SRGB_LUT_SIZE];
+static bool mip_chain_srgb_tables_ready = false;
+
+static void mip_chain_init_srgb_tables(void)
+{
+  if (mip_chain_srgb_tables_ready) {
+    return;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    const float c               = i / 255.0f;
+    mip_chain_srgb_to_linear[i] = c <= 0.04045f ?
+                                    c / 12.92f :
+                                    powf((c + 0.055f) / 1.055f, 2.4f);
+  }
+  for (uint32_t i = 0; i < MIP_CHAIN_SRGB_LUT_SIZE; ++i) {
+    const float l = i / (float)(MIP_CHAIN_SRGB_LUT_SIZE - 1);
+    const float c = l <= 0.0031308f ? l * 12.92f :
+                                      1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+    mip_chain_linear_to_srgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+  }
+  mip_chain_srgb_tables_ready = true;
+}
+
 /**
- * @brief Deallocates image data.
+ * @brief Computes the layout of the mip chain and allocates its storage.
  */
-static void destroy_image_data(uint8_t** pixel_vec, int width, int height)
+static void mip_chain_create(mip_chain_t* mip_chain, uint32_t width,
+                             uint32_t height, uint32_t level_count)
 {
-  uint32_t mipmap_level = calculate_mip_level_count(width, height);
-  for (uint32_t i = 0; i < mipmap_level; ++i) {
-    free(pixel_vec[i]);
+  ASSERT(level_count > 0 && level_count <= MIP_CHAIN_MAX_LEVELS);
+  memset(mip_chain, 0, sizeof(*mip_chain));
+  mip_chain->level_count = level_count;
+  for (uint32_t i = 0; i < level_count; ++i) {
+    mip_chain_level_t* level = &mip_chain->levels[i];
+    level->offset            = mip_chain->size;
+    level->width             = MAX(width >> i, 1u);
+    level->height            = MAX(height >> i, 1u);
+    level->bytes_per_row     = make_multiple_of_256(level->width * 4);
+    mip_chain->size += (size_t)level->bytes_per_row * level->height;
   }
-  free(pixel_vec);
+  mip_chain->pixels = (uint8_t*)malloc(mip_chain->size);
+  ASSERT(mip_chain->pixels != NULL);
 }
 
 /**
- * @brief Generates mipmaps on the CPU.
- * @see https://github.com/webatintel/aquarium
+ * @brief Deallocates the mip chain storage.
  */
-static void generate_mipmap(uint8_t* input_pixels, int input_w, int input_h,
-                            int input_stride_in_bytes, uint8_t*** output_pixels,
-                            int output_w, int output_h,
-                            int output_stride_in_bytes, int num_channels,
-                            bool is_256_padding)
-{
-  uint32_t mipmap_level = calculate_mip_level_count(output_w, output_h);
-  uint8_t** mipmap_pixels
-    = (unsigned char**)malloc(mipmap_level * sizeof(unsigned char**));
-  *output_pixels = mipmap_pixels;
-  int height     = output_h;
-  int width      = output_w;
-
-  if (!is_256_padding) {
-    for (uint32_t i = 0; i < mipmap_level; ++i) {
-      mipmap_pixels[i]
-        = (unsigned char*)malloc(output_w * height * 4 * sizeof(char));
-      stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes,
-                         mipmap_pixels[i], width, height,
-                         output_stride_in_bytes, num_channels);
-
-      height >>= 1;
-      width >>= 1;
-      if (height == 0) {
-        height = 1;
-      }
+static void mip_chain_release(mip_chain_t* mip_chain)
+{
+  free(mip_chain->pixels);
+  memset(mip_chain, 0, sizeof(*mip_chain));
+}
+
+/* 2x2 box filter of one row, the last column is repeated for a source width
+ * of 1 */
+static void mip_chain_downsample_row(const uint8_t* row0, const uint8_t* row1,
+                                     uint8_t* out, uint32_t src_width,
+                                     uint32_t dst_width)
+{
+  uint32_t x = 0;
+#if defined(MIP_CHAIN_SSE2)
+  // Four texels per iteration, the sums are computed in 16 bit lanes
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(2);
+  for (; x + 4 <= dst_width; x += 4) {
+    const __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+    const __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+    const __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+    const __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+    // Vertical sums of the source texel pairs (0,1), (2,3), (4,5) and (6,7)
+    const __m128i s0
+      = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+    const __m128i s1
+      = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+    const __m128i s2
+      = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+    const __m128i s3
+      = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+    // Horizontal sums of the pairs
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                               _mm_unpackhi_epi64(s0, s1));
+    __m128i hi = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3),
+                               _mm_unpackhi_epi64(s2, s3));
+    lo         = _mm_srli_epi16(_mm_add_epi16(lo, bias), 2);
+    hi         = _mm_srli_epi16(_mm_add_epi16(hi, bias), 2);
+    _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; x < dst_width; ++x) {
+    const uint32_t x0 = MIN(2 * x, src_width - 1) * 4;
+    const uint32_t x1 = MIN(2 * x + 1, src_width - 1) * 4;
+    for (uint32_t c = 0; c < 4; ++c) {
+      out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c]
+                                  + row1[x1 + c] + 2)
+                                 >> 2);
+    }
+  }
+}
+
+/* 2x2 box filter of one row, the color channels are averaged in linear space
+ * and alpha as is */
+static void mip_chain_downsample_row_srgb(const uint8_t* row0,
+                                          const uint8_t* row1, uint8_t* out,
+                                          uint32_t src_width,
+                                          uint32_t dst_width)
+{
+  const float* to_linear = mip_chain_srgb_to_linear;
+  const float lut_scale  = (float)(MIP_CHAIN_SRGB_LUT_SIZE - 1);
+  for (uint32_t x = 0; x < dst_width; ++x) {
+    const uint32_t x0 = MIN(2 * x, src_width - 1) * 4;
+    const uint32_t x1 = MIN(2 * x + 1, src_width - 1) * 4;
+    for (uint32_t c = 0; c < 3; ++c) {
+      const float l = (to_linear[row0[x0 + c]] + to_linear[row0[x1 + c]]
+                       + to_linear[row1[x0 + c]] + to_linear[row1[x1 + c]])
+                      * 0.25f;
+      out[x * 4 + c]
+        = mip_chain_linear_to_srgb[(uint32_t)(l * lut_scale + 0.5f)];
+    }
+    out[x * 4 + 3] = (uint8_t)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3]
+                                + row1[x1 + 3] + 2)
+                               >> 2);
+  }
+}
+
+/**
+ * @brief Generates the mip chain on the CPU from an RGBA8 image. Level 0 is
+ * resized from the image when the sizes differ, every following level is
+ * downsampled from the previous one.
+ */
+static void mip_chain_generate(mip_chain_t* mip_chain, const uint8_t* pixels,
+                               uint32_t width, uint32_t height, bool srgb)
+{
+  const mip_chain_level_t* base = &mip_chain->levels[0];
+  if (width == base->width && height == base->height) {
+    for (uint32_t y = 0; y < height; ++y) {
+      memcpy(mip_chain->pixels + (size_t)y * base->bytes_per_row,
+             pixels + (size_t)y * width * 4, width * 4);
     }
   }
+  else if (srgb) {
+    stbir_resize_uint8_srgb(pixels, width, height, 0, mip_chain->pixels,
+                            base->width, base->height, base->bytes_per_row, 4,
+                            3, 0);
+  }
   else {
-    uint8_t* pixels
-      = (unsigned char*)malloc(output_w * height * 4 * sizeof(char));
-
-    for (uint32_t i = 0; i < mipmap_level; ++i) {
-      mipmap_pixels[i]
-        = (unsigned char*)malloc(output_w * height * 4 * sizeof(char));
-      stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes,
-                         pixels, width, height, output_stride_in_bytes,
-                         num_channels);
-      copy_padding_buffer(mipmap_pixels[i], pixels, width, height, output_w);
-
-      height >>= 1;
-      width >>= 1;
-      if (height == 0) {
-        height = 1;
+    stbir_resize_uint8(pixels, width, height, 0, mip_chain->pixels,
+                       base->width, base->height, base->bytes_per_row, 4);
+  }
+
+  if (srgb) {
+    mip_chain_init_srgb_tables();
+  }
+  for (uint32_t i = 1; i < mip_chain->level_count; ++i) {
+    const mip_chain_level_t* src = &mip_chain->levels[i - 1];
+    const mip_chain_level_t* dst = &mip_chain->levels[i];
+    for (uint32_t y = 0; y < dst->height; ++y) {
+      const uint8_t* row0 = mip_chain->pixels + src->offset
+                            + (size_t)MIN(2 * y, src->height - 1)
+                                * src->bytes_per_row;
+      const uint8_t* row1 = mip_chain->pixels + src->offset
+                            + (size_t)MIN(2 * y + 1, src->height - 1)
+                                * src->bytes_per_row;
+      uint8_t* out
+        = mip_chain->pixels + dst->offset + (size_t)y * dst->bytes_per_row;
+      if (srgb) {
+        mip_chain_downsample_row_srgb(row0, row1, out, src->width, dst->width);
+      }
+      else {
+        mip_chain_downsample_row(row0, row1, out, src->width, dst->width);
       }
     }
-    free(pixels);
   }
 }
 
@@ -249,6 +428,7 @@ static void generate_mipmap(uint8_t* input_pixels, int input_w, int input_h,
  * -------------------------------------------------------------------------- */
 
 #define NUMBER_OF_TEXTURE_FORMATS WGPUTextureFormat_R8BG8Biplanar420Unorm
+#define MIPMAP_COMPUTE_FORMAT_COUNT 6u
 
 struct wgpu_mipmap_generator {
   wgpu_context_t* wgpu_context;
@@ -260,6 +440,11 @@ struct wgpu_mipmap_generator {
   // Vertex state and  Fragment state are shared between all pipelines
   WGPUVertexState vertex_state_desc;
   WGPUFragmentState fragment_state_desc;
+  // Compute pipelines for the formats with storage texture support
+  struct {
+    WGPUBindGroupLayout bind_group_layouts[MIPMAP_COMPUTE_FORMAT_COUNT];
+    WGPUComputePipeline pipelines[MIPMAP_COMPUTE_FORMAT_COUNT];
+  } compute;
 };
 
 wgpu_mipmap_generator_t*
@@ -283,8 +468,7 @@ wgpu_mipmap_generator_create(wgpu_context_t* wgpu_context)
     .lodMaxClamp   = 1.0f,
     .maxAnisotropy = 1,
   };
-  mipmap_generator->sampler
-    = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+  mipmap_generator->sampler = wgpu_create_sampler(wgpu_context, &sampler_desc);
   ASSERT(mipmap_generator->sampler != NULL);
 
   return mipmap_generator;
@@ -299,6 +483,12 @@ void wgpu_mipmap_generator_destroy(wgpu_mipmap_generator_t* mipmap_generator)
       mipmap_generator->active_pipelines[i] = false;
     }
   }
+  for (uint32_t i = 0; i < MIPMAP_COMPUTE_FORMAT_COUNT; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                          mipmap_generator->compute.bind_group_layouts[i])
+    WGPU_RELEASE_RESOURCE(ComputePipeline,
+                          mipmap_generator->compute.pipelines[i])
+  }
   if (!mipmap_generator->vertex_state_desc.module
       || !mipmap_generator->fragment_state_desc.module) {
     WGPU_RELEASE_RESOURCE(ShaderModule,
@@ -400,8 +590,8 @@ WGPURenderPipeline wgpu_mipmap_generator_get_mipmap_pipeline(
 
     // Create rendering pipeline using the specified states
     mipmap_generator->pipelines[pipeline_index]
-      = wgpuDeviceCreateRenderPipeline(
-        wgpu_context->device,
+      = wgpu_create_render_pipeline(
+        wgpu_context,
         &(WGPURenderPipelineDescriptor){
           .label       = "blit_render_pipeline",
           .primitive   = primitive_state_desc,
@@ -424,21 +614,297 @@ WGPURenderPipeline wgpu_mipmap_generator_get_mipmap_pipeline(
   return mipmap_generator->pipelines[pipeline_index];
 }
 
-WGPUTexture
-wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
-                                      WGPUTexture texture,
-                                      WGPUTextureDescriptor* texture_desc)
+/* Compute mipmap generation */
+
+/* Number of mip levels generated by one dispatch, a workgroup reduces a 64x64
+ * texel tile of the source level down to a single texel */
+#define MIPMAP_COMPUTE_LEVELS_PER_DISPATCH 6u
+#define MIPMAP_COMPUTE_TILE_SIZE 32u /* size of the first level of a tile */
+
+static const struct {
+  WGPUTextureFormat format;
+  const char* wgsl_format;
+} mipmap_compute_formats[MIPMAP_COMPUTE_FORMAT_COUNT] = {
+  {WGPUTextureFormat_RGBA8Unorm, "rgba8unorm"},
+  {WGPUTextureFormat_RGBA8Snorm, "rgba8snorm"},
+  {WGPUTextureFormat_RGBA16Float, "rgba16float"},
+  {WGPUTextureFormat_RGBA32Float, "rgba32float"},
+  {WGPUTextureFormat_R32Float, "r32float"},
+  {WGPUTextureFormat_RG32Float, "rg32float"},
+};
+
+// clang-format off
+static const char* mipmap_compute_shader_wgsl_format = CODE(
+  struct Params {
+    mipCount : u32,
+  }
+
+  @group(0) @binding(0) var src : texture_2d<f32>;
+  @group(0) @binding(1) var<uniform> params : Params;
+  @group(0) @binding(2) var dst0 : texture_storage_2d<%s, write>;
+  @group(0) @binding(3) var dst1 : texture_storage_2d<%s, write>;
+  @group(0) @binding(4) var dst2 : texture_storage_2d<%s, write>;
+  @group(0) @binding(5) var dst3 : texture_storage_2d<%s, write>;
+  @group(0) @binding(6) var dst4 : texture_storage_2d<%s, write>;
+  @group(0) @binding(7) var dst5 : texture_storage_2d<%s, write>;
+
+  var<workgroup> tile : array<vec4<f32>, 1024>;
+
+  fn loadSrc(coord : vec2<i32>) -> vec4<f32> {
+    let size = vec2<i32>(textureDimensions(src));
+    return textureLoad(src, clamp(coord, vec2<i32>(0), size - vec2<i32>(1)), 0);
+  }
+
+  fn inBounds(coord : vec2<i32>, size : vec2<i32>) -> bool {
+    return all(coord < size);
+  }
+
+  fn storeMip(level : u32, coord : vec2<i32>, value : vec4<f32>) {
+    switch (level) {
+      case 0u: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst0)))) {
+          textureStore(dst0, coord, value);
+        }
+      }
+      case 1u: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst1)))) {
+          textureStore(dst1, coord, value);
+        }
+      }
+      case 2u: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst2)))) {
+          textureStore(dst2, coord, value);
+        }
+      }
+      case 3u: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst3)))) {
+          textureStore(dst3, coord, value);
+        }
+      }
+      case 4u: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst4)))) {
+          textureStore(dst4, coord, value);
+        }
+      }
+      default: {
+        if (inBounds(coord, vec2<i32>(textureDimensions(dst5)))) {
+          textureStore(dst5, coord, value);
+        }
+      }
+    }
+  }
+
+  @compute @workgroup_size(16, 16)
+  fn main(@builtin(workgroup_id) groupId : vec3<u32>,
+          @builtin(local_invocation_id) localId : vec3<u32>) {
+    // First level: every thread reduces four 2x2 blocks of the source level
+    for (var i = 0u; i < 4u; i = i + 1u) {
+      let pos = localId.xy * 2u + vec2<u32>(i & 1u, i >> 1u);
+      let coord = vec2<i32>(groupId.xy * 32u + pos);
+      let s = coord * 2;
+      let value = (loadSrc(s) + loadSrc(s + vec2<i32>(1, 0))
+                   + loadSrc(s + vec2<i32>(0, 1))
+                   + loadSrc(s + vec2<i32>(1, 1))) * 0.25;
+      storeMip(0u, coord, value);
+      tile[pos.y * 32u + pos.x] = value;
+    }
+    // Remaining levels are reduced in workgroup memory
+    var size = 16u;
+    for (var level = 1u; level < 6u; level = level + 1u) {
+      workgroupBarrier();
+      let active = all(localId.xy < vec2<u32>(size));
+      var value = vec4<f32>(0.0);
+      if (active) {
+        let c = localId.xy * 2u;
+        value = (tile[c.y * 32u + c.x] + tile[c.y * 32u + c.x + 1u]
+                 + tile[(c.y + 1u) * 32u + c.x]
+                 + tile[(c.y + 1u) * 32u + c.x + 1u]) * 0.25;
+      }
+      workgroupBarrier();
+      if (active) {
+        tile[localId.y * 32u + localId.x] = value;
+        if (level < params.mipCount) {
+          storeMip(level, vec2<i32>(groupId.xy * size + localId.xy), value);
+        }
+      }
+      size = size / 2u;
+    }
+  }
+);
+// clang-format on
+
+static int32_t mipmap_compute_format_index(WGPUTextureFormat format)
 {
-  WGPURenderPipeline pipeline = wgpu_mipmap_generator_get_mipmap_pipeline(
-    mipmap_generator, texture_desc->format);
+  for (uint32_t i = 0; i < (uint32_t)MIPMAP_COMPUTE_FORMAT_COUNT; ++i) {
+    if (mipmap_compute_formats[i].format == format) {
+      return (int32_t)i;
+    }
+  }
+  return -1;
+}
 
-  if (texture_desc->dimension == WGPUTextureDimension_3D
-      || texture_desc->dimension == WGPUTextureDimension_1D) {
-    log_error(
-      "Generating mipmaps for non-2d textures is currently unsupported!");
-    return NULL;
+bool wgpu_mipmap_generator_supports_compute(WGPUTextureFormat format)
+{
+  return mipmap_compute_format_index(format) >= 0;
+}
+
+static WGPUComputePipeline
+mipmap_generator_get_compute_pipeline(wgpu_mipmap_generator_t* mipmap_generator,
+                                      uint32_t format_index)
+{
+  if (mipmap_generator->compute.pipelines[format_index] != NULL) {
+    return mipmap_generator->compute.pipelines[format_index];
+  }
+
+  // The storage texture format is part of the shader
+  const char* wgsl_format = mipmap_compute_formats[format_index].wgsl_format;
+  const size_t wgsl_size  = strlen(mipmap_compute_shader_wgsl_format)
+                           + 6 * strlen(wgsl_format) + 1;
+  char* wgsl_code = (char*)malloc(wgsl_size);
+  snprintf(wgsl_code, wgsl_size, mipmap_compute_shader_wgsl_format,
+           wgsl_format, wgsl_format, wgsl_format, wgsl_format, wgsl_format,
+           wgsl_format);
+
+  wgpu_context_t* wgpu_context = mipmap_generator->wgpu_context;
+  wgpu_shader_t mipmap_shader  = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                     // Compute shader WGSL
+                     .wgsl_code.source = wgsl_code,
+                     .entry            = "main",
+                  });
+  mipmap_generator->compute.pipelines[format_index]
+    = wgpu_create_compute_pipeline(
+      wgpu_context,
+      &(WGPUComputePipelineDescriptor){
+        .label   = "mipmap_compute_pipeline",
+        .compute = mipmap_shader.programmable_stage_descriptor,
+      });
+  ASSERT(mipmap_generator->compute.pipelines[format_index] != NULL);
+  wgpu_shader_release(&mipmap_shader);
+  free(wgsl_code);
+
+  // Store the bind group layout of the created pipeline
+  mipmap_generator->compute.bind_group_layouts[format_index]
+    = wgpuComputePipelineGetBindGroupLayout(
+      mipmap_generator->compute.pipelines[format_index], 0);
+  ASSERT(mipmap_generator->compute.bind_group_layouts[format_index] != NULL);
+
+  return mipmap_generator->compute.pipelines[format_index];
+}
+
+static void mipmap_generator_encode_compute(
+  wgpu_mipmap_generator_t* mipmap_generator, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc,
+  uint32_t format_index)
+{
+  wgpu_context_t* wgpu_context = mipmap_generator->wgpu_context;
+  WGPUComputePipeline pipeline
+    = mipmap_generator_get_compute_pipeline(mipmap_generator, format_index);
+  WGPUBindGroupLayout bind_group_layout
+    = mipmap_generator->compute.bind_group_layouts[format_index];
+  const uint32_t array_layer_count = texture_desc->size.depthOrArrayLayers > 0 ?
+                                       texture_desc->size.depthOrArrayLayers :
+                                       1;
+  const uint32_t mip_level_count   = texture_desc->mipLevelCount;
+
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_encoder, &(WGPUComputePassDescriptor){
+                   .label = "Mipmap generation compute pass",
+                 });
+  wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+
+  for (uint32_t array_layer = 0; array_layer < array_layer_count;
+       ++array_layer) {
+    for (uint32_t base_mip = 0; base_mip + 1 < mip_level_count;
+         base_mip += MIPMAP_COMPUTE_LEVELS_PER_DISPATCH) {
+      const uint32_t mip_count = MIN(MIPMAP_COMPUTE_LEVELS_PER_DISPATCH,
+                                     mip_level_count - 1 - base_mip);
+      WGPUTextureViewDescriptor view_desc = {
+        .aspect          = WGPUTextureAspect_All,
+        .mipLevelCount   = 1,
+        .dimension       = WGPUTextureViewDimension_2D,
+        .baseArrayLayer  = array_layer,
+        .arrayLayerCount = 1,
+      };
+
+      // Source level and the generated levels, the unused bindings repeat
+      // the last generated level and are never written
+      WGPUTextureView views[1 + MIPMAP_COMPUTE_LEVELS_PER_DISPATCH] = {0};
+      view_desc.label        = "src_view";
+      view_desc.baseMipLevel = base_mip;
+      views[0]               = wgpuTextureCreateView(texture, &view_desc);
+      view_desc.label        = "dst_view";
+      for (uint32_t i = 0; i < mip_count; ++i) {
+        view_desc.baseMipLevel = base_mip + 1 + i;
+        views[1 + i]           = wgpuTextureCreateView(texture, &view_desc);
+      }
+
+      const uint32_t params[4] = {mip_count, 0, 0, 0};
+      WGPUBuffer params_buffer = wgpu_create_buffer_from_data(
+        wgpu_context, params, sizeof(params), WGPUBufferUsage_Uniform);
+
+      WGPUBindGroupEntry bg_entries[2 + MIPMAP_COMPUTE_LEVELS_PER_DISPATCH] = {
+        [0] = (WGPUBindGroupEntry){
+          .binding     = 0,
+          .textureView = views[0],
+        },
+        [1] = (WGPUBindGroupEntry){
+          .binding = 1,
+          .buffer  = params_buffer,
+          .size    = sizeof(params),
+        },
+      };
+      for (uint32_t i = 0; i < MIPMAP_COMPUTE_LEVELS_PER_DISPATCH; ++i) {
+        bg_entries[2 + i] = (WGPUBindGroupEntry){
+          .binding     = 2 + i,
+          .textureView = views[1 + MIN(i, mip_count - 1)],
+        };
+      }
+      WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+        wgpu_context->device, &(WGPUBindGroupDescriptor){
+                                .layout     = bind_group_layout,
+                                .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                                .entries    = bg_entries,
+                              });
+
+      // One workgroup per tile of the first generated level
+      const uint32_t shift  = base_mip + 1;
+      const uint32_t width  = MAX(texture_desc->size.width >> shift, 1u);
+      const uint32_t height = MAX(texture_desc->size.height >> shift, 1u);
+      if (wgpu_debug_markers_enabled()) {
+        char group_name[STRMAX];
+        snprintf(group_name, sizeof(group_name),
+                 "Mip levels %u-%u, layer %u", base_mip + 1,
+                 base_mip + mip_count, array_layer);
+        wgpu_compute_pass_debug_group_push(pass_encoder, group_name);
+      }
+      wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+      wgpuComputePassEncoderDispatchWorkgroups(
+        pass_encoder,
+        (width + MIPMAP_COMPUTE_TILE_SIZE - 1) / MIPMAP_COMPUTE_TILE_SIZE,
+        (height + MIPMAP_COMPUTE_TILE_SIZE - 1) / MIPMAP_COMPUTE_TILE_SIZE, 1);
+      wgpu_compute_pass_debug_group_pop(pass_encoder);
+
+      // The command encoder keeps the resources alive until the submit
+      WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+      WGPU_RELEASE_RESOURCE(Buffer, params_buffer)
+      for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(views); ++i) {
+        WGPU_RELEASE_RESOURCE(TextureView, views[i])
+      }
+    }
   }
 
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+}
+
+static void mipmap_generator_encode_render(
+  wgpu_mipmap_generator_t* mipmap_generator, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc)
+{
+  WGPURenderPipeline pipeline = wgpu_mipmap_generator_get_mipmap_pipeline(
+    mipmap_generator, texture_desc->format);
+
   wgpu_context_t* wgpu_context     = mipmap_generator->wgpu_context;
   WGPUTexture mip_texture          = texture;
   const uint32_t array_layer_count = texture_desc->size.depthOrArrayLayers > 0 ?
@@ -472,8 +938,7 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
     ASSERT(mip_texture != NULL);
   }
 
-  WGPUCommandEncoder cmd_encoder
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpu_debug_group_push(cmd_encoder, "Generate mipmaps");
   uint32_t pipeline_index = (uint32_t)texture_desc->format;
   WGPUBindGroupLayout bind_group_layout
     = mipmap_generator->pipeline_layouts[pipeline_index];
@@ -526,8 +991,12 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
              .a = 0.0f,
            },
         };
+      char pass_label[STRMAX];
+      snprintf(pass_label, sizeof(pass_label),
+               "Mipmap level %u, layer %u render pass", i, array_layer);
       WGPURenderPassEncoder pass_encoder = wgpuCommandEncoderBeginRenderPass(
         cmd_encoder, &(WGPURenderPassDescriptor){
+                       .label                  = pass_label,
                        .colorAttachmentCount   = 1,
                        .colorAttachments       = &color_attachment_desc,
                        .depthStencilAttachment = NULL,
@@ -589,21 +1058,12 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
       mip_level_size.height = ceil(mip_level_size.height / 2.0f);
     }
   }
+  wgpu_debug_group_pop(cmd_encoder);
 
-  WGPUCommandBuffer command_buffer
-    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
-  ASSERT(command_buffer != NULL);
-  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
-
-  // Sumbit commmand buffer and cleanup
-  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
-  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
-
+  // Cleanup, the command encoder keeps the resources alive until the submit
   if (!render_to_source) {
     WGPU_RELEASE_RESOURCE(Texture, mip_texture);
   }
-
-  // Cleanup
   for (uint32_t i = 0; i < views_count; ++i) {
     WGPU_RELEASE_RESOURCE(TextureView, views[i]);
   }
@@ -612,72 +1072,543 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
     WGPU_RELEASE_RESOURCE(BindGroup, bind_groups[i]);
   }
   free(bind_groups);
+}
 
-  return texture;
+bool wgpu_mipmap_method_supports(wgpu_mipmap_method_enum_t method,
+                                 const WGPUTextureDescriptor* texture_desc)
+{
+  if (texture_desc->dimension == WGPUTextureDimension_3D
+      || texture_desc->dimension == WGPUTextureDimension_1D) {
+    return false;
+  }
+  switch (method) {
+    case WGPU_MipmapMethod_Auto:
+    case WGPU_MipmapMethod_Render:
+      return true;
+    case WGPU_MipmapMethod_Compute:
+      return wgpu_mipmap_generator_supports_compute(texture_desc->format);
+    case WGPU_MipmapMethod_CPU:
+      // The CPU mip chain is 4 channels of 8 bits and one layer
+      return texture_desc->size.depthOrArrayLayers <= 1
+             && texture_desc->mipLevelCount <= MIP_CHAIN_MAX_LEVELS
+             && (srgb_to_linear_format(texture_desc->format)
+                   == WGPUTextureFormat_RGBA8Unorm
+                 || srgb_to_linear_format(texture_desc->format)
+                      == WGPUTextureFormat_BGRA8Unorm);
+    default:
+      return false;
+  }
 }
 
-/* -------------------------------------------------------------------------- *
- * WebGPU Texture Client
- * -------------------------------------------------------------------------- */
+const char* wgpu_mipmap_method_get_name(wgpu_mipmap_method_enum_t method)
+{
+  static const char* names[WGPU_MipmapMethod_Count] = {
+    "Auto",    // WGPU_MipmapMethod_Auto
+    "Render",  // WGPU_MipmapMethod_Render
+    "Compute", // WGPU_MipmapMethod_Compute
+    "CPU",     // WGPU_MipmapMethod_CPU
+  };
+  return method < WGPU_MipmapMethod_Count ? names[method] : "Unknown";
+}
 
-typedef struct texture_result_t {
-  WGPUTexture texture;
-  uint32_t width;
-  uint32_t height;
-  uint32_t depth;
-  uint32_t mip_level_count;
-  WGPUTextureFormat format;
-  WGPUTextureDimension dimension;
-} texture_result_t;
+bool wgpu_mipmap_generator_encode_mipmap(
+  wgpu_mipmap_generator_t* mipmap_generator, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc,
+  wgpu_mipmap_method_enum_t method)
+{
+  if (method == WGPU_MipmapMethod_CPU
+      || !wgpu_mipmap_method_supports(method, texture_desc)) {
+    return false;
+  }
 
-texture_result_t wgpu_texture_client_load_texture_from_memory(
-  struct wgpu_texture_client_t* texture_client, void* data, size_t data_size,
-  struct wgpu_texture_load_options_t* options)
+  // Textures with storage usage are downsampled in a compute pass, several
+  // mip levels per dispatch
+  const int32_t compute_format_index
+    = mipmap_compute_format_index(texture_desc->format);
+  const bool storage = texture_desc->usage & WGPUTextureUsage_StorageBinding;
+  if (method == WGPU_MipmapMethod_Compute && !storage) {
+    return false;
+  }
+  if (method != WGPU_MipmapMethod_Render && compute_format_index >= 0
+      && storage) {
+    mipmap_generator_encode_compute(mipmap_generator, cmd_encoder, texture,
+                                    texture_desc,
+                                    (uint32_t)compute_format_index);
+  }
+  else {
+    mipmap_generator_encode_render(mipmap_generator, cmd_encoder, texture,
+                                   texture_desc);
+  }
+  return true;
+}
+
+WGPUTexture
+wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
+                                      WGPUTexture texture,
+                                      WGPUTextureDescriptor* texture_desc)
 {
-  if (!texture_client->wgpu_context) {
-    log_error("Cannot create new textures after object has been destroyed.");
-    return (texture_result_t){0};
+  if (texture_desc->dimension == WGPUTextureDimension_3D
+      || texture_desc->dimension == WGPUTextureDimension_1D) {
+    log_error(
+      "Generating mipmaps for non-2d textures is currently unsupported!");
+    return NULL;
   }
 
-  static const uint8_t comp_map[5] = {
-    0, //
-    1, //
-    2, //
-    4, //
-    4  //
-  };
-  static const uint32_t channels[5] = {
-    STBI_default,    // only used for req_comp
-    STBI_grey,       //
-    STBI_grey_alpha, //
-    STBI_rgb_alpha,  //
-    STBI_rgb_alpha   //
-  };
+  // Sumbit commmand buffer, batched uploads are submitted with the batch
+  wgpu_context_t* wgpu_context   = mipmap_generator->wgpu_context;
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  wgpu_mipmap_generator_encode_mipmap(mipmap_generator, cmd_encoder, texture,
+                                      texture_desc, WGPU_MipmapMethod_Auto);
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
 
-  bool is_hdr = stbi_is_hdr_from_memory((stbi_uc*)data, data_size);
-  int width = 0, height = 0, read_comps = 4;
-  stbi_set_flip_vertically_on_load(false);
-  uint8_t* pixel_data
-    = is_hdr ? (uint8_t*)stbi_loadf_from_memory((stbi_uc*)data, data_size,
-                                                &width, &height, &read_comps,
-                                                channels[read_comps]) :
-               (uint8_t*)stbi_load_from_memory((stbi_uc*)data, data_size,
-                                               &width, &height, &read_comps,
-                                               channels[read_comps]);
+  return texture;
+}
 
-  if (pixel_data == NULL) {
-    log_warn("Couldn't parse image data!");
-    return (texture_result_t){0};
+bool wgpu_mipmap_generator_encode_cpu_mipmap(
+  wgpu_context_t* wgpu_context, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc,
+  const uint8_t* pixels)
+{
+  if (!wgpu_mipmap_method_supports(WGPU_MipmapMethod_CPU, texture_desc)) {
+    return false;
   }
-  ASSERT(pixel_data);
 
-  const uint8_t comps         = comp_map[read_comps];
-  const bool generate_mipmaps = options ? options->generate_mipmaps : false;
-  const uint32_t mip_level_count
-    = generate_mipmaps ? calculate_mip_level_count(width, height) : 1u;
+  const uint32_t width  = texture_desc->size.width;
+  const uint32_t height = texture_desc->size.height;
+  const bool srgb
+    = srgb_to_linear_format(texture_desc->format) != texture_desc->format;
+  mip_chain_t mip_chain = {0};
+  mip_chain_create(&mip_chain, width, height,
+                   MAX(texture_desc->mipLevelCount, 1u));
+  mip_chain_generate(&mip_chain, pixels, width, height, srgb);
+
+  // The mip chain layout already has the row pitch of buffer copies
+  WGPUBuffer staging_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device, &(WGPUBufferDescriptor){
+                            .label = "mip_chain_staging_buffer",
+                            .usage = WGPUBufferUsage_CopySrc
+                                     | WGPUBufferUsage_MapWrite,
+                            .size  = mip_chain.size,
+                            .mappedAtCreation = true,
+                          });
+  ASSERT(staging_buffer)
+  void* staging_data
+    = wgpuBufferGetMappedRange(staging_buffer, 0, mip_chain.size);
+  ASSERT(staging_data)
+  memcpy(staging_data, mip_chain.pixels, mip_chain.size);
+  wgpuBufferUnmap(staging_buffer);
+
+  for (uint32_t level = 0; level < mip_chain.level_count; ++level) {
+    const mip_chain_level_t* mip_level = &mip_chain.levels[level];
+    wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
+      // Source
+      &(WGPUImageCopyBuffer) {
+        .buffer = staging_buffer,
+        .layout = (WGPUTextureDataLayout) {
+          .offset       = mip_level->offset,
+          .bytesPerRow  = mip_level->bytes_per_row,
+          .rowsPerImage = mip_level->height,
+        },
+      },
+      // Destination
+      &(WGPUImageCopyTexture){
+        .texture  = texture,
+        .mipLevel = level,
+        .origin   = (WGPUOrigin3D){0},
+        .aspect   = WGPUTextureAspect_All,
+      },
+      // Copy size
+      &(WGPUExtent3D){
+        .width              = mip_level->width,
+        .height             = mip_level->height,
+        .depthOrArrayLayers = 1,
+      });
+  }
 
-  const WGPUTextureUsage usage
-    = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding;
+  // The command encoder keeps the staging buffer alive until the submit
+  WGPU_RELEASE_RESOURCE(Buffer, staging_buffer)
+  mip_chain_release(&mip_chain);
+  return true;
+}
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU YUV Converter
+ * -------------------------------------------------------------------------- */
+
+#define YUV_CONVERTER_WORKGROUP_SIZE 8u
+
+// clang-format off
+static const char* yuv_converter_shader_wgsl = CODE(
+  override nv12 : bool = false;
+  override bt709 : bool = true;
+  override full_range : bool = false;
+
+  @group(0) @binding(0) var luma : texture_2d<f32>;
+  @group(0) @binding(1) var chroma0 : texture_2d<f32>; // U or UV
+  @group(0) @binding(2) var chroma1 : texture_2d<f32>; // V, unused for NV12
+  @group(0) @binding(3) var dst : texture_storage_2d<rgba8unorm, write>;
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let size = vec2<u32>(textureDimensions(luma));
+    if (any(id.xy >= size)) {
+      return;
+    }
+    let coord        = vec2<i32>(id.xy);
+    let chroma_coord = coord / 2;
+    var y  = textureLoad(luma, coord, 0).r;
+    var uv = textureLoad(chroma0, chroma_coord, 0).rg;
+    if (!nv12) {
+      uv.y = textureLoad(chroma1, chroma_coord, 0).r;
+    }
+    uv = uv - vec2<f32>(128.0 / 255.0);
+    if (!full_range) {
+      y  = (y - 16.0 / 255.0) * (255.0 / 219.0);
+      uv = uv * (255.0 / 224.0);
+    }
+    var rgb : vec3<f32>;
+    if (bt709) {
+      rgb = vec3<f32>(y + 1.5748 * uv.y,
+                      y - 0.1873 * uv.x - 0.4681 * uv.y,
+                      y + 1.8556 * uv.x);
+    }
+    else {
+      rgb = vec3<f32>(y + 1.402 * uv.y,
+                      y - 0.344136 * uv.x - 0.714136 * uv.y,
+                      y + 1.772 * uv.x);
+    }
+    textureStore(dst, coord, vec4<f32>(clamp(rgb, vec3<f32>(0.0),
+                                             vec3<f32>(1.0)), 1.0));
+  }
+);
+// clang-format on
+
+struct wgpu_yuv_converter {
+  wgpu_context_t* wgpu_context;
+  wgpu_yuv_converter_desc_t desc;
+  uint32_t chroma_width;
+  uint32_t chroma_height;
+  // Y plane and the chroma planes, the second chroma plane is unused for NV12
+  WGPUTexture plane_textures[3];
+  WGPUComputePipeline pipeline;
+  WGPUBindGroup bind_group;
+};
+
+static WGPUTexture yuv_converter_create_plane_texture(
+  wgpu_context_t* wgpu_context, uint32_t width, uint32_t height,
+  WGPUTextureFormat format)
+{
+  WGPUTexture texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "yuv_plane_texture",
+      .size          = (WGPUExtent3D){
+        .width              = width,
+        .height             = height,
+        .depthOrArrayLayers = 1,
+      },
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+      .dimension     = WGPUTextureDimension_2D,
+      .format        = format,
+      .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+    });
+  ASSERT(texture != NULL);
+  return texture;
+}
+
+wgpu_yuv_converter_t*
+wgpu_yuv_converter_create(wgpu_context_t* wgpu_context,
+                          const wgpu_yuv_converter_desc_t* desc)
+{
+  ASSERT(desc->texture != NULL && desc->width > 0 && desc->height > 0);
+
+  wgpu_yuv_converter_t* yuv_converter
+    = (wgpu_yuv_converter_t*)calloc(1, sizeof(wgpu_yuv_converter_t));
+  yuv_converter->wgpu_context  = wgpu_context;
+  yuv_converter->desc          = *desc;
+  yuv_converter->chroma_width  = (desc->width + 1) / 2;
+  yuv_converter->chroma_height = (desc->height + 1) / 2;
+
+  // Plane textures
+  const bool nv12 = desc->format == WGPU_YUV_Format_NV12;
+  yuv_converter->plane_textures[0] = yuv_converter_create_plane_texture(
+    wgpu_context, desc->width, desc->height, WGPUTextureFormat_R8Unorm);
+  yuv_converter->plane_textures[1] = yuv_converter_create_plane_texture(
+    wgpu_context, yuv_converter->chroma_width, yuv_converter->chroma_height,
+    nv12 ? WGPUTextureFormat_RG8Unorm : WGPUTextureFormat_R8Unorm);
+  if (!nv12) {
+    yuv_converter->plane_textures[2] = yuv_converter_create_plane_texture(
+      wgpu_context, yuv_converter->chroma_width, yuv_converter->chroma_height,
+      WGPUTextureFormat_R8Unorm);
+  }
+
+  // Compute pipeline specialized to the format and color space
+  WGPUConstantEntry constants[3] = {
+    [0] = (WGPUConstantEntry){
+      .key   = "nv12",
+      .value = nv12 ? 1.0 : 0.0,
+    },
+    [1] = (WGPUConstantEntry){
+      .key   = "bt709",
+      .value = desc->bt709 ? 1.0 : 0.0,
+    },
+    [2] = (WGPUConstantEntry){
+      .key   = "full_range",
+      .value = desc->full_range ? 1.0 : 0.0,
+    },
+  };
+  wgpu_shader_t yuv_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    // Compute shader WGSL
+                    .wgsl_code.source = yuv_converter_shader_wgsl,
+                    .entry            = "main",
+                    .constants        = {
+                      .count   = (uint32_t)ARRAY_SIZE(constants),
+                      .entries = constants,
+                    },
+                  });
+  yuv_converter->pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = "yuv_converter_pipeline",
+                    .compute = yuv_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(yuv_converter->pipeline != NULL);
+  wgpu_shader_release(&yuv_shader);
+
+  // Bind group, NV12 binds the UV plane for both chroma bindings
+  WGPUTextureView views[4] = {0};
+  for (uint32_t i = 0; i < 3; ++i) {
+    WGPUTexture texture = yuv_converter->plane_textures[nv12 && i == 2 ? 1 : i];
+    views[i]            = wgpuTextureCreateView(texture, NULL);
+  }
+  views[3] = wgpuTextureCreateView(
+    desc->texture, &(WGPUTextureViewDescriptor){
+                     .format          = WGPUTextureFormat_RGBA8Unorm,
+                     .dimension       = WGPUTextureViewDimension_2D,
+                     .baseMipLevel    = 0,
+                     .mipLevelCount   = 1,
+                     .baseArrayLayer  = 0,
+                     .arrayLayerCount = 1,
+                   });
+  WGPUBindGroupEntry bg_entries[4] = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(bg_entries); ++i) {
+    bg_entries[i] = (WGPUBindGroupEntry){
+      .binding     = i,
+      .textureView = views[i],
+    };
+  }
+  yuv_converter->bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .label  = "yuv_converter_bind_group",
+      .layout = wgpuComputePipelineGetBindGroupLayout(yuv_converter->pipeline,
+                                                      0),
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(yuv_converter->bind_group != NULL);
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(views); ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, views[i])
+  }
+
+  return yuv_converter;
+}
+
+void wgpu_yuv_converter_destroy(wgpu_yuv_converter_t* yuv_converter)
+{
+  if (yuv_converter == NULL) {
+    return;
+  }
+  WGPU_RELEASE_RESOURCE(BindGroup, yuv_converter->bind_group)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, yuv_converter->pipeline)
+  for (uint32_t i = 0; i < 3; ++i) {
+    WGPU_RELEASE_RESOURCE(Texture, yuv_converter->plane_textures[i])
+  }
+  free(yuv_converter);
+}
+
+void wgpu_yuv_converter_convert(wgpu_yuv_converter_t* yuv_converter,
+                                const void* planes)
+{
+  wgpu_context_t* wgpu_context          = yuv_converter->wgpu_context;
+  const wgpu_yuv_converter_desc_t* desc = &yuv_converter->desc;
+  const bool nv12                       = desc->format == WGPU_YUV_Format_NV12;
+
+  const WGPUExtent3D luma_size = {
+    .width              = desc->width,
+    .height             = desc->height,
+    .depthOrArrayLayers = 1,
+  };
+  const WGPUExtent3D chroma_size = {
+    .width              = yuv_converter->chroma_width,
+    .height             = yuv_converter->chroma_height,
+    .depthOrArrayLayers = 1,
+  };
+  const size_t luma_plane_size   = (size_t)desc->width * desc->height;
+  const size_t chroma_plane_size = (size_t)yuv_converter->chroma_width
+                                   * yuv_converter->chroma_height;
+
+  // Upload the planes
+  uint8_t* data = (uint8_t*)planes;
+  wgpu_image_to_texure(wgpu_context, yuv_converter->plane_textures[0], data,
+                       luma_size, 1u);
+  data += luma_plane_size;
+  wgpu_image_to_texure(wgpu_context, yuv_converter->plane_textures[1], data,
+                       chroma_size, nv12 ? 2u : 1u);
+  if (!nv12) {
+    data += chroma_plane_size;
+    wgpu_image_to_texure(wgpu_context, yuv_converter->plane_textures[2], data,
+                         chroma_size, 1u);
+  }
+
+  // Convert, submitted before the command buffers sampling the texture
+  WGPUCommandEncoder cmd_encoder
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPUComputePassEncoder pass_encoder
+    = wgpuCommandEncoderBeginComputePass(cmd_encoder, NULL);
+  wgpuComputePassEncoderSetPipeline(pass_encoder, yuv_converter->pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0,
+                                     yuv_converter->bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    pass_encoder,
+    (desc->width + YUV_CONVERTER_WORKGROUP_SIZE - 1)
+      / YUV_CONVERTER_WORKGROUP_SIZE,
+    (desc->height + YUV_CONVERTER_WORKGROUP_SIZE - 1)
+      / YUV_CONVERTER_WORKGROUP_SIZE,
+    1);
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+  WGPUCommandBuffer command_buffer
+    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+}
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Texture Client
+ * -------------------------------------------------------------------------- */
+
+typedef struct texture_result_t {
+  WGPUTexture texture;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t mip_level_count;
+  uint32_t resident_mip_level;
+  WGPUTextureFormat format;
+  WGPUTextureDimension dimension;
+  bool array_view; /* 2D array view, also for a single or 6 layers */
+} texture_result_t;
+
+/**
+ * @brief Mip map generation method of a loaded texture: the method of the
+ * client, the fastest method of the adapter when it is Auto. Auto if the
+ * method does not support the texture or the pixels.
+ */
+static wgpu_mipmap_method_enum_t
+texture_client_get_mipmap_method(struct wgpu_texture_client_t* texture_client,
+                                 const WGPUTextureDescriptor* texture_desc,
+                                 uint32_t channel_count)
+{
+  if (texture_client->wgpu_mipmap_generator == NULL) {
+    texture_client->wgpu_mipmap_generator
+      = wgpu_mipmap_generator_create(texture_client->wgpu_context);
+  }
+  wgpu_mipmap_method_enum_t method = texture_client->mipmap_method;
+  if (method == WGPU_MipmapMethod_Auto) {
+    method = wgpu_tune_mipmap_method(texture_client->wgpu_context,
+                                     texture_client->wgpu_mipmap_generator,
+                                     texture_desc->format);
+  }
+  // The CPU mip chain is generated from 4 channel 8-bit pixels
+  if ((method == WGPU_MipmapMethod_CPU && channel_count != 4)
+      || !wgpu_mipmap_method_supports(method, texture_desc)) {
+    return WGPU_MipmapMethod_Auto;
+  }
+  return method;
+}
+
+/* Uploads level 0 and generates the mip chain of the texture descriptor with
+ * the method */
+static void
+texture_client_upload_with_mipmaps(struct wgpu_texture_client_t* texture_client,
+                                   WGPUTexture texture,
+                                   const WGPUTextureDescriptor* texture_desc,
+                                   wgpu_mipmap_method_enum_t method,
+                                   void* pixels, uint32_t bytes_per_texel)
+{
+  wgpu_context_t* wgpu_context = texture_client->wgpu_context;
+  if (texture_desc->mipLevelCount > 1 && method == WGPU_MipmapMethod_CPU) {
+    WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+    wgpu_mipmap_generator_encode_cpu_mipmap(wgpu_context, cmd_encoder, texture,
+                                            texture_desc,
+                                            (const uint8_t*)pixels);
+    wgpu_upload_commands_end(wgpu_context, cmd_encoder);
+    return;
+  }
+
+  wgpu_image_to_texure(wgpu_context, texture, pixels, texture_desc->size,
+                       bytes_per_texel);
+  if (texture_desc->mipLevelCount > 1) {
+    // Textures without the storage usage are generated with render passes
+    WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+    wgpu_mipmap_generator_encode_mipmap(texture_client->wgpu_mipmap_generator,
+                                        cmd_encoder, texture, texture_desc,
+                                        WGPU_MipmapMethod_Auto);
+    wgpu_upload_commands_end(wgpu_context, cmd_encoder);
+  }
+}
+
+texture_result_t wgpu_texture_client_load_texture_from_memory(
+  struct wgpu_texture_client_t* texture_client, void* data, size_t data_size,
+  struct wgpu_texture_load_options_t* options)
+{
+  if (!texture_client->wgpu_context) {
+    log_error("Cannot create new textures after object has been destroyed.");
+    return (texture_result_t){0};
+  }
+
+  static const uint8_t comp_map[5] = {
+    0, //
+    1, //
+    2, //
+    4, //
+    4  //
+  };
+  static const uint32_t channels[5] = {
+    STBI_default,    // only used for req_comp
+    STBI_grey,       //
+    STBI_grey_alpha, //
+    STBI_rgb_alpha,  //
+    STBI_rgb_alpha   //
+  };
+
+  bool is_hdr = stbi_is_hdr_from_memory((stbi_uc*)data, data_size);
+  int width = 0, height = 0, read_comps = 4;
+  stbi_set_flip_vertically_on_load(false);
+  uint8_t* pixel_data
+    = is_hdr ? (uint8_t*)stbi_loadf_from_memory((stbi_uc*)data, data_size,
+                                                &width, &height, &read_comps,
+                                                channels[read_comps]) :
+               (uint8_t*)stbi_load_from_memory((stbi_uc*)data, data_size,
+                                               &width, &height, &read_comps,
+                                               channels[read_comps]);
+
+  if (pixel_data == NULL) {
+    log_warn("Couldn't parse image data!");
+    return (texture_result_t){0};
+  }
+  ASSERT(pixel_data);
+
+  const uint8_t comps         = comp_map[read_comps];
+  const bool generate_mipmaps = options ? options->generate_mipmaps : false;
+  const uint32_t mip_level_count
+    = generate_mipmaps ? calculate_mip_level_count(width, height) : 1u;
+
+  const WGPUTextureUsage usage
+    = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding;
 
   WGPUExtent3D texture_size = {
     .width              = width,
@@ -696,19 +1627,29 @@ texture_result_t wgpu_texture_client_load_texture_from_memory(
     .mipLevelCount = mip_level_count,
     .sampleCount   = 1,
   };
+  // Radiance (.hdr) images are decoded to 4 32-bit floats per pixel
+  if (is_hdr) {
+    texture_desc.format = WGPUTextureFormat_RGBA32Float;
+  }
+  const wgpu_mipmap_method_enum_t mipmap_method
+    = generate_mipmaps ?
+        texture_client_get_mipmap_method(texture_client, &texture_desc,
+                                         is_hdr ? 0u : comps) :
+        WGPU_MipmapMethod_Auto;
+  if (generate_mipmaps && mipmap_method != WGPU_MipmapMethod_Render
+      && wgpu_mipmap_generator_supports_compute(texture_desc.format)) {
+    texture_desc.usage |= WGPUTextureUsage_StorageBinding;
+  }
   WGPUTexture texture = wgpuDeviceCreateTexture(
     texture_client->wgpu_context->device, &texture_desc);
 
   // Copy pixel data to texture and free allocated memory
-  wgpu_image_to_texure(texture_client->wgpu_context, texture, pixel_data,
-                       texture_size, comps);
+  texture_client_upload_with_mipmaps(texture_client, texture, &texture_desc,
+                                     mipmap_method, pixel_data,
+                                     is_hdr ? 4u * (uint32_t)sizeof(float) :
+                                              comps);
   free(pixel_data);
 
-  if (generate_mipmaps) {
-    texture = wgpu_mipmap_generator_generate_mipmap(
-      texture_client->wgpu_mipmap_generator, texture, &texture_desc);
-  }
-
   return (texture_result_t){
     .texture         = texture,
     .width           = texture_desc.size.width,
@@ -745,19 +1686,30 @@ stb_image_load_image_from_file(const char* filename, bool flip_y)
     STBI_rgb_alpha   //
   };
 
+  // Decode straight from the mapped file
+  file_mapping_t file_mapping = {0};
+  const int error             = file_map(filename, &file_mapping);
+  if (error != 0) {
+    log_error("Couldn't load '%s': %s\n", filename, strerror(error));
+    return (stb_image_load_result_t){0};
+  }
+
   int width = 0, height = 0;
   // Force loading 4 channel images to 3 channel by stb becasue Dawn doesn't
   // support 3 channel formats currently. The group is discussing on whether
   // webgpu shoud support 3 channel format.
   // https://github.com/gpuweb/gpuweb/issues/66#issuecomment-410021505
   int read_comps = 4;
-  stbi_set_flip_vertically_on_load(flip_y);
-  stbi_uc* pixel_data = stbi_load(filename,            //
-                                  &width,              //
-                                  &height,             //
-                                  &read_comps,         //
-                                  channels[read_comps] //
+  // Thread local setting, images can be decoded from worker threads
+  stbi_set_flip_vertically_on_load_thread(flip_y);
+  stbi_uc* pixel_data = stbi_load_from_memory(file_mapping.data,      //
+                                              (int)file_mapping.size, //
+                                              &width,                 //
+                                              &height,                //
+                                              &read_comps,            //
+                                              channels[read_comps]    //
   );
+  file_unmap(&file_mapping);
 
   if (pixel_data == NULL) {
     log_error("Couldn't load '%s'\n", filename);
@@ -776,28 +1728,15 @@ stb_image_load_image_from_file(const char* filename, bool flip_y)
 }
 
 static texture_result_t
-wgpu_texture_load_with_stb(struct wgpu_texture_client_t* texture_client,
-                           const char* filename,
-                           struct wgpu_texture_load_options_t* options)
+wgpu_texture_load_from_image_data(struct wgpu_texture_client_t* texture_client,
+                                  const image_data_t* image_data,
+                                  struct wgpu_texture_load_options_t* options)
 {
-  if (!texture_client->wgpu_context) {
-    log_error("Cannot create new textures after object has been destroyed.");
-    return (texture_result_t){0};
-  }
-
-  const bool flip_y = options ? options->flip_y : false;
-  stb_image_load_result_t image_load_result
-    = stb_image_load_image_from_file(filename, flip_y);
-
-  stbi_uc* pixel_data = image_load_result.pixel_data;
-  if (pixel_data == NULL) {
-    return (texture_result_t){0};
-  }
-  ASSERT(pixel_data);
+  ASSERT(image_data && image_data->pixels);
 
-  const int width             = image_load_result.image_width;
-  const int height            = image_load_result.image_height;
-  const int channel_count     = image_load_result.channel_count;
+  const int width             = image_data->width;
+  const int height            = image_data->height;
+  const int channel_count     = image_data->channel_count;
   const bool generate_mipmaps = options ? options->generate_mipmaps : false;
   const uint32_t mip_level_count
     = generate_mipmaps ? calculate_mip_level_count(width, height) : 1u;
@@ -825,22 +1764,22 @@ wgpu_texture_load_with_stb(struct wgpu_texture_client_t* texture_client,
     .mipLevelCount = mip_level_count,
     .sampleCount   = 1,
   };
+  const wgpu_mipmap_method_enum_t mipmap_method
+    = generate_mipmaps ?
+        texture_client_get_mipmap_method(texture_client, &texture_desc,
+                                         (uint32_t)channel_count) :
+        WGPU_MipmapMethod_Auto;
+  if (generate_mipmaps && mipmap_method != WGPU_MipmapMethod_Render
+      && wgpu_mipmap_generator_supports_compute(texture_desc.format)) {
+    texture_desc.usage |= WGPUTextureUsage_StorageBinding;
+  }
   WGPUTexture texture = wgpuDeviceCreateTexture(
     texture_client->wgpu_context->device, &texture_desc);
 
-  // Copy pixel data to texture and free allocated memory
-  wgpu_image_to_texure(texture_client->wgpu_context, texture, pixel_data,
-                       texture_size, channel_count);
-  stbi_image_free(pixel_data);
-
-  if (generate_mipmaps) {
-    if (texture_client->wgpu_mipmap_generator == NULL) {
-      texture_client->wgpu_mipmap_generator
-        = wgpu_mipmap_generator_create(texture_client->wgpu_context);
-    }
-    texture = wgpu_mipmap_generator_generate_mipmap(
-      texture_client->wgpu_mipmap_generator, texture, &texture_desc);
-  }
+  // Copy pixel data to texture
+  texture_client_upload_with_mipmaps(texture_client, texture, &texture_desc,
+                                     mipmap_method, image_data->pixels,
+                                     (uint32_t)channel_count);
 
   return (texture_result_t){
     .texture         = texture,
@@ -853,6 +1792,71 @@ wgpu_texture_load_with_stb(struct wgpu_texture_client_t* texture_client,
   };
 }
 
+static texture_result_t
+wgpu_texture_load_with_stb(struct wgpu_texture_client_t* texture_client,
+                           const char* filename,
+                           struct wgpu_texture_load_options_t* options)
+{
+  if (!texture_client->wgpu_context) {
+    log_error("Cannot create new textures after object has been destroyed.");
+    return (texture_result_t){0};
+  }
+
+  const bool flip_y       = options ? options->flip_y : false;
+  image_data_t image_data = {0};
+  if (!wgpu_image_data_load_from_file(filename, flip_y, &image_data)) {
+    return (texture_result_t){0};
+  }
+
+  // Create the texture and free allocated memory
+  texture_result_t texture_result = wgpu_texture_load_from_image_data(
+    texture_client, &image_data, options);
+  wgpu_image_data_release(&image_data);
+
+  return texture_result;
+}
+
+/* Decodes one cubemap face on the thread pool, optionally with mip chain */
+typedef struct cubemap_face_job_t {
+  const char* filename;
+  bool flip_y;
+  bool generate_mipmaps;
+  bool srgb;
+  stb_image_load_result_t image;
+  mip_chain_t mip_chain; /* pixels are NULL without mipmaps */
+} cubemap_face_job_t;
+
+static void cubemap_face_job_run(void* arg)
+{
+  cubemap_face_job_t* job = (cubemap_face_job_t*)arg;
+  job->image = stb_image_load_image_from_file(job->filename, job->flip_y);
+  if (job->image.pixel_data == NULL || !job->generate_mipmaps
+      || job->image.channel_count != 4) {
+    return;
+  }
+
+  // The mip chain includes level 0, the decoded image is no longer needed
+  const uint32_t width  = (uint32_t)job->image.image_width;
+  const uint32_t height = (uint32_t)job->image.image_height;
+  mip_chain_create(&job->mip_chain, width, height,
+                   calculate_mip_level_count(width, height));
+  mip_chain_generate(&job->mip_chain, job->image.pixel_data, width, height,
+                     job->srgb);
+  stbi_image_free(job->image.pixel_data);
+  job->image.pixel_data = NULL;
+}
+
+static void cubemap_face_job_release(cubemap_face_job_t* job)
+{
+  if (job->image.pixel_data != NULL) {
+    stbi_image_free(job->image.pixel_data);
+    job->image.pixel_data = NULL;
+  }
+  if (job->mip_chain.pixels != NULL) {
+    mip_chain_release(&job->mip_chain);
+  }
+}
+
 static texture_result_t
 wgpu_texture_cubemap_load_with_stb(wgpu_context_t* wgpu_context,
                                    const char* filenames[6],
@@ -861,34 +1865,57 @@ wgpu_texture_cubemap_load_with_stb(wgpu_context_t* wgpu_context,
   // Swap top and bottom when images should be flipped vertically
   const bool flip_y         = options ? options->flip_y : false;
   const uint16_t mapping[6] = {0, 1, flip_y ? 3 : 2, flip_y ? 2 : 3, 4, 5};
+  const WGPUTextureFormat texture_format
+    = options ?
+        (options->format != WGPUTextureFormat_Undefined ?
+           format_for_color_space(options->format, options->color_space) :
+           WGPUTextureFormat_RGBA8Unorm) :
+        WGPUTextureFormat_RGBA8Unorm;
+
+  const bool srgb = srgb_to_linear_format(texture_format) != texture_format;
+  if (srgb) {
+    // Shared by the jobs, initialized before the jobs start
+    mip_chain_init_srgb_tables();
+  }
 
-  // Load images into memory
-  stb_image_load_result_t image_load_results[6] = {0};
+  // Decode the faces concurrently
+  cubemap_face_job_t face_jobs[6] = {0};
+  thread_pool_t* thread_pool      = thread_pool_create(0);
   for (uint32_t face = 0; face < 6; ++face) {
-    image_load_results[face]
-      = stb_image_load_image_from_file(filenames[mapping[face]], flip_y);
-    if (image_load_results[face].pixel_data == NULL) {
-      // Free pixel data for already loaded images
-      for (uint32_t prev_face = 0; prev_face < face; ++prev_face) {
-        stbi_image_free(image_load_results[prev_face].pixel_data);
-      }
-      return (texture_result_t){0};
+    face_jobs[face] = (cubemap_face_job_t){
+      .filename         = filenames[mapping[face]],
+      .flip_y           = flip_y,
+      .generate_mipmaps = options ? options->generate_mipmaps : false,
+      .srgb             = srgb,
+    };
+    thread_pool_submit(thread_pool, cubemap_face_job_run, &face_jobs[face]);
+  }
+  thread_pool_release(thread_pool);
+
+  // All faces must be decoded and match the first face
+  bool valid = true;
+  for (uint32_t face = 0; face < 6; ++face) {
+    const stb_image_load_result_t* image = &face_jobs[face].image;
+    valid = valid && image->image_width > 0
+            && image->image_width == face_jobs[0].image.image_width
+            && image->image_height == face_jobs[0].image.image_height
+            && image->channel_count == face_jobs[0].image.channel_count;
+  }
+  if (!valid) {
+    for (uint32_t face = 0; face < 6; ++face) {
+      cubemap_face_job_release(&face_jobs[face]);
     }
+    return (texture_result_t){0};
   }
 
   // Use first image to determine the width and height of the image
-  const uint32_t width           = image_load_results[0].image_width;
-  const uint32_t height          = image_load_results[0].image_height;
-  const uint32_t channel_count   = image_load_results[0].channel_count;
+  const uint32_t width           = face_jobs[0].image.image_width;
+  const uint32_t height          = face_jobs[0].image.image_height;
+  const uint32_t channel_count   = face_jobs[0].image.channel_count;
   const uint32_t depth           = 6u;
-  const uint32_t mip_level_count = 1;
-  const WGPUTextureFormat texture_format
-    = options ?
-        (options->format != WGPUTextureFormat_Undefined ?
-           format_for_color_space(options->format, options->color_space) :
-           WGPUTextureFormat_RGBA8Unorm) :
-        WGPUTextureFormat_RGBA8Unorm;
-  const size_t texture_size = width * height * channel_count * sizeof(uint8_t);
+  const mip_chain_t* mip_chain   = &face_jobs[0].mip_chain;
+  const bool has_mip_chain       = mip_chain->pixels != NULL;
+  const uint32_t mip_level_count = has_mip_chain ? mip_chain->level_count : 1;
 
   // Create cubemap texture
   WGPUTextureDescriptor texture_desc = {
@@ -906,78 +1933,90 @@ wgpu_texture_cubemap_load_with_stb(wgpu_context_t* wgpu_context,
   WGPUTexture texture
     = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
 
-  WGPUCommandEncoder cmd_encoder
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
-
-  // Create a host-visible staging buffers that contains the raw image data for
-  // each face of the cubemap
-  WGPUBuffer staging_buffers[6] = {0};
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+
+  // Create one host-visible staging buffer that contains the raw image data
+  // of all faces, the rows are padded to the required 256 bytes
+  const uint32_t face_bytes_per_row = width * channel_count;
+  const uint32_t bytes_per_row      = make_multiple_of_256(face_bytes_per_row);
+  const size_t face_size
+    = has_mip_chain ? mip_chain->size : (size_t)bytes_per_row * height;
+  WGPUBufferDescriptor staging_buffer_desc = {
+    .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
+    .size             = face_size * depth,
+    .mappedAtCreation = true,
+  };
+  WGPUBuffer staging_buffer
+    = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
+  ASSERT(staging_buffer)
+
+  // Copy the decoded images into the staging buffer
+  uint8_t* staging_data = (uint8_t*)wgpuBufferGetMappedRange(
+    staging_buffer, 0, face_size * depth);
+  ASSERT(staging_data)
   for (uint32_t face = 0; face < depth; ++face) {
-    WGPUBufferDescriptor staging_buffer_desc = {
-      .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
-      .size             = texture_size,
-      .mappedAtCreation = true,
-    };
-    staging_buffers[face]
-      = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
-    ASSERT(staging_buffers[face])
+    const uint8_t* pixels = has_mip_chain ? face_jobs[face].mip_chain.pixels :
+                                            face_jobs[face].image.pixel_data;
+    if (has_mip_chain || bytes_per_row == face_bytes_per_row) {
+      memcpy(staging_data + face * face_size, pixels, face_size);
+      continue;
+    }
+    for (uint32_t y = 0; y < height; ++y) {
+      memcpy(staging_data + face * face_size + (size_t)y * bytes_per_row,
+             pixels + (size_t)y * face_bytes_per_row, face_bytes_per_row);
+    }
   }
+  wgpuBufferUnmap(staging_buffer);
 
   for (uint32_t face = 0; face < depth; ++face) {
-    // Copy texture data into staging buffer
-    void* mapping
-      = wgpuBufferGetMappedRange(staging_buffers[face], 0, texture_size);
-    ASSERT(mapping)
-    memcpy(mapping, image_load_results[face].pixel_data, texture_size);
-    wgpuBufferUnmap(staging_buffers[face]);
-
-    // Upload staging buffer to texture
-    wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
-      // Source
-      &(WGPUImageCopyBuffer) {
-        .buffer = staging_buffers[face],
-        .layout = (WGPUTextureDataLayout) {
-          .offset       = 0,
-          .bytesPerRow  = width * channel_count,
-          .rowsPerImage = height,
+    for (uint32_t level = 0; level < mip_level_count; ++level) {
+      const mip_chain_level_t mip_level
+        = has_mip_chain ? mip_chain->levels[level] :
+                          (mip_chain_level_t){
+                            .offset        = 0,
+                            .width         = width,
+                            .height        = height,
+                            .bytes_per_row = bytes_per_row,
+                          };
+
+      // Upload staging buffer to texture
+      wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
+        // Source
+        &(WGPUImageCopyBuffer) {
+          .buffer = staging_buffer,
+          .layout = (WGPUTextureDataLayout) {
+            .offset       = face * face_size + mip_level.offset,
+            .bytesPerRow  = mip_level.bytes_per_row,
+            .rowsPerImage = mip_level.height,
+          },
         },
-      },
-      // Destination
-      &(WGPUImageCopyTexture){
-        .texture = texture,
-        .mipLevel = 0,
-        .origin = (WGPUOrigin3D) {
-          .x = 0,
-          .y = 0,
-          .z = face,
+        // Destination
+        &(WGPUImageCopyTexture){
+          .texture = texture,
+          .mipLevel = level,
+          .origin = (WGPUOrigin3D) {
+            .x = 0,
+            .y = 0,
+            .z = face,
+          },
+          .aspect = WGPUTextureAspect_All,
         },
-        .aspect = WGPUTextureAspect_All,
-      },
-      // Copy size
-      &(WGPUExtent3D){
-        .width              = width,
-        .height             = height,
-        .depthOrArrayLayers = 1,
-      });
+        // Copy size
+        &(WGPUExtent3D){
+          .width              = mip_level.width,
+          .height             = mip_level.height,
+          .depthOrArrayLayers = 1,
+        });
+    }
   }
 
-  WGPUCommandBuffer command_buffer
-    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
-  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
-
-  // Sumbit commmand buffer and cleanup
-  ASSERT(command_buffer != NULL)
-
-  // Submit to the queue
-  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
-
-  // Release command buffer
-  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  // Submit to the queue, batched uploads are submitted with the batch
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
 
   // Clean up staging resources and pixel data
+  WGPU_RELEASE_RESOURCE(Buffer, staging_buffer);
   for (uint32_t face = 0; face < depth; ++face) {
-    WGPU_RELEASE_RESOURCE(Buffer, staging_buffers[face]);
-    stbi_image_free(image_load_results[face].pixel_data);
+    cubemap_face_job_release(&face_jobs[face]);
   }
 
   return (texture_result_t){
@@ -991,28 +2030,319 @@ wgpu_texture_cubemap_load_with_stb(wgpu_context_t* wgpu_context,
   };
 }
 
-static ktxResult load_ktx_file(const char* filename, ktxTexture** target)
+/* -------------------------------------------------------------------------- *
+ * Mip level streaming
+ * -------------------------------------------------------------------------- */
+
+#define TEXTURE_STREAM_MAX_LEVELS 16u
+/* Mip levels up to this size are uploaded when the texture is created */
+#define TEXTURE_STREAM_TAIL_SIZE 256u
+#define TEXTURE_STREAM_DEFAULT_BYTES_PER_FRAME (8ull << 20)
+
+/* Data of one mip level of one face */
+typedef struct texture_level_data_t {
+  const uint8_t* data;
+  uint64_t size;
+  uint32_t bytes_per_row;
+  uint32_t rows_per_image;
+  uint32_t width; /* copy size, a multiple of the block size */
+  uint32_t height;
+} texture_level_data_t;
+
+static void texture_write_level(wgpu_context_t* wgpu_context,
+                                WGPUTexture texture, uint32_t face,
+                                uint32_t level,
+                                const texture_level_data_t* level_data)
+{
+  wgpuQueueWriteTexture(wgpu_context->queue,
+    &(WGPUImageCopyTexture) {
+      .texture = texture,
+      .mipLevel = level,
+      .origin = (WGPUOrigin3D) {
+        .x = 0,
+        .y = 0,
+        .z = face,
+      },
+      .aspect = WGPUTextureAspect_All,
+    },
+    level_data->data, level_data->size,
+    &(WGPUTextureDataLayout){
+      .offset       = 0,
+      .bytesPerRow  = level_data->bytes_per_row,
+      .rowsPerImage = level_data->rows_per_image,
+    },
+    &(WGPUExtent3D){
+      .width              = level_data->width,
+      .height             = level_data->height,
+      .depthOrArrayLayers = 1,
+    });
+}
+
+/* Texture with mip levels waiting for upload, levels are uploaded from the
+ * smallest to the largest one */
+typedef struct texture_stream_entry_t {
+  WGPUTexture texture; /* referenced until the entry is removed */
+  uint32_t width;
+  uint32_t height;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t resident_level; /* this level and all smaller ones are uploaded */
+  texture_level_data_t levels[TEXTURE_STREAM_MAX_LEVELS][6];
+  /* Returns true if the data of the level is stored in levels, waits for the
+   * data when wait is true. NULL if the data of all levels is available. */
+  bool (*level_ready)(struct texture_stream_entry_t* entry, uint32_t level,
+                      bool wait);
+  /* Releases the level data once all levels are uploaded */
+  void (*release)(struct texture_stream_entry_t* entry);
+  void* user_data;
+} texture_stream_entry_t;
+
+struct wgpu_texture_stream {
+  texture_stream_entry_t** entries;
+  uint32_t entry_count;
+  uint32_t entry_capacity;
+  thread_pool_t* thread_pool; /* produces the data of streamed levels */
+  uint32_t basis_entry_count;
+};
+
+static struct wgpu_texture_stream*
+texture_stream_get(struct wgpu_texture_client_t* texture_client)
+{
+  if (texture_client->texture_stream == NULL) {
+    texture_client->texture_stream = (struct wgpu_texture_stream*)calloc(
+      1, sizeof(struct wgpu_texture_stream));
+  }
+  return texture_client->texture_stream;
+}
+
+static thread_pool_t*
+texture_stream_get_thread_pool(struct wgpu_texture_client_t* texture_client)
+{
+  struct wgpu_texture_stream* stream = texture_stream_get(texture_client);
+  if (stream->thread_pool == NULL) {
+    stream->thread_pool = thread_pool_create(0);
+  }
+  return stream->thread_pool;
+}
+
+static bool texture_stream_level_is_ready(texture_stream_entry_t* entry,
+                                          uint32_t level, bool wait)
+{
+  return entry->level_ready == NULL || entry->level_ready(entry, level, wait);
+}
+
+/* Uploads all faces of the level, returns the size of the uploaded data */
+static uint64_t texture_stream_upload_level(wgpu_context_t* wgpu_context,
+                                            texture_stream_entry_t* entry,
+                                            uint32_t level)
+{
+  uint64_t size = 0;
+  for (uint32_t face = 0; face < entry->face_count; ++face) {
+    const texture_level_data_t* level_data = &entry->levels[level][face];
+    if (level_data->data != NULL) {
+      texture_write_level(wgpu_context, entry->texture, face, level,
+                          level_data);
+      size += level_data->size;
+    }
+  }
+  entry->resident_level = level;
+  return size;
+}
+
+static void texture_stream_release_data(texture_stream_entry_t* entry)
+{
+  if (entry->release != NULL) {
+    entry->release(entry);
+    entry->release = NULL;
+  }
+}
+
+static void texture_stream_remove(struct wgpu_texture_stream* stream,
+                                  uint32_t index)
+{
+  texture_stream_entry_t* entry = stream->entries[index];
+  texture_stream_release_data(entry);
+  WGPU_RELEASE_RESOURCE(Texture, entry->texture)
+  free(entry);
+  stream->entries[index] = stream->entries[--stream->entry_count];
+}
+
+static void texture_stream_destroy(struct wgpu_texture_client_t* texture_client)
+{
+  struct wgpu_texture_stream* stream = texture_client->texture_stream;
+  if (stream == NULL) {
+    return;
+  }
+  while (stream->entry_count > 0) {
+    texture_stream_remove(stream, stream->entry_count - 1);
+  }
+  if (stream->thread_pool != NULL) {
+    thread_pool_release(stream->thread_pool);
+  }
+  free(stream->entries);
+  free(stream);
+  texture_client->texture_stream = NULL;
+}
+
+/**
+ * @brief Uploads the tail mip levels of the texture, the remaining levels are
+ * uploaded by wgpu_texture_client_stream_mips(). The stream takes ownership of
+ * the entry.
+ * @returns the first resident mip level
+ */
+static uint32_t texture_stream_add(struct wgpu_texture_client_t* texture_client,
+                                   texture_stream_entry_t* entry)
+{
+  const uint32_t size = MAX(entry->width, entry->height);
+  for (uint32_t level = entry->level_count; level-- > 0;) {
+    if ((size >> level) > TEXTURE_STREAM_TAIL_SIZE
+        && level + 1 < entry->level_count) {
+      break;
+    }
+    texture_stream_level_is_ready(entry, level, true);
+    texture_stream_upload_level(texture_client->wgpu_context, entry, level);
+  }
+
+  const uint32_t resident_level = entry->resident_level;
+  if (resident_level == 0) {
+    // Small texture, nothing left to stream
+    texture_stream_release_data(entry);
+    free(entry);
+    return 0;
+  }
+
+  struct wgpu_texture_stream* stream = texture_stream_get(texture_client);
+  if (stream->entry_count == stream->entry_capacity) {
+    stream->entry_capacity
+      = stream->entry_capacity > 0 ? stream->entry_capacity * 2 : 16;
+    stream->entries = (texture_stream_entry_t**)realloc(
+      stream->entries, stream->entry_capacity * sizeof(*stream->entries));
+  }
+  wgpuTextureReference(entry->texture);
+  stream->entries[stream->entry_count++] = entry;
+  return resident_level;
+}
+
+/* View of the mip levels of the texture from base_mip_level on, textures with
+ * 6 layers are viewed as cubemap unless array_view is set */
+static WGPUTextureView
+texture_create_view(WGPUTexture texture, WGPUTextureFormat format,
+                    uint32_t depth, bool array_view, uint32_t base_mip_level,
+                    uint32_t mip_level_count)
+{
+  WGPUTextureViewDimension dimension = WGPUTextureViewDimension_2D;
+  if (array_view) {
+    dimension = WGPUTextureViewDimension_2DArray;
+  }
+  else if (depth == 6u) {
+    dimension = WGPUTextureViewDimension_Cube;
+  }
+  WGPUTextureViewDescriptor texture_view_dec = {
+    .format          = format,
+    .dimension       = dimension,
+    .baseMipLevel    = base_mip_level,
+    .mipLevelCount   = mip_level_count - base_mip_level,
+    .baseArrayLayer  = 0,
+    .arrayLayerCount = depth, // Cube faces count as array layers
+  };
+  return wgpuTextureCreateView(texture, &texture_view_dec);
+}
+
+void wgpu_texture_client_stream_mips(
+  struct wgpu_texture_client_t* texture_client)
+{
+  struct wgpu_texture_stream* stream = texture_client->texture_stream;
+  if (stream == NULL) {
+    return;
+  }
+
+  // At least one level is uploaded per frame when a level is ready
+  const uint64_t budget = texture_client->stream_bytes_per_frame > 0 ?
+                            texture_client->stream_bytes_per_frame :
+                            TEXTURE_STREAM_DEFAULT_BYTES_PER_FRAME;
+  uint64_t uploaded = 0;
+  for (uint32_t i = 0; i < stream->entry_count && uploaded < budget; ++i) {
+    texture_stream_entry_t* entry = stream->entries[i];
+    while (entry->resident_level > 0 && uploaded < budget) {
+      const uint32_t level = entry->resident_level - 1;
+      if (!texture_stream_level_is_ready(entry, level, false)) {
+        break;
+      }
+      uploaded
+        += texture_stream_upload_level(texture_client->wgpu_context, entry,
+                                       level);
+    }
+    if (entry->resident_level == 0) {
+      texture_stream_release_data(entry);
+    }
+  }
+}
+
+bool wgpu_texture_update_mip_residency(wgpu_context_t* wgpu_context,
+                                       texture_t* texture)
 {
-  ktxResult result = KTX_SUCCESS;
-  if (!file_exists(filename)) {
-    log_fatal("Could not load texture from %s", filename);
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  struct wgpu_texture_stream* stream
+    = texture_client ? texture_client->texture_stream : NULL;
+  for (uint32_t i = 0; stream != NULL && i < stream->entry_count; ++i) {
+    texture_stream_entry_t* entry = stream->entries[i];
+    if (entry->texture != texture->texture) {
+      continue;
+    }
+    if (entry->resident_level >= texture->resident_mip_level) {
+      return false;
+    }
+    WGPU_RELEASE_RESOURCE(TextureView, texture->view)
+    texture->view = texture_create_view(
+      texture->texture, texture->format, texture->size.depth, false,
+      entry->resident_level, texture->mip_level_count);
+    texture->resident_mip_level = entry->resident_level;
+    if (entry->resident_level == 0) {
+      texture_stream_remove(stream, i);
+    }
+    return true;
+  }
+  return false;
+}
+
+/* The texture reads the image data from the mapping, which has to outlive it */
+static ktxResult load_ktx_file(const char* filename,
+                               ktxTextureCreateFlags create_flags,
+                               file_mapping_t* file_mapping,
+                               ktxTexture** target)
+{
+  const int error = file_map(filename, file_mapping);
+  if (error != 0) {
+    log_fatal("Could not load texture from %s: %s", filename, strerror(error));
     return KTX_FILE_OPEN_FAILED;
   }
-  result = ktxTexture_CreateFromNamedFile(
-    filename, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, target);
+  const ktxResult result = ktxTexture_CreateFromMemory(
+    file_mapping->data, file_mapping->size, create_flags, target);
+  if (result != KTX_SUCCESS) {
+    file_unmap(file_mapping);
+  }
   return result;
 }
 
+static void ktx_stream_release(texture_stream_entry_t* entry)
+{
+  mip_chain_t* mip_chain = (mip_chain_t*)entry->user_data;
+  mip_chain_release(mip_chain);
+  free(mip_chain);
+}
+
 static texture_result_t
 wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
-                                const char* filename)
+                                const char* filename, bool stream_mips)
 {
+  // The image data is loaded later on, directly into the staging buffer when
+  // the layout allows it
+  file_mapping_t file_mapping = {0};
   ktxTexture* ktx_texture;
-  ktxResult result = load_ktx_file(filename, &ktx_texture);
+  ktxResult result = load_ktx_file(filename, KTX_TEXTURE_CREATE_NO_FLAGS,
+                                   &file_mapping, &ktx_texture);
   assert(result == KTX_SUCCESS);
 
-  ktx_uint8_t* ktx_texture_data = ktxTexture_GetData(ktx_texture);
-
   // WebGPU requires that the bytes per row is a multiple of 256
   uint32_t resized_width = make_multiple_of_256(ktx_texture->baseWidth);
 
@@ -1022,9 +2352,10 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
     = ktx_texture->isCubemap ? ktx_texture->baseWidth : resized_width;
   uint32_t texture_height = ktx_texture->baseHeight;
   uint32_t texture_depth  = ktx_texture->isCubemap ? 6u : 1u;
+  // Cubemaps use the (prefiltered) mip levels stored in the file
   uint32_t texture_mip_level_count
     = ktx_texture->isCubemap ?
-        1u :
+        ktx_texture->numLevels :
         calculate_mip_level_count(ktx_texture->baseWidth,
                                   ktx_texture->baseHeight);
   WGPUTextureFormat texture_format = WGPUTextureFormat_RGBA8Unorm;
@@ -1044,37 +2375,83 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
   WGPUTexture texture
     = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
 
-  WGPUCommandEncoder cmd_encoder
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  uint32_t resident_mip_level    = 0;
 
   if (ktx_texture->isCubemap) {
+    // WebGPU requires that the bytes per row is a multiple of 256, the rows
+    // of levels which are not aligned are padded in the staging buffer
+    bool padded_rows       = false;
+    ktx_size_t padded_size = 0;
+    for (uint32_t level = 0; level < texture_mip_level_count; ++level) {
+      const uint32_t row_pitch     = ktxTexture_GetRowPitch(ktx_texture, level);
+      const uint32_t bytes_per_row = make_multiple_of_256(row_pitch);
+      padded_rows = padded_rows || bytes_per_row != row_pitch;
+      padded_size += (ktx_size_t)bytes_per_row
+                     * MAX(texture_height >> level, 1u) * texture_depth;
+    }
+    const ktx_size_t staging_size
+      = padded_rows ? padded_size : ktxTexture_GetSize(ktx_texture);
+
     // Create a host-visible staging buffer that contains the raw image data
-    ktx_size_t ktx_texture_size              = ktxTexture_GetSize(ktx_texture);
     WGPUBufferDescriptor staging_buffer_desc = {
       .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
-      .size             = ktx_texture_size,
+      .size             = staging_size,
       .mappedAtCreation = true,
     };
     WGPUBuffer staging_buffer
       = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
     ASSERT(staging_buffer)
 
-    // Copy texture data into staging buffer
-    void* mapping
-      = wgpuBufferGetMappedRange(staging_buffer, 0, ktx_texture_size);
+    uint8_t* mapping
+      = (uint8_t*)wgpuBufferGetMappedRange(staging_buffer, 0, staging_size);
     ASSERT(mapping)
-    memcpy(mapping, ktx_texture_data, ktx_texture_size);
-    wgpuBufferUnmap(staging_buffer);
-
-    for (uint32_t face = 0; face < texture_depth; ++face) {
+    if (!padded_rows) {
+      // The ktx layout matches the upload layout, load the image data straight
+      // into the staging buffer
+      result = ktxTexture_LoadImageData(ktx_texture, mapping, staging_size);
+      assert(result == KTX_SUCCESS);
+    }
+    else {
+      // Load the image data into the ktx texture and pad the rows on copy
+      result = ktxTexture_LoadImageData(ktx_texture, NULL, 0);
+      assert(result == KTX_SUCCESS);
+      const ktx_uint8_t* ktx_texture_data = ktxTexture_GetData(ktx_texture);
+      uint8_t* dst                        = mapping;
       for (uint32_t level = 0; level < texture_mip_level_count; ++level) {
-        uint32_t width  = ktx_texture->baseWidth >> level;
-        uint32_t height = ktx_texture->baseHeight >> level;
+        const uint32_t src_pitch = ktxTexture_GetRowPitch(ktx_texture, level);
+        const uint32_t dst_pitch = make_multiple_of_256(src_pitch);
+        const uint32_t rows      = MAX(texture_height >> level, 1u);
+        for (uint32_t face = 0; face < texture_depth; ++face) {
+          ktx_size_t offset;
+          result
+            = ktxTexture_GetImageOffset(ktx_texture, level, 0, face, &offset);
+          assert(result == KTX_SUCCESS);
+          for (uint32_t y = 0; y < rows; ++y) {
+            memcpy(dst + (size_t)y * dst_pitch,
+                   ktx_texture_data + offset + (size_t)y * src_pitch,
+                   src_pitch);
+          }
+          dst += (size_t)dst_pitch * rows;
+        }
+      }
+    }
+    wgpuBufferUnmap(staging_buffer);
 
-        ktx_size_t offset;
-        KTX_error_code result
-          = ktxTexture_GetImageOffset(ktx_texture, level, 0, face, &offset);
-        assert(result == KTX_SUCCESS);
+    ktx_size_t padded_offset = 0;
+    for (uint32_t level = 0; level < texture_mip_level_count; ++level) {
+      const uint32_t row_pitch     = ktxTexture_GetRowPitch(ktx_texture, level);
+      const uint32_t bytes_per_row = make_multiple_of_256(row_pitch);
+      const uint32_t level_width   = MAX(texture_width >> level, 1u);
+      const uint32_t level_height  = MAX(texture_height >> level, 1u);
+      for (uint32_t face = 0; face < texture_depth; ++face) {
+        ktx_size_t offset = padded_offset;
+        if (!padded_rows) {
+          result
+            = ktxTexture_GetImageOffset(ktx_texture, level, 0, face, &offset);
+          assert(result == KTX_SUCCESS);
+        }
+        padded_offset += (ktx_size_t)bytes_per_row * level_height;
 
         // Upload staging buffer to texture
         wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
@@ -1083,8 +2460,8 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
             .buffer = staging_buffer,
             .layout = (WGPUTextureDataLayout) {
               .offset = offset,
-              .bytesPerRow = width * 4,
-              .rowsPerImage= height,
+              .bytesPerRow = bytes_per_row,
+              .rowsPerImage= level_height,
             },
           },
           // Destination
@@ -1100,8 +2477,8 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
           },
           // Copy size
           &(WGPUExtent3D){
-            .width               = MAX(1u, width),
-            .height              = MAX(1u, height),
+            .width               = level_width,
+            .height              = level_height,
             .depthOrArrayLayers  = 1,
           });
       }
@@ -1109,40 +2486,74 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
 
     WGPU_RELEASE_RESOURCE(Buffer, staging_buffer);
   }
+  else if (stream_mips
+           && texture_mip_level_count <= TEXTURE_STREAM_MAX_LEVELS) {
+    // Generate the mipmaps on the CPU, the mip chain is kept until all levels
+    // are streamed
+    result = ktxTexture_LoadImageData(ktx_texture, NULL, 0);
+    assert(result == KTX_SUCCESS);
+    mip_chain_t* mip_chain = (mip_chain_t*)malloc(sizeof(mip_chain_t));
+    mip_chain_create(mip_chain, texture_width, texture_height,
+                     texture_mip_level_count);
+    mip_chain_generate(mip_chain, ktxTexture_GetData(ktx_texture),
+                       ktx_texture->baseWidth, ktx_texture->baseHeight, false);
+
+    texture_stream_entry_t* entry
+      = (texture_stream_entry_t*)calloc(1, sizeof(texture_stream_entry_t));
+    entry->texture     = texture;
+    entry->width       = texture_width;
+    entry->height      = texture_height;
+    entry->face_count  = 1;
+    entry->level_count = mip_chain->level_count;
+    entry->release     = ktx_stream_release;
+    entry->user_data   = mip_chain;
+    for (uint32_t level = 0; level < mip_chain->level_count; ++level) {
+      const mip_chain_level_t* mip_level = &mip_chain->levels[level];
+      entry->levels[level][0]            = (texture_level_data_t){
+        .data           = mip_chain->pixels + mip_level->offset,
+        .size           = mip_level->bytes_per_row * mip_level->height,
+        .bytes_per_row  = mip_level->bytes_per_row,
+        .rows_per_image = mip_level->height,
+        .width          = mip_level->width,
+        .height         = mip_level->height,
+      };
+    }
+    resident_mip_level
+      = texture_stream_add(wgpu_context->texture_client, entry);
+  }
   else { /* WGPUTextureDimension_2D */
-    // Generate Mipmap
-    uint8_t** resized_vec = NULL;
-    generate_mipmap(ktx_texture_data, ktx_texture->baseWidth,
-                    ktx_texture->baseHeight, 0, &resized_vec, resized_width,
-                    ktx_texture->baseHeight, 0, 4, true);
+    // Generate Mipmap, the texture is created as RGBA8Unorm so the data is
+    // filtered as linear
+    result = ktxTexture_LoadImageData(ktx_texture, NULL, 0);
+    assert(result == KTX_SUCCESS);
+    const ktx_uint8_t* ktx_texture_data = ktxTexture_GetData(ktx_texture);
+    mip_chain_t mip_chain;
+    mip_chain_create(&mip_chain, texture_width, texture_height,
+                     texture_mip_level_count);
+    mip_chain_generate(&mip_chain, ktx_texture_data, ktx_texture->baseWidth,
+                       ktx_texture->baseHeight, false);
+
+    // Create a host-visible staging buffer that contains all mip levels
+    WGPUBufferDescriptor staging_buffer_desc = {
+      .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
+      .size             = mip_chain.size,
+      .mappedAtCreation = true,
+    };
+    WGPUBuffer staging_buffer
+      = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
+    ASSERT(staging_buffer)
+
+    // Copy texture data into staging buffer
+    void* mapping = wgpuBufferGetMappedRange(staging_buffer, 0, mip_chain.size);
+    ASSERT(mapping)
+    memcpy(mapping, mip_chain.pixels, mip_chain.size);
+    wgpuBufferUnmap(staging_buffer);
 
     // Setup buffer copy regions for each face including all of its mip levels
     // and copy the texture regions from the staging buffer into the texture
     for (uint32_t face = 0; face < texture_depth; ++face) {
-      for (uint32_t level = 0; level < texture_mip_level_count; ++level) {
-        uint32_t width  = texture_width >> level;
-        uint32_t height = texture_height >> level;
-        if (height == 0) {
-          height = 1;
-        }
-
-        // Create a host-visible staging buffer that contains the raw image data
-        size_t ktx_texture_size                  = texture_width * height * 4;
-        WGPUBufferDescriptor staging_buffer_desc = {
-          .usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
-          .size  = ktx_texture_size,
-          .mappedAtCreation = true,
-        };
-        WGPUBuffer staging_buffer
-          = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
-        ASSERT(staging_buffer)
-
-        // Copy texture data into staging buffer
-        void* mapping
-          = wgpuBufferGetMappedRange(staging_buffer, 0, ktx_texture_size);
-        ASSERT(mapping)
-        memcpy(mapping, resized_vec[level], ktx_texture_size);
-        wgpuBufferUnmap(staging_buffer);
+      for (uint32_t level = 0; level < mip_chain.level_count; ++level) {
+        const mip_chain_level_t* mip_level = &mip_chain.levels[level];
 
         // Upload statging buffer to texture
         wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
@@ -1150,9 +2561,9 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
           &(WGPUImageCopyBuffer) {
             .buffer = staging_buffer,
             .layout = (WGPUTextureDataLayout) {
-              .offset = 0,
-              .bytesPerRow = texture_width * 4,
-              .rowsPerImage= height,
+              .offset = mip_level->offset,
+              .bytesPerRow = mip_level->bytes_per_row,
+              .rowsPerImage= mip_level->height,
             },
           },
           // Destination
@@ -1168,195 +2579,614 @@ wgpu_texture_load_from_ktx_file(wgpu_context_t* wgpu_context,
           },
           // Copy size
           &(WGPUExtent3D){
-            .width               = MAX(1u, width),
-            .height              = MAX(1u, height),
+            .width               = mip_level->width,
+            .height              = mip_level->height,
             .depthOrArrayLayers  = 1,
           });
-
-        WGPU_RELEASE_RESOURCE(Buffer, staging_buffer);
       }
     }
+
+    WGPU_RELEASE_RESOURCE(Buffer, staging_buffer);
     // Free image data after upload to GPU
-    destroy_image_data(resized_vec, resized_width, ktx_texture->baseHeight);
+    mip_chain_release(&mip_chain);
   }
 
-  WGPUCommandBuffer command_buffer
-    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
-  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
-
-  // Sumbit commmand buffer and cleanup
-  ASSERT(command_buffer != NULL)
-
-  // Submit to the queue
-  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
-
-  // Release command buffer
-  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  // Submit to the queue, batched uploads are submitted with the batch
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
 
   // Clean up staging resources
   ktxTexture_Destroy(ktx_texture);
+  file_unmap(&file_mapping);
 
   return (texture_result_t){
-    .texture         = texture,
-    .width           = texture_desc.size.width,
-    .height          = texture_desc.size.height,
-    .depth           = texture_desc.size.depthOrArrayLayers,
-    .mip_level_count = texture_desc.mipLevelCount,
-    .format          = texture_desc.format,
-    .dimension       = texture_desc.dimension,
+    .texture            = texture,
+    .width              = texture_desc.size.width,
+    .height             = texture_desc.size.height,
+    .depth              = texture_desc.size.depthOrArrayLayers,
+    .mip_level_count    = texture_desc.mipLevelCount,
+    .resident_mip_level = resident_mip_level,
+    .format             = texture_desc.format,
+    .dimension          = texture_desc.dimension,
   };
 }
 
-static texture_result_t
-wgpu_texture_load_from_basis_file(wgpu_context_t* wgpu_context,
-                                  const char* filename)
+/* -------------------------------------------------------------------------- *
+ * Basis Universal transcoding cache
+ * -------------------------------------------------------------------------- */
+
+#define BASIS_CACHE_MAGIC 0x48434257u /* "WBCH" */
+#define BASIS_CACHE_VERSION 2u
+
+/* Header of a cache file, followed by the payload of each face of each mip
+ * level */
+typedef struct basis_cache_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_hash;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t level_count;
+  uint32_t face_count;
+  uint32_t level_sizes[BASISU_MAX_MIPMAPS];
+} basis_cache_header_t;
+
+/* Transcoded payload of every mip level and face */
+typedef struct basis_image_t {
+  basisu_image_desc_t desc;
+  basisu_data_t levels[BASISU_MAX_MIPMAPS][6];
+} basis_image_t;
+
+static uint64_t basis_cache_hash(uint64_t hash, const void* data, size_t size)
 {
-  // Read file into memory
-  if (!file_exists(filename)) {
-    log_fatal("Could not load texture from %s", filename);
-    return (texture_result_t){0};
+  /* 64-bit FNV-1a */
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/**
+ * @brief Builds the cache file name of a .basis file. The name contains a hash
+ * of the supported format list, since that list selects the target format.
+ */
+static void basis_cache_get_filename(struct wgpu_texture_client_t* client,
+                                     const char* filename, char* cache_filename,
+                                     size_t size)
+{
+  const uint64_t formats_hash = basis_cache_hash(
+    0xcbf29ce484222325ull, client->supported_format_list.values,
+    client->supported_format_list.count * sizeof(WGPUTextureFormat));
+  if (client->transcode_cache_dir == NULL) {
+    snprintf(cache_filename, size, "%s.%08x.cache", filename,
+             (uint32_t)formats_hash);
+    return;
   }
+  const char* basename = strrchr(filename, '/');
+  basename             = basename ? basename + 1 : filename;
+  snprintf(cache_filename, size, "%s/%s.%08x.cache",
+           client->transcode_cache_dir, basename, (uint32_t)formats_hash);
+}
 
-  file_read_result_t file_read_result = {0};
-  read_file(filename, &file_read_result, false);
+/**
+ * @brief Reads a cached transcoding result. The level pointers of the image
+ * point into the returned cache data.
+ */
+static bool basis_cache_read(struct wgpu_texture_client_t* client,
+                             const char* cache_filename, uint64_t source_hash,
+                             file_mapping_t* cache_data,
+                             basis_image_t* image)
+{
+  if (file_map(cache_filename, cache_data) != 0) {
+    return false;
+  }
 
-  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  basis_cache_header_t header = {0};
+  bool valid                  = cache_data->size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, cache_data->data, sizeof(header));
+    valid = header.magic == BASIS_CACHE_MAGIC
+            && header.version == BASIS_CACHE_VERSION
+            && header.source_hash == source_hash
+            && header.level_count > 0
+            && header.level_count <= BASISU_MAX_MIPMAPS
+            && (header.face_count == 1 || header.face_count == 6);
+  }
 
-  // Transcode file
-  basisu_setup();
-  basisu_transcode_result_t transcode_result = basisu_transcode(
-    (basisu_data_t){
-      .ptr  = file_read_result.data,
-      .size = file_read_result.size,
-    },
-    &texture_client->supported_format_list.values,
-    texture_client->supported_format_list.count, false);
-  if (transcode_result.result_code != BASIS_TRANSCODE_RESULT_SUCCESS) {
-    log_fatal("Could not transcode texture from %s", filename);
-    return (texture_result_t){0};
+  // The cached format has to be supported by the current device
+  bool format_supported = false;
+  for (size_t i = 0; valid && i < client->supported_format_list.count; ++i) {
+    format_supported
+      |= client->supported_format_list.values[i] == header.format;
+  }
+  valid = valid && format_supported;
+
+  size_t offset = sizeof(header);
+  for (uint32_t level = 0; valid && level < header.level_count; ++level) {
+    for (uint32_t face = 0; face < header.face_count; ++face) {
+      if (offset + header.level_sizes[level] > cache_data->size) {
+        valid = false;
+        break;
+      }
+      image->levels[level][face] = (basisu_data_t){
+        .ptr  = cache_data->data + offset,
+        .size = header.level_sizes[level],
+      };
+      offset += header.level_sizes[level];
+    }
+  }
+
+  if (!valid) {
+    log_debug("Ignoring outdated transcode cache %s", cache_filename);
+    file_unmap(cache_data);
+    return false;
+  }
+
+  image->desc = (basisu_image_desc_t){
+    .format      = (WGPUTextureFormat)header.format,
+    .width       = header.width,
+    .height      = header.height,
+    .level_count = header.level_count,
+    .face_count  = header.face_count,
+  };
+  return true;
+}
+
+static void basis_cache_write(const char* cache_filename, uint64_t source_hash,
+                              const basis_image_t* image)
+{
+  FILE* file = fopen(cache_filename, "wb");
+  if (file == NULL) {
+    log_warn("Unable to write transcode cache %s", cache_filename);
+    return;
   }
 
-  // Create file
-  basisu_image_desc_t* image_desc = &transcode_result.image_desc;
+  const basisu_image_desc_t* desc = &image->desc;
+  basis_cache_header_t header     = {
+    .magic       = BASIS_CACHE_MAGIC,
+    .version     = BASIS_CACHE_VERSION,
+    .source_hash = source_hash,
+    .format      = (uint32_t)desc->format,
+    .width       = desc->width,
+    .height      = desc->height,
+    .level_count = desc->level_count,
+    .face_count  = desc->face_count,
+  };
+  for (uint32_t level = 0; level < desc->level_count; ++level) {
+    header.level_sizes[level] = (uint32_t)image->levels[level][0].size;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (uint32_t level = 0; written && level < desc->level_count; ++level) {
+    for (uint32_t face = 0; written && face < desc->face_count; ++face) {
+      const basisu_data_t* data = &image->levels[level][face];
+      written = data->size == header.level_sizes[level]
+                && fwrite(data->ptr, data->size, 1, file) == 1;
+    }
+  }
+  fclose(file);
+
+  if (!written) {
+    log_warn("Unable to write transcode cache %s", cache_filename);
+    remove(cache_filename);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Basis Universal texture loading
+ * -------------------------------------------------------------------------- */
+
+/* Transcoding of one mip level of one face on the thread pool */
+typedef struct basis_level_job_t {
+  basisu_transcoder_t* transcoder;
+  struct basis_level_jobs_t* jobs;
+  uint32_t face;
+  uint32_t level;
+  basisu_data_t* data; /* points into the basis image */
+  bool success;
+  bool done;
+} basis_level_job_t;
+
+typedef struct basis_level_jobs_t {
+  pthread_mutex_t mutex;
+  pthread_cond_t job_done;
+  basis_level_job_t jobs[BASISU_MAX_MIPMAPS * 6];
+  uint32_t job_count;
+} basis_level_jobs_t;
+
+static void basis_level_job_run(void* arg)
+{
+  basis_level_job_t* job = (basis_level_job_t*)arg;
+  const bool success     = basisu_transcoder_transcode_level(
+    job->transcoder, job->face, job->level, job->data);
+
+  pthread_mutex_lock(&job->jobs->mutex);
+  job->success = success;
+  job->done    = true;
+  pthread_cond_broadcast(&job->jobs->job_done);
+  pthread_mutex_unlock(&job->jobs->mutex);
+}
+
+static WGPUTexture basis_image_create_texture(wgpu_context_t* wgpu_context,
+                                              const basisu_image_desc_t* desc)
+{
   WGPUTextureDescriptor texture_desc = {
     .size          = (WGPUExtent3D) {
-      .width               = image_desc->width,
-      .height              = image_desc->height,
-      .depthOrArrayLayers  = 1,
+      .width               = desc->width,
+      .height              = desc->height,
+      .depthOrArrayLayers  = desc->face_count,
      },
-    .mipLevelCount = image_desc->level_count,
+    .mipLevelCount = desc->level_count,
     .sampleCount   = 1,
     .dimension     = WGPUTextureDimension_2D,
-    .format        = image_desc->format,
+    .format        = desc->format,
     .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
   };
-  WGPUTexture texture
-    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  return wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+}
 
-  WGPUCommandEncoder cmd_encoder
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+/* Layout of one transcoded mip level, rows are tightly packed blocks */
+static texture_level_data_t
+basis_image_get_level_data(const basisu_image_desc_t* desc, uint32_t level,
+                           const basisu_data_t* data)
+{
+  uint32_t block_size = 1, block_bytes = 4;
+  texture_format_get_block_info(desc->format, &block_size, &block_bytes);
+  const uint32_t width    = MAX(desc->width >> level, 1u);
+  const uint32_t height   = MAX(desc->height >> level, 1u);
+  const uint32_t blocks_x = (width + block_size - 1) / block_size;
+  const uint32_t blocks_y = (height + block_size - 1) / block_size;
+  return (texture_level_data_t){
+    .data           = (const uint8_t*)data->ptr,
+    .size           = data->size,
+    .bytes_per_row  = blocks_x * block_bytes,
+    .rows_per_image = blocks_y,
+    .width          = blocks_x * block_size,
+    .height         = blocks_y * block_size,
+  };
+}
 
-  for (uint32_t level = 0; level < image_desc->level_count; ++level) {
-    uint32_t width  = image_desc->width >> level;
-    uint32_t height = image_desc->height >> level;
-    if (height == 0) {
-      height = 1;
+/* Writes one transcoded mip level of one face to the texture */
+static void basis_image_upload_level(wgpu_context_t* wgpu_context,
+                                     WGPUTexture texture,
+                                     const basisu_image_desc_t* desc,
+                                     uint32_t face, uint32_t level,
+                                     const basisu_data_t* data)
+{
+  const texture_level_data_t level_data
+    = basis_image_get_level_data(desc, level, data);
+  texture_write_level(wgpu_context, texture, face, level, &level_data);
+}
+
+static texture_result_t basis_image_get_texture_result(
+  WGPUTexture texture, const basisu_image_desc_t* desc)
+{
+  return (texture_result_t){
+    .texture         = texture,
+    .width           = desc->width,
+    .height          = desc->height,
+    .depth           = desc->face_count,
+    .mip_level_count = desc->level_count,
+    .format          = desc->format,
+    .dimension       = WGPUTextureDimension_2D,
+  };
+}
+
+/* Streamed Basis Universal texture, owns the data of the levels */
+typedef struct basis_stream_t {
+  struct wgpu_texture_stream* stream;
+  basis_image_t image;
+  basisu_transcoder_t* transcoder; /* NULL if the levels were cached */
+  basis_level_jobs_t* jobs;
+  file_mapping_t file_data;
+  file_mapping_t cache_data;
+  char cache_filename[STRMAX];
+  uint64_t source_hash;
+} basis_stream_t;
+
+static bool basis_stream_level_ready(texture_stream_entry_t* entry,
+                                     uint32_t level, bool wait)
+{
+  basis_stream_t* basis    = (basis_stream_t*)entry->user_data;
+  basis_level_jobs_t* jobs = basis->jobs;
+  pthread_mutex_lock(&jobs->mutex);
+  for (uint32_t i = 0; i < jobs->job_count; ++i) {
+    basis_level_job_t* job = &jobs->jobs[i];
+    while (job->level == level && !job->done) {
+      if (!wait) {
+        pthread_mutex_unlock(&jobs->mutex);
+        return false;
+      }
+      pthread_cond_wait(&jobs->job_done, &jobs->mutex);
     }
+  }
+  pthread_mutex_unlock(&jobs->mutex);
 
-    // Create a host-visible staging buffer that contains the raw image data
-    size_t texture_size = image_desc->levels[level].size * 4;
-    WGPUBufferDescriptor staging_buffer_desc = {
-      .usage            = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
-      .size             = texture_size,
-      .mappedAtCreation = true,
-    };
-    WGPUBuffer staging_buffer
-      = wgpuDeviceCreateBuffer(wgpu_context->device, &staging_buffer_desc);
-    ASSERT(staging_buffer)
+  // Failed levels have no data and are skipped
+  for (uint32_t face = 0; face < entry->face_count; ++face) {
+    entry->levels[level][face] = basis_image_get_level_data(
+      &basis->image.desc, level, &basis->image.levels[level][face]);
+  }
+  return true;
+}
 
-    // Copy texture data into staging buffer
-    void* mapping = wgpuBufferGetMappedRange(staging_buffer, 0, texture_size);
-    ASSERT(mapping)
-    memcpy(mapping, image_desc->levels[level].ptr,
-           image_desc->levels[level].size);
-    wgpuBufferUnmap(staging_buffer);
+static void basis_stream_release(texture_stream_entry_t* entry)
+{
+  basis_stream_t* basis           = (basis_stream_t*)entry->user_data;
+  const basisu_image_desc_t* desc = &basis->image.desc;
+  if (basis->transcoder != NULL) {
+    // The jobs of the levels are finished once all levels were uploaded,
+    // unless the stream is destroyed early
+    basis_level_jobs_t* jobs = basis->jobs;
+    bool success             = true;
+    pthread_mutex_lock(&jobs->mutex);
+    for (uint32_t i = 0; i < jobs->job_count; ++i) {
+      while (!jobs->jobs[i].done) {
+        pthread_cond_wait(&jobs->job_done, &jobs->mutex);
+      }
+      success = success && jobs->jobs[i].success;
+    }
+    pthread_mutex_unlock(&jobs->mutex);
+    pthread_cond_destroy(&jobs->job_done);
+    pthread_mutex_destroy(&jobs->mutex);
+    free(jobs);
+    basisu_transcoder_release(basis->transcoder);
+    if (success) {
+      basis_cache_write(basis->cache_filename, basis->source_hash,
+                        &basis->image);
+    }
+    for (uint32_t level = 0; level < desc->level_count; ++level) {
+      for (uint32_t face = 0; face < desc->face_count; ++face) {
+        free((void*)basis->image.levels[level][face].ptr);
+      }
+    }
+    if (--basis->stream->basis_entry_count == 0) {
+      basisu_shutdown();
+    }
+  }
+  file_unmap(&basis->cache_data);
+  file_unmap(&basis->file_data);
+  free(basis);
+}
 
-    // Upload statging buffer to texture
-    wgpuCommandEncoderCopyBufferToTexture(cmd_encoder,
-      // Source
-      &(WGPUImageCopyBuffer) {
-        .buffer = staging_buffer,
-        .layout = (WGPUTextureDataLayout) {
-          .offset = 0,
-          .bytesPerRow = texture_size / height,
-          .rowsPerImage= height,
-        },
-      },
-      // Destination
-      &(WGPUImageCopyTexture){
-        .texture = texture,
-        .mipLevel = level,
-        .origin = (WGPUOrigin3D) {
-          .x=0,
-          .y=0,
-          .z=0,
-        },
-        .aspect = WGPUTextureAspect_All,
-      },
-      // Copy size
-      &(WGPUExtent3D){
-        .width               = MAX(1u, width),
-        .height              = MAX(1u, height),
-        .depthOrArrayLayers  = 1,
-      });
+/**
+ * @brief Creates a texture of which the tail mip levels are uploaded, the
+ * remaining levels are transcoded on the thread pool of the texture stream
+ * and uploaded by wgpu_texture_client_stream_mips().
+ */
+static texture_result_t basis_image_stream(wgpu_context_t* wgpu_context,
+                                           basis_stream_t* basis)
+{
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  const basisu_image_desc_t* desc              = &basis->image.desc;
+  WGPUTexture texture = basis_image_create_texture(wgpu_context, desc);
+
+  texture_stream_entry_t* entry
+    = (texture_stream_entry_t*)calloc(1, sizeof(texture_stream_entry_t));
+  entry->texture     = texture;
+  entry->width       = desc->width;
+  entry->height      = desc->height;
+  entry->face_count  = desc->face_count;
+  entry->level_count = desc->level_count;
+  entry->release     = basis_stream_release;
+  entry->user_data   = basis;
+
+  if (basis->transcoder == NULL) {
+    // Cached levels, all data is available
+    for (uint32_t level = 0; level < desc->level_count; ++level) {
+      for (uint32_t face = 0; face < desc->face_count; ++face) {
+        entry->levels[level][face] = basis_image_get_level_data(
+          desc, level, &basis->image.levels[level][face]);
+      }
+    }
+  }
+  else {
+    // Smallest levels first, the tail levels are waited for
+    basis_level_jobs_t* jobs = (basis_level_jobs_t*)calloc(1, sizeof(*jobs));
+    pthread_mutex_init(&jobs->mutex, NULL);
+    pthread_cond_init(&jobs->job_done, NULL);
+    thread_pool_t* thread_pool = texture_stream_get_thread_pool(texture_client);
+    for (uint32_t level = desc->level_count; level-- > 0;) {
+      for (uint32_t face = 0; face < desc->face_count; ++face) {
+        basis_level_job_t* job = &jobs->jobs[jobs->job_count++];
+        *job                   = (basis_level_job_t){
+          .transcoder = basis->transcoder,
+          .jobs       = jobs,
+          .face       = face,
+          .level      = level,
+          .data       = &basis->image.levels[level][face],
+        };
+        thread_pool_submit(thread_pool, basis_level_job_run, job);
+      }
+    }
+    basis->jobs        = jobs;
+    basis->stream      = texture_stream_get(texture_client);
+    entry->level_ready = basis_stream_level_ready;
+    basis->stream->basis_entry_count++;
+  }
 
-    WGPU_RELEASE_RESOURCE(Buffer, staging_buffer);
+  texture_result_t texture_result
+    = basis_image_get_texture_result(texture, desc);
+  texture_result.resident_mip_level
+    = texture_stream_add(texture_client, entry);
+  return texture_result;
+}
+
+/**
+ * @brief Transcodes all mip levels and faces on a thread pool. Every level is
+ * uploaded as soon as it is transcoded, largest levels first.
+ */
+static texture_result_t
+basis_image_transcode(wgpu_context_t* wgpu_context,
+                      basisu_transcoder_t* transcoder, basis_image_t* image)
+{
+  const basisu_image_desc_t* desc = &image->desc;
+  WGPUTexture texture
+    = basis_image_create_texture(wgpu_context, desc);
+
+  basis_level_jobs_t* jobs = (basis_level_jobs_t*)calloc(1, sizeof(*jobs));
+  pthread_mutex_init(&jobs->mutex, NULL);
+  pthread_cond_init(&jobs->job_done, NULL);
+  thread_pool_t* thread_pool = thread_pool_create(0);
+  for (uint32_t level = 0; level < desc->level_count; ++level) {
+    for (uint32_t face = 0; face < desc->face_count; ++face) {
+      basis_level_job_t* job = &jobs->jobs[jobs->job_count++];
+      *job                   = (basis_level_job_t){
+        .transcoder = transcoder,
+        .jobs       = jobs,
+        .face       = face,
+        .level      = level,
+        .data       = &image->levels[level][face],
+      };
+      thread_pool_submit(thread_pool, basis_level_job_run, job);
+    }
   }
 
-  WGPUCommandBuffer command_buffer
-    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
-  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+  // The device is only used from this thread
+  bool success = true;
+  for (uint32_t i = 0; i < jobs->job_count; ++i) {
+    basis_level_job_t* job = &jobs->jobs[i];
+    pthread_mutex_lock(&jobs->mutex);
+    while (!job->done) {
+      pthread_cond_wait(&jobs->job_done, &jobs->mutex);
+    }
+    pthread_mutex_unlock(&jobs->mutex);
+    if (!job->success) {
+      success = false;
+      continue;
+    }
+    if (success) {
+      basis_image_upload_level(wgpu_context, texture, desc, job->face,
+                               job->level, job->data);
+    }
+  }
 
-  // Sumbit commmand buffer and cleanup
-  ASSERT(command_buffer != NULL)
+  thread_pool_release(thread_pool);
+  pthread_cond_destroy(&jobs->job_done);
+  pthread_mutex_destroy(&jobs->mutex);
+  free(jobs);
 
-  // Submit to the queue
-  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  if (!success) {
+    WGPU_RELEASE_RESOURCE(Texture, texture)
+    return (texture_result_t){0};
+  }
+  return basis_image_get_texture_result(texture, desc);
+}
 
-  // Release command buffer
-  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+static texture_result_t
+wgpu_texture_load_from_basis_file(wgpu_context_t* wgpu_context,
+                                  const char* filename, bool stream_mips)
+{
+  // Map file into memory
+  file_mapping_t file_mapping = {0};
+  const int error             = file_map(filename, &file_mapping);
+  if (error != 0) {
+    log_fatal("Could not load texture from %s: %s", filename, strerror(error));
+    return (texture_result_t){0};
+  }
 
-  // Clean up staging resources
-  basisu_free(image_desc);
-  basisu_shutdown();
-  free(file_read_result.data);
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
 
-  return (texture_result_t){
-    .texture         = texture,
-    .width           = texture_desc.size.width,
-    .height          = texture_desc.size.height,
-    .depth           = texture_desc.size.depthOrArrayLayers,
-    .mip_level_count = texture_desc.mipLevelCount,
-    .format          = texture_desc.format,
-    .dimension       = texture_desc.dimension,
-  };
+  // Reuse the result of an earlier transcoding of the same file
+  char cache_filename[STRMAX];
+  basis_cache_get_filename(texture_client, filename, cache_filename,
+                           sizeof(cache_filename));
+  const uint64_t source_hash = basis_cache_hash(
+    0xcbf29ce484222325ull, file_mapping.data, file_mapping.size);
+
+  file_mapping_t cache_data = {0};
+  basis_image_t image       = {0};
+  const bool cached = basis_cache_read(texture_client, cache_filename,
+                                       source_hash, &cache_data, &image);
+  if (cached && stream_mips) {
+    basis_stream_t* basis = (basis_stream_t*)calloc(1, sizeof(basis_stream_t));
+    basis->image          = image;
+    basis->cache_data     = cache_data;
+    file_unmap(&file_mapping);
+    return basis_image_stream(wgpu_context, basis);
+  }
+  if (cached) {
+    WGPUTexture texture = basis_image_create_texture(wgpu_context, &image.desc);
+    for (uint32_t level = 0; level < image.desc.level_count; ++level) {
+      for (uint32_t face = 0; face < image.desc.face_count; ++face) {
+        basis_image_upload_level(wgpu_context, texture, &image.desc, face,
+                                 level, &image.levels[level][face]);
+      }
+    }
+    file_unmap(&cache_data);
+    file_unmap(&file_mapping);
+    return basis_image_get_texture_result(texture, &image.desc);
+  }
+
+  // Transcode file
+  basisu_setup();
+  uint32_t result_code            = BASIS_TRANSCODE_RESULT_SUCCESS;
+  basisu_transcoder_t* transcoder = basisu_transcoder_create(
+    (basisu_data_t){
+      .ptr  = file_mapping.data,
+      .size = file_mapping.size,
+    },
+    texture_client->supported_format_list.values,
+    texture_client->supported_format_list.count, true, &image.desc,
+    &result_code);
+
+  if (transcoder != NULL && stream_mips) {
+    // The stream owns the transcoder and the data until all levels are
+    // transcoded
+    basis_stream_t* basis = (basis_stream_t*)calloc(1, sizeof(basis_stream_t));
+    basis->image          = image;
+    basis->transcoder     = transcoder;
+    basis->file_data      = file_mapping;
+    basis->source_hash    = source_hash;
+    snprintf(basis->cache_filename, sizeof(basis->cache_filename), "%s",
+             cache_filename);
+    return basis_image_stream(wgpu_context, basis);
+  }
+
+  texture_result_t texture_result = {0};
+  if (transcoder != NULL) {
+    texture_result = basis_image_transcode(wgpu_context, transcoder, &image);
+    basisu_transcoder_release(transcoder);
+  }
+  if (texture_result.texture != NULL) {
+    basis_cache_write(cache_filename, source_hash, &image);
+  }
+  else {
+    log_fatal("Could not transcode texture from %s", filename);
+  }
+
+  // Clean up transcoded data
+  for (uint32_t level = 0; level < image.desc.level_count; ++level) {
+    for (uint32_t face = 0; face < image.desc.face_count; ++face) {
+      free((void*)image.levels[level][face].ptr);
+    }
+  }
+  // Streamed textures still transcode with the global codebook
+  struct wgpu_texture_stream* stream = texture_client->texture_stream;
+  if (stream == NULL || stream->basis_entry_count == 0) {
+    basisu_shutdown();
+  }
+  file_unmap(&file_mapping);
+
+  return texture_result;
 }
 
 static texture_result_t wgpu_texture_client_load_texture_from_file(
   struct wgpu_texture_client_t* texture_client, const char* filename,
   struct wgpu_texture_load_options_t* options)
 {
+  const bool stream_mips = options != NULL && options->stream_mips;
   if (filename_has_extension(filename, "jpg")
       || filename_has_extension(filename, "png")) {
     return wgpu_texture_load_with_stb(texture_client, filename, options);
   }
   else if (filename_has_extension(filename, "ktx")) {
     return wgpu_texture_load_from_ktx_file(texture_client->wgpu_context,
-                                           filename);
+                                           filename, stream_mips);
   }
   else if (filename_has_extension(filename, "basis")) {
     return wgpu_texture_load_from_basis_file(texture_client->wgpu_context,
-                                             filename);
+                                             filename, stream_mips);
   }
 
   return (texture_result_t){0};
@@ -1369,27 +3199,16 @@ wgpu_create_texture(wgpu_context_t* wgpu_context,
 {
   ASSERT(texture_result);
 
-  const bool is_cubemap = texture_result->depth == 6u;
-
-  // Create texture view
-  WGPUTextureViewDescriptor texture_view_dec = {
-    .format = texture_result->format,
-    .dimension
-    = is_cubemap ? WGPUTextureViewDimension_Cube : WGPUTextureViewDimension_2D,
-    .baseMipLevel   = 0,
-    .mipLevelCount  = texture_result->mip_level_count,
-    .baseArrayLayer = 0,
-    .arrayLayerCount
-    = texture_result->depth, // Cube faces count as array layers
-  };
-  WGPUTextureView texture_view
-    = wgpuTextureCreateView(texture_result->texture, &texture_view_dec);
+  // Create texture view, streamed textures start with the resident levels
+  WGPUTextureView texture_view = texture_create_view(
+    texture_result->texture, texture_result->format, texture_result->depth,
+    texture_result->array_view, texture_result->resident_mip_level,
+    texture_result->mip_level_count);
 
   const bool is_size_power_of_2 = is_power_of_2(texture_result->width)
                                   && is_power_of_2(texture_result->height);
-  WGPUFilterMode mipmapFilter = is_size_power_of_2 && !is_cubemap ?
-                                  WGPUFilterMode_Linear :
-                                  WGPUFilterMode_Nearest;
+  WGPUFilterMode mipmapFilter
+    = is_size_power_of_2 ? WGPUFilterMode_Linear : WGPUFilterMode_Nearest;
   WGPUAddressMode address_mode
     = options ? options->address_mode : WGPUAddressMode_ClampToEdge;
 
@@ -1405,8 +3224,7 @@ wgpu_create_texture(wgpu_context_t* wgpu_context,
     .lodMaxClamp   = (float)texture_result->mip_level_count,
     .maxAnisotropy = 1,
   };
-  WGPUSampler sampler
-    = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+  WGPUSampler sampler = wgpu_create_sampler(wgpu_context, &sampler_desc);
 
   return (texture_t){
     .size = {
@@ -1414,12 +3232,13 @@ wgpu_create_texture(wgpu_context_t* wgpu_context,
       .height = texture_result->height,
       .depth  = texture_result->depth,
     },
-    .mip_level_count = texture_result->mip_level_count,
-    .format          = texture_result->format,
-    .dimension       = texture_result->dimension,
-    .texture         = texture_result->texture,
-    .view            = texture_view,
-    .sampler         = sampler,
+    .mip_level_count    = texture_result->mip_level_count,
+    .resident_mip_level = texture_result->resident_mip_level,
+    .format             = texture_result->format,
+    .dimension          = texture_result->dimension,
+    .texture            = texture_result->texture,
+    .view               = texture_view,
+    .sampler            = sampler,
   };
 }
 
@@ -1445,33 +3264,67 @@ wgpu_texture_client_create(wgpu_context_t* wgpu_context)
   }
 
   {
-    static const WGPUTextureFormat supported_format_list[12] = {
-      // Uncompressed format list
-      WGPUTextureFormat_RGBA8Unorm,
-      WGPUTextureFormat_RGBA8UnormSrgb,
-      WGPUTextureFormat_BGRA8Unorm,
-      WGPUTextureFormat_BGRA8UnormSrgb,
-      // Compressed format list
-      WGPUTextureFormat_BC1RGBAUnorm,
-      WGPUTextureFormat_BC1RGBAUnormSrgb,
-      WGPUTextureFormat_BC2RGBAUnorm,
-      WGPUTextureFormat_BC2RGBAUnormSrgb,
-      WGPUTextureFormat_BC3RGBAUnorm,
-      WGPUTextureFormat_BC3RGBAUnormSrgb,
-      WGPUTextureFormat_BC7RGBAUnorm,
-      WGPUTextureFormat_BC7RGBAUnormSrgb,
+    // Uncompressed formats are always supported, followed by the compressed
+    // formats of every texture compression feature of the device
+    static const WGPUTextureFormat bc_format_list[8] = {
+      WGPUTextureFormat_BC1RGBAUnorm, WGPUTextureFormat_BC1RGBAUnormSrgb,
+      WGPUTextureFormat_BC2RGBAUnorm, WGPUTextureFormat_BC2RGBAUnormSrgb,
+      WGPUTextureFormat_BC3RGBAUnorm, WGPUTextureFormat_BC3RGBAUnormSrgb,
+      WGPUTextureFormat_BC7RGBAUnorm, WGPUTextureFormat_BC7RGBAUnormSrgb,
+    };
+    static const WGPUTextureFormat etc2_format_list[4] = {
+      WGPUTextureFormat_ETC2RGB8Unorm,
+      WGPUTextureFormat_ETC2RGB8UnormSrgb,
+      WGPUTextureFormat_ETC2RGBA8Unorm,
+      WGPUTextureFormat_ETC2RGBA8UnormSrgb,
+    };
+    static const WGPUTextureFormat astc_format_list[2] = {
+      WGPUTextureFormat_ASTC4x4Unorm,
+      WGPUTextureFormat_ASTC4x4UnormSrgb,
     };
-    memcpy(texture_client->supported_format_list.values, supported_format_list,
-           sizeof(supported_format_list));
-    texture_client->allow_compressed_formats = wgpuDeviceHasFeature(
-      wgpu_context->device, WGPUFeatureName_TextureCompressionBC);
-    texture_client->supported_format_list.count
-      = texture_client->allow_compressed_formats ? 12 : 4;
+    texture_client->texture_compression.bc
+      = wgpu_has_feature(wgpu_context, WGPUFeatureName_TextureCompressionBC);
+    texture_client->texture_compression.etc2
+      = wgpu_has_feature(wgpu_context, WGPUFeatureName_TextureCompressionETC2);
+    texture_client->texture_compression.astc
+      = wgpu_has_feature(wgpu_context, WGPUFeatureName_TextureCompressionASTC);
+    texture_client->allow_compressed_formats
+      = texture_client->texture_compression.bc
+        || texture_client->texture_compression.etc2
+        || texture_client->texture_compression.astc;
+
+    const struct {
+      bool supported;
+      const WGPUTextureFormat* values;
+      size_t count;
+    } format_lists[4] = {
+      {true, texture_client->uncompressed_format_list.values,
+       texture_client->uncompressed_format_list.count},
+      {texture_client->texture_compression.bc, bc_format_list,
+       ARRAY_SIZE(bc_format_list)},
+      {texture_client->texture_compression.etc2, etc2_format_list,
+       ARRAY_SIZE(etc2_format_list)},
+      {texture_client->texture_compression.astc, astc_format_list,
+       ARRAY_SIZE(astc_format_list)},
+    };
+    size_t count = 0;
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(format_lists); ++i) {
+      if (!format_lists[i].supported) {
+        continue;
+      }
+      memcpy(&texture_client->supported_format_list.values[count],
+             format_lists[i].values,
+             format_lists[i].count * sizeof(WGPUTextureFormat));
+      count += format_lists[i].count;
+    }
+    texture_client->supported_format_list.count = count;
   }
 
   return texture_client;
 }
 
+static void texture_cache_destroy(struct wgpu_texture_client_t* texture_client);
+
 void wgpu_texture_client_destroy(struct wgpu_texture_client_t* texture_client)
 {
   if (texture_client != NULL) {
@@ -1479,6 +3332,8 @@ void wgpu_texture_client_destroy(struct wgpu_texture_client_t* texture_client)
       wgpu_mipmap_generator_destroy(texture_client->wgpu_mipmap_generator);
       texture_client->wgpu_mipmap_generator = NULL;
     }
+    texture_cache_destroy(texture_client);
+    texture_stream_destroy(texture_client);
     free(texture_client);
     texture_client = NULL;
   }
@@ -1614,8 +3469,7 @@ texture_t wgpu_create_empty_texture(wgpu_context_t* wgpu_context)
     .lodMaxClamp   = 1.0f,
     .maxAnisotropy = 1,
   };
-  WGPUSampler sampler
-    = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+  WGPUSampler sampler = wgpu_create_sampler(wgpu_context, &sampler_desc);
 
   return (texture_t){
     .size = {
@@ -1631,3 +3485,685 @@ texture_t wgpu_create_empty_texture(wgpu_context_t* wgpu_context)
     .sampler         = sampler,
   };
 }
+
+/* -------------------------------------------------------------------------- *
+ * Image decoding
+ * -------------------------------------------------------------------------- */
+
+bool wgpu_image_data_load_from_file(const char* filename, bool flip_y,
+                                    image_data_t* image_data)
+{
+  stb_image_load_result_t image_load_result
+    = stb_image_load_image_from_file(filename, flip_y);
+
+  *image_data = (image_data_t){
+    .width         = image_load_result.image_width,
+    .height        = image_load_result.image_height,
+    .channel_count = image_load_result.channel_count,
+    .pixels        = image_load_result.pixel_data,
+  };
+
+  return image_data->pixels != NULL;
+}
+
+bool wgpu_image_data_load_from_memory(const void* data, size_t data_size,
+                                      bool flip_y, image_data_t* image_data)
+{
+  int width = 0, height = 0, read_comps = 0;
+  stbi_set_flip_vertically_on_load_thread(flip_y);
+  stbi_uc* pixel_data
+    = stbi_load_from_memory((const stbi_uc*)data, (int)data_size, &width,
+                            &height, &read_comps, STBI_rgb_alpha);
+  if (pixel_data == NULL) {
+    log_warn("Couldn't parse image data!");
+  }
+
+  *image_data = (image_data_t){
+    .width         = width,
+    .height        = height,
+    .channel_count = 4,
+    .pixels        = pixel_data,
+  };
+
+  return image_data->pixels != NULL;
+}
+
+void wgpu_image_data_release(image_data_t* image_data)
+{
+  if (image_data->pixels != NULL) {
+    stbi_image_free(image_data->pixels);
+    image_data->pixels = NULL;
+  }
+}
+
+texture_t
+wgpu_create_texture_from_image_data(wgpu_context_t* wgpu_context,
+                                    const image_data_t* image_data,
+                                    struct wgpu_texture_load_options_t* options)
+{
+  if (wgpu_context->texture_client == NULL) {
+    wgpu_create_texture_client(wgpu_context);
+  }
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+
+  texture_result_t texture_result = wgpu_texture_load_from_image_data(
+    texture_client, image_data, options);
+
+  if (texture_result.texture) {
+    return wgpu_create_texture(texture_client->wgpu_context, &texture_result,
+                               options);
+  }
+
+  return (texture_t){0};
+}
+
+texture_t wgpu_create_texture_array_from_image_data(
+  wgpu_context_t* wgpu_context, const image_data_t* const* images,
+  uint32_t image_count, struct wgpu_texture_load_options_t* options)
+{
+  ASSERT(images && image_count > 0);
+
+  if (wgpu_context->texture_client == NULL) {
+    wgpu_create_texture_client(wgpu_context);
+  }
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+
+  const int width             = images[0]->width;
+  const int height            = images[0]->height;
+  const bool generate_mipmaps = options ? options->generate_mipmaps : false;
+  const uint32_t mip_level_count
+    = generate_mipmaps ? calculate_mip_level_count(width, height) : 1u;
+
+  const WGPUTextureUsage usage
+    = (options && options->usage != WGPUTextureUsage_None) ?
+        options->usage :
+        WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding;
+  const WGPUTextureFormat format
+    = (options && options->format != WGPUTextureFormat_Undefined) ?
+        format_for_color_space(options->format, options->color_space) :
+        WGPUTextureFormat_RGBA8Unorm;
+
+  WGPUTextureDescriptor texture_desc = {
+    .usage     = usage,
+    .dimension = WGPUTextureDimension_2D,
+    .size      = (WGPUExtent3D){
+      .width              = width,
+      .height             = height,
+      .depthOrArrayLayers = image_count,
+    },
+    .format        = format,
+    .mipLevelCount = mip_level_count,
+    .sampleCount   = 1,
+  };
+  if (generate_mipmaps
+      && wgpu_mipmap_generator_supports_compute(texture_desc.format)) {
+    texture_desc.usage |= WGPUTextureUsage_StorageBinding;
+  }
+  WGPUTexture texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+
+  // Copy the pixel data of every image into its layer
+  for (uint32_t i = 0; i < image_count; ++i) {
+    const image_data_t* image_data = images[i];
+    ASSERT(image_data->pixels && image_data->channel_count == 4);
+    ASSERT(image_data->width == width && image_data->height == height);
+    texture_write_level(wgpu_context, texture, i, 0,
+                        &(texture_level_data_t){
+                          .data           = image_data->pixels,
+                          .size           = (uint64_t)width * height * 4,
+                          .bytes_per_row  = width * 4,
+                          .rows_per_image = height,
+                          .width          = width,
+                          .height         = height,
+                        });
+  }
+
+  if (generate_mipmaps) {
+    if (texture_client->wgpu_mipmap_generator == NULL) {
+      texture_client->wgpu_mipmap_generator
+        = wgpu_mipmap_generator_create(wgpu_context);
+    }
+    texture = wgpu_mipmap_generator_generate_mipmap(
+      texture_client->wgpu_mipmap_generator, texture, &texture_desc);
+  }
+
+  texture_result_t texture_result = {
+    .texture         = texture,
+    .width           = texture_desc.size.width,
+    .height          = texture_desc.size.height,
+    .depth           = texture_desc.size.depthOrArrayLayers,
+    .mip_level_count = texture_desc.mipLevelCount,
+    .format          = texture_desc.format,
+    .dimension       = texture_desc.dimension,
+    .array_view      = true,
+  };
+  return wgpu_create_texture(wgpu_context, &texture_result, options);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Texture cache
+ * -------------------------------------------------------------------------- */
+
+typedef struct texture_cache_entry_t {
+  char filename[STRMAX];
+  struct wgpu_texture_load_options_t options;
+  texture_t texture;
+  uint64_t size_in_bytes;
+  uint32_t ref_count;
+  uint64_t last_use; /* use counter value of the last acquire or release */
+} texture_cache_entry_t;
+
+struct wgpu_texture_cache {
+  texture_cache_entry_t* entries;
+  uint32_t entry_count;
+  uint32_t entry_capacity;
+  uint64_t resident_bytes;
+  uint64_t use_counter;
+};
+
+static struct wgpu_texture_cache*
+texture_cache_get(struct wgpu_texture_client_t* texture_client)
+{
+  if (texture_client->texture_cache == NULL) {
+    texture_client->texture_cache = (struct wgpu_texture_cache*)calloc(
+      1, sizeof(struct wgpu_texture_cache));
+  }
+  return texture_client->texture_cache;
+}
+
+static void texture_cache_destroy(struct wgpu_texture_client_t* texture_client)
+{
+  struct wgpu_texture_cache* cache = texture_client->texture_cache;
+  if (cache == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < cache->entry_count; ++i) {
+    wgpu_destroy_texture(&cache->entries[i].texture);
+  }
+  free(cache->entries);
+  free(cache);
+  texture_client->texture_cache = NULL;
+}
+
+static bool
+texture_load_options_equal(const struct wgpu_texture_load_options_t* a,
+                           const struct wgpu_texture_load_options_t* b)
+{
+  return a->flip_y == b->flip_y && a->generate_mipmaps == b->generate_mipmaps
+         && a->usage == b->usage && a->format == b->format
+         && a->address_mode == b->address_mode
+         && a->color_space == b->color_space
+         && a->stream_mips == b->stream_mips;
+}
+
+static texture_cache_entry_t*
+texture_cache_find(struct wgpu_texture_cache* cache, const char* filename,
+                   const struct wgpu_texture_load_options_t* options)
+{
+  const struct wgpu_texture_load_options_t default_options = {0};
+  options = options ? options : &default_options;
+  for (uint32_t i = 0; i < cache->entry_count; ++i) {
+    texture_cache_entry_t* entry = &cache->entries[i];
+    if (strcmp(entry->filename, filename) == 0
+        && texture_load_options_equal(&entry->options, options)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Evicts the least recently used unreferenced textures until the resident
+ * textures fit into the budget */
+static void texture_cache_evict(struct wgpu_texture_client_t* texture_client)
+{
+  struct wgpu_texture_cache* cache = texture_client->texture_cache;
+  const uint64_t budget            = texture_client->texture_budget;
+  while (budget > 0 && cache->resident_bytes > budget) {
+    texture_cache_entry_t* lru_entry = NULL;
+    for (uint32_t i = 0; i < cache->entry_count; ++i) {
+      texture_cache_entry_t* entry = &cache->entries[i];
+      if (entry->ref_count == 0
+          && (lru_entry == NULL || entry->last_use < lru_entry->last_use)) {
+        lru_entry = entry;
+      }
+    }
+    if (lru_entry == NULL) {
+      // All resident textures are in use
+      break;
+    }
+    wgpu_destroy_texture(&lru_entry->texture);
+    cache->resident_bytes -= lru_entry->size_in_bytes;
+    *lru_entry = cache->entries[--cache->entry_count];
+  }
+}
+
+static texture_t
+texture_cache_insert(struct wgpu_texture_client_t* texture_client,
+                     const char* filename,
+                     const struct wgpu_texture_load_options_t* options,
+                     texture_t texture)
+{
+  struct wgpu_texture_cache* cache = texture_cache_get(texture_client);
+  if (cache->entry_count == cache->entry_capacity) {
+    cache->entry_capacity
+      = cache->entry_capacity > 0 ? cache->entry_capacity * 2 : 16;
+    cache->entries = (texture_cache_entry_t*)realloc(
+      cache->entries, cache->entry_capacity * sizeof(texture_cache_entry_t));
+  }
+  const struct wgpu_texture_load_options_t default_options = {0};
+  texture_cache_entry_t* entry = &cache->entries[cache->entry_count++];
+  *entry                       = (texture_cache_entry_t){
+    .options       = options ? *options : default_options,
+    .texture       = texture,
+    .size_in_bytes = wgpu_texture_get_size_in_bytes(&texture),
+    .ref_count     = 1,
+    .last_use      = ++cache->use_counter,
+  };
+  snprintf(entry->filename, sizeof(entry->filename), "%s", filename);
+  cache->resident_bytes += entry->size_in_bytes;
+
+  texture_cache_evict(texture_client);
+  return texture;
+}
+
+static bool texture_cache_acquire(wgpu_context_t* wgpu_context,
+                                  const char* filename,
+                                  struct wgpu_texture_load_options_t* options,
+                                  texture_t* texture)
+{
+  if (wgpu_context->texture_client == NULL) {
+    wgpu_create_texture_client(wgpu_context);
+  }
+  struct wgpu_texture_cache* cache
+    = texture_cache_get(wgpu_context->texture_client);
+  texture_cache_entry_t* entry = texture_cache_find(cache, filename, options);
+  if (entry == NULL) {
+    return false;
+  }
+  entry->ref_count++;
+  entry->last_use = ++cache->use_counter;
+  *texture        = entry->texture;
+  return true;
+}
+
+uint64_t wgpu_texture_get_size_in_bytes(const texture_t* texture)
+{
+  uint32_t block_size = 1, block_bytes = 4;
+  texture_format_get_block_info(texture->format, &block_size, &block_bytes);
+  uint64_t size = 0;
+  for (uint32_t level = 0; level < texture->mip_level_count; ++level) {
+    const uint32_t width  = MAX(texture->size.width >> level, 1u);
+    const uint32_t height = MAX(texture->size.height >> level, 1u);
+    size += (uint64_t)((width + block_size - 1) / block_size)
+            * ((height + block_size - 1) / block_size) * block_bytes;
+  }
+  return size * MAX(texture->size.depth, 1u);
+}
+
+texture_t
+wgpu_acquire_texture_from_file(wgpu_context_t* wgpu_context,
+                               const char* filename,
+                               struct wgpu_texture_load_options_t* options)
+{
+  texture_t texture = {0};
+  if (texture_cache_acquire(wgpu_context, filename, options, &texture)) {
+    return texture;
+  }
+  texture = wgpu_create_texture_from_file(wgpu_context, filename, options);
+  if (texture.texture == NULL) {
+    return texture;
+  }
+  return texture_cache_insert(wgpu_context->texture_client, filename, options,
+                              texture);
+}
+
+texture_t wgpu_acquire_texture_from_image_data(
+  wgpu_context_t* wgpu_context, const char* filename,
+  const image_data_t* image_data, struct wgpu_texture_load_options_t* options)
+{
+  texture_t texture = {0};
+  if (texture_cache_acquire(wgpu_context, filename, options, &texture)) {
+    return texture;
+  }
+  texture
+    = wgpu_create_texture_from_image_data(wgpu_context, image_data, options);
+  if (texture.texture == NULL) {
+    return texture;
+  }
+  return texture_cache_insert(wgpu_context->texture_client, filename, options,
+                              texture);
+}
+
+bool wgpu_texture_is_resident(wgpu_context_t* wgpu_context,
+                              const char* filename,
+                              struct wgpu_texture_load_options_t* options)
+{
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  if (texture_client == NULL || texture_client->texture_cache == NULL) {
+    return false;
+  }
+  return texture_cache_find(texture_client->texture_cache, filename, options)
+         != NULL;
+}
+
+void wgpu_release_texture(wgpu_context_t* wgpu_context, texture_t* texture)
+{
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  struct wgpu_texture_cache* cache
+    = texture_client ? texture_client->texture_cache : NULL;
+  for (uint32_t i = 0; cache != NULL && i < cache->entry_count; ++i) {
+    texture_cache_entry_t* entry = &cache->entries[i];
+    if (entry->texture.texture == texture->texture) {
+      ASSERT(entry->ref_count > 0);
+      entry->ref_count--;
+      entry->last_use = ++cache->use_counter;
+      *texture        = (texture_t){0};
+      texture_cache_evict(texture_client);
+      return;
+    }
+  }
+  // Not a cached texture
+  wgpu_destroy_texture(texture);
+}
+
+void wgpu_texture_client_set_budget(
+  struct wgpu_texture_client_t* texture_client, uint64_t budget)
+{
+  texture_client->texture_budget = budget;
+  if (texture_client->texture_cache != NULL) {
+    texture_cache_evict(texture_client);
+  }
+}
+
+uint64_t wgpu_texture_client_get_resident_bytes(
+  struct wgpu_texture_client_t* texture_client)
+{
+  return texture_client->texture_cache ?
+           texture_client->texture_cache->resident_bytes :
+           0;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Baked texture files
+ * -------------------------------------------------------------------------- */
+
+#define TEXTURE_FILE_MAGIC 0x58544257u /* "WBTX" */
+#define TEXTURE_FILE_VERSION 1u
+
+/* Header of a baked texture file, followed by the tightly packed rows of each
+ * layer of each mip level */
+typedef struct texture_file_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t mip_level_count;
+  uint32_t reserved;
+} texture_file_header_t;
+
+/* Row layout of one mip level, for a tightly packed copy and for a copy
+ * between a buffer and the texture */
+typedef struct texture_file_level_t {
+  uint32_t width; /* copy size, a multiple of the block size */
+  uint32_t height;
+  uint32_t row_bytes;
+  uint32_t rows;
+  uint32_t padded_row_bytes;
+} texture_file_level_t;
+
+static texture_file_level_t texture_file_get_level(WGPUTextureFormat format,
+                                                   uint32_t width,
+                                                   uint32_t height,
+                                                   uint32_t level)
+{
+  uint32_t block_size = 1, block_bytes = 4;
+  texture_format_get_block_info(format, &block_size, &block_bytes);
+  const uint32_t blocks_x = (MAX(width >> level, 1u) + block_size - 1)
+                            / block_size;
+  const uint32_t blocks_y = (MAX(height >> level, 1u) + block_size - 1)
+                            / block_size;
+  return (texture_file_level_t){
+    .width            = blocks_x * block_size,
+    .height           = blocks_y * block_size,
+    .row_bytes        = blocks_x * block_bytes,
+    .rows             = blocks_y,
+    .padded_row_bytes = (uint32_t)make_multiple_of_256(
+      (int)(blocks_x * block_bytes)),
+  };
+}
+
+uint64_t wgpu_texture_file_key(const char* const* filenames,
+                               uint32_t file_count, const void* settings,
+                               size_t settings_size)
+{
+  uint64_t key = 0xcbf29ce484222325ull;
+  for (uint32_t i = 0; i < file_count; ++i) {
+    file_mapping_t file_mapping = {0};
+    if (file_map(filenames[i], &file_mapping) == 0
+        && file_mapping.data != NULL) {
+      key = basis_cache_hash(key, file_mapping.data, file_mapping.size);
+      file_unmap(&file_mapping);
+    }
+    else {
+      key = basis_cache_hash(key, filenames[i], strlen(filenames[i]));
+    }
+  }
+  if (settings != NULL) {
+    key = basis_cache_hash(key, settings, settings_size);
+  }
+  return key;
+}
+
+typedef struct texture_file_readback_t {
+  bool done;
+  WGPUBufferMapAsyncStatus status;
+} texture_file_readback_t;
+
+static void texture_file_map_callback(WGPUBufferMapAsyncStatus status,
+                                      void* user_data)
+{
+  texture_file_readback_t* readback = (texture_file_readback_t*)user_data;
+  readback->status                  = status;
+  readback->done                    = true;
+}
+
+bool wgpu_texture_save_to_baked_file(wgpu_context_t* wgpu_context,
+                                     const texture_t* texture,
+                                     const char* filename, uint64_t key)
+{
+  ASSERT(texture->texture != NULL);
+
+  const uint32_t depth = MAX(texture->size.depth, 1u);
+  const uint32_t level_count
+    = MIN(MAX(texture->mip_level_count, 1u), TEXTURE_STREAM_MAX_LEVELS);
+  texture_file_level_t levels[TEXTURE_STREAM_MAX_LEVELS];
+  uint64_t level_offsets[TEXTURE_STREAM_MAX_LEVELS];
+  uint64_t readback_size = 0;
+  for (uint32_t level = 0; level < level_count; ++level) {
+    levels[level] = texture_file_get_level(
+      texture->format, texture->size.width, texture->size.height, level);
+    level_offsets[level] = readback_size;
+    readback_size += (uint64_t)levels[level].padded_row_bytes
+                     * levels[level].rows * depth;
+  }
+
+  // Copy all mip levels and layers into a readback buffer
+  WGPUBuffer readback_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "texture_file_readback_buffer",
+      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+      .size  = readback_size,
+    });
+  ASSERT(readback_buffer != NULL);
+
+  WGPUCommandEncoder cmd_encoder
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t level = 0; level < level_count; ++level) {
+    wgpuCommandEncoderCopyTextureToBuffer(cmd_encoder,
+      &(WGPUImageCopyTexture) {
+        .texture  = texture->texture,
+        .mipLevel = level,
+        .origin   = (WGPUOrigin3D){0},
+        .aspect   = WGPUTextureAspect_All,
+      },
+      &(WGPUImageCopyBuffer) {
+        .buffer = readback_buffer,
+        .layout = (WGPUTextureDataLayout) {
+          .offset       = level_offsets[level],
+          .bytesPerRow  = levels[level].padded_row_bytes,
+          .rowsPerImage = levels[level].rows,
+        },
+      },
+      &(WGPUExtent3D) {
+        .width              = levels[level].width,
+        .height             = levels[level].height,
+        .depthOrArrayLayers = depth,
+      });
+  }
+  WGPUCommandBuffer command_buffer
+    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+
+  // Wait for the readback, this only happens when the file is baked
+  texture_file_readback_t readback = {0};
+  wgpuBufferMapAsync(readback_buffer, WGPUMapMode_Read, 0, readback_size,
+                     texture_file_map_callback, &readback);
+  while (!readback.done) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+  if (readback.status != WGPUBufferMapAsyncStatus_Success) {
+    log_warn("Unable to read back texture for %s", filename);
+    WGPU_RELEASE_RESOURCE(Buffer, readback_buffer)
+    return false;
+  }
+  const uint8_t* mapped_data = (const uint8_t*)wgpuBufferGetConstMappedRange(
+    readback_buffer, 0, readback_size);
+
+  bool written = false;
+  FILE* file   = fopen(filename, "wb");
+  if (file != NULL) {
+    texture_file_header_t header = {
+      .magic           = TEXTURE_FILE_MAGIC,
+      .version         = TEXTURE_FILE_VERSION,
+      .key             = key,
+      .format          = (uint32_t)texture->format,
+      .width           = texture->size.width,
+      .height          = texture->size.height,
+      .depth           = depth,
+      .mip_level_count = level_count,
+    };
+    written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t level = 0; written && level < level_count; ++level) {
+      const texture_file_level_t* l = &levels[level];
+      for (uint32_t row = 0; written && row < l->rows * depth; ++row) {
+        written = fwrite(mapped_data + level_offsets[level]
+                           + (uint64_t)row * l->padded_row_bytes,
+                         l->row_bytes, 1, file)
+                  == 1;
+      }
+    }
+    fclose(file);
+    if (!written) {
+      remove(filename);
+    }
+  }
+  wgpuBufferUnmap(readback_buffer);
+  WGPU_RELEASE_RESOURCE(Buffer, readback_buffer)
+
+  if (!written) {
+    log_warn("Unable to write texture file %s", filename);
+  }
+  return written;
+}
+
+texture_t
+wgpu_texture_load_from_baked_file(wgpu_context_t* wgpu_context,
+                                  const char* filename, uint64_t key,
+                                  struct wgpu_texture_load_options_t* options)
+{
+  file_mapping_t file_mapping = {0};
+  if (file_map(filename, &file_mapping) != 0) {
+    return (texture_t){0};
+  }
+
+  texture_file_header_t header = {0};
+  bool valid                   = file_mapping.size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, file_mapping.data, sizeof(header));
+    valid = header.magic == TEXTURE_FILE_MAGIC
+            && header.version == TEXTURE_FILE_VERSION && header.key == key
+            && header.width > 0 && header.height > 0 && header.depth > 0
+            && header.mip_level_count > 0
+            && header.mip_level_count <= TEXTURE_STREAM_MAX_LEVELS;
+  }
+
+  // Validate the payload size before creating the texture
+  const WGPUTextureFormat format = (WGPUTextureFormat)header.format;
+  uint64_t payload_size          = 0;
+  for (uint32_t level = 0; valid && level < header.mip_level_count; ++level) {
+    const texture_file_level_t l
+      = texture_file_get_level(format, header.width, header.height, level);
+    payload_size += (uint64_t)l.row_bytes * l.rows * header.depth;
+  }
+  valid = valid && sizeof(header) + payload_size <= file_mapping.size;
+  if (!valid) {
+    log_debug("Ignoring outdated texture file %s", filename);
+    file_unmap(&file_mapping);
+    return (texture_t){0};
+  }
+
+  WGPUTexture texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = filename,
+      .size  = (WGPUExtent3D){
+        .width              = header.width,
+        .height             = header.height,
+        .depthOrArrayLayers = header.depth,
+      },
+      .mipLevelCount = header.mip_level_count,
+      .sampleCount   = 1,
+      .dimension     = WGPUTextureDimension_2D,
+      .format        = format,
+      .usage         = WGPUTextureUsage_CopyDst | WGPUTextureUsage_CopySrc
+               | WGPUTextureUsage_TextureBinding,
+    });
+  ASSERT(texture != NULL);
+
+  const uint8_t* data = file_mapping.data + sizeof(header);
+  for (uint32_t level = 0; level < header.mip_level_count; ++level) {
+    const texture_file_level_t l
+      = texture_file_get_level(format, header.width, header.height, level);
+    const uint64_t layer_size = (uint64_t)l.row_bytes * l.rows;
+    for (uint32_t layer = 0; layer < header.depth; ++layer) {
+      texture_write_level(wgpu_context, texture, layer, level,
+                          &(texture_level_data_t){
+                            .data           = data,
+                            .size           = layer_size,
+                            .bytes_per_row  = l.row_bytes,
+                            .rows_per_image = l.rows,
+                            .width          = l.width,
+                            .height         = l.height,
+                          });
+      data += layer_size;
+    }
+  }
+  file_unmap(&file_mapping);
+
+  texture_result_t texture_result = {
+    .texture         = texture,
+    .width           = header.width,
+    .height          = header.height,
+    .depth           = header.depth,
+    .mip_level_count = header.mip_level_count,
+    .format          = format,
+    .dimension       = WGPUTextureDimension_2D,
+  };
+  return wgpu_create_texture(wgpu_context, &texture_result, options);
+}
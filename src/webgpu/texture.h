@@ -16,6 +16,7 @@ typedef struct texture_t {
     uint32_t depth;
   } size;
   uint32_t mip_level_count;
+  uint32_t resident_mip_level; /* first mip level of the view */
   WGPUTextureFormat format;
   WGPUTextureDimension dimension;
   WGPUTexture texture;
@@ -41,6 +42,20 @@ void wgpu_destroy_texture(texture_t* texture);
 /* Mip map generator */
 typedef struct wgpu_mipmap_generator wgpu_mipmap_generator_t;
 
+/* Ways of generating the mip chain of a texture, see mipmap_tuner.h for the
+ * fastest method of the adapter */
+typedef enum wgpu_mipmap_method_enum_t {
+  /* Compute if the format and usage allow it, otherwise render */
+  WGPU_MipmapMethod_Auto = 0,
+  /* One render pass per level, each level sampled from the previous one */
+  WGPU_MipmapMethod_Render = 1,
+  /* Up to 6 levels per dispatch, the texture needs the storage usage */
+  WGPU_MipmapMethod_Compute = 2,
+  /* Box filter of RGBA8 pixels on the CPU, all levels are uploaded */
+  WGPU_MipmapMethod_CPU   = 3,
+  WGPU_MipmapMethod_Count = 4,
+} wgpu_mipmap_method_enum_t;
+
 /* Mip map generator construction / destruction */
 wgpu_mipmap_generator_t*
 wgpu_mipmap_generator_create(wgpu_context_t* wgpu_context);
@@ -50,6 +65,10 @@ void wgpu_mipmap_generator_destroy(wgpu_mipmap_generator_t* mipmap_generator);
 WGPURenderPipeline wgpu_mipmap_generator_get_mipmap_pipeline(
   wgpu_mipmap_generator_t* mipmap_generator, WGPUTextureFormat format);
 
+/* Returns true if mipmaps of the format can be generated with compute, the
+ * texture must also be created with WGPUTextureUsage_StorageBinding */
+bool wgpu_mipmap_generator_supports_compute(WGPUTextureFormat format);
+
 /**
  * @brief Generates mipmaps for the given GPUTexture from the data in level 0.
  *
@@ -64,6 +83,74 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
                                       WGPUTexture texture,
                                       WGPUTextureDescriptor* texture_desc);
 
+/* Returns true if the method can generate the mip chain of a 2D texture of
+ * the descriptor, the usage is not checked */
+bool wgpu_mipmap_method_supports(wgpu_mipmap_method_enum_t method,
+                                 const WGPUTextureDescriptor* texture_desc);
+const char* wgpu_mipmap_method_get_name(wgpu_mipmap_method_enum_t method);
+
+/**
+ * @brief Records the generation of the mip chain from level 0 with a render or
+ * compute method into the command encoder. The command encoder keeps the
+ * temporary resources alive.
+ * @return false if the method does not support the texture
+ */
+bool wgpu_mipmap_generator_encode_mipmap(
+  wgpu_mipmap_generator_t* mipmap_generator, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc,
+  wgpu_mipmap_method_enum_t method);
+
+/**
+ * @brief Generates the mip chain of tightly packed 4 channel 8-bit pixels on
+ * the CPU, sRGB formats are averaged in linear space, and records the upload
+ * of all levels including level 0 from a staging buffer.
+ * @return false if the texture is not a single layer RGBA8 / BGRA8 texture
+ */
+bool wgpu_mipmap_generator_encode_cpu_mipmap(
+  wgpu_context_t* wgpu_context, WGPUCommandEncoder cmd_encoder,
+  WGPUTexture texture, const WGPUTextureDescriptor* texture_desc,
+  const uint8_t* pixels);
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU YUV Converter
+ *
+ * Converts planar YUV 4:2:0 frames, e.g. the native output of video decoders,
+ * into an RGBA8Unorm texture on the GPU. The planes are uploaded into R8 / RG8
+ * textures and converted with a compute shader.
+ * -------------------------------------------------------------------------- */
+
+typedef enum wgpu_yuv_format_enum_t {
+  WGPU_YUV_Format_I420 = 0, /* Y plane, U plane and V plane */
+  WGPU_YUV_Format_NV12 = 1, /* Y plane and interleaved UV plane */
+} wgpu_yuv_format_enum_t;
+
+typedef struct wgpu_yuv_converter_desc_t {
+  wgpu_yuv_format_enum_t format;
+  uint32_t width;
+  uint32_t height;
+  bool bt709;      /* BT.709 instead of BT.601 color matrix */
+  bool full_range; /* full instead of video range */
+  /* RGBA8Unorm destination texture with at least the frame size, created
+   * with WGPUTextureUsage_StorageBinding */
+  WGPUTexture texture;
+} wgpu_yuv_converter_desc_t;
+
+typedef struct wgpu_yuv_converter wgpu_yuv_converter_t;
+
+/* YUV converter construction / destruction */
+wgpu_yuv_converter_t*
+wgpu_yuv_converter_create(wgpu_context_t* wgpu_context,
+                          const wgpu_yuv_converter_desc_t* desc);
+void wgpu_yuv_converter_destroy(wgpu_yuv_converter_t* yuv_converter);
+
+/**
+ * @brief Uploads the planes of a frame and submits the conversion into the
+ * destination texture. The planes are tightly packed, the Y plane is followed
+ * by the chroma planes of half width and height (rounded up).
+ */
+void wgpu_yuv_converter_convert(wgpu_yuv_converter_t* yuv_converter,
+                                const void* planes);
+
 /* -------------------------------------------------------------------------- *
  * WebGPU Texture Client
  * -------------------------------------------------------------------------- */
@@ -71,15 +158,38 @@ wgpu_mipmap_generator_generate_mipmap(wgpu_mipmap_generator_t* mipmap_generator,
 typedef struct wgpu_texture_client_t {
   wgpu_context_t* wgpu_context;
   wgpu_mipmap_generator_t* wgpu_mipmap_generator;
+  // Mip map generation method of loaded textures, Auto = the fastest method
+  // of the adapter, see wgpu_tune_mipmap_method()
+  wgpu_mipmap_method_enum_t mipmap_method;
   bool allow_compressed_formats;
+  // Texture compression features of the device
+  struct {
+    bool bc;
+    bool etc2;
+    bool astc;
+  } texture_compression;
   struct {
     WGPUTextureFormat values[4];
     size_t count;
   } uncompressed_format_list;
+  // Formats Basis Universal textures can be transcoded to, uncompressed
+  // formats first
   struct {
-    WGPUTextureFormat values[12];
+    WGPUTextureFormat values[18];
     size_t count;
   } supported_format_list;
+  // Directory of the Basis Universal transcoding cache, the cache files are
+  // written next to the .basis files when NULL
+  const char* transcode_cache_dir;
+  // Shared textures, see wgpu_acquire_texture_from_file()
+  struct wgpu_texture_cache* texture_cache;
+  // Size of the resident shared textures in bytes before unreferenced
+  // textures are evicted, 0 = unlimited
+  uint64_t texture_budget;
+  // Textures with mip levels waiting for upload
+  struct wgpu_texture_stream* texture_stream;
+  // Upload size of streamed mip levels per frame, 0 = default (8 MiB)
+  uint64_t stream_bytes_per_frame;
 } wgpu_texture_client;
 
 typedef struct wgpu_texture_load_options_t {
@@ -89,6 +199,9 @@ typedef struct wgpu_texture_load_options_t {
   WGPUTextureFormat format;
   WGPUAddressMode address_mode;
   color_space_enum_t color_space;
+  // Upload the tail mip levels of ktx / basis textures right away and stream
+  // the larger levels, see wgpu_texture_client_stream_mips()
+  bool stream_mips;
 } wgpu_texture_load_options;
 
 /* Texture client construction / destruction */
@@ -131,4 +244,108 @@ texture_t wgpu_create_texture_cubemap_from_files(
 /* Texture creation with dimension 1x1 */
 texture_t wgpu_create_empty_texture(wgpu_context_t* wgpu_context);
 
+/* Size of the texture including all mip levels and array layers */
+uint64_t wgpu_texture_get_size_in_bytes(const texture_t* texture);
+
+/* -------------------------------------------------------------------------- *
+ * Image decoding
+ *
+ * Decodes an image into memory without using the WebGPU device, these
+ * functions can be called from worker threads. The texture is then created
+ * from the decoded image on the main thread.
+ * -------------------------------------------------------------------------- */
+
+typedef struct image_data_t {
+  int32_t width;
+  int32_t height;
+  int32_t channel_count;
+  uint8_t* pixels; /* NULL if decoding failed */
+} image_data_t;
+
+/* Image decoding / releasing, return false if the image could not be decoded */
+bool wgpu_image_data_load_from_file(const char* filename, bool flip_y,
+                                    image_data_t* image_data);
+bool wgpu_image_data_load_from_memory(const void* data, size_t data_size,
+                                      bool flip_y, image_data_t* image_data);
+void wgpu_image_data_release(image_data_t* image_data);
+
+/* Texture creation from a decoded image */
+texture_t wgpu_create_texture_from_image_data(
+  wgpu_context_t* wgpu_context, const image_data_t* image_data,
+  struct wgpu_texture_load_options_t* options);
+/* Texture array creation from decoded images of the same size with 4 channels,
+ * image i is uploaded into layer i. The view is a 2D array view, also for a
+ * single or 6 layers. */
+texture_t wgpu_create_texture_array_from_image_data(
+  wgpu_context_t* wgpu_context, const image_data_t* const* images,
+  uint32_t image_count, struct wgpu_texture_load_options_t* options);
+
+/* -------------------------------------------------------------------------- *
+ * Shared textures
+ *
+ * Textures acquired through the texture client are deduplicated by path and
+ * load options and reference counted. Released textures stay resident until
+ * the texture budget is exceeded, then the least recently used unreferenced
+ * textures are evicted. Shared textures are released with
+ * wgpu_release_texture(), never with wgpu_destroy_texture().
+ * -------------------------------------------------------------------------- */
+
+texture_t
+wgpu_acquire_texture_from_file(wgpu_context_t* wgpu_context,
+                               const char* filename,
+                               struct wgpu_texture_load_options_t* options);
+/* The filename identifies the decoded image in the cache */
+texture_t wgpu_acquire_texture_from_image_data(
+  wgpu_context_t* wgpu_context, const char* filename,
+  const image_data_t* image_data, struct wgpu_texture_load_options_t* options);
+bool wgpu_texture_is_resident(wgpu_context_t* wgpu_context,
+                              const char* filename,
+                              struct wgpu_texture_load_options_t* options);
+/* Releases a shared texture, other textures are destroyed */
+void wgpu_release_texture(wgpu_context_t* wgpu_context, texture_t* texture);
+
+void wgpu_texture_client_set_budget(
+  struct wgpu_texture_client_t* texture_client, uint64_t budget);
+uint64_t wgpu_texture_client_get_resident_bytes(
+  struct wgpu_texture_client_t* texture_client);
+
+/* -------------------------------------------------------------------------- *
+ * Mip level streaming
+ *
+ * Textures loaded with the stream_mips option start with their tail mip
+ * levels, the view of the texture is limited to the resident levels. The
+ * larger levels are uploaded over the next frames.
+ * -------------------------------------------------------------------------- */
+
+/* Uploads the streamed mip levels that are ready, called once per frame */
+void wgpu_texture_client_stream_mips(
+  struct wgpu_texture_client_t* texture_client);
+/* Recreates the view of the texture when more mip levels became resident,
+ * returns true if the view changed and bind groups need to be recreated */
+bool wgpu_texture_update_mip_residency(wgpu_context_t* wgpu_context,
+                                       texture_t* texture);
+
+/* -------------------------------------------------------------------------- *
+ * Baked texture files
+ *
+ * Textures generated on the GPU can be read back once and saved to a file,
+ * later runs load the file instead of generating the texture again. The key
+ * identifies the inputs of the generation, files with another key are ignored.
+ * -------------------------------------------------------------------------- */
+
+/* Hashes the contents of the source files and the generation settings */
+uint64_t wgpu_texture_file_key(const char* const* filenames,
+                               uint32_t file_count, const void* settings,
+                               size_t settings_size);
+/* Reads back all mip levels and layers of the texture, the texture needs the
+ * CopySrc usage. Blocks until the GPU copy is done. */
+bool wgpu_texture_save_to_baked_file(wgpu_context_t* wgpu_context,
+                                     const texture_t* texture,
+                                     const char* filename, uint64_t key);
+/* Returns an empty texture if the file is missing or has another key */
+texture_t
+wgpu_texture_load_from_baked_file(wgpu_context_t* wgpu_context,
+                                  const char* filename, uint64_t key,
+                                  struct wgpu_texture_load_options_t* options);
+
 #endif /* TEXTURE_H */
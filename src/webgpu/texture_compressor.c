@@ -0,0 +1,722 @@
+#include "texture_compressor.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "pipeline_cache.h"
+#include "readback.h"
+#include "sampler_cache.h"
+#include "shader.h"
+#include "upload_batch.h"
+
+/* Blocks per workgroup in x and y */
+#define TEXTURE_COMPRESSOR_WORKGROUP_SIZE 8u
+/* Squared error (low, high word) and error samples (low, high word) */
+#define TEXTURE_COMPRESSOR_ERROR_BUFFER_SIZE (4u * sizeof(uint32_t))
+/* PSNR of an encoding without error */
+#define TEXTURE_COMPRESSOR_MAX_PSNR 99.0f
+
+static const struct {
+  WGPUTextureFormat format;
+  WGPUTextureFormat srgb_format;
+  const char* name;
+  uint32_t block_size;
+} texture_compression_formats[WGPU_TextureCompression_Count] = {
+  [WGPU_TextureCompression_BC1] = {WGPUTextureFormat_BC1RGBAUnorm,
+                                   WGPUTextureFormat_BC1RGBAUnormSrgb, "BC1",
+                                   8u},
+  [WGPU_TextureCompression_BC4] = {WGPUTextureFormat_BC4RUnorm,
+                                   WGPUTextureFormat_BC4RUnorm, "BC4", 8u},
+  [WGPU_TextureCompression_BC5] = {WGPUTextureFormat_BC5RGUnorm,
+                                   WGPUTextureFormat_BC5RGUnorm, "BC5", 16u},
+  [WGPU_TextureCompression_BC7] = {WGPUTextureFormat_BC7RGBAUnorm,
+                                   WGPUTextureFormat_BC7RGBAUnormSrgb, "BC7",
+                                   16u},
+};
+
+// clang-format off
+static const char* texture_compressor_shader_wgsl = CODE(
+  // 0 = BC1, 1 = BC4, 2 = BC5, 3 = BC7
+  override compression : u32 = 3u;
+  // The source is linear, the blocks are sRGB encoded
+  override srgb : bool = false;
+
+  @group(0) @binding(0) var source : texture_2d<f32>;
+  // Rows of blocks, 256 bytes aligned for the buffer to texture copy
+  @group(0) @binding(1) var<storage, read_write> blocks : array<u32>;
+  // Squared error and samples, 64-bit as low and high words
+  @group(0) @binding(2) var<storage, read_write> error_sums : array<atomic<u32>, 4>;
+
+  var<private> texels : array<vec4<f32>, 16>;
+  var<private> block : array<u32, 4>;
+  var<private> block_error : f32;
+  var<private> bc7_weights : array<u32, 16> = array<u32, 16>(
+    0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u, 34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u);
+
+  fn put_bits(position : u32, count : u32, value : u32) {
+    let word  = position / 32u;
+    let shift = position % 32u;
+    block[word] = block[word] | (value << shift);
+    if (shift + count > 32u) {
+      block[word + 1u] = block[word + 1u] | (value >> (32u - shift));
+    }
+  }
+
+  fn linear_to_srgb(color : vec3<f32>) -> vec3<f32> {
+    let low  = color * 12.92;
+    let high = 1.055 * pow(color, vec3<f32>(1.0 / 2.4)) - 0.055;
+    return select(high, low, color <= vec3<f32>(0.0031308));
+  }
+
+  // Texels of the block in 0..255, the edge texels repeat beyond the image
+  fn load_texels(block_coord : vec2<u32>) {
+    let size = vec2<u32>(textureDimensions(source, 0));
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      let coord = min(block_coord * 4u + vec2<u32>(i % 4u, i / 4u),
+                      size - vec2<u32>(1u));
+      var color = clamp(textureLoad(source, vec2<i32>(coord), 0),
+                        vec4<f32>(0.0), vec4<f32>(1.0));
+      if (srgb) {
+        color = vec4<f32>(linear_to_srgb(color.rgb), color.a);
+      }
+      texels[i] = round(color * 255.0);
+    }
+  }
+
+  fn pack_565(color : vec3<f32>) -> u32 {
+    let q = vec3<u32>(round(clamp(color, vec3<f32>(0.0), vec3<f32>(255.0))
+                            * vec3<f32>(31.0, 63.0, 31.0) / 255.0));
+    return (q.r << 11u) | (q.g << 5u) | q.b;
+  }
+
+  fn unpack_565(value : u32) -> vec3<f32> {
+    let r = (value >> 11u) & 31u;
+    let g = (value >> 5u) & 63u;
+    let b = value & 31u;
+    return vec3<f32>(f32((r << 3u) | (r >> 2u)), f32((g << 2u) | (g >> 4u)),
+                     f32((b << 3u) | (b >> 2u)));
+  }
+
+  // Endpoints of the bounding box inset by 1/16 of its size, four colors
+  fn encode_bc1() {
+    var low  = vec3<f32>(255.0);
+    var high = vec3<f32>(0.0);
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      low  = min(low, texels[i].rgb);
+      high = max(high, texels[i].rgb);
+    }
+    let inset = (high - low) / 16.0;
+    var c0 = pack_565(high - inset);
+    var c1 = pack_565(low + inset);
+    // c0 > c1 selects the four color mode
+    if (c0 < c1) {
+      let c = c0;
+      c0 = c1;
+      c1 = c;
+    }
+    put_bits(0u, 16u, c0);
+    put_bits(16u, 16u, c1);
+
+    var palette : array<vec3<f32>, 4>;
+    palette[0] = unpack_565(c0);
+    palette[1] = unpack_565(c1);
+    palette[2] = (2.0 * palette[0] + palette[1]) / 3.0;
+    palette[3] = (palette[0] + 2.0 * palette[1]) / 3.0;
+    // Equal endpoints are the three color mode, index 0 is the color
+    let color_count = select(4u, 1u, c0 == c1);
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      var best_index = 0u;
+      var best_error = 1e30;
+      for (var k = 0u; k < color_count; k = k + 1u) {
+        let d = palette[k] - texels[i].rgb;
+        if (dot(d, d) < best_error) {
+          best_error = dot(d, d);
+          best_index = k;
+        }
+      }
+      put_bits(32u + 2u * i, 2u, best_index);
+      block_error = block_error + best_error;
+    }
+  }
+
+  fn bc4_value(e0 : f32, e1 : f32, index : u32) -> f32 {
+    if (index < 2u) {
+      return select(e1, e0, index == 0u);
+    }
+    return (f32(8u - index) * e0 + f32(index - 1u) * e1) / 7.0;
+  }
+
+  // Minimum and maximum as endpoints, e0 > e1 selects eight values
+  fn encode_bc4(channel : u32, position : u32) {
+    var low  = 255.0;
+    var high = 0.0;
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      low  = min(low, texels[i][channel]);
+      high = max(high, texels[i][channel]);
+    }
+    put_bits(position, 8u, u32(high));
+    put_bits(position + 8u, 8u, u32(low));
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      var best_index = 0u;
+      var best_error = 1e30;
+      for (var k = 0u; k < 8u; k = k + 1u) {
+        let d = bc4_value(high, low, k) - texels[i][channel];
+        if (d * d < best_error) {
+          best_error = d * d;
+          best_index = k;
+        }
+      }
+      put_bits(position + 16u + 3u * i, 3u, best_index);
+      block_error = block_error + best_error;
+    }
+  }
+
+  // 7-bit endpoint with the p-bit closer to the color, as 8-bit values
+  fn bc7_quantize(color : vec4<f32>) -> vec4<u32> {
+    var best       = vec4<u32>(0u);
+    var best_error = 1e30;
+    for (var p = 0u; p < 2u; p = p + 1u) {
+      let q = vec4<u32>(clamp(round((color - f32(p)) / 2.0), vec4<f32>(0.0),
+                              vec4<f32>(127.0)));
+      let value = q * 2u + vec4<u32>(p);
+      let d     = vec4<f32>(value) - color;
+      if (dot(d, d) < best_error) {
+        best_error = dot(d, d);
+        best       = value;
+      }
+    }
+    return best;
+  }
+
+  // Mode 6: one subset, RGBA endpoints of 7 bits and a p-bit, 4-bit indices
+  fn encode_bc7() {
+    var low  = vec4<f32>(255.0);
+    var high = vec4<f32>(0.0);
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      low  = min(low, texels[i]);
+      high = max(high, texels[i]);
+    }
+    let inset = (high - low) / 32.0;
+    var e0 = bc7_quantize(low + inset);
+    var e1 = bc7_quantize(high - inset);
+
+    var palette : array<vec4<f32>, 16>;
+    for (var k = 0u; k < 16u; k = k + 1u) {
+      let w = vec4<u32>(bc7_weights[k]);
+      palette[k] = vec4<f32>(((vec4<u32>(64u) - w) * e0 + w * e1
+                              + vec4<u32>(32u)) >> vec4<u32>(6u));
+    }
+    var indices : array<u32, 16>;
+    for (var i = 0u; i < 16u; i = i + 1u) {
+      var best_error = 1e30;
+      for (var k = 0u; k < 16u; k = k + 1u) {
+        let d = palette[k] - texels[i];
+        if (dot(d, d) < best_error) {
+          best_error = dot(d, d);
+          indices[i] = k;
+        }
+      }
+      block_error = block_error + best_error;
+    }
+    // The most significant bit of the first index is implied 0
+    if (indices[0] >= 8u) {
+      let e = e0;
+      e0 = e1;
+      e1 = e;
+      for (var i = 0u; i < 16u; i = i + 1u) {
+        indices[i] = 15u - indices[i];
+      }
+    }
+
+    put_bits(0u, 7u, 64u);
+    for (var c = 0u; c < 4u; c = c + 1u) {
+      put_bits(7u + 14u * c, 7u, e0[c] >> 1u);
+      put_bits(14u + 14u * c, 7u, e1[c] >> 1u);
+    }
+    put_bits(63u, 1u, e0.x & 1u);
+    put_bits(64u, 1u, e1.x & 1u);
+    put_bits(65u, 3u, indices[0]);
+    for (var i = 1u; i < 16u; i = i + 1u) {
+      put_bits(64u + 4u * i, 4u, indices[i]);
+    }
+  }
+
+  fn add_error(index : u32, value : u32) {
+    let previous = atomicAdd(&error_sums[index], value);
+    if (previous + value < previous) {
+      atomicAdd(&error_sums[index + 1u], 1u);
+    }
+  }
+
+  @compute @workgroup_size(8, 8)
+  fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+    let block_count = (vec2<u32>(textureDimensions(source, 0)) + vec2<u32>(3u))
+                      / 4u;
+    if (any(id.xy >= block_count)) {
+      return;
+    }
+    load_texels(id.xy);
+
+    var words    = 4u;
+    var channels = 4u;
+    switch (compression) {
+      case 0u: {
+        encode_bc1();
+        words    = 2u;
+        channels = 3u;
+      }
+      case 1u: {
+        encode_bc4(0u, 0u);
+        words    = 2u;
+        channels = 1u;
+      }
+      case 2u: {
+        encode_bc4(0u, 0u);
+        encode_bc4(1u, 64u);
+        channels = 2u;
+      }
+      default: {
+        encode_bc7();
+      }
+    }
+
+    let row_words = (block_count.x * words * 4u + 255u) / 256u * 64u;
+    let offset    = id.y * row_words + id.x * words;
+    for (var w = 0u; w < words; w = w + 1u) {
+      blocks[offset + w] = block[w];
+    }
+    add_error(0u, u32(round(block_error)));
+    add_error(2u, 16u * channels);
+  }
+);
+// clang-format on
+
+/**
+ * @brief Texture compressor class
+ */
+struct wgpu_texture_compressor {
+  wgpu_context_t* wgpu_context;
+  /* Pipelines of the compressions, linear and sRGB, created on first use */
+  WGPUComputePipeline pipelines[WGPU_TextureCompression_Count][2];
+  /* Encoded blocks, reused by every encoding */
+  WGPUBuffer block_buffer;
+  uint64_t block_buffer_size;
+  WGPUBuffer error_buffer;
+  bool readback_pending;
+  wgpu_texture_compressor_stats_t stats;
+};
+
+/* Texture compressor creating / destroying */
+
+wgpu_texture_compressor_t*
+wgpu_texture_compressor_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_texture_compressor_t* compressor
+    = (wgpu_texture_compressor_t*)malloc(sizeof(*compressor));
+  memset(compressor, 0, sizeof(*compressor));
+  compressor->wgpu_context = wgpu_context;
+
+  compressor->error_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "texture_compressor_error_buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc
+               | WGPUBufferUsage_CopyDst,
+      .size  = TEXTURE_COMPRESSOR_ERROR_BUFFER_SIZE,
+    });
+  ASSERT(compressor->error_buffer != NULL);
+
+  return compressor;
+}
+
+void wgpu_texture_compressor_destroy(wgpu_texture_compressor_t* compressor)
+{
+  if (compressor == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < (uint32_t)WGPU_TextureCompression_Count; ++i) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, compressor->pipelines[i][0])
+    WGPU_RELEASE_RESOURCE(ComputePipeline, compressor->pipelines[i][1])
+  }
+  WGPU_RELEASE_RESOURCE(Buffer, compressor->block_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, compressor->error_buffer)
+  free(compressor);
+}
+
+bool wgpu_texture_compressor_is_supported(wgpu_context_t* wgpu_context)
+{
+  return wgpu_has_feature(wgpu_context, WGPUFeatureName_TextureCompressionBC);
+}
+
+/* Formats */
+
+WGPUTextureFormat
+wgpu_texture_compression_get_format(wgpu_texture_compression_enum_t compression,
+                                    bool srgb)
+{
+  ASSERT(compression < WGPU_TextureCompression_Count);
+  return srgb ? texture_compression_formats[compression].srgb_format :
+                texture_compression_formats[compression].format;
+}
+
+const char*
+wgpu_texture_compression_get_name(wgpu_texture_compression_enum_t compression)
+{
+  ASSERT(compression < WGPU_TextureCompression_Count);
+  return texture_compression_formats[compression].name;
+}
+
+uint32_t wgpu_texture_compression_get_block_size(
+  wgpu_texture_compression_enum_t compression)
+{
+  ASSERT(compression < WGPU_TextureCompression_Count);
+  return texture_compression_formats[compression].block_size;
+}
+
+/* Compression and sRGB encoding of a compressed format, false if the format
+ * is not one of the compressor */
+static bool texture_compressor_find_format(
+  WGPUTextureFormat format, wgpu_texture_compression_enum_t* compression,
+  bool* srgb)
+{
+  for (uint32_t i = 0; i < (uint32_t)WGPU_TextureCompression_Count; ++i) {
+    if (texture_compression_formats[i].format == format
+        || texture_compression_formats[i].srgb_format == format) {
+      *compression = (wgpu_texture_compression_enum_t)i;
+      *srgb        = texture_compression_formats[i].format != format;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Encoding */
+
+static WGPUComputePipeline
+texture_compressor_get_pipeline(wgpu_texture_compressor_t* this,
+                                wgpu_texture_compression_enum_t compression,
+                                bool srgb)
+{
+  WGPUComputePipeline* pipeline = &this->pipelines[compression][srgb];
+  if (*pipeline != NULL) {
+    return *pipeline;
+  }
+
+  // The compression is specialized with pipeline constants
+  WGPUConstantEntry constants[2] = {
+    [0] = (WGPUConstantEntry){
+      .key   = "compression",
+      .value = (double)compression,
+    },
+    [1] = (WGPUConstantEntry){
+      .key   = "srgb",
+      .value = srgb ? 1.0 : 0.0,
+    },
+  };
+  wgpu_shader_t compressor_shader = wgpu_shader_create(
+    this->wgpu_context, &(wgpu_shader_desc_t){
+                          // Compute shader WGSL
+                          .wgsl_code.source = texture_compressor_shader_wgsl,
+                          .entry            = "main",
+                          .constants        = {
+                            .count   = (uint32_t)ARRAY_SIZE(constants),
+                            .entries = constants,
+                          },
+                        });
+  *pipeline = wgpu_create_compute_pipeline(
+    this->wgpu_context,
+    &(WGPUComputePipelineDescriptor){
+      .label   = "texture_compressor_compute_pipeline",
+      .compute = compressor_shader.programmable_stage_descriptor,
+    });
+  ASSERT(*pipeline != NULL);
+  wgpu_shader_release(&compressor_shader);
+
+  return *pipeline;
+}
+
+static void texture_compressor_reserve(wgpu_texture_compressor_t* this,
+                                       uint64_t size)
+{
+  if (this->block_buffer_size >= size) {
+    return;
+  }
+
+  // Recorded encodings keep the previous buffer alive until their submit
+  WGPU_RELEASE_RESOURCE(Buffer, this->block_buffer)
+  this->block_buffer_size = size;
+  this->block_buffer      = wgpuDeviceCreateBuffer(
+    this->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "texture_compressor_block_buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc,
+      .size  = size,
+    });
+  ASSERT(this->block_buffer != NULL);
+}
+
+static void texture_compressor_on_error_read(const void* data, uint64_t size,
+                                             void* user_data)
+{
+  UNUSED_VAR(size);
+
+  wgpu_texture_compressor_t* compressor
+    = (wgpu_texture_compressor_t*)user_data;
+  compressor->readback_pending = false;
+  if (data == NULL) {
+    return;
+  }
+
+  const uint32_t* error = (const uint32_t*)data;
+  const double squared_error
+    = (double)error[0] + (double)error[1] * 4294967296.0;
+  const double samples = (double)error[2] + (double)error[3] * 4294967296.0;
+  if (samples <= 0.0) {
+    return;
+  }
+  const double mse = squared_error / samples;
+  compressor->stats.psnr
+    = mse > 0.0 ?
+        MIN((float)(10.0 * log10(255.0 * 255.0 / mse)),
+            TEXTURE_COMPRESSOR_MAX_PSNR) :
+        TEXTURE_COMPRESSOR_MAX_PSNR;
+}
+
+void wgpu_texture_compressor_encode(wgpu_texture_compressor_t* compressor,
+                                    WGPUCommandEncoder cmd_enc,
+                                    WGPUTextureView source,
+                                    WGPUTexture destination,
+                                    WGPUTextureFormat destination_format,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t mip_level, uint32_t array_layer)
+{
+  wgpu_texture_compression_enum_t compression;
+  bool srgb = false;
+  if (!texture_compressor_find_format(destination_format, &compression,
+                                      &srgb)) {
+    log_error("Texture compressor: unsupported format %d",
+              destination_format);
+    return;
+  }
+
+  const uint32_t block_size  = texture_compression_formats[compression].block_size;
+  const uint32_t blocks_x    = (width + 3) / 4;
+  const uint32_t blocks_y    = (height + 3) / 4;
+  const uint32_t bytes_per_row = (blocks_x * block_size + 255) & ~255u;
+  const uint64_t size          = (uint64_t)bytes_per_row * blocks_y;
+  texture_compressor_reserve(compressor, size);
+
+  // A new measurement starts when the previous one was read back
+  const bool measure = !compressor->readback_pending;
+  if (measure) {
+    wgpuCommandEncoderClearBuffer(cmd_enc, compressor->error_buffer, 0,
+                                  TEXTURE_COMPRESSOR_ERROR_BUFFER_SIZE);
+  }
+
+  WGPUComputePipeline pipeline
+    = texture_compressor_get_pipeline(compressor, compression, srgb);
+  WGPUBindGroupLayout bind_group_layout
+    = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry){
+      .binding     = 0,
+      .textureView = source,
+    },
+    [1] = (WGPUBindGroupEntry){
+      .binding = 1,
+      .buffer  = compressor->block_buffer,
+      .offset  = 0,
+      .size    = size,
+    },
+    [2] = (WGPUBindGroupEntry){
+      .binding = 2,
+      .buffer  = compressor->error_buffer,
+      .offset  = 0,
+      .size    = TEXTURE_COMPRESSOR_ERROR_BUFFER_SIZE,
+    },
+  };
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+    compressor->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .layout     = bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+
+  // One invocation per block
+  WGPUComputePassEncoder pass_encoder = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Texture compressor compute pass",
+             });
+  wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    pass_encoder,
+    (blocks_x + TEXTURE_COMPRESSOR_WORKGROUP_SIZE - 1)
+      / TEXTURE_COMPRESSOR_WORKGROUP_SIZE,
+    (blocks_y + TEXTURE_COMPRESSOR_WORKGROUP_SIZE - 1)
+      / TEXTURE_COMPRESSOR_WORKGROUP_SIZE,
+    1);
+  wgpuComputePassEncoderEnd(pass_encoder);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+
+  // The copy covers the blocks, the physical size of the mip level
+  wgpuCommandEncoderCopyBufferToTexture(cmd_enc,
+    // Source
+    &(WGPUImageCopyBuffer) {
+      .buffer = compressor->block_buffer,
+      .layout = (WGPUTextureDataLayout) {
+        .offset       = 0,
+        .bytesPerRow  = bytes_per_row,
+        .rowsPerImage = blocks_y,
+      },
+    },
+    // Destination
+    &(WGPUImageCopyTexture){
+      .texture  = destination,
+      .mipLevel = mip_level,
+      .origin   = (WGPUOrigin3D){
+        .x = 0,
+        .y = 0,
+        .z = array_layer,
+      },
+      .aspect   = WGPUTextureAspect_All,
+    },
+    // Copy size
+    &(WGPUExtent3D){
+      .width              = blocks_x * 4,
+      .height             = blocks_y * 4,
+      .depthOrArrayLayers = 1,
+    });
+
+  compressor->stats.source_bytes += (uint64_t)width * height * 4;
+  compressor->stats.compressed_bytes
+    += (uint64_t)blocks_x * blocks_y * block_size;
+  if (measure) {
+    compressor->readback_pending = wgpu_buffer_read_async(
+      compressor->wgpu_context, compressor->error_buffer, 0,
+      TEXTURE_COMPRESSOR_ERROR_BUFFER_SIZE, texture_compressor_on_error_read,
+      compressor);
+  }
+}
+
+texture_t
+wgpu_texture_compressor_compress(wgpu_texture_compressor_t* compressor,
+                                 const texture_t* source,
+                                 wgpu_texture_compression_enum_t compression)
+{
+  ASSERT(source && source->texture);
+  ASSERT(compression < WGPU_TextureCompression_Count);
+
+  if (source->dimension != WGPUTextureDimension_2D
+      || source->size.width % 4 != 0 || source->size.height % 4 != 0) {
+    log_error("Texture compressor: %ux%u texture is not 2D with a size of "
+              "multiples of 4",
+              source->size.width, source->size.height);
+    return (texture_t){0};
+  }
+
+  wgpu_context_t* wgpu_context = compressor->wgpu_context;
+  const bool srgb              = source->format == WGPUTextureFormat_RGBA8UnormSrgb
+                    || source->format == WGPUTextureFormat_BGRA8UnormSrgb;
+  const WGPUTextureFormat format
+    = wgpu_texture_compression_get_format(compression, srgb);
+  const uint32_t layer_count     = MAX(source->size.depth, 1u);
+  const uint32_t mip_level_count = MAX(source->mip_level_count, 1u);
+
+  WGPUTexture texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "texture_compressor_texture",
+      .usage         = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = source->size.width,
+        .height             = source->size.height,
+        .depthOrArrayLayers = layer_count,
+      },
+      .format        = format,
+      .mipLevelCount = mip_level_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(texture != NULL);
+
+  // Every mip level and layer is encoded from a single level view
+  WGPUCommandEncoder cmd_encoder = wgpu_upload_commands_begin(wgpu_context);
+  for (uint32_t m = 0; m < mip_level_count; ++m) {
+    for (uint32_t layer = 0; layer < layer_count; ++layer) {
+      WGPUTextureView level_view = wgpuTextureCreateView(
+        source->texture, &(WGPUTextureViewDescriptor){
+                           .label           = "texture_compressor_level_view",
+                           .format          = source->format,
+                           .dimension       = WGPUTextureViewDimension_2D,
+                           .baseMipLevel    = m,
+                           .mipLevelCount   = 1,
+                           .baseArrayLayer  = layer,
+                           .arrayLayerCount = 1,
+                           .aspect          = WGPUTextureAspect_All,
+                         });
+      wgpu_texture_compressor_encode(
+        compressor, cmd_encoder, level_view, texture, format,
+        MAX(source->size.width >> m, 1u), MAX(source->size.height >> m, 1u),
+        m, layer);
+      WGPU_RELEASE_RESOURCE(TextureView, level_view)
+    }
+  }
+  wgpu_upload_commands_end(wgpu_context, cmd_encoder);
+
+  // Views of 6 layers are cube views
+  WGPUTextureView view = wgpuTextureCreateView(
+    texture, &(WGPUTextureViewDescriptor){
+               .label     = "texture_compressor_texture_view",
+               .format    = format,
+               .dimension = layer_count == 6 ? WGPUTextureViewDimension_Cube :
+                            layer_count > 1  ? WGPUTextureViewDimension_2DArray :
+                                               WGPUTextureViewDimension_2D,
+               .baseMipLevel    = 0,
+               .mipLevelCount   = mip_level_count,
+               .baseArrayLayer  = 0,
+               .arrayLayerCount = layer_count,
+               .aspect          = WGPUTextureAspect_All,
+             });
+  WGPUSampler sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Linear,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = (float)mip_level_count,
+                    .maxAnisotropy = 1,
+                  });
+
+  return (texture_t){
+    .size = {
+      .width  = source->size.width,
+      .height = source->size.height,
+      .depth  = layer_count,
+    },
+    .mip_level_count = mip_level_count,
+    .format          = format,
+    .dimension       = WGPUTextureDimension_2D,
+    .texture         = texture,
+    .view            = view,
+    .sampler         = sampler,
+  };
+}
+
+/* Statistics */
+
+const wgpu_texture_compressor_stats_t*
+wgpu_texture_compressor_get_stats(wgpu_texture_compressor_t* compressor)
+{
+  return &compressor->stats;
+}
@@ -0,0 +1,102 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include "context.h"
+#include "texture.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU texture compressor
+ *
+ * Compresses textures generated at runtime into BCn formats on the GPU, so
+ * they are sampled with a quarter or an eighth of the memory and bandwidth of
+ * RGBA8. A compute shader encodes one 4x4 block per invocation into a buffer,
+ * the blocks are copied into the compressed texture with a buffer to texture
+ * copy:
+ *
+ *   - BC1: RGB, 4 bits per texel, 565 endpoints from the inset bounding box
+ *   - BC4: R, 4 bits per texel, 8 interpolated values
+ *   - BC5: RG, 8 bits per texel, two BC4 blocks, e.g. normals or BRDF LUTs
+ *   - BC7: RGBA, 8 bits per texel, fast mode: mode 6 only (one subset, 7-bit
+ *     endpoints with p-bits, 16 levels), the highest quality single mode
+ *
+ * The encoder measures its own error: every block accumulates the squared
+ * difference of the decoded block to the source, read back asynchronously as
+ * the PSNR of wgpu_texture_compressor_get_stats(). The formats require the
+ * TextureCompressionBC feature, see wgpu_texture_compressor_is_supported().
+ *
+ *   if (wgpu_texture_compressor_is_supported(wgpu_context)) {
+ *     texture_t compressed = wgpu_texture_compressor_compress(
+ *       compressor, &texture, WGPU_TextureCompression_BC7);
+ *   }
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_texture_compressor wgpu_texture_compressor_t;
+
+typedef enum wgpu_texture_compression_enum_t {
+  WGPU_TextureCompression_BC1   = 0,
+  WGPU_TextureCompression_BC4   = 1,
+  WGPU_TextureCompression_BC5   = 2,
+  WGPU_TextureCompression_BC7   = 3,
+  WGPU_TextureCompression_Count = 4,
+} wgpu_texture_compression_enum_t;
+
+typedef struct wgpu_texture_compressor_stats_t {
+  /* Peak signal to noise ratio of the last measurement over the encoded
+   * channels in dB, 0 until the first readback arrived */
+  float psnr;
+  /* Source and compressed size of the encoded blocks, RGBA8 source texels */
+  uint64_t source_bytes;
+  uint64_t compressed_bytes;
+} wgpu_texture_compressor_stats_t;
+
+/* Texture compressor creating / destroying */
+wgpu_texture_compressor_t*
+wgpu_texture_compressor_create(wgpu_context_t* wgpu_context);
+void wgpu_texture_compressor_destroy(wgpu_texture_compressor_t* compressor);
+
+/* True if the device has the TextureCompressionBC feature */
+bool wgpu_texture_compressor_is_supported(wgpu_context_t* wgpu_context);
+
+/* Compressed format, the sRGB variant for BC1 and BC7 if srgb is set */
+WGPUTextureFormat
+wgpu_texture_compression_get_format(wgpu_texture_compression_enum_t compression,
+                                    bool srgb);
+const char*
+wgpu_texture_compression_get_name(wgpu_texture_compression_enum_t compression);
+/* Bytes of a 4x4 block, 8 or 16 */
+uint32_t wgpu_texture_compression_get_block_size(
+  wgpu_texture_compression_enum_t compression);
+
+/**
+ * @brief Creates a compressed copy of all mip levels and layers of a 2D or
+ * cube texture and submits the encoding. The source needs the TextureBinding
+ * usage and a filterable float format, its width and height must be multiples
+ * of 4. An sRGB source gives an sRGB BC1 or BC7 texture.
+ * @return the compressed texture with the CopyDst and TextureBinding usages,
+ * an empty texture if the source cannot be compressed
+ */
+texture_t
+wgpu_texture_compressor_compress(wgpu_texture_compressor_t* compressor,
+                                 const texture_t* source,
+                                 wgpu_texture_compression_enum_t compression);
+
+/**
+ * @brief Records the encoding of the first mip level of a 2D source view into
+ * a mip level and layer of a compressed texture of the same size, e.g. every
+ * frame of a video. The encodings are recorded in command order, so one
+ * command encoder can encode several textures.
+ */
+void wgpu_texture_compressor_encode(wgpu_texture_compressor_t* compressor,
+                                    WGPUCommandEncoder cmd_enc,
+                                    WGPUTextureView source,
+                                    WGPUTexture destination,
+                                    WGPUTextureFormat destination_format,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t mip_level, uint32_t array_layer);
+
+/* Statistics of the encodings since the compressor was created, the PSNR is
+ * measured again every time the previous readback arrived */
+const wgpu_texture_compressor_stats_t*
+wgpu_texture_compressor_get_stats(wgpu_texture_compressor_t* compressor);
+
+#endif /* TEXTURE_COMPRESSOR_H */
@@ -0,0 +1,150 @@
+#include "uniform_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "upload_ring.h"
+
+/**
+ * @brief Uniform allocator class
+ */
+struct wgpu_uniform_allocator {
+  wgpu_context_t* wgpu_context;
+  WGPUBuffer buffer;
+  uint64_t size;
+  uint32_t alignment;
+  /* Staging copy of the buffer */
+  uint8_t* data;
+  /* End of the allocations since the last reset */
+  uint64_t offset;
+  bool overflow_logged;
+};
+
+/* Uniform allocator creating / destroying */
+
+wgpu_uniform_allocator_t*
+wgpu_uniform_allocator_create(wgpu_context_t* wgpu_context,
+                              const wgpu_uniform_allocator_desc_t* desc)
+{
+  WGPUSupportedLimits supported_limits = {0};
+  wgpuDeviceGetLimits(wgpu_context->device, &supported_limits);
+
+  wgpu_uniform_allocator_t* allocator
+    = (wgpu_uniform_allocator_t*)malloc(sizeof(*allocator));
+  memset(allocator, 0, sizeof(*allocator));
+  allocator->wgpu_context = wgpu_context;
+  allocator->alignment
+    = supported_limits.limits.minUniformBufferOffsetAlignment > 0 ?
+        supported_limits.limits.minUniformBufferOffsetAlignment :
+        256u;
+  const uint64_t size = (desc != NULL && desc->size > 0) ?
+                          desc->size :
+                          WGPU_UNIFORM_ALLOCATOR_DEFAULT_SIZE;
+  allocator->size     = wgpu_uniform_allocator_aligned_size(allocator, size);
+  allocator->data     = (uint8_t*)calloc(allocator->size, 1);
+  allocator->buffer   = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = (desc != NULL && desc->label != NULL) ? desc->label :
+                                                       "Uniform allocator",
+      .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      .size  = allocator->size,
+    });
+  ASSERT(allocator->buffer != NULL);
+
+  return allocator;
+}
+
+void wgpu_uniform_allocator_destroy(wgpu_uniform_allocator_t* allocator)
+{
+  if (allocator == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(Buffer, allocator->buffer)
+  free(allocator->data);
+  free(allocator);
+}
+
+/* Allocating */
+
+void wgpu_uniform_allocator_reset(wgpu_uniform_allocator_t* allocator)
+{
+  allocator->offset = 0;
+}
+
+bool wgpu_uniform_allocator_alloc(wgpu_uniform_allocator_t* allocator,
+                                  uint64_t size,
+                                  wgpu_uniform_allocation_t* allocation)
+{
+  ASSERT(size > 0);
+
+  const uint64_t aligned_size
+    = wgpu_uniform_allocator_aligned_size(allocator, size);
+  if (allocator->offset + aligned_size > allocator->size) {
+    if (!allocator->overflow_logged) {
+      log_error("Uniform allocator full (%llu bytes)",
+                (unsigned long long)allocator->size);
+      allocator->overflow_logged = true;
+    }
+    return false;
+  }
+
+  allocation->buffer = allocator->buffer;
+  allocation->offset = (uint32_t)allocator->offset;
+  allocation->data   = allocator->data + allocator->offset;
+  allocator->offset += aligned_size;
+  return true;
+}
+
+bool wgpu_uniform_allocator_push(wgpu_uniform_allocator_t* allocator,
+                                 const void* data, uint64_t size,
+                                 wgpu_uniform_allocation_t* allocation)
+{
+  if (!wgpu_uniform_allocator_alloc(allocator, size, allocation)) {
+    return false;
+  }
+  memcpy(allocation->data, data, size);
+  return true;
+}
+
+void wgpu_uniform_allocator_flush(wgpu_uniform_allocator_t* allocator)
+{
+  if (allocator->offset == 0) {
+    return;
+  }
+
+  // One copy of the used range, the offsets are multiples of 4
+  wgpu_context_t* wgpu_context = allocator->wgpu_context;
+  if (wgpu_context->upload_ring == NULL
+      || !wgpu_upload_ring_write_buffer(wgpu_context->upload_ring,
+                                        allocator->buffer, 0, allocator->data,
+                                        allocator->offset)) {
+    wgpu_queue_write_buffer(wgpu_context, allocator->buffer, 0,
+                            allocator->data, allocator->offset);
+  }
+}
+
+/* Buffer and alignment */
+
+WGPUBuffer
+wgpu_uniform_allocator_get_buffer(wgpu_uniform_allocator_t* allocator)
+{
+  return allocator->buffer;
+}
+
+uint32_t
+wgpu_uniform_allocator_get_alignment(wgpu_uniform_allocator_t* allocator)
+{
+  return allocator->alignment;
+}
+
+uint64_t
+wgpu_uniform_allocator_aligned_size(wgpu_uniform_allocator_t* allocator,
+                                    uint64_t size)
+{
+  const uint64_t alignment = allocator->alignment;
+  return (size + alignment - 1) / alignment * alignment;
+}
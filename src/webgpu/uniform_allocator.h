@@ -0,0 +1,81 @@
+#ifndef UNIFORM_ALLOCATOR_H
+#define UNIFORM_ALLOCATOR_H
+
+#include "context.h"
+
+#define WGPU_UNIFORM_ALLOCATOR_DEFAULT_SIZE (1024u * 1024u)
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU uniform allocator
+ *
+ * Linear sub-allocator for per-draw uniform data. The data of all draws is
+ * packed into one large uniform buffer, each allocation starts at a multiple
+ * of the minUniformBufferOffsetAlignment device limit and is bound with a
+ * dynamic offset, e.g.:
+ *
+ *   wgpu_uniform_allocator_reset(allocator);
+ *   for each object:
+ *     wgpu_uniform_allocator_push(allocator, &object->uniforms,
+ *                                 sizeof(object->uniforms), &allocation);
+ *     object->dynamic_offset = allocation.offset;
+ *   wgpu_uniform_allocator_flush(allocator);
+ *
+ * The allocations are staged in CPU memory and uploaded with a single write of
+ * the used range through the upload ring on flush. The bind groups reference
+ * the buffer of wgpu_uniform_allocator_get_buffer() with the binding size of
+ * the largest per-draw struct. Allocations made in the same order each frame
+ * get the same offsets, so render bundles can keep their dynamic offsets.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_uniform_allocator wgpu_uniform_allocator_t;
+
+typedef struct wgpu_uniform_allocator_desc_t {
+  const char* label;
+  /* Buffer size, 0 = WGPU_UNIFORM_ALLOCATOR_DEFAULT_SIZE */
+  uint64_t size;
+} wgpu_uniform_allocator_desc_t;
+
+typedef struct wgpu_uniform_allocation_t {
+  WGPUBuffer buffer;
+  /* Dynamic offset of the allocation in the buffer */
+  uint32_t offset;
+  /* Staging memory of the allocation, written before the next flush */
+  void* data;
+} wgpu_uniform_allocation_t;
+
+/* Uniform allocator creating / destroying */
+wgpu_uniform_allocator_t*
+wgpu_uniform_allocator_create(wgpu_context_t* wgpu_context,
+                              const wgpu_uniform_allocator_desc_t* desc);
+void wgpu_uniform_allocator_destroy(wgpu_uniform_allocator_t* allocator);
+
+/* Frees all allocations, called before the allocations of a frame */
+void wgpu_uniform_allocator_reset(wgpu_uniform_allocator_t* allocator);
+
+/**
+ * @brief Allocates size bytes at the next aligned offset.
+ * @return false if the buffer is full
+ */
+bool wgpu_uniform_allocator_alloc(wgpu_uniform_allocator_t* allocator,
+                                  uint64_t size,
+                                  wgpu_uniform_allocation_t* allocation);
+
+/* Allocates and copies the data into the staging memory of the allocation */
+bool wgpu_uniform_allocator_push(wgpu_uniform_allocator_t* allocator,
+                                 const void* data, uint64_t size,
+                                 wgpu_uniform_allocation_t* allocation);
+
+/* Uploads the allocations made since the last reset */
+void wgpu_uniform_allocator_flush(wgpu_uniform_allocator_t* allocator);
+
+/* Buffer and alignment */
+WGPUBuffer
+wgpu_uniform_allocator_get_buffer(wgpu_uniform_allocator_t* allocator);
+uint32_t
+wgpu_uniform_allocator_get_alignment(wgpu_uniform_allocator_t* allocator);
+/* Size rounded up to the offset alignment, the stride of equal allocations */
+uint64_t
+wgpu_uniform_allocator_aligned_size(wgpu_uniform_allocator_t* allocator,
+                                    uint64_t size);
+
+#endif /* UNIFORM_ALLOCATOR_H */
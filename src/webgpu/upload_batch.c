@@ -0,0 +1,98 @@
+#include "upload_batch.h"
+
+#include "../core/macro.h"
+
+static struct {
+  DawnProcTable procs; /* wrapped procs */
+  /* Context with recorded uploads which are not submitted yet */
+  wgpu_context_t* pending;
+} upload_batch = {0};
+
+/* Upload batch begin / end */
+
+void wgpu_upload_batch_begin(wgpu_context_t* wgpu_context)
+{
+  ++wgpu_context->upload_batch.depth;
+}
+
+void wgpu_upload_batch_end(wgpu_context_t* wgpu_context)
+{
+  ASSERT(wgpu_context->upload_batch.depth > 0);
+
+  if (--wgpu_context->upload_batch.depth == 0) {
+    wgpu_upload_batch_flush(wgpu_context);
+  }
+}
+
+static void submit_commands(wgpu_context_t* wgpu_context,
+                            WGPUCommandEncoder cmd_encoder)
+{
+  WGPUCommandBuffer command_buffer
+    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+}
+
+void wgpu_upload_batch_flush(wgpu_context_t* wgpu_context)
+{
+  WGPUCommandEncoder cmd_encoder = wgpu_context->upload_batch.cmd_encoder;
+  if (cmd_encoder == NULL) {
+    return;
+  }
+
+  /* Cleared first, the submit passes through the submit hook */
+  wgpu_context->upload_batch.cmd_encoder = NULL;
+  if (upload_batch.pending == wgpu_context) {
+    upload_batch.pending = NULL;
+  }
+  submit_commands(wgpu_context, cmd_encoder);
+}
+
+/* Upload commands */
+
+WGPUCommandEncoder wgpu_upload_commands_begin(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->upload_batch.depth == 0) {
+    return wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  }
+
+  /* The batch encoder is created by the first upload of the batch */
+  if (wgpu_context->upload_batch.cmd_encoder == NULL) {
+    wgpu_context->upload_batch.cmd_encoder = wgpuDeviceCreateCommandEncoder(
+      wgpu_context->device, &(WGPUCommandEncoderDescriptor){
+                              .label = "Upload batch command encoder",
+                            });
+    upload_batch.pending = wgpu_context;
+  }
+  return wgpu_context->upload_batch.cmd_encoder;
+}
+
+void wgpu_upload_commands_end(wgpu_context_t* wgpu_context,
+                              WGPUCommandEncoder cmd_encoder)
+{
+  if (cmd_encoder != wgpu_context->upload_batch.cmd_encoder) {
+    submit_commands(wgpu_context, cmd_encoder);
+  }
+}
+
+/* Submit interception */
+
+static void upload_batch_queue_submit(WGPUQueue queue, uint32_t command_count,
+                                      WGPUCommandBuffer const* commands)
+{
+  wgpu_context_t* pending = upload_batch.pending;
+  if (pending != NULL && pending->queue == queue) {
+    wgpu_upload_batch_flush(pending);
+  }
+  upload_batch.procs.queueSubmit(queue, command_count, commands);
+}
+
+void wgpu_upload_batch_hook_procs(DawnProcTable* procs)
+{
+  upload_batch.procs = *procs;
+
+  procs->queueSubmit = upload_batch_queue_submit;
+}
@@ -0,0 +1,45 @@
+#ifndef UPLOAD_BATCH_H
+#define UPLOAD_BATCH_H
+
+#include <dawn/dawn_proc_table.h>
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU upload batch
+ *
+ * Load time uploads record their copies and mipmap generation passes into one
+ * command encoder between wgpu_upload_batch_begin() and
+ * wgpu_upload_batch_end(), which submits the commands of all uploads at once
+ * instead of one submit per texture. Batches nest, the outermost end submits.
+ * Outside of a batch every upload is submitted on its own.
+ *
+ * The example initialization, its load tasks and the texture creation of the
+ * glTF loader run in a batch. Any other queue submit first submits the
+ * pending batch, so work submitted during the loading sees the uploaded
+ * textures. Queue writes (wgpuQueueWriteBuffer / wgpuQueueWriteTexture) are
+ * not ordered after the batch: a recorded upload must not be overwritten by a
+ * queue write before the batch is submitted.
+ * -------------------------------------------------------------------------- */
+
+/* Upload batch begin / end */
+void wgpu_upload_batch_begin(wgpu_context_t* wgpu_context);
+void wgpu_upload_batch_end(wgpu_context_t* wgpu_context);
+/* Submits the commands recorded so far, the batch stays active */
+void wgpu_upload_batch_flush(wgpu_context_t* wgpu_context);
+
+/**
+ * @brief Returns the command encoder for the commands of an upload: the
+ * encoder of the active batch, otherwise a new encoder.
+ */
+WGPUCommandEncoder wgpu_upload_commands_begin(wgpu_context_t* wgpu_context);
+/* Submits the encoder of wgpu_upload_commands_begin() unless it belongs to the
+ * active batch */
+void wgpu_upload_commands_end(wgpu_context_t* wgpu_context,
+                              WGPUCommandEncoder cmd_encoder);
+
+/* Proc table hook submitting the pending batch before every queue submit, see
+ * wgpu_set_proc_table_hook() */
+void wgpu_upload_batch_hook_procs(DawnProcTable* procs);
+
+#endif
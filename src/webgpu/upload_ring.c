@@ -0,0 +1,316 @@
+#include "upload_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "gpu_stats.h"
+
+/* Copy offsets and sizes must be a multiple of 4 bytes */
+#define WGPU_UPLOAD_RING_ALIGNMENT 4u
+/* Offsets of texture copies are aligned to the bytesPerRow alignment, this
+ * covers the texel block size of all formats */
+#define WGPU_UPLOAD_RING_TEXTURE_ALIGNMENT 256u
+
+typedef enum wgpu_upload_chunk_state_t {
+  UploadChunk_State_Mapped   = 0, /* mapped, can be suballocated */
+  UploadChunk_State_Enqueued = 1, /* mapped, used in the current frame */
+  UploadChunk_State_Mapping  = 2, /* waiting for the GPU to finish */
+  UploadChunk_State_Lost     = 3, /* mapping failed, e.g. device lost */
+} wgpu_upload_chunk_state_t;
+
+typedef struct wgpu_upload_chunk_t {
+  WGPUBuffer buffer;
+  uint64_t size;
+  uint64_t tail;
+  uint8_t* mapped_data;
+  wgpu_upload_chunk_state_t state;
+} wgpu_upload_chunk_t;
+
+/**
+ * @brief Upload ring class
+ */
+struct wgpu_upload_ring {
+  wgpu_context_t* wgpu_context;
+  uint64_t chunk_size;
+  uint32_t max_chunk_count;
+  uint32_t chunk_count;
+  wgpu_upload_chunk_t* chunks;
+  WGPUCommandEncoder encoder; /* NULL if no copies are recorded */
+};
+
+/* Upload ring creating / releasing */
+
+wgpu_upload_ring_t*
+wgpu_upload_ring_create(wgpu_context_t* wgpu_context,
+                        const wgpu_upload_ring_desc_t* desc)
+{
+  wgpu_upload_ring_t* upload_ring
+    = (wgpu_upload_ring_t*)malloc(sizeof(wgpu_upload_ring_t));
+  memset(upload_ring, 0, sizeof(wgpu_upload_ring_t));
+
+  upload_ring->wgpu_context = wgpu_context;
+  upload_ring->chunk_size   = (desc && desc->chunk_size > 0) ?
+                                desc->chunk_size :
+                                WGPU_UPLOAD_RING_DEFAULT_CHUNK_SIZE;
+  upload_ring->max_chunk_count = (desc && desc->max_chunk_count > 0) ?
+                                   desc->max_chunk_count :
+                                   WGPU_UPLOAD_RING_MAX_CHUNK_COUNT;
+  /* Chunks are referenced by the map callbacks, the array is never resized */
+  upload_ring->chunks = (wgpu_upload_chunk_t*)calloc(
+    upload_ring->max_chunk_count, sizeof(wgpu_upload_chunk_t));
+
+  return upload_ring;
+}
+
+void wgpu_upload_ring_release(wgpu_upload_ring_t* upload_ring)
+{
+  if (upload_ring == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(CommandEncoder, upload_ring->encoder)
+  for (uint32_t i = 0; i < upload_ring->chunk_count; ++i) {
+    /* Unmapping also cancels pending map requests */
+    wgpuBufferUnmap(upload_ring->chunks[i].buffer);
+    WGPU_RELEASE_RESOURCE(Buffer, upload_ring->chunks[i].buffer)
+  }
+  free(upload_ring->chunks);
+  free(upload_ring);
+}
+
+/* Chunk management */
+
+static void upload_chunk_map_callback(WGPUBufferMapAsyncStatus status,
+                                      void* user_data)
+{
+  wgpu_upload_chunk_t* chunk = (wgpu_upload_chunk_t*)user_data;
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    chunk->mapped_data
+      = (uint8_t*)wgpuBufferGetMappedRange(chunk->buffer, 0, chunk->size);
+    ASSERT(chunk->mapped_data);
+    chunk->tail  = 0;
+    chunk->state = UploadChunk_State_Mapped;
+  }
+  else {
+    chunk->state = UploadChunk_State_Lost;
+  }
+}
+
+static wgpu_upload_chunk_t* upload_ring_create_chunk(wgpu_upload_ring_t* this,
+                                                     uint64_t size)
+{
+  if (this->chunk_count >= this->max_chunk_count) {
+    return NULL;
+  }
+
+  wgpu_upload_chunk_t* chunk = &this->chunks[this->chunk_count++];
+  chunk->size                = MAX(size, this->chunk_size);
+  chunk->tail                = 0;
+  chunk->state               = UploadChunk_State_Mapped;
+  chunk->buffer              = wgpuDeviceCreateBuffer(
+    this->wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label            = "Upload ring chunk",
+      .usage            = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+      .size             = chunk->size,
+      .mappedAtCreation = true,
+    });
+  ASSERT(chunk->buffer);
+  chunk->mapped_data
+    = (uint8_t*)wgpuBufferGetMappedRange(chunk->buffer, 0, chunk->size);
+  ASSERT(chunk->mapped_data);
+
+  return chunk;
+}
+
+static uint64_t upload_ring_align(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static wgpu_upload_chunk_t* upload_ring_find_chunk(wgpu_upload_ring_t* this,
+                                                   uint64_t size,
+                                                   uint64_t alignment)
+{
+  for (uint32_t i = 0; i < this->chunk_count; ++i) {
+    wgpu_upload_chunk_t* chunk = &this->chunks[i];
+    const uint64_t offset      = upload_ring_align(chunk->tail, alignment);
+    if ((chunk->state == UploadChunk_State_Mapped
+         || chunk->state == UploadChunk_State_Enqueued)
+        && offset <= chunk->size && chunk->size - offset >= size) {
+      return chunk;
+    }
+  }
+  return NULL;
+}
+
+static bool upload_ring_has_mapping_chunks(wgpu_upload_ring_t* this)
+{
+  for (uint32_t i = 0; i < this->chunk_count; ++i) {
+    if (this->chunks[i].state == UploadChunk_State_Mapping) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Allocate size bytes at an aligned offset in a mapped chunk, waits for a
+ * chunk to be re-mapped if the upper limit of chunks is reached */
+static wgpu_upload_chunk_t* upload_ring_allocate(wgpu_upload_ring_t* this,
+                                                 uint64_t size,
+                                                 uint64_t alignment,
+                                                 uint64_t* offset)
+{
+  wgpu_upload_chunk_t* chunk = upload_ring_find_chunk(this, size, alignment);
+  if (chunk == NULL) {
+    chunk = upload_ring_create_chunk(this, size);
+  }
+  while (chunk == NULL && upload_ring_has_mapping_chunks(this)) {
+    /* Force wait for the chunk remapping */
+    wgpuDeviceTick(this->wgpu_context->device);
+    chunk = upload_ring_find_chunk(this, size, alignment);
+  }
+  if (chunk == NULL) {
+    return NULL;
+  }
+
+  const uint64_t aligned_size
+    = upload_ring_align(size, WGPU_UPLOAD_RING_ALIGNMENT);
+  *offset      = upload_ring_align(chunk->tail, alignment);
+  chunk->tail  = MIN(*offset + aligned_size, chunk->size);
+  chunk->state = UploadChunk_State_Enqueued;
+
+  return chunk;
+}
+
+/* Uploading */
+
+void* wgpu_upload_ring_reserve_buffer(wgpu_upload_ring_t* upload_ring,
+                                      WGPUBuffer buffer,
+                                      uint64_t buffer_offset, uint64_t size)
+{
+  ASSERT(upload_ring && buffer);
+  ASSERT(size % WGPU_UPLOAD_RING_ALIGNMENT == 0);
+
+  uint64_t offset            = 0;
+  wgpu_upload_chunk_t* chunk = upload_ring_allocate(
+    upload_ring, size, WGPU_UPLOAD_RING_ALIGNMENT, &offset);
+  if (chunk == NULL) {
+    log_error("Upload ring memory upper limit reached\n");
+    return NULL;
+  }
+
+  if (upload_ring->encoder == NULL) {
+    upload_ring->encoder = wgpuDeviceCreateCommandEncoder(
+      upload_ring->wgpu_context->device, NULL);
+  }
+  wgpuCommandEncoderCopyBufferToBuffer(upload_ring->encoder, chunk->buffer,
+                                       offset, buffer, buffer_offset, size);
+  wgpu_stats_add_upload_bytes(size);
+
+  return chunk->mapped_data + offset;
+}
+
+bool wgpu_upload_ring_write_buffer(wgpu_upload_ring_t* upload_ring,
+                                   WGPUBuffer buffer, uint64_t buffer_offset,
+                                   const void* data, uint64_t size)
+{
+  ASSERT(data);
+
+  void* mapped_data = wgpu_upload_ring_reserve_buffer(upload_ring, buffer,
+                                                      buffer_offset, size);
+  if (mapped_data == NULL) {
+    return false;
+  }
+  memcpy(mapped_data, data, size);
+
+  return true;
+}
+
+bool wgpu_upload_ring_write_texture(wgpu_upload_ring_t* upload_ring,
+                                    const WGPUImageCopyTexture* destination,
+                                    const void* data, uint32_t bytes_per_row,
+                                    const WGPUExtent3D* write_size)
+{
+  ASSERT(upload_ring && destination && data && write_size);
+
+  /* Buffer to texture copies require a row pitch aligned to 256 bytes, the
+   * rows are repacked while they are copied into the chunk */
+  const uint32_t row_count = write_size->height
+                             * MAX(write_size->depthOrArrayLayers, 1u);
+  const uint32_t aligned_bytes_per_row = (uint32_t)upload_ring_align(
+    bytes_per_row, WGPU_UPLOAD_RING_TEXTURE_ALIGNMENT);
+  const uint64_t size = (uint64_t)aligned_bytes_per_row * row_count;
+
+  uint64_t offset            = 0;
+  wgpu_upload_chunk_t* chunk = upload_ring_allocate(
+    upload_ring, size, WGPU_UPLOAD_RING_TEXTURE_ALIGNMENT, &offset);
+  if (chunk == NULL) {
+    log_error("Upload ring memory upper limit reached\n");
+    return false;
+  }
+  if (aligned_bytes_per_row == bytes_per_row) {
+    memcpy(chunk->mapped_data + offset, data, size);
+  }
+  else {
+    const uint8_t* src = (const uint8_t*)data;
+    uint8_t* dst       = chunk->mapped_data + offset;
+    for (uint32_t row = 0; row < row_count; ++row) {
+      memcpy(dst, src, bytes_per_row);
+      src += bytes_per_row;
+      dst += aligned_bytes_per_row;
+    }
+  }
+
+  if (upload_ring->encoder == NULL) {
+    upload_ring->encoder = wgpuDeviceCreateCommandEncoder(
+      upload_ring->wgpu_context->device, NULL);
+  }
+  wgpuCommandEncoderCopyBufferToTexture(
+    upload_ring->encoder,
+    &(WGPUImageCopyBuffer){
+      .buffer = chunk->buffer,
+      .layout = (WGPUTextureDataLayout){
+        .offset       = offset,
+        .bytesPerRow  = aligned_bytes_per_row,
+        .rowsPerImage = write_size->height,
+      },
+    },
+    destination, write_size);
+  wgpu_stats_add_upload_bytes(size);
+
+  return true;
+}
+
+void wgpu_upload_ring_flush(wgpu_upload_ring_t* upload_ring)
+{
+  if (upload_ring == NULL || upload_ring->encoder == NULL) {
+    return;
+  }
+
+  /* The chunks used in this frame have to be unmapped before the submit */
+  for (uint32_t i = 0; i < upload_ring->chunk_count; ++i) {
+    wgpu_upload_chunk_t* chunk = &upload_ring->chunks[i];
+    if (chunk->state == UploadChunk_State_Enqueued) {
+      wgpuBufferUnmap(chunk->buffer);
+      chunk->mapped_data = NULL;
+    }
+  }
+
+  WGPUCommandBuffer copy = wgpu_get_command_buffer(upload_ring->encoder);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, upload_ring->encoder)
+  wgpuQueueSubmit(upload_ring->wgpu_context->queue, 1, &copy);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, copy)
+
+  /* Async function, re-mapped chunks are reused in a later frame */
+  for (uint32_t i = 0; i < upload_ring->chunk_count; ++i) {
+    wgpu_upload_chunk_t* chunk = &upload_ring->chunks[i];
+    if (chunk->state == UploadChunk_State_Enqueued) {
+      chunk->state = UploadChunk_State_Mapping;
+      wgpuBufferMapAsync(chunk->buffer, WGPUMapMode_Write, 0, chunk->size,
+                         upload_chunk_map_callback, chunk);
+    }
+  }
+}
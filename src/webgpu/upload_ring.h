@@ -0,0 +1,75 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include "context.h"
+
+#define WGPU_UPLOAD_RING_DEFAULT_CHUNK_SIZE (4u * 1024u * 1024u)
+#define WGPU_UPLOAD_RING_MAX_CHUNK_COUNT 16u
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU upload ring
+ *
+ * Suballocates per-frame uniform / vertex / texture data from persistently
+ * mapped MapWrite | CopySrc chunks and records the copies into the destination
+ * buffers and textures on its own command encoder. wgpu_upload_ring_flush()
+ * unmaps the chunks used in the frame, submits the copies and maps the chunks
+ * again asynchronously, they become available once the GPU finished the
+ * copies.
+ *
+ * Based on the buffer manager of the aquarium example.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_upload_ring wgpu_upload_ring_t;
+
+typedef struct wgpu_upload_ring_desc_t {
+  uint64_t chunk_size;      /* 0 = WGPU_UPLOAD_RING_DEFAULT_CHUNK_SIZE */
+  uint32_t max_chunk_count; /* 0 = WGPU_UPLOAD_RING_MAX_CHUNK_COUNT */
+} wgpu_upload_ring_desc_t;
+
+/* Upload ring creating / releasing */
+wgpu_upload_ring_t*
+wgpu_upload_ring_create(wgpu_context_t* wgpu_context,
+                        const wgpu_upload_ring_desc_t* desc);
+void wgpu_upload_ring_release(wgpu_upload_ring_t* upload_ring);
+
+/**
+ * @brief Copies the data into the destination buffer (which requires the
+ * CopyDst usage), similar to wgpuQueueWriteBuffer. The copy is executed on
+ * the next wgpu_upload_ring_flush().
+ * @param size the data size, must be a multiple of 4
+ * @return true on success, false if the ring reached its upper memory limit
+ */
+bool wgpu_upload_ring_write_buffer(wgpu_upload_ring_t* upload_ring,
+                                   WGPUBuffer buffer, uint64_t buffer_offset,
+                                   const void* data, uint64_t size);
+
+/**
+ * @brief Like wgpu_upload_ring_write_buffer(), but returns the mapped staging
+ * memory of the copy instead of copying the data. The caller writes the size
+ * bytes before the next wgpu_upload_ring_flush().
+ * @return the mapped memory, NULL if the ring reached its upper memory limit
+ */
+void* wgpu_upload_ring_reserve_buffer(wgpu_upload_ring_t* upload_ring,
+                                      WGPUBuffer buffer,
+                                      uint64_t buffer_offset, uint64_t size);
+
+/**
+ * @brief Copies tightly or loosely packed rows into the destination texture
+ * (which requires the CopyDst usage), similar to wgpuQueueWriteTexture. The
+ * rows are repacked to the 256 bytes row pitch of buffer to texture copies.
+ * The copy is executed on the next wgpu_upload_ring_flush().
+ * @param bytes_per_row the row pitch of the data
+ * @return true on success, false if the ring reached its upper memory limit
+ */
+bool wgpu_upload_ring_write_texture(wgpu_upload_ring_t* upload_ring,
+                                    const WGPUImageCopyTexture* destination,
+                                    const void* data, uint32_t bytes_per_row,
+                                    const WGPUExtent3D* write_size);
+
+/**
+ * @brief Submits the recorded copies. Called before the command buffers of a
+ * frame are submitted, this is done by wgpu_flush_command_buffers().
+ */
+void wgpu_upload_ring_flush(wgpu_upload_ring_t* upload_ring);
+
+#endif /* UPLOAD_RING_H */
@@ -0,0 +1,906 @@
+#include "virtual_texture.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/file.h"
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "readback.h"
+#include "sampler_cache.h"
+#include "texture.h"
+#include "upload_ring.h"
+
+#include "stb_image_resize.h"
+
+/* "VTEX" little endian */
+#define VIRTUAL_TEXTURE_FILE_MAGIC 0x58455456u
+#define VIRTUAL_TEXTURE_FILE_VERSION 1u
+/* Alignment of the pages in the page file, like the asset archive payloads */
+#define VIRTUAL_TEXTURE_FILE_ALIGNMENT 256u
+/* 12 bits for the page coordinates in the page IDs */
+#define VIRTUAL_TEXTURE_MAX_LEVEL_COUNT 13u
+#define VIRTUAL_TEXTURE_DEFAULT_CACHE_SIZE 16u
+#define VIRTUAL_TEXTURE_DEFAULT_PAGES_PER_FRAME 8u
+/* Slot coordinates are stored in 8 bits in the indirection texture */
+#define VIRTUAL_TEXTURE_MAX_CACHE_SIZE 256u
+#define VIRTUAL_TEXTURE_NO_SLOT -1
+
+#define VIRTUAL_TEXTURE_ALIGN(x, a) (((x) + (a) - 1) / (a) * (a))
+
+// clang-format off
+static const char* virtual_texture_wgsl = CODE(
+  // xy: pages per side of level 0, z: level count, w: cache size in pages
+  struct VirtualTexture {
+    size : vec4<f32>,
+  }
+
+  const VT_PAGE_SIZE : f32   = 128.0;
+  const VT_PAGE_BORDER : f32 = 4.0;
+
+  // Virtual level of the fragment, continuous derivatives across the wrap
+  fn vt_level(vt : VirtualTexture, uv : vec2<f32>, lod_bias : f32) -> f32 {
+    let texels = uv * vt.size.xy * VT_PAGE_SIZE;
+    let dx     = dpdx(texels);
+    let dy     = dpdy(texels);
+    let lod    = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8))
+                 + lod_bias;
+    return clamp(floor(lod), 0.0, vt.size.z - 1.0);
+  }
+
+  fn vt_level_pages(vt : VirtualTexture, level : f32) -> vec2<f32> {
+    return max(floor(vt.size.xy / exp2(level)), vec2<f32>(1.0));
+  }
+
+  // Feedback value: page x in bits 0-11, y in bits 12-23, level in 24-31
+  fn vt_page_id(vt : VirtualTexture, uv : vec2<f32>, level : f32) -> u32 {
+    let pages = vt_level_pages(vt, level);
+    let page  = min(vec2<u32>(fract(uv) * pages), vec2<u32>(pages) - 1u);
+    return page.x | (page.y << 12u) | (u32(level) << 24u);
+  }
+
+  // Samples the page of the level or its nearest resident ancestor
+  fn vt_sample(indirection : texture_2d<u32>, cache : texture_2d<f32>,
+               cache_sampler : sampler, vt : VirtualTexture, uv : vec2<f32>,
+               level : f32) -> vec4<f32> {
+    let wrapped = fract(uv);
+    let pages   = vt_level_pages(vt, level);
+    let page    = min(vec2<i32>(wrapped * pages), vec2<i32>(pages) - 1);
+    let entry   = textureLoad(indirection, page, i32(level));
+
+    let resident_pages = vt_level_pages(vt, f32(entry.z));
+    let in_page   = fract(wrapped * resident_pages);
+    let slot_size = VT_PAGE_SIZE + 2.0 * VT_PAGE_BORDER;
+    let texel     = vec2<f32>(entry.xy) * slot_size + VT_PAGE_BORDER
+                    + in_page * VT_PAGE_SIZE;
+    return textureSampleLevel(cache, cache_sampler,
+                              texel / (vt.size.w * slot_size), 0.0);
+  }
+);
+// clang-format on
+
+char* wgpu_virtual_texture_add_wgsl(const char* wgsl_source)
+{
+  const size_t prelude_length = strlen(virtual_texture_wgsl);
+  const size_t source_length  = strlen(wgsl_source);
+
+  char* source = (char*)malloc(prelude_length + 1 + source_length + 1);
+  ASSERT(source != NULL);
+  memcpy(source, virtual_texture_wgsl, prelude_length);
+  source[prelude_length] = '\n';
+  memcpy(source + prelude_length + 1, wgsl_source, source_length + 1);
+
+  return source;
+}
+
+/* Page file header, followed by the pages of all levels from level 0 in row
+ * major order, each one slot of RGBA8 texels at a multiple of page_stride */
+typedef struct virtual_texture_file_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t page_size;
+  uint32_t page_border;
+  uint32_t level_count;
+  uint32_t page_count;
+  uint32_t page_stride;
+} virtual_texture_file_header_t;
+
+static uint64_t virtual_texture_file_pages_offset(void)
+{
+  return VIRTUAL_TEXTURE_ALIGN(sizeof(virtual_texture_file_header_t),
+                               VIRTUAL_TEXTURE_FILE_ALIGNMENT);
+}
+
+static uint32_t virtual_texture_file_page_stride(void)
+{
+  return VIRTUAL_TEXTURE_ALIGN(WGPU_VIRTUAL_TEXTURE_SLOT_SIZE
+                                 * WGPU_VIRTUAL_TEXTURE_SLOT_SIZE * 4u,
+                               VIRTUAL_TEXTURE_FILE_ALIGNMENT);
+}
+
+/**
+ * @brief Virtual texture class
+ */
+struct wgpu_virtual_texture {
+  wgpu_context_t* wgpu_context;
+  file_mapping_t file;
+  const uint8_t* pages;
+  uint32_t page_stride;
+  uint32_t pages_per_side; /* level 0 */
+  uint32_t level_count;
+  uint32_t page_count;
+  uint32_t level_offsets[VIRTUAL_TEXTURE_MAX_LEVEL_COUNT + 1];
+  uint32_t cache_size; /* slots per side */
+  uint32_t slot_count;
+  uint32_t pages_per_frame;
+  /* Residency: slot of every page, page of every slot */
+  int32_t* page_slots;
+  int32_t* slot_pages;
+  /* Last feedback a page was requested in / the page of a slot was used in */
+  uint32_t* page_serials;
+  uint32_t* slot_serials;
+  uint32_t serial;
+  /* Requested pages of the last feedback that are not resident, coarse first */
+  uint32_t* requests;
+  uint32_t request_count;
+  uint32_t next_request;
+  /* CPU copy of all indirection levels, one RGBA8 texel per page */
+  uint8_t* indirection;
+  bool indirection_dirty;
+  WGPUTexture cache_texture;
+  WGPUTextureView cache_view;
+  WGPUTexture indirection_texture;
+  WGPUTextureView indirection_view;
+  WGPUSampler sampler;
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+    WGPUTexture depth_texture;
+    WGPUTextureView depth_view;
+    WGPUBuffer buffer;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_row;
+  } feedback;
+  /* Feedback target layout of the readback in flight */
+  struct {
+    bool pending;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_row;
+  } readback;
+  wgpu_virtual_texture_stats_t stats;
+};
+
+/* -------------------------------------------------------------------------- *
+ * Page file baking
+ * -------------------------------------------------------------------------- */
+
+static uint32_t virtual_texture_wrap(int32_t x, uint32_t size, bool wrap)
+{
+  if (wrap) {
+    const int32_t s = (int32_t)size;
+    return (uint32_t)(((x % s) + s) % s);
+  }
+  return (uint32_t)CLAMP(x, 0, (int32_t)size - 1);
+}
+
+/* Box filters a square RGBA8 level into the next level */
+static void virtual_texture_downsample(const uint8_t* src, uint32_t src_size,
+                                       uint8_t* dst)
+{
+  const uint32_t dst_size = src_size / 2u;
+  for (uint32_t y = 0; y < dst_size; ++y) {
+    const uint8_t* row0 = src + (uint64_t)(2u * y) * src_size * 4u;
+    const uint8_t* row1 = row0 + (uint64_t)src_size * 4u;
+    for (uint32_t x = 0; x < dst_size; ++x) {
+      for (uint32_t c = 0; c < 4u; ++c) {
+        const uint32_t sum = row0[8u * x + c] + row0[8u * x + 4u + c]
+                             + row1[8u * x + c] + row1[8u * x + 4u + c];
+        dst[((uint64_t)y * dst_size + x) * 4u + c] = (uint8_t)((sum + 2u) / 4u);
+      }
+    }
+  }
+}
+
+bool wgpu_virtual_texture_bake(const char* image_filename,
+                               const char* filename, uint32_t size, bool wrap)
+{
+  const uint32_t page_size = WGPU_VIRTUAL_TEXTURE_PAGE_SIZE;
+  if (size < page_size || (size & (size - 1u)) != 0
+      || size / page_size > (1u << (VIRTUAL_TEXTURE_MAX_LEVEL_COUNT - 1u))) {
+    log_error("Invalid virtual texture size %u\n", size);
+    return false;
+  }
+
+  image_data_t image = {0};
+  if (!wgpu_image_data_load_from_file(image_filename, false, &image)) {
+    return false;
+  }
+  if (image.channel_count != 4) {
+    log_error("Virtual texture source '%s' is not RGBA\n", image_filename);
+    wgpu_image_data_release(&image);
+    return false;
+  }
+
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
+    log_error("Couldn't write '%s': %s\n", filename, strerror(errno));
+    wgpu_image_data_release(&image);
+    return false;
+  }
+
+  virtual_texture_file_header_t header = {
+    .magic       = VIRTUAL_TEXTURE_FILE_MAGIC,
+    .version     = VIRTUAL_TEXTURE_FILE_VERSION,
+    .size        = size,
+    .page_size   = page_size,
+    .page_border = WGPU_VIRTUAL_TEXTURE_PAGE_BORDER,
+    .page_stride = virtual_texture_file_page_stride(),
+  };
+  for (uint32_t level_size = size; level_size >= page_size; level_size /= 2u) {
+    const uint32_t pages = level_size / page_size;
+    header.page_count += pages * pages;
+    ++header.level_count;
+  }
+
+  // Level 0 at the virtual size, the coarser levels are box filtered
+  uint8_t* level = (uint8_t*)malloc((uint64_t)size * size * 4u);
+  if ((uint32_t)image.width == size && (uint32_t)image.height == size) {
+    memcpy(level, image.pixels, (uint64_t)size * size * 4u);
+  }
+  else {
+    stbir_resize_uint8(image.pixels, image.width, image.height, 0, level,
+                       (int)size, (int)size, 0, 4);
+  }
+  wgpu_image_data_release(&image);
+
+  uint8_t* page = (uint8_t*)calloc(header.page_stride, 1);
+  uint8_t padding[VIRTUAL_TEXTURE_FILE_ALIGNMENT] = {0};
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                 && fwrite(padding,
+                           virtual_texture_file_pages_offset() - sizeof(header),
+                           1, file)
+                      == 1;
+
+  const int32_t border = (int32_t)WGPU_VIRTUAL_TEXTURE_PAGE_BORDER;
+  const uint32_t slot_size = WGPU_VIRTUAL_TEXTURE_SLOT_SIZE;
+  uint32_t level_size      = size;
+  for (uint32_t l = 0; l < header.level_count && written; ++l) {
+    const uint32_t pages = level_size / page_size;
+    for (uint32_t py = 0; py < pages && written; ++py) {
+      for (uint32_t px = 0; px < pages && written; ++px) {
+        // The border repeats the texels of the neighbouring pages
+        for (uint32_t y = 0; y < slot_size; ++y) {
+          const uint32_t sy = virtual_texture_wrap(
+            (int32_t)(py * page_size + y) - border, level_size, wrap);
+          for (uint32_t x = 0; x < slot_size; ++x) {
+            const uint32_t sx = virtual_texture_wrap(
+              (int32_t)(px * page_size + x) - border, level_size, wrap);
+            memcpy(page + ((uint64_t)y * slot_size + x) * 4u,
+                   level + ((uint64_t)sy * level_size + sx) * 4u, 4u);
+          }
+        }
+        written = fwrite(page, header.page_stride, 1, file) == 1;
+      }
+    }
+    if (l + 1u < header.level_count) {
+      virtual_texture_downsample(level, level_size, level);
+      level_size /= 2u;
+    }
+  }
+
+  free(page);
+  free(level);
+  written = fclose(file) == 0 && written;
+  if (!written) {
+    log_error("Couldn't write '%s'\n", filename);
+    remove(filename);
+    return false;
+  }
+  log_info("Baked virtual texture '%s': %u levels, %u pages\n", filename,
+           header.level_count, header.page_count);
+  return true;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Virtual texture creating / destroying
+ * -------------------------------------------------------------------------- */
+
+static bool virtual_texture_map_file(wgpu_virtual_texture_t* vt,
+                                     const char* filename)
+{
+  const int error = file_map(filename, &vt->file);
+  if (error != 0) {
+    log_error("Couldn't load '%s': %s\n", filename, strerror(error));
+    return false;
+  }
+
+  virtual_texture_file_header_t header = {0};
+  if (vt->file.size >= sizeof(header)) {
+    memcpy(&header, vt->file.data, sizeof(header));
+  }
+  const uint64_t pages_size = (uint64_t)header.page_count * header.page_stride;
+  if (header.magic != VIRTUAL_TEXTURE_FILE_MAGIC
+      || header.version != VIRTUAL_TEXTURE_FILE_VERSION
+      || header.page_size != WGPU_VIRTUAL_TEXTURE_PAGE_SIZE
+      || header.page_border != WGPU_VIRTUAL_TEXTURE_PAGE_BORDER
+      || header.page_stride != virtual_texture_file_page_stride()
+      || header.level_count == 0
+      || header.level_count > VIRTUAL_TEXTURE_MAX_LEVEL_COUNT
+      || header.size != header.page_size << (header.level_count - 1u)
+      || vt->file.size < virtual_texture_file_pages_offset() + pages_size) {
+    log_error("Invalid virtual texture page file '%s'\n", filename);
+    file_unmap(&vt->file);
+    return false;
+  }
+
+  vt->pages          = vt->file.data + virtual_texture_file_pages_offset();
+  vt->page_stride    = header.page_stride;
+  vt->pages_per_side = header.size / header.page_size;
+  vt->level_count    = header.level_count;
+  for (uint32_t l = 0; l < vt->level_count; ++l) {
+    const uint32_t pages     = vt->pages_per_side >> l;
+    vt->level_offsets[l + 1] = vt->level_offsets[l] + pages * pages;
+  }
+  vt->page_count = vt->level_offsets[vt->level_count];
+  return vt->page_count == header.page_count;
+}
+
+static void virtual_texture_create_textures(wgpu_virtual_texture_t* vt,
+                                            bool srgb)
+{
+  wgpu_context_t* wgpu_context = vt->wgpu_context;
+  const WGPUTextureFormat format
+    = srgb ? WGPUTextureFormat_RGBA8UnormSrgb : WGPUTextureFormat_RGBA8Unorm;
+  const uint32_t cache_texels = vt->cache_size * WGPU_VIRTUAL_TEXTURE_SLOT_SIZE;
+
+  vt->cache_texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "virtual_texture_cache_texture",
+      .usage         = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = cache_texels,
+        .height             = cache_texels,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = format,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(vt->cache_texture != NULL);
+  vt->cache_view = wgpuTextureCreateView(vt->cache_texture, NULL);
+
+  vt->indirection_texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "virtual_texture_indirection_texture",
+      .usage         = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = vt->pages_per_side,
+        .height             = vt->pages_per_side,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = WGPUTextureFormat_RGBA8Uint,
+      .mipLevelCount = vt->level_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(vt->indirection_texture != NULL);
+  vt->indirection_view = wgpuTextureCreateView(vt->indirection_texture, NULL);
+
+  // The borders cover the bilinear footprint, the slots never bleed
+  vt->sampler = wgpu_create_sampler(
+    wgpu_context, &(WGPUSamplerDescriptor){
+                    .addressModeU  = WGPUAddressMode_ClampToEdge,
+                    .addressModeV  = WGPUAddressMode_ClampToEdge,
+                    .addressModeW  = WGPUAddressMode_ClampToEdge,
+                    .minFilter     = WGPUFilterMode_Linear,
+                    .magFilter     = WGPUFilterMode_Linear,
+                    .mipmapFilter  = WGPUFilterMode_Nearest,
+                    .lodMinClamp   = 0.0f,
+                    .lodMaxClamp   = 1.0f,
+                    .maxAnisotropy = 1,
+                  });
+  ASSERT(vt->sampler != NULL);
+
+  vt->stats.cache_bytes
+    = (uint64_t)cache_texels * cache_texels * 4u
+      + (uint64_t)vt->page_count * 4u;
+}
+
+static void virtual_texture_upload_page(wgpu_virtual_texture_t* vt,
+                                        uint32_t page, uint32_t slot)
+{
+  wgpu_context_t* wgpu_context = vt->wgpu_context;
+  const uint32_t slot_size     = WGPU_VIRTUAL_TEXTURE_SLOT_SIZE;
+  const uint8_t* data = vt->pages + (uint64_t)page * vt->page_stride;
+  const WGPUImageCopyTexture destination = {
+    .texture  = vt->cache_texture,
+    .mipLevel = 0,
+    .origin   = (WGPUOrigin3D){
+      .x = (slot % vt->cache_size) * slot_size,
+      .y = (slot / vt->cache_size) * slot_size,
+      .z = 0,
+    },
+    .aspect   = WGPUTextureAspect_All,
+  };
+  const WGPUExtent3D size = {
+    .width              = slot_size,
+    .height             = slot_size,
+    .depthOrArrayLayers = 1,
+  };
+  if (wgpu_context->upload_ring == NULL
+      || !wgpu_upload_ring_write_texture(wgpu_context->upload_ring,
+                                         &destination, data, slot_size * 4u,
+                                         &size)) {
+    wgpuQueueWriteTexture(wgpu_context->queue, &destination, data,
+                          (size_t)slot_size * slot_size * 4u,
+                          &(WGPUTextureDataLayout){
+                            .offset       = 0,
+                            .bytesPerRow  = slot_size * 4u,
+                            .rowsPerImage = slot_size,
+                          },
+                          &size);
+  }
+
+  const int32_t evicted = vt->slot_pages[slot];
+  if (evicted != VIRTUAL_TEXTURE_NO_SLOT) {
+    vt->page_slots[evicted] = VIRTUAL_TEXTURE_NO_SLOT;
+    ++vt->stats.evicted_page_count;
+  }
+  else {
+    ++vt->stats.resident_page_count;
+  }
+  vt->page_slots[page]   = (int32_t)slot;
+  vt->slot_pages[slot]   = (int32_t)page;
+  vt->slot_serials[slot] = vt->serial;
+  ++vt->stats.uploaded_page_count;
+  vt->indirection_dirty = true;
+}
+
+wgpu_virtual_texture_t*
+wgpu_virtual_texture_create(wgpu_context_t* wgpu_context,
+                            const wgpu_virtual_texture_desc_t* desc)
+{
+  ASSERT(desc != NULL && desc->filename != NULL);
+
+  wgpu_virtual_texture_t* vt = (wgpu_virtual_texture_t*)malloc(sizeof(*vt));
+  memset(vt, 0, sizeof(*vt));
+  vt->wgpu_context = wgpu_context;
+  if (!virtual_texture_map_file(vt, desc->filename)) {
+    file_unmap(&vt->file);
+    free(vt);
+    return NULL;
+  }
+
+  // The cache never holds more pages than the texture has
+  const uint32_t max_cache_texels
+    = wgpu_context->limits.limits.maxTextureDimension2D;
+  uint32_t cache_size = desc->cache_size_in_pages > 0 ?
+                          desc->cache_size_in_pages :
+                          VIRTUAL_TEXTURE_DEFAULT_CACHE_SIZE;
+  cache_size = MIN(cache_size, VIRTUAL_TEXTURE_MAX_CACHE_SIZE);
+  if (max_cache_texels > 0) {
+    cache_size
+      = MIN(cache_size, max_cache_texels / WGPU_VIRTUAL_TEXTURE_SLOT_SIZE);
+  }
+  while (cache_size > 1 && (cache_size - 1) * (cache_size - 1) >= vt->page_count) {
+    --cache_size;
+  }
+  vt->cache_size      = cache_size;
+  vt->slot_count      = MIN(cache_size * cache_size, vt->page_count);
+  vt->pages_per_frame = desc->pages_per_frame > 0 ?
+                          desc->pages_per_frame :
+                          VIRTUAL_TEXTURE_DEFAULT_PAGES_PER_FRAME;
+
+  vt->page_slots   = (int32_t*)malloc(vt->page_count * sizeof(int32_t));
+  vt->page_serials = (uint32_t*)calloc(vt->page_count, sizeof(uint32_t));
+  vt->requests     = (uint32_t*)malloc(vt->page_count * sizeof(uint32_t));
+  vt->indirection  = (uint8_t*)calloc(vt->page_count, 4u);
+  vt->slot_pages   = (int32_t*)malloc(vt->slot_count * sizeof(int32_t));
+  vt->slot_serials = (uint32_t*)calloc(vt->slot_count, sizeof(uint32_t));
+  for (uint32_t i = 0; i < vt->page_count; ++i) {
+    vt->page_slots[i] = VIRTUAL_TEXTURE_NO_SLOT;
+  }
+  for (uint32_t i = 0; i < vt->slot_count; ++i) {
+    vt->slot_pages[i] = VIRTUAL_TEXTURE_NO_SLOT;
+  }
+
+  virtual_texture_create_textures(vt, desc->srgb);
+
+  vt->stats.virtual_size = vt->pages_per_side * WGPU_VIRTUAL_TEXTURE_PAGE_SIZE;
+  vt->stats.level_count  = vt->level_count;
+  vt->stats.page_count   = vt->page_count;
+  vt->stats.slot_count   = vt->slot_count;
+  for (uint32_t l = 0; l < vt->level_count; ++l) {
+    const uint64_t level_size = vt->stats.virtual_size >> l;
+    vt->stats.virtual_bytes += level_size * level_size * 4u;
+  }
+
+  // The coarsest page stays in slot 0, every page falls back to it
+  virtual_texture_upload_page(vt, vt->page_count - 1u, 0u);
+  wgpu_virtual_texture_update(vt);
+
+  return vt;
+}
+
+static void virtual_texture_release_feedback(wgpu_virtual_texture_t* vt)
+{
+  WGPU_RELEASE_RESOURCE(TextureView, vt->feedback.view)
+  WGPU_RELEASE_RESOURCE(Texture, vt->feedback.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, vt->feedback.depth_view)
+  WGPU_RELEASE_RESOURCE(Texture, vt->feedback.depth_texture)
+  WGPU_RELEASE_RESOURCE(Buffer, vt->feedback.buffer)
+}
+
+void wgpu_virtual_texture_destroy(wgpu_virtual_texture_t* vt)
+{
+  if (vt == NULL) {
+    return;
+  }
+
+  virtual_texture_release_feedback(vt);
+  WGPU_RELEASE_RESOURCE(TextureView, vt->cache_view)
+  WGPU_RELEASE_RESOURCE(Texture, vt->cache_texture)
+  WGPU_RELEASE_RESOURCE(TextureView, vt->indirection_view)
+  WGPU_RELEASE_RESOURCE(Texture, vt->indirection_texture)
+  WGPU_RELEASE_RESOURCE(Sampler, vt->sampler)
+  free(vt->page_slots);
+  free(vt->page_serials);
+  free(vt->requests);
+  free(vt->indirection);
+  free(vt->slot_pages);
+  free(vt->slot_serials);
+  file_unmap(&vt->file);
+  free(vt);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Feedback
+ * -------------------------------------------------------------------------- */
+
+static void virtual_texture_create_feedback(wgpu_virtual_texture_t* vt,
+                                            uint32_t width, uint32_t height)
+{
+  wgpu_context_t* wgpu_context = vt->wgpu_context;
+  virtual_texture_release_feedback(vt);
+
+  const WGPUExtent3D size = {
+    .width              = width,
+    .height             = height,
+    .depthOrArrayLayers = 1,
+  };
+  vt->feedback.texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "virtual_texture_feedback_texture",
+      .usage         = WGPUTextureUsage_RenderAttachment
+                       | WGPUTextureUsage_CopySrc,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = size,
+      .format        = WGPU_VIRTUAL_TEXTURE_FEEDBACK_FORMAT,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(vt->feedback.texture != NULL);
+  vt->feedback.view = wgpuTextureCreateView(vt->feedback.texture, NULL);
+
+  vt->feedback.depth_texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "virtual_texture_feedback_depth_texture",
+      .usage         = WGPUTextureUsage_RenderAttachment,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = size,
+      .format        = WGPU_VIRTUAL_TEXTURE_FEEDBACK_DEPTH_FORMAT,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(vt->feedback.depth_texture != NULL);
+  vt->feedback.depth_view
+    = wgpuTextureCreateView(vt->feedback.depth_texture, NULL);
+
+  vt->feedback.bytes_per_row = VIRTUAL_TEXTURE_ALIGN(width * 4u, 256u);
+  vt->feedback.buffer        = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "virtual_texture_feedback_buffer",
+      .usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst,
+      .size  = (uint64_t)vt->feedback.bytes_per_row * height,
+    });
+  ASSERT(vt->feedback.buffer != NULL);
+
+  vt->feedback.width  = width;
+  vt->feedback.height = height;
+}
+
+WGPURenderPassEncoder
+wgpu_virtual_texture_begin_feedback_pass(wgpu_virtual_texture_t* vt,
+                                         WGPUCommandEncoder cmd_enc,
+                                         uint32_t width, uint32_t height)
+{
+  if (vt->readback.pending) {
+    return NULL;
+  }
+
+  const uint32_t scale = WGPU_VIRTUAL_TEXTURE_FEEDBACK_SCALE;
+  const uint32_t feedback_width  = MAX((width + scale - 1u) / scale, 1u);
+  const uint32_t feedback_height = MAX((height + scale - 1u) / scale, 1u);
+  if (feedback_width != vt->feedback.width
+      || feedback_height != vt->feedback.height) {
+    virtual_texture_create_feedback(vt, feedback_width, feedback_height);
+  }
+
+  return wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+      .label                = "virtual_texture_feedback_render_pass",
+      .colorAttachmentCount = 1,
+      .colorAttachments     = &(WGPURenderPassColorAttachment){
+        .view       = vt->feedback.view,
+        .loadOp     = WGPULoadOp_Clear,
+        .storeOp    = WGPUStoreOp_Store,
+        .clearValue = (WGPUColor){
+          .r = (double)WGPU_VIRTUAL_TEXTURE_INVALID_PAGE,
+        },
+      },
+      .depthStencilAttachment = &(WGPURenderPassDepthStencilAttachment){
+        .view            = vt->feedback.depth_view,
+        .depthLoadOp     = WGPULoadOp_Clear,
+        .depthStoreOp    = WGPUStoreOp_Discard,
+        .depthClearValue = 1.0f,
+        .clearDepth      = 1.0f,
+      },
+    });
+}
+
+/* Marks a page and its ancestors as requested, the ancestors keep their slots
+ * and non-resident ones are requested as well */
+static void virtual_texture_request_page(wgpu_virtual_texture_t* vt,
+                                         uint32_t x, uint32_t y,
+                                         uint32_t level)
+{
+  for (; level < vt->level_count; ++level, x /= 2u, y /= 2u) {
+    const uint32_t pages = vt->pages_per_side >> level;
+    const uint32_t page  = vt->level_offsets[level] + y * pages + x;
+    if (vt->page_serials[page] == vt->serial) {
+      return;
+    }
+    vt->page_serials[page] = vt->serial;
+    ++vt->stats.requested_page_count;
+
+    const int32_t slot = vt->page_slots[page];
+    if (slot != VIRTUAL_TEXTURE_NO_SLOT) {
+      vt->slot_serials[slot] = vt->serial;
+    }
+    else {
+      vt->requests[vt->request_count++] = page;
+    }
+  }
+}
+
+/* Coarser levels have higher page indices */
+static int virtual_texture_compare_requests(const void* a, const void* b)
+{
+  const uint32_t page_a = *(const uint32_t*)a;
+  const uint32_t page_b = *(const uint32_t*)b;
+  return (page_a < page_b) - (page_a > page_b);
+}
+
+static void virtual_texture_on_feedback_read(const void* data, uint64_t size,
+                                             void* user_data)
+{
+  wgpu_virtual_texture_t* vt = (wgpu_virtual_texture_t*)user_data;
+  vt->readback.pending       = false;
+  if (data == NULL
+      || size < (uint64_t)vt->readback.bytes_per_row * vt->readback.height) {
+    return;
+  }
+
+  // The previous requests are replaced by the pages visible now
+  ++vt->serial;
+  vt->request_count              = 0;
+  vt->next_request               = 0;
+  vt->stats.requested_page_count = 0;
+  const uint8_t* rows            = (const uint8_t*)data;
+  for (uint32_t y = 0; y < vt->readback.height; ++y) {
+    const uint32_t* row
+      = (const uint32_t*)(rows + (uint64_t)y * vt->readback.bytes_per_row);
+    uint32_t previous_id = WGPU_VIRTUAL_TEXTURE_INVALID_PAGE;
+    for (uint32_t x = 0; x < vt->readback.width; ++x) {
+      const uint32_t id = row[x];
+      if (id == previous_id || id == WGPU_VIRTUAL_TEXTURE_INVALID_PAGE) {
+        continue;
+      }
+      previous_id          = id;
+      const uint32_t px    = id & 0xfffu;
+      const uint32_t py    = (id >> 12u) & 0xfffu;
+      const uint32_t level = id >> 24u;
+      if (level < vt->level_count && px < (vt->pages_per_side >> level)
+          && py < (vt->pages_per_side >> level)) {
+        virtual_texture_request_page(vt, px, py, level);
+      }
+    }
+  }
+  qsort(vt->requests, vt->request_count, sizeof(uint32_t),
+        virtual_texture_compare_requests);
+  ++vt->stats.feedback_count;
+}
+
+void wgpu_virtual_texture_end_feedback_pass(wgpu_virtual_texture_t* vt,
+                                            WGPUCommandEncoder cmd_enc,
+                                            WGPURenderPassEncoder rpass_enc)
+{
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+  wgpuCommandEncoderCopyTextureToBuffer(
+    cmd_enc,
+    &(WGPUImageCopyTexture){
+      .texture  = vt->feedback.texture,
+      .mipLevel = 0,
+      .origin   = (WGPUOrigin3D){0},
+      .aspect   = WGPUTextureAspect_All,
+    },
+    &(WGPUImageCopyBuffer){
+      .buffer = vt->feedback.buffer,
+      .layout = (WGPUTextureDataLayout){
+        .offset       = 0,
+        .bytesPerRow  = vt->feedback.bytes_per_row,
+        .rowsPerImage = vt->feedback.height,
+      },
+    },
+    &(WGPUExtent3D){
+      .width              = vt->feedback.width,
+      .height             = vt->feedback.height,
+      .depthOrArrayLayers = 1,
+    });
+
+  vt->readback.width         = vt->feedback.width;
+  vt->readback.height        = vt->feedback.height;
+  vt->readback.bytes_per_row = vt->feedback.bytes_per_row;
+  vt->readback.pending       = wgpu_buffer_read_async(
+    vt->wgpu_context, vt->feedback.buffer, 0,
+    (uint64_t)vt->feedback.bytes_per_row * vt->feedback.height,
+    virtual_texture_on_feedback_read, vt);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Page streaming
+ * -------------------------------------------------------------------------- */
+
+/* Free slot, or the least recently used one not visible in the last feedback.
+ * Returns false if the whole cache is visible. */
+static bool virtual_texture_find_slot(wgpu_virtual_texture_t* vt,
+                                      uint32_t* slot)
+{
+  const int32_t pinned_page = (int32_t)vt->page_count - 1;
+  bool found                = false;
+  uint32_t oldest_serial    = vt->serial;
+  for (uint32_t i = 0; i < vt->slot_count; ++i) {
+    if (vt->slot_pages[i] == VIRTUAL_TEXTURE_NO_SLOT) {
+      *slot = i;
+      return true;
+    }
+    if (vt->slot_pages[i] != pinned_page && vt->slot_serials[i] < oldest_serial) {
+      oldest_serial = vt->slot_serials[i];
+      *slot         = i;
+      found         = true;
+    }
+  }
+  return found;
+}
+
+/* A non-resident page points to the slot of its nearest resident ancestor */
+static void virtual_texture_update_indirection(wgpu_virtual_texture_t* vt)
+{
+  for (int32_t level = (int32_t)vt->level_count - 1; level >= 0; --level) {
+    const uint32_t pages  = vt->pages_per_side >> level;
+    const uint32_t offset = vt->level_offsets[level];
+    for (uint32_t y = 0; y < pages; ++y) {
+      for (uint32_t x = 0; x < pages; ++x) {
+        const uint32_t page = offset + y * pages + x;
+        const int32_t slot  = vt->page_slots[page];
+        uint8_t* entry      = vt->indirection + (uint64_t)page * 4u;
+        if (slot != VIRTUAL_TEXTURE_NO_SLOT) {
+          entry[0] = (uint8_t)((uint32_t)slot % vt->cache_size);
+          entry[1] = (uint8_t)((uint32_t)slot / vt->cache_size);
+          entry[2] = (uint8_t)level;
+          entry[3] = 1u;
+        }
+        else {
+          const uint32_t parent = vt->level_offsets[level + 1]
+                                  + (y / 2u) * (pages / 2u) + x / 2u;
+          memcpy(entry, vt->indirection + (uint64_t)parent * 4u, 4u);
+        }
+      }
+    }
+
+    wgpuQueueWriteTexture(vt->wgpu_context->queue,
+      &(WGPUImageCopyTexture) {
+        .texture  = vt->indirection_texture,
+        .mipLevel = (uint32_t)level,
+        .origin   = (WGPUOrigin3D){0},
+        .aspect   = WGPUTextureAspect_All,
+      },
+      vt->indirection + (uint64_t)offset * 4u, (size_t)pages * pages * 4u,
+      &(WGPUTextureDataLayout){
+        .offset       = 0,
+        .bytesPerRow  = pages * 4u,
+        .rowsPerImage = pages,
+      },
+      &(WGPUExtent3D){
+        .width              = pages,
+        .height             = pages,
+        .depthOrArrayLayers = 1,
+      });
+  }
+  vt->indirection_dirty = false;
+}
+
+void wgpu_virtual_texture_update(wgpu_virtual_texture_t* vt)
+{
+  for (uint32_t uploads = 0;
+       uploads < vt->pages_per_frame && vt->next_request < vt->request_count;
+       ++uploads) {
+    const uint32_t page = vt->requests[vt->next_request];
+    if (vt->page_slots[page] != VIRTUAL_TEXTURE_NO_SLOT) {
+      ++vt->next_request;
+      continue;
+    }
+    uint32_t slot = 0;
+    if (!virtual_texture_find_slot(vt, &slot)) {
+      // The finer pages wait until the view frees slots
+      break;
+    }
+    virtual_texture_upload_page(vt, page, slot);
+    ++vt->next_request;
+  }
+  vt->stats.pending_page_count = vt->request_count - vt->next_request;
+
+  if (vt->indirection_dirty) {
+    virtual_texture_update_indirection(vt);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Getters
+ * -------------------------------------------------------------------------- */
+
+WGPUTextureView
+wgpu_virtual_texture_get_indirection_view(wgpu_virtual_texture_t* vt)
+{
+  return vt->indirection_view;
+}
+
+WGPUTextureView wgpu_virtual_texture_get_cache_view(wgpu_virtual_texture_t* vt)
+{
+  return vt->cache_view;
+}
+
+WGPUSampler wgpu_virtual_texture_get_sampler(wgpu_virtual_texture_t* vt)
+{
+  return vt->sampler;
+}
+
+void wgpu_virtual_texture_get_params(wgpu_virtual_texture_t* vt,
+                                     wgpu_virtual_texture_params_t* params)
+{
+  *params = (wgpu_virtual_texture_params_t){
+    .size_in_pages       = {(float)vt->pages_per_side,
+                            (float)vt->pages_per_side},
+    .level_count         = (float)vt->level_count,
+    .cache_size_in_pages = (float)vt->cache_size,
+  };
+}
+
+const wgpu_virtual_texture_stats_t*
+wgpu_virtual_texture_get_stats(wgpu_virtual_texture_t* vt)
+{
+  return &vt->stats;
+}
@@ -0,0 +1,151 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include "context.h"
+
+/* Texels of a page without and with the border on each side */
+#define WGPU_VIRTUAL_TEXTURE_PAGE_SIZE 128u
+#define WGPU_VIRTUAL_TEXTURE_PAGE_BORDER 4u
+#define WGPU_VIRTUAL_TEXTURE_SLOT_SIZE                                         \
+  (WGPU_VIRTUAL_TEXTURE_PAGE_SIZE + 2u * WGPU_VIRTUAL_TEXTURE_PAGE_BORDER)
+/* Feedback target: one texel per block of 8x8 frame buffer texels */
+#define WGPU_VIRTUAL_TEXTURE_FEEDBACK_SCALE 8u
+#define WGPU_VIRTUAL_TEXTURE_FEEDBACK_FORMAT WGPUTextureFormat_R32Uint
+#define WGPU_VIRTUAL_TEXTURE_FEEDBACK_DEPTH_FORMAT WGPUTextureFormat_Depth24Plus
+/* Feedback value of texels without virtual texture */
+#define WGPU_VIRTUAL_TEXTURE_INVALID_PAGE 0xffffffffu
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU virtual texture
+ *
+ * Samples a texture far larger than the GPU memory it occupies: the mip chain
+ * is split into pages of 128x128 texels, only the pages visible on screen are
+ * resident in a physical page cache texture. Texture detail then scales with
+ * storage instead of VRAM.
+ *
+ *  * the page file, baked once from a source image with
+ *    wgpu_virtual_texture_bake(), holds every page of every level with its
+ *    border, so bilinear filtering never reads a neighbouring slot. It is
+ *    mapped with file_map(), pages stream from the packed asset archive when
+ *    the file is in the mounted archive
+ *  * a feedback pass renders the scene into a low resolution R32Uint target,
+ *    every texel the page ID (x, y, level) the fragment samples. The target
+ *    is read back asynchronously (see readback.h) into the page request list,
+ *    coarse pages first
+ *  * wgpu_virtual_texture_update() uploads a budget of requested pages per
+ *    frame through the upload ring into free or least recently used slots
+ *  * the indirection texture has one texel per page and a mip level per
+ *    virtual level, pointing to the slot of the page or of its nearest
+ *    resident ancestor. The coarsest page is always resident, so missing
+ *    pages sample a blurrier level instead of nothing
+ *
+ * The shaders are prepended with wgpu_virtual_texture_add_wgsl() and sample
+ * with:
+ *
+ *   let level = vt_level(vt, uv, 0.0);
+ *   let color = vt_sample(vt_indirection, vt_cache, vt_sampler, vt, uv, level);
+ *
+ * The feedback pipeline writes vt_page_id(vt, uv, vt_level(vt, uv, bias))
+ * with the bias -log2(WGPU_VIRTUAL_TEXTURE_FEEDBACK_SCALE), the derivatives
+ * of the smaller target are that much larger. Texture coordinates wrap.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_virtual_texture wgpu_virtual_texture_t;
+
+typedef struct wgpu_virtual_texture_desc_t {
+  /* Page file baked with wgpu_virtual_texture_bake() */
+  const char* filename;
+  /* Slots per side of the page cache, 0 = 16 (256 pages) */
+  uint32_t cache_size_in_pages;
+  /* Page uploads per frame, 0 = 8 */
+  uint32_t pages_per_frame;
+  /* Samples the pages as sRGB */
+  bool srgb;
+} wgpu_virtual_texture_desc_t;
+
+typedef struct wgpu_virtual_texture_stats_t {
+  uint32_t virtual_size;  /* texels per side of level 0 */
+  uint32_t level_count;   /* levels down to one page */
+  uint32_t page_count;    /* pages of all levels */
+  uint32_t slot_count;    /* pages the cache holds */
+  uint32_t resident_page_count;
+  uint32_t requested_page_count; /* last feedback, with the ancestors */
+  uint32_t pending_page_count;   /* requested pages not resident yet */
+  uint32_t uploaded_page_count;  /* since creation */
+  uint32_t evicted_page_count;   /* since creation */
+  uint32_t feedback_count;       /* feedback readbacks processed */
+  uint64_t virtual_bytes;        /* all levels, RGBA8 */
+  uint64_t cache_bytes;          /* page cache and indirection texture */
+} wgpu_virtual_texture_stats_t;
+
+/* Shader parameters, uniform vec4 VirtualTexture of the WGSL functions */
+typedef struct wgpu_virtual_texture_params_t {
+  float size_in_pages[2]; /* pages per side of level 0 */
+  float level_count;
+  float cache_size_in_pages;
+} wgpu_virtual_texture_params_t;
+
+/* Prepends the WGSL declarations of struct VirtualTexture, vt_level(),
+ * vt_page_id() and vt_sample() to a WGSL source, like
+ * wgpu_add_storage_precision(). The returned string has to be freed. */
+char* wgpu_virtual_texture_add_wgsl(const char* wgsl_source);
+
+/**
+ * @brief Bakes the page file of an RGBA image. The image is resized to
+ * size x size texels (a power of two, at least one page), the levels are box
+ * filtered down to one page. Borders wrap around for tiling textures and are
+ * clamped at the edges otherwise.
+ * @return false if the image cannot be loaded or the file cannot be written
+ */
+bool wgpu_virtual_texture_bake(const char* image_filename,
+                               const char* filename, uint32_t size, bool wrap);
+
+/**
+ * @brief Maps the page file and creates the page cache and the indirection
+ * texture, the feedback target is created by the first feedback pass. The
+ * coarsest page is uploaded right away.
+ * @return NULL if the page file cannot be mapped or is invalid
+ */
+wgpu_virtual_texture_t*
+wgpu_virtual_texture_create(wgpu_context_t* wgpu_context,
+                            const wgpu_virtual_texture_desc_t* desc);
+void wgpu_virtual_texture_destroy(wgpu_virtual_texture_t* vt);
+
+/**
+ * @brief Begins the feedback pass into the target of the frame buffer size
+ * divided by WGPU_VIRTUAL_TEXTURE_FEEDBACK_SCALE, cleared to
+ * WGPU_VIRTUAL_TEXTURE_INVALID_PAGE, with a depth attachment of
+ * WGPU_VIRTUAL_TEXTURE_FEEDBACK_DEPTH_FORMAT. The target is recreated when the
+ * frame buffer is resized.
+ * @return NULL while the readback of the previous feedback is in flight, the
+ * pass is skipped then
+ */
+WGPURenderPassEncoder
+wgpu_virtual_texture_begin_feedback_pass(wgpu_virtual_texture_t* vt,
+                                         WGPUCommandEncoder cmd_enc,
+                                         uint32_t width, uint32_t height);
+/* Ends the feedback pass, copies the target and starts its readback */
+void wgpu_virtual_texture_end_feedback_pass(wgpu_virtual_texture_t* vt,
+                                            WGPUCommandEncoder cmd_enc,
+                                            WGPURenderPassEncoder rpass_enc);
+
+/**
+ * @brief Uploads the pending pages of the frame budget and updates the
+ * indirection texture, called once per frame before the passes sampling the
+ * virtual texture are submitted.
+ */
+void wgpu_virtual_texture_update(wgpu_virtual_texture_t* vt);
+
+/* Bindings of the WGSL functions, valid for the lifetime of the virtual
+ * texture: the indirection texture (texture_2d<u32>, all levels), the page
+ * cache (texture_2d<f32>) and its linear clamping sampler */
+WGPUTextureView
+wgpu_virtual_texture_get_indirection_view(wgpu_virtual_texture_t* vt);
+WGPUTextureView wgpu_virtual_texture_get_cache_view(wgpu_virtual_texture_t* vt);
+WGPUSampler wgpu_virtual_texture_get_sampler(wgpu_virtual_texture_t* vt);
+void wgpu_virtual_texture_get_params(wgpu_virtual_texture_t* vt,
+                                     wgpu_virtual_texture_params_t* params);
+const wgpu_virtual_texture_stats_t*
+wgpu_virtual_texture_get_stats(wgpu_virtual_texture_t* vt);
+
+#endif /* VIRTUAL_TEXTURE_H */
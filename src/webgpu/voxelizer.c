@@ -0,0 +1,721 @@
+#include "voxelizer.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "buffer.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Levels of the largest grid, 256^3 down to 1^3 */
+#define VOXELIZER_MAX_LEVELS 9u
+#define VOXELIZER_WORKGROUP_SIZE 4u
+
+/* Grid parameters, matches VoxelizerParams in WGSL */
+typedef struct voxelizer_params_t {
+  vec3 bounds_min;
+  float voxel_size;
+  uint32_t grid_size;
+  uint32_t padding[3];
+} voxelizer_params_t;
+
+// clang-format off
+static const char* voxelizer_params_wgsl = CODE(
+  struct VoxelizerParams {
+    boundsMin : vec3f,
+    voxelSize : f32,
+    gridSize  : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> params : VoxelizerParams;
+);
+// clang-format on
+
+/* Voxelization pass, one vertex per triangle corner pulled from the triangle
+ * soup, the grid space is voxel units with the pixels along xy */
+// clang-format off
+static const char* voxelizer_voxelize_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> positions : array<f32>;
+  @group(0) @binding(2) var<storage, read_write> voxels : array<atomic<u32>>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) depth : f32,
+    @location(1) @interpolate(flat) bounds : vec4f,
+    @location(2) @interpolate(flat) axis : u32,
+  }
+
+  fn loadVertex(index : u32) -> vec3f {
+    let p = vec3f(positions[index * 3u], positions[index * 3u + 1u],
+                  positions[index * 3u + 2u]);
+    return (p - params.boundsMin) / params.voxelSize;
+  }
+
+  // Swizzles the dominant axis into z and back
+  fn projectAxis(p : vec3f, axis : u32) -> vec3f {
+    if (axis == 0u) {
+      return p.yzx;
+    }
+    if (axis == 1u) {
+      return p.zxy;
+    }
+    return p;
+  }
+
+  fn unprojectAxis(p : vec3i, axis : u32) -> vec3i {
+    if (axis == 0u) {
+      return p.zxy;
+    }
+    if (axis == 1u) {
+      return p.yzx;
+    }
+    return p;
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    let triangle = vertexIndex / 3u;
+    let corner   = vertexIndex % 3u;
+    let v0 = loadVertex(triangle * 3u);
+    let v1 = loadVertex(triangle * 3u + 1u);
+    let v2 = loadVertex(triangle * 3u + 2u);
+
+    let n = abs(cross(v1 - v0, v2 - v0));
+    var axis = 2u;
+    if (n.x > n.y && n.x > n.z) {
+      axis = 0u;
+    }
+    else if (n.y > n.z) {
+      axis = 1u;
+    }
+    var p = array<vec3f, 3>(projectAxis(v0, axis), projectAxis(v1, axis),
+                            projectAxis(v2, axis));
+
+    // Edges as lines with the interior on the positive side, moved outwards
+    // by half a pixel diagonal, the corner is where its two edges intersect
+    let e1      = p[1] - p[0];
+    let e2      = p[2] - p[0];
+    let normal  = cross(e1, e2);
+    let facing  = select(-1.0, 1.0, normal.z >= 0.0);
+    let prev    = p[(corner + 2u) % 3u];
+    let current = p[corner];
+    let next    = p[(corner + 1u) % 3u];
+    var edge0 = cross(vec3f(prev.xy, 1.0), vec3f(current.xy, 1.0)) * facing;
+    var edge1 = cross(vec3f(current.xy, 1.0), vec3f(next.xy, 1.0)) * facing;
+    edge0.z += 0.5 * (abs(edge0.x) + abs(edge0.y));
+    edge1.z += 0.5 * (abs(edge1.x) + abs(edge1.y));
+    let corner2d = cross(edge0, edge1);
+    var xy = current.xy;
+    if (abs(corner2d.z) > 1e-6) {
+      xy = corner2d.xy / corner2d.z;
+    }
+
+    // Depth of the moved corner on the plane of the triangle
+    let nz    = select(min(normal.z, -1e-6), max(normal.z, 1e-6),
+                       normal.z >= 0.0);
+    let depth = p[0].z - dot(normal.xy, xy - p[0].xy) / nz;
+
+    let grid = f32(params.gridSize);
+    var output : VertexOutput;
+    output.position = vec4f(xy.x / grid * 2.0 - 1.0, 1.0 - xy.y / grid * 2.0,
+                            0.5, 1.0);
+    output.depth    = depth;
+    output.bounds   = vec4f(min(min(p[0].xy, p[1].xy), p[2].xy) - 0.5,
+                            max(max(p[0].xy, p[1].xy), p[2].xy) + 0.5);
+    output.axis     = axis;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) {
+    // Depth range of the triangle within the pixel, at most one voxel along
+    // the dominant axis
+    let depthRange = 0.5 * fwidth(input.depth);
+    let center     = input.position.xy;
+    if (any(center < input.bounds.xy) || any(center > input.bounds.zw)) {
+      discard;
+    }
+
+    let n  = i32(params.gridSize);
+    let xy = vec2i(center);
+    let z0 = clamp(i32(floor(input.depth - depthRange)), 0, n - 1);
+    let z1 = clamp(i32(floor(input.depth + depthRange)), 0, n - 1);
+    for (var z = z0; z <= z1; z++) {
+      let voxel = unprojectAxis(vec3i(xy, z), input.axis);
+      let index = u32(voxel.x + (voxel.y + voxel.z * n) * n);
+      atomicOr(&voxels[index / 32u], 1u << (index % 32u));
+    }
+  }
+);
+// clang-format on
+
+/* Resolve of the voxel bits into level 0 */
+// clang-format off
+static const char* voxelizer_resolve_wgsl = CODE(
+  @group(0) @binding(1) var<storage, read> voxels : array<u32>;
+  @group(0) @binding(2) var level : texture_storage_3d<r32uint, write>;
+
+  @compute @workgroup_size(4, 4, 4)
+  fn main(@builtin(global_invocation_id) id : vec3u) {
+    let n = params.gridSize;
+    if (any(id >= vec3u(n))) {
+      return;
+    }
+    let index    = id.x + (id.y + id.z * n) * n;
+    let occupied = (voxels[index / 32u] >> (index % 32u)) & 1u;
+    textureStore(level, id, vec4u(occupied * 255u, 0u, 0u, 0u));
+  }
+);
+// clang-format on
+
+/* Mip level from the 8 child voxels, rounded up so thin geometry stays in the
+ * coarse levels */
+// clang-format off
+static const char* voxelizer_mip_wgsl = CODE(
+  @group(0) @binding(0) var source : texture_3d<u32>;
+  @group(0) @binding(1) var level : texture_storage_3d<r32uint, write>;
+
+  @compute @workgroup_size(4, 4, 4)
+  fn main(@builtin(global_invocation_id) id : vec3u) {
+    if (any(id >= textureDimensions(level))) {
+      return;
+    }
+    var sum = 0u;
+    for (var i = 0u; i < 8u; i++) {
+      let child = id * 2u + vec3u(i & 1u, (i >> 1u) & 1u, i >> 2u);
+      sum += textureLoad(source, child, 0).r;
+    }
+    textureStore(level, id, vec4u((sum + 7u) / 8u, 0u, 0u, 0u));
+  }
+);
+// clang-format on
+
+/**
+ * @brief Voxelizer class
+ */
+struct wgpu_voxelizer {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  /* Triangle soup and its bounds */
+  wgpu_buffer_t triangles;
+  uint32_t triangle_count;
+  vec3 triangles_min;
+  vec3 triangles_max;
+  /* Grid */
+  uint32_t grid_size;
+  uint32_t level_count;
+  voxelizer_params_t params;
+  wgpu_buffer_t params_buffer;
+  wgpu_buffer_t voxel_bits;
+  WGPUTexture texture;
+  WGPUTextureView view;
+  WGPUTextureView level_views[VOXELIZER_MAX_LEVELS];
+  /* Target of the voxelization pass, only sets the viewport size */
+  WGPUTexture attachment;
+  WGPUTextureView attachment_view;
+  /* Pipelines, the layouts are derived from the shaders */
+  struct {
+    WGPURenderPipeline pipeline;
+    WGPUBindGroupLayout bind_group_layout;
+  } voxelize;
+  struct {
+    WGPUComputePipeline pipeline;
+    WGPUBindGroupLayout bind_group_layout;
+  } resolve, mip;
+};
+
+/* Pipelines */
+
+static char* voxelizer_create_wgsl(const char* shader)
+{
+  const size_t params_length = strlen(voxelizer_params_wgsl);
+  const size_t shader_length = strlen(shader);
+  char* wgsl = (char*)malloc(params_length + shader_length + 2);
+  memcpy(wgsl, voxelizer_params_wgsl, params_length);
+  wgsl[params_length] = '\n';
+  memcpy(wgsl + params_length + 1, shader, shader_length + 1);
+  return wgsl;
+}
+
+static void voxelizer_create_voxelize_pipeline(wgpu_voxelizer_t* voxelizer)
+{
+  wgpu_context_t* wgpu_context = voxelizer->wgpu_context;
+  char* wgsl_code              = voxelizer_create_wgsl(voxelizer_voxelize_wgsl);
+
+  /* Nothing is written to the attachment */
+  WGPUColorTargetState color_target_state = {
+    .format    = WGPUTextureFormat_R8Unorm,
+    .writeMask = WGPUColorWriteMask_None,
+  };
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                wgpu_context, &(wgpu_vertex_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Vertex shader WGSL
+                  .label            = "Voxelizer vertex shader",
+                  .wgsl_code.source = wgsl_code,
+                  .entry            = "vs_main",
+                },
+                .buffer_count = 0,
+                .buffers      = NULL,
+              });
+
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                wgpu_context, &(wgpu_fragment_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Fragment shader WGSL
+                  .label            = "Voxelizer fragment shader",
+                  .wgsl_code.source = wgsl_code,
+                  .entry            = "fs_main",
+                },
+                .target_count = 1,
+                .targets      = &color_target_state,
+              });
+
+  voxelizer->voxelize.pipeline = wgpu_create_render_pipeline(
+    wgpu_context, &(WGPURenderPipelineDescriptor){
+                    .label     = "Voxelizer pipeline",
+                    .primitive = (WGPUPrimitiveState){
+                      .topology  = WGPUPrimitiveTopology_TriangleList,
+                      .frontFace = WGPUFrontFace_CCW,
+                      .cullMode  = WGPUCullMode_None,
+                    },
+                    .vertex      = vertex_state,
+                    .fragment    = &fragment_state,
+                    .multisample = (WGPUMultisampleState){
+                      .count = 1,
+                      .mask  = 0xFFFFFFFF,
+                    },
+                  });
+  ASSERT(voxelizer->voxelize.pipeline != NULL);
+  voxelizer->voxelize.bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(voxelizer->voxelize.pipeline, 0);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  free(wgsl_code);
+}
+
+static WGPUComputePipeline
+voxelizer_create_compute_pipeline(wgpu_context_t* wgpu_context,
+                                  const char* label, const char* wgsl_code)
+{
+  wgpu_shader_t comp_shader = wgpu_shader_create(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    /* Compute shader WGSL */
+                    .label            = label,
+                    .wgsl_code.source = wgsl_code,
+                    .entry            = "main",
+                  });
+  WGPUComputePipeline pipeline = wgpu_create_compute_pipeline(
+    wgpu_context, &(WGPUComputePipelineDescriptor){
+                    .label   = label,
+                    .compute = comp_shader.programmable_stage_descriptor,
+                  });
+  ASSERT(pipeline != NULL);
+  wgpu_shader_release(&comp_shader);
+  return pipeline;
+}
+
+static void voxelizer_create_pipelines(wgpu_voxelizer_t* voxelizer)
+{
+  wgpu_context_t* wgpu_context = voxelizer->wgpu_context;
+
+  voxelizer_create_voxelize_pipeline(voxelizer);
+
+  char* wgsl_code = voxelizer_create_wgsl(voxelizer_resolve_wgsl);
+  voxelizer->resolve.pipeline = voxelizer_create_compute_pipeline(
+    wgpu_context, "Voxelizer resolve pipeline", wgsl_code);
+  voxelizer->resolve.bind_group_layout
+    = wgpuComputePipelineGetBindGroupLayout(voxelizer->resolve.pipeline, 0);
+  free(wgsl_code);
+
+  voxelizer->mip.pipeline = voxelizer_create_compute_pipeline(
+    wgpu_context, "Voxelizer mip pipeline", voxelizer_mip_wgsl);
+  voxelizer->mip.bind_group_layout
+    = wgpuComputePipelineGetBindGroupLayout(voxelizer->mip.pipeline, 0);
+}
+
+/* Grid */
+
+static void voxelizer_release_grid(wgpu_voxelizer_t* voxelizer)
+{
+  for (uint32_t i = 0; i < voxelizer->level_count; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, voxelizer->level_views[i])
+  }
+  WGPU_RELEASE_RESOURCE(TextureView, voxelizer->view)
+  WGPU_RELEASE_RESOURCE(Texture, voxelizer->texture)
+  WGPU_RELEASE_RESOURCE(TextureView, voxelizer->attachment_view)
+  WGPU_RELEASE_RESOURCE(Texture, voxelizer->attachment)
+  wgpu_destroy_buffer(&voxelizer->voxel_bits);
+  voxelizer->level_count = 0;
+}
+
+static void voxelizer_create_grid(wgpu_voxelizer_t* voxelizer)
+{
+  wgpu_context_t* wgpu_context = voxelizer->wgpu_context;
+  const uint32_t n             = voxelizer->grid_size;
+
+  uint32_t level_count = 1;
+  while ((n >> level_count) > 0) {
+    ++level_count;
+  }
+  voxelizer->level_count = level_count;
+
+  /* One bit per voxel */
+  voxelizer->voxel_bits = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Voxelizer voxel bits",
+                    .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+                    .size  = MAX(n * n * n / 8, 4u),
+                  });
+
+  voxelizer->texture = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = voxelizer->label,
+      .usage = WGPUTextureUsage_StorageBinding
+               | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_3D,
+      .size          = (WGPUExtent3D){
+        .width              = n,
+        .height             = n,
+        .depthOrArrayLayers = n,
+      },
+      .format        = WGPU_VOXELIZER_FORMAT,
+      .mipLevelCount = level_count,
+      .sampleCount   = 1,
+    });
+  ASSERT(voxelizer->texture != NULL);
+
+  WGPUTextureViewDescriptor view_desc = {
+    .label           = "Voxelizer view",
+    .format          = WGPU_VOXELIZER_FORMAT,
+    .dimension       = WGPUTextureViewDimension_3D,
+    .baseMipLevel    = 0,
+    .mipLevelCount   = level_count,
+    .baseArrayLayer  = 0,
+    .arrayLayerCount = 1,
+    .aspect          = WGPUTextureAspect_All,
+  };
+  voxelizer->view = wgpuTextureCreateView(voxelizer->texture, &view_desc);
+  ASSERT(voxelizer->view != NULL);
+  view_desc.label         = "Voxelizer level view";
+  view_desc.mipLevelCount = 1;
+  for (uint32_t i = 0; i < level_count; ++i) {
+    view_desc.baseMipLevel = i;
+    voxelizer->level_views[i]
+      = wgpuTextureCreateView(voxelizer->texture, &view_desc);
+    ASSERT(voxelizer->level_views[i] != NULL);
+  }
+
+  voxelizer->attachment = wgpuDeviceCreateTexture(
+    wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = "Voxelizer attachment",
+      .usage         = WGPUTextureUsage_RenderAttachment,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = n,
+        .height             = n,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = WGPUTextureFormat_R8Unorm,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(voxelizer->attachment != NULL);
+  voxelizer->attachment_view
+    = wgpuTextureCreateView(voxelizer->attachment, NULL);
+  ASSERT(voxelizer->attachment_view != NULL);
+}
+
+/* Fits the cubic grid around the triangles with a margin of one voxel */
+static void voxelizer_update_bounds(wgpu_voxelizer_t* voxelizer)
+{
+  vec3 center, extent;
+  glm_vec3_center(voxelizer->triangles_min, voxelizer->triangles_max, center);
+  glm_vec3_sub(voxelizer->triangles_max, voxelizer->triangles_min, extent);
+  const float n    = (float)voxelizer->grid_size;
+  const float size = MAX(glm_vec3_max(extent), 1e-4f) * n / (n - 2.0f);
+
+  glm_vec3_subs(center, 0.5f * size, voxelizer->params.bounds_min);
+  voxelizer->params.voxel_size = size / n;
+  voxelizer->params.grid_size  = voxelizer->grid_size;
+  wgpu_queue_write_buffer(voxelizer->wgpu_context,
+                          voxelizer->params_buffer.buffer, 0,
+                          &voxelizer->params, sizeof(voxelizer->params));
+}
+
+/* Voxelizer creating / destroying */
+
+wgpu_voxelizer_t* wgpu_voxelizer_create(wgpu_context_t* wgpu_context,
+                                        const wgpu_voxelizer_desc_t* desc)
+{
+  const uint32_t grid_size = desc->grid_size > 0 ? desc->grid_size : 128u;
+  ASSERT(grid_size >= 4 && grid_size <= WGPU_VOXELIZER_MAX_GRID_SIZE
+         && (grid_size & (grid_size - 1)) == 0);
+
+  wgpu_voxelizer_t* voxelizer
+    = (wgpu_voxelizer_t*)calloc(1, sizeof(*voxelizer));
+  voxelizer->wgpu_context = wgpu_context;
+  voxelizer->label = desc->label != NULL ? desc->label : "Voxelizer texture";
+  voxelizer->grid_size = grid_size;
+
+  voxelizer->params_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Voxelizer parameters",
+                    .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+                    .size  = sizeof(voxelizer_params_t),
+                  });
+  voxelizer_create_pipelines(voxelizer);
+  voxelizer_create_grid(voxelizer);
+  voxelizer_update_bounds(voxelizer);
+
+  return voxelizer;
+}
+
+void wgpu_voxelizer_destroy(wgpu_voxelizer_t* voxelizer)
+{
+  if (voxelizer == NULL) {
+    return;
+  }
+
+  voxelizer_release_grid(voxelizer);
+  if (voxelizer->triangles.buffer != NULL) {
+    wgpu_destroy_buffer(&voxelizer->triangles);
+  }
+  wgpu_destroy_buffer(&voxelizer->params_buffer);
+  WGPU_RELEASE_RESOURCE(RenderPipeline, voxelizer->voxelize.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, voxelizer->voxelize.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, voxelizer->resolve.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, voxelizer->resolve.bind_group_layout)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, voxelizer->mip.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, voxelizer->mip.bind_group_layout)
+  free(voxelizer);
+}
+
+void wgpu_voxelizer_set_triangles(wgpu_voxelizer_t* voxelizer,
+                                  const float* positions,
+                                  uint32_t triangle_count)
+{
+  if (voxelizer->triangles.buffer != NULL) {
+    wgpu_destroy_buffer(&voxelizer->triangles);
+  }
+  voxelizer->triangle_count = triangle_count;
+  glm_vec3_zero(voxelizer->triangles_min);
+  glm_vec3_zero(voxelizer->triangles_max);
+  if (triangle_count == 0) {
+    voxelizer_update_bounds(voxelizer);
+    return;
+  }
+
+  glm_vec3_copy((vec3){FLT_MAX, FLT_MAX, FLT_MAX}, voxelizer->triangles_min);
+  glm_vec3_copy((vec3){-FLT_MAX, -FLT_MAX, -FLT_MAX},
+                voxelizer->triangles_max);
+  for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+    glm_vec3_minv(voxelizer->triangles_min, (float*)&positions[i * 3],
+                  voxelizer->triangles_min);
+    glm_vec3_maxv(voxelizer->triangles_max, (float*)&positions[i * 3],
+                  voxelizer->triangles_max);
+  }
+
+  const uint32_t size = triangle_count * 9 * sizeof(float);
+  voxelizer->triangles = wgpu_create_buffer(
+    voxelizer->wgpu_context, &(wgpu_buffer_desc_t){
+                               .label   = "Voxelizer triangles",
+                               .usage   = WGPUBufferUsage_Storage,
+                               .size    = size,
+                               .initial = {
+                                 .data = positions,
+                                 .size = size,
+                               },
+                             });
+  voxelizer_update_bounds(voxelizer);
+}
+
+void wgpu_voxelizer_set_grid_size(wgpu_voxelizer_t* voxelizer,
+                                  uint32_t grid_size)
+{
+  ASSERT(grid_size >= 4 && grid_size <= WGPU_VOXELIZER_MAX_GRID_SIZE
+         && (grid_size & (grid_size - 1)) == 0);
+  if (grid_size == voxelizer->grid_size) {
+    return;
+  }
+
+  voxelizer_release_grid(voxelizer);
+  voxelizer->grid_size = grid_size;
+  voxelizer_create_grid(voxelizer);
+  voxelizer_update_bounds(voxelizer);
+}
+
+uint32_t wgpu_voxelizer_get_grid_size(wgpu_voxelizer_t* voxelizer)
+{
+  return voxelizer->grid_size;
+}
+
+/* Voxelization */
+
+static void voxelizer_record_voxelize_pass(wgpu_voxelizer_t* voxelizer,
+                                           WGPUCommandEncoder cmd_enc)
+{
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = voxelizer->params_buffer.buffer,
+      .size    = voxelizer->params_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = voxelizer->triangles.buffer,
+      .size    = voxelizer->triangles.size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = voxelizer->voxel_bits.buffer,
+      .size    = voxelizer->voxel_bits.size,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    voxelizer->wgpu_context,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Voxelizer bind group",
+      .layout     = voxelizer->voxelize.bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(bind_group != NULL);
+
+  WGPURenderPassColorAttachment color_att = {
+    .view       = voxelizer->attachment_view,
+    .loadOp     = WGPULoadOp_Clear,
+    .storeOp    = WGPUStoreOp_Discard,
+    .clearValue = (WGPUColor){0.0, 0.0, 0.0, 0.0},
+  };
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .label                = "Voxelizer render pass",
+               .colorAttachmentCount = 1,
+               .colorAttachments     = &color_att,
+             });
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, voxelizer->voxelize.pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_group, 0, NULL);
+  wgpuRenderPassEncoderDraw(rpass_enc, voxelizer->triangle_count * 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
+
+static void voxelizer_dispatch(WGPUComputePassEncoder cpass_enc,
+                               uint32_t size)
+{
+  const uint32_t groups
+    = (size + VOXELIZER_WORKGROUP_SIZE - 1) / VOXELIZER_WORKGROUP_SIZE;
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, groups, groups, groups);
+}
+
+static void voxelizer_record_mip_chain(wgpu_voxelizer_t* voxelizer,
+                                       WGPUCommandEncoder cmd_enc)
+{
+  wgpu_context_t* wgpu_context = voxelizer->wgpu_context;
+  WGPUComputePassEncoder cpass_enc = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label = "Voxelizer compute pass",
+             });
+
+  /* Level 0 from the voxel bits */
+  WGPUBindGroupEntry resolve_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = voxelizer->params_buffer.buffer,
+      .size    = voxelizer->params_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = voxelizer->voxel_bits.buffer,
+      .size    = voxelizer->voxel_bits.size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      .binding     = 2,
+      .textureView = voxelizer->level_views[0],
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    wgpu_context, &(WGPUBindGroupDescriptor){
+                    .label      = "Voxelizer resolve bind group",
+                    .layout     = voxelizer->resolve.bind_group_layout,
+                    .entryCount = (uint32_t)ARRAY_SIZE(resolve_entries),
+                    .entries    = resolve_entries,
+                  });
+  ASSERT(bind_group != NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, voxelizer->resolve.pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 0, NULL);
+  voxelizer_dispatch(cpass_enc, voxelizer->grid_size);
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+
+  /* Every further level from the previous one */
+  wgpuComputePassEncoderSetPipeline(cpass_enc, voxelizer->mip.pipeline);
+  for (uint32_t level = 1; level < voxelizer->level_count; ++level) {
+    WGPUBindGroupEntry mip_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding     = 0,
+        .textureView = voxelizer->level_views[level - 1],
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = voxelizer->level_views[level],
+      },
+    };
+    bind_group = wgpu_create_bind_group(
+      wgpu_context, &(WGPUBindGroupDescriptor){
+                      .label      = "Voxelizer mip bind group",
+                      .layout     = voxelizer->mip.bind_group_layout,
+                      .entryCount = (uint32_t)ARRAY_SIZE(mip_entries),
+                      .entries    = mip_entries,
+                    });
+    ASSERT(bind_group != NULL);
+    wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, bind_group, 0, NULL);
+    voxelizer_dispatch(cpass_enc, voxelizer->grid_size >> level);
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+  }
+
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+void wgpu_voxelizer_voxelize(wgpu_voxelizer_t* voxelizer,
+                             WGPUCommandEncoder cmd_enc)
+{
+  wgpu_context_t* wgpu_context = voxelizer->wgpu_context;
+
+  wgpu_profiler_begin_scope(wgpu_context->profiler, cmd_enc, "Voxelization");
+  wgpuCommandEncoderClearBuffer(cmd_enc, voxelizer->voxel_bits.buffer, 0,
+                                voxelizer->voxel_bits.size);
+  if (voxelizer->triangle_count > 0) {
+    voxelizer_record_voxelize_pass(voxelizer, cmd_enc);
+  }
+  voxelizer_record_mip_chain(voxelizer, cmd_enc);
+  wgpu_profiler_end_scope(wgpu_context->profiler, cmd_enc);
+}
+
+WGPUTextureView wgpu_voxelizer_get_view(wgpu_voxelizer_t* voxelizer)
+{
+  return voxelizer->view;
+}
+
+uint32_t wgpu_voxelizer_get_level_count(wgpu_voxelizer_t* voxelizer)
+{
+  return voxelizer->level_count;
+}
+
+void wgpu_voxelizer_get_bounds(wgpu_voxelizer_t* voxelizer, vec3 min,
+                               vec3 max)
+{
+  const float size
+    = voxelizer->params.voxel_size * (float)voxelizer->grid_size;
+  glm_vec3_copy(voxelizer->params.bounds_min, min);
+  glm_vec3_adds(voxelizer->params.bounds_min, size, max);
+}
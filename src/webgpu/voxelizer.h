@@ -0,0 +1,82 @@
+#ifndef VOXELIZER_H
+#define VOXELIZER_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* Largest grid, 256^3 voxels, and the format of the voxel texture */
+#define WGPU_VOXELIZER_MAX_GRID_SIZE 256u
+#define WGPU_VOXELIZER_FORMAT WGPUTextureFormat_R32Uint
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU voxelizer
+ *
+ * Voxelizes a triangle soup into a cubic grid in a single render pass (Crassin
+ * & Green, Octree-Based Sparse Voxelization Using the GPU Hardware Rasterizer,
+ * OpenGL Insights 2012). Every triangle is projected along the axis of its
+ * largest normal component onto a grid x grid viewport, so it covers as many
+ * pixels as possible, and each fragment marks the voxels the triangle crosses
+ * within the depth range of the pixel:
+ *
+ *   wgpu_voxelizer_set_triangles(voxelizer, positions, triangle_count);
+ *   wgpu_voxelizer_voxelize(voxelizer, cmd_enc);
+ *   ... read wgpu_voxelizer_get_view(voxelizer) as texture_3d<u32> ...
+ *
+ * Conservative rasterization is not supported by Dawn, it is emulated: the
+ * vertex shader moves the edges of the projected triangle outwards by half a
+ * pixel diagonal and the fragment shader discards the fragments outside of
+ * the bounds of the original triangle, so thin triangles leave no holes.
+ * WebGPU has no atomics on storage textures either, the fragments set the
+ * bits of the voxels with atomicOr() in a storage buffer, which a compute
+ * pass resolves into level 0 of the voxel texture.
+ *
+ * Level 0 holds 255 for occupied and 0 for empty voxels, every further level
+ * of the mip chain holds the average of its 8 child voxels (the coverage of
+ * the voxel in 1 / 255), e.g. the opacity for voxel cone tracing. The grid is
+ * a cube around the bounds of the triangles with a margin of one voxel.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_voxelizer wgpu_voxelizer_t;
+
+typedef struct wgpu_voxelizer_desc_t {
+  const char* label;
+  /* Voxels along each axis, a power of two up to
+   * WGPU_VOXELIZER_MAX_GRID_SIZE, 0 = 128 */
+  uint32_t grid_size;
+} wgpu_voxelizer_desc_t;
+
+/* Voxelizer creating / destroying */
+wgpu_voxelizer_t* wgpu_voxelizer_create(wgpu_context_t* wgpu_context,
+                                        const wgpu_voxelizer_desc_t* desc);
+void wgpu_voxelizer_destroy(wgpu_voxelizer_t* voxelizer);
+
+/**
+ * @brief Uploads the triangles to voxelize and fits the grid around them.
+ * @param positions triangle soup, 9 floats (3 vertices) per triangle, e.g. the
+ * world space triangles of wgpu_gltf_model_get_triangles()
+ */
+void wgpu_voxelizer_set_triangles(wgpu_voxelizer_t* voxelizer,
+                                  const float* positions,
+                                  uint32_t triangle_count);
+
+/* Recreates the grid with the given size, the grid has to be voxelized again
+ * and the views change */
+void wgpu_voxelizer_set_grid_size(wgpu_voxelizer_t* voxelizer,
+                                  uint32_t grid_size);
+uint32_t wgpu_voxelizer_get_grid_size(wgpu_voxelizer_t* voxelizer);
+
+/* Records the voxelization of the triangles and the build of the mip chain
+ * inside the "Voxelization" profiler scope */
+void wgpu_voxelizer_voxelize(wgpu_voxelizer_t* voxelizer,
+                             WGPUCommandEncoder cmd_enc);
+
+/* View of the voxel texture with all levels */
+WGPUTextureView wgpu_voxelizer_get_view(wgpu_voxelizer_t* voxelizer);
+uint32_t wgpu_voxelizer_get_level_count(wgpu_voxelizer_t* voxelizer);
+
+/* World space bounds of the grid, a cube */
+void wgpu_voxelizer_get_bounds(wgpu_voxelizer_t* voxelizer, vec3 min,
+                               vec3 max);
+
+#endif /* VOXELIZER_H */
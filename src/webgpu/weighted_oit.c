@@ -0,0 +1,365 @@
+#include "weighted_oit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "bind_group_cache.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+
+/* Output of the transparent fragment shaders, the depth weight of McGuire &
+ * Bavoil (equation 9) keeps the fp16 accumulation in range */
+// clang-format off
+static const char* weighted_oit_output_wgsl = CODE(
+  struct WeightedOitOutput {
+    @location(0) accum     : vec4f,
+    @location(1) revealage : vec4f,
+  }
+
+  fn weightedOitOutput(color : vec4f, viewDepth : f32) -> WeightedOitOutput {
+    let z      = viewDepth;
+    let weight = color.a * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0)
+                                         + pow(z / 200.0, 6.0)),
+                                 1e-2, 3e3);
+    var output : WeightedOitOutput;
+    output.accum     = vec4f(color.rgb * color.a, color.a) * weight;
+    output.revealage = vec4f(color.a);
+    return output;
+  }
+);
+// clang-format on
+
+/* Composite, the weighted average color with the coverage 1 - revealage */
+// clang-format off
+static const char* weighted_oit_composite_wgsl = CODE(
+  @group(0) @binding(0) var accumTexture : texture_2d<f32>;
+  @group(0) @binding(1) var revealageTexture : texture_2d<f32>;
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32)
+    -> @builtin(position) vec4f {
+    let uv = vec2f(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u));
+    return vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+  }
+
+  @fragment
+  fn fs_main(@builtin(position) position : vec4f) -> @location(0) vec4f {
+    let coord     = vec2i(position.xy);
+    let revealage = textureLoad(revealageTexture, coord, 0).r;
+    if (revealage >= 1.0) {
+      discard;
+    }
+    let accum = textureLoad(accumTexture, coord, 0);
+    return vec4f(accum.rgb / max(accum.a, 1e-5), 1.0 - revealage);
+  }
+);
+// clang-format on
+
+/**
+ * @brief Weighted OIT class
+ */
+struct wgpu_weighted_oit {
+  wgpu_context_t* wgpu_context;
+  const char* label;
+  WGPUTextureFormat color_format;
+  /* Transparent pass targets of the surface size */
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+  } accum, revealage;
+  uint32_t width;
+  uint32_t height;
+  /* Composite pass */
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline pipeline;
+};
+
+/* Composite pipeline */
+
+static void weighted_oit_create_pipeline(wgpu_weighted_oit_t* oit)
+{
+  wgpu_context_t* wgpu_context = oit->wgpu_context;
+
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Accumulation
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Revealage
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+  };
+  oit->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "Weighted OIT bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(oit->bind_group_layout != NULL);
+
+  oit->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .label = "Weighted OIT pipeline layout",
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts = &oit->bind_group_layout,
+                          });
+  ASSERT(oit->pipeline_layout != NULL);
+
+  /* Over operator with the coverage as source alpha */
+  WGPUBlendState blend_state = wgpu_create_blend_state(true);
+  blend_state.alpha          = (WGPUBlendComponent){
+    .operation = WGPUBlendOperation_Add,
+    .srcFactor = WGPUBlendFactor_One,
+    .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = oit->color_format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+                wgpu_context, &(wgpu_vertex_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Vertex shader WGSL
+                  .label            = "Weighted OIT composite vertex shader",
+                  .wgsl_code.source = weighted_oit_composite_wgsl,
+                  .entry            = "vs_main",
+                },
+                .buffer_count = 0,
+                .buffers      = NULL,
+              });
+
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+                wgpu_context, &(wgpu_fragment_state_t){
+                .shader_desc = (wgpu_shader_desc_t){
+                  // Fragment shader WGSL
+                  .label            = "Weighted OIT composite fragment shader",
+                  .wgsl_code.source = weighted_oit_composite_wgsl,
+                  .entry            = "fs_main",
+                },
+                .target_count = 1,
+                .targets      = &color_target_state,
+              });
+
+  oit->pipeline = wgpu_create_render_pipeline(
+    wgpu_context, &(WGPURenderPipelineDescriptor){
+                    .label     = "Weighted OIT composite pipeline",
+                    .layout    = oit->pipeline_layout,
+                    .primitive = (WGPUPrimitiveState){
+                      .topology  = WGPUPrimitiveTopology_TriangleList,
+                      .frontFace = WGPUFrontFace_CCW,
+                      .cullMode  = WGPUCullMode_None,
+                    },
+                    .vertex      = vertex_state,
+                    .fragment    = &fragment_state,
+                    .multisample = (WGPUMultisampleState){
+                      .count = 1,
+                      .mask  = 0xFFFFFFFF,
+                    },
+                  });
+  ASSERT(oit->pipeline != NULL);
+
+  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+}
+
+/* Targets */
+
+static void weighted_oit_create_target(wgpu_weighted_oit_t* oit,
+                                       WGPUTextureFormat format,
+                                       WGPUTexture* texture,
+                                       WGPUTextureView* view)
+{
+  *texture = wgpuDeviceCreateTexture(
+    oit->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = oit->label,
+      .usage = WGPUTextureUsage_RenderAttachment
+               | WGPUTextureUsage_TextureBinding,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = oit->width,
+        .height             = oit->height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = format,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(*texture != NULL);
+  *view = wgpuTextureCreateView(*texture, NULL);
+  ASSERT(*view != NULL);
+}
+
+static void weighted_oit_release_targets(wgpu_weighted_oit_t* oit)
+{
+  WGPU_RELEASE_RESOURCE(TextureView, oit->accum.view)
+  WGPU_RELEASE_RESOURCE(Texture, oit->accum.texture)
+  WGPU_RELEASE_RESOURCE(TextureView, oit->revealage.view)
+  WGPU_RELEASE_RESOURCE(Texture, oit->revealage.texture)
+}
+
+/* (Re)creates the targets if the surface size changed */
+static void weighted_oit_update_targets(wgpu_weighted_oit_t* oit)
+{
+  wgpu_context_t* wgpu_context = oit->wgpu_context;
+  if (oit->accum.view != NULL && oit->width == wgpu_context->surface.width
+      && oit->height == wgpu_context->surface.height) {
+    return;
+  }
+
+  weighted_oit_release_targets(oit);
+  oit->width  = wgpu_context->surface.width;
+  oit->height = wgpu_context->surface.height;
+  weighted_oit_create_target(oit, WGPU_WEIGHTED_OIT_ACCUM_FORMAT,
+                             &oit->accum.texture, &oit->accum.view);
+  weighted_oit_create_target(oit, WGPU_WEIGHTED_OIT_REVEALAGE_FORMAT,
+                             &oit->revealage.texture, &oit->revealage.view);
+}
+
+/* Weighted OIT creating / destroying */
+
+wgpu_weighted_oit_t*
+wgpu_weighted_oit_create(wgpu_context_t* wgpu_context,
+                         const wgpu_weighted_oit_desc_t* desc)
+{
+  wgpu_weighted_oit_t* oit = (wgpu_weighted_oit_t*)calloc(1, sizeof(*oit));
+  oit->wgpu_context        = wgpu_context;
+  oit->label = desc->label != NULL ? desc->label : "Weighted OIT target";
+  oit->color_format = (desc->color_format != WGPUTextureFormat_Undefined) ?
+                        desc->color_format :
+                        wgpu_context->swap_chain.format;
+
+  weighted_oit_create_pipeline(oit);
+
+  return oit;
+}
+
+void wgpu_weighted_oit_destroy(wgpu_weighted_oit_t* oit)
+{
+  if (oit == NULL) {
+    return;
+  }
+
+  weighted_oit_release_targets(oit);
+  WGPU_RELEASE_RESOURCE(RenderPipeline, oit->pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, oit->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, oit->bind_group_layout)
+  free(oit);
+}
+
+/* Transparent pass */
+
+void wgpu_weighted_oit_get_color_targets(WGPUBlendState blend_states[2],
+                                         WGPUColorTargetState targets[2])
+{
+  /* Sum of the weighted premultiplied colors and coverages */
+  const WGPUBlendComponent accum_component = {
+    .operation = WGPUBlendOperation_Add,
+    .srcFactor = WGPUBlendFactor_One,
+    .dstFactor = WGPUBlendFactor_One,
+  };
+  blend_states[0] = (WGPUBlendState){
+    .color = accum_component,
+    .alpha = accum_component,
+  };
+  /* Product of the transmittances, revealage * (1 - alpha) */
+  const WGPUBlendComponent revealage_component = {
+    .operation = WGPUBlendOperation_Add,
+    .srcFactor = WGPUBlendFactor_Zero,
+    .dstFactor = WGPUBlendFactor_OneMinusSrc,
+  };
+  blend_states[1] = (WGPUBlendState){
+    .color = revealage_component,
+    .alpha = revealage_component,
+  };
+
+  targets[0] = (WGPUColorTargetState){
+    .format    = WGPU_WEIGHTED_OIT_ACCUM_FORMAT,
+    .blend     = &blend_states[0],
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  targets[1] = (WGPUColorTargetState){
+    .format    = WGPU_WEIGHTED_OIT_REVEALAGE_FORMAT,
+    .blend     = &blend_states[1],
+    .writeMask = WGPUColorWriteMask_Red,
+  };
+}
+
+char* wgpu_weighted_oit_create_wgsl(const char* shader)
+{
+  const size_t output_length = strlen(weighted_oit_output_wgsl);
+  const size_t shader_length = strlen(shader);
+  char* wgsl = (char*)malloc(output_length + shader_length + 2);
+  memcpy(wgsl, weighted_oit_output_wgsl, output_length);
+  wgsl[output_length] = '\n';
+  memcpy(wgsl + output_length + 1, shader, shader_length + 1);
+  return wgsl;
+}
+
+void wgpu_weighted_oit_get_attachments(
+  wgpu_weighted_oit_t* oit, WGPURenderPassColorAttachment color_atts[2])
+{
+  weighted_oit_update_targets(oit);
+
+  /* Nothing accumulated and fully revealed */
+  color_atts[0] = (WGPURenderPassColorAttachment){
+    .view       = oit->accum.view,
+    .loadOp     = WGPULoadOp_Clear,
+    .storeOp    = WGPUStoreOp_Store,
+    .clearValue = (WGPUColor){0.0, 0.0, 0.0, 0.0},
+  };
+  color_atts[1] = (WGPURenderPassColorAttachment){
+    .view       = oit->revealage.view,
+    .loadOp     = WGPULoadOp_Clear,
+    .storeOp    = WGPUStoreOp_Store,
+    .clearValue = (WGPUColor){1.0, 1.0, 1.0, 1.0},
+  };
+}
+
+/* Composite pass */
+
+void wgpu_weighted_oit_composite(wgpu_weighted_oit_t* oit,
+                                 WGPURenderPassEncoder rpass_enc)
+{
+  ASSERT(oit->accum.view != NULL);
+
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding     = 0,
+      .textureView = oit->accum.view,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = oit->revealage.view,
+    },
+  };
+  WGPUBindGroup bind_group = wgpu_create_bind_group(
+    oit->wgpu_context, &(WGPUBindGroupDescriptor){
+                         .label      = "Weighted OIT bind group",
+                         .layout     = oit->bind_group_layout,
+                         .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                         .entries    = bg_entries,
+                       });
+  ASSERT(bind_group != NULL);
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, oit->pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_group, 0, NULL);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+
+  WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+}
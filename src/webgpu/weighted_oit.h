@@ -0,0 +1,74 @@
+#ifndef WEIGHTED_OIT_H
+#define WEIGHTED_OIT_H
+
+#include "context.h"
+
+/* Formats of the accumulation and of the revealage target */
+#define WGPU_WEIGHTED_OIT_ACCUM_FORMAT WGPUTextureFormat_RGBA16Float
+#define WGPU_WEIGHTED_OIT_REVEALAGE_FORMAT WGPUTextureFormat_R8Unorm
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU weighted blended order-independent transparency
+ *
+ * Blends transparent surfaces in any order, so they need no per-frame sorting
+ * (McGuire & Bavoil, Weighted Blended Order-Independent Transparency, 2013).
+ * The transparent pass renders into two targets of the surface size, the
+ * premultiplied colors weighted by coverage and depth are summed up in the
+ * accumulation target and the product of the transmittances is multiplied
+ * into the revealage target. The composite pass blends the weighted average
+ * color over the opaque image with the total coverage:
+ *
+ *   wgpu_weighted_oit_get_attachments(oit, color_atts);
+ *   ... transparent pass with color_atts and the depth of the opaque pass,
+ *       depth test on and depth writes off ...
+ *   wgpu_weighted_oit_composite(oit, rpass_enc);
+ *
+ * The fragment shaders of the transparent pipelines are wrapped with
+ * wgpu_weighted_oit_create_wgsl() and return
+ * weightedOitOutput(color, viewDepth), color is not premultiplied and
+ * viewDepth is the positive view space depth, e.g. the clip w of a perspective
+ * projection. The color targets of the pipelines come from
+ * wgpu_weighted_oit_get_color_targets(). The result is an approximation, the
+ * weighting favors near surfaces and the pass order of equally weighted
+ * surfaces does not matter.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_weighted_oit wgpu_weighted_oit_t;
+
+typedef struct wgpu_weighted_oit_desc_t {
+  const char* label;
+  /* Format of the composite target, Undefined = swap chain format */
+  WGPUTextureFormat color_format;
+} wgpu_weighted_oit_desc_t;
+
+/* Weighted OIT creating / destroying */
+wgpu_weighted_oit_t*
+wgpu_weighted_oit_create(wgpu_context_t* wgpu_context,
+                         const wgpu_weighted_oit_desc_t* desc);
+void wgpu_weighted_oit_destroy(wgpu_weighted_oit_t* oit);
+
+/**
+ * @brief Fills the color targets (accumulation, revealage) of a transparent
+ * pipeline, the targets point to the blend states.
+ */
+void wgpu_weighted_oit_get_color_targets(WGPUBlendState blend_states[2],
+                                         WGPUColorTargetState targets[2]);
+
+/**
+ * @brief Prepends the WeightedOitOutput struct and weightedOitOutput() to the
+ * WGSL code of a transparent fragment shader.
+ * @return the WGSL code, to be freed by the caller
+ */
+char* wgpu_weighted_oit_create_wgsl(const char* shader);
+
+/* Fills the color attachments (accumulation, revealage) of the transparent
+ * pass, the targets are recreated when the surface size changes */
+void wgpu_weighted_oit_get_attachments(
+  wgpu_weighted_oit_t* oit, WGPURenderPassColorAttachment color_atts[2]);
+
+/* Records the composite of the transparent pass into a render pass with one
+ * color attachment of the composite format and no depth-stencil attachment */
+void wgpu_weighted_oit_composite(wgpu_weighted_oit_t* oit,
+                                 WGPURenderPassEncoder rpass_enc);
+
+#endif /* WEIGHTED_OIT_H */
@@ -0,0 +1,346 @@
+#include "workgroup_tuner.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#define WORKGROUP_TUNER_FILENAME "workgroup_sizes.txt"
+#define WORKGROUP_TUNER_INITIAL_CAPACITY 16u
+#define WORKGROUP_TUNER_DEFAULT_DISPATCH_COUNT 8u
+/* Measured passes per candidate, the first pass is a warm-up */
+#define WORKGROUP_TUNER_PASS_COUNT 4u
+
+static const uint32_t workgroup_tuner_default_candidates[4] = {32, 64, 128,
+                                                               256};
+
+/* Adapter the results were measured on */
+typedef struct workgroup_tuner_adapter_t {
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint32_t backend_type;
+} workgroup_tuner_adapter_t;
+
+typedef struct workgroup_tuner_entry_t {
+  workgroup_tuner_adapter_t adapter;
+  char name[WGPU_WORKGROUP_TUNER_NAME_SIZE];
+  uint32_t workgroup_size;
+} workgroup_tuner_entry_t;
+
+struct wgpu_workgroup_tuner {
+  workgroup_tuner_adapter_t adapter; /* adapter of the context */
+  char filename[STRMAX];             /* empty if the results are not stored */
+  workgroup_tuner_entry_t* entries;  /* results of all adapters in the file */
+  uint32_t count;
+  uint32_t capacity;
+};
+
+/* -------------------------------------------------------------------------- *
+ * Results cache
+ * -------------------------------------------------------------------------- */
+
+static void workgroup_tuner_insert(wgpu_workgroup_tuner_t* tuner,
+                                   const workgroup_tuner_entry_t* entry)
+{
+  if (tuner->count == tuner->capacity) {
+    tuner->capacity = tuner->capacity ? tuner->capacity * 2 :
+                                        WORKGROUP_TUNER_INITIAL_CAPACITY;
+    tuner->entries  = (workgroup_tuner_entry_t*)realloc(
+      tuner->entries, tuner->capacity * sizeof(workgroup_tuner_entry_t));
+  }
+  tuner->entries[tuner->count++] = *entry;
+}
+
+static void workgroup_tuner_load(wgpu_workgroup_tuner_t* tuner)
+{
+  FILE* file = fopen(tuner->filename, "r");
+  if (file == NULL) {
+    return;
+  }
+  // One result per line: vendor ID, device ID, backend, kernel name, size
+  workgroup_tuner_entry_t entry = {0};
+  while (fscanf(file, "%x %x %u %63s %u", &entry.adapter.vendor_id,
+                &entry.adapter.device_id, &entry.adapter.backend_type,
+                entry.name, &entry.workgroup_size)
+         == 5) {
+    workgroup_tuner_insert(tuner, &entry);
+  }
+  fclose(file);
+}
+
+static void workgroup_tuner_store(wgpu_workgroup_tuner_t* tuner,
+                                  const workgroup_tuner_entry_t* entry)
+{
+  if (tuner->filename[0] == '\0') {
+    return;
+  }
+  FILE* file = fopen(tuner->filename, "a");
+  if (file == NULL) {
+    log_warn("Unable to store the workgroup size in %s", tuner->filename);
+    return;
+  }
+  fprintf(file, "%08x %08x %u %s %u\n", entry->adapter.vendor_id,
+          entry->adapter.device_id, entry->adapter.backend_type, entry->name,
+          entry->workgroup_size);
+  fclose(file);
+}
+
+static wgpu_workgroup_tuner_t*
+workgroup_tuner_get(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->workgroup_tuner != NULL) {
+    return wgpu_context->workgroup_tuner;
+  }
+
+  wgpu_workgroup_tuner_t* tuner
+    = (wgpu_workgroup_tuner_t*)calloc(1, sizeof(wgpu_workgroup_tuner_t));
+  WGPUAdapterProperties properties = {0};
+  wgpuAdapterGetProperties(wgpu_context->adapter, &properties);
+  tuner->adapter = (workgroup_tuner_adapter_t){
+    .vendor_id    = properties.vendorID,
+    .device_id    = properties.deviceID,
+    .backend_type = (uint32_t)properties.backendType,
+  };
+  // Results are stored next to the backend pipeline cache
+  const char* directory = wgpu_get_pipeline_cache_dir();
+  if (directory != NULL) {
+    snprintf(tuner->filename, sizeof(tuner->filename), "%s/%s", directory,
+             WORKGROUP_TUNER_FILENAME);
+    workgroup_tuner_load(tuner);
+  }
+
+  wgpu_context->workgroup_tuner = tuner;
+  return tuner;
+}
+
+static const workgroup_tuner_entry_t*
+workgroup_tuner_find(const wgpu_workgroup_tuner_t* tuner, const char* name)
+{
+  // The last result of a kernel wins
+  for (uint32_t i = tuner->count; i > 0; --i) {
+    const workgroup_tuner_entry_t* entry = &tuner->entries[i - 1];
+    if (memcmp(&entry->adapter, &tuner->adapter, sizeof(tuner->adapter)) == 0
+        && strcmp(entry->name, name) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void wgpu_workgroup_tuner_release(wgpu_workgroup_tuner_t* workgroup_tuner)
+{
+  if (workgroup_tuner == NULL) {
+    return;
+  }
+  free(workgroup_tuner->entries);
+  free(workgroup_tuner);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Measurement
+ * -------------------------------------------------------------------------- */
+
+typedef struct workgroup_tuner_readback_t {
+  bool done;
+  WGPUBufferMapAsyncStatus status;
+} workgroup_tuner_readback_t;
+
+static void workgroup_tuner_map_callback(WGPUBufferMapAsyncStatus status,
+                                         void* user_data)
+{
+  workgroup_tuner_readback_t* readback
+    = (workgroup_tuner_readback_t*)user_data;
+  readback->status = status;
+  readback->done   = true;
+}
+
+static bool workgroup_size_fits(const WGPULimits* limits,
+                                uint32_t workgroup_size,
+                                uint32_t dimension_count)
+{
+  const uint32_t max_size[3] = {
+    limits->maxComputeWorkgroupSizeX,
+    limits->maxComputeWorkgroupSizeY,
+    limits->maxComputeWorkgroupSizeZ,
+  };
+  uint64_t invocations = 1;
+  for (uint32_t d = 0; d < dimension_count; ++d) {
+    if (workgroup_size > max_size[d]) {
+      return false;
+    }
+    invocations *= workgroup_size;
+  }
+  return invocations <= limits->maxComputeInvocationsPerWorkgroup;
+}
+
+/**
+ * @brief Measures the GPU time of the dispatches of the kernel with one
+ * workgroup size.
+ * @return the fastest pass time in milliseconds, a negative value on failure
+ */
+static double workgroup_tuner_measure(wgpu_context_t* wgpu_context,
+                                      const wgpu_workgroup_tuner_desc_t* desc,
+                                      uint32_t workgroup_size,
+                                      WGPUQuerySet query_set,
+                                      WGPUBuffer resolve_buffer,
+                                      WGPUBuffer readback_buffer)
+{
+  WGPUComputePipeline pipeline
+    = desc->create_pipeline(wgpu_context, workgroup_size, desc->user_data);
+  if (pipeline == NULL) {
+    return -1.0;
+  }
+
+  const uint32_t dispatch_count = desc->dispatch_count ?
+                                    desc->dispatch_count :
+                                    WORKGROUP_TUNER_DEFAULT_DISPATCH_COUNT;
+  const uint32_t query_count    = WORKGROUP_TUNER_PASS_COUNT * 2;
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t pass = 0; pass < WORKGROUP_TUNER_PASS_COUNT; ++pass) {
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, query_set, pass * 2);
+    WGPUComputePassEncoder pass_encoder
+      = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+    wgpuComputePassEncoderSetPipeline(pass_encoder, pipeline);
+    for (uint32_t i = 0; i < dispatch_count; ++i) {
+      desc->dispatch(pass_encoder, workgroup_size, desc->user_data);
+    }
+    wgpuComputePassEncoderEnd(pass_encoder);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass_encoder)
+    wgpuCommandEncoderWriteTimestamp(cmd_enc, query_set, pass * 2 + 1);
+  }
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, query_set, 0, query_count,
+                                    resolve_buffer, 0);
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, resolve_buffer, 0,
+                                       readback_buffer, 0,
+                                       query_count * sizeof(uint64_t));
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, pipeline)
+
+  workgroup_tuner_readback_t readback = {0};
+  wgpuBufferMapAsync(readback_buffer, WGPUMapMode_Read, 0,
+                     query_count * sizeof(uint64_t),
+                     workgroup_tuner_map_callback, &readback);
+  while (!readback.done) {
+    wgpuDeviceTick(wgpu_context->device);
+  }
+  if (readback.status != WGPUBufferMapAsyncStatus_Success) {
+    return -1.0;
+  }
+
+  const uint64_t* timestamps = (const uint64_t*)wgpuBufferGetConstMappedRange(
+    readback_buffer, 0, query_count * sizeof(uint64_t));
+  double time_ms = DBL_MAX;
+  for (uint32_t pass = 1; pass < WORKGROUP_TUNER_PASS_COUNT; ++pass) {
+    const uint64_t begin = timestamps[pass * 2];
+    const uint64_t end   = timestamps[pass * 2 + 1];
+    // Timestamps are in nanoseconds
+    if (end > begin) {
+      time_ms = MIN(time_ms, (end - begin) / 1.0e6);
+    }
+  }
+  wgpuBufferUnmap(readback_buffer);
+  return (time_ms < DBL_MAX) ? time_ms : -1.0;
+}
+
+static uint32_t
+workgroup_tuner_benchmark(wgpu_context_t* wgpu_context,
+                          const wgpu_workgroup_tuner_desc_t* desc)
+{
+  WGPUSupportedLimits supported_limits = {0};
+  wgpuDeviceGetLimits(wgpu_context->device, &supported_limits);
+  const uint32_t dimension_count
+    = desc->dimension_count ? desc->dimension_count : 1;
+  const uint32_t* candidates = workgroup_tuner_default_candidates;
+  uint32_t candidate_count
+    = (uint32_t)ARRAY_SIZE(workgroup_tuner_default_candidates);
+  if (desc->candidates != NULL) {
+    candidates      = desc->candidates;
+    candidate_count = desc->candidate_count;
+  }
+
+  const uint64_t buffer_size
+    = WORKGROUP_TUNER_PASS_COUNT * 2 * sizeof(uint64_t);
+  WGPUQuerySet query_set = wgpuDeviceCreateQuerySet(
+    wgpu_context->device, &(WGPUQuerySetDescriptor){
+                            .label = "Workgroup tuner timestamp query set",
+                            .type  = WGPUQueryType_Timestamp,
+                            .count = WORKGROUP_TUNER_PASS_COUNT * 2,
+                          });
+  WGPUBuffer resolve_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Workgroup tuner resolve buffer",
+      .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+      .size  = buffer_size,
+    });
+  WGPUBuffer readback_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Workgroup tuner readback buffer",
+      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+      .size  = buffer_size,
+    });
+  ASSERT(query_set && resolve_buffer && readback_buffer);
+
+  uint32_t best_size  = desc->default_size;
+  double best_time_ms = DBL_MAX;
+  for (uint32_t i = 0; i < candidate_count; ++i) {
+    if (!workgroup_size_fits(&supported_limits.limits, candidates[i],
+                             dimension_count)) {
+      continue;
+    }
+    const double time_ms
+      = workgroup_tuner_measure(wgpu_context, desc, candidates[i], query_set,
+                                resolve_buffer, readback_buffer);
+    log_debug("Workgroup size %u of %s: %.3f ms", candidates[i], desc->name,
+              time_ms);
+    if (time_ms >= 0.0 && time_ms < best_time_ms) {
+      best_time_ms = time_ms;
+      best_size    = candidates[i];
+    }
+  }
+
+  WGPU_RELEASE_RESOURCE(Buffer, readback_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, resolve_buffer)
+  WGPU_RELEASE_RESOURCE(QuerySet, query_set)
+
+  return best_size;
+}
+
+uint32_t wgpu_tune_workgroup_size(wgpu_context_t* wgpu_context,
+                                  const wgpu_workgroup_tuner_desc_t* desc)
+{
+  ASSERT(desc->name && desc->create_pipeline && desc->dispatch);
+  ASSERT(strlen(desc->name) < WGPU_WORKGROUP_TUNER_NAME_SIZE);
+
+  wgpu_workgroup_tuner_t* tuner = workgroup_tuner_get(wgpu_context);
+  const workgroup_tuner_entry_t* cached
+    = workgroup_tuner_find(tuner, desc->name);
+  if (cached != NULL) {
+    return cached->workgroup_size;
+  }
+
+  if (!wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery)) {
+    log_warn("Timestamp queries not supported, using workgroup size %u for %s",
+             desc->default_size, desc->name);
+    return desc->default_size;
+  }
+
+  workgroup_tuner_entry_t entry = {
+    .adapter        = tuner->adapter,
+    .workgroup_size = workgroup_tuner_benchmark(wgpu_context, desc),
+  };
+  snprintf(entry.name, sizeof(entry.name), "%s", desc->name);
+  workgroup_tuner_insert(tuner, &entry);
+  workgroup_tuner_store(tuner, &entry);
+  log_info("Tuned workgroup size of %s: %u", desc->name, entry.workgroup_size);
+
+  return entry.workgroup_size;
+}
@@ -0,0 +1,52 @@
+#ifndef WORKGROUP_TUNER_H
+#define WORKGROUP_TUNER_H
+
+#include "context.h"
+
+#define WGPU_WORKGROUP_TUNER_NAME_SIZE 64u
+
+/* -------------------------------------------------------------------------- *
+ * Workgroup size autotuner
+ *
+ * Measures a compute kernel with each candidate workgroup size using timestamp
+ * queries and returns the fastest size. Results are cached per adapter (vendor
+ * ID, device ID and backend) and kernel name: in memory for the lifetime of
+ * the context and in the pipeline cache directory across runs. Tuning blocks
+ * until the measurements are read back, so it is done during initialization.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_workgroup_tuner_desc_t {
+  /* Identifies the kernel in the cache, must not contain whitespace */
+  const char* name;
+  /* Candidate sizes, defaults to 32, 64, 128 and 256. Candidates exceeding
+   * the device limits are skipped. */
+  uint32_t candidate_count;
+  const uint32_t* candidates;
+  /* Dimensions of the workgroup, the workgroup has size^dimension_count
+   * invocations (default: 1) */
+  uint32_t dimension_count;
+  /* Size returned if timestamp queries are not supported */
+  uint32_t default_size;
+  /* Dispatches per measurement (default: 8) */
+  uint32_t dispatch_count;
+  /* Creates the pipeline specialized to the workgroup size, e.g. using a
+   * workgroup_size override constant */
+  WGPUComputePipeline (*create_pipeline)(wgpu_context_t* wgpu_context,
+                                         uint32_t workgroup_size,
+                                         void* user_data);
+  /* Records one dispatch, the pipeline is already set. Sets the bind groups
+   * and derives the workgroup count from the workgroup size. */
+  void (*dispatch)(WGPUComputePassEncoder pass_encoder,
+                   uint32_t workgroup_size, void* user_data);
+  void* user_data;
+} wgpu_workgroup_tuner_desc_t;
+
+/* Returns the fastest workgroup size of the kernel on the current adapter */
+uint32_t wgpu_tune_workgroup_size(wgpu_context_t* wgpu_context,
+                                  const wgpu_workgroup_tuner_desc_t* desc);
+
+/* Tuning results releasing */
+typedef struct wgpu_workgroup_tuner wgpu_workgroup_tuner_t;
+void wgpu_workgroup_tuner_release(wgpu_workgroup_tuner_t* workgroup_tuner);
+
+#endif
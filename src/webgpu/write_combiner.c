@@ -0,0 +1,296 @@
+#include "write_combiner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+#include "upload_ring.h"
+
+typedef struct wgpu_combined_write_t {
+  WGPUBuffer buffer; /* referenced until the write is uploaded */
+  uint64_t buffer_offset;
+  uint64_t size;
+  uint64_t data_offset; /* offset of the data in the CPU region */
+  uint32_t sequence;    /* order of the writes */
+} wgpu_combined_write_t;
+
+/**
+ * @brief Write combiner class
+ */
+struct wgpu_write_combiner {
+  wgpu_context_t* wgpu_context;
+  bool enabled;
+  /* Pending writes */
+  wgpu_combined_write_t* writes;
+  uint32_t write_count;
+  uint32_t write_capacity;
+  /* Data of the pending writes */
+  uint8_t* data;
+  uint64_t data_size;
+  uint64_t data_capacity;
+};
+
+static struct {
+  DawnProcTable procs; /* wrapped procs */
+  /* Combiner of the device, NULL before the device is created */
+  wgpu_write_combiner_t* active;
+} combiner_hook = {0};
+
+/* Write combiner creating / releasing */
+
+wgpu_write_combiner_t* wgpu_write_combiner_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_write_combiner_t* combiner
+    = (wgpu_write_combiner_t*)malloc(sizeof(wgpu_write_combiner_t));
+  memset(combiner, 0, sizeof(wgpu_write_combiner_t));
+
+  combiner->wgpu_context = wgpu_context;
+  combiner->enabled      = true;
+  combiner_hook.active   = combiner;
+
+  return combiner;
+}
+
+static void write_combiner_clear(wgpu_write_combiner_t* this)
+{
+  for (uint32_t i = 0; i < this->write_count; ++i) {
+    wgpuBufferRelease(this->writes[i].buffer);
+  }
+  this->write_count = 0;
+  this->data_size   = 0;
+}
+
+void wgpu_write_combiner_release(wgpu_write_combiner_t* write_combiner)
+{
+  if (write_combiner == NULL) {
+    return;
+  }
+
+  if (combiner_hook.active == write_combiner) {
+    combiner_hook.active = NULL;
+  }
+  write_combiner_clear(write_combiner);
+  free(write_combiner->writes);
+  free(write_combiner->data);
+  free(write_combiner);
+}
+
+void wgpu_write_combiner_set_enabled(wgpu_write_combiner_t* write_combiner,
+                                     bool enabled)
+{
+  if (!enabled) {
+    wgpu_write_combiner_flush(write_combiner);
+  }
+  write_combiner->enabled = enabled;
+}
+
+/* Recording */
+
+static void write_combiner_record(wgpu_write_combiner_t* this,
+                                  WGPUBuffer buffer, uint64_t buffer_offset,
+                                  void const* data, uint64_t size)
+{
+  if (this->write_count == this->write_capacity) {
+    this->write_capacity = MAX(this->write_capacity * 2, 64u);
+    this->writes         = (wgpu_combined_write_t*)realloc(
+      this->writes, this->write_capacity * sizeof(wgpu_combined_write_t));
+  }
+  if (this->data_size + size > this->data_capacity) {
+    this->data_capacity
+      = MAX(this->data_capacity * 2, MAX(this->data_size + size, 64u * 1024u));
+    this->data = (uint8_t*)realloc(this->data, this->data_capacity);
+  }
+
+  memcpy(this->data + this->data_size, data, size);
+  wgpuBufferReference(buffer);
+  this->writes[this->write_count] = (wgpu_combined_write_t){
+    .buffer        = buffer,
+    .buffer_offset = buffer_offset,
+    .size          = size,
+    .data_offset   = this->data_size,
+    .sequence      = this->write_count,
+  };
+  ++this->write_count;
+  this->data_size += size;
+}
+
+static bool write_combiner_has_writes(wgpu_write_combiner_t* this,
+                                      WGPUBuffer buffer)
+{
+  for (uint32_t i = 0; i < this->write_count; ++i) {
+    if (this->writes[i].buffer == buffer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Flushing */
+
+/* Sorted by buffer and offset, the writes of a buffer range are consecutive */
+static int compare_by_buffer_offset(const void* a, const void* b)
+{
+  const wgpu_combined_write_t* wa = (const wgpu_combined_write_t*)a;
+  const wgpu_combined_write_t* wb = (const wgpu_combined_write_t*)b;
+  if (wa->buffer != wb->buffer) {
+    return (uintptr_t)wa->buffer < (uintptr_t)wb->buffer ? -1 : 1;
+  }
+  if (wa->buffer_offset != wb->buffer_offset) {
+    return wa->buffer_offset < wb->buffer_offset ? -1 : 1;
+  }
+  return wa->sequence < wb->sequence ? -1 : 1;
+}
+
+static int compare_by_sequence(const void* a, const void* b)
+{
+  const wgpu_combined_write_t* wa = (const wgpu_combined_write_t*)a;
+  const wgpu_combined_write_t* wb = (const wgpu_combined_write_t*)b;
+  return wa->sequence < wb->sequence ? -1 : 1;
+}
+
+/* Uploads the writes of one merged range with a single copy */
+static void write_combiner_upload_range(wgpu_write_combiner_t* this,
+                                        wgpu_combined_write_t* writes,
+                                        uint32_t write_count,
+                                        uint64_t range_offset,
+                                        uint64_t range_size)
+{
+  /* Overlapping writes are applied in their original order */
+  if (write_count > 1) {
+    qsort(writes, write_count, sizeof(wgpu_combined_write_t),
+          compare_by_sequence);
+  }
+
+  uint8_t* mapped_data = (uint8_t*)wgpu_upload_ring_reserve_buffer(
+    this->wgpu_context->upload_ring, writes[0].buffer, range_offset,
+    range_size);
+  for (uint32_t i = 0; i < write_count; ++i) {
+    const wgpu_combined_write_t* write = &writes[i];
+    if (mapped_data != NULL) {
+      memcpy(mapped_data + (write->buffer_offset - range_offset),
+             this->data + write->data_offset, write->size);
+    }
+    else {
+      /* Upload ring memory limit reached, written by the queue instead */
+      combiner_hook.procs.queueWriteBuffer(
+        this->wgpu_context->queue, write->buffer, write->buffer_offset,
+        this->data + write->data_offset, write->size);
+    }
+  }
+}
+
+void wgpu_write_combiner_flush(wgpu_write_combiner_t* write_combiner)
+{
+  wgpu_write_combiner_t* this = write_combiner;
+  if (this == NULL || this->write_count == 0) {
+    return;
+  }
+
+  qsort(this->writes, this->write_count, sizeof(wgpu_combined_write_t),
+        compare_by_buffer_offset);
+
+  uint32_t first = 0;
+  while (first < this->write_count) {
+    const WGPUBuffer buffer = this->writes[first].buffer;
+    const uint64_t begin    = this->writes[first].buffer_offset;
+    uint64_t end            = begin + this->writes[first].size;
+    uint32_t last           = first + 1;
+    while (last < this->write_count && this->writes[last].buffer == buffer
+           && this->writes[last].buffer_offset <= end) {
+      end = MAX(end,
+                this->writes[last].buffer_offset + this->writes[last].size);
+      ++last;
+    }
+    write_combiner_upload_range(this, &this->writes[first], last - first,
+                                begin, end - begin);
+    first = last;
+  }
+
+  /* Cleared first, the upload ring submit passes through the submit hook */
+  write_combiner_clear(this);
+  wgpu_upload_ring_flush(this->wgpu_context->upload_ring);
+}
+
+/* Intercepted procs */
+
+static void combiner_queue_write_buffer(WGPUQueue queue, WGPUBuffer buffer,
+                                        uint64_t buffer_offset,
+                                        void const* data, size_t size)
+{
+  wgpu_write_combiner_t* combiner = combiner_hook.active;
+  if (combiner == NULL || !combiner->enabled
+      || combiner->wgpu_context->queue != queue) {
+    combiner_hook.procs.queueWriteBuffer(queue, buffer, buffer_offset, data,
+                                         size);
+    return;
+  }
+
+  /* Misaligned writes are passed on for the validation error */
+  if (size > 0 && size <= WGPU_WRITE_COMBINER_MAX_WRITE_SIZE
+      && buffer_offset % 4 == 0 && size % 4 == 0) {
+    write_combiner_record(combiner, buffer, buffer_offset, data, size);
+    return;
+  }
+
+  if (write_combiner_has_writes(combiner, buffer)) {
+    wgpu_write_combiner_flush(combiner);
+  }
+  combiner_hook.procs.queueWriteBuffer(queue, buffer, buffer_offset, data,
+                                       size);
+}
+
+static void combiner_queue_submit(WGPUQueue queue, uint32_t command_count,
+                                  WGPUCommandBuffer const* commands)
+{
+  wgpu_write_combiner_t* combiner = combiner_hook.active;
+  if (combiner != NULL && combiner->wgpu_context->queue == queue) {
+    wgpu_write_combiner_flush(combiner);
+  }
+  combiner_hook.procs.queueSubmit(queue, command_count, commands);
+}
+
+static void combiner_queue_on_submitted_work_done(
+  WGPUQueue queue, uint64_t signal_value, WGPUQueueWorkDoneCallback callback,
+  void* userdata)
+{
+  /* The queue writes are part of the submitted work */
+  wgpu_write_combiner_t* combiner = combiner_hook.active;
+  if (combiner != NULL && combiner->wgpu_context->queue == queue) {
+    wgpu_write_combiner_flush(combiner);
+  }
+  combiner_hook.procs.queueOnSubmittedWorkDone(queue, signal_value, callback,
+                                               userdata);
+}
+
+static void combiner_buffer_map_async(WGPUBuffer buffer, WGPUMapModeFlags mode,
+                                      size_t offset, size_t size,
+                                      WGPUBufferMapCallback callback,
+                                      void* userdata)
+{
+  wgpu_write_combiner_t* combiner = combiner_hook.active;
+  if (combiner != NULL && write_combiner_has_writes(combiner, buffer)) {
+    wgpu_write_combiner_flush(combiner);
+  }
+  combiner_hook.procs.bufferMapAsync(buffer, mode, offset, size, callback,
+                                     userdata);
+}
+
+static void combiner_buffer_destroy(WGPUBuffer buffer)
+{
+  wgpu_write_combiner_t* combiner = combiner_hook.active;
+  if (combiner != NULL && write_combiner_has_writes(combiner, buffer)) {
+    wgpu_write_combiner_flush(combiner);
+  }
+  combiner_hook.procs.bufferDestroy(buffer);
+}
+
+void wgpu_write_combiner_hook_procs(DawnProcTable* procs)
+{
+  combiner_hook.procs = *procs;
+
+  procs->queueWriteBuffer         = combiner_queue_write_buffer;
+  procs->queueSubmit              = combiner_queue_submit;
+  procs->queueOnSubmittedWorkDone = combiner_queue_on_submitted_work_done;
+  procs->bufferMapAsync           = combiner_buffer_map_async;
+  procs->bufferDestroy            = combiner_buffer_destroy;
+}
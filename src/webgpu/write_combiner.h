@@ -0,0 +1,50 @@
+#ifndef WRITE_COMBINER_H
+#define WRITE_COMBINER_H
+
+#include <dawn/dawn_proc_table.h>
+
+#include "context.h"
+
+/* Writes up to this size are combined, larger writes go to the queue */
+#define WGPU_WRITE_COMBINER_MAX_WRITE_SIZE (64u * 1024u)
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU write combiner
+ *
+ * Collects the small queue buffer writes (wgpuQueueWriteBuffer and
+ * wgpu_queue_write_buffer()) of a frame in a contiguous CPU region instead of
+ * passing every write to the driver. Before the next queue submit the writes
+ * are sorted per buffer, overlapping and adjacent writes are merged into one
+ * range (later writes win) and every range is uploaded with one copy of the
+ * upload ring. Redundant writes, e.g. the same uniforms written by several
+ * update calls, are uploaded once.
+ *
+ * The queue order is kept: the pending writes of a buffer are uploaded before
+ * a large write, a map request or the destruction of the buffer, and all
+ * pending writes before any submit or work done callback request. Only the
+ * copies recorded directly into the upload ring may run before combined
+ * writes to the same range.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_write_combiner wgpu_write_combiner_t;
+
+/* Write combiner creating / releasing, pending writes are dropped */
+wgpu_write_combiner_t* wgpu_write_combiner_create(wgpu_context_t* wgpu_context);
+void wgpu_write_combiner_release(wgpu_write_combiner_t* write_combiner);
+
+/* Enabled on creation, disabling uploads the pending writes */
+void wgpu_write_combiner_set_enabled(wgpu_write_combiner_t* write_combiner,
+                                     bool enabled);
+
+/**
+ * @brief Uploads the pending writes and submits the upload ring. Done before
+ * every queue submit, wgpu_flush_command_buffers() calls it before flushing
+ * the upload ring.
+ */
+void wgpu_write_combiner_flush(wgpu_write_combiner_t* write_combiner);
+
+/* Proc table hook combining the queue buffer writes, see
+ * wgpu_set_proc_table_hook() */
+void wgpu_write_combiner_hook_procs(DawnProcTable* procs);
+
+#endif /* WRITE_COMBINER_H */